@@ -0,0 +1,294 @@
+//
+// File: bpp_model_bench.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/*
+ * Micro-benchmark of substitution model kernels.
+ *
+ * For each model class, measures the cost of updateMatrices (triggered by
+ * a parameter change), getPij_t, getdPij_dt and getd2Pij_dt2, over a range
+ * of parameter values and branch lengths. Results are given in ns per call
+ * and heap allocations per call. The transition matrix cache is disabled,
+ * so that every call computes its matrix.
+ *
+ * The 'path' column tells how exponentials are computed: 'eigen' for a
+ * real diagonalization, 'complex' for complex eigenvalues, and 'pade' or
+ * 'taylor' when the eigenvectors are singular. Both fallbacks are timed
+ * for models taking them.
+ *
+ * Results are written as tab-separated lines: model, path, measure, value, unit.
+ *
+ * Usage: bpp-model-bench [--repeats N] [--output file]
+ */
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+#include <Bpp/Phyl/Model/AbstractSubstitutionModel.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Model/Protein/LG08.h>
+#include <Bpp/Phyl/Model/Protein/Coala.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/Codon/MG94.h>
+#include <Bpp/Phyl/Model/Codon/KroneckerCodonDistanceSubstitutionModel.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/CodonFrequenciesSet.h>
+#include <Bpp/Phyl/Model/RE08.h>
+#include <Bpp/Phyl/Model/G2001.h>
+#include <Bpp/Phyl/Model/TS98.h>
+#include <Bpp/Phyl/Simulation/CounterBasedRandomStream.h>
+
+// From the STL:
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace bpp;
+using namespace std;
+
+/*
+ * Count heap allocations, by replacing the global allocation functions.
+ * The benchmark is single-threaded.
+ */
+static size_t nbAllocations = 0;
+
+void* operator new(size_t size)
+{
+  ++nbAllocations;
+  void* p = malloc(size == 0 ? 1 : size);
+  if (!p)
+    throw bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+namespace
+{
+  typedef chrono::steady_clock Clock;
+
+  /**
+   * @brief Time and count the allocations of a number of calls.
+   */
+  class Measure
+  {
+  private:
+    Clock::time_point start_;
+    size_t allocations_;
+
+  public:
+    Measure() : start_(Clock::now()), allocations_(nbAllocations) {}
+
+  public:
+    void report(ostream& out, const string& model, const string& path, const string& measure, size_t nbCalls) const
+    {
+      double ns = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start_).count());
+      double n = static_cast<double>(nbCalls);
+      out << model << "\t" << path << "\t" << measure << "\t" << setprecision(6) << ns / n << "\tns/call" << endl;
+      out << model << "\t" << path << "\t" << measure << "\t" << static_cast<double>(nbAllocations - allocations_) / n << "\tallocations/call" << endl;
+    }
+  };
+
+  /**
+   * @return Two values for the first independent parameter, both within its constraint.
+   */
+  vector<double> getParameterValues(const Parameter& p)
+  {
+    vector<double> values(1, p.getValue());
+    double v = p.getValue() == 0 ? 0.1 : p.getValue() * 1.1;
+    if (p.hasConstraint() && !p.getConstraint()->isCorrect(v))
+      v = p.getValue() * 0.9;
+    values.push_back(v);
+    return values;
+  }
+
+  string getPath(const SubstitutionModel& model)
+  {
+    const AbstractSubstitutionModel* asm_ = dynamic_cast<const AbstractSubstitutionModel*>(&model);
+    if (!asm_)
+      return "eigen"; // Markov modulated models always diagonalize their generator.
+    if (!asm_->isNonSingular())
+      return asm_->enablePadeExponential() ? "pade" : "taylor";
+    return asm_->isDiagonalizable() ? "eigen" : "complex";
+  }
+
+  void benchmarkModel(ostream& out, SubstitutionModel& model, unsigned int repeats)
+  {
+    AbstractSubstitutionModel* asm_ = dynamic_cast<AbstractSubstitutionModel*>(&model);
+    if (asm_)
+      asm_->setTransitionMatrixCacheSize(0);
+    string name = model.getName();
+    ParameterList parameters = model.getIndependentParameters();
+    vector<double> values = getParameterValues(parameters[0]);
+    string parameterName = parameters[0].getName();
+
+    // Branch lengths from 0.001 to 3, evenly spaced on a log scale:
+    vector<double> lengths;
+    for (size_t i = 0; i < 32; ++i)
+      lengths.push_back(0.001 * pow(3000., static_cast<double>(i) / 31.));
+
+    Measure update;
+    for (unsigned int i = 0; i < repeats; ++i)
+      model.setParameterValue(parameterName, values[i % 2]);
+    update.report(out, name, getPath(model), "updateMatrices", repeats);
+
+    // Time both fallbacks for models with singular eigenvectors:
+    vector<bool> pade(1, asm_ ? asm_->enablePadeExponential() : true);
+    if (asm_ && !asm_->isNonSingular())
+      pade.push_back(!pade[0]);
+    for (size_t k = 0; k < pade.size(); ++k)
+    {
+      if (asm_)
+        asm_->enablePadeExponential(pade[k]);
+      string path = getPath(model);
+      size_t nbCalls = 0;
+      Measure pij;
+      for (unsigned int i = 0; i < repeats; ++i)
+        for (size_t j = 0; j < lengths.size(); ++j, ++nbCalls)
+          model.getPij_t(lengths[j]);
+      pij.report(out, name, path, "getPij_t", nbCalls);
+
+      nbCalls = 0;
+      Measure dpij;
+      for (unsigned int i = 0; i < repeats; ++i)
+        for (size_t j = 0; j < lengths.size(); ++j, ++nbCalls)
+          model.getdPij_dt(lengths[j]);
+      dpij.report(out, name, path, "getdPij_dt", nbCalls);
+
+      nbCalls = 0;
+      Measure d2pij;
+      for (unsigned int i = 0; i < repeats; ++i)
+        for (size_t j = 0; j < lengths.size(); ++j, ++nbCalls)
+          model.getd2Pij_dt2(lengths[j]);
+      d2pij.report(out, name, path, "getd2Pij_dt2", nbCalls);
+    }
+    if (asm_)
+      asm_->enablePadeExponential(pade[0]);
+  }
+
+  /**
+   * @return Random protein sequences, used to compute the axes of the Coala model.
+   */
+  VectorSiteContainer* createProteinData()
+  {
+    const string letters = "ARNDCQEGHILKMFPSTWYV";
+    VectorSiteContainer* sites = new VectorSiteContainer(&AlphabetTools::PROTEIN_ALPHABET);
+    for (size_t i = 0; i < 10; ++i)
+    {
+      CounterBasedRandomStream random(42, i);
+      string sequence;
+      for (size_t j = 0; j < 200; ++j)
+        sequence += letters[random.giveIntRandomNumberBetweenZeroAndEntry(letters.size())];
+      sites->addSequence(BasicSequence("P" + TextTools::toString(i), sequence, &AlphabetTools::PROTEIN_ALPHABET));
+    }
+    return sites;
+  }
+}
+
+/******************************************************************************/
+
+int main(int argc, char** argv)
+{
+  unsigned int repeats = 100;
+  string outputPath;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--repeats" && i + 1 < argc)
+      repeats = static_cast<unsigned int>(atoi(argv[++i]));
+    else if (arg == "--output" && i + 1 < argc)
+      outputPath = argv[++i];
+    else
+    {
+      cerr << "Usage: bpp-model-bench [--repeats N] [--output file]" << endl;
+      return 1;
+    }
+  }
+
+  ofstream file;
+  if (!outputPath.empty())
+    file.open(outputPath.c_str());
+  ostream& out = outputPath.empty() ? cout : file;
+  out << "model\tpath\tmeasure\tvalue\tunit" << endl;
+
+  try
+  {
+    const NucleicAlphabet* dna = &AlphabetTools::DNA_ALPHABET;
+    const ProteicAlphabet* protein = &AlphabetTools::PROTEIN_ALPHABET;
+    StandardGeneticCode gc(dna);
+
+    vector<SubstitutionModel*> models;
+    models.push_back(new GTR(dna, 1., 0.5, 0.3, 0.2, 0.4, 0.3, 0.2, 0.2, 0.3));
+    models.push_back(new LG08(protein));
+    models.push_back(new YN98(&gc, CodonFrequenciesSet::getFrequenciesSetForCodons(CodonFrequenciesSet::F3X4, &gc)));
+    models.push_back(new MG94(&gc, CodonFrequenciesSet::getFrequenciesSetForCodons(CodonFrequenciesSet::F3X4, &gc)));
+    models.push_back(new KroneckerCodonDistanceSubstitutionModel(&gc, new K80(dna, 2.)));
+    models.push_back(new RE08Nucleotide(new GTR(dna)));
+    LG08 lg08(protein);
+    Coala* coala = new Coala(protein, lg08, 3);
+    unique_ptr<VectorSiteContainer> proteinData(createProteinData());
+    coala->setFreqFromData(*proteinData);
+    models.push_back(coala);
+    models.push_back(new G2001(new GTR(dna), new GammaDiscreteDistribution(3, 1.), 1.));
+    models.push_back(new TS98(new GTR(dna)));
+
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+      benchmarkModel(out, *models[i], repeats);
+      delete models[i];
+    }
+  }
+  catch (exception& e)
+  {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
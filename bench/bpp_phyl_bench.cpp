@@ -0,0 +1,538 @@
+//
+// File: bpp_phyl_bench.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+/*
+ * Benchmark of the likelihood engines of bpp-phyl.
+ *
+ * The legacy DR* / R* tree likelihoods, the NewLikelihood recursive
+ * calculation and the NewPhyl dataflow graph are run on the same synthetic
+ * datasets. Trees and alignments only depend on the seed, so that results
+ * can be compared across releases. For each (dataset, engine) pair, the
+ * following are measured: setup time, likelihood evaluation after a branch
+ * length change, gradient with respect to all branch lengths, a full branch
+ * length optimization, and the resident memory used by the engine.
+ *
+ * Results are written as tab-separated lines: dataset, engine, measure, value, unit.
+ *
+ * Usage: bpp-phyl-bench [--quick] [--seed N] [--repeats N] [--output file]
+ */
+
+#include <Bpp/Numeric/AutoParameter.h>
+#include <Bpp/Numeric/Function/ConjugateGradientMultiDimensions.h>
+#include <Bpp/Numeric/Prob/ConstantDistribution.h>
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/Protein/JTT92.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/CodonFrequenciesSet.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/NucleotideFrequenciesSet.h>
+#include <Bpp/Phyl/Model/MixtureOfASubstitutionModel.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Model/SubstitutionModelSetTools.h>
+#include <Bpp/Phyl/Simulation/CounterBasedRandomStream.h>
+#include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousMixedTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousMixedTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/RNonHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRNonHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/NonHomogeneousSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <Bpp/NewPhyl/LikelihoodExample.h>
+
+// From the STL:
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// From POSIX:
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace bpp;
+using namespace std;
+
+namespace
+{
+  typedef chrono::steady_clock Clock;
+
+  double elapsedNs(Clock::time_point start)
+  {
+    return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count());
+  }
+
+  /**
+   * @return The current resident set size in kB, or 0 if it cannot be read.
+   */
+  double residentMemoryKb()
+  {
+    ifstream statm("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    if (!(statm >> size >> resident))
+      return 0.;
+    return static_cast<double>(resident) * static_cast<double>(sysconf(_SC_PAGESIZE)) / 1024.;
+  }
+
+  /**
+   * @return The peak resident set size of the process, in kB.
+   */
+  double peakMemoryKb()
+  {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_maxrss);
+  }
+
+  /******************************************************************************/
+
+  enum Variant { PLAIN, GAMMA, MIXTURE, NON_HOMOGENEOUS };
+
+  const char* variantName(Variant variant)
+  {
+    switch (variant)
+    {
+    case PLAIN: return "plain";
+    case GAMMA: return "gamma";
+    case MIXTURE: return "mixture";
+    default: return "nh";
+    }
+  }
+
+  /**
+   * @brief A synthetic dataset: a random tree and an alignment simulated on it.
+   */
+  struct Dataset
+  {
+    string name;
+    string alphabetName;
+    Variant variant;
+    const Alphabet* alphabet;
+    shared_ptr<GeneticCode> geneticCode;
+    unique_ptr<TreeTemplate<Node> > tree;
+    unique_ptr<PhyloTree> phyloTree;
+    unique_ptr<VectorSiteContainer> sites;
+
+    Dataset() : name(), alphabetName(), variant(PLAIN), alphabet(0), geneticCode(), tree(), phyloTree(), sites() {}
+
+    /**
+     * @return A new instance of the reference model of the dataset.
+     */
+    SubstitutionModel* createModel() const
+    {
+      if (alphabetName == "dna")
+        return new T92(&AlphabetTools::DNA_ALPHABET, 3.);
+      if (alphabetName == "protein")
+        return new JTT92(&AlphabetTools::PROTEIN_ALPHABET);
+      return new YN98(geneticCode.get(), CodonFrequenciesSet::getFrequenciesSetForCodons(CodonFrequenciesSet::F0, geneticCode.get()));
+    }
+
+    DiscreteDistribution* createRateDistribution() const
+    {
+      if (variant == PLAIN)
+        return new ConstantDistribution(1.);
+      return new GammaDiscreteRateDistribution(4, 0.5);
+    }
+  };
+
+  /**
+   * @brief Draw a random (Yule) topology with exponential branch lengths.
+   *
+   * Numbers are drawn from a CounterBasedRandomStream, so that the tree only
+   * depends on the seed. The tree is unrooted, with a trifurcation at the root.
+   */
+  string randomNewick(size_t nbTaxa, uint64_t seed)
+  {
+    CounterBasedRandomStream random(seed, 0);
+    vector<string> subtrees;
+    for (size_t i = 0; i < nbTaxa; ++i)
+      subtrees.push_back("T" + TextTools::toString(i));
+    while (subtrees.size() > 3)
+    {
+      size_t i = random.giveIntRandomNumberBetweenZeroAndEntry(subtrees.size());
+      string left = subtrees[i];
+      subtrees.erase(subtrees.begin() + static_cast<ptrdiff_t>(i));
+      size_t j = random.giveIntRandomNumberBetweenZeroAndEntry(subtrees.size());
+      double l1 = 0.001 - 0.1 * log(1. - random.giveRandomNumberBetweenZeroAndEntry(1.));
+      double l2 = 0.001 - 0.1 * log(1. - random.giveRandomNumberBetweenZeroAndEntry(1.));
+      subtrees[j] = "(" + left + ":" + TextTools::toString(l1) + "," + subtrees[j] + ":" + TextTools::toString(l2) + ")";
+    }
+    string newick = "(";
+    for (size_t i = 0; i < subtrees.size(); ++i)
+    {
+      double l = 0.001 - 0.1 * log(1. - random.giveRandomNumberBetweenZeroAndEntry(1.));
+      newick += (i > 0 ? "," : "") + subtrees[i] + ":" + TextTools::toString(l);
+    }
+    return newick + ");";
+  }
+
+  unique_ptr<Dataset> createDataset(const string& alphabetName, Variant variant, size_t nbTaxa, size_t nbSites, uint64_t seed)
+  {
+    unique_ptr<Dataset> data(new Dataset());
+    data->name = alphabetName + "_t" + TextTools::toString(nbTaxa) + "_s" + TextTools::toString(nbSites) + "_" + variantName(variant);
+    data->alphabetName = alphabetName;
+    data->variant = variant;
+    if (alphabetName == "dna")
+      data->alphabet = &AlphabetTools::DNA_ALPHABET;
+    else if (alphabetName == "protein")
+      data->alphabet = &AlphabetTools::PROTEIN_ALPHABET;
+    else
+    {
+      data->geneticCode.reset(new StandardGeneticCode(&AlphabetTools::DNA_ALPHABET));
+      data->alphabet = data->geneticCode->getSourceAlphabet();
+    }
+
+    string newick = randomNewick(nbTaxa, seed);
+    data->tree.reset(TreeTemplateTools::parenthesisToTree(newick));
+    Newick reader;
+    data->phyloTree.reset(reader.parenthesisToPhyloTree(newick, false, "", false, false));
+
+    // Data are always simulated under the reference model with gamma rates:
+    unique_ptr<SubstitutionModel> model(data->createModel());
+    GammaDiscreteRateDistribution rdist(4, 0.5);
+    HomogeneousSequenceSimulator simulator(model.get(), &rdist, data->tree.get());
+    unique_ptr<SiteContainer> sites(simulator.simulate(nbSites, seed));
+    data->sites.reset(new VectorSiteContainer(*sites));
+    return data;
+  }
+
+  /******************************************************************************/
+
+  /**
+   * @brief One likelihood engine set up on one dataset.
+   */
+  class Engine
+  {
+  public:
+    virtual ~Engine() {}
+
+  public:
+    virtual DerivableSecondOrder& getLikelihood() = 0;
+    virtual ParameterList getBranchLengthParameters() const = 0;
+  };
+
+  /**
+   * @brief Legacy tree likelihoods (R*, DR* classes), which do not own their model.
+   */
+  template<class TreeLikelihoodType>
+  class OldEngine :
+    public Engine
+  {
+  private:
+    unique_ptr<TransitionModel> model_;
+    unique_ptr<SubstitutionModelSet> modelSet_;
+    unique_ptr<DiscreteDistribution> rdist_;
+    unique_ptr<TreeLikelihoodType> likelihood_;
+
+  public:
+    OldEngine(const Dataset& data, TransitionModel* model, DiscreteDistribution* rdist) :
+      model_(model), modelSet_(), rdist_(rdist),
+      likelihood_(new TreeLikelihoodType(*data.tree, *data.sites, model, rdist, false, false))
+    {
+      likelihood_->initialize();
+    }
+
+    OldEngine(const Dataset& data, SubstitutionModelSet* modelSet, DiscreteDistribution* rdist) :
+      model_(), modelSet_(modelSet), rdist_(rdist),
+      likelihood_(new TreeLikelihoodType(*data.tree, *data.sites, modelSet, rdist, false))
+    {
+      likelihood_->initialize();
+    }
+
+  public:
+    DerivableSecondOrder& getLikelihood() { return *likelihood_; }
+    ParameterList getBranchLengthParameters() const { return likelihood_->getBranchLengthsParameters(); }
+  };
+
+  /**
+   * @brief The NewLikelihood recursive calculation. The process owns the model and tree.
+   */
+  class NewEngine :
+    public Engine
+  {
+  private:
+    unique_ptr<SubstitutionProcess> process_;
+    unique_ptr<SingleProcessPhyloLikelihood> likelihood_;
+
+  public:
+    NewEngine(const Dataset& data, SubstitutionProcess* process) :
+      process_(process),
+      likelihood_(new SingleProcessPhyloLikelihood(process, new RecursiveLikelihoodTreeCalculation(*data.sites, process, false, true)))
+    {
+      likelihood_->computeLikelihood();
+    }
+
+  public:
+    DerivableSecondOrder& getLikelihood() { return *likelihood_; }
+    ParameterList getBranchLengthParameters() const { return likelihood_->getBranchLengthParameters(); }
+  };
+
+  /**
+   * @brief The dataflow likelihood graph, with branch lengths as the only parameters.
+   */
+  class DataFlowEngine :
+    public Engine
+  {
+  private:
+    dataflow::Context context_;
+    ParameterList branchLengths_;
+    unique_ptr<DataFlowFunction> likelihood_;
+
+  public:
+    DataFlowEngine(const Dataset& data) :
+      context_(), branchLengths_(), likelihood_()
+    {
+      unique_ptr<SubstitutionModel> model(data.createModel());
+      auto modelParameters = dataflow::createParameterMapForModel(context_, *model);
+      auto modelNode = dataflow::ConfiguredModel::create(
+        context_,
+        dataflow::createDependencyVector(
+          *model, [&modelParameters](const string& paramName) { return modelParameters[paramName]; }),
+        std::move(model));
+      auto nodes = makeSimpleLikelihoodNodes(context_, *data.phyloTree, *data.sites, modelNode);
+      for (const auto& p : nodes.branchLengthValues)
+      {
+        DataFlowParameter param("BrLen" + TextTools::toString(p.first), p.second);
+        param.setConstraint(Parameter::R_PLUS.clone(), true);
+        branchLengths_.addParameter(param);
+      }
+      likelihood_.reset(new DataFlowFunction(context_, nodes.totalLogLikelihood, branchLengths_));
+      likelihood_->getValue();
+    }
+
+  public:
+    DerivableSecondOrder& getLikelihood() { return *likelihood_; }
+    ParameterList getBranchLengthParameters() const { return branchLengths_; }
+  };
+
+  /**
+   * @return A new engine for this dataset, or 0 if the engine does not support the dataset variant.
+   */
+  Engine* createEngine(const string& engine, const Dataset& data)
+  {
+    if (engine == "df")
+      return data.variant == PLAIN ? new DataFlowEngine(data) : 0;
+    if ((data.variant == MIXTURE || data.variant == NON_HOMOGENEOUS) && data.alphabetName != "dna")
+      return 0;
+
+    if (data.variant == MIXTURE)
+    {
+      map<string, DiscreteDistribution*> distributions;
+      distributions["kappa"] = new GammaDiscreteDistribution(4, 2., 1.);
+      MixtureOfASubstitutionModel* model = new MixtureOfASubstitutionModel(data.alphabet, data.createModel(), distributions);
+      if (engine == "old_r")
+        return new OldEngine<RHomogeneousMixedTreeLikelihood>(data, model, data.createRateDistribution());
+      if (engine == "old_dr")
+        return new OldEngine<DRHomogeneousMixedTreeLikelihood>(data, model, data.createRateDistribution());
+      delete model; // Mixtures are only benchmarked with the legacy likelihoods.
+      return 0;
+    }
+
+    if (data.variant == NON_HOMOGENEOUS)
+    {
+      vector<string> globalParameterNames(1, "T92.kappa");
+      if (engine == "new")
+      {
+        unique_ptr<SubstitutionModel> model(data.createModel());
+        return new NewEngine(data, NonHomogeneousSubstitutionProcess::createNonHomogeneousSubstitutionProcess(
+          model.get(), data.createRateDistribution(), new GCFrequenciesSet(&AlphabetTools::DNA_ALPHABET),
+          new ParametrizablePhyloTree(*data.phyloTree), globalParameterNames));
+      }
+      map<string, string> aliases;
+      SubstitutionModelSet* modelSet = SubstitutionModelSetTools::createNonHomogeneousModelSet(
+        data.createModel(), new GCFrequenciesSet(&AlphabetTools::DNA_ALPHABET), data.tree.get(), aliases, globalParameterNames);
+      if (engine == "old_r")
+        return new OldEngine<RNonHomogeneousTreeLikelihood>(data, modelSet, data.createRateDistribution());
+      return new OldEngine<DRNonHomogeneousTreeLikelihood>(data, modelSet, data.createRateDistribution());
+    }
+
+    if (engine == "new")
+      return new NewEngine(data, new RateAcrossSitesSubstitutionProcess(
+        data.createModel(), data.createRateDistribution(), new ParametrizablePhyloTree(*data.phyloTree)));
+    if (engine == "old_r")
+      return new OldEngine<RHomogeneousTreeLikelihood>(data, data.createModel(), data.createRateDistribution());
+    return new OldEngine<DRHomogeneousTreeLikelihood>(data, data.createModel(), data.createRateDistribution());
+  }
+
+  /******************************************************************************/
+
+  void report(ostream& out, const string& dataset, const string& engine, const string& measure, double value, const string& unit)
+  {
+    out << dataset << "\t" << engine << "\t" << measure << "\t" << setprecision(12) << value << "\t" << unit << endl;
+  }
+
+  void runBenchmark(ostream& out, const string& engineName, const Dataset& data, unsigned int repeats)
+  {
+    double memoryBefore = residentMemoryKb();
+    Clock::time_point start = Clock::now();
+    unique_ptr<Engine> engine(createEngine(engineName, data));
+    if (!engine.get())
+      return;
+    report(out, data.name, engineName, "setup", elapsedNs(start), "ns");
+    report(out, data.name, engineName, "memory", residentMemoryKb() - memoryBefore, "kB");
+
+    DerivableSecondOrder& llh = engine->getLikelihood();
+    ParameterList branchLengths = engine->getBranchLengthParameters();
+    report(out, data.name, engineName, "log_likelihood", -llh.getValue(), "");
+
+    // Evaluation after the change of one branch length, alternating two values.
+    // Plain parameters are used, as copies of dataflow parameters would share their node:
+    ParameterList p1, p2;
+    const string& name = branchLengths[0].getName();
+    p1.addParameter(Parameter(name, branchLengths[0].getValue()));
+    p2.addParameter(Parameter(name, branchLengths[0].getValue() * 1.5));
+    start = Clock::now();
+    for (unsigned int i = 0; i < repeats; ++i)
+    {
+      llh.matchParametersValues(i % 2 ? p1 : p2);
+      llh.getValue();
+    }
+    report(out, data.name, engineName, "evaluation", elapsedNs(start) / repeats, "ns");
+    llh.matchParametersValues(p1);
+
+    // Gradient with respect to all branch lengths:
+    start = Clock::now();
+    for (unsigned int i = 0; i < repeats; ++i)
+    {
+      llh.matchParametersValues(i % 2 ? p1 : p2);
+      for (size_t j = 0; j < branchLengths.size(); ++j)
+        llh.getFirstOrderDerivative(branchLengths[j].getName());
+    }
+    report(out, data.name, engineName, "gradient", elapsedNs(start) / repeats, "ns");
+    llh.matchParametersValues(p1);
+
+    // Full optimization of branch lengths:
+    ConjugateGradientMultiDimensions optimizer(&llh);
+    optimizer.setVerbose(0);
+    optimizer.setProfiler(0);
+    optimizer.setMessageHandler(0);
+    optimizer.setMaximumNumberOfEvaluations(1000);
+    optimizer.getStopCondition()->setTolerance(0.000001);
+    optimizer.setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
+    start = Clock::now();
+    optimizer.init(branchLengths);
+    optimizer.optimize();
+    report(out, data.name, engineName, "optimization", elapsedNs(start), "ns");
+    report(out, data.name, engineName, "optimization_evaluations", static_cast<double>(optimizer.getNumberOfEvaluations()), "");
+    report(out, data.name, engineName, "optimized_log_likelihood", -llh.getValue(), "");
+  }
+}
+
+/******************************************************************************/
+
+int main(int argc, char** argv)
+{
+  bool quick = false;
+  uint64_t seed = 42;
+  unsigned int repeats = 100;
+  string outputPath;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "--quick")
+      quick = true;
+    else if (arg == "--seed" && i + 1 < argc)
+      seed = static_cast<uint64_t>(atoll(argv[++i]));
+    else if (arg == "--repeats" && i + 1 < argc)
+      repeats = static_cast<unsigned int>(atoi(argv[++i]));
+    else if (arg == "--output" && i + 1 < argc)
+      outputPath = argv[++i];
+    else
+    {
+      cerr << "Usage: bpp-phyl-bench [--quick] [--seed N] [--repeats N] [--output file]" << endl;
+      return 1;
+    }
+  }
+  if (quick)
+    repeats = std::min(repeats, 10u);
+
+  ofstream file;
+  if (!outputPath.empty())
+    file.open(outputPath.c_str());
+  ostream& out = outputPath.empty() ? cout : file;
+  out << "# bpp-phyl-bench seed=" << seed << " repeats=" << repeats << endl;
+  out << "dataset\tengine\tmeasure\tvalue\tunit" << endl;
+
+  vector<size_t> taxa = quick ? vector<size_t>(1, 8) : vector<size_t>{16, 64};
+  const char* alphabets[] = {"dna", "protein", "codon"};
+  const Variant variants[] = {PLAIN, GAMMA, MIXTURE, NON_HOMOGENEOUS};
+  const char* engines[] = {"old_r", "old_dr", "new", "df"};
+  try
+  {
+    for (size_t a = 0; a < 3; ++a)
+    {
+      // Fewer sites for larger state spaces, for a comparable computation cost:
+      size_t nbSites = (quick ? 200 : 2000) / (a == 0 ? 1 : (a == 1 ? 4 : 10));
+      for (size_t t = 0; t < taxa.size(); ++t)
+      {
+        for (size_t v = 0; v < 4; ++v)
+        {
+          unique_ptr<Dataset> data(createDataset(alphabets[a], variants[v], taxa[t], nbSites, seed));
+          for (size_t e = 0; e < 4; ++e)
+            runBenchmark(out, engines[e], *data, repeats);
+        }
+      }
+    }
+  }
+  catch (exception& e)
+  {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  report(out, "all", "all", "peak_memory", peakMemoryKb(), "kB");
+  return 0;
+}
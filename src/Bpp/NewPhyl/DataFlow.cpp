@@ -42,15 +42,19 @@
 #include <Bpp/Exceptions.h>
 
 #include <algorithm>
+#include <chrono>      // NodeProfiler timings
+#include <cstdint>     // NodeArena alignment
 #include <fstream>     // debug
 #include <functional>  // std::hash
 #include <ostream>     // debug
 #include <stack>       // invalidate/compute recursively + debug
+#include <thread>      // std::this_thread::yield
 #include <type_traits> // DotOptions flags
 #include <typeinfo>
-#include <unordered_set> // debug
+#include <unordered_set> // debug, computeRecursively (nodes)
 
 #include "DataFlow.h"
+#include "DataFlowProfiler.h"
 
 /* std::type_info::name() returns a "mangled" type name, not very readable.
  * Compilers can optionally provide an ABI header cxxabi.h.
@@ -157,6 +161,10 @@ namespace bpp {
 
     std::string Node::debugInfo () const { return {}; }
 
+    std::size_t Node::valueSizeInBytes () const { return 0; }
+
+    const std::type_info & Node::valueType () const noexcept { return typeid (void); }
+
     bool Node::hasNumericalProperty (NumericalProperty) const { return false; }
 
     bool Node::compareAdditionalArguments (const Node &) const { return false; }
@@ -170,48 +178,146 @@ namespace bpp {
       throw Exception ("Node does not support recreate(deps): " + description ());
     }
 
+    constexpr std::size_t Node::validFlag;
+    constexpr std::size_t Node::busyFlag;
+    constexpr std::size_t Node::releasedFlag;
+    constexpr std::size_t Node::generationIncrement;
+
     void Node::computeRecursively () {
-      // Compute the current node (and dependencies recursively) if needed
-      if (isValid ())
-        return;
+      // Compute the current node (and dependencies recursively) if needed.
+      // Restart from discovery if a concurrent invalidation interrupted a computation.
+      while (!isValid ()) {
+        // Discover then recompute needed nodes
+        std::stack<Node *> nodesToVisit;
+        std::stack<Node *> nodesToRecompute;
+        nodesToVisit.push (this);
+        while (!nodesToVisit.empty ()) {
+          auto * n = nodesToVisit.top ();
+          nodesToVisit.pop ();
+          if (!n->isValid ()) {
+            nodesToRecompute.push (n);
+            for (auto & dep : n->dependencies ())
+              nodesToVisit.push (dep.get ());
+          }
+        }
+        while (!nodesToRecompute.empty ()) {
+          auto * n = nodesToRecompute.top ();
+          nodesToRecompute.pop ();
+          if (!n->tryCompute ())
+            break;
+        }
+      }
+    }
 
-      // Discover then recompute needed nodes
-      std::stack<Node *> nodesToVisit;
-      std::stack<Node *> nodesToRecompute;
-      nodesToVisit.push (this);
-      while (!nodesToVisit.empty ()) {
-        auto * n = nodesToVisit.top ();
-        nodesToVisit.pop ();
-        if (!n->isValid ()) {
-          nodesToRecompute.push (n);
-          for (auto & dep : n->dependencies ())
-            nodesToVisit.push (dep.get ());
+    // Active profiler, or nullptr (the common case: a single atomic load in tryCompute()).
+    static std::atomic<NodeProfiler *> activeNodeProfiler{nullptr};
+
+    NodeProfiler * setNodeProfiler (NodeProfiler * profiler) noexcept {
+      return activeNodeProfiler.exchange (profiler);
+    }
+    bool unsetNodeProfiler (NodeProfiler * profiler) noexcept {
+      return activeNodeProfiler.compare_exchange_strong (profiler, nullptr);
+    }
+
+    bool Node::tryCompute () {
+      // Claim the node, or wait for the thread computing it.
+      auto state = state_.load ();
+      while (true) {
+        if (state & validFlag) {
+          return true;
+        } else if (state & busyFlag) {
+          std::this_thread::yield ();
+          state = state_.load ();
+        } else if (state_.compare_exchange_weak (state, state | busyFlag)) {
+          break;
         }
       }
-      while (!nodesToRecompute.empty ()) {
-        auto * n = nodesToRecompute.top ();
-        nodesToRecompute.pop ();
-        n->compute ();
-        n->makeValid ();
+      // Computations of dependents started before our invalidation may still read the previous value.
+      waitForDependentComputations ();
+      // Dependencies may have been invalidated since they were computed.
+      for (auto & dep : dependencyNodes_) {
+        if (!dep->isValid ()) {
+          state_.fetch_and (~busyFlag);
+          return false;
+        }
+      }
+      try {
+        auto * profiler = activeNodeProfiler.load (std::memory_order_acquire);
+        if (profiler == nullptr) {
+          compute ();
+        } else {
+          const auto start = std::chrono::steady_clock::now ();
+          compute ();
+          const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+          profiler->recordComputation (*this, elapsed.count ());
+        }
+      } catch (...) {
+        state_.fetch_and (~busyFlag);
+        throw;
+      }
+      // Commit only if not invalidated during compute (same generation).
+      auto expected = state | busyFlag;
+      if (state_.compare_exchange_strong (expected, (state & ~releasedFlag) | validFlag)) {
+        return true;
+      } else {
+        state_.fetch_and (~busyFlag);
+        return false;
       }
     }
 
     void Node::invalidateRecursively () noexcept {
-      if (!isValid ())
-        return;
       std::stack<Node *> nodesToInvalidate;
       nodesToInvalidate.push (this);
       while (!nodesToInvalidate.empty ()) {
         auto * n = nodesToInvalidate.top ();
         nodesToInvalidate.pop ();
-        if (n->isValid ()) {
-          n->makeInvalid ();
+        // Always change generation: an ongoing compute() of n will not be committed.
+        auto state = n->state_.load ();
+        while (!n->state_.compare_exchange_weak (state, (state + generationIncrement) & ~validFlag))
+          ;
+        // Dependents of invalid nodes are already invalid, except for released nodes.
+        if (state & (validFlag | releasedFlag)) {
           for (auto * dependent : n->dependentNodes_)
             nodesToInvalidate.push (dependent);
         }
       }
     }
 
+    void Node::beginModification () noexcept {
+      auto state = state_.load ();
+      while (true) {
+        if (state & busyFlag) {
+          std::this_thread::yield ();
+          state = state_.load ();
+        } else if (state_.compare_exchange_weak (state, state | busyFlag)) {
+          break;
+        }
+      }
+      invalidateRecursively ();
+      waitForDependentComputations ();
+    }
+
+    void Node::endModification (bool valid) noexcept {
+      auto state = state_.load ();
+      const auto validBit = valid ? validFlag : std::size_t (0);
+      while (!state_.compare_exchange_weak (state, (state & ~busyFlag) | validBit))
+        ;
+    }
+
+    void Node::waitForDependentComputations () const noexcept {
+      // Busy nodes only wait for their dependents, and the graph is acyclic: no deadlock.
+      for (auto * dependent : dependentNodes_) {
+        while (dependent->state_.load () & busyFlag)
+          std::this_thread::yield ();
+      }
+    }
+
+    bool Node::releaseValue (ValueBufferPool &) { return false; }
+    void Node::reuseValueBuffer (ValueBufferPool &) {}
+
+    std::unique_ptr<Node::ValueSnapshot> Node::saveValue () const { return nullptr; }
+    void Node::restoreValue (const ValueSnapshot &) {}
+
     void Node::registerNode (Node * n) { dependentNodes_.emplace_back (n); }
     void Node::unregisterNode (const Node * n) {
       dependentNodes_.erase (std::remove (dependentNodes_.begin (), dependentNodes_.end (), n),
@@ -258,6 +364,371 @@ namespace bpp {
       }
     }
 
+    /*****************************************************************************
+     * DependencyRewrite.
+     */
+    void DependencyRewrite::replaceDependency (const NodeRef & node, std::size_t index, NodeRef newDependency) {
+      assert (node != nullptr);
+      if (index >= node->nbDependencies ()) {
+        throw Exception ("DependencyRewrite: " + node->description () + " has no dependency " +
+                         std::to_string (index));
+      }
+      if (!newDependency) {
+        failureEmptyDependency (typeid (*node), index);
+      }
+      const auto & previous = *node->dependency (index);
+      if (newDependency->valueType () != previous.valueType ()) {
+        failureDependencyTypeMismatch (typeid (*node), index, previous.valueType (), typeid (*newDependency));
+      }
+      // A cycle would be created if newDependency is node or one of its transitive dependents.
+      std::unordered_set<const Node *> visited;
+      std::stack<const Node *> nodesToVisit;
+      nodesToVisit.push (node.get ());
+      while (!nodesToVisit.empty ()) {
+        auto * n = nodesToVisit.top ();
+        nodesToVisit.pop ();
+        if (n == newDependency.get ()) {
+          throw Exception ("DependencyRewrite: " + newDependency->description () + " is a dependent of " +
+                           node->description () + ", this would create a cycle");
+        }
+        if (visited.insert (n).second) {
+          for (auto * dependent : n->dependentNodes ())
+            nodesToVisit.push (dependent);
+        }
+      }
+
+      saveDependentValues (*node);
+      auto previousDependency = node->dependency (index);
+      // The merging key of node changes with its dependencies.
+      const bool wasCached = context_.uncache (node);
+      relink (*node, index, std::move (newDependency));
+      if (wasCached)
+        context_.recache (node);
+      replacements_.push_back (Replacement{node, index, std::move (previousDependency), wasCached});
+      // Only later invalidations will change the generations.
+      for (auto & saved : savedValues_)
+        saved.generation = saved.node->state_.load () / Node::generationIncrement;
+    }
+
+    void DependencyRewrite::swapDependencies (const NodeRef & a, std::size_t indexA, const NodeRef & b,
+                                              std::size_t indexB) {
+      assert (a != nullptr);
+      assert (b != nullptr);
+      if (indexA >= a->nbDependencies () || indexB >= b->nbDependencies ()) {
+        throw Exception ("DependencyRewrite::swapDependencies: dependency index out of range");
+      }
+      auto depA = a->dependency (indexA);
+      auto depB = b->dependency (indexB);
+      replaceDependency (a, indexA, std::move (depB));
+      replaceDependency (b, indexB, std::move (depA));
+    }
+
+    void DependencyRewrite::revert () {
+      // Values reached by a foreign invalidation since the rewrite are not restored.
+      std::unordered_map<const Node *, std::size_t> savedIndex;
+      std::vector<bool> restorable (savedValues_.size ());
+      for (std::size_t i = 0; i < savedValues_.size (); ++i) {
+        const auto & saved = savedValues_[i];
+        savedIndex.emplace (saved.node.get (), i);
+        restorable[i] = saved.node->state_.load () / Node::generationIncrement == saved.generation;
+      }
+
+      for (auto it = replacements_.rbegin (); it != replacements_.rend (); ++it) {
+        context_.uncache (it->node);
+        relink (*it->node, it->index, std::move (it->previousDependency));
+        if (it->wasCached)
+          context_.recache (it->node);
+      }
+
+      // Restore values with dependencies first (post-order on the saved nodes).
+      std::vector<char> visitState (savedValues_.size (), 0); // 0 = new, 1 = open, 2 = done
+      std::vector<std::size_t> order;
+      order.reserve (savedValues_.size ());
+      std::stack<std::size_t> nodesToVisit;
+      for (std::size_t start = 0; start < savedValues_.size (); ++start) {
+        nodesToVisit.push (start);
+        while (!nodesToVisit.empty ()) {
+          const auto i = nodesToVisit.top ();
+          if (visitState[i] == 0) {
+            visitState[i] = 1;
+            for (const auto & dep : savedValues_[i].node->dependencies ()) {
+              auto found = savedIndex.find (dep.get ());
+              if (found != savedIndex.end () && visitState[found->second] == 0)
+                nodesToVisit.push (found->second);
+            }
+          } else {
+            nodesToVisit.pop ();
+            if (visitState[i] == 1) {
+              visitState[i] = 2;
+              order.push_back (i);
+            }
+          }
+        }
+      }
+      for (auto i : order) {
+        auto & saved = savedValues_[i];
+        auto & n = *saved.node;
+        const auto & deps = n.dependencies ();
+        if (restorable[i] &&
+            std::all_of (deps.begin (), deps.end (), [](const NodeRef & dep) { return dep->isValid (); })) {
+          n.restoreValue (*saved.value);
+          n.state_.fetch_and (~Node::releasedFlag);
+          n.makeValid ();
+        }
+      }
+      commit ();
+    }
+
+    void DependencyRewrite::commit () noexcept {
+      replacements_.clear ();
+      savedValues_.clear ();
+      savedNodes_.clear ();
+    }
+
+    void DependencyRewrite::relink (Node & node, std::size_t index, NodeRef newDependency) {
+      node.beginModification ();
+      auto & deps = node.dependencyNodes_;
+      auto previous = std::move (deps[index]);
+      deps[index] = std::move (newDependency);
+      deps[index]->registerNode (&node);
+      // unregisterNode removes all registrations: keep those of other uses of previous.
+      previous->unregisterNode (&node);
+      for (const auto & dep : deps) {
+        if (dep == previous)
+          previous->registerNode (&node);
+      }
+      node.endModification (false);
+    }
+
+    void DependencyRewrite::saveDependentValues (Node & node) {
+      // Same traversal as Node::invalidateRecursively (): valid nodes and released nodes are invalidated.
+      std::stack<Node *> nodesToVisit;
+      nodesToVisit.push (&node);
+      while (!nodesToVisit.empty ()) {
+        auto * n = nodesToVisit.top ();
+        nodesToVisit.pop ();
+        const auto state = n->state_.load ();
+        if (!(state & (Node::validFlag | Node::releasedFlag)) || !savedNodes_.insert (n).second)
+          continue;
+        if (state & Node::validFlag) {
+          auto value = n->saveValue ();
+          if (value)
+            savedValues_.push_back (SavedValue{n->shared_from_this (), std::move (value), 0});
+        }
+        for (auto * dependent : n->dependentNodes_)
+          nodesToVisit.push (dependent);
+      }
+    }
+
+    /*****************************************************************************
+     * Value recycling.
+     */
+    std::size_t ValueBufferPool::nbBuffers () const {
+      std::size_t n = 0;
+      for (const auto & bucket : buckets_)
+        n += bucket.second->size ();
+      return n;
+    }
+
+    void computeRecursively (const std::vector<Node *> & nodes) {
+      const auto allValid = [&nodes]() {
+        return std::all_of (nodes.begin (), nodes.end (), [](const Node * n) { return n->isValid (); });
+      };
+      while (!allValid ()) {
+        // Discover invalid nodes, ordered with dependencies first (post-order), each node once.
+        std::vector<Node *> nodesToRecompute;
+        std::unordered_set<Node *> discoveredNodes;
+        std::stack<std::pair<Node *, bool>> nodesToVisit; // (node, dependencies visited)
+        for (auto * n : nodes)
+          nodesToVisit.emplace (n, false);
+        while (!nodesToVisit.empty ()) {
+          auto & top = nodesToVisit.top ();
+          auto * n = top.first;
+          if (top.second) {
+            nodesToVisit.pop ();
+            nodesToRecompute.push_back (n);
+          } else if (n->isValid () || !discoveredNodes.insert (n).second) {
+            nodesToVisit.pop ();
+          } else {
+            top.second = true;
+            for (auto & dep : n->dependencies ())
+              nodesToVisit.emplace (dep.get (), false);
+          }
+        }
+        for (auto * n : nodesToRecompute) {
+          if (!n->tryCompute ())
+            break;
+        }
+      }
+    }
+
+    void computeWithValueRecycling (const std::vector<Node *> & nodes, ValueBufferPool & pool) {
+      // Discover invalid nodes, ordered with dependencies first (post-order).
+      std::vector<Node *> nodesToRecompute;
+      std::unordered_map<Node *, std::size_t> nbPendingReaders; // Dependents to recompute, by occurrence
+      {
+        std::stack<std::pair<Node *, bool>> nodesToVisit; // (node, dependencies visited)
+        for (auto * n : nodes)
+          nodesToVisit.emplace (n, false);
+        while (!nodesToVisit.empty ()) {
+          auto & top = nodesToVisit.top ();
+          auto * n = top.first;
+          if (top.second) {
+            nodesToVisit.pop ();
+            nodesToRecompute.push_back (n);
+          } else if (n->isValid () || !nbPendingReaders.emplace (n, 0).second) {
+            nodesToVisit.pop ();
+          } else {
+            top.second = true;
+            for (auto & dep : n->dependencies ())
+              nodesToVisit.emplace (dep.get (), false);
+          }
+        }
+      }
+      for (auto * n : nodesToRecompute) {
+        for (auto & dep : n->dependencies ()) {
+          auto it = nbPendingReaders.find (dep.get ());
+          if (it != nbPendingReaders.end ())
+            ++it->second;
+        }
+      }
+      const std::unordered_set<const Node *> requestedNodes (nodes.begin (), nodes.end ());
+
+      // Compute, releasing dependencies when their last reader is computed.
+      for (auto * n : nodesToRecompute) {
+        n->reuseValueBuffer (pool);
+        n->tryCompute ();
+        for (auto & dep : n->dependencies ()) {
+          auto it = nbPendingReaders.find (dep.get ());
+          if (it != nbPendingReaders.end () && --it->second == 0 && dep->isValid () &&
+              requestedNodes.count (dep.get ()) == 0 && dep->releaseValue (pool)) {
+            auto state = dep->state_.load ();
+            while (!dep->state_.compare_exchange_weak (state, (state & ~Node::validFlag) | Node::releasedFlag))
+              ;
+          }
+        }
+      }
+    }
+
+    /*****************************************************************************
+     * ExecutionPlan.
+     */
+    ExecutionPlan::ExecutionPlan (const NodeRefVec & nodes) : nodes_ (nodes) {
+      // All transitive dependencies, with dependencies first (post-order), each node once.
+      std::unordered_map<const Node *, std::size_t> stepIndexes;
+      std::stack<std::pair<Node *, bool>> nodesToVisit; // (node, dependencies visited)
+      for (auto & n : nodes_) {
+        if (!n)
+          throw Exception ("ExecutionPlan: nullptr node");
+        nodesToVisit.emplace (n.get (), false);
+      }
+      while (!nodesToVisit.empty ()) {
+        auto & top = nodesToVisit.top ();
+        auto * n = top.first;
+        if (top.second) {
+          nodesToVisit.pop ();
+          if (stepIndexes.emplace (n, steps_.size ()).second)
+            steps_.push_back (n->shared_from_this ());
+        } else if (stepIndexes.count (n) != 0) {
+          nodesToVisit.pop ();
+        } else {
+          top.second = true;
+          for (auto & dep : n->dependencies ())
+            nodesToVisit.emplace (dep.get (), false);
+        }
+      }
+      dependencyOffsets_.reserve (steps_.size () + 1);
+      dependencyOffsets_.push_back (0);
+      for (auto & n : steps_) {
+        for (auto & dep : n->dependencies ())
+          dependencySteps_.push_back (stepIndexes.at (dep.get ()));
+        dependencyOffsets_.push_back (dependencySteps_.size ());
+      }
+      dirtyFlags_.assign (steps_.size (), 0);
+    }
+
+    void ExecutionPlan::compute () {
+      // Steps are ordered with dependencies first: a linear scan computes each invalid step once.
+      // Restart if a concurrent invalidation interrupted a computation.
+      bool interrupted = true;
+      while (interrupted) {
+        interrupted = false;
+        for (auto & n : steps_) {
+          if (!n->isValid () && !n->tryCompute ()) {
+            interrupted = true;
+            break;
+          }
+        }
+      }
+    }
+
+    std::size_t ExecutionPlan::updateDirtyFlags () {
+      std::size_t nbDirty = 0;
+      for (std::size_t i = 0; i < steps_.size (); ++i) {
+        const bool dirty = !steps_[i]->isValid ();
+        dirtyFlags_[i] = dirty;
+        nbDirty += dirty;
+      }
+      return nbDirty;
+    }
+
+    bool ExecutionPlan::matchesGraph () const noexcept {
+      for (std::size_t i = 0; i < steps_.size (); ++i) {
+        const auto & deps = steps_[i]->dependencies ();
+        if (deps.size () != dependencyOffsets_[i + 1] - dependencyOffsets_[i])
+          return false;
+        const auto * depStep = dependencyStepsBegin (i);
+        for (const auto & dep : deps) {
+          if (dep != steps_[*depStep++])
+            return false;
+        }
+      }
+      return true;
+    }
+
+    /*****************************************************************************
+     * NodeArena.
+     */
+    NodeArena::NodeArena (std::size_t chunkSize) : chunkSize_ (chunkSize) {}
+
+    void * NodeArena::allocate (std::size_t size, std::size_t alignment) {
+      std::lock_guard<std::mutex> lock (mutex_);
+      auto alignedCurrent = [this, alignment]() {
+        const auto address = reinterpret_cast<std::uintptr_t> (current_);
+        return current_ + (alignment - address % alignment) % alignment;
+      };
+      if (current_ == nullptr || alignedCurrent () + size > end_) {
+        // Oversized requests get a dedicated chunk, but the current chunk stays in use.
+        const auto newChunkSize = std::max (chunkSize_, size + alignment);
+        std::unique_ptr<char[]> chunk (new char[newChunkSize]);
+        if (newChunkSize > chunkSize_ && current_ != nullptr) {
+          char * p = chunk.get ();
+          p += (alignment - reinterpret_cast<std::uintptr_t> (p) % alignment) % alignment;
+          chunks_.insert (chunks_.end () - 1, std::move (chunk));
+          return p;
+        }
+        current_ = chunk.get ();
+        end_ = current_ + newChunkSize;
+        chunks_.emplace_back (std::move (chunk));
+      }
+      char * p = alignedCurrent ();
+      current_ = p + size;
+      return p;
+    }
+
+    void NodeArena::deallocate (void * p, std::size_t size) noexcept {
+      std::lock_guard<std::mutex> lock (mutex_);
+      // Roll back if last allocation of the current chunk, otherwise memory is only released with the arena.
+      auto * ptr = static_cast<char *> (p);
+      if (ptr + size == current_ && std::less_equal<const char *>{}(chunks_.back ().get (), ptr))
+        current_ = ptr;
+    }
+
+    std::size_t NodeArena::nbChunks () const {
+      std::lock_guard<std::mutex> lock (mutex_);
+      return chunks_.size ();
+    }
+
     /*****************************************************************************
      * Context.
      */
@@ -272,6 +743,17 @@ namespace bpp {
      * type and deps are available directly from the Node*.
      * additionalArgs is handled through the two virtual methods.
      */
+    bool Context::uncache (const NodeRef & node) {
+      auto it = nodeCache_.find (CachedNodeRef (NodeRef (node)));
+      if (it != nodeCache_.end () && it->ref == node) {
+        nodeCache_.erase (it);
+        return true;
+      }
+      return false;
+    }
+
+    bool Context::recache (const NodeRef & node) { return nodeCache_.emplace (NodeRef (node)).second; }
+
     bool Context::CachedNodeRef::operator== (const CachedNodeRef & other) const {
       const auto & lhs = *this->ref;
       const auto & rhs = *other.ref;
@@ -323,15 +805,19 @@ namespace bpp {
     }
 
     // Write line with node representation
-    static void writeDotNode (std::ostream & os, const Node & node, DotOptions opt) {
+    static void writeDotNode (std::ostream & os, const Node & node, DotOptions opt,
+                              const std::string & extraAttributes) {
       os << '\t' << dotIdentifier (node);
       if (opt & DotOptions::DetailedNodeInfo) {
         os << " [shape=Mrecord,label=\"{" << dotLabelEscape (node.description ())
-           << "| valid=" << node.isValid () << ' ' << dotLabelEscape (node.debugInfo ()) << "}\"]";
+           << "| valid=" << node.isValid () << ' ' << dotLabelEscape (node.debugInfo ()) << "}\"";
       } else {
-        os << " [shape=box,label=\"" << dotLabelEscape (node.description ()) << "\"]";
+        os << " [shape=box,label=\"" << dotLabelEscape (node.description ()) << '"';
       }
-      os << ";\n";
+      if (!extraAttributes.empty ()) {
+        os << ',' << extraAttributes;
+      }
+      os << "];\n";
     }
 
     // Write line with edge representation for n-th dependency of from
@@ -345,7 +831,8 @@ namespace bpp {
 
     // Write dot lines for graph structure, starting from the given entry points.
     static void writeGraphStructure (std::ostream & os, const std::vector<const Node *> & entryPoints,
-                                     DotOptions opt) {
+                                     DotOptions opt,
+                                     const std::function<std::string (const Node &)> & nodeAttributes) {
       std::stack<const Node *> nodesToVisit;
       std::unordered_set<const Node *> discoveredNodes;
 
@@ -364,7 +851,7 @@ namespace bpp {
       while (!nodesToVisit.empty ()) {
         const auto * node = nodesToVisit.top ();
         nodesToVisit.pop ();
-        writeDotNode (os, *node, opt);
+        writeDotNode (os, *node, opt, nodeAttributes ? nodeAttributes (*node) : std::string ());
         if (opt & DotOptions::FollowUpwardLinks) {
           for (const auto * dependent : node->dependentNodes ()) {
             discover (dependent);
@@ -378,8 +865,13 @@ namespace bpp {
     }
 
     void writeGraphToDot (std::ostream & os, const std::vector<const Node *> & nodes, DotOptions opt) {
+      writeGraphToDot (os, nodes, opt, {});
+    }
+
+    void writeGraphToDot (std::ostream & os, const std::vector<const Node *> & nodes, DotOptions opt,
+                          const std::function<std::string (const Node &)> & nodeAttributes) {
       os << "digraph {\n";
-      writeGraphStructure (os, nodes, opt);
+      writeGraphStructure (os, nodes, opt, nodeAttributes);
       os << "}\n";
     }
     void writeGraphToDot (const std::string & filename, const std::vector<const Node *> & nodes,
@@ -42,10 +42,16 @@
 #ifndef BPP_DATAFLOW_H
 #define BPP_DATAFLOW_H
 
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <type_traits>
+#include <typeindex>
 #include <typeinfo>
 #include <unordered_set>
 #include <utility>
@@ -69,6 +75,8 @@ namespace bpp {
     class Node;
     template <typename T> class Value;
     class Context;
+    class ParallelExecutor;
+    class ValueBufferPool;
 
     /// Node instances are always manipulated as shared pointers: provide a short alias.
     using NodeRef = std::shared_ptr<Node>;
@@ -137,6 +145,23 @@ namespace bpp {
      * 1: During computation of a node dependencies, do not recompute valid nodes.
      * 2: Only invalidate transitively dependent node, not others (still valid).
      *
+     * Validity is stored in an atomic state word: valid flag, busy flag, and a generation counter.
+     * This defines the protocol for concurrent invalidations and computations on a shared graph:
+     * - invalidation clears the valid flag and increments the generation, even for already invalid nodes;
+     * - computation claims the node with the busy flag (other threads wait), waits for ongoing computations
+     *   of direct dependents (reading the old value), checks that dependencies are still valid, computes,
+     *   then commits the valid flag only if the generation did not change meanwhile;
+     * - a failed commit (concurrent invalidation during compute) discards the result, and the computation is
+     *   restarted from the discovery of invalid nodes;
+     * - a modification of a leaf value (NumericMutable::modify) holds the busy flag of the leaf, invalidates
+     *   dependent nodes, and waits for ongoing computations of direct dependents (which can read the old value).
+     * Thus several threads can compute values and modify different leaves of one graph without copying it.
+     * Graph construction (Context, node creation and destruction) is not thread safe.
+     * Values returned by getValue() are references: they may change if the graph is concurrently modified.
+     *
+     * A node can also be released (see computeWithValueRecycling): its value storage has been recycled.
+     * A released node is invalid, but its dependents may be valid: invalidations propagate through it.
+     *
      * Specific features are present in the base class as virtual functions.
      * This include derivation (numerical values), debug, etc.
      * These features have no-op or failure defaults which can be overriden in derived classes.
@@ -155,7 +180,7 @@ namespace bpp {
       Node (NodeRefVec && dependenciesArg);
 
       // Accessors
-      bool isValid () const noexcept { return isValid_; }
+      bool isValid () const noexcept { return (state_.load () & validFlag) != 0; }
       const NodeRefVec & dependencies () const noexcept { return dependencyNodes_; }
       const std::vector<Node *> & dependentNodes () const noexcept { return dependentNodes_; }
       std::size_t nbDependencies () const noexcept { return dependencyNodes_.size (); }
@@ -167,6 +192,12 @@ namespace bpp {
       /// Node debug info (default = ""): user defined detailed info for DF graph debug.
       virtual std::string debugInfo () const;
 
+      /// Memory used by the node value, in bytes (default = 0). Used by NodeProfiler.
+      virtual std::size_t valueSizeInBytes () const;
+
+      /// Type of the node value (default = void, for nodes without value). Used by DependencyRewrite.
+      virtual const std::type_info & valueType () const noexcept;
+
       /** @brief Test if the node has the given numerical property.
        *
        * This is an optional indication only, used for optimisations.
@@ -206,7 +237,9 @@ namespace bpp {
 
       /** @brief Compute this node value, recomputing dependencies (transitively) as needed.
        *
-       * Not thread safe !
+       * Can be called concurrently from multiple threads, and concurrently with invalidations.
+       * Nodes computed by another thread are waited for, not recomputed.
+       * See ParallelExecutor (DataFlowParallel.h) to use multiple threads for one computation.
        */
       void computeRecursively ();
 
@@ -229,20 +262,72 @@ namespace bpp {
 
       /** @brief Invalidate (transitively) dependent nodes from this one.
        *
-       * Not thread safe !
+       * Thread safe: increments the generation of each visited node.
        */
       void invalidateRecursively () noexcept;
 
-      void makeInvalid () noexcept { isValid_ = false; }
-      void makeValid () noexcept { isValid_ = true; }
+      void makeInvalid () noexcept { state_.fetch_and (~validFlag); }
+      void makeValid () noexcept { state_.fetch_or (validFlag); }
+
+      /** @brief Start a modification of the node value by the caller (for leaf nodes).
+       *
+       * Claims the node (concurrent modifications are serialized), invalidates it and its dependents.
+       * Then waits until no direct dependent is computing (reading the previous value).
+       * Must be followed by endModification (valid) with valid = the node value is valid after modification.
+       */
+      void beginModification () noexcept;
+      void endModification (bool valid) noexcept;
+
+      /// Copy of a node value, used to restore it (see DependencyRewrite).
+      struct ValueSnapshot {
+        virtual ~ValueSnapshot () = default;
+      };
 
     private:
+      friend class ParallelExecutor; // Calls tryCompute() from worker threads
+      friend class DependencyRewrite; // Re-links dependencies, saves and restores values
+      friend class ExecutionPlan; // Calls tryCompute() on plan steps
+      friend void computeWithValueRecycling (const std::vector<Node *> & nodes, ValueBufferPool & pool);
+      friend void computeRecursively (const std::vector<Node *> & nodes);
+
+      /** @brief Give the value storage to the pool (default: not supported, returns false).
+       *
+       * Called on valid nodes with no computing dependent.
+       * If it returns true, the node is marked as released.
+       */
+      virtual bool releaseValue (ValueBufferPool & pool);
+      /// Take a recycled buffer from the pool for the next compute(), if possible (default: nothing).
+      virtual void reuseValueBuffer (ValueBufferPool & pool);
+
+      /// Copy the current value (default: not supported, returns nullptr).
+      virtual std::unique_ptr<ValueSnapshot> saveValue () const;
+      /// Restore a value saved by saveValue() on the same node, without changing the state.
+      virtual void restoreValue (const ValueSnapshot & snapshot);
+
+      /** @brief Compute the node if invalid, assuming dependencies are valid.
+       *
+       * Waits if the node is computed (or modified) by another thread.
+       * Returns true if the node is valid at the end.
+       * Returns false if a concurrent invalidation interfered (invalid dependency, or generation changed
+       * during compute), in which case the node is left invalid.
+       * Exceptions from compute() are forwarded, leaving the node invalid.
+       */
+      bool tryCompute ();
+      // Wait until no direct dependent is computing (reading our value).
+      void waitForDependentComputations () const noexcept;
+
       void registerNode (Node * n);
       void unregisterNode (const Node * n);
 
+      // State word: flags in the low bits, generation in the others.
+      static constexpr std::size_t validFlag = 1;
+      static constexpr std::size_t busyFlag = 2;
+      static constexpr std::size_t releasedFlag = 4;
+      static constexpr std::size_t generationIncrement = 8;
+
       NodeRefVec dependencyNodes_{};         // Nodes that we depend on.
       std::vector<Node *> dependentNodes_{}; // Nodes that depend on us.
-      bool isValid_{false};
+      std::atomic<std::size_t> state_{0};    // Invalid, not busy, generation 0.
     };
 
     /// Convert a node ref with runtime type check.
@@ -270,6 +355,12 @@ namespace bpp {
     void writeGraphToDot (const std::string & filename, const std::vector<const Node *> & nodes,
                           DotOptions opt);
 
+    /** @brief Write dataflow graph starting at nodes to output stream, with additional node attributes.
+     * nodeAttributes(node) returns dot attributes added to the node line (like "style=filled"), or "".
+     */
+    void writeGraphToDot (std::ostream & os, const std::vector<const Node *> & nodes, DotOptions opt,
+                          const std::function<std::string (const Node &)> & nodeAttributes);
+
     /// Check if searchedDependency if a transitive dependency of node.
     bool isTransitivelyDependentOn (const Node & searchedDependency, const Node & node);
 
@@ -277,6 +368,188 @@ namespace bpp {
     NodeRef recreateWithSubstitution (Context & c, const NodeRef & node,
                                       const std::unordered_map<const Node *, NodeRef> & substitutions);
 
+    /** @brief In place rewrite of node dependencies, which can be reverted.
+     *
+     * recreateWithSubstitution() creates new nodes for all transitive dependents of the substituted nodes.
+     * For topology moves (NNI, SPR), it is cheaper to re-link a few dependencies of the existing nodes:
+     * no node is created, and only the dependents of re-linked nodes (the path to the root) are invalidated.
+     * For a NNI, swapDependencies() exchanges the forward likelihoods of two conditional likelihood nodes.
+     *
+     * Each re-link is recorded.
+     * revert() restores the previous dependencies, and the values of nodes that were valid before the rewrite:
+     * a rejected move does not recompute anything.
+     * A value is only restored if no other invalidation (a leaf modification) reached its node since the rewrite,
+     * and if its dependencies are valid.
+     * commit() keeps the new dependencies and discards saved values. The destructor does the same.
+     *
+     * Re-linked nodes are changed for all their users: nodes merged by Context are shared.
+     * A re-linked node is removed from the Context merging set while rewritten, and added back if possible.
+     * The new dependency must store a value of the same type, and (not checked) of the same dimension.
+     * Nodes derived (see Node::derive) before the rewrite are not changed.
+     * Not thread safe: the graph must not be computed during calls.
+     */
+    class DependencyRewrite {
+    public:
+      explicit DependencyRewrite (Context & c) : context_ (c) {}
+      DependencyRewrite (const DependencyRewrite &) = delete;
+      DependencyRewrite & operator= (const DependencyRewrite &) = delete;
+
+      /// Replace node->dependency (index) by newDependency. Throws if value types differ or for a cycle.
+      void replaceDependency (const NodeRef & node, std::size_t index, NodeRef newDependency);
+
+      /// Exchange a->dependency (indexA) and b->dependency (indexB).
+      void swapDependencies (const NodeRef & a, std::size_t indexA, const NodeRef & b, std::size_t indexB);
+
+      /// Number of re-links since construction or the last commit() / revert().
+      std::size_t nbReplacements () const noexcept { return replacements_.size (); }
+
+      /// Restore previous dependencies and values, in reverse order.
+      void revert ();
+
+      /// Keep the new dependencies.
+      void commit () noexcept;
+
+    private:
+      struct Replacement {
+        NodeRef node;
+        std::size_t index;
+        NodeRef previousDependency;
+        bool wasCached;
+      };
+      struct SavedValue {
+        NodeRef node;
+        std::unique_ptr<Node::ValueSnapshot> value;
+        std::size_t generation; // Generation after the last re-link: changed by foreign invalidations.
+      };
+
+      // Replace the dependency and invalidate node (and dependents), without Context update.
+      static void relink (Node & node, std::size_t index, NodeRef newDependency);
+      void saveDependentValues (Node & node);
+
+      Context & context_;
+      std::vector<Replacement> replacements_{};
+      std::vector<SavedValue> savedValues_{};
+      std::unordered_set<const Node *> savedNodes_{};
+    };
+
+    /** @brief Pool of value buffers, used to recycle memory of released node values.
+     *
+     * Buffers are stored by type, and reused in LIFO order.
+     * Buffer contents are meaningless: compute() overwrites them, reallocating if the size differs.
+     */
+    class ValueBufferPool {
+    public:
+      template <typename T> void put (T && buffer) { bucket<T> ().emplace_back (std::move (buffer)); }
+      template <typename T> bool take (T & buffer) {
+        auto & buffers = bucket<T> ();
+        if (buffers.empty ())
+          return false;
+        buffer = std::move (buffers.back ());
+        buffers.pop_back ();
+        return true;
+      }
+
+      /// Number of stored buffers (all types).
+      std::size_t nbBuffers () const;
+
+    private:
+      struct BucketBase {
+        virtual ~BucketBase () = default;
+        virtual std::size_t size () const = 0;
+      };
+      template <typename T> struct Bucket : BucketBase {
+        std::vector<T> buffers;
+        std::size_t size () const override { return buffers.size (); }
+      };
+      template <typename T> std::vector<T> & bucket () {
+        auto & b = buckets_[std::type_index (typeid (T))];
+        if (!b)
+          b.reset (new Bucket<T>);
+        return static_cast<Bucket<T> &> (*b).buffers;
+      }
+
+      std::unordered_map<std::type_index, std::unique_ptr<BucketBase>> buckets_;
+    };
+
+    /** @brief Compute values of multiple nodes in one evaluation, recomputing dependencies as needed.
+     *
+     * Invalid nodes are discovered once for all requested nodes, then computed with dependencies first.
+     * Sub-expressions shared by requested nodes (nodes reachable from several of them) are visited and
+     * computed once.
+     * Same thread safety as Node::computeRecursively().
+     */
+    void computeRecursively (const std::vector<Node *> & nodes);
+
+    /** @brief Compute values of nodes, recycling memory of intermediate values.
+     *
+     * Memory saving alternative to computeRecursively() for nodes.
+     * Nodes recomputed by this evaluation (except the requested nodes) are released as soon as all their
+     * dependents recomputed by this evaluation have been computed: their value storage goes to the pool.
+     * Recomputed nodes take their storage from the pool if possible.
+     * Thus the high-water mark is the number of simultaneously live intermediate values, not their total.
+     *
+     * Released nodes will be recomputed when needed again, for example if a dependency changes.
+     * Only non-scalar values are released.
+     * Not thread safe: released values must not be read concurrently.
+     */
+    void computeWithValueRecycling (const std::vector<Node *> & nodes, ValueBufferPool & pool);
+
+    /** @brief Frozen graph: a linear evaluation plan for nodes whose graph structure does not change.
+     *
+     * computeRecursively() discovers invalid nodes at each call, with a stack based graph walk.
+     * For a fixed graph (a likelihood in an optimizer loop), the plan sorts once the transitive dependencies of
+     * the requested nodes, dependencies first (post-order, each node once).
+     * compute() then scans the steps in order: invalid steps are computed, valid ones skipped.
+     *
+     * Steps and their dependencies are stored as dense arrays (step indexes), for use by other executors:
+     * updateDirtyFlags() gives one flag per step, steps with dirty dependencies are dirty.
+     *
+     * The plan holds references to its nodes, which are thus kept alive.
+     * Leaf modifications are allowed between (or during) evaluations, as for computeRecursively().
+     * Structure changes (DependencyRewrite) require a new plan: matchesGraph() checks the dependencies.
+     */
+    class ExecutionPlan {
+    public:
+      explicit ExecutionPlan (const NodeRefVec & nodes);
+
+      /// Compute all requested nodes. Same thread safety as Node::computeRecursively().
+      void compute ();
+
+      std::size_t nbSteps () const noexcept { return steps_.size (); }
+      const NodeRef & step (std::size_t i) const noexcept { return steps_[i]; }
+
+      /// Step indexes of dependencies of step i, as a [begin, end) range in the order of Node::dependencies().
+      const std::size_t * dependencyStepsBegin (std::size_t i) const noexcept {
+        return dependencySteps_.data () + dependencyOffsets_[i];
+      }
+      const std::size_t * dependencyStepsEnd (std::size_t i) const noexcept {
+        return dependencySteps_.data () + dependencyOffsets_[i + 1];
+      }
+
+      /// Set flag i to 1 if step i is invalid (must be computed), 0 otherwise. Returns the number of dirty steps.
+      std::size_t updateDirtyFlags ();
+      const std::vector<char> & dirtyFlags () const noexcept { return dirtyFlags_; }
+
+      /// Check that node dependencies are still the ones of the plan.
+      bool matchesGraph () const noexcept;
+
+    private:
+      NodeRefVec nodes_;
+      NodeRefVec steps_;
+      std::vector<std::size_t> dependencyOffsets_; // nbSteps + 1 offsets in dependencySteps_
+      std::vector<std::size_t> dependencySteps_;
+      std::vector<char> dirtyFlags_;
+    };
+
+    /** @brief Memory used by a T value in bytes, for profiling.
+     *
+     * The default is sizeof(T).
+     * Types with heap storage should specialise it (see Eigen matrices in DataFlowNumeric.h).
+     */
+    template <typename T> struct ValueMemorySize {
+      static std::size_t get (const T &) noexcept { return sizeof (T); }
+    };
+
     /** @brief Abstract Node storing a value of type T.
      *
      * Represents a DataFlow node containing a T value, but still abstract (no compute()).
@@ -305,7 +578,7 @@ namespace bpp {
        *
        * Recompute the value if it is not up to date.
        * Then access it as const.
-       * Recomputation is single threaded and not thread safe.
+       * See computeRecursively() for thread safety.
        */
       const T & getValue () {
         this->computeRecursively ();
@@ -323,11 +596,40 @@ namespace bpp {
         return convertRef<Value<T>> (this->derive (c, node));
       }
 
+      std::size_t valueSizeInBytes () const final { return ValueMemorySize<T>::get (value_); }
+
+      const std::type_info & valueType () const noexcept final { return typeid (T); }
+
     protected:
       /// Raw value access (mutable). Should only be used by subclasses to implement compute().
       T & accessValueMutable () noexcept { return value_; }
 
     private:
+      // Scalars are not worth recycling.
+      bool releaseValue (ValueBufferPool & pool) final {
+        return releaseValue (pool, std::integral_constant<bool, std::is_scalar<T>::value>{});
+      }
+      bool releaseValue (ValueBufferPool &, std::true_type) { return false; }
+      bool releaseValue (ValueBufferPool & pool, std::false_type) {
+        pool.put<T> (std::move (value_)); // Moved-from dynamic Eigen matrices are empty
+        return true;
+      }
+      void reuseValueBuffer (ValueBufferPool & pool) final {
+        if (!std::is_scalar<T>::value)
+          pool.take<T> (value_);
+      }
+
+      struct Snapshot : Node::ValueSnapshot {
+        explicit Snapshot (const T & v) : value (v) {}
+        T value;
+      };
+      std::unique_ptr<Node::ValueSnapshot> saveValue () const final {
+        return std::unique_ptr<Node::ValueSnapshot> (new Snapshot (value_));
+      }
+      void restoreValue (const Node::ValueSnapshot & snapshot) final {
+        value_ = static_cast<const Snapshot &> (snapshot).value;
+      }
+
       T value_;
     };
 
@@ -373,12 +675,103 @@ namespace bpp {
     }
     ///@}
 
+    /** @brief Bump allocator for dataflow nodes.
+     *
+     * Memory is taken sequentially from big chunks, instead of one heap allocation per node.
+     * Nodes built together are thus close in memory, and construction of big graphs is faster.
+     * Memory of destroyed nodes is not reused, except for the last allocation (a new node discarded by
+     * Context::cached is just rolled back).
+     * All chunks are released at once when the arena is destroyed.
+     *
+     * The arena is owned by shared_ptr: each node allocated from it keeps it alive (see NodeArenaAllocator).
+     * Thus nodes may safely outlive the Context they were built with.
+     */
+    class NodeArena {
+    public:
+      /// Create an arena using chunks of chunkSize bytes (bigger allocations get their own chunk).
+      explicit NodeArena (std::size_t chunkSize = 64 * 1024);
+
+      NodeArena (const NodeArena &) = delete;
+      NodeArena & operator= (const NodeArena &) = delete;
+
+      void * allocate (std::size_t size, std::size_t alignment);
+      void deallocate (void * p, std::size_t size) noexcept;
+
+      /// Number of chunks allocated from the heap.
+      std::size_t nbChunks () const;
+
+    private:
+      mutable std::mutex mutex_; // Nodes can be destroyed from any thread
+      std::size_t chunkSize_;
+      std::vector<std::unique_ptr<char[]>> chunks_{};
+      char * current_{nullptr}; // Free space of the last chunk: [current_, end_[
+      char * end_{nullptr};
+    };
+
+    /// Allocator using a shared NodeArena, for std::allocate_shared (the control block keeps a copy).
+    template <typename T> class NodeArenaAllocator {
+    public:
+      using value_type = T;
+
+      explicit NodeArenaAllocator (std::shared_ptr<NodeArena> arena) noexcept : arena_ (std::move (arena)) {}
+      template <typename U>
+      NodeArenaAllocator (const NodeArenaAllocator<U> & other) noexcept : arena_ (other.arena ()) {}
+
+      T * allocate (std::size_t n) { return static_cast<T *> (arena_->allocate (n * sizeof (T), alignof (T))); }
+      void deallocate (T * p, std::size_t n) noexcept { arena_->deallocate (p, n * sizeof (T)); }
+
+      const std::shared_ptr<NodeArena> & arena () const noexcept { return arena_; }
+
+    private:
+      std::shared_ptr<NodeArena> arena_;
+    };
+    template <typename T, typename U>
+    bool operator== (const NodeArenaAllocator<T> & lhs, const NodeArenaAllocator<U> & rhs) noexcept {
+      return lhs.arena () == rhs.arena ();
+    }
+    template <typename T, typename U>
+    bool operator!= (const NodeArenaAllocator<T> & lhs, const NodeArenaAllocator<U> & rhs) noexcept {
+      return !(lhs == rhs);
+    }
+
+    /** Allocator for over-aligned node types, for std::allocate_shared.
+     * Before C++17, std::make_shared ignores alignments above alignof(std::max_align_t).
+     * This is required for nodes storing fixed size Eigen matrices (vectorized loads need 16 or 32 byte alignment).
+     * The pointer returned by ::operator new is stored just before the aligned block.
+     */
+    template <typename T> class OverAlignedAllocator {
+    public:
+      using value_type = T;
+
+      OverAlignedAllocator () noexcept = default;
+      template <typename U> OverAlignedAllocator (const OverAlignedAllocator<U> &) noexcept {}
+
+      T * allocate (std::size_t n) {
+        constexpr std::size_t alignment = alignof (T) > alignof (void *) ? alignof (T) : alignof (void *);
+        auto * raw = static_cast<char *> (::operator new (n * sizeof (T) + sizeof (void *) + alignment));
+        auto aligned = reinterpret_cast<std::uintptr_t> (raw + sizeof (void *));
+        aligned = (aligned + alignment - 1) & ~(std::uintptr_t (alignment) - 1);
+        auto * p = reinterpret_cast<void *> (aligned);
+        static_cast<void **> (p)[-1] = raw;
+        return static_cast<T *> (p);
+      }
+      void deallocate (T * p, std::size_t) noexcept { ::operator delete (reinterpret_cast<void **> (p)[-1]); }
+    };
+    template <typename T, typename U>
+    bool operator== (const OverAlignedAllocator<T> &, const OverAlignedAllocator<U> &) noexcept {
+      return true;
+    }
+    template <typename T, typename U>
+    bool operator!= (const OverAlignedAllocator<T> &, const OverAlignedAllocator<U> &) noexcept {
+      return false;
+    }
+
     /** @brief Context for dataflow node construction.
      *
      * A context argument is passed to every function constructing dataflow nodes.
      * This class can thus be used to provide construction-time features.
      *
-     * The only feature for now is merging of nodes representing the same value.
+     * The main feature is merging of nodes representing the same value.
      * Each Context instance stores the set of nodes created with it.
      * When passed to a node creation function (create, derive, recreate),
      * the set is updated and used to prevent duplicate nodes.
@@ -396,10 +789,18 @@ namespace bpp {
      * - same additional arguments (constants, etc).
      * Which is equivalent to the value if all additional arguments are compared.
      * (compare|hash)AdditionalArguments implement polymorphic comparison of additional arguments.
+     *
+     * A Context can also provide a NodeArena: nodes created with makeNode are then allocated from it.
+     * Dependency vectors (NodeRefVec) still use the standard allocator.
      */
     class Context {
     public:
       Context () = default;
+      /// Context allocating nodes from arena (can be shared between contexts).
+      explicit Context (std::shared_ptr<NodeArena> arena) : arena_ (std::move (arena)) {}
+
+      /// Node arena, or nullptr if nodes are allocated on the heap.
+      const std::shared_ptr<NodeArena> & nodeArena () const noexcept { return arena_; }
 
       /** For a newly created node, return its equivalent from the cache.
        * If not already present in the cache, add it and return newNode.
@@ -411,6 +812,13 @@ namespace bpp {
       NodeRef cached (NodeRef && newNode);
 
     private:
+      friend class DependencyRewrite;
+
+      // Remove node from the merging set, before changing its configuration. Returns true if it was there.
+      bool uncache (const NodeRef & node);
+      // Add node to the merging set, if no equal node is present. Returns true if added.
+      bool recache (const NodeRef & node);
+
       /* NodeRef is hashable and comparable as a pointer.
        * CachedNodeRef is hashable and comparable, by comparing the node configuration:
        * - Derived class type,
@@ -428,9 +836,34 @@ namespace bpp {
         std::size_t operator() (const CachedNodeRef & ref) const;
       };
 
+      // Declared first: destroyed after nodeCache_ (nodes keep the arena alive anyway).
+      std::shared_ptr<NodeArena> arena_{};
       std::unordered_set<CachedNodeRef, CachedNodeRefHash> nodeCache_;
     };
 
+    // makeNode helper: heap allocation, with correct alignment for over-aligned types.
+    template <typename T, typename... Args>
+    std::shared_ptr<T> makeHeapNode (std::false_type /*overAligned*/, Args &&... args) {
+      return std::make_shared<T> (std::forward<Args> (args)...);
+    }
+    template <typename T, typename... Args>
+    std::shared_ptr<T> makeHeapNode (std::true_type /*overAligned*/, Args &&... args) {
+      return std::allocate_shared<T> (OverAlignedAllocator<T> (), std::forward<Args> (args)...);
+    }
+
+    /** @brief Create a new node of type T from args, allocated from the Context arena if any.
+     *
+     * Node create() functions should use this instead of std::make_shared.
+     */
+    template <typename T, typename... Args> std::shared_ptr<T> makeNode (Context & c, Args &&... args) {
+      if (c.nodeArena ()) {
+        return std::allocate_shared<T> (NodeArenaAllocator<T> (c.nodeArena ()), std::forward<Args> (args)...);
+      } else {
+        using OverAligned = std::integral_constant<bool, (alignof (T) > alignof (std::max_align_t))>;
+        return makeHeapNode<T> (OverAligned{}, std::forward<Args> (args)...);
+      }
+    }
+
     /// Helper: Same as Context::cached but with a shared_ptr<T> node.
     template <typename T> std::shared_ptr<T> cachedAs (Context & c, std::shared_ptr<T> && newNode) {
       // We can use the faster static_cast due to Context::cached(): node types are conserved.
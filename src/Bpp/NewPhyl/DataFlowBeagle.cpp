@@ -0,0 +1,206 @@
+//
+// File: DataFlowBeagle.cpp
+// Authors:
+//   Julien Dutheil
+// Created: 2026-10-14
+// Last modified: 2026-10-14
+//
+
+/*
+  Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Phyl/Model/SubstitutionModel.h>
+
+#include <functional> // std::hash
+#include <string>
+#include <libhmsbeagle/beagle.h>
+
+#include "DataFlowBeagle.h"
+
+namespace bpp {
+  namespace dataflow {
+    // Throw if a BEAGLE call failed (negative return code).
+    static void checkBeagleCall (int returnCode, const char * function) {
+      if (returnCode < 0) {
+        throw Exception (std::string ("BeagleLogLikelihood: ") + function + " failed with code " +
+                         std::to_string (returnCode));
+      }
+    }
+
+    // BEAGLE matrices are row major, as bpp matrices.
+    static void copyBppToRowMajor (const Matrix<double> & bppMatrix, std::vector<double> & values) {
+      const auto nbRows = bppMatrix.getNumberOfRows ();
+      const auto nbCols = bppMatrix.getNumberOfColumns ();
+      values.resize (nbRows * nbCols);
+      for (std::size_t i = 0; i < nbRows; ++i) {
+        for (std::size_t j = 0; j < nbCols; ++j) {
+          values[i * nbCols + j] = bppMatrix (i, j);
+        }
+      }
+    }
+
+    ValueRef<double> BeagleLogLikelihood::create (Context & c, NodeRefVec && deps,
+                                                  std::shared_ptr<const BeagleTreeLayout> layout,
+                                                  long preferenceFlags) {
+      if (!layout) {
+        throw Exception ("BeagleLogLikelihood(): nullptr layout");
+      }
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyVectorSize (typeid (Self), deps, 1 + layout->nbBranches);
+      checkNthDependencyIs<ConfiguredModel> (typeid (Self), deps, 0);
+      checkDependencyRangeIsValue<double> (typeid (Self), deps, 1, deps.size ());
+      return cachedAs<Value<double>> (c, makeNode<Self> (c, std::move (deps), std::move (layout), preferenceFlags));
+    }
+
+    BeagleLogLikelihood::BeagleLogLikelihood (NodeRefVec && deps, std::shared_ptr<const BeagleTreeLayout> layout,
+                                              long preferenceFlags)
+      : Value<double> (std::move (deps)), layout_ (std::move (layout)), preferenceFlags_ (preferenceFlags) {
+      const auto & l = *layout_;
+      const auto nbTips = l.tipLikelihoods.size ();
+      const auto nbOperations = l.operations.size ();
+      BeagleInstanceDetails details;
+      // Scale buffers: one per operation, and the cumulative one (index nbOperations).
+      instance_ = beagleCreateInstance (
+        int(nbTips), int(l.nbPartialBuffers), 0, int(l.nbState), int(l.nbPattern), 1, int(l.nbBranches + 1), 1,
+        int(nbOperations + 1), nullptr, 0, preferenceFlags_ | BEAGLE_FLAG_SCALING_MANUAL,
+        BEAGLE_FLAG_PRECISION_DOUBLE, &details);
+      checkBeagleCall (instance_, "beagleCreateInstance");
+      implementationName_ = details.implName;
+      try {
+        for (std::size_t i = 0; i < nbTips; ++i) {
+          // Column major Matrix(state, pattern): states of a pattern are contiguous, as BEAGLE partials.
+          checkBeagleCall (beagleSetTipPartials (instance_, int(i), l.tipLikelihoods[i].data ()),
+                           "beagleSetTipPartials");
+        }
+        checkBeagleCall (beagleSetPatternWeights (instance_, l.patternWeights.data ()), "beagleSetPatternWeights");
+        const double one = 1.;
+        checkBeagleCall (beagleSetCategoryRates (instance_, &one), "beagleSetCategoryRates");
+        checkBeagleCall (beagleSetCategoryWeights (instance_, 0, &one), "beagleSetCategoryWeights");
+        std::vector<double> identity (l.nbState * l.nbState, 0.);
+        for (std::size_t i = 0; i < l.nbState; ++i)
+          identity[i * l.nbState + i] = 1.;
+        checkBeagleCall (beagleSetTransitionMatrix (instance_, int(l.nbBranches), identity.data (), 1.),
+                         "beagleSetTransitionMatrix");
+      } catch (...) {
+        beagleFinalizeInstance (instance_);
+        throw;
+      }
+      matrixIndices_.resize (l.nbBranches);
+      for (std::size_t i = 0; i < l.nbBranches; ++i)
+        matrixIndices_[i] = int(i);
+      edgeLengths_.resize (l.nbBranches);
+    }
+
+    BeagleLogLikelihood::~BeagleLogLikelihood () { beagleFinalizeInstance (instance_); }
+
+    std::string BeagleLogLikelihood::description () const {
+      return "BeagleLogLikelihood(" + implementationName_ + ")";
+    }
+    std::string BeagleLogLikelihood::debugInfo () const {
+      return "nbState=" + std::to_string (layout_->nbState) + " nbPattern=" + std::to_string (layout_->nbPattern);
+    }
+
+    // BeagleLogLikelihood additional arguments = (layout, preferenceFlags).
+    bool BeagleLogLikelihood::compareAdditionalArguments (const Node & other) const {
+      const auto * derived = dynamic_cast<const Self *> (&other);
+      return derived != nullptr && layout_ == derived->layout_ && preferenceFlags_ == derived->preferenceFlags_;
+    }
+    std::size_t BeagleLogLikelihood::hashAdditionalArguments () const {
+      std::size_t seed = std::hash<const BeagleTreeLayout *>{}(layout_.get ());
+      combineHash (seed, preferenceFlags_);
+      return seed;
+    }
+
+    NodeRef BeagleLogLikelihood::recreate (Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), layout_, preferenceFlags_);
+    }
+
+    void BeagleLogLikelihood::compute () {
+      const auto & l = *layout_;
+      const auto * model = accessValueConstCast<const TransitionModel *> (*this->dependency (0));
+      for (std::size_t i = 0; i < l.nbBranches; ++i)
+        edgeLengths_[i] = accessValueConstCast<double> (*this->dependency (1 + i));
+
+      const std::unique_lock<std::mutex> lock (static_cast<ConfiguredModel &> (*this->dependency (0)).modelMutex ());
+      std::vector<double> values;
+      const auto * substitutionModel = dynamic_cast<const SubstitutionModel *> (model);
+      if (substitutionModel != nullptr && substitutionModel->isDiagonalizable () &&
+          substitutionModel->isNonSingular ()) {
+        // P(t) = V diag(exp(rate * eigenValues * t)) U: BEAGLE exponentiates on the device.
+        std::vector<double> inverseEigenVectors;
+        copyBppToRowMajor (substitutionModel->getColumnRightEigenVectors (), values);
+        copyBppToRowMajor (substitutionModel->getRowLeftEigenVectors (), inverseEigenVectors);
+        checkBeagleCall (beagleSetEigenDecomposition (instance_, 0, values.data (), inverseEigenVectors.data (),
+                                                      substitutionModel->getEigenValues ().data ()),
+                         "beagleSetEigenDecomposition");
+        const auto rate = substitutionModel->getRate ();
+        for (auto & t : edgeLengths_)
+          t *= rate;
+        checkBeagleCall (beagleUpdateTransitionMatrices (instance_, 0, matrixIndices_.data (), nullptr, nullptr,
+                                                         edgeLengths_.data (), int(l.nbBranches)),
+                         "beagleUpdateTransitionMatrices");
+      } else {
+        for (std::size_t i = 0; i < l.nbBranches; ++i) {
+          copyBppToRowMajor (model->getPij_t (edgeLengths_[i]), values);
+          checkBeagleCall (beagleSetTransitionMatrix (instance_, int(i), values.data (), 1.),
+                           "beagleSetTransitionMatrix");
+        }
+      }
+      checkBeagleCall (beagleSetStateFrequencies (instance_, 0, model->getFrequencies ().data ()),
+                       "beagleSetStateFrequencies");
+
+      // Post-order partials, scale factors of operation i in scale buffer i.
+      const auto nbOperations = l.operations.size ();
+      const int cumulativeScaleIndex = int(nbOperations);
+      std::vector<BeagleOperation> operations (nbOperations);
+      for (std::size_t i = 0; i < nbOperations; ++i) {
+        const auto & op = l.operations[i];
+        operations[i] = BeagleOperation{op.destination, int(i), BEAGLE_OP_NONE, op.child1, op.child1Matrix,
+                                        op.child2, op.child2Matrix};
+      }
+      checkBeagleCall (beagleResetScaleFactors (instance_, cumulativeScaleIndex), "beagleResetScaleFactors");
+      checkBeagleCall (beagleUpdatePartials (instance_, operations.data (), int(nbOperations), cumulativeScaleIndex),
+                       "beagleUpdatePartials");
+
+      const int categoryWeightsIndex = 0;
+      const int stateFrequenciesIndex = 0;
+      double logLikelihood = 0.;
+      checkBeagleCall (beagleCalculateRootLogLikelihoods (instance_, &l.rootBuffer, &categoryWeightsIndex,
+                                                          &stateFrequenciesIndex, &cumulativeScaleIndex, 1,
+                                                          &logLikelihood),
+                       "beagleCalculateRootLogLikelihoods");
+      this->accessValueMutable () = logLikelihood;
+    }
+  } // namespace dataflow
+} // namespace bpp
@@ -0,0 +1,140 @@
+//
+// File: DataFlowBeagle.h
+// Authors:
+//   Julien Dutheil
+// Created: 2026-10-14
+// Last modified: 2026-10-14
+//
+
+/*
+  Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_NEWPHYL_DATAFLOWBEAGLE_H
+#define BPP_NEWPHYL_DATAFLOWBEAGLE_H
+
+#include <Eigen/Core>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DataFlow.h"
+#include "Likelihood.h"
+
+/** @file Tree likelihood computed by the BEAGLE library (libhmsbeagle).
+ * Only available if bpp-phyl is built with the WITH_BEAGLE CMake option (BPP_WITH_BEAGLE is then defined).
+ */
+namespace bpp {
+  namespace dataflow {
+    /** @brief Description of a tree likelihood computation for BEAGLE.
+     *
+     * Partial (conditional likelihood) buffers are numbered from 0: tips first, then inner nodes.
+     * Transition matrix buffers are numbered as branches, plus one identity matrix (index nbBranches).
+     * BEAGLE operations combine two children: a multifurcation is a chain of operations, intermediate results
+     * being combined with the identity matrix.
+     */
+    struct BeagleTreeLayout {
+      /// destination = (P[child1Matrix] * child1) o (P[child2Matrix] * child2).
+      struct Operation {
+        int destination;
+        int child1;
+        int child1Matrix;
+        int child2;
+        int child2Matrix;
+      };
+
+      std::size_t nbState{};
+      std::size_t nbPattern{};
+      std::size_t nbBranches{};
+      std::size_t nbPartialBuffers{};                // Tips included
+      std::vector<Eigen::MatrixXd> tipLikelihoods{}; // Tip buffer i: Matrix(state, pattern)
+      std::vector<Operation> operations{};           // Dependencies first
+      int rootBuffer{};
+      std::vector<double> patternWeights{};
+    };
+
+    /** @brief logLikelihood = f(model, branchLen_0, ..., branchLen_{nbBranches - 1}), computed by BEAGLE.
+     * - logLikelihood: double, sum over patterns of weight * log(likelihood).
+     * - model: ConfiguredModel (same model on all branches).
+     * - branchLen_i: double, length of the branch of transition matrix buffer i (see BeagleTreeLayout).
+     *
+     * Each node owns a BEAGLE instance, created at construction with the tip likelihoods and pattern weights.
+     * Conditional likelihoods stay in the instance (on the device for GPU implementations).
+     * A compute() only sends the model (eigen system, or transition matrices if the model has no real eigen
+     * system), the branch lengths and the equilibrium frequencies, then gets the log likelihood back.
+     * Conditional likelihoods are rescaled at each operation (BEAGLE manual scaling).
+     *
+     * preferenceFlags selects the implementation (BEAGLE_FLAG_PROCESSOR_GPU, BEAGLE_FLAG_FRAMEWORK_CUDA...).
+     * Values are always double precision.
+     *
+     * Derivation is not supported: numerical derivation would create one BEAGLE instance per shifted node.
+     * Use the Eigen likelihood graph (makeSimpleLikelihoodNodes) for gradient based optimization.
+     *
+     * Node construction should be done with the create static method.
+     */
+    class BeagleLogLikelihood : public Value<double> {
+    public:
+      using Self = BeagleLogLikelihood;
+
+      /// Build a new BeagleLogLikelihood node.
+      static ValueRef<double> create (Context & c, NodeRefVec && deps,
+                                      std::shared_ptr<const BeagleTreeLayout> layout, long preferenceFlags = 0);
+      BeagleLogLikelihood (NodeRefVec && deps, std::shared_ptr<const BeagleTreeLayout> layout,
+                           long preferenceFlags);
+      ~BeagleLogLikelihood ();
+
+      std::string description () const final;
+      std::string debugInfo () const final;
+
+      bool compareAdditionalArguments (const Node & other) const final;
+      std::size_t hashAdditionalArguments () const final;
+
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+      /// Name of the BEAGLE implementation used by the instance.
+      const std::string & implementationName () const noexcept { return implementationName_; }
+
+    private:
+      void compute () final;
+
+      std::shared_ptr<const BeagleTreeLayout> layout_;
+      long preferenceFlags_;
+      int instance_;
+      std::string implementationName_{};
+      std::vector<int> matrixIndices_{}; // 0 .. nbBranches - 1
+      std::vector<double> edgeLengths_{};
+    };
+  } // namespace dataflow
+} // namespace bpp
+
+#endif // BPP_NEWPHYL_DATAFLOWBEAGLE_H
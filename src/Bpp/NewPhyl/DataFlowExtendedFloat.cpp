@@ -0,0 +1,483 @@
+//
+// File: DataFlowExtendedFloat.cpp
+// Authors:
+//   Julien Dutheil
+// Created: 2026-10-14
+// Last modified: 2026-10-14
+//
+
+/*
+  Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "DataFlowExtendedFloat.h"
+
+namespace bpp {
+  template <typename F> void GenericExtendedFloatMatrix<F>::normalizeColumn (Eigen::Index j) noexcept {
+    if (rows () == 0)
+      return;
+    auto column = f_.col (j);
+    FloatType maxValue = column.cwiseAbs ().maxCoeff ();
+    if (!std::isfinite (maxValue) || maxValue == 0.)
+      return;
+    // Usually zero or one step, so scale the column at each step (a combined factor could overflow).
+    // Eigen takes scalars by reference: use local copies of the constants.
+    const FloatType bigFactor = FloatType (1) / biggest_normalized_value;
+    const FloatType smallFactor = FloatType (1) / smallest_normalized_value;
+    while (maxValue > biggest_normalized_value) {
+      maxValue *= bigFactor;
+      column *= bigFactor;
+      exp_ (j) += biggest_normalized_radix_power;
+    }
+    while (maxValue < smallest_normalized_value) {
+      maxValue *= smallFactor;
+      column *= smallFactor;
+      exp_ (j) += smallest_normalized_radix_power;
+    }
+  }
+
+  template class GenericExtendedFloatMatrix<double>;
+  template class GenericExtendedFloatMatrix<float>;
+
+  template <typename F>
+  GenericExtendedFloatMatrix<F> zero (const Dimension<GenericExtendedFloatMatrix<F>> & dim) {
+    GenericExtendedFloatMatrix<F> m (dim.rows, dim.cols);
+    m.float_part ().setZero ();
+    return m;
+  }
+  template <typename F>
+  GenericExtendedFloatMatrix<F> one (const Dimension<GenericExtendedFloatMatrix<F>> & dim) {
+    GenericExtendedFloatMatrix<F> m (dim.rows, dim.cols);
+    m.float_part ().setOnes ();
+    return m;
+  }
+  template <typename F> bool isIdentity (const GenericExtendedFloatMatrix<F> & m) {
+    return (m.exponent_part ().array () == 0).all () && numeric::isIdentity (m.float_part ());
+  }
+  template <typename F> std::string debug (const GenericExtendedFloatMatrix<F> & m) {
+    std::string s = numeric::debug (m.float_part ());
+    if (m.cols () > 0) {
+      s += " exps=[" + std::to_string (m.exponent_part ().minCoeff ()) + "," +
+           std::to_string (m.exponent_part ().maxCoeff ()) + "]";
+    }
+    return s;
+  }
+  template <typename F> std::size_t hash (const GenericExtendedFloatMatrix<F> & m) {
+    std::size_t seed = numeric::hash (m.float_part ());
+    for (Eigen::Index j = 0; j < m.cols (); ++j) {
+      combineHash (seed, m.exponent_part () (j));
+    }
+    return seed;
+  }
+
+  template ExtendedFloatMatrix zero (const Dimension<ExtendedFloatMatrix> &);
+  template SingleExtendedFloatMatrix zero (const Dimension<SingleExtendedFloatMatrix> &);
+  template ExtendedFloatMatrix one (const Dimension<ExtendedFloatMatrix> &);
+  template SingleExtendedFloatMatrix one (const Dimension<SingleExtendedFloatMatrix> &);
+  template bool isIdentity (const ExtendedFloatMatrix &);
+  template bool isIdentity (const SingleExtendedFloatMatrix &);
+  template std::string debug (const ExtendedFloatMatrix &);
+  template std::string debug (const SingleExtendedFloatMatrix &);
+  template std::size_t hash (const ExtendedFloatMatrix &);
+  template std::size_t hash (const SingleExtendedFloatMatrix &);
+
+  namespace dataflow {
+    // Short name for member definitions of the specialisations below.
+    template <typename F> using EFMatrix = GenericExtendedFloatMatrix<F>;
+
+    // CWiseMul<ExtendedFloatMatrix, ReductionOf<ExtendedFloatMatrix>>
+
+    template <typename F>
+    ValueRef<EFMatrix<F>>
+    CWiseMul<EFMatrix<F>, ReductionOf<EFMatrix<F>>>::create (
+      Context & c, NodeRefVec && deps, const Dimension<T> & dim) {
+      // Check dependencies
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyRangeIsValue<T> (typeid (Self), deps, 0, deps.size ());
+      // If there is a 0 return 0.
+      if (std::any_of (deps.begin (), deps.end (), [](const NodeRef & dep) {
+            return dep->hasNumericalProperty (NumericalProperty::ConstantZero);
+          })) {
+        return ConstantZero<T>::create (c, dim);
+      }
+      // Remove 1s from deps
+      removeDependenciesIf (deps, [](const NodeRef & dep) {
+        return dep->hasNumericalProperty (NumericalProperty::ConstantOne);
+      });
+      // Select node implementation
+      if (deps.size () == 0) {
+        return ConstantOne<T>::create (c, dim);
+      } else if (deps.size () == 1) {
+        return convertRef<Value<T>> (deps[0]);
+      } else {
+        return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
+      }
+    }
+
+    template <typename F>
+    CWiseMul<EFMatrix<F>, ReductionOf<EFMatrix<F>>>::CWiseMul (NodeRefVec && deps, const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), targetDimension_ (dim) {}
+
+    template <typename F>
+    std::string CWiseMul<EFMatrix<F>, ReductionOf<EFMatrix<F>>>::debugInfo () const {
+      return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+    }
+
+    template <typename F>
+    bool
+    CWiseMul<EFMatrix<F>, ReductionOf<EFMatrix<F>>>::compareAdditionalArguments (const Node & other) const {
+      return dynamic_cast<const Self *> (&other) != nullptr;
+    }
+
+    template <typename F>
+    NodeRef CWiseMul<EFMatrix<F>, ReductionOf<EFMatrix<F>>>::recreate (Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), targetDimension_);
+    }
+
+    template <typename F>
+    void CWiseMul<EFMatrix<F>, ReductionOf<EFMatrix<F>>>::compute () {
+      // Dependencies are normalized, so normalization can be delayed for some products.
+      auto & result = this->accessValueMutable ();
+      const auto n = this->nbDependencies ();
+      result = accessValueConstCast<T> (*this->dependency (0));
+      int nbFactorsSinceNormalization = 1;
+      for (std::size_t i = 1; i < n; ++i) {
+        const auto & x = accessValueConstCast<T> (*this->dependency (i));
+        result.float_part ().array () *= x.float_part ().array ();
+        result.exponent_part () += x.exponent_part ();
+        if (++nbFactorsSinceNormalization == ExtendedFloat::allowed_product_without_normalization) {
+          result.normalize ();
+          nbFactorsSinceNormalization = 1;
+        }
+      }
+      if (nbFactorsSinceNormalization > 1) {
+        result.normalize ();
+      }
+    }
+
+    // MatrixProduct<ExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, ExtendedFloatMatrix>
+
+    template <typename F>
+    ValueRef<EFMatrix<F>>
+    MatrixProduct<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::create (
+      Context & c, NodeRefVec && deps, const Dimension<T> & dim) {
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyVectorSize (typeid (Self), deps, 2);
+      checkNthDependencyIsValue<Eigen::MatrixXd> (typeid (Self), deps, 0);
+      checkNthDependencyIsValue<T> (typeid (Self), deps, 1);
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
+    }
+
+    template <typename F>
+    MatrixProduct<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::MatrixProduct (
+      NodeRefVec && deps, const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), targetDimension_ (dim) {}
+
+    template <typename F>
+    std::string MatrixProduct<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::debugInfo () const {
+      return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+    }
+
+    template <typename F>
+    bool
+    MatrixProduct<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::compareAdditionalArguments (
+      const Node & other) const {
+      return dynamic_cast<const Self *> (&other) != nullptr;
+    }
+
+    template <typename F>
+    NodeRef
+    MatrixProduct<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::recreate (
+      Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), targetDimension_);
+    }
+
+    template <typename F>
+    void MatrixProduct<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::compute () {
+      auto & result = this->accessValueMutable ();
+      const auto & x0 = accessValueConstCast<Eigen::MatrixXd> (*this->dependency (0));
+      const auto & x1 = accessValueConstCast<T> (*this->dependency (1));
+      result.float_part ().noalias () = x0.transpose ().template cast<F> () * x1.float_part ();
+      result.exponent_part () = x1.exponent_part ();
+      result.normalize ();
+    }
+
+    // CWiseMulOfMatrixProducts<ExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, ExtendedFloatMatrix>
+
+    template <typename F>
+    ValueRef<EFMatrix<F>>
+    CWiseMulOfMatrixProducts<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::create (
+      Context & c, NodeRefVec && deps, const Dimension<T> & dim) {
+      checkDependenciesNotNull (typeid (Self), deps);
+      if (deps.size () == 0 || deps.size () % 2 != 0) {
+        failureDependencyNumberMismatch (typeid (Self), deps.size () + 1, deps.size ());
+      }
+      for (std::size_t i = 0; i < deps.size (); i += 2) {
+        checkNthDependencyIsValue<Eigen::MatrixXd> (typeid (Self), deps, i);
+        checkNthDependencyIsValue<T> (typeid (Self), deps, i + 1);
+      }
+      if (deps.size () == 2) {
+        return MatrixProduct<T, Transposed<Eigen::MatrixXd>, T>::create (c, std::move (deps), dim);
+      }
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
+    }
+
+    template <typename F>
+    CWiseMulOfMatrixProducts<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::CWiseMulOfMatrixProducts (
+      NodeRefVec && deps, const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), targetDimension_ (dim) {}
+
+    template <typename F>
+    std::string CWiseMulOfMatrixProducts<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::debugInfo () const {
+      return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+    }
+
+    template <typename F>
+    bool CWiseMulOfMatrixProducts<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::compareAdditionalArguments (
+      const Node & other) const {
+      return dynamic_cast<const Self *> (&other) != nullptr;
+    }
+
+    template <typename F>
+    NodeRef CWiseMulOfMatrixProducts<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::recreate (
+      Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), targetDimension_);
+    }
+
+    template <typename F>
+    void CWiseMulOfMatrixProducts<EFMatrix<F>, Transposed<Eigen::MatrixXd>, EFMatrix<F>>::compute () {
+      auto & result = this->accessValueMutable ();
+      const auto n = this->nbDependencies () / 2;
+      const auto nbCols = targetDimension_.cols;
+      const auto blockSize =
+        std::min (nbCols, Eigen::Index (CWiseMulOfMatrixProducts<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>,
+                                                                 Eigen::MatrixXd>::columnBlockSize));
+      result.resize (targetDimension_.rows, nbCols);
+      product_.resize (targetDimension_.rows, blockSize);
+      for (Eigen::Index first = 0; first < nbCols; first += blockSize) {
+        const auto size = std::min (blockSize, nbCols - first);
+        auto block = result.float_part ().middleCols (first, size);
+        auto blockExponents = result.exponent_part ().segment (first, size);
+        auto product = product_.float_part ().leftCols (size);
+        int nbFactorsSinceNormalization = 1;
+        for (std::size_t i = 0; i < n; ++i) {
+          const auto & x0 = accessValueConstCast<Eigen::MatrixXd> (*this->dependency (2 * i));
+          const auto & x1 = accessValueConstCast<T> (*this->dependency (2 * i + 1));
+          // Each product column keeps the x1 exponent, and is normalized as by MatrixProduct.
+          if (i == 0) {
+            block.noalias () = x0.transpose ().template cast<F> () * x1.float_part ().middleCols (first, size);
+            blockExponents = x1.exponent_part ().segment (first, size);
+            for (Eigen::Index j = first; j < first + size; ++j)
+              result.normalizeColumn (j);
+            continue;
+          }
+          product.noalias () = x0.transpose ().template cast<F> () * x1.float_part ().middleCols (first, size);
+          product_.exponent_part ().head (size) = x1.exponent_part ().segment (first, size);
+          for (Eigen::Index j = 0; j < size; ++j)
+            product_.normalizeColumn (j);
+          block.array () *= product.array ();
+          blockExponents += product_.exponent_part ().head (size);
+          if (++nbFactorsSinceNormalization == ExtendedFloat::allowed_product_without_normalization) {
+            for (Eigen::Index j = first; j < first + size; ++j)
+              result.normalizeColumn (j);
+            nbFactorsSinceNormalization = 1;
+          }
+        }
+        if (nbFactorsSinceNormalization > 1) {
+          for (Eigen::Index j = first; j < first + size; ++j)
+            result.normalizeColumn (j);
+        }
+      }
+    }
+
+    // MatrixProduct<ExtendedFloatMatrix, Eigen::RowVectorXd, ExtendedFloatMatrix>
+
+    template <typename F>
+    ValueRef<EFMatrix<F>>
+    MatrixProduct<EFMatrix<F>, Eigen::RowVectorXd, EFMatrix<F>>::create (Context & c, NodeRefVec && deps,
+                                                                         const Dimension<T> & dim) {
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyVectorSize (typeid (Self), deps, 2);
+      checkNthDependencyIsValue<Eigen::RowVectorXd> (typeid (Self), deps, 0);
+      checkNthDependencyIsValue<T> (typeid (Self), deps, 1);
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
+    }
+
+    template <typename F>
+    MatrixProduct<EFMatrix<F>, Eigen::RowVectorXd, EFMatrix<F>>::MatrixProduct (
+      NodeRefVec && deps, const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), targetDimension_ (dim) {}
+
+    template <typename F>
+    std::string MatrixProduct<EFMatrix<F>, Eigen::RowVectorXd, EFMatrix<F>>::debugInfo () const {
+      return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+    }
+
+    template <typename F>
+    bool
+    MatrixProduct<EFMatrix<F>, Eigen::RowVectorXd, EFMatrix<F>>::compareAdditionalArguments (
+      const Node & other) const {
+      return dynamic_cast<const Self *> (&other) != nullptr;
+    }
+
+    template <typename F>
+    NodeRef
+    MatrixProduct<EFMatrix<F>, Eigen::RowVectorXd, EFMatrix<F>>::recreate (Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), targetDimension_);
+    }
+
+    template <typename F>
+    void MatrixProduct<EFMatrix<F>, Eigen::RowVectorXd, EFMatrix<F>>::compute () {
+      auto & result = this->accessValueMutable ();
+      const auto & x0 = accessValueConstCast<Eigen::RowVectorXd> (*this->dependency (0));
+      const auto & x1 = accessValueConstCast<T> (*this->dependency (1));
+      result.float_part ().noalias () = (x0 * x1.float_part ().template cast<double> ()).template cast<F> ();
+      result.exponent_part () = x1.exponent_part ();
+      result.normalize ();
+    }
+
+    // SumOfLogarithms<ExtendedFloatMatrix>
+
+    template <typename FloatType>
+    ValueRef<double>
+    SumOfLogarithms<EFMatrix<FloatType>>::create (
+      Context & c, NodeRefVec && deps, const Dimension<F> & mDim) {
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyVectorSize (typeid (Self), deps, 1);
+      checkNthDependencyIsValue<F> (typeid (Self), deps, 0);
+      return cachedAs<Value<double>> (c, makeNode<Self> (c, std::move (deps), mDim));
+    }
+
+    template <typename FloatType>
+    SumOfLogarithms<EFMatrix<FloatType>>::SumOfLogarithms (NodeRefVec && deps, const Dimension<F> & mDim)
+      : Value<double> (std::move (deps)), mTargetDimension_ (mDim) {}
+
+    template <typename FloatType>
+    std::string SumOfLogarithms<EFMatrix<FloatType>>::debugInfo () const {
+      using namespace numeric;
+      return debug (this->accessValueConst ());
+    }
+
+    template <typename FloatType>
+    bool SumOfLogarithms<EFMatrix<FloatType>>::compareAdditionalArguments (const Node & other) const {
+      return dynamic_cast<const Self *> (&other) != nullptr;
+    }
+
+    template <typename FloatType>
+    NodeRef SumOfLogarithms<EFMatrix<FloatType>>::recreate (Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), mTargetDimension_);
+    }
+
+    template <typename FloatType>
+    void SumOfLogarithms<EFMatrix<FloatType>>::compute () {
+      // prod(m) = prod(float_part) * radix^(rows * sum(exponent_part))
+      static const auto ln_radix = std::log (static_cast<double> (ExtendedFloat::radix));
+      auto & result = this->accessValueMutable ();
+      const auto & m = accessValueConstCast<F> (*this->dependency (0));
+      ExtendedFloat floatProduct{1.};
+      for (Eigen::Index j = 0; j < m.cols (); ++j) {
+        for (Eigen::Index i = 0; i < m.rows (); ++i) {
+          ExtendedFloat ef{static_cast<double> (m.float_part () (i, j))};
+          ef.normalize_small ();
+          floatProduct = denorm_mul (floatProduct, ef);
+          floatProduct.normalize_small ();
+        }
+      }
+      const auto exponentSum = m.exponent_part ().template cast<double> ().sum ();
+      result = log (floatProduct) + static_cast<double> (m.rows ()) * exponentSum * ln_radix;
+    }
+
+    // WeightedSumOfLogarithms<ExtendedFloatMatrix>
+
+    template <typename FloatType>
+    ValueRef<double> WeightedSumOfLogarithms<EFMatrix<FloatType>>::create (Context & c, NodeRefVec && deps,
+                                                        const Dimension<F> & mDim) {
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyVectorSize (typeid (Self), deps, 2);
+      checkNthDependencyIsValue<F> (typeid (Self), deps, 0);
+      checkNthDependencyIsValue<Eigen::RowVectorXd> (typeid (Self), deps, 1);
+      return cachedAs<Value<double>> (c, makeNode<Self> (c, std::move (deps), mDim));
+    }
+
+    template <typename FloatType>
+    WeightedSumOfLogarithms<EFMatrix<FloatType>>::WeightedSumOfLogarithms (
+      NodeRefVec && deps, const Dimension<F> & mDim)
+      : Value<double> (std::move (deps)), mTargetDimension_ (mDim) {}
+
+    template <typename FloatType>
+    std::string WeightedSumOfLogarithms<EFMatrix<FloatType>>::debugInfo () const {
+      using namespace numeric;
+      return debug (this->accessValueConst ());
+    }
+
+    template <typename FloatType>
+    bool WeightedSumOfLogarithms<EFMatrix<FloatType>>::compareAdditionalArguments (const Node & other) const {
+      return dynamic_cast<const Self *> (&other) != nullptr;
+    }
+
+    template <typename FloatType>
+    NodeRef WeightedSumOfLogarithms<EFMatrix<FloatType>>::recreate (Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), mTargetDimension_);
+    }
+
+    template <typename FloatType>
+    void WeightedSumOfLogarithms<EFMatrix<FloatType>>::compute () {
+      // log(m(i,j)) = log(float_part(i,j)) + exponent(j) * log(radix)
+      static const auto ln_radix = std::log (static_cast<double> (ExtendedFloat::radix));
+      auto & result = this->accessValueMutable ();
+      const auto & m = accessValueConstCast<F> (*this->dependency (0));
+      const auto & w = accessValueConstCast<Eigen::RowVectorXd> (*this->dependency (1));
+      const Eigen::RowVectorXd columnLogs =
+        m.float_part ().template cast<double> ().array ().log ().colwise ().sum ().matrix () +
+        static_cast<double> (m.rows ()) * ln_radix * m.exponent_part ().template cast<double> ();
+      result = w.dot (columnLogs);
+    }
+
+    template class CWiseMul<ExtendedFloatMatrix, ReductionOf<ExtendedFloatMatrix>>;
+    template class CWiseMul<SingleExtendedFloatMatrix, ReductionOf<SingleExtendedFloatMatrix>>;
+    template class MatrixProduct<ExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, ExtendedFloatMatrix>;
+    template class MatrixProduct<SingleExtendedFloatMatrix, Transposed<Eigen::MatrixXd>,
+                                 SingleExtendedFloatMatrix>;
+    template class CWiseMulOfMatrixProducts<ExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, ExtendedFloatMatrix>;
+    template class CWiseMulOfMatrixProducts<SingleExtendedFloatMatrix, Transposed<Eigen::MatrixXd>,
+                                            SingleExtendedFloatMatrix>;
+    template class MatrixProduct<ExtendedFloatMatrix, Eigen::RowVectorXd, ExtendedFloatMatrix>;
+    template class MatrixProduct<SingleExtendedFloatMatrix, Eigen::RowVectorXd, SingleExtendedFloatMatrix>;
+    template class SumOfLogarithms<ExtendedFloatMatrix>;
+    template class SumOfLogarithms<SingleExtendedFloatMatrix>;
+    template class WeightedSumOfLogarithms<ExtendedFloatMatrix>;
+    template class WeightedSumOfLogarithms<SingleExtendedFloatMatrix>;
+  } // namespace dataflow
+} // namespace bpp
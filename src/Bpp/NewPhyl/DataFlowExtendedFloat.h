@@ -0,0 +1,418 @@
+//
+// File: DataFlowExtendedFloat.h
+// Authors:
+//   Julien Dutheil
+// Created: 2026-10-14
+// Last modified: 2026-10-14
+//
+
+/*
+  Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_NEWPHYL_DATAFLOWEXTENDEDFLOAT_H
+#define BPP_NEWPHYL_DATAFLOWEXTENDEDFLOAT_H
+
+#include <Bpp/NewPhyl/DataFlowNumeric.h>
+#include <Bpp/NewPhyl/ExtendedFloat.h>
+#include <Eigen/Core>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+namespace bpp {
+  /** @brief Matrix of ExtendedFloat values, with one exponent shared by each column.
+   *
+   * m(i,j) = float_part()(i,j) * radix^exponent_part()(j).
+   * For likelihood matrices (nbState, nbSite), there is one exponent by site.
+   * Float parts are a plain Eigen matrix, so products and other operations are vectorised by Eigen.
+   *
+   * After normalize(), the biggest float part (in absolute value) of each column is in
+   * [smallest_normalized_value, biggest_normalized_value] (if not zero, inf or nan).
+   * Up to ExtendedFloat::allowed_product_without_normalization normalized matrices can then be multiplied
+   * component-wise without normalizing, which is how normalization is delayed in products.
+   *
+   * F is the type of float parts: double (ExtendedFloatMatrix), or float (SingleExtendedFloatMatrix).
+   * Normalization bounds are computed from F, so that exponents prevent underflow for both.
+   * Float parts are converted to double to build ExtendedFloat values (operator()) and logarithms.
+   */
+  template <typename F> class GenericExtendedFloatMatrix {
+  public:
+    using FloatType = F;
+    using ExtType = ExtendedFloat::ExtType;
+    using FloatMatrix = Eigen::Matrix<FloatType, Eigen::Dynamic, Eigen::Dynamic>;
+    using ExponentVector = Eigen::Matrix<ExtType, 1, Eigen::Dynamic>;
+
+    // Same bounds as ExtendedFloat, computed for FloatType.
+    static constexpr int allowed_product = ExtendedFloat::allowed_product_without_normalization;
+    static constexpr int biggest_normalized_radix_power =
+      (std::numeric_limits<FloatType>::max_exponent - 1) / allowed_product;
+    static constexpr int smallest_normalized_radix_power =
+      -((1 - std::numeric_limits<FloatType>::min_exponent) / allowed_product);
+    static constexpr FloatType biggest_normalized_value =
+      constexpr_power (FloatType (ExtendedFloat::radix), biggest_normalized_radix_power);
+    static constexpr FloatType smallest_normalized_value =
+      constexpr_power (FloatType (ExtendedFloat::radix), smallest_normalized_radix_power);
+
+    GenericExtendedFloatMatrix () = default;
+    GenericExtendedFloatMatrix (Eigen::Index rows, Eigen::Index cols)
+      : f_ (rows, cols), exp_ (ExponentVector::Zero (cols)) {}
+
+    /** From double matrix (exponents set to 0), then normalized.
+     * If FloatType is another type (float), columns are first scaled by a power of radix to keep their
+     * maximum in [0.5, 1[, so that small double values do not underflow in the conversion.
+     */
+    template <typename Derived>
+    explicit GenericExtendedFloatMatrix (const Eigen::MatrixBase<Derived> & m)
+      : f_ (m.rows (), m.cols ()), exp_ (ExponentVector::Zero (m.cols ())) {
+      using Scalar = typename Derived::Scalar;
+      for (Eigen::Index j = 0; j < m.cols (); ++j) {
+        int e = 0;
+        if (!std::is_same<Scalar, FloatType>::value && m.rows () > 0) {
+          const Scalar maxValue = m.col (j).cwiseAbs ().maxCoeff ();
+          if (std::isfinite (maxValue) && maxValue != 0)
+            std::frexp (maxValue, &e);
+        }
+        f_.col (j) = m.col (j).unaryExpr ([e](Scalar v) { return std::ldexp (v, -e); }).template cast<FloatType> ();
+        exp_ (j) = e;
+      }
+      normalize ();
+    }
+
+    Eigen::Index rows () const noexcept { return f_.rows (); }
+    Eigen::Index cols () const noexcept { return f_.cols (); }
+
+    const FloatMatrix & float_part () const noexcept { return f_; }
+    FloatMatrix & float_part () noexcept { return f_; }
+    const ExponentVector & exponent_part () const noexcept { return exp_; }
+    ExponentVector & exponent_part () noexcept { return exp_; }
+
+    /// Resize both parts, values are undefined.
+    void resize (Eigen::Index rows, Eigen::Index cols) {
+      f_.resize (rows, cols);
+      exp_.resize (cols);
+    }
+
+    /// Value as an ExtendedFloat.
+    ExtendedFloat operator() (Eigen::Index i, Eigen::Index j) const {
+      return {static_cast<ExtendedFloat::FloatType> (f_ (i, j)), exp_ (j)};
+    }
+
+    /// Normalize all columns.
+    void normalize () noexcept {
+      for (Eigen::Index j = 0; j < cols (); ++j)
+        normalizeColumn (j);
+    }
+    /// Normalize column j: compute the scaling from the column maximum, then scale the column at once.
+    void normalizeColumn (Eigen::Index j) noexcept;
+
+  private:
+    FloatMatrix f_;
+    ExponentVector exp_;
+  };
+
+  template <typename F> constexpr int GenericExtendedFloatMatrix<F>::allowed_product;
+  template <typename F> constexpr int GenericExtendedFloatMatrix<F>::biggest_normalized_radix_power;
+  template <typename F> constexpr int GenericExtendedFloatMatrix<F>::smallest_normalized_radix_power;
+  template <typename F> constexpr F GenericExtendedFloatMatrix<F>::biggest_normalized_value;
+  template <typename F> constexpr F GenericExtendedFloatMatrix<F>::smallest_normalized_value;
+
+  /// Double float parts: the default ExtendedFloat matrix.
+  using ExtendedFloatMatrix = GenericExtendedFloatMatrix<double>;
+  /** Single precision float parts: half the memory and bandwidth of ExtendedFloatMatrix.
+   * Exponents still prevent underflow, but values only have 24 significant bits.
+   */
+  using SingleExtendedFloatMatrix = GenericExtendedFloatMatrix<float>;
+
+  template <typename F>
+  bool operator== (const GenericExtendedFloatMatrix<F> & lhs, const GenericExtendedFloatMatrix<F> & rhs) {
+    return lhs.float_part () == rhs.float_part () && lhs.exponent_part () == rhs.exponent_part ();
+  }
+  template <typename F>
+  bool operator!= (const GenericExtendedFloatMatrix<F> & lhs, const GenericExtendedFloatMatrix<F> & rhs) {
+    return !(lhs == rhs);
+  }
+
+  /// Dimension of an ExtendedFloatMatrix is the dimension of its float part.
+  template <typename F> struct Dimension<GenericExtendedFloatMatrix<F>> : MatrixDimension {
+    using MatrixDimension::MatrixDimension;
+    Dimension (const MatrixDimension & dim) : MatrixDimension (dim) {}
+    Dimension (const GenericExtendedFloatMatrix<F> & m) : MatrixDimension (m.rows (), m.cols ()) {}
+  };
+
+  /* Numeric functions for ExtendedFloatMatrix, counterparts of those of bpp::numeric.
+   * They are declared in namespace bpp to be found by ADL from dataflow node templates.
+   * Defined for ExtendedFloatMatrix and SingleExtendedFloatMatrix.
+   */
+  template <typename F>
+  GenericExtendedFloatMatrix<F> zero (const Dimension<GenericExtendedFloatMatrix<F>> & dim);
+  template <typename F>
+  GenericExtendedFloatMatrix<F> one (const Dimension<GenericExtendedFloatMatrix<F>> & dim);
+  template <typename F> bool isIdentity (const GenericExtendedFloatMatrix<F> & m);
+  template <typename F> std::string debug (const GenericExtendedFloatMatrix<F> & m);
+  template <typename F> std::size_t hash (const GenericExtendedFloatMatrix<F> & m);
+
+  namespace dataflow {
+    /// Memory used by an ExtendedFloatMatrix value: float part and exponents.
+    template <typename F> struct ValueMemorySize<GenericExtendedFloatMatrix<F>> {
+      static std::size_t get (const GenericExtendedFloatMatrix<F> & m) noexcept {
+        return static_cast<std::size_t> (m.float_part ().size ()) * sizeof (F) +
+               static_cast<std::size_t> (m.exponent_part ().size ()) * sizeof (ExtendedFloat::ExtType);
+      }
+    };
+
+    /** @brief r = prod (x_i), for each component (ExtendedFloatMatrix specialisation).
+     * - r, x_i: GenericExtendedFloatMatrix<F>.
+     *
+     * Float parts are multiplied, exponents are summed.
+     * Columns are normalized only every ExtendedFloat::allowed_product_without_normalization factors.
+     * Node construction should be done with the create static method.
+     * Derivation is not supported.
+     */
+    template <typename F>
+    class CWiseMul<GenericExtendedFloatMatrix<F>, ReductionOf<GenericExtendedFloatMatrix<F>>>
+      : public Value<GenericExtendedFloatMatrix<F>> {
+    public:
+      using Self = CWiseMul;
+      using T = GenericExtendedFloatMatrix<F>;
+
+      /// Build a new CWiseMul node with the given output dimensions.
+      static ValueRef<T> create (Context & c, NodeRefVec && deps, const Dimension<T> & dim);
+      CWiseMul (NodeRefVec && deps, const Dimension<T> & dim);
+
+      std::string debugInfo () const override;
+
+      // CWiseMul additional arguments = ().
+      bool compareAdditionalArguments (const Node & other) const final;
+
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+    private:
+      void compute () final;
+
+      Dimension<T> targetDimension_;
+    };
+
+    /** @brief r = transposed(x0) * x1 (matrix product, ExtendedFloatMatrix specialisation).
+     * - r: GenericExtendedFloatMatrix<F>.
+     * - x0: Eigen::MatrixXd, transposed.
+     * - x1: GenericExtendedFloatMatrix<F>.
+     *
+     * Each column of r is a linear combination of the same column of x1, so it keeps the x1 exponent.
+     * The result is then normalized.
+     * For float parts, x0 is cast to float before the product.
+     * Node construction should be done with the create static method.
+     * Derivation is not supported.
+     */
+    template <typename F>
+    class MatrixProduct<GenericExtendedFloatMatrix<F>, Transposed<Eigen::MatrixXd>,
+                        GenericExtendedFloatMatrix<F>>
+      : public Value<GenericExtendedFloatMatrix<F>> {
+    public:
+      using Self = MatrixProduct;
+      using T = GenericExtendedFloatMatrix<F>;
+
+      /// Build a new MatrixProduct node with the given output dimensions.
+      static ValueRef<T> create (Context & c, NodeRefVec && deps, const Dimension<T> & dim);
+      MatrixProduct (NodeRefVec && deps, const Dimension<T> & dim);
+
+      std::string debugInfo () const override;
+
+      // MatrixProduct additional arguments = ().
+      bool compareAdditionalArguments (const Node & other) const final;
+
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+    private:
+      void compute () final;
+
+      Dimension<T> targetDimension_;
+    };
+
+    /** @brief r = prod_i (transposed(x0_i) * x1_i) (fused matrix products, ExtendedFloatMatrix specialisation).
+     * - r: GenericExtendedFloatMatrix<F>.
+     * - x0_i: Eigen::MatrixXd, transposed.
+     * - x1_i: GenericExtendedFloatMatrix<F>.
+     * - Order of dependencies: (x0_0, x1_0, x0_1, x1_1, ...).
+     *
+     * Same value as the CWiseMul of the MatrixProduct nodes, in one pass over the columns (see the generic
+     * CWiseMulOfMatrixProducts). Columns of each product block are normalized before being multiplied into r,
+     * and r is rescaled as in CWiseMul, while the block is in cache.
+     * Node construction should be done with the create static method.
+     * Derivation is not supported.
+     */
+    template <typename F>
+    class CWiseMulOfMatrixProducts<GenericExtendedFloatMatrix<F>, Transposed<Eigen::MatrixXd>,
+                                   GenericExtendedFloatMatrix<F>>
+      : public Value<GenericExtendedFloatMatrix<F>> {
+    public:
+      using Self = CWiseMulOfMatrixProducts;
+      using T = GenericExtendedFloatMatrix<F>;
+
+      /// Build a new CWiseMulOfMatrixProducts node with the given output dimensions.
+      static ValueRef<T> create (Context & c, NodeRefVec && deps, const Dimension<T> & dim);
+      CWiseMulOfMatrixProducts (NodeRefVec && deps, const Dimension<T> & dim);
+
+      std::string debugInfo () const override;
+
+      // CWiseMulOfMatrixProducts additional arguments = ().
+      bool compareAdditionalArguments (const Node & other) const final;
+
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+    private:
+      void compute () final;
+
+      Dimension<T> targetDimension_;
+      T product_; // Product of the current column block
+    };
+
+    /** @brief r = x0 * x1 (matrix product, ExtendedFloatMatrix specialisation).
+     * - r: GenericExtendedFloatMatrix<F> (1 row).
+     * - x0: Eigen::RowVectorXd.
+     * - x1: GenericExtendedFloatMatrix<F>.
+     *
+     * Same exponent handling as the transposed variant.
+     * For float parts, the product is computed in double and then stored in float.
+     * Node construction should be done with the create static method.
+     * Derivation is not supported.
+     */
+    template <typename F>
+    class MatrixProduct<GenericExtendedFloatMatrix<F>, Eigen::RowVectorXd, GenericExtendedFloatMatrix<F>>
+      : public Value<GenericExtendedFloatMatrix<F>> {
+    public:
+      using Self = MatrixProduct;
+      using T = GenericExtendedFloatMatrix<F>;
+
+      /// Build a new MatrixProduct node with the given output dimensions.
+      static ValueRef<T> create (Context & c, NodeRefVec && deps, const Dimension<T> & dim);
+      MatrixProduct (NodeRefVec && deps, const Dimension<T> & dim);
+
+      std::string debugInfo () const override;
+
+      // MatrixProduct additional arguments = ().
+      bool compareAdditionalArguments (const Node & other) const final;
+
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+    private:
+      void compute () final;
+
+      Dimension<T> targetDimension_;
+    };
+
+    /** @brief r = sum_{v in m} log (v) (ExtendedFloatMatrix specialisation).
+     * - r: double.
+     * - m: GenericExtendedFloatMatrix<FloatType>.
+     *
+     * log(v) = log(float_part) + exponent * log(radix), so the log likelihood never underflows.
+     * The sum is computed in double, whatever the float part type.
+     * Node construction should be done with the create static method.
+     * Derivation is not supported.
+     */
+    template <typename FloatType>
+    class SumOfLogarithms<GenericExtendedFloatMatrix<FloatType>> : public Value<double> {
+    public:
+      using Self = SumOfLogarithms;
+      using F = GenericExtendedFloatMatrix<FloatType>;
+
+      /// Build a new SumOfLogarithms node with the given input matrix dimensions.
+      static ValueRef<double> create (Context & c, NodeRefVec && deps, const Dimension<F> & mDim);
+      SumOfLogarithms (NodeRefVec && deps, const Dimension<F> & mDim);
+
+      std::string debugInfo () const override;
+
+      // SumOfLogarithms additional arguments = ().
+      bool compareAdditionalArguments (const Node & other) const final;
+
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+    private:
+      void compute () final;
+
+      Dimension<F> mTargetDimension_;
+    };
+
+    /** @brief r = sum_{i,j} w_j * log (m(i,j)) (ExtendedFloatMatrix specialisation).
+     * - r: double.
+     * - m: GenericExtendedFloatMatrix<FloatType>.
+     * - w: RowVector(col): one weight for each column of m (site pattern).
+     *
+     * The sum is computed in double, whatever the float part type.
+     * Node construction should be done with the create static method.
+     * Derivation is not supported.
+     */
+    template <typename FloatType>
+    class WeightedSumOfLogarithms<GenericExtendedFloatMatrix<FloatType>> : public Value<double> {
+    public:
+      using Self = WeightedSumOfLogarithms;
+      using F = GenericExtendedFloatMatrix<FloatType>;
+
+      /// Build a new WeightedSumOfLogarithms node with the given input matrix dimensions.
+      static ValueRef<double> create (Context & c, NodeRefVec && deps, const Dimension<F> & mDim);
+      WeightedSumOfLogarithms (NodeRefVec && deps, const Dimension<F> & mDim);
+
+      std::string debugInfo () const override;
+
+      // WeightedSumOfLogarithms additional arguments = ().
+      bool compareAdditionalArguments (const Node & other) const final;
+
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+    private:
+      void compute () final;
+
+      Dimension<F> mTargetDimension_;
+    };
+
+    extern template class CWiseMul<ExtendedFloatMatrix, ReductionOf<ExtendedFloatMatrix>>;
+    extern template class CWiseMul<SingleExtendedFloatMatrix, ReductionOf<SingleExtendedFloatMatrix>>;
+    extern template class MatrixProduct<ExtendedFloatMatrix, Transposed<Eigen::MatrixXd>,
+                                        ExtendedFloatMatrix>;
+    extern template class MatrixProduct<SingleExtendedFloatMatrix, Transposed<Eigen::MatrixXd>,
+                                        SingleExtendedFloatMatrix>;
+    extern template class CWiseMulOfMatrixProducts<ExtendedFloatMatrix, Transposed<Eigen::MatrixXd>,
+                                                   ExtendedFloatMatrix>;
+    extern template class CWiseMulOfMatrixProducts<SingleExtendedFloatMatrix, Transposed<Eigen::MatrixXd>,
+                                                   SingleExtendedFloatMatrix>;
+    extern template class MatrixProduct<ExtendedFloatMatrix, Eigen::RowVectorXd, ExtendedFloatMatrix>;
+    extern template class MatrixProduct<SingleExtendedFloatMatrix, Eigen::RowVectorXd,
+                                        SingleExtendedFloatMatrix>;
+    extern template class SumOfLogarithms<ExtendedFloatMatrix>;
+    extern template class SumOfLogarithms<SingleExtendedFloatMatrix>;
+    extern template class WeightedSumOfLogarithms<ExtendedFloatMatrix>;
+    extern template class WeightedSumOfLogarithms<SingleExtendedFloatMatrix>;
+  } // namespace dataflow
+} // namespace bpp
+
+#endif // BPP_NEWPHYL_DATAFLOWEXTENDEDFLOAT_H
@@ -76,6 +76,9 @@ namespace bpp {
       throw Exception ("Numerical derivation of expression is not configured: define the node "
                        "providing the delta value, and choose a computation type.");
     }
+    void failureWeightsNotConstant (const std::type_info & contextNodeType) {
+      throw Exception (prettyTypeName (contextNodeType) + ": does not support derivation for non constant weights");
+    }
     void checkRecreateWithoutDependencies (const std::type_info & contextNodeType, const NodeRefVec & deps) {
       if (!deps.empty ()) {
         throw Exception (prettyTypeName (contextNodeType) +
@@ -159,10 +162,15 @@ namespace bpp {
     template class SumOfLogarithms<Eigen::VectorXd>;
     template class SumOfLogarithms<Eigen::RowVectorXd>;
 
+    template class WeightedSumOfLogarithms<Eigen::VectorXd>;
+    template class WeightedSumOfLogarithms<Eigen::RowVectorXd>;
+
     template class MatrixProduct<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::MatrixXd>;
     template class MatrixProduct<Eigen::RowVectorXd, Eigen::RowVectorXd, Eigen::MatrixXd>;
     template class MatrixProduct<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>;
 
+    template class CWiseMulOfMatrixProducts<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>;
+
     template class ShiftDelta<double>;
     template class ShiftDelta<Eigen::VectorXd>;
     template class ShiftDelta<Eigen::RowVectorXd>;
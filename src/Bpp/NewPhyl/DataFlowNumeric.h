@@ -43,6 +43,7 @@
 #define BPP_NEWPHYL_DATAFLOWNUMERIC_H
 
 #include <Bpp/NewPhyl/ExtendedFloat.h>
+#include <Bpp/Phyl/Likelihood/CompensatedSum.h>
 #include <Eigen/Core>
 #include <algorithm>
 #include <cassert>
@@ -282,9 +283,17 @@ namespace bpp {
    * all deps constant => return constant ?
    */
   namespace dataflow {
+    /// Memory used by an Eigen matrix value: its coefficients, which may be on the heap.
+    template <typename T, int Rows, int Cols> struct ValueMemorySize<Eigen::Matrix<T, Rows, Cols>> {
+      static std::size_t get (const Eigen::Matrix<T, Rows, Cols> & m) noexcept {
+        return static_cast<std::size_t> (m.size ()) * sizeof (T);
+      }
+    };
+
     // Error utils
     [[noreturn]] void failureDeltaNotDerivable (const std::type_info & contextNodeType);
     [[noreturn]] void failureNumericalDerivationNotConfigured ();
+    [[noreturn]] void failureWeightsNotConstant (const std::type_info & contextNodeType);
     void checkRecreateWithoutDependencies (const std::type_info & contextNodeType, const NodeRefVec & deps);
 
     // Type tag to indicate a reduction operation (for +,*,...).
@@ -303,7 +312,9 @@ namespace bpp {
     template <typename T> class CWiseConstantPow;
     template <typename T0, typename T1> class ScalarProduct;
     template <typename F> class SumOfLogarithms;
+    template <typename F> class WeightedSumOfLogarithms;
     template <typename R, typename T0, typename T1> class MatrixProduct;
+    template <typename R, typename T0, typename T1> class CWiseMulOfMatrixProducts;
     template <typename T> class ShiftDelta;
     template <typename T> class CombineDeltaShifted;
 
@@ -373,7 +384,7 @@ namespace bpp {
 
       /// Build a new ConstantZero node of the given dimension.
       static std::shared_ptr<Self> create (Context & c, const Dimension<T> & dim) {
-        return cachedAs<Self> (c, std::make_shared<Self> (dim));
+        return cachedAs<Self> (c, makeNode<Self> (c, dim));
       }
 
       explicit ConstantZero (const Dimension<T> & dim) : Value<T> (NodeRefVec{}), targetDimension_ (dim) {}
@@ -431,7 +442,7 @@ namespace bpp {
 
       /// Build a new ConstantOne node of the given dimension.
       static std::shared_ptr<Self> create (Context & c, const Dimension<T> & dim) {
-        return cachedAs<Self> (c, std::make_shared<Self> (dim));
+        return cachedAs<Self> (c, makeNode<Self> (c, dim));
       }
 
       explicit ConstantOne (const Dimension<T> & dim) : Value<T> (NodeRefVec{}), targetDimension_ (dim) {}
@@ -483,6 +494,9 @@ namespace bpp {
      * Node construction should be done with the create static method.
      * Value is set at construction, and cannot change.
      * Supports derivation.
+     *
+     * Context merging uses a fingerprint of the value, computed once at construction, instead of hashing
+     * the value at each lookup. Values are only compared when fingerprints are equal.
      */
     template <typename T> class NumericConstant : public Value<T> {
     public:
@@ -490,7 +504,24 @@ namespace bpp {
 
       /// Build a new NumericConstant node with T(args...) value.
       template <typename... Args> static std::shared_ptr<Self> create (Context & c, Args &&... args) {
-        return cachedAs<Self> (c, std::make_shared<Self> (std::forward<Args> (args)...));
+        auto node = makeNode<Self> (c, std::forward<Args> (args)...);
+        using namespace numeric;
+        node->fingerprint_ = hash (node->accessValueConst ());
+        return cachedAs<Self> (c, std::move (node));
+      }
+
+      /** @brief Build a new NumericConstant node with T(args...) value, and a fingerprint given by the caller.
+       *
+       * This avoids reading the whole value for large constants, when the caller already has a cheaper key
+       * (for example, leaf likelihoods from the states of a sequence).
+       * The fingerprint can differ from the one computed by create(), but constants built with equal values
+       * must be given equal fingerprints to be merged.
+       */
+      template <typename... Args>
+      static std::shared_ptr<Self> createWithFingerprint (Context & c, std::size_t fingerprint, Args &&... args) {
+        auto node = makeNode<Self> (c, std::forward<Args> (args)...);
+        node->fingerprint_ = fingerprint;
+        return cachedAs<Self> (c, std::move (node));
       }
 
       template <typename... Args>
@@ -498,6 +529,9 @@ namespace bpp {
         this->makeValid (); // Always valid
       }
 
+      /// Fingerprint used for Context merging.
+      std::size_t getFingerprint () const noexcept { return fingerprint_; }
+
       std::string debugInfo () const override {
         using namespace numeric;
         return debug (this->accessValueConst ());
@@ -520,15 +554,16 @@ namespace bpp {
         }
       }
 
-      // NumericConstant<T> additional arguments = (value).
+      // NumericConstant<T> additional arguments = (value), hashed by the fingerprint.
       bool compareAdditionalArguments (const Node & other) const final {
+        if (&other == this) {
+          return true;
+        }
         const auto * derived = dynamic_cast<const Self *> (&other);
-        return derived != nullptr && this->accessValueConst () == derived->accessValueConst ();
-      }
-      std::size_t hashAdditionalArguments () const final {
-        using namespace numeric;
-        return hash (this->accessValueConst ());
+        return derived != nullptr && fingerprint_ == derived->fingerprint_ &&
+               this->accessValueConst () == derived->accessValueConst ();
       }
+      std::size_t hashAdditionalArguments () const final { return fingerprint_; }
 
       NodeRef derive (Context & c, const Node & node) final {
         const auto dim = Dimension<T> (this->accessValueConst ());
@@ -548,6 +583,8 @@ namespace bpp {
         // Constant is valid from construction
         failureComputeWasCalled (typeid (*this));
       }
+
+      std::size_t fingerprint_{0};
     };
 
     /** @brief r = variable_value.
@@ -563,8 +600,8 @@ namespace bpp {
       using Self = NumericMutable;
 
       /// Build a new NumericMutable node with T(args...) value.
-      template <typename... Args> static std::shared_ptr<Self> create (Context &, Args &&... args) {
-        return std::make_shared<Self> (std::forward<Args> (args)...);
+      template <typename... Args> static std::shared_ptr<Self> create (Context & c, Args &&... args) {
+        return makeNode<Self> (c, std::forward<Args> (args)...);
       }
 
       template <typename... Args>
@@ -577,12 +614,18 @@ namespace bpp {
        * Takes a callable object (lamda, function pointer) that performs the modification.
        * It must take a single T& as argument, which will refer to the T object to modify.
        * The callable is called exactly once.
+       * Thread safe with respect to concurrent computations and modifications (see Node).
        * TODO replace with view-struct that performs invalidate on destruction ?
        */
       template <typename Callable> void modify (Callable && modifier) {
-        this->invalidateRecursively ();
-        std::forward<Callable> (modifier) (this->accessValueMutable ());
-        this->makeValid ();
+        this->beginModification ();
+        try {
+          std::forward<Callable> (modifier) (this->accessValueMutable ());
+        } catch (...) {
+          this->endModification (false);
+          throw;
+        }
+        this->endModification (true);
       }
 
       /// Setter with invalidation.
@@ -645,7 +688,7 @@ namespace bpp {
         } else if (deps[0]->hasNumericalProperty (NumericalProperty::ConstantOne)) {
           return ConstantOne<R>::create (c, dim);
         } else {
-          return cachedAs<Value<R>> (c, std::make_shared<Self> (std::move (deps), dim));
+          return cachedAs<Value<R>> (c, makeNode<Self> (c, std::move (deps), dim));
         }
       }
 
@@ -717,7 +760,7 @@ namespace bpp {
         } else if (!zeroDep0 && zeroDep1) {
           return Convert<R, T0>::create (c, {deps[0]}, dim);
         } else {
-          return cachedAs<Value<R>> (c, std::make_shared<Self> (std::move (deps), dim));
+          return cachedAs<Value<R>> (c, makeNode<Self> (c, std::move (deps), dim));
         }
       }
 
@@ -791,7 +834,7 @@ namespace bpp {
         } else if (deps.size () == 2) {
           return CWiseAdd<R, std::tuple<T, T>>::create (c, std::move (deps), dim);
         } else {
-          return cachedAs<Value<R>> (c, std::make_shared<Self> (std::move (deps), dim));
+          return cachedAs<Value<R>> (c, makeNode<Self> (c, std::move (deps), dim));
         }
       }
 
@@ -874,7 +917,7 @@ namespace bpp {
         } else if (!oneDep0 && oneDep1) {
           return Convert<R, T0>::create (c, {deps[0]}, dim);
         } else {
-          return cachedAs<Value<R>> (c, std::make_shared<Self> (std::move (deps), dim));
+          return cachedAs<Value<R>> (c, makeNode<Self> (c, std::move (deps), dim));
         }
       }
 
@@ -956,7 +999,7 @@ namespace bpp {
         } else if (deps.size () == 2) {
           return CWiseMul<R, std::tuple<T, T>>::create (c, std::move (deps), dim);
         } else {
-          return cachedAs<Value<R>> (c, std::make_shared<Self> (std::move (deps), dim));
+          return cachedAs<Value<R>> (c, makeNode<Self> (c, std::move (deps), dim));
         }
       }
 
@@ -1023,7 +1066,7 @@ namespace bpp {
         if (deps[0]->hasNumericalProperty (NumericalProperty::ConstantZero)) {
           return ConstantZero<T>::create (c, dim);
         } else {
-          return cachedAs<Value<T>> (c, std::make_shared<Self> (std::move (deps), dim));
+          return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
         }
       }
 
@@ -1081,7 +1124,7 @@ namespace bpp {
         if (deps[0]->hasNumericalProperty (NumericalProperty::ConstantOne)) {
           return ConstantOne<T>::create (c, dim);
         } else {
-          return cachedAs<Value<T>> (c, std::make_shared<Self> (std::move (deps), dim));
+          return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
         }
       }
 
@@ -1157,7 +1200,7 @@ namespace bpp {
             {NumericConstant<double>::create (c, factor), CWiseInverse<T>::create (c, std::move (deps), dim)},
             dim);
         } else {
-          return cachedAs<Value<T>> (c, std::make_shared<Self> (std::move (deps), exponent, factor, dim));
+          return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), exponent, factor, dim));
         }
       }
 
@@ -1232,7 +1275,7 @@ namespace bpp {
             deps[1]->hasNumericalProperty (NumericalProperty::ConstantZero)) {
           return ConstantZero<double>::create (c, Dimension<double> ());
         } else {
-          return cachedAs<Value<double>> (c, std::make_shared<Self> (std::move (deps)));
+          return cachedAs<Value<double>> (c, makeNode<Self> (c, std::move (deps)));
         }
       }
 
@@ -1288,7 +1331,7 @@ namespace bpp {
         checkDependenciesNotNull (typeid (Self), deps);
         checkDependencyVectorSize (typeid (Self), deps, 1);
         checkNthDependencyIsValue<F> (typeid (Self), deps, 0);
-        return cachedAs<Value<double>> (c, std::make_shared<Self> (std::move (deps), mDim));
+        return cachedAs<Value<double>> (c, makeNode<Self> (c, std::move (deps), mDim));
       }
 
       SumOfLogarithms (NodeRefVec && deps, const Dimension<F> & mDim)
@@ -1335,6 +1378,86 @@ namespace bpp {
       Dimension<F> mTargetDimension_;
     };
 
+    /** @brief r = sum_i w_i * log (m_i).
+     * - r: double.
+     * - m: F (matrix-like type).
+     * - w: F, with the same dimensions as m.
+     *
+     * Used to sum log likelihoods of site patterns, weighted by the number of sites sharing each pattern.
+     * The node has no dimension (double).
+     * The dimension of m should be provided for derivation.
+     * For derivation, weights must be constant (their derivative must be ConstantZero).
+     * Node construction should be done with the create static method.
+     */
+    template <typename F> class WeightedSumOfLogarithms : public Value<double> {
+    public:
+      using Self = WeightedSumOfLogarithms;
+
+      /// Build a new WeightedSumOfLogarithms node with the given input matrix dimensions.
+      static ValueRef<double> create (Context & c, NodeRefVec && deps, const Dimension<F> & mDim) {
+        checkDependenciesNotNull (typeid (Self), deps);
+        checkDependencyVectorSize (typeid (Self), deps, 2);
+        checkNthDependencyIsValue<F> (typeid (Self), deps, 0);
+        checkNthDependencyIsValue<F> (typeid (Self), deps, 1);
+        if (deps[1]->hasNumericalProperty (NumericalProperty::ConstantZero)) {
+          return ConstantZero<double>::create (c, Dimension<double> ());
+        }
+        return cachedAs<Value<double>> (c, makeNode<Self> (c, std::move (deps), mDim));
+      }
+
+      WeightedSumOfLogarithms (NodeRefVec && deps, const Dimension<F> & mDim)
+        : Value<double> (std::move (deps)), mTargetDimension_ (mDim) {}
+
+      std::string debugInfo () const override {
+        using namespace numeric;
+        return debug (this->accessValueConst ());
+      }
+
+      // WeightedSumOfLogarithms additional arguments = ().
+      bool compareAdditionalArguments (const Node & other) const final {
+        return dynamic_cast<const Self *> (&other) != nullptr;
+      }
+
+      NodeRef derive (Context & c, const Node & node) final {
+        const auto & m = this->dependency (0);
+        const auto & w = this->dependency (1);
+        if (!w->derive (c, node)->hasNumericalProperty (NumericalProperty::ConstantZero)) {
+          failureWeightsNotConstant (typeid (Self));
+        }
+        // d(sum_i w_i * log(m_i))/dn = sum_i dm_i/dn * (w_i / m_i)
+        auto dm_dn = m->derive (c, node);
+        auto m_inverse = CWiseInverse<F>::create (c, {m}, mTargetDimension_);
+        auto w_over_m = CWiseMul<F, std::tuple<F, F>>::create (c, {w, std::move (m_inverse)}, mTargetDimension_);
+        return ScalarProduct<F, F>::create (c, {std::move (dm_dn), std::move (w_over_m)});
+      }
+
+      NodeRef recreate (Context & c, NodeRefVec && deps) final {
+        return Self::create (c, std::move (deps), mTargetDimension_);
+      }
+
+    private:
+      void compute () final {
+        auto & result = this->accessValueMutable ();
+        const auto & m = accessValueConstCast<F> (*this->dependency (0));
+        const auto & w = accessValueConstCast<F> (*this->dependency (1));
+        // Logarithms are vectorized by blocks, then accumulated with compensated summation.
+        const Eigen::Index blockSize = 256;
+        const Eigen::Index n = m.size ();
+        Eigen::Array<double, blockSize, 1> terms;
+        CompensatedSum sum;
+        for (Eigen::Index first = 0; first < n; first += blockSize) {
+          const Eigen::Index size = std::min (blockSize, n - first);
+          terms.head (size) = w.array ().segment (first, size) *
+                              m.array ().segment (first, size).log ();
+          for (Eigen::Index i = 0; i < size; ++i)
+            sum.add (terms (i));
+        }
+        result = sum.getValue ();
+      }
+
+      Dimension<F> mTargetDimension_;
+    };
+
     /** @brief r = x0 * x1 (matrix product).
      * - r: R (matrix).
      * - x0: T0 (matrix), allows NumericalDependencyTransform.
@@ -1373,7 +1496,7 @@ namespace bpp {
         } else if (!identityDep0 && identityDep1) {
           return Convert<R, T0>::create (c, {deps[0]}, dim);
         } else {
-          return cachedAs<Value<R>> (c, std::make_shared<Self> (std::move (deps), dim));
+          return cachedAs<Value<R>> (c, makeNode<Self> (c, std::move (deps), dim));
         }
       }
 
@@ -1417,6 +1540,118 @@ namespace bpp {
       Dimension<R> targetDimension_;
     };
 
+    /** @brief r = prod_i (x0_i * x1_i), for each component (fused matrix products).
+     * - r: R (matrix).
+     * - x0_i: T0 (matrix), allows NumericalDependencyTransform.
+     * - x1_i: T1 (matrix), allows NumericalDependencyTransform.
+     * - Order of dependencies: (x0_0, x1_0, x0_1, x1_1, ...).
+     *
+     * Same value as a CWiseMul<R, ReductionOf<R>> of MatrixProduct<R, T0, T1> nodes, in one pass over the
+     * columns: products are computed by blocks of columns, and multiplied into r while the block is in cache.
+     * No (rows, cols) matrix is stored for each product, which divides memory traffic by the number of products
+     * plus one. Products used elsewhere should stay MatrixProduct nodes, as the fused node does not store them.
+     * Derivation creates the unfused expression, and derives it.
+     * Node construction should be done with the create static method.
+     */
+    template <typename R, typename T0, typename T1> class CWiseMulOfMatrixProducts : public Value<R> {
+    public:
+      using Self = CWiseMulOfMatrixProducts;
+      using DepT0 = typename NumericalDependencyTransform<T0>::DepType;
+      using DepT1 = typename NumericalDependencyTransform<T1>::DepType;
+
+      /// Number of columns computed at once.
+      static constexpr Eigen::Index columnBlockSize = 64;
+
+      /// Build a new CWiseMulOfMatrixProducts node with the given output dimensions.
+      static ValueRef<R> create (Context & c, NodeRefVec && deps, const Dimension<R> & dim) {
+        // Check dependencies
+        checkDependenciesNotNull (typeid (Self), deps);
+        if (deps.size () % 2 != 0) {
+          failureDependencyNumberMismatch (typeid (Self), deps.size () + 1, deps.size ());
+        }
+        for (std::size_t i = 0; i < deps.size (); i += 2) {
+          checkNthDependencyIsValue<DepT0> (typeid (Self), deps, i);
+          checkNthDependencyIsValue<DepT1> (typeid (Self), deps, i + 1);
+        }
+        // Return 0 if any 0.
+        if (std::any_of (deps.begin (), deps.end (), [](const NodeRef & dep) {
+              return dep->hasNumericalProperty (NumericalProperty::ConstantZero);
+            })) {
+          return ConstantZero<R>::create (c, dim);
+        }
+        // Select node implementation: a single product has no temporary to save.
+        if (deps.size () == 0) {
+          return ConstantOne<R>::create (c, dim);
+        } else if (deps.size () == 2) {
+          return MatrixProduct<R, T0, T1>::create (c, std::move (deps), dim);
+        } else {
+          return cachedAs<Value<R>> (c, makeNode<Self> (c, std::move (deps), dim));
+        }
+      }
+
+      CWiseMulOfMatrixProducts (NodeRefVec && deps, const Dimension<R> & dim)
+        : Value<R> (std::move (deps)), targetDimension_ (dim) {}
+
+      std::string debugInfo () const override {
+        using namespace numeric;
+        return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+      }
+
+      // CWiseMulOfMatrixProducts additional arguments = ().
+      bool compareAdditionalArguments (const Node & other) const final {
+        return dynamic_cast<const Self *> (&other) != nullptr;
+      }
+
+      NodeRef derive (Context & c, const Node & node) final {
+        if (&node == this) {
+          return ConstantOne<R>::create (c, targetDimension_);
+        }
+        const auto n = this->nbDependencies () / 2;
+        NodeRefVec products (n);
+        for (std::size_t i = 0; i < n; ++i) {
+          products[i] = MatrixProduct<R, T0, T1>::create (
+            c, {this->dependency (2 * i), this->dependency (2 * i + 1)}, targetDimension_);
+        }
+        return CWiseMul<R, ReductionOf<R>>::create (c, std::move (products), targetDimension_)->derive (c, node);
+      }
+
+      NodeRef recreate (Context & c, NodeRefVec && deps) final {
+        return Self::create (c, std::move (deps), targetDimension_);
+      }
+
+    private:
+      void compute () final {
+        auto & result = this->accessValueMutable ();
+        const auto n = this->nbDependencies () / 2;
+        const auto nbCols = targetDimension_.cols;
+        const auto blockSize = std::min (nbCols, Eigen::Index (columnBlockSize));
+        result.resize (targetDimension_.rows, nbCols);
+        product_.resize (targetDimension_.rows, blockSize);
+        for (Eigen::Index first = 0; first < nbCols; first += blockSize) {
+          const auto size = std::min (blockSize, nbCols - first);
+          auto block = result.middleCols (first, size);
+          auto product = product_.leftCols (size);
+          for (std::size_t i = 0; i < n; ++i) {
+            const auto & x0 = accessValueConstCast<DepT0> (*this->dependency (2 * i));
+            const auto & x1 = accessValueConstCast<DepT1> (*this->dependency (2 * i + 1));
+            const auto x1Block = NumericalDependencyTransform<T1>::transform (x1).middleCols (first, size);
+            if (i == 0) {
+              block.noalias () = NumericalDependencyTransform<T0>::transform (x0) * x1Block;
+            } else {
+              product.noalias () = NumericalDependencyTransform<T0>::transform (x0) * x1Block;
+              block.array () *= product.array ();
+            }
+          }
+        }
+      }
+
+      Dimension<R> targetDimension_;
+      R product_; // Product of the current column block
+    };
+
+    template <typename R, typename T0, typename T1>
+    constexpr Eigen::Index CWiseMulOfMatrixProducts<R, T0, T1>::columnBlockSize;
+
     /** @brief r = n * delta + x.
      * - r: T.
      * - delta: double.
@@ -1451,7 +1686,7 @@ namespace bpp {
         if (n == 0 || delta->hasNumericalProperty (NumericalProperty::ConstantZero)) {
           return convertRef<Value<T>> (x);
         } else {
-          return cachedAs<Value<T>> (c, std::make_shared<Self> (std::move (deps), n, dim));
+          return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), n, dim));
         }
       }
 
@@ -1546,8 +1781,7 @@ namespace bpp {
           if (coeffs2.empty ()) {
             return ConstantZero<T>::create (c, dim);
           } else {
-            return cachedAs<Value<T>> (
-              c, std::make_shared<Self> (std::move (deps2), n2, std::move (coeffs2), dim));
+            return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps2), n2, std::move (coeffs2), dim));
           }
         };
         // Detect if we can merge this node with its dependencies
@@ -1749,10 +1983,15 @@ namespace bpp {
     extern template class SumOfLogarithms<Eigen::VectorXd>;
     extern template class SumOfLogarithms<Eigen::RowVectorXd>;
 
+    extern template class WeightedSumOfLogarithms<Eigen::VectorXd>;
+    extern template class WeightedSumOfLogarithms<Eigen::RowVectorXd>;
+
     extern template class MatrixProduct<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::MatrixXd>;
     extern template class MatrixProduct<Eigen::RowVectorXd, Eigen::RowVectorXd, Eigen::MatrixXd>;
     extern template class MatrixProduct<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>;
 
+    extern template class CWiseMulOfMatrixProducts<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>;
+
     extern template class ShiftDelta<double>;
     extern template class ShiftDelta<Eigen::VectorXd>;
     extern template class ShiftDelta<Eigen::RowVectorXd>;
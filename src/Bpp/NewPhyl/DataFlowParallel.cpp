@@ -0,0 +1,259 @@
+//
+// File: DataFlowParallel.cpp
+// Authors:
+//   Julien Dutheil
+// Created: 2026-10-14
+// Last modified: 2026-10-14
+//
+
+/*
+  Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <algorithm>
+#include <stack>
+#include <unordered_map>
+
+#include "DataFlowParallel.h"
+
+namespace bpp {
+  namespace dataflow {
+    ParallelExecutor::ParallelExecutor (std::size_t nbThreads)
+      : queues_ (nbThreads > 0 ? nbThreads : 1) {
+      threads_.reserve (queues_.size () - 1);
+      for (std::size_t i = 1; i < queues_.size (); ++i) {
+        threads_.emplace_back ([this, i] { workerLoop (i); });
+      }
+    }
+
+    ParallelExecutor::~ParallelExecutor () {
+      {
+        std::lock_guard<std::mutex> lock (stateMutex_);
+        stopping_ = true;
+      }
+      workAvailable_.notify_all ();
+      for (auto & t : threads_)
+        t.join ();
+    }
+
+    void ParallelExecutor::computeRecursively (Node & node) { computeRecursively (std::vector<Node *>{&node}); }
+
+    void ParallelExecutor::computeRecursively (const std::vector<Node *> & nodes) {
+      // Evaluations interrupted by concurrent invalidations leave some nodes invalid: restart them.
+      while (std::any_of (nodes.begin (), nodes.end (), [](const Node * n) { return !n->isValid (); }))
+        evaluate (nodes);
+    }
+
+    void ParallelExecutor::evaluate (const std::vector<Node *> & nodes) {
+      // Discover nodes needing a recomputation, same walk as Node::computeRecursively.
+      std::unordered_map<Node *, std::size_t> taskIndexes;
+      std::stack<Node *> nodesToVisit;
+      for (auto * n : nodes)
+        nodesToVisit.push (n);
+      while (!nodesToVisit.empty ()) {
+        auto * n = nodesToVisit.top ();
+        nodesToVisit.pop ();
+        if (!n->isValid () && taskIndexes.find (n) == taskIndexes.end ()) {
+          taskIndexes.emplace (n, tasks_.size ());
+          tasks_.push_back (Task{n, {}});
+          for (auto & dep : n->dependencies ())
+            nodesToVisit.push (dep.get ());
+        }
+      }
+      if (tasks_.empty ())
+        return;
+
+      // Build the dependency counts and reverse edges, restricted to invalid nodes.
+      const auto nbTasks = tasks_.size ();
+      nbPendingDependencies_.reset (new std::atomic<std::size_t>[nbTasks]);
+      for (std::size_t i = 0; i < nbTasks; ++i) {
+        std::size_t nbPending = 0;
+        for (auto & dep : tasks_[i].node->dependencies ()) {
+          auto it = taskIndexes.find (dep.get ());
+          if (it != taskIndexes.end ()) {
+            tasks_[it->second].dependentTasks.push_back (i);
+            ++nbPending; // Duplicated dependencies are counted (and decremented) once per occurrence
+          }
+        }
+        nbPendingDependencies_[i].store (nbPending, std::memory_order_relaxed);
+      }
+
+      // Start the evaluation: wake workers, then distribute initially ready tasks.
+      aborted_.store (false);
+      {
+        std::lock_guard<std::mutex> lock (stateMutex_);
+        nbRemainingTasks_ = nbTasks;
+        firstException_ = nullptr;
+        ++generation_;
+      }
+      workAvailable_.notify_all ();
+      std::size_t nextQueue = 0;
+      for (std::size_t i = 0; i < nbTasks; ++i) {
+        if (nbPendingDependencies_[i].load (std::memory_order_relaxed) == 0) {
+          pushTask (nextQueue, i);
+          nextQueue = (nextQueue + 1) % queues_.size ();
+        }
+      }
+
+      // Participate, then wait for workers to leave the evaluation before cleaning up.
+      runTasks (0);
+      std::exception_ptr exception;
+      {
+        std::unique_lock<std::mutex> lock (stateMutex_);
+        evaluationDone_.wait (lock, [this] { return nbActiveWorkers_ == 0; });
+        exception = firstException_;
+        firstException_ = nullptr;
+        nbQueuedTasks_ = 0;
+      }
+      for (auto & q : queues_) {
+        std::lock_guard<std::mutex> lock (q.mutex);
+        q.tasks.clear (); // Only non empty after a failure
+      }
+      tasks_.clear ();
+      nbPendingDependencies_.reset ();
+      if (exception)
+        std::rethrow_exception (exception);
+    }
+
+    void ParallelExecutor::workerLoop (std::size_t workerIndex) {
+      std::size_t seenGeneration = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock (stateMutex_);
+          workAvailable_.wait (lock, [this, seenGeneration] { return stopping_ || generation_ != seenGeneration; });
+          if (stopping_)
+            return;
+          seenGeneration = generation_;
+          ++nbActiveWorkers_;
+        }
+        runTasks (workerIndex);
+        {
+          std::lock_guard<std::mutex> lock (stateMutex_);
+          --nbActiveWorkers_;
+        }
+        evaluationDone_.notify_all ();
+      }
+    }
+
+    void ParallelExecutor::runTasks (std::size_t workerIndex) {
+      while (true) {
+        std::size_t taskIndex;
+        if (!aborted_.load () && popTask (workerIndex, taskIndex)) {
+          executeTask (workerIndex, taskIndex);
+        } else {
+          // Nothing to do for now: sleep until a task is queued or the evaluation ends.
+          std::unique_lock<std::mutex> lock (stateMutex_);
+          workAvailable_.wait (lock, [this] {
+            return nbQueuedTasks_ > 0 || nbRemainingTasks_ == 0 || aborted_.load () || stopping_;
+          });
+          if (nbRemainingTasks_ == 0 || aborted_.load () || stopping_)
+            return;
+        }
+      }
+    }
+
+    bool ParallelExecutor::popTask (std::size_t workerIndex, std::size_t & taskIndex) {
+      bool found = false;
+      {
+        // Own deque: LIFO.
+        auto & own = queues_[workerIndex];
+        std::lock_guard<std::mutex> lock (own.mutex);
+        if (!own.tasks.empty ()) {
+          taskIndex = own.tasks.back ();
+          own.tasks.pop_back ();
+          found = true;
+        }
+      }
+      // Steal from other deques: FIFO.
+      for (std::size_t i = 1; !found && i < queues_.size (); ++i) {
+        auto & victim = queues_[(workerIndex + i) % queues_.size ()];
+        std::lock_guard<std::mutex> lock (victim.mutex);
+        if (!victim.tasks.empty ()) {
+          taskIndex = victim.tasks.front ();
+          victim.tasks.pop_front ();
+          found = true;
+        }
+      }
+      if (found) {
+        std::lock_guard<std::mutex> lock (stateMutex_);
+        --nbQueuedTasks_;
+      }
+      return found;
+    }
+
+    void ParallelExecutor::pushTask (std::size_t workerIndex, std::size_t taskIndex) {
+      {
+        auto & q = queues_[workerIndex];
+        std::lock_guard<std::mutex> lock (q.mutex);
+        q.tasks.push_back (taskIndex);
+      }
+      {
+        std::lock_guard<std::mutex> lock (stateMutex_);
+        ++nbQueuedTasks_;
+      }
+      workAvailable_.notify_one ();
+    }
+
+    void ParallelExecutor::recordFailure () {
+      {
+        std::lock_guard<std::mutex> lock (stateMutex_);
+        if (!firstException_)
+          firstException_ = std::current_exception ();
+        aborted_.store (true);
+      }
+      workAvailable_.notify_all ();
+    }
+
+    void ParallelExecutor::executeTask (std::size_t workerIndex, std::size_t taskIndex) {
+      const auto & task = tasks_[taskIndex];
+      try {
+        // If interrupted, dependents will fail too, and the evaluation is restarted by computeRecursively.
+        task.node->tryCompute ();
+      } catch (...) {
+        recordFailure ();
+        return;
+      }
+      // Release dependents: the last finished dependency queues the dependent on its own deque.
+      for (auto dependent : task.dependentTasks) {
+        if (nbPendingDependencies_[dependent].fetch_sub (1) == 1)
+          pushTask (workerIndex, dependent);
+      }
+      bool finished;
+      {
+        std::lock_guard<std::mutex> lock (stateMutex_);
+        finished = --nbRemainingTasks_ == 0;
+      }
+      if (finished)
+        workAvailable_.notify_all ();
+    }
+  } // namespace dataflow
+} // namespace bpp
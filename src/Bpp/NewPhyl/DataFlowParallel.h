@@ -0,0 +1,149 @@
+//
+// File: DataFlowParallel.h
+// Authors:
+//   Julien Dutheil
+// Created: 2026-10-14
+// Last modified: 2026-10-14
+//
+
+/*
+  Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_NEWPHYL_DATAFLOWPARALLEL_H
+#define BPP_NEWPHYL_DATAFLOWPARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DataFlow.h"
+
+/** @file Parallel evaluation of dataflow graphs.
+ */
+namespace bpp {
+  namespace dataflow {
+    /** @brief Evaluate dataflow graphs using a pool of threads.
+     *
+     * This is an alternative to Node::computeRecursively().
+     * The set of invalid nodes that must be recomputed is discovered first (single threaded).
+     * Each of these nodes is then scheduled as soon as all its invalid dependencies have been recomputed.
+     * Independent nodes (sibling subtrees in a likelihood graph for example) are thus computed concurrently.
+     *
+     * Scheduling uses one task deque per thread (the calling thread participates as worker 0).
+     * A thread pushes nodes made ready by its own computations to the back of its deque, and pops from the
+     * back : this favors depth-first evaluation and cache locality.
+     * When its deque is empty, a thread steals from the front of other deques.
+     *
+     * Nodes follow the same concurrent protocol as computeRecursively() (see Node).
+     * Graphs can thus be evaluated by several executors, or modified, concurrently.
+     * If an evaluation is interrupted by a concurrent invalidation, it is restarted for remaining invalid nodes.
+     * Nodes which share a non thread safe resource must protect it themselves (see ConfiguredModel).
+     * If a compute() throws, remaining nodes are not computed and the first exception is rethrown.
+     *
+     * Threads are created once, at construction, to amortize their cost over many evaluations.
+     */
+    class ParallelExecutor {
+    public:
+      /// Create an executor with nbThreads threads in total (including the calling one), at least 1.
+      explicit ParallelExecutor (std::size_t nbThreads = std::thread::hardware_concurrency ());
+      ~ParallelExecutor ();
+
+      ParallelExecutor (const ParallelExecutor &) = delete;
+      ParallelExecutor & operator= (const ParallelExecutor &) = delete;
+
+      /// Number of threads used for computation (including the calling thread).
+      std::size_t nbThreads () const noexcept { return queues_.size (); }
+
+      /// Compute node value, recomputing dependencies (transitively) in parallel as needed.
+      void computeRecursively (Node & node);
+      /// Compute multiple node values at once, sharing the schedule of common dependencies.
+      void computeRecursively (const std::vector<Node *> & nodes);
+
+      /// Access value of node, recomputing it in parallel if needed.
+      template <typename T> const T & getValue (Value<T> & node) {
+        computeRecursively (node);
+        return node.accessValueConst ();
+      }
+
+    private:
+      // Scheduling information for a node to recompute.
+      struct Task {
+        Node * node;
+        std::vector<std::size_t> dependentTasks; // Indexes in tasks_
+      };
+      // Task deque of one worker thread, and its lock.
+      struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+      };
+
+      void evaluate (const std::vector<Node *> & nodes);
+      void workerLoop (std::size_t workerIndex);
+      void runTasks (std::size_t workerIndex);
+      void recordFailure ();
+      bool popTask (std::size_t workerIndex, std::size_t & taskIndex);
+      void pushTask (std::size_t workerIndex, std::size_t taskIndex);
+      void executeTask (std::size_t workerIndex, std::size_t taskIndex);
+
+      std::vector<WorkQueue> queues_;
+      std::vector<std::thread> threads_;
+
+      /* Current evaluation state.
+       * tasks_ and nbPendingDependencies_ are built before any task is queued, then only read.
+       * nbPendingDependencies_[i] is the number of invalid dependencies of tasks_[i] not yet recomputed.
+       * Other fields are protected by stateMutex_.
+       */
+      std::vector<Task> tasks_{};
+      std::unique_ptr<std::atomic<std::size_t>[]> nbPendingDependencies_{};
+      std::atomic<bool> aborted_{false};
+
+      std::mutex stateMutex_;
+      std::size_t nbQueuedTasks_{0};
+      std::size_t nbRemainingTasks_{0};
+      std::size_t nbActiveWorkers_{0};
+      std::size_t generation_{0}; // Incremented at each evaluation start to wake workers
+      bool stopping_{false};
+      std::exception_ptr firstException_{};
+      std::condition_variable workAvailable_;
+      std::condition_variable evaluationDone_;
+    };
+  } // namespace dataflow
+} // namespace bpp
+
+#endif // BPP_NEWPHYL_DATAFLOWPARALLEL_H
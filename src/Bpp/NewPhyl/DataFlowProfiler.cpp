@@ -0,0 +1,161 @@
+//
+// File: DataFlowProfiler.cpp
+// Authors:
+//   Julien Dutheil
+// Created: 2026-10-14
+// Last modified: 2026-10-14
+//
+
+/*
+  Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <ostream>
+#include <typeinfo>
+#include <utility>
+
+#include "DataFlowProfiler.h"
+
+namespace bpp {
+  namespace dataflow {
+    NodeProfiler::~NodeProfiler () { stop (); }
+
+    void NodeProfiler::start () noexcept { setNodeProfiler (this); }
+    void NodeProfiler::stop () noexcept { unsetNodeProfiler (this); }
+
+    void NodeProfiler::reset () {
+      std::lock_guard<std::mutex> lock (mutex_);
+      records_.clear ();
+    }
+
+    void NodeProfiler::recordComputation (const Node & node, double seconds) {
+      const auto valueBytes = node.valueSizeInBytes ();
+      std::lock_guard<std::mutex> lock (mutex_);
+      auto it = records_.find (&node);
+      if (it == records_.end ()) {
+        NodeRecord record;
+        record.className = prettyTypeName (typeid (node));
+        record.description = node.description ();
+        record.stats.nbNodes = 1;
+        it = records_.emplace (&node, std::move (record)).first;
+      }
+      auto & stats = it->second.stats;
+      stats.nbComputations++;
+      stats.totalSeconds += seconds;
+      stats.valueBytes = valueBytes;
+    }
+
+    NodeProfiler::Statistics NodeProfiler::nodeStatistics (const Node & node) const {
+      std::lock_guard<std::mutex> lock (mutex_);
+      auto it = records_.find (&node);
+      return it != records_.end () ? it->second.stats : Statistics{};
+    }
+
+    std::map<std::string, NodeProfiler::Statistics> NodeProfiler::classStatistics () const {
+      std::lock_guard<std::mutex> lock (mutex_);
+      std::map<std::string, Statistics> byClass;
+      for (const auto & p : records_) {
+        const auto & nodeStats = p.second.stats;
+        auto & classStats = byClass[p.second.className];
+        classStats.nbNodes += nodeStats.nbNodes;
+        classStats.nbComputations += nodeStats.nbComputations;
+        classStats.totalSeconds += nodeStats.totalSeconds;
+        classStats.valueBytes += nodeStats.valueBytes;
+      }
+      return byClass;
+    }
+
+    // Write a report table, sorted by decreasing total time.
+    static void writeReportTable (std::ostream & os,
+                                  std::vector<std::pair<std::string, NodeProfiler::Statistics>> && lines) {
+      using Line = std::pair<std::string, NodeProfiler::Statistics>;
+      std::sort (lines.begin (), lines.end (), [](const Line & lhs, const Line & rhs) {
+        return lhs.second.totalSeconds > rhs.second.totalSeconds;
+      });
+      os << std::setw (12) << "time_ms" << std::setw (10) << "computed" << std::setw (8) << "nodes"
+         << std::setw (12) << "bytes"
+         << "  name\n";
+      for (const auto & line : lines) {
+        const auto & stats = line.second;
+        os << std::setw (12) << std::fixed << std::setprecision (3) << stats.totalSeconds * 1000.
+           << std::setw (10) << stats.nbComputations << std::setw (8) << stats.nbNodes << std::setw (12)
+           << stats.valueBytes << "  " << line.first << '\n';
+      }
+    }
+
+    void NodeProfiler::writeReport (std::ostream & os) const {
+      const auto byClass = classStatistics ();
+      std::vector<std::pair<std::string, Statistics>> nodeLines;
+      {
+        std::lock_guard<std::mutex> lock (mutex_);
+        nodeLines.reserve (records_.size ());
+        for (const auto & p : records_) {
+          nodeLines.emplace_back (p.second.description, p.second.stats);
+        }
+      }
+      const auto flags = os.flags ();
+      const auto precision = os.precision ();
+      os << "Node classes:\n";
+      writeReportTable (os, std::vector<std::pair<std::string, Statistics>> (byClass.begin (), byClass.end ()));
+      os << "Nodes:\n";
+      writeReportTable (os, std::move (nodeLines));
+      os.flags (flags);
+      os.precision (precision);
+    }
+
+    void NodeProfiler::writeGraphToDot (std::ostream & os, const std::vector<const Node *> & nodes,
+                                        DotOptions opt) const {
+      std::lock_guard<std::mutex> lock (mutex_);
+      double maxSeconds = 0.;
+      for (const auto & p : records_) {
+        maxSeconds = std::max (maxSeconds, p.second.stats.totalSeconds);
+      }
+      bpp::dataflow::writeGraphToDot (os, nodes, opt, [this, maxSeconds](const Node & node) -> std::string {
+        auto it = records_.find (&node);
+        if (it == records_.end ()) {
+          return "style=filled,fillcolor=white";
+        }
+        const auto & stats = it->second.stats;
+        // HSV hue: 0.66 (blue) for no time, to 0 (red) for the slowest node.
+        const double heat = maxSeconds > 0. ? stats.totalSeconds / maxSeconds : 0.;
+        char attributes[128];
+        std::snprintf (attributes, sizeof (attributes),
+                       "style=filled,fillcolor=\"%.3f 0.700 1.000\",xlabel=\"n=%zu t=%.3fms\"",
+                       0.66 * (1. - heat), stats.nbComputations, stats.totalSeconds * 1000.);
+        return attributes;
+      });
+    }
+  } // namespace dataflow
+} // namespace bpp
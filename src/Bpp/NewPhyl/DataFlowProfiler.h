@@ -0,0 +1,132 @@
+//
+// File: DataFlowProfiler.h
+// Authors:
+//   Julien Dutheil
+// Created: 2026-10-14
+// Last modified: 2026-10-14
+//
+
+/*
+  Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_NEWPHYL_DATAFLOWPROFILER_H
+#define BPP_NEWPHYL_DATAFLOWPROFILER_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DataFlow.h"
+
+/** @file Profiling of dataflow graph computations.
+ */
+namespace bpp {
+  namespace dataflow {
+    /** @brief Records compute() calls of dataflow nodes: number of calls, time, value size.
+     *
+     * Profiling is opt-in: a profiler only records while it is started.
+     * At most one profiler is active at a time, for all nodes and threads.
+     * When no profiler is active, the overhead is a single atomic load per compute().
+     *
+     * Statistics are kept by node instance, and can be aggregated by node class.
+     * A high number of computations for a node indicates frequent invalidations: for example a
+     * TransitionMatrixFromModel recomputed while only unrelated branch lengths were changed.
+     *
+     * Nodes are identified by address: statistics of a destroyed node stay until reset().
+     */
+    class NodeProfiler {
+    public:
+      /// Statistics for a node (nbNodes = 1), or aggregated for a node class.
+      struct Statistics {
+        std::size_t nbNodes{0};
+        std::size_t nbComputations{0};
+        double totalSeconds{0.}; // Cumulated wall time of compute() calls
+        std::size_t valueBytes{0}; // Value size at the last computation (sum for classes)
+      };
+
+      NodeProfiler () = default;
+      ~NodeProfiler (); // Stops if active
+      NodeProfiler (const NodeProfiler &) = delete;
+      NodeProfiler & operator= (const NodeProfiler &) = delete;
+
+      /// Start recording computations of all nodes (replaces the active profiler, if any).
+      void start () noexcept;
+      /// Stop recording, if this profiler is active.
+      void stop () noexcept;
+      /// Discard all recorded statistics.
+      void reset ();
+
+      /// Record a compute() call (called by the dataflow core, thread safe).
+      void recordComputation (const Node & node, double seconds);
+
+      /// Statistics for a node (zero if it was never computed while recording).
+      Statistics nodeStatistics (const Node & node) const;
+      /// Statistics aggregated by node class (pretty type name).
+      std::map<std::string, Statistics> classStatistics () const;
+
+      /// Write a text report: node classes, then nodes, sorted by decreasing total time.
+      void writeReport (std::ostream & os) const;
+
+      /** @brief Write dataflow graph starting at nodes, with nodes coloured by total time.
+       * Colours go from blue (fast) to red (slowest node), nodes never computed are white.
+       * The number of computations and total time are added as an external label.
+       */
+      void writeGraphToDot (std::ostream & os, const std::vector<const Node *> & nodes,
+                            DotOptions opt = DotOptions::None) const;
+
+    private:
+      struct NodeRecord {
+        std::string className;
+        std::string description;
+        Statistics stats;
+      };
+
+      mutable std::mutex mutex_;
+      std::unordered_map<const Node *, NodeRecord> records_;
+    };
+
+    /** @brief Set the active profiler, or disable profiling with nullptr.
+     * Returns the previously active profiler.
+     * Prefer NodeProfiler::start() and stop().
+     */
+    NodeProfiler * setNodeProfiler (NodeProfiler * profiler) noexcept;
+    /// Disable profiling if profiler is the active one. Returns true if it was active.
+    bool unsetNodeProfiler (NodeProfiler * profiler) noexcept;
+  } // namespace dataflow
+} // namespace bpp
+
+#endif // BPP_NEWPHYL_DATAFLOWPROFILER_H
@@ -42,14 +42,17 @@
 #ifndef BPP_NEWPHYL_EXTENDEDFLOAT_H
 #define BPP_NEWPHYL_EXTENDEDFLOAT_H
 
+#include <Eigen/Core>
+#include <algorithm>
 #include <cmath>
+#include <functional>
 #include <limits>
 #include <string>
 
 namespace bpp {
 
 template <typename T> constexpr T constexpr_power (T d, int n) {
-	return n == 0 ? 1.0 : (n > 0 ? constexpr_power (d, n - 1) * d : constexpr_power (d, n + 1) / d);
+	return n == 0 ? T (1) : (n > 0 ? constexpr_power (d, n - 1) * d : constexpr_power (d, n + 1) / d);
 }
 
 class ExtendedFloat {
@@ -86,7 +89,9 @@ public:
 	static constexpr FloatType normalize_big_factor = 1. / biggest_normalized_value;
 	static constexpr FloatType normalize_small_factor = 1. / smallest_normalized_value;
 
-	// TODO add denorm info for sum
+	/* Sums align exponents on the biggest one: the float part of the other operand is scaled down,
+	 * and only underflows to 0 if it is negligible. The exponent of a zero is ignored.
+	 */
 
 	constexpr ExtendedFloat (FloatType f = 0.0, ExtType e = 0) noexcept : f_ (f), exp_ (e) {}
 
@@ -114,6 +119,20 @@ public:
 		normalize_small ();
 	}
 
+	// Value as a FloatType (may overflow to infinity, or underflow to 0).
+	explicit operator FloatType () const noexcept { return std::scalbn (f_, exp_); }
+
+	/* Float parts of two values with a common exponent, which is returned.
+	 * Used to implement sums and comparisons.
+	 */
+	static ExtType align (const ExtendedFloat & lhs, const ExtendedFloat & rhs, FloatType & lhsF,
+	                      FloatType & rhsF) noexcept {
+		ExtType e = lhs.f_ == 0. ? rhs.exp_ : (rhs.f_ == 0. ? lhs.exp_ : std::max (lhs.exp_, rhs.exp_));
+		lhsF = std::scalbn (lhs.f_, lhs.exp_ - e);
+		rhsF = std::scalbn (rhs.f_, rhs.exp_ - e);
+		return e;
+	}
+
 private:
 	FloatType f_;
 	ExtType exp_;
@@ -127,6 +146,60 @@ inline ExtendedFloat operator* (const ExtendedFloat & lhs, const ExtendedFloat &
 	r.normalize ();
 	return r;
 }
+inline ExtendedFloat & operator*= (ExtendedFloat & lhs, const ExtendedFloat & rhs) {
+	return lhs = lhs * rhs;
+}
+
+inline ExtendedFloat denorm_add (const ExtendedFloat & lhs, const ExtendedFloat & rhs) {
+	ExtendedFloat::FloatType lhsF, rhsF;
+	auto e = ExtendedFloat::align (lhs, rhs, lhsF, rhsF);
+	return {lhsF + rhsF, e};
+}
+inline ExtendedFloat operator+ (const ExtendedFloat & lhs, const ExtendedFloat & rhs) {
+	auto r = denorm_add (lhs, rhs);
+	r.normalize ();
+	return r;
+}
+inline ExtendedFloat & operator+= (ExtendedFloat & lhs, const ExtendedFloat & rhs) {
+	return lhs = lhs + rhs;
+}
+
+// Comparisons (of values, not of representations).
+inline bool operator== (const ExtendedFloat & lhs, const ExtendedFloat & rhs) {
+	ExtendedFloat::FloatType lhsF, rhsF;
+	ExtendedFloat::align (lhs, rhs, lhsF, rhsF);
+	return lhsF == rhsF;
+}
+inline bool operator!= (const ExtendedFloat & lhs, const ExtendedFloat & rhs) {
+	return !(lhs == rhs);
+}
+inline bool operator< (const ExtendedFloat & lhs, const ExtendedFloat & rhs) {
+	ExtendedFloat::FloatType lhsF, rhsF;
+	ExtendedFloat::align (lhs, rhs, lhsF, rhsF);
+	return lhsF < rhsF;
+}
+inline bool operator> (const ExtendedFloat & lhs, const ExtendedFloat & rhs) {
+	return rhs < lhs;
+}
+inline bool operator<= (const ExtendedFloat & lhs, const ExtendedFloat & rhs) {
+	ExtendedFloat::FloatType lhsF, rhsF;
+	ExtendedFloat::align (lhs, rhs, lhsF, rhsF);
+	return lhsF <= rhsF;
+}
+inline bool operator>= (const ExtendedFloat & lhs, const ExtendedFloat & rhs) {
+	return rhs <= lhs;
+}
+
+// Classification, found by Eigen through ADL.
+inline bool isnan (const ExtendedFloat & ef) {
+	return std::isnan (ef.float_part ());
+}
+inline bool isinf (const ExtendedFloat & ef) {
+	return std::isinf (ef.float_part ());
+}
+inline bool isfinite (const ExtendedFloat & ef) {
+	return std::isfinite (ef.float_part ());
+}
 
 inline double log (const ExtendedFloat & ef) {
 	static const auto ln_radix = std::log (static_cast<double> (ExtendedFloat::radix));
@@ -139,7 +212,52 @@ inline std::string to_string (const ExtendedFloat & ef) {
 }
 
 // TODO add Vector<EF> = Vector<double> + one exp (for lik vectors for one site, big tree case)
-// TODO add Vector<EF> = Vector<double> + Vector<exps> (for lik vec by site, eigen, delayed_norm)
+// Vector<EF> = Vector<double> + Vector<exps> (lik vec by site, eigen, delayed_norm): see ExtendedFloatMatrix.
 } // namespace bpp
 
+namespace std {
+// Hash of the value, not of the representation: equal values with different exponents hash the same.
+template <> struct hash<bpp::ExtendedFloat> {
+	std::size_t operator() (const bpp::ExtendedFloat & ef) const {
+		if (ef.float_part () == 0.)
+			return std::hash<double>{}(0.);
+		int e;
+		const double mantissa = std::frexp (ef.float_part (), &e); // Radix 2
+		std::size_t seed = std::hash<double>{}(mantissa);
+		seed ^= std::hash<int>{}(ef.exponent_part () + e) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		return seed;
+	}
+};
+} // namespace std
+
+namespace Eigen {
+/* ExtendedFloat as an Eigen scalar type.
+ * Eigen matrices of ExtendedFloat support component-wise sums and products, comparisons, and matrix products.
+ * Values are positive, and there is no subtraction or division.
+ */
+template <> struct NumTraits<bpp::ExtendedFloat> : GenericNumTraits<bpp::ExtendedFloat> {
+	using Real = bpp::ExtendedFloat;
+	using NonInteger = bpp::ExtendedFloat;
+	using Nested = bpp::ExtendedFloat;
+	using Literal = bpp::ExtendedFloat;
+	enum {
+		IsComplex = 0,
+		IsInteger = 0,
+		IsSigned = 0,
+		RequireInitialization = 1,
+		ReadCost = 2,
+		AddCost = 8,
+		MulCost = 4
+	};
+	static Real epsilon () { return NumTraits<double>::epsilon (); }
+	static Real dummy_precision () { return NumTraits<double>::dummy_precision (); }
+	static Real highest () { return {NumTraits<double>::highest (), std::numeric_limits<int>::max ()}; }
+	static Real lowest () { return Real (0.); }
+	static Real infinity () { return NumTraits<double>::infinity (); }
+	static Real quiet_NaN () { return NumTraits<double>::quiet_NaN (); }
+	static int digits10 () { return NumTraits<double>::digits10 (); }
+	static int digits () { return NumTraits<double>::digits (); }
+};
+} // namespace Eigen
+
 #endif // BPP_NEWPHYL_EXTENDEDFLOAT_H
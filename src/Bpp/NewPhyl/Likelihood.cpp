@@ -41,6 +41,7 @@
 #include <Bpp/Exceptions.h>
 #include <Bpp/NewPhyl/Likelihood.h>
 #include <Bpp/Phyl/Model/SubstitutionModel.h>
+#include <cmath>
 
 namespace bpp {
   namespace dataflow {
@@ -48,7 +49,7 @@ namespace bpp {
      * TODO use eigen internally in SubstitutionModel ! (not perf critical for now though)
      * FIXME if multithreading, internal model state must be removed !
      */
-    static void copyBppToEigen (const Matrix<double> & bppMatrix, Eigen::MatrixXd & eigenMatrix) {
+    template <typename T> static void copyBppToEigen (const Matrix<double> & bppMatrix, T & eigenMatrix) {
       const auto eigenRows = static_cast<Eigen::Index> (bppMatrix.getNumberOfRows ());
       const auto eigenCols = static_cast<Eigen::Index> (bppMatrix.getNumberOfColumns ());
       eigenMatrix.resize (eigenRows, eigenCols);
@@ -59,6 +60,13 @@ namespace bpp {
       }
     }
 
+    /* Helper: lock and access the model of a ConfiguredModel dependency from a compute() function.
+     * The lock must be held while calling model methods which use internal buffers (getPij_t, ...).
+     */
+    static std::unique_lock<std::mutex> lockModel (const NodeRef & modelDep) {
+      return std::unique_lock<std::mutex> (static_cast<ConfiguredModel &> (*modelDep).modelMutex ());
+    }
+
     /* Helper function for generating numerical derivatives of model computation nodes.
      * Assuming we have a v = f(model, stuff) node, with v of type T.
      * df/dn = sum_i df/dx_i * dx_i/dn + df/dstuff * dstuff/dn.
@@ -133,7 +141,7 @@ namespace bpp {
       checkDependenciesNotNull (typeid (Self), deps);
       checkDependencyVectorSize (typeid (Self), deps, nbParameters);
       checkDependencyRangeIsValue<double> (typeid (Self), deps, 0, nbParameters);
-      return cachedAs<Self> (c, std::make_shared<Self> (std::move (deps), std::move (model)));
+      return cachedAs<Self> (c, makeNode<Self> (c, std::move (deps), std::move (model)));
     }
 
     ConfiguredModel::ConfiguredModel (NodeRefVec && deps, std::unique_ptr<TransitionModel> && model)
@@ -198,7 +206,7 @@ namespace bpp {
       checkDependenciesNotNull (typeid (Self), deps);
       checkDependencyVectorSize (typeid (Self), deps, 1);
       checkNthDependencyIs<ConfiguredModel> (typeid (Self), deps, 0);
-      return cachedAs<Value<T>> (c, std::make_shared<Self> (std::move (deps), dim));
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
     }
 
     EquilibriumFrequenciesFromModel::EquilibriumFrequenciesFromModel (
@@ -238,92 +246,115 @@ namespace bpp {
       r = Eigen::Map<const T> (freqsFromModel.data (), static_cast<Eigen::Index> (freqsFromModel.size ()));
     }
 
-    // TransitionMatrixFromModel
+    // GenericTransitionMatrixFromModel
 
-    ValueRef<Eigen::MatrixXd> TransitionMatrixFromModel::create (Context & c, NodeRefVec && deps,
-                                                                 const Dimension<Eigen::MatrixXd> & dim) {
+    template <typename T>
+    ValueRef<T> GenericTransitionMatrixFromModel<T>::create (Context & c, NodeRefVec && deps,
+                                                             const Dimension<T> & dim) {
       checkDependenciesNotNull (typeid (Self), deps);
       checkDependencyVectorSize (typeid (Self), deps, 2);
       checkNthDependencyIs<ConfiguredModel> (typeid (Self), deps, 0);
       checkNthDependencyIsValue<double> (typeid (Self), deps, 1);
-      return cachedAs<Value<T>> (c, std::make_shared<Self> (std::move (deps), dim));
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
     }
 
-    TransitionMatrixFromModel::TransitionMatrixFromModel (NodeRefVec && deps,
-                                                          const Dimension<Eigen::MatrixXd> & dim)
-      : Value<Eigen::MatrixXd> (std::move (deps)), targetDimension_ (dim) {}
+    template <typename T>
+    GenericTransitionMatrixFromModel<T>::GenericTransitionMatrixFromModel (NodeRefVec && deps, const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), targetDimension_ (dim) {}
 
-    std::string TransitionMatrixFromModel::debugInfo () const {
+    template <typename T>
+    std::string GenericTransitionMatrixFromModel<T>::debugInfo () const {
       using namespace numeric;
       return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
     }
 
-    // TransitionMatrixFromModel additional arguments = ().
-    bool TransitionMatrixFromModel::compareAdditionalArguments (const Node & other) const {
+    // GenericTransitionMatrixFromModel additional arguments = ().
+    template <typename T>
+    bool GenericTransitionMatrixFromModel<T>::compareAdditionalArguments (const Node & other) const {
       return dynamic_cast<const Self *> (&other) != nullptr;
     }
 
-    NodeRef TransitionMatrixFromModel::derive (Context & c, const Node & node) {
+    template <typename T>
+    NodeRef GenericTransitionMatrixFromModel<T>::derive (Context & c, const Node & node) {
       // dtm/dn = sum_i dtm/dx_i * dx_i/dn + dtm/dbrlen + dbrlen/dn (x_i = model parameters).
       auto modelDep = this->dependency (0);
       auto brlenDep = this->dependency (1);
       // Model part
       auto & model = static_cast<ConfiguredModel &> (*modelDep);
-      auto buildFWithNewModel = [this, &c, &brlenDep](NodeRef && newModel) {
-        return Self::create (c, {std::move (newModel), brlenDep}, targetDimension_);
-      };
-      NodeRefVec derivativeSumDeps = generateModelDerivativeSumDepsForModelComputations<T> (
-        c, model, node, targetDimension_, buildFWithNewModel);
+      NodeRefVec derivativeSumDeps;
+      if (dynamic_cast<const SubstitutionModel *> (model.accessValueConst ()) != nullptr) {
+        // Analytical from the generator derivative: only the generator is derived numerically.
+        auto generator = GeneratorFromModel::create (
+          c, {modelDep}, MatrixDimension (targetDimension_.rows, targetDimension_.cols));
+        auto dgenerator_dn = generator->derive (c, node);
+        if (!dgenerator_dn->hasNumericalProperty (NumericalProperty::ConstantZero)) {
+          derivativeSumDeps.emplace_back (GenericTransitionMatrixFromModelGeneratorDerivative<T>::create (
+            c, {modelDep, brlenDep, std::move (dgenerator_dn)}, targetDimension_));
+        }
+      } else {
+        auto buildFWithNewModel = [this, &c, &brlenDep](NodeRef && newModel) {
+          return Self::create (c, {std::move (newModel), brlenDep}, targetDimension_);
+        };
+        derivativeSumDeps = generateModelDerivativeSumDepsForModelComputations<T> (
+          c, model, node, targetDimension_, buildFWithNewModel);
+      }
       // Brlen part, use specific node
       auto dbrlen_dn = brlenDep->derive (c, node);
       if (!dbrlen_dn->hasNumericalProperty (NumericalProperty::ConstantZero)) {
-        auto df_dbrlen =
-          TransitionMatrixFromModelFirstBrlenDerivative::create (c, {modelDep, brlenDep}, targetDimension_);
+        auto df_dbrlen = GenericTransitionMatrixFromModelFirstBrlenDerivative<T>::create (c, {modelDep, brlenDep},
+                                                                                           targetDimension_);
         derivativeSumDeps.emplace_back (CWiseMul<T, std::tuple<double, T>>::create (
           c, {std::move (dbrlen_dn), std::move (df_dbrlen)}, targetDimension_));
       }
       return CWiseAdd<T, ReductionOf<T>>::create (c, std::move (derivativeSumDeps), targetDimension_);
     }
 
-    NodeRef TransitionMatrixFromModel::recreate (Context & c, NodeRefVec && deps) {
+    template <typename T>
+    NodeRef GenericTransitionMatrixFromModel<T>::recreate (Context & c, NodeRefVec && deps) {
       return Self::create (c, std::move (deps), targetDimension_);
     }
 
-    void TransitionMatrixFromModel::compute () {
+    template <typename T>
+    void GenericTransitionMatrixFromModel<T>::compute () {
       const auto * model = accessValueConstCast<const TransitionModel *> (*this->dependency (0));
       const auto brlen = accessValueConstCast<double> (*this->dependency (1));
       auto & r = this->accessValueMutable ();
+      const auto lock = lockModel (this->dependency (0));
       copyBppToEigen (model->getPij_t (brlen), r);
     }
 
-    // TransitionMatrixFromModelFirstBrlenDerivative
+    // GenericTransitionMatrixFromModelFirstBrlenDerivative
 
-    ValueRef<Eigen::MatrixXd>
-    TransitionMatrixFromModelFirstBrlenDerivative::create (Context & c, NodeRefVec && deps,
-                                                           const Dimension<Eigen::MatrixXd> & dim) {
+    template <typename T>
+    ValueRef<T> GenericTransitionMatrixFromModelFirstBrlenDerivative<T>::create (Context & c, NodeRefVec && deps,
+                                                                                 const Dimension<T> & dim) {
       checkDependenciesNotNull (typeid (Self), deps);
       checkDependencyVectorSize (typeid (Self), deps, 2);
       checkNthDependencyIs<ConfiguredModel> (typeid (Self), deps, 0);
       checkNthDependencyIsValue<double> (typeid (Self), deps, 1);
-      return cachedAs<Value<T>> (c, std::make_shared<Self> (std::move (deps), dim));
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
     }
 
-    TransitionMatrixFromModelFirstBrlenDerivative::TransitionMatrixFromModelFirstBrlenDerivative (
-      NodeRefVec && deps, const Dimension<Eigen::MatrixXd> & dim)
-      : Value<Eigen::MatrixXd> (std::move (deps)), targetDimension_ (dim) {}
+    template <typename T>
+    GenericTransitionMatrixFromModelFirstBrlenDerivative<T>::GenericTransitionMatrixFromModelFirstBrlenDerivative (
+      NodeRefVec && deps, const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), targetDimension_ (dim) {}
 
-    std::string TransitionMatrixFromModelFirstBrlenDerivative::debugInfo () const {
+    template <typename T>
+    std::string GenericTransitionMatrixFromModelFirstBrlenDerivative<T>::debugInfo () const {
       using namespace numeric;
       return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
     }
 
-    // TransitionMatrixFromModelFirstBrlenDerivative additional arguments = ().
+    // GenericTransitionMatrixFromModelFirstBrlenDerivative additional arguments = ().
+    template <typename T>
     bool
-    TransitionMatrixFromModelFirstBrlenDerivative::compareAdditionalArguments (const Node & other) const {
+    GenericTransitionMatrixFromModelFirstBrlenDerivative<T>::compareAdditionalArguments (const Node & other) const {
       return dynamic_cast<const Self *> (&other) != nullptr;
     }
 
-    NodeRef TransitionMatrixFromModelFirstBrlenDerivative::derive (Context & c, const Node & node) {
+    template <typename T>
+    NodeRef GenericTransitionMatrixFromModelFirstBrlenDerivative<T>::derive (Context & c, const Node & node) {
       // dtm/dn = sum_i dtm/dx_i * dx_i/dn + dtm/dbrlen + dbrlen/dn (x_i = model parameters).
       auto modelDep = this->dependency (0);
       auto brlenDep = this->dependency (1);
@@ -337,53 +368,60 @@ namespace bpp {
       // Brlen part, use specific node
       auto dbrlen_dn = brlenDep->derive (c, node);
       if (!dbrlen_dn->hasNumericalProperty (NumericalProperty::ConstantZero)) {
-        auto df_dbrlen =
-          TransitionMatrixFromModelSecondBrlenDerivative::create (c, {modelDep, brlenDep}, targetDimension_);
+        auto df_dbrlen = GenericTransitionMatrixFromModelSecondBrlenDerivative<T>::create (c, {modelDep, brlenDep},
+                                                                                            targetDimension_);
         derivativeSumDeps.emplace_back (CWiseMul<T, std::tuple<double, T>>::create (
           c, {std::move (dbrlen_dn), std::move (df_dbrlen)}, targetDimension_));
       }
       return CWiseAdd<T, ReductionOf<T>>::create (c, std::move (derivativeSumDeps), targetDimension_);
     }
 
-    NodeRef TransitionMatrixFromModelFirstBrlenDerivative::recreate (Context & c, NodeRefVec && deps) {
+    template <typename T>
+    NodeRef GenericTransitionMatrixFromModelFirstBrlenDerivative<T>::recreate (Context & c, NodeRefVec && deps) {
       return Self::create (c, std::move (deps), targetDimension_);
     }
 
-    void TransitionMatrixFromModelFirstBrlenDerivative::compute () {
+    template <typename T>
+    void GenericTransitionMatrixFromModelFirstBrlenDerivative<T>::compute () {
       const auto * model = accessValueConstCast<const TransitionModel *> (*this->dependency (0));
       const auto brlen = accessValueConstCast<double> (*this->dependency (1));
       auto & r = this->accessValueMutable ();
+      const auto lock = lockModel (this->dependency (0));
       copyBppToEigen (model->getdPij_dt (brlen), r);
     }
 
-    // TransitionMatrixFromModelSecondBrlenDerivative
+    // GenericTransitionMatrixFromModelSecondBrlenDerivative
 
-    ValueRef<Eigen::MatrixXd>
-    TransitionMatrixFromModelSecondBrlenDerivative::create (Context & c, NodeRefVec && deps,
-                                                            const Dimension<Eigen::MatrixXd> & dim) {
+    template <typename T>
+    ValueRef<T> GenericTransitionMatrixFromModelSecondBrlenDerivative<T>::create (Context & c, NodeRefVec && deps,
+                                                                                  const Dimension<T> & dim) {
       checkDependenciesNotNull (typeid (Self), deps);
       checkDependencyVectorSize (typeid (Self), deps, 2);
       checkNthDependencyIs<ConfiguredModel> (typeid (Self), deps, 0);
       checkNthDependencyIsValue<double> (typeid (Self), deps, 1);
-      return cachedAs<Value<T>> (c, std::make_shared<Self> (std::move (deps), dim));
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
     }
 
-    TransitionMatrixFromModelSecondBrlenDerivative::TransitionMatrixFromModelSecondBrlenDerivative (
-      NodeRefVec && deps, const Dimension<Eigen::MatrixXd> & dim)
-      : Value<Eigen::MatrixXd> (std::move (deps)), targetDimension_ (dim) {}
+    template <typename T>
+    GenericTransitionMatrixFromModelSecondBrlenDerivative<T>::GenericTransitionMatrixFromModelSecondBrlenDerivative (
+      NodeRefVec && deps, const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), targetDimension_ (dim) {}
 
-    std::string TransitionMatrixFromModelSecondBrlenDerivative::debugInfo () const {
+    template <typename T>
+    std::string GenericTransitionMatrixFromModelSecondBrlenDerivative<T>::debugInfo () const {
       using namespace numeric;
       return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
     }
 
-    // TransitionMatrixFromModelSecondBrlenDerivative additional arguments = ().
+    // GenericTransitionMatrixFromModelSecondBrlenDerivative additional arguments = ().
+    template <typename T>
     bool
-    TransitionMatrixFromModelSecondBrlenDerivative::compareAdditionalArguments (const Node & other) const {
+    GenericTransitionMatrixFromModelSecondBrlenDerivative<T>::compareAdditionalArguments (const Node & other) const {
       return dynamic_cast<const Self *> (&other) != nullptr;
     }
 
-    NodeRef TransitionMatrixFromModelSecondBrlenDerivative::derive (Context & c, const Node & node) {
+    template <typename T>
+    NodeRef GenericTransitionMatrixFromModelSecondBrlenDerivative<T>::derive (Context & c, const Node & node) {
       // dtm/dn = sum_i dtm/dx_i * dx_i/dn + dtm/dbrlen + dbrlen/dn (x_i = model parameters).
       auto modelDep = this->dependency (0);
       auto brlenDep = this->dependency (1);
@@ -408,15 +446,456 @@ namespace bpp {
       return CWiseAdd<T, ReductionOf<T>>::create (c, std::move (derivativeSumDeps), targetDimension_);
     }
 
-    NodeRef TransitionMatrixFromModelSecondBrlenDerivative::recreate (Context & c, NodeRefVec && deps) {
+    template <typename T>
+    NodeRef GenericTransitionMatrixFromModelSecondBrlenDerivative<T>::recreate (Context & c, NodeRefVec && deps) {
       return Self::create (c, std::move (deps), targetDimension_);
     }
 
-    void TransitionMatrixFromModelSecondBrlenDerivative::compute () {
+    template <typename T>
+    void GenericTransitionMatrixFromModelSecondBrlenDerivative<T>::compute () {
       const auto * model = accessValueConstCast<const TransitionModel *> (*this->dependency (0));
       const auto brlen = accessValueConstCast<double> (*this->dependency (1));
       auto & r = this->accessValueMutable ();
+      const auto lock = lockModel (this->dependency (0));
       copyBppToEigen (model->getd2Pij_dt2 (brlen), r);
     }
+
+    // GeneratorFromModel
+
+    ValueRef<Eigen::MatrixXd> GeneratorFromModel::create (Context & c, NodeRefVec && deps,
+                                                          const Dimension<Eigen::MatrixXd> & dim) {
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyVectorSize (typeid (Self), deps, 1);
+      checkNthDependencyIs<ConfiguredModel> (typeid (Self), deps, 0);
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
+    }
+
+    GeneratorFromModel::GeneratorFromModel (NodeRefVec && deps, const Dimension<Eigen::MatrixXd> & dim)
+      : Value<Eigen::MatrixXd> (std::move (deps)), targetDimension_ (dim) {}
+
+    std::string GeneratorFromModel::debugInfo () const {
+      using namespace numeric;
+      return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+    }
+
+    // GeneratorFromModel additional arguments = ().
+    bool GeneratorFromModel::compareAdditionalArguments (const Node & other) const {
+      return dynamic_cast<const Self *> (&other) != nullptr;
+    }
+
+    NodeRef GeneratorFromModel::derive (Context & c, const Node & node) {
+      // dgenerator/dn = sum_i dgenerator/dx_i * dx_i/dn (x_i = model parameters)
+      auto modelDep = this->dependency (0);
+      auto & model = static_cast<ConfiguredModel &> (*modelDep);
+      auto buildFWithNewModel = [this, &c](NodeRef && newModel) {
+        return Self::create (c, {std::move (newModel)}, targetDimension_);
+      };
+      NodeRefVec derivativeSumDeps = generateModelDerivativeSumDepsForModelComputations<T> (
+        c, model, node, targetDimension_, buildFWithNewModel);
+      return CWiseAdd<T, ReductionOf<T>>::create (c, std::move (derivativeSumDeps), targetDimension_);
+    }
+
+    NodeRef GeneratorFromModel::recreate (Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), targetDimension_);
+    }
+
+    void GeneratorFromModel::compute () {
+      const auto * model =
+        dynamic_cast<const SubstitutionModel *> (accessValueConstCast<const TransitionModel *> (*this->dependency (0)));
+      if (model == nullptr) {
+        throw Exception ("GeneratorFromModel: model is not a SubstitutionModel");
+      }
+      auto & r = this->accessValueMutable ();
+      const auto lock = lockModel (this->dependency (0));
+      copyBppToEigen (model->getGenerator (), r);
+      r *= model->getRate ();
+    }
+
+    // GenericTransitionMatrixFromModelGeneratorDerivative
+
+    /* Van Loan (1978): the upper right block of exp(t [[G, dG], [0, G]]) is the derivative of exp(t G) along dG.
+     * The exponential uses scaling and squaring, with a Taylor expansion for the scaled matrix.
+     */
+    static Eigen::MatrixXd expDirectionalDerivative (const Eigen::MatrixXd & g, const Eigen::MatrixXd & dg,
+                                                     double t) {
+      const auto n = g.rows ();
+      Eigen::MatrixXd m = Eigen::MatrixXd::Zero (2 * n, 2 * n);
+      m.topLeftCorner (n, n) = t * g;
+      m.topRightCorner (n, n) = t * dg;
+      m.bottomRightCorner (n, n) = t * g;
+      // Scale m so that its norm is below 1/2 : 12 Taylor terms are then enough for double precision.
+      const double norm = m.cwiseAbs ().rowwise ().sum ().maxCoeff ();
+      int nbSquaring = 0;
+      while (norm > 0.5 * std::ldexp (1., nbSquaring)) {
+        ++nbSquaring;
+      }
+      m /= std::ldexp (1., nbSquaring);
+      Eigen::MatrixXd result = Eigen::MatrixXd::Identity (2 * n, 2 * n);
+      Eigen::MatrixXd term = Eigen::MatrixXd::Identity (2 * n, 2 * n);
+      for (int k = 1; k <= 12; ++k) {
+        term = (term * m) / static_cast<double> (k);
+        result += term;
+      }
+      for (int i = 0; i < nbSquaring; ++i) {
+        result = result * result;
+      }
+      return result.topRightCorner (n, n);
+    }
+
+    template <typename T>
+    ValueRef<T> GenericTransitionMatrixFromModelGeneratorDerivative<T>::create (Context & c, NodeRefVec && deps,
+                                                                                const Dimension<T> & dim) {
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyVectorSize (typeid (Self), deps, 3);
+      checkNthDependencyIs<ConfiguredModel> (typeid (Self), deps, 0);
+      checkNthDependencyIsValue<double> (typeid (Self), deps, 1);
+      checkNthDependencyIsValue<Eigen::MatrixXd> (typeid (Self), deps, 2);
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
+    }
+
+    template <typename T>
+    GenericTransitionMatrixFromModelGeneratorDerivative<T>::GenericTransitionMatrixFromModelGeneratorDerivative (
+      NodeRefVec && deps, const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), targetDimension_ (dim) {}
+
+    template <typename T>
+    std::string GenericTransitionMatrixFromModelGeneratorDerivative<T>::debugInfo () const {
+      using namespace numeric;
+      return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+    }
+
+    // GenericTransitionMatrixFromModelGeneratorDerivative additional arguments = ().
+    template <typename T>
+    bool
+    GenericTransitionMatrixFromModelGeneratorDerivative<T>::compareAdditionalArguments (const Node & other) const {
+      return dynamic_cast<const Self *> (&other) != nullptr;
+    }
+
+    template <typename T>
+    NodeRef GenericTransitionMatrixFromModelGeneratorDerivative<T>::derive (Context & c, const Node & node) {
+      // d(dtm)/dn = sum_i d(dtm)/dx_i * dx_i/dn + d(dtm)/dbrlen * dbrlen/dn + dtm(d(dgenerator)/dn).
+      auto modelDep = this->dependency (0);
+      auto brlenDep = this->dependency (1);
+      auto dgeneratorDep = this->dependency (2);
+      // Model part: eigen system changes, numerical.
+      auto & model = static_cast<ConfiguredModel &> (*modelDep);
+      auto buildFWithNewModel = [this, &c, &brlenDep, &dgeneratorDep](NodeRef && newModel) {
+        return Self::create (c, {std::move (newModel), brlenDep, dgeneratorDep}, targetDimension_);
+      };
+      NodeRefVec derivativeSumDeps = generateModelDerivativeSumDepsForModelComputations<T> (
+        c, model, node, targetDimension_, buildFWithNewModel);
+      // Brlen part: numerical.
+      auto dbrlen_dn = brlenDep->derive (c, node);
+      if (!dbrlen_dn->hasNumericalProperty (NumericalProperty::ConstantZero)) {
+        auto buildFWithNewBrlen = [this, &c, &modelDep, &dgeneratorDep](ValueRef<double> newBrlen) {
+          return Self::create (c, {modelDep, std::move (newBrlen), dgeneratorDep}, targetDimension_);
+        };
+        auto df_dbrlen = generateNumericalDerivative<T, double> (
+          c, model.config, brlenDep, Dimension<double> (), targetDimension_, buildFWithNewBrlen);
+        derivativeSumDeps.emplace_back (CWiseMul<T, std::tuple<double, T>>::create (
+          c, {std::move (dbrlen_dn), std::move (df_dbrlen)}, targetDimension_));
+      }
+      // Generator derivative part: linear.
+      auto ddgenerator_dn = dgeneratorDep->derive (c, node);
+      if (!ddgenerator_dn->hasNumericalProperty (NumericalProperty::ConstantZero)) {
+        derivativeSumDeps.emplace_back (
+          Self::create (c, {modelDep, brlenDep, std::move (ddgenerator_dn)}, targetDimension_));
+      }
+      return CWiseAdd<T, ReductionOf<T>>::create (c, std::move (derivativeSumDeps), targetDimension_);
+    }
+
+    template <typename T>
+    NodeRef GenericTransitionMatrixFromModelGeneratorDerivative<T>::recreate (Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), targetDimension_);
+    }
+
+    template <typename T>
+    void GenericTransitionMatrixFromModelGeneratorDerivative<T>::compute () {
+      const auto * model =
+        dynamic_cast<const SubstitutionModel *> (accessValueConstCast<const TransitionModel *> (*this->dependency (0)));
+      if (model == nullptr) {
+        throw Exception ("TransitionMatrixFromModelGeneratorDerivative: model is not a SubstitutionModel");
+      }
+      const auto brlen = accessValueConstCast<double> (*this->dependency (1));
+      const auto & dgenerator = accessValueConstCast<Eigen::MatrixXd> (*this->dependency (2));
+      auto & r = this->accessValueMutable ();
+      const auto lock = lockModel (this->dependency (0));
+      const auto rate = model->getRate ();
+      if (model->isDiagonalizable () && model->isNonSingular ()) {
+        // G = rate * Q = V diag(mu) U, mu = rate * eigenValues.
+        Eigen::MatrixXd v;
+        Eigen::MatrixXd u;
+        copyBppToEigen (model->getColumnRightEigenVectors (), v);
+        copyBppToEigen (model->getRowLeftEigenVectors (), u);
+        const auto & eigenValues = model->getEigenValues ();
+        const auto n = static_cast<Eigen::Index> (eigenValues.size ());
+        Eigen::VectorXd mu (n);
+        Eigen::VectorXd expMu (n);
+        for (Eigen::Index i = 0; i < n; ++i) {
+          mu (i) = rate * eigenValues[static_cast<std::size_t> (i)];
+          expMu (i) = std::exp (mu (i) * brlen);
+        }
+        Eigen::MatrixXd a = u * dgenerator * v;
+        for (Eigen::Index j = 0; j < n; ++j) {
+          for (Eigen::Index i = 0; i < n; ++i) {
+            const double delta = mu (i) - mu (j);
+            if (std::abs (delta * brlen) < 1e-8) {
+              // Limit of the divided difference, avoids cancellation for close eigen values.
+              a (i, j) *= brlen * std::exp ((mu (i) + mu (j)) * brlen / 2.);
+            } else {
+              a (i, j) *= (expMu (i) - expMu (j)) / delta;
+            }
+          }
+        }
+        r = v * a * u;
+      } else {
+        Eigen::MatrixXd generator;
+        copyBppToEigen (model->getGenerator (), generator);
+        generator *= rate;
+        r = expDirectionalDerivative (generator, dgenerator, brlen);
+      }
+    }
+
+    // Precompiled instantiations: dynamic and fixed numbers of states.
+    template class GenericTransitionMatrixFromModel<Eigen::MatrixXd>;
+    template class GenericTransitionMatrixFromModel<FixedTransitionMatrix<4>>;
+    template class GenericTransitionMatrixFromModel<FixedTransitionMatrix<20>>;
+    template class GenericTransitionMatrixFromModel<FixedTransitionMatrix<61>>;
+    template class GenericTransitionMatrixFromModelFirstBrlenDerivative<Eigen::MatrixXd>;
+    template class GenericTransitionMatrixFromModelFirstBrlenDerivative<FixedTransitionMatrix<4>>;
+    template class GenericTransitionMatrixFromModelFirstBrlenDerivative<FixedTransitionMatrix<20>>;
+    template class GenericTransitionMatrixFromModelFirstBrlenDerivative<FixedTransitionMatrix<61>>;
+    template class GenericTransitionMatrixFromModelSecondBrlenDerivative<Eigen::MatrixXd>;
+    template class GenericTransitionMatrixFromModelSecondBrlenDerivative<FixedTransitionMatrix<4>>;
+    template class GenericTransitionMatrixFromModelSecondBrlenDerivative<FixedTransitionMatrix<20>>;
+    template class GenericTransitionMatrixFromModelSecondBrlenDerivative<FixedTransitionMatrix<61>>;
+    template class GenericTransitionMatrixFromModelGeneratorDerivative<Eigen::MatrixXd>;
+    template class GenericTransitionMatrixFromModelGeneratorDerivative<FixedTransitionMatrix<4>>;
+    template class GenericTransitionMatrixFromModelGeneratorDerivative<FixedTransitionMatrix<20>>;
+    template class GenericTransitionMatrixFromModelGeneratorDerivative<FixedTransitionMatrix<61>>;
+
+    // Helper: hash of constant class values (rates, weights).
+    static std::size_t hashClassValues (const std::vector<double> & values) {
+      std::size_t seed = values.size ();
+      for (auto v : values)
+        combineHash (seed, v);
+      return seed;
+    }
+
+    // ClassTransitionMatricesFromModel
+
+    ValueRef<Eigen::MatrixXd> ClassTransitionMatricesFromModel::create (Context & c, NodeRefVec && deps,
+                                                                       const std::vector<double> & rates,
+                                                                       int derivativeOrder,
+                                                                       const Dimension<T> & dim) {
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyVectorSize (typeid (Self), deps, 2);
+      checkNthDependencyIs<ConfiguredModel> (typeid (Self), deps, 0);
+      checkNthDependencyIsValue<double> (typeid (Self), deps, 1);
+      if (rates.empty () || dim.rows != Eigen::Index (rates.size ()) * dim.cols) {
+        throw Exception ("ClassTransitionMatricesFromModel: dimension does not match the number of classes");
+      }
+      if (derivativeOrder < 0 || derivativeOrder > 2) {
+        throw Exception ("ClassTransitionMatricesFromModel: unsupported derivative order " +
+                         std::to_string (derivativeOrder));
+      }
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), rates, derivativeOrder, dim));
+    }
+
+    ClassTransitionMatricesFromModel::ClassTransitionMatricesFromModel (NodeRefVec && deps,
+                                                                        const std::vector<double> & rates,
+                                                                        int derivativeOrder, const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), rates_ (rates), derivativeOrder_ (derivativeOrder), targetDimension_ (dim) {}
+
+    std::string ClassTransitionMatricesFromModel::debugInfo () const {
+      using namespace numeric;
+      return debug (this->accessValueConst ()) + " nbClass=" + std::to_string (rates_.size ()) +
+             " derivativeOrder=" + std::to_string (derivativeOrder_) + " targetDim=" + to_string (targetDimension_);
+    }
+
+    // ClassTransitionMatricesFromModel additional arguments = (rates, derivativeOrder).
+    bool ClassTransitionMatricesFromModel::compareAdditionalArguments (const Node & other) const {
+      const auto * derived = dynamic_cast<const Self *> (&other);
+      return derived != nullptr && derivativeOrder_ == derived->derivativeOrder_ && rates_ == derived->rates_;
+    }
+    std::size_t ClassTransitionMatricesFromModel::hashAdditionalArguments () const {
+      std::size_t seed = hashClassValues (rates_);
+      combineHash (seed, derivativeOrder_);
+      return seed;
+    }
+
+    NodeRef ClassTransitionMatricesFromModel::derive (Context & c, const Node & node) {
+      // dtm/dn = sum_i dtm/dx_i * dx_i/dn + dtm/dbrlen + dbrlen/dn (x_i = model parameters).
+      auto modelDep = this->dependency (0);
+      auto brlenDep = this->dependency (1);
+      // Model part
+      auto & model = static_cast<ConfiguredModel &> (*modelDep);
+      auto buildFWithNewModel = [this, &c, &brlenDep](NodeRef && newModel) {
+        return Self::create (c, {std::move (newModel), brlenDep}, rates_, derivativeOrder_, targetDimension_);
+      };
+      NodeRefVec derivativeSumDeps = generateModelDerivativeSumDepsForModelComputations<T> (
+        c, model, node, targetDimension_, buildFWithNewModel);
+      // Brlen part: next order node, or numerical derivation after the second order.
+      auto dbrlen_dn = brlenDep->derive (c, node);
+      if (!dbrlen_dn->hasNumericalProperty (NumericalProperty::ConstantZero)) {
+        ValueRef<T> df_dbrlen;
+        if (derivativeOrder_ < 2) {
+          df_dbrlen = Self::create (c, {modelDep, brlenDep}, rates_, derivativeOrder_ + 1, targetDimension_);
+        } else {
+          auto buildFWithNewBrlen = [this, &c, &modelDep](ValueRef<double> newBrlen) {
+            return Self::create (c, {modelDep, std::move (newBrlen)}, rates_, derivativeOrder_, targetDimension_);
+          };
+          df_dbrlen = generateNumericalDerivative<T, double> (c, model.config, brlenDep, Dimension<double> (),
+                                                              targetDimension_, buildFWithNewBrlen);
+        }
+        derivativeSumDeps.emplace_back (CWiseMul<T, std::tuple<double, T>>::create (
+          c, {std::move (dbrlen_dn), std::move (df_dbrlen)}, targetDimension_));
+      }
+      return CWiseAdd<T, ReductionOf<T>>::create (c, std::move (derivativeSumDeps), targetDimension_);
+    }
+
+    NodeRef ClassTransitionMatricesFromModel::recreate (Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), rates_, derivativeOrder_, targetDimension_);
+    }
+
+    void ClassTransitionMatricesFromModel::compute () {
+      const auto * model = accessValueConstCast<const TransitionModel *> (*this->dependency (0));
+      const auto brlen = accessValueConstCast<double> (*this->dependency (1));
+      auto & r = this->accessValueMutable ();
+      r.resize (targetDimension_.rows, targetDimension_.cols);
+      const auto nbState = targetDimension_.cols;
+      const auto lock = lockModel (this->dependency (0));
+      for (std::size_t k = 0; k < rates_.size (); ++k) {
+        const double rate = rates_[k];
+        const double t = rate * brlen;
+        const auto & pij = derivativeOrder_ == 0 ? model->getPij_t (t)
+                                                 : derivativeOrder_ == 1 ? model->getdPij_dt (t) : model->getd2Pij_dt2 (t);
+        const double factor = derivativeOrder_ == 0 ? 1. : derivativeOrder_ == 1 ? rate : rate * rate;
+        const auto firstRow = Eigen::Index (k) * nbState;
+        for (Eigen::Index i = 0; i < nbState; ++i) {
+          for (Eigen::Index j = 0; j < nbState; ++j) {
+            r (firstRow + i, j) = factor * pij (static_cast<std::size_t> (i), static_cast<std::size_t> (j));
+          }
+        }
+      }
+    }
+
+    // ClassForwardLikelihoodFromConditional
+
+    ValueRef<Eigen::MatrixXd> ClassForwardLikelihoodFromConditional::create (Context & c, NodeRefVec && deps,
+                                                                            const Dimension<T> & dim) {
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyVectorSize (typeid (Self), deps, 2);
+      checkDependencyRangeIsValue<T> (typeid (Self), deps, 0, 2);
+      // Class blocks of a zero conditional likelihood or zero matrices give a zero product.
+      if (deps[0]->hasNumericalProperty (NumericalProperty::ConstantZero) ||
+          deps[1]->hasNumericalProperty (NumericalProperty::ConstantZero)) {
+        return ConstantZero<T>::create (c, dim);
+      }
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), dim));
+    }
+
+    ClassForwardLikelihoodFromConditional::ClassForwardLikelihoodFromConditional (NodeRefVec && deps,
+                                                                                  const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), targetDimension_ (dim) {}
+
+    std::string ClassForwardLikelihoodFromConditional::debugInfo () const {
+      using namespace numeric;
+      return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_);
+    }
+
+    // ClassForwardLikelihoodFromConditional additional arguments = ().
+    bool ClassForwardLikelihoodFromConditional::compareAdditionalArguments (const Node & other) const {
+      return dynamic_cast<const Self *> (&other) != nullptr;
+    }
+    std::size_t ClassForwardLikelihoodFromConditional::hashAdditionalArguments () const {
+      using namespace numeric;
+      return hash (targetDimension_);
+    }
+
+    NodeRef ClassForwardLikelihoodFromConditional::derive (Context & c, const Node & node) {
+      // Bilinear: d(f(tm, c)) = f(dtm, c) + f(tm, dc).
+      auto tmDep = this->dependency (0);
+      auto condDep = this->dependency (1);
+      NodeRefVec derivativeSumDeps;
+      auto dtm = tmDep->derive (c, node);
+      if (!dtm->hasNumericalProperty (NumericalProperty::ConstantZero)) {
+        derivativeSumDeps.emplace_back (Self::create (c, {std::move (dtm), condDep}, targetDimension_));
+      }
+      auto dcond = condDep->derive (c, node);
+      if (!dcond->hasNumericalProperty (NumericalProperty::ConstantZero)) {
+        derivativeSumDeps.emplace_back (Self::create (c, {tmDep, std::move (dcond)}, targetDimension_));
+      }
+      return CWiseAdd<T, ReductionOf<T>>::create (c, std::move (derivativeSumDeps), targetDimension_);
+    }
+
+    NodeRef ClassForwardLikelihoodFromConditional::recreate (Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), targetDimension_);
+    }
+
+    void ClassForwardLikelihoodFromConditional::compute () {
+      const auto & tm = accessValueConstCast<T> (*this->dependency (0));
+      const auto & cond = accessValueConstCast<T> (*this->dependency (1));
+      auto & r = this->accessValueMutable ();
+      r.resize (targetDimension_.rows, targetDimension_.cols);
+      const auto nbState = tm.cols ();
+      for (Eigen::Index firstRow = 0; firstRow < tm.rows (); firstRow += nbState) {
+        r.middleRows (firstRow, nbState).noalias () =
+          tm.middleRows (firstRow, nbState).transpose () * cond.middleRows (firstRow, nbState);
+      }
+    }
+
+    // ClassWeightedFrequencies
+
+    ValueRef<Eigen::RowVectorXd> ClassWeightedFrequencies::create (Context & c, NodeRefVec && deps,
+                                                                  const std::vector<double> & weights,
+                                                                  const Dimension<T> & dim) {
+      checkDependenciesNotNull (typeid (Self), deps);
+      checkDependencyVectorSize (typeid (Self), deps, 1);
+      checkNthDependencyIsValue<T> (typeid (Self), deps, 0);
+      if (weights.empty () || dim.cols % Eigen::Index (weights.size ()) != 0) {
+        throw Exception ("ClassWeightedFrequencies: dimension does not match the number of classes");
+      }
+      if (deps[0]->hasNumericalProperty (NumericalProperty::ConstantZero)) {
+        return ConstantZero<T>::create (c, dim);
+      }
+      return cachedAs<Value<T>> (c, makeNode<Self> (c, std::move (deps), weights, dim));
+    }
+
+    ClassWeightedFrequencies::ClassWeightedFrequencies (NodeRefVec && deps, const std::vector<double> & weights,
+                                                        const Dimension<T> & dim)
+      : Value<T> (std::move (deps)), weights_ (weights), targetDimension_ (dim) {}
+
+    std::string ClassWeightedFrequencies::debugInfo () const {
+      using namespace numeric;
+      return debug (this->accessValueConst ()) + " nbClass=" + std::to_string (weights_.size ()) +
+             " targetDim=" + to_string (targetDimension_);
+    }
+
+    // ClassWeightedFrequencies additional arguments = (weights).
+    bool ClassWeightedFrequencies::compareAdditionalArguments (const Node & other) const {
+      const auto * derived = dynamic_cast<const Self *> (&other);
+      return derived != nullptr && weights_ == derived->weights_;
+    }
+    std::size_t ClassWeightedFrequencies::hashAdditionalArguments () const { return hashClassValues (weights_); }
+
+    NodeRef ClassWeightedFrequencies::derive (Context & c, const Node & node) {
+      // Linear in the frequencies.
+      return Self::create (c, {this->dependency (0)->derive (c, node)}, weights_, targetDimension_);
+    }
+
+    NodeRef ClassWeightedFrequencies::recreate (Context & c, NodeRefVec && deps) {
+      return Self::create (c, std::move (deps), weights_, targetDimension_);
+    }
+
+    void ClassWeightedFrequencies::compute () {
+      const auto & freqs = accessValueConstCast<T> (*this->dependency (0));
+      auto & r = this->accessValueMutable ();
+      r.resize (targetDimension_.cols);
+      const auto nbState = freqs.size ();
+      for (std::size_t k = 0; k < weights_.size (); ++k) {
+        r.segment (Eigen::Index (k) * nbState, nbState) = weights_[k] * freqs;
+      }
+    }
   } // namespace dataflow
 } // namespace bpp
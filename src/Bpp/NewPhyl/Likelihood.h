@@ -44,9 +44,12 @@
 #define BPP_NEWPHYL_LIKELIHOOD_H
 
 #include <Bpp/NewPhyl/DataFlow.h>
+#include <Bpp/NewPhyl/DataFlowExtendedFloat.h>
 #include <Bpp/NewPhyl/DataFlowNumeric.h>
 #include <functional>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace bpp {
   /** Conditional likelihoods are stored in a matrix of sizes (nbState, nbSite).
@@ -98,6 +101,19 @@ namespace bpp {
     using ForwardLikelihoodFromConditional =
       MatrixProduct<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>;
 
+    /** @brief conditionalLikelihood = f(transitionMatrix[children[i]], conditionalLikelihood[children[i]] for i).
+     * - conditionalLikelihood: Matrix(state, site).
+     * - transitionMatrix[i]: Matrix(fromState, toState).
+     * - conditionalLikelihood[i]: Matrix(state, site).
+     * - Order of dependencies: (transitionMatrix[0], conditionalLikelihood[0], transitionMatrix[1], ...).
+     *
+     * c = prod_member_i (transposed(transitionMatrix_i) * c_i): ConditionalLikelihoodFromChildrenForward of the
+     * ForwardLikelihoodFromConditional nodes, computed by blocks of sites without storing forward likelihoods.
+     * To use when forward likelihoods are not needed by other nodes.
+     */
+    using ConditionalLikelihoodFromChildrenTransitions =
+      CWiseMulOfMatrixProducts<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>;
+
     /** @brief likelihood = f(equilibriumFrequencies, rootConditionalLikelihood).
      * - likelihood: RowVector(site).
      * - equilibriumFrequencies: RowVector(state).
@@ -114,6 +130,72 @@ namespace bpp {
      * - totalLogLikelihood: double.
      */
     using TotalLogLikelihood = SumOfLogarithms<Eigen::RowVectorXd>;
+
+    /** @brief totalLogLikelihood = sum_pattern weight(pattern) * log(likelihood(pattern)).
+     * - likelihood: RowVector (site pattern).
+     * - weight: RowVector (site pattern), number of sites with this pattern.
+     * - totalLogLikelihood: double.
+     */
+    using WeightedTotalLogLikelihood = WeightedSumOfLogarithms<Eigen::RowVectorXd>;
+
+    /* ExtendedFloat variants of the likelihood nodes.
+     * Conditional and forward likelihoods are ExtendedFloatMatrix(state, site), with one exponent by site.
+     * Likelihood is an ExtendedFloatMatrix with one row.
+     * They do not underflow on big trees, but do not support derivation.
+     */
+    using ExtendedFloatConditionalLikelihoodFromChildrenForward =
+      CWiseMul<ExtendedFloatMatrix, ReductionOf<ExtendedFloatMatrix>>;
+    using ExtendedFloatForwardLikelihoodFromConditional =
+      MatrixProduct<ExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, ExtendedFloatMatrix>;
+    using ExtendedFloatConditionalLikelihoodFromChildrenTransitions =
+      CWiseMulOfMatrixProducts<ExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, ExtendedFloatMatrix>;
+    using ExtendedFloatLikelihoodFromRootConditional =
+      MatrixProduct<ExtendedFloatMatrix, Eigen::RowVectorXd, ExtendedFloatMatrix>;
+    using ExtendedFloatTotalLogLikelihood = SumOfLogarithms<ExtendedFloatMatrix>;
+    using ExtendedFloatWeightedTotalLogLikelihood = WeightedSumOfLogarithms<ExtendedFloatMatrix>;
+
+    /* Single precision variants of the ExtendedFloat likelihood nodes.
+     * Conditional and forward likelihoods are SingleExtendedFloatMatrix(state, site): float parts halve the
+     * memory and bandwidth used by likelihood matrices, and Eigen packs twice as many values in SIMD registers.
+     * Exponents prevent underflow as for ExtendedFloatMatrix.
+     * Transition matrices and equilibrium frequencies stay double, and log likelihoods are summed in double.
+     * The relative error of likelihoods is then bounded by a small multiple of nbState * depth * 6e-8 (float
+     * unit roundoff), which is enough for tree search but not for the last digits of optimized likelihoods.
+     */
+    using SingleExtendedFloatConditionalLikelihoodFromChildrenForward =
+      CWiseMul<SingleExtendedFloatMatrix, ReductionOf<SingleExtendedFloatMatrix>>;
+    using SingleExtendedFloatForwardLikelihoodFromConditional =
+      MatrixProduct<SingleExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, SingleExtendedFloatMatrix>;
+    using SingleExtendedFloatConditionalLikelihoodFromChildrenTransitions =
+      CWiseMulOfMatrixProducts<SingleExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, SingleExtendedFloatMatrix>;
+    using SingleExtendedFloatLikelihoodFromRootConditional =
+      MatrixProduct<SingleExtendedFloatMatrix, Eigen::RowVectorXd, SingleExtendedFloatMatrix>;
+    using SingleExtendedFloatTotalLogLikelihood = SumOfLogarithms<SingleExtendedFloatMatrix>;
+    using SingleExtendedFloatWeightedTotalLogLikelihood = WeightedSumOfLogarithms<SingleExtendedFloatMatrix>;
+
+    /* Fixed number of states variants of the likelihood nodes.
+     * The state dimension is a compile time constant, which lets Eigen unroll and vectorize the kernels.
+     * Transition matrices are fully fixed size, conditional likelihoods have a dynamic number of sites.
+     * Using Eigen::Dynamic as NbState gives the default dynamic types.
+     * Node classes are precompiled for 4 (nucleotides), 20 (proteins) and 61 (codons) states.
+     */
+    template <int NbState> using FixedTransitionMatrix = Eigen::Matrix<double, NbState, NbState>;
+    template <int NbState> using FixedConditionalLikelihood = Eigen::Matrix<double, NbState, Eigen::Dynamic>;
+
+    template <int NbState>
+    using FixedConditionalLikelihoodFromChildrenForward =
+      CWiseMul<FixedConditionalLikelihood<NbState>, ReductionOf<FixedConditionalLikelihood<NbState>>>;
+    template <int NbState>
+    using FixedForwardLikelihoodFromConditional =
+      MatrixProduct<FixedConditionalLikelihood<NbState>, Transposed<FixedTransitionMatrix<NbState>>,
+                    FixedConditionalLikelihood<NbState>>;
+    template <int NbState>
+    using FixedConditionalLikelihoodFromChildrenTransitions =
+      CWiseMulOfMatrixProducts<FixedConditionalLikelihood<NbState>, Transposed<FixedTransitionMatrix<NbState>>,
+                               FixedConditionalLikelihood<NbState>>;
+    template <int NbState>
+    using FixedLikelihoodFromRootConditional =
+      MatrixProduct<Eigen::RowVectorXd, Eigen::RowVectorXd, FixedConditionalLikelihood<NbState>>;
   } // namespace dataflow
 
   /* Likelihood transition model.
@@ -147,6 +229,10 @@ namespace bpp {
      * transition matrices and their derivatives.
      *
      * The dummy value is implemented as a pointer to the internal model for simplicity.
+     *
+     * bpp::TransitionModel computations (getPij_t, ...) use internal buffers and are not thread safe.
+     * Nodes using the model in their compute() must hold modelMutex() while doing so.
+     * This allows graphs to be evaluated by a ParallelExecutor.
      */
     class ConfiguredModel : public Value<const TransitionModel *> {
     public:
@@ -179,10 +265,14 @@ namespace bpp {
 
       NodeRef recreate (Context & c, NodeRefVec && deps) final;
 
+      /// Mutex serializing accesses to the internal bpp::TransitionModel during computations.
+      std::mutex & modelMutex () noexcept { return modelMutex_; }
+
     private:
       void compute () final;
 
       std::unique_ptr<TransitionModel> model_;
+      std::mutex modelMutex_;
     };
 
     /** @brief equilibriumFrequencies = f(model).
@@ -218,16 +308,23 @@ namespace bpp {
      * - model: ConfiguredModel.
      * - branchLen: double.
      *
+     * T is the matrix type: Eigen::MatrixXd, or FixedTransitionMatrix<nbState> for common state counts.
      * Node construction should be done with the create static method.
+     *
+     * Derivatives by branchLen use the analytical dPij/dt and d2Pij/dt2 of the model (derivative nodes below).
+     * Thus branch length optimization does not require numerical derivation, which is only used for model
+     * parameters (see ConfiguredModel::config) and for third order brlen derivatives.
+     * For a bpp::SubstitutionModel, derivatives by model parameters are computed from the derivative of the
+     * generator and the eigen system (TransitionMatrixFromModelGeneratorDerivative): only the generator is
+     * derived numerically, not each transition matrix.
      */
-    class TransitionMatrixFromModel : public Value<Eigen::MatrixXd> {
+    template <typename T> class GenericTransitionMatrixFromModel : public Value<T> {
     public:
-      using Self = TransitionMatrixFromModel;
-      using T = Eigen::MatrixXd;
+      using Self = GenericTransitionMatrixFromModel;
 
       /// Build a new TransitionMatrixFromModel node with the given output dimensions.
       static ValueRef<T> create (Context & c, NodeRefVec && deps, const Dimension<T> & dim);
-      TransitionMatrixFromModel (NodeRefVec && deps, const Dimension<T> & dim);
+      GenericTransitionMatrixFromModel (NodeRefVec && deps, const Dimension<T> & dim);
 
       std::string debugInfo () const final;
 
@@ -249,14 +346,13 @@ namespace bpp {
      *
      * Node construction should be done with the create static method.
      */
-    class TransitionMatrixFromModelFirstBrlenDerivative : public Value<Eigen::MatrixXd> {
+    template <typename T> class GenericTransitionMatrixFromModelFirstBrlenDerivative : public Value<T> {
     public:
-      using Self = TransitionMatrixFromModelFirstBrlenDerivative;
-      using T = Eigen::MatrixXd;
+      using Self = GenericTransitionMatrixFromModelFirstBrlenDerivative;
 
       /// Build a new TransitionMatrixFromModelFirstBrlenDerivative node with the given output dimensions.
       static ValueRef<T> create (Context & c, NodeRefVec && deps, const Dimension<T> & dim);
-      TransitionMatrixFromModelFirstBrlenDerivative (NodeRefVec && deps, const Dimension<T> & dim);
+      GenericTransitionMatrixFromModelFirstBrlenDerivative (NodeRefVec && deps, const Dimension<T> & dim);
 
       std::string debugInfo () const final;
 
@@ -278,14 +374,84 @@ namespace bpp {
      *
      * Node construction should be done with the create static method.
      */
-    class TransitionMatrixFromModelSecondBrlenDerivative : public Value<Eigen::MatrixXd> {
+    template <typename T> class GenericTransitionMatrixFromModelSecondBrlenDerivative : public Value<T> {
     public:
-      using Self = TransitionMatrixFromModelSecondBrlenDerivative;
-      using T = Eigen::MatrixXd;
+      using Self = GenericTransitionMatrixFromModelSecondBrlenDerivative;
 
       /// Build a new TransitionMatrixFromModelSecondBrlenDerivative node with the given output dimensions.
       static ValueRef<T> create (Context & c, NodeRefVec && deps, const Dimension<T> & dim);
-      TransitionMatrixFromModelSecondBrlenDerivative (NodeRefVec && deps, const Dimension<T> & dim);
+      GenericTransitionMatrixFromModelSecondBrlenDerivative (NodeRefVec && deps, const Dimension<T> & dim);
+
+      std::string debugInfo () const final;
+
+      bool compareAdditionalArguments (const Node & other) const final;
+
+      NodeRef derive (Context & c, const Node & node) final;
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+    private:
+      void compute () final;
+
+      Dimension<T> targetDimension_;
+    };
+
+    /** @brief generator = f(model).
+     * - generator: Matrix(fromState, toState), rate * Q for a bpp::SubstitutionModel.
+     * - model: ConfiguredModel, the wrapped model must be a bpp::SubstitutionModel.
+     *
+     * Transition matrices are exp(branchLen * generator).
+     * bpp models do not provide dQ/dx, so derivatives by model parameters are numerical.
+     * The shifted models are shared by all branches: the cost of a model update is paid once per shift, and
+     * derivatives of transition matrices are then analytical (TransitionMatrixFromModelGeneratorDerivative).
+     *
+     * Node construction should be done with the create static method.
+     */
+    class GeneratorFromModel : public Value<Eigen::MatrixXd> {
+    public:
+      using Self = GeneratorFromModel;
+      using T = Eigen::MatrixXd;
+
+      /// Build a new GeneratorFromModel node with the given output dimensions.
+      static ValueRef<T> create (Context & c, NodeRefVec && deps, const Dimension<T> & dim);
+      GeneratorFromModel (NodeRefVec && deps, const Dimension<T> & dim);
+
+      std::string debugInfo () const final;
+
+      bool compareAdditionalArguments (const Node & other) const final;
+
+      NodeRef derive (Context & c, const Node & node) final;
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+    private:
+      void compute () final;
+
+      Dimension<T> targetDimension_;
+    };
+
+    /** @brief dtransitionMatrix = f(model, branchLen, dgenerator).
+     * - dtransitionMatrix: Matrix(fromState, toState), derivative of P = exp(branchLen * G).
+     * - model: ConfiguredModel, the wrapped model must be a bpp::SubstitutionModel.
+     * - branchLen: double.
+     * - dgenerator: Matrix(fromState, toState), derivative of G (GeneratorFromModel) by the same variable.
+     *
+     * dP = integral_0^t exp(s G) dG exp((t - s) G) ds, with t = branchLen.
+     * Using the eigen system of the model G = V diag(mu) U, with U = V^-1:
+     * dP = V (F o (U dG V)) U, with F_ij = (exp(mu_i t) - exp(mu_j t)) / (mu_i - mu_j), or t exp(mu_i t) if mu_i = mu_j.
+     * The eigen system is the one already computed by the model: no additional diagonalisation.
+     * If the model is not diagonalizable in R, exp(t [[G, dG], [0, G]]) is computed instead (Van Loan):
+     * its upper right block is dP.
+     *
+     * dP is linear in dgenerator, which gives model parameter derivatives of TransitionMatrixFromModel.
+     *
+     * Node construction should be done with the create static method.
+     */
+    template <typename T> class GenericTransitionMatrixFromModelGeneratorDerivative : public Value<T> {
+    public:
+      using Self = GenericTransitionMatrixFromModelGeneratorDerivative;
+
+      /// Build a new TransitionMatrixFromModelGeneratorDerivative node with the given output dimensions.
+      static ValueRef<T> create (Context & c, NodeRefVec && deps, const Dimension<T> & dim);
+      GenericTransitionMatrixFromModelGeneratorDerivative (NodeRefVec && deps, const Dimension<T> & dim);
 
       std::string debugInfo () const final;
 
@@ -299,6 +465,150 @@ namespace bpp {
 
       Dimension<T> targetDimension_;
     };
+
+    using TransitionMatrixFromModel = GenericTransitionMatrixFromModel<Eigen::MatrixXd>;
+    using TransitionMatrixFromModelFirstBrlenDerivative =
+      GenericTransitionMatrixFromModelFirstBrlenDerivative<Eigen::MatrixXd>;
+    using TransitionMatrixFromModelSecondBrlenDerivative =
+      GenericTransitionMatrixFromModelSecondBrlenDerivative<Eigen::MatrixXd>;
+    using TransitionMatrixFromModelGeneratorDerivative =
+      GenericTransitionMatrixFromModelGeneratorDerivative<Eigen::MatrixXd>;
+    template <int NbState>
+    using FixedTransitionMatrixFromModel = GenericTransitionMatrixFromModel<FixedTransitionMatrix<NbState>>;
+
+    extern template class GenericTransitionMatrixFromModel<Eigen::MatrixXd>;
+    extern template class GenericTransitionMatrixFromModel<FixedTransitionMatrix<4>>;
+    extern template class GenericTransitionMatrixFromModel<FixedTransitionMatrix<20>>;
+    extern template class GenericTransitionMatrixFromModel<FixedTransitionMatrix<61>>;
+    extern template class GenericTransitionMatrixFromModelFirstBrlenDerivative<Eigen::MatrixXd>;
+    extern template class GenericTransitionMatrixFromModelFirstBrlenDerivative<FixedTransitionMatrix<4>>;
+    extern template class GenericTransitionMatrixFromModelFirstBrlenDerivative<FixedTransitionMatrix<20>>;
+    extern template class GenericTransitionMatrixFromModelFirstBrlenDerivative<FixedTransitionMatrix<61>>;
+    extern template class GenericTransitionMatrixFromModelSecondBrlenDerivative<Eigen::MatrixXd>;
+    extern template class GenericTransitionMatrixFromModelSecondBrlenDerivative<FixedTransitionMatrix<4>>;
+    extern template class GenericTransitionMatrixFromModelSecondBrlenDerivative<FixedTransitionMatrix<20>>;
+    extern template class GenericTransitionMatrixFromModelSecondBrlenDerivative<FixedTransitionMatrix<61>>;
+    extern template class GenericTransitionMatrixFromModelGeneratorDerivative<Eigen::MatrixXd>;
+    extern template class GenericTransitionMatrixFromModelGeneratorDerivative<FixedTransitionMatrix<4>>;
+    extern template class GenericTransitionMatrixFromModelGeneratorDerivative<FixedTransitionMatrix<20>>;
+    extern template class GenericTransitionMatrixFromModelGeneratorDerivative<FixedTransitionMatrix<61>>;
+
+    /* Rate classes (+G) share the graph structure: values of all classes are stacked in one matrix.
+     * A class stacked matrix has nbClass blocks of nbState rows, block k for class k:
+     * conditional and forward likelihoods are Matrix(class * nbState + state, site).
+     * Conditional likelihoods of children are still multiplied with ConditionalLikelihoodFromChildrenForward.
+     */
+
+    /** @brief transitionMatrices = f(model, branchLen), for rate classes.
+     * - transitionMatrices: Matrix(class * nbState + fromState, toState).
+     * - model: ConfiguredModel.
+     * - branchLen: double.
+     *
+     * Block k is P(rates[k] * branchLen), the transition matrix of class k.
+     * With derivativeOrder d (1 or 2), block k is the d-th derivative by branchLen:
+     * rates[k]^d * (d^d P/dt^d)(rates[k] * branchLen).
+     * Rates are constant, given at construction (categories of a bpp::DiscreteDistribution for instance).
+     * The matrices of all classes are computed by one node, under one lock of the model.
+     *
+     * Node construction should be done with the create static method.
+     */
+    class ClassTransitionMatricesFromModel : public Value<Eigen::MatrixXd> {
+    public:
+      using Self = ClassTransitionMatricesFromModel;
+      using T = Eigen::MatrixXd;
+
+      /// Build a new ClassTransitionMatricesFromModel node with the given output dimensions.
+      static ValueRef<T> create (Context & c, NodeRefVec && deps, const std::vector<double> & rates,
+                                 int derivativeOrder, const Dimension<T> & dim);
+      ClassTransitionMatricesFromModel (NodeRefVec && deps, const std::vector<double> & rates, int derivativeOrder,
+                                        const Dimension<T> & dim);
+
+      std::string debugInfo () const final;
+
+      bool compareAdditionalArguments (const Node & other) const final;
+      std::size_t hashAdditionalArguments () const final;
+
+      NodeRef derive (Context & c, const Node & node) final;
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+      const std::vector<double> & getRates () const noexcept { return rates_; }
+
+    private:
+      void compute () final;
+
+      std::vector<double> rates_;
+      int derivativeOrder_;
+      Dimension<T> targetDimension_;
+    };
+
+    /** @brief forwardLikelihood = f(transitionMatrices, conditionalLikelihood), for rate classes.
+     * - forwardLikelihood: Matrix(class * nbState + toState, site).
+     * - transitionMatrices: Matrix(class * nbState + fromState, toState).
+     * - conditionalLikelihood: Matrix(class * nbState + fromState, site).
+     *
+     * For each class block k: f_k = transposed(transitionMatrix_k) * c_k, as ForwardLikelihoodFromConditional.
+     * The number of classes is rows(transitionMatrices) / cols(transitionMatrices).
+     *
+     * Node construction should be done with the create static method.
+     */
+    class ClassForwardLikelihoodFromConditional : public Value<Eigen::MatrixXd> {
+    public:
+      using Self = ClassForwardLikelihoodFromConditional;
+      using T = Eigen::MatrixXd;
+
+      /// Build a new ClassForwardLikelihoodFromConditional node with the given output dimensions.
+      static ValueRef<T> create (Context & c, NodeRefVec && deps, const Dimension<T> & dim);
+      ClassForwardLikelihoodFromConditional (NodeRefVec && deps, const Dimension<T> & dim);
+
+      std::string debugInfo () const final;
+
+      bool compareAdditionalArguments (const Node & other) const final;
+      std::size_t hashAdditionalArguments () const final;
+
+      NodeRef derive (Context & c, const Node & node) final;
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+    private:
+      void compute () final;
+
+      Dimension<T> targetDimension_;
+    };
+
+    /** @brief classFrequencies = f(equilibriumFrequencies), for rate classes.
+     * - classFrequencies: RowVector(class * nbState + state).
+     * - equilibriumFrequencies: RowVector(state).
+     *
+     * classFrequencies(k * nbState + state) = weights[k] * equilibriumFrequencies(state).
+     * With weights the class probabilities, LikelihoodFromRootConditional gives the site likelihoods
+     * (sum over classes) from the class stacked root conditional likelihood.
+     * Weights are constant, given at construction.
+     *
+     * Node construction should be done with the create static method.
+     */
+    class ClassWeightedFrequencies : public Value<Eigen::RowVectorXd> {
+    public:
+      using Self = ClassWeightedFrequencies;
+      using T = Eigen::RowVectorXd;
+
+      /// Build a new ClassWeightedFrequencies node with the given output dimensions.
+      static ValueRef<T> create (Context & c, NodeRefVec && deps, const std::vector<double> & weights,
+                                 const Dimension<T> & dim);
+      ClassWeightedFrequencies (NodeRefVec && deps, const std::vector<double> & weights, const Dimension<T> & dim);
+
+      std::string debugInfo () const final;
+
+      bool compareAdditionalArguments (const Node & other) const final;
+      std::size_t hashAdditionalArguments () const final;
+
+      NodeRef derive (Context & c, const Node & node) final;
+      NodeRef recreate (Context & c, NodeRefVec && deps) final;
+
+    private:
+      void compute () final;
+
+      std::vector<double> weights_;
+      Dimension<T> targetDimension_;
+    };
   } // namespace dataflow
 } // namespace bpp
 
@@ -48,11 +48,27 @@
 #include <Bpp/Numeric/ParameterList.h>
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 
+#include "Bpp/NewPhyl/DataFlowParallel.h"
+#ifdef BPP_WITH_BEAGLE
+#include "Bpp/NewPhyl/DataFlowBeagle.h"
+#endif
 #include "Bpp/NewPhyl/Likelihood.h"
+#include "Bpp/Phyl/Io/BinarySiteBlockStream.h"
+#include "Bpp/Phyl/Io/BinaryTools.h"
 #include "Bpp/Phyl/Model/SubstitutionModel.h"
+#include "Bpp/Phyl/Tree/FlatTopology.h"
 #include "Bpp/Phyl/Tree/PhyloTree.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 /* This file contains temporary helpers and wrappers.
  * They are used to bridge the gap between bpp::dataflow stuff and the rest of bpp.
@@ -71,67 +87,192 @@ namespace bpp {
       branchLengthValues;
   };
 
+  /* Node types used to build the likelihood example graph.
+   * Double: conditional likelihoods are Eigen::MatrixXd, which underflows for big trees.
+   * FixedState: same as Double, but with a compile time number of states (Eigen::Dynamic gives Double).
+   * ExtendedFloat: conditional likelihoods are ExtendedFloatMatrix (one exponent per site), but derivation is
+   * not supported.
+   * SingleExtendedFloat: same as ExtendedFloat with float values, for big datasets limited by memory bandwidth.
+   */
+  template <int NbState> struct FixedStateLikelihoodNodeTypes {
+    using ConditionalLikelihood = dataflow::FixedConditionalLikelihood<NbState>;
+    using TransitionMatrixFromModel = dataflow::FixedTransitionMatrixFromModel<NbState>;
+    using ConditionalLikelihoodFromChildrenForward = dataflow::FixedConditionalLikelihoodFromChildrenForward<NbState>;
+    using ForwardLikelihoodFromConditional = dataflow::FixedForwardLikelihoodFromConditional<NbState>;
+    using ConditionalLikelihoodFromChildrenTransitions =
+      dataflow::FixedConditionalLikelihoodFromChildrenTransitions<NbState>;
+    using LikelihoodFromRootConditional = dataflow::FixedLikelihoodFromRootConditional<NbState>;
+    using WeightedTotalLogLikelihood = dataflow::WeightedTotalLogLikelihood;
+  };
+  using DoubleLikelihoodNodeTypes = FixedStateLikelihoodNodeTypes<Eigen::Dynamic>;
+  struct ExtendedFloatLikelihoodNodeTypes {
+    using ConditionalLikelihood = ExtendedFloatMatrix;
+    using TransitionMatrixFromModel = dataflow::TransitionMatrixFromModel;
+    using ConditionalLikelihoodFromChildrenForward = dataflow::ExtendedFloatConditionalLikelihoodFromChildrenForward;
+    using ForwardLikelihoodFromConditional = dataflow::ExtendedFloatForwardLikelihoodFromConditional;
+    using ConditionalLikelihoodFromChildrenTransitions =
+      dataflow::ExtendedFloatConditionalLikelihoodFromChildrenTransitions;
+    using LikelihoodFromRootConditional = dataflow::ExtendedFloatLikelihoodFromRootConditional;
+    using WeightedTotalLogLikelihood = dataflow::ExtendedFloatWeightedTotalLogLikelihood;
+  };
+  struct SingleExtendedFloatLikelihoodNodeTypes {
+    using ConditionalLikelihood = SingleExtendedFloatMatrix;
+    using TransitionMatrixFromModel = dataflow::TransitionMatrixFromModel;
+    using ConditionalLikelihoodFromChildrenForward =
+      dataflow::SingleExtendedFloatConditionalLikelihoodFromChildrenForward;
+    using ForwardLikelihoodFromConditional = dataflow::SingleExtendedFloatForwardLikelihoodFromConditional;
+    using ConditionalLikelihoodFromChildrenTransitions =
+      dataflow::SingleExtendedFloatConditionalLikelihoodFromChildrenTransitions;
+    using LikelihoodFromRootConditional = dataflow::SingleExtendedFloatLikelihoodFromRootConditional;
+    using WeightedTotalLogLikelihood = dataflow::SingleExtendedFloatWeightedTotalLogLikelihood;
+  };
+
+  /* Site patterns of an alignment: sites with the same states for all sequences are merged.
+   * sites[i] is the first site with pattern i, and weights[i] the number of sites with pattern i.
+   * Patterns are in order of first occurrence.
+   */
+  struct SitePatterns {
+    std::vector<std::size_t> sites;
+    std::vector<std::size_t> weights;
+  };
+  inline SitePatterns computeSitePatterns (const VectorSiteContainer & sites) {
+    SitePatterns r;
+    std::map<std::vector<int>, std::size_t> patternIndexes;
+    for (std::size_t site = 0; site < sites.getNumberOfSites (); ++site) {
+      const auto inserted = patternIndexes.emplace (sites.getSite (site).getContent (), r.sites.size ());
+      if (inserted.second) {
+        r.sites.push_back (site);
+        r.weights.push_back (1);
+      } else {
+        r.weights[inserted.first->second]++;
+      }
+    }
+    return r;
+  }
+
+  /* Initial conditional likelihood of a sequence: the matrix of {0,1} for each (state, site).
+   * Column site is alignment site columnSites[site].
+   * States are converted with indicators, the StateMap values of the model.
+   */
+  template <typename ConditionalLikelihood>
+  dataflow::NodeRef makeLeafConditionalLikelihood (dataflow::Context & c, const VectorSiteContainer & sites,
+                                                   const StateIndicatorTable & indicators, std::size_t sequenceIndex,
+                                                   std::size_t nbState, std::size_t nbSite,
+                                                   const std::size_t * columnSites) {
+    Eigen::MatrixXd initCondLik (nbState, nbSite);
+    // The matrix only depends on the sequence states: they give a fingerprint nbState times cheaper to compute.
+    std::size_t fingerprint = nbState;
+    for (std::size_t site = 0; site < nbSite; ++site) {
+      // Gather the precomputed column of the alphabet state, instead of resolving it for each state.
+      const int siteState = sites.getSite (columnSites[site])[sequenceIndex];
+      combineHash (fingerprint, siteState);
+      const auto & values = indicators.getIndicators (siteState);
+      for (std::size_t state = 0; state < nbState; ++state) {
+        initCondLik (Eigen::Index (state), Eigen::Index (site)) = values[state];
+      }
+    }
+    return dataflow::NumericConstant<ConditionalLikelihood>::createWithFingerprint (c, fingerprint,
+                                                                                    std::move (initCondLik));
+  }
+
   // Recursion helper class.
   // This stores state used by the two mutually recursive functions used to generate cond lik nodes.
   // The struct is similar to how a lambda is done internally, and allow the function definitions to be short.
   // The pure function equivalent has seven arguments, which is horrible.
-  struct SimpleLikelihoodNodesHelper {
+  template <typename NodeTypes> struct SimpleLikelihoodNodesHelper {
     dataflow::Context & c;
     SimpleLikelihoodNodes & r;
     std::shared_ptr<dataflow::ConfiguredModel> model;
     const PhyloTree & tree;
+    const FlatTopology & topology; // Contiguous snapshot of tree, used for the recursion
     const VectorSiteContainer & sites;
+    const StateIndicatorTable & indicators; // Model state values of each alphabet state, shared by all leaves
     MatrixDimension likelihoodMatrixDim;
     std::size_t nbState;
-    std::size_t nbSite;
+    std::size_t nbSite;              // Number of likelihood matrix columns (site patterns)
+    const std::size_t * columnSites; // Alignment site of each column
+    bool fuseForwardLikelihoods;     // Use ConditionalLikelihoodFromChildrenTransitions
 
     dataflow::NodeRef makeInitialConditionalLikelihood (const std::string & sequenceName) {
       /* FIXME Generate the matrix of {0,1} for each (state, site).
        * I am not sure what is the current interface class to use in the bpp_seq stuff.
        * Thus I selected VectorSiteContainer which is an implementation class.
        * This is certainly not the most permissive interface.
-       * In addition, I iterate on raw states, but newlik code seems to use StateMap conversion.
-       * I do not handle any of that in this example !
+       * States are converted with the StateMap of the model, which is assumed to be the same on all edges.
        * It should also be checked that edge models have the same state space, etc...
        */
-      const auto sequenceIndex = sites.getSequencePosition (sequenceName);
-      Eigen::MatrixXd initCondLik (nbState, nbSite);
-      for (std::size_t site = 0; site < nbSite; ++site) {
-        for (std::size_t state = 0; state < nbState; ++state) {
-          initCondLik (Eigen::Index (state), Eigen::Index (site)) =
-            sites.getStateValueAt (site, sequenceIndex, int(state));
+      return makeLeafConditionalLikelihood<typename NodeTypes::ConditionalLikelihood> (
+        c, sites, indicators, sites.getSequencePosition (sequenceName), nbState, nbSite, columnSites);
+    }
+
+    // Index is the position of the son node of the branch in topology.
+    dataflow::NodeRef makeTransitionMatrixNode (std::size_t index) {
+      // Branch lengths are shared by all site blocks: only create them once.
+      const auto edgeIndex = PhyloTree::EdgeIndex (topology.getBranchId (index));
+      auto it = r.branchLengthValues.find (edgeIndex);
+      if (it == r.branchLengthValues.end ()) {
+        if (!topology.hasBranchLength (index)) {
+          throw Exception ("PhyloTree branch " + std::to_string (edgeIndex) + " has no length");
         }
+        const auto initBrlen = topology.getBranchLength (index);
+        it = r.branchLengthValues.emplace (edgeIndex, dataflow::NumericMutable<double>::create (c, initBrlen)).first;
       }
-      return dataflow::NumericConstant<Eigen::MatrixXd>::create (c, std::move (initCondLik));
+      auto brlen = it->second;
+      return NodeTypes::TransitionMatrixFromModel::create (c, {model, brlen}, transitionMatrixDimension (nbState));
     }
 
-    dataflow::NodeRef makeForwardLikelihoodNode (PhyloTree::EdgeIndex index) {
-      const auto initBrlen = tree.getEdge (index)->getLength ();
-      auto brlen = dataflow::NumericMutable<double>::create (c, initBrlen);
-      r.branchLengthValues.emplace (index, brlen);
-
-      auto childConditionalLikelihood = makeConditionalLikelihoodNode (tree.getSon (index));
-      auto transitionMatrix =
-        dataflow::TransitionMatrixFromModel::create (c, {model, brlen}, transitionMatrixDimension (nbState));
-      return dataflow::ForwardLikelihoodFromConditional::create (
+    // Index is the position of the son node of the branch in topology.
+    dataflow::NodeRef makeForwardLikelihoodNode (std::size_t index) {
+      auto transitionMatrix = makeTransitionMatrixNode (index);
+      auto childConditionalLikelihood = makeConditionalLikelihoodNode (index);
+      return NodeTypes::ForwardLikelihoodFromConditional::create (
         c, {transitionMatrix, childConditionalLikelihood}, likelihoodMatrixDim);
     }
 
-    dataflow::NodeRef makeConditionalLikelihoodNode (PhyloTree::NodeIndex index) {
-      const auto childBranchIndexes = tree.getBranches (index);
-      if (childBranchIndexes.empty ()) {
-        return makeInitialConditionalLikelihood (tree.getNode (index)->getName ());
+    // Index is the position of the node in topology.
+    dataflow::NodeRef makeConditionalLikelihoodNode (std::size_t index) {
+      const auto nbSons = topology.getNumberOfSons (index);
+      if (nbSons == 0) {
+        return makeInitialConditionalLikelihood (
+          tree.getNode (PhyloTree::NodeIndex (topology.getNodeId (index)))->getName ());
+      } else if (fuseForwardLikelihoods) {
+        dataflow::NodeRefVec deps (2 * nbSons);
+        for (std::size_t i = 0; i < nbSons; ++i) {
+          deps[2 * i] = makeTransitionMatrixNode (topology.getSon (index, i));
+          deps[2 * i + 1] = makeConditionalLikelihoodNode (topology.getSon (index, i));
+        }
+        return NodeTypes::ConditionalLikelihoodFromChildrenTransitions::create (c, std::move (deps),
+                                                                                likelihoodMatrixDim);
       } else {
-        dataflow::NodeRefVec deps (childBranchIndexes.size ());
-        for (std::size_t i = 0; i < childBranchIndexes.size (); ++i) {
-          deps[i] = makeForwardLikelihoodNode (childBranchIndexes[i]);
+        dataflow::NodeRefVec deps (nbSons);
+        for (std::size_t i = 0; i < nbSons; ++i) {
+          deps[i] = makeForwardLikelihoodNode (topology.getSon (index, i));
         }
-        return dataflow::ConditionalLikelihoodFromChildrenForward::create (c, std::move (deps),
-                                                                           likelihoodMatrixDim);
+        return NodeTypes::ConditionalLikelihoodFromChildrenForward::create (c, std::move (deps),
+                                                                            likelihoodMatrixDim);
       }
     }
   };
 
+  /* Log likelihood of site patterns [firstPattern, firstPattern + nbBlockPattern), weighted by pattern counts.
+   * Root conditional likelihoods are combined to equilibrium frequencies to get the pattern likelihoods.
+   */
+  template <typename NodeTypes>
+  dataflow::NodeRef makeBlockLogLikelihood (dataflow::Context & c, dataflow::NodeRef equFreqs,
+                                            dataflow::NodeRef rootConditionalLikelihoods, const SitePatterns & patterns,
+                                            std::size_t firstPattern, std::size_t nbBlockPattern) {
+    auto siteLikelihoods = NodeTypes::LikelihoodFromRootConditional::create (
+      c, {std::move (equFreqs), std::move (rootConditionalLikelihoods)},
+      rowVectorDimension (Eigen::Index (nbBlockPattern)));
+    Eigen::RowVectorXd blockWeights (Eigen::Index (nbBlockPattern));
+    for (std::size_t i = 0; i < nbBlockPattern; ++i) {
+      blockWeights (Eigen::Index (i)) = double(patterns.weights[firstPattern + i]);
+    }
+    auto weights = dataflow::NumericConstant<Eigen::RowVectorXd>::create (c, std::move (blockWeights));
+    return NodeTypes::WeightedTotalLogLikelihood::create (c, {siteLikelihoods, weights},
+                                                          rowVectorDimension (Eigen::Index (nbBlockPattern)));
+  }
+
   /* Build a likelihood computation dataflow graph for a simple example.
    *
    * The same model is used everywhere for simplicity.
@@ -141,31 +282,389 @@ namespace bpp {
    * The set of parameters (branch lengths) is returned in the branchLengthValues map.
    * In a real case, something like a map<EdgeIndex, ValueRef<double>> would provide branch lengths.
    * The branch length values can be provided by any computation, or as a leaf NumericMutable node.
+   *
+   * Identical site patterns are merged (see computeSitePatterns): conditional likelihood matrices have one
+   * column for each distinct pattern, and pattern log likelihoods are weighted by their number of sites.
+   *
+   * If siteBlockSize is not 0, patterns are split in blocks of (at most) siteBlockSize columns.
+   * Each block has its own conditional likelihood sub-graph, with (nbState, blockSize) matrices.
+   * Small blocks stay in cache for the whole tree recursion, and are independent for a ParallelExecutor.
+   * Transition matrices and branch lengths are shared by all blocks.
+   * Log likelihoods of blocks are summed.
+   *
+   * If fuseForwardLikelihoods is true, each inner node is one ConditionalLikelihoodFromChildrenTransitions node,
+   * which does not store the forward likelihoods of its children.
+   * This suits graphs which are only evaluated: derivatives would create the forward likelihood nodes again.
+   * ExtendedFloat node types do not support derivation, so they can always be fused.
+   *
+   * NodeTypes selects the likelihood value types (see DoubleLikelihoodNodeTypes and others).
    */
-  inline SimpleLikelihoodNodes makeSimpleLikelihoodNodes (dataflow::Context & c, const PhyloTree & tree,
-                                                          const VectorSiteContainer & sites,
-                                                          std::shared_ptr<dataflow::ConfiguredModel> model) {
+  template <typename NodeTypes>
+  SimpleLikelihoodNodes makeSimpleLikelihoodNodesWithTypes (dataflow::Context & c, const PhyloTree & tree,
+                                                            const VectorSiteContainer & sites,
+                                                            std::shared_ptr<dataflow::ConfiguredModel> model,
+                                                            std::size_t siteBlockSize = 0,
+                                                            bool fuseForwardLikelihoods = false) {
     const auto nbState = model->getValue ()->getNumberOfStates (); // Number of stored state values !
-    const auto nbSite = sites.getNumberOfSites ();
-    const auto likelihoodMatrixDim = conditionalLikelihoodDimension (nbState, nbSite);
+    const auto patterns = computeSitePatterns (sites);
+    const auto nbPattern = patterns.sites.size ();
+    const auto blockSize = siteBlockSize > 0 ? siteBlockSize : std::max (nbPattern, std::size_t (1));
     SimpleLikelihoodNodes r;
 
     // Build conditional likelihoods up to root recursively.
     if (!tree.isRooted ()) {
       throw Exception ("PhyloTree must be rooted");
     }
+    // Flatten the topology once, instead of querying the graph for every site block.
+    const FlatTopology topology (tree);
+    const StateIndicatorTable indicators (model->getValue ()->getStateMap ());
+
+    auto equFreqs = dataflow::EquilibriumFrequenciesFromModel::create (
+      c, {model}, rowVectorDimension (Eigen::Index (nbState)));
+
+    dataflow::NodeRefVec blockLogLikelihoods;
+    for (std::size_t firstPattern = 0; firstPattern < nbPattern; firstPattern += blockSize) {
+      const auto nbBlockPattern = std::min (blockSize, nbPattern - firstPattern);
+      const auto likelihoodMatrixDim = conditionalLikelihoodDimension (nbState, nbBlockPattern);
+
+      // Recursively generate dataflow graph for conditional likelihood using helper struct.
+      SimpleLikelihoodNodesHelper<NodeTypes> helper{
+        c, r, model, tree, topology, sites, indicators, likelihoodMatrixDim, nbState, nbBlockPattern,
+        patterns.sites.data () + firstPattern, fuseForwardLikelihoods};
+      auto rootConditionalLikelihoods = helper.makeConditionalLikelihoodNode (topology.getRootIndex ());
+      blockLogLikelihoods.emplace_back (makeBlockLogLikelihood<NodeTypes> (c, equFreqs, rootConditionalLikelihoods,
+                                                                          patterns, firstPattern, nbBlockPattern));
+    }
+    auto totalLogLikelihood = dataflow::CWiseAdd<double, dataflow::ReductionOf<double>>::create (
+      c, std::move (blockLogLikelihoods), Dimension<double> ());
+
+    // We want -log(likelihood)
+    r.totalLogLikelihood =
+      dataflow::CWiseNegate<double>::create (c, {totalLogLikelihood}, Dimension<double> ());
+    return r;
+  }
+
+  /* Build the likelihood example graph with double values.
+   * Node types are selected from the number of states of the model: 4 (nucleotides), 20 (proteins) and
+   * 61 (codons) use fixed size Eigen types, other state counts use dynamic types.
+   */
+  inline SimpleLikelihoodNodes makeSimpleLikelihoodNodes (dataflow::Context & c, const PhyloTree & tree,
+                                                          const VectorSiteContainer & sites,
+                                                          std::shared_ptr<dataflow::ConfiguredModel> model,
+                                                          std::size_t siteBlockSize = 0,
+                                                          bool fuseForwardLikelihoods = false) {
+    switch (model->getValue ()->getNumberOfStates ()) {
+    case 4:
+      return makeSimpleLikelihoodNodesWithTypes<FixedStateLikelihoodNodeTypes<4>> (
+        c, tree, sites, std::move (model), siteBlockSize, fuseForwardLikelihoods);
+    case 20:
+      return makeSimpleLikelihoodNodesWithTypes<FixedStateLikelihoodNodeTypes<20>> (
+        c, tree, sites, std::move (model), siteBlockSize, fuseForwardLikelihoods);
+    case 61:
+      return makeSimpleLikelihoodNodesWithTypes<FixedStateLikelihoodNodeTypes<61>> (
+        c, tree, sites, std::move (model), siteBlockSize, fuseForwardLikelihoods);
+    default:
+      return makeSimpleLikelihoodNodesWithTypes<DoubleLikelihoodNodeTypes> (
+        c, tree, sites, std::move (model), siteBlockSize, fuseForwardLikelihoods);
+    }
+  }
+
+  /* Data independent structure of the likelihood example graph (see makeSimpleLikelihoodNodesWithTypes).
+   *
+   * The recursion of SimpleLikelihoodNodesHelper is done once, and recorded as a list of instructions in dependency
+   * order: each instruction creates one node from the nodes of previous instructions, and the last one is the root
+   * conditional likelihood.
+   * makeSimpleLikelihoodNodesFromTemplate builds a graph from the list: only leaf conditional likelihoods are read
+   * from the alignment, and the tree is not needed anymore.
+   * A template can thus be reused for any alignment with the same sequence names, and written to a stream to skip
+   * the recursion in later runs (see loadOrCreateLikelihoodGraphTemplate).
+   *
+   * Two trees have the same structure if they have the same nodes with the same son order, leaf names and branch
+   * ids: structureHash identifies it, with fuseForwardLikelihoods.
+   * Branch lengths are initial values of the branch length nodes, they are not part of the structure.
+   */
+  struct LikelihoodGraphTemplate {
+    enum class Kind : std::uint8_t {
+      Leaf,                    // Initial conditional likelihood of sequence names[ref]
+      TransitionMatrix,        // Transition matrix of branch branchIds[ref]
+      Forward,                 // ForwardLikelihoodFromConditional of (transition matrix, conditional likelihood)
+      FromChildrenForward,     // ConditionalLikelihoodFromChildrenForward of forward likelihoods
+      FromChildrenTransitions, // ConditionalLikelihoodFromChildrenTransitions of (matrix, conditional) pairs
+    };
+    std::vector<Kind> kinds;
+    std::vector<std::size_t> refs; // Unused for kinds other than Leaf and TransitionMatrix
+    // Dependencies of instruction i are instructions deps[depsBegin[i]] to deps[depsBegin[i + 1] - 1].
+    std::vector<std::size_t> depsBegin{0};
+    std::vector<std::size_t> deps;
+
+    std::vector<std::string> names;    // Leaf sequence names
+    std::vector<int> branchIds;        // Branch ids of the tree
+    std::vector<double> branchLengths; // Initial branch lengths, by branch
+    bool fuseForwardLikelihoods{false};
+    std::size_t structureHash{0};
+
+    std::size_t getNumberOfInstructions () const { return kinds.size (); }
+
+    // Hash of the structure of a tree, as stored in structureHash.
+    static std::size_t computeStructureHash (const PhyloTree & tree, const FlatTopology & topology,
+                                             bool fuseForwardLikelihoods) {
+      std::size_t seed = topology.getNumberOfNodes ();
+      combineHash (seed, fuseForwardLikelihoods);
+      for (std::size_t i = 0; i < topology.getNumberOfNodes (); ++i) {
+        combineHash (seed, topology.getNumberOfSons (i));
+        combineHash (seed, topology.getBranchId (i));
+        if (topology.isLeaf (i)) {
+          combineHash (seed, tree.getNode (PhyloTree::NodeIndex (topology.getNodeId (i)))->getName ());
+        }
+      }
+      return seed;
+    }
+
+    static LikelihoodGraphTemplate create (const PhyloTree & tree, bool fuseForwardLikelihoods = false) {
+      if (!tree.isRooted ()) {
+        throw Exception ("PhyloTree must be rooted");
+      }
+      const FlatTopology topology (tree);
+      LikelihoodGraphTemplate r;
+      r.fuseForwardLikelihoods = fuseForwardLikelihoods;
+      r.structureHash = computeStructureHash (tree, topology, fuseForwardLikelihoods);
+      r.addConditionalLikelihood (tree, topology, topology.getRootIndex ());
+      r.setBranchLengths (topology);
+      return r;
+    }
+
+    // Take initial branch lengths from a tree with the same structure.
+    void setBranchLengths (const FlatTopology & topology) {
+      std::unordered_map<int, std::size_t> indexes;
+      for (std::size_t i = 0; i < topology.getNumberOfNodes (); ++i) {
+        indexes.emplace (topology.getBranchId (i), i);
+      }
+      branchLengths.resize (branchIds.size ());
+      for (std::size_t b = 0; b < branchIds.size (); ++b) {
+        auto it = indexes.find (branchIds[b]);
+        if (it == indexes.end () || !topology.hasBranchLength (it->second)) {
+          throw Exception ("PhyloTree branch " + std::to_string (branchIds[b]) + " has no length");
+        }
+        branchLengths[b] = topology.getBranchLength (it->second);
+      }
+    }
+
+    /* Binary format: header, structure hash, flags, then the arrays with their sizes.
+     * As the layout of std::hash values, it depends on the build of the library: files are meant to be a cache.
+     */
+    void write (std::ostream & os) const {
+      BinaryTools::writeHeader (os, magic (), version ());
+      BinaryTools::writeValue (os, std::uint64_t (structureHash));
+      BinaryTools::writeValue (os, std::uint8_t (fuseForwardLikelihoods));
+      BinaryTools::writeValue (os, std::uint64_t (kinds.size ()));
+      BinaryTools::writeArray (os, kinds);
+      writeIndexes (os, refs);
+      writeIndexes (os, depsBegin);
+      BinaryTools::writeValue (os, std::uint64_t (deps.size ()));
+      writeIndexes (os, deps);
+      BinaryTools::writeValue (os, std::uint64_t (names.size ()));
+      for (const auto & name : names) {
+        BinaryTools::writeString (os, name);
+      }
+      BinaryTools::writeValue (os, std::uint64_t (branchIds.size ()));
+      BinaryTools::writeArray (os, branchIds);
+      BinaryTools::writeArray (os, branchLengths);
+    }
 
-    // Recursively generate dataflow graph for conditional likelihood using helper struct.
-    SimpleLikelihoodNodesHelper helper{c, r, model, tree, sites, likelihoodMatrixDim, nbState, nbSite};
-    auto rootConditionalLikelihoods = helper.makeConditionalLikelihoodNode (tree.getRootIndex ());
+    // Read a template written by write(). Throws IOException if the stream is truncated or not consistent.
+    static LikelihoodGraphTemplate read (std::istream & is) {
+      if (!BinaryTools::readHeader (is, magic (), version ())) {
+        throw IOException ("LikelihoodGraphTemplate::read. No template found in stream.");
+      }
+      LikelihoodGraphTemplate r;
+      std::uint64_t hash, size;
+      std::uint8_t fuse;
+      BinaryTools::readValue (is, hash);
+      BinaryTools::readValue (is, fuse);
+      r.structureHash = std::size_t (hash);
+      r.fuseForwardLikelihoods = fuse != 0;
+      BinaryTools::readValue (is, size);
+      r.kinds.resize (std::size_t (size));
+      BinaryTools::readArray (is, r.kinds);
+      r.refs.resize (r.kinds.size ());
+      readIndexes (is, r.refs);
+      r.depsBegin.resize (r.kinds.size () + 1);
+      readIndexes (is, r.depsBegin);
+      BinaryTools::readValue (is, size);
+      r.deps.resize (std::size_t (size));
+      readIndexes (is, r.deps);
+      BinaryTools::readValue (is, size);
+      r.names.resize (std::size_t (size));
+      for (auto & name : r.names) {
+        BinaryTools::readString (is, name);
+      }
+      BinaryTools::readValue (is, size);
+      r.branchIds.resize (std::size_t (size));
+      r.branchLengths.resize (std::size_t (size));
+      BinaryTools::readArray (is, r.branchIds);
+      BinaryTools::readArray (is, r.branchLengths);
+      if (!r.isConsistent ()) {
+        throw IOException ("LikelihoodGraphTemplate::read. Inconsistent template.");
+      }
+      return r;
+    }
+
+    // Check that dependencies come before their instruction, and that references are valid.
+    bool isConsistent () const {
+      const auto nbInstruction = kinds.size ();
+      if (nbInstruction == 0 || refs.size () != nbInstruction || depsBegin.size () != nbInstruction + 1 ||
+          depsBegin.front () != 0 || depsBegin.back () != deps.size () || branchLengths.size () != branchIds.size ()) {
+        return false;
+      }
+      for (std::size_t i = 0; i < nbInstruction; ++i) {
+        if (depsBegin[i] > depsBegin[i + 1] || kinds[i] > Kind::FromChildrenTransitions) {
+          return false;
+        }
+        for (std::size_t k = depsBegin[i]; k < depsBegin[i + 1]; ++k) {
+          if (deps[k] >= i) {
+            return false;
+          }
+        }
+        if ((kinds[i] == Kind::Leaf && refs[i] >= names.size ()) ||
+            (kinds[i] == Kind::TransitionMatrix && refs[i] >= branchIds.size ())) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+  private:
+    static const char * magic () { return "BPPG"; }
+    static std::uint32_t version () { return 1; }
+
+    static void writeIndexes (std::ostream & os, const std::vector<std::size_t> & v) {
+      BinaryTools::writeArray (os, std::vector<std::uint64_t> (v.begin (), v.end ()));
+    }
+    static void readIndexes (std::istream & is, std::vector<std::size_t> & v) {
+      std::vector<std::uint64_t> values (v.size ());
+      BinaryTools::readArray (is, values);
+      v.assign (values.begin (), values.end ());
+    }
+
+    std::size_t addInstruction (Kind kind, std::size_t ref, const std::vector<std::size_t> & instructionDeps) {
+      kinds.push_back (kind);
+      refs.push_back (ref);
+      deps.insert (deps.end (), instructionDeps.begin (), instructionDeps.end ());
+      depsBegin.push_back (deps.size ());
+      return kinds.size () - 1;
+    }
+
+    // Same recursion as SimpleLikelihoodNodesHelper, in the same order. Index is the position in topology.
+    std::size_t addTransitionMatrix (const FlatTopology & topology, std::size_t index) {
+      branchIds.push_back (topology.getBranchId (index));
+      return addInstruction (Kind::TransitionMatrix, branchIds.size () - 1, {});
+    }
+
+    std::size_t addConditionalLikelihood (const PhyloTree & tree, const FlatTopology & topology, std::size_t index) {
+      const auto nbSons = topology.getNumberOfSons (index);
+      if (nbSons == 0) {
+        names.push_back (tree.getNode (PhyloTree::NodeIndex (topology.getNodeId (index)))->getName ());
+        return addInstruction (Kind::Leaf, names.size () - 1, {});
+      } else if (fuseForwardLikelihoods) {
+        std::vector<std::size_t> sonDeps (2 * nbSons);
+        for (std::size_t i = 0; i < nbSons; ++i) {
+          sonDeps[2 * i] = addTransitionMatrix (topology, topology.getSon (index, i));
+          sonDeps[2 * i + 1] = addConditionalLikelihood (tree, topology, topology.getSon (index, i));
+        }
+        return addInstruction (Kind::FromChildrenTransitions, 0, sonDeps);
+      } else {
+        std::vector<std::size_t> sonDeps (nbSons);
+        for (std::size_t i = 0; i < nbSons; ++i) {
+          const auto son = topology.getSon (index, i);
+          const auto transitionMatrix = addTransitionMatrix (topology, son);
+          const auto childConditionalLikelihood = addConditionalLikelihood (tree, topology, son);
+          sonDeps[i] = addInstruction (Kind::Forward, 0, {transitionMatrix, childConditionalLikelihood});
+        }
+        return addInstruction (Kind::FromChildrenForward, 0, sonDeps);
+      }
+    }
+  };
+
+  /* Build the likelihood example graph of a template (see LikelihoodGraphTemplate).
+   *
+   * The graph is the same as makeSimpleLikelihoodNodesWithTypes for the tree of the template, with the same
+   * patterns, site blocks and branch length nodes (initialised with the template branch lengths).
+   * Instructions are replayed for each site block: branch length and transition matrix nodes are created in a first
+   * pass, as they are shared by all blocks, and sequence positions are resolved once.
+   */
+  template <typename NodeTypes>
+  SimpleLikelihoodNodes makeSimpleLikelihoodNodesFromTemplateWithTypes (dataflow::Context & c,
+                                                                        const LikelihoodGraphTemplate & graph,
+                                                                        const VectorSiteContainer & sites,
+                                                                        std::shared_ptr<dataflow::ConfiguredModel> model,
+                                                                        std::size_t siteBlockSize = 0) {
+    using Kind = LikelihoodGraphTemplate::Kind;
+    const auto nbState = model->getValue ()->getNumberOfStates (); // Number of stored state values !
+    const auto patterns = computeSitePatterns (sites);
+    const auto nbPattern = patterns.sites.size ();
+    const auto blockSize = siteBlockSize > 0 ? siteBlockSize : std::max (nbPattern, std::size_t (1));
+    const auto nbInstruction = graph.getNumberOfInstructions ();
+    if (nbInstruction == 0) {
+      throw Exception ("LikelihoodGraphTemplate is empty");
+    }
+    SimpleLikelihoodNodes r;
+
+    const StateIndicatorTable indicators (model->getValue ()->getStateMap ());
+    std::vector<std::size_t> sequenceIndexes;
+    for (const auto & name : graph.names) {
+      sequenceIndexes.push_back (sites.getSequencePosition (name));
+    }
+
+    dataflow::NodeRefVec nodes (nbInstruction);
+    for (std::size_t i = 0; i < nbInstruction; ++i) {
+      if (graph.kinds[i] == Kind::TransitionMatrix) {
+        const auto branch = graph.refs[i];
+        auto brlen = dataflow::NumericMutable<double>::create (c, graph.branchLengths[branch]);
+        r.branchLengthValues.emplace (PhyloTree::EdgeIndex (graph.branchIds[branch]), brlen);
+        nodes[i] =
+          NodeTypes::TransitionMatrixFromModel::create (c, {model, brlen}, transitionMatrixDimension (nbState));
+      }
+    }
 
-    // Combine them to equilibrium frequencies to get the log likelihood
     auto equFreqs = dataflow::EquilibriumFrequenciesFromModel::create (
       c, {model}, rowVectorDimension (Eigen::Index (nbState)));
-    auto siteLikelihoods = dataflow::LikelihoodFromRootConditional::create (
-      c, {equFreqs, rootConditionalLikelihoods}, rowVectorDimension (Eigen::Index (nbSite)));
-    auto totalLogLikelihood =
-      dataflow::TotalLogLikelihood::create (c, {siteLikelihoods}, rowVectorDimension (Eigen::Index (nbSite)));
+
+    dataflow::NodeRefVec blockLogLikelihoods;
+    for (std::size_t firstPattern = 0; firstPattern < nbPattern; firstPattern += blockSize) {
+      const auto nbBlockPattern = std::min (blockSize, nbPattern - firstPattern);
+      const auto likelihoodMatrixDim = conditionalLikelihoodDimension (nbState, nbBlockPattern);
+      for (std::size_t i = 0; i < nbInstruction; ++i) {
+        dataflow::NodeRefVec deps;
+        for (std::size_t k = graph.depsBegin[i]; k < graph.depsBegin[i + 1]; ++k) {
+          deps.push_back (nodes[graph.deps[k]]);
+        }
+        switch (graph.kinds[i]) {
+        case Kind::Leaf:
+          nodes[i] = makeLeafConditionalLikelihood<typename NodeTypes::ConditionalLikelihood> (
+            c, sites, indicators, sequenceIndexes[graph.refs[i]], nbState, nbBlockPattern,
+            patterns.sites.data () + firstPattern);
+          break;
+        case Kind::TransitionMatrix:
+          break;
+        case Kind::Forward:
+          nodes[i] =
+            NodeTypes::ForwardLikelihoodFromConditional::create (c, std::move (deps), likelihoodMatrixDim);
+          break;
+        case Kind::FromChildrenForward:
+          nodes[i] =
+            NodeTypes::ConditionalLikelihoodFromChildrenForward::create (c, std::move (deps), likelihoodMatrixDim);
+          break;
+        case Kind::FromChildrenTransitions:
+          nodes[i] = NodeTypes::ConditionalLikelihoodFromChildrenTransitions::create (c, std::move (deps),
+                                                                                      likelihoodMatrixDim);
+          break;
+        }
+      }
+      blockLogLikelihoods.emplace_back (
+        makeBlockLogLikelihood<NodeTypes> (c, equFreqs, nodes.back (), patterns, firstPattern, nbBlockPattern));
+    }
+    auto totalLogLikelihood = dataflow::CWiseAdd<double, dataflow::ReductionOf<double>>::create (
+      c, std::move (blockLogLikelihoods), Dimension<double> ());
 
     // We want -log(likelihood)
     r.totalLogLikelihood =
@@ -173,6 +672,366 @@ namespace bpp {
     return r;
   }
 
+  // Same as makeSimpleLikelihoodNodes, from a template.
+  inline SimpleLikelihoodNodes makeSimpleLikelihoodNodesFromTemplate (dataflow::Context & c,
+                                                                      const LikelihoodGraphTemplate & graph,
+                                                                      const VectorSiteContainer & sites,
+                                                                      std::shared_ptr<dataflow::ConfiguredModel> model,
+                                                                      std::size_t siteBlockSize = 0) {
+    switch (model->getValue ()->getNumberOfStates ()) {
+    case 4:
+      return makeSimpleLikelihoodNodesFromTemplateWithTypes<FixedStateLikelihoodNodeTypes<4>> (
+        c, graph, sites, std::move (model), siteBlockSize);
+    case 20:
+      return makeSimpleLikelihoodNodesFromTemplateWithTypes<FixedStateLikelihoodNodeTypes<20>> (
+        c, graph, sites, std::move (model), siteBlockSize);
+    case 61:
+      return makeSimpleLikelihoodNodesFromTemplateWithTypes<FixedStateLikelihoodNodeTypes<61>> (
+        c, graph, sites, std::move (model), siteBlockSize);
+    default:
+      return makeSimpleLikelihoodNodesFromTemplateWithTypes<DoubleLikelihoodNodeTypes> (
+        c, graph, sites, std::move (model), siteBlockSize);
+    }
+  }
+
+  /* Get the template of a tree from a cache directory, or create it and store it there.
+   *
+   * The file is named by the structure hash of the tree: trees with the same structure share it.
+   * If it is missing or cannot be read (or was written for a different structure), the template is created from the
+   * tree and written again: the cache is only an optimisation, and writing is skipped if the directory is not
+   * writable. It is written to a temporary file first, so that concurrent runs never read a partial file.
+   * Branch lengths are always taken from the tree.
+   */
+  inline LikelihoodGraphTemplate loadOrCreateLikelihoodGraphTemplate (const std::string & cacheDirectory,
+                                                                      const PhyloTree & tree,
+                                                                      bool fuseForwardLikelihoods = false) {
+    if (!tree.isRooted ()) {
+      throw Exception ("PhyloTree must be rooted");
+    }
+    const FlatTopology topology (tree);
+    const auto hash = LikelihoodGraphTemplate::computeStructureHash (tree, topology, fuseForwardLikelihoods);
+    const auto path = cacheDirectory + "/likelihood-graph-" + std::to_string (hash) + ".bin";
+    {
+      std::ifstream is (path, std::ios::binary);
+      if (is) {
+        try {
+          auto cached = LikelihoodGraphTemplate::read (is);
+          if (cached.structureHash == hash && cached.fuseForwardLikelihoods == fuseForwardLikelihoods) {
+            cached.setBranchLengths (topology);
+            return cached;
+          }
+        } catch (const IOException &) {
+          // Unreadable file: replaced below.
+        }
+      }
+    }
+    auto r = LikelihoodGraphTemplate::create (tree, fuseForwardLikelihoods);
+    std::size_t tmpId = std::hash<std::thread::id> () (std::this_thread::get_id ());
+    combineHash (tmpId, std::chrono::steady_clock::now ().time_since_epoch ().count ());
+    const auto tmpPath = path + ".tmp" + std::to_string (tmpId);
+    {
+      std::ofstream os (tmpPath, std::ios::binary);
+      if (!os) {
+        return r;
+      }
+      r.write (os);
+      if (!os) {
+        os.close ();
+        std::remove (tmpPath.c_str ());
+        return r;
+      }
+    }
+    if (std::rename (tmpPath.c_str (), path.c_str ()) != 0) {
+      std::remove (tmpPath.c_str ());
+    }
+    return r;
+  }
+
+  /// Result of computeStreamedLikelihood.
+  struct StreamedLikelihood {
+    double totalLogLikelihood{0.}; // -log(likelihood), as in SimpleLikelihoodNodes
+    std::unordered_map<PhyloTree::EdgeIndex, double> branchLengthDerivatives; // Of totalLogLikelihood
+    std::size_t nbSites{0};
+  };
+
+  /* Compute the likelihood of an alignment read block by block, in memory bounded by the size of a block.
+   *
+   * The alignment is read from a stream written by BinarySiteBlockWriter (typically a file on disk).
+   * For each block, a graph is built by makeSimpleLikelihoodNodes in a temporary Context, evaluated, and
+   * destroyed: only the block log likelihood and branch length derivatives are accumulated.
+   * Site patterns are merged in each block only.
+   * Branch lengths are read from the tree, and model parameters from the model.
+   * Derivatives are evaluated with the value in one computeWithValueRecycling() call: the conditional
+   * likelihood buffers are reused between nodes, and between blocks of the same size.
+   */
+  inline StreamedLikelihood computeStreamedLikelihood (BinarySiteBlockReader & reader, const PhyloTree & tree,
+                                                       const TransitionModel & model,
+                                                       bool withBranchLengthDerivatives = true) {
+    StreamedLikelihood r;
+    dataflow::ValueBufferPool pool;
+    VectorSiteContainer block (reader.getAlphabet ());
+    while (reader.readBlock (block)) {
+      dataflow::Context c;
+      auto modelParameters = dataflow::createParameterMapForModel (c, model);
+      auto modelNode = dataflow::ConfiguredModel::create (
+        c,
+        dataflow::createDependencyVector (
+          model, [&modelParameters] (const std::string & name) -> dataflow::NodeRef { return modelParameters[name]; }),
+        std::unique_ptr<TransitionModel> (model.clone ()));
+      auto nodes = makeSimpleLikelihoodNodes (c, tree, block, modelNode);
+
+      std::vector<dataflow::Node *> requested{nodes.totalLogLikelihood.get ()};
+      std::vector<std::pair<PhyloTree::EdgeIndex, dataflow::ValueRef<double>>> derivatives;
+      if (withBranchLengthDerivatives) {
+        for (const auto & p : nodes.branchLengthValues) {
+          derivatives.emplace_back (p.first, nodes.totalLogLikelihood->deriveAsValue (c, *p.second));
+          requested.push_back (derivatives.back ().second.get ());
+        }
+      }
+      dataflow::computeWithValueRecycling (requested, pool);
+
+      r.totalLogLikelihood += nodes.totalLogLikelihood->accessValueConst ();
+      for (const auto & d : derivatives) {
+        r.branchLengthDerivatives[d.first] += d.second->accessValueConst ();
+      }
+      r.nbSites += block.getNumberOfSites ();
+    }
+    return r;
+  }
+
+  // Recursion helper for makeClassLikelihoodNodes: same as SimpleLikelihoodNodesHelper, with class stacked values.
+  struct ClassLikelihoodNodesHelper {
+    dataflow::Context & c;
+    SimpleLikelihoodNodes & r;
+    std::shared_ptr<dataflow::ConfiguredModel> model;
+    const PhyloTree & tree;
+    const FlatTopology & topology;
+    const VectorSiteContainer & sites;
+    const StateIndicatorTable & indicators;
+    const std::vector<double> & classRates;
+    MatrixDimension likelihoodMatrixDim; // (nbClass * nbState, nbSite)
+    std::size_t nbState;
+    std::size_t nbSite;
+    const std::size_t * columnSites;
+
+    // Leaf values do not depend on the class: the (nbState, nbSite) matrix is repeated for each class.
+    dataflow::NodeRef makeInitialConditionalLikelihood (const std::string & sequenceName) {
+      const auto sequenceIndex = sites.getSequencePosition (sequenceName);
+      const auto nbClass = classRates.size ();
+      Eigen::MatrixXd initCondLik (likelihoodMatrixDim.rows, likelihoodMatrixDim.cols);
+      std::size_t fingerprint = nbClass * nbState;
+      for (std::size_t site = 0; site < nbSite; ++site) {
+        const int siteState = sites.getSite (columnSites[site])[sequenceIndex];
+        combineHash (fingerprint, siteState);
+        const auto & values = indicators.getIndicators (siteState);
+        for (std::size_t state = 0; state < nbState; ++state) {
+          for (std::size_t k = 0; k < nbClass; ++k) {
+            initCondLik (Eigen::Index (k * nbState + state), Eigen::Index (site)) = values[state];
+          }
+        }
+      }
+      return dataflow::NumericConstant<Eigen::MatrixXd>::createWithFingerprint (c, fingerprint,
+                                                                                std::move (initCondLik));
+    }
+
+    dataflow::NodeRef makeForwardLikelihoodNode (std::size_t index) {
+      const auto edgeIndex = PhyloTree::EdgeIndex (topology.getBranchId (index));
+      auto it = r.branchLengthValues.find (edgeIndex);
+      if (it == r.branchLengthValues.end ()) {
+        if (!topology.hasBranchLength (index)) {
+          throw Exception ("PhyloTree branch " + std::to_string (edgeIndex) + " has no length");
+        }
+        const auto initBrlen = topology.getBranchLength (index);
+        it = r.branchLengthValues.emplace (edgeIndex, dataflow::NumericMutable<double>::create (c, initBrlen)).first;
+      }
+      auto brlen = it->second;
+
+      auto childConditionalLikelihood = makeConditionalLikelihoodNode (index);
+      // One node computes the matrices of all classes.
+      auto transitionMatrices = dataflow::ClassTransitionMatricesFromModel::create (
+        c, {model, brlen}, classRates, 0,
+        MatrixDimension (Eigen::Index (classRates.size () * nbState), Eigen::Index (nbState)));
+      return dataflow::ClassForwardLikelihoodFromConditional::create (
+        c, {transitionMatrices, childConditionalLikelihood}, likelihoodMatrixDim);
+    }
+
+    dataflow::NodeRef makeConditionalLikelihoodNode (std::size_t index) {
+      const auto nbSons = topology.getNumberOfSons (index);
+      if (nbSons == 0) {
+        return makeInitialConditionalLikelihood (
+          tree.getNode (PhyloTree::NodeIndex (topology.getNodeId (index)))->getName ());
+      } else {
+        dataflow::NodeRefVec deps (nbSons);
+        for (std::size_t i = 0; i < nbSons; ++i) {
+          deps[i] = makeForwardLikelihoodNode (topology.getSon (index, i));
+        }
+        return dataflow::ConditionalLikelihoodFromChildrenForward::create (c, std::move (deps),
+                                                                           likelihoodMatrixDim);
+      }
+    }
+  };
+
+  /* Build the likelihood example graph with rate classes (+G for instance).
+   *
+   * Class k has rate multiplier classRates[k] and probability classProbabilities[k].
+   * Values of all classes are stacked in (nbClass * nbState, nbSite) matrices (see Likelihood.h):
+   * the graph has the same number of nodes as with makeSimpleLikelihoodNodes, whatever the number of classes.
+   * Each branch has one ClassTransitionMatricesFromModel node computing the matrices of all classes.
+   * Site likelihoods are sum_k p_k sum_state freqs(state) * c(k * nbState + state, site),
+   * computed by one product of the root conditional likelihood with ClassWeightedFrequencies.
+   *
+   * Patterns, site blocks and branch lengths are handled as in makeSimpleLikelihoodNodesWithTypes.
+   * Values are Eigen::MatrixXd: there is no fixed state or ExtendedFloat variant.
+   */
+  inline SimpleLikelihoodNodes makeClassLikelihoodNodes (dataflow::Context & c, const PhyloTree & tree,
+                                                         const VectorSiteContainer & sites,
+                                                         std::shared_ptr<dataflow::ConfiguredModel> model,
+                                                         const std::vector<double> & classRates,
+                                                         const std::vector<double> & classProbabilities,
+                                                         std::size_t siteBlockSize = 0) {
+    if (classRates.empty () || classRates.size () != classProbabilities.size ()) {
+      throw Exception ("makeClassLikelihoodNodes: classRates and classProbabilities must have the same size");
+    }
+    const auto nbClass = classRates.size ();
+    const auto nbState = model->getValue ()->getNumberOfStates ();
+    const auto patterns = computeSitePatterns (sites);
+    const auto nbPattern = patterns.sites.size ();
+    const auto blockSize = siteBlockSize > 0 ? siteBlockSize : std::max (nbPattern, std::size_t (1));
+    SimpleLikelihoodNodes r;
+
+    if (!tree.isRooted ()) {
+      throw Exception ("PhyloTree must be rooted");
+    }
+    const FlatTopology topology (tree);
+    const StateIndicatorTable indicators (model->getValue ()->getStateMap ());
+
+    auto equFreqs = dataflow::EquilibriumFrequenciesFromModel::create (
+      c, {model}, rowVectorDimension (Eigen::Index (nbState)));
+    auto classFreqs = dataflow::ClassWeightedFrequencies::create (
+      c, {equFreqs}, classProbabilities, rowVectorDimension (Eigen::Index (nbClass * nbState)));
+
+    dataflow::NodeRefVec blockLogLikelihoods;
+    for (std::size_t firstPattern = 0; firstPattern < nbPattern; firstPattern += blockSize) {
+      const auto nbBlockPattern = std::min (blockSize, nbPattern - firstPattern);
+      const auto likelihoodMatrixDim = conditionalLikelihoodDimension (nbClass * nbState, nbBlockPattern);
+
+      ClassLikelihoodNodesHelper helper{
+        c, r, model, tree, topology, sites, indicators, classRates, likelihoodMatrixDim, nbState, nbBlockPattern,
+        patterns.sites.data () + firstPattern};
+      auto rootConditionalLikelihoods = helper.makeConditionalLikelihoodNode (topology.getRootIndex ());
+
+      auto siteLikelihoods = dataflow::LikelihoodFromRootConditional::create (
+        c, {classFreqs, rootConditionalLikelihoods}, rowVectorDimension (Eigen::Index (nbBlockPattern)));
+      Eigen::RowVectorXd blockWeights (Eigen::Index (nbBlockPattern));
+      for (std::size_t i = 0; i < nbBlockPattern; ++i) {
+        blockWeights (Eigen::Index (i)) = double(patterns.weights[firstPattern + i]);
+      }
+      auto weights = dataflow::NumericConstant<Eigen::RowVectorXd>::create (c, std::move (blockWeights));
+      blockLogLikelihoods.emplace_back (dataflow::WeightedTotalLogLikelihood::create (
+        c, {siteLikelihoods, weights}, rowVectorDimension (Eigen::Index (nbBlockPattern))));
+    }
+    auto totalLogLikelihood = dataflow::CWiseAdd<double, dataflow::ReductionOf<double>>::create (
+      c, std::move (blockLogLikelihoods), Dimension<double> ());
+    r.totalLogLikelihood =
+      dataflow::CWiseNegate<double>::create (c, {totalLogLikelihood}, Dimension<double> ());
+    return r;
+  }
+
+#ifdef BPP_WITH_BEAGLE
+  /* Build the likelihood example as a single BeagleLogLikelihood node (see DataFlowBeagle.h).
+   *
+   * Tip likelihoods, site patterns and branch lengths are as in makeSimpleLikelihoodNodes.
+   * The whole conditional likelihood recursion runs in the BEAGLE instance.
+   * Inner nodes must have at least 2 sons. Derivatives are not available.
+   */
+  inline SimpleLikelihoodNodes makeBeagleLikelihoodNodes (dataflow::Context & c, const PhyloTree & tree,
+                                                          const VectorSiteContainer & sites,
+                                                          std::shared_ptr<dataflow::ConfiguredModel> model,
+                                                          long beaglePreferenceFlags = 0) {
+    const auto nbState = model->getValue ()->getNumberOfStates ();
+    const auto patterns = computeSitePatterns (sites);
+    SimpleLikelihoodNodes r;
+
+    if (!tree.isRooted ()) {
+      throw Exception ("PhyloTree must be rooted");
+    }
+    const FlatTopology topology (tree);
+    const StateIndicatorTable indicators (model->getValue ()->getStateMap ());
+
+    auto layout = std::make_shared<dataflow::BeagleTreeLayout> ();
+    layout->nbState = nbState;
+    layout->nbPattern = patterns.sites.size ();
+    for (auto w : patterns.weights)
+      layout->patternWeights.push_back (double(w));
+
+    // Tips take the first partial buffers.
+    const auto & postorder = topology.getPostorder ();
+    std::vector<int> buffers (topology.getNumberOfNodes ());
+    for (auto index : postorder) {
+      if (!topology.isLeaf (index))
+        continue;
+      const auto & name = tree.getNode (PhyloTree::NodeIndex (topology.getNodeId (index)))->getName ();
+      const auto sequenceIndex = sites.getSequencePosition (name);
+      Eigen::MatrixXd tipLikelihood (nbState, layout->nbPattern);
+      for (std::size_t pattern = 0; pattern < layout->nbPattern; ++pattern) {
+        const auto & values = indicators.getIndicators (sites.getSite (patterns.sites[pattern])[sequenceIndex]);
+        for (std::size_t state = 0; state < nbState; ++state) {
+          tipLikelihood (Eigen::Index (state), Eigen::Index (pattern)) = values[state];
+        }
+      }
+      buffers[index] = int(layout->tipLikelihoods.size ());
+      layout->tipLikelihoods.emplace_back (std::move (tipLikelihood));
+    }
+
+    // Inner nodes, sons first. Branch i (transition matrix buffer i) is brlenDeps[i].
+    // All nodes except the root have a branch: the identity matrix buffer is nbNodes - 1.
+    const int identityMatrix = int(topology.getNumberOfNodes () - 1);
+    dataflow::NodeRefVec brlenDeps;
+    std::vector<int> matrices (topology.getNumberOfNodes ());
+    int nextBuffer = int(layout->tipLikelihoods.size ());
+    for (auto index : postorder) {
+      if (index != topology.getRootIndex ()) {
+        const auto edgeIndex = PhyloTree::EdgeIndex (topology.getBranchId (index));
+        if (!topology.hasBranchLength (index)) {
+          throw Exception ("PhyloTree branch " + std::to_string (edgeIndex) + " has no length");
+        }
+        auto brlen = dataflow::NumericMutable<double>::create (c, topology.getBranchLength (index));
+        r.branchLengthValues.emplace (edgeIndex, brlen);
+        matrices[index] = int(brlenDeps.size ());
+        brlenDeps.emplace_back (std::move (brlen));
+      }
+      const auto nbSons = topology.getNumberOfSons (index);
+      if (nbSons == 0)
+        continue;
+      if (nbSons == 1) {
+        throw Exception ("makeBeagleLikelihoodNodes: nodes with one son are not supported");
+      }
+      // Chain of operations for multifurcations: intermediate results go through the identity matrix.
+      const auto first = topology.getSon (index, 0);
+      int partial = buffers[first];
+      int matrix = matrices[first];
+      for (std::size_t k = 1; k < nbSons; ++k) {
+        const auto son = topology.getSon (index, k);
+        layout->operations.push_back (
+          dataflow::BeagleTreeLayout::Operation{nextBuffer, partial, matrix, buffers[son], matrices[son]});
+        partial = nextBuffer++;
+        matrix = identityMatrix;
+      }
+      buffers[index] = partial;
+    }
+    layout->nbBranches = brlenDeps.size ();
+    layout->nbPartialBuffers = std::size_t (nextBuffer);
+    layout->rootBuffer = buffers[topology.getRootIndex ()];
+
+    dataflow::NodeRefVec deps{model};
+    deps.insert (deps.end (), brlenDeps.begin (), brlenDeps.end ());
+    auto logLikelihood =
+      dataflow::BeagleLogLikelihood::create (c, std::move (deps), std::move (layout), beaglePreferenceFlags);
+    r.totalLogLikelihood = dataflow::CWiseNegate<double>::create (c, {logLikelihood}, Dimension<double> ());
+    return r;
+  }
+#endif
+
   /* Wraps a dataflow::NumericMutable<double> as a bpp::Parameter.
    * 2 values exist: the one in the node, and the one in bpp::Parameter.
    * The dataflow one is considered to be the reference.
@@ -321,6 +1180,45 @@ namespace bpp {
       }
     }
 
+    /// Value, gradient and Hessian diagonal of the function for a set of variables.
+    struct ValueGradientHessianDiagonal {
+      double value;
+      std::vector<double> gradient;        // d(f)/d(variable[i])
+      std::vector<double> hessianDiagonal; // d2(f)/d(variable[i])2
+    };
+
+    /** @brief Compute value, gradient and Hessian diagonal for variables in one graph evaluation.
+     *
+     * All needed nodes are scheduled together, thus sub-expressions shared by the derivatives (like root
+     * conditional likelihoods) are computed once per call, instead of once per variable.
+     * If executor is not null, the evaluation is done in parallel.
+     */
+    ValueGradientHessianDiagonal
+    computeValueGradientAndHessianDiagonal (const std::vector<std::string> & variables,
+                                            dataflow::ParallelExecutor * executor = nullptr) const {
+      std::vector<dataflow::ValueRef<double>> firstOrderNodes;
+      std::vector<dataflow::ValueRef<double>> secondOrderNodes;
+      std::vector<dataflow::Node *> nodesToCompute{resultNode_.get ()};
+      for (const auto & variable : variables) {
+        firstOrderNodes.emplace_back (firstOrderDerivativeNode (variable));
+        secondOrderNodes.emplace_back (secondOrderDerivativeNode (variable, variable));
+        nodesToCompute.emplace_back (firstOrderNodes.back ().get ());
+        nodesToCompute.emplace_back (secondOrderNodes.back ().get ());
+      }
+      if (executor != nullptr) {
+        executor->computeRecursively (nodesToCompute);
+      } else {
+        dataflow::computeRecursively (nodesToCompute);
+      }
+      ValueGradientHessianDiagonal r;
+      r.value = resultNode_->accessValueConst ();
+      for (std::size_t i = 0; i < variables.size (); ++i) {
+        r.gradient.push_back (firstOrderNodes[i]->accessValueConst ());
+        r.hessianDiagonal.push_back (secondOrderNodes[i]->accessValueConst ());
+      }
+      return r;
+    }
+
   private:
     static dataflow::NumericMutable<double> & accessVariableNode (const Parameter & param) {
       return dynamic_cast<const DataFlowParameter &> (param).node ();
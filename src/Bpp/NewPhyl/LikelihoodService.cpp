@@ -0,0 +1,255 @@
+//
+// File: LikelihoodService.cpp
+// Authors:
+//   Julien Dutheil
+// Created: 2026-10-14
+// Last modified: 2026-10-14
+//
+
+/*
+  Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "LikelihoodService.h"
+#include "LikelihoodExample.h"
+
+#include <Bpp/Exceptions.h>
+
+#include "Bpp/Phyl/Tree/FlatTopology.h"
+
+#include <exception>
+#include <iterator>
+#include <utility>
+
+namespace bpp {
+  // Graph built for one topology, used by one worker at a time.
+  struct LikelihoodService::Engine {
+    std::string topologyKey;
+    dataflow::Context context;
+    std::unordered_map<std::string, std::shared_ptr<dataflow::NumericMutable<double>>> modelParameters;
+    std::vector<std::shared_ptr<dataflow::NumericMutable<double>>> branchLengths; // By FlatTopology index
+    dataflow::ValueRef<double> minusLogLikelihood;
+  };
+
+  namespace {
+    // Only change leaves with a different value, to keep the rest of the graph valid.
+    void setIfChanged (dataflow::NumericMutable<double> & leaf, double value) {
+      if (leaf.accessValueConst () != value) {
+        leaf.setValue (value);
+      }
+    }
+  } // namespace
+
+  LikelihoodService::LikelihoodService (const VectorSiteContainer & sites, const TransitionModel & model,
+                                        std::size_t nbThreads, std::size_t maxIdleEngines,
+                                        std::size_t maxBatchSize, std::size_t siteBlockSize)
+    : sites_ (sites), model_ (model.clone ()), maxIdleEngines_ (maxIdleEngines),
+      maxBatchSize_ (maxBatchSize > 0 ? maxBatchSize : 1), siteBlockSize_ (siteBlockSize) {
+    const auto & parameters = model_->getParameters ();
+    for (std::size_t i = 0; i < parameters.size (); ++i) {
+      defaultModelParameters_.emplace (model_->getParameterNameWithoutNamespace (parameters[i].getName ()),
+                                       parameters[i].getValue ());
+    }
+    const auto nbWorkers = nbThreads > 0 ? nbThreads : 1;
+    workers_.reserve (nbWorkers);
+    for (std::size_t i = 0; i < nbWorkers; ++i) {
+      workers_.emplace_back ([this] { workerLoop (); });
+    }
+  }
+
+  LikelihoodService::~LikelihoodService () {
+    {
+      std::lock_guard<std::mutex> lock (mutex_);
+      stopping_ = true;
+    }
+    requestAvailable_.notify_all ();
+    for (auto & worker : workers_) {
+      worker.join ();
+    }
+  }
+
+  std::future<double> LikelihoodService::submit (const LikelihoodRequest & request) {
+    if (request.tree == nullptr || !request.tree->isRooted ()) {
+      throw Exception ("LikelihoodService::submit: PhyloTree must be rooted");
+    }
+    PendingRequest pending;
+    pending.request = request;
+
+    // Key: number of sons of each node in preorder, and names of leaves.
+    const FlatTopology topology (*request.tree);
+    pending.branchLengths.resize (topology.getNumberOfNodes ());
+    for (std::size_t i = 0; i < topology.getNumberOfNodes (); ++i) {
+      const auto nbSons = topology.getNumberOfSons (i);
+      pending.topologyKey += std::to_string (nbSons);
+      if (nbSons == 0) {
+        pending.topologyKey +=
+          ':' + request.tree->getNode (PhyloTree::NodeIndex (topology.getNodeId (i)))->getName ();
+      }
+      pending.topologyKey += ';';
+      if (i != topology.getRootIndex ()) {
+        if (!topology.hasBranchLength (i)) {
+          throw Exception ("LikelihoodService::submit: PhyloTree branch " +
+                           std::to_string (topology.getBranchId (i)) + " has no length");
+        }
+        pending.branchLengths[i] = topology.getBranchLength (i);
+      }
+    }
+
+    auto future = pending.result.get_future ();
+    {
+      std::lock_guard<std::mutex> lock (mutex_);
+      queue_.push_back (std::move (pending));
+    }
+    requestAvailable_.notify_one ();
+    return future;
+  }
+
+  std::size_t LikelihoodService::nbEnginesBuilt () const {
+    std::lock_guard<std::mutex> lock (mutex_);
+    return nbEnginesBuilt_;
+  }
+
+  void LikelihoodService::workerLoop () {
+    std::unique_lock<std::mutex> lock (mutex_);
+    for (;;) {
+      requestAvailable_.wait (lock, [this] { return stopping_ || !queue_.empty (); });
+      if (queue_.empty ()) {
+        return; // Stopping, and all requests have been taken
+      }
+
+      // Batch the oldest request with queued requests of the same topology.
+      std::list<PendingRequest> batch;
+      const std::string topologyKey = queue_.front ().topologyKey;
+      for (auto it = queue_.begin (); it != queue_.end () && batch.size () < maxBatchSize_;) {
+        auto next = std::next (it);
+        if (it->topologyKey == topologyKey) {
+          batch.splice (batch.end (), queue_, it);
+        }
+        it = next;
+      }
+      auto engine = takeIdleEngine (topologyKey);
+      if (engine == nullptr) {
+        ++nbEnginesBuilt_;
+      }
+      lock.unlock ();
+
+      if (engine == nullptr) {
+        try {
+          engine = buildEngine (batch.front ());
+        } catch (...) {
+          // The graph depends only on the topology: all requests of the batch fail the same way.
+          for (auto & pending : batch) {
+            pending.result.set_exception (std::current_exception ());
+          }
+          lock.lock ();
+          continue;
+        }
+      }
+      for (auto & pending : batch) {
+        try {
+          pending.result.set_value (evaluate (*engine, pending));
+        } catch (...) {
+          pending.result.set_exception (std::current_exception ());
+        }
+      }
+
+      lock.lock ();
+      releaseEngine (std::move (engine));
+    }
+  }
+
+  std::unique_ptr<LikelihoodService::Engine> LikelihoodService::takeIdleEngine (const std::string & topologyKey) {
+    for (auto it = idleEngines_.begin (); it != idleEngines_.end (); ++it) {
+      if ((*it)->topologyKey == topologyKey) {
+        auto engine = std::move (*it);
+        idleEngines_.erase (it);
+        return engine;
+      }
+    }
+    return nullptr;
+  }
+
+  void LikelihoodService::releaseEngine (std::unique_ptr<Engine> && engine) {
+    idleEngines_.push_front (std::move (engine));
+    while (idleEngines_.size () > maxIdleEngines_) {
+      idleEngines_.pop_back ();
+    }
+  }
+
+  std::unique_ptr<LikelihoodService::Engine> LikelihoodService::buildEngine (const PendingRequest & request) const {
+    std::unique_ptr<Engine> engine (new Engine);
+    engine->topologyKey = request.topologyKey;
+    auto & c = engine->context;
+
+    std::unique_ptr<TransitionModel> model (model_->clone ());
+    engine->modelParameters = dataflow::createParameterMapForModel (c, *model);
+    auto & parameters = engine->modelParameters;
+    auto modelNode = dataflow::ConfiguredModel::create (
+      c,
+      dataflow::createDependencyVector (
+        *model, [&parameters] (const std::string & name) -> dataflow::NodeRef { return parameters[name]; }),
+      std::move (model));
+
+    // Engines are only evaluated: forward likelihoods need not be stored.
+    auto nodes = makeSimpleLikelihoodNodes (c, *request.request.tree, sites_, modelNode, siteBlockSize_, true);
+    engine->minusLogLikelihood = nodes.totalLogLikelihood;
+
+    // The same topology gives the same FlatTopology indexes: store branch length leaves by index.
+    const FlatTopology topology (*request.request.tree);
+    engine->branchLengths.resize (topology.getNumberOfNodes ());
+    for (std::size_t i = 0; i < topology.getNumberOfNodes (); ++i) {
+      if (i != topology.getRootIndex ()) {
+        engine->branchLengths[i] = nodes.branchLengthValues.at (PhyloTree::EdgeIndex (topology.getBranchId (i)));
+      }
+    }
+    return engine;
+  }
+
+  double LikelihoodService::evaluate (Engine & engine, const PendingRequest & request) const {
+    for (const auto & p : request.request.modelParameters) {
+      if (defaultModelParameters_.count (p.first) == 0) {
+        throw Exception ("LikelihoodService: unknown model parameter " + p.first);
+      }
+    }
+    for (const auto & p : defaultModelParameters_) {
+      const auto it = request.request.modelParameters.find (p.first);
+      setIfChanged (*engine.modelParameters.at (p.first),
+                    it != request.request.modelParameters.end () ? it->second : p.second);
+    }
+    for (std::size_t i = 0; i < engine.branchLengths.size (); ++i) {
+      if (engine.branchLengths[i] != nullptr) {
+        setIfChanged (*engine.branchLengths[i], request.branchLengths[i]);
+      }
+    }
+    return engine.minusLogLikelihood->getValue ();
+  }
+} // namespace bpp
@@ -0,0 +1,154 @@
+//
+// File: LikelihoodService.h
+// Authors:
+//   Julien Dutheil
+// Created: 2026-10-14
+// Last modified: 2026-10-14
+//
+
+/*
+  Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+  This software is a computer program whose purpose is to provide classes
+  for phylogenetic data analysis.
+
+  This software is governed by the CeCILL license under French law and
+  abiding by the rules of distribution of free software. You can use,
+  modify and/ or redistribute the software under the terms of the CeCILL
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty and the software's author, the holder of the
+  economic rights, and the successive licensors have only limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading, using, modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean that it is complicated to manipulate, and that also
+  therefore means that it is reserved for developers and experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and, more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef BPP_NEWPHYL_LIKELIHOODSERVICE_H
+#define BPP_NEWPHYL_LIKELIHOODSERVICE_H
+
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+#include "Bpp/Phyl/Model/SubstitutionModel.h"
+#include "Bpp/Phyl/Tree/PhyloTree.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** @file Asynchronous evaluation of many likelihood requests on one alignment.
+ */
+namespace bpp {
+  /// One likelihood evaluation: a tree with branch lengths, and model parameter values.
+  struct LikelihoodRequest {
+    /// Rooted tree, all branches except the root one must have a length.
+    std::shared_ptr<const PhyloTree> tree;
+    /// Values by non namespaced parameter name. Missing parameters take the value of the service model.
+    std::map<std::string, double> modelParameters;
+  };
+
+  /** @brief Evaluate likelihood requests concurrently, reusing dataflow graphs between requests.
+   *
+   * The service computes likelihoods for one alignment and one model family (the model given at construction).
+   * Requests are queued by submit(), and evaluated by a pool of worker threads created at construction.
+   *
+   * Building the likelihood graph (tip matrices, site patterns, nodes) is much more expensive than evaluating it.
+   * Thus each worker evaluates requests with an engine: a graph built for one topology (see makeSimpleLikelihoodNodes).
+   * Two trees have the same topology if they have the same nodes with the same son order and leaf names.
+   * An evaluation only changes branch length and model parameter leaves of the engine graph:
+   * values which do not depend on changed leaves (like tip matrices, or subtrees with unchanged branch lengths) are
+   * not computed again.
+   * Finished engines are kept for later requests with the same topology: the least recently used idle engines are
+   * destroyed above maxIdleEngines.
+   *
+   * A worker takes the oldest queued request, and all queued requests with the same topology (up to maxBatchSize).
+   * The batch is then evaluated in the same engine, without building a graph for each request.
+   * Different topologies are evaluated concurrently by different workers, each evaluation being single threaded.
+   *
+   * Values are -log(likelihood), as in makeSimpleLikelihoodNodes.
+   * Errors during evaluation (unknown parameter or sequence name, ...) are reported through the future.
+   */
+  class LikelihoodService {
+  public:
+    /** @brief Create a service with its worker threads.
+     * sites and model are copied.
+     * siteBlockSize is given to makeSimpleLikelihoodNodes for new engines.
+     */
+    LikelihoodService (const VectorSiteContainer & sites, const TransitionModel & model,
+                       std::size_t nbThreads = std::thread::hardware_concurrency (),
+                       std::size_t maxIdleEngines = 16, std::size_t maxBatchSize = 64,
+                       std::size_t siteBlockSize = 0);
+    /// Evaluate requests still in the queue, then stop worker threads.
+    ~LikelihoodService ();
+
+    LikelihoodService (const LikelihoodService &) = delete;
+    LikelihoodService & operator= (const LikelihoodService &) = delete;
+
+    /** @brief Queue a request, and return the future -log(likelihood).
+     * The tree is read immediately (topology and branch lengths), and can be changed after the call.
+     * @throw Exception if the tree is not rooted or lacks branch lengths.
+     */
+    std::future<double> submit (const LikelihoodRequest & request);
+
+    /// Number of worker threads.
+    std::size_t nbThreads () const noexcept { return workers_.size (); }
+    /// Number of engines built since construction (for statistics).
+    std::size_t nbEnginesBuilt () const;
+
+  private:
+    struct Engine;
+    struct PendingRequest {
+      LikelihoodRequest request;
+      std::string topologyKey;
+      std::vector<double> branchLengths; // By FlatTopology index (root value unused)
+      std::promise<double> result;
+    };
+
+    void workerLoop ();
+    std::unique_ptr<Engine> takeIdleEngine (const std::string & topologyKey);
+    void releaseEngine (std::unique_ptr<Engine> && engine);
+    std::unique_ptr<Engine> buildEngine (const PendingRequest & request) const;
+    double evaluate (Engine & engine, const PendingRequest & request) const;
+
+    const VectorSiteContainer sites_;
+    const std::unique_ptr<TransitionModel> model_;
+    std::map<std::string, double> defaultModelParameters_;
+    const std::size_t maxIdleEngines_;
+    const std::size_t maxBatchSize_;
+    const std::size_t siteBlockSize_;
+
+    // Queue, idle engines and counters are protected by mutex_.
+    // Idle engines are ordered from the most recently used.
+    mutable std::mutex mutex_;
+    std::list<PendingRequest> queue_{};
+    std::list<std::unique_ptr<Engine>> idleEngines_{};
+    std::size_t nbEnginesBuilt_{0};
+    bool stopping_{false};
+    std::condition_variable requestAvailable_;
+    std::vector<std::thread> workers_{};
+  };
+} // namespace bpp
+
+#endif // BPP_NEWPHYL_LIKELIHOODSERVICE_H
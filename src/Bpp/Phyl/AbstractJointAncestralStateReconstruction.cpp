@@ -0,0 +1,235 @@
+//
+// File: AbstractJointAncestralStateReconstruction.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "AbstractJointAncestralStateReconstruction.h"
+#include "SiteLoopExecutor.h"
+#include "Tree/TreeExceptions.h"
+
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <functional>
+#include <limits>
+
+using namespace std;
+
+/******************************************************************************/
+
+void AbstractJointAncestralStateReconstruction::reconstruct_()
+{
+  size_t nbNodes = nodeIds_.size();
+  nodeIndex_.clear();
+  for (size_t k = 0; k < nbNodes; ++k)
+    nodeIndex_[nodeIds_[k]] = k;
+
+  states_.assign(nbNodes, vector<size_t>(nbDistinctSites_, 0));
+
+  function<void(size_t, size_t)> loop = [&](size_t first, size_t last)
+  {
+    reconstructSites_(first, last);
+  };
+
+  if (nbThreads_ > 1)
+  {
+    SiteLoopExecutor executor(nbThreads_);
+    executor.run(nbDistinctSites_, loop);
+  }
+  else
+    loop(0, nbDistinctSites_);
+}
+
+/******************************************************************************/
+
+void AbstractJointAncestralStateReconstruction::reconstructSites_(size_t first, size_t last)
+{
+  size_t nbNodes = nodeIds_.size();
+  size_t n = nbStates_;
+  size_t n2 = n * n;
+  size_t root = nbNodes - 1;
+  const double minusInf = -numeric_limits<double>::infinity();
+
+  // For each node, the log likelihood of its subtree given its state
+  // (below), and the best state of the node given the state of its
+  // father (arg, for the current class and for the best class so far):
+  vector<double> below(nbNodes * n);
+  vector<size_t> arg(nbNodes * n);
+  vector<size_t> bestArg(nbNodes * n);
+
+  for (size_t i = first; i < last; ++i)
+  {
+    double bestScore = minusInf;
+    size_t bestRoot = 0;
+
+    for (size_t c = 0; c < nbClasses_; ++c)
+    {
+      for (size_t k = 0; k < nbNodes; ++k)
+      {
+        double* below_k = &below[k * n];
+        if (isLeaf_[k])
+        {
+          const double* leaf_i = &logLeaves_[k][i * n];
+          for (size_t y = 0; y < n; ++y)
+            below_k[y] = leaf_i[y];
+        }
+        else
+          for (size_t y = 0; y < n; ++y)
+            below_k[y] = 0;
+      }
+
+      // Nodes are in postorder, so the below array of a node is complete
+      // when the node is reached:
+      for (size_t k = 0; k < root; ++k)
+      {
+        const double* pxy = &logPxy_[(k * nbClasses_ + c) * n2];
+        const double* below_k = &below[k * n];
+        double* below_f = &below[fathers_[k] * n];
+        size_t* arg_k = &arg[k * n];
+        for (size_t x = 0; x < n; ++x)
+        {
+          const double* pxy_x = pxy + x * n;
+          double m = minusInf;
+          size_t a = 0;
+          for (size_t y = 0; y < n; ++y)
+          {
+            double v = pxy_x[y] + below_k[y];
+            if (v > m)
+            {
+              m = v;
+              a = y;
+            }
+          }
+          arg_k[x] = a;
+          below_f[x] += m;
+        }
+      }
+
+      const double* below_r = &below[root * n];
+      double m = minusInf;
+      size_t a = 0;
+      for (size_t y = 0; y < n; ++y)
+      {
+        double v = logRootFreqs_[y] + below_r[y];
+        if (v > m)
+        {
+          m = v;
+          a = y;
+        }
+      }
+
+      double score = logClassProbs_[c] + m;
+      if (c == 0 || score > bestScore)
+      {
+        bestScore = score;
+        bestRoot = a;
+        bestArg.swap(arg);
+      }
+    }
+
+    // Traceback, from the root to the leaves:
+    states_[root][i] = bestRoot;
+    for (size_t k = root; k > 0; --k)
+    {
+      size_t j = k - 1;
+      states_[j][i] = bestArg[j * n + states_[fathers_[j]][i]];
+    }
+  }
+}
+
+/******************************************************************************/
+
+size_t AbstractJointAncestralStateReconstruction::getNodeIndex_(int nodeId) const
+{
+  map<int, size_t>::const_iterator it = nodeIndex_.find(nodeId);
+  if (it == nodeIndex_.end())
+    throw NodeNotFoundException("AbstractJointAncestralStateReconstruction::getNodeIndex_.", nodeId);
+  return it->second;
+}
+
+/******************************************************************************/
+
+vector<size_t> AbstractJointAncestralStateReconstruction::getAncestralStatesForNode(int nodeId) const
+{
+  return states_[getNodeIndex_(nodeId)];
+}
+
+/******************************************************************************/
+
+map<int, vector<size_t> > AbstractJointAncestralStateReconstruction::getAllAncestralStates() const
+{
+  map<int, vector<size_t> > ancestors;
+  for (size_t k = 0; k < nodeIds_.size(); ++k)
+    ancestors[nodeIds_[k]] = states_[k];
+  return ancestors;
+}
+
+/******************************************************************************/
+
+Sequence* AbstractJointAncestralStateReconstruction::getAncestralSequenceForNode(int nodeId) const
+{
+  size_t k = getNodeIndex_(nodeId);
+  const vector<size_t>& states = states_[k];
+  vector<int> allStates(nbSites_);
+  for (size_t i = 0; i < nbSites_; i++)
+  {
+    allStates[i] = alphabetStates_[states[rootPatternLinks_[i]]];
+  }
+  string name = names_[k].empty() ? TextTools::toString(nodeId) : names_[k];
+  return new BasicSequence(name, allStates, alphabet_);
+}
+
+/******************************************************************************/
+
+AlignedSequenceContainer* AbstractJointAncestralStateReconstruction::getAncestralSequences() const
+{
+  AlignedSequenceContainer* asc = new AlignedSequenceContainer(alphabet_);
+  for (size_t k = 0; k < nodeIds_.size(); k++)
+  {
+    if (isLeaf_[k])
+      continue;
+    Sequence* seq = getAncestralSequenceForNode(nodeIds_[k]);
+    asc->addSequence(*seq);
+    delete seq;
+  }
+  return asc;
+}
+
+/******************************************************************************/
+
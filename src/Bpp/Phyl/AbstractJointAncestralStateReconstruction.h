@@ -0,0 +1,191 @@
+//
+// File: AbstractJointAncestralStateReconstruction.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _ABSTRACTJOINTANCESTRALSTATERECONSTRUCTION_H_
+#define _ABSTRACTJOINTANCESTRALSTATERECONSTRUCTION_H_
+
+#include "AncestralStateReconstruction.h"
+
+// From SeqLib:
+#include <Bpp/Seq/Alphabet/Alphabet.h>
+#include <Bpp/Seq/Container/AlignedSequenceContainer.h>
+#include <Bpp/Seq/Sequence.h>
+
+// From the STL:
+#include <vector>
+#include <map>
+#include <string>
+
+namespace bpp
+{
+
+/**
+ * @brief Likelihood ancestral states reconstruction: joint method.
+ *
+ * The states at all nodes maximizing the joint likelihood of a site are
+ * found with the dynamic programming algorithm of Pupko et al, in
+ * O(nodes * sites * states^2) time. For rate (or mixture) classes, the
+ * class maximizing its probability times the joint likelihood is chosen
+ * for each site, and the states are those of this class.
+ *
+ * Computations are done in log space on flat arrays, one site at a time,
+ * so that sites can be dealt with concurrently.
+ *
+ * This class does not depend on a likelihood engine: derived classes fill
+ * the topology, transition probabilities and leaf likelihoods from their
+ * own likelihood object, and then call reconstruct_().
+ *
+ * Reference:
+ * T Pupko, I Pe'er, R Shamir and D Graur (2000), _Mol Biol Evol_ 17(6) 890-6.
+ */
+  class AbstractJointAncestralStateReconstruction:
+    public virtual AncestralStateReconstruction
+  {
+  protected:
+    const Alphabet* alphabet_;
+    size_t nbSites_;
+    size_t nbDistinctSites_;
+    size_t nbClasses_;
+    size_t nbStates_;
+    std::vector<size_t> rootPatternLinks_;
+
+    /**
+     * @brief Node ids in postorder (the root is the last one), with the
+     * index of the father of each node in this vector, and node names.
+     */
+    std::vector<int> nodeIds_;
+    std::vector<size_t> fathers_;
+    std::vector<bool> isLeaf_;
+    std::vector<std::string> names_;
+
+    /**
+     * @brief Log transition probabilities, in
+     * [(node * nbClasses_ + class) * nbStates_ * nbStates_ + x * nbStates_ + y].
+     */
+    std::vector<double> logPxy_;
+
+    /**
+     * @brief Log leaf likelihoods for each node in [site * nbStates_ + state]
+     * (empty for inner nodes).
+     */
+    std::vector< std::vector<double> > logLeaves_;
+
+    std::vector<double> logRootFreqs_;
+    std::vector<double> logClassProbs_;
+
+    /**
+     * @brief Alphabet states of the model states.
+     */
+    std::vector<int> alphabetStates_;
+
+    size_t nbThreads_;
+
+  private:
+    std::vector< std::vector<size_t> > states_;
+    std::map<int, size_t> nodeIndex_;
+
+  public:
+    AbstractJointAncestralStateReconstruction(const Alphabet* alphabet, size_t nbThreads) :
+      alphabet_(alphabet),
+      nbSites_(0),
+      nbDistinctSites_(0),
+      nbClasses_(0),
+      nbStates_(0),
+      rootPatternLinks_(),
+      nodeIds_(),
+      fathers_(),
+      isLeaf_(),
+      names_(),
+      logPxy_(),
+      logLeaves_(),
+      logRootFreqs_(),
+      logClassProbs_(),
+      alphabetStates_(),
+      nbThreads_(nbThreads),
+      states_(),
+      nodeIndex_()
+    {}
+
+    virtual ~AbstractJointAncestralStateReconstruction() {}
+
+  public:
+
+    /**
+     * @brief Get ancestral states for a given node as a vector of int.
+     *
+     * The size of the vector is the number of distinct sites in the container
+     * associated to the likelihood object.
+     *
+     * @param nodeId The id of the node at which the states must be reconstructed.
+     * @return A vector of states indices.
+     * @throw NodeNotFoundException If the node is not in the tree.
+     */
+    std::vector<size_t> getAncestralStatesForNode(int nodeId) const;
+
+    /**
+     * @return The states of all nodes, leaves included, by node id.
+     */
+    std::map<int, std::vector<size_t> > getAllAncestralStates() const;
+
+    Sequence* getAncestralSequenceForNode(int nodeId) const;
+
+    AlignedSequenceContainer* getAncestralSequences() const;
+
+  protected:
+
+    /**
+     * @brief Compute the states of all nodes from the arrays filled by
+     * the derived class.
+     */
+    void reconstruct_();
+
+  private:
+
+    /**
+     * @brief Reconstruct the distinct sites in [first, last).
+     */
+    void reconstructSites_(size_t first, size_t last);
+
+    size_t getNodeIndex_(int nodeId) const;
+  };
+
+} // end of namespace bpp.
+
+#endif // _ABSTRACTJOINTANCESTRALSTATERECONSTRUCTION_H_
+
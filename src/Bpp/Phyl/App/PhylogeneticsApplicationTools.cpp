@@ -44,6 +44,7 @@
 #include "../Model/Protein/Coala.h"
 #include "../Model/FrequenciesSet/MvaFrequenciesSet.h"
 #include "../Likelihood/TreeLikelihood.h"
+#include "../Likelihood/MemoryUsage.h"
 #include "../Mapping/LaplaceSubstitutionCount.h"
 #include "../Mapping/UniformizationSubstitutionCount.h"
 #include "../Mapping/DecompositionSubstitutionCount.h"
@@ -2741,7 +2742,8 @@ bpp::TreeLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
   const string& suffix,
   bool suffixIsOptional,
   bool verbose,
-  int warn)
+  int warn,
+  OptimizationWarmStart* warmStart)
 {
   string optimization = ApplicationTools::getStringParameter("optimization", params, "FullD(derivatives=Newton)", suffix, suffixIsOptional, warn);
   if (optimization == "None")
@@ -2770,6 +2772,14 @@ bpp::TreeLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
   if (verbose)
     ApplicationTools::displayResult("Profiler", prPath);
 
+  string profilePath = ApplicationTools::getAFilePath("optimization.profile", params, false, false, suffix, suffixIsOptional, "none", warn + 1);
+  string profileFormat = ApplicationTools::getStringParameter("optimization.profile.format", params, "csv", suffix, suffixIsOptional, warn + 1);
+  if (profileFormat != "csv" && profileFormat != "json")
+    throw Exception("Unknown optimization profile format: " + profileFormat);
+  unique_ptr<OptimizationProfile> profile(profilePath == "none" ? 0 : new OptimizationProfile());
+  if (verbose && profile)
+    ApplicationTools::displayResult("Optimization profile", profilePath + " (" + profileFormat + ")");
+
   bool scaleFirst = ApplicationTools::getBooleanParameter("optimization.scale_first", params, false, suffix, suffixIsOptional, warn);
   if (scaleFirst)
   {
@@ -2973,6 +2983,35 @@ bpp::TreeLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
   if (verbose)
     ApplicationTools::displayResult("Tolerance", TextTools::toString(tolerance));
 
+  // Loose tolerance first, tightened over successive rounds:
+  unique_ptr<ToleranceSchedule> schedule;
+  double initialTolerance = ApplicationTools::getDoubleParameter("optimization.tolerance.initial", params, tolerance, suffix, suffixIsOptional, warn + 1);
+  if (initialTolerance > tolerance)
+  {
+    double toleranceFactor = ApplicationTools::getDoubleParameter("optimization.tolerance.factor", params, 0.1, suffix, suffixIsOptional, warn + 1);
+    if (toleranceFactor <= 0 || toleranceFactor >= 1)
+      throw Exception("PhylogeneticsApplicationTools::optimizeParameters. optimization.tolerance.factor should be in ]0,1[.");
+    schedule.reset(new ToleranceSchedule(initialTolerance, toleranceFactor));
+    if (verbose)
+      ApplicationTools::displayResult("Initial tolerance", TextTools::toString(initialTolerance));
+  }
+
+  // Starting from a previous run?
+  if (warmStart && warmStart->hasState())
+  {
+    ParameterList previous = warmStart->getParameters().getCommonParametersWith(tl->getParameters());
+    tl->matchParametersValues(previous);
+    parametersToEstimate.matchParametersValues(tl->getParameters());
+    if (verbose)
+      ApplicationTools::displayResult("Warm start from previous run", TextTools::toString(previous.size()) + " parameters");
+    if (warmStart->isLocalTreeChange())
+    {
+      parametersToEstimate = parametersToEstimate.getCommonParametersWith(tl->getBranchLengthsParameters());
+      if (verbose)
+        ApplicationTools::displayMessage("Local tree change: only branch lengths are estimated.");
+    }
+  }
+
   // Backing up or restoring?
   unique_ptr<BackupListener> backupListener;
   string backupFile = ApplicationTools::getAFilePath("optimization.backup.file", params, false, false);
@@ -3088,10 +3127,12 @@ bpp::TreeLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
       unsigned int topoNbStep = ApplicationTools::getParameter<unsigned int>("optimization.topology.nstep", params, 1, "", true, warn + 1);
       double tolBefore = ApplicationTools::getDoubleParameter("optimization.topology.tolerance.before", params, 100, suffix, suffixIsOptional, warn + 1);
       double tolDuring = ApplicationTools::getDoubleParameter("optimization.topology.tolerance.during", params, 100, suffix, warn + 1);
+      int localDistance = ApplicationTools::getIntParameter("optimization.topology.local_distance", params, -1, suffix, suffixIsOptional, warn + 1);
+      double nniScreening = ApplicationTools::getDoubleParameter("optimization.topology.nni_screening", params, std::numeric_limits<double>::infinity(), suffix, suffixIsOptional, warn + 1);
       tl = OptimizationTools::optimizeTreeNNI(
         dynamic_cast<NNIHomogeneousTreeLikelihood*>(tl), parametersToEstimate,
         optNumFirst, tolBefore, tolDuring, nbEvalMax, topoNbStep, messageHandler, profiler,
-        reparam, optVerbose, optMethodDeriv, nstep, nniAlgo);
+        reparam, optVerbose, optMethodDeriv, nstep, nniAlgo, nniScreening, localDistance);
     }
 
     if (verbose && nstep > 1)
@@ -3099,7 +3140,7 @@ bpp::TreeLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
     parametersToEstimate.matchParametersValues(tl->getParameters());
     n = OptimizationTools::optimizeNumericalParameters(
       dynamic_cast<DiscreteRatesAcrossSitesTreeLikelihood*>(tl), parametersToEstimate,
-      backupListener.get(), nstep, tolerance, nbEvalMax, messageHandler, profiler, reparam, optVerbose, optMethodDeriv, optMethodModel);
+      backupListener.get(), nstep, tolerance, nbEvalMax, messageHandler, profiler, reparam, optVerbose, optMethodDeriv, optMethodModel, 1, profile.get(), schedule.get());
   }
   else if (optName == "FullD")
   {
@@ -3111,16 +3152,18 @@ bpp::TreeLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
       unsigned int topoNbStep = ApplicationTools::getParameter<unsigned int>("optimization.topology.nstep", params, 1, "", true, warn + 1);
       double tolBefore = ApplicationTools::getDoubleParameter("optimization.topology.tolerance.before", params, 100, suffix, suffixIsOptional, warn + 1);
       double tolDuring = ApplicationTools::getDoubleParameter("optimization.topology.tolerance.during", params, 100, suffix, suffixIsOptional, warn + 1);
+      int localDistance = ApplicationTools::getIntParameter("optimization.topology.local_distance", params, -1, suffix, suffixIsOptional, warn + 1);
+      double nniScreening = ApplicationTools::getDoubleParameter("optimization.topology.nni_screening", params, std::numeric_limits<double>::infinity(), suffix, suffixIsOptional, warn + 1);
       tl = OptimizationTools::optimizeTreeNNI2(
         dynamic_cast<NNIHomogeneousTreeLikelihood*>(tl), parametersToEstimate,
         optNumFirst, tolBefore, tolDuring, nbEvalMax, topoNbStep, messageHandler, profiler,
-        reparam, optVerbose, optMethodDeriv, nniAlgo);
+        reparam, optVerbose, optMethodDeriv, nniAlgo, nniScreening, localDistance);
     }
 
     parametersToEstimate.matchParametersValues(tl->getParameters());
     n = OptimizationTools::optimizeNumericalParameters2(
       dynamic_cast<DiscreteRatesAcrossSitesTreeLikelihood*>(tl), parametersToEstimate,
-      backupListener.get(), tolerance, nbEvalMax, messageHandler, profiler, reparam, useClock, optVerbose, optMethodDeriv);
+      backupListener.get(), tolerance, nbEvalMax, messageHandler, profiler, reparam, useClock, optVerbose, optMethodDeriv, profile.get());
   }
   else
     throw Exception("Unknown optimization method: " + optName);
@@ -3157,8 +3200,18 @@ bpp::TreeLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
     delete finalOptimizer;
   }
 
+  if (warmStart)
+    warmStart->record(tl->getParameters(), tl->getBranchLengthsParameters(), tl->getValue());
   if (verbose)
     ApplicationTools::displayResult("Performed", TextTools::toString(n) + " function evaluations.");
+  if (profile)
+  {
+    ofstream profileOut(profilePath.c_str(), ios::out);
+    if (profileFormat == "json")
+      profile->writeJson(profileOut);
+    else
+      profile->writeCsv(profileOut);
+  }
   if (backupFile != "none")
   {
     string bf=backupFile+".def";
@@ -3176,7 +3229,8 @@ PhyloLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
   const string& suffix,
   bool suffixIsOptional,
   bool verbose,
-  int warn)
+  int warn,
+  OptimizationWarmStart* warmStart)
 {
   string optimization = ApplicationTools::getStringParameter("optimization", params, "FullD(derivatives=Newton)", suffix, suffixIsOptional, warn);
   if (optimization == "None")
@@ -3205,6 +3259,14 @@ PhyloLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
   if (verbose)
     ApplicationTools::displayResult("Profiler", prPath);
 
+  string profilePath = ApplicationTools::getAFilePath("optimization.profile", params, false, false, suffix, suffixIsOptional, "none", warn + 1);
+  string profileFormat = ApplicationTools::getStringParameter("optimization.profile.format", params, "csv", suffix, suffixIsOptional, warn + 1);
+  if (profileFormat != "csv" && profileFormat != "json")
+    throw Exception("Unknown optimization profile format: " + profileFormat);
+  unique_ptr<OptimizationProfile> profile(profilePath == "none" ? 0 : new OptimizationProfile());
+  if (verbose && profile)
+    ApplicationTools::displayResult("Optimization profile", profilePath + " (" + profileFormat + ")");
+
   bool scaleFirst = ApplicationTools::getBooleanParameter("optimization.scale_first", params, false, suffix, suffixIsOptional, warn + 1);
   if (scaleFirst)
   {
@@ -3379,6 +3441,35 @@ PhyloLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
   if (verbose)
     ApplicationTools::displayResult("Tolerance", TextTools::toString(tolerance));
 
+  // Loose tolerance first, tightened over successive rounds:
+  unique_ptr<ToleranceSchedule> schedule;
+  double initialTolerance = ApplicationTools::getDoubleParameter("optimization.tolerance.initial", params, tolerance, suffix, suffixIsOptional, warn + 1);
+  if (initialTolerance > tolerance)
+  {
+    double toleranceFactor = ApplicationTools::getDoubleParameter("optimization.tolerance.factor", params, 0.1, suffix, suffixIsOptional, warn + 1);
+    if (toleranceFactor <= 0 || toleranceFactor >= 1)
+      throw Exception("PhylogeneticsApplicationTools::optimizeParameters. optimization.tolerance.factor should be in ]0,1[.");
+    schedule.reset(new ToleranceSchedule(initialTolerance, toleranceFactor));
+    if (verbose)
+      ApplicationTools::displayResult("Initial tolerance", TextTools::toString(initialTolerance));
+  }
+
+  // Starting from a previous run?
+  if (warmStart && warmStart->hasState())
+  {
+    ParameterList previous = warmStart->getParameters().getCommonParametersWith(lik->getParameters());
+    lik->matchParametersValues(previous);
+    parametersToEstimate.matchParametersValues(lik->getParameters());
+    if (verbose)
+      ApplicationTools::displayResult("Warm start from previous run", TextTools::toString(previous.size()) + " parameters");
+    if (warmStart->isLocalTreeChange())
+    {
+      parametersToEstimate = parametersToEstimate.getCommonParametersWith(lik->getBranchLengthParameters());
+      if (verbose)
+        ApplicationTools::displayMessage("Local tree change: only branch lengths are estimated.");
+    }
+  }
+
   // Backing up or restoring?
   unique_ptr<BackupListener> backupListener;
   string backupFile = ApplicationTools::getAFilePath("optimization.backup.file", params, false, false, suffix, suffixIsOptional, "none", warn + 1);
@@ -3508,7 +3599,7 @@ PhyloLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
     parametersToEstimate.matchParametersValues(lik->getParameters());
     n = OptimizationTools::optimizeNumericalParameters(
       lik, parametersToEstimate,
-      backupListener.get(), nstep, tolerance, nbEvalMax, messageHandler, profiler, reparam, optVerbose, optMethodDeriv, optMethodModel);
+      backupListener.get(), nstep, tolerance, nbEvalMax, messageHandler, profiler, reparam, optVerbose, optMethodDeriv, optMethodModel, profile.get(), schedule.get());
   }
   else if (optName == "FullD")
   {
@@ -3531,7 +3622,7 @@ PhyloLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
 
     n = OptimizationTools::optimizeNumericalParameters2(
       lik, parametersToEstimate,
-      backupListener.get(), tolerance, nbEvalMax, messageHandler, profiler, reparam, useClock, optVerbose, optMethodDeriv);
+      backupListener.get(), tolerance, nbEvalMax, messageHandler, profiler, reparam, useClock, optVerbose, optMethodDeriv, profile.get());
 
   }
   else
@@ -3569,8 +3660,18 @@ PhyloLikelihood* PhylogeneticsApplicationTools::optimizeParameters(
     delete finalOptimizer;
   }
 
+  if (warmStart)
+    warmStart->record(lik->getParameters(), lik->getBranchLengthParameters(), lik->getValue());
   if (verbose)
     ApplicationTools::displayResult("Performed", TextTools::toString(n) + " function evaluations.");
+  if (profile)
+  {
+    ofstream profileOut(profilePath.c_str(), ios::out);
+    if (profileFormat == "json")
+      profile->writeJson(profileOut);
+    else
+      profile->writeCsv(profileOut);
+  }
   if (backupFile != "none")
   {
     string bf=backupFile+".def";
@@ -4681,6 +4782,10 @@ void PhylogeneticsApplicationTools::printAnalysisInformation(const SingleDataPhy
   if (dynamic_cast<const SingleProcessPhyloLikelihood*>(&phyloLike) != NULL)
   {
     const SingleProcessPhyloLikelihood* pSPL = dynamic_cast<const SingleProcessPhyloLikelihood*>(&phyloLike);
+
+    MemoryUsage usage;
+    pSPL->getMemoryUsage(usage);
+    usage.display();
     
     StlOutputStream out(new ofstream(infosFile.c_str(), ios::out));
     
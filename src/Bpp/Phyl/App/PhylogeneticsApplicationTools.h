@@ -50,6 +50,7 @@
 #include "../Likelihood/HomogeneousTreeLikelihood.h"
 #include "../Likelihood/ClockTreeLikelihood.h"
 #include "../Mapping/SubstitutionCount.h"
+#include "../OptimizationWarmStart.h"
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/Io/OutputStream.h>
 #include <Bpp/Numeric/Prob/DiscreteDistribution.h>
@@ -781,6 +782,10 @@ namespace bpp
      * @param suffixIsOptional Tell if the suffix is absolutely required.
      * @param verbose          Print some info to the 'message' output stream.
      * @param warn             Set the warning level (0: always display warnings, >0 display warnings on demand).
+     * @param warmStart        If not null and holding a previous state, model parameters
+     *                         start from their previously converged values, and only branch
+     *                         lengths are estimated if the tree change is local. The converged
+     *                         parameters of this run are then stored in it.
      * @return A pointer toward the final likelihood object.
      * This pointer may be the same as passed in argument (tl), but in some cases the algorithm
      * clone this object. We may change this bahavior in the future...
@@ -797,7 +802,8 @@ namespace bpp
       const std::string& suffix = "",
       bool suffixIsOptional = true,
       bool verbose = true,
-      int warn = 1);
+      int warn = 1,
+      OptimizationWarmStart* warmStart = 0);
     
     static PhyloLikelihood* optimizeParameters(
       PhyloLikelihood* lik,
@@ -806,7 +812,8 @@ namespace bpp
       const std::string& suffix = "",
       bool suffixIsOptional = true,
       bool verbose = true,
-      int warn = 1);
+      int warn = 1,
+      OptimizationWarmStart* warmStart = 0);
     
     /**
      * @brief Optimize parameters according to options, with a molecular clock.
@@ -837,6 +844,7 @@ namespace bpp
      * A warning message will be output for each problematic parameter.
      *
      * @param pl A list of parameters. Parameters without constraint will be ignored.
+     * @see TreeLikelihoodTools::computeCovarianceMatrix() for the standard errors of the other parameters.
      */
     static void checkEstimatedParameters(const ParameterList& pl);
 
@@ -1054,6 +1062,9 @@ namespace bpp
     /**
      * @brief Output information on the computation to a file.
      *
+     * The memory held by the likelihood arrays of single process
+     * likelihoods is also displayed (see MemoryUsage).
+     *
      * @param phylolike The phylolikelihood to serialize.
      * @param infosFile   The name of the file where to print.
      * @param warn  Set the warning level (0: always display warnings, >0 display warnings on demand).
@@ -0,0 +1,109 @@
+//
+// File: BranchwiseNewtonOptimizer.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BRANCHWISENEWTONOPTIMIZER_H_
+#define _BRANCHWISENEWTONOPTIMIZER_H_
+
+#include "Likelihood/DRHomogeneousTreeLikelihood.h"
+
+#include <Bpp/Numeric/Function/AbstractOptimizer.h>
+
+namespace bpp
+{
+
+  /**
+   * @brief This Optimizer optimizes branch lengths one at a time, with
+   * 1-D Newton steps, as in PhyML or RAxML.
+   *
+   * Each step is one pass over the tree (see
+   * DRHomogeneousTreeLikelihood::optimizeBranchLengthsOneByOne), where
+   * each branch is optimized from the conditional likelihoods at its
+   * ends only, the likelihood of the whole tree being computed once at
+   * the end of the pass. Parameters other than branch lengths are
+   * ignored.
+   */
+  class BranchwiseNewtonOptimizer:
+    public AbstractOptimizer
+  {
+  private:
+    DRHomogeneousTreeLikelihood* likelihood_;
+
+    std::vector<std::string> params_; // All parameter names
+
+    double brLenTolerance_;
+
+    unsigned int maxNbNewtonSteps_;
+
+  public:
+
+    BranchwiseNewtonOptimizer(DRHomogeneousTreeLikelihood* tl);
+
+    virtual ~BranchwiseNewtonOptimizer() {}
+
+    BranchwiseNewtonOptimizer* clone() const { return new BranchwiseNewtonOptimizer(*this); }
+
+  public:
+    /**
+     * @name The Optimizer interface.
+     *
+     * @{
+     */
+    double getFunctionValue() const { return currentValue_; }
+    /** @} */
+
+    void doInit(const ParameterList& params);
+
+    double doStep();
+
+    /**
+     * @brief Set the tolerance on each branch length within a pass (0.000001 by default).
+     */
+    void setBranchLengthTolerance(double tolerance) { brLenTolerance_ = tolerance; }
+
+    /**
+     * @brief Set the maximum number of Newton steps on each branch within a pass (10 by default).
+     */
+    void setMaximumNumberOfNewtonSteps(unsigned int mx) { maxNbNewtonSteps_ = mx; }
+
+  };
+
+} //end of namespace bpp.
+
+#endif //_BRANCHWISENEWTONOPTIMIZER_H_
+
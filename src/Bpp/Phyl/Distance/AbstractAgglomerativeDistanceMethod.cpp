@@ -46,6 +46,8 @@ knowledge of the CeCILL license and that you accept its terms.
 using namespace bpp;
 
 // From the STL:
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 using namespace std;
@@ -61,6 +63,12 @@ void AbstractAgglomerativeDistanceMethod::setDistanceMatrix(const DistanceMatrix
     
 void AbstractAgglomerativeDistanceMethod::computeTree()
 {
+  if (rootTree_ && isReducible())
+  {
+    computeTreeWithNearestNeighborChain_();
+    return;
+  }
+
   // Initialization:
   for (size_t i = 0; i < matrix_.size(); ++i)
   {
@@ -75,37 +83,141 @@ void AbstractAgglomerativeDistanceMethod::computeTree()
     if (verbose_)
       ApplicationTools::displayGauge(matrix_.size() - currentNodes_.size(), matrix_.size() - (rootTree_ ? 2 : 3) - 1);
     vector<size_t> bestPair = getBestPair();
-    vector<double> distances = computeBranchLengthsForPair(bestPair);
-    Node* best1 = currentNodes_[bestPair[0]];
-    Node* best2 = currentNodes_[bestPair[1]];
-    // Distances may be used by getParentNodes (PGMA for instance).
-    best1->setDistanceToFather(distances[0]);
-    best2->setDistanceToFather(distances[1]);
-    Node* parent = getParentNode(idNextNode, best1, best2);
+    agglomerate_(bestPair, idNextNode, newDist);
     idNextNode++;
-    for (map<size_t, Node *>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  }
+  finalStep(idNextNode);
+}
+
+Node* AbstractAgglomerativeDistanceMethod::agglomerate_(const vector<size_t>& pair, int id, vector<double>& newDist)
+{
+  vector<double> distances = computeBranchLengthsForPair(pair);
+  Node* best1 = currentNodes_[pair[0]];
+  Node* best2 = currentNodes_[pair[1]];
+  // Distances may be used by getParentNodes (PGMA for instance).
+  best1->setDistanceToFather(distances[0]);
+  best2->setDistanceToFather(distances[1]);
+  Node* parent = getParentNode(id, best1, best2);
+  vector<size_t> ids;
+  ids.reserve(currentNodes_.size());
+  for (map<size_t, Node *>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  {
+    ids.push_back(i->first);
+  }
+  runParallelLoop_(ids.size(), [&](size_t first, size_t last)
+  {
+    for (size_t k = first; k < last; k++)
     {
-      size_t id = i->first;
-      if (id != bestPair[0] && id != bestPair[1])
+      size_t idk = ids[k];
+      if (idk != pair[0] && idk != pair[1])
       {
-        assert (id < newDist.size()); //DEBUG
-        newDist[id] = computeDistancesFromPair(bestPair, distances, id);
+        assert (idk < newDist.size()); //DEBUG
+        newDist[idk] = computeDistancesFromPair(pair, distances, idk);
       }
       else
       {
-        newDist[id] = 0;
+        newDist[idk] = 0;
       }
     }
-    // Actualize currentNodes_:
-    currentNodes_[bestPair[0]] = parent;
-    currentNodes_.erase(bestPair[1]);
-    for (map<size_t, Node *>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  });
+  // Actualize currentNodes_:
+  currentNodes_[pair[0]] = parent;
+  currentNodes_.erase(pair[1]);
+  for (map<size_t, Node *>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  {
+    size_t idk = i->first;
+    matrix_(pair[0], idk) = matrix_(idk, pair[0]) = newDist[idk];
+  }
+  return parent;
+}
+
+void AbstractAgglomerativeDistanceMethod::computeTreeWithNearestNeighborChain_()
+{
+  size_t n = matrix_.size();
+  for (size_t i = 0; i < n; ++i)
+  {
+    currentNodes_[i] = getLeafNode(static_cast<int>(i), matrix_.getName(i));
+  }
+  vector<double> newDist(n);
+
+  // Agglomerated pairs are not found by increasing distance: inner nodes
+  // are renumbered at the end according to the distance of their pair.
+  vector< pair<double, Node*> > parents;
+  parents.reserve(n - 2);
+  vector<size_t> chain;
+  while (currentNodes_.size() > 2)
+  {
+    if (verbose_)
+      ApplicationTools::displayGauge(n - currentNodes_.size(), n - 3);
+    if (chain.empty())
+      chain.push_back(currentNodes_.begin()->first);
+    size_t a = chain.back();
+
+    // Nearest neighbor of the end of the chain, the previous node of the chain
+    // being kept in case of ties (which ensures that the chain stops growing),
+    // and then the smallest index:
+    size_t b = n;
+    double distMin = -std::log(0.);
+    if (chain.size() > 1)
+    {
+      b = chain[chain.size() - 2];
+      distMin = matrix_(a, b);
+    }
+    for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
     {
       size_t id = i->first;
-      matrix_(bestPair[0], id) = matrix_(id, bestPair[0]) = newDist[id];
-    }  
+      if (id == a)
+        continue;
+      double dist = matrix_(a, id);
+      if (dist < distMin)
+      {
+        distMin = dist;
+        b = id;
+      }
+    }
+    if (b == n)
+      throw Exception("Unexpected error: no minimum found in the distance matrix.");
+
+    if (chain.size() > 1 && b == chain[chain.size() - 2])
+    {
+      // a and b are reciprocal nearest neighbors:
+      chain.pop_back();
+      chain.pop_back();
+      vector<size_t> bestPair(2);
+      bestPair[0] = min(a, b);
+      bestPair[1] = max(a, b);
+      Node* parent = agglomerate_(bestPair, static_cast<int>(n + parents.size()), newDist);
+      parents.push_back(make_pair(distMin, parent));
+    }
+    else
+      chain.push_back(b);
   }
-  finalStep(idNextNode);
+
+  stable_sort(parents.begin(), parents.end(),
+      [](const pair<double, Node*>& p1, const pair<double, Node*>& p2) { return p1.first < p2.first; });
+  for (size_t i = 0; i < parents.size(); i++)
+  {
+    parents[i].second->setId(static_cast<int>(n + i));
+  }
+  finalStep(static_cast<int>(n + parents.size()));
+}
+
+void AbstractAgglomerativeDistanceMethod::setNumberOfThreads(size_t nbThreads)
+{
+  if (nbThreads == getNumberOfThreads())
+    return;
+  if (nbThreads <= 1)
+    executor_.reset();
+  else
+    executor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
+void AbstractAgglomerativeDistanceMethod::runParallelLoop_(size_t size, const std::function<void(size_t, size_t)>& loop) const
+{
+  if (executor_)
+    executor_->run(size, loop);
+  else if (size > 0)
+    loop(0, size);
 }
 
 Node* AbstractAgglomerativeDistanceMethod::getLeafNode(int id, const std::string& name)
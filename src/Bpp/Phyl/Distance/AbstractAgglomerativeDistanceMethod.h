@@ -44,9 +44,12 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "DistanceMethod.h"
 #include "../Tree/Node.h"
 #include "../Tree/TreeTemplate.h"
+#include "../SiteLoopExecutor.h"
 
 // From the STL:
+#include <functional>
 #include <map>
+#include <memory>
 
 namespace bpp
 {
@@ -69,16 +72,19 @@ class AbstractAgglomerativeDistanceMethod:
     std::map<size_t, Node*> currentNodes_;
     bool verbose_;
     bool rootTree_;
+
+  private:
+    std::unique_ptr<SiteLoopExecutor> executor_;
 	
 	public:
 		//AbstractAgglomerativeDistanceMethod() :
     //  matrix_(0), tree_(0), currentNodes_(), verbose_(true), rootTree_(false) {}
 
 		AbstractAgglomerativeDistanceMethod(bool verbose = true, bool rootTree = false) :
-      matrix_(0), tree_(0), currentNodes_(), verbose_(verbose), rootTree_(rootTree) {}
+      matrix_(0), tree_(0), currentNodes_(), verbose_(verbose), rootTree_(rootTree), executor_() {}
 		
     AbstractAgglomerativeDistanceMethod(const DistanceMatrix& matrix, bool verbose = true, bool rootTree = false) :
-      matrix_(0), tree_(0), currentNodes_(), verbose_(verbose), rootTree_(rootTree)
+      matrix_(0), tree_(0), currentNodes_(), verbose_(verbose), rootTree_(rootTree), executor_()
     {
       setDistanceMatrix(matrix);
     }
@@ -90,11 +96,12 @@ class AbstractAgglomerativeDistanceMethod:
     }
     
     AbstractAgglomerativeDistanceMethod(const AbstractAgglomerativeDistanceMethod& a) :
-      matrix_(a.matrix_), tree_(0), currentNodes_(), verbose_(a.verbose_), rootTree_(a.rootTree_)
+      matrix_(a.matrix_), tree_(0), currentNodes_(), verbose_(a.verbose_), rootTree_(a.rootTree_), executor_()
     {
       // Hard copy of inner tree:
       if (a.tree_)
         tree_ = new TreeTemplate<Node>(* a.tree_);
+      setNumberOfThreads(a.getNumberOfThreads());
     }
 
     AbstractAgglomerativeDistanceMethod& operator=(const AbstractAgglomerativeDistanceMethod& a)
@@ -107,6 +114,7 @@ class AbstractAgglomerativeDistanceMethod:
       currentNodes_.clear();
       verbose_ = a.verbose_;
       rootTree_ = a.rootTree_;
+      setNumberOfThreads(a.getNumberOfThreads());
       return *this;
     }
 
@@ -138,12 +146,35 @@ class AbstractAgglomerativeDistanceMethod:
      * 5) For each remaining node, update distances from the pair (computeDistancesFromPair method)
      * 6) Return to step 2 while there are more than 3 remaining nodes.
      * 7) Perform the final step, and send a rooted or unrooted tree.
+     *
+     * For rooted trees built with a reducible linkage (see isReducible()),
+     * the pairs are found with the nearest-neighbor chain algorithm instead,
+     * which needs O(n^2) distance evaluations instead of O(n^3). The pairs
+     * merged and the tree are the same as with the best-pair search when
+     * there are no ties, and inner nodes are numbered by increasing
+     * distance of the pair agglomerated, so that their ids are the same too.
      */
 		virtual void computeTree();
 
     void setVerbose(bool yn) { verbose_ = yn; }
     bool isVerbose() const { return verbose_; }
 
+    /**
+     * @brief Set the number of threads used at each agglomeration step
+     * (1 by default, ie no additional thread).
+     *
+     * The distance updates, and the search of the best pair in methods
+     * supporting it, are split into one block of nodes per thread. Ties are
+     * broken by node indices, so that the tree does not depend on the number
+     * of threads. With several threads, computeDistancesFromPair() is called
+     * concurrently for distinct nodes.
+     *
+     * @param nbThreads The total number of threads, including the calling one.
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    size_t getNumberOfThreads() const { return executor_ ? executor_->getNumberOfThreads() : 1; }
+
 	protected:
     /**
      * @name Specific methods.
@@ -194,6 +225,20 @@ class AbstractAgglomerativeDistanceMethod:
      */
     virtual void finalStep(int idRoot) = 0;
 
+    /**
+     * @brief Tell if the linkage is reducible, and the best pair the closest one.
+     *
+     * The linkage is reducible if the distance from the agglomerated pair
+     * to any other node is never smaller than the distance between the
+     * two nodes of the pair. This is the case for single, complete, average
+     * and Ward linkages, but not for median or centroid ones.
+     * Subclasses returning true must select the pair with the smallest
+     * distance in getBestPair(), which is then not called.
+     *
+     * @return false by default.
+     */
+    virtual bool isReducible() const { return false; }
+
     /**
      * @brief Get a leaf node.
      *
@@ -217,6 +262,30 @@ class AbstractAgglomerativeDistanceMethod:
      */
 		virtual Node* getParentNode(int id, Node * son1, Node * son2);
     /** @} */
+
+    /**
+     * @brief Run a loop over [0, size), split into blocks when several threads are used.
+     *
+     * @param size The number of iterations.
+     * @param loop A function computing iterations in [first, last).
+     */
+    void runParallelLoop_(size_t size, const std::function<void(size_t, size_t)>& loop) const;
+
+  private:
+    /**
+     * @brief Agglomerate a pair of nodes and update the distances to the new one.
+     *
+     * @param pair The indices of the nodes to agglomerate.
+     * @param id The id of the new node.
+     * @param newDist A vector of the size of the matrix, for computations.
+     * @return The new node, stored at index pair[0].
+     */
+    Node* agglomerate_(const std::vector<size_t>& pair, int id, std::vector<double>& newDist);
+
+    /**
+     * @brief Build a rooted tree with the nearest-neighbor chain algorithm.
+     */
+    void computeTreeWithNearestNeighborChain_();
 		
 };
 
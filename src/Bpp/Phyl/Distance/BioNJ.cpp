@@ -102,19 +102,28 @@ void BioNJ::computeTree()
     if (lambda_ > 1.)
       lambda_ = 1.;
 
+    vector<size_t> ids;
+    ids.reserve(currentNodes_.size());
     for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
     {
-      size_t id = i->first;
-      if (id != bestPair[0] && id != bestPair[1])
-      {
-        newDist[id] = computeDistancesFromPair(bestPair, distances, id);
-        newVar[id] = lambda_ * variance_(bestPair[0], id) + (1 - lambda_) * variance_(bestPair[1], id) - lambda_ * (1 - lambda_) * variance_(bestPair[0], bestPair[1]);
-      }
-      else
+      ids.push_back(i->first);
+    }
+    runParallelLoop_(ids.size(), [&](size_t first, size_t last)
+    {
+      for (size_t k = first; k < last; k++)
       {
-        newDist[id] = 0;
+        size_t id = ids[k];
+        if (id != bestPair[0] && id != bestPair[1])
+        {
+          newDist[id] = computeDistancesFromPair(bestPair, distances, id);
+          newVar[id] = lambda_ * variance_(bestPair[0], id) + (1 - lambda_) * variance_(bestPair[1], id) - lambda_ * (1 - lambda_) * variance_(bestPair[0], bestPair[1]);
+        }
+        else
+        {
+          newDist[id] = 0;
+        }
       }
-    }
+    });
     // Actualize currentNodes_:
     currentNodes_[bestPair[0]] = parent;
     currentNodes_.erase(bestPair[1]);
@@ -42,6 +42,14 @@
 #include "../Tree/Tree.h"
 #include "../PatternTools.h"
 #include "../SitePatterns.h"
+#include "../SiteLoopExecutor.h"
+#include "../Model/Nucleotide/JCnuc.h"
+#include "../Model/Nucleotide/K80.h"
+#include "../Model/Nucleotide/F84.h"
+#include "../Model/Nucleotide/TN93.h"
+#include "../Model/Protein/JCprot.h"
+#include "../Model/RateDistribution/ConstantRateDistribution.h"
+#include "../Model/RateDistribution/GammaDiscreteRateDistribution.h"
 
 // From bpp-core:
 #include <Bpp/App/ApplicationTools.h>
@@ -56,10 +64,14 @@
 using namespace bpp;
 
 // From the STL:
+#include <map>
 #include <vector>
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 
 using namespace std;
 
@@ -80,7 +92,31 @@ TwoTreeLikelihood::TwoTreeLikelihood(
 {
   seqnames_[0] = seq1;
   seqnames_[1] = seq2;
-  
+
+  initData_(data, verbose);
+
+  brLen_ = minimumBrLen_;
+  brLenConstraint_ = new IntervalConstraint(1, minimumBrLen_, true);
+
+  if (verbose) ApplicationTools::displayTaskDone();
+}
+
+/******************************************************************************/
+
+void TwoTreeLikelihood::setData(const std::string& seq1, const std::string& seq2, const AlignedValuesContainer& data)
+{
+  seqnames_[0] = seq1;
+  seqnames_[1] = seq2;
+  initData_(data, false);
+  brLen_ = minimumBrLen_;
+  initialized_ = false;
+}
+
+/******************************************************************************/
+
+void TwoTreeLikelihood::initData_(const AlignedValuesContainer& data, bool verbose)
+{
+  if (data_) delete data_;
   data_ = PatternTools::getSequenceSubset(data, seqnames_);
   if (data_->getAlphabet()->getAlphabetType()
       != model_->getAlphabet()->getAlphabetType())
@@ -94,6 +130,40 @@ TwoTreeLikelihood::TwoTreeLikelihood(
   if (verbose)
     ApplicationTools::displayMessage("Double-Recursive Homogeneous Tree Likelihood");
 
+  const SiteContainer* sc = dynamic_cast<const SiteContainer*>(data_);
+  if (sc)
+  {
+    // With two sequences, a pattern is a pair of states. Patterns and their
+    // counts are found in one pass, without sorting the sites:
+    const Sequence& seq1 = sc->getSequence(0);
+    const Sequence& seq2 = sc->getSequence(1);
+    map<pair<int, int>, size_t> patterns;
+    vector<size_t> patternSites;
+    rootWeights_.clear();
+    rootPatternLinks_.resize(nbSites_);
+    for (size_t i = 0; i < nbSites_; i++)
+    {
+      pair<map<pair<int, int>, size_t>::iterator, bool> it =
+        patterns.insert(make_pair(make_pair(seq1.getValue(i), seq2.getValue(i)), rootWeights_.size()));
+      if (it.second)
+      {
+        rootWeights_.push_back(0);
+        patternSites.push_back(i);
+      }
+      rootPatternLinks_[i] = it.first->second;
+      rootWeights_[it.first->second]++;
+    }
+    nbDistinctSites_ = rootWeights_.size();
+    shrunkData_.reset();
+    if (verbose)
+    {
+      ApplicationTools::displayResult("Number of distinct sites", TextTools::toString(nbDistinctSites_));
+      ApplicationTools::displayTask("Init likelihoods arrays recursively");
+    }
+    initTreeLikelihoods_(*data_, &patternSites);
+    return;
+  }
+
   // Initialize root patterns:
   SitePatterns pattern(data_);
   shrunkData_       = pattern.getSites();
@@ -106,23 +176,17 @@ TwoTreeLikelihood::TwoTreeLikelihood(
   // Init _likelihoods:
   if (verbose) ApplicationTools::displayTask("Init likelihoods arrays recursively");
   // Clone data for more efficiency on sequences access:
-  const AlignedValuesContainer* sequences = (dynamic_cast<const SiteContainer*>(shrunkData_.get()))?static_cast<const AlignedValuesContainer*>(new AlignedSequenceContainer(dynamic_cast<SiteContainer&>(*shrunkData_))):
-    static_cast<const AlignedValuesContainer*>(new VectorProbabilisticSiteContainer(dynamic_cast<const VectorProbabilisticSiteContainer&>(*shrunkData_)));
+  const AlignedValuesContainer* sequences = static_cast<const AlignedValuesContainer*>(new VectorProbabilisticSiteContainer(dynamic_cast<const VectorProbabilisticSiteContainer&>(*shrunkData_)));
   
   initTreeLikelihoods(*sequences);
   delete sequences;
-
-  brLen_ = minimumBrLen_;
-  brLenConstraint_ = new IntervalConstraint(1, minimumBrLen_, true);
-
-  if (verbose) ApplicationTools::displayTaskDone();
 }
 
 /******************************************************************************/
 
 TwoTreeLikelihood::TwoTreeLikelihood(const TwoTreeLikelihood& lik) :
   AbstractDiscreteRatesAcrossSitesTreeLikelihood(lik),
-  shrunkData_        (dynamic_cast<AlignedValuesContainer*>(lik.shrunkData_->clone())),
+  shrunkData_        (lik.shrunkData_ ? dynamic_cast<AlignedValuesContainer*>(lik.shrunkData_->clone()) : 0),
   seqnames_          (lik.seqnames_),
   model_             (lik.model_),
   brLenParameters_   (lik.brLenParameters_),
@@ -152,7 +216,7 @@ TwoTreeLikelihood::TwoTreeLikelihood(const TwoTreeLikelihood& lik) :
 TwoTreeLikelihood& TwoTreeLikelihood::operator=(const TwoTreeLikelihood& lik)
 {
   AbstractDiscreteRatesAcrossSitesTreeLikelihood::operator=(lik);
-  shrunkData_        = shared_ptr<AlignedValuesContainer>(lik.shrunkData_->clone());
+  shrunkData_        = shared_ptr<AlignedValuesContainer>(lik.shrunkData_ ? lik.shrunkData_->clone() : 0);
   seqnames_          = lik.seqnames_;
   model_             = lik.model_;
   brLenParameters_   = lik.brLenParameters_;
@@ -417,6 +481,11 @@ double TwoTreeLikelihood::getValue() const
 /******************************************************************************/
 
 void TwoTreeLikelihood::initTreeLikelihoods(const SequencedValuesContainer& sequences)
+{
+  initTreeLikelihoods_(sequences, 0);
+}
+
+void TwoTreeLikelihood::initTreeLikelihoods_(const SequencedValuesContainer& sequences, const std::vector<size_t>* patternSites)
 {
   leafLikelihoods1_.resize(nbDistinctSites_);
   leafLikelihoods2_.resize(nbDistinctSites_);
@@ -424,13 +493,14 @@ void TwoTreeLikelihood::initTreeLikelihoods(const SequencedValuesContainer& sequ
   {
    Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
    Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
+   size_t site = patternSites ? (*patternSites)[i] : i;
    leafLikelihoods1_i->resize(nbStates_);
    leafLikelihoods2_i->resize(nbStates_);
    for (size_t s = 0; s < nbStates_; s++)
    {
      try {
-       (*leafLikelihoods1_i)[s] = sequences.getStateValueAt(i, seqnames_[0], model_->getAlphabetStateAsInt(s));
-       (*leafLikelihoods2_i)[s] = sequences.getStateValueAt(i, seqnames_[1], model_->getAlphabetStateAsInt(s));
+       (*leafLikelihoods1_i)[s] = sequences.getStateValueAt(site, seqnames_[0], model_->getAlphabetStateAsInt(s));
+       (*leafLikelihoods2_i)[s] = sequences.getStateValueAt(site, seqnames_[1], model_->getAlphabetStateAsInt(s));
      }
      catch (SequenceNotFoundException& snfe)
      {
@@ -640,6 +710,239 @@ double TwoTreeLikelihood::getSecondOrderDerivative(const string& variable) const
 
 /******************************************************************************/
 
+namespace
+{
+  typedef uint64_t Block;
+
+  inline unsigned int countBits(Block m)
+  {
+#if defined(__GNUC__)
+    return static_cast<unsigned int>(__builtin_popcountll(m));
+#else
+    unsigned int n = 0;
+    for (; m; m &= m - 1)
+      n++;
+    return n;
+#endif
+  }
+
+  /**
+   * @brief A sequence stored as bit planes of its states, 64 sites per word.
+   *
+   * Bit b of the state of site i is bit i of planes[b]. Sites with a
+   * resolved state are set in resolved, and sites with a partially
+   * ambiguous character in ambiguous. Gaps and fully unknown characters
+   * are in neither.
+   */
+  struct EncodedSequence
+  {
+    std::vector< std::vector<Block> > planes;
+    std::vector<Block> resolved;
+    std::vector<Block> ambiguous;
+
+    EncodedSequence(const Sequence& seq, size_t nbStates, size_t nbPlanes) :
+      planes(nbPlanes, std::vector<Block>((seq.size() + 63) / 64, 0)),
+      resolved((seq.size() + 63) / 64, 0),
+      ambiguous((seq.size() + 63) / 64, 0)
+    {
+      const Alphabet* alphabet = seq.getAlphabet();
+      for (size_t i = 0; i < seq.size(); i++)
+      {
+        int state = seq.getValue(i);
+        Block bit = Block(1) << (i % 64);
+        if (state >= 0 && static_cast<size_t>(state) < nbStates)
+        {
+          resolved[i / 64] |= bit;
+          for (size_t b = 0; b < nbPlanes; b++)
+            if ((state >> b) & 1)
+              planes[b][i / 64] |= bit;
+        }
+        else if (!alphabet->isGap(state) && alphabet->getAlias(state).size() < nbStates)
+          ambiguous[i / 64] |= bit;
+      }
+    }
+  };
+
+  /**
+   * @brief Numbers of sites compared and of differences between two sequences.
+   *
+   * For nucleotides, transitions are counted separately between purines
+   * (A <-> G) and between pyrimidines (C <-> T). For other alphabets, all
+   * differences are counted as transversions.
+   */
+  struct PairCounts
+  {
+    unsigned int nbSites, nbPurineTransitions, nbPyrimidineTransitions, nbTransversions;
+    bool ambiguous;
+
+    PairCounts(const EncodedSequence& s1, const EncodedSequence& s2, bool nucleotides) :
+      nbSites(0), nbPurineTransitions(0), nbPyrimidineTransitions(0), nbTransversions(0), ambiguous(false)
+    {
+      for (size_t j = 0; j < s1.resolved.size(); j++)
+      {
+        // Sites where one of the sequence is ambiguous and the other is not gap or unknown:
+        Block both1 = s1.resolved[j] | s1.ambiguous[j];
+        Block both2 = s2.resolved[j] | s2.ambiguous[j];
+        if ((s1.ambiguous[j] & both2) | (s2.ambiguous[j] & both1))
+        {
+          ambiguous = true;
+          return;
+        }
+        Block valid = s1.resolved[j] & s2.resolved[j];
+        nbSites += countBits(valid);
+        if (nucleotides)
+        {
+          // A = 00, C = 01, G = 10, T = 11: transitions only change the second bit.
+          Block diff0 = (s1.planes[0][j] ^ s2.planes[0][j]) & valid;
+          Block transitions = (s1.planes[1][j] ^ s2.planes[1][j]) & valid & ~diff0;
+          nbPurineTransitions += countBits(transitions & ~s1.planes[0][j]);
+          nbPyrimidineTransitions += countBits(transitions & s1.planes[0][j]);
+          nbTransversions += countBits(diff0);
+        }
+        else
+        {
+          Block diff = 0;
+          for (size_t b = 0; b < s1.planes.size(); b++)
+            diff |= s1.planes[b][j] ^ s2.planes[b][j];
+          nbTransversions += countBits(diff & valid);
+        }
+      }
+    }
+  };
+
+  /**
+   * @brief Sum of terms c f(x), where f(x) = -log(x) for constant rates and
+   * a (x^{-1/a} - 1) for gamma rates with shape a.
+   *
+   * @return NaN if one of the x is not positive.
+   */
+  double sumOfTerms(const std::vector< std::pair<double, double> >& terms, double alpha)
+  {
+    double d = 0;
+    for (auto& term : terms)
+    {
+      if (term.second <= 0)
+        return std::numeric_limits<double>::quiet_NaN();
+      d += term.first * (alpha > 0 ? alpha * (std::pow(term.second, -1. / alpha) - 1.) : -std::log(term.second));
+    }
+    return d;
+  }
+}
+
+/******************************************************************************/
+
+void DistanceEstimation::computeClosedFormDistances_(const SiteContainer& sites, vector<double>& distances, SiteLoopExecutor& executor) const
+{
+  enum { JC, KIMURA, FELSENSTEIN, TAMURA_NEI } formula;
+  if (dynamic_cast<const JCnuc*>(model_.get()) || dynamic_cast<const JCprot*>(model_.get()))
+    formula = JC;
+  else if (dynamic_cast<const K80*>(model_.get()))
+    formula = KIMURA;
+  else if (dynamic_cast<const F84*>(model_.get()))
+    formula = FELSENSTEIN;
+  else if (dynamic_cast<const TN93*>(model_.get()))
+    formula = TAMURA_NEI;
+  else
+    return;
+
+  // JCprot may have unequal frequencies:
+  const vector<double>& freqs = model_->getFrequencies();
+  size_t nbStates = freqs.size();
+  if (formula == JC)
+  {
+    for (double f : freqs)
+      if (std::abs(f - 1. / static_cast<double>(nbStates)) > 1e-12)
+        return;
+  }
+
+  // Shape of the gamma distribution, or 0 for constant rates:
+  double alpha = 0;
+  if (dynamic_cast<const GammaDiscreteRateDistribution*>(rateDist_.get()))
+    alpha = rateDist_->getParameterValue("alpha");
+  else if (!dynamic_cast<const ConstantRateDistribution*>(rateDist_.get()))
+    return;
+
+  size_t nbPlanes = 0;
+  while ((size_t(1) << nbPlanes) < nbStates)
+    nbPlanes++;
+  size_t n = sites.getNumberOfSequences();
+  vector<EncodedSequence> sequences;
+  for (size_t i = 0; i < n; i++)
+    sequences.push_back(EncodedSequence(sites.getSequence(i), nbStates, nbPlanes));
+
+  bool nucleotides = (formula != JC || nbStates == 4);
+  double rate = model_->getRate();
+  double piA = freqs[0], piC = freqs[1], piG = nbStates == 4 ? freqs[2] : 0, piT = nbStates == 4 ? freqs[3] : 0;
+  double piR = piA + piG, piY = piC + piT;
+
+  executor.run(distances.size(), [&](size_t firstPair, size_t lastPair)
+  {
+    size_t i = 0;
+    size_t j = 1;
+    for (size_t k = 0; k < firstPair; k++)
+    {
+      if (++j == n)
+      {
+        i++;
+        j = i + 1;
+      }
+    }
+
+    vector< pair<double, double> > terms;
+    for (size_t k = firstPair; k < lastPair; k++)
+    {
+      PairCounts counts(sequences[i], sequences[j], nucleotides);
+      if (!counts.ambiguous && counts.nbSites > 0)
+      {
+        double total = static_cast<double>(counts.nbSites);
+        double p1 = counts.nbPurineTransitions / total;
+        double p2 = counts.nbPyrimidineTransitions / total;
+        double q = counts.nbTransversions / total;
+        terms.clear();
+        switch (formula)
+        {
+        case JC:
+        {
+          double b = 1. - 1. / static_cast<double>(nbStates);
+          terms.push_back(make_pair(b, 1. - (p1 + p2 + q) / b));
+          break;
+        }
+        case KIMURA:
+          terms.push_back(make_pair(0.5, 1. - 2. * (p1 + p2) - q));
+          terms.push_back(make_pair(0.25, 1. - 2. * q));
+          break;
+        case FELSENSTEIN:
+        {
+          double a = piC * piT / piY + piA * piG / piR;
+          double b = piC * piT + piA * piG;
+          double c = piR * piY;
+          terms.push_back(make_pair(2. * a, 1. - (p1 + p2) / (2. * a) - (a - b) * q / (2. * a * c)));
+          terms.push_back(make_pair(-2. * (a - b - c), 1. - q / (2. * c)));
+          break;
+        }
+        case TAMURA_NEI:
+          terms.push_back(make_pair(2. * piA * piG / piR, 1. - piR * p1 / (2. * piA * piG) - q / (2. * piR)));
+          terms.push_back(make_pair(2. * piC * piT / piY, 1. - piY * p2 / (2. * piC * piT) - q / (2. * piY)));
+          terms.push_back(make_pair(2. * (piR * piY - piA * piG * piY / piR - piC * piT * piR / piY), 1. - q / (2. * piR * piY)));
+          break;
+        }
+        double d = sumOfTerms(terms, alpha) / rate;
+        // Same lower bound as the one of TwoTreeLikelihood branch lengths:
+        if (!std::isnan(d))
+          distances[k] = std::max(d, 0.000001);
+      }
+
+      if (++j == n)
+      {
+        i++;
+        j = i + 1;
+      }
+    }
+  });
+}
+
+/******************************************************************************/
+
 void DistanceEstimation::computeMatrix()
 {
   size_t n = sites_->getNumberOfSequences();
@@ -647,49 +950,102 @@ void DistanceEstimation::computeMatrix()
   if (dist_ != 0) delete dist_;
   dist_ = new DistanceMatrix(names);
   optimizer_->setVerbose(static_cast<unsigned int>(max(static_cast<int>(verbose_) - 2, 0)));
+  for (size_t i = 0; i < n; ++i)
+  {
+    (*dist_)(i, i) = 0;
+  }
 
   const SiteContainer* sc=dynamic_cast<const SiteContainer*>(sites_);
   const VectorProbabilisticSiteContainer* psc=dynamic_cast<const VectorProbabilisticSiteContainer*>(sites_);
 
-  for (size_t i = 0; i < n; ++i)
+  // Additional parameters are estimated starting from the values of the previous pair,
+  // pairs are then computed in order:
+  size_t nbThreads = parameters_.size() == 0 ? nbThreads_ : 1;
+  SiteLoopExecutor executor(nbThreads);
+  bool serial = (executor.getNumberOfThreads() == 1);
+  size_t nbPairs = n * (n - 1) / 2;
+
+  // Pairs with a NaN distance are estimated by maximum likelihood:
+  vector<double> closedFormDistances(nbPairs, numeric_limits<double>::quiet_NaN());
+  if (closedForm_ && parameters_.size() == 0 && sc)
+    computeClosedFormDistances_(*sc, closedFormDistances, executor);
+
+  executor.run(nbPairs, [&](size_t firstPair, size_t lastPair)
   {
-    (*dist_)(i, i) = 0;
-    if (verbose_ == 1)
+    // Each block works on its own copies, the ones of this instance are only used serially:
+    unique_ptr<TransitionModel> model(serial ? 0 : model_->clone());
+    unique_ptr<DiscreteDistribution> rateDist(serial ? 0 : rateDist_->clone());
+    unique_ptr<Optimizer> optimizer(serial ? 0 : dynamic_cast<Optimizer*>(optimizer_->clone()));
+    TransitionModel* blockModel = serial ? model_.get() : model.get();
+    DiscreteDistribution* blockRateDist = serial ? rateDist_.get() : rateDist.get();
+    Optimizer* blockOptimizer = serial ? optimizer_ : optimizer.get();
+    bool showGauge = (firstPair == 0 && verbose_ > 0);
+
+    // Find the pair (i, j) with index firstPair, pairs being numbered row by row:
+    size_t i = 0;
+    size_t j = 1;
+    for (size_t k = 0; k < firstPair; k++)
     {
-      ApplicationTools::displayGauge(i, n - 1, '=');
+      if (++j == n)
+      {
+        i++;
+        j = i + 1;
+      }
     }
-    for (size_t j = i + 1; j < n; j++)
+
+    unique_ptr<TwoTreeLikelihood> lik;
+    for (size_t k = firstPair; k < lastPair; k++)
     {
-      if (verbose_ > 1)
+      if (serial)
       {
-        ApplicationTools::displayGauge(j - i - 1, n - i - 2, '=');
+        if (verbose_ == 1 && j == i + 1)
+          ApplicationTools::displayGauge(i, n - 1, '=');
+        if (verbose_ > 1)
+          ApplicationTools::displayGauge(j - i - 1, n - i - 2, '=');
+      }
+      else if (showGauge)
+        ApplicationTools::displayGauge(k, lastPair - 1, '=');
+
+      if (!std::isnan(closedFormDistances[k]))
+        (*dist_)(i, j) = (*dist_)(j, i) = closedFormDistances[k];
+      else
+      {
+        if (!lik)
+          lik.reset(new TwoTreeLikelihood(names[i], names[j], *sites_, blockModel, blockRateDist, verbose_ > 3));
+        else
+          lik->setData(names[i], names[j], *sites_);
+        lik->initialize();
+        lik->enableDerivatives(true);
+
+        size_t d = sc?
+          SymbolListTools::getNumberOfDistinctPositions(sc->getSequence(i), sc->getSequence(j)):
+          SymbolListTools::getNumberOfDistinctPositions(*psc->getSequence(i), *psc->getSequence(j));
+        size_t g = sc?
+          SymbolListTools::getNumberOfPositionsWithoutGap(sc->getSequence(i), sc->getSequence(j)):
+          SymbolListTools::getNumberOfPositionsWithoutGap(*psc->getSequence(i), *psc->getSequence(j));
+
+        lik->setParameterValue("BrLen", g == 0 ? lik->getMinimumBranchLength() : std::max(lik->getMinimumBranchLength(), static_cast<double>(d) / static_cast<double>(g)));
+        // Optimization:
+        blockOptimizer->setFunction(lik.get());
+        blockOptimizer->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
+        ParameterList params = lik->getBranchLengthsParameters();
+        params.addParameters(parameters_);
+        blockOptimizer->init(params);
+        blockOptimizer->optimize();
+        // Store results:
+        (*dist_)(i, j) = (*dist_)(j, i) = lik->getParameterValue("BrLen");
+      }
+
+      if (++j == n)
+      {
+        if (serial && verbose_ > 1 && ApplicationTools::message) ApplicationTools::message->endLine();
+        i++;
+        j = i + 1;
       }
-      TwoTreeLikelihood* lik =
-        new TwoTreeLikelihood(names[i], names[j], *sites_, model_.get(), rateDist_.get(), verbose_ > 3);
-      lik->initialize();
-      lik->enableDerivatives(true);
-
-      size_t d = sc?
-        SymbolListTools::getNumberOfDistinctPositions(sc->getSequence(i), sc->getSequence(j)):
-        SymbolListTools::getNumberOfDistinctPositions(*psc->getSequence(i), *psc->getSequence(j));
-      size_t g = sc?
-        SymbolListTools::getNumberOfPositionsWithoutGap(sc->getSequence(i), sc->getSequence(j)):
-        SymbolListTools::getNumberOfPositionsWithoutGap(*psc->getSequence(i), *psc->getSequence(j));
-
-      lik->setParameterValue("BrLen", g == 0 ? lik->getMinimumBranchLength() : std::max(lik->getMinimumBranchLength(), static_cast<double>(d) / static_cast<double>(g)));
-      // Optimization:
-      optimizer_->setFunction(lik);
-      optimizer_->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
-      ParameterList params = lik->getBranchLengthsParameters();
-      params.addParameters(parameters_);
-      optimizer_->init(params);
-      optimizer_->optimize();
-      // Store results:
-      (*dist_)(i, j) = (*dist_)(j, i) = lik->getParameterValue("BrLen");
-      delete lik;
     }
-    if (verbose_ > 1 && ApplicationTools::message) ApplicationTools::message->endLine();
-  }
+  });
+  if (verbose_ == 1 && serial && n > 0)
+    ApplicationTools::displayGauge(n - 1, n - 1, '=');
 }
 
 /******************************************************************************/
@@ -55,12 +55,15 @@
 
 // From bpp-seq:
 #include <Bpp/Seq/Container/AlignedValuesContainer.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
 
 // From the STL:
+#include <algorithm>
 #include <memory>
 
 namespace bpp
 {
+  class SiteLoopExecutor;
 
 /**
  * @brief This class is a simplified version of DRHomogeneousTreeLikelihood for 2-Trees.
@@ -131,6 +134,23 @@ namespace bpp
 
     virtual ~TwoTreeLikelihood();
 
+  public:
+    /**
+     * @brief Reuse this object for another pair of sequences.
+     *
+     * Likelihood arrays are resized in place. The branch length is reset to
+     * its minimum value, and initialize() must be called again before any
+     * computation.
+     *
+     * @param seq1 The name of the first sequence.
+     * @param seq2 The name of the second sequence.
+     * @param data The container holding the two sequences.
+     */
+    void setData(const std::string& seq1, const std::string& seq2, const AlignedValuesContainer& data);
+
+  private:
+    void initData_(const AlignedValuesContainer& data, bool verbose);
+
   public:
 
     /**
@@ -272,6 +292,15 @@ namespace bpp
      */
     virtual void initTreeLikelihoods(const SequencedValuesContainer & sequences);
 
+  private:
+    /**
+     * @brief Same as initTreeLikelihoods, but pattern i is read at site (*patternSites)[i]
+     * of the container, or at site i if patternSites is 0.
+     */
+    void initTreeLikelihoods_(const SequencedValuesContainer& sequences, const std::vector<size_t>* patternSites);
+
+  protected:
+
     void fireParameterChanged(const ParameterList & params);
     virtual void computeTreeLikelihood();
     virtual void computeTreeDLikelihood();
@@ -316,6 +345,8 @@ namespace bpp
     MetaOptimizer* defaultOptimizer_;
     size_t verbose_;
     ParameterList parameters_;
+    size_t nbThreads_;
+    bool closedForm_;
 
   public:
   
@@ -344,7 +375,9 @@ namespace bpp
       optimizer_(0),
       defaultOptimizer_(0),
       verbose_(verbose),
-      parameters_()
+      parameters_(),
+      nbThreads_(1),
+      closedForm_(false)
     {
       init_();
     }
@@ -379,7 +412,9 @@ namespace bpp
       optimizer_(0),
       defaultOptimizer_(0),
       verbose_(verbose),
-      parameters_()
+      parameters_(),
+      nbThreads_(1),
+      closedForm_(false)
     {
       init_();
       if(computeMat) computeMatrix();
@@ -400,7 +435,9 @@ namespace bpp
       optimizer_(dynamic_cast<Optimizer *>(distanceEstimation.optimizer_->clone())),
       defaultOptimizer_(dynamic_cast<MetaOptimizer *>(distanceEstimation.defaultOptimizer_->clone())),
       verbose_(distanceEstimation.verbose_),
-      parameters_(distanceEstimation.parameters_)
+      parameters_(distanceEstimation.parameters_),
+      nbThreads_(distanceEstimation.nbThreads_),
+      closedForm_(distanceEstimation.closedForm_)
     {
       if(distanceEstimation.dist_ != 0)
         dist_ = new DistanceMatrix(*distanceEstimation.dist_);
@@ -429,6 +466,8 @@ namespace bpp
       // _defaultOptimizer has already been initialized since the default constructor has been called.
       verbose_    = distanceEstimation.verbose_;
       parameters_ = distanceEstimation.parameters_;
+      nbThreads_  = distanceEstimation.nbThreads_;
+      closedForm_ = distanceEstimation.closedForm_;
       return *this;
     }
 
@@ -541,6 +580,59 @@ namespace bpp
      * @return Verbose level.
      */
     size_t getVerbose() const { return verbose_; }
+
+    /**
+     * @brief Set the number of threads computing pairwise distances
+     * concurrently (1 by default, ie no additional thread).
+     *
+     * Pairs are split into one contiguous block per thread. Each block uses
+     * its own copy of the model, rate distribution and optimizer, so that
+     * the objects of this instance are left unchanged. Threads are only
+     * used when no additional parameter is estimated, since otherwise each
+     * pair starts from the values estimated for the previous one.
+     * With several threads, only the progress of the first block is displayed,
+     * and the optimizer must not write to a shared profiler or message handler.
+     *
+     * @param nbThreads The total number of threads, including the calling one.
+     */
+    void setNumberOfThreads(size_t nbThreads) { nbThreads_ = std::max<size_t>(nbThreads, 1); }
+
+    size_t getNumberOfThreads() const { return nbThreads_; }
+
+    /**
+     * @brief Use closed-form distances when the model permits (false by default).
+     *
+     * When no additional parameter is estimated, distances for the JCnuc,
+     * K80, F84, TN93 and JCprot models with constant or gamma rates are
+     * computed from the counts of differences between the two sequences,
+     * obtained by comparing 64 sites at a time:
+     * - JCnuc and JCprot use the Jukes and Cantor (1969) formula, which is
+     *   the maximum likelihood estimate when rates are constant,
+     * - K80 uses the Kimura (1980) formula,
+     * - F84 and TN93 use the formulas of Tamura and Nei (1993), with the
+     *   equilibrium frequencies of the model.
+     * With gamma rates, the formulas for a continuous gamma distribution with the
+     * same shape are used. Apart from the frequencies, the parameters of the model
+     * (for instance kappa) are not used, since the formulas estimate
+     * them for each pair together with the distance.
+     *
+     * Other models, pairs with partially ambiguous characters (fully unknown characters
+     * are treated as gaps), and pairs too divergent for the formula still use a
+     * maximum likelihood estimation.
+     */
+    void setClosedFormDistances(bool yn) { closedForm_ = yn; }
+
+    bool useClosedFormDistances() const { return closedForm_; }
+
+  private:
+    /**
+     * @brief Compute closed-form distances, for pairs numbered row by row.
+     *
+     * @param sites The sequences.
+     * @param distances The distances, left to NaN for pairs which must be estimated by maximum likelihood.
+     * @param executor The executor used to loop over pairs.
+     */
+    void computeClosedFormDistances_(const SiteContainer& sites, std::vector<double>& distances, SiteLoopExecutor& executor) const;
   };
 
 } //end of namespace bpp.
@@ -136,8 +136,8 @@ double HierarchicalClustering::computeDistancesFromPair(const vector<size_t>& pa
   }
   else if (method_ == "Average")
   {
-    double n1 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_[pair[0]])->getInfos().numberOfLeaves);
-    double n2 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_[pair[1]])->getInfos().numberOfLeaves);
+    double n1 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_.find(pair[0])->second)->getInfos().numberOfLeaves);
+    double n2 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_.find(pair[1])->second)->getInfos().numberOfLeaves);
     w1 = n1 / (n1 + n2);
     w2 = n2 / (n1 + n2);
     w3 = 0.;
@@ -145,9 +145,9 @@ double HierarchicalClustering::computeDistancesFromPair(const vector<size_t>& pa
   }
   else if (method_ == "Ward")
   {
-    double n1 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_[pair[0]])->getInfos().numberOfLeaves);
-    double n2 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_[pair[1]])->getInfos().numberOfLeaves);
-    double n3 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_[pos])->getInfos().numberOfLeaves);
+    double n1 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_.find(pair[0])->second)->getInfos().numberOfLeaves);
+    double n2 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_.find(pair[1])->second)->getInfos().numberOfLeaves);
+    double n3 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_.find(pos)->second)->getInfos().numberOfLeaves);
     w1 = (n1 + n3) / (n1 + n2 + n3);
     w2 = (n2 + n3) / (n1 + n2 + n3);
     w3 = -n3 / (n1 + n2 + n3);
@@ -155,8 +155,8 @@ double HierarchicalClustering::computeDistancesFromPair(const vector<size_t>& pa
   }
   else if (method_ == "Centroid")
   {
-    double n1 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_[pair[0]])->getInfos().numberOfLeaves);
-    double n2 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_[pair[1]])->getInfos().numberOfLeaves);
+    double n1 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_.find(pair[0])->second)->getInfos().numberOfLeaves);
+    double n2 = static_cast<double>(dynamic_cast<NodeTemplate<ClusterInfos>*>(currentNodes_.find(pair[1])->second)->getInfos().numberOfLeaves);
     w1 = n1 / (n1 + n2);
     w2 = n2 / (n1 + n2);
     w3 = -n1 * n2 / pow(n1 + n2, 2.);
@@ -170,6 +170,11 @@ double HierarchicalClustering::computeDistancesFromPair(const vector<size_t>& pa
   return w1 * d1 + w2 * d2 + w3 * d3 + w4* std::abs(d1 - d2);
 }
 
+bool HierarchicalClustering::isReducible() const
+{
+  return method_ == COMPLETE || method_ == SINGLE || method_ == AVERAGE || method_ == WARD;
+}
+
 void HierarchicalClustering::finalStep(int idRoot)
 {
   NodeTemplate<ClusterInfos>* root = new NodeTemplate<ClusterInfos>(idRoot);
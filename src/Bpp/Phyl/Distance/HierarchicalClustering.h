@@ -60,6 +60,8 @@ public:
  * @brief Hierarchical clustering.
  *
  * This class implements the complete, single, average (= UPGMA), median, ward and centroid linkage methods.
+ * Rooted trees with complete, single, average and ward linkages are built with
+ * the nearest-neighbor chain algorithm (see AbstractAgglomerativeDistanceMethod::computeTree()).
  */
 class HierarchicalClustering :
   public AbstractAgglomerativeDistanceMethod
@@ -106,6 +108,7 @@ protected:
   std::vector<double> computeBranchLengthsForPair(const std::vector<size_t>& pair);
   double computeDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& branchLengths, size_t pos);
   void finalStep(int idRoot);
+  bool isReducible() const;
   virtual Node* getLeafNode(int id, const std::string& name);
   virtual Node* getParentNode(int id, Node* son1, Node* son2);
 };
@@ -45,47 +45,107 @@ using namespace bpp;
 
 #include <cmath>
 #include <iostream>
+#include <mutex>
 
 using namespace std;
 
 std::vector<size_t> NeighborJoining::getBestPair()
 {
+  // Current nodes are copied to a vector, for faster loops:
+  vector<size_t> ids;
+  ids.reserve(currentNodes_.size());
   for (std::map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
   {
-    size_t id = i->first;
-    sumDist_[id] = 0;
-    for (map<size_t, Node*>::iterator j = currentNodes_.begin(); j != currentNodes_.end(); j++)
+    ids.push_back(i->first);
+  }
+  size_t nbIds = ids.size();
+  if (nbIds < 2)
+    throw Exception("NeighborJoining::getBestPair(). At least two nodes are needed to find a pair.");
+  double factor = static_cast<double>(nbIds - 2);
+
+  // Row sums, and for each row the minimum distance to a node with a larger index:
+  vector<double> minDist(nbIds, -std::log(0.));
+  runParallelLoop_(nbIds, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; i++)
     {
-      size_t jd = j->first;
-      sumDist_[id] += matrix_(id, jd);
+      size_t id = ids[i];
+      double sum = 0;
+      for (size_t j = 0; j < nbIds; j++)
+      {
+        double d = matrix_(id, ids[j]);
+        sum += d;
+        if (j > i && d < minDist[i])
+          minDist[i] = d;
+      }
+      sumDist_[id] = sum;
     }
+  });
+
+  // maxSum[i] is the maximum row sum of nodes with index larger than i:
+  vector<double> maxSum(nbIds, std::log(0.));
+  for (size_t i = nbIds - 1; i > 0; i--)
+  {
+    maxSum[i - 1] = std::max(maxSum[i], sumDist_[ids[i]]);
   }
 
+  // Order in which rows are scanned. With several threads, short and long
+  // rows alternate so that blocks of rows have similar sizes:
+  vector<size_t> rows(nbIds - 1);
+  bool interleave = (getNumberOfThreads() > 1);
+  for (size_t k = 0; k < rows.size(); k++)
+  {
+    if (!interleave)
+      rows[k] = k;
+    else
+      rows[k] = (k % 2 == 0) ? k / 2 : nbIds - 2 - k / 2;
+  }
+
+  // The best pair has the largest criterion, and the smallest indices in
+  // case of ties, which gives the same pair whatever the order of the scan:
   vector<size_t> bestPair(2);
   double critMax = std::log(0.);
-  for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  size_t bestI = nbIds, bestJ = nbIds;
+  mutex bestMutex;
+  runParallelLoop_(rows.size(), [&](size_t first, size_t last)
   {
-    size_t id = i->first;
-    map<size_t, Node*>::iterator j = i;
-    j++;
-    for ( ; j != currentNodes_.end(); j++)
+    double blockMax = std::log(0.);
+    size_t blockI = nbIds, blockJ = nbIds;
+    for (size_t k = first; k < last; k++)
     {
-      size_t jd = j->first;
-      double crit = sumDist_[id] + sumDist_[jd] - static_cast<double>(currentNodes_.size() - 2) * matrix_(id, jd);
-      // cout << "\t" << id << "\t" << jd << "\t" << crit << endl;
-      if (crit > critMax)
+      size_t i = rows[k];
+      size_t id = ids[i];
+      // No pair of this row has a larger criterion than this bound (rounding
+      // is monotonic, so this also holds for computed values):
+      double bound = sumDist_[id] + maxSum[i] - factor * minDist[i];
+      if (bound < blockMax)
+        continue;
+      for (size_t j = i + 1; j < nbIds; j++)
       {
-        critMax = crit;
-        bestPair[0] = id;
-        bestPair[1] = jd;
+        double crit = sumDist_[id] + sumDist_[ids[j]] - factor * matrix_(id, ids[j]);
+        if (crit > blockMax || (crit == blockMax && (i < blockI || (i == blockI && j < blockJ))))
+        {
+          blockMax = crit;
+          blockI = i;
+          blockJ = j;
+        }
       }
     }
-  }
+    lock_guard<mutex> lock(bestMutex);
+    if (blockMax > critMax || (blockMax == critMax && (blockI < bestI || (blockI == bestI && blockJ < bestJ))))
+    {
+      critMax = blockMax;
+      bestI = blockI;
+      bestJ = blockJ;
+    }
+  });
 
   if (critMax == std::log(0.))
   {
     throw Exception("Unexpected error: no maximum criterium found.");
   }
+  bestPair[0] = ids[bestI];
+  bestPair[1] = ids[bestJ];
   return bestPair;
 }
 
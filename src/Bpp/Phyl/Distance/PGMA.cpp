@@ -48,6 +48,7 @@ using namespace bpp;
 // From the STL:
 #include <cmath>
 #include <iostream>
+#include <mutex>
 
 using namespace std;
 
@@ -59,31 +60,54 @@ TreeTemplate<Node>* PGMA::getTree() const
 
 vector<size_t> PGMA::getBestPair()
 {
+  vector<size_t> ids;
+  ids.reserve(currentNodes_.size());
+  for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  {
+    ids.push_back(i->first);
+  }
+  size_t nbIds = ids.size();
+
+  // The best pair has the smallest distance, and the smallest indices in case
+  // of ties, which gives the same pair whatever the number of threads:
   vector<size_t> bestPair(2);
   double distMin = -std::log(0.);
-  for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  size_t bestI = nbIds, bestJ = nbIds;
+  mutex bestMutex;
+  runParallelLoop_(nbIds, [&](size_t first, size_t last)
   {
-    size_t id = i->first;
-    map<size_t, Node*>::iterator j = i;
-    j++;
-    for ( ; j != currentNodes_.end(); j++)
+    double blockMin = -std::log(0.);
+    size_t blockI = nbIds, blockJ = nbIds;
+    for (size_t i = first; i < last; i++)
     {
-      size_t jd = j->first;
-      double dist = matrix_(id, jd);
-      if (dist < distMin)
+      size_t id = ids[i];
+      for (size_t j = i + 1; j < nbIds; j++)
       {
-        distMin = dist;
-        bestPair[0] = id;
-        bestPair[1] = jd;
+        double dist = matrix_(id, ids[j]);
+        if (dist < blockMin)
+        {
+          blockMin = dist;
+          blockI = i;
+          blockJ = j;
+        }
       }
     }
-  }
+    lock_guard<mutex> lock(bestMutex);
+    if (blockMin < distMin || (blockMin == distMin && (blockI < bestI || (blockI == bestI && blockJ < bestJ))))
+    {
+      distMin = blockMin;
+      bestI = blockI;
+      bestJ = blockJ;
+    }
+  });
 
   if (distMin == -std::log(0.))
   {
     throw Exception("Unexpected error: no minimum found in the distance matrix.");
   }
 
+  bestPair[0] = ids[bestI];
+  bestPair[1] = ids[bestJ];
   return bestPair;
 }
 
@@ -106,8 +130,8 @@ double PGMA::computeDistancesFromPair(const vector<size_t>& pair, const vector<d
   }
   else
   {
-    w1 = static_cast<double>(dynamic_cast<NodeTemplate<PGMAInfos>*>(currentNodes_[pair[0]])->getInfos().numberOfLeaves);
-    w2 = static_cast<double>(dynamic_cast<NodeTemplate<PGMAInfos>*>(currentNodes_[pair[1]])->getInfos().numberOfLeaves);
+    w1 = static_cast<double>(dynamic_cast<NodeTemplate<PGMAInfos>*>(currentNodes_.find(pair[0])->second)->getInfos().numberOfLeaves);
+    w2 = static_cast<double>(dynamic_cast<NodeTemplate<PGMAInfos>*>(currentNodes_.find(pair[1])->second)->getInfos().numberOfLeaves);
   }
   return (w1 * matrix_(pair[0], pos) + w2 * matrix_(pair[1], pos)) / (w1 + w2);
 }
@@ -62,6 +62,9 @@ struct PGMAInfos
  * is equivalent to the average linkage hierarchical clustering method.
  * The distance between two taxa is the average distance between all individuals in each taxa.
  * The unweighted version (named UPGMA), uses a weighted average, with the number of individuals in a group as a weight.
+ *
+ * Both linkages are reducible, and trees are built with the nearest-neighbor chain
+ * algorithm (see AbstractAgglomerativeDistanceMethod::computeTree()).
  */
 class PGMA :
   public AbstractAgglomerativeDistanceMethod
@@ -109,6 +112,7 @@ protected:
   std::vector<double> computeBranchLengthsForPair(const std::vector<size_t>& pair);
   double computeDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& branchLengths, size_t pos);
   void finalStep(int idRoot);
+  bool isReducible() const { return true; }
   virtual Node* getLeafNode(int id, const std::string& name);
   virtual Node* getParentNode(int id, Node* son1, Node* son2);
 };
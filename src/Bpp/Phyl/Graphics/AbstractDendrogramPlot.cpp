@@ -40,6 +40,11 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "AbstractDendrogramPlot.h"
 
 using namespace bpp;
+
+//From the STL:
+#include <algorithm>
+#include <memory>
+
 using namespace std;
 
 short AbstractDendrogramPlot::ORIENTATION_LEFT_TO_RIGHT = 1;
@@ -53,3 +58,148 @@ void AbstractDendrogramPlot::plot(GraphicDevice& gDevice) const
   drawDendrogram_(gDevice);
 }
 
+void AbstractDendrogramPlot::getSubtreeExtents_(const INode& root, SubtreeExtents_& extents) const
+{
+  // Nodes in pre-order:
+  vector<const INode*> nodes;
+  vector<const INode*> stack(1, &root);
+  int maxId = 0;
+  while (!stack.empty())
+  {
+    const INode* node = stack.back();
+    stack.pop_back();
+    nodes.push_back(node);
+    maxId = max(maxId, node->getId());
+    for (size_t i = node->getNumberOfSons(); i > 0; i--)
+      stack.push_back(node->getSon(i - 1));
+  }
+
+  size_t size = static_cast<size_t>(maxId) + 1;
+  extents.nbLeaves.assign(size, 0);
+  extents.heights.assign(size, 0.);
+  extents.depths.assign(size, 0);
+  // Sons come before their father in reverse pre-order:
+  for (size_t k = nodes.size(); k > 0; k--)
+  {
+    const INode* node = nodes[k - 1];
+    size_t id = static_cast<size_t>(node->getId());
+    size_t nbSons = node->getNumberOfSons();
+    if (nbSons == 0 || node->getInfos().isCollapsed())
+      extents.nbLeaves[id] = 1;
+    for (size_t i = 0; i < nbSons; i++)
+    {
+      const INode* son = node->getSon(i);
+      size_t sonId = static_cast<size_t>(son->getId());
+      if (!node->getInfos().isCollapsed())
+        extents.nbLeaves[id] += extents.nbLeaves[sonId];
+      double length = son->hasDistanceToFather() ? son->getDistanceToFather() : 0.;
+      extents.heights[id] = max(extents.heights[id], extents.heights[sonId] + length);
+      extents.depths[id] = max(extents.depths[id], extents.depths[sonId] + 1);
+    }
+  }
+}
+
+void AbstractDendrogramPlot::plotNodes_(GraphicDevice& gDevice, double x, double hDirection, double vDirection) const
+{
+  struct Frame
+  {
+    INode* node;
+    double x;
+    double x2;
+    bool drawBranch;
+    size_t nextSon;
+    double miny;
+    double maxy;
+  };
+
+  INode* root = const_cast<INode*>(getTree_()->getRootNode());
+  SubtreeExtents_ extents;
+  getSubtreeExtents_(*root, extents);
+
+  short hpos = (getHorizontalOrientation() == ORIENTATION_LEFT_TO_RIGHT ? GraphicDevice::TEXT_HORIZONTAL_LEFT : GraphicDevice::TEXT_HORIZONTAL_RIGHT);
+  double yOrigin = (getVerticalOrientation() == ORIENTATION_TOP_TO_BOTTOM ? 0 : getHeight());
+  size_t tipCounter = 0;
+
+  vector<Frame> stack;
+  Frame rootFrame = { root, x, 0., true, 0, 1000000, 0 };
+  rootFrame.x2 = getNodeX_(*root, x, hDirection, extents, rootFrame.drawBranch);
+  stack.push_back(rootFrame);
+  while (!stack.empty())
+  {
+    Frame& frame = stack.back();
+    INode& node = *frame.node;
+    size_t nbLeaves = extents.nbLeaves[static_cast<size_t>(node.getId())];
+    bool asTriangle = !node.isLeaf() && nbLeaves > 1 && static_cast<double>(nbLeaves) * getYUnit() < lodMinHeight_;
+    bool terminal = node.isLeaf() || node.getInfos().isCollapsed() || asTriangle;
+
+    if (!terminal && frame.nextSon < node.getNumberOfSons())
+    {
+      //Sons are drawn first:
+      Frame sonFrame = { node.getSon(frame.nextSon), frame.x2, 0., true, 0, 1000000, 0 };
+      frame.nextSon++;
+      sonFrame.x2 = getNodeX_(*sonFrame.node, sonFrame.x, hDirection, extents, sonFrame.drawBranch);
+      stack.push_back(sonFrame);
+      continue;
+    }
+
+    double y;
+    unique_ptr<Cursor> cursor;
+    unique_ptr<DrawINodeEvent> nodeEvent;
+    if (asTriangle)
+    {
+      //The whole subtree is drawn as a triangle spanning its leaves:
+      double y1 = (yOrigin + static_cast<double>(tipCounter) * vDirection) * getYUnit();
+      double y2 = (yOrigin + static_cast<double>(tipCounter + nbLeaves - 1) * vDirection) * getYUnit();
+      tipCounter += nbLeaves;
+      y = (y1 + y2) / 2.;
+      cursor.reset(new Cursor(frame.x2, y, 0, hpos));
+      nodeEvent.reset(new DrawINodeEvent(this, &gDevice, &node, *cursor));
+      fireBeforeNodeEvent_(*nodeEvent);
+      double x3 = getSubtreeTipsX_(node, frame.x2, hDirection, extents);
+      gDevice.drawLine(frame.x2, y, x3, y1);
+      gDevice.drawLine(x3, y1, x3, y2);
+      gDevice.drawLine(x3, y2, frame.x2, y);
+    }
+    else if (terminal)
+    {
+      y = (yOrigin + static_cast<double>(tipCounter) * vDirection) * getYUnit();
+      tipCounter++;
+      cursor.reset(new Cursor(frame.x2, y, 0, hpos));
+      nodeEvent.reset(new DrawINodeEvent(this, &gDevice, &node, *cursor));
+      fireBeforeNodeEvent_(*nodeEvent);
+    }
+    else
+    {
+      //Vertical line:
+      y = (frame.maxy + frame.miny) / 2.;
+      cursor.reset(new Cursor(frame.x2, y, 0, hpos));
+      nodeEvent.reset(new DrawINodeEvent(this, &gDevice, &node, *cursor));
+      fireBeforeNodeEvent_(*nodeEvent);
+      gDevice.drawLine(frame.x2, frame.miny, frame.x2, frame.maxy);
+    }
+
+    //Actualize node infos:
+    node.getInfos().setX(frame.x2);
+    node.getInfos().setY(y);
+    nodeEvent.reset(new DrawINodeEvent(this, &gDevice, &node, *cursor));
+    fireAfterNodeEvent_(*nodeEvent);
+
+    if (frame.drawBranch)
+    {
+      //Horizontal line
+      unique_ptr<DrawIBranchEvent> branchEvent(newBranchEvent_(gDevice, node, frame.x, frame.x2, *cursor));
+      fireBeforeBranchEvent_(*branchEvent);
+      gDevice.drawLine(frame.x, y, frame.x2, y);
+      fireAfterBranchEvent_(*branchEvent);
+    }
+
+    stack.pop_back();
+    if (!stack.empty())
+    {
+      Frame& father = stack.back();
+      if (y < father.miny) father.miny = y;
+      if (y > father.maxy) father.maxy = y;
+    }
+  }
+}
+
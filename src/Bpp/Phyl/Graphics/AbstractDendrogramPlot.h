@@ -42,6 +42,9 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "AbstractTreeDrawing.h"
 
+//From the STL:
+#include <vector>
+
 namespace bpp
 {
 
@@ -52,6 +55,10 @@ namespace bpp
  * This implementation offers to option for ploting form left to right or right to left. This will affect the direction
  * of plot annotations. The drawing can always be transformed using the regular translation/rotation operation on the
  * GraphicDevice.
+ *
+ * With a level of detail (see setLevelOfDetail()), subtrees too small to be
+ * seen are drawn as triangles, which keeps drawings of huge trees small.
+ * Nodes are laid out without recursion, so that deep trees can be drawn.
  */
 class AbstractDendrogramPlot:
   public AbstractTreeDrawing
@@ -59,10 +66,35 @@ class AbstractDendrogramPlot:
   private:
     short horOrientation_;
     short verOrientation_;
+    double lodMinHeight_;
+
+  protected:
+    /**
+     * @brief Sizes of the subtree of each node, indexed by node id.
+     */
+    struct SubtreeExtents_
+    {
+      /**
+       * @brief Number of leaves, collapsed nodes counting for one.
+       */
+      std::vector<size_t> nbLeaves;
+
+      /**
+       * @brief Largest distance to a leaf.
+       */
+      std::vector<double> heights;
+
+      /**
+       * @brief Largest number of branches to a leaf.
+       */
+      std::vector<size_t> depths;
+
+      SubtreeExtents_() : nbLeaves(), heights(), depths() {}
+    };
 
   public:
     AbstractDendrogramPlot():
-      AbstractTreeDrawing(), horOrientation_(ORIENTATION_LEFT_TO_RIGHT), verOrientation_(ORIENTATION_TOP_TO_BOTTOM)
+      AbstractTreeDrawing(), horOrientation_(ORIENTATION_LEFT_TO_RIGHT), verOrientation_(ORIENTATION_TOP_TO_BOTTOM), lodMinHeight_(0)
     {}
 
   public:
@@ -72,10 +104,60 @@ class AbstractDendrogramPlot:
     short getHorizontalOrientation() const { return horOrientation_; }
     short getVerticalOrientation() const { return verOrientation_; }
 
+    /**
+     * @brief Set the level of detail.
+     *
+     * Subtrees whose leaves span less than the given height, in device
+     * units, are drawn as a triangle from their root to the span of their
+     * leaves. No event is fired, and node infos are not updated, for the
+     * nodes within such subtrees. 0 (the default) means that all nodes
+     * are drawn.
+     */
+    void setLevelOfDetail(double minHeight) { lodMinHeight_ = minHeight; }
+    double getLevelOfDetail() const { return lodMinHeight_; }
+
     void plot(GraphicDevice& gDevice) const;
 
   protected:
     virtual void drawDendrogram_(GraphicDevice& gDevice) const = 0;
+
+    /**
+     * @brief Compute the extents of all subtrees, without recursion.
+     */
+    void getSubtreeExtents_(const INode& root, SubtreeExtents_& extents) const;
+
+    /**
+     * @brief Draw all nodes and branches, visiting nodes in post-order
+     * with an explicit stack.
+     *
+     * @param gDevice The device to draw on.
+     * @param x The horizontal position of the father of the root.
+     * @param hDirection 1 or -1, according to the horizontal orientation.
+     * @param vDirection 1 or -1, according to the vertical orientation.
+     */
+    void plotNodes_(GraphicDevice& gDevice, double x, double hDirection, double vDirection) const;
+
+    /**
+     * @return The horizontal position of a node.
+     *
+     * @param node The node.
+     * @param fatherX The horizontal position of its father.
+     * @param hDirection 1 or -1, according to the horizontal orientation.
+     * @param extents The extents of all subtrees.
+     * @param drawBranch [out] Tell if the branch to the father must be drawn.
+     */
+    virtual double getNodeX_(const INode& node, double fatherX, double hDirection, const SubtreeExtents_& extents, bool& drawBranch) const = 0;
+
+    /**
+     * @return The horizontal position of the farthest leaf of the subtree
+     * of a node, where the triangle drawn for that subtree ends.
+     */
+    virtual double getSubtreeTipsX_(const INode& node, double nodeX, double hDirection, const SubtreeExtents_& extents) const = 0;
+
+    /**
+     * @return A new event for the branch of a node.
+     */
+    virtual DrawIBranchEvent* newBranchEvent_(GraphicDevice& gDevice, const INode& node, double fatherX, double nodeX, const Cursor& cursor) const = 0;
    
   public:
     static short ORIENTATION_LEFT_TO_RIGHT;
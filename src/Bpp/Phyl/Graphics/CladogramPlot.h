@@ -97,7 +97,9 @@ class CladogramPlot:
     {
       if (hasTree())
       {
-        totalDepth_ = static_cast<double>(TreeTemplateTools::getDepth(*getTree_()->getRootNode()));  
+        SubtreeExtents_ extents;
+        getSubtreeExtents_(*getTree_()->getRootNode(), extents);
+        totalDepth_ = static_cast<double>(extents.depths[static_cast<size_t>(getTree_()->getRootId())]);
         numberOfLeaves_ = static_cast<double>(getTree_()->getNumberOfLeaves());
       }
     }
@@ -105,7 +107,23 @@ class CladogramPlot:
       
   private:
     void drawDendrogram_(GraphicDevice& gDevice) const;
-    void recursivePlot_(GraphicDevice& gDevice, INode& node, double x, double& y, double hDirection, double vDirection, unsigned int* tipCounter) const;
+
+    double getNodeX_(const INode& node, double fatherX, double hDirection, const SubtreeExtents_& extents, bool& drawBranch) const
+    {
+      drawBranch = true;
+      double depth = static_cast<double>(extents.depths[static_cast<size_t>(node.getId())]);
+      return ((getHorizontalOrientation() == ORIENTATION_LEFT_TO_RIGHT ? totalDepth_ : 0) - depth) * getXUnit() * hDirection;
+    }
+
+    double getSubtreeTipsX_(const INode& node, double nodeX, double hDirection, const SubtreeExtents_& extents) const
+    {
+      return (getHorizontalOrientation() == ORIENTATION_LEFT_TO_RIGHT ? totalDepth_ : 0) * getXUnit() * hDirection;
+    }
+
+    DrawIBranchEvent* newBranchEvent_(GraphicDevice& gDevice, const INode& node, double fatherX, double nodeX, const Cursor& cursor) const
+    {
+      return new CladogramDrawBranchEvent(this, &gDevice, &node, nodeX - fatherX, cursor, getHorizontalOrientation());
+    }
 
 };
 
@@ -95,7 +95,9 @@ class PhylogramPlot:
       if (hasTree())
       {
         getTree_()->setVoidBranchLengths(0.);
-        totalDepth_ = TreeTemplateTools::getHeight(*getTree_()->getRootNode());
+        SubtreeExtents_ extents;
+        getSubtreeExtents_(*getTree_()->getRootNode(), extents);
+        totalDepth_ = extents.heights[static_cast<size_t>(getTree_()->getRootId())];
         numberOfLeaves_ = static_cast<double>(getTree_()->getNumberOfLeaves());
       }
     }
@@ -103,7 +105,17 @@ class PhylogramPlot:
   private:
     void drawDendrogram_(GraphicDevice& gDevice) const;
  
-    void recursivePlot_(GraphicDevice& gDevice, INode& node, double x, double& y, double hDirection, double vDirection, unsigned int* tipCounter) const;
+    double getNodeX_(const INode& node, double fatherX, double hDirection, const SubtreeExtents_& extents, bool& drawBranch) const;
+
+    double getSubtreeTipsX_(const INode& node, double nodeX, double hDirection, const SubtreeExtents_& extents) const
+    {
+      return nodeX + hDirection * extents.heights[static_cast<size_t>(node.getId())] * getXUnit();
+    }
+
+    DrawIBranchEvent* newBranchEvent_(GraphicDevice& gDevice, const INode& node, double fatherX, double nodeX, const Cursor& cursor) const
+    {
+      return new PhylogramDrawBranchEvent(this, &gDevice, &node, cursor, getHorizontalOrientation());
+    }
 
 };
 
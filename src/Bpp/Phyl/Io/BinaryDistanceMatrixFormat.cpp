@@ -0,0 +1,104 @@
+//
+// File: BinaryDistanceMatrixFormat.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BinaryDistanceMatrixFormat.h"
+#include "BinaryTools.h"
+
+// From SeqLib:
+#include <Bpp/Seq/DistanceMatrix.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <memory>
+
+using namespace std;
+
+namespace
+{
+  const char DISTANCE_MATRIX_MAGIC[4] = {'B', 'P', 'P', 'D'};
+  const uint32_t DISTANCE_MATRIX_VERSION = 1;
+}
+
+DistanceMatrix* BinaryDistanceMatrixFormat::read(istream& in) const
+{
+  if (!BinaryTools::readHeader(in, DISTANCE_MATRIX_MAGIC, DISTANCE_MATRIX_VERSION))
+    throw IOException("BinaryDistanceMatrixFormat::read. No matrix found in stream.");
+  uint64_t size;
+  BinaryTools::readValue(in, size);
+  size_t n = static_cast<size_t>(size);
+  unique_ptr<DistanceMatrix> dist(new DistanceMatrix(n));
+  string name;
+  for (size_t i = 0; i < n; i++)
+  {
+    BinaryTools::readString(in, name);
+    dist->setName(i, name);
+  }
+  vector<double> triangle(n * (n + 1) / 2);
+  BinaryTools::readArray(in, triangle);
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j <= i; j++)
+    {
+      (*dist)(i, j) = (*dist)(j, i) = triangle[k++];
+    }
+  }
+  return dist.release();
+}
+
+void BinaryDistanceMatrixFormat::write(const DistanceMatrix& dist, ostream& out) const
+{
+  size_t n = dist.size();
+  BinaryTools::writeHeader(out, DISTANCE_MATRIX_MAGIC, DISTANCE_MATRIX_VERSION);
+  BinaryTools::writeValue(out, static_cast<uint64_t>(n));
+  for (size_t i = 0; i < n; i++)
+    BinaryTools::writeString(out, dist.getName(i));
+  vector<double> triangle;
+  triangle.reserve(n * (n + 1) / 2);
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j <= i; j++)
+    {
+      triangle.push_back(dist(i, j));
+    }
+  }
+  BinaryTools::writeArray(out, triangle);
+}
+
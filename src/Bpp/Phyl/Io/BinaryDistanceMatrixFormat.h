@@ -0,0 +1,91 @@
+//
+// File: BinaryDistanceMatrixFormat.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BINARYDISTANCEMATRIXFORMAT_H_
+#define _BINARYDISTANCEMATRIXFORMAT_H_
+
+#include "IoDistanceMatrix.h"
+
+namespace bpp
+{
+
+/**
+ * @brief Distance matrix I/O in a compact binary format.
+ *
+ * The file starts with a signature, a byte order mark, a version number
+ * and the size n of the matrix, followed by the n entry names and by the
+ * lower triangle of the matrix (diagonal included), row after row, as raw
+ * doubles. The triangle is written in one block, so that large matrices
+ * are read and written without any text conversion.
+ *
+ * The matrix is assumed to be symmetric: only the lower triangle is written.
+ * Numbers are stored with the byte order of the writing machine.
+ * Streams should be opened in binary mode.
+ */
+class BinaryDistanceMatrixFormat:
+  public AbstractIDistanceMatrix,
+  public AbstractODistanceMatrix
+{
+	public:
+		BinaryDistanceMatrixFormat() {}
+		virtual ~BinaryDistanceMatrixFormat() {}
+
+	public:
+		const std::string getFormatName() const { return "Binary"; }
+
+		const std::string getFormatDescription() const { return "Lower triangular matrix as raw doubles."; }
+
+		DistanceMatrix* read(const std::string& path) const
+		{
+			return AbstractIDistanceMatrix::read(path);
+		}
+		DistanceMatrix* read(std::istream& in) const;
+
+		void write(const DistanceMatrix& dist, const std::string& path, bool overwrite = true) const
+		{
+			AbstractODistanceMatrix::write(dist, path, overwrite);
+		}
+		void write(const DistanceMatrix& dist, std::ostream& out) const;
+
+};
+
+} //end of namespace bpp.
+
+#endif //_BINARYDISTANCEMATRIXFORMAT_H_
+
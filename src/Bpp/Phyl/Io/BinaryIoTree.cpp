@@ -0,0 +1,606 @@
+//
+// File: BinaryIoTree.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BinaryIoTree.h"
+#include "BinaryTools.h"
+#include "../Tree/FlatTopology.h"
+#include "../Tree/PhyloBranch.h"
+#include "../Tree/TreeTools.h"
+
+#include <Bpp/BppString.h>
+#include <Bpp/BppBoolean.h>
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <memory>
+#include <fstream>
+
+using namespace std;
+
+/******************************************************************************/
+
+const uint32_t BinaryIOTree::VERSION = 2;
+
+namespace
+{
+  const char BINARY_TREE_MAGIC[4] = {'B', 'P', 'P', 'T'};
+  const uint8_t HAS_LENGTH = 1;
+  const uint8_t HAS_BOOTSTRAP = 2;
+
+  // Property types, numbered as in Nhx:
+  const uint8_t PROPERTY_STRING = 0;
+  const uint8_t PROPERTY_INT = 1;
+  const uint8_t PROPERTY_DOUBLE = 2;
+  const uint8_t PROPERTY_BOOLEAN = 3;
+
+  typedef vector<pair<string, shared_ptr<Clonable> > > PropertyList;
+}
+
+/******************************************************************************/
+
+const string BinaryIOTree::getFormatName() const { return "Binary"; }
+
+/******************************************************************************/
+
+const string BinaryIOTree::getFormatDescription() const
+{
+  return string("Compact binary format: topology as an array of father indices, ")
+         + "raw branch lengths, bootstrap values, node names and properties.";
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::Record_::resize(size_t n)
+{
+  ids.resize(n);
+  fathers.resize(n);
+  flags.resize(n);
+  lengths.resize(n);
+  bootstraps.resize(n);
+  names.resize(n);
+  nodeProperties.resize(n);
+  branchProperties.resize(n);
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::writeProperties_(const PropertyList& properties, ostream& out)
+{
+  BinaryTools::writeValue(out, static_cast<uint32_t>(properties.size()));
+  for (size_t i = 0; i < properties.size(); i++)
+  {
+    const Clonable* property = properties[i].second.get();
+    BinaryTools::writeString(out, properties[i].first);
+    if (const BppString* str = dynamic_cast<const BppString*>(property))
+    {
+      BinaryTools::writeValue(out, PROPERTY_STRING);
+      BinaryTools::writeString(out, str->toSTL());
+    }
+    else if (const Number<int>* integer = dynamic_cast<const Number<int>*>(property))
+    {
+      BinaryTools::writeValue(out, PROPERTY_INT);
+      BinaryTools::writeValue(out, static_cast<int32_t>(integer->getValue()));
+    }
+    else if (const Number<double>* number = dynamic_cast<const Number<double>*>(property))
+    {
+      BinaryTools::writeValue(out, PROPERTY_DOUBLE);
+      BinaryTools::writeValue(out, number->getValue());
+    }
+    else if (const BppBoolean* boolean = dynamic_cast<const BppBoolean*>(property))
+    {
+      BinaryTools::writeValue(out, PROPERTY_BOOLEAN);
+      BinaryTools::writeValue(out, static_cast<uint8_t>(boolean->getValue() ? 1 : 0));
+    }
+    else
+      throw IOException("BinaryIOTree::write(). Unsupported class for property '" + properties[i].first + "'.");
+  }
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::readProperties_(istream& in, PropertyList& properties)
+{
+  uint32_t nbProperties;
+  BinaryTools::readValue(in, nbProperties);
+  properties.clear();
+  for (uint32_t i = 0; i < nbProperties; i++)
+  {
+    string name;
+    BinaryTools::readString(in, name);
+    uint8_t type;
+    BinaryTools::readValue(in, type);
+    Clonable* property;
+    if (type == PROPERTY_STRING)
+    {
+      string value;
+      BinaryTools::readString(in, value);
+      property = new BppString(value);
+    }
+    else if (type == PROPERTY_INT)
+    {
+      int32_t value;
+      BinaryTools::readValue(in, value);
+      property = new Number<int>(static_cast<int>(value));
+    }
+    else if (type == PROPERTY_DOUBLE)
+    {
+      double value;
+      BinaryTools::readValue(in, value);
+      property = new Number<double>(value);
+    }
+    else if (type == PROPERTY_BOOLEAN)
+    {
+      uint8_t value;
+      BinaryTools::readValue(in, value);
+      property = new BppBoolean(value != 0);
+    }
+    else
+      throw IOException("BinaryIOTree::read(). Unknown type for property '" + name + "'.");
+    properties.push_back(make_pair(name, shared_ptr<Clonable>(property)));
+  }
+}
+
+/******************************************************************************/
+
+bool BinaryIOTree::readRecord_(istream& in, Record_& record) const
+{
+  if (!BinaryTools::readHeader(in, BINARY_TREE_MAGIC, VERSION))
+    return false;
+  uint64_t nbNodes;
+  BinaryTools::readValue(in, nbNodes);
+  if (nbNodes == 0)
+    throw IOException("BinaryIOTree::read(). Empty tree record.");
+
+  size_t n = static_cast<size_t>(nbNodes);
+  record.resize(n);
+  BinaryTools::readArray(in, record.ids);
+  BinaryTools::readArray(in, record.fathers);
+  BinaryTools::readArray(in, record.flags);
+  BinaryTools::readArray(in, record.lengths);
+  BinaryTools::readArray(in, record.bootstraps);
+  vector<uint32_t> nameLengths(n);
+  BinaryTools::readArray(in, nameLengths);
+  for (size_t i = 0; i < n; i++)
+  {
+    // Nodes are in preorder: fathers always come first.
+    if (i == 0 ? record.fathers[i] != -1 : (record.fathers[i] < 0 || static_cast<size_t>(record.fathers[i]) >= i))
+      throw IOException("BinaryIOTree::read(). Invalid father index for node " + TextTools::toString(record.ids[i]) + ".");
+    record.names[i].resize(nameLengths[i]);
+    if (nameLengths[i] > 0)
+      in.read(&record.names[i][0], static_cast<streamsize>(nameLengths[i]));
+  }
+  if (!in)
+    throw IOException("BinaryIOTree::read(). Truncated tree record.");
+  for (size_t i = 0; i < n; i++)
+  {
+    readProperties_(in, record.nodeProperties[i]);
+    readProperties_(in, record.branchProperties[i]);
+  }
+  if (!in)
+    throw IOException("BinaryIOTree::read(). Truncated tree record.");
+  return true;
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::writeRecord_(const Record_& record, ostream& out) const
+{
+  if (!out) { throw IOException ("BinaryIOTree::write(). Failed to write to stream"); }
+  size_t n = record.ids.size();
+  BinaryTools::writeHeader(out, BINARY_TREE_MAGIC, VERSION);
+  BinaryTools::writeValue(out, static_cast<uint64_t>(n));
+  BinaryTools::writeArray(out, record.ids);
+  BinaryTools::writeArray(out, record.fathers);
+  BinaryTools::writeArray(out, record.flags);
+  BinaryTools::writeArray(out, record.lengths);
+  BinaryTools::writeArray(out, record.bootstraps);
+  vector<uint32_t> nameLengths(n);
+  for (size_t i = 0; i < n; i++)
+    nameLengths[i] = static_cast<uint32_t>(record.names[i].size());
+  BinaryTools::writeArray(out, nameLengths);
+  for (size_t i = 0; i < n; i++)
+    out.write(record.names[i].data(), static_cast<streamsize>(record.names[i].size()));
+  for (size_t i = 0; i < n; i++)
+  {
+    writeProperties_(record.nodeProperties[i], out);
+    writeProperties_(record.branchProperties[i], out);
+  }
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::toRecord_(const Tree& tree, Record_& record)
+{
+  FlatTopology topo(tree);
+  size_t n = topo.getNumberOfNodes();
+  record.resize(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    int id = topo.getNodeId(i);
+    record.ids[i] = static_cast<int32_t>(id);
+    size_t father = topo.getFather(i);
+    record.fathers[i] = (father == FlatTopology::NO_FATHER ? -1 : static_cast<int32_t>(father));
+    record.flags[i] = 0;
+    record.lengths[i] = 0.;
+    record.bootstraps[i] = 0.;
+    if (father != FlatTopology::NO_FATHER)
+    {
+      if (topo.hasBranchLength(i))
+      {
+        record.flags[i] |= HAS_LENGTH;
+        record.lengths[i] = topo.getBranchLength(i);
+      }
+      if (tree.hasBranchProperty(id, TreeTools::BOOTSTRAP))
+      {
+        const Number<double>* bs = dynamic_cast<const Number<double>*>(tree.getBranchProperty(id, TreeTools::BOOTSTRAP));
+        if (bs)
+        {
+          record.flags[i] |= HAS_BOOTSTRAP;
+          record.bootstraps[i] = bs->getValue();
+        }
+      }
+    }
+    record.names[i] = tree.hasNodeName(id) ? tree.getNodeName(id) : "";
+    record.nodeProperties[i].clear();
+    vector<string> names = tree.getNodePropertyNames(id);
+    for (size_t j = 0; j < names.size(); j++)
+      record.nodeProperties[i].push_back(make_pair(names[j], shared_ptr<Clonable>(tree.getNodeProperty(id, names[j])->clone())));
+    record.branchProperties[i].clear();
+    names = tree.getBranchPropertyNames(id);
+    for (size_t j = 0; j < names.size(); j++)
+    {
+      if (names[j] == TreeTools::BOOTSTRAP && (record.flags[i] & HAS_BOOTSTRAP))
+        continue;
+      record.branchProperties[i].push_back(make_pair(names[j], shared_ptr<Clonable>(tree.getBranchProperty(id, names[j])->clone())));
+    }
+  }
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::toRecord_(const PhyloTree& tree, Record_& record)
+{
+  // Same preorder as FlatTopology:
+  record.resize(0);
+  vector<pair<shared_ptr<PhyloNode>, int32_t> > stack(1, make_pair(tree.getRoot(), -1));
+  while (!stack.empty())
+  {
+    shared_ptr<PhyloNode> node = stack.back().first;
+    int32_t father = stack.back().second;
+    stack.pop_back();
+    int32_t index = static_cast<int32_t>(record.ids.size());
+    record.ids.push_back(static_cast<int32_t>(tree.getNodeIndex(node)));
+    record.fathers.push_back(father);
+    uint8_t flags = 0;
+    double length = 0., bootstrap = 0.;
+    PropertyList nodeProperties, branchProperties;
+    vector<string> names = node->getPropertyNames();
+    for (size_t j = 0; j < names.size(); j++)
+      nodeProperties.push_back(make_pair(names[j], shared_ptr<Clonable>(node->getProperty(names[j])->clone())));
+    if (father != -1)
+    {
+      shared_ptr<PhyloBranch> branch = tree.getEdgeToFather(node);
+      if (branch->hasLength())
+      {
+        flags |= HAS_LENGTH;
+        length = branch->getLength();
+      }
+      if (branch->hasProperty("bootstrap"))
+      {
+        const Number<double>* bs = dynamic_cast<const Number<double>*>(branch->getProperty("bootstrap"));
+        if (bs)
+        {
+          flags |= HAS_BOOTSTRAP;
+          bootstrap = bs->getValue();
+        }
+      }
+      names = branch->getPropertyNames();
+      for (size_t j = 0; j < names.size(); j++)
+      {
+        if (names[j] == "bootstrap" && (flags & HAS_BOOTSTRAP))
+          continue;
+        branchProperties.push_back(make_pair(names[j], shared_ptr<Clonable>(branch->getProperty(names[j])->clone())));
+      }
+    }
+    record.flags.push_back(flags);
+    record.lengths.push_back(length);
+    record.bootstraps.push_back(bootstrap);
+    record.names.push_back(node->hasName() ? node->getName() : "");
+    record.nodeProperties.push_back(nodeProperties);
+    record.branchProperties.push_back(branchProperties);
+    vector<shared_ptr<PhyloNode> > sons = tree.getSons(node);
+    for (size_t k = sons.size(); k > 0; k--)
+      stack.push_back(make_pair(sons[k - 1], index));
+  }
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* BinaryIOTree::toTree_(const Record_& record) const
+{
+  size_t n = record.ids.size();
+  vector<Node*> nodes(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    Node* node = new Node(record.ids[i]);
+    nodes[i] = node;
+    if (!record.names[i].empty())
+      node->setName(record.names[i]);
+    for (size_t j = 0; j < record.nodeProperties[i].size(); j++)
+      node->setNodeProperty(record.nodeProperties[i][j].first, *record.nodeProperties[i][j].second);
+    for (size_t j = 0; j < record.branchProperties[i].size(); j++)
+      node->setBranchProperty(record.branchProperties[i][j].first, *record.branchProperties[i][j].second);
+    if (i > 0)
+    {
+      nodes[static_cast<size_t>(record.fathers[i])]->addSon(node);
+      if (record.flags[i] & HAS_LENGTH)
+        node->setDistanceToFather(record.lengths[i]);
+      if (record.flags[i] & HAS_BOOTSTRAP)
+        node->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(record.bootstraps[i]));
+    }
+  }
+  return new TreeTemplate<Node>(nodes[0]);
+}
+
+/******************************************************************************/
+
+PhyloTree* BinaryIOTree::toPhyloTree_(const Record_& record) const
+{
+  size_t n = record.ids.size();
+  PhyloTree* tree = new PhyloTree();
+  vector<shared_ptr<PhyloNode> > nodes(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    shared_ptr<PhyloNode> node(new PhyloNode());
+    nodes[i] = node;
+    if (!record.names[i].empty())
+      node->setName(record.names[i]);
+    for (size_t j = 0; j < record.nodeProperties[i].size(); j++)
+      node->setProperty(record.nodeProperties[i][j].first, *record.nodeProperties[i][j].second);
+    PhyloTree::NodeIndex index = static_cast<PhyloTree::NodeIndex>(record.ids[i]);
+    if (i > 0)
+    {
+      shared_ptr<PhyloBranch> branch(new PhyloBranch());
+      if (record.flags[i] & HAS_LENGTH)
+        branch->setLength(record.lengths[i]);
+      if (record.flags[i] & HAS_BOOTSTRAP)
+        branch->setProperty("bootstrap", Number<double>(record.bootstraps[i]));
+      for (size_t j = 0; j < record.branchProperties[i].size(); j++)
+        branch->setProperty(record.branchProperties[i][j].first, *record.branchProperties[i][j].second);
+      tree->createNode(nodes[static_cast<size_t>(record.fathers[i])], node, branch);
+      tree->setEdgeIndex(branch, index);
+    }
+    else
+      tree->createNode(node);
+    tree->setNodeIndex(node, index);
+  }
+  tree->rootAt(nodes[0]);
+  return tree;
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* BinaryIOTree::read(const string& path) const
+{
+  ifstream input(path.c_str(), ios::in | ios::binary);
+  TreeTemplate<Node>* tree = read(input);
+  input.close();
+  return tree;
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* BinaryIOTree::read(istream& in) const
+{
+  if (!in) { throw IOException ("BinaryIOTree::read(). Failed to read from stream"); }
+  Record_ record;
+  if (!readRecord_(in, record))
+    throw IOException("BinaryIOTree::read(). No tree found in stream.");
+  return toTree_(record);
+}
+
+/******************************************************************************/
+
+PhyloTree* BinaryIOTree::readP(const string& path) const
+{
+  ifstream input(path.c_str(), ios::in | ios::binary);
+  PhyloTree* tree = readP(input);
+  input.close();
+  return tree;
+}
+
+/******************************************************************************/
+
+PhyloTree* BinaryIOTree::readP(istream& in) const
+{
+  if (!in) { throw IOException ("BinaryIOTree::readP(). Failed to read from stream"); }
+  Record_ record;
+  if (!readRecord_(in, record))
+    throw IOException("BinaryIOTree::readP(). No tree found in stream.");
+  return toPhyloTree_(record);
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::readTrees(const string& path, const std::function<bool (Tree*)>& handler) const
+{
+  ifstream input(path.c_str(), ios::in | ios::binary);
+  readTrees(input, handler);
+  input.close();
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::readTrees(istream& in, const std::function<bool (Tree*)>& handler) const
+{
+  if (!in) { throw IOException ("BinaryIOTree::read(). Failed to read from stream"); }
+  Record_ record;
+  while (readRecord_(in, record))
+  {
+    if (!handler(toTree_(record)))
+      break;
+  }
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::read(const string& path, vector<Tree*>& trees) const
+{
+  ifstream input(path.c_str(), ios::in | ios::binary);
+  read(input, trees);
+  input.close();
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::read(istream& in, vector<Tree*>& trees) const
+{
+  readTrees(in, [&trees](Tree* tree) { trees.push_back(tree); return true; });
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::read(const string& path, vector<PhyloTree*>& trees) const
+{
+  ifstream input(path.c_str(), ios::in | ios::binary);
+  read(input, trees);
+  input.close();
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::read(istream& in, vector<PhyloTree*>& trees) const
+{
+  if (!in) { throw IOException ("BinaryIOTree::read(). Failed to read from stream"); }
+  Record_ record;
+  while (readRecord_(in, record))
+    trees.push_back(toPhyloTree_(record));
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::write(const Tree& tree, const string& path, bool overwrite) const
+{
+  ofstream output(path.c_str(), overwrite ? (ios::out | ios::binary) : (ios::out | ios::app | ios::binary));
+  if (!output)
+    throw IOException("BinaryIOTree::write(). Could not open file " + path + ".");
+  write(tree, output);
+  output.close();
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::write(const Tree& tree, ostream& out) const
+{
+  Record_ record;
+  toRecord_(tree, record);
+  writeRecord_(record, out);
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::write(const PhyloTree& tree, const string& path, bool overwrite) const
+{
+  ofstream output(path.c_str(), overwrite ? (ios::out | ios::binary) : (ios::out | ios::app | ios::binary));
+  if (!output)
+    throw IOException("BinaryIOTree::write(). Could not open file " + path + ".");
+  write(tree, output);
+  output.close();
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::write(const PhyloTree& tree, ostream& out) const
+{
+  Record_ record;
+  toRecord_(tree, record);
+  writeRecord_(record, out);
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::write(const vector<const Tree*>& trees, const string& path, bool overwrite) const
+{
+  ofstream output(path.c_str(), overwrite ? (ios::out | ios::binary) : (ios::out | ios::app | ios::binary));
+  if (!output)
+    throw IOException("BinaryIOTree::write(). Could not open file " + path + ".");
+  write(trees, output);
+  output.close();
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::write(const vector<const Tree*>& trees, ostream& out) const
+{
+  Record_ record;
+  for (size_t i = 0; i < trees.size(); i++)
+  {
+    toRecord_(*trees[i], record);
+    writeRecord_(record, out);
+  }
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::write(const vector<const PhyloTree*>& trees, const string& path, bool overwrite) const
+{
+  ofstream output(path.c_str(), overwrite ? (ios::out | ios::binary) : (ios::out | ios::app | ios::binary));
+  if (!output)
+    throw IOException("BinaryIOTree::write(). Could not open file " + path + ".");
+  write(trees, output);
+  output.close();
+}
+
+/******************************************************************************/
+
+void BinaryIOTree::write(const vector<const PhyloTree*>& trees, ostream& out) const
+{
+  Record_ record;
+  for (size_t i = 0; i < trees.size(); i++)
+  {
+    toRecord_(*trees[i], record);
+    writeRecord_(record, out);
+  }
+}
+
+/******************************************************************************/
+
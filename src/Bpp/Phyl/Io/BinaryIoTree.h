@@ -0,0 +1,205 @@
+//
+// File: BinaryIoTree.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BINARYIOTREE_H_
+#define _BINARYIOTREE_H_
+
+#include "IoTree.h"
+#include "../Tree/TreeTemplate.h"
+#include "../Tree/PhyloTree.h"
+
+// From the STL:
+#include <vector>
+#include <string>
+#include <memory>
+#include <stdint.h>
+
+namespace bpp
+{
+
+  /**
+   * @brief Compact binary tree format, for checkpoints and exchange between processes.
+   *
+   * Each tree is stored as one self-contained record, so that several records can be
+   * appended to the same file. A record is made of:
+   * - the 4 bytes "BPPT", a 32 bits byte order mark and a 32 bits format version,
+   * - the number of nodes n, as a 64 bits integer,
+   * - n 32 bits node ids, in preorder,
+   * - n 32 bits father positions in the preorder (-1 for the root),
+   * - n flag bytes (bit 0: the branch has a length, bit 1: the branch has a bootstrap value),
+   * - n branch lengths and n bootstrap values, as doubles,
+   * - n 32 bits name lengths, followed by the concatenated node names,
+   * - for each node in preorder, its node properties then the properties of the branch
+   *   leading to it, each list starting with its 32 bits size, each property made of its
+   *   name (32 bits length and characters), a type byte and its value.
+   *
+   * All fixed-size arrays are written contiguously, so that a record can be loaded
+   * with a handful of bulk reads. Numbers are stored in the byte order of the
+   * writing machine; reading a file written with another byte order throws an IOException.
+   *
+   * Bootstrap values are taken from the TreeTools::BOOTSTRAP branch property for Tree
+   * objects, and from the "bootstrap" property for PhyloTree branches. All other node
+   * and branch properties are saved with their type, using the same types as the Nhx
+   * format: BppString, Number<int>, Number<double> and BppBoolean. Writing a tree with
+   * a property of any other class throws an IOException.
+   *
+   * Files are opened in binary mode by the methods taking a path; streams passed to the
+   * other methods should be opened in binary mode too.
+   */
+  class BinaryIOTree:
+    public virtual AbstractITree,
+    public virtual AbstractOTree,
+    public virtual AbstractIMultiTree,
+    public virtual AbstractOMultiTree
+  {
+  private:
+    struct Record_
+    {
+      std::vector<int32_t> ids;
+      std::vector<int32_t> fathers;
+      std::vector<uint8_t> flags;
+      std::vector<double> lengths;
+      std::vector<double> bootstraps;
+      std::vector<std::string> names;
+      std::vector<std::vector<std::pair<std::string, std::shared_ptr<Clonable> > > > nodeProperties;
+      std::vector<std::vector<std::pair<std::string, std::shared_ptr<Clonable> > > > branchProperties;
+
+      Record_() : ids(), fathers(), flags(), lengths(), bootstraps(), names(), nodeProperties(), branchProperties() {}
+      void resize(size_t n);
+    };
+
+  public:
+    static const uint32_t VERSION;
+
+  public:
+    BinaryIOTree() {}
+
+    virtual ~BinaryIOTree() {}
+
+  public:
+
+    /**
+     * @name The IOTree interface
+     *
+     * @{
+     */
+    const std::string getFormatName() const;
+    const std::string getFormatDescription() const;
+    /* @} */
+
+    /**
+     * @name The ITree interface
+     *
+     * @{
+     */
+    TreeTemplate<Node>* read(const std::string& path) const;
+
+    TreeTemplate<Node>* read(std::istream& in) const;
+
+    PhyloTree* readP(const std::string& path) const;
+
+    PhyloTree* readP(std::istream& in) const;
+    /** @} */
+
+    /**
+     * @name The OTree interface
+     *
+     * @{
+     */
+    void write(const Tree& tree, const std::string& path, bool overwrite = true) const;
+    void write(const Tree& tree, std::ostream& out) const;
+    void write(const PhyloTree& tree, const std::string& path, bool overwrite = true) const;
+    void write(const PhyloTree& tree, std::ostream& out) const;
+    /** @} */
+
+    /**
+     * @name The IMultiTree interface
+     *
+     * @{
+     */
+    void read(const std::string& path, std::vector<Tree*>& trees) const;
+    void read(std::istream& in, std::vector<Tree*>& trees) const;
+
+    void read(const std::string& path, std::vector<PhyloTree*>& trees) const;
+    void read(std::istream& in, std::vector<PhyloTree*>& trees) const;
+
+    void readTrees(const std::string& path, const std::function<bool (Tree*)>& handler) const;
+    void readTrees(std::istream& in, const std::function<bool (Tree*)>& handler) const;
+    /** @} */
+
+    /**
+     * @name The OMultiTree interface
+     *
+     * @{
+     */
+    void write(const std::vector<const Tree*>& trees, const std::string& path, bool overwrite = true) const;
+    void write(const std::vector<const Tree*>& trees, std::ostream& out) const;
+    void write(const std::vector<const PhyloTree*>& trees, const std::string& path, bool overwrite = true) const;
+    void write(const std::vector<const PhyloTree*>& trees, std::ostream& out) const;
+    /** @} */
+
+  private:
+    /**
+     * @brief Read the next record from a stream.
+     *
+     * @return false if the end of the stream was reached before a new record.
+     * @throw IOException If the record is truncated or malformed.
+     */
+    bool readRecord_(std::istream& in, Record_& record) const;
+
+    void writeRecord_(const Record_& record, std::ostream& out) const;
+
+    TreeTemplate<Node>* toTree_(const Record_& record) const;
+
+    PhyloTree* toPhyloTree_(const Record_& record) const;
+
+    static void toRecord_(const Tree& tree, Record_& record);
+
+    static void toRecord_(const PhyloTree& tree, Record_& record);
+
+    static void writeProperties_(const std::vector<std::pair<std::string, std::shared_ptr<Clonable> > >& properties, std::ostream& out);
+
+    static void readProperties_(std::istream& in, std::vector<std::pair<std::string, std::shared_ptr<Clonable> > >& properties);
+
+  };
+
+} //end of namespace bpp.
+
+#endif  //_BINARYIOTREE_H_
+
@@ -0,0 +1,133 @@
+//
+// File: BinarySiteBlockStream.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BinarySiteBlockStream.h"
+#include "BinaryTools.h"
+
+using namespace bpp;
+
+using namespace std;
+
+namespace
+{
+  const char SITES_MAGIC[4] = {'B', 'P', 'P', 'S'};
+  const uint32_t SITES_VERSION = 1;
+}
+
+/******************************************************************************/
+
+BinarySiteBlockWriter::BinarySiteBlockWriter(ostream& out, const vector<string>& names) :
+  out_(&out),
+  names_(names),
+  nbSites_(0)
+{
+  if (!out)
+    throw IOException("BinarySiteBlockWriter. Can't write to stream.");
+  BinaryTools::writeHeader(out, SITES_MAGIC, SITES_VERSION);
+  BinaryTools::writeValue(out, static_cast<uint64_t>(names_.size()));
+  for (size_t k = 0; k < names_.size(); k++)
+    BinaryTools::writeString(out, names_[k]);
+}
+
+/******************************************************************************/
+
+void BinarySiteBlockWriter::writeBlock(const VectorSiteContainer& sites, size_t firstSite, size_t nbSites)
+{
+  if (nbSites == 0)
+    return;
+  if (firstSite + nbSites > sites.getNumberOfSites())
+    throw IndexOutOfBoundsException("BinarySiteBlockWriter::writeBlock.", firstSite + nbSites - 1, 0, sites.getNumberOfSites() - 1);
+  vector<size_t> positions(names_.size());
+  for (size_t k = 0; k < names_.size(); k++)
+    positions[k] = sites.getSequencePosition(names_[k]);
+
+  BinaryTools::writeValue(*out_, static_cast<uint64_t>(nbSites));
+  vector<int32_t> states(names_.size());
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    const Site& site = sites.getSite(firstSite + i);
+    for (size_t k = 0; k < positions.size(); k++)
+      states[k] = static_cast<int32_t>(site[positions[k]]);
+    BinaryTools::writeArray(*out_, states);
+  }
+  nbSites_ += nbSites;
+}
+
+/******************************************************************************/
+
+BinarySiteBlockReader::BinarySiteBlockReader(istream& in, const Alphabet* alphabet) :
+  in_(&in),
+  alphabet_(alphabet),
+  names_(),
+  nbSites_(0)
+{
+  if (!BinaryTools::readHeader(in, SITES_MAGIC, SITES_VERSION))
+    throw IOException("BinarySiteBlockReader. No sites found in stream.");
+  uint64_t nbSequences;
+  BinaryTools::readValue(in, nbSequences);
+  names_.resize(static_cast<size_t>(nbSequences));
+  for (size_t k = 0; k < names_.size(); k++)
+    BinaryTools::readString(in, names_[k]);
+}
+
+/******************************************************************************/
+
+bool BinarySiteBlockReader::readBlock(VectorSiteContainer& sites)
+{
+  if (in_->peek() == istream::traits_type::eof())
+    return false;
+
+  uint64_t nbSites;
+  BinaryTools::readValue(*in_, nbSites);
+  VectorSiteContainer block(names_.size(), alphabet_);
+  block.setSequencesNames(names_, false);
+
+  vector<int32_t> states(names_.size());
+  vector<int> content(names_.size());
+  for (size_t i = 0; i < static_cast<size_t>(nbSites); i++)
+  {
+    BinaryTools::readArray(*in_, states);
+    for (size_t k = 0; k < states.size(); k++)
+      content[k] = static_cast<int>(states[k]);
+    block.addSite(Site(content, alphabet_, static_cast<int>(nbSites_ + i + 1)), false);
+  }
+  nbSites_ += static_cast<size_t>(nbSites);
+  sites = block;
+  return true;
+}
@@ -0,0 +1,182 @@
+//
+// File: BinarySiteBlockStream.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BINARYSITEBLOCKSTREAM_H_
+#define _BINARYSITEBLOCKSTREAM_H_
+
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+// From the STL:
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Write the states of an alignment to a binary stream, block of
+ * sites by block of sites.
+ *
+ * The stream starts with a header holding the sequence names. Each block
+ * then holds its number of sites, followed by the states of all sequences
+ * for each site of the block (sites are contiguous). Blocks can be
+ * appended as the alignment is read or converted, so that the whole
+ * alignment never needs to be in memory.
+ *
+ * @see BinarySiteBlockReader
+ */
+class BinarySiteBlockWriter
+{
+  private:
+    std::ostream* out_;
+    std::vector<std::string> names_;
+    size_t nbSites_;
+
+  public:
+    /**
+     * @brief Write the header of the stream.
+     *
+     * @param out   The output stream.
+     * @param names The names of the sequences, in the order of the blocks.
+     */
+    BinarySiteBlockWriter(std::ostream& out, const std::vector<std::string>& names);
+
+    BinarySiteBlockWriter(const BinarySiteBlockWriter& writer) :
+      out_(writer.out_),
+      names_(writer.names_),
+      nbSites_(writer.nbSites_)
+    {}
+
+    BinarySiteBlockWriter& operator=(const BinarySiteBlockWriter& writer)
+    {
+      out_ = writer.out_;
+      names_ = writer.names_;
+      nbSites_ = writer.nbSites_;
+      return *this;
+    }
+
+    virtual ~BinarySiteBlockWriter() {}
+
+  public:
+    /**
+     * @brief Write a block of sites.
+     *
+     * @param sites     The alignment, with all the sequences given in the header.
+     * @param firstSite The position of the first site of the block in sites.
+     * @param nbSites   The number of sites of the block.
+     * @throw SequenceNotFoundException If a sequence of the header is missing.
+     * @throw IndexOutOfBoundsException If the block goes past the last site.
+     */
+    void writeBlock(const VectorSiteContainer& sites, size_t firstSite, size_t nbSites);
+
+    /**
+     * @return The number of sites written so far.
+     */
+    size_t getNumberOfSitesWritten() const { return nbSites_; }
+};
+
+/**
+ * @brief Read an alignment written by BinarySiteBlockWriter, block by block.
+ *
+ * Only the current block is in memory: this is used to compute
+ * likelihoods of alignments which do not fit in memory (see
+ * computeStreamedLikelihood in NewPhyl/LikelihoodExample.h).
+ */
+class BinarySiteBlockReader
+{
+  private:
+    std::istream* in_;
+    const Alphabet* alphabet_;
+    std::vector<std::string> names_;
+    size_t nbSites_;
+
+  public:
+    /**
+     * @brief Read the header of the stream.
+     *
+     * @param in       The input stream.
+     * @param alphabet The alphabet of the states.
+     * @throw IOException If the stream does not hold binary sites.
+     */
+    BinarySiteBlockReader(std::istream& in, const Alphabet* alphabet);
+
+    BinarySiteBlockReader(const BinarySiteBlockReader& reader) :
+      in_(reader.in_),
+      alphabet_(reader.alphabet_),
+      names_(reader.names_),
+      nbSites_(reader.nbSites_)
+    {}
+
+    BinarySiteBlockReader& operator=(const BinarySiteBlockReader& reader)
+    {
+      in_ = reader.in_;
+      alphabet_ = reader.alphabet_;
+      names_ = reader.names_;
+      nbSites_ = reader.nbSites_;
+      return *this;
+    }
+
+    virtual ~BinarySiteBlockReader() {}
+
+  public:
+    const Alphabet* getAlphabet() const { return alphabet_; }
+
+    const std::vector<std::string>& getSequencesNames() const { return names_; }
+
+    /**
+     * @return The number of sites read so far.
+     */
+    size_t getNumberOfSitesRead() const { return nbSites_; }
+
+    /**
+     * @brief Read the next block of sites.
+     *
+     * Site positions follow the order of the sites in the stream.
+     *
+     * @param sites [out] The sites of the block (previous content is discarded).
+     * @return false if there are no more blocks.
+     * @throw IOException If the stream ends within a block.
+     */
+    bool readBlock(VectorSiteContainer& sites);
+};
+
+} //end of namespace bpp.
+
+#endif //_BINARYSITEBLOCKSTREAM_H_
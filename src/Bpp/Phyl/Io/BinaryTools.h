@@ -0,0 +1,159 @@
+//
+// File: BinaryTools.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BINARYTOOLS_H_
+#define _BINARYTOOLS_H_
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+namespace bpp
+{
+
+/**
+ * @brief Low-level helpers for the binary formats (trees, checkpoints).
+ *
+ * Values are written with the byte order of the machine, and arrays as
+ * contiguous blocks. Reading functions throw an IOException if the stream
+ * ends prematurely.
+ */
+class BinaryTools
+{
+  public:
+    template<class T>
+    static void writeValue(std::ostream& out, const T& value)
+    {
+      out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<class T>
+    static void readValue(std::istream& in, T& value)
+    {
+      in.read(reinterpret_cast<char*>(&value), sizeof(T));
+      if (!in)
+        throw IOException("BinaryTools::readValue(). Unexpected end of stream.");
+    }
+
+    /**
+     * @brief Write the elements of an array, without its size.
+     */
+    template<class T>
+    static void writeArray(std::ostream& out, const std::vector<T>& v)
+    {
+      if (!v.empty())
+        out.write(reinterpret_cast<const char*>(&v[0]), static_cast<std::streamsize>(v.size() * sizeof(T)));
+    }
+
+    /**
+     * @brief Read the elements of an array, which must already have the right size.
+     */
+    template<class T>
+    static void readArray(std::istream& in, std::vector<T>& v)
+    {
+      if (!v.empty())
+        in.read(reinterpret_cast<char*>(&v[0]), static_cast<std::streamsize>(v.size() * sizeof(T)));
+      if (!in)
+        throw IOException("BinaryTools::readArray(). Unexpected end of stream.");
+    }
+
+    static void writeString(std::ostream& out, const std::string& s)
+    {
+      writeValue(out, static_cast<uint32_t>(s.size()));
+      out.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+
+    static void readString(std::istream& in, std::string& s)
+    {
+      uint32_t size;
+      readValue(in, size);
+      s.resize(size);
+      if (size > 0)
+        in.read(&s[0], static_cast<std::streamsize>(size));
+      if (!in)
+        throw IOException("BinaryTools::readString(). Unexpected end of stream.");
+    }
+
+    /**
+     * @brief Write a file signature: 4 characters, a byte order mark and a version number.
+     */
+    static void writeHeader(std::ostream& out, const char magic[4], uint32_t version)
+    {
+      uint32_t byteOrder = BYTE_ORDER_MARK;
+      out.write(magic, 4);
+      writeValue(out, byteOrder);
+      writeValue(out, version);
+    }
+
+    /**
+     * @brief Check a file signature written by writeHeader.
+     *
+     * @return false if the stream was at its end before the signature.
+     * @throw IOException If the signature, byte order or version do not match.
+     */
+    static bool readHeader(std::istream& in, const char magic[4], uint32_t version)
+    {
+      char buffer[4];
+      in.read(buffer, 4);
+      if (in.gcount() == 0 && in.eof())
+        return false;
+      if (!in || std::string(buffer, 4) != std::string(magic, 4))
+        throw IOException("BinaryTools::readHeader(). Bad signature, expected " + std::string(magic, 4) + ".");
+      uint32_t byteOrder, v;
+      readValue(in, byteOrder);
+      if (byteOrder != BYTE_ORDER_MARK)
+        throw IOException("BinaryTools::readHeader(). Data were written with a different byte order.");
+      readValue(in, v);
+      if (v != version)
+        throw IOException("BinaryTools::readHeader(). Unsupported format version.");
+      return true;
+    }
+
+  private:
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+};
+
+} //end of namespace bpp.
+
+#endif //_BINARYTOOLS_H_
+
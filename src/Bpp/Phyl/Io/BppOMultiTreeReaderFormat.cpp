@@ -41,6 +41,7 @@
 #include "Newick.h"
 #include "NexusIoTree.h"
 #include "Nhx.h"
+#include "BinaryIoTree.h"
 
 #include <Bpp/Text/KeyvalTools.h>
 
@@ -59,7 +60,10 @@ IMultiTree* BppOMultiTreeReaderFormat::read(const std::string& description)
   if (format == "Newick")
   {
     bool allowComments = ApplicationTools::getBooleanParameter("allow_comments", unparsedArguments_, false, "", true, warningLevel_);
-    iTrees.reset(new Newick(allowComments));
+    unsigned int nbThreads = ApplicationTools::getParameter<unsigned int>("threads", unparsedArguments_, 1, "", true, warningLevel_);
+    Newick* newick = new Newick(allowComments);
+    newick->setNumberOfThreads(nbThreads);
+    iTrees.reset(newick);
   }
   else if (format == "Nhx")
   {
@@ -69,6 +73,10 @@ IMultiTree* BppOMultiTreeReaderFormat::read(const std::string& description)
   {
     iTrees.reset(new NexusIOTree());
   }
+  else if (format == "Binary")
+  {
+    iTrees.reset(new BinaryIOTree());
+  }
   else
   {
     throw Exception("Trees format '" + format + "' unknown.");
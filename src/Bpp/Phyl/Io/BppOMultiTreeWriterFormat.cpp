@@ -41,6 +41,7 @@
 #include "Newick.h"
 #include "NexusIoTree.h"
 #include "Nhx.h"
+#include "BinaryIoTree.h"
 
 #include <Bpp/Text/KeyvalTools.h>
 
@@ -69,6 +70,10 @@ OMultiTree* BppOMultiTreeWriterFormat::read(const std::string& description)
   {
     oTrees.reset(new NexusIOTree());
   }
+  else if (format == "Binary")
+  {
+    oTrees.reset(new BinaryIOTree());
+  }
   else
   {
     throw Exception("Trees format '" + format + "' unknown.");
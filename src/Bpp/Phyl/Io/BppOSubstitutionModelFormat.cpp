@@ -138,6 +138,7 @@
 using namespace bpp;
 
 // From the STL:
+#include <functional>
 #include <iomanip>
 #include <set>
 
@@ -153,11 +154,73 @@ unsigned char BppOSubstitutionModelFormat::BINARY = 32;
 unsigned char BppOSubstitutionModelFormat::ALL = 1 | 2 | 4 | 8 | 16 | 32;
 
 
+size_t BppOSubstitutionModelFormat::getDataFingerprint_(const AlignedValuesContainer* data)
+{
+  if (!data)
+    return 0;
+  hash<string> hashString;
+  hash<double> hashDouble;
+  size_t fingerprint = data->getNumberOfSequences() * 1000003 + data->getNumberOfSites();
+  vector<string> names = data->getSequencesNames();
+  for (size_t j = 0; j < names.size(); j++)
+    fingerprint = fingerprint * 31 + hashString(names[j]);
+  int nbStates = static_cast<int>(data->getAlphabet()->getSize());
+  for (size_t i = 0; i < data->getNumberOfSites(); i++)
+  {
+    for (size_t j = 0; j < names.size(); j++)
+    {
+      for (int s = 0; s < nbStates; s++)
+        fingerprint = fingerprint * 31 + hashDouble(data->getStateValueAt(i, j, s));
+    }
+  }
+  return fingerprint;
+}
+
+
 SubstitutionModel* BppOSubstitutionModelFormat::read(
   const Alphabet* alphabet,
   const std::string& modelDescription,
   const AlignedValuesContainer* data,
   bool parseArguments)
+{
+  // Data are identified by their content and not by their address,
+  // which may be reused by another container:
+  size_t dataFingerprint = getDataFingerprint_(data);
+  map<string, ModelPrototype_>::const_iterator it = prototypes_.find(modelDescription);
+  if (it != prototypes_.end()
+      && it->second.alphabet == alphabet
+      && it->second.hasData == (data != 0)
+      && it->second.dataFingerprint == dataFingerprint
+      && it->second.geneticCode == geneticCode_
+      && it->second.parseArguments == parseArguments)
+  {
+    if (verbose_)
+      ApplicationTools::displayResult("Substitution model", it->second.modelName + " (same description as before)");
+    unparsedArguments_ = it->second.unparsedArguments;
+    return it->second.model->clone();
+  }
+
+  unique_ptr<SubstitutionModel> model(read_(alphabet, modelDescription, data, parseArguments));
+
+  ModelPrototype_& prototype = prototypes_[modelDescription];
+  prototype.alphabet          = alphabet;
+  prototype.hasData           = (data != 0);
+  prototype.dataFingerprint   = dataFingerprint;
+  prototype.geneticCode       = geneticCode_;
+  prototype.parseArguments    = parseArguments;
+  prototype.modelName         = model->getName();
+  prototype.model.reset(model->clone());
+  prototype.unparsedArguments = unparsedArguments_;
+
+  return model.release();
+}
+
+
+SubstitutionModel* BppOSubstitutionModelFormat::read_(
+  const Alphabet* alphabet,
+  const std::string& modelDescription,
+  const AlignedValuesContainer* data,
+  bool parseArguments)
 {
   unparsedArguments_.clear();
   unique_ptr<SubstitutionModel> model;
@@ -48,6 +48,11 @@
 // From bpp-seq
 #include <Bpp/Seq/GeneticCode/GeneticCode.h>
 
+// From the STL:
+#include <map>
+#include <memory>
+#include <string>
+
 namespace bpp
 {
 /**
@@ -56,6 +61,16 @@ namespace bpp
  * Creates a new substitution model object according to model description syntax
  * (see the Bio++ Progam Suite manual for a detailed description of this syntax).
  *
+ * Models read are kept as prototypes, indexed by their description: reading
+ * again the same description with the same alphabet, data, genetic code and
+ * parseArguments flag returns a copy of the prototype, without parsing the
+ * description again. This is useful for non-homogeneous models, where
+ * many branches often share the same description. Data are compared by a
+ * fingerprint of their content, so that modified data or another container
+ * allocated at the same address are never mistaken for the data of a
+ * prototype. The cache is not copied with the format object, and can be
+ * emptied with clearModelCache().
+ *
  */
 
   class BppOSubstitutionModelFormat :
@@ -82,6 +97,21 @@ namespace bpp
     const GeneticCode* geneticCode_;
     int warningLevel_;
 
+  private:
+    struct ModelPrototype_
+    {
+      const Alphabet* alphabet;
+      bool hasData;
+      size_t dataFingerprint;
+      const GeneticCode* geneticCode;
+      bool parseArguments;
+      std::string modelName;
+      std::unique_ptr<SubstitutionModel> model;
+      std::map<std::string, std::string> unparsedArguments;
+    };
+
+    std::map<std::string, ModelPrototype_> prototypes_;
+
   public:
     /**
      * @brief Create a new BppOSubstitutionModelFormat object.
@@ -101,7 +131,8 @@ namespace bpp
       verbose_(verbose),
       unparsedArguments_(),
       geneticCode_(0),
-      warningLevel_(warn)
+      warningLevel_(warn),
+      prototypes_()
     {}
 
     BppOSubstitutionModelFormat(const BppOSubstitutionModelFormat& format):
@@ -112,7 +143,8 @@ namespace bpp
       verbose_(format.verbose_),
       unparsedArguments_(format.unparsedArguments_),
       geneticCode_(format.geneticCode_),
-      warningLevel_(format.warningLevel_)
+      warningLevel_(format.warningLevel_),
+      prototypes_()
     {}
 
     BppOSubstitutionModelFormat& operator=(const BppOSubstitutionModelFormat& format)
@@ -125,6 +157,7 @@ namespace bpp
       unparsedArguments_ = format.unparsedArguments_;
       geneticCode_       = format.geneticCode_;
       warningLevel_      = format.warningLevel_;
+      prototypes_.clear();
       return *this;
     }
 
@@ -145,6 +178,11 @@ namespace bpp
     }
 
     SubstitutionModel* read(const Alphabet* alphabet, const std::string& modelDescription, const AlignedValuesContainer* data = 0, bool parseArguments = true);
+
+    /**
+     * @brief Forget all the model prototypes kept by read(), to release memory.
+     */
+    void clearModelCache() { prototypes_.clear(); }
   
     const std::map<std::string, std::string>& getUnparsedArguments() const { return unparsedArguments_; }
 
@@ -168,6 +206,16 @@ namespace bpp
     void setVerbose(bool verbose) { verbose_=verbose;}
   
   private:
+    /**
+     * @brief Hash of the names and state values of a container, 0 if there are no data.
+     */
+    static size_t getDataFingerprint_(const AlignedValuesContainer* data);
+
+    /**
+     * @brief Parse a model description, without looking for a prototype.
+     */
+    SubstitutionModel* read_(const Alphabet* alphabet, const std::string& modelDescription, const AlignedValuesContainer* data, bool parseArguments);
+
     MixedSubstitutionModel* readMixed_(const Alphabet* alphabet, const std::string& modelDescription, const AlignedValuesContainer* data);
 
     SubstitutionModel* readWord_(const Alphabet* alphabet, const std::string& modelDescription, const AlignedValuesContainer* data);
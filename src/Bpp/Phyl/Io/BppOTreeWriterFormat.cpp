@@ -41,6 +41,7 @@
 #include "Newick.h"
 #include "NexusIoTree.h"
 #include "Nhx.h"
+#include "BinaryIoTree.h"
 
 #include <Bpp/Text/KeyvalTools.h>
 
@@ -69,6 +70,10 @@ OTree* BppOTreeWriterFormat::read(const std::string& description)
   {
     oTree.reset(new NexusIOTree());
   }
+  else if (format == "Binary")
+  {
+    oTree.reset(new BinaryIOTree());
+  }
   else
   {
     throw Exception("Tree format '" + format + "' unknown.");
@@ -39,20 +39,24 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "IoDistanceMatrixFactory.h"
 #include "PhylipDistanceMatrixFormat.h"
+#include "BinaryDistanceMatrixFormat.h"
 
 using namespace bpp;
 
 const std::string IODistanceMatrixFactory::PHYLIP_FORMAT = "Phylip"; 
+const std::string IODistanceMatrixFactory::BINARY_FORMAT = "Binary"; 
 
 IDistanceMatrix* IODistanceMatrixFactory::createReader(const std::string& format, bool extended)
 {
   if(format == PHYLIP_FORMAT) return new PhylipDistanceMatrixFormat(extended);
+  else if(format == BINARY_FORMAT) return new BinaryDistanceMatrixFormat();
   else throw Exception("Format " + format + " is not supported for input.");
 }
   
 ODistanceMatrix* IODistanceMatrixFactory::createWriter(const std::string& format, bool extended)
 {
   if(format == PHYLIP_FORMAT) return new PhylipDistanceMatrixFormat(extended);
+  else if(format == BINARY_FORMAT) return new BinaryDistanceMatrixFormat();
   else throw Exception("Format " + format + " is not supported for output.");
 }
 
@@ -60,6 +60,7 @@ class IODistanceMatrixFactory
 {
 public:
   static const std::string PHYLIP_FORMAT;  
+  static const std::string BINARY_FORMAT;  
 
 public:
 
@@ -81,7 +82,7 @@ public:
    *
    * @param format The input file format, and whether names should be
    *      only less than 10 characters, or not (false=10 characters max).
-   * @param extended format (default false).
+   * @param extended format (default false), ignored by the binary format.
    * @return A pointer toward a new IDistanceMatrix object.
    * @throw Exception If the format name do not match any available format.
    */
@@ -92,7 +93,7 @@ public:
    *
    * @param format The output file format, and whether names should be
    *        only less than 10 characters, or not (false=10 characters max).
-   * @param extended format (default false).
+   * @param extended format (default false), ignored by the binary format.
    * @return A pointer toward a new ODistanceMatrix object.
    * @throw Exception If the format name do not match any available format.
    */
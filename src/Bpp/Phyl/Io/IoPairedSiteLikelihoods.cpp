@@ -40,16 +40,24 @@
 // From the STL
 #include <vector>
 #include <numeric>
+#include <utility>
 
 // From Bio++
 #include <Bpp/Text/TextTools.h>
 #include "../Likelihood/PairedSiteLikelihoods.h"
 
 #include "IoPairedSiteLikelihoods.h"
+#include "BinaryTools.h"
 
 using namespace std;
 using namespace bpp;
 
+namespace
+{
+  const char PAIRED_SITE_MAGIC[4] = {'B', 'P', 'S', 'L'};
+  const uint32_t PAIRED_SITE_VERSION = 1;
+}
+
 /*
  * Read from a stream in Tree-puzzle, phylip-like format
  */
@@ -140,9 +148,11 @@ PairedSiteLikelihoods IOTreepuzzlePairedSiteLikelihoods::read(const std::string&
  */
 void IOTreepuzzlePairedSiteLikelihoods::write(const bpp::PairedSiteLikelihoods& psl, ostream& os, const string& delim)
 {
-  if (psl.getLikelihoods().size() == 0)
+  if (psl.getNumberOfModels() == 0)
     throw Exception("Writing an empty PairedSiteLikelihoods object to file.");
 
+  size_t nbSites = psl.getNumberOfSites();
+
   // Header line
   os << psl.getNumberOfModels() << " " << psl.getNumberOfSites() << endl;
 
@@ -154,14 +164,13 @@ void IOTreepuzzlePairedSiteLikelihoods::write(const bpp::PairedSiteLikelihoods&
     for (size_t i = 0; i < psl.getNumberOfModels(); ++i)
     {
       os << psl.getModelNames().at(i) << "\t";
-      for (vector<double>::const_iterator sitelik = psl.getLikelihoods().at(i).begin();
-           sitelik != psl.getLikelihoods().at(i).end();
-           ++sitelik)
+      const double* siteliks = psl.getSiteLogLikelihoods(i);
+      for (size_t s = 0; s < nbSites; ++s)
       {
-        if (sitelik == psl.getLikelihoods().at(i).end() - 1)
-          os << *sitelik;
+        if (s == nbSites - 1)
+          os << siteliks[s];
         else
-          os << *sitelik << " ";
+          os << siteliks[s] << " ";
       }
       os << endl;
     }
@@ -190,14 +199,13 @@ void IOTreepuzzlePairedSiteLikelihoods::write(const bpp::PairedSiteLikelihoods&
       os << name;
 
       // site-likelihoods field
-      for (vector<double>::const_iterator sitelik = psl.getLikelihoods().at(i).begin();
-           sitelik != psl.getLikelihoods().at(i).end();
-           ++sitelik)
+      const double* siteliks = psl.getSiteLogLikelihoods(i);
+      for (size_t s = 0; s < nbSites; ++s)
       {
-        if (sitelik == psl.getLikelihoods().at(i).end() - 1)
-          os << *sitelik;
+        if (s == nbSites - 1)
+          os << siteliks[s];
         else
-          os << *sitelik << " ";
+          os << siteliks[s] << " ";
       }
       os << endl;
     }
@@ -274,3 +282,61 @@ vector<double> IOPhymlPairedSiteLikelihoods::read(const std::string& path)
   return loglikelihoods;
 }
 
+/*
+ * Read from a stream in binary format
+ */
+PairedSiteLikelihoods IOBinaryPairedSiteLikelihoods::read(istream& is)
+{
+  if (!BinaryTools::readHeader(is, PAIRED_SITE_MAGIC, PAIRED_SITE_VERSION))
+    throw IOException("IOBinaryPairedSiteLikelihoods::read: Empty stream.");
+
+  uint32_t nbModels;
+  uint64_t nbSites;
+  BinaryTools::readValue(is, nbModels);
+  BinaryTools::readValue(is, nbSites);
+
+  vector<string> names(nbModels);
+  for (auto& name : names)
+    BinaryTools::readString(is, name);
+
+  // The matrix is stored model by model, as in memory:
+  vector<double> loglikelihoods(static_cast<size_t>(nbSites) * nbModels);
+  BinaryTools::readArray(is, loglikelihoods);
+
+  return PairedSiteLikelihoods(static_cast<size_t>(nbSites), std::move(loglikelihoods), names);
+}
+
+/*
+ * Read from a file in binary format
+ */
+PairedSiteLikelihoods IOBinaryPairedSiteLikelihoods::read(const std::string& path)
+{
+  ifstream iF (path.c_str(), ios::in | ios::binary);
+  PairedSiteLikelihoods psl (IOBinaryPairedSiteLikelihoods::read(iF));
+  return psl;
+}
+
+/*
+ * Write to a stream in binary format
+ */
+void IOBinaryPairedSiteLikelihoods::write(const PairedSiteLikelihoods& psl, ostream& os)
+{
+  if (psl.getNumberOfModels() == 0)
+    throw Exception("Writing an empty PairedSiteLikelihoods object to file.");
+
+  BinaryTools::writeHeader(os, PAIRED_SITE_MAGIC, PAIRED_SITE_VERSION);
+  BinaryTools::writeValue(os, static_cast<uint32_t>(psl.getNumberOfModels()));
+  BinaryTools::writeValue(os, static_cast<uint64_t>(psl.getNumberOfSites()));
+  for (const auto& name : psl.getModelNames())
+    BinaryTools::writeString(os, name);
+  BinaryTools::writeArray(os, psl.getLogLikelihoodMatrix());
+}
+
+/*
+ * Write to a file in binary format
+ */
+void IOBinaryPairedSiteLikelihoods::write(const PairedSiteLikelihoods& psl, const std::string& path)
+{
+  ofstream oF (path.c_str(), ios::out | ios::binary);
+  IOBinaryPairedSiteLikelihoods::write(psl, oF);
+}
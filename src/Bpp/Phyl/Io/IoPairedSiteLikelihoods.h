@@ -122,5 +122,49 @@ public:
    */
   static std::vector<double> read(const std::string& path);
 };
+
+
+/**
+ * @brief This class provides I/O for a compact binary paired-site likelihoods format.
+ *
+ * After a signature, the file stores the number of models and of sites,
+ * the model names, then the site log-likelihoods of each model as a
+ * contiguous block of doubles, which is the matrix of
+ * PairedSiteLikelihoods as stored in memory. Values are written with the byte order of
+ * the machine (see BinaryTools).
+ */
+class IOBinaryPairedSiteLikelihoods : public virtual IOPairedSiteLikelihoods
+{
+public:
+  /**
+   * @brief Read paired-site likelihoods from a binary stream.
+   *
+   * @throw IOException If the stream is not in the binary format, or ends prematurely.
+   */
+  static PairedSiteLikelihoods read(std::istream& is);
+
+  /**
+   * @brief Read paired-site likelihoods from a binary file.
+   *
+   * @throw IOException If the file is not in the binary format, or ends prematurely.
+   */
+  static PairedSiteLikelihoods read(const std::string& path);
+
+  /**
+   * @brief Write paired-site likelihoods to a binary stream.
+   *
+   * @param psl The PairedSiteLikelihoods object to write.
+   * @param os The output stream, opened in binary mode.
+   */
+  static void write(const PairedSiteLikelihoods& psl, std::ostream& os);
+
+  /**
+   * @brief Write paired-site likelihoods to a binary file.
+   *
+   * @param psl The PairedSiteLikelihoods object to write.
+   * @param path The path of the output file.
+   */
+  static void write(const PairedSiteLikelihoods& psl, const std::string& path);
+};
 } // namespace bpp
 #endif
@@ -48,6 +48,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <functional>
 
 #include <Bpp/Exceptions.h>
 #include <Bpp/Io/IoFormat.h>
@@ -277,6 +278,37 @@ you have the proper authorizations? ";
      */
     virtual void read(std::istream& in, std::vector<Tree*>& trees) const = 0;
     virtual void read(std::istream& in, std::vector<PhyloTree*>& trees) const = 0;
+
+    /**
+     * @brief Read trees from a stream, one at a time.
+     *
+     * Each tree is passed to the handler as soon as it is read, and is then owned by the handler.
+     * This allows to process files with more trees than would fit in memory at once.
+     *
+     * The default implementation reads all trees first, formats able to parse trees
+     * one at a time should override it.
+     *
+     * @param in The input stream.
+     * @param handler A function called on each tree, returning false to stop reading.
+     * @throw Exception If an error occured.
+     */
+    virtual void readTrees(std::istream& in, const std::function<bool (Tree*)>& handler) const
+    {
+      std::vector<Tree*> trees;
+      read(in, trees);
+      size_t i = 0;
+      while (i < trees.size() && handler(trees[i++])) {}
+      for (; i < trees.size(); i++)
+      {
+        delete trees[i];
+      }
+    }
+    virtual void readTrees(const std::string& path, const std::function<bool (Tree*)>& handler) const
+    {
+      std::ifstream input(path.c_str(), std::ios::in);
+      readTrees(input, handler);
+      input.close();
+    }
   };
 
 /**
@@ -41,18 +41,21 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "Newick.h"
 #include "NexusIoTree.h"
 #include "Nhx.h"
+#include "BinaryIoTree.h"
 
 using namespace bpp;
 
 const std::string IOTreeFactory::NEWICK_FORMAT = "Newick"; 
 const std::string IOTreeFactory::NEXUS_FORMAT = "Nexus"; 
 const std::string IOTreeFactory::NHX_FORMAT = "Nhx"; 
+const std::string IOTreeFactory::BINARY_FORMAT = "Binary"; 
 
 ITree* IOTreeFactory::createReader(const std::string& format)
 {
        if (format == NEWICK_FORMAT) return new Newick();
   else if (format == NEXUS_FORMAT) return new NexusIOTree();
   else if (format == NHX_FORMAT) return new Nhx();
+  else if (format == BINARY_FORMAT) return new BinaryIOTree();
   else throw Exception("Format " + format + " is not supported for input.");
 }
   
@@ -61,6 +64,7 @@ OTree* IOTreeFactory::createWriter(const std::string& format)
        if (format == NEWICK_FORMAT) return new Newick();
   else if (format == NEXUS_FORMAT) return new NexusIOTree();
   else if (format == NHX_FORMAT) return new Nhx();
+  else if (format == BINARY_FORMAT) return new BinaryIOTree();
   else throw Exception("Format " + format + " is not supported for output.");
 }
 
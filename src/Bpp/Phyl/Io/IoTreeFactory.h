@@ -57,6 +57,7 @@ public:
   static const std::string NEWICK_FORMAT;  
   static const std::string NEXUS_FORMAT;  
   static const std::string NHX_FORMAT;  
+  static const std::string BINARY_FORMAT;  
 
 public:
 
@@ -45,6 +45,7 @@
 #include "../Tree/PhyloTree.h"
 #include "../Tree/PhyloNode.h"
 #include "../Tree/PhyloBranch.h"
+#include "../SiteLoopExecutor.h"
 
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/Numeric/Number.h>
@@ -58,6 +59,10 @@ using namespace bpp;
 // From the STL:
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <limits>
+#include <iterator>
+#include <typeinfo>
 
 using namespace std;
 
@@ -133,26 +138,163 @@ PhyloTree* Newick::readP(istream& in) const
 
 void Newick::read(istream& in, vector<Tree*>& trees) const
 {
-  // Checking the existence of specified file
+  if (nbThreads_ <= 1)
+  {
+    readTrees(in, [&trees](Tree* tree) { trees.push_back(tree); return true; });
+    return;
+  }
+
   if (! in) { throw IOException ("Newick::read(vector): failed to read from stream"); }
-  
-  // Main loop : for all file lines
-  string temp, description;// Initialization
-  string::size_type index;
-  //We concatenate all line in file till we reach the ending semi colon:
-  while (getline(in, temp, '\n'))
+
+  // Split the whole stream at semi-colons, as readNextTree does:
+  string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+  vector<string> descriptions;
+  for (size_t start = 0, end = content.find(';'); end != string::npos; start = end + 1, end = content.find(';', start))
   {
-    index = temp.find(";");
-    if (index != string::npos)
+    string description = content.substr(start, end - start);
+    removeLineBreaks_(description);
+    if (allowComments_) description = TextTools::removeSubstrings(description, '[', ']');
+    if (!TextTools::isEmpty(description))
+      descriptions.push_back(description + ";");
+  }
+  content.clear();
+
+  vector<Tree*> parsed(descriptions.size(), 0);
+  try
+  {
+    SiteLoopExecutor executor(nbThreads_);
+    executor.run(descriptions.size(), [&](size_t first, size_t last)
     {
-      description += temp.substr(0, index + 1);
-      if (allowComments_) description = TextTools::removeSubstrings(description, '[', ']');
-      trees.push_back(TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_));
-      description = temp.substr(index + 1);
+      for (size_t i = first; i < last; i++)
+      {
+        parsed[i] = TreeTemplateTools::parenthesisToTree(descriptions[i], useBootstrap_, bootstrapPropertyName_, false, false);
+      }
+    });
+  }
+  catch (...)
+  {
+    for (size_t i = 0; i < parsed.size(); i++)
+    {
+      delete parsed[i];
     }
-    else description += temp;
+    throw;
   }
-  //In case the file is empty, the method will not add any neww tree to the vector.
+  trees.insert(trees.end(), parsed.begin(), parsed.end());
+}
+
+/******************************************************************************/
+
+void Newick::readTrees(istream& in, const std::function<bool (Tree*)>& handler) const
+{
+  // Checking the existence of specified file
+  if (! in) { throw IOException ("Newick::readTrees: failed to read from stream"); }
+
+  TreeTemplate<Node>* tree;
+  while ((tree = readNextTree(in)))
+  {
+    if (!handler(tree))
+      break;
+  }
+  //In case the file is empty, the handler is never called.
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* Newick::readNextTree(istream& in) const
+{
+  string description;
+  if (!readNextDescription_(in, description))
+    return 0;
+  return TreeTemplateTools::parenthesisToTree(description + ";", useBootstrap_, bootstrapPropertyName_, false, verbose_);
+}
+
+/******************************************************************************/
+
+bool Newick::readNextTree(istream& in, TreeTemplate<Node>& tree) const
+{
+  string description;
+  if (!readNextDescription_(in, description))
+    return false;
+
+  // Detach the nodes of the previous tree, and reset them:
+  vector<Node*> pool;
+  if (tree.getRootNode())
+    pool = tree.getNodes();
+  for (size_t i = 0; i < pool.size(); i++)
+  {
+    pool[i]->removeSons();
+  }
+  size_t nbRecycled = 0;
+  for (size_t i = 0; i < pool.size(); i++)
+  {
+    Node* node = pool[i];
+    if (typeid(*node) != typeid(Node))
+    {
+      delete node; // Only plain nodes are recycled.
+      continue;
+    }
+    node->setId(0);
+    node->deleteName();
+    node->deleteDistanceToFather();
+    node->deleteNodeProperties();
+    node->deleteBranchProperties();
+    pool[nbRecycled++] = node;
+  }
+  pool.resize(nbRecycled);
+
+  Node* root = 0;
+  try
+  {
+    unsigned int nodeCounter = 0;
+    root = TreeTemplateTools::parenthesisToNode(description, nodeCounter, useBootstrap_, bootstrapPropertyName_, false, verbose_, &pool);
+  }
+  catch (...)
+  {
+    // The previous tree is lost, leave a single node:
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+      delete pool[i];
+    }
+    tree.setRootNode(new Node());
+    throw;
+  }
+  // Nodes not used by this tree:
+  for (size_t i = 0; i < pool.size(); i++)
+  {
+    delete pool[i];
+  }
+  tree.setRootNode(root);
+  tree.resetNodesId();
+  if (verbose_)
+  {
+    (*ApplicationTools::message) << " nodes loaded.";
+    ApplicationTools::message->endLine();
+  }
+  return true;
+}
+
+/******************************************************************************/
+
+bool Newick::readNextDescription_(istream& in, string& description) const
+{
+  while (getline(in, description, ';'))
+  {
+    if (in.eof())
+      break; // Trailing text without semi-colon.
+    removeLineBreaks_(description);
+    if (allowComments_) description = TextTools::removeSubstrings(description, '[', ']');
+    if (!TextTools::isEmpty(description))
+      return true;
+  }
+  return false;
+}
+
+/******************************************************************************/
+
+void Newick::removeLineBreaks_(string& description)
+{
+  // Also removes the carriage returns of files written on Windows:
+  description.erase(remove_if(description.begin(), description.end(), [](char c) { return c == '\n' || c == '\r'; }), description.end());
 }
 
 /******************************************************************************/
@@ -248,103 +390,98 @@ AbstractITree::Element Newick::getElement(const string& elt) const
 
 shared_ptr<PhyloNode>  Newick::parenthesisToNode(PhyloTree& tree, shared_ptr<PhyloNode>  father, const string& description, unsigned int& nodeCounter, bool bootstrap, const string& propertyName, bool withId, bool verbose) const
 {
-//  cout << "NODE: " << description << endl;
-  AbstractITree::Element elt = getElement(description);
-
-  // New node:
-  std::shared_ptr<PhyloNode> node(new PhyloNode());
+  vector<TreeTemplateTools::Element> elements;
+  vector<size_t> fathers, postorder;
+  TreeTemplateTools::parseParenthesis(description, elements, fathers, postorder);
 
-  shared_ptr<PhyloBranch> branch(father?new PhyloBranch():0);
-
-  if (father)
+  vector<shared_ptr<PhyloNode> > nodes(elements.size());
+  vector<shared_ptr<PhyloBranch> > branches(elements.size());
+  for (size_t k = 0; k < elements.size(); k++)
   {
-    tree.createNode(father, node, branch);
+    const TreeTemplateTools::Element& elt = elements[k];
 
-    if (!TextTools::isEmpty(elt.length))
-      branch->setLength(TextTools::toDouble(elt.length));
-  }
-  else
-    tree.createNode(node);
+    // New node:
+    std::shared_ptr<PhyloNode> node(new PhyloNode());
+    nodes[k] = node;
+    shared_ptr<PhyloNode> nodeFather = (fathers[k] == numeric_limits<size_t>::max() ? father : nodes[fathers[k]]);
+    shared_ptr<PhyloBranch> branch(nodeFather ? new PhyloBranch() : 0);
+    branches[k] = branch;
 
-  if (!TextTools::isEmpty(elt.annotation))
-  {
-    if (withId)
+    if (nodeFather)
     {
-      auto id = static_cast<PhyloTree::NodeIndex> (TextTools::toInt(elt.annotation));
-      tree.setNodeIndex(node, id);
-      if (branch)
-        tree.setEdgeIndex(branch, id);
+      tree.createNode(nodeFather, node, branch);
+
+      if (!TextTools::isEmpty(elt.length))
+        branch->setLength(TextTools::toDouble(elt.length));
     }
     else
+      tree.createNode(node);
+
+    if (!TextTools::isEmpty(elt.bootstrap))
     {
-      if (bootstrap)
+      if (withId)
       {
+        auto id = static_cast<PhyloTree::NodeIndex> (TextTools::toInt(elt.bootstrap));
+        tree.setNodeIndex(node, id);
         if (branch)
-          branch->setProperty("bootstrap", Number<double>(TextTools::toDouble(elt.annotation)));
-        // cout << "NODE: BOOTSTRAP: " << * elt.bootstrap << endl;
+          tree.setEdgeIndex(branch, id);
       }
       else
       {
-        if (branch)
-          branch->setProperty(propertyName, BppString(elt.annotation));
+        if (bootstrap)
+        {
+          if (branch)
+            branch->setProperty("bootstrap", Number<double>(TextTools::toDouble(elt.bootstrap)));
+        }
+        else
+        {
+          if (branch)
+            branch->setProperty(propertyName, BppString(elt.bootstrap));
+        }
       }
     }
-  }
 
-  NestedStringTokenizer nt(elt.content, "(", ")", ",");
-  vector<string> elements;
-  while (nt.hasMoreToken())
-  {
-    elements.push_back(nt.nextToken());
-  }
-
-  if (elt.isLeaf)
-  {
-    // This is a leaf:
-    string name = TextTools::removeSurroundingWhiteSpaces(elements[0]);
-    if (withId)
+    if (elt.isLeaf)
     {
-      StringTokenizer st(name, "_", true, true);
-      ostringstream realName;
-      for (size_t i = 0; i < st.numberOfRemainingTokens() - 1; ++i)
+      // This is a leaf:
+      if (withId)
       {
-        if (i != 0)
+        StringTokenizer st(elt.content, "_", true, true);
+        ostringstream realName;
+        for (size_t i = 0; i < st.numberOfRemainingTokens() - 1; ++i)
         {
-          realName << "_";
+          if (i != 0)
+          {
+            realName << "_";
+          }
+          realName << st.getToken(i);
         }
-        realName << st.getToken(i);
-      }
-      node->setName(realName.str());
-      tree.setNodeIndex(node, static_cast<PhyloTree::NodeIndex> (
-            TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1))));
-      if (branch)
-        tree.setEdgeIndex(branch, static_cast<PhyloTree::NodeIndex> (
+        node->setName(realName.str());
+        tree.setNodeIndex(node, static_cast<PhyloTree::NodeIndex> (
               TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1))));
+        if (branch)
+          tree.setEdgeIndex(branch, static_cast<PhyloTree::NodeIndex> (
+                TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1))));
+      }
+      else
+        node->setName(elt.content);
     }
-    else
-      node->setName(name);
   }
-  else
+
+  // Indexes follow the order in which node descriptions end, as with the recursive parser:
+  for (size_t k = 0; k < postorder.size(); k++)
   {
-    // This is a node:
-    for (size_t i = 0; i < elements.size(); i++)
+    if (!withId)
     {
-      //    cout << "NODE: SUBNODE: " << i << ", " << elements[i] << endl;
-      parenthesisToNode(tree, node, elements[i], nodeCounter, bootstrap, propertyName, withId, verbose);
+      tree.setNodeIndex(nodes[postorder[k]], nodeCounter);
+      if (branches[postorder[k]])
+        tree.setEdgeIndex(branches[postorder[k]], nodeCounter);
     }
+    nodeCounter++;
+    if (verbose)
+      ApplicationTools::displayUnlimitedGauge(nodeCounter);
   }
-  
-  if (!withId)
-  {
-    tree.setNodeIndex(node,nodeCounter);
-    if (branch)
-      tree.setEdgeIndex(branch,nodeCounter);
-  }
-
-  nodeCounter++;
-  if (verbose)
-    ApplicationTools::displayUnlimitedGauge(nodeCounter);
-  return node;
+  return nodes[0];
 }
 
 /******************************************************************************/
@@ -379,11 +516,11 @@ void Newick::write_(const Tree& tree, ostream& out) const
   if (! out) { throw IOException ("Newick::writeTree: failed to write to stream"); }
   if(useBootstrap_)
   {
-    out << TreeTools::treeToParenthesis(tree, writeId_);
+    TreeTools::treeToParenthesis(tree, out, writeId_);
   }
   else
   {
-    out << TreeTools::treeToParenthesis(tree, false, bootstrapPropertyName_);
+    TreeTools::treeToParenthesis(tree, out, false, bootstrapPropertyName_);
   }
 }
 
@@ -393,11 +530,11 @@ void Newick::write_(const PhyloTree& tree, ostream& out) const
   if (! out) { throw IOException ("Newick::writeTree: failed to write to stream"); }
   if(useBootstrap_)
   {
-    out << treeToParenthesis(tree, writeId_);
+    treeToParenthesis(tree, out, writeId_);
   }
   else
   {
-    out << treeToParenthesis(tree, false, bootstrapPropertyName_);
+    treeToParenthesis(tree, out, false, bootstrapPropertyName_);
   }
 }
 
@@ -410,11 +547,11 @@ void Newick::write_(const TreeTemplate<N>& tree, ostream& out) const
   if (! out) { throw IOException ("Newick::writeTree: failed to write to stream"); }
   if(useBootstrap_)
   {
-    out << TreeTemplateTools::treeToParenthesis(tree, writeId_);
+    TreeTemplateTools::treeToParenthesis(tree, out, writeId_);
   }
   else
   {
-    out << TreeTemplateTools::treeToParenthesis(tree, false, bootstrapPropertyName_);
+    TreeTemplateTools::treeToParenthesis(tree, out, false, bootstrapPropertyName_);
   }
 }
 
@@ -429,11 +566,11 @@ void Newick::write_(const vector<const Tree*>& trees, ostream& out) const
   {
     if(useBootstrap_)
     {
-      out << TreeTools::treeToParenthesis(*trees[i], writeId_);
+      TreeTools::treeToParenthesis(*trees[i], out, writeId_);
     }
     else
     {
-      out << TreeTools::treeToParenthesis(*trees[i], false, bootstrapPropertyName_);
+      TreeTools::treeToParenthesis(*trees[i], out, false, bootstrapPropertyName_);
     }
   }
 }
@@ -449,11 +586,11 @@ void Newick::write_(const vector<TreeTemplate<N>*>& trees, ostream& out) const
   {
     if(useBootstrap_)
     {
-      out << TreeTemplateTools::treeToParenthesis(*trees[i], writeId_);
+      TreeTemplateTools::treeToParenthesis(*trees[i], out, writeId_);
     }
     else
     {
-      out << TreeTemplateTools::treeToParenthesis(*trees[i], false, bootstrapPropertyName_);
+      TreeTemplateTools::treeToParenthesis(*trees[i], out, false, bootstrapPropertyName_);
     }
   }
 }
@@ -468,20 +605,20 @@ void Newick::write_(const vector<const PhyloTree*>& trees, ostream& out) const
   {
     if(useBootstrap_)
     {
-      out << treeToParenthesis(*trees[i], writeId_);
+      treeToParenthesis(*trees[i], out, writeId_);
     }
     else
     {
-      out << treeToParenthesis(*trees[i], false, bootstrapPropertyName_);
+      treeToParenthesis(*trees[i], out, false, bootstrapPropertyName_);
     }
   }
 }
 
 /******************************************************************************/
 
-string Newick::nodeToParenthesis(const PhyloTree& tree, const std::shared_ptr<PhyloNode> node, bool writeId) const
+void Newick::nodeToParenthesis(const PhyloTree& tree, const std::shared_ptr<PhyloNode> node, ostream& s, bool writeId) const
 {
-  ostringstream s;
+  TreeTools::DefaultNumberFormat format(s);
   shared_ptr<PhyloBranch> branch=tree.hasFather(node)?tree.getEdgeToFather(node):0;
 
   if (tree.getNumberOfSons(node)==0)
@@ -499,7 +636,7 @@ string Newick::nodeToParenthesis(const PhyloTree& tree, const std::shared_ptr<Ph
       if (it!=vSons.begin())
         s << ",";
       
-      s << nodeToParenthesis(tree, *it);
+      nodeToParenthesis(tree, *it, s, writeId);
     }
 
     s << ")";
@@ -519,14 +656,22 @@ string Newick::nodeToParenthesis(const PhyloTree& tree, const std::shared_ptr<Ph
 
   if (branch && branch->hasLength())
     s << ":" << branch->getLength();
-  return s.str();  
 }
 
 /******************************************************************************/
 
-string Newick::nodeToParenthesis(const PhyloTree& tree, const std::shared_ptr<PhyloNode> node, bool bootstrap, const string& propertyName) const
+string Newick::nodeToParenthesis(const PhyloTree& tree, const std::shared_ptr<PhyloNode> node, bool writeId) const
 {
   ostringstream s;
+  nodeToParenthesis(tree, node, s, writeId);
+  return s.str();
+}
+
+/******************************************************************************/
+
+void Newick::nodeToParenthesis(const PhyloTree& tree, const std::shared_ptr<PhyloNode> node, ostream& s, bool bootstrap, const string& propertyName) const
+{
+  TreeTools::DefaultNumberFormat format(s);
   shared_ptr<PhyloBranch> branch=tree.hasFather(node)?tree.getEdgeToFather(node):0;
 
   if (tree.getNumberOfSons(node)==0)
@@ -544,7 +689,7 @@ string Newick::nodeToParenthesis(const PhyloTree& tree, const std::shared_ptr<Ph
       if (it!=vSons.begin())
         s << ",";
 
-      s << nodeToParenthesis(tree, *it, bootstrap, propertyName);
+      nodeToParenthesis(tree, *it, s, bootstrap, propertyName);
     }
 
     s << ")";
@@ -566,15 +711,22 @@ string Newick::nodeToParenthesis(const PhyloTree& tree, const std::shared_ptr<Ph
 
   if (branch && branch->hasLength())
     s << ":" << branch->getLength();
-
-  return s.str();  
 }
 
 /******************************************************************************/
 
-string Newick::treeToParenthesis(const PhyloTree& tree, bool writeId) const
+string Newick::nodeToParenthesis(const PhyloTree& tree, const std::shared_ptr<PhyloNode> node, bool bootstrap, const string& propertyName) const
 {
   ostringstream s;
+  nodeToParenthesis(tree, node, s, bootstrap, propertyName);
+  return s.str();
+}
+
+/******************************************************************************/
+
+void Newick::treeToParenthesis(const PhyloTree& tree, ostream& s, bool writeId) const
+{
+  TreeTools::DefaultNumberFormat format(s);
   s << "(";
 
   shared_ptr<PhyloNode>  root = tree.getRoot();
@@ -587,7 +739,7 @@ string Newick::treeToParenthesis(const PhyloTree& tree, bool writeId) const
     {
       if (i!=0)
         s << ",";
-      s << nodeToParenthesis(tree, rSons[i], writeId);
+      nodeToParenthesis(tree, rSons[i], s, writeId);
     }
   }
   else
@@ -598,7 +750,7 @@ string Newick::treeToParenthesis(const PhyloTree& tree, bool writeId) const
     {
       if (i!=0)
         s << ",";
-      s << nodeToParenthesis(tree, rSons[i], writeId);
+      nodeToParenthesis(tree, rSons[i], s, writeId);
     }
   }
 
@@ -608,16 +760,23 @@ string Newick::treeToParenthesis(const PhyloTree& tree, bool writeId) const
 
   if (branch && branch->hasLength())
     s << ":" << branch->getLength();
-  s << ";" << endl;
-
-  return s.str();  
+  s << ";\n";
 }
 
 /******************************************************************************/
 
-string Newick::treeToParenthesis(const PhyloTree& tree, bool bootstrap, const string& propertyName) const
+string Newick::treeToParenthesis(const PhyloTree& tree, bool writeId) const
 {
   ostringstream s;
+  treeToParenthesis(tree, s, writeId);
+  return s.str();
+}
+
+/******************************************************************************/
+
+void Newick::treeToParenthesis(const PhyloTree& tree, ostream& s, bool bootstrap, const string& propertyName) const
+{
+  TreeTools::DefaultNumberFormat format(s);
   s << "(";
 
   shared_ptr<PhyloNode>  root = tree.getRoot();
@@ -630,7 +789,7 @@ string Newick::treeToParenthesis(const PhyloTree& tree, bool bootstrap, const st
     {
       if (i!=0)
         s << ",";
-      s << nodeToParenthesis(tree, rSons[i], bootstrap, propertyName);
+      nodeToParenthesis(tree, rSons[i], s, bootstrap, propertyName);
     }
   }
   else
@@ -641,7 +800,7 @@ string Newick::treeToParenthesis(const PhyloTree& tree, bool bootstrap, const st
     {
       if (i!=0)
         s << ",";
-      s << nodeToParenthesis(tree, rSons[i], bootstrap, propertyName);
+      nodeToParenthesis(tree, rSons[i], s, bootstrap, propertyName);
     }
   }
 
@@ -663,7 +822,15 @@ string Newick::treeToParenthesis(const PhyloTree& tree, bool bootstrap, const st
     }
   }
   
-  s << ";" << endl;
-  return s.str();  
+  s << ";\n";
+}
+
+/******************************************************************************/
+
+string Newick::treeToParenthesis(const PhyloTree& tree, bool bootstrap, const string& propertyName) const
+{
+  ostringstream s;
+  treeToParenthesis(tree, s, bootstrap, propertyName);
+  return s.str();
 }
 
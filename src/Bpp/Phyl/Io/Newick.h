@@ -44,6 +44,9 @@
 #include "../Tree/TreeTemplate.h"
 #include "../Tree/PhyloTree.h"
 
+// From the STL:
+#include <algorithm>
+
 namespace bpp
 {
 
@@ -93,6 +96,7 @@ namespace bpp
     bool useBootstrap_;
     std::string bootstrapPropertyName_;
     bool verbose_;
+    size_t nbThreads_;
 	
   public:
 		
@@ -110,7 +114,8 @@ namespace bpp
       writeId_(writeId),
       useBootstrap_(true),
       bootstrapPropertyName_("bootstrap"),
-      verbose_(verbose) {}
+      verbose_(verbose),
+      nbThreads_(1) {}
 
     virtual ~Newick() {}
 
@@ -127,6 +132,18 @@ namespace bpp
       bootstrapPropertyName_ = "bootstrap";
     }
 
+    /**
+     * @brief Set the number of threads used to parse multi-tree files (1 by default).
+     *
+     * With more than one thread, read(std::istream&, std::vector<Tree*>&) loads the whole stream,
+     * splits it at semi-colons and parses the tree descriptions concurrently. Trees are returned
+     * in file order. Progress is then not displayed, whatever the verbose option.
+     * readTrees() always parses trees one at a time.
+     */
+    void setNumberOfThreads(size_t nbThreads) { nbThreads_ = std::max<size_t>(nbThreads, 1); }
+
+    size_t getNumberOfThreads() const { return nbThreads_; }
+
     /**
      * @name The IOTree interface
      *
@@ -207,6 +224,37 @@ namespace bpp
       AbstractIMultiTree::read(path, trees);
     }
     void read(std::istream& in, std::vector<PhyloTree*>& trees) const;
+
+    void readTrees(const std::string& path, const std::function<bool (Tree*)>& handler) const
+    {
+      IMultiTree::readTrees(path, handler);
+    }
+    void readTrees(std::istream& in, const std::function<bool (Tree*)>& handler) const;
+
+    /**
+     * @brief Read the next tree of a multi-tree stream.
+     *
+     * Contrary to read(std::istream&, std::vector<Tree*>&), trees are parsed one at a time,
+     * so that large tree files can be processed without holding all trees in memory.
+     *
+     * @param in The input stream.
+     * @return The next tree, or NULL if the end of the stream was reached.
+     * @see BipartitionCounter
+     */
+    TreeTemplate<Node>* readNextTree(std::istream& in) const;
+
+    /**
+     * @brief Read the next tree of a multi-tree stream into an existing tree.
+     *
+     * The nodes of the previous content of the tree are recycled for the new one, so that
+     * reading a whole stream into the same tree only allocates nodes when a tree is larger
+     * than the previous one. Nodes of other types than Node are not recycled.
+     *
+     * @param in The input stream.
+     * @param tree The tree to fill. It can be empty, and is left with a single node if parsing fails.
+     * @return false if the end of the stream was reached, in which case the tree is not modified.
+     */
+    bool readNextTree(std::istream& in, TreeTemplate<Node>& tree) const;
 /**@}*/
 
     /**
@@ -236,6 +284,16 @@ namespace bpp
     }
     /** @} */
 
+  private:
+    /**
+     * @brief Read the next non-empty tree description, without its semi-colon.
+     *
+     * @return false if the end of the stream was reached.
+     */
+    bool readNextDescription_(std::istream& in, std::string& description) const;
+
+    static void removeLineBreaks_(std::string& description);
+
   protected:
     void write_(const Tree& tree, std::ostream& out) const;
 
@@ -266,6 +324,13 @@ namespace bpp
 
     std::string nodeToParenthesis(const PhyloTree& tree, std::shared_ptr<PhyloNode> node, bool writeId = false) const;
 
+    /**
+     * @brief Same as above, but writes the description to a stream.
+     *
+     * Numbers are written as in the string version, whatever the settings of the stream.
+     */
+    void nodeToParenthesis(const PhyloTree& tree, std::shared_ptr<PhyloNode> node, std::ostream& out, bool writeId = false) const;
+
 /* @brief Get the parenthesis description of a subtree.
  *
  * @param tree The tree
@@ -281,6 +346,13 @@ namespace bpp
 
     std::string nodeToParenthesis(const PhyloTree& tree, std::shared_ptr<PhyloNode> node, bool bootstrap, const std::string& propertyName) const;
 
+    /**
+     * @brief Same as above, but writes the description to a stream.
+     *
+     * Numbers are written as in the string version, whatever the settings of the stream.
+     */
+    void nodeToParenthesis(const PhyloTree& tree, std::shared_ptr<PhyloNode> node, std::ostream& out, bool bootstrap, const std::string& propertyName) const;
+
 /**
  * @brief Get the parenthesis description of a tree.
  *
@@ -293,6 +365,13 @@ namespace bpp
 
     std::string treeToParenthesis(const PhyloTree& tree, bool writeId = false) const;
 
+    /**
+     * @brief Same as above, but writes the description to a stream.
+     *
+     * Numbers are written as in the string version, whatever the settings of the stream.
+     */
+    void treeToParenthesis(const PhyloTree& tree, std::ostream& out, bool writeId = false) const;
+
 /**
  * @brief Get the parenthesis description of a tree.
  *
@@ -306,6 +385,13 @@ namespace bpp
  * @return A string in the parenthesis format.
  */
     std::string treeToParenthesis(const PhyloTree& tree, bool bootstrap, const std::string& propertyName) const;
+
+    /**
+     * @brief Same as above, but writes the description to a stream.
+     *
+     * Numbers are written as in the string version, whatever the settings of the stream.
+     */
+    void treeToParenthesis(const PhyloTree& tree, std::ostream& out, bool bootstrap, const std::string& propertyName) const;
     
   };
 
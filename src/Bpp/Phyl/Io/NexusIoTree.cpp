@@ -91,6 +91,13 @@ TreeTemplate<Node> * NexusIOTree::read(istream &in) const
 /******************************************************************************/
 
 void NexusIOTree::read(std::istream& in, std::vector<Tree*>& trees) const
+{
+  readTrees(in, [&trees](Tree* tree) { trees.push_back(tree); return true; });
+}
+
+/******************************************************************************/
+
+void NexusIOTree::readTrees(std::istream& in, const std::function<bool (Tree*)>& handler) const
 {
   // Checking the existence of specified file
   if (! in) { throw IOException ("NexusIOTree::read(). Failed to read from stream"); }
@@ -161,7 +168,8 @@ void NexusIOTree::read(std::istream& in, std::vector<Tree*>& trees) const
               leaves[i]->setName(translation[name]);
             }
         }
-      trees.push_back(tree);
+      if (!handler(tree))
+        break;
       cmdFound = NexusTools::getNextCommand(in, cmdName, cmdArgs, false);
       if (cmdFound) cmdName = TextTools::toUpper(cmdName);
     }
@@ -146,6 +146,12 @@ namespace bpp
     }
     
     void read(std::istream& in, std::vector<PhyloTree*>& trees) const;
+
+    void readTrees(const std::string& path, const std::function<bool (Tree*)>& handler) const
+    {
+      IMultiTree::readTrees(path, handler);
+    }
+    void readTrees(std::istream& in, const std::function<bool (Tree*)>& handler) const;
 /**@}*/
 
     /**
@@ -61,8 +61,73 @@ using namespace std;
 
 /******************************************************************************/
 
+namespace
+{
+  /*
+   * Splits a "&&NHX:tag=value:..." annotation into (tag, value) pairs, in
+   * their order of appearance. ']' characters are ignored, and tokens
+   * without '=' are skipped.
+   */
+  void splitNhxProperties(const string& properties, vector<pair<string, string> >& props)
+  {
+    size_t n = properties.size();
+    size_t i = 0;
+    string tag, value;
+    while (i <= n)
+    {
+      // One token, up to the next ':'.
+      tag.clear();
+      value.clear();
+      bool hasEqual = false;
+      bool secondEqual = false;
+      for (; i < n && properties[i] != ':'; ++i)
+      {
+        char c = properties[i];
+        if (c == ']')
+          continue;
+        if (c == '=')
+        {
+          if (hasEqual)
+            secondEqual = true;
+          hasEqual = true;
+        }
+        else if (!hasEqual)
+          tag += c;
+        else if (!secondEqual)
+          value += c;
+      }
+      if (hasEqual)
+        props.push_back(make_pair(tag, value));
+      ++i;
+    }
+  }
+
+  /*
+   * Converts a value according to a Property type, and passes it to a
+   * setter, which copies it. The value is built on the stack.
+   */
+  template<class Setter>
+  void setTypedProperty(const string& value, short type, const Setter& setter)
+  {
+    if (type == 0) {
+      setter(BppString(value));
+    } else if (type == 1) {
+      setter(Number<int>(TextTools::toInt(value)));
+    } else if (type == 2) {
+      setter(Number<double>(TextTools::toDouble(value)));
+    } else if (type == 3) {
+      setter(BppBoolean(TextTools::to<bool>(value)));
+    } else {
+      throw Exception("Nhx::stringToProperty_. Unsupported type: " + TextTools::toString(type));
+    }
+  }
+}
+
+/******************************************************************************/
+
 Nhx::Nhx(bool useTagsAsPptNames):
   supportedProperties_(),
+  propertiesByTag_(),
   useTagsAsPropertyNames_(useTagsAsPptNames),
   hasIds_(false)
 {
@@ -492,42 +557,37 @@ void Nhx::checkNodesId_(PhyloTree& tree) const
 
 bool Nhx::setNodeProperties(Node& node, const string properties) const
 {
-  string propsDesc = TextTools::removeChar(properties, ']');
-  StringTokenizer st(propsDesc, ":", true, true);
-  map<string, string> props; 
-  while (st.hasMoreToken())
-  {
-    string token = st.nextToken();
-    if (TextTools::hasSubstring(token, "=")) {
-      StringTokenizer pt(token, "=", true, true);
-      string tag = pt.nextToken();
-      string value = pt.nextToken();
-      props[tag] = value;
-    }
-  }
+  vector<pair<string, string> > props;
+  splitNhxProperties(properties, props);
 
-  for (set<Property>::iterator it = supportedProperties_.begin(); it != supportedProperties_.end(); ++it) {
-    if (props.find(it->tag) != props.end()) {
-      //Property found
-      string ppt = (useTagsAsPropertyNames_ ? it->tag : it->name);
-      if (it->onBranch) {
-        node.setBranchProperty(ppt, *unique_ptr<Clonable>(stringToProperty_(props[it->tag], it->type)));
-      } else {
-        node.setNodeProperty(ppt, *unique_ptr<Clonable>(stringToProperty_(props[it->tag], it->type)));
-      }
-    }
-  }
-     
   //If the ND tag is present and is decimal, we use it has the node id:
   bool hasId = false;
-  
-  if (props.find("ND") != props.end()) {
-    string prop = props["ND"];
-    if (TextTools::isDecimalNumber(prop))
+  const string* id = 0;
+  for (size_t i = 0; i < props.size(); ++i)
+  {
+    const string& tag = props[i].first;
+    const string& value = props[i].second;
+    map<string, vector<Property> >::const_iterator it = propertiesByTag_.find(tag);
+    if (it != propertiesByTag_.end())
     {
-      node.setId(TextTools::toInt(prop));
-      hasId = true;   
+      for (vector<Property>::const_iterator ppt = it->second.begin(); ppt != it->second.end(); ++ppt)
+      {
+        //Property found
+        const string& pptName = (useTagsAsPropertyNames_ ? ppt->tag : ppt->name);
+        if (ppt->onBranch)
+          setTypedProperty(value, ppt->type, [&](const Clonable& p) { node.setBranchProperty(pptName, p); });
+        else
+          setTypedProperty(value, ppt->type, [&](const Clonable& p) { node.setNodeProperty(pptName, p); });
+      }
     }
+    if (tag == "ND")
+      id = &value;
+  }
+
+  if (id && TextTools::isDecimalNumber(*id))
+  {
+    node.setId(TextTools::toInt(*id));
+    hasId = true;
   }
   return hasId;
 }
@@ -536,50 +596,44 @@ bool Nhx::setNodeProperties(Node& node, const string properties) const
 
 bool Nhx::setNodeProperties(PhyloTree& tree, shared_ptr<PhyloNode> node , const string properties) const
 {
-  string propsDesc = TextTools::removeChar(properties, ']');
-  StringTokenizer st(propsDesc, ":", true, true);
-  map<string, string> props; 
-  while (st.hasMoreToken())
-  {
-    string token = st.nextToken();
-    if (TextTools::hasSubstring(token, "=")) {
-      StringTokenizer pt(token, "=", true, true);
-      string tag = pt.nextToken();
-      string value = pt.nextToken();
-      props[tag] = value;
-    }
-  }
+  vector<pair<string, string> > props;
+  splitNhxProperties(properties, props);
 
   shared_ptr<PhyloBranch> branch=tree.hasFather(node)?tree.getEdgeToFather(node):0;
-  
-  for (set<Property>::iterator it = supportedProperties_.begin(); it != supportedProperties_.end(); ++it) {
-    if (props.find(it->tag) != props.end()) {
-      //Property found
-      string ppt = (useTagsAsPropertyNames_ ? it->tag : it->name);
-      
-      if (it->onBranch) {
-        if (branch)
-          branch->setProperty(ppt, *unique_ptr<Clonable>(stringToProperty_(props[it->tag], it->type)));
-      } else {
-        node->setProperty(ppt, *unique_ptr<Clonable>(stringToProperty_(props[it->tag], it->type)));
-      }
-    }
-  }
 
   //If the ND tag is present and is decimal, we use it has the node id:
   bool hasId = false;
-  
-  if (props.find("ND") != props.end()) {
-    string prop = props["ND"];
-    if (TextTools::isDecimalNumber(prop))
+  const string* id = 0;
+  for (size_t i = 0; i < props.size(); ++i)
+  {
+    const string& tag = props[i].first;
+    const string& value = props[i].second;
+    map<string, vector<Property> >::const_iterator it = propertiesByTag_.find(tag);
+    if (it != propertiesByTag_.end())
     {
-      unsigned int id=(unsigned int)TextTools::toInt(prop);
-      tree.setNodeIndex(node, id);
-
-      if (branch)
-        tree.setEdgeIndex(branch, id);
-      hasId = true;   
+      for (vector<Property>::const_iterator ppt = it->second.begin(); ppt != it->second.end(); ++ppt)
+      {
+        //Property found
+        const string& pptName = (useTagsAsPropertyNames_ ? ppt->tag : ppt->name);
+        if (ppt->onBranch) {
+          if (branch)
+            setTypedProperty(value, ppt->type, [&](const Clonable& p) { branch->setProperty(pptName, p); });
+        } else
+          setTypedProperty(value, ppt->type, [&](const Clonable& p) { node->setProperty(pptName, p); });
+      }
     }
+    if (tag == "ND")
+      id = &value;
+  }
+
+  if (id && TextTools::isDecimalNumber(*id))
+  {
+    unsigned int nid=(unsigned int)TextTools::toInt(*id);
+    tree.setNodeIndex(node, nid);
+
+    if (branch)
+      tree.setEdgeIndex(branch, nid);
+    hasId = true;
   }
 
   return hasId;
@@ -690,29 +744,28 @@ void Nhx::changeNamesToTags(PhyloTree& tree, shared_ptr<PhyloNode> node) const {
 
 string Nhx::propertiesToParenthesis(const Node& node) const
 {
-  ostringstream s;
-  s << "[&&NHX";
+  string s = "[&&NHX";
   for (set<Property>::iterator it = supportedProperties_.begin(); it != supportedProperties_.end(); ++it) {
-    string ppt = (useTagsAsPropertyNames_ ? it->tag : it->name);
+    const string& ppt = (useTagsAsPropertyNames_ ? it->tag : it->name);
     if (it->onBranch) {
       if (node.hasBranchProperty(ppt)) {
         const Clonable* pptObject = node.getBranchProperty(ppt);
-        s << ":" << it->tag << "=" << propertyToString_(pptObject, it->type);
+        s += ":" + it->tag + "=" + propertyToString_(pptObject, it->type);
       }
     } else {
       if (node.hasNodeProperty(ppt)) {
         const Clonable* pptObject = node.getNodeProperty(ppt);
-        s << ":" << it->tag << "=" << propertyToString_(pptObject, it->type);
+        s += ":" + it->tag + "=" + propertyToString_(pptObject, it->type);
       }
     }
   }
   //If no special node id is provided, we output the one from the tree:
   if (!node.hasNodeProperty(useTagsAsPropertyNames_ ? "ND" : "Node ID"))
   {
-    s << ":ND="<<TextTools::toString(node.getId());
+    s += ":ND=" + TextTools::toString(node.getId());
   }
-  s << "]";
-  return s.str();  
+  s += "]";
+  return s;
 }
 
 
@@ -720,35 +773,34 @@ string Nhx::propertiesToParenthesis(const Node& node) const
 
 string Nhx::propertiesToParenthesis(const PhyloTree& tree, const shared_ptr<PhyloNode> node) const
 {
-  ostringstream s;
-  s << "[&&NHX";
+  string s = "[&&NHX";
 
   const shared_ptr<PhyloBranch> branch=tree.hasFather(node)?tree.getEdgeToFather(node):0;
 
   for (set<Property>::iterator it = supportedProperties_.begin(); it != supportedProperties_.end(); ++it) {
-    string ppt = (useTagsAsPropertyNames_ ? it->tag : it->name);
+    const string& ppt = (useTagsAsPropertyNames_ ? it->tag : it->name);
     if (it->onBranch) {
       if (branch)
       {
         if (branch->hasProperty(ppt)) {
           const Clonable* pptObject = branch->getProperty(ppt);
-          s << ":" << it->tag << "=" << propertyToString_(pptObject, it->type);
+          s += ":" + it->tag + "=" + propertyToString_(pptObject, it->type);
         }
       }
     } else {
       if (node->hasProperty(ppt)) {
         const Clonable* pptObject = node->getProperty(ppt);
-        s << ":" << it->tag << "=" << propertyToString_(pptObject, it->type);
+        s += ":" + it->tag + "=" + propertyToString_(pptObject, it->type);
       }
     }
   }
   //If no special node id is provided, we output the one from the tree:
   if (!node->hasProperty(useTagsAsPropertyNames_ ? "ND" : "Node ID"))
   {
-    s << ":ND="<<TextTools::toString(tree.getNodeIndex(node));
+    s += ":ND=" + TextTools::toString(tree.getNodeIndex(node));
   }
-  s << "]";
-  return s.str();  
+  s += "]";
+  return s;
 }
 
 /******************************************************************************/
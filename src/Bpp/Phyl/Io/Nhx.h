@@ -46,6 +46,8 @@
 
 //From the STL:
 #include <set>
+#include <map>
+#include <vector>
 
 namespace bpp
 {
@@ -124,6 +126,7 @@ namespace bpp
 
   private:
     std::set<Property> supportedProperties_;
+    std::map<std::string, std::vector<Property> > propertiesByTag_; // Supported properties, indexed by tag for parsing.
     bool useTagsAsPropertyNames_;
     mutable bool hasIds_;
 
@@ -249,7 +252,8 @@ namespace bpp
     std::string treeToParenthesis(const PhyloTree& tree) const;
 
     void registerProperty(const Property& property) {
-      supportedProperties_.insert(property);
+      if (supportedProperties_.insert(property).second)
+        propertiesByTag_[property.tag].push_back(property);
     }
 
     /**
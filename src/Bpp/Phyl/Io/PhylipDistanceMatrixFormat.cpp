@@ -41,7 +41,6 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include <Bpp/Io/FileTools.h>
 #include <Bpp/Text/TextTools.h>
-#include <Bpp/Text/StringTokenizer.h>
 
 // From SeqLib:
 #include <Bpp/Seq/DistanceMatrix.h>
@@ -49,7 +48,10 @@ knowledge of the CeCILL license and that you accept its terms.
 using namespace bpp;
 
 // From the STL:
-#include <iomanip>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
 
 using namespace std;
 
@@ -58,12 +60,15 @@ DistanceMatrix * PhylipDistanceMatrixFormat::read(istream& in) const
 	string s = FileTools::getNextLine(in);
 	// the size of the matrix:
 	unsigned int n = TextTools::fromString<unsigned int>(s);
-	DistanceMatrix * dist = new DistanceMatrix(n);
+	unique_ptr<DistanceMatrix> dist(new DistanceMatrix(n));
 	unsigned int rowNumber = 0;
 	unsigned int colNumber = 0;
-	s = FileTools::getNextLine(in);
-	while (in)
+	// Lines are read in a reused buffer, and numbers are converted in place.
+	while (rowNumber < n && getline(in, s))
   {
+    if (TextTools::isEmpty(s))
+      continue;
+    const char* p = s.c_str();
 		if (colNumber == 0)
     { // New row
       if (extended_) {
@@ -71,32 +76,38 @@ DistanceMatrix * PhylipDistanceMatrixFormat::read(istream& in) const
         if (pos == string::npos)
           throw Exception("PhylipDistanceMatrixFormat::read. Bad format, probably not 'extended' Phylip.");
         dist->setName(rowNumber, s.substr(0, pos));
-        s = s.substr(pos + 2);
+        p += pos + 2;
       } else {
         dist->setName(rowNumber, s.substr(0, 10));
-        s = s.substr(11);
+        p += min(s.size(), static_cast<size_t>(11));
       }
     }
-		StringTokenizer st(s, "\t ");
-		for (; colNumber < n && st.hasMoreToken(); colNumber++)
+		for (; colNumber < n; colNumber++)
     {
-			double d = TextTools::fromString<double>(st.nextToken());
+      while (*p == ' ' || *p == '\t' || *p == '\r')
+        p++;
+      if (*p == '\0')
+        break;
+      char* end;
+			double d = strtod(p, &end);
+      if (end == p)
+        throw IOException("PhylipDistanceMatrixFormat::read. Bad distance value at row " + TextTools::toString(rowNumber + 1) + ".");
 			(* dist)(rowNumber, colNumber) = d;
+      p = end;
 		}
 		if (colNumber == n)
     {
 			colNumber = 0;
 			rowNumber++;
 		}
-		s = FileTools::getNextLine(in);
 	}
-	return dist;
+	return dist.release();
 }
 
 void PhylipDistanceMatrixFormat::write(const DistanceMatrix& dist, ostream& out) const
 {
 	size_t n = dist.size();
-	out << "   " << n << endl;
+	out << "   " << n << "\n";
   size_t offset = 10;
   if (extended_) {
     offset = 0;
@@ -105,19 +116,25 @@ void PhylipDistanceMatrixFormat::write(const DistanceMatrix& dist, ostream& out)
       if (s > offset) offset = s;
     }
   }
+  // Each row is formatted in a buffer and written at once:
+  string line;
+  char buffer[32];
 	for (unsigned int i = 0; i < n; i++)
   {
-    out << TextTools::resizeRight(dist.getName(i), offset, ' ');
+    line = TextTools::resizeRight(dist.getName(i), offset, ' ');
     if (extended_) {
-      out << "  ";
+      line += "  ";
     } else {
-      out << " ";
+      line += " ";
     }
     for (unsigned int j = 0; j < n; j++) {
-      if (j > 0) out << " ";
-		  out << setprecision(8) << dist(i, j); 
+      if (j > 0) line += ' ';
+      int length = snprintf(buffer, sizeof(buffer), "%.8g", dist(i, j));
+      line.append(buffer, static_cast<size_t>(length));
     }
-		out << endl;
+		line += '\n';
+    out.write(line.data(), static_cast<streamsize>(line.size()));
 	}
+  out.flush();
 }
 
@@ -50,7 +50,10 @@
 using namespace bpp;
 
 // From the STL:
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <deque>
 
 using namespace std;
 
@@ -65,6 +68,7 @@ AbstractHomogeneousTreeLikelihood::AbstractHomogeneousTreeLikelihood(
   AbstractDiscreteRatesAcrossSitesTreeLikelihood(rDist, verbose),
   model_(0),
   brLenParameters_(),
+  brLenHandles_(),
   pxy_(),
   dpxy_(),
   d2pxy_(),
@@ -90,6 +94,7 @@ AbstractHomogeneousTreeLikelihood::AbstractHomogeneousTreeLikelihood(
   AbstractDiscreteRatesAcrossSitesTreeLikelihood(lik),
   model_(lik.model_),
   brLenParameters_(lik.brLenParameters_),
+  brLenHandles_(lik.brLenHandles_),
   pxy_(lik.pxy_),
   dpxy_(lik.dpxy_),
   d2pxy_(lik.d2pxy_),
@@ -105,8 +110,7 @@ AbstractHomogeneousTreeLikelihood::AbstractHomogeneousTreeLikelihood(
   maximumBrLen_(lik.maximumBrLen_),
   brLenConstraint_(lik.brLenConstraint_->clone())
 {
-  nodes_ = tree_->getNodes();
-  nodes_.pop_back(); // Remove the root node (the last added!).
+  copyNodes_(lik);
 }
 
 /******************************************************************************/
@@ -117,12 +121,12 @@ AbstractHomogeneousTreeLikelihood& AbstractHomogeneousTreeLikelihood::operator=(
   AbstractDiscreteRatesAcrossSitesTreeLikelihood::operator=(lik);
   model_           = lik.model_;
   brLenParameters_ = lik.brLenParameters_;
+  brLenHandles_    = lik.brLenHandles_;
   pxy_             = lik.pxy_;
   dpxy_            = lik.dpxy_;
   d2pxy_           = lik.d2pxy_;
   rootFreqs_       = lik.rootFreqs_;
-  nodes_ = tree_->getNodes();
-  nodes_.pop_back(); // Remove the root node (the last added!).
+  copyNodes_(lik);
   nbSites_         = lik.nbSites_;
   nbDistinctSites_ = lik.nbDistinctSites_;
   nbClasses_       = lik.nbClasses_;
@@ -139,6 +143,66 @@ AbstractHomogeneousTreeLikelihood& AbstractHomogeneousTreeLikelihood::operator=(
 
 /******************************************************************************/
 
+void AbstractHomogeneousTreeLikelihood::copyNodes_(const AbstractHomogeneousTreeLikelihood& lik)
+{
+  vector<Node*> nodes = tree_->getNodes();
+  map<int, Node*> nodesById;
+  for (size_t i = 0; i < nodes.size(); i++)
+  {
+    nodesById[nodes[i]->getId()] = nodes[i];
+  }
+  nodes_.resize(lik.nodes_.size());
+  for (size_t i = 0; i < lik.nodes_.size(); i++)
+  {
+    nodes_[i] = nodesById[lik.nodes_[i]->getId()];
+  }
+}
+
+/******************************************************************************/
+
+vector<Node*> AbstractHomogeneousTreeLikelihood::moveRoot_(int nodeId)
+{
+  Node* newRoot = tree_->getNode(nodeId);
+  if (newRoot == tree_->getRootNode())
+    return vector<Node*>();
+  if (newRoot->degree() < 3)
+    throw NodeException("AbstractHomogeneousTreeLikelihood::moveRoot_. The new root must have at least three neighbors.", nodeId);
+
+  // Path from the old root to the new one:
+  vector<Node*> path = TreeTemplateTools::getPathBetweenAnyTwoNodes(*tree_->getRootNode(), *newRoot);
+
+  // The branch between path[i] and path[i + 1] was identified by path[i + 1], it is now by path[i]:
+  for (size_t i = 0; i + 1 < path.size(); i++)
+  {
+    int id1 = path[i]->getId();
+    int id2 = path[i + 1]->getId();
+    pxy_[id1].swap(pxy_[id2]);
+    dpxy_[id1].swap(dpxy_[id2]);
+    d2pxy_[id1].swap(d2pxy_[id2]);
+  }
+  pxy_.erase(nodeId);
+  dpxy_.erase(nodeId);
+  d2pxy_.erase(nodeId);
+
+  map<const Node*, size_t> positions;
+  for (size_t i = 1; i < path.size(); i++)
+  {
+    positions[path[i]] = i;
+  }
+  for (size_t j = 0; j < nodes_.size(); j++)
+  {
+    map<const Node*, size_t>::iterator it = positions.find(nodes_[j]);
+    if (it != positions.end())
+      nodes_[j] = path[it->second - 1];
+  }
+
+  tree_->rootAt(newRoot);
+  path.pop_back();
+  return path;
+}
+
+/******************************************************************************/
+
 void AbstractHomogeneousTreeLikelihood::init_(
   const Tree& tree,
   TransitionModel* model,
@@ -254,6 +318,70 @@ ParameterList AbstractHomogeneousTreeLikelihood::getBranchLengthsParameters() co
   return brLenParameters_.getCommonParametersWith(getParameters());
 }
 
+ParameterList AbstractHomogeneousTreeLikelihood::getBranchLengthsParameters(const std::vector<int>& nodeIds, unsigned int distance) const
+{
+  if (!initialized_)
+    throw Exception("AbstractHomogeneousTreeLikelihood::getBranchLengthsParameters(). Object is not initialized.");
+  // Branch parameters are indexed by the position of their node in nodes_:
+  map<int, size_t> positions;
+  for (size_t i = 0; i < nbNodes_; i++)
+  {
+    positions[nodes_[i]->getId()] = i;
+  }
+  // Breadth-first search on branches, each branch being identified by its lower node:
+  map<int, unsigned int> depths;
+  deque<const Node*> toVisit;
+  for (size_t i = 0; i < nodeIds.size(); i++)
+  {
+    const Node* node = tree_->getNode(nodeIds[i]);
+    if (node->hasFather() && depths.find(node->getId()) == depths.end())
+    {
+      depths[node->getId()] = 0;
+      toVisit.push_back(node);
+    }
+  }
+  while (!toVisit.empty())
+  {
+    const Node* node = toVisit.front();
+    toVisit.pop_front();
+    unsigned int depth = depths[node->getId()];
+    if (depth == distance)
+      continue;
+    vector<const Node*> neighbors;
+    for (size_t i = 0; i < node->getNumberOfSons(); i++)
+    {
+      neighbors.push_back(node->getSon(i));
+    }
+    const Node* father = node->getFather();
+    for (size_t i = 0; i < father->getNumberOfSons(); i++)
+    {
+      if (father->getSon(i) != node)
+        neighbors.push_back(father->getSon(i));
+    }
+    if (father->hasFather())
+      neighbors.push_back(father);
+    for (size_t i = 0; i < neighbors.size(); i++)
+    {
+      if (depths.find(neighbors[i]->getId()) == depths.end())
+      {
+        depths[neighbors[i]->getId()] = depth + 1;
+        toVisit.push_back(neighbors[i]);
+      }
+    }
+  }
+  ParameterList pl;
+  for (map<int, unsigned int>::const_iterator it = depths.begin(); it != depths.end(); it++)
+  {
+    map<int, size_t>::const_iterator pos = positions.find(it->first);
+    if (pos == positions.end())
+      continue;
+    string name = "BrLen" + TextTools::toString(pos->second);
+    if (hasParameter(name))
+      pl.addParameter(getParameter(name));
+  }
+  return pl;
+}
+
 /******************************************************************************/
 
 ParameterList AbstractHomogeneousTreeLikelihood::getSubstitutionModelParameters() const
@@ -291,7 +419,7 @@ void AbstractHomogeneousTreeLikelihood::applyParameters()
   // brLenParameters_.matchParametersValues(parameters_); Not necessary!
   for (unsigned int i = 0; i < nbNodes_; i++)
   {
-    const Parameter* brLen = &getParameter(string("BrLen") + TextTools::toString(i));
+    const Parameter* brLen = brLenHandles_.getParameter(getParameters(), i);
     if (brLen)
       nodes_[i]->setDistanceToFather(brLen->getValue());
   }
@@ -304,9 +432,37 @@ void AbstractHomogeneousTreeLikelihood::applyParameters()
 
 /******************************************************************************/
 
+void AbstractHomogeneousTreeLikelihood::setBranchLengths(const std::vector<double>& lengths)
+{
+  if (!initialized_)
+    throw Exception("AbstractHomogeneousTreeLikelihood::setBranchLengths(). Object not initialized.");
+  if (lengths.size() != nbNodes_)
+    throw Exception("AbstractHomogeneousTreeLikelihood::setBranchLengths(). Expected " + TextTools::toString(nbNodes_) + " branch lengths, got " + TextTools::toString(lengths.size()) + ".");
+
+  ParameterList& parameters = getParameters_();
+  for (size_t i = 0; i < nbNodes_; i++)
+  {
+    double d = std::min(std::max(lengths[i], minimumBrLen_), maximumBrLen_);
+    parameters[brLenHandles_.getPosition(parameters, i)].setValue(d);
+    nodes_[i]->setDistanceToFather(d);
+  }
+
+  // All branches at once, then the likelihood with nothing left to update:
+  computeAllTransitionProbabilities();
+  fireParameterChanged(ParameterList());
+}
+
+/******************************************************************************/
+
 void AbstractHomogeneousTreeLikelihood::initBranchLengthsParameters(bool verbose)
 {
   brLenParameters_.reset();
+  std::vector<std::string> names(nbNodes_);
+  for (unsigned int i = 0; i < nbNodes_; i++)
+  {
+    names[i] = "BrLen" + TextTools::toString(i);
+  }
+  brLenHandles_.setNames(names);
   for (unsigned int i = 0; i < nbNodes_; i++)
   {
     double d = minimumBrLen_;
@@ -334,7 +490,7 @@ void AbstractHomogeneousTreeLikelihood::initBranchLengthsParameters(bool verbose
         d = maximumBrLen_;
       }
     }
-    brLenParameters_.addParameter(Parameter("BrLen" + TextTools::toString(i), d, brLenConstraint_->clone(), true)); // Attach constraint to avoid clonage problems!
+    brLenParameters_.addParameter(Parameter(names[i], d, brLenConstraint_->clone(), true)); // Attach constraint to avoid clonage problems!
   }
 }
 
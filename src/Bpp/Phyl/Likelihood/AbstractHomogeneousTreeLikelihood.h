@@ -42,6 +42,7 @@
 
 #include "AbstractDiscreteRatesAcrossSitesTreeLikelihood.h"
 #include "HomogeneousTreeLikelihood.h"
+#include "ParameterHandles.h"
 
 // From STL:
 #include <memory>
@@ -86,6 +87,12 @@ protected:
   TransitionModel* model_;
   ParameterList brLenParameters_;
 
+  /**
+   * @brief Handles on the branch length parameters, the handle of
+   * "BrLen"+i being i.
+   */
+  ParameterHandles brLenHandles_;
+
   mutable std::map<int, VVVdouble> pxy_;
 
   mutable std::map<int, VVVdouble> dpxy_;
@@ -149,6 +156,14 @@ private:
              bool checkRooted,
              bool verbose);
 
+  /**
+   * @brief Set nodes_ to the nodes of tree_ with the same ids as in lik.nodes_.
+   *
+   * The order of nodes_ is kept after a change of root, so that branch length
+   * parameters keep designating the same branches.
+   */
+  void copyNodes_(const AbstractHomogeneousTreeLikelihood& lik);
+
 public:
   /**
    * @name The TreeLikelihood interface.
@@ -169,6 +184,35 @@ public:
 
   ParameterList getBranchLengthsParameters() const;
 
+  /**
+   * @brief Get the branch lengths parameters of the neighbourhood of some branches.
+   *
+   * Branches are identified by their lower node. A branch is selected if it is
+   * at most @p distance branches away from one of the input branches, so that
+   * a distance of 0 only selects the input branches themselves.
+   *
+   * @param nodeIds  The ids of the nodes under the central branches.
+   * @param distance The maximum number of branches between a selected branch and a central one.
+   * @return The branch lengths parameters of the selected branches.
+   */
+  ParameterList getBranchLengthsParameters(const std::vector<int>& nodeIds, unsigned int distance) const;
+
+  /**
+   * @brief Set all branch lengths at once.
+   *
+   * The values are set without a change notification per branch: the
+   * transition probabilities are computed in a single pass over the
+   * branches, and the likelihood once, as if no other parameter had
+   * changed.
+   *
+   * @param lengths The length of each branch, lengths[i] being the value
+   * of parameter "BrLen"+i. Values are bounded by the minimum and maximum
+   * branch lengths.
+   * @throw Exception If the object is not initialized or the number of
+   * lengths is not the number of branches.
+   */
+  virtual void setBranchLengths(const std::vector<double>& lengths);
+
   ParameterList getSubstitutionModelParameters() const;
 
   ParameterList getRateDistributionParameters() const
@@ -180,6 +224,14 @@ public:
 
   VVVdouble getTransitionProbabilitiesPerRateClass(int nodeId, size_t siteIndex) const { return pxy_[nodeId]; }
 
+  void getMemoryUsage(MemoryUsage& usage) const
+  {
+    usage.add(MemoryUsage::TRANSITION_MATRICES, MemoryUsage::getHeapBytes(pxy_)
+        + MemoryUsage::getHeapBytes(dpxy_) + MemoryUsage::getHeapBytes(d2pxy_));
+    if (getLikelihoodData())
+      getLikelihoodData()->getMemoryUsage(usage);
+  }
+
   ConstBranchModelIterator* getNewBranchModelIterator(int nodeId) const
   {
     return new ConstNoPartitionBranchModelIterator(model_, nbDistinctSites_);
@@ -277,6 +329,20 @@ protected:
    * @brief Fill the pxy_, dpxy_ and d2pxy_ arrays for one node.
    */
   virtual void computeTransitionProbabilitiesForNode(const Node* node);
+
+  /**
+   * @brief Move the root of tree_ to an inner node, without recomputing anything.
+   *
+   * Each branch keeps its transition probabilities and its branch length parameter,
+   * which now refer to the node that became the son of the branch.
+   *
+   * @param nodeId The id of the new root, which must have at least three neighbors,
+   * so that the tree stays unrooted.
+   * @return The nodes between the old root (included) and the new one (excluded),
+   * whose branch to their father changed.
+   * @throw NodeException If the node has less than three neighbors.
+   */
+  std::vector<Node*> moveRoot_(int nodeId);
 };
 } // end of namespace bpp.
 
@@ -64,6 +64,7 @@ AbstractNonHomogeneousTreeLikelihood::AbstractNonHomogeneousTreeLikelihood(
   AbstractDiscreteRatesAcrossSitesTreeLikelihood(rDist, verbose),
   modelSet_(0),
   brLenParameters_(),
+  brLenHandles_(),
   pxy_(),
   dpxy_(),
   d2pxy_(),
@@ -93,6 +94,7 @@ AbstractNonHomogeneousTreeLikelihood::AbstractNonHomogeneousTreeLikelihood(
   AbstractDiscreteRatesAcrossSitesTreeLikelihood(lik),
   modelSet_(lik.modelSet_),
   brLenParameters_(lik.brLenParameters_),
+  brLenHandles_(lik.brLenHandles_),
   pxy_(lik.pxy_),
   dpxy_(lik.dpxy_),
   d2pxy_(lik.d2pxy_),
@@ -130,6 +132,7 @@ AbstractNonHomogeneousTreeLikelihood& AbstractNonHomogeneousTreeLikelihood::oper
   AbstractDiscreteRatesAcrossSitesTreeLikelihood::operator=(lik);
   modelSet_          = lik.modelSet_;
   brLenParameters_   = lik.brLenParameters_;
+  brLenHandles_      = lik.brLenHandles_;
   pxy_               = lik.pxy_;
   dpxy_              = lik.dpxy_;
   d2pxy_             = lik.d2pxy_;
@@ -320,19 +323,19 @@ void AbstractNonHomogeneousTreeLikelihood::applyParameters()
     int id = nodes_[i]->getId();
     if (reparametrizeRoot_ && id == root1_)
     {
-      const Parameter* rootBrLen = &getParameter("BrLenRoot");
-      const Parameter* rootPos = &getParameter("RootPosition");
+      const Parameter* rootBrLen = brLenHandles_.getParameter(getParameters(), nbNodes_);
+      const Parameter* rootPos = brLenHandles_.getParameter(getParameters(), nbNodes_ + 1);
       nodes_[i]->setDistanceToFather(rootBrLen->getValue() * rootPos->getValue());
     }
     else if (reparametrizeRoot_ && id == root2_)
     {
-      const Parameter* rootBrLen = &getParameter("BrLenRoot");
-      const Parameter* rootPos = &getParameter("RootPosition");
+      const Parameter* rootBrLen = brLenHandles_.getParameter(getParameters(), nbNodes_);
+      const Parameter* rootPos = brLenHandles_.getParameter(getParameters(), nbNodes_ + 1);
       nodes_[i]->setDistanceToFather(rootBrLen->getValue() * (1. - rootPos->getValue()));
     }
     else
     {
-      const Parameter* brLen = &getParameter(string("BrLen") + TextTools::toString(i));
+      const Parameter* brLen = brLenHandles_.getParameter(getParameters(), i);
       if (brLen) nodes_[i]->setDistanceToFather(brLen->getValue());
     }
   }
@@ -348,6 +351,14 @@ void AbstractNonHomogeneousTreeLikelihood::applyParameters()
 void AbstractNonHomogeneousTreeLikelihood::initBranchLengthsParameters(bool verbose)
 {
   brLenParameters_.reset();
+  std::vector<std::string> names(nbNodes_);
+  for (unsigned int i = 0; i < nbNodes_; i++)
+    {
+      names[i] = "BrLen" + TextTools::toString(i);
+    }
+  names.push_back("BrLenRoot");
+  names.push_back("RootPosition");
+  brLenHandles_.setNames(names);
   double l1 = 0, l2 = 0;
   for (unsigned int i = 0; i < nbNodes_; i++)
     {
@@ -382,7 +393,7 @@ void AbstractNonHomogeneousTreeLikelihood::initBranchLengthsParameters(bool verb
         l2 = d;
       else
         {
-          brLenParameters_.addParameter(Parameter("BrLen" + TextTools::toString(i), d, brLenConstraint_->clone(), true)); //Attach constraint to avoid clonage problems!
+          brLenParameters_.addParameter(Parameter(names[i], d, brLenConstraint_->clone(), true)); //Attach constraint to avoid clonage problems!
         }
     }
   if (reparametrizeRoot_) {
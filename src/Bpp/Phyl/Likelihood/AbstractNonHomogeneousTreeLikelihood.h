@@ -43,6 +43,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "NonHomogeneousTreeLikelihood.h"
 #include "AbstractDiscreteRatesAcrossSitesTreeLikelihood.h"
+#include "ParameterHandles.h"
 
 //From the STL:
 #include <memory>
@@ -91,6 +92,12 @@ class AbstractNonHomogeneousTreeLikelihood:
   protected:
     SubstitutionModelSet* modelSet_;
     ParameterList brLenParameters_;
+
+    /**
+     * @brief Handles on the branch length parameters, the handle of
+     * "BrLen"+i being i, followed by "BrLenRoot" and "RootPosition".
+     */
+    ParameterHandles brLenHandles_;
     
     mutable std::map<int, VVVdouble> pxy_;
 
@@ -206,6 +213,14 @@ class AbstractNonHomogeneousTreeLikelihood:
     
     VVVdouble getTransitionProbabilitiesPerRateClass(int nodeId, size_t siteIndex) const { return pxy_[nodeId]; }
 
+    void getMemoryUsage(MemoryUsage& usage) const
+    {
+      usage.add(MemoryUsage::TRANSITION_MATRICES, MemoryUsage::getHeapBytes(pxy_)
+          + MemoryUsage::getHeapBytes(dpxy_) + MemoryUsage::getHeapBytes(d2pxy_));
+      if (getLikelihoodData())
+        getLikelihoodData()->getMemoryUsage(usage);
+    }
+
     ConstBranchModelIterator* getNewBranchModelIterator(int nodeId) const
     {
       return new ConstNoPartitionBranchModelIterator(modelSet_->getModelForNode(nodeId), nbDistinctSites_);
@@ -49,6 +49,9 @@
 //From SeqLib:
 #include <Bpp/Seq/Container/AlignedValuesContainer.h>
 
+// From the STL:
+#include <memory>
+
 namespace bpp
 {
 
@@ -226,7 +229,11 @@ namespace bpp
 
 
   protected:
-    const AlignedValuesContainer* data_;
+    /**
+     * @brief The data subset of the leaves. It is not modified, and is
+     * shared by the copies of this object.
+     */
+    std::shared_ptr<const AlignedValuesContainer> data_;
     mutable TreeTemplate<Node>* tree_;
     bool computeFirstOrderDerivatives_;
     bool computeSecondOrderDerivatives_;
@@ -235,7 +242,7 @@ namespace bpp
   public:
     AbstractTreeLikelihood():
       AbstractParametrizable(""),
-      data_(0),
+      data_(),
       tree_(0),
       computeFirstOrderDerivatives_(true),
       computeSecondOrderDerivatives_(true),
@@ -243,22 +250,19 @@ namespace bpp
 
     AbstractTreeLikelihood(const AbstractTreeLikelihood & lik):
       AbstractParametrizable(lik),
-      data_(0),
+      data_(lik.data_),
       tree_(0),
       computeFirstOrderDerivatives_(lik.computeFirstOrderDerivatives_),
       computeSecondOrderDerivatives_(lik.computeSecondOrderDerivatives_),
       initialized_(lik.initialized_) 
     {
-      if (lik.data_) data_ = dynamic_cast<AlignedValuesContainer*>(lik.data_->clone());
       if (lik.tree_) tree_ = lik.tree_->clone();
     }
 
     AbstractTreeLikelihood & operator=(const AbstractTreeLikelihood& lik)
     {
       AbstractParametrizable::operator=(lik);
-      if (data_) delete data_;
-      if (lik.data_) data_ = dynamic_cast<AlignedValuesContainer*>(lik.data_->clone());
-      else           data_ = 0;
+      data_ = lik.data_;
       if (tree_) delete tree_;
       if (lik.tree_) tree_ = lik.tree_->clone();
       else           tree_ = 0;
@@ -275,7 +279,6 @@ namespace bpp
      */
     virtual ~AbstractTreeLikelihood()
     {
-      if (data_) delete data_;
       if (tree_) delete tree_;
     }
   
@@ -285,7 +288,7 @@ namespace bpp
      *
      * @{
      */
-    const AlignedValuesContainer* getData() const { return data_; }
+    const AlignedValuesContainer* getData() const { return data_.get(); }
     const Alphabet* getAlphabet() const { return data_->getAlphabet(); }  
     Vdouble getLikelihoodPerSite()                 const;
     Vdouble getLogLikelihoodPerSite()              const;
@@ -300,6 +303,7 @@ namespace bpp
     bool enableSecondOrderDerivatives() const { return computeSecondOrderDerivatives_; }
     bool isInitialized() const { return initialized_; }
     void initialize() { initialized_ = true; }
+    void getMemoryUsage(MemoryUsage& usage) const {}
     /** @} */
 
   };
@@ -137,6 +137,11 @@ class AbstractTreeLikelihoodData :
 
 		const TreeTemplate<Node>* getTree() const { return tree_; }  
 
+    void getMemoryUsage(MemoryUsage& usage) const
+    {
+      usage.add(MemoryUsage::OTHER, MemoryUsage::getHeapBytes(rootPatternLinks_) + MemoryUsage::getHeapBytes(rootWeights_));
+    }
+
 };
 
 } //end of namespace bpp.
@@ -0,0 +1,126 @@
+//
+// File: CompensatedSum.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _COMPENSATEDSUM_H_
+#define _COMPENSATEDSUM_H_
+
+// From the STL:
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace bpp
+{
+/**
+ * @brief Accumulate doubles with compensated (Neumaier) summation.
+ *
+ * The rounding error of each addition is recovered and accumulated
+ * separately, so that the final sum is as accurate as summing sorted
+ * terms, but in linear time, and whatever the order of the terms.
+ */
+class CompensatedSum
+{
+  private:
+    double sum_;
+    double compensation_;
+
+  public:
+    CompensatedSum() : sum_(0.), compensation_(0.) {}
+
+  public:
+    void add(double x)
+    {
+      double t = sum_ + x;
+      if (std::abs(sum_) >= std::abs(x))
+        compensation_ += (sum_ - t) + x;
+      else
+        compensation_ += (x - t) + sum_;
+      sum_ = t;
+    }
+
+    double getValue() const { return sum_ + compensation_; }
+};
+
+/**
+ * @brief Compute sum_i w_i * log(l_i), the log likelihood of a set of site patterns.
+ *
+ * Logarithms are computed by blocks, in a loop without dependencies which the
+ * compiler can vectorize, and then summed.
+ *
+ * @param lik Iterator on the pattern likelihoods.
+ * @param weights Iterator on the pattern weights.
+ * @param n The number of patterns.
+ * @param compensated Use compensated summation (see CompensatedSum), otherwise terms are simply added.
+ */
+template<class LikelihoodIterator, class WeightIterator>
+double sumOfWeightedLogarithms(LikelihoodIterator lik, WeightIterator weights, size_t n, bool compensated = true)
+{
+  const size_t blockSize = 256;
+  double terms[blockSize];
+  CompensatedSum sum;
+  double plainSum = 0.;
+  for (size_t first = 0; first < n; first += blockSize)
+  {
+    size_t size = std::min(blockSize, n - first);
+    for (size_t i = 0; i < size; i++, ++lik, ++weights)
+    {
+      terms[i] = static_cast<double>(*weights) * std::log(*lik);
+    }
+    if (compensated)
+    {
+      for (size_t i = 0; i < size; i++)
+      {
+        sum.add(terms[i]);
+      }
+    }
+    else
+    {
+      for (size_t i = 0; i < size; i++)
+      {
+        plainSum += terms[i];
+      }
+    }
+  }
+  return compensated ? sum.getValue() : plainSum;
+}
+
+} // end of namespace bpp.
+
+#endif // _COMPENSATEDSUM_H_
+
@@ -44,6 +44,9 @@
 // From SeqLib:
 #include <Bpp/Seq/SiteTools.h>
 
+// From the STL:
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
@@ -70,38 +73,51 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const AlignedValuesContainer& sit
   rootPatternLinks_ = pattern.getIndices();
   nbDistinctSites_  = shrunkData_->getNumberOfSites();
 
-  // Init data:
-  // Clone data for more efficiency on sequences access:
+  initArrays_(model);
+}
 
-  const SiteContainer* sc=dynamic_cast<const SiteContainer*>(shrunkData_.get());
-  const VectorProbabilisticSiteContainer* psc=dynamic_cast<const VectorProbabilisticSiteContainer*>(shrunkData_.get());
-  
-  shared_ptr<const AlignedValuesContainer> sequences(sc?
-                                               static_cast<const AlignedValuesContainer*>(sc->clone()):
-                                               static_cast<const AlignedValuesContainer*>(psc->clone()));
-  
-  initLikelihoods(tree_->getRootNode(), *sequences, model);
+/******************************************************************************/
 
-  // Now initialize root likelihoods and derivatives:
-  rootLikelihoods_.resize(nbDistinctSites_);
-  rootLikelihoodsS_.resize(nbDistinctSites_);
-  rootLikelihoodsSR_.resize(nbDistinctSites_);
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+void DRASDRTreeLikelihoodData::initLikelihoods(const AlignedValuesContainer& sites, const TransitionModel& model, const DRASDRTreeLikelihoodData& shared)
+{
+  if (!shared.shrunkData_ || shared.nbSites_ != sites.getNumberOfSites())
   {
-    VVdouble* rootLikelihoods_i_ = &rootLikelihoods_[i];
-    Vdouble* rootLikelihoodsS_i_ = &rootLikelihoodsS_[i];
-    rootLikelihoods_i_->resize(nbClasses_);
-    rootLikelihoodsS_i_->resize(nbClasses_);
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      Vdouble* rootLikelihoods_i_c_ = &(*rootLikelihoods_i_)[c];
-      rootLikelihoods_i_c_->resize(nbStates_);
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        (*rootLikelihoods_i_c_)[x] = 1.;
-      }
-    }
+    initLikelihoods(sites, model);
+    return;
   }
+
+  if (sites.getAlphabet()->getAlphabetType()
+      != model.getAlphabet()->getAlphabetType())
+    throw AlphabetMismatchException("DRASDRTreeLikelihoodData::initLikelihoods. Data and model must have the same alphabet type.",
+                                    sites.getAlphabet(),
+                                    model.getAlphabet());
+  alphabet_ = sites.getAlphabet();
+  nbStates_ = model.getNumberOfStates();
+  nbSites_  = sites.getNumberOfSites();
+
+  shrunkData_       = shared.shrunkData_;
+  rootWeights_      = shared.rootWeights_;
+  rootPatternLinks_ = shared.rootPatternLinks_;
+  nbDistinctSites_  = shared.nbDistinctSites_;
+
+  initArrays_(model);
+}
+
+/******************************************************************************/
+
+void DRASDRTreeLikelihoodData::initArrays_(const TransitionModel& model)
+{
+  // The compressed data set is read directly: it is not modified, and
+  // may be shared with other objects.
+  resizeNodeData_();
+  releaseStaleArrays_();
+  leafStateProfiles_.clear();
+  leafStateProfileIndex_.clear();
+  initLikelihoods(tree_->getRootNode(), *shrunkData_, model);
+  leafStateProfileIndex_.clear();
+
+  // Node and root arrays are allocated before the first computation:
+  arraysAllocated_ = false;
 }
 
 /******************************************************************************/
@@ -120,25 +136,31 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const Node* node, const AlignedVa
     {
       throw SequenceNotFoundException("DRASDRTreeLikelihoodData::initlikelihoods. Leaf name in tree not found in site container: ", (node->getName()));
     }
-    DRASDRTreeLikelihoodLeafData* leafData = &leafData_[node->getId()];
-    VVdouble* leavesLikelihoods_leaf = &leafData->getLikelihoodArray();
+    DRASDRTreeLikelihoodLeafData* leafData = &leafData_[static_cast<size_t>(node->getId())];
+    vector<unsigned int>* stateCodes_leaf = &leafData->getStateCodes();
     leafData->setNode(node);
-    leavesLikelihoods_leaf->resize(nbDistinctSites_);
+    stateCodes_leaf->resize(nbDistinctSites_);
+    Vdouble profile(nbStates_);
+    // Integer-coded characters are looked up in a table rather than resolved for each state:
+    const SiteContainer* sc = dynamic_cast<const SiteContainer*>(&sites);
+    StateIndicatorTable indicators(model.getStateMap());
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      Vdouble* leavesLikelihoods_leaf_i = &(*leavesLikelihoods_leaf)[i];
-      leavesLikelihoods_leaf_i->resize(nbStates_);
       double test = 0.;
 
+      if (sc)
+        profile = indicators.getIndicators(sc->getSite(i)[posSeq]);
       for (size_t s = 0; s < nbStates_; s++)
       {
         // Leaves likelihood are set to 1 if the char correspond to the site in the sequence,
         // otherwise value set to 0:
-        ( *leavesLikelihoods_leaf_i)[s] = sites.getStateValueAt(i, posSeq, model.getAlphabetStateAsInt(s));
-        test += ( *leavesLikelihoods_leaf_i)[s];
+        if (!sc)
+          profile[s] = sites.getStateValueAt(i, posSeq, model.getAlphabetStateAsInt(s));
+        test += profile[s];
       }
       if (test < 0.000001)
         std::cerr << "WARNING!!! Likelihood will be 0 for site " << i << std::endl;
+      (*stateCodes_leaf)[i] = getLeafStateCode_(profile);
     }
   }
 
@@ -151,117 +173,223 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const Node* node, const AlignedVa
   }
 
   // Initialize likelihood vector:
-  DRASDRTreeLikelihoodNodeData* nodeData = &nodeData_[node->getId()];
-  std::map<int, VVVdouble>* likelihoods_node_ = &nodeData->getLikelihoodArrays();
+  DRASDRTreeLikelihoodNodeData* nodeData = &nodeData_[static_cast<size_t>(node->getId())];
   nodeData->setNode(node);
 
   int nbSons = static_cast<int>(node->getNumberOfSons());
 
+  // The arrays are only created here, and are allocated by allocateArrays():
   for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
   {
-    const Node* neighbor = (*node)[n];
-    VVVdouble* likelihoods_node_neighbor_ = &(*likelihoods_node_)[neighbor->getId()];
-
-    likelihoods_node_neighbor_->resize(nbDistinctSites_);
-
-    if (neighbor->isLeaf())
-    {
-      VVdouble* leavesLikelihoods_leaf_ = &leafData_[neighbor->getId()].getLikelihoodArray();
-      for (size_t i = 0; i < nbDistinctSites_; i++)
-      {
-        Vdouble* leavesLikelihoods_leaf_i_ = &(*leavesLikelihoods_leaf_)[i];
-        VVdouble* likelihoods_node_neighbor_i_ = &(*likelihoods_node_neighbor_)[i];
-        likelihoods_node_neighbor_i_->resize(nbClasses_);
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* likelihoods_node_neighbor_i_c_ = &(*likelihoods_node_neighbor_i_)[c];
-          likelihoods_node_neighbor_i_c_->resize(nbStates_);
-          for (size_t s = 0; s < nbStates_; s++)
-          {
-            (*likelihoods_node_neighbor_i_c_)[s] = (*leavesLikelihoods_leaf_i_)[s];
-          }
-        }
-      }
-    }
-    else
-    {
-      for (size_t i = 0; i < nbDistinctSites_; i++)
-      {
-        VVdouble* likelihoods_node_neighbor_i_ = &(*likelihoods_node_neighbor_)[i];
-        likelihoods_node_neighbor_i_->resize(nbClasses_);
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* likelihoods_node_neighbor_i_c_ = &(*likelihoods_node_neighbor_i_)[c];
-          likelihoods_node_neighbor_i_c_->resize(nbStates_);
-          for (size_t s = 0; s < nbStates_; s++)
-          {
-            (*likelihoods_node_neighbor_i_c_)[s] = 1.; // All likelihoods are initialized to 1.
-          }
-        }
-      }
-    }
+    nodeData->getLikelihoodArrayForNeighbor((*node)[n]->getId(), arrayPool_);
   }
-
-  // Initialize d and d2 likelihoods:
-  Vdouble* dLikelihoods_node_ = &nodeData->getDLikelihoodArray();
-  Vdouble* d2Likelihoods_node_ = &nodeData->getD2LikelihoodArray();
-  dLikelihoods_node_->resize(nbDistinctSites_);
-  d2Likelihoods_node_->resize(nbDistinctSites_);
 }
 
 /******************************************************************************/
 
 void DRASDRTreeLikelihoodData::reInit()
 {
+  resizeNodeData_();
+  releaseStaleArrays_();
   reInit(tree_->getRootNode());
+  arraysAllocated_ = false;
+}
+
+/******************************************************************************/
+
+void DRASDRTreeLikelihoodData::releaseStaleArrays_()
+{
+  vector<const Node*> nodes = tree_->getNodes();
+  for (size_t k = 0; k < nodes.size(); k++)
+  {
+    const Node* node = nodes[k];
+    vector<int> neighbors;
+    int nbSons = static_cast<int>(node->getNumberOfSons());
+    for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
+      neighbors.push_back((*node)[n]->getId());
+    nodeData_[static_cast<size_t>(node->getId())].releaseNeighborArrays(neighbors, arrayPool_);
+  }
+}
+
+/******************************************************************************/
+
+void DRASDRTreeLikelihoodData::resizeNodeData_()
+{
+  vector<int> ids = tree_->getNodesId();
+  size_t size = static_cast<size_t>(*max_element(ids.begin(), ids.end())) + 1;
+  if (nodeData_.size() < size)
+    nodeData_.resize(size);
+  if (leafData_.size() < size)
+    leafData_.resize(size);
 }
 
+unsigned int DRASDRTreeLikelihoodData::getLeafStateCode_(const Vdouble& profile)
+{
+  map<Vdouble, unsigned int>::const_iterator it = leafStateProfileIndex_.find(profile);
+  if (it != leafStateProfileIndex_.end())
+    return it->second;
+  unsigned int code = static_cast<unsigned int>(leafStateProfiles_.size());
+  leafStateProfiles_.push_back(profile);
+  leafStateProfileIndex_[profile] = code;
+  return code;
+}
+
+VVdouble DRASDRTreeLikelihoodData::getLeafLikelihoods(int nodeId) const
+{
+  const vector<unsigned int>& codes = leafData_[static_cast<size_t>(nodeId)].getStateCodes();
+  VVdouble array(codes.size());
+  for (size_t i = 0; i < codes.size(); i++)
+  {
+    array[i] = leafStateProfiles_[codes[i]];
+  }
+  return array;
+}
+
+/******************************************************************************/
+
 void DRASDRTreeLikelihoodData::reInit(const Node* node)
 {
   if (node->isLeaf())
   {
-    DRASDRTreeLikelihoodLeafData* leafData = &leafData_[node->getId()];
+    DRASDRTreeLikelihoodLeafData* leafData = &leafData_[static_cast<size_t>(node->getId())];
     leafData->setNode(node);
   }
 
-  DRASDRTreeLikelihoodNodeData* nodeData = &nodeData_[node->getId()];
+  DRASDRTreeLikelihoodNodeData* nodeData = &nodeData_[static_cast<size_t>(node->getId())];
   nodeData->setNode(node);
-  nodeData->eraseNeighborArrays();
 
   int nbSons = static_cast<int>(node->getNumberOfSons());
 
   for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
   {
-    const Node* neighbor = (*node)[n];
-    VVVdouble* array = &nodeData->getLikelihoodArrayForNeighbor(neighbor->getId());
+    nodeData->getLikelihoodArrayForNeighbor((*node)[n]->getId(), arrayPool_);
+  }
 
-    array->resize(nbDistinctSites_);
-    for (size_t i = 0; i < nbDistinctSites_; i++)
+  // We re-initialize each son node:
+  size_t nbSonNodes = node->getNumberOfSons();
+  for (size_t l = 0; l < nbSonNodes; l++)
+  {
+    // For each son node,
+    reInit(node->getSon(l));
+  }
+}
+
+/******************************************************************************/
+
+void DRASDRTreeLikelihoodData::allocateArrays(bool upperArrays)
+{
+  if (arraysAllocated_)
+    return;
+
+  vector<const Node*> nodes = tree_->getNodes();
+  for (size_t k = 0; k < nodes.size(); k++)
+  {
+    const Node* node = nodes[k];
+    DRASDRTreeLikelihoodNodeData* nodeData = &nodeData_[static_cast<size_t>(node->getId())];
+    int nbSons = static_cast<int>(node->getNumberOfSons());
+    for (int n = (node->hasFather() && upperArrays ? -1 : 0); n < nbSons; n++)
     {
-      VVdouble* array_i = &(*array)[i];
-      array_i->resize(nbClasses_);
-      for (size_t c = 0; c < nbClasses_; c++)
+      VVVdouble* array = &nodeData->getLikelihoodArrayForNeighbor((*node)[n]->getId());
+      array->resize(nbDistinctSites_);
+      for (size_t i = 0; i < nbDistinctSites_; i++)
       {
-        Vdouble* array_i_c = &(*array_i)[c];
-        array_i_c->resize(nbStates_);
-        for (size_t s = 0; s < nbStates_; s++)
+        VVdouble* array_i = &(*array)[i];
+        array_i->resize(nbClasses_);
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          (*array_i_c)[s] = 1.; // All likelihoods are initialized to 1.
+          Vdouble* array_i_c = &(*array_i)[c];
+          array_i_c->resize(nbStates_);
+          for (size_t s = 0; s < nbStates_; s++)
+          {
+            (*array_i_c)[s] = 1.; // All likelihoods are initialized to 1.
+          }
         }
       }
     }
   }
 
-  // We re-initialize each son node:
-  size_t nbSonNodes = node->getNumberOfSons();
-  for (size_t l = 0; l < nbSonNodes; l++)
+  // Now initialize root likelihoods:
+  rootLikelihoods_.resize(nbDistinctSites_);
+  rootLikelihoodsS_.resize(nbDistinctSites_);
+  rootLikelihoodsSR_.resize(nbDistinctSites_);
+  for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    // For each son node,
-    reInit(node->getSon(l));
+    VVdouble* rootLikelihoods_i_ = &rootLikelihoods_[i];
+    Vdouble* rootLikelihoodsS_i_ = &rootLikelihoodsS_[i];
+    rootLikelihoods_i_->resize(nbClasses_);
+    rootLikelihoodsS_i_->resize(nbClasses_);
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      Vdouble* rootLikelihoods_i_c_ = &(*rootLikelihoods_i_)[c];
+      rootLikelihoods_i_c_->resize(nbStates_);
+      for (size_t x = 0; x < nbStates_; x++)
+      {
+        (*rootLikelihoods_i_c_)[x] = 1.;
+      }
+    }
+  }
+  arraysAllocated_ = true;
+}
+
+/******************************************************************************/
+
+void DRASDRTreeLikelihoodData::getMemoryUsage(MemoryUsage& usage) const
+{
+  AbstractTreeLikelihoodData::getMemoryUsage(usage);
+  usage.add(MemoryUsage::LEAF_ARRAYS, MemoryUsage::getHeapBytes(leafStateProfiles_));
+  for (size_t i = 0; i < leafData_.size(); i++)
+  {
+    usage.add(MemoryUsage::LEAF_ARRAYS, MemoryUsage::getHeapBytes(leafData_[i].getStateCodes()));
+  }
+  for (size_t i = 0; i < nodeData_.size(); i++)
+  {
+    usage.add(MemoryUsage::INNER_ARRAYS, MemoryUsage::getHeapBytes(nodeData_[i].getLikelihoodArrays()));
+    usage.add(MemoryUsage::DERIVATIVE_ARRAYS, MemoryUsage::getHeapBytes(nodeData_[i].getDLikelihoodArray()));
+    usage.add(MemoryUsage::DERIVATIVE_ARRAYS, MemoryUsage::getHeapBytes(nodeData_[i].getD2LikelihoodArray()));
+  }
+  for (size_t i = 0; i < arrayPool_.size(); i++)
+    usage.add(MemoryUsage::INNER_ARRAYS, MemoryUsage::getHeapBytes(arrayPool_[i]));
+  usage.add(MemoryUsage::INNER_ARRAYS, MemoryUsage::getHeapBytes(rootLikelihoods_)
+      + MemoryUsage::getHeapBytes(rootLikelihoodsS_) + MemoryUsage::getHeapBytes(rootLikelihoodsSR_));
+  usage.add(MemoryUsage::OTHER, nodeData_.capacity() * sizeof(DRASDRTreeLikelihoodNodeData)
+      + leafData_.capacity() * sizeof(DRASDRTreeLikelihoodLeafData));
+}
+
+/******************************************************************************/
+
+bool DRASDRTreeLikelihoodData::swapArrays(DRASDRTreeLikelihoodData& data)
+{
+  if (data.nodeData_.size() != nodeData_.size()
+      || data.nbDistinctSites_ != nbDistinctSites_
+      || data.nbClasses_ != nbClasses_
+      || data.nbStates_ != nbStates_)
+    return false;
+  for (size_t i = 0; i < nodeData_.size(); i++)
+  {
+    const map<int, VVVdouble>& arrays = nodeData_[i].getLikelihoodArrays();
+    const map<int, VVVdouble>& otherArrays = data.nodeData_[i].getLikelihoodArrays();
+    if (arrays.size() != otherArrays.size())
+      return false;
+    for (map<int, VVVdouble>::const_iterator it = arrays.begin(), oit = otherArrays.begin(); it != arrays.end(); it++, oit++)
+    {
+      if (it->first != oit->first || it->second.size() != oit->second.size())
+        return false;
+    }
   }
 
-  nodeData->getDLikelihoodArray().resize(nbDistinctSites_);
-  nodeData->getD2LikelihoodArray().resize(nbDistinctSites_);
+  for (size_t i = 0; i < nodeData_.size(); i++)
+  {
+    map<int, VVVdouble>& arrays = nodeData_[i].getLikelihoodArrays();
+    map<int, VVVdouble>& otherArrays = data.nodeData_[i].getLikelihoodArrays();
+    for (map<int, VVVdouble>::iterator it = arrays.begin(), oit = otherArrays.begin(); it != arrays.end(); it++, oit++)
+      it->second.swap(oit->second);
+    nodeData_[i].getDLikelihoodArray().swap(data.nodeData_[i].getDLikelihoodArray());
+    nodeData_[i].getD2LikelihoodArray().swap(data.nodeData_[i].getD2LikelihoodArray());
+  }
+  rootLikelihoods_.swap(data.rootLikelihoods_);
+  rootLikelihoodsS_.swap(data.rootLikelihoodsS_);
+  rootLikelihoodsSR_.swap(data.rootLikelihoodsSR_);
+  return true;
 }
 
 /******************************************************************************/
@@ -50,7 +50,10 @@
 #include <Bpp/Seq/Container/AlignedSequenceContainer.h>
 
 // From the STL:
+#include <algorithm>
 #include <map>
+#include <utility>
+#include <vector>
 
 namespace bpp
 {
@@ -61,6 +64,12 @@ namespace bpp
  * This class is for use with the DRASDRTreeLikelihoodData class.
  * 
  * Store the likelihoods arrays associated to a leaf.
+ *
+ * The leaf likelihoods are stored as one code per distinct site, indexing the
+ * table of state profiles shared by all leaves (see
+ * DRASDRTreeLikelihoodData::getLeafStateProfiles()). The full
+ * sites x states array is never stored: see
+ * DRASDRTreeLikelihoodData::getLeafLikelihoods().
  * 
  * @see DRASDRTreeLikelihoodData
  */
@@ -68,19 +77,19 @@ namespace bpp
     public virtual TreeLikelihoodNodeData
   {
   private:
-    mutable VVdouble leafLikelihood_;
+    std::vector<unsigned int> stateCodes_;
     const Node* leaf_;
 
   public:
-    DRASDRTreeLikelihoodLeafData() : leafLikelihood_(), leaf_(0) {}
+    DRASDRTreeLikelihoodLeafData() : stateCodes_(), leaf_(0) {}
 
     DRASDRTreeLikelihoodLeafData(const DRASDRTreeLikelihoodLeafData& data) :
-      leafLikelihood_(data.leafLikelihood_), leaf_(data.leaf_) {}
+      stateCodes_(data.stateCodes_), leaf_(data.leaf_) {}
     
     DRASDRTreeLikelihoodLeafData& operator=(const DRASDRTreeLikelihoodLeafData& data)
     {
-      leafLikelihood_ = data.leafLikelihood_;
-      leaf_           = data.leaf_;
+      stateCodes_ = data.stateCodes_;
+      leaf_       = data.leaf_;
       return *this;
     }
 
@@ -93,7 +102,11 @@ namespace bpp
     const Node* getNode() const { return leaf_; }
     void setNode(const Node* node) { leaf_ = node; }
 
-    VVdouble& getLikelihoodArray()  { return leafLikelihood_;  }
+    /**
+     * @return The index of the state profile of the leaf, for each distinct site.
+     */
+    std::vector<unsigned int>& getStateCodes() { return stateCodes_; }
+    const std::vector<unsigned int>& getStateCodes() const { return stateCodes_; }
   };
 
 /**
@@ -103,6 +116,13 @@ namespace bpp
  * 
  * Store for each neighbor node an array with conditionnal likelihoods.
  *
+ * The arrays are nested vectors (VVVdouble), with one allocation per
+ * site and rate class. They are returned by reference by
+ * getLikelihoodArrayForNeighbor() and passed as VVVdouble pointers to
+ * the computations of the DR likelihoods, so that they are not stored
+ * in a flat buffer. Their allocations are kept across topology changes
+ * instead (see releaseNeighborArrays()).
+ *
  * @see DRASDRTreeLikelihoodData
  */
   class DRASDRTreeLikelihoodNodeData :
@@ -189,7 +209,7 @@ namespace bpp
     
     const VVVdouble& getLikelihoodArrayForNeighbor(int neighborId) const
     {
-      return nodeLikelihoods_[neighborId];
+      return nodeLikelihoods_.at(neighborId);
     }
     
     Vdouble& getDLikelihoodArray() { return nodeDLikelihoods_;  }
@@ -205,6 +225,45 @@ namespace bpp
       return nodeLikelihoods_.find(neighborId) != nodeLikelihoods_.end();
     }
 
+    /**
+     * @brief Move the arrays of the nodes that are no more neighbors
+     * into a pool, keeping their memory for other nodes.
+     *
+     * @param neighbors The ids of the current neighbors.
+     * @param pool The pool of free arrays.
+     */
+    void releaseNeighborArrays(const std::vector<int>& neighbors, std::vector<VVVdouble>& pool)
+    {
+      for (std::map<int, VVVdouble>::iterator it = nodeLikelihoods_.begin(); it != nodeLikelihoods_.end();)
+      {
+        if (std::find(neighbors.begin(), neighbors.end(), it->first) == neighbors.end())
+        {
+          pool.push_back(std::move(it->second));
+          nodeLikelihoods_.erase(it++);
+        }
+        else
+          ++it;
+      }
+    }
+
+    /**
+     * @brief Get the array for a neighbor, taking it from the pool
+     * of free arrays if it does not exist yet.
+     */
+    VVVdouble& getLikelihoodArrayForNeighbor(int neighborId, std::vector<VVVdouble>& pool)
+    {
+      std::map<int, VVVdouble>::iterator it = nodeLikelihoods_.find(neighborId);
+      if (it != nodeLikelihoods_.end())
+        return it->second;
+      VVVdouble& array = nodeLikelihoods_[neighborId];
+      if (!pool.empty())
+      {
+        array = std::move(pool.back());
+        pool.pop_back();
+      }
+      return array;
+    }
+
     void eraseNeighborArrays()
     {
       nodeLikelihoods_.erase(nodeLikelihoods_.begin(), nodeLikelihoods_.end());
@@ -221,23 +280,51 @@ namespace bpp
   {
   private:
 
-    mutable std::map<int, DRASDRTreeLikelihoodNodeData> nodeData_;
-    mutable std::map<int, DRASDRTreeLikelihoodLeafData> leafData_;
+    /**
+     * @brief Node and leaf data, indexed by node id.
+     */
+    mutable std::vector<DRASDRTreeLikelihoodNodeData> nodeData_;
+    mutable std::vector<DRASDRTreeLikelihoodLeafData> leafData_;
     mutable VVVdouble rootLikelihoods_;
     mutable VVdouble  rootLikelihoodsS_;
     mutable Vdouble   rootLikelihoodsSR_;
 
+    /**
+     * @brief Distinct leaf state profiles, shared by all leaves.
+     */
+    VVdouble leafStateProfiles_;
+
+    /**
+     * @brief Index of the profiles in leafStateProfiles_, only used while initializing.
+     */
+    std::map<Vdouble, unsigned int> leafStateProfileIndex_;
+
+    /**
+     * @brief Arrays released after a change of topology, reused for
+     * the new neighbors of the nodes, so that NNI moves and new data
+     * sets do not free and allocate the arrays again.
+     */
+    std::vector<VVVdouble> arrayPool_;
+
     std::shared_ptr<AlignedValuesContainer> shrunkData_;
     size_t nbSites_; 
     size_t nbStates_;
     size_t nbClasses_;
     size_t nbDistinctSites_; 
 
+    /**
+     * @brief Tell if the node and root arrays were allocated since the
+     * last initialization.
+     */
+    bool arraysAllocated_;
+
   public:
     DRASDRTreeLikelihoodData(const TreeTemplate<Node>* tree, size_t nbClasses) :
       AbstractTreeLikelihoodData(tree),
       nodeData_(), leafData_(), rootLikelihoods_(), rootLikelihoodsS_(), rootLikelihoodsSR_(),
-      shrunkData_(0), nbSites_(0), nbStates_(0), nbClasses_(nbClasses), nbDistinctSites_(0)
+      leafStateProfiles_(), leafStateProfileIndex_(), arrayPool_(),
+      shrunkData_(0), nbSites_(0), nbStates_(0), nbClasses_(nbClasses), nbDistinctSites_(0),
+      arraysAllocated_(false)
     {}
 
     DRASDRTreeLikelihoodData(const DRASDRTreeLikelihoodData& data):
@@ -246,13 +333,14 @@ namespace bpp
       rootLikelihoods_(data.rootLikelihoods_),
       rootLikelihoodsS_(data.rootLikelihoodsS_),
       rootLikelihoodsSR_(data.rootLikelihoodsSR_),
-      shrunkData_(0),
+      leafStateProfiles_(data.leafStateProfiles_),
+      leafStateProfileIndex_(),
+      arrayPool_(),
+      shrunkData_(data.shrunkData_),
       nbSites_(data.nbSites_), nbStates_(data.nbStates_),
-      nbClasses_(data.nbClasses_), nbDistinctSites_(data.nbDistinctSites_)
-    {
-      if (data.shrunkData_)
-        shrunkData_ = std::shared_ptr<AlignedValuesContainer>(dynamic_cast<AlignedValuesContainer*>(data.shrunkData_->clone()));
-    }
+      nbClasses_(data.nbClasses_), nbDistinctSites_(data.nbDistinctSites_),
+      arraysAllocated_(data.arraysAllocated_)
+    {}
 
     DRASDRTreeLikelihoodData& operator=(const DRASDRTreeLikelihoodData& data)
     {
@@ -262,14 +350,13 @@ namespace bpp
       rootLikelihoods_   = data.rootLikelihoods_;
       rootLikelihoodsS_  = data.rootLikelihoodsS_;
       rootLikelihoodsSR_ = data.rootLikelihoodsSR_;
+      leafStateProfiles_ = data.leafStateProfiles_;
       nbSites_           = data.nbSites_;
       nbStates_          = data.nbStates_;
       nbClasses_         = data.nbClasses_;
       nbDistinctSites_   = data.nbDistinctSites_;
-      if (data.shrunkData_)
-        shrunkData_ = std::shared_ptr<AlignedValuesContainer>(dynamic_cast<AlignedValuesContainer*>(data.shrunkData_->clone()));
-      else
-        shrunkData_      = 0;
+      shrunkData_        = data.shrunkData_;
+      arraysAllocated_   = data.arraysAllocated_;
       return *this;
     }
 
@@ -290,36 +377,40 @@ namespace bpp
     void setTree(const TreeTemplate<Node>* tree)
     { 
       tree_ = tree;
-      for (std::map<int, DRASDRTreeLikelihoodNodeData>::iterator it = nodeData_.begin(); it != nodeData_.end(); it++)
+      for (std::vector<DRASDRTreeLikelihoodNodeData>::iterator it = nodeData_.begin(); it != nodeData_.end(); it++)
       {
-        int id = it->second.getNode()->getId();
-        it->second.setNode(tree_->getNode(id));
+        if (!it->getNode())
+          continue;
+        int id = it->getNode()->getId();
+        it->setNode(tree_->getNode(id));
       }
-      for (std::map<int, DRASDRTreeLikelihoodLeafData>::iterator it = leafData_.begin(); it != leafData_.end(); it++)
+      for (std::vector<DRASDRTreeLikelihoodLeafData>::iterator it = leafData_.begin(); it != leafData_.end(); it++)
       {
-        int id = it->second.getNode()->getId();
-        it->second.setNode(tree_->getNode(id));
+        if (!it->getNode())
+          continue;
+        int id = it->getNode()->getId();
+        it->setNode(tree_->getNode(id));
       }
     }
 
     DRASDRTreeLikelihoodNodeData& getNodeData(int nodeId)
     { 
-      return nodeData_[nodeId];
+      return nodeData_[static_cast<size_t>(nodeId)];
     }
     
     const DRASDRTreeLikelihoodNodeData& getNodeData(int nodeId) const
     { 
-      return nodeData_[nodeId];
+      return nodeData_[static_cast<size_t>(nodeId)];
     }
     
     DRASDRTreeLikelihoodLeafData& getLeafData(int nodeId)
     { 
-      return leafData_[nodeId];
+      return leafData_[static_cast<size_t>(nodeId)];
     }
     
     const DRASDRTreeLikelihoodLeafData& getLeafData(int nodeId) const
     { 
-      return leafData_[nodeId];
+      return leafData_[static_cast<size_t>(nodeId)];
     }
     
     size_t getArrayPosition(int parentId, int sonId, size_t currentPosition) const
@@ -329,53 +420,79 @@ namespace bpp
 
     const std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId) const 
     {
-      return nodeData_[nodeId].getLikelihoodArrays();
+      return nodeData_[static_cast<size_t>(nodeId)].getLikelihoodArrays();
     }
     
     std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId)
     {
-      return nodeData_[nodeId].getLikelihoodArrays();
+      return nodeData_[static_cast<size_t>(nodeId)].getLikelihoodArrays();
     }
 
     VVVdouble& getLikelihoodArray(int parentId, int neighborId)
     {
-      return nodeData_[parentId].getLikelihoodArrayForNeighbor(neighborId);
+      return nodeData_[static_cast<size_t>(parentId)].getLikelihoodArrayForNeighbor(neighborId);
     }
     
     const VVVdouble& getLikelihoodArray(int parentId, int neighborId) const
     {
-      return nodeData_[parentId].getLikelihoodArrayForNeighbor(neighborId);
+      return nodeData_[static_cast<size_t>(parentId)].getLikelihoodArrayForNeighbor(neighborId);
     }
     
+    /**
+     * @brief Get the first order derivative array of a node, allocated when it is first requested.
+     */
     Vdouble& getDLikelihoodArray(int nodeId)
     {
-      return nodeData_[nodeId].getDLikelihoodArray();
+      Vdouble& array = nodeData_[static_cast<size_t>(nodeId)].getDLikelihoodArray();
+      if (array.size() != nbDistinctSites_)
+        array.resize(nbDistinctSites_);
+      return array;
     }
     
     const Vdouble& getDLikelihoodArray(int nodeId) const
     {
-      return nodeData_[nodeId].getDLikelihoodArray();
+      return nodeData_[static_cast<size_t>(nodeId)].getDLikelihoodArray();
     }
     
+    /**
+     * @brief Get the second order derivative array of a node, allocated when it is first requested.
+     */
     Vdouble& getD2LikelihoodArray(int nodeId)
     {
-      return nodeData_[nodeId].getD2LikelihoodArray();
+      Vdouble& array = nodeData_[static_cast<size_t>(nodeId)].getD2LikelihoodArray();
+      if (array.size() != nbDistinctSites_)
+        array.resize(nbDistinctSites_);
+      return array;
     }
 
     const Vdouble& getD2LikelihoodArray(int nodeId) const
     {
-      return nodeData_[nodeId].getD2LikelihoodArray();
+      return nodeData_[static_cast<size_t>(nodeId)].getD2LikelihoodArray();
     }
 
-    VVdouble& getLeafLikelihoods(int nodeId)
-    {
-      return leafData_[nodeId].getLikelihoodArray();
-    }
-    
-    const VVdouble& getLeafLikelihoods(int nodeId) const
+    /**
+     * @brief Get the sites x states likelihood array of a leaf.
+     *
+     * The array is built from the state codes at each call, and is not
+     * kept, so that this method can be called from several threads.
+     * Likelihood computations should rather use getLeafStateCodes() and
+     * getLeafStateProfiles().
+     */
+    VVdouble getLeafLikelihoods(int nodeId) const;
+
+    /**
+     * @return The index of the state profile of a leaf, for each distinct site.
+     */
+    const std::vector<unsigned int>& getLeafStateCodes(int nodeId) const
     {
-      return leafData_[nodeId].getLikelihoodArray();
+      return leafData_[static_cast<size_t>(nodeId)].getStateCodes();
     }
+
+    /**
+     * @return The table of distinct leaf state profiles, indexed by state codes.
+     * Each profile has one likelihood value per model state.
+     */
+    const VVdouble& getLeafStateProfiles() const { return leafStateProfiles_; }
     
     VVVdouble& getRootLikelihoodArray() { return rootLikelihoods_; }
     const VVVdouble & getRootLikelihoodArray() const { return rootLikelihoods_; }
@@ -395,15 +512,45 @@ namespace bpp
     size_t getNumberOfClasses() const { return nbClasses_; }
 
     const std::shared_ptr<AlignedValuesContainer> getShrunkData() const { return shrunkData_; }
+
+    void getMemoryUsage(MemoryUsage& usage) const;
+
+    /**
+     * @brief Exchange the contents of all inner, derivative and root
+     * arrays with those of @p data, without copying them.
+     *
+     * The arrays keep their addresses, so that pointers to them stay
+     * valid. Leaf arrays are not exchanged.
+     *
+     * @param data Likelihood data with the same arrays, typically a clone.
+     * @return false, without exchanging anything, if @p data does not have
+     * the same arrays (other topology or data set).
+     */
+    bool swapArrays(DRASDRTreeLikelihoodData& data);
     
     /**
-     * @brief Resize and initialize all likelihood arrays according to the given data set and substitution model.
+     * @brief Initialize the leaves and the node array relationships according to the given data set and substitution model.
+     *
+     * Node and root arrays are only allocated by allocateArrays(), and derivative
+     * arrays when they are first requested.
      *
      * @param sites The sequences to use as data.
      * @param model The substitution model to use.
      * @throw Exception if an error occures.
      */
     void initLikelihoods(const AlignedValuesContainer& sites, const TransitionModel& model);
+
+    /**
+     * @brief Same as initLikelihoods(sites, model), but the compressed
+     * data set and the site patterns are taken from @p shared, which
+     * must have been initialized with the same sites.
+     *
+     * @param sites The sequences to use as data.
+     * @param model The substitution model to use.
+     * @param shared Likelihood data initialized with @p sites.
+     * @throw Exception if an error occures.
+     */
+    void initLikelihoods(const AlignedValuesContainer& sites, const TransitionModel& model, const DRASDRTreeLikelihoodData& shared);
     
     /**
      * @brief Rebuild likelihood arrays at inner nodes.
@@ -411,11 +558,26 @@ namespace bpp
      * This method is to be called when the topology of the tree has changed.
      * Node arrays relationship are rebuilt according to the new topology of the tree.
      * The leaves likelihood remain unchanged, so as for the first and second order derivatives.
+     * The arrays for new neighbors are allocated by the next call to allocateArrays().
      */
     void reInit();
     
     void reInit(const Node* node);
 
+    /**
+     * @brief Allocate the node and root arrays, filled with 1, if this was
+     * not done since the last initialization.
+     *
+     * Likelihood objects call this before their first computation, so that
+     * objects which are built but never evaluated do not hold the arrays.
+     *
+     * @param upperArrays Tell if the arrays of the nodes for their father
+     * should also be allocated. Otherwise they are left to the computation.
+     */
+    void allocateArrays(bool upperArrays = true);
+
+    bool hasAllocatedArrays() const { return arraysAllocated_; }
+
   protected:
     /**
      * @brief This method initializes the leaves according to a sequence container.
@@ -424,8 +586,8 @@ namespace bpp
      * Likelihood is set to 1 for the state corresponding to the sequence site,
      * otherwise it is set to 0.
      *
-     * All likelihood arrays at each nodes are initialized according to alphabet
-     * size and sequences length, and filled with 1.
+     * The likelihood arrays at each nodes are created empty, and are sized and
+     * filled with 1 by allocateArrays().
      *
      * NB: This method is recursive.
      *
@@ -434,6 +596,27 @@ namespace bpp
      * @param model The model, used for initializing leaves' likelihoods.
      */
     void initLikelihoods(const Node* node, const AlignedValuesContainer& sites, const TransitionModel& model);
+
+    /**
+     * @brief Resize the node and leaf data so that they can be indexed by any node id of the tree.
+     */
+    void resizeNodeData_();
+
+    /**
+     * @brief Move the arrays of all nodes for their former neighbors
+     * into arrayPool_.
+     */
+    void releaseStaleArrays_();
+
+    /**
+     * @brief Initialize the node and root arrays from shrunkData_.
+     */
+    void initArrays_(const TransitionModel& model);
+
+    /**
+     * @brief Get the code of a leaf state profile, adding it to the table if needed.
+     */
+    unsigned int getLeafStateCode_(const Vdouble& profile);
     
   };
 
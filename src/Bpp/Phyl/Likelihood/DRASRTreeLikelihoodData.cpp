@@ -140,6 +140,9 @@ void DRASRTreeLikelihoodData::initLikelihoods(const Node* node, const AlignedVal
     {
       throw SequenceNotFoundException("DRASRTreeLikelihoodData::initTreelikelihoods. Leaf name in tree not found in site container: ", (node->getName()));
     }
+    // Integer-coded characters are looked up in a table rather than resolved for each state:
+    const SiteContainer* sc = dynamic_cast<const SiteContainer*>(&sequences);
+    StateIndicatorTable indicators(model.getStateMap());
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
       VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
@@ -148,12 +151,15 @@ void DRASRTreeLikelihoodData::initLikelihoods(const Node* node, const AlignedVal
         Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
         double test = 0.;
 
+        if (sc)
+          *_likelihoods_node_i_c = indicators.getIndicators(sc->getSite(i)[posSeq]);
         for (size_t s = 0; s < nbStates_; s++)
         {
           // Leaves likelihood are set to 1 if the char correspond to the site in the sequence,
           // otherwise value set to 0:
 
-          (*_likelihoods_node_i_c)[s] = sequences.getStateValueAt(i, posSeq, model.getAlphabetStateAsInt(s));
+          if (!sc)
+            (*_likelihoods_node_i_c)[s] = sequences.getStateValueAt(i, posSeq, model.getAlphabetStateAsInt(s));
           test += (*_likelihoods_node_i_c)[s];
         }
         if (test < 0.000001)
@@ -246,6 +252,8 @@ SitePatterns* DRASRTreeLikelihoodData::initLikelihoodsWithPatterns(const Node* n
       throw SequenceNotFoundException("HomogeneousTreeLikelihood::initTreelikelihoodsWithPatterns. Leaf name in tree not found in site container: ", (node->getName()));
     }
 
+    const SiteContainer* sc = dynamic_cast<const SiteContainer*>(subSequences.get());
+    StateIndicatorTable indicators(model.getStateMap());
     for (size_t i = 0; i < nbSites; i++)
     {
       VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
@@ -254,12 +262,15 @@ SitePatterns* DRASRTreeLikelihoodData::initLikelihoodsWithPatterns(const Node* n
       {
         Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
         double test = 0.;
+        if (sc)
+          *_likelihoods_node_i_c = indicators.getIndicators(sc->getSite(i)[posSeq]);
         for (size_t s = 0; s < nbStates_; s++)
         {
           // Leaves likelihood are set to 1 if the char correspond to the site in the sequence,
           // otherwise value set to 0:
           // cout << "i=" << i << "\tc=" << c << "\ts=" << s << endl;
-          (*_likelihoods_node_i_c)[s] = subSequences->getStateValueAt(i, posSeq, model.getAlphabetStateAsInt(s));
+          if (!sc)
+            (*_likelihoods_node_i_c)[s] = subSequences->getStateValueAt(i, posSeq, model.getAlphabetStateAsInt(s));
           test += (*_likelihoods_node_i_c)[s];
         }
         if (test < 0.000001)
@@ -294,3 +305,19 @@ SitePatterns* DRASRTreeLikelihoodData::initLikelihoodsWithPatterns(const Node* n
 
 /******************************************************************************/
 
+void DRASRTreeLikelihoodData::getMemoryUsage(MemoryUsage& usage) const
+{
+  AbstractTreeLikelihoodData::getMemoryUsage(usage);
+  for (map<int, DRASRTreeLikelihoodNodeData>::const_iterator it = nodeData_.begin(); it != nodeData_.end(); it++)
+  {
+    const DRASRTreeLikelihoodNodeData& data = it->second;
+    bool isLeaf = data.getNode() && data.getNode()->isLeaf();
+    usage.add(isLeaf ? MemoryUsage::LEAF_ARRAYS : MemoryUsage::INNER_ARRAYS, MemoryUsage::getHeapBytes(data.getLikelihoodArray()));
+    usage.add(MemoryUsage::DERIVATIVE_ARRAYS, MemoryUsage::getHeapBytes(data.getDLikelihoodArray())
+        + MemoryUsage::getHeapBytes(data.getD2LikelihoodArray()));
+  }
+  usage.add(MemoryUsage::OTHER, MemoryUsage::getHeapBytes(patternLinks_));
+}
+
+/******************************************************************************/
+
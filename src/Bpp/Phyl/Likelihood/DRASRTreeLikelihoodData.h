@@ -259,6 +259,8 @@ namespace bpp
     size_t getNumberOfSites() const { return nbSites_; }
     size_t getNumberOfStates() const { return nbStates_; }
     size_t getNumberOfClasses() const { return nbClasses_; }
+
+    void getMemoryUsage(MemoryUsage& usage) const;
     
     void initLikelihoods(const AlignedValuesContainer& sites, const TransitionModel& model);
 
@@ -37,6 +37,7 @@
  */
 
 #include "DRHomogeneousMixedTreeLikelihood.h"
+#include "CompensatedSum.h"
 
 
 // From the STL:
@@ -61,7 +62,8 @@ DRHomogeneousMixedTreeLikelihood::DRHomogeneousMixedTreeLikelihood(
   DRHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   treeLikelihoodsContainer_(),
   probas_(),
-  rootArray_(rootArray)
+  rootArray_(rootArray),
+  componentExecutor_()
 {
   MixedSubstitutionModel* mixedmodel;
 
@@ -88,7 +90,8 @@ DRHomogeneousMixedTreeLikelihood::DRHomogeneousMixedTreeLikelihood(
   DRHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   treeLikelihoodsContainer_(),
   probas_(),
-  rootArray_(rootArray)
+  rootArray_(rootArray),
+  componentExecutor_()
 {
   MixedSubstitutionModel* mixedmodel;
 
@@ -122,6 +125,8 @@ DRHomogeneousMixedTreeLikelihood& DRHomogeneousMixedTreeLikelihood::operator=(co
 
   rootArray_=lik.rootArray_;
 
+  setNumberOfComponentThreads(lik.getNumberOfComponentThreads());
+
   return *this;
 }
 
@@ -129,8 +134,10 @@ DRHomogeneousMixedTreeLikelihood::DRHomogeneousMixedTreeLikelihood(const DRHomog
   DRHomogeneousTreeLikelihood(lik),
   treeLikelihoodsContainer_(lik.treeLikelihoodsContainer_.size()),
   probas_(lik.probas_.size()),
-  rootArray_(lik.rootArray_)
+  rootArray_(lik.rootArray_),
+  componentExecutor_()
 {
+  setNumberOfComponentThreads(lik.getNumberOfComponentThreads());
   for (unsigned int i = 0; i < treeLikelihoodsContainer_.size(); i++)
   {
     treeLikelihoodsContainer_.push_back(lik.treeLikelihoodsContainer_[i]->clone());
@@ -146,6 +153,23 @@ DRHomogeneousMixedTreeLikelihood::~DRHomogeneousMixedTreeLikelihood()
   }
 }
 
+void DRHomogeneousMixedTreeLikelihood::setNumberOfComponentThreads(size_t nbThreads)
+{
+  if (nbThreads == getNumberOfComponentThreads())
+    return;
+  if (nbThreads <= 1)
+    componentExecutor_.reset();
+  else
+    componentExecutor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
+void DRHomogeneousMixedTreeLikelihood::runComponentLoop_(size_t nbComponents, const std::function<void(size_t, size_t)>& loop) const
+{
+  if (componentExecutor_)
+    componentExecutor_->run(nbComponents, loop);
+  else if (nbComponents > 0)
+    loop(0, nbComponents);
+}
 
 void DRHomogeneousMixedTreeLikelihood::initialize()
 {
@@ -177,20 +201,36 @@ void DRHomogeneousMixedTreeLikelihood::fireParameterChanged(const ParameterList&
 
   size_t s = mixedmodel->getNumberOfModels();
 
-  const TransitionModel* pm;
-  for (size_t i = 0; i < s; i++)
-  {
-    ParameterList pl;
-    pm = mixedmodel->getNModel(i);
-    pl.addParameters(pm->getParameters());
-    pl.includeParameters(getParameters());
-    treeLikelihoodsContainer_[i]->matchParametersValues(pl);
-  }
+  // Each submodel likelihood is updated independently:
+  runComponentLoop_(s, [&](size_t firstComponent, size_t lastComponent) {
+    for (size_t i = firstComponent; i < lastComponent; i++)
+    {
+      ParameterList pl;
+      const TransitionModel* pm = mixedmodel->getNModel(i);
+      pl.addParameters(pm->getParameters());
+      pl.includeParameters(getParameters());
+      treeLikelihoodsContainer_[i]->matchParametersValues(pl);
+    }
+  });
   probas_ = mixedmodel->getProbabilities();
 
   minusLogLik_ = -getLogLikelihood();
 }
 
+void DRHomogeneousMixedTreeLikelihood::rootAt(int nodeId)
+{
+  runComponentLoop_(treeLikelihoodsContainer_.size(), [&](size_t firstComponent, size_t lastComponent) {
+    for (size_t i = firstComponent; i < lastComponent; i++)
+    {
+      treeLikelihoodsContainer_[i]->rootAt(nodeId);
+    }
+  });
+  if (moveRoot_(nodeId).empty())
+    return;
+  invalidateLikelihoodOperations_();
+  minusLogLik_ = -getLogLikelihood();
+}
+
 void DRHomogeneousMixedTreeLikelihood::resetLikelihoodArrays(const Node* node)
 {
   for (unsigned int i = 0; i < treeLikelihoodsContainer_.size(); i++)
@@ -201,10 +241,12 @@ void DRHomogeneousMixedTreeLikelihood::resetLikelihoodArrays(const Node* node)
 
 void DRHomogeneousMixedTreeLikelihood::computeTreeLikelihood()
 {
-  for (unsigned int i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->computeTreeLikelihood();
-  }
+  runComponentLoop_(treeLikelihoodsContainer_.size(), [&](size_t firstComponent, size_t lastComponent) {
+    for (size_t i = firstComponent; i < lastComponent; i++)
+    {
+      treeLikelihoodsContainer_[i]->computeTreeLikelihood();
+    }
+  });
   if(rootArray_)
     computeRootLikelihood();
 }
@@ -238,8 +280,6 @@ double DRHomogeneousMixedTreeLikelihood::getLikelihood() const
 
 double DRHomogeneousMixedTreeLikelihood::getLogLikelihood() const
 {
-  double ll = 0;
-
   vector<Vdouble*> llik;
   for (unsigned int i = 0; i < treeLikelihoodsContainer_.size(); i++)
   {
@@ -256,15 +296,9 @@ double DRHomogeneousMixedTreeLikelihood::getLogLikelihood() const
     {
       x += (*llik[j])[i] * probas_[j];
     }
-    la[i] = (*w)[i] * log(x);
+    la[i] = x;
   }
-  sort(la.begin(), la.end());
-  for (size_t i = nbDistinctSites_; i > 0; i--)
-  {
-    ll += la[i - 1];
-  }
-
-  return ll;
+  return sumOfWeightedLogarithms(la.begin(), w->begin(), nbDistinctSites_);
 }
 
 
@@ -390,10 +424,12 @@ void DRHomogeneousMixedTreeLikelihood::computeLikelihoodAtNode_(const Node* node
 
 void DRHomogeneousMixedTreeLikelihood::computeTreeDLikelihoods()
 {
-  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->computeTreeDLikelihoods();
-  }
+  runComponentLoop_(treeLikelihoodsContainer_.size(), [&](size_t firstComponent, size_t lastComponent) {
+    for (size_t i = firstComponent; i < lastComponent; i++)
+    {
+      treeLikelihoodsContainer_[i]->computeTreeDLikelihoods();
+    }
+  });
 }
 
 double DRHomogeneousMixedTreeLikelihood::getFirstOrderDerivative(const std::string& variable) const
@@ -445,18 +481,22 @@ double DRHomogeneousMixedTreeLikelihood::getFirstOrderDerivative(const std::stri
 
 void DRHomogeneousMixedTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* node)
 {
-  for (unsigned int i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->computeTreeD2LikelihoodAtNode(node);
-  }
+  runComponentLoop_(treeLikelihoodsContainer_.size(), [&](size_t firstComponent, size_t lastComponent) {
+    for (size_t i = firstComponent; i < lastComponent; i++)
+    {
+      treeLikelihoodsContainer_[i]->computeTreeD2LikelihoodAtNode(node);
+    }
+  });
 }
 
 void DRHomogeneousMixedTreeLikelihood::computeTreeD2Likelihoods()
 {
-  for (unsigned int i = 0; i < treeLikelihoodsContainer_.size(); i++)
-  {
-    treeLikelihoodsContainer_[i]->computeTreeD2Likelihoods();
-  }
+  runComponentLoop_(treeLikelihoodsContainer_.size(), [&](size_t firstComponent, size_t lastComponent) {
+    for (size_t i = firstComponent; i < lastComponent; i++)
+    {
+      treeLikelihoodsContainer_[i]->computeTreeD2Likelihoods();
+    }
+  });
 }
 
 double DRHomogeneousMixedTreeLikelihood::getSecondOrderDerivative(const std::string& variable) const
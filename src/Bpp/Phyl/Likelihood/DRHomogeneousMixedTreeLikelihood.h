@@ -40,12 +40,17 @@
 #define _DRHOMOGENEOUSMIXEDTREELIKELIHOOD_H_
 
 #include "DRHomogeneousTreeLikelihood.h"
+#include "../SiteLoopExecutor.h"
 #include "../Model/SubstitutionModel.h"
 #include "../Model/MixedSubstitutionModel.h"
 
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Prob/DiscreteDistribution.h>
 
+// From the STL:
+#include <functional>
+#include <memory>
+
 namespace bpp
 {
 
@@ -68,6 +73,12 @@ private:
   // reconstruction)
   
   bool rootArray_;
+
+  /**
+   * @brief Threads computing the likelihoods of the submodels
+   * concurrently (none by default).
+   */
+  std::unique_ptr<SiteLoopExecutor> componentExecutor_;
   
 public:
   /**
@@ -184,6 +195,56 @@ public:
 
   virtual void computeTreeDLikelihoods();
 
+  /**
+   * @brief Set the number of threads computing the likelihoods of
+   * the submodels concurrently.
+   *
+   * Each thread updates a contiguous block of submodel likelihoods,
+   * which are fully independent since each one has its own model.
+   * Their probability-weighted combination is then performed
+   * serially, so that results do not depend on the number of threads.
+   *
+   * @param nbThreads The number of threads, including the calling one. 1 (the default) means no additional thread.
+   */
+  void setNumberOfComponentThreads(size_t nbThreads);
+
+  size_t getNumberOfComponentThreads() const { return componentExecutor_ ? componentExecutor_->getNumberOfThreads() : 1; }
+
+  /**
+   * @brief Not available with mixed models, whose transition
+   * probabilities are held by the likelihood of each model.
+   */
+  void optimizeBranchLengthsOneByOne(const std::vector<std::string>& names, double tolerance, unsigned int maxNbSteps)
+  {
+    throw Exception("DRHomogeneousMixedTreeLikelihood::optimizeBranchLengthsOneByOne. Not implemented for mixed models.");
+  }
+
+  /**
+   * @brief Not available with mixed models, whose likelihood arrays
+   * are computed by their own recursions.
+   */
+  void setMemoryBudget(size_t bytes)
+  {
+    if (bytes > 0)
+      throw Exception("DRHomogeneousMixedTreeLikelihood::setMemoryBudget. Not implemented for mixed models.");
+  }
+
+  /**
+   * @brief Not available with mixed models, whose likelihood arrays
+   * are held by the likelihood of each model.
+   */
+  void proposeParameters(const ParameterList& parameters)
+  {
+    throw Exception("DRHomogeneousMixedTreeLikelihood::proposeParameters. Not implemented for mixed models.");
+  }
+
+  /**
+   * @brief Move the root of the tree, in the likelihood of each submodel too.
+   *
+   * @see DRHomogeneousTreeLikelihood::rootAt
+   */
+  void rootAt(int nodeId);
+
 protected:
   virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode = 0) const;
 
@@ -203,6 +264,11 @@ protected:
 
   void resetLikelihoodArrays(const Node* node);
 
+  /**
+   * @brief Run a loop over submodel likelihoods, in parallel if component threads are set.
+   */
+  void runComponentLoop_(size_t nbComponents, const std::function<void(size_t, size_t)>& loop) const;
+
   /**
    * @brief This method is mainly for debugging purpose.
    *
@@ -38,7 +38,9 @@
  */
 
 #include "DRHomogeneousTreeLikelihood.h"
+#include "CompensatedSum.h"
 #include "../PatternTools.h"
+#include "../Tree/TreeTemplateTools.h"
 
 // From SeqLib:
 #include <Bpp/Seq/SiteTools.h>
@@ -51,6 +53,8 @@
 using namespace bpp;
 
 // From the STL:
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 using namespace std;
@@ -65,6 +69,25 @@ DRHomogeneousTreeLikelihood::DRHomogeneousTreeLikelihood(
   bool verbose) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
+  fatherLikelihoods_(),
+  siteLoopExecutor_(),
+  likelihoodOperations_(),
+  likelihoodOperationsUpToDate_(false),
+  memoryBudget_(0),
+  checkpointInterval_(1),
+  maxNbUpperTransients_(0),
+  upperCheckpoints_(),
+  upperUpToDate_(),
+  upperTransients_(),
+  upperMutex_(),
+  proposalData_(),
+  proposalParameters_(),
+  proposalPxy_(),
+  proposalDpxy_(),
+  proposalD2pxy_(),
+  proposalRootFreqs_(),
+  proposalMinusLogLik_(-1.),
+  hasProposal_(false),
   minusLogLik_(-1.)
 {
   init_();
@@ -81,6 +104,25 @@ DRHomogeneousTreeLikelihood::DRHomogeneousTreeLikelihood(
   bool verbose) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
+  fatherLikelihoods_(),
+  siteLoopExecutor_(),
+  likelihoodOperations_(),
+  likelihoodOperationsUpToDate_(false),
+  memoryBudget_(0),
+  checkpointInterval_(1),
+  maxNbUpperTransients_(0),
+  upperCheckpoints_(),
+  upperUpToDate_(),
+  upperTransients_(),
+  upperMutex_(),
+  proposalData_(),
+  proposalParameters_(),
+  proposalPxy_(),
+  proposalDpxy_(),
+  proposalD2pxy_(),
+  proposalRootFreqs_(),
+  proposalMinusLogLik_(-1.),
+  hasProposal_(false),
   minusLogLik_(-1.)
 {
   init_();
@@ -101,11 +143,31 @@ void DRHomogeneousTreeLikelihood::init_()
 DRHomogeneousTreeLikelihood::DRHomogeneousTreeLikelihood(const DRHomogeneousTreeLikelihood& lik) :
   AbstractHomogeneousTreeLikelihood(lik),
   likelihoodData_(0),
+  fatherLikelihoods_(),
+  siteLoopExecutor_(),
+  likelihoodOperations_(),
+  likelihoodOperationsUpToDate_(false),
+  memoryBudget_(lik.memoryBudget_),
+  checkpointInterval_(lik.checkpointInterval_),
+  maxNbUpperTransients_(lik.maxNbUpperTransients_),
+  upperCheckpoints_(lik.upperCheckpoints_),
+  upperUpToDate_(lik.upperUpToDate_),
+  upperTransients_(lik.upperTransients_),
+  upperMutex_(),
+  proposalData_(),
+  proposalParameters_(),
+  proposalPxy_(),
+  proposalDpxy_(),
+  proposalD2pxy_(),
+  proposalRootFreqs_(),
+  proposalMinusLogLik_(-1.),
+  hasProposal_(false),
   minusLogLik_(-1.)
 {
   likelihoodData_ = dynamic_cast<DRASDRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
   minusLogLik_ = lik.minusLogLik_;
+  setNumberOfThreads(lik.getNumberOfThreads());
 }
 
 /******************************************************************************/
@@ -117,7 +179,19 @@ DRHomogeneousTreeLikelihood& DRHomogeneousTreeLikelihood::operator=(const DRHomo
     delete likelihoodData_;
   likelihoodData_ = dynamic_cast<DRASDRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
+  likelihoodOperations_.clear();
+  likelihoodOperationsUpToDate_ = false;
+  memoryBudget_          = lik.memoryBudget_;
+  checkpointInterval_    = lik.checkpointInterval_;
+  maxNbUpperTransients_  = lik.maxNbUpperTransients_;
+  upperCheckpoints_      = lik.upperCheckpoints_;
+  upperUpToDate_         = lik.upperUpToDate_;
+  upperTransients_       = lik.upperTransients_;
+  // Pending proposals are not copied.
+  proposalData_.reset();
+  hasProposal_ = false;
   minusLogLik_ = lik.minusLogLik_;
+  setNumberOfThreads(lik.getNumberOfThreads());
   return *this;
 }
 
@@ -130,14 +204,88 @@ DRHomogeneousTreeLikelihood::~DRHomogeneousTreeLikelihood()
 
 /******************************************************************************/
 
+void DRHomogeneousTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  if (nbThreads == getNumberOfThreads())
+    return;
+  if (nbThreads <= 1)
+    siteLoopExecutor_.reset();
+  else
+    siteLoopExecutor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::runSiteLoop_(const std::function<void(size_t, size_t)>& loop) const
+{
+  runParallelLoop_(nbDistinctSites_, loop);
+}
+
+void DRHomogeneousTreeLikelihood::runParallelLoop_(size_t size, const std::function<void(size_t, size_t)>& loop) const
+{
+  if (siteLoopExecutor_)
+    siteLoopExecutor_->run(size, loop);
+  else if (size > 0)
+    loop(0, size);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::setMemoryBudget(size_t bytes)
+{
+  memoryBudget_ = bytes;
+  invalidateLikelihoodOperations_();
+  if (isInitialized())
+  {
+    computeTreeLikelihood();
+    if (computeFirstOrderDerivatives_)
+      computeTreeDLikelihoods();
+    if (computeSecondOrderDerivatives_)
+      computeTreeD2Likelihoods();
+  }
+}
+
+/******************************************************************************/
+
 void DRHomogeneousTreeLikelihood::setData(const AlignedValuesContainer& sites)
 {
-  if (data_)
-    delete data_;
-  data_ = PatternTools::getSequenceSubset(sites, *tree_->getRootNode());
+  setData_(shared_ptr<const AlignedValuesContainer>(PatternTools::getSequenceSubset(sites, *tree_->getRootNode())), 0);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::setData(const AlignedValuesContainer& sites, const DRHomogeneousTreeLikelihood& shared)
+{
+  if (!shared.data_)
+  {
+    setData(sites);
+    return;
+  }
+
+  // The data subset only depends on the names of the leaves.
+  vector<string> leaves = tree_->getLeavesNames();
+  vector<string> names = shared.data_->getSequencesNames();
+  sort(leaves.begin(), leaves.end());
+  sort(names.begin(), names.end());
+
+  if (leaves == names)
+    setData_(shared.data_, shared.likelihoodData_);
+  else
+    setData(sites);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::setData_(shared_ptr<const AlignedValuesContainer> data, const DRASDRTreeLikelihoodData* shared)
+{
+  data_ = data;
   if (verbose_)
     ApplicationTools::displayTask("Initializing data structure");
-  likelihoodData_->initLikelihoods(*data_, *model_);
+  if (shared)
+    likelihoodData_->initLikelihoods(*data_, *model_, *shared);
+  else
+    likelihoodData_->initLikelihoods(*data_, *model_);
+  likelihoodOperationsUpToDate_ = false;
   if (verbose_)
     ApplicationTools::displayTaskDone();
 
@@ -170,21 +318,9 @@ double DRHomogeneousTreeLikelihood::getLikelihood() const
 
 double DRHomogeneousTreeLikelihood::getLogLikelihood() const
 {
-  double ll = 0;
-  Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
   const vector<unsigned int>* w = &likelihoodData_->getWeights();
-  vector<double> la(nbDistinctSites_);
-  for (size_t i = 0; i < nbDistinctSites_; i++)
-  {
-    la[i] = (*w)[i] * log((*lik)[i]);
-  }
-
-  sort(la.begin(), la.end());
-  for (size_t i = nbDistinctSites_; i > 0; i--)
-  {
-    ll += la[i - 1];
-  }
-  return ll;
+  return sumOfWeightedLogarithms(lik->begin(), w->begin(), nbDistinctSites_);
 }
 
 /******************************************************************************/
@@ -241,8 +377,8 @@ void DRHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& para
 {
   applyParameters();
 
-  if (rateDistribution_->getParameters().getCommonParametersWith(params).size() > 0
-      || model_->getParameters().getCommonParametersWith(params).size() > 0)
+  if (haveCommonParameters(rateDistribution_->getParameters(), params)
+      || haveCommonParameters(model_->getParameters(), params))
   {
     // Rate parameter changed, need to recompute all probs:
     computeAllTransitionProbabilities();
@@ -276,6 +412,119 @@ void DRHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& para
 
 /******************************************************************************/
 
+void DRHomogeneousTreeLikelihood::proposeParameters(const ParameterList& parameters)
+{
+  if (!isInitialized())
+    throw Exception("DRHomogeneousTreeLikelihood::proposeParameters(). Instance is not initialized.");
+  if (hasProposal_)
+    throw Exception("DRHomogeneousTreeLikelihood::proposeParameters(). A proposal is already pending.");
+  if (memoryBudget_ > 0)
+    throw Exception("DRHomogeneousTreeLikelihood::proposeParameters(). Proposals are not supported with a memory budget.");
+
+  // The second set of arrays is only copied after a change of topology or data.
+  if (!proposalData_ || !proposalData_->swapArrays(*likelihoodData_))
+    proposalData_.reset(likelihoodData_->clone());
+  proposalParameters_ = getParameters();
+  proposalPxy_ = pxy_;
+  proposalDpxy_ = dpxy_;
+  proposalD2pxy_ = d2pxy_;
+  proposalRootFreqs_ = rootFreqs_;
+  proposalMinusLogLik_ = minusLogLik_;
+  hasProposal_ = true;
+
+  try
+  {
+    setParametersValues(parameters);
+  }
+  catch (...)
+  {
+    rejectProposal();
+    throw;
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::acceptProposal()
+{
+  if (!hasProposal_)
+    throw Exception("DRHomogeneousTreeLikelihood::acceptProposal(). No pending proposal.");
+  hasProposal_ = false;
+}
+
+/******************************************************************************/
+
+namespace
+{
+  void swapTransitionProbabilities(map<int, VVVdouble>& pxy, map<int, VVVdouble>& saved)
+  {
+    // Exchange contents only: likelihood operations point to the arrays of pxy.
+    for (map<int, VVVdouble>::iterator it = pxy.begin(); it != pxy.end(); it++)
+      it->second.swap(saved[it->first]);
+  }
+}
+
+void DRHomogeneousTreeLikelihood::rejectProposal()
+{
+  if (!hasProposal_)
+    throw Exception("DRHomogeneousTreeLikelihood::rejectProposal(). No pending proposal.");
+  getParameters_().matchParametersValues(proposalParameters_);
+  applyParameters();
+  likelihoodData_->swapArrays(*proposalData_);
+  swapTransitionProbabilities(pxy_, proposalPxy_);
+  swapTransitionProbabilities(dpxy_, proposalDpxy_);
+  swapTransitionProbabilities(d2pxy_, proposalD2pxy_);
+  rootFreqs_.swap(proposalRootFreqs_);
+  minusLogLik_ = proposalMinusLogLik_;
+  hasProposal_ = false;
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::rootAt(int nodeId)
+{
+  vector<Node*> moved = moveRoot_(nodeId);
+  if (moved.empty())
+    return;
+  invalidateLikelihoodOperations_();
+  if (memoryBudget_ > 0)
+    updateUpperCheckpoints_();
+
+  // moved[i] is now the son of moved[i + 1], and the last one the son of the new root.
+  // The arrays toward the other neighbors are reused: with a reversible model at
+  // equilibrium they do not depend on the position of the root.
+  // The arrays across the branches of the path are computed again, since the old upper
+  // arrays include the root frequencies and the old root has no upper array.
+  // Lower arrays, from the old root to the new one:
+  for (size_t i = 0; i < moved.size(); i++)
+  {
+    VVVdouble* array = &likelihoodData_->getLikelihoodArray(moved[i]->getFatherId(), moved[i]->getId());
+    if (array->size() != nbDistinctSites_)
+      array->assign(nbDistinctSites_, VVdouble(nbClasses_, Vdouble(nbStates_)));
+    computeSubtreeLikelihoodPostfixAtNode_(moved[i]);
+  }
+  // Upper arrays, from the new root to the old one (computed when needed with a memory budget):
+  if (memoryBudget_ == 0)
+  {
+    for (size_t i = moved.size(); i > 0; i--)
+    {
+      computeSubtreeLikelihoodPrefixAtNode_(moved[i - 1]);
+    }
+  }
+
+  computeRootLikelihood();
+  for (size_t i = 0; i < moved.size(); i++)
+  {
+    if (computeFirstOrderDerivatives_)
+      computeTreeDLikelihoodAtNode(moved[i]);
+    if (computeSecondOrderDerivatives_)
+      computeTreeD2LikelihoodAtNode(moved[i]);
+  }
+  minusLogLik_ = -getLogLikelihood();
+}
+
+/******************************************************************************/
+
 double DRHomogeneousTreeLikelihood::getValue() const
 {
   if (!isInitialized())
@@ -292,41 +541,44 @@ void DRHomogeneousTreeLikelihood::computeTreeDLikelihoodAtNode(const Node* node)
   VVVdouble* likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
   Vdouble* dLikelihoods_node = &likelihoodData_->getDLikelihoodArray(node->getId());
   VVVdouble* dpxy_node = &dpxy_[node->getId()];
-  VVVdouble larray;
+  VVVdouble& larray = fatherLikelihoods_;
   computeLikelihoodAtNode_(father, larray, node);
 
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  Vdouble p = rateDistribution_->getProbabilities();
 
-  double dLi, dLic, dLicx;
-
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  runSiteLoop_([&](size_t firstSite, size_t lastSite)
   {
-    VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    dLi = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
+    double dLi, dLic, dLicx;
+
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
-      VVdouble* dpxy_node_c = &(*dpxy_node)[c];
-      dLic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
+      VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
+      VVdouble* larray_i = &larray[i];
+      dLi = 0;
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* dpxy_node_c_x = &(*dpxy_node_c)[x];
-        dLicx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
+        Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
+        Vdouble* larray_i_c = &(*larray_i)[c];
+        VVdouble* dpxy_node_c = &(*dpxy_node)[c];
+        dLic = 0;
+        for (size_t x = 0; x < nbStates_; x++)
         {
-          dLicx += (*dpxy_node_c_x)[y] * (*likelihoods_father_node_i_c)[y];
+          Vdouble* dpxy_node_c_x = &(*dpxy_node_c)[x];
+          dLicx = 0;
+          for (size_t y = 0; y < nbStates_; y++)
+          {
+            dLicx += (*dpxy_node_c_x)[y] * (*likelihoods_father_node_i_c)[y];
+          }
+          dLicx *= (*larray_i_c)[x];
+          dLic += dLicx;
         }
-        dLicx *= (*larray_i_c)[x];
-        dLic += dLicx;
+        dLi += p[c] * dLic;
       }
-      dLi += rateDistribution_->getProbability(c) * dLic;
-    }
 
-    (*dLikelihoods_node)[i] = dLi / (*rootLikelihoodsSR)[i];
-    // cout << dLi << "\t" << (*rootLikelihoodsSR)[i] << endl;
-  }
+      (*dLikelihoods_node)[i] = dLi / (*rootLikelihoodsSR)[i];
+    }
+  });
 }
 
 /******************************************************************************/
@@ -381,38 +633,42 @@ void DRHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* node
   VVVdouble* likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
   Vdouble* d2Likelihoods_node = &likelihoodData_->getD2LikelihoodArray(node->getId());
   VVVdouble* d2pxy_node = &d2pxy_[node->getId()];
-  VVVdouble larray;
+  VVVdouble& larray = fatherLikelihoods_;
   computeLikelihoodAtNode_(father, larray, node);
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  Vdouble p = rateDistribution_->getProbabilities();
 
-  double d2Li, d2Lic, d2Licx;
-
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  runSiteLoop_([&](size_t firstSite, size_t lastSite)
   {
-    VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    d2Li = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
+    double d2Li, d2Lic, d2Licx;
+
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
-      VVdouble* d2pxy_node_c = &(*d2pxy_node)[c];
-      d2Lic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
+      VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
+      VVdouble* larray_i = &larray[i];
+      d2Li = 0;
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* d2pxy_node_c_x = &(*d2pxy_node_c)[x];
-        d2Licx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
+        Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
+        Vdouble* larray_i_c = &(*larray_i)[c];
+        VVdouble* d2pxy_node_c = &(*d2pxy_node)[c];
+        d2Lic = 0;
+        for (size_t x = 0; x < nbStates_; x++)
         {
-          d2Licx += (*d2pxy_node_c_x)[y] * (*likelihoods_father_node_i_c)[y];
+          Vdouble* d2pxy_node_c_x = &(*d2pxy_node_c)[x];
+          d2Licx = 0;
+          for (size_t y = 0; y < nbStates_; y++)
+          {
+            d2Licx += (*d2pxy_node_c_x)[y] * (*likelihoods_father_node_i_c)[y];
+          }
+          d2Licx *= (*larray_i_c)[x];
+          d2Lic += d2Licx;
         }
-        d2Licx *= (*larray_i_c)[x];
-        d2Lic += d2Licx;
+        d2Li += p[c] * d2Lic;
       }
-      d2Li += rateDistribution_->getProbability(c) * d2Lic;
+      (*d2Likelihoods_node)[i] = d2Li / (*rootLikelihoodsSR)[i];
     }
-    (*d2Likelihoods_node)[i] = d2Li / (*rootLikelihoodsSR)[i];
-  }
+  });
 }
 
 /******************************************************************************/
@@ -458,6 +714,216 @@ double DRHomogeneousTreeLikelihood::getSecondOrderDerivative(const std::string&
   return -d2;
 }
 
+/******************************************************************************
+*                       Branch by branch optimization                        *
+******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::optimizeBranchLengthsOneByOne(const std::vector<std::string>& names, double tolerance, unsigned int maxNbSteps)
+{
+  vector<bool> selected(nbNodes_, false);
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    if (names[i].substr(0, 5) == "BrLen" && hasParameter(names[i]))
+      selected[TextTools::to<size_t>(names[i].substr(5))] = true;
+  }
+
+  map<int, size_t> brIndex;
+  vector<double> lengths(nbNodes_);
+  for (size_t i = 0; i < nbNodes_; i++)
+  {
+    brIndex[nodes_[i]->getId()] = i;
+    lengths[i] = nodes_[i]->getDistanceToFather();
+  }
+
+  optimizeBranchLengthsOneByOne_(tree_->getRootNode(), brIndex, selected, tolerance, maxNbSteps, lengths);
+
+  // Set the new lengths, this recomputes all arrays once:
+  ParameterList pl;
+  for (size_t i = 0; i < nbNodes_; i++)
+  {
+    if (selected[i])
+    {
+      string name = "BrLen" + TextTools::toString(i);
+      pl.addParameter(getParameter(name));
+      pl.setParameterValue(name, lengths[i]);
+    }
+  }
+  matchParametersValues(pl);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::optimizeBranchLengthsOneByOne_(const Node* node, const map<int, size_t>& brIndex, const vector<bool>& selected, double tolerance, unsigned int maxNbSteps, vector<double>& lengths)
+{
+  for (size_t n = 0; n < node->getNumberOfSons(); n++)
+  {
+    const Node* son = node->getSon(n);
+    size_t i = brIndex.at(son->getId());
+    // The arrays at both ends of the branch are up to date here: the
+    // subtree of the son has not been changed yet, and the other ones
+    // have been updated when leaving them.
+    if (selected[i])
+      lengths[i] = optimizeBranchLength_(son, tolerance, maxNbSteps);
+
+    if (son->getNumberOfSons() > 0)
+    {
+      computeSubtreeLikelihoodPrefixAtNode_(son);
+      optimizeBranchLengthsOneByOne_(son, brIndex, selected, tolerance, maxNbSteps, lengths);
+      computeSubtreeLikelihoodPostfixAtNode_(son);
+    }
+  }
+}
+
+/******************************************************************************/
+
+double DRHomogeneousTreeLikelihood::optimizeBranchLength_(const Node* node, double tolerance, unsigned int maxNbSteps)
+{
+  const Node* father = node->getFather();
+  const VVVdouble* likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  VVVdouble& larray = fatherLikelihoods_;
+  computeLikelihoodAtNode_(father, larray, node);
+
+  const vector<unsigned int>* w = &likelihoodData_->getWeights();
+  Vdouble p = rateDistribution_->getProbabilities();
+  VVVdouble* pxy_node = &pxy_[node->getId()];
+  VVVdouble dpxy(nbClasses_, VVdouble(nbStates_, Vdouble(nbStates_)));
+  VVVdouble d2pxy(nbClasses_, VVdouble(nbStates_, Vdouble(nbStates_)));
+  Vdouble li(nbDistinctSites_), dli(nbDistinctSites_), d2li(nbDistinctSites_);
+
+  // Log likelihood of the tree and its derivatives for a length of the
+  // branch, the other branches being fixed.
+  auto evaluate = [&](double t, double& d1, double& d2)
+  {
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      double rc = rateDistribution_->getCategory(c);
+      const Matrix<double>& Q = model_->getPij_t(t * rc);
+      for (size_t x = 0; x < nbStates_; x++)
+        for (size_t y = 0; y < nbStates_; y++)
+          (*pxy_node)[c][x][y] = Q(x, y);
+      const Matrix<double>& dQ = model_->getdPij_dt(t * rc);
+      for (size_t x = 0; x < nbStates_; x++)
+        for (size_t y = 0; y < nbStates_; y++)
+          dpxy[c][x][y] = rc * dQ(x, y);
+      const Matrix<double>& d2Q = model_->getd2Pij_dt2(t * rc);
+      for (size_t x = 0; x < nbStates_; x++)
+        for (size_t y = 0; y < nbStates_; y++)
+          d2pxy[c][x][y] = rc * rc * d2Q(x, y);
+    }
+
+    runSiteLoop_([&](size_t firstSite, size_t lastSite)
+    {
+      for (size_t i = firstSite; i < lastSite; i++)
+      {
+        const VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
+        const VVdouble* larray_i = &larray[i];
+        double l = 0, dl = 0, d2l = 0;
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          const Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
+          const Vdouble* larray_i_c = &(*larray_i)[c];
+          double lc = 0, dlc = 0, d2lc = 0;
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            const Vdouble* pxy_node_c_x = &(*pxy_node)[c][x];
+            const Vdouble* dpxy_c_x = &dpxy[c][x];
+            const Vdouble* d2pxy_c_x = &d2pxy[c][x];
+            double lcx = 0, dlcx = 0, d2lcx = 0;
+            for (size_t y = 0; y < nbStates_; y++)
+            {
+              double ly = (*likelihoods_father_node_i_c)[y];
+              lcx += (*pxy_node_c_x)[y] * ly;
+              dlcx += (*dpxy_c_x)[y] * ly;
+              d2lcx += (*d2pxy_c_x)[y] * ly;
+            }
+            lc += (*larray_i_c)[x] * lcx;
+            dlc += (*larray_i_c)[x] * dlcx;
+            d2lc += (*larray_i_c)[x] * d2lcx;
+          }
+          l += p[c] * lc;
+          dl += p[c] * dlc;
+          d2l += p[c] * d2lc;
+        }
+        li[i] = l;
+        dli[i] = dl / l;
+        d2li[i] = d2l / l;
+      }
+    });
+
+    double ll = 0;
+    d1 = 0;
+    d2 = 0;
+    for (size_t i = 0; i < nbDistinctSites_; i++)
+    {
+      ll += (*w)[i] * log(li[i]);
+      d1 += (*w)[i] * dli[i];
+      d2 += (*w)[i] * (d2li[i] - dli[i] * dli[i]);
+    }
+    return ll;
+  };
+
+  double t = node->getDistanceToFather();
+  double d1, d2;
+  double ll = evaluate(t, d1, d2);
+  for (unsigned int k = 0; k < maxNbSteps; k++)
+  {
+    // Newton step toward a maximum, or a move following the slope where
+    // the log likelihood is not concave:
+    double tNew;
+    if (d2 < 0)
+      tNew = t - d1 / d2;
+    else
+      tNew = d1 > 0 ? 2. * t : t / 2.;
+    tNew = max(minimumBrLen_, min(maximumBrLen_, tNew));
+
+    double newD1, newD2;
+    double newLl = evaluate(tNew, newD1, newD2);
+    // Felsenstein-Churchill correction:
+    for (unsigned int count = 0; (newLl < ll || std::isnan(newLl)) && count < 10; count++)
+    {
+      tNew = (t + tNew) / 2.;
+      newLl = evaluate(tNew, newD1, newD2);
+    }
+    if (newLl < ll || std::isnan(newLl))
+      break;
+
+    double move = std::abs(tNew - t);
+    t = tNew;
+    ll = newLl;
+    d1 = newD1;
+    d2 = newD2;
+    if (move < tolerance)
+      break;
+  }
+
+  // Leave the transition probabilities at the retained length:
+  evaluate(t, d1, d2);
+  return t;
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfixAtNode_(const Node* node)
+{
+  VVVdouble* _likelihoods_father_node = &likelihoodData_->getLikelihoodArray(node->getFatherId(), node->getId());
+  map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
+  size_t nbSons = node->getNumberOfSons();
+
+  vector<const VVVdouble*> iLik(nbSons);
+  vector<const VVVdouble*> tProb(nbSons);
+  for (size_t n = 0; n < nbSons; n++)
+  {
+    const Node* son = node->getSon(n);
+    tProb[n] = &pxy_[son->getId()];
+    iLik[n] = &(*_likelihoods_node)[son->getId()];
+  }
+  resetLikelihoodArray(*_likelihoods_father_node);
+  runSiteLoop_([&](size_t firstSite, size_t lastSite)
+  {
+    computeLikelihoodFromArraysForSites(iLik, tProb, *_likelihoods_father_node, nbSons, firstSite, lastSite, nbClasses_, nbStates_);
+  });
+}
+
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::resetLikelihoodArrays(const Node* node)
@@ -467,7 +933,7 @@ void DRHomogeneousTreeLikelihood::resetLikelihoodArrays(const Node* node)
     const Node* subNode = node->getSon(n);
     resetLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), subNode->getId()));
   }
-  if (node->hasFather())
+  if (node->hasFather() && memoryBudget_ == 0)
   {
     const Node* father = node->getFather();
     resetLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), father->getId()));
@@ -478,15 +944,292 @@ void DRHomogeneousTreeLikelihood::resetLikelihoodArrays(const Node* node)
 
 void DRHomogeneousTreeLikelihood::computeTreeLikelihood()
 {
-  computeSubtreeLikelihoodPostfix(tree_->getRootNode());
-  computeSubtreeLikelihoodPrefix(tree_->getRootNode());
+  // Arrays are allocated on the first computation:
+  likelihoodData_->allocateArrays(memoryBudget_ == 0);
+  if (!likelihoodOperationsUpToDate_)
+  {
+    updateUpperCheckpoints_();
+    likelihoodOperations_.clear();
+    buildPostfixOperations_(tree_->getRootNode());
+    // With a memory budget, upper arrays are computed when needed:
+    if (memoryBudget_ == 0)
+      buildPrefixOperations_(tree_->getRootNode());
+    likelihoodOperationsUpToDate_ = true;
+  }
+  runLikelihoodOperations_();
+  if (memoryBudget_ > 0)
+    invalidateUpperLikelihoodArrays_();
   computeRootLikelihood();
 }
 
 /******************************************************************************/
 
+void DRHomogeneousTreeLikelihood::updateUpperCheckpoints_()
+{
+  vector<int> ids = tree_->getNodesId();
+  size_t size = static_cast<size_t>(*max_element(ids.begin(), ids.end())) + 1;
+  upperCheckpoints_.assign(size, memoryBudget_ == 0);
+  upperUpToDate_.assign(size, memoryBudget_ == 0);
+  upperTransients_.clear();
+  checkpointInterval_ = 1;
+  maxNbUpperTransients_ = 0;
+
+  if (memoryBudget_ > 0)
+  {
+    // Depth of the inner nodes, the root excepted:
+    vector<size_t> depths(size, 0);
+    vector<size_t> nbInnerNodesAtDepth;
+    vector<const Node*> stack(1, tree_->getRootNode());
+    while (!stack.empty())
+    {
+      const Node* node = stack.back();
+      stack.pop_back();
+      size_t depth = depths[static_cast<size_t>(node->getId())];
+      if (node->hasFather() && !node->isLeaf())
+      {
+        if (nbInnerNodesAtDepth.size() <= depth)
+          nbInnerNodesAtDepth.resize(depth + 1, 0);
+        nbInnerNodesAtDepth[depth]++;
+      }
+      for (size_t n = 0; n < node->getNumberOfSons(); n++)
+      {
+        depths[static_cast<size_t>(node->getSon(n)->getId())] = depth + 1;
+        stack.push_back(node->getSon(n));
+      }
+    }
+    size_t maxDepth = nbInnerNodesAtDepth.size();
+
+    // Number of upper arrays fitting in the budget, once the lower ones,
+    // the root one and the father one are stored:
+    size_t arrayBytes = nbDistinctSites_ * (sizeof(VVdouble) + nbClasses_ * (sizeof(Vdouble) + nbStates_ * sizeof(double)));
+    size_t lowerBytes = (nbNodes_ + 2) * arrayBytes;
+    size_t nbUpper = (memoryBudget_ > lowerBytes && arrayBytes > 0) ? (memoryBudget_ - lowerBytes) / arrayBytes : 0;
+
+    // The smallest interval such that the checkpoints and the transients fit:
+    checkpointInterval_ = maxDepth + 1;
+    maxNbUpperTransients_ = max(static_cast<size_t>(2), nbUpper);
+    for (size_t k = 1; k <= maxDepth; k++)
+    {
+      size_t nbCheckpoints = 0;
+      for (size_t d = k; d < maxDepth; d += k)
+        nbCheckpoints += nbInnerNodesAtDepth[d];
+      if (nbCheckpoints + k + 1 <= nbUpper)
+      {
+        checkpointInterval_ = k;
+        maxNbUpperTransients_ = k + 1;
+        break;
+      }
+    }
+    for (size_t k = 0; k < nbNodes_; k++)
+    {
+      const Node* node = nodes_[k];
+      size_t depth = depths[static_cast<size_t>(node->getId())];
+      if (!node->isLeaf() && depth % checkpointInterval_ == 0)
+        upperCheckpoints_[static_cast<size_t>(node->getId())] = true;
+    }
+  }
+
+  for (size_t k = 0; k < nbNodes_; k++)
+  {
+    const Node* node = nodes_[k];
+    VVVdouble* array = &likelihoodData_->getLikelihoodArray(node->getId(), node->getFatherId());
+    if (upperCheckpoints_[static_cast<size_t>(node->getId())])
+    {
+      if (array->size() != nbDistinctSites_)
+        array->assign(nbDistinctSites_, VVdouble(nbClasses_, Vdouble(nbStates_, 1.)));
+    }
+    else
+      VVVdouble().swap(*array);
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::invalidateUpperLikelihoodArrays_() const
+{
+  while (!upperTransients_.empty())
+  {
+    releaseUpperLikelihoodArray_(upperTransients_.front());
+    upperTransients_.pop_front();
+  }
+  upperUpToDate_.assign(upperUpToDate_.size(), false);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::releaseUpperLikelihoodArray_(int nodeId) const
+{
+  // Arrays which became checkpoints since they were computed are kept.
+  if (upperCheckpoints_[static_cast<size_t>(nodeId)])
+    return;
+  const Node* node = likelihoodData_->getNodeData(nodeId).getNode();
+  VVVdouble().swap(likelihoodData_->getLikelihoodArray(nodeId, node->getFatherId()));
+  upperUpToDate_[static_cast<size_t>(nodeId)] = false;
+}
+
+/******************************************************************************/
+
+const VVVdouble& DRHomogeneousTreeLikelihood::getUpperLikelihoodArray_(const Node* node) const
+{
+  const VVVdouble& array = likelihoodData_->getLikelihoodArray(node->getId(), node->getFatherId());
+  if (memoryBudget_ > 0)
+  {
+    lock_guard<recursive_mutex> lock(upperMutex_);
+    if (!upperUpToDate_[static_cast<size_t>(node->getId())])
+      computeSubtreeLikelihoodPrefixAtNode_(node);
+  }
+  return array;
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::buildPostfixOperations_(const Node* node)
+{
+  if (node->getNumberOfSons() == 0)
+    return;
+
+  for (size_t n = 0; n < node->getNumberOfSons(); n++)
+  {
+    likelihoodOperations_.push_back(LikelihoodOperation_(LikelihoodOperation_::RESET, &likelihoodData_->getLikelihoodArray(node->getId(), node->getSon(n)->getId())));
+  }
+  if (node->hasFather() && memoryBudget_ == 0)
+    likelihoodOperations_.push_back(LikelihoodOperation_(LikelihoodOperation_::RESET, &likelihoodData_->getLikelihoodArray(node->getId(), node->getFatherId())));
+
+  map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
+  for (size_t l = 0; l < node->getNumberOfSons(); l++)
+  {
+    const Node* son = node->getSon(l);
+    VVVdouble* _likelihoods_node_son = &(*_likelihoods_node)[son->getId()];
+    if (son->isLeaf())
+    {
+      LikelihoodOperation_ op(LikelihoodOperation_::COPY_LEAF, _likelihoods_node_son);
+      op.leafCodes = &likelihoodData_->getLeafStateCodes(son->getId());
+      likelihoodOperations_.push_back(op);
+    }
+    else
+    {
+      buildPostfixOperations_(son);
+      map<int, VVVdouble>* _likelihoods_son = &likelihoodData_->getLikelihoodArrays(son->getId());
+      LikelihoodOperation_ op(LikelihoodOperation_::COMBINE, _likelihoods_node_son);
+      for (size_t n = 0; n < son->getNumberOfSons(); n++)
+      {
+        int sonSonId = son->getSon(n)->getId();
+        op.tProb.push_back(&pxy_[sonSonId]);
+        op.iLik.push_back(&(*_likelihoods_son)[sonSonId]);
+      }
+      likelihoodOperations_.push_back(op);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::buildPrefixOperations_(const Node* node)
+{
+  if (node->hasFather())
+  {
+    const Node* father = node->getFather();
+    map<int, VVVdouble>* _likelihoods_father = &likelihoodData_->getLikelihoodArrays(father->getId());
+    VVVdouble* _likelihoods_node_father = &likelihoodData_->getLikelihoodArrays(node->getId())[father->getId()];
+    if (node->isLeaf())
+      likelihoodOperations_.push_back(LikelihoodOperation_(LikelihoodOperation_::RESET, _likelihoods_node_father));
+
+    if (father->isLeaf())
+    {
+      // If the tree is rooted by a leaf
+      LikelihoodOperation_ op(LikelihoodOperation_::COPY_LEAF, _likelihoods_node_father);
+      op.leafCodes = &likelihoodData_->getLeafStateCodes(father->getId());
+      likelihoodOperations_.push_back(op);
+    }
+    else
+    {
+      LikelihoodOperation_ op(LikelihoodOperation_::COMBINE, _likelihoods_node_father);
+      for (size_t n = 0; n < father->getNumberOfSons(); n++)
+      {
+        const Node* son = father->getSon(n);
+        if (son->getId() != node->getId())
+        {
+          op.tProb.push_back(&pxy_[son->getId()]);
+          op.iLik.push_back(&(*_likelihoods_father)[son->getId()]);
+        }
+      }
+      if (father->hasFather())
+      {
+        op.iLikR = &(*_likelihoods_father)[father->getFatherId()];
+        op.tProbR = &pxy_[father->getId()];
+      }
+      likelihoodOperations_.push_back(op);
+    }
+
+    if (!father->hasFather())
+      likelihoodOperations_.push_back(LikelihoodOperation_(LikelihoodOperation_::ROOT_FREQUENCIES, _likelihoods_node_father));
+  }
+
+  for (size_t i = 0; i < node->getNumberOfSons(); i++)
+  {
+    buildPrefixOperations_(node->getSon(i));
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::runLikelihoodOperations_()
+{
+  for (size_t k = 0; k < likelihoodOperations_.size(); k++)
+  {
+    const LikelihoodOperation_& op = likelihoodOperations_[k];
+    switch (op.type)
+    {
+    case LikelihoodOperation_::RESET:
+      resetLikelihoodArray(*op.result);
+      break;
+    case LikelihoodOperation_::COPY_LEAF:
+      for (size_t i = 0; i < nbDistinctSites_; i++)
+      {
+        const Vdouble* leaf_i = &likelihoodData_->getLeafStateProfiles()[(*op.leafCodes)[i]];
+        VVdouble* result_i = &(*op.result)[i];
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          Vdouble* result_i_c = &(*result_i)[c];
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            (*result_i_c)[x] = (*leaf_i)[x];
+          }
+        }
+      }
+      break;
+    case LikelihoodOperation_::COMBINE:
+      runSiteLoop_([&](size_t firstSite, size_t lastSite)
+      {
+        if (op.iLikR)
+          computeLikelihoodFromArraysForSites(op.iLik, op.tProb, op.iLikR, op.tProbR, *op.result, op.iLik.size(), firstSite, lastSite, nbClasses_, nbStates_);
+        else
+          computeLikelihoodFromArraysForSites(op.iLik, op.tProb, *op.result, op.iLik.size(), firstSite, lastSite, nbClasses_, nbStates_);
+      });
+      break;
+    case LikelihoodOperation_::ROOT_FREQUENCIES:
+      for (size_t i = 0; i < nbDistinctSites_; i++)
+      {
+        VVdouble* result_i = &(*op.result)[i];
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          Vdouble* result_i_c = &(*result_i)[c];
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            (*result_i_c)[x] *= rootFreqs_[x];
+          }
+        }
+      }
+      break;
+    }
+  }
+}
+
+/******************************************************************************/
+
 void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* node)
 {
+  likelihoodData_->allocateArrays(memoryBudget_ == 0);
 //  if(node->isLeaf()) return;
 // cout << node->getId() << "\t" << (node->hasName()?node->getName():"") << endl;
   if (node->getNumberOfSons() == 0)
@@ -506,11 +1249,12 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
 
     if (son->isLeaf())
     {
-      VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(son->getId());
+      const vector<unsigned int>* _codes_leaf = &likelihoodData_->getLeafStateCodes(son->getId());
+      const VVdouble* leafProfiles = &likelihoodData_->getLeafStateProfiles();
       for (size_t i = 0; i < nbDistinctSites_; i++)
       {
         // For each site in the sequence,
-        Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
+        const Vdouble* _likelihoods_leaf_i = &(*leafProfiles)[(*_codes_leaf)[i]];
         VVdouble* _likelihoods_node_son_i = &(*_likelihoods_node_son)[i];
         for (size_t c = 0; c < nbClasses_; c++)
         {
@@ -538,7 +1282,10 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
         tProb[n] = &pxy_[sonSon->getId()];
         iLik[n] = &(*_likelihoods_son)[sonSon->getId()];
       }
-      computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_son, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+      runSiteLoop_([&](size_t firstSite, size_t lastSite)
+      {
+        computeLikelihoodFromArraysForSites(iLik, tProb, *_likelihoods_node_son, nbSons, firstSite, lastSite, nbClasses_, nbStates_);
+      });
     }
   }
 }
@@ -547,6 +1294,7 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
 
 void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* node)
 {
+  likelihoodData_->allocateArrays(memoryBudget_ == 0);
   if (!node->hasFather())
   {
     // 'node' is the root of the tree.
@@ -560,96 +1308,127 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
   }
   else
   {
-    const Node* father = node->getFather();
-    map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
-    map<int, VVVdouble>* _likelihoods_father = &likelihoodData_->getLikelihoodArrays(father->getId());
-    VVVdouble* _likelihoods_node_father = &(*_likelihoods_node)[father->getId()];
-    if (node->isLeaf())
+    computeSubtreeLikelihoodPrefixAtNode_(node);
+
+    // Call the method on each son node:
+    size_t nbNodeSons = node->getNumberOfSons();
+    for (size_t i = 0; i < nbNodeSons; i++)
     {
-      resetLikelihoodArray(*_likelihoods_node_father);
+      computeSubtreeLikelihoodPrefix(node->getSon(i)); // Recursive method.
     }
+  }
+}
 
-    if (father->isLeaf())
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefixAtNode_(const Node* node) const
+{
+  const Node* father = node->getFather();
+  // This may compute the father array first, with a memory budget:
+  const VVVdouble* _likelihoods_father_fatherFather = father->hasFather() ? &getUpperLikelihoodArray_(father) : 0;
+  map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
+  map<int, VVVdouble>* _likelihoods_father = &likelihoodData_->getLikelihoodArrays(father->getId());
+  VVVdouble* _likelihoods_node_father = &(*_likelihoods_node)[father->getId()];
+  if (_likelihoods_node_father->size() != nbDistinctSites_)
+    _likelihoods_node_father->assign(nbDistinctSites_, VVdouble(nbClasses_, Vdouble(nbStates_)));
+  resetLikelihoodArray(*_likelihoods_node_father);
+
+  if (father->isLeaf())
+  {
+    // If the tree is rooted by a leaf
+    const vector<unsigned int>* _codes_leaf = &likelihoodData_->getLeafStateCodes(father->getId());
+    const VVdouble* leafProfiles = &likelihoodData_->getLeafStateProfiles();
+    for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      // If the tree is rooted by a leaf
-      VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(father->getId());
-      for (size_t i = 0; i < nbDistinctSites_; i++)
+      // For each site in the sequence,
+      const Vdouble* _likelihoods_leaf_i = &(*leafProfiles)[(*_codes_leaf)[i]];
+      VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        // For each site in the sequence,
-        Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
-        VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        // For each rate classe,
+        Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
+        for (size_t x = 0; x < nbStates_; x++)
         {
-          // For each rate classe,
-          Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            // For each initial state,
-            (*_likelihoods_node_father_i_c)[x] = (*_likelihoods_leaf_i)[x];
-          }
+          // For each initial state,
+          (*_likelihoods_node_father_i_c)[x] = (*_likelihoods_leaf_i)[x];
         }
       }
     }
-    else
+  }
+  else
+  {
+    vector<const Node*> nodes;
+    // Add brothers:
+    size_t nbFatherSons = father->getNumberOfSons();
+    for (size_t n = 0; n < nbFatherSons; n++)
     {
-      vector<const Node*> nodes;
-      // Add brothers:
-      size_t nbFatherSons = father->getNumberOfSons();
-      for (size_t n = 0; n < nbFatherSons; n++)
-      {
-        const Node* son = father->getSon(n);
-        if (son->getId() != node->getId())
-          nodes.push_back(son);  // This is a real brother, not current node!
-      }
-      // Now the real stuff... We've got to compute the likelihoods for the
-      // subtree defined by node 'father'.
-      // This is the same as postfix method, but with different subnodes.
+      const Node* son = father->getSon(n);
+      if (son->getId() != node->getId())
+        nodes.push_back(son);  // This is a real brother, not current node!
+    }
+    // Now the real stuff... We've got to compute the likelihoods for the
+    // subtree defined by node 'father'.
+    // This is the same as postfix method, but with different subnodes.
 
-      size_t nbSons = nodes.size(); // In case of a bifurcating tree, this is equal to 1, excepted for the root.
+    size_t nbSons = nodes.size(); // In case of a bifurcating tree, this is equal to 1, excepted for the root.
 
-      vector<const VVVdouble*> iLik(nbSons);
-      vector<const VVVdouble*> tProb(nbSons);
-      for (size_t n = 0; n < nbSons; n++)
-      {
-        const Node* fatherSon = nodes[n];
-        tProb[n] = &pxy_[fatherSon->getId()];
-        iLik[n] = &(*_likelihoods_father)[fatherSon->getId()];
-      }
+    vector<const VVVdouble*> iLik(nbSons);
+    vector<const VVVdouble*> tProb(nbSons);
+    for (size_t n = 0; n < nbSons; n++)
+    {
+      const Node* fatherSon = nodes[n];
+      tProb[n] = &pxy_[fatherSon->getId()];
+      iLik[n] = &(*_likelihoods_father)[fatherSon->getId()];
+    }
 
-      if (father->hasFather())
+    if (father->hasFather())
+    {
+      const VVVdouble* tProbFather = &pxy_[father->getId()];
+      runSiteLoop_([&](size_t firstSite, size_t lastSite)
       {
-        const Node* fatherFather = father->getFather();
-        computeLikelihoodFromArrays(iLik, tProb, &(*_likelihoods_father)[fatherFather->getId()], &pxy_[father->getId()], *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
-      }
-      else
+        computeLikelihoodFromArraysForSites(iLik, tProb, _likelihoods_father_fatherFather, tProbFather, *_likelihoods_node_father, nbSons, firstSite, lastSite, nbClasses_, nbStates_);
+      });
+    }
+    else
+    {
+      runSiteLoop_([&](size_t firstSite, size_t lastSite)
       {
-        computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
-      }
+        computeLikelihoodFromArraysForSites(iLik, tProb, *_likelihoods_node_father, nbSons, firstSite, lastSite, nbClasses_, nbStates_);
+      });
     }
+  }
 
-    if (!father->hasFather())
+  if (!father->hasFather())
+  {
+    // We have to account for the root frequencies:
+    for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      // We have to account for the root frequencies:
-      for (size_t i = 0; i < nbDistinctSites_; i++)
+      VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
+        for (size_t x = 0; x < nbStates_; x++)
         {
-          Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            (*_likelihoods_node_father_i_c)[x] *= rootFreqs_[x];
-          }
+          (*_likelihoods_node_father_i_c)[x] *= rootFreqs_[x];
         }
       }
     }
+  }
 
-    // Call the method on each son node:
-    size_t nbNodeSons = node->getNumberOfSons();
-    for (size_t i = 0; i < nbNodeSons; i++)
+  if (memoryBudget_ > 0)
+  {
+    size_t id = static_cast<size_t>(node->getId());
+    if (!upperCheckpoints_[id] && !upperUpToDate_[id])
     {
-      computeSubtreeLikelihoodPrefix(node->getSon(i)); // Recursive method.
+      upperUpToDate_[id] = true;
+      upperTransients_.push_back(node->getId());
+      while (upperTransients_.size() > maxNbUpperTransients_)
+      {
+        releaseUpperLikelihoodArray_(upperTransients_.front());
+        upperTransients_.pop_front();
+      }
     }
+    upperUpToDate_[id] = true;
   }
 }
 
@@ -657,16 +1436,18 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
 
 void DRHomogeneousTreeLikelihood::computeRootLikelihood()
 {
+  likelihoodData_->allocateArrays(memoryBudget_ == 0);
   const Node* root = tree_->getRootNode();
   VVVdouble* rootLikelihoods = &likelihoodData_->getRootLikelihoodArray();
   // Set all likelihoods to 1 for a start:
   if (root->isLeaf())
   {
-    VVdouble* leavesLikelihoods_root = &likelihoodData_->getLeafLikelihoods(root->getId());
+    const vector<unsigned int>* leavesCodes_root = &likelihoodData_->getLeafStateCodes(root->getId());
+    const VVdouble* leafProfiles = &likelihoodData_->getLeafStateProfiles();
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
       VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
-      Vdouble* leavesLikelihoods_root_i = &(*leavesLikelihoods_root)[i];
+      const Vdouble* leavesLikelihoods_root_i = &(*leafProfiles)[(*leavesCodes_root)[i]];
       for (size_t c = 0; c < nbClasses_; c++)
       {
         Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
@@ -692,35 +1473,39 @@ void DRHomogeneousTreeLikelihood::computeRootLikelihood()
     tProb[n] = &pxy_[son->getId()];
     iLik[n] = &(*likelihoods_root)[son->getId()];
   }
-  computeLikelihoodFromArrays(iLik, tProb, *rootLikelihoods, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
-
   Vdouble p = rateDistribution_->getProbabilities();
   VVdouble* rootLikelihoodsS  = &likelihoodData_->getRootSiteLikelihoodArray();
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+
+  runSiteLoop_([&](size_t firstSite, size_t lastSite)
   {
-    // For each site in the sequence,
-    VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
-    Vdouble* rootLikelihoodsS_i = &(*rootLikelihoodsS)[i];
-    (*rootLikelihoodsSR)[i] = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
+    computeLikelihoodFromArraysForSites(iLik, tProb, *rootLikelihoods, nbNodes, firstSite, lastSite, nbClasses_, nbStates_);
+
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      // For each rate classe,
-      Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
-      double* rootLikelihoodsS_i_c = &(*rootLikelihoodsS_i)[c];
-      (*rootLikelihoodsS_i_c) = 0;
-      for (size_t x = 0; x < nbStates_; x++)
+      // For each site in the sequence,
+      VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
+      Vdouble* rootLikelihoodsS_i = &(*rootLikelihoodsS)[i];
+      (*rootLikelihoodsSR)[i] = 0;
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        // For each initial state,
-        (*rootLikelihoodsS_i_c) += rootFreqs_[x] * (*rootLikelihoods_i_c)[x];
+        // For each rate classe,
+        Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
+        double* rootLikelihoodsS_i_c = &(*rootLikelihoodsS_i)[c];
+        (*rootLikelihoodsS_i_c) = 0;
+        for (size_t x = 0; x < nbStates_; x++)
+        {
+          // For each initial state,
+          (*rootLikelihoodsS_i_c) += rootFreqs_[x] * (*rootLikelihoods_i_c)[x];
+        }
+        (*rootLikelihoodsSR)[i] += p[c] * (*rootLikelihoodsS_i_c);
       }
-      (*rootLikelihoodsSR)[i] += p[c] * (*rootLikelihoodsS_i_c);
-    }
 
-    // Final checking (for numerical errors):
-    if ((*rootLikelihoodsSR)[i] < 0)
-      (*rootLikelihoodsSR)[i] = 0.;
-  }
+      // Final checking (for numerical errors):
+      if ((*rootLikelihoodsSR)[i] < 0)
+        (*rootLikelihoodsSR)[i] = 0.;
+    }
+  });
 }
 
 /******************************************************************************/
@@ -735,11 +1520,12 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVV
   // Initialize likelihood array:
   if (node->isLeaf())
   {
-    VVdouble* leavesLikelihoods_node = &likelihoodData_->getLeafLikelihoods(nodeId);
+    const vector<unsigned int>* leavesCodes_node = &likelihoodData_->getLeafStateCodes(nodeId);
+    const VVdouble* leafProfiles = &likelihoodData_->getLeafStateProfiles();
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
       VVdouble* likelihoodArray_i = &likelihoodArray[i];
-      Vdouble* leavesLikelihoods_node_i = &(*leavesLikelihoods_node)[i];
+      const Vdouble* leavesLikelihoods_node_i = &(*leafProfiles)[(*leavesCodes_node)[i]];
       likelihoodArray_i->resize(nbClasses_);
       for (size_t c = 0; c < nbClasses_; c++)
       {
@@ -796,12 +1582,19 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVV
 
   if (node->hasFather())
   {
-    const Node* father = node->getFather();
-    computeLikelihoodFromArrays(iLik, tProb, &(*likelihoods_node)[father->getId()], &pxy_[nodeId], likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    const VVVdouble* likelihoods_node_father = &getUpperLikelihoodArray_(node);
+    const VVVdouble* tProbNode = &pxy_[nodeId];
+    runSiteLoop_([&](size_t firstSite, size_t lastSite)
+    {
+      computeLikelihoodFromArraysForSites(iLik, tProb, likelihoods_node_father, tProbNode, likelihoodArray, nbNodes, firstSite, lastSite, nbClasses_, nbStates_);
+    });
   }
   else
   {
-    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    runSiteLoop_([&](size_t firstSite, size_t lastSite)
+    {
+      computeLikelihoodFromArraysForSites(iLik, tProb, likelihoodArray, nbNodes, firstSite, lastSite, nbClasses_, nbStates_);
+    });
 
     // We have to account for the equilibrium frequencies:
     for (size_t i = 0; i < nbDistinctSites_; i++)
@@ -834,12 +1627,27 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
   if (reset)
     resetLikelihoodArray(oLik);
 
+  computeLikelihoodFromArraysForSites(iLik, tProb, oLik, nbNodes, 0, nbDistinctSites, nbClasses, nbStates);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodFromArraysForSites(
+  const vector<const VVVdouble*>& iLik,
+  const vector<const VVVdouble*>& tProb,
+  VVVdouble& oLik,
+  size_t nbNodes,
+  size_t firstSite,
+  size_t lastSite,
+  size_t nbClasses,
+  size_t nbStates)
+{
   for (size_t n = 0; n < nbNodes; n++)
   {
     const VVVdouble* pxy_n = tProb[n];
     const VVVdouble* iLik_n = iLik[n];
 
-    for (size_t i = 0; i < nbDistinctSites; i++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
       // For each site in the sequence,
       const VVdouble* iLik_n_i = &(*iLik_n)[i];
@@ -885,12 +1693,29 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
   if (reset)
     resetLikelihoodArray(oLik);
 
+  computeLikelihoodFromArraysForSites(iLik, tProb, iLikR, tProbR, oLik, nbNodes, 0, nbDistinctSites, nbClasses, nbStates);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodFromArraysForSites(
+  const vector<const VVVdouble*>& iLik,
+  const vector<const VVVdouble*>& tProb,
+  const VVVdouble* iLikR,
+  const VVVdouble* tProbR,
+  VVVdouble& oLik,
+  size_t nbNodes,
+  size_t firstSite,
+  size_t lastSite,
+  size_t nbClasses,
+  size_t nbStates)
+{
   for (size_t n = 0; n < nbNodes; n++)
   {
     const VVVdouble* pxy_n = tProb[n];
     const VVVdouble* iLik_n = iLik[n];
 
-    for (size_t i = 0; i < nbDistinctSites; i++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
       // For each site in the sequence,
       const VVdouble* iLik_n_i = &(*iLik_n)[i];
@@ -922,7 +1747,7 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
   }
 
   // Now deal with the subtree containing the root:
-  for (size_t i = 0; i < nbDistinctSites; i++)
+  for (size_t i = firstSite; i < lastSite; i++)
   {
     // For each site in the sequence,
     const VVdouble* iLikR_i = &(*iLikR)[i];
@@ -965,7 +1790,7 @@ void DRHomogeneousTreeLikelihood::displayLikelihood(const Node* node)
   {
     const Node* father = node->getFather();
     cout << "Array for father node " << father->getId() << endl;
-    displayLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), father->getId()));
+    displayLikelihoodArray(getUpperLikelihoodArray_(node));
   }
   cout << "                                         ***" << endl;
 }
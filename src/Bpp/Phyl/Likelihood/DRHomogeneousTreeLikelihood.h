@@ -43,10 +43,17 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "AbstractHomogeneousTreeLikelihood.h"
 #include "DRTreeLikelihood.h"
 #include "DRASDRTreeLikelihoodData.h"
+#include "../SiteLoopExecutor.h"
 
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Prob/DiscreteDistribution.h>
 
+// From the STL:
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
 namespace bpp
 {
 
@@ -68,6 +75,79 @@ class DRHomogeneousTreeLikelihood:
   private:
     mutable DRASDRTreeLikelihoodData* likelihoodData_;
 
+    /**
+     * @brief Conditional likelihoods at the father node, reused by the
+     * derivative computations to avoid reallocating one array per site
+     * and per class at each call.
+     */
+    VVVdouble fatherLikelihoods_;
+
+    /**
+     * @brief Threads used by site loops, null if there is only one thread.
+     */
+    std::unique_ptr<SiteLoopExecutor> siteLoopExecutor_;
+
+    /**
+     * @brief One step of the postfix and prefix recursions.
+     *
+     * The recursions are recorded once per topology as a flat list of operations
+     * on likelihood arrays, which computeTreeLikelihood() then runs in order.
+     */
+    struct LikelihoodOperation_
+    {
+      enum Type { RESET, COPY_LEAF, COMBINE, ROOT_FREQUENCIES };
+      Type type;
+      VVVdouble* result;
+      const std::vector<unsigned int>* leafCodes; // COPY_LEAF only.
+      std::vector<const VVVdouble*> iLik;      // COMBINE only.
+      std::vector<const VVVdouble*> tProb;     // COMBINE only.
+      const VVVdouble* iLikR;                  // COMBINE with a father node, or 0.
+      const VVVdouble* tProbR;
+
+      LikelihoodOperation_(Type t, VVVdouble* r) :
+        type(t), result(r), leafCodes(0), iLik(), tProb(), iLikR(0), tProbR(0) {}
+    };
+
+    std::vector<LikelihoodOperation_> likelihoodOperations_;
+    bool likelihoodOperationsUpToDate_;
+
+    /**
+     * @name Memory budget (see setMemoryBudget()).
+     *
+     * Upper arrays, that is the array at a node for its father, are indexed
+     * by node id. Only those of checkpoint nodes and of the last recomputed
+     * ones (the transients, oldest first) are allocated.
+     *
+     * @{
+     */
+    size_t memoryBudget_;
+    size_t checkpointInterval_;
+    size_t maxNbUpperTransients_;
+    std::vector<bool> upperCheckpoints_;
+    mutable std::vector<bool> upperUpToDate_;
+    mutable std::deque<int> upperTransients_;
+    mutable std::recursive_mutex upperMutex_;
+    /** @} */
+
+    /**
+     * @name State kept by proposeParameters() until the proposal is
+     * accepted or rejected.
+     *
+     * proposalData_ is the second set of likelihood arrays, kept from one
+     * proposal to the next.
+     *
+     * @{
+     */
+    std::unique_ptr<DRASDRTreeLikelihoodData> proposalData_;
+    ParameterList proposalParameters_;
+    std::map<int, VVVdouble> proposalPxy_;
+    std::map<int, VVVdouble> proposalDpxy_;
+    std::map<int, VVVdouble> proposalD2pxy_;
+    std::vector<double> proposalRootFreqs_;
+    double proposalMinusLogLik_;
+    bool hasProposal_;
+    /** @} */
+
   protected:
     double minusLogLik_;
     
@@ -133,6 +213,12 @@ class DRHomogeneousTreeLikelihood:
      */
     void init_();
 
+    /**
+     * @brief Set the data subset, and initialize the likelihood arrays,
+     * sharing the site compression of @p shared if not null.
+     */
+    void setData_(std::shared_ptr<const AlignedValuesContainer> data, const DRASDRTreeLikelihoodData* shared);
+
   public:
 
     /**
@@ -143,6 +229,17 @@ class DRHomogeneousTreeLikelihood:
      * @{
      */
     void setData(const AlignedValuesContainer & sites);
+
+    /**
+     * @brief Same as setData(sites), but if this object and @p shared
+     * have the same leaves, the data subset and the site compression
+     * of @p shared are reused instead of being copied again.
+     *
+     * @param sites The data set, the same as the one of @p shared.
+     * @param shared An object already initialized with @p sites.
+     */
+    void setData(const AlignedValuesContainer & sites, const DRHomogeneousTreeLikelihood& shared);
+
     double getLikelihood () const;
     double getLogLikelihood() const;
     double getLikelihoodForASite (size_t site) const;
@@ -208,9 +305,214 @@ class DRHomogeneousTreeLikelihood:
     {
       computeLikelihoodAtNode_(tree_->getNode(nodeId), likelihoodArray);
     }
+
+    const VVVdouble& getLikelihoodArrayForNeighbor(int nodeId, int neighborId) const
+    {
+      if (memoryBudget_ == 0)
+        return likelihoodData_->getLikelihoodArray(nodeId, neighborId);
+      return getLikelihoodArrayForNeighbor_(tree_->getNode(nodeId), neighborId);
+    }
+
+    /**
+     * @brief Set a memory budget for the conditional likelihood arrays.
+     *
+     * The double-recursive algorithm stores at each node one array per
+     * neighbor. The lower arrays, toward the sons, are about what a simple
+     * recursive algorithm needs, and are always stored. With a budget, the
+     * upper arrays, toward the father, are only stored at checkpoint nodes,
+     * every k levels down the tree, k being the smallest interval for
+     * which the arrays fit in the budget. Other upper arrays are computed
+     * again from the nearest checkpoint above them when needed, and only
+     * the last k + 1 of them are kept.
+     *
+     * The likelihood itself only needs the lower arrays, so that the budget
+     * only slows down derivatives and methods working on all branches
+     * (branch length optimization, topology moves, substitution mapping).
+     * If the budget is lower than the lower arrays, no upper array is stored
+     * beyond the last two recomputed ones.
+     *
+     * @param bytes The memory budget of the likelihood arrays, in bytes.
+     * 0 (the default) means no budget: all arrays are stored, as before.
+     */
+    virtual void setMemoryBudget(size_t bytes);
+
+    size_t getMemoryBudget() const { return memoryBudget_; }
+
+    /**
+     * @return The number of levels between two checkpoint nodes,
+     * 1 without budget.
+     */
+    size_t getCheckpointInterval() const { return checkpointInterval_; }
+
+    /**
+     * @brief Set the number of threads used to compute likelihood arrays and their derivatives.
+     *
+     * Sites are split into one contiguous block per thread (see SiteLoopExecutor).
+     * Each site is computed by the same code whatever its block, and sums over sites
+     * are still performed in site order, so that results do not depend on the number of threads.
+     *
+     * @param nbThreads The number of threads, including the calling one. 1 (the default) means no additional thread.
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    size_t getNumberOfThreads() const { return siteLoopExecutor_ ? siteLoopExecutor_->getNumberOfThreads() : 1; }
+
+    /**
+     * @name Speculative evaluation, for samplers rejecting most of their proposals.
+     *
+     * proposeParameters() sets new parameter values and computes the
+     * likelihood, but keeps the likelihood arrays and transition
+     * probabilities of the current state. rejectProposal() then restores
+     * them by exchanging the arrays back, without computing anything, and
+     * acceptProposal() only forgets them.
+     *
+     * All likelihood arrays are computed again after a change of parameter:
+     * the arrays of the current state are moved to a second set of arrays,
+     * allocated once by the first proposal, and the proposal is computed in
+     * the set they replace. Transition probabilities are copied, as only
+     * some of them may be computed again.
+     *
+     * Proposals only change parameter values, including branch lengths.
+     * The topology must not be changed while a proposal is pending.
+     *
+     * @{
+     */
+
+    /**
+     * @brief Set new parameter values, keeping the current state.
+     *
+     * @param parameters The proposed values (see setParameters()).
+     * @throw Exception If a proposal is already pending, or if a memory
+     * budget is set (see setMemoryBudget()).
+     */
+    virtual void proposeParameters(const ParameterList& parameters);
+
+    /**
+     * @brief Keep the proposed state.
+     */
+    virtual void acceptProposal();
+
+    /**
+     * @brief Go back to the state before proposeParameters().
+     *
+     * Parameter values are set back in the model and rate distribution,
+     * which updates them, but no likelihood is computed.
+     */
+    virtual void rejectProposal();
+
+    bool hasProposal() const { return hasProposal_; }
+
+    /** @} */
+
+    /**
+     * @brief Optimize branch lengths one at a time, in one pass over the tree.
+     *
+     * Each branch is optimized by 1-D Newton steps computed only from the
+     * two conditional likelihood arrays at its ends, which do not depend on
+     * its length. Nodes are visited in prefix order, so that after each
+     * branch only the arrays needed by the next one are updated, instead of
+     * the whole tree. The branch length parameters are set at the end of the
+     * pass, which computes the likelihood of the tree once.
+     *
+     * @param names The names of the branch length parameters to optimize. Other names are ignored.
+     * @param tolerance Newton steps on a branch stop when its length moves by less than this value.
+     * @param maxNbSteps The maximum number of Newton steps on each branch.
+     */
+    virtual void optimizeBranchLengthsOneByOne(const std::vector<std::string>& names, double tolerance, unsigned int maxNbSteps);
+
+    /**
+     * @brief Move the root of the tree to another inner node.
+     *
+     * The model being reversible and at equilibrium at the root, the conditional
+     * likelihood arrays toward each neighbor of each node do not depend on the root,
+     * except across the branches between the old and the new root. Those arrays are
+     * computed again, as well as the root arrays and the derivatives for these branches;
+     * the other ones are reused as they are. The branch length parameters keep
+     * designating the same branches.
+     *
+     * @param nodeId The id of the new root, which must have at least three neighbors.
+     * @throw NodeException If the node has less than three neighbors.
+     */
+    virtual void rootAt(int nodeId);
       
   protected:
+    /**
+     * @brief Run a loop over all distinct sites, split over the threads if any.
+     *
+     * @param loop A function computing sites in [first, last).
+     */
+    void runSiteLoop_(const std::function<void(size_t, size_t)>& loop) const;
+
+    /**
+     * @brief Run a loop over any range of independent items, split over the threads if any.
+     *
+     * @param size The number of items.
+     * @param loop A function computing items in [first, last).
+     */
+    void runParallelLoop_(size_t size, const std::function<void(size_t, size_t)>& loop) const;
+
+  private:
+    /**
+     * @brief Record the operations performed by computeSubtreeLikelihoodPostfix and computeSubtreeLikelihoodPrefix.
+     */
+    void buildPostfixOperations_(const Node* node);
+    void buildPrefixOperations_(const Node* node);
+    void runLikelihoodOperations_();
+
+    /**
+     * @brief Steps of optimizeBranchLengthsOneByOne().
+     *
+     * optimizeBranchLength_ returns the new length of the branch of a node,
+     * and leaves its transition probabilities at this length.
+     * computeSubtreeLikelihoodPostfixAtNode_ and computeSubtreeLikelihoodPrefixAtNode_
+     * compute the arrays of a node at its father and of its father at the node.
+     */
+    void optimizeBranchLengthsOneByOne_(const Node* node, const std::map<int, size_t>& brIndex, const std::vector<bool>& selected, double tolerance, unsigned int maxNbSteps, std::vector<double>& lengths);
+    double optimizeBranchLength_(const Node* node, double tolerance, unsigned int maxNbSteps);
+    void computeSubtreeLikelihoodPostfixAtNode_(const Node* node);
+    void computeSubtreeLikelihoodPrefixAtNode_(const Node* node) const;
+
+    /**
+     * @brief Choose the checkpoint nodes according to the memory budget,
+     * (re)allocate their upper arrays and release the other ones.
+     *
+     * All upper arrays are flagged as not up to date.
+     * Without budget, this only makes sure that all upper arrays are allocated.
+     */
+    void updateUpperCheckpoints_();
+
+    /**
+     * @brief Flag all upper arrays as not up to date and release the transients.
+     */
+    void invalidateUpperLikelihoodArrays_() const;
+
+    void releaseUpperLikelihoodArray_(int nodeId) const;
+
+  protected:
+
+
     virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode = 0) const;
+
+    /**
+     * @return The array at a node for its father, computed first if the
+     * node is not a checkpoint and its array is not up to date.
+     *
+     * With a memory budget, the bookkeeping of the upper arrays is protected by a
+     * lock, but a returned array which is not a checkpoint may be released by any
+     * later recomputation. Callers running concurrently (see testNNIs()) must
+     * therefore not rely on it: they are run serially when a budget is set.
+     */
+    const VVVdouble& getUpperLikelihoodArray_(const Node* node) const;
+
+    /**
+     * @return The array at a node for any of its neighbors.
+     */
+    const VVVdouble& getLikelihoodArrayForNeighbor_(const Node* node, int neighborId) const
+    {
+      if (node->hasFather() && node->getFatherId() == neighborId)
+        return getUpperLikelihoodArray_(node);
+      return likelihoodData_->getLikelihoodArray(node->getId(), neighborId);
+    }
   
     /**
      * Initialize the arrays corresponding to each son node for the node passed as argument.
@@ -226,6 +528,14 @@ class DRHomogeneousTreeLikelihood:
 
     virtual void computeRootLikelihood();
 
+    /**
+     * @brief Tell that the topology has changed.
+     *
+     * The list of operations run by computeTreeLikelihood() will be rebuilt at the next call.
+     * This must be called by any method modifying the tree topology.
+     */
+    void invalidateLikelihoodOperations_() { likelihoodOperationsUpToDate_ = false; }
+
     virtual void computeTreeDLikelihoodAtNode(const Node* node);
     virtual void computeTreeDLikelihoods();
     
@@ -301,6 +611,39 @@ class DRHomogeneousTreeLikelihood:
         size_t nbStates,
         bool reset = true);
 
+    /**
+     * @brief Compute conditional likelihoods for a range of sites.
+     *
+     * Same as computeLikelihoodFromArrays, restricted to sites in [firstSite, lastSite)
+     * and without reset, so that disjoint ranges can be computed concurrently.
+     */
+    static void computeLikelihoodFromArraysForSites(
+        const std::vector<const VVVdouble*>& iLik,
+        const std::vector<const VVVdouble*>& tProb,
+        VVVdouble& oLik, size_t nbNodes,
+        size_t firstSite,
+        size_t lastSite,
+        size_t nbClasses,
+        size_t nbStates);
+
+    /**
+     * @brief Compute conditional likelihoods for a range of sites, for non-reversible models.
+     *
+     * Same as computeLikelihoodFromArrays, restricted to sites in [firstSite, lastSite)
+     * and without reset, so that disjoint ranges can be computed concurrently.
+     */
+    static void computeLikelihoodFromArraysForSites(
+        const std::vector<const VVVdouble*>& iLik,
+        const std::vector<const VVVdouble*>& tProb,
+        const VVVdouble* iLikR,
+        const VVVdouble* tProbR,
+        VVVdouble& oLik,
+        size_t nbNodes,
+        size_t firstSite,
+        size_t lastSite,
+        size_t nbClasses,
+        size_t nbStates);
+
   friend class DRHomogeneousMixedTreeLikelihood;
 };
 
@@ -38,6 +38,7 @@
  */
 
 #include "DRNonHomogeneousTreeLikelihood.h"
+#include "CompensatedSum.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -65,7 +66,10 @@ DRNonHomogeneousTreeLikelihood::DRNonHomogeneousTreeLikelihood(
   bool reparametrizeRoot) :
   AbstractNonHomogeneousTreeLikelihood(tree, modelSet, rDist, verbose, reparametrizeRoot),
   likelihoodData_(0),
-  minusLogLik_(-1.)
+  minusLogLik_(-1.),
+  fatherLikelihoods_(),
+  dLikelihoodsUpToDate_(),
+  d2LikelihoodsUpToDate_()
 {
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("DRNonHomogeneousTreeLikelihood(constructor). Model set is not fully specified.");
@@ -83,7 +87,10 @@ DRNonHomogeneousTreeLikelihood::DRNonHomogeneousTreeLikelihood(
   bool reparametrizeRoot) :
   AbstractNonHomogeneousTreeLikelihood(tree, modelSet, rDist, verbose, reparametrizeRoot),
   likelihoodData_(0),
-  minusLogLik_(-1.)
+  minusLogLik_(-1.),
+  fatherLikelihoods_(),
+  dLikelihoodsUpToDate_(),
+  d2LikelihoodsUpToDate_()
 {
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("DRNonHomogeneousTreeLikelihood(constructor). Model set is not fully specified.");
@@ -105,7 +112,10 @@ void DRNonHomogeneousTreeLikelihood::init_()
 DRNonHomogeneousTreeLikelihood::DRNonHomogeneousTreeLikelihood(const DRNonHomogeneousTreeLikelihood& lik) :
   AbstractNonHomogeneousTreeLikelihood(lik),
   likelihoodData_(0),
-  minusLogLik_(lik.minusLogLik_)
+  minusLogLik_(lik.minusLogLik_),
+  fatherLikelihoods_(),
+  dLikelihoodsUpToDate_(),
+  d2LikelihoodsUpToDate_()
 {
   likelihoodData_ = dynamic_cast<DRASDRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
@@ -121,6 +131,8 @@ DRNonHomogeneousTreeLikelihood& DRNonHomogeneousTreeLikelihood::operator=(const
   likelihoodData_ = dynamic_cast<DRASDRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
   minusLogLik_ = lik.minusLogLik_;
+  dLikelihoodsUpToDate_.clear();
+  d2LikelihoodsUpToDate_.clear();
   return *this;
 }
 
@@ -135,9 +147,7 @@ DRNonHomogeneousTreeLikelihood::~DRNonHomogeneousTreeLikelihood()
 
 void DRNonHomogeneousTreeLikelihood::setData(const AlignedValuesContainer& sites)
 {
-  if (data_)
-    delete data_;
-  data_ = PatternTools::getSequenceSubset(sites, *tree_->getRootNode());
+  data_.reset(PatternTools::getSequenceSubset(sites, *tree_->getRootNode()));
   if (verbose_)
     ApplicationTools::displayTask("Initializing data structure");
   likelihoodData_->initLikelihoods(*data_, *modelSet_->getModel(0)); // We assume here that all models have the same number of states, and that they have the same 'init' method,
@@ -173,20 +183,9 @@ double DRNonHomogeneousTreeLikelihood::getLikelihood() const
 
 double DRNonHomogeneousTreeLikelihood::getLogLikelihood() const
 {
-  double ll = 0;
-  Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
   const vector<unsigned int>* w = &likelihoodData_->getWeights();
-  vector<double> la(nbDistinctSites_);
-  for (size_t i = 0; i < nbDistinctSites_; i++)
-  {
-    la[i] = (*w)[i] * log((*lik)[i]);
-  }
-  sort(la.begin(), la.end());
-  for (size_t i = nbDistinctSites_; i > 0; i--)
-  {
-    ll += la[i - 1];
-  }
-  return ll;
+  return sumOfWeightedLogarithms(lik->begin(), w->begin(), nbDistinctSites_);
 }
 
 /******************************************************************************/
@@ -243,7 +242,7 @@ void DRNonHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& p
 {
   applyParameters();
 
-  if (params.getCommonParametersWith(rateDistribution_->getIndependentParameters()).size() > 0)
+  if (haveCommonParameters(params, rateDistribution_->getIndependentParameters()))
   {
     computeAllTransitionProbabilities();
   }
@@ -287,14 +286,6 @@ void DRNonHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& p
     rootFreqs_ = modelSet_->getRootFrequencies();
   }
   computeTreeLikelihood();
-  if (computeFirstOrderDerivatives_)
-  {
-    computeTreeDLikelihoods();
-  }
-  if (computeSecondOrderDerivatives_)
-  {
-    computeTreeD2Likelihoods();
-  }
 }
 
 /******************************************************************************/
@@ -316,7 +307,7 @@ void DRNonHomogeneousTreeLikelihood::computeTreeDLikelihoodAtNode(const Node* no
   Vdouble* _dLikelihoods_node = &likelihoodData_->getDLikelihoodArray(node->getId());
   VVVdouble*  pxy__node = &pxy_[node->getId()];
   VVVdouble* dpxy__node = &dpxy_[node->getId()];
-  VVVdouble larray;
+  VVVdouble& larray = fatherLikelihoods_;
   computeLikelihoodAtNode_(father, larray);
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
 
@@ -361,11 +352,22 @@ void DRNonHomogeneousTreeLikelihood::computeTreeDLikelihoods()
   for (size_t k = 0; k < nbNodes_; k++)
   {
     computeTreeDLikelihoodAtNode(nodes_[k]);
+    dLikelihoodsUpToDate_.insert(nodes_[k]->getId());
   }
 }
 
 /******************************************************************************/
 
+void DRNonHomogeneousTreeLikelihood::updateDLikelihoodArray_(int nodeId) const
+{
+  if (!computeFirstOrderDerivatives_ || dLikelihoodsUpToDate_.find(nodeId) != dLikelihoodsUpToDate_.end())
+    return;
+  const_cast<DRNonHomogeneousTreeLikelihood*>(this)->computeTreeDLikelihoodAtNode(tree_->getNode(nodeId));
+  dLikelihoodsUpToDate_.insert(nodeId);
+}
+
+/******************************************************************************/
+
 double DRNonHomogeneousTreeLikelihood::getFirstOrderDerivative(const string& variable) const
 {
   if (!hasParameter(variable))
@@ -386,6 +388,8 @@ double DRNonHomogeneousTreeLikelihood::getFirstOrderDerivative(const string& var
   Vdouble* _dLikelihoods_branch;
   if (variable == "BrLenRoot")
   {
+    updateDLikelihoodArray_(root1_);
+    updateDLikelihoodArray_(root2_);
     _dLikelihoods_branch = &likelihoodData_->getDLikelihoodArray(root1_);
     double d1 = 0;
     for (size_t i = 0; i < nbDistinctSites_; i++)
@@ -403,6 +407,8 @@ double DRNonHomogeneousTreeLikelihood::getFirstOrderDerivative(const string& var
   }
   else if (variable == "RootPosition")
   {
+    updateDLikelihoodArray_(root1_);
+    updateDLikelihoodArray_(root2_);
     _dLikelihoods_branch = &likelihoodData_->getDLikelihoodArray(root1_);
     double d1 = 0;
     for (size_t i = 0; i < nbDistinctSites_; i++)
@@ -423,6 +429,7 @@ double DRNonHomogeneousTreeLikelihood::getFirstOrderDerivative(const string& var
     // Get the node with the branch whose length must be derivated:
     size_t brI = TextTools::to<size_t>(variable.substr(5));
     const Node* branch = nodes_[brI];
+    updateDLikelihoodArray_(branch->getId());
     _dLikelihoods_branch = &likelihoodData_->getDLikelihoodArray(branch->getId());
     double d = 0;
     for (size_t i = 0; i < nbDistinctSites_; i++)
@@ -443,7 +450,7 @@ void DRNonHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* n
   Vdouble* _d2Likelihoods_node = &likelihoodData_->getD2LikelihoodArray(node->getId());
   VVVdouble*   pxy__node = &pxy_[node->getId()];
   VVVdouble* d2pxy__node = &d2pxy_[node->getId()];
-  VVVdouble larray;
+  VVVdouble& larray = fatherLikelihoods_;
   computeLikelihoodAtNode_(father, larray);
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
 
@@ -489,11 +496,22 @@ void DRNonHomogeneousTreeLikelihood::computeTreeD2Likelihoods()
   for (size_t k = 0; k < nbNodes_; k++)
   {
     computeTreeD2LikelihoodAtNode(nodes_[k]);
+    d2LikelihoodsUpToDate_.insert(nodes_[k]->getId());
   }
 }
 
 /******************************************************************************/
 
+void DRNonHomogeneousTreeLikelihood::updateD2LikelihoodArray_(int nodeId) const
+{
+  if (!computeSecondOrderDerivatives_ || d2LikelihoodsUpToDate_.find(nodeId) != d2LikelihoodsUpToDate_.end())
+    return;
+  const_cast<DRNonHomogeneousTreeLikelihood*>(this)->computeTreeD2LikelihoodAtNode(tree_->getNode(nodeId));
+  d2LikelihoodsUpToDate_.insert(nodeId);
+}
+
+/******************************************************************************/
+
 double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& variable) const
 {
   if (!hasParameter(variable))
@@ -814,6 +832,8 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
     // Get the node with the branch whose length must be derivated:
     size_t brI = TextTools::to<size_t>(variable.substr(5));
     const Node* branch = nodes_[brI];
+    updateDLikelihoodArray_(branch->getId());
+    updateD2LikelihoodArray_(branch->getId());
     _dLikelihoods_branch = &likelihoodData_->getDLikelihoodArray(branch->getId());
     _d2Likelihoods_branch = &likelihoodData_->getD2LikelihoodArray(branch->getId());
     double d2l = 0;
@@ -845,15 +865,21 @@ void DRNonHomogeneousTreeLikelihood::resetLikelihoodArrays(const Node* node)
 
 void DRNonHomogeneousTreeLikelihood::computeTreeLikelihood()
 {
+  // Arrays are allocated on the first computation:
+  likelihoodData_->allocateArrays();
   computeSubtreeLikelihoodPostfix(tree_->getRootNode());
   computeSubtreeLikelihoodPrefix(tree_->getRootNode());
   computeRootLikelihood();
+  // Derivative arrays are computed later on, for the branches actually requested:
+  dLikelihoodsUpToDate_.clear();
+  d2LikelihoodsUpToDate_.clear();
 }
 
 /******************************************************************************/
 
 void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* node)
 {
+  likelihoodData_->allocateArrays();
 //  if(node->isLeaf()) return;
 // cout << node->getId() << "\t" << (node->hasName()?node->getName():"") << endl;
   if (node->getNumberOfSons() == 0)
@@ -873,11 +899,12 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node*
 
     if (son->isLeaf())
     {
-      VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(son->getId());
+      const vector<unsigned int>* _codes_leaf = &likelihoodData_->getLeafStateCodes(son->getId());
+      const VVdouble* leafProfiles = &likelihoodData_->getLeafStateProfiles();
       for (size_t i = 0; i < nbDistinctSites_; i++)
       {
         // For each site in the sequence,
-        Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
+        const Vdouble* _likelihoods_leaf_i = &(*leafProfiles)[(*_codes_leaf)[i]];
         VVdouble* _likelihoods_node_son_i = &(*_likelihoods_node_son)[i];
         for (size_t c = 0; c < nbClasses_; c++)
         {
@@ -914,6 +941,7 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node*
 
 void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* node)
 {
+  likelihoodData_->allocateArrays();
   if (!node->hasFather())
   {
     // 'node' is the root of the tree.
@@ -939,11 +967,12 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
     if (father->isLeaf())
     {
       // If the tree is rooted by a leaf
-      VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(father->getId());
+      const vector<unsigned int>* _codes_leaf = &likelihoodData_->getLeafStateCodes(father->getId());
+      const VVdouble* leafProfiles = &likelihoodData_->getLeafStateProfiles();
       for (size_t i = 0; i < nbDistinctSites_; i++)
       {
         // For each site in the sequence,
-        Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
+        const Vdouble* _likelihoods_leaf_i = &(*leafProfiles)[(*_codes_leaf)[i]];
         VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
         for (size_t c = 0; c < nbClasses_; c++)
         {
@@ -1024,16 +1053,18 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
 
 void DRNonHomogeneousTreeLikelihood::computeRootLikelihood()
 {
+  likelihoodData_->allocateArrays();
   const Node* root = tree_->getRootNode();
   VVVdouble* rootLikelihoods = &likelihoodData_->getRootLikelihoodArray();
   // Set all likelihoods to 1 for a start:
   if (root->isLeaf())
   {
-    VVdouble* leavesLikelihoods_root = &likelihoodData_->getLeafLikelihoods(root->getId());
+    const vector<unsigned int>* leavesCodes_root = &likelihoodData_->getLeafStateCodes(root->getId());
+    const VVdouble* leafProfiles = &likelihoodData_->getLeafStateProfiles();
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
       VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
-      Vdouble* leavesLikelihoods_root_i = &(*leavesLikelihoods_root)[i];
+      const Vdouble* leavesLikelihoods_root_i = &(*leafProfiles)[(*leavesCodes_root)[i]];
       for (size_t c = 0; c < nbClasses_; c++)
       {
         Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
@@ -1102,11 +1133,12 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node,
   // Initialize likelihood array:
   if (node->isLeaf())
   {
-    VVdouble* leavesLikelihoods_node = &likelihoodData_->getLeafLikelihoods(nodeId);
+    const vector<unsigned int>* leavesCodes_node = &likelihoodData_->getLeafStateCodes(nodeId);
+    const VVdouble* leafProfiles = &likelihoodData_->getLeafStateProfiles();
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
       VVdouble* likelihoodArray_i = &likelihoodArray[i];
-      Vdouble* leavesLikelihoods_node_i = &(*leavesLikelihoods_node)[i];
+      const Vdouble* leavesLikelihoods_node_i = &(*leafProfiles)[(*leavesCodes_node)[i]];
       likelihoodArray_i->resize(nbClasses_);
       for (size_t c = 0; c < nbClasses_; c++)
       {
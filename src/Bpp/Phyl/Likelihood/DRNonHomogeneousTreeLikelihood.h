@@ -47,6 +47,9 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Prob/DiscreteDistribution.h>
 
+// From the STL:
+#include <set>
+
 namespace bpp
 {
 
@@ -72,6 +75,23 @@ class DRNonHomogeneousTreeLikelihood:
   protected:
     mutable DRASDRTreeLikelihoodData *likelihoodData_;
     double minusLogLik_;
+
+    /**
+     * @brief Conditional likelihoods at the father node, reused by the
+     * derivative computations to avoid reallocating one array per site
+     * and per class at each call.
+     */
+    VVVdouble fatherLikelihoods_;
+
+    /**
+     * @brief Ids of the nodes whose first and second order derivative arrays
+     * are up to date with the current parameter values.
+     *
+     * Derivative arrays are computed on demand, branch by branch, when a
+     * derivative is requested, and invalidated when parameters change.
+     */
+    mutable std::set<int> dLikelihoodsUpToDate_;
+    mutable std::set<int> d2LikelihoodsUpToDate_;
    
   public:
     /**
@@ -235,6 +255,16 @@ class DRNonHomogeneousTreeLikelihood:
     virtual void computeTreeD2LikelihoodAtNode(const Node* node);
     virtual void computeTreeD2Likelihoods();
 
+    /**
+     * @brief Compute the derivative arrays of a branch if they are not up to date.
+     *
+     * Nothing is done if the corresponding derivatives are not enabled.
+     *
+     * @param nodeId The id of the node under the branch.
+     */
+    void updateDLikelihoodArray_(int nodeId) const;
+    void updateD2LikelihoodArray_(int nodeId) const;
+
     void fireParameterChanged(const ParameterList& params);
 
     void resetLikelihoodArrays(const Node* node);
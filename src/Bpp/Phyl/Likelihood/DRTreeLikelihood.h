@@ -101,6 +101,21 @@ class DRTreeLikelihood:
      */
     virtual void computeLikelihoodAtNode(int nodeId, VVVdouble& likelihoodArray) const = 0;
 
+    /**
+     * @brief Get the conditional likelihood array at a node for one of its neighbors.
+     *
+     * Implementations which do not store all arrays compute the missing ones first.
+     * Arrays should hence be retrieved with this method rather than from the data structure.
+     *
+     * @param nodeId The id of the node to consider.
+     * @param neighborId The id of a neighbor of this node.
+     * @return The likelihood array of the subtree defined by the neighbor, as seen from the node.
+     */
+    virtual const VVVdouble& getLikelihoodArrayForNeighbor(int nodeId, int neighborId) const
+    {
+      return getLikelihoodData()->getLikelihoodArray(nodeId, neighborId);
+    }
+
 };
 
 } //end of namespace bpp.
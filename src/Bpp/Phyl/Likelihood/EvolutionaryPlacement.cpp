@@ -0,0 +1,390 @@
+//
+// File: EvolutionaryPlacement.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "EvolutionaryPlacement.h"
+#include "../SiteLoopExecutor.h"
+#include "../Model/StateMap.h"
+
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From the STL:
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+namespace
+{
+  /**
+   * @brief Golden section search of a maximum of f in [a, b].
+   */
+  double goldenSectionMaximum(const function<double(double)>& f, double a, double b, double tolerance, double& fMax)
+  {
+    const double r = (sqrt(5.) - 1.) / 2.;
+    double c = b - r * (b - a);
+    double d = a + r * (b - a);
+    double fc = f(c);
+    double fd = f(d);
+    while (b - a > tolerance)
+    {
+      if (fc > fd)
+      {
+        b = d;
+        d = c;
+        fd = fc;
+        c = b - r * (b - a);
+        fc = f(c);
+      }
+      else
+      {
+        a = c;
+        c = d;
+        fc = fd;
+        d = a + r * (b - a);
+        fd = f(d);
+      }
+    }
+    if (fc > fd)
+    {
+      fMax = fc;
+      return c;
+    }
+    fMax = fd;
+    return d;
+  }
+}
+
+/******************************************************************************/
+
+EvolutionaryPlacement::EvolutionaryPlacement(const DRHomogeneousTreeLikelihood& reference) :
+  model_(),
+  rates_(),
+  probs_(),
+  rootPatternLinks_(),
+  nbSites_(0),
+  nbDistinctSites_(0),
+  nbClasses_(0),
+  nbStates_(0),
+  branches_(),
+  minimumBrLen_(reference.getMinimumBranchLength()),
+  maximumPendantLength_(10.),
+  initialPendantLength_(0.1),
+  nbCandidates_(5),
+  tolerance_(0.0001),
+  maxNbRounds_(3)
+{
+  if (!reference.isInitialized())
+    throw Exception("EvolutionaryPlacement::EvolutionaryPlacement(). The reference likelihood is not initialized.");
+
+  const DRASDRTreeLikelihoodData* data = reference.getLikelihoodData();
+  nbSites_ = data->getNumberOfSites();
+  nbDistinctSites_ = data->getNumberOfDistinctSites();
+  nbClasses_ = data->getNumberOfClasses();
+  nbStates_ = data->getNumberOfStates();
+  rootPatternLinks_ = data->getRootArrayPositions();
+
+  model_.reset(reference.getModel()->clone());
+  const DiscreteDistribution* rDist = reference.getRateDistribution();
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    rates_.push_back(rDist->getCategory(c));
+    probs_.push_back(rDist->getProbability(c));
+  }
+
+  const Tree& tree = reference.getTree();
+  vector<int> ids = tree.getNodesId();
+  for (size_t k = 0; k < ids.size(); k++)
+  {
+    int id = ids[k];
+    if (!tree.hasFather(id))
+      continue;
+    int fatherId = tree.getFatherId(id);
+    branches_.push_back(Branch_());
+    Branch_& branch = branches_.back();
+    branch.nodeId = id;
+    branch.length = tree.getDistanceToFather(id);
+    // Copied at once, as arrays may be released with a memory budget:
+    branch.above = reference.getLikelihoodArrayForNeighbor(id, fatherId);
+    branch.below = reference.getLikelihoodArrayForNeighbor(fatherId, id);
+    computeMiddleArray_(*model_, branch, branch.length / 2., branch.middle);
+  }
+}
+
+/******************************************************************************/
+
+vector< vector<EvolutionaryPlacement::Placement> > EvolutionaryPlacement::place(const AlignedValuesContainer& queries, size_t nbThreads) const
+{
+  if (queries.getNumberOfSites() != nbSites_)
+    throw Exception("EvolutionaryPlacement::place(). Queries must have as many sites as the reference data.");
+
+  size_t nbQueries = queries.getNumberOfSequences();
+  vector< vector<Placement> > placements(nbQueries);
+  if (nbQueries == 0)
+    return placements;
+
+  // Queries are dealt in turn to the threads, each with its own model:
+  size_t nbBlocks = max(static_cast<size_t>(1), min(nbThreads, nbQueries));
+  const SiteContainer* sc = dynamic_cast<const SiteContainer*>(&queries);
+  std::function<void(size_t, size_t)> placeBlocks = [&](size_t first, size_t last)
+  {
+    unique_ptr<TransitionModel> model(model_->clone());
+    StateIndicatorTable indicators(model->getStateMap());
+    VVdouble profile(nbSites_, Vdouble(nbStates_));
+    for (size_t b = first; b < last; ++b)
+    {
+      for (size_t q = b; q < nbQueries; q += nbBlocks)
+      {
+        for (size_t i = 0; i < nbSites_; i++)
+        {
+          if (sc)
+            profile[i] = indicators.getIndicators(sc->getSite(i)[q]);
+          else
+            for (size_t s = 0; s < nbStates_; s++)
+              profile[i][s] = queries.getStateValueAt(i, q, model->getAlphabetStateAsInt(s));
+        }
+        placements[q] = place_(*model, profile);
+      }
+    }
+  };
+
+  if (nbBlocks > 1)
+  {
+    SiteLoopExecutor executor(nbBlocks);
+    executor.run(nbBlocks, placeBlocks);
+  }
+  else
+    placeBlocks(0, 1);
+
+  return placements;
+}
+
+/******************************************************************************/
+
+vector<EvolutionaryPlacement::Placement> EvolutionaryPlacement::place_(const TransitionModel& model, const VVdouble& profile) const
+{
+  VVVdouble pendant;
+  computePendantArray_(model, profile, initialPendantLength_, pendant);
+
+  // All branches are first scored with the query at their middle:
+  size_t nbBranches = branches_.size();
+  vector< pair<double, size_t> > scores(nbBranches);
+  for (size_t b = 0; b < nbBranches; b++)
+    scores[b] = make_pair(getLogLikelihood_(branches_[b].middle, pendant), b);
+  size_t nbCandidates = min(nbCandidates_, nbBranches);
+  partial_sort(scores.begin(), scores.begin() + static_cast<ptrdiff_t>(nbCandidates), scores.end(),
+               [](const pair<double, size_t>& s1, const pair<double, size_t>& s2) { return s1.first > s2.first; });
+
+  // Lengths are then optimized on the best candidates:
+  vector<Placement> placements(nbCandidates);
+  VVVdouble middle;
+  for (size_t k = 0; k < nbCandidates; k++)
+  {
+    const Branch_& branch = branches_[scores[k].second];
+    Placement& pl = placements[k];
+    pl.nodeId = branch.nodeId;
+    pl.distalLength = branch.length / 2.;
+    pl.pendantLength = initialPendantLength_;
+    pl.logLikelihood = scores[k].first;
+    computePendantArray_(model, profile, pl.pendantLength, pendant);
+
+    for (unsigned int r = 0; r < maxNbRounds_; r++)
+    {
+      double previous = pl.logLikelihood;
+      double previousPendant = pl.pendantLength;
+      double previousDistal = pl.distalLength;
+
+      // The pendant length is searched on a log scale:
+      computeMiddleArray_(model, branch, pl.distalLength, middle);
+      double ll;
+      double logPendant = goldenSectionMaximum([&](double x)
+        {
+          computePendantArray_(model, profile, exp(x), pendant);
+          return getLogLikelihood_(middle, pendant);
+        }, log(minimumBrLen_), log(maximumPendantLength_), tolerance_, ll);
+      if (ll > pl.logLikelihood)
+      {
+        pl.pendantLength = exp(logPendant);
+        pl.logLikelihood = ll;
+      }
+      computePendantArray_(model, profile, pl.pendantLength, pendant);
+
+      double distal = goldenSectionMaximum([&](double d)
+        {
+          computeMiddleArray_(model, branch, d, middle);
+          return getLogLikelihood_(middle, pendant);
+        }, 0, branch.length, tolerance_, ll);
+      if (ll > pl.logLikelihood)
+      {
+        pl.distalLength = distal;
+        pl.logLikelihood = ll;
+      }
+
+      if (pl.logLikelihood - previous < tolerance_
+          && abs(pl.pendantLength - previousPendant) < tolerance_
+          && abs(pl.distalLength - previousDistal) < tolerance_)
+        break;
+    }
+  }
+
+  sort(placements.begin(), placements.end(),
+       [](const Placement& p1, const Placement& p2) { return p1.logLikelihood > p2.logLikelihood; });
+
+  // Likelihood weight ratios of the candidates:
+  if (nbCandidates > 0)
+  {
+    double sum = 0;
+    for (size_t k = 0; k < nbCandidates; k++)
+    {
+      placements[k].likelihoodWeightRatio = exp(placements[k].logLikelihood - placements[0].logLikelihood);
+      sum += placements[k].likelihoodWeightRatio;
+    }
+    for (size_t k = 0; k < nbCandidates; k++)
+      placements[k].likelihoodWeightRatio /= sum;
+  }
+
+  return placements;
+}
+
+/******************************************************************************/
+
+void EvolutionaryPlacement::computeTransitionProbabilities_(const TransitionModel& model, double length, VVVdouble& pxy) const
+{
+  pxy.resize(nbClasses_);
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    const Matrix<double>& Q = model.getPij_t(length * rates_[c]);
+    pxy[c].resize(nbStates_);
+    for (size_t x = 0; x < nbStates_; x++)
+    {
+      pxy[c][x].resize(nbStates_);
+      for (size_t y = 0; y < nbStates_; y++)
+        pxy[c][x][y] = Q(x, y);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void EvolutionaryPlacement::computeMiddleArray_(const TransitionModel& model, const Branch_& branch, double distalLength, VVVdouble& middle) const
+{
+  VVVdouble pAbove, pBelow;
+  computeTransitionProbabilities_(model, max(0., branch.length - distalLength), pAbove);
+  computeTransitionProbabilities_(model, distalLength, pBelow);
+
+  middle.resize(nbDistinctSites_);
+  for (size_t i = 0; i < nbDistinctSites_; i++)
+  {
+    middle[i].resize(nbClasses_);
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      const Vdouble* above_i_c = &branch.above[i][c];
+      const Vdouble* below_i_c = &branch.below[i][c];
+      Vdouble* middle_i_c = &middle[i][c];
+      middle_i_c->resize(nbStates_);
+      for (size_t z = 0; z < nbStates_; z++)
+      {
+        // From the father to the attachment point, and from there to the node:
+        double u = 0, v = 0;
+        for (size_t x = 0; x < nbStates_; x++)
+        {
+          u += (*above_i_c)[x] * pAbove[c][x][z];
+          v += pBelow[c][z][x] * (*below_i_c)[x];
+        }
+        (*middle_i_c)[z] = u * v;
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+void EvolutionaryPlacement::computePendantArray_(const TransitionModel& model, const VVdouble& profile, double pendantLength, VVVdouble& pendant) const
+{
+  VVVdouble pxy;
+  computeTransitionProbabilities_(model, pendantLength, pxy);
+
+  pendant.resize(nbSites_);
+  for (size_t i = 0; i < nbSites_; i++)
+  {
+    pendant[i].resize(nbClasses_);
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      Vdouble* pendant_i_c = &pendant[i][c];
+      pendant_i_c->resize(nbStates_);
+      for (size_t z = 0; z < nbStates_; z++)
+      {
+        double w = 0;
+        for (size_t y = 0; y < nbStates_; y++)
+          w += pxy[c][z][y] * profile[i][y];
+        (*pendant_i_c)[z] = w;
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+double EvolutionaryPlacement::getLogLikelihood_(const VVVdouble& middle, const VVVdouble& pendant) const
+{
+  double ll = 0;
+  for (size_t i = 0; i < nbSites_; i++)
+  {
+    const VVdouble* middle_i = &middle[rootPatternLinks_[i]];
+    const VVdouble* pendant_i = &pendant[i];
+    double l = 0;
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      const Vdouble* middle_i_c = &(*middle_i)[c];
+      const Vdouble* pendant_i_c = &(*pendant_i)[c];
+      double lc = 0;
+      for (size_t z = 0; z < nbStates_; z++)
+        lc += (*middle_i_c)[z] * (*pendant_i_c)[z];
+      l += probs_[c] * lc;
+    }
+    ll += log(l);
+  }
+  return ll;
+}
+
+/******************************************************************************/
+
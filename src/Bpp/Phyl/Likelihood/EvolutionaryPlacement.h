@@ -0,0 +1,211 @@
+//
+// File: EvolutionaryPlacement.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _EVOLUTIONARYPLACEMENT_H_
+#define _EVOLUTIONARYPLACEMENT_H_
+
+#include "DRHomogeneousTreeLikelihood.h"
+
+#include <Bpp/Seq/Container/AlignedValuesContainer.h>
+
+// From the STL:
+#include <memory>
+#include <vector>
+
+namespace bpp
+{
+
+  /**
+   * @brief Place query sequences on the branches of a fixed reference tree.
+   *
+   * The conditional likelihood arrays of both sides of every branch are
+   * taken once from a double-recursive likelihood of the reference tree
+   * and kept. A query grafted on a branch at a given distance from the
+   * node (distal length), with a given pendant length, is then scored by
+   * a single three-way product of the two directional arrays and of the
+   * query profile propagated along the pendant branch, without building
+   * or evaluating a new tree.
+   *
+   * Each query is first scored on all branches, grafted at their middle
+   * with a default pendant length. The pendant and distal lengths of the
+   * best candidate branches are then optimized in turn, the rest of the
+   * tree being fixed, and the candidates are returned sorted by their
+   * log-likelihood, with their likelihood weight ratios.
+   *
+   * Queries must be aligned to the reference data. As two identical
+   * reference sites may differ in a query, query sites are not compressed,
+   * but reference arrays are shared by all sites with the same pattern.
+   *
+   * The reference arrays are copied: the reference likelihood is not used
+   * after construction, and queries may be placed concurrently.
+   */
+  class EvolutionaryPlacement
+  {
+  public:
+    struct Placement
+    {
+      /**
+       * @brief The id of the node below the branch.
+       */
+      int nodeId;
+
+      /**
+       * @brief The distance from the node to the attachment point.
+       */
+      double distalLength;
+
+      double pendantLength;
+      double logLikelihood;
+      double likelihoodWeightRatio;
+
+      Placement() : nodeId(-1), distalLength(0), pendantLength(0), logLikelihood(0), likelihoodWeightRatio(0) {}
+    };
+
+  private:
+    struct Branch_
+    {
+      int nodeId;
+      double length;
+      // Arrays at the father for the rest of the tree, and at the node for its subtree:
+      VVVdouble above;
+      VVVdouble below;
+      // Product of both arrays propagated to the middle of the branch:
+      VVVdouble middle;
+    };
+
+    std::unique_ptr<TransitionModel> model_;
+    Vdouble rates_;
+    Vdouble probs_;
+    std::vector<size_t> rootPatternLinks_;
+    size_t nbSites_;
+    size_t nbDistinctSites_;
+    size_t nbClasses_;
+    size_t nbStates_;
+    std::vector<Branch_> branches_;
+
+    double minimumBrLen_;
+    double maximumPendantLength_;
+    double initialPendantLength_;
+    size_t nbCandidates_;
+    double tolerance_;
+    unsigned int maxNbRounds_;
+
+  public:
+    /**
+     * @param reference An initialized likelihood of the reference tree,
+     * with up to date arrays. It is only used in the constructor.
+     * @throw Exception If the likelihood is not initialized.
+     */
+    EvolutionaryPlacement(const DRHomogeneousTreeLikelihood& reference);
+
+    EvolutionaryPlacement(const EvolutionaryPlacement& ep) = delete;
+    EvolutionaryPlacement& operator=(const EvolutionaryPlacement& ep) = delete;
+
+    virtual ~EvolutionaryPlacement() {}
+
+  public:
+    size_t getNumberOfBranches() const { return branches_.size(); }
+
+    /**
+     * @brief Set the pendant length used to score all branches (0.1 by default).
+     */
+    void setInitialPendantLength(double length) { initialPendantLength_ = length; }
+
+    /**
+     * @brief Set the largest pendant length considered (10 by default).
+     */
+    void setMaximumPendantLength(double length) { maximumPendantLength_ = length; }
+
+    /**
+     * @brief Set the number of best branches on which lengths are optimized
+     * and which are returned (5 by default).
+     */
+    void setNumberOfCandidates(size_t nbCandidates) { nbCandidates_ = nbCandidates; }
+
+    /**
+     * @brief Set the tolerance on lengths, and the maximum number of rounds
+     * of pendant and distal length optimizations (1e-4 and 3 by default).
+     */
+    void setOptimizationParameters(double tolerance, unsigned int maxNbRounds)
+    {
+      tolerance_ = tolerance;
+      maxNbRounds_ = maxNbRounds;
+    }
+
+    /**
+     * @brief Place all the sequences of a container.
+     *
+     * @param queries The query sequences, aligned to the reference data.
+     * @param nbThreads The number of queries placed concurrently.
+     * @return For each query, in the order of the container, the best
+     * placements, best first.
+     * @throw Exception If the queries do not have as many sites as the reference data.
+     */
+    std::vector< std::vector<Placement> > place(const AlignedValuesContainer& queries, size_t nbThreads = 1) const;
+
+  private:
+    /**
+     * @brief Place one query, given its profile in [site][state].
+     */
+    std::vector<Placement> place_(const TransitionModel& model, const VVdouble& profile) const;
+
+    /**
+     * @brief Compute the transition probabilities in [class][x][y] for a branch length.
+     */
+    void computeTransitionProbabilities_(const TransitionModel& model, double length, VVVdouble& pxy) const;
+
+    /**
+     * @brief Compute the product of the arrays of a branch, propagated to
+     * the attachment point, in [distinct site][class][state].
+     */
+    void computeMiddleArray_(const TransitionModel& model, const Branch_& branch, double distalLength, VVVdouble& middle) const;
+
+    /**
+     * @brief Compute the query profile propagated along the pendant
+     * branch, in [site][class][state].
+     */
+    void computePendantArray_(const TransitionModel& model, const VVdouble& profile, double pendantLength, VVVdouble& pendant) const;
+
+    double getLogLikelihood_(const VVVdouble& middle, const VVVdouble& pendant) const;
+  };
+
+} // end of namespace bpp.
+
+#endif // _EVOLUTIONARYPLACEMENT_H_
+
@@ -56,9 +56,32 @@ void GlobalClockTreeLikelihoodFunctionWrapper::fireParameterChanged(const bpp::P
   if (recomputeHeights)
   {
     TreeTemplate<Node> tree(tl_->getTree());
-    computeBranchLengthsFromHeights_(tree.getRootNode(), getParameter("TotalHeight").getValue(), pl2);
+    ParameterList brlenPl;
+    computeBranchLengthsFromHeights_(tree.getRootNode(), getParameter("TotalHeight").getValue(), brlenPl);
+    // Only pass the branch lengths which actually changed, so that the other ones are not updated:
+    for (unsigned int i = 0; i < brlenPl.size(); ++i)
+    {
+      if (brlenPl[i].getValue() != tl_->getParameter(brlenPl[i].getName()).getValue())
+        pl2.addParameter(brlenPl[i]);
+    }
   }
-  tl_->setParameters(pl2);
+  heightDerivativesUp2Date_ = false;
+  if (pl2.size() > 0)
+    tl_->setParameters(pl2);
+}
+
+double GlobalClockTreeLikelihoodFunctionWrapper::getFirstOrderDerivative(const std::string& variable) const
+{
+  if (variable.substr(0, 7) != "HeightP" && variable != "TotalHeight")
+    return tl_->getFirstOrderDerivative(variable);
+  if (!heightDerivativesUp2Date_)
+  {
+    heightDerivatives_.clear();
+    TreeTemplate<Node> tree(tl_->getTree());
+    heightDerivatives_["TotalHeight"] = computeHeightDerivatives_(tree.getRootNode(), getParameter("TotalHeight").getValue());
+    heightDerivativesUp2Date_ = true;
+  }
+  return heightDerivatives_[variable];
 }
 
 ParameterList GlobalClockTreeLikelihoodFunctionWrapper::getHeightParameters() const
@@ -103,6 +126,29 @@ void GlobalClockTreeLikelihoodFunctionWrapper::initParameters_()
   fireParameterChanged(getParameters());
 }
 
+double GlobalClockTreeLikelihoodFunctionWrapper::computeHeightDerivatives_(const Node* node, double height) const
+{
+  // Lengths of the branches below the node increase with its height, the one above decreases:
+  double d = 0;
+  if (node->hasFather())
+    d -= tl_->getFirstOrderDerivative("BrLen" + TextTools::toString(node->getId()));
+  for (unsigned int i = 0; i < node->getNumberOfSons(); i++)
+  {
+    const Node* son = node->getSon(i);
+    d += tl_->getFirstOrderDerivative("BrLen" + TextTools::toString(son->getId()));
+    if (!son->isLeaf())
+    {
+      // The height of the son is HeightP * height:
+      std::string name = "HeightP" + TextTools::toString(son->getId());
+      double sonHeightP = getParameter(name).getValue();
+      double dSon = computeHeightDerivatives_(son, sonHeightP * height);
+      heightDerivatives_[name] = height * dSon;
+      d += sonHeightP * dSon;
+    }
+  }
+  return d;
+}
+
 void GlobalClockTreeLikelihoodFunctionWrapper::computeBranchLengthsFromHeights_(const Node* node, double height, ParameterList& brlenPl)
 {
   for (unsigned int i = 0; i < node->getNumberOfSons(); i++)
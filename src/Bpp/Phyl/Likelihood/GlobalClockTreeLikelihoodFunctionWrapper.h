@@ -42,6 +42,9 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "TreeLikelihood.h"
 
+// From the STL:
+#include <map>
+
 namespace bpp
 {
 
@@ -52,21 +55,33 @@ class GlobalClockTreeLikelihoodFunctionWrapper:
   private:
     TreeLikelihood* tl_;
 
+    /**
+     * @brief Derivatives with respect to the height parameters, for the current parameter values.
+     */
+    mutable std::map<std::string, double> heightDerivatives_;
+    mutable bool heightDerivativesUp2Date_;
+
   public:
     GlobalClockTreeLikelihoodFunctionWrapper(TreeLikelihood* tl):
       AbstractParametrizable(""),
-      tl_(tl)
+      tl_(tl),
+      heightDerivatives_(),
+      heightDerivativesUp2Date_(false)
     {
       initParameters_();
     }
 
     GlobalClockTreeLikelihoodFunctionWrapper(const GlobalClockTreeLikelihoodFunctionWrapper& gctlfw):
-      AbstractParametrizable(gctlfw), tl_(gctlfw.tl_)
+      AbstractParametrizable(gctlfw), tl_(gctlfw.tl_),
+      heightDerivatives_(gctlfw.heightDerivatives_),
+      heightDerivativesUp2Date_(gctlfw.heightDerivativesUp2Date_)
     {}
     
     GlobalClockTreeLikelihoodFunctionWrapper& operator=(const GlobalClockTreeLikelihoodFunctionWrapper& gctlfw) {
       AbstractParametrizable::operator=(gctlfw);
       tl_ = gctlfw.tl_;
+      heightDerivatives_ = gctlfw.heightDerivatives_;
+      heightDerivativesUp2Date_ = gctlfw.heightDerivativesUp2Date_;
       return *this;
     }
 
@@ -88,13 +103,22 @@ class GlobalClockTreeLikelihoodFunctionWrapper:
     bool enableFirstOrderDerivatives() const { return tl_->enableFirstOrderDerivatives(); }
     double getSecondOrderDerivative(const std::string& variable1, const std::string& variable2) const { return tl_->getSecondOrderDerivative(variable1, variable2); }
     double getSecondOrderDerivative(const std::string& variable) const { return tl_->getSecondOrderDerivative(variable); }
-    double getFirstOrderDerivative(const std::string& variable) const { return tl_->getFirstOrderDerivative(variable); } 
+
+    /**
+     * @brief First order derivative of the function.
+     *
+     * Derivatives with respect to heights are obtained by the chain rule from
+     * the derivatives of the wrapped function with respect to each branch length.
+     * They are computed all at once, and kept until parameters change.
+     */
+    double getFirstOrderDerivative(const std::string& variable) const;
 
     ParameterList getHeightParameters() const;
 
   private:
     void initParameters_();
     void computeBranchLengthsFromHeights_(const Node* node, double height, ParameterList& brlenPl);
+    double computeHeightDerivatives_(const Node* node, double height) const;
 
 };
 
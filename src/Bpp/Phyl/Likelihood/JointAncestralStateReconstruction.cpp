@@ -0,0 +1,135 @@
+//
+// File: JointAncestralStateReconstruction.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "JointAncestralStateReconstruction.h"
+
+using namespace bpp;
+
+// From the STL:
+#include <cmath>
+
+using namespace std;
+
+/******************************************************************************/
+
+JointAncestralStateReconstruction::JointAncestralStateReconstruction(const DRTreeLikelihood* drl, size_t nbThreads) :
+  AbstractJointAncestralStateReconstruction(drl->getAlphabet(), nbThreads)
+{
+  const DRASDRTreeLikelihoodData* data = drl->getLikelihoodData();
+  nbSites_          = data->getNumberOfSites();
+  nbDistinctSites_  = data->getNumberOfDistinctSites();
+  nbClasses_        = data->getNumberOfClasses();
+  nbStates_         = data->getNumberOfStates();
+  rootPatternLinks_ = data->getRootArrayPositions();
+
+  TreeTemplate<Node> tree(drl->getTree());
+  size_t nbNodes = tree.getNumberOfNodes();
+  nodeIds_.resize(nbNodes);
+  fathers_.resize(nbNodes);
+  isLeaf_.resize(nbNodes);
+  names_.resize(nbNodes);
+  logPxy_.resize(nbNodes * nbClasses_ * nbStates_ * nbStates_);
+  logLeaves_.resize(nbNodes);
+
+  size_t index = 0;
+  addNodes_(drl, tree.getRootNode(), index);
+  fathers_[nbNodes - 1] = nbNodes;
+
+  const vector<double>& freqs = drl->getRootFrequencies(0);
+  logRootFreqs_.resize(nbStates_);
+  for (size_t x = 0; x < nbStates_; ++x)
+    logRootFreqs_[x] = log(freqs[x]);
+
+  vector<double> probs = drl->getRateDistribution()->getProbabilities();
+  logClassProbs_.resize(nbClasses_);
+  for (size_t c = 0; c < nbClasses_; ++c)
+    logClassProbs_[c] = log(probs[c]);
+
+  const TransitionModel* model = drl->getModelForSite(tree.getNodesId()[0], 0); // We assume all nodes have a model with the same number of states.
+  alphabetStates_.resize(nbStates_);
+  for (size_t x = 0; x < nbStates_; ++x)
+    alphabetStates_[x] = model->getAlphabetStateAsInt(x);
+
+  reconstruct_();
+}
+
+/******************************************************************************/
+
+void JointAncestralStateReconstruction::addNodes_(const DRTreeLikelihood* drl, const Node* node, size_t& index)
+{
+  vector<size_t> sons(node->getNumberOfSons());
+  for (size_t i = 0; i < node->getNumberOfSons(); i++)
+  {
+    addNodes_(drl, node->getSon(i), index);
+    sons[i] = index - 1;
+  }
+
+  size_t k = index++;
+  int nodeId = node->getId();
+  nodeIds_[k] = nodeId;
+  isLeaf_[k] = node->isLeaf();
+  names_[k] = node->hasName() ? node->getName() : "";
+  for (size_t i = 0; i < sons.size(); i++)
+    fathers_[sons[i]] = k;
+
+  if (node->isLeaf())
+  {
+    const VVdouble& larray = drl->getLikelihoodData()->getLeafLikelihoods(nodeId);
+    vector<double>& leaf = logLeaves_[k];
+    leaf.resize(nbDistinctSites_ * nbStates_);
+    for (size_t i = 0; i < nbDistinctSites_; i++)
+      for (size_t y = 0; y < nbStates_; y++)
+        leaf[i * nbStates_ + y] = log(larray[i][y]);
+  }
+
+  if (node->hasFather())
+  {
+    VVVdouble pxy = drl->getTransitionProbabilitiesPerRateClass(nodeId, 0);
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      double* pxy_c = &logPxy_[(k * nbClasses_ + c) * nbStates_ * nbStates_];
+      for (size_t x = 0; x < nbStates_; x++)
+        for (size_t y = 0; y < nbStates_; y++)
+          pxy_c[x * nbStates_ + y] = log(pxy[c][x][y]);
+    }
+  }
+}
+
+/******************************************************************************/
+
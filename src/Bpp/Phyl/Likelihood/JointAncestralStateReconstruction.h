@@ -0,0 +1,80 @@
+//
+// File: JointAncestralStateReconstruction.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _JOINTANCESTRALSTATERECONSTRUCTION_H_
+#define _JOINTANCESTRALSTATERECONSTRUCTION_H_
+
+#include "../AbstractJointAncestralStateReconstruction.h"
+#include "DRTreeLikelihood.h"
+#include "../Tree/TreeTemplate.h"
+
+namespace bpp
+{
+
+/**
+ * @brief Joint likelihood ancestral states reconstruction for
+ * double-recursive likelihood objects.
+ *
+ * States are computed once, when the object is built, from the current
+ * parameter values of the likelihood object.
+ *
+ * @see AbstractJointAncestralStateReconstruction
+ */
+  class JointAncestralStateReconstruction:
+    public AbstractJointAncestralStateReconstruction
+  {
+  public:
+    /**
+     * @param drl       The likelihood object, which must be up to date.
+     * @param nbThreads The number of threads over which sites are shared.
+     */
+    JointAncestralStateReconstruction(const DRTreeLikelihood* drl, size_t nbThreads = 1);
+
+    JointAncestralStateReconstruction* clone() const { return new JointAncestralStateReconstruction(*this); }
+
+    virtual ~JointAncestralStateReconstruction() {}
+
+  private:
+    void addNodes_(const DRTreeLikelihood* drl, const Node* node, size_t& index);
+  };
+
+} // end of namespace bpp.
+
+#endif // _JOINTANCESTRALSTATERECONSTRUCTION_H_
+
@@ -0,0 +1,166 @@
+//
+// File: MemoryUsage.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _MEMORYUSAGE_H_
+#define _MEMORYUSAGE_H_
+
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Text/TextTools.h>
+
+// From the STL:
+#include <vector>
+#include <map>
+#include <string>
+
+namespace bpp
+{
+
+/**
+ * @brief Memory accounting of likelihood and mapping objects.
+ *
+ * Objects holding large arrays report the number of bytes they own,
+ * by category, through a getMemoryUsage(MemoryUsage&) method. Usage is
+ * accumulated only when queried, so that the accounting costs nothing
+ * during computations.
+ *
+ * Sizes are estimated from the capacity of the containers, and include
+ * the node overhead of maps, but not the allocator book-keeping.
+ */
+class MemoryUsage
+{
+  public:
+    enum Category {
+      LEAF_ARRAYS = 0,
+      INNER_ARRAYS,
+      DERIVATIVE_ARRAYS,
+      TRANSITION_MATRICES,
+      MAPPING_COUNTS,
+      OTHER,
+      NB_CATEGORIES
+    };
+
+  private:
+    std::vector<size_t> bytes_;
+
+  public:
+    MemoryUsage() : bytes_(NB_CATEGORIES, 0) {}
+
+  public:
+    static std::string getCategoryName(Category cat)
+    {
+      switch (cat)
+      {
+        case LEAF_ARRAYS: return "Leaf arrays";
+        case INNER_ARRAYS: return "Inner arrays";
+        case DERIVATIVE_ARRAYS: return "Derivative arrays";
+        case TRANSITION_MATRICES: return "Transition matrices";
+        case MAPPING_COUNTS: return "Mapping counts";
+        default: return "Other";
+      }
+    }
+
+    void add(Category cat, size_t bytes) { bytes_[cat] += bytes; }
+
+    void add(const MemoryUsage& usage)
+    {
+      for (size_t i = 0; i < bytes_.size(); ++i)
+        bytes_[i] += usage.bytes_[i];
+    }
+
+    size_t getBytes(Category cat) const { return bytes_[cat]; }
+
+    size_t getTotalBytes() const
+    {
+      size_t total = 0;
+      for (size_t i = 0; i < bytes_.size(); ++i)
+        total += bytes_[i];
+      return total;
+    }
+
+    /**
+     * @brief Print the non-empty categories and the total, in kB.
+     */
+    void display() const
+    {
+      for (size_t i = 0; i < bytes_.size(); ++i)
+      {
+        if (bytes_[i] > 0)
+          ApplicationTools::displayResult("Memory, " + getCategoryName(static_cast<Category>(i)),
+              TextTools::toString(static_cast<double>(bytes_[i]) / 1024., 6) + " kB");
+      }
+      ApplicationTools::displayResult("Memory, total",
+          TextTools::toString(static_cast<double>(getTotalBytes()) / 1024., 6) + " kB");
+    }
+
+    /**
+     * @name Heap size of containers.
+     *
+     * @return The number of bytes allocated on the heap by a container and
+     * its elements, recursively.
+     *
+     * @{
+     */
+    template<class T>
+    static size_t getHeapBytes(const T&) { return 0; }
+
+    template<class T>
+    static size_t getHeapBytes(const std::vector<T>& v)
+    {
+      size_t bytes = v.capacity() * sizeof(T);
+      for (size_t i = 0; i < v.size(); ++i)
+        bytes += getHeapBytes(v[i]);
+      return bytes;
+    }
+
+    template<class K, class T>
+    static size_t getHeapBytes(const std::map<K, T>& m)
+    {
+      // Red-black tree nodes hold three pointers and a colour besides the value.
+      size_t bytes = m.size() * (sizeof(std::pair<const K, T>) + 4 * sizeof(void*));
+      for (typename std::map<K, T>::const_iterator it = m.begin(); it != m.end(); ++it)
+        bytes += getHeapBytes(it->second);
+      return bytes;
+    }
+    /** @} */
+};
+
+} //end of namespace bpp.
+
+#endif //_MEMORYUSAGE_H_
+
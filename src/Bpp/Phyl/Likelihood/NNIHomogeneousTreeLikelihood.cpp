@@ -43,13 +43,46 @@
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/AutoParameter.h>
 
+#include <Eigen/Core>
+
 using namespace bpp;
 
 // From the STL:
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <memory>
 
 using namespace std;
 
+namespace
+{
+  typedef Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> > TransitionBlock;
+  typedef Eigen::Map<const Eigen::MatrixXd> LikelihoodBlock;
+
+  /*
+   * Copy array[i][c][x] into column-major nbStates x nbSites blocks, one per class.
+   */
+  void packLikelihoods(const VVVdouble& array, size_t nbClasses, size_t nbStates, vector<double>& packed)
+  {
+    size_t nbSites = array.size();
+    packed.resize(nbClasses * nbSites * nbStates);
+    for (size_t c = 0; c < nbClasses; c++)
+    {
+      double* block = &packed[c * nbSites * nbStates];
+      for (size_t i = 0; i < nbSites; i++)
+      {
+        const Vdouble* array_i_c = &array[i][c];
+        for (size_t x = 0; x < nbStates; x++)
+        {
+          block[i * nbStates + x] = (*array_i_c)[x];
+        }
+      }
+    }
+  }
+}
+
 /*******************************************************************************/
 void BranchLikelihood::initModel(const TransitionModel* model, const DiscreteDistribution* rDist)
 {
@@ -57,15 +90,17 @@ void BranchLikelihood::initModel(const TransitionModel* model, const DiscreteDis
   rDist_ = rDist;
   nbStates_ = model->getNumberOfStates();
   nbClasses_  = rDist->getNumberOfCategories();
-  pxy_.resize(nbClasses_);
-  for (size_t i = 0; i < nbClasses_; i++)
-  {
-    pxy_[i].resize(nbStates_);
-    for (size_t j = 0; j < nbStates_; j++)
-    {
-      pxy_[i][j].resize(nbStates_);
-    }
-  }
+  pxy_.resize(nbClasses_ * nbStates_ * nbStates_);
+}
+
+/*******************************************************************************/
+void BranchLikelihood::initLikelihoods(const VVVdouble* array1, const VVVdouble* array2)
+{
+  array1_ = array1;
+  array2_ = array2;
+  nbSites_ = array1->size();
+  packLikelihoods(*array1, nbClasses_, nbStates_, likelihoods1_);
+  packLikelihoods(*array2, nbClasses_, nbStates_, likelihoods2_);
 }
 
 /*******************************************************************************/
@@ -76,14 +111,13 @@ void BranchLikelihood::computeAllTransitionProbabilities()
   // Computes all pxy once for all:
   for (size_t c = 0; c < nbClasses_; c++)
   {
-    VVdouble* pxy__c = &pxy_[c];
+    double* pxy__c = &pxy_[c * nbStates_ * nbStates_];
     RowMatrix<double> Q = model_->getPij_t(l * rDist_->getCategory(c));
     for (size_t x = 0; x < nbStates_; x++)
     {
-      Vdouble* pxy__c_x = &(*pxy__c)[x];
       for (size_t y = 0; y < nbStates_; y++)
       {
-        (*pxy__c_x)[y] = Q(x, y);
+        pxy__c[x * nbStates_ + y] = Q(x, y);
       }
     }
   }
@@ -94,29 +128,80 @@ void BranchLikelihood::computeLogLikelihood()
 {
   lnL_ = 0;
 
-  vector<double> la(array1_->size());
-  for (size_t i = 0; i < array1_->size(); i++)
+  // Site likelihoods: for each class, the sum over x of array1[x] times
+  // (pxy * array2)[x], that is a product and a column-wise dot:
+  size_t blockSize = nbStates_ * nbSites_;
+  Eigen::ArrayXd Li = Eigen::ArrayXd::Zero(static_cast<Eigen::Index>(nbSites_));
+  Eigen::MatrixXd pa2(nbStates_, nbSites_);
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    TransitionBlock pxy(&pxy_[c * nbStates_ * nbStates_], nbStates_, nbStates_);
+    LikelihoodBlock a1(&likelihoods1_[c * blockSize], nbStates_, nbSites_);
+    LikelihoodBlock a2(&likelihoods2_[c * blockSize], nbStates_, nbSites_);
+    pa2.noalias() = pxy * a2;
+    Li += rDist_->getProbability(c) * a1.cwiseProduct(pa2).colwise().sum().transpose().array();
+  }
+
+  vector<double> la(nbSites_);
+  for (size_t i = 0; i < nbSites_; i++)
+  {
+    la[i] = weights_[i] * log(Li(static_cast<Eigen::Index>(i)));
+  }
+
+  sort(la.begin(), la.end());
+  for (size_t i = nbSites_; i > 0; i--)
+  {
+    lnL_ -= la[i - 1];
+  }
+}
+
+/*******************************************************************************/
+double BranchLikelihood::getNewtonLength(double minimum, double maximum) const
+{
+  double l = getParameterValue("BrLen");
+
+  size_t blockSize = nbStates_ * nbSites_;
+  Eigen::ArrayXd Li = Eigen::ArrayXd::Zero(static_cast<Eigen::Index>(nbSites_));
+  Eigen::ArrayXd dLi = Li, d2Li = Li;
+  Eigen::MatrixXd dpxy(nbStates_, nbStates_), d2pxy(nbStates_, nbStates_), pa2(nbStates_, nbSites_);
+  for (size_t c = 0; c < nbClasses_; c++)
   {
-    double Li = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
+    double rc = rDist_->getCategory(c);
+    double pc = rDist_->getProbability(c);
+    RowMatrix<double> dQ = model_->getdPij_dt(l * rc);
+    RowMatrix<double> d2Q = model_->getd2Pij_dt2(l * rc);
+    for (size_t x = 0; x < nbStates_; x++)
     {
-      double rc = rDist_->getProbability(c);
-      for (size_t x = 0; x < nbStates_; x++)
+      for (size_t y = 0; y < nbStates_; y++)
       {
-        for (size_t y = 0; y < nbStates_; y++)
-        {
-          Li += rc * (*array1_)[i][c][x] * pxy_[c][x][y] * (*array2_)[i][c][y];
-        }
+        dpxy(x, y) = rc * dQ(x, y);
+        d2pxy(x, y) = rc * rc * d2Q(x, y);
       }
     }
-    la[i] = weights_[i] * log(Li);
+
+    TransitionBlock pxy(&pxy_[c * nbStates_ * nbStates_], nbStates_, nbStates_);
+    LikelihoodBlock a1(&likelihoods1_[c * blockSize], nbStates_, nbSites_);
+    LikelihoodBlock a2(&likelihoods2_[c * blockSize], nbStates_, nbSites_);
+    pa2.noalias() = pxy * a2;
+    Li += pc * a1.cwiseProduct(pa2).colwise().sum().transpose().array();
+    pa2.noalias() = dpxy * a2;
+    dLi += pc * a1.cwiseProduct(pa2).colwise().sum().transpose().array();
+    pa2.noalias() = d2pxy * a2;
+    d2Li += pc * a1.cwiseProduct(pa2).colwise().sum().transpose().array();
   }
 
-  sort(la.begin(), la.end());
-  for (size_t i = array1_->size(); i > 0; i--)
+  double d1 = 0, d2 = 0;
+  for (size_t i = 0; i < nbSites_; i++)
   {
-    lnL_ -= la[i - 1];
+    Eigen::Index k = static_cast<Eigen::Index>(i);
+    double ri = dLi(k) / Li(k);
+    d1 += weights_[i] * ri;
+    d2 += weights_[i] * (d2Li(k) / Li(k) - ri * ri);
   }
+
+  if (d2 >= 0 || std::isnan(d2))
+    return l;
+  return std::min(std::max(l - d1 / d2, minimum), maximum);
 }
 
 /******************************************************************************/
@@ -131,7 +216,9 @@ NNIHomogeneousTreeLikelihood::NNIHomogeneousTreeLikelihood(
   brLikFunction_(0),
   brentOptimizer_(0),
   brLenNNIValues_(),
-  brLenNNIParams_()
+  brLenSPRValues_(),
+  brLenNNIParams_(),
+  nniScreeningThreshold_(std::numeric_limits<double>::infinity())
 {
   brentOptimizer_ = new BrentOneDimension();
   brentOptimizer_->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
@@ -153,7 +240,9 @@ NNIHomogeneousTreeLikelihood::NNIHomogeneousTreeLikelihood(
   brLikFunction_(0),
   brentOptimizer_(0),
   brLenNNIValues_(),
-  brLenNNIParams_()
+  brLenSPRValues_(),
+  brLenNNIParams_(),
+  nniScreeningThreshold_(std::numeric_limits<double>::infinity())
 {
   brentOptimizer_ = new BrentOneDimension();
   brentOptimizer_->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
@@ -171,12 +260,16 @@ NNIHomogeneousTreeLikelihood::NNIHomogeneousTreeLikelihood(const NNIHomogeneousT
   brLikFunction_(0),
   brentOptimizer_(0),
   brLenNNIValues_(),
-  brLenNNIParams_()
+  brLenSPRValues_(),
+  brLenNNIParams_(),
+  nniScreeningThreshold_(std::numeric_limits<double>::infinity())
 {
   brLikFunction_  = dynamic_cast<BranchLikelihood*>(lik.brLikFunction_->clone());
   brentOptimizer_ = dynamic_cast<BrentOneDimension*>(lik.brentOptimizer_->clone());
   brLenNNIValues_ = lik.brLenNNIValues_;
+  brLenSPRValues_ = lik.brLenSPRValues_;
   brLenNNIParams_ = lik.brLenNNIParams_;
+  nniScreeningThreshold_ = lik.nniScreeningThreshold_;
 }
 
 /******************************************************************************/
@@ -189,7 +282,9 @@ NNIHomogeneousTreeLikelihood& NNIHomogeneousTreeLikelihood::operator=(const NNIH
   if (brentOptimizer_) delete brentOptimizer_;
   brentOptimizer_ = dynamic_cast<BrentOneDimension*>(lik.brentOptimizer_->clone());
   brLenNNIValues_ = lik.brLenNNIValues_;
+  brLenSPRValues_ = lik.brLenSPRValues_;
   brLenNNIParams_ = lik.brLenNNIParams_;
+  nniScreeningThreshold_ = lik.nniScreeningThreshold_;
   return *this;
 }
 
@@ -203,6 +298,51 @@ NNIHomogeneousTreeLikelihood::~NNIHomogeneousTreeLikelihood()
 
 /******************************************************************************/
 double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const
+{
+  double brLen;
+  double diff = testNNI_(nodeId, *brLikFunction_, *brentOptimizer_, model_, brLen);
+  brLenNNIValues_[nodeId] = brLen;
+  return diff;
+}
+
+/******************************************************************************/
+void NNIHomogeneousTreeLikelihood::testNNIs(const vector<int>& nodeIds, vector<double>& diffs) const
+{
+  // With a memory budget, testing a NNI may recompute and release upper arrays,
+  // which other candidates are reading: they are tested one after the other.
+  if (getNumberOfThreads() <= 1 || getMemoryBudget() > 0)
+  {
+    NNISearchable::testNNIs(nodeIds, diffs);
+    return;
+  }
+
+  // Each block of candidates gets its own branch function, optimizer and model,
+  // since the model caches its transition matrices:
+  diffs.resize(nodeIds.size());
+  vector<double> brLens(nodeIds.size());
+  runParallelLoop_(nodeIds.size(), [&](size_t first, size_t last)
+  {
+    unique_ptr<BranchLikelihood> brLik(brLikFunction_->clone());
+    unique_ptr<BrentOneDimension> optimizer(dynamic_cast<BrentOneDimension*>(brentOptimizer_->clone()));
+    unique_ptr<TransitionModel> model(model_->clone());
+    for (size_t i = first; i < last; i++)
+    {
+      diffs[i] = testNNI_(nodeIds[i], *brLik, *optimizer, model.get(), brLens[i]);
+    }
+  });
+  for (size_t i = 0; i < nodeIds.size(); i++)
+  {
+    brLenNNIValues_[nodeIds[i]] = brLens[i];
+  }
+}
+
+/******************************************************************************/
+double NNIHomogeneousTreeLikelihood::testNNI_(
+  int nodeId,
+  BranchLikelihood& brLikFunction,
+  BrentOneDimension& brentOptimizer,
+  const TransitionModel* model,
+  double& brLenValue) const
 {
   const Node* son    = tree_->getNode(nodeId);
   if (!son->hasFather()) throw NodePException("DRHomogeneousTreeLikelihood::testNNI(). Node 'son' must not be the root node.", son);
@@ -217,8 +357,7 @@ double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const
   const Node* uncle = grandFather->getSon(parentPosition > 1 ? 0 : 1 - parentPosition);
 
   // Retrieving arrays of interest:
-  const DRASDRTreeLikelihoodNodeData* parentData = &getLikelihoodData()->getNodeData(parent->getId());
-  const VVVdouble* sonArray   = &parentData->getLikelihoodArrayForNeighbor(son->getId());
+  const VVVdouble* sonArray   = &getLikelihoodArrayForNeighbor_(parent, son->getId());
   vector<const Node*> parentNeighbors = TreeTemplateTools::getRemainingNeighbors(parent, grandFather, son);
   size_t nbParentNeighbors = parentNeighbors.size();
   vector<const VVVdouble*> parentArrays(nbParentNeighbors);
@@ -226,14 +365,13 @@ double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const
   for (size_t k = 0; k < nbParentNeighbors; k++)
   {
     const Node* n = parentNeighbors[k]; // This neighbor
-    parentArrays[k] = &parentData->getLikelihoodArrayForNeighbor(n->getId());
+    parentArrays[k] = &getLikelihoodArrayForNeighbor_(parent, n->getId());
     // if(n != grandFather) parentTProbs[k] = & pxy_[n->getId()];
     // else                 parentTProbs[k] = & pxy_[parent->getId()];
-    parentTProbs[k] = &pxy_[n->getId()];
+    parentTProbs[k] = &pxy_.at(n->getId());
   }
 
-  const DRASDRTreeLikelihoodNodeData* grandFatherData = &getLikelihoodData()->getNodeData(grandFather->getId());
-  const VVVdouble* uncleArray      = &grandFatherData->getLikelihoodArrayForNeighbor(uncle->getId());
+  const VVVdouble* uncleArray      = &getLikelihoodArrayForNeighbor_(grandFather, uncle->getId());
   vector<const Node*> grandFatherNeighbors = TreeTemplateTools::getRemainingNeighbors(grandFather, parent, uncle);
   size_t nbGrandFatherNeighbors = grandFatherNeighbors.size();
   vector<const VVVdouble*> grandFatherArrays;
@@ -243,8 +381,8 @@ double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const
     const Node* n = grandFatherNeighbors[k]; // This neighbor
     if (grandFather->getFather() == NULL || n != grandFather->getFather())
     {
-      grandFatherArrays.push_back(&grandFatherData->getLikelihoodArrayForNeighbor(n->getId()));
-      grandFatherTProbs.push_back(&pxy_[n->getId()]);
+      grandFatherArrays.push_back(&getLikelihoodArrayForNeighbor_(grandFather, n->getId()));
+      grandFatherTProbs.push_back(&pxy_.at(n->getId()));
     }
   }
 
@@ -252,10 +390,10 @@ double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const
   VVVdouble array1 = *sonArray;
   resetLikelihoodArray(array1);
   grandFatherArrays.push_back(sonArray);
-  grandFatherTProbs.push_back(&pxy_[son->getId()]);
+  grandFatherTProbs.push_back(&pxy_.at(son->getId()));
   if (grandFather->hasFather())
   {
-    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, &grandFatherData->getLikelihoodArrayForNeighbor(grandFather->getFather()->getId()), &pxy_[grandFather->getId()], array1, nbGrandFatherNeighbors, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, &getLikelihoodArrayForNeighbor_(grandFather, grandFather->getFather()->getId()), &pxy_.at(grandFather->getId()), array1, nbGrandFatherNeighbors, nbDistinctSites_, nbClasses_, nbStates_, false);
   }
   else
   {
@@ -278,12 +416,12 @@ double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const
   VVVdouble array2 = *uncleArray;
   resetLikelihoodArray(array2);
   parentArrays.push_back(uncleArray);
-  parentTProbs.push_back(&pxy_[uncle->getId()]);
+  parentTProbs.push_back(&pxy_.at(uncle->getId()));
   computeLikelihoodFromArrays(parentArrays, parentTProbs, array2, nbParentNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false);
 
   // Initialize BranchLikelihood:
-  brLikFunction_->initModel(model_, rateDistribution_);
-  brLikFunction_->initLikelihoods(&array1, &array2);
+  brLikFunction.initModel(model, rateDistribution_);
+  brLikFunction.initLikelihoods(&array1, &array2);
   ParameterList parameters;
   size_t pos = 0;
   while (pos < nodes_.size() && nodes_[pos]->getId() != parent->getId()) pos++;
@@ -291,21 +429,43 @@ double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const
   Parameter brLen = getParameter("BrLen" + TextTools::toString(pos));
   brLen.setName("BrLen");
   parameters.addParameter(brLen);
-  brLikFunction_->setParameters(parameters);
+  brLikFunction.setParameters(parameters);
+
+  // Screen the move with the current branch length and one Newton step:
+  if (nniScreeningThreshold_ < std::numeric_limits<double>::infinity())
+  {
+    double screenedLength = brLen.getValue();
+    double screenedValue = brLikFunction.getValue();
+    double newtonLength = brLikFunction.getNewtonLength(minimumBrLen_, maximumBrLen_);
+    if (newtonLength != screenedLength)
+    {
+      brLikFunction.setParameterValue("BrLen", newtonLength);
+      if (brLikFunction.getValue() < screenedValue)
+      {
+        screenedLength = newtonLength;
+        screenedValue = brLikFunction.getValue();
+      }
+    }
+    if (screenedValue - getValue() > nniScreeningThreshold_)
+    {
+      brLenValue = screenedLength;
+      brLikFunction.resetLikelihoods();
+      return screenedValue - getValue();
+    }
+  }
 
   // Re-estimate branch length:
-  brentOptimizer_->setFunction(brLikFunction_);
-  brentOptimizer_->getStopCondition()->setTolerance(0.1);
-  brentOptimizer_->setInitialInterval(brLen.getValue(), brLen.getValue() + 0.01);
-  brentOptimizer_->init(parameters);
-  brentOptimizer_->optimize();
-  // brLenNNIValues_[nodeId] = brLikFunction_->getParameterValue("BrLen");
-  brLenNNIValues_[nodeId] = brentOptimizer_->getParameters().getParameter("BrLen").getValue();
-  brLikFunction_->resetLikelihoods(); // Array1 and Array2 will be destroyed after this function call.
-                                      // We should not keep pointers towards them...
+  brentOptimizer.setFunction(&brLikFunction);
+  brentOptimizer.getStopCondition()->setTolerance(0.1);
+  brentOptimizer.setInitialInterval(brLen.getValue(), brLen.getValue() + 0.01);
+  brentOptimizer.init(parameters);
+  brentOptimizer.optimize();
+  brLenValue = brentOptimizer.getParameters().getParameter("BrLen").getValue();
+  brLikFunction.resetLikelihoods(); // Array1 and Array2 will be destroyed after this function call.
+                                    // We should not keep pointers towards them...
 
   // Return the resulting likelihood:
-  return brLikFunction_->getValue() - getValue();
+  return brLikFunction.getValue() - getValue();
 }
 
 /*******************************************************************************/
@@ -327,6 +487,7 @@ void NNIHomogeneousTreeLikelihood::doNNI(int nodeId)
   grandFather->removeSon(uncle);
   parent->addSon(uncle);
   grandFather->addSon(son);
+  invalidateLikelihoodOperations_();
   size_t pos = 0;
   while (pos < nodes_.size() && nodes_[pos]->getId() != parent->getId()) pos++;
   if (pos == nodes_.size()) throw Exception("NNIHomogeneousTreeLikelihood::doNNI. Unvalid node id.");
@@ -358,4 +519,195 @@ void NNIHomogeneousTreeLikelihood::doNNI(int nodeId)
 }
 
 /*******************************************************************************/
+void NNIHomogeneousTreeLikelihood::computeTransitionProbabilitiesForLength_(double length, VVVdouble& pxy) const
+{
+  pxy.resize(nbClasses_);
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    RowMatrix<double> Q = model_->getPij_t(length * rateDistribution_->getCategory(c));
+    pxy[c].resize(nbStates_);
+    for (size_t x = 0; x < nbStates_; x++)
+    {
+      pxy[c][x].resize(nbStates_);
+      for (size_t y = 0; y < nbStates_; y++)
+      {
+        pxy[c][x][y] = Q(x, y);
+      }
+    }
+  }
+}
+
+/*******************************************************************************/
+double NNIHomogeneousTreeLikelihood::testSPR(int nodeId, int targetId) const
+{
+  const Node* son    = tree_->getNode(nodeId);
+  const Node* target = tree_->getNode(targetId);
+  // The path from the pruning point (path[0]) to the regrafting branch (last two nodes):
+  vector<const Node*> path = TreeTemplateTools::getRegraftingPath(son, target);
+  size_t nbSteps = path.size() - 2;
+  const Node* parent  = path[0];
+  const Node* brother = TreeTemplateTools::getRemainingNeighbors(parent, son, path[1])[0];
+
+  // Once the subtree pruned, path[1] and brother are joined by a single branch:
+  const Node* lowerNode = (path[1]->getFather() == parent ? path[1] : brother);
+  VVVdouble mergedTProbs;
+  computeTransitionProbabilitiesForLength_(parent->getDistanceToFather() + lowerNode->getDistanceToFather(), mergedTProbs);
+
+  const VVVdouble* sonArray = &getLikelihoodArrayForNeighbor_(parent, son->getId());
+
+  // Conditional likelihoods of the pruned tree along the path, each array being at
+  // node path[i + 1] and computed from the previous one and from the arrays of the other neighbors:
+  vector<VVVdouble> stepArrays(nbSteps, *sonArray);
+  for (size_t i = 0; i < nbSteps; i++)
+  {
+    const Node* node = path[i + 1];
+    vector<const VVVdouble*> iLik;
+    vector<const VVVdouble*> tProb;
+    const VVVdouble* iLikR = 0;
+    const VVVdouble* tProbR = 0;
+
+    // The previous node on the path:
+    const VVVdouble* prevArray;
+    const VVVdouble* prevTProbs;
+    bool prevIsFather;
+    if (i == 0)
+    {
+      prevArray    = &getLikelihoodArrayForNeighbor_(parent, brother->getId());
+      prevTProbs   = &mergedTProbs;
+      prevIsFather = (lowerNode == node);
+    }
+    else
+    {
+      prevArray    = &stepArrays[i - 1];
+      prevIsFather = (node->getFather() == path[i]);
+      prevTProbs   = &pxy_[prevIsFather ? node->getId() : path[i]->getId()];
+    }
+    if (prevIsFather)
+    {
+      iLikR  = prevArray;
+      tProbR = prevTProbs;
+    }
+    else
+    {
+      iLik.push_back(prevArray);
+      tProb.push_back(prevTProbs);
+    }
+
+    // The other neighbors:
+    vector<const Node*> neighbors = TreeTemplateTools::getRemainingNeighbors(node, path[i], path[i + 2]);
+    for (size_t k = 0; k < neighbors.size(); k++)
+    {
+      const Node* n = neighbors[k];
+      if (node->hasFather() && n == node->getFather())
+      {
+        iLikR  = &getLikelihoodArrayForNeighbor_(node, n->getId());
+        tProbR = &pxy_[node->getId()];
+      }
+      else
+      {
+        iLik.push_back(&getLikelihoodArrayForNeighbor_(node, n->getId()));
+        tProb.push_back(&pxy_[n->getId()]);
+      }
+    }
+
+    if (iLikR)
+      computeLikelihoodFromArrays(iLik, tProb, iLikR, tProbR, stepArrays[i], iLik.size(), nbDistinctSites_, nbClasses_, nbStates_, true);
+    else
+      computeLikelihoodFromArrays(iLik, tProb, stepArrays[i], iLik.size(), nbDistinctSites_, nbClasses_, nbStates_, true);
+
+    if (!node->hasFather())
+    {
+      // This is the root node, we have to account for the ancestral frequencies:
+      for (size_t s = 0; s < nbDistinctSites_; s++)
+      {
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            stepArrays[i][s][c][x] *= rootFreqs_[x];
+          }
+        }
+      }
+    }
+  }
+
+  // The regrafted node splits the target branch in two halves:
+  const Node* endNode = path[nbSteps];
+  const Node* farNode = path[nbSteps + 1];
+  VVVdouble halfTProbs;
+  computeTransitionProbabilitiesForLength_(target->getDistanceToFather() / 2., halfTProbs);
+  const VVVdouble* endArray = &stepArrays[nbSteps - 1];
+  const VVVdouble* farArray = &getLikelihoodArrayForNeighbor_(endNode, farNode->getId());
+  vector<const VVVdouble*> iLik(1, farNode == target ? farArray : endArray);
+  vector<const VVVdouble*> tProb(1, &halfTProbs);
+  VVVdouble array1 = *sonArray;
+  computeLikelihoodFromArrays(iLik, tProb, farNode == target ? endArray : farArray, &halfTProbs, array1, 1, nbDistinctSites_, nbClasses_, nbStates_, true);
+
+  // Initialize BranchLikelihood:
+  brLikFunction_->initModel(model_, rateDistribution_);
+  brLikFunction_->initLikelihoods(&array1, sonArray);
+  ParameterList parameters;
+  size_t pos = 0;
+  while (pos < nodes_.size() && nodes_[pos]->getId() != son->getId()) pos++;
+  if (pos == nodes_.size()) throw Exception("NNIHomogeneousTreeLikelihood::testSPR. Unvalid node id.");
+  Parameter brLen = getParameter("BrLen" + TextTools::toString(pos));
+  brLen.setName("BrLen");
+  parameters.addParameter(brLen);
+  brLikFunction_->setParameters(parameters);
+
+  // Re-estimate branch length:
+  brentOptimizer_->setFunction(brLikFunction_);
+  brentOptimizer_->getStopCondition()->setTolerance(0.1);
+  brentOptimizer_->setInitialInterval(brLen.getValue(), brLen.getValue() + 0.01);
+  brentOptimizer_->init(parameters);
+  brentOptimizer_->optimize();
+  brLenSPRValues_[make_pair(nodeId, targetId)] = brentOptimizer_->getParameters().getParameter("BrLen").getValue();
+  brLikFunction_->resetLikelihoods(); // Array1 will be destroyed after this function call.
+
+  // Return the resulting likelihood:
+  return brLikFunction_->getValue() - getValue();
+}
+
+/*******************************************************************************/
+void NNIHomogeneousTreeLikelihood::doSPR(int nodeId, int targetId)
+{
+  // Perform the topological move, the likelihood array will have to be recomputed...
+  Node* son    = tree_->getNode(nodeId);
+  Node* target = tree_->getNode(targetId);
+  Node* parent = son->getFather();
+  if (!parent)
+    throw NodePException("NNIHomogeneousTreeLikelihood::doSPR(). Node 'son' must not be the root node.", son);
+  Node* brother = parent->getSon(parent->getSon(0) == son ? 1 : 0);
+  TreeTemplateTools::pruneAndRegraft(son, target);
+  invalidateLikelihoodOperations_();
+
+  setBranchLengthForTopologyChange_(brother, brother->getDistanceToFather());
+  setBranchLengthForTopologyChange_(parent, parent->getDistanceToFather());
+  setBranchLengthForTopologyChange_(target, target->getDistanceToFather());
+  map<pair<int, int>, double>::iterator it = brLenSPRValues_.find(make_pair(nodeId, targetId));
+  if (it != brLenSPRValues_.end())
+    setBranchLengthForTopologyChange_(son, it->second);
+}
+
+/*******************************************************************************/
+void NNIHomogeneousTreeLikelihood::setBranchLengthForTopologyChange_(Node* node, double length)
+{
+  size_t pos = 0;
+  while (pos < nodes_.size() && nodes_[pos]->getId() != node->getId()) pos++;
+  if (pos == nodes_.size()) throw Exception("NNIHomogeneousTreeLikelihood::setBranchLengthForTopologyChange_. Unvalid node id.");
+
+  string name = "BrLen" + TextTools::toString(pos);
+  brLenParameters_.setParameterValue(name, length);
+  getParameter_(name).setValue(length);
+  node->setDistanceToFather(length);
+  if (brLenNNIParams_.hasParameter(name))
+    brLenNNIParams_.setParameterValue(name, length);
+  else
+  {
+    brLenNNIParams_.addParameter(brLenParameters_.getParameter(name));
+    // In case of copy of this object, we must remove the constraint associated to this stored parameter:
+    brLenNNIParams_[brLenNNIParams_.size() - 1].removeConstraint();
+  }
+}
 
+/*******************************************************************************/
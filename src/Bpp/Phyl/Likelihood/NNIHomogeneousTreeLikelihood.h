@@ -41,7 +41,7 @@
 #define _NNIHOMOGENEOUSTREELIKELIHOOD_H_
 
 #include "DRHomogeneousTreeLikelihood.h"
-#include "../Tree/NNISearchable.h"
+#include "../Tree/SPRSearchable.h"
 
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Parametrizable.h>
@@ -58,6 +58,10 @@ namespace bpp
  * - two likelihood arrays corresponding to the conditional likelihoods at top and bottom nodes,
  * - a substitution model and a rate distribution, whose parameters will not be estimated but taken "as is",
  * It takes only one parameter, the branch length.
+ *
+ * The arrays are copied once into contiguous blocks, one states x sites
+ * matrix per class, so that each evaluation is a matrix product by the
+ * transition probabilities followed by a column-wise dot product.
  */
 class BranchLikelihood :
   public Function,
@@ -67,8 +71,20 @@ protected:
   const VVVdouble* array1_, * array2_;
   const TransitionModel* model_;
   const DiscreteDistribution* rDist_;
-  size_t nbStates_, nbClasses_;
-  VVVdouble pxy_;
+  size_t nbStates_, nbClasses_, nbSites_;
+
+  /**
+   * @brief The transition probabilities of each class, row-major
+   * nbStates x nbStates blocks.
+   */
+  std::vector<double> pxy_;
+
+  /**
+   * @brief array1_ and array2_, as column-major nbStates x nbSites
+   * blocks, one per class.
+   */
+  std::vector<double> likelihoods1_, likelihoods2_;
+
   double lnL_;
   std::vector<unsigned int> weights_;
 
@@ -81,7 +97,10 @@ public:
     rDist_(0),
     nbStates_(0),
     nbClasses_(0),
+    nbSites_(0),
     pxy_(),
+    likelihoods1_(),
+    likelihoods2_(),
     lnL_(log(0.)),
     weights_(weights)
   {
@@ -96,7 +115,10 @@ public:
     rDist_(bl.rDist_),
     nbStates_(bl.nbStates_),
     nbClasses_(bl.nbClasses_),
+    nbSites_(bl.nbSites_),
     pxy_(bl.pxy_),
+    likelihoods1_(bl.likelihoods1_),
+    likelihoods2_(bl.likelihoods2_),
     lnL_(bl.lnL_),
     weights_(bl.weights_)
   {}
@@ -110,7 +132,10 @@ public:
     rDist_ = bl.rDist_;
     nbStates_ = bl.nbStates_;
     nbClasses_ = bl.nbClasses_;
+    nbSites_ = bl.nbSites_;
     pxy_ = bl.pxy_;
+    likelihoods1_ = bl.likelihoods1_;
+    likelihoods2_ = bl.likelihoods2_;
     lnL_ = bl.lnL_;
     weights_ = bl.weights_;
     return *this;
@@ -127,16 +152,14 @@ public:
    * @warning No checking on alphabet size or number of rate classes is performed,
    * use with care!
    */
-  void initLikelihoods(const VVVdouble* array1, const VVVdouble* array2)
-  {
-    array1_ = array1;
-    array2_ = array2;
-  }
+  void initLikelihoods(const VVVdouble* array1, const VVVdouble* array2);
 
   void resetLikelihoods()
   {
     array1_ = 0;
     array2_ = 0;
+    likelihoods1_.clear();
+    likelihoods2_.clear();
   }
 
   void setParameters(const ParameterList& parameters)
@@ -146,6 +169,15 @@ public:
 
   double getValue() const { return lnL_; }
 
+  /**
+   * @brief Compute one Newton-Raphson step on the branch length, from its current value.
+   *
+   * @param minimum The minimum branch length allowed.
+   * @param maximum The maximum branch length allowed.
+   * @return The new branch length, or the current one if the likelihood is not concave there.
+   */
+  double getNewtonLength(double minimum, double maximum) const;
+
   void fireParameterChanged(const ParameterList& parameters)
   {
     computeAllTransitionProbabilities();
@@ -159,11 +191,11 @@ protected:
 
 
 /**
- * @brief This class adds support for NNI topology estimation to the DRHomogeneousTreeLikelihood class.
+ * @brief This class adds support for NNI and SPR topology estimation to the DRHomogeneousTreeLikelihood class.
  */
 class NNIHomogeneousTreeLikelihood :
   public DRHomogeneousTreeLikelihood,
-  public virtual NNISearchable
+  public virtual SPRSearchable
 {
 protected:
   BranchLikelihood* brLikFunction_;
@@ -177,8 +209,18 @@ protected:
    */
   mutable std::map<int, double> brLenNNIValues_;
 
+  /**
+   * @brief Hash used for backing up the length of the pruned branch when testing SPRs.
+   */
+  mutable std::map<std::pair<int, int>, double> brLenSPRValues_;
+
   ParameterList brLenNNIParams_;
 
+  /**
+   * @brief Maximum score variation of a NNI before it is fully tested.
+   */
+  double nniScreeningThreshold_;
+
 public:
   /**
    * @brief Build a new NNIHomogeneousTreeLikelihood object.
@@ -238,7 +280,7 @@ public:
   }
 
   /**
-   * @name The NNISearchable interface.
+   * @name The NNISearchable and SPRSearchable interfaces.
    *
    * Current implementation:
    * When testing a particular NNI, only the branch length of the parent node is optimized (and roughly).
@@ -254,8 +296,41 @@ public:
 
   double testNNI(int nodeId) const;
 
+  /**
+   * When several threads are set (see setNumberOfThreads), the NNIs are tested concurrently,
+   * each thread using its own copies of the branch function, optimizer and substitution model.
+   * They are tested serially when a memory budget is set (see setMemoryBudget), since the
+   * upper arrays are then recomputed and released on demand.
+   */
+  void testNNIs(const std::vector<int>& nodeIds, std::vector<double>& diffs) const;
+
   void doNNI(int nodeId);
 
+  /**
+   * @brief Set the screening threshold of NNIs.
+   *
+   * Before optimizing the branch length of a NNI, the move is scored with the current
+   * branch length and with one Newton-Raphson step from it. If the best of these two scores
+   * is a variation larger than the threshold, the NNI is rejected without further optimization,
+   * and this score is returned by testNNI.
+   *
+   * @param threshold The threshold, in log-likelihood units. Infinity (the default) disables screening,
+   * and a threshold of 0 keeps only the NNIs which already improve the likelihood before optimization.
+   */
+  void setNNIScreeningThreshold(double threshold) { nniScreeningThreshold_ = threshold; }
+
+  double getNNIScreeningThreshold() const { return nniScreeningThreshold_; }
+
+  /**
+   * When testing a SPR, the conditional likelihoods are recomputed only along the path
+   * between the pruning point and the regrafting branch, from the arrays already stored for
+   * the other neighbors. The regrafting branch is split in two halves, and only the branch
+   * length of the pruned node is optimized (roughly).
+   */
+  double testSPR(int nodeId, int targetId) const;
+
+  void doSPR(int nodeId, int targetId);
+
   void topologyChangeTested(const TopologyChangeEvent& event)
   {
     getLikelihoodData()->reInit();
@@ -267,8 +342,41 @@ public:
   void topologyChangeSuccessful(const TopologyChangeEvent& event)
   {
     brLenNNIValues_.clear();
+    brLenSPRValues_.clear();
   }
   /** @} */
+
+protected:
+  /**
+   * @brief Test a NNI with a given branch function, optimizer and model.
+   *
+   * @param nodeId         The id of the node defining the NNI movement.
+   * @param brLikFunction  The branch function to use.
+   * @param brentOptimizer The optimizer to use for the branch length.
+   * @param model          The substitution model to use for the branch.
+   * @param brLenValue     [out] The estimated branch length.
+   * @return The score variation of the NNI.
+   */
+  double testNNI_(
+    int nodeId,
+    BranchLikelihood& brLikFunction,
+    BrentOneDimension& brentOptimizer,
+    const TransitionModel* model,
+    double& brLenValue) const;
+
+  /**
+   * @brief Compute the transition probabilities of a branch of a given length, for all rate classes.
+   *
+   * @param length The length of the branch.
+   * @param pxy    The array where to store the probabilities.
+   */
+  void computeTransitionProbabilitiesForLength_(double length, VVVdouble& pxy) const;
+
+  /**
+   * @brief Set the length of a branch changed by a topology move,
+   * and record it for the next topologyChangeTested() call.
+   */
+  void setBranchLengthForTopologyChange_(Node* node, double length);
 };
 } // end of namespace bpp.
 
@@ -42,9 +42,18 @@
 #include <string>
 #include <numeric>
 #include <cmath>
+#include <algorithm>
+#include <functional>
 
 #include "PairedSiteLikelihoods.h"
 #include "TreeLikelihood.h"
+#include "../SiteLoopExecutor.h"
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Numeric/NumConstants.h>
+#include <Bpp/Text/TextTools.h>
+
+#include <Eigen/Core>
 
 using namespace std;
 using namespace bpp;
@@ -55,32 +64,54 @@ using namespace bpp;
 
 PairedSiteLikelihoods::PairedSiteLikelihoods() :
   logLikelihoods_(),
+  nbSites_(0),
   modelNames_()
 {}
 
 PairedSiteLikelihoods::PairedSiteLikelihoods(
   const vector<vector<double> >& siteLogLikelihoods,
   const vector<string>& modelNames) :
-  logLikelihoods_(siteLogLikelihoods),
+  logLikelihoods_(),
+  nbSites_(siteLogLikelihoods.size() > 0 ? siteLogLikelihoods[0].size() : 0),
   modelNames_(modelNames)
 {
-  if (modelNames_.size() != getNumberOfModels())
+  if (modelNames_.size() != siteLogLikelihoods.size())
   {
     if (modelNames_.size() == 0)
-      modelNames_.assign(getNumberOfModels(), string());
+      modelNames_.assign(siteLogLikelihoods.size(), string());
     else
       throw Exception("PairedSiteLikelihoods: There should be as many model names as model site-loglikelihoods records.");
   }
 
-  if (this->getNumberOfModels() > 0)
+  logLikelihoods_.reserve(siteLogLikelihoods.size() * nbSites_);
+  for (vector<vector<double> >::const_iterator siteLLiks = siteLogLikelihoods.begin();
+       siteLLiks != siteLogLikelihoods.end();
+       ++siteLLiks)
   {
-    for (vector<vector<double> >::const_iterator siteLLiks = siteLogLikelihoods.begin();
-         siteLLiks != siteLogLikelihoods.end();
-         ++siteLLiks)
-    {
-      if (siteLLiks->size() != getNumberOfSites())
-        throw Exception("PairedSiteLikelihoods: Models site-loglikelihoods records do not have the same number of elements.");
-    }
+    if (siteLLiks->size() != nbSites_)
+      throw Exception("PairedSiteLikelihoods: Models site-loglikelihoods records do not have the same number of elements.");
+    logLikelihoods_.insert(logLikelihoods_.end(), siteLLiks->begin(), siteLLiks->end());
+  }
+}
+
+PairedSiteLikelihoods::PairedSiteLikelihoods(
+  size_t nbSites,
+  vector<double> siteLogLikelihoods,
+  const vector<string>& modelNames) :
+  logLikelihoods_(std::move(siteLogLikelihoods)),
+  nbSites_(nbSites),
+  modelNames_(modelNames)
+{
+  if (nbSites_ == 0 ? logLikelihoods_.size() > 0 : logLikelihoods_.size() % nbSites_ != 0)
+    throw Exception("PairedSiteLikelihoods: The size of the site-loglikelihoods matrix is not a multiple of the number of sites.");
+
+  size_t nbModels = nbSites_ == 0 ? modelNames_.size() : logLikelihoods_.size() / nbSites_;
+  if (modelNames_.size() != nbModels)
+  {
+    if (modelNames_.size() == 0)
+      modelNames_.assign(nbModels, string());
+    else
+      throw Exception("PairedSiteLikelihoods: There should be as many model names as model site-loglikelihoods records.");
   }
 }
 
@@ -92,7 +123,8 @@ void PairedSiteLikelihoods::appendModel(
   if (getNumberOfModels() > 0 && siteLogLikelihoods.size() != getNumberOfSites())
     throw Exception("PairedSiteLikelihoods::appendModel: Model site-loglikelihoods record does not have the correct number of elements");
 
-  logLikelihoods_.push_back(siteLogLikelihoods);
+  nbSites_ = siteLogLikelihoods.size();
+  logLikelihoods_.insert(logLikelihoods_.end(), siteLogLikelihoods.begin(), siteLogLikelihoods.end());
   modelNames_.push_back(modelName);
 }
 
@@ -109,6 +141,9 @@ void PairedSiteLikelihoods::appendModels(const PairedSiteLikelihoods& psl)
   if (getNumberOfModels() > 0 && psl.getNumberOfModels() > 0 && psl.getNumberOfSites() != getNumberOfSites())
     throw Exception("PairedSiteLikelihoods::appendModels: The two PairedSiteLikelihood objects have different number of sites.");
 
+  if (getNumberOfModels() == 0)
+    nbSites_ = psl.nbSites_;
+
   logLikelihoods_.insert(logLikelihoods_.end(),
                         psl.logLikelihoods_.begin(),
                         psl.logLikelihoods_.end()
@@ -120,51 +155,249 @@ void PairedSiteLikelihoods::appendModels(const PairedSiteLikelihoods& psl)
                     );
 }
 
+void PairedSiteLikelihoods::appendModels(const vector<const TreeLikelihood*>& treeLikelihoods, size_t nbThreads)
+{
+  size_t nbModels = treeLikelihoods.size();
+  vector<vector<double> > siteLogLikelihoods(nbModels);
+  std::function<void(size_t, size_t)> computeModels = [&](size_t first, size_t last)
+  {
+    for (size_t m = first; m < last; ++m)
+      siteLogLikelihoods[m] = treeLikelihoods[m]->getLogLikelihoodPerSite();
+  };
 
-pair<vector<string>, vector<double> > PairedSiteLikelihoods::computeExpectedLikelihoodWeights (int replicates) const
+  size_t nbBlocks = min(nbThreads, nbModels);
+  if (nbBlocks > 1)
+  {
+    SiteLoopExecutor executor(nbBlocks);
+    executor.run(nbModels, computeModels);
+  }
+  else
+    computeModels(0, nbModels);
+
+  for (size_t m = 0; m < nbModels; ++m)
+    appendModel(siteLogLikelihoods[m], treeLikelihoods[m]->getTree().getName());
+}
+
+vector<vector<double> > PairedSiteLikelihoods::getLikelihoods() const
 {
-  // Initialize the weights
-  vector<double> weights(getNumberOfModels(), 0);
+  vector<vector<double> > logliks(getNumberOfModels());
+  for (size_t m = 0; m < getNumberOfModels(); ++m)
+    logliks[m].assign(getSiteLogLikelihoods(m), getSiteLogLikelihoods(m) + nbSites_);
+  return logliks;
+}
 
-  // Sum the model weights over replicates
-  for (int r = 0; r < replicates; ++r)
+vector<double> PairedSiteLikelihoods::getLogLikelihoods_() const
+{
+  vector<double> logliks(getNumberOfModels(), 0);
+  for (size_t m = 0; m < getNumberOfModels(); ++m)
+    logliks[m] = accumulate(getSiteLogLikelihoods(m), getSiteLogLikelihoods(m) + nbSites_, 0.0);
+  return logliks;
+}
+
+vector<vector<double> > PairedSiteLikelihoods::computeReplicateLogLikelihoods_(int replicates, double scaling) const
+{
+  size_t nbModels = getNumberOfModels();
+  size_t nbSites = getNumberOfSites();
+  size_t nbReplicates = static_cast<size_t>(max(replicates, 0));
+
+  Eigen::Map<const Eigen::MatrixXd> L(logLikelihoods_.data(), static_cast<Eigen::Index>(nbSites), static_cast<Eigen::Index>(nbModels));
+
+  // The site counts of a block of replicates, one column per replicate:
+  const size_t blockSize = 64;
+  Eigen::MatrixXd counts(static_cast<Eigen::Index>(nbSites), static_cast<Eigen::Index>(min(blockSize, nbReplicates)));
+  Eigen::MatrixXd Y;
+
+  vector<vector<double> > logliks(nbReplicates, vector<double>(nbModels, 0));
+  for (size_t b0 = 0; b0 < nbReplicates; b0 += blockSize)
   {
-    // Draw the pseudoreplicate
-    vector<int> siteCounts = bootstrap(getNumberOfSites());
+    size_t nb = min(blockSize, nbReplicates - b0);
+    for (size_t b = 0; b < nb; ++b)
+    {
+      vector<int> siteCounts = bootstrap(nbSites, scaling);
+      for (size_t s = 0; s < nbSites; ++s)
+        counts(static_cast<Eigen::Index>(s), static_cast<Eigen::Index>(b)) = siteCounts[s];
+    }
 
-    // Compute the loglikelihood of each model for this replicate
-    vector<double> models_logliks (getNumberOfModels(), 0);
-    for (size_t m = 0; m < getNumberOfModels(); ++m)
+    Y.noalias() = counts.leftCols(static_cast<Eigen::Index>(nb)).transpose() * L;
+    for (size_t b = 0; b < nb; ++b)
     {
-      const vector<double>& modelSiteLLiks = logLikelihoods_.at(m);
-      double Y = 0;
-      for (size_t s = 0; s < getNumberOfSites(); ++s)
-      {
-        Y += modelSiteLLiks.at(s) * siteCounts.at(s);
-      }
-      models_logliks.at(m) = Y;
+      for (size_t m = 0; m < nbModels; ++m)
+        logliks[b0 + b][m] = Y(static_cast<Eigen::Index>(b), static_cast<Eigen::Index>(m));
     }
+  }
+  return logliks;
+}
 
-    // Get the best loglikelihood
-    double Ymax = *max_element(models_logliks.begin(), models_logliks.end());
+vector<double> PairedSiteLikelihoods::computeKHTest(int replicates) const
+{
+  size_t nbModels = getNumberOfModels();
+  vector<double> Y = getLogLikelihoods_();
+  size_t best = static_cast<size_t>(max_element(Y.begin(), Y.end()) - Y.begin());
+  vector<vector<double> > Yr = computeReplicateLogLikelihoods_(replicates, 1);
 
-    // Get the exponentials of the loglikelihood differences
-    // and the sum of these values
-    vector<double> exp_logliks_diffs (getNumberOfModels(), 0);
-    for (size_t m = 0; m < getNumberOfModels(); ++m)
+  vector<double> pvalues(nbModels, 1.);
+  for (size_t m = 0; m < nbModels; ++m)
+  {
+    if (m == best)
+      continue;
+    double delta = Y[best] - Y[m];
+    double mean = 0;
+    for (const auto& Yb : Yr)
+      mean += Yb[best] - Yb[m];
+    mean /= replicates;
+    size_t count = 0;
+    for (const auto& Yb : Yr)
     {
-      exp_logliks_diffs.at(m) = exp(models_logliks.at(m) - Ymax);
+      if (Yb[best] - Yb[m] - mean >= delta)
+        ++count;
     }
+    pvalues[m] = static_cast<double>(count) / replicates;
+  }
+  return pvalues;
+}
 
-    double sumELLD = accumulate(exp_logliks_diffs.begin(), exp_logliks_diffs.end(), 0.0);
+vector<double> PairedSiteLikelihoods::computeSHTest(int replicates) const
+{
+  size_t nbModels = getNumberOfModels();
+  vector<double> Y = getLogLikelihoods_();
+  double Ymax = *max_element(Y.begin(), Y.end());
+  vector<vector<double> > Yr = computeReplicateLogLikelihoods_(replicates, 1);
+
+  // Center the replicates
+  vector<double> means(nbModels, 0);
+  for (const auto& Yb : Yr)
+  {
+    for (size_t m = 0; m < nbModels; ++m)
+      means[m] += Yb[m];
+  }
+  for (auto& mean : means)
+    mean /= replicates;
+
+  vector<double> counts(nbModels, 0);
+  vector<double> Z(nbModels);
+  for (const auto& Yb : Yr)
+  {
+    for (size_t m = 0; m < nbModels; ++m)
+      Z[m] = Yb[m] - means[m];
+    double Zmax = *max_element(Z.begin(), Z.end());
+    for (size_t m = 0; m < nbModels; ++m)
+    {
+      if (Zmax - Z[m] >= Ymax - Y[m])
+        counts[m] += 1;
+    }
+  }
+
+  for (auto& c : counts)
+    c /= replicates;
+  return counts;
+}
+
+vector<double> PairedSiteLikelihoods::computeAUTest(int replicates, const vector<double>& scales) const
+{
+  vector<double> r = scales;
+  if (r.size() == 0)
+  {
+    for (int k = 5; k <= 14; ++k)
+      r.push_back(k / 10.);
+  }
 
-    // Get the models weights for this replicate
-    for (size_t m = 0; m < getNumberOfModels(); ++m)
+  size_t nbModels = getNumberOfModels();
+  size_t nbSites = getNumberOfSites();
+  size_t nbScales = r.size();
+
+  // Bootstrap probabilities of each model being the best one, per scale
+  vector<vector<double> > bp(nbScales, vector<double>(nbModels, 0));
+  vector<double> sigma2(nbScales);
+  for (size_t k = 0; k < nbScales; ++k)
+  {
+    size_t length = static_cast<size_t>(static_cast<double>(nbSites) * r[k] + 0.5);
+    if (length == 0)
+      throw Exception("PairedSiteLikelihoods::computeAUTest: Scale " + TextTools::toString(r[k]) + " gives empty pseudoreplicates.");
+    sigma2[k] = static_cast<double>(nbSites) / static_cast<double>(length);
+
+    vector<vector<double> > Yr = computeReplicateLogLikelihoods_(replicates, r[k]);
+    for (const auto& Yb : Yr)
     {
-      double w = exp_logliks_diffs.at(m) / sumELLD;
-      weights.at(m) += w;
+      double Ymax = *max_element(Yb.begin(), Yb.end());
+      double nbBest = static_cast<double>(count(Yb.begin(), Yb.end(), Ymax));
+      for (size_t m = 0; m < nbModels; ++m)
+      {
+        if (Yb[m] == Ymax)
+          bp[k][m] += 1. / nbBest;
+      }
     }
-  } //for replicates
+    for (auto& p : bp[k])
+      p /= replicates;
+  }
+
+  size_t closest = 0;
+  for (size_t k = 1; k < nbScales; ++k)
+  {
+    if (abs(r[k] - 1.) < abs(r[closest] - 1.))
+      closest = k;
+  }
+
+  vector<double> pvalues(nbModels);
+  for (size_t m = 0; m < nbModels; ++m)
+  {
+    // Weighted least squares fit of psi = v + c * sigma2
+    double sw = 0, swx = 0, swxx = 0, swy = 0, swxy = 0;
+    size_t n = 0;
+    for (size_t k = 0; k < nbScales; ++k)
+    {
+      double p = bp[k][m];
+      if (p <= 0 || p >= 1)
+        continue;
+      double z = RandomTools::qNorm(1. - p);
+      double psi = sqrt(sigma2[k]) * z;
+      double density = exp(-z * z / 2.) / sqrt(2. * NumConstants::PI());
+      double var = sigma2[k] * p * (1. - p) / (replicates * density * density);
+      double w = 1. / var;
+      sw   += w;
+      swx  += w * sigma2[k];
+      swxx += w * sigma2[k] * sigma2[k];
+      swy  += w * psi;
+      swxy += w * sigma2[k] * psi;
+      ++n;
+    }
+    double det = sw * swxx - swx * swx;
+    if (n < 2 || det <= 0)
+    {
+      pvalues[m] = bp[closest][m];
+      continue;
+    }
+    double v = (swxx * swy - swx * swxy) / det;
+    double c = (sw * swxy - swx * swy) / det;
+    pvalues[m] = 0.5 * erfc((v - c) / sqrt(2.));
+  }
+  return pvalues;
+}
+
+namespace
+{
+  /**
+   * @brief Add exp(Y_m - log(sum_k exp(Y_k))) to the weight of each model.
+   */
+  void addLogSumExpWeights(const vector<double>& Y, vector<double>& weights)
+  {
+    double Ymax = *max_element(Y.begin(), Y.end());
+    double sumExp = 0;
+    for (double y : Y)
+      sumExp += exp(y - Ymax);
+    double logSum = Ymax + log(sumExp);
+    for (size_t m = 0; m < Y.size(); ++m)
+      weights[m] += exp(Y[m] - logSum);
+  }
+}
+
+pair<vector<string>, vector<double> > PairedSiteLikelihoods::computeExpectedLikelihoodWeights (int replicates) const
+{
+  vector<double> weights(getNumberOfModels(), 0);
+
+  // Sum the model weights over replicates
+  vector<vector<double> > Yr = computeReplicateLogLikelihoods_(replicates, 1);
+  for (const auto& Yb : Yr)
+    addLogSumExpWeights(Yb, weights);
 
   // Divide all weights by the number of replicates.
   for (vector<double>::iterator w = weights.begin(); w != weights.end(); ++w)
@@ -175,6 +408,25 @@ pair<vector<string>, vector<double> > PairedSiteLikelihoods::computeExpectedLike
   return make_pair(modelNames_, weights);
 }
 
+vector<double> PairedSiteLikelihoods::computeModelWeights(const vector<double>& penalties) const
+{
+  size_t nbModels = getNumberOfModels();
+  if (penalties.size() != 0 && penalties.size() != nbModels)
+    throw Exception("PairedSiteLikelihoods::computeModelWeights: There should be as many penalties as models.");
+
+  vector<double> Y = getLogLikelihoods_();
+  if (penalties.size() != 0)
+  {
+    for (size_t m = 0; m < nbModels; ++m)
+      Y[m] -= penalties[m];
+  }
+
+  vector<double> weights(nbModels, 0);
+  if (nbModels > 0)
+    addLogSumExpWeights(Y, weights);
+  return weights;
+}
+
 std::vector<int> PairedSiteLikelihoods::bootstrap(std::size_t length, double scaling)
 {
   vector<int> v(length, 0);
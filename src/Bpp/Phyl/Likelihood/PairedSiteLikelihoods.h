@@ -56,11 +56,17 @@ namespace bpp
  * An instance of this class is, roughly, a list of models, each of
  * them having a name (stored in the <i>modelNames</i> attribute) and
  * a set of site likelihoods (stored in the <i>logLikelihoods</i> attribute).
+ *
+ * Site log-likelihoods are stored as a single column-major
+ * nsites*nmodels matrix, those of a model being contiguous, so that
+ * resampling tests on many models and sites are computed with matrix
+ * products.
  */
 class PairedSiteLikelihoods
 {
 private:
-  std::vector<std::vector<double> > logLikelihoods_;
+  std::vector<double> logLikelihoods_;
+  std::size_t nbSites_;
   std::vector<std::string> modelNames_;
 
 public:
@@ -80,6 +86,23 @@ public:
     const std::vector<std::string>& modelNames = std::vector<std::string>()
     );
 
+  /**
+   * @brief Build a new object from a site likelihoods matrix.
+   *
+   * @param nbSites The number of sites.
+   * @param siteLogLikelihoods A column-major nsites*nmodels matrix of
+   * loglikelihoods, the sites of each model being contiguous.
+   * @param modelNames <i>(Optional)</i> The names of the models.
+   *
+   * @throw Exception If the size of the matrix is not a multiple of the
+   * number of sites, or if the number of names and models differ.
+   */
+  PairedSiteLikelihoods(
+    std::size_t nbSites,
+    std::vector<double> siteLogLikelihoods,
+    const std::vector<std::string>& modelNames = std::vector<std::string>()
+    );
+
   ~PairedSiteLikelihoods() {}
 
   /**
@@ -113,13 +136,39 @@ public:
   void appendModels(const PairedSiteLikelihoods& psl);
 
   /**
-   * @return The site-likelihoods of all models.
+   * @brief Append the models of several TreeLikelihood records, computing
+   * their site log-likelihoods concurrently.
+   *
+   * @param treeLikelihoods The TreeLikelihood records, which must be up to date.
+   * @param nbThreads The number of threads to use.
+   *
+   * @throw Exception If the number of sites is not the same as in the container.
+   */
+  void appendModels(const std::vector<const TreeLikelihood*>& treeLikelihoods, size_t nbThreads = 1);
+
+  /**
+   * @return A copy of the site-likelihoods of all models, model by model.
    */
-  const std::vector<std::vector<double> >& getLikelihoods() const
+  std::vector<std::vector<double> > getLikelihoods() const;
+
+  /**
+   * @return The column-major nsites*nmodels matrix of the site-likelihoods.
+   */
+  const std::vector<double>& getLogLikelihoodMatrix() const
   {
     return logLikelihoods_;
   }
 
+  /**
+   * @return A pointer to the contiguous site-likelihoods of a model.
+   *
+   * @param model The position of the model.
+   */
+  const double* getSiteLogLikelihoods(std::size_t model) const
+  {
+    return logLikelihoods_.data() + model * nbSites_;
+  }
+
   /**
    * @return The model names.
    */
@@ -131,7 +180,7 @@ public:
   /** @brief Get the number of models in the container. */
   size_t getNumberOfModels() const
   {
-    return logLikelihoods_.size();
+    return modelNames_.size();
   }
 
   /**
@@ -140,14 +189,9 @@ public:
    */
   std::size_t getNumberOfSites() const
   {
-    try
-    {
-      return logLikelihoods_.at(0).size();
-    }
-    catch (std::out_of_range&)
-    {
+    if (modelNames_.empty())
       throw Exception("PairedSiteLikelihoods::nsites: The container is empty, there isn't a number of sites.");
-    }
+    return nbSites_;
   }
 
   /**
@@ -177,6 +221,75 @@ public:
    */
   std::pair< std::vector<std::string>, std::vector<double> > computeExpectedLikelihoodWeights(int replicates = 10000) const;
 
+  /**
+   * @brief Compute the weights of the models on the data.
+   *
+   * The weight of model m is
+   * \f$W_m = exp(Y_m - k_m) / \sum_j exp(Y_j - k_j)\f$, computed with
+   * the log-sum-exp trick, where \f$Y_m\f$ is the loglikelihood of the
+   * model and \f$k_m\f$ its penalty. Without penalties, these are the
+   * posterior probabilities of the models under a uniform prior; with
+   * the numbers of free parameters as penalties, they are the Akaike
+   * weights.
+   *
+   * @param penalties The penalty of each model (default: none).
+   * @throw Exception If the number of penalties and models differ.
+   */
+  std::vector<double> computeModelWeights(const std::vector<double>& penalties = std::vector<double>()) const;
+
+  /**
+   * @name Topology tests.
+   *
+   * All tests use RELL resampling: replicates are scored by weighting the
+   * site log-likelihoods of the models, which are not estimated again.
+   * They return the p-value of each model, in the order of the container.
+   *
+   * @{
+   */
+
+  /**
+   * @brief Kishino-Hasegawa test of each model against the best one.
+   *
+   * The statistic is the difference \f$\delta_m = Y_{best} - Y_m\f$, and the
+   * p-value is the proportion of replicates where the centered difference
+   * is at least \f$\delta_m\f$. The p-value of the best model is 1.
+   * Note that the best model is chosen a posteriori, so that the test is
+   * only valid for models specified a priori.
+   *
+   * @param replicates The number of pseudoreplicates.
+   */
+  std::vector<double> computeKHTest(int replicates = 10000) const;
+
+  /**
+   * @brief Shimodaira-Hasegawa test.
+   *
+   * Replicate log-likelihoods are centered, and the statistic of a model
+   * is the difference with the best model, in the data and in each
+   * replicate.
+   *
+   * @param replicates The number of pseudoreplicates.
+   */
+  std::vector<double> computeSHTest(int replicates = 10000) const;
+
+  /**
+   * @brief Approximately unbiased test (Shimodaira, 2002).
+   *
+   * Bootstrap probabilities \f$BP_m(\sigma^2)\f$ that each model is the
+   * best one are computed with pseudoreplicates of \f$n' = n / \sigma^2\f$ sites,
+   * and \f$\sigma \Phi^{-1}(1 - BP_m(\sigma^2)) = v_m + c_m \sigma^2\f$ is fitted by
+   * weighted least squares. The p-value is \f$1 - \Phi(v_m - c_m)\f$. If less
+   * than two scales give a probability strictly between 0 and 1, the
+   * bootstrap probability at the scale closest to 1 is returned.
+   *
+   * @param replicates The number of pseudoreplicates per scale.
+   * @param scales The lengths of the pseudoreplicates, in fraction of the
+   * length of the data. The default is the ten scales from 0.5 to 1.4 of
+   * the CONSEL program.
+   */
+  std::vector<double> computeAUTest(int replicates = 10000, const std::vector<double>& scales = std::vector<double>()) const;
+
+  /** @} */
+
   /**
    * @brief Draw a nonparametric pseudoreplicate
    *
@@ -188,7 +301,23 @@ public:
    * of each element in the pseudoreplicate.
    */
   static std::vector<int> bootstrap(std::size_t length, double scaling = 1);
-  
+
+private:
+  /**
+   * @brief Draw pseudoreplicates and compute the loglikelihood of each model for each of them.
+   *
+   * Replicates are drawn by blocks, the loglikelihoods of a block being
+   * the product of the site counts of the block and the site
+   * loglikelihoods matrix.
+   *
+   * @return A replicates*nmodels array.
+   */
+  std::vector<std::vector<double> > computeReplicateLogLikelihoods_(int replicates, double scaling) const;
+
+  /**
+   * @return The loglikelihood of each model.
+   */
+  std::vector<double> getLogLikelihoods_() const;
 };
 } // namespace bpp.
 
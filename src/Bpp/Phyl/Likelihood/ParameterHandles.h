@@ -0,0 +1,131 @@
+//
+// File: ParameterHandles.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _PARAMETERHANDLES_H_
+#define _PARAMETERHANDLES_H_
+
+#include <Bpp/Numeric/ParameterList.h>
+
+// From the STL:
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Integer handles on parameters of a ParameterList.
+ *
+ * The names of the parameters are given once, and each handle then
+ * caches the position of its parameter in the list. Looking a parameter
+ * up by its handle only compares the name at the cached position, and
+ * searches the list again only when the list has changed, avoiding the
+ * building of names and the linear lookups of ParameterList in loops
+ * over branches.
+ */
+class ParameterHandles
+{
+private:
+  std::vector<std::string> names_;
+  mutable std::vector<size_t> positions_;
+
+public:
+  ParameterHandles() : names_(), positions_() {}
+
+public:
+  /**
+   * @brief Set the parameter names, the handle of each one being its index.
+   */
+  void setNames(const std::vector<std::string>& names)
+  {
+    names_ = names;
+    positions_.assign(names.size(), 0);
+  }
+
+  size_t size() const { return names_.size(); }
+
+  const std::string& getName(size_t handle) const { return names_[handle]; }
+
+  /**
+   * @return A pointer to the parameter with the given handle.
+   *
+   * @param pl The list where the parameter is looked for.
+   * @param handle The handle of the parameter.
+   * @throw ParameterNotFoundException If the parameter is not in the list.
+   */
+  const Parameter* getParameter(const ParameterList& pl, size_t handle) const
+  {
+    return &pl[getPosition(pl, handle)];
+  }
+
+  /**
+   * @return The position in the list of the parameter with the given handle.
+   *
+   * @param pl The list where the parameter is looked for.
+   * @param handle The handle of the parameter.
+   * @throw ParameterNotFoundException If the parameter is not in the list.
+   */
+  size_t getPosition(const ParameterList& pl, size_t handle) const
+  {
+    size_t& pos = positions_[handle];
+    if (!(pos < pl.size() && pl[pos].getName() == names_[handle]))
+      pos = pl.whichParameterHasName(names_[handle]);
+    return pos;
+  }
+};
+
+/**
+ * @return True if the two lists have at least one parameter name in common.
+ *
+ * Same as testing the size of ParameterList::getCommonParametersWith(),
+ * without copying the common parameters.
+ */
+inline bool haveCommonParameters(const ParameterList& pl1, const ParameterList& pl2)
+{
+  const ParameterList& shortest = pl1.size() < pl2.size() ? pl1 : pl2;
+  const ParameterList& longest = pl1.size() < pl2.size() ? pl2 : pl1;
+  for (size_t i = 0; i < shortest.size(); i++)
+  {
+    if (longest.hasParameter(shortest[i].getName()))
+      return true;
+  }
+  return false;
+}
+} // end of namespace bpp.
+
+#endif // _PARAMETERHANDLES_H_
@@ -42,6 +42,8 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "../Tree/TreeTemplateTools.h"
 
 #include <iostream>
+#include <map>
+#include <set>
 
 using namespace std;
 
@@ -57,7 +59,10 @@ RHomogeneousClockTreeLikelihood::RHomogeneousClockTreeLikelihood(
   DiscreteDistribution * rDist,
   bool checkRooted,
   bool verbose):
-  RHomogeneousTreeLikelihood(tree, model, rDist, false, verbose, true)
+  RHomogeneousTreeLikelihood(tree, model, rDist, false, verbose, true),
+  dLogLikelihoods_(),
+  heightDerivatives_(),
+  derivativesUp2Date_(false)
 {
   init_();
 }
@@ -71,7 +76,10 @@ RHomogeneousClockTreeLikelihood::RHomogeneousClockTreeLikelihood(
   DiscreteDistribution * rDist,
   bool checkRooted,
   bool verbose):
-  RHomogeneousTreeLikelihood(tree, data, model, rDist, false, verbose, true)
+  RHomogeneousTreeLikelihood(tree, data, model, rDist, false, verbose, true),
+  dLogLikelihoods_(),
+  heightDerivatives_(),
+  derivativesUp2Date_(false)
 {
   init_();
 }
@@ -105,17 +113,55 @@ void RHomogeneousClockTreeLikelihood::applyParameters()
 
 void RHomogeneousClockTreeLikelihood::fireParameterChanged(const ParameterList& params)
 {
-  applyParameters();
+  vector<double> lengths(nbNodes_);
+  for (size_t i = 0; i < nbNodes_; i++)
+  {
+    lengths[i] = nodes_[i]->getDistanceToFather();
+  }
 
-  computeAllTransitionProbabilities();
+  applyParameters();
+  derivativesUp2Date_ = false;
 
-  computeTreeLikelihood();
+  if (params.size() == getNumberOfParameters()
+      || haveCommonParameters(rateDistribution_->getParameters(), params)
+      || haveCommonParameters(model_->getParameters(), params))
+  {
+    computeAllTransitionProbabilities();
+    computeTreeLikelihood();
+  }
+  else
+  {
+    //Only heights changed, update the branches whose length changed and their paths to the root:
+    set<int> toUpdate;
+    for (size_t i = 0; i < nbNodes_; i++)
+    {
+      if (nodes_[i]->getDistanceToFather() != lengths[i])
+      {
+        computeTransitionProbabilitiesForNode(nodes_[i]);
+        for (const Node* node = nodes_[i]->getFather(); node && toUpdate.insert(node->getId()).second; node = node->getFather()) {}
+      }
+    }
+    computeLikelihoodsOnPaths_(tree_->getRootNode(), toUpdate);
+  }
   
   minusLogLik_ = - getLogLikelihood();
 }
 
 /******************************************************************************/
 
+void RHomogeneousClockTreeLikelihood::computeLikelihoodsOnPaths_(const Node* node, const std::set<int>& nodeIds)
+{
+  if (nodeIds.find(node->getId()) == nodeIds.end())
+    return;
+  for (size_t i = 0; i < node->getNumberOfSons(); i++)
+  {
+    computeLikelihoodsOnPaths_(node->getSon(i), nodeIds);
+  }
+  computeLikelihoodAtNode_(node);
+}
+
+/******************************************************************************/
+
 void RHomogeneousClockTreeLikelihood::initBranchLengthsParameters(bool verbose)
 {
   //Check branch lengths first:
@@ -200,7 +246,60 @@ ParameterList RHomogeneousClockTreeLikelihood::getNonDerivableParameters() const
 
 double RHomogeneousClockTreeLikelihood::getFirstOrderDerivative(const std::string& variable) const
 { 
-  throw Exception("No first order derivative is implemented for this function.");
+  if (!hasParameter(variable))
+    throw ParameterNotFoundException("RHomogeneousClockTreeLikelihood::getFirstOrderDerivative().", variable);
+  if (!brLenParameters_.hasParameter(variable))
+    throw Exception("RHomogeneousClockTreeLikelihood::getFirstOrderDerivative(). Derivatives are only implemented for height parameters.");
+  if (!computeFirstOrderDerivatives_)
+    throw Exception("RHomogeneousClockTreeLikelihood::getFirstOrderDerivative(). First order derivatives are not enabled.");
+  if (!derivativesUp2Date_)
+    computeDerivatives_();
+  return -heightDerivatives_[variable];
+}
+
+/******************************************************************************/
+
+void RHomogeneousClockTreeLikelihood::computeDerivatives_() const
+{
+  //One derivative per branch, each one costs a pass from the branch to the root:
+  RHomogeneousClockTreeLikelihood* self = const_cast<RHomogeneousClockTreeLikelihood*>(this);
+  map<int, size_t> index;
+  dLogLikelihoods_.resize(nbNodes_);
+  for (size_t i = 0; i < nbNodes_; i++)
+  {
+    index[nodes_[i]->getId()] = i;
+    self->computeTreeDLikelihood("BrLen" + TextTools::toString(i));
+    dLogLikelihoods_[i] = getDLogLikelihood();
+  }
+
+  //Then chain rule in height space:
+  heightDerivatives_.clear();
+  const Node* root = tree_->getRootNode();
+  heightDerivatives_["TotalHeight"] = computeHeightDerivatives_(root, brLenParameters_.getParameter("TotalHeight").getValue(), index);
+  derivativesUp2Date_ = true;
+}
+
+double RHomogeneousClockTreeLikelihood::computeHeightDerivatives_(const Node* node, double height, const std::map<int, size_t>& index) const
+{
+  //Lengths of the branches below the node increase with its height, the one above decreases:
+  double d = 0;
+  if (node->hasFather())
+    d -= dLogLikelihoods_[index.find(node->getId())->second];
+  for (size_t i = 0; i < node->getNumberOfSons(); i++)
+  {
+    const Node* son = node->getSon(i);
+    d += dLogLikelihoods_[index.find(son->getId())->second];
+    if (!son->isLeaf())
+    {
+      //The height of the son is HeightP * height:
+      string name = "HeightP" + TextTools::toString(son->getId());
+      double sonHeightP = brLenParameters_.getParameter(name).getValue();
+      double dSon = computeHeightDerivatives_(son, sonHeightP * height, index);
+      heightDerivatives_[name] = height * dSon;
+      d += sonHeightP * dSon;
+    }
+  }
+  return d;
 }
 
 /******************************************************************************
@@ -47,6 +47,10 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include <Bpp/Numeric/ParameterList.h>
 
+// From the STL:
+#include <map>
+#include <set>
+
 namespace bpp
 {
 
@@ -56,9 +60,13 @@ namespace bpp
  * This class overrides the HomogeneousTreeLikelihood class, and change the branch length parameters
  * which are the heights of the ancestral nodes.
  * Heights are coded as percentage (HeightP) of the height of their father + the total height of the tree (TotalHeight).
- * This parametrization resolve the linear constraint between heights, but has the limitation that the first and second
+ * This parametrization resolve the linear constraint between heights, but has the limitation that the second
  * order derivatives for HeightP parameters are not (easilly) computable analytically, and one may wish to use numerical
  * derivatives instead.
+ * First order derivatives are obtained by the chain rule from the derivatives with respect to each
+ * branch length, which are computed once for a given set of parameter values.
+ * When only heights change, transition probabilities are only computed again for the branches whose
+ * length changed, and likelihood arrays only on the paths from these branches to the root.
  * The tree must be rooted and fully resolved (no multifurcation).
  *
  * Constraint on parameters HeightP are of class IncludingInterval, initially set to [0,1].
@@ -69,6 +77,19 @@ class RHomogeneousClockTreeLikelihood:
   public RHomogeneousTreeLikelihood,
   public DiscreteRatesAcrossSitesClockTreeLikelihood
 {
+  private:
+    /**
+     * @brief Derivatives of the log likelihood with respect to each branch length, indexed as nodes_.
+     */
+    mutable std::vector<double> dLogLikelihoods_;
+
+    /**
+     * @brief Derivatives of the log likelihood with respect to the TotalHeight and HeightP parameters.
+     */
+    mutable std::map<std::string, double> heightDerivatives_;
+
+    mutable bool derivativesUp2Date_;
+
   public:
     /**
      * @brief Build a new HomogeneousClockTreeLikelihood object.
@@ -158,6 +179,27 @@ class RHomogeneousClockTreeLikelihood:
      */
     void computeBranchLengthsFromHeights(Node* node, double height);
 
+  private:
+    /**
+     * @brief Compute the likelihood arrays of all nodes in a set, sons first.
+     *
+     * The set must contain all ancestors of its elements.
+     */
+    void computeLikelihoodsOnPaths_(const Node* node, const std::set<int>& nodeIds);
+
+    /**
+     * @brief Fill dLogLikelihoods_ and heightDerivatives_ for the current parameter values.
+     */
+    void computeDerivatives_() const;
+
+    /**
+     * @brief Recursive step of computeDerivatives_().
+     *
+     * @return The derivative of the log likelihood with respect to the height of the node,
+     * all ratios HeightP of its descendants being fixed.
+     */
+    double computeHeightDerivatives_(const Node* node, double height, const std::map<int, size_t>& index) const;
+
 };
 
 } //end of namespace bpp.
@@ -38,6 +38,7 @@
  */
 
 #include "RHomogeneousTreeLikelihood.h"
+#include "CompensatedSum.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -61,6 +62,7 @@ RHomogeneousTreeLikelihood::RHomogeneousTreeLikelihood(
   bool usePatterns) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
+  siteLoopExecutor_(),
   minusLogLik_(-1.)
 {
   init_(usePatterns);
@@ -78,6 +80,7 @@ RHomogeneousTreeLikelihood::RHomogeneousTreeLikelihood(
   bool usePatterns) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
+  siteLoopExecutor_(),
   minusLogLik_(-1.)
 {
   init_(usePatterns);
@@ -100,10 +103,12 @@ RHomogeneousTreeLikelihood::RHomogeneousTreeLikelihood(
   const RHomogeneousTreeLikelihood& lik) :
   AbstractHomogeneousTreeLikelihood(lik),
   likelihoodData_(0),
+  siteLoopExecutor_(),
   minusLogLik_(lik.minusLogLik_)
 {
   likelihoodData_ = dynamic_cast<DRASRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
+  setNumberOfThreads(lik.getNumberOfThreads());
 }
 
 /******************************************************************************/
@@ -116,6 +121,7 @@ RHomogeneousTreeLikelihood& RHomogeneousTreeLikelihood::operator=(
   likelihoodData_ = dynamic_cast<DRASRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
   minusLogLik_ = lik.minusLogLik_;
+  setNumberOfThreads(lik.getNumberOfThreads());
   return *this;
 }
 
@@ -128,10 +134,29 @@ RHomogeneousTreeLikelihood::~RHomogeneousTreeLikelihood()
 
 /******************************************************************************/
 
+void RHomogeneousTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  if (nbThreads == getNumberOfThreads())
+    return;
+  if (nbThreads <= 1)
+    siteLoopExecutor_.reset();
+  else
+    siteLoopExecutor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
+void RHomogeneousTreeLikelihood::runParallelLoop_(size_t nbSites, const std::function<void(size_t, size_t)>& loop) const
+{
+  if (siteLoopExecutor_)
+    siteLoopExecutor_->run(nbSites, loop);
+  else if (nbSites > 0)
+    loop(0, nbSites);
+}
+
+/******************************************************************************/
+
 void RHomogeneousTreeLikelihood::setData(const AlignedValuesContainer& sites)
 {
-  if (data_) delete data_;
-  data_ = PatternTools::getSequenceSubset(sites, *tree_->getRootNode());
+  data_.reset(PatternTools::getSequenceSubset(sites, *tree_->getRootNode()));
 
   if (verbose_) ApplicationTools::displayTask("Initializing data structure");
   likelihoodData_->initLikelihoods(*data_, *model_);
@@ -162,18 +187,12 @@ double RHomogeneousTreeLikelihood::getLikelihood() const
 
 double RHomogeneousTreeLikelihood::getLogLikelihood() const
 {
-  double ll = 0;
-  vector<double> la(nbSites_);
+  CompensatedSum ll;
   for (size_t i = 0; i < nbSites_; i++)
   {
-    la[i] = getLogLikelihoodForASite(i);
-  }
-  sort(la.begin(), la.end());
-  for (size_t i = nbSites_; i > 0; i--)
-  {
-    ll += la[i - 1];
+    ll.add(getLogLikelihoodForASite(i));
   }
-  return ll;
+  return ll.getValue();
 }
 
 /******************************************************************************/
@@ -257,8 +276,8 @@ void RHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& param
 {
   applyParameters();
 
-  if (rateDistribution_->getParameters().getCommonParametersWith(params).size() > 0
-      || model_->getParameters().getCommonParametersWith(params).size() > 0)
+  if (haveCommonParameters(rateDistribution_->getParameters(), params)
+      || haveCommonParameters(model_->getParameters(), params))
   {
     //Rate parameter changed, need to recompute all probs:
     computeAllTransitionProbabilities();
@@ -376,18 +395,21 @@ void RHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variable)
   // Compute dLikelihoods array for the father node.
   // Fist initialize to 1:
   size_t nbSites  = _dLikelihoods_father->size();
-  for (size_t i = 0; i < nbSites; i++)
+  runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
   {
-    VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-      for (size_t s = 0; s < nbStates_; s++)
+      VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        (*_dLikelihoods_father_i_c)[s] = 1.;
+        Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+        for (size_t s = 0; s < nbStates_; s++)
+        {
+          (*_dLikelihoods_father_i_c)[s] = 1.;
+        }
       }
     }
-  }
+  });
 
   size_t nbNodes = father->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
@@ -402,52 +424,58 @@ void RHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variable)
     {
       VVVdouble* dpxy__son = &dpxy_[son->getId()];
 
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* dpxy__son_c = &(*dpxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* dpxy__son_c_x = &(*dpxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* dpxy__son_c = &(*dpxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*dpxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* dpxy__son_c_x = &(*dpxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*dpxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* pxy__son = &pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
   }
 
@@ -468,18 +496,21 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* node)
   // Fist initialize to 1:
   VVVdouble* _dLikelihoods_father = &likelihoodData_->getDLikelihoodArray(father->getId());
   size_t nbSites  = _dLikelihoods_father->size();
-  for (size_t i = 0; i < nbSites; i++)
+  runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
   {
-    VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-      for (size_t s = 0; s < nbStates_; s++)
+      VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        (*_dLikelihoods_father_i_c)[s] = 1.;
+        Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+        for (size_t s = 0; s < nbStates_; s++)
+        {
+          (*_dLikelihoods_father_i_c)[s] = 1.;
+        }
       }
     }
-  }
+  });
 
   size_t nbNodes = father->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
@@ -492,52 +523,58 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* node)
     if (son == node)
     {
       VVVdouble* _dLikelihoods_son = &likelihoodData_->getDLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _dLikelihoods_son_i = &(*_dLikelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _dLikelihoods_son_i_c = &(*_dLikelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _dLikelihoods_son_i = &(*_dLikelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _dLikelihoods_son_i_c = &(*_dLikelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_dLikelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_dLikelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
   }
 
@@ -629,18 +666,21 @@ void RHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variable)
   // Fist initialize to 1:
   VVVdouble* _d2Likelihoods_father = &likelihoodData_->getD2LikelihoodArray(father->getId());
   size_t nbSites  = _d2Likelihoods_father->size();
-  for (size_t i = 0; i < nbSites; i++)
+  runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
   {
-    VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-      for (size_t s = 0; s < nbStates_; s++)
+      VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        (*_d2Likelihoods_father_i_c)[s] = 1.;
+        Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+        for (size_t s = 0; s < nbStates_; s++)
+        {
+          (*_d2Likelihoods_father_i_c)[s] = 1.;
+        }
       }
     }
-  }
+  });
 
   size_t nbNodes = father->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
@@ -653,52 +693,58 @@ void RHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variable)
     if (son == branch)
     {
       VVVdouble* d2pxy__son = &d2pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* d2pxy__son_c = &(*d2pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double d2l = 0;
-            Vdouble* d2pxy__son_c_x = &(*d2pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* d2pxy__son_c = &(*d2pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              d2l += (*d2pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double d2l = 0;
+              Vdouble* d2pxy__son_c_x = &(*d2pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                d2l += (*d2pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* pxy__son = &pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double d2l = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double d2l = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
           }
         }
-      }
+      });
     }
   }
 
@@ -719,18 +765,21 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node
   // Fist initialize to 1:
   VVVdouble* _d2Likelihoods_father = &likelihoodData_->getD2LikelihoodArray(father->getId());
   size_t nbSites  = _d2Likelihoods_father->size();
-  for (size_t i = 0; i < nbSites; i++)
+  runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
   {
-    VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-      for (size_t s = 0; s < nbStates_; s++)
+      VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        (*_d2Likelihoods_father_i_c)[s] = 1.;
+        Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+        for (size_t s = 0; s < nbStates_; s++)
+        {
+          (*_d2Likelihoods_father_i_c)[s] = 1.;
+        }
       }
     }
-  }
+  });
 
   size_t nbNodes = father->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
@@ -743,52 +792,58 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node
     if (son == node)
     {
       VVVdouble* _d2Likelihoods_son = &likelihoodData_->getD2LikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _d2Likelihoods_son_i = &(*_d2Likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _d2Likelihoods_son_i_c = &(*_d2Likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _d2Likelihoods_son_i = &(*_d2Likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double d2l = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _d2Likelihoods_son_i_c = &(*_d2Likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              d2l += (*pxy__son_c_x)[y] * (*_d2Likelihoods_son_i_c)[y];
+              double d2l = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                d2l += (*pxy__son_c_x)[y] * (*_d2Likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= dl;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
   }
 
@@ -806,6 +861,20 @@ void RHomogeneousTreeLikelihood::computeTreeLikelihood()
 /******************************************************************************/
 
 void RHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
+{
+  if (node->isLeaf())
+    return;
+
+  for (size_t l = 0; l < node->getNumberOfSons(); l++)
+  {
+    computeSubtreeLikelihood(node->getSon(l)); //Recursive method:
+  }
+  computeLikelihoodAtNode_(node);
+}
+
+/******************************************************************************/
+
+void RHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node)
 {
   if (node->isLeaf())
     return;
@@ -815,21 +884,24 @@ void RHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
 
   // Must reset the likelihood array first (i.e. set all of them to 1):
   VVVdouble* _likelihoods_node = &likelihoodData_->getLikelihoodArray(node->getId());
-  for (size_t i = 0; i < nbSites; i++)
+  runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
   {
-    //For each site in the sequence,
-    VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      //For each rate classe,
-      Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-      for (size_t x = 0; x < nbStates_; x++)
+      //For each site in the sequence,
+      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        //For each initial state,
-        (*_likelihoods_node_i_c)[x] = 1.;
+        //For each rate classe,
+        Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
+        for (size_t x = 0; x < nbStates_; x++)
+        {
+          //For each initial state,
+          (*_likelihoods_node_i_c)[x] = 1.;
+        }
       }
     }
-  }
+  });
 
   for (size_t l = 0; l < nbNodes; l++)
   {
@@ -837,35 +909,36 @@ void RHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
 
     const Node* son = node->getSon(l);
 
-    computeSubtreeLikelihood(son); //Recursive method:
-
     VVVdouble* pxy__son = &pxy_[son->getId()];
     vector<size_t> * _patternLinks_node_son = &likelihoodData_->getArrayPositions(node->getId(), son->getId());
     VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
-    for (size_t i = 0; i < nbSites; i++)
+    runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
     {
-      //For each site in the sequence,
-      VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_node_son)[i]];
-      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
+      for (size_t i = firstSite; i < lastSite; i++)
       {
-        //For each rate classe,
-        Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-        Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-        VVdouble* pxy__son_c = &(*pxy__son)[c];
-        for (size_t x = 0; x < nbStates_; x++)
+        //For each site in the sequence,
+        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_node_son)[i]];
+        VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          //For each initial state,
-          Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates_; y++)
-            likelihood += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+          //For each rate classe,
+          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+          Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
+          VVdouble* pxy__son_c = &(*pxy__son)[c];
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            //For each initial state,
+            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+            double likelihood = 0;
+            for (size_t y = 0; y < nbStates_; y++)
+              likelihood += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
           
-          (*_likelihoods_node_i_c)[x] *= likelihood;
+            (*_likelihoods_node_i_c)[x] *= likelihood;
+          }
         }
       }
-    }
+    });
   }
   
 }
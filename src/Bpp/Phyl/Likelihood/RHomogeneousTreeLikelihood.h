@@ -43,10 +43,14 @@
 #include "AbstractHomogeneousTreeLikelihood.h"
 #include "../Model/SubstitutionModel.h"
 #include "DRASRTreeLikelihoodData.h"
+#include "../SiteLoopExecutor.h"
 
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Prob/DiscreteDistribution.h>
 
+// From the STL:
+#include <memory>
+
 namespace bpp
 {
 
@@ -86,6 +90,11 @@ namespace bpp
 
     mutable DRASRTreeLikelihoodData* likelihoodData_;
 
+    /**
+     * @brief Threads used by site loops, null if there is only one thread.
+     */
+    std::unique_ptr<SiteLoopExecutor> siteLoopExecutor_;
+
   protected:
     double minusLogLik_;
 
@@ -220,6 +229,19 @@ namespace bpp
     DRASRTreeLikelihoodData* getLikelihoodData() { return likelihoodData_; }
     const DRASRTreeLikelihoodData* getLikelihoodData() const { return likelihoodData_; }
 
+    /**
+     * @brief Set the number of threads used to compute likelihood arrays and their derivatives.
+     *
+     * The patterns of each node array are split into one contiguous block per thread
+     * (see SiteLoopExecutor). Sums over sites are still performed serially, in site order,
+     * so that results do not depend on the number of threads.
+     *
+     * @param nbThreads The number of threads, including the calling one. 1 (the default) means no additional thread.
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    size_t getNumberOfThreads() const { return siteLoopExecutor_ ? siteLoopExecutor_->getNumberOfThreads() : 1; }
+
     void computeTreeLikelihood();
 
     virtual double getDLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const;
@@ -244,6 +266,13 @@ namespace bpp
 
 	
   protected:
+    /**
+     * @brief Run a loop over the patterns of a node array, split over the threads if any.
+     *
+     * @param nbSites The number of patterns.
+     * @param loop A function computing patterns in [first, last).
+     */
+    void runParallelLoop_(size_t nbSites, const std::function<void(size_t, size_t)>& loop) const;
 			
     /**
      * @brief Compute the likelihood for a subtree defined by the Tree::Node <i>node</i>.
@@ -251,6 +280,16 @@ namespace bpp
      * @param node The root of the subtree.
      */
     virtual void computeSubtreeLikelihood(const Node* node); //Recursive method.			
+
+    /**
+     * @brief Compute the likelihood array of one node from the arrays of its sons.
+     *
+     * The arrays of the sons are assumed to be up to date.
+     *
+     * @param node The node to update.
+     */
+    void computeLikelihoodAtNode_(const Node* node);
+
     virtual void computeDownSubtreeDLikelihood(const Node*);
 		
     virtual void computeDownSubtreeD2Likelihood(const Node*);
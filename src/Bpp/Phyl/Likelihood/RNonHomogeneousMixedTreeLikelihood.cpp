@@ -64,7 +64,8 @@ RNonHomogeneousMixedTreeLikelihood::RNonHomogeneousMixedTreeLikelihood(const Tre
   mvTreeLikelihoods_(),
   hyperNode_(modelSet),
   upperNode_(tree.getRootId()),
-  main_(true)
+  main_(true),
+  componentExecutor_()
 {
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("RNonHomogeneousMixedTreeLikelihood(constructor). Model set is not fully specified.");
@@ -87,7 +88,8 @@ RNonHomogeneousMixedTreeLikelihood::RNonHomogeneousMixedTreeLikelihood(const Tre
   mvTreeLikelihoods_(),
   hyperNode_(modelSet),
   upperNode_(tree.getRootId()),
-  main_(true)
+  main_(true),
+  componentExecutor_()
 {
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("RNonHomogeneousMixedTreeLikelihood(constructor). Model set is not fully specified.");
@@ -109,7 +111,8 @@ RNonHomogeneousMixedTreeLikelihood::RNonHomogeneousMixedTreeLikelihood(const Tre
   mvTreeLikelihoods_(),
   hyperNode_(hyperNode),
   upperNode_(upperNode),
-  main_(false)
+  main_(false),
+  componentExecutor_()
 {
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("RNonHomogeneousMixedTreeLikelihood(constructor). Model set is not fully specified.");
@@ -131,7 +134,8 @@ RNonHomogeneousMixedTreeLikelihood::RNonHomogeneousMixedTreeLikelihood(const Tre
   mvTreeLikelihoods_(),
   hyperNode_(hyperNode),
   upperNode_(upperNode),
-  main_(false)
+  main_(false),
+  componentExecutor_()
 {
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("RNonHomogeneousMixedTreeLikelihood(constructor). Model set is not fully specified.");
@@ -256,8 +260,11 @@ RNonHomogeneousMixedTreeLikelihood::RNonHomogeneousMixedTreeLikelihood(
   mvTreeLikelihoods_(),
   hyperNode_(lik.hyperNode_),
   upperNode_(lik.upperNode_),
-  main_(lik.main_)
+  main_(lik.main_),
+  componentExecutor_()
 {
+  setNumberOfComponentThreads(lik.getNumberOfComponentThreads());
+
   map<int, vector<RNonHomogeneousMixedTreeLikelihood*> >::const_iterator it;
   for (it = lik.mvTreeLikelihoods_.begin(); it != lik.mvTreeLikelihoods_.end(); it++)
   {
@@ -291,6 +298,8 @@ RNonHomogeneousMixedTreeLikelihood& RNonHomogeneousMixedTreeLikelihood::operator
 
   hyperNode_=lik.hyperNode_;
 
+  setNumberOfComponentThreads(lik.getNumberOfComponentThreads());
+
   return *this;
 }
 
@@ -308,6 +317,26 @@ RNonHomogeneousMixedTreeLikelihood::~RNonHomogeneousMixedTreeLikelihood()
   }
 }
 
+/******************************************************************************/
+
+void RNonHomogeneousMixedTreeLikelihood::setNumberOfComponentThreads(size_t nbThreads)
+{
+  if (nbThreads == getNumberOfComponentThreads())
+    return;
+  if (nbThreads <= 1)
+    componentExecutor_.reset();
+  else
+    componentExecutor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
+void RNonHomogeneousMixedTreeLikelihood::runComponentLoop_(size_t nbComponents, const std::function<void(size_t, size_t)>& loop) const
+{
+  if (componentExecutor_)
+    componentExecutor_->run(nbComponents, loop);
+  else if (nbComponents > 0)
+    loop(0, nbComponents);
+}
+
 /******************************************************************************/
  void RNonHomogeneousMixedTreeLikelihood::initialize()
 {
@@ -372,7 +401,7 @@ RNonHomogeneousMixedTreeLikelihood::~RNonHomogeneousMixedTreeLikelihood()
     rootFreqs_ = modelSet_->getRootFrequencies();
   }
   else {
-    if (params.getCommonParametersWith(rateDistribution_->getIndependentParameters()).size() > 0)
+    if (haveCommonParameters(params, rateDistribution_->getIndependentParameters()))
       {
         computeAllTransitionProbabilities();
       }
@@ -493,8 +522,10 @@ void RNonHomogeneousMixedTreeLikelihood::computeSubtreeLikelihood(const Node* no
       return;
   
     vector<RNonHomogeneousMixedTreeLikelihood* > vr = mvTreeLikelihoods_[nodeId];
-    for (size_t t = 0; t < vr.size(); t++)
-      vr[t]->computeSubtreeLikelihood(node);
+    runComponentLoop_(vr.size(), [&](size_t firstComponent, size_t lastComponent) {
+      for (size_t t = firstComponent; t < lastComponent; t++)
+        vr[t]->computeSubtreeLikelihood(node);
+    });
 
     // for each specific subtree
     for (size_t t = 0; t < vr.size(); t++)
@@ -579,8 +610,10 @@ void RNonHomogeneousMixedTreeLikelihood::computeTreeDLikelihood(const string& va
 
     if (getProbability()!=0){
       vector<RNonHomogeneousMixedTreeLikelihood* > vr = mvTreeLikelihoods_[fatherId];
-      for (size_t t = 0; t < vr.size(); t++)
-        vr[t]->computeTreeDLikelihood(variable);
+      runComponentLoop_(vr.size(), [&](size_t firstComponent, size_t lastComponent) {
+        for (size_t t = firstComponent; t < lastComponent; t++)
+          vr[t]->computeTreeDLikelihood(variable);
+      });
       
     
       // for each specific subtree
@@ -672,8 +705,10 @@ void RNonHomogeneousMixedTreeLikelihood::computeTreeD2Likelihood(const string& v
       if (getProbability()!=0){
         
         vector<RNonHomogeneousMixedTreeLikelihood* > vr = mvTreeLikelihoods_[fatherId];
-        for (size_t t = 0; t < vr.size(); t++)
-          vr[t]->computeTreeD2Likelihood(variable);
+        runComponentLoop_(vr.size(), [&](size_t firstComponent, size_t lastComponent) {
+          for (size_t t = firstComponent; t < lastComponent; t++)
+            vr[t]->computeTreeD2Likelihood(variable);
+        });
       
         // for each specific subtree
         for (size_t t = 0; t < vr.size(); t++) {
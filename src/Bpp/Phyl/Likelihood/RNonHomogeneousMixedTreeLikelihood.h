@@ -105,6 +105,13 @@ private:
    **/
 
   bool main_;
+
+  /**
+   * @brief Threads computing the owned RNonHomogeneousMixedTreeLikelihood
+   * objects concurrently (none by default).
+   */
+
+  std::unique_ptr<SiteLoopExecutor> componentExecutor_;
   
   /**
    * @brief Build a new RNonHomogeneousMixeTreeLikelihood object
@@ -267,8 +274,31 @@ public:
    */
 
   const MixedSubstitutionModelSet::HyperNode& getHyperNode() { return hyperNode_;}
+
+  /**
+   * @brief Set the number of threads computing the likelihood arrays
+   * of the expanded submodels concurrently.
+   *
+   * Each thread computes the arrays of a contiguous block of owned
+   * objects, which are fully independent. Their weighted sum is then
+   * performed serially, in the same order whatever the number of
+   * threads. Transition probabilities are still computed serially,
+   * since owned objects share the same model set.
+   *
+   * @param nbThreads The number of threads, including the calling one. 1 (the default) means no additional thread.
+   */
+  void setNumberOfComponentThreads(size_t nbThreads);
+
+  size_t getNumberOfComponentThreads() const { return componentExecutor_ ? componentExecutor_->getNumberOfThreads() : 1; }
+
 protected:
 
+  /**
+   * @brief Run a loop over owned objects, in parallel if component threads are set.
+   */
+  void runComponentLoop_(size_t nbComponents, const std::function<void(size_t, size_t)>& loop) const;
+
+
 
   /**
    * @brief Compute the likelihood for a subtree defined by the Tree::Node <i>node</i>.
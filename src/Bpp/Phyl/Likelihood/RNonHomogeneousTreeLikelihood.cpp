@@ -39,6 +39,7 @@
  */
 
 #include "RNonHomogeneousTreeLikelihood.h"
+#include "CompensatedSum.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -62,6 +63,7 @@ RNonHomogeneousTreeLikelihood::RNonHomogeneousTreeLikelihood(
   bool reparametrizeRoot) :
   AbstractNonHomogeneousTreeLikelihood(tree, modelSet, rDist, verbose, reparametrizeRoot),
   likelihoodData_(0),
+  siteLoopExecutor_(),
   minusLogLik_(-1.)
 {
   if (!modelSet->isFullySetUpFor(tree))
@@ -81,6 +83,7 @@ RNonHomogeneousTreeLikelihood::RNonHomogeneousTreeLikelihood(
   bool reparametrizeRoot) :
   AbstractNonHomogeneousTreeLikelihood(tree, modelSet, rDist, verbose, reparametrizeRoot),
   likelihoodData_(0),
+  siteLoopExecutor_(),
   minusLogLik_(-1.)
 {
   if (!modelSet->isFullySetUpFor(tree))
@@ -105,10 +108,12 @@ RNonHomogeneousTreeLikelihood::RNonHomogeneousTreeLikelihood(
   const RNonHomogeneousTreeLikelihood& lik) :
   AbstractNonHomogeneousTreeLikelihood(lik),
   likelihoodData_(0),
+  siteLoopExecutor_(),
   minusLogLik_(lik.minusLogLik_)
 {
   likelihoodData_ = dynamic_cast<DRASRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
+  setNumberOfThreads(lik.getNumberOfThreads());
 }
 
 /******************************************************************************/
@@ -121,6 +126,7 @@ RNonHomogeneousTreeLikelihood& RNonHomogeneousTreeLikelihood::operator=(
   likelihoodData_ = dynamic_cast<DRASRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
   minusLogLik_ = lik.minusLogLik_;
+  setNumberOfThreads(lik.getNumberOfThreads());
   return *this;
 }
 
@@ -133,10 +139,29 @@ RNonHomogeneousTreeLikelihood::~RNonHomogeneousTreeLikelihood()
 
 /******************************************************************************/
 
+void RNonHomogeneousTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  if (nbThreads == getNumberOfThreads())
+    return;
+  if (nbThreads <= 1)
+    siteLoopExecutor_.reset();
+  else
+    siteLoopExecutor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
+void RNonHomogeneousTreeLikelihood::runParallelLoop_(size_t nbSites, const std::function<void(size_t, size_t)>& loop) const
+{
+  if (siteLoopExecutor_)
+    siteLoopExecutor_->run(nbSites, loop);
+  else if (nbSites > 0)
+    loop(0, nbSites);
+}
+
+/******************************************************************************/
+
 void RNonHomogeneousTreeLikelihood::setData(const AlignedValuesContainer& sites)
 {
-  if (data_) delete data_;
-  data_ = PatternTools::getSequenceSubset(sites, *tree_->getRootNode());
+  data_.reset(PatternTools::getSequenceSubset(sites, *tree_->getRootNode()));
   if (verbose_) ApplicationTools::displayTask("Initializing data structure");
   likelihoodData_->initLikelihoods(*data_, *modelSet_->getModel(0)); //We assume here that all models have the same number of states, and that they have the same 'init' method,
                                                                      //Which is a reasonable assumption as long as they share the same alphabet.
@@ -167,18 +192,12 @@ double RNonHomogeneousTreeLikelihood::getLikelihood() const
 
 double RNonHomogeneousTreeLikelihood::getLogLikelihood() const
 {
-  double ll = 0;
-  vector<double> la(nbSites_);
+  CompensatedSum ll;
   for (size_t i = 0; i < nbSites_; i++)
   {
-    la[i] = getLogLikelihoodForASite(i);
-  }
-  sort(la.begin(), la.end());
-  for (size_t i = nbSites_; i > 0; i--)
-  {
-    ll += la[i - 1];
+    ll.add(getLogLikelihoodForASite(i));
   }
-  return ll;
+  return ll.getValue();
 }
 
 /******************************************************************************/
@@ -260,7 +279,7 @@ void RNonHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& pa
 {
   applyParameters();
 
-  if (params.getCommonParametersWith(rateDistribution_->getIndependentParameters()).size() > 0)
+  if (haveCommonParameters(params, rateDistribution_->getIndependentParameters()))
   {
     computeAllTransitionProbabilities();
   }
@@ -398,18 +417,21 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
     // Fist initialize to 1:
     VVVdouble* _dLikelihoods_father = &likelihoodData_->getDLikelihoodArray(father->getId());
     size_t nbSites  = _dLikelihoods_father->size();
-    for (size_t i = 0; i < nbSites; i++)
+    runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
     {
-      VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
+      for (size_t i = firstSite; i < lastSite; i++)
       {
-        Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-        for (size_t s = 0; s < nbStates_; s++)
+        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          (*_dLikelihoods_father_i_c)[s] = 1.;
+          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+          for (size_t s = 0; s < nbStates_; s++)
+          {
+            (*_dLikelihoods_father_i_c)[s] = 1.;
+          }
         }
       }
-    }
+    });
 
     size_t nbNodes = father->getNumberOfSons();
     for (size_t l = 0; l < nbNodes; l++)
@@ -430,39 +452,42 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
         VVVdouble* dpxy_root2_  = &dpxy_[root2_];
         VVVdouble* pxy_root1_   = &pxy_[root1_];
         VVVdouble* pxy_root2_   = &pxy_[root2_];
-        for (size_t i = 0; i < nbSites; i++)
+        runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
         {
-          VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
-          VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
-          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-          for (size_t c = 0; c < nbClasses_; c++)
+          for (size_t i = firstSite; i < lastSite; i++)
           {
-            Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
-            Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
-            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-            VVdouble* dpxy_root1__c  = &(*dpxy_root1_)[c];
-            VVdouble* dpxy_root2__c  = &(*dpxy_root2_)[c];
-            VVdouble* pxy_root1__c   = &(*pxy_root1_)[c];
-            VVdouble* pxy_root2__c   = &(*pxy_root2_)[c];
-            for (size_t x = 0; x < nbStates_; x++)
+            VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
+            VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
+            VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+            for (size_t c = 0; c < nbClasses_; c++)
             {
-              Vdouble* dpxy_root1__c_x  = &(*dpxy_root1__c)[x];
-              Vdouble* dpxy_root2__c_x  = &(*dpxy_root2__c)[x];
-              Vdouble* pxy_root1__c_x   = &(*pxy_root1__c)[x];
-              Vdouble* pxy_root2__c_x   = &(*pxy_root2__c)[x];
-              double dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
-              for (size_t y = 0; y < nbStates_; y++)
+              Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
+              Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
+              Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+              VVdouble* dpxy_root1__c  = &(*dpxy_root1_)[c];
+              VVdouble* dpxy_root2__c  = &(*dpxy_root2_)[c];
+              VVdouble* pxy_root1__c   = &(*pxy_root1_)[c];
+              VVdouble* pxy_root2__c   = &(*pxy_root2_)[c];
+              for (size_t x = 0; x < nbStates_; x++)
               {
-                dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
-                dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
-                l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
-                l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                Vdouble* dpxy_root1__c_x  = &(*dpxy_root1__c)[x];
+                Vdouble* dpxy_root2__c_x  = &(*dpxy_root2__c)[x];
+                Vdouble* pxy_root1__c_x   = &(*pxy_root1__c)[x];
+                Vdouble* pxy_root2__c_x   = &(*pxy_root2__c)[x];
+                double dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
+                for (size_t y = 0; y < nbStates_; y++)
+                {
+                  dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
+                  dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
+                  l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
+                  l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                }
+                double dl = pos * dl1 * l2 + (1. - pos) * dl2 * l1;
+                (*_dLikelihoods_father_i_c)[x] *= dl;
               }
-              double dl = pos * dl1 * l2 + (1. - pos) * dl2 * l1;
-              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
           }
-        }
+        });
       }
       else if (son->getId() == root2_)
       {
@@ -475,27 +500,30 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
         VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
-        for (size_t i = 0; i < nbSites; i++)
+        runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
         {
-          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-          for (size_t c = 0; c < nbClasses_; c++)
+          for (size_t i = firstSite; i < lastSite; i++)
           {
-            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-            VVdouble* pxy__son_c = &(*pxy__son)[c];
-            for (size_t x = 0; x < nbStates_; x++)
+            VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+            VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+            for (size_t c = 0; c < nbClasses_; c++)
             {
-              double dl = 0;
-              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-              for (size_t y = 0; y < nbStates_; y++)
+              Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+              Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+              VVdouble* pxy__son_c = &(*pxy__son)[c];
+              for (size_t x = 0; x < nbStates_; x++)
               {
-                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                double dl = 0;
+                Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+                for (size_t y = 0; y < nbStates_; y++)
+                {
+                  dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                }
+                (*_dLikelihoods_father_i_c)[x] *= dl;
               }
-              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
           }
-        }
+        });
       }
     }
     return;
@@ -508,18 +536,21 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
     // Fist initialize to 1:
     VVVdouble* _dLikelihoods_father = &likelihoodData_->getDLikelihoodArray(father->getId());
     size_t nbSites  = _dLikelihoods_father->size();
-    for (size_t i = 0; i < nbSites; i++)
+    runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
     {
-      VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
+      for (size_t i = firstSite; i < lastSite; i++)
       {
-        Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-        for (size_t s = 0; s < nbStates_; s++)
+        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          (*_dLikelihoods_father_i_c)[s] = 1.;
+          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+          for (size_t s = 0; s < nbStates_; s++)
+          {
+            (*_dLikelihoods_father_i_c)[s] = 1.;
+          }
         }
       }
-    }
+    });
 
     size_t nbNodes = father->getNumberOfSons();
     for (size_t l = 0; l < nbNodes; l++)
@@ -540,39 +571,42 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
         VVVdouble* dpxy_root2_  = &dpxy_[root2_];
         VVVdouble* pxy_root1_   = &pxy_[root1_];
         VVVdouble* pxy_root2_   = &pxy_[root2_];
-        for (size_t i = 0; i < nbSites; i++)
+        runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
         {
-          VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
-          VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
-          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-          for (size_t c = 0; c < nbClasses_; c++)
+          for (size_t i = firstSite; i < lastSite; i++)
           {
-            Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
-            Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
-            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-            VVdouble* dpxy_root1__c  = &(*dpxy_root1_)[c];
-            VVdouble* dpxy_root2__c  = &(*dpxy_root2_)[c];
-            VVdouble* pxy_root1__c   = &(*pxy_root1_)[c];
-            VVdouble* pxy_root2__c   = &(*pxy_root2_)[c];
-            for (size_t x = 0; x < nbStates_; x++)
+            VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
+            VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
+            VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+            for (size_t c = 0; c < nbClasses_; c++)
             {
-              Vdouble* dpxy_root1__c_x  = &(*dpxy_root1__c)[x];
-              Vdouble* dpxy_root2__c_x  = &(*dpxy_root2__c)[x];
-              Vdouble* pxy_root1__c_x   = &(*pxy_root1__c)[x];
-              Vdouble* pxy_root2__c_x   = &(*pxy_root2__c)[x];
-              double dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
-              for (size_t y = 0; y < nbStates_; y++)
+              Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
+              Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
+              Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+              VVdouble* dpxy_root1__c  = &(*dpxy_root1_)[c];
+              VVdouble* dpxy_root2__c  = &(*dpxy_root2_)[c];
+              VVdouble* pxy_root1__c   = &(*pxy_root1_)[c];
+              VVdouble* pxy_root2__c   = &(*pxy_root2_)[c];
+              for (size_t x = 0; x < nbStates_; x++)
               {
-                dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
-                dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
-                l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
-                l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                Vdouble* dpxy_root1__c_x  = &(*dpxy_root1__c)[x];
+                Vdouble* dpxy_root2__c_x  = &(*dpxy_root2__c)[x];
+                Vdouble* pxy_root1__c_x   = &(*pxy_root1__c)[x];
+                Vdouble* pxy_root2__c_x   = &(*pxy_root2__c)[x];
+                double dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
+                for (size_t y = 0; y < nbStates_; y++)
+                {
+                  dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
+                  dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
+                  l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
+                  l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                }
+                double dl = len * (dl1 * l2 - dl2 * l1);
+                (*_dLikelihoods_father_i_c)[x] *= dl;
               }
-              double dl = len * (dl1 * l2 - dl2 * l1);
-              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
           }
-        }
+        });
       }
       else if (son->getId() == root2_)
       {
@@ -585,27 +619,30 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
         VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
-        for (size_t i = 0; i < nbSites; i++)
+        runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
         {
-          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-          for (size_t c = 0; c < nbClasses_; c++)
+          for (size_t i = firstSite; i < lastSite; i++)
           {
-            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-            VVdouble* pxy__son_c = &(*pxy__son)[c];
-            for (size_t x = 0; x < nbStates_; x++)
+            VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+            VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+            for (size_t c = 0; c < nbClasses_; c++)
             {
-              double dl = 0;
-              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-              for (size_t y = 0; y < nbStates_; y++)
+              Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+              Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+              VVdouble* pxy__son_c = &(*pxy__son)[c];
+              for (size_t x = 0; x < nbStates_; x++)
               {
-                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                double dl = 0;
+                Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+                for (size_t y = 0; y < nbStates_; y++)
+                {
+                  dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                }
+                (*_dLikelihoods_father_i_c)[x] *= dl;
               }
-              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
           }
-        }
+        });
       }
     }
     return;
@@ -620,18 +657,21 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
   // Compute dLikelihoods array for the father node.
   // Fist initialize to 1:
   size_t nbSites  = _dLikelihoods_father->size();
-  for (size_t i = 0; i < nbSites; i++)
+  runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
   {
-    VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-      for (size_t s = 0; s < nbStates_; s++)
+      VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        (*_dLikelihoods_father_i_c)[s] = 1.;
+        Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+        for (size_t s = 0; s < nbStates_; s++)
+        {
+          (*_dLikelihoods_father_i_c)[s] = 1.;
+        }
       }
     }
-  }
+  });
 
   size_t nbNodes = father->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
@@ -644,52 +684,58 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
     if (son == branch)
     {
       VVVdouble* dpxy__son = &dpxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* dpxy__son_c = &(*dpxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* dpxy__son_c_x = &(*dpxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* dpxy__son_c = &(*dpxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*dpxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* dpxy__son_c_x = &(*dpxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*dpxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* pxy__son = &pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
   }
 
@@ -710,18 +756,21 @@ void RNonHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* no
   // Fist initialize to 1:
   VVVdouble* _dLikelihoods_father = &likelihoodData_->getDLikelihoodArray(father->getId());
   size_t nbSites  = _dLikelihoods_father->size();
-  for (size_t i = 0; i < nbSites; i++)
+  runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
   {
-    VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-      for (size_t s = 0; s < nbStates_; s++)
+      VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        (*_dLikelihoods_father_i_c)[s] = 1.;
+        Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+        for (size_t s = 0; s < nbStates_; s++)
+        {
+          (*_dLikelihoods_father_i_c)[s] = 1.;
+        }
       }
     }
-  }
+  });
 
   size_t nbNodes = father->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
@@ -734,52 +783,58 @@ void RNonHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* no
     if (son == node)
     {
       VVVdouble* _dLikelihoods_son = &likelihoodData_->getDLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _dLikelihoods_son_i = &(*_dLikelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _dLikelihoods_son_i_c = &(*_dLikelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _dLikelihoods_son_i = &(*_dLikelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _dLikelihoods_son_i_c = &(*_dLikelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_dLikelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_dLikelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
   }
 
@@ -869,18 +924,21 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
     // Fist initialize to 1:
     VVVdouble* _d2Likelihoods_father = &likelihoodData_->getD2LikelihoodArray(father->getId());
     size_t nbSites  = _d2Likelihoods_father->size();
-    for (size_t i = 0; i < nbSites; i++)
+    runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
     {
-      VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
+      for (size_t i = firstSite; i < lastSite; i++)
       {
-        Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-        for (size_t s = 0; s < nbStates_; s++)
+        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          (*_d2Likelihoods_father_i_c)[s] = 1.;
+          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+          for (size_t s = 0; s < nbStates_; s++)
+          {
+            (*_d2Likelihoods_father_i_c)[s] = 1.;
+          }
         }
       }
-    }
+    });
 
     size_t nbNodes = father->getNumberOfSons();
     for (size_t l = 0; l < nbNodes; l++)
@@ -903,45 +961,48 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
         VVVdouble* dpxy_root2_  = &dpxy_[root2_];
         VVVdouble* pxy_root1_   = &pxy_[root1_];
         VVVdouble* pxy_root2_   = &pxy_[root2_];
-        for (size_t i = 0; i < nbSites; i++)
+        runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
         {
-          VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
-          VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
-          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-          for (size_t c = 0; c < nbClasses_; c++)
+          for (size_t i = firstSite; i < lastSite; i++)
           {
-            Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
-            Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
-            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-            VVdouble* d2pxy_root1__c = &(*d2pxy_root1_)[c];
-            VVdouble* d2pxy_root2__c = &(*d2pxy_root2_)[c];
-            VVdouble* dpxy_root1__c  = &(*dpxy_root1_)[c];
-            VVdouble* dpxy_root2__c  = &(*dpxy_root2_)[c];
-            VVdouble* pxy_root1__c   = &(*pxy_root1_)[c];
-            VVdouble* pxy_root2__c   = &(*pxy_root2_)[c];
-            for (size_t x = 0; x < nbStates_; x++)
+            VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
+            VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
+            VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+            for (size_t c = 0; c < nbClasses_; c++)
             {
-              Vdouble* d2pxy_root1__c_x = &(*d2pxy_root1__c)[x];
-              Vdouble* d2pxy_root2__c_x = &(*d2pxy_root2__c)[x];
-              Vdouble* dpxy_root1__c_x  = &(*dpxy_root1__c)[x];
-              Vdouble* dpxy_root2__c_x  = &(*dpxy_root2__c)[x];
-              Vdouble* pxy_root1__c_x   = &(*pxy_root1__c)[x];
-              Vdouble* pxy_root2__c_x   = &(*pxy_root2__c)[x];
-              double d2l1 = 0, d2l2 = 0, dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
-              for (size_t y = 0; y < nbStates_; y++)
+              Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
+              Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
+              Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+              VVdouble* d2pxy_root1__c = &(*d2pxy_root1_)[c];
+              VVdouble* d2pxy_root2__c = &(*d2pxy_root2_)[c];
+              VVdouble* dpxy_root1__c  = &(*dpxy_root1_)[c];
+              VVdouble* dpxy_root2__c  = &(*dpxy_root2_)[c];
+              VVdouble* pxy_root1__c   = &(*pxy_root1_)[c];
+              VVdouble* pxy_root2__c   = &(*pxy_root2_)[c];
+              for (size_t x = 0; x < nbStates_; x++)
               {
-                d2l1 += (*d2pxy_root1__c_x)[y] * (*_likelihoodsroot1__i_c)[y];
-                d2l2 += (*d2pxy_root2__c_x)[y] * (*_likelihoodsroot2__i_c)[y];
-                dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
-                dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
-                l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
-                l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                Vdouble* d2pxy_root1__c_x = &(*d2pxy_root1__c)[x];
+                Vdouble* d2pxy_root2__c_x = &(*d2pxy_root2__c)[x];
+                Vdouble* dpxy_root1__c_x  = &(*dpxy_root1__c)[x];
+                Vdouble* dpxy_root2__c_x  = &(*dpxy_root2__c)[x];
+                Vdouble* pxy_root1__c_x   = &(*pxy_root1__c)[x];
+                Vdouble* pxy_root2__c_x   = &(*pxy_root2__c)[x];
+                double d2l1 = 0, d2l2 = 0, dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
+                for (size_t y = 0; y < nbStates_; y++)
+                {
+                  d2l1 += (*d2pxy_root1__c_x)[y] * (*_likelihoodsroot1__i_c)[y];
+                  d2l2 += (*d2pxy_root2__c_x)[y] * (*_likelihoodsroot2__i_c)[y];
+                  dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
+                  dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
+                  l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
+                  l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                }
+                double d2l = pos * pos * d2l1 * l2 + (1. - pos) * (1. - pos) * d2l2 * l1 + 2 * pos * (1. - pos) * dl1 * dl2;
+                (*_d2Likelihoods_father_i_c)[x] *= d2l;
               }
-              double d2l = pos * pos * d2l1 * l2 + (1. - pos) * (1. - pos) * d2l2 * l1 + 2 * pos * (1. - pos) * dl1 * dl2;
-              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
           }
-        }
+        });
       }
       else if (son->getId() == root2_)
       {
@@ -954,27 +1015,30 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
         VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
-        for (size_t i = 0; i < nbSites; i++)
+        runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
         {
-          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-          for (size_t c = 0; c < nbClasses_; c++)
+          for (size_t i = firstSite; i < lastSite; i++)
           {
-            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-            VVdouble* pxy__son_c = &(*pxy__son)[c];
-            for (size_t x = 0; x < nbStates_; x++)
+            VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+            VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+            for (size_t c = 0; c < nbClasses_; c++)
             {
-              double d2l = 0;
-              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-              for (size_t y = 0; y < nbStates_; y++)
+              Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+              Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+              VVdouble* pxy__son_c = &(*pxy__son)[c];
+              for (size_t x = 0; x < nbStates_; x++)
               {
-                d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                double d2l = 0;
+                Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+                for (size_t y = 0; y < nbStates_; y++)
+                {
+                  d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                }
+                (*_d2Likelihoods_father_i_c)[x] *= d2l;
               }
-              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
           }
-        }
+        });
       }
     }
     return;
@@ -987,18 +1051,21 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
     // Fist initialize to 1:
     VVVdouble* _d2Likelihoods_father = &likelihoodData_->getD2LikelihoodArray(father->getId());
     size_t nbSites  = _d2Likelihoods_father->size();
-    for (size_t i = 0; i < nbSites; i++)
+    runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
     {
-      VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
+      for (size_t i = firstSite; i < lastSite; i++)
       {
-        Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-        for (size_t s = 0; s < nbStates_; s++)
+        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          (*_d2Likelihoods_father_i_c)[s] = 1.;
+          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+          for (size_t s = 0; s < nbStates_; s++)
+          {
+            (*_d2Likelihoods_father_i_c)[s] = 1.;
+          }
         }
       }
-    }
+    });
 
     size_t nbNodes = father->getNumberOfSons();
     for (size_t l = 0; l < nbNodes; l++)
@@ -1021,45 +1088,48 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
         VVVdouble* dpxy_root2_  = &dpxy_[root2_];
         VVVdouble* pxy_root1_   = &pxy_[root1_];
         VVVdouble* pxy_root2_   = &pxy_[root2_];
-        for (size_t i = 0; i < nbSites; i++)
+        runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
         {
-          VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
-          VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
-          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-          for (size_t c = 0; c < nbClasses_; c++)
+          for (size_t i = firstSite; i < lastSite; i++)
           {
-            Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
-            Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
-            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-            VVdouble* d2pxy_root1__c = &(*d2pxy_root1_)[c];
-            VVdouble* d2pxy_root2__c = &(*d2pxy_root2_)[c];
-            VVdouble* dpxy_root1__c  = &(*dpxy_root1_)[c];
-            VVdouble* dpxy_root2__c  = &(*dpxy_root2_)[c];
-            VVdouble* pxy_root1__c   = &(*pxy_root1_)[c];
-            VVdouble* pxy_root2__c   = &(*pxy_root2_)[c];
-            for (size_t x = 0; x < nbStates_; x++)
+            VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
+            VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
+            VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+            for (size_t c = 0; c < nbClasses_; c++)
             {
-              Vdouble* d2pxy_root1__c_x = &(*d2pxy_root1__c)[x];
-              Vdouble* d2pxy_root2__c_x = &(*d2pxy_root2__c)[x];
-              Vdouble* dpxy_root1__c_x  = &(*dpxy_root1__c)[x];
-              Vdouble* dpxy_root2__c_x  = &(*dpxy_root2__c)[x];
-              Vdouble* pxy_root1__c_x   = &(*pxy_root1__c)[x];
-              Vdouble* pxy_root2__c_x   = &(*pxy_root2__c)[x];
-              double d2l1 = 0, d2l2 = 0, dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
-              for (size_t y = 0; y < nbStates_; y++)
+              Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
+              Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
+              Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+              VVdouble* d2pxy_root1__c = &(*d2pxy_root1_)[c];
+              VVdouble* d2pxy_root2__c = &(*d2pxy_root2_)[c];
+              VVdouble* dpxy_root1__c  = &(*dpxy_root1_)[c];
+              VVdouble* dpxy_root2__c  = &(*dpxy_root2_)[c];
+              VVdouble* pxy_root1__c   = &(*pxy_root1_)[c];
+              VVdouble* pxy_root2__c   = &(*pxy_root2_)[c];
+              for (size_t x = 0; x < nbStates_; x++)
               {
-                d2l1 += (*d2pxy_root1__c_x)[y] * (*_likelihoodsroot1__i_c)[y];
-                d2l2 += (*d2pxy_root2__c_x)[y] * (*_likelihoodsroot2__i_c)[y];
-                dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
-                dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
-                l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
-                l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                Vdouble* d2pxy_root1__c_x = &(*d2pxy_root1__c)[x];
+                Vdouble* d2pxy_root2__c_x = &(*d2pxy_root2__c)[x];
+                Vdouble* dpxy_root1__c_x  = &(*dpxy_root1__c)[x];
+                Vdouble* dpxy_root2__c_x  = &(*dpxy_root2__c)[x];
+                Vdouble* pxy_root1__c_x   = &(*pxy_root1__c)[x];
+                Vdouble* pxy_root2__c_x   = &(*pxy_root2__c)[x];
+                double d2l1 = 0, d2l2 = 0, dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
+                for (size_t y = 0; y < nbStates_; y++)
+                {
+                  d2l1 += (*d2pxy_root1__c_x)[y] * (*_likelihoodsroot1__i_c)[y];
+                  d2l2 += (*d2pxy_root2__c_x)[y] * (*_likelihoodsroot2__i_c)[y];
+                  dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
+                  dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
+                  l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
+                  l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                }
+                double d2l = len * len * (d2l1 * l2 + d2l2 * l1 - 2 * dl1 * dl2);
+                (*_d2Likelihoods_father_i_c)[x] *= d2l;
               }
-              double d2l = len * len * (d2l1 * l2 + d2l2 * l1 - 2 * dl1 * dl2);
-              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
           }
-        }
+        });
       }
       else if (son->getId() == root2_)
       {
@@ -1072,27 +1142,30 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
         VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
-        for (size_t i = 0; i < nbSites; i++)
+        runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
         {
-          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-          for (size_t c = 0; c < nbClasses_; c++)
+          for (size_t i = firstSite; i < lastSite; i++)
           {
-            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-            VVdouble* pxy__son_c = &(*pxy__son)[c];
-            for (size_t x = 0; x < nbStates_; x++)
+            VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+            VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+            for (size_t c = 0; c < nbClasses_; c++)
             {
-              double d2l = 0;
-              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-              for (size_t y = 0; y < nbStates_; y++)
+              Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+              Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+              VVdouble* pxy__son_c = &(*pxy__son)[c];
+              for (size_t x = 0; x < nbStates_; x++)
               {
-                d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                double d2l = 0;
+                Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+                for (size_t y = 0; y < nbStates_; y++)
+                {
+                  d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                }
+                (*_d2Likelihoods_father_i_c)[x] *= d2l;
               }
-              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
           }
-        }
+        });
       }
     }
     return;
@@ -1107,18 +1180,21 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
   // Fist initialize to 1:
   VVVdouble* _d2Likelihoods_father = &likelihoodData_->getD2LikelihoodArray(father->getId());
   size_t nbSites  = _d2Likelihoods_father->size();
-  for (size_t i = 0; i < nbSites; i++)
+  runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
   {
-    VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-      for (size_t s = 0; s < nbStates_; s++)
+      VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        (*_d2Likelihoods_father_i_c)[s] = 1.;
+        Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+        for (size_t s = 0; s < nbStates_; s++)
+        {
+          (*_d2Likelihoods_father_i_c)[s] = 1.;
+        }
       }
     }
-  }
+  });
 
   size_t nbNodes = father->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
@@ -1131,52 +1207,58 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
     if (son == branch)
     {
       VVVdouble* d2pxy__son = &d2pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* d2pxy__son_c = &(*d2pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double d2l = 0;
-            Vdouble* d2pxy__son_c_x = &(*d2pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* d2pxy__son_c = &(*d2pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              d2l += (*d2pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double d2l = 0;
+              Vdouble* d2pxy__son_c_x = &(*d2pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                d2l += (*d2pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* pxy__son = &pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double d2l = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double d2l = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
           }
         }
-      }
+      });
     }
   }
 
@@ -1197,18 +1279,21 @@ void RNonHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* n
   // Fist initialize to 1:
   VVVdouble* _d2Likelihoods_father = &likelihoodData_->getD2LikelihoodArray(father->getId());
   size_t nbSites  = _d2Likelihoods_father->size();
-  for (size_t i = 0; i < nbSites; i++)
+  runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
   {
-    VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-      for (size_t s = 0; s < nbStates_; s++)
+      VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        (*_d2Likelihoods_father_i_c)[s] = 1.;
+        Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+        for (size_t s = 0; s < nbStates_; s++)
+        {
+          (*_d2Likelihoods_father_i_c)[s] = 1.;
+        }
       }
     }
-  }
+  });
 
   size_t nbNodes = father->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
@@ -1221,52 +1306,58 @@ void RNonHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* n
     if (son == node)
     {
       VVVdouble* _d2Likelihoods_son = &likelihoodData_->getD2LikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _d2Likelihoods_son_i = &(*_d2Likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _d2Likelihoods_son_i_c = &(*_d2Likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _d2Likelihoods_son_i = &(*_d2Likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double d2l = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _d2Likelihoods_son_i_c = &(*_d2Likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              d2l += (*pxy__son_c_x)[y] * (*_d2Likelihoods_son_i_c)[y];
+              double d2l = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                d2l += (*pxy__son_c_x)[y] * (*_d2Likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = firstSite; i < lastSite; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= dl;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
   }
 
@@ -1292,21 +1383,24 @@ void RNonHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
 
   // Must reset the likelihood array first (i.e. set all of them to 1):
   VVVdouble* _likelihoods_node = &likelihoodData_->getLikelihoodArray(node->getId());
-  for (size_t i = 0; i < nbSites; i++)
+  runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
   {
-    //For each site in the sequence,
-    VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
+    for (size_t i = firstSite; i < lastSite; i++)
     {
-      //For each rate classe,
-      Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-      for (size_t x = 0; x < nbStates_; x++)
+      //For each site in the sequence,
+      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        //For each initial state,
-        (*_likelihoods_node_i_c)[x] = 1.;
+        //For each rate classe,
+        Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
+        for (size_t x = 0; x < nbStates_; x++)
+        {
+          //For each initial state,
+          (*_likelihoods_node_i_c)[x] = 1.;
+        }
       }
     }
-  }
+  });
 
   for (size_t l = 0; l < nbNodes; l++)
   {
@@ -1320,30 +1414,33 @@ void RNonHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
     vector<size_t> * _patternLinks_node_son = &likelihoodData_->getArrayPositions(node->getId(), son->getId());
     VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
-    for (size_t i = 0; i < nbSites; i++)
+    runParallelLoop_(nbSites, [&](size_t firstSite, size_t lastSite)
     {
-      //For each site in the sequence,
-      VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_node_son)[i]];
-      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
+      for (size_t i = firstSite; i < lastSite; i++)
       {
-        //For each rate classe,
-        Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-        Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-        VVdouble* pxy__son_c = &(*pxy__son)[c];
-        for (size_t x = 0; x < nbStates_; x++)
+        //For each site in the sequence,
+        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_node_son)[i]];
+        VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          //For each initial state,
-          Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates_; y++)
+          //For each rate classe,
+          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+          Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
+          VVdouble* pxy__son_c = &(*pxy__son)[c];
+          for (size_t x = 0; x < nbStates_; x++)
           {
-            likelihood += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+            //For each initial state,
+            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+            double likelihood = 0;
+            for (size_t y = 0; y < nbStates_; y++)
+            {
+              likelihood += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+            }
+            (*_likelihoods_node_i_c)[x] *= likelihood;
           }
-          (*_likelihoods_node_i_c)[x] *= likelihood;
         }
       }
-    }
+    });
   }
 }
 
@@ -208,6 +208,16 @@ namespace bpp
      */
     virtual const TreeLikelihoodData* getLikelihoodData() const = 0;
 
+    /**
+     * @brief Add the memory held by this object to a usage report.
+     *
+     * The usage is computed on demand, so that it does not cost anything
+     * unless queried.
+     *
+     * @param usage The report to update.
+     */
+    virtual void getMemoryUsage(MemoryUsage& usage) const = 0;
+
     /**
      * @brief Get the likelihood for a site.
      *
@@ -43,6 +43,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "../Tree/Node.h"
 #include "../Tree/TreeTemplate.h"
+#include "MemoryUsage.h"
 
 //From SeqLib:
 #include <Bpp/Seq/Alphabet/Alphabet.h>
@@ -136,6 +137,13 @@ class TreeLikelihoodData:
      */
     virtual const std::vector<unsigned int>& getWeights() const = 0;
 
+    /**
+     * @brief Add the memory held by the likelihood arrays to a usage report.
+     *
+     * @param usage The report to update.
+     */
+    virtual void getMemoryUsage(MemoryUsage& usage) const = 0;
+
 };
 
 } //end of namespace bpp.
@@ -38,10 +38,34 @@ knowledge of the CeCILL license and that you accept its terms.
 */
 
 #include "TreeLikelihoodTools.h"
+#include "../SiteLoopExecutor.h"
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
 
 using namespace std;
 using namespace bpp;
 
+// From the STL:
+#include <cmath>
+#include <functional>
+#include <memory>
+
+namespace
+{
+  /**
+   * @brief A point where the likelihood is evaluated: the current values, with
+   * parameter i shifted by si steps and parameter j (if any) by sj steps.
+   */
+  struct FiniteDifferencePoint
+  {
+    size_t i;
+    double si;
+    size_t j;
+    double sj;
+  };
+}
+
 void TreeLikelihoodTools::getAncestralFrequencies(
         const TreeLikelihood& tl,
         size_t site,
@@ -119,3 +143,149 @@ void TreeLikelihoodTools::getAncestralFrequencies_(
   }
 }
 
+/******************************************************************************/
+
+void TreeLikelihoodTools::computeObservedInformation(
+        const TreeLikelihood& tl,
+        const ParameterList& parameters,
+        RowMatrix<double>& information,
+        size_t nbThreads,
+        double relativeStep)
+{
+  size_t nbParameters = parameters.size();
+  information.resize(nbParameters, nbParameters);
+  ParameterList values;
+  vector<double> steps(nbParameters);
+  vector<bool> analytical(nbParameters, false);
+  for (size_t i = 0; i < nbParameters; i++)
+  {
+    const Parameter& p = tl.getParameter(parameters[i].getName());
+    values.addParameter(p);
+    double x = p.getValue();
+    steps[i] = relativeStep * max(abs(x), 1.);
+    const Constraint* constraint = p.getConstraint();
+    if (constraint && (!constraint->isCorrect(x - steps[i]) || !constraint->isCorrect(x + steps[i])))
+      throw Exception("TreeLikelihoodTools::computeObservedInformation(). Parameter " + p.getName() + " is too close to its boundary (" + TextTools::toString(x) + ").");
+    if (p.getName().substr(0, 5) == "BrLen" && tl.enableFirstOrderDerivatives() && tl.enableSecondOrderDerivatives())
+    {
+      try
+      {
+        information(i, i) = tl.getSecondOrderDerivative(p.getName());
+        analytical[i] = true;
+      }
+      catch (Exception&) {}
+    }
+  }
+
+  // Each parameter shifted alone, at 2j and 2j + 1, then the four corners
+  // of each pair of parameters without analytical derivatives:
+  vector<FiniteDifferencePoint> points;
+  for (size_t j = 0; j < nbParameters; j++)
+  {
+    points.push_back({j, 1., nbParameters, 0.});
+    points.push_back({j, -1., nbParameters, 0.});
+  }
+  for (size_t i = 0; i < nbParameters; i++)
+  {
+    for (size_t j = i + 1; j < nbParameters; j++)
+    {
+      if (analytical[i] || analytical[j])
+        continue;
+      points.push_back({i, 1., j, 1.});
+      points.push_back({i, 1., j, -1.});
+      points.push_back({i, -1., j, 1.});
+      points.push_back({i, -1., j, -1.});
+    }
+  }
+
+  size_t nbPoints = points.size();
+  vector<double> pointValues(nbPoints);
+  VVdouble pointDerivatives(nbPoints, Vdouble(nbParameters, 0.));
+  SiteLoopExecutor executor(max<size_t>(1, min(nbThreads, nbPoints)));
+  vector< unique_ptr<TreeLikelihood> > copies(executor.getNumberOfThreads());
+  for (size_t b = 0; b < copies.size(); b++)
+  {
+    copies[b].reset(tl.clone());
+  }
+
+  function<void(size_t, size_t)> loop = [&](size_t first, size_t last)
+  {
+    size_t block = 0;
+    while (executor.getBlockBegin(block + 1, nbPoints) <= first)
+      block++;
+    TreeLikelihood& copy = *copies[block];
+    for (size_t k = first; k < last; k++)
+    {
+      const FiniteDifferencePoint& point = points[k];
+      ParameterList shifted(values);
+      shifted[point.i].setValue(values[point.i].getValue() + point.si * steps[point.i]);
+      if (point.j < nbParameters)
+        shifted[point.j].setValue(values[point.j].getValue() + point.sj * steps[point.j]);
+      copy.setParametersValues(shifted);
+      pointValues[k] = copy.getValue();
+      if (point.j < nbParameters)
+        continue;
+      for (size_t i = 0; i < nbParameters; i++)
+      {
+        if (analytical[i])
+          pointDerivatives[k][i] = copy.getFirstOrderDerivative(values[i].getName());
+      }
+    }
+  };
+  executor.run(nbPoints, loop);
+
+  double f0 = tl.getValue();
+  for (size_t j = 0; j < nbParameters; j++)
+  {
+    if (!analytical[j])
+      information(j, j) = (pointValues[2 * j] - 2 * f0 + pointValues[2 * j + 1]) / (steps[j] * steps[j]);
+  }
+  size_t next = 2 * nbParameters;
+  for (size_t i = 0; i < nbParameters; i++)
+  {
+    for (size_t j = i + 1; j < nbParameters; j++)
+    {
+      double hij = 0;
+      if (analytical[i] || analytical[j])
+      {
+        // Central difference of the analytical first order derivative,
+        // averaged over both directions when both are available:
+        double n = 0;
+        if (analytical[i])
+        {
+          hij += (pointDerivatives[2 * j][i] - pointDerivatives[2 * j + 1][i]) / (2 * steps[j]);
+          n++;
+        }
+        if (analytical[j])
+        {
+          hij += (pointDerivatives[2 * i][j] - pointDerivatives[2 * i + 1][j]) / (2 * steps[i]);
+          n++;
+        }
+        hij /= n;
+      }
+      else
+      {
+        hij = (pointValues[next] - pointValues[next + 1] - pointValues[next + 2] + pointValues[next + 3]) / (4 * steps[i] * steps[j]);
+        next += 4;
+      }
+      information(i, j) = hij;
+      information(j, i) = hij;
+    }
+  }
+}
+
+/******************************************************************************/
+
+void TreeLikelihoodTools::computeCovarianceMatrix(
+        const TreeLikelihood& tl,
+        const ParameterList& parameters,
+        RowMatrix<double>& covariance,
+        size_t nbThreads,
+        double relativeStep)
+{
+  RowMatrix<double> information;
+  computeObservedInformation(tl, parameters, information, nbThreads, relativeStep);
+  MatrixTools::inv(information, covariance);
+}
+
+/******************************************************************************/
@@ -42,6 +42,8 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "TreeLikelihood.h"
 
+#include <Bpp/Numeric/Matrix/Matrix.h>
+
 //From the STL:
 #include <vector>
 #include <map>
@@ -97,6 +99,60 @@ class TreeLikelihoodTools
         std::map<int, std::vector<double> >& frequencies,
         bool alsoForLeaves = false);
 
+    /**
+     * @brief Compute the observed information matrix of a set of parameters,
+     * that is the Hessian matrix of minus the log-likelihood at the current
+     * parameter values.
+     *
+     * Branch lengths use the analytical derivatives of the likelihood object
+     * when they are enabled: their diagonal term is the second order
+     * derivative, and their cross terms are central differences of the first
+     * order derivative, evaluated at the 2k points where one parameter is
+     * shifted. Only the cross terms between two other parameters need the
+     * four point central differences of the likelihood value.
+     *
+     * The evaluations are independent, and are shared between nbThreads
+     * copies of the likelihood object. For a fixed number of parameters
+     * which are not branch lengths, the number of evaluations thus grows
+     * linearly with the number of parameters.
+     *
+     * @param tl           [in] A tree likelihood object, with parameters set to their estimated values.
+     * @param parameters   [in] The parameters to consider, for instance tl.getBranchLengthsParameters().
+     * Their values are ignored: the current values of tl are used.
+     * @param information  [out] The k x k matrix where to store the results, in the order of parameters.
+     * @param nbThreads    [opt] The number of threads, each working on its own copy of tl.
+     * @param relativeStep [opt] The finite difference step, relative to the parameter values (or absolute for values below 1).
+     * @throw Exception If a parameter is too close to a boundary for the step to fit within its constraint.
+     * PhylogeneticsApplicationTools::checkEstimatedParameters() reports such parameters, which should be left out.
+     */
+    static void computeObservedInformation(
+        const TreeLikelihood& tl,
+        const ParameterList& parameters,
+        RowMatrix<double>& information,
+        size_t nbThreads = 1,
+        double relativeStep = 0.0001);
+
+    /**
+     * @brief Compute the asymptotic covariance matrix of a set of estimated parameters,
+     * as the inverse of their observed information matrix.
+     *
+     * The square roots of the diagonal terms are the standard errors of the estimates.
+     *
+     * @param tl           [in] A tree likelihood object, with parameters set to their maximum likelihood estimates.
+     * @param parameters   [in] The parameters to consider.
+     * @param covariance   [out] The k x k matrix where to store the results, in the order of parameters.
+     * @param nbThreads    [opt] The number of threads.
+     * @param relativeStep [opt] The finite difference step.
+     * @throw Exception If the information matrix cannot be computed or is singular.
+     * @see computeObservedInformation()
+     */
+    static void computeCovarianceMatrix(
+        const TreeLikelihood& tl,
+        const ParameterList& parameters,
+        RowMatrix<double>& covariance,
+        size_t nbThreads = 1,
+        double relativeStep = 0.0001);
+
   private:
     /**
      * @brief Recursive method, for internal use only.
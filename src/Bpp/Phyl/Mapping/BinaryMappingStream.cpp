@@ -0,0 +1,169 @@
+//
+// File: BinaryMappingStream.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BinaryMappingStream.h"
+#include "../Io/BinaryTools.h"
+
+using namespace bpp;
+
+using namespace std;
+
+namespace
+{
+  const char MAPPING_MAGIC[4] = {'B', 'P', 'P', 'M'};
+  const uint32_t MAPPING_VERSION = 1;
+}
+
+/******************************************************************************/
+
+BinaryMappingWriter::BinaryMappingWriter(ostream& out, const vector<uint>& ids, const vector<string>& typeNames) :
+  out_(&out),
+  nbBranches_(ids.size()),
+  nbTypes_(typeNames.size()),
+  nbSites_(0)
+{
+  if (!out)
+    throw IOException("BinaryMappingWriter. Can't write to stream.");
+  BinaryTools::writeHeader(out, MAPPING_MAGIC, MAPPING_VERSION);
+  BinaryTools::writeValue(out, static_cast<uint64_t>(nbBranches_));
+  for (size_t k = 0; k < nbBranches_; k++)
+    BinaryTools::writeValue(out, static_cast<uint32_t>(ids[k]));
+  BinaryTools::writeValue(out, static_cast<uint64_t>(nbTypes_));
+  for (size_t t = 0; t < nbTypes_; t++)
+    BinaryTools::writeString(out, typeNames[t]);
+}
+
+/******************************************************************************/
+
+void BinaryMappingWriter::writeBlock(const VVVdouble& counts)
+{
+  size_t nbSites = counts.size();
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    if (counts[i].size() != nbBranches_)
+      throw BadSizeException("BinaryMappingWriter::writeBlock. Bad number of branches", counts[i].size(), nbBranches_);
+    for (size_t k = 0; k < nbBranches_; k++)
+      if (counts[i][k].size() != nbTypes_)
+        throw BadSizeException("BinaryMappingWriter::writeBlock. Bad number of types", counts[i][k].size(), nbTypes_);
+  }
+
+  BinaryTools::writeValue(*out_, static_cast<uint64_t>(nbSites));
+  Vdouble column(nbSites);
+  for (size_t k = 0; k < nbBranches_; k++)
+    for (size_t t = 0; t < nbTypes_; t++)
+    {
+      for (size_t i = 0; i < nbSites; i++)
+        column[i] = counts[i][k][t];
+      BinaryTools::writeArray(*out_, column);
+    }
+  nbSites_ += nbSites;
+}
+
+/******************************************************************************/
+
+void BinaryMappingWriter::writeBlock(const ProbabilisticSubstitutionMapping& counts, const vector<uint>& ids, size_t firstSite, size_t nbSites)
+{
+  if (ids.size() != nbBranches_)
+    throw BadSizeException("BinaryMappingWriter::writeBlock. Bad number of branches", ids.size(), nbBranches_);
+  if (counts.getNumberOfSubstitutionTypes() != nbTypes_)
+    throw BadSizeException("BinaryMappingWriter::writeBlock. Bad number of types", counts.getNumberOfSubstitutionTypes(), nbTypes_);
+
+  BinaryTools::writeValue(*out_, static_cast<uint64_t>(nbSites));
+  Vdouble column(nbSites);
+  for (size_t k = 0; k < nbBranches_; k++)
+  {
+    shared_ptr<PhyloBranchMapping> br = counts.getEdge(ids[k]);
+    for (size_t t = 0; t < nbTypes_; t++)
+    {
+      for (size_t i = 0; i < nbSites; i++)
+        column[i] = (*br)(counts.getSiteIndex(firstSite + i), t);
+      BinaryTools::writeArray(*out_, column);
+    }
+  }
+  nbSites_ += nbSites;
+}
+
+/******************************************************************************/
+
+BinaryMappingReader::BinaryMappingReader(istream& in) :
+  in_(&in),
+  ids_(),
+  typeNames_()
+{
+  if (!BinaryTools::readHeader(in, MAPPING_MAGIC, MAPPING_VERSION))
+    throw IOException("BinaryMappingReader. No counts found in stream.");
+  uint64_t nbBranches, nbTypes;
+  BinaryTools::readValue(in, nbBranches);
+  ids_.resize(static_cast<size_t>(nbBranches));
+  for (size_t k = 0; k < ids_.size(); k++)
+  {
+    uint32_t id;
+    BinaryTools::readValue(in, id);
+    ids_[k] = id;
+  }
+  BinaryTools::readValue(in, nbTypes);
+  typeNames_.resize(static_cast<size_t>(nbTypes));
+  for (size_t t = 0; t < typeNames_.size(); t++)
+    BinaryTools::readString(in, typeNames_[t]);
+}
+
+/******************************************************************************/
+
+bool BinaryMappingReader::readBlock(VVVdouble& counts)
+{
+  if (in_->peek() == istream::traits_type::eof())
+    return false;
+
+  uint64_t nbSites;
+  BinaryTools::readValue(*in_, nbSites);
+  size_t nbBranches = ids_.size();
+  size_t nbTypes = typeNames_.size();
+  VectorTools::resize3(counts, static_cast<size_t>(nbSites), nbBranches, nbTypes);
+
+  Vdouble column(static_cast<size_t>(nbSites));
+  for (size_t k = 0; k < nbBranches; k++)
+    for (size_t t = 0; t < nbTypes; t++)
+    {
+      BinaryTools::readArray(*in_, column);
+      for (size_t i = 0; i < column.size(); i++)
+        counts[i][k][t] = column[i];
+    }
+  return true;
+}
+
@@ -0,0 +1,182 @@
+//
+// File: BinaryMappingStream.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BINARYMAPPINGSTREAM_H_
+#define _BINARYMAPPINGSTREAM_H_
+
+#include "ProbabilisticSubstitutionMapping.h"
+
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Write per-site, per-branch and per-type counts to a binary
+ * stream, block of sites by block of sites.
+ *
+ * The stream starts with a header holding the branch ids and the type
+ * names. Each block then holds its number of sites, followed by the
+ * counts of each branch and type for all the sites of the block
+ * (columns are contiguous). Blocks can be written as soon as their
+ * counts are computed, so that the whole table never needs to be in
+ * memory.
+ *
+ * @see BinaryMappingReader
+ */
+class BinaryMappingWriter
+{
+  private:
+    std::ostream* out_;
+    size_t nbBranches_;
+    size_t nbTypes_;
+    size_t nbSites_;
+
+  public:
+    /**
+     * @brief Write the header of the stream.
+     *
+     * @param out       The output stream.
+     * @param ids       The ids of the branches, in the order of the blocks.
+     * @param typeNames The names of the types, in the order of the blocks.
+     */
+    BinaryMappingWriter(std::ostream& out, const std::vector<uint>& ids, const std::vector<std::string>& typeNames);
+
+    BinaryMappingWriter(const BinaryMappingWriter& writer) :
+      out_(writer.out_),
+      nbBranches_(writer.nbBranches_),
+      nbTypes_(writer.nbTypes_),
+      nbSites_(writer.nbSites_)
+    {}
+
+    BinaryMappingWriter& operator=(const BinaryMappingWriter& writer)
+    {
+      out_ = writer.out_;
+      nbBranches_ = writer.nbBranches_;
+      nbTypes_ = writer.nbTypes_;
+      nbSites_ = writer.nbSites_;
+      return *this;
+    }
+
+    virtual ~BinaryMappingWriter() {}
+
+  public:
+    /**
+     * @brief Write a block of sites.
+     *
+     * @param counts The counts, indexed by site, branch and type.
+     * @throw BadSizeException If the numbers of branches or types do not
+     * match the header.
+     */
+    void writeBlock(const VVVdouble& counts);
+
+    /**
+     * @brief Write a block of sites read in place from a mapping.
+     *
+     * @param counts    The mapping, with the branches given in the header.
+     * @param ids       The ids of the branches, as given in the header.
+     * @param firstSite The first (real) site position of the block.
+     * @param nbSites   The number of sites of the block.
+     */
+    void writeBlock(const ProbabilisticSubstitutionMapping& counts, const std::vector<uint>& ids, size_t firstSite, size_t nbSites);
+
+    /**
+     * @return The number of sites written so far.
+     */
+    size_t getNumberOfSitesWritten() const { return nbSites_; }
+};
+
+/**
+ * @brief Read counts written by BinaryMappingWriter, block by block.
+ */
+class BinaryMappingReader
+{
+  private:
+    std::istream* in_;
+    std::vector<uint> ids_;
+    std::vector<std::string> typeNames_;
+
+  public:
+    /**
+     * @brief Read the header of the stream.
+     *
+     * @throw IOException If the stream does not hold binary counts.
+     */
+    BinaryMappingReader(std::istream& in);
+
+    BinaryMappingReader(const BinaryMappingReader& reader) :
+      in_(reader.in_),
+      ids_(reader.ids_),
+      typeNames_(reader.typeNames_)
+    {}
+
+    BinaryMappingReader& operator=(const BinaryMappingReader& reader)
+    {
+      in_ = reader.in_;
+      ids_ = reader.ids_;
+      typeNames_ = reader.typeNames_;
+      return *this;
+    }
+
+    virtual ~BinaryMappingReader() {}
+
+  public:
+    const std::vector<uint>& getBranchIds() const { return ids_; }
+
+    const std::vector<std::string>& getTypeNames() const { return typeNames_; }
+
+    /**
+     * @brief Read the next block of sites.
+     *
+     * @param counts [out] The counts, indexed by site, branch and type.
+     * @return false if there are no more blocks.
+     * @throw IOException If the stream ends within a block.
+     */
+    bool readBlock(VVVdouble& counts);
+};
+
+} //end of namespace bpp.
+
+#endif //_BINARYMAPPINGSTREAM_H_
+
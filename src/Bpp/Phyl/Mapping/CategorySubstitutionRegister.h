@@ -165,6 +165,7 @@ namespace bpp
           revIndex_.push_back(pos);
         }
       }
+      resetTypeMatrix_();
     }
 
   public:
@@ -42,6 +42,7 @@
 #include <Bpp/Numeric/Matrix/MatrixTools.h>
 
 #include <vector>
+#include <map>
 #include <typeinfo>
 
 using namespace std;
@@ -87,6 +88,8 @@ DecompositionMethods::DecompositionMethods(const SubstitutionModel* model) :
 
 void DecompositionMethods::computeProducts_()
 {
+  clearExpectationsCache();
+
   //vInv_ %*% bMatrices_[i] %*% v_;
   if (model_->isDiagonalizable())
   {
@@ -152,35 +155,9 @@ void DecompositionMethods::jFunction_(const std::vector<double>& lambda, const s
 }
 
 
-void DecompositionMethods::computeExpectations(RowMatrix<double>& mapping, double length) const
-{
-  RowMatrix<double> tmp1(nbStates_, nbStates_), tmp2(nbStates_, nbStates_);
-  if (model_->isDiagonalizable())
-  {
-    jFunction_(model_->getEigenValues(), length, jMat_);
-    
-    MatrixTools::hadamardMult(jMat_, insideProducts_[0], tmp1);
-    MatrixTools::mult(model_->getColumnRightEigenVectors(), tmp1, tmp2);
-    MatrixTools::mult(tmp2, model_->getRowLeftEigenVectors(), mapping);
-  }
-  else if (model_->isNonSingular())
-  {
-    jFunction_(model_->getEigenValues(), model_->getIEigenValues(), length, jMat_, jIMat_);
-    
-    RowMatrix<double> itmp1(nbStates_, nbStates_), itmp2(nbStates_, nbStates_);
-    RowMatrix<double> imat(nbStates_, nbStates_);
-    
-    MatrixTools::hadamardMult(jMat_, jIMat_, insideProducts_[0], insideIProducts_[0], tmp1, itmp1);
-    MatrixTools::mult(rightEigenVectors_, rightIEigenVectors_, tmp1, itmp1, tmp2, itmp2);
-    MatrixTools::mult(tmp2, itmp2, leftEigenVectors_, leftIEigenVectors_, mapping, imat);
-  }
-  else
-    throw Exception("void DecompositionMethods::computeMappings : substitution mapping is not implemented for singular generators.");
-}
-
-
-void DecompositionMethods::computeExpectations(std::vector< RowMatrix<double> >& mappings, double length) const
+void DecompositionMethods::computeAllExpectations_(std::vector< RowMatrix<double> >& mappings, double length) const
 {
+  mappings.resize(nbTypes_);
   RowMatrix<double> tmp1(nbStates_, nbStates_), tmp2(nbStates_, nbStates_);
 
   if (model_->isDiagonalizable())
@@ -208,7 +185,43 @@ void DecompositionMethods::computeExpectations(std::vector< RowMatrix<double> >&
   }
   else
     throw Exception("void DecompositionMethods::computeMappings : substitution mapping is not implemented for singular generators.");
+}
 
+const std::vector< RowMatrix<double> >& DecompositionMethods::getExpectations_(double length) const
+{
+  map<double, vector< RowMatrix<double> > >::const_iterator it = expectationsCache_.find(length);
+  if (it != expectationsCache_.end())
+    return it->second;
+
+  if (cachedLengths_.size() >= CACHE_SIZE)
+  {
+    expectationsCache_.erase(cachedLengths_.front());
+    cachedLengths_.pop_front();
+  }
+
+  vector< RowMatrix<double> >& mappings = expectationsCache_[length];
+  computeAllExpectations_(mappings, length);
+  cachedLengths_.push_back(length);
+  return mappings;
+}
+
+void DecompositionMethods::computeExpectations(RowMatrix<double>& mapping, double length) const
+{
+  mapping = getExpectations_(length)[0];
+}
+
+
+void DecompositionMethods::computeExpectations(std::vector< RowMatrix<double> >& mappings, double length) const
+{
+  mappings = getExpectations_(length);
+}
+
+
+void DecompositionMethods::computeExpectations(const std::vector<double>& lengths, std::vector< std::vector< RowMatrix<double> > >& mappings) const
+{
+  mappings.resize(lengths.size());
+  for (size_t l = 0; l < lengths.size(); ++l)
+    mappings[l] = getExpectations_(lengths[l]);
 } 
 
 
@@ -222,6 +235,7 @@ void DecompositionMethods::initStates_()
 void DecompositionMethods::setSubstitutionModel(const SubstitutionModel* model)
 {
   model_ = model;
+  clearExpectationsCache();
   size_t n = model->getNumberOfStates();
   if (n != nbStates_)
   {
@@ -280,6 +294,7 @@ void DecompositionMethods::setSubstitutionModel(const SubstitutionModel* model)
 void DecompositionMethods::initBMatrices_()
 {
   //Re-initialize all B matrices according to substitution register.
+  clearExpectationsCache();
   bMatrices_.resize(nbTypes_);
   insideProducts_.resize(nbTypes_);
   
@@ -46,6 +46,10 @@
 #include "../Model/SubstitutionModel.h"
 #include "SubstitutionRegister.h"
 
+// From the STL:
+#include <deque>
+#include <map>
+
 namespace bpp
 {
 
@@ -81,6 +85,21 @@ namespace bpp
      */
     
     std::vector< RowMatrix<double> > bMatrices_, insideProducts_, insideIProducts_;
+
+    /*
+     * @brief Expectations already computed, keyed by length, and
+     * their lengths in insertion order so that the oldest is
+     * discarded first.
+     *
+     * Many branches and rate classes share the same length, so that
+     * a few entries save most of the computations. The cache is
+     * cleared whenever the products are computed again.
+     */
+
+    mutable std::map<double, std::vector< RowMatrix<double> > > expectationsCache_;
+    mutable std::deque<double> cachedLengths_;
+
+    static const size_t CACHE_SIZE = 32;
     
   public:
     DecompositionMethods(const SubstitutionModel* model, SubstitutionRegister* reg);
@@ -99,7 +118,9 @@ namespace bpp
       leftIEigenVectors_(dm.leftIEigenVectors_),
       bMatrices_(dm.bMatrices_),
       insideProducts_(dm.insideProducts_),
-      insideIProducts_(dm.insideIProducts_)
+      insideIProducts_(dm.insideIProducts_),
+      expectationsCache_(dm.expectationsCache_),
+      cachedLengths_(dm.cachedLengths_)
     {}				
     
     DecompositionMethods& operator=(const DecompositionMethods& dm)
@@ -117,6 +138,8 @@ namespace bpp
       bMatrices_      = dm.bMatrices_;
       insideProducts_ = dm.insideProducts_;
       insideIProducts_ =  dm.insideIProducts_;
+      expectationsCache_ = dm.expectationsCache_;
+      cachedLengths_  = dm.cachedLengths_;
       
       return *this;
     }				
@@ -134,6 +157,12 @@ namespace bpp
     
     void setSubstitutionModel(const SubstitutionModel* model);
 
+    /**
+     * @return The substitution model the decomposition was last set on.
+     */
+
+    const SubstitutionModel* getSubstitutionModel() const { return model_; }
+
 
   protected:
 
@@ -150,7 +179,46 @@ namespace bpp
 
     void computeExpectations(RowMatrix<double>& mapping, double length) const;
 
-    void computeExpectations(std::vector< RowMatrix<double> >& mappings, double leangth) const;
+    void computeExpectations(std::vector< RowMatrix<double> >& mappings, double length) const;
+
+    /**
+     * @brief Perform the computation of the conditional expectations
+     * for several lengths at once.
+     *
+     * @param lengths  The lengths (ie rate * branch length).
+     * @param mappings [out] The expectations of all types, for each
+     *                 length in the same order.
+     */
+
+    void computeExpectations(const std::vector<double>& lengths, std::vector< std::vector< RowMatrix<double> > >& mappings) const;
+
+    /**
+     * @brief Discard all cached expectations.
+     */
+
+    void clearExpectationsCache() const
+    {
+      expectationsCache_.clear();
+      cachedLengths_.clear();
+    }
+
+  private:
+
+    /**
+     * @brief Compute the expectations of all types for a given
+     * length, without looking in the cache.
+     */
+
+    void computeAllExpectations_(std::vector< RowMatrix<double> >& mappings, double length) const;
+
+    /**
+     * @brief Look for the expectations of a given length in the
+     * cache, and compute and store them if they are not there.
+     */
+
+    const std::vector< RowMatrix<double> >& getExpectations_(double length) const;
+
+  protected:
 
     /**
      * @brief Compute the integral part of the computation
@@ -81,9 +81,11 @@ void DecompositionSubstitutionCount::initCounts_()
 void DecompositionSubstitutionCount::fillBMatrices_()
 {
   vector<int> supportedStates = model_->getAlphabetStates();
+  const vector<size_t>& types = register_->getTypeMatrix();
+  size_t nbTypeStates = register_->getStateMap().getNumberOfModelStates();
   for (size_t j = 0; j < nbStates_; ++j) {
     for (size_t k = 0; k < nbStates_; ++k) {
-      size_t i = register_->getType(j, k);
+      size_t i = types[j * nbTypeStates + k];
       if (i > 0 && k != j) {
         bMatrices_[i - 1](j, k) = model_->Qij(j, k);
       }
@@ -97,9 +99,11 @@ void DecompositionSubstitutionCount::fillBMatrices_()
 void DecompositionSubstitutionCount::setDistanceBMatrices_()
 {
   vector<int> supportedStates = model_->getAlphabetStates();
+  const vector<size_t>& types = register_->getTypeMatrix();
+  size_t nbTypeStates = register_->getStateMap().getNumberOfModelStates();
   for (size_t j = 0; j < nbStates_; ++j) {
     for (size_t k = 0; k < nbStates_; ++k) {
-      size_t i = register_->getType(j, k);
+      size_t i = types[j * nbTypeStates + k];
       if (i > 0 && k != j) {
         bMatrices_[i - 1](j, k) *= distances_->getIndex(supportedStates[j], supportedStates[k]);
       }
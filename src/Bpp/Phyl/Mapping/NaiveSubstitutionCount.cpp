@@ -45,11 +45,13 @@ Matrix<double>* NaiveSubstitutionCount::getAllNumbersOfSubstitutions(double leng
 { 
   size_t n = supportedChars_.size();
   RowMatrix<double>* mat = new RowMatrix<double>(n, n);
+  const std::vector<size_t>& types = register_->getTypeMatrix();
+  size_t nbTypeStates = register_->getStateMap().getNumberOfModelStates();
   for (size_t i = 0; i < n; ++i)
   {
     for (size_t j = 0; j < n; ++j)
     {
-      (*mat)(i, j) = (register_->getType(i, j) == type ? (weights_ ? weights_->getIndex(supportedChars_[i], supportedChars_[j]) : 1.) : 0.);
+      (*mat)(i, j) = (types[i * nbTypeStates + j] == type ? (weights_ ? weights_->getIndex(supportedChars_[i], supportedChars_[j]) : 1.) : 0.);
     }
   }
   return mat;
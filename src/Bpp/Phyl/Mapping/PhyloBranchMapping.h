@@ -46,9 +46,52 @@
 
 #include "../Tree/PhyloBranch.h"
 
+// From the STL:
+#include <algorithm>
+
 
 namespace bpp
 {
+  /*
+   * @brief A read-only view on the counts of all types at a site,
+   * which does not copy them.
+   *
+   * The view is valid as long as the number of sites or types of the
+   * branch it comes from is not changed.
+   */
+
+  class SiteCounts
+  {
+  private:
+    const double* data_;
+    size_t size_;
+
+  public:
+    SiteCounts(const double* data, size_t size) :
+      data_(data),
+      size_(size)
+    {
+    }
+
+    size_t size() const { return size_; }
+
+    const double& operator[](size_t type) const { return data_[type]; }
+
+    const double* begin() const { return data_; }
+
+    const double* end() const { return data_ + size_; }
+
+    double sum() const
+    {
+      double s = 0;
+      for (size_t t = 0; t < size_; t++)
+        s += data_[t];
+      return s;
+    }
+
+    operator Vdouble() const { return Vdouble(begin(), end()); }
+  };
+
   /*
    * @brief A branch with countings.
    *
@@ -63,11 +106,14 @@ namespace bpp
   {
   protected:
     /*
-     * @brief counts are stored by site / type
+     * @brief counts are stored by site / type, in a single contiguous
+     * vector: the count of type t at site i is counts_[i * nbTypes_ + t].
      *
      */
     
-    VVdouble counts_;
+    Vdouble counts_;
+
+    size_t nbSites_, nbTypes_;
     
   public:
     /**
@@ -79,19 +125,25 @@ namespace bpp
     
     PhyloBranchMapping():
       PhyloBranch(),
-      counts_()
+      counts_(),
+      nbSites_(0),
+      nbTypes_(0)
     {
     }
 
     PhyloBranchMapping(double length):
       PhyloBranch(length),
-      counts_()
+      counts_(),
+      nbSites_(0),
+      nbTypes_(0)
     {
     }
 
     PhyloBranchMapping(const PhyloBranch& branch):
       PhyloBranch(branch),
-      counts_()
+      counts_(),
+      nbSites_(0),
+      nbTypes_(0)
     {
     }
     
@@ -103,7 +155,9 @@ namespace bpp
     
     PhyloBranchMapping(const PhyloBranchMapping& branch):
       PhyloBranch(branch),
-      counts_(branch.counts_)
+      counts_(branch.counts_),
+      nbSites_(branch.nbSites_),
+      nbTypes_(branch.nbTypes_)
     {
     }
     
@@ -118,6 +172,8 @@ namespace bpp
     {
       PhyloBranch::operator=(branch);
       counts_ = branch.counts_;
+      nbSites_ = branch.nbSites_;
+      nbTypes_ = branch.nbTypes_;
       return *this;
       
     }
@@ -133,6 +189,31 @@ namespace bpp
     {
     }
 
+  private:
+    /**
+     * @brief Resize the counts, keeping the existing values and
+     * setting the new ones to 0.
+     */
+    
+    void resize_(size_t nbSites, size_t nbTypes)
+    {
+      if (nbTypes == nbTypes_)
+        counts_.resize(nbSites * nbTypes);
+      else
+      {
+        Vdouble counts(nbSites * nbTypes, 0.);
+        size_t nbS = std::min(nbSites, nbSites_);
+        size_t nbT = std::min(nbTypes, nbTypes_);
+        for (size_t i = 0; i < nbS; i++)
+          for (size_t t = 0; t < nbT; t++)
+            counts[i * nbTypes + t] = counts_[i * nbTypes_ + t];
+        counts_.swap(counts);
+      }
+      nbSites_ = nbSites;
+      nbTypes_ = nbTypes;
+    }
+
+  public:
     /**
      * @brief Sets a number of sites. If the number of types is
      * already defined, it is kept. 
@@ -140,7 +221,7 @@ namespace bpp
     
     void setNumberOfSites(size_t nbSites)
     {
-      VectorTools::resize2(counts_, nbSites, (counts_.size()!=0?counts_[0].size():0));
+      resize_(nbSites, nbTypes_);
     }
 
     /**
@@ -149,7 +230,7 @@ namespace bpp
     
     void setNumberOfTypes(size_t nbTypes)
     {
-      VectorTools::resize2(counts_, counts_.size(), nbTypes);
+      resize_(nbSites_, nbTypes);
     }
 
     /**
@@ -158,7 +239,7 @@ namespace bpp
     
     void setNumberOfSitesAndTypes(size_t nbSites, size_t nbTypes)
     {
-      VectorTools::resize2(counts_, nbSites, nbTypes);
+      resize_(nbSites, nbTypes);
     }
 
 
@@ -168,7 +249,7 @@ namespace bpp
     
     size_t getNumberOfSites() const
     {
-      return counts_.size();
+      return nbSites_;
     }
 
     /**
@@ -177,22 +258,17 @@ namespace bpp
     
     size_t getNumberOfTypes() const
     {
-      return counts_.size()?counts_[0].size():0;
+      return nbSites_?nbTypes_:0;
     }
     
     /**
-     * @brief Gets the counts at a given site
+     * @brief Gets the counts at a given site, without copy.
      *
      */
     
-    Vdouble& getSiteCount(size_t site)
-    {
-      return counts_[site];
-    }
-
-    const Vdouble& getSiteCount(size_t site) const
+    SiteCounts getSiteCount(size_t site) const
     {
-      return counts_[site];
+      return SiteCounts(counts_.data() + site * nbTypes_, nbTypes_);
     }
 
     /**
@@ -211,7 +287,7 @@ namespace bpp
         throw BadSizeException("PhyloBranchMapping::getSiteTypeCount : bad site number",site,getNumberOfSites());
       if (type>=getNumberOfTypes())
         throw BadSizeException("PhyloBranchMapping::getSiteTypeCount : bad site number",type,getNumberOfTypes());
-      return counts_[site][type];
+      return counts_[site * nbTypes_ + type];
     }
 
     /**
@@ -225,7 +301,7 @@ namespace bpp
         throw BadSizeException("PhyloBranchMapping::setSiteTypeCount : bad site number",site,getNumberOfSites());
       if (type>=getNumberOfTypes())
         throw BadSizeException("PhyloBranchMapping::setSiteTypeCount : bad type number",type,getNumberOfTypes());
-      counts_[site][type]=value;
+      counts_[site * nbTypes_ + type]=value;
     }
 
     
@@ -234,27 +310,28 @@ namespace bpp
      *
      */
     
-    double operator()(size_t site, size_t type) const
+    const double& operator()(size_t site, size_t type) const
     {
-      return counts_[site][type];
+      return counts_[site * nbTypes_ + type];
     }
 
     double& operator()(size_t site, size_t type)
     {
-      return counts_[site][type];
+      return counts_[site * nbTypes_ + type];
     }
 
     /**
-     * @brief return counts
+     * @brief return counts, by site / type in a single vector (see
+     * counts_).
      *
      */
     
-    VVdouble getCounts() const
+    const Vdouble& getCounts() const
     {
       return counts_;
     }
 
-    VVdouble& getCounts()
+    Vdouble& getCounts()
     {
       return counts_;
     }
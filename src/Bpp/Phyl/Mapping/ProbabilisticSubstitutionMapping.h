@@ -41,6 +41,7 @@
 #define _PROBABILISTICSUBSTITUTIONMAPPING_H_
 
 #include "SubstitutionMapping.h"
+#include "../Likelihood/MemoryUsage.h"
 
 #include <Bpp/Text/TextTools.h>
 
@@ -205,7 +206,18 @@ namespace bpp
       return getEdge(branchId)->getSiteTypeCount(getSiteIndex(site), type);
     }
 
-    const std::vector<double>& getCounts(unsigned int branchId, size_t site) const
+    Vdouble getCounts(unsigned int branchId, size_t site) const
+    {
+      return getSiteCounts(branchId, site);
+    }
+
+    /**
+     * @brief A view on the counts of all types on a branch, with REAL
+     * site position, without copy.
+     *
+     */
+
+    SiteCounts getSiteCounts(unsigned int branchId, size_t site) const
     {
       return getEdge(branchId)->getSiteCount(getSiteIndex(site));
     }
@@ -264,6 +276,17 @@ namespace bpp
     {
       return (usePatterns_?rootPatternLinks_[site]:site);
     }
+
+    /**
+     * @brief Add the memory held by the counts to a usage report.
+     */
+    void getMemoryUsage(MemoryUsage& usage) const
+    {
+      std::vector<std::shared_ptr<PhyloBranchMapping> > vEdges = getAllEdges();
+      for (size_t i = 0; i < vEdges.size(); i++)
+        usage.add(MemoryUsage::MAPPING_COUNTS, MemoryUsage::getHeapBytes(vEdges[i]->getCounts()));
+      usage.add(MemoryUsage::OTHER, MemoryUsage::getHeapBytes(rootPatternLinks_));
+    }
   };
 
 } //end of namespace bpp.
@@ -38,7 +38,9 @@
  */
 
 #include "RewardMappingTools.h"
+#include "SubstitutionMappingTools.h"
 #include "../Likelihood/DRTreeLikelihoodTools.h"
+#include "../SiteLoopExecutor.h"
 
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/App/ApplicationTools.h>
@@ -48,7 +50,11 @@
 using namespace bpp;
 
 // From the STL:
+#include <functional>
 #include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
 
 using namespace std;
 
@@ -59,8 +65,24 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
   RecursiveLikelihoodTreeCalculation& rltc,
   const vector<uint>& nodeIds,
   Reward& reward,
-  bool verbose)
+  bool verbose,
+  size_t nbThreads)
 {
+  vector<Reward*> rewards(1, &reward);
+  return computeRewardVectors(rltc, nodeIds, rewards, verbose, nbThreads)[0];
+}
+
+/**************************************************************************************************/
+
+vector<ProbabilisticRewardMapping*> RewardMappingTools::computeRewardVectors(
+  RecursiveLikelihoodTreeCalculation& rltc,
+  const vector<uint>& nodeIds,
+  const vector<Reward*>& rewards,
+  bool verbose,
+  size_t nbThreads)
+{
+  size_t nbRewards = rewards.size();
+
   // Preamble:
   if (!rltc.isInitialized())
     throw Exception("RewardMappingTools::computeSubstitutionVectors(). Likelihood object is not initialized.");
@@ -80,8 +102,10 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
   
   const vector<size_t>& rootPatternLinks = rlt.getRootArrayPositions();
 
-  // We create a new ProbabilisticRewardMapping object:
-  unique_ptr<ProbabilisticRewardMapping> rewards(new ProbabilisticRewardMapping(ppt, rootPatternLinks, nbDistinctSites));
+  // We create one ProbabilisticRewardMapping object per reward:
+  vector<unique_ptr<ProbabilisticRewardMapping> > mappings(nbRewards);
+  for (size_t k = 0; k < nbRewards; k++)
+    mappings[k].reset(new ProbabilisticRewardMapping(ppt, rootPatternLinks, nbDistinctSites));
   
   // Store likelihood for each site (here rootPatterns are managed):
   Vdouble Lr(nbDistinctSites, 0);
@@ -89,193 +113,251 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
   for (size_t i = 0; i < nbDistinctSites; i++)
     Lr[i]=rltc.getLogLikelihoodForASiteIndex(i);
 
-  // Compute the reward for each class and each branch in the tree:
-  if (verbose)
-    ApplicationTools::displayTask("Compute rewards", true);
+  // The branches to map, and the above likelihoods of their fathers,
+  // computed once before the branches are dealt with (concurrently if
+  // several threads are used):
+  vector<uint> branches;
 
-  unique_ptr<ProbabilisticRewardMapping::mapTree::EdgeIterator> brIt=rewards->allEdgesIterator();
+  unique_ptr<ProbabilisticRewardMapping::mapTree::EdgeIterator> brIt=mappings[0]->allEdgesIterator();
 
-  size_t nn=0;
-  
   for (;!brIt->end();brIt->next())
   {
-    if (verbose)
-      ApplicationTools::displayGauge(nn++, nbNodes - 1);
-    
-    shared_ptr<PhyloBranchReward> br=**brIt;
-    
-    // For each branch
-    uint edid=rewards->getEdgeIndex(br);
-
+    uint edid=mappings[0]->getEdgeIndex(**brIt);
     if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, (int)edid))
       continue;
+    branches.push_back(edid);
+  }
 
-    uint fathid=rewards->getFather(edid);
-    uint icid=rewards->getSon(edid);
+  vector<uint> fatherIds;
+  for (auto edid : branches)
+  {
+    uint fathid=mappings[0]->getFather(edid);
+    if (!VectorTools::contains(fatherIds, fathid))
+    {
+      rltc.computeLikelihoodsAtNode(fathid);
+      fatherIds.push_back(fathid);
+    }
+  }
 
-    double d=br->getLength();
+  // Transition probabilities may be cached by models, they are hence
+  // read by one thread at a time:
+  mutex processMutex;
+  mutex displayMutex;
+  size_t nn=0;
+
+  // Compute the reward for each class and each branch in the tree:
+  if (verbose)
+    ApplicationTools::displayTask("Compute rewards", true);
+
+  std::function<void(size_t, size_t)> loop = [&](size_t first, size_t last)
+  {
+    // Each thread has its own rewards and scratch buffers, the
+    // likelihood products being shared by all rewards:
+    vector<unique_ptr<Reward> > localRewards(nbRewards);
+    vector<Reward*> vrewards(rewards);
+    if (nbThreads > 1)
+    {
+      for (size_t k = 0; k < nbRewards; k++)
+      {
+        localRewards[k].reset(rewards[k]->clone());
+        vrewards[k] = localRewards[k].get();
+      }
+    }
 
-    Vdouble rewardsForCurrentNode(nbDistinctSites);
+    // Rewards are set up again only when the model changes:
+    vector<const SubstitutionModel*> currentModels(nbRewards, 0);
+
+    // Models write their transition probabilities when the rewards
+    // compute them, so that with several threads the rewards use copies
+    // of the models of their own:
+    map<const SubstitutionModel*, unique_ptr<SubstitutionModel> > localModels;
 
     VVdouble likelihoodsFatherConstantPart;    
     VectorTools::resize2(likelihoodsFatherConstantPart, nbDistinctSites, nbStates);
 
-    bool usesLog=false;
+    VVdouble rewardsForCurrentNode(nbRewards, Vdouble(nbDistinctSites));
 
-    for (size_t ncl=0; ncl<nbClasses; ncl++)
-    {
-      const RecursiveLikelihoodTree::LikTree& rlt_c=rlt[ncl];
-      
-      shared_ptr<RecursiveLikelihoodNode> ici = rlt_c.getNode(icid);
+    // The father and son likelihoods stored by state, so that the
+    // rewards are accumulated over contiguous sites:
+    VVdouble likelihoodsFatherByState(nbStates, Vdouble(nbDistinctSites));
+    VVdouble likelihoodsNodeByState(nbStates, Vdouble(nbDistinctSites));
 
-      // reinit substitutionsForCurrentNode for log 
-      if (!usesLog && ici->usesLog())
+    RowMatrix<double> pxy;
+
+    for (size_t b = first; b < last; b++)
+    {
+      if (verbose)
       {
-        std::fill(rewardsForCurrentNode.begin(), rewardsForCurrentNode.end(), NumConstants::MINF());
+        lock_guard<mutex> lock(displayMutex);
+        ApplicationTools::displayGauge(nn++, nbNodes - 1);
       }
 
-      usesLog=ici->usesLog();
-      
-      double pr=sp.getProbabilityForModel(ncl);
-      double rate=sp.getRateForModel(ncl);
-      
-      for (size_t i=0; i<nbDistinctSites; i++)
-        VectorTools::fill(likelihoodsFatherConstantPart[i],usesLog?log(pr):pr);
+      // For each branch
+      uint edid=branches[b];
 
-      rltc.computeLikelihoodsAtNode(fathid);
+      uint fathid=mappings[0]->getFather(edid);
+      uint icid=mappings[0]->getSon(edid);
 
-      // up father
-      shared_ptr<RecursiveLikelihoodNode> father = rlt_c.getNode(fathid);
+      double d=mappings[0]->getEdge(edid)->getLength();
 
-      // down the brothers
+      for (auto& rk : rewardsForCurrentNode)
+        std::fill(rk.begin(), rk.end(), 0.);
 
-      unique_ptr<RecursiveLikelihoodTree::LikTree::EdgeIterator> brothIt=rlt_c.branchesIterator(father);
+      bool usesLog=false;
 
-      for (;!brothIt->end();brothIt->next())
+      for (size_t ncl=0; ncl<nbClasses; ncl++)
       {
-        if (rlt_c.getEdgeIndex(**brothIt)!=edid)
+        const RecursiveLikelihoodTree::LikTree& rlt_c=rlt[ncl];
+      
+        shared_ptr<RecursiveLikelihoodNode> ici = rlt_c.getNode(icid);
+
+        // reinit rewardsForCurrentNode for log 
+        if (!usesLog && ici->usesLog())
         {
-          bool slog=rlt_c.getSon(**brothIt)->usesLog();
+          for (auto& rk : rewardsForCurrentNode)
+            std::fill(rk.begin(), rk.end(), NumConstants::MINF());
+        }
+
+        usesLog=ici->usesLog();
+      
+        double pr=sp.getProbabilityForModel(ncl);
+        double rate=sp.getRateForModel(ncl);
+
+        SubstitutionMappingTools::computeLikelihoodsFatherConstantPart(rlt_c, edid, fathid, pr, usesLog, likelihoodsFatherConstantPart);
+      
+        // Then, we deal with the node of interest.
+        // ('y' is the state at 'node' and 'x' the state at 'father'.)
+
+        const VVdouble& likelihoodsFather_node = ici->getBelowLikelihoodArray(ComputingNode::D0);
 
-          if (!usesLog)
+        for (size_t i=0; i< nbDistinctSites; i++)
+          for (size_t x = 0; x < nbStates; ++x)
           {
-            if (!slog)
-              likelihoodsFatherConstantPart *= rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0);
-            else
-              likelihoodsFatherConstantPart *= VectorTools::exp(rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0));
+            likelihoodsFatherByState[x][i] = likelihoodsFatherConstantPart[i][x];
+            likelihoodsNodeByState[x][i] = likelihoodsFather_node[i][x];
           }
-          else {
-            if (slog)
-              likelihoodsFatherConstantPart += rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0);
-            else
-              likelihoodsFatherConstantPart += VectorTools::log(rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0));
+
+        const SubstitutionModel* sm=dynamic_cast<const SubstitutionModel*>(sp.getModel(icid,ncl));
+        if (!sm)
+          throw Exception("RewardMappingTools:: non substitution model in node " + TextTools::toString(icid));
+
+        const SubstitutionModel* rewardModel=sm;
+        {
+          lock_guard<mutex> lock(processMutex);
+          pxy = sp.getTransitionProbabilities(icid,ncl);
+
+          if (nbThreads > 1)
+          {
+            unique_ptr<SubstitutionModel>& localModel=localModels[sm];
+            if (!localModel)
+              localModel.reset(sm->clone());
+            rewardModel=localModel.get();
           }
         }
-      }
-      
-      bool flog=father->usesLog();
-
-      if (!usesLog)
-      {
-        if (!flog)
-          likelihoodsFatherConstantPart *= father->getAboveLikelihoodArray();
-        else
-          likelihoodsFatherConstantPart *= VectorTools::exp(father->getAboveLikelihoodArray());
-      }
-      else {
-        if (flog)
-          likelihoodsFatherConstantPart += father->getAboveLikelihoodArray();
-        else
-          likelihoodsFatherConstantPart += VectorTools::log(father->getAboveLikelihoodArray());
-      }
-      
-      // Then, we deal with the node of interest.
-      // We first average upon 'y' to save computations, and then upon 'x'.
-      // ('y' is the state at 'node' and 'x' the state at 'father'.)
 
-      const VVdouble& likelihoodsFather_node = ici->getBelowLikelihoodArray(ComputingNode::D0);
+        for (size_t k = 0; k < nbRewards; k++)
+        {
+          Reward& reward = *vrewards[k];
+          Vdouble& rewardsForCurrentNode_k = rewardsForCurrentNode[k];
 
-      const SubstitutionModel* sm=dynamic_cast<const SubstitutionModel*>(sp.getModel(icid,ncl));
-      if (!sm)
-        throw Exception("RewardMappingTools:: non substitution model in node " + TextTools::toString(icid));
-      
-      reward.setSubstitutionModel(sm);
+          if (rewardModel != currentModels[k])
+          {
+            reward.setSubstitutionModel(rewardModel);
+            currentModels[k] = rewardModel;
+          }
       
-      // compute all nxy * pxy first:
+          // compute all nxy * pxy first:
       
-      const Matrix<double>& pxy = sp.getTransitionProbabilities(icid,ncl);
-      Matrix<double>* nij = reward.getAllRewards(d * rate);
-      MatrixTools::hadamardMult((*nij),pxy,(*nij));
+          Matrix<double>* nij = reward.getAllRewards(d * rate);
+          MatrixTools::hadamardMult((*nij),pxy,(*nij));
 
-      
-      for (size_t i=0; i< nbDistinctSites; i++)
-      {
-        const Vdouble* likelihoodsFather_node_i = &(likelihoodsFather_node[i]);
-        const Vdouble* likelihoodsFatherConstantPart_i = &(likelihoodsFatherConstantPart[i]);
-        
-        for (size_t x = 0; x < nbStates; ++x)
-        {
-          double likelihoodsFatherConstantPart_i_x = (*likelihoodsFatherConstantPart_i)[x];
-          for (size_t y = 0; y < nbStates; ++y)
+          for (size_t x = 0; x < nbStates; ++x)
           {
-            double likelihood_xy = usesLog
-              ?likelihoodsFatherConstantPart_i_x + (*likelihoodsFather_node_i)[y]
-              :likelihoodsFatherConstantPart_i_x * (*likelihoodsFather_node_i)[y];
-
-            if (!usesLog)
+            for (size_t y = 0; y < nbStates; ++y)
             {
-              if (likelihood_xy!=0) // to avoid multiplication per nan
-                                    // (stop codons)
-                rewardsForCurrentNode[i] += likelihood_xy * (*nij)(x,y);
-            //                       <------------>   <--------------->
-            // Posterior probability         |                 |
-            // for site i and rate class c * |                 |
-            // likelihood for this site------+                 |
-            //                                                 |
-            // Reward function for site i and rate class c------+
-            }
-            else
-            {
-              if (likelihood_xy!=NumConstants::MINF())  // to avoid add per -inf
+              double nxy = (*nij)(x,y);
+              const Vdouble& likelihoodsFather_x = likelihoodsFatherByState[x];
+              const Vdouble& likelihoodsNode_y = likelihoodsNodeByState[y];
+
+              if (!usesLog)
               {
-                if ((*nij)(x,y)< -NumConstants::MILLI())
+                if (nxy == 0)
+                  continue;
+                for (size_t i=0; i< nbDistinctSites; i++)
                 {
-                  ApplicationTools::displayWarning("These rewards are negative, their logs could not be computed:" + TextTools::toString((*nij)(x,y)));
+                  double likelihood_xy = likelihoodsFather_x[i] * likelihoodsNode_y[i];
+                  if (likelihood_xy!=0) // to avoid multiplication per nan
+                                        // (stop codons)
+                    rewardsForCurrentNode_k[i] += likelihood_xy * nxy;
+                  //                         <------------>   <--->
+                  // Posterior probability         |            |
+                  // for site i and rate class c * |            |
+                  // likelihood for this site------+            |
+                  //                                            |
+                  // Reward function for rate class c ----------+
+                }
+              }
+              else
+              {
+                if (nxy < -NumConstants::MILLI())
+                {
+                  lock_guard<mutex> lock(displayMutex);
+                  ApplicationTools::displayWarning("These rewards are negative, their logs could not be computed:" + TextTools::toString(nxy));
                   throw Exception("Stop in RewardMappingTools");
                 }
-                else
+                if (nxy <= 0)
+                  continue;
+                double lnxy = log(nxy);
+                for (size_t i=0; i< nbDistinctSites; i++)
                 {
-                  if ((*nij)(x,y)>0)
+                  double likelihood_xy = likelihoodsFather_x[i] + likelihoodsNode_y[i];
+                  if (likelihood_xy!=NumConstants::MINF())  // to avoid add per -inf
                   {
-                    double ll=likelihood_xy + log((*nij)(x,y));
-                    if (ll>rewardsForCurrentNode[i])
-                      rewardsForCurrentNode[i] = ll + log(1 + exp(rewardsForCurrentNode[i] - ll));
+                    double ll=likelihood_xy + lnxy;
+                    if (ll>rewardsForCurrentNode_k[i])
+                      rewardsForCurrentNode_k[i] = ll + log(1 + exp(rewardsForCurrentNode_k[i] - ll));
                     else
-                      rewardsForCurrentNode[i] += log(1 + exp(ll - rewardsForCurrentNode[i]));
+                      rewardsForCurrentNode_k[i] += log(1 + exp(ll - rewardsForCurrentNode_k[i]));
                   }
                 }
               }
             }
           }
+
+          delete nij;
         }
       }
-
-      delete nij;
-    }
     
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbDistinctSites; ++i)
-      (*br)(i) = usesLog?exp(rewardsForCurrentNode[i] - Lr[i]):
-        rewardsForCurrentNode[i] / exp(Lr[i]);
+      // Now we just have to copy the substitutions into the result vectors:
+      for (size_t k = 0; k < nbRewards; k++)
+      {
+        shared_ptr<PhyloBranchReward> br=mappings[k]->getEdge(edid);
+        for (size_t i = 0; i < nbDistinctSites; ++i)
+          (*br)(i) = usesLog?exp(rewardsForCurrentNode[k][i] - Lr[i]):
+            rewardsForCurrentNode[k][i] / exp(Lr[i]);
+      }
+    }
+  };
 
+  if (nbThreads > 1)
+  {
+    SiteLoopExecutor executor(nbThreads);
+    executor.run(branches.size(), loop);
   }
+  else
+    loop(0, branches.size());
+
   if (verbose)
   {
     if (ApplicationTools::message)
       *ApplicationTools::message << " ";
     ApplicationTools::displayTaskDone();
   }
-  return rewards.release();
+
+  vector<ProbabilisticRewardMapping*> result(nbRewards);
+  for (size_t k = 0; k < nbRewards; k++)
+    result[k] = mappings[k].release();
+  return result;
 }
 
 /**************************************************************************************************/
@@ -75,6 +75,9 @@ namespace bpp
      *                          are computed on.
      * @param reward            The Reward to use.
      * @param verbose           Print info to screen.
+     * @param nbThreads         The number of threads mapping distinct branches
+     *                          concurrently (default: 1). Each thread uses
+     *                          a clone of reward.
      * @return A vector of reward vectors (one for each site).
      * @throw Exception If the likelihood object is not initialized.
      */
@@ -82,7 +85,33 @@ namespace bpp
       RecursiveLikelihoodTreeCalculation& rltc,
       const std::vector<uint>& nodeIds,
       Reward& reward,
-      bool verbose = true);
+      bool verbose = true,
+      size_t nbThreads = 1);
+
+    /**
+     * @brief Compute the reward vectors of several rewards in a single
+     * traversal of the tree.
+     *
+     * The likelihood products at each branch are computed once and
+     * shared by all rewards.
+     *
+     * @param rltc              A RecursiveLikelihoodTreeCalculation object.
+     * @param nodeIds           The Ids of the nodes the reward vectors
+     *                          are computed on.
+     * @param rewards           The Rewards to use.
+     * @param verbose           Print info to screen.
+     * @param nbThreads         The number of threads mapping distinct branches
+     *                          concurrently (default: 1).
+     * @return One mapping per reward, in the same order, to be deleted
+     * by the caller.
+     * @throw Exception If the likelihood object is not initialized.
+     */
+    static std::vector<ProbabilisticRewardMapping*> computeRewardVectors(
+      RecursiveLikelihoodTreeCalculation& rltc,
+      const std::vector<uint>& nodeIds,
+      const std::vector<Reward*>& rewards,
+      bool verbose = true,
+      size_t nbThreads = 1);
 
 
     /**
@@ -43,6 +43,8 @@
 #include "ProbabilisticRewardMapping.h"
 #include "ProbabilisticSubstitutionMapping.h"
 #include "RewardMappingTools.h"
+#include "BinaryMappingStream.h"
+#include "../SiteLoopExecutor.h"
 
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/App/ApplicationTools.h>
@@ -54,7 +56,13 @@ using namespace bpp;
 using namespace std;
 
 // From the STL:
+#include <functional>
 #include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
 
 /******************************************************************************/
 
@@ -65,7 +73,8 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeCounts(
   std::shared_ptr<const AlphabetIndex2> weights,
   std::shared_ptr<const AlphabetIndex2> distances,
   double threshold,
-  bool verbose)
+  bool verbose,
+  size_t nbThreads)
 {
   // Preamble:
   if (!rltc.isInitialized())
@@ -99,7 +108,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeCounts(
 
   unique_ptr<SubstitutionCount> substitutionCount(new DecompositionSubstitutionCount(sm, reg.clone(), weights, distances));
 
-  return computeCounts(rltc, nodeIds, *substitutionCount, threshold, verbose);
+  return computeCounts(rltc, nodeIds, *substitutionCount, threshold, verbose, nbThreads);
 }
 
 
@@ -108,8 +117,26 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeCounts(
   const vector<uint>& nodeIds,
   SubstitutionCount& substitutionCount,
   double threshold,
-  bool verbose)
+  bool verbose,
+  size_t nbThreads)
+{
+  vector<SubstitutionCount*> substitutionCounts(1, &substitutionCount);
+  return computeCounts(rltc, nodeIds, substitutionCounts, threshold, verbose, nbThreads)[0];
+}
+
+/**************************************************************************************************/
+
+vector<ProbabilisticSubstitutionMapping*> SubstitutionMappingTools::computeCounts(
+  RecursiveLikelihoodTreeCalculation& rltc,
+  const vector<uint>& nodeIds,
+  const vector<SubstitutionCount*>& substitutionCounts,
+  double threshold,
+  bool verbose,
+  size_t nbThreads,
+  bool countsAreSet)
 {
+  size_t nbCounts = substitutionCounts.size();
+
   // Preamble:
   if (!rltc.isInitialized())
     throw Exception("SubstitutionMappingTools::computeSubstitutionVectors(). Likelihood object is not initialized.");
@@ -123,7 +150,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeCounts(
     const vector<size_t>& rootPatternLinks = rltc.getLikelihoodData().getRootArrayPositions();
     size_t nbDistinctSites = rltc.getLikelihoodData().getNumberOfDistinctSites();
     
-    return new ProbabilisticSubstitutionMapping(ppt, substitutionCount.getNumberOfSubstitutionTypes(), rootPatternLinks, nbDistinctSites);
+    vector<ProbabilisticSubstitutionMapping*> mappings(nbCounts);
+    for (size_t k = 0; k < nbCounts; k++)
+      mappings[k] = new ProbabilisticSubstitutionMapping(ppt, substitutionCounts[k]->getNumberOfSubstitutionTypes(), rootPatternLinks, nbDistinctSites);
+    return mappings;
   }
 
   for (auto id :nodeIds)
@@ -142,14 +172,18 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeCounts(
   size_t nbStates        = sp.getNumberOfStates();
   size_t nbClasses       = sp.getNumberOfClasses();
 
-  size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
+  vector<size_t> nbTypes(nbCounts);
+  for (size_t k = 0; k < nbCounts; k++)
+    nbTypes[k] = substitutionCounts[k]->getNumberOfSubstitutionTypes();
   size_t nbNodes         = nodeIds.size();
   
   const vector<size_t>& rootPatternLinks = rlt.getRootArrayPositions();
 
-  // We create a Mapping objects
+  // We create one Mapping object per count
   
-  unique_ptr<ProbabilisticSubstitutionMapping> substitutions(new ProbabilisticSubstitutionMapping(ppt, nbTypes, rootPatternLinks, nbDistinctSites));
+  vector<unique_ptr<ProbabilisticSubstitutionMapping> > substitutions(nbCounts);
+  for (size_t k = 0; k < nbCounts; k++)
+    substitutions[k].reset(new ProbabilisticSubstitutionMapping(ppt, nbTypes[k], rootPatternLinks, nbDistinctSites));
 
   // Store likelihood for each compressed site :
 
@@ -158,228 +192,294 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeCounts(
   for (size_t i = 0; i < nbDistinctSites; i++)
     Lr[i]=rltc.getLogLikelihoodForASiteIndex(i);
 
-  // Compute the number of substitutions for each class and each branch in the tree:
-  if (verbose)
-    ApplicationTools::displayTask("Compute counts", true);
+  // The branches to map, and the above likelihoods of their fathers,
+  // computed once before the branches are dealt with (concurrently if
+  // several threads are used):
+  vector<uint> branches;
 
-  unique_ptr<ProbabilisticSubstitutionMapping::mapTree::EdgeIterator> brIt=substitutions->allEdgesIterator();
+  unique_ptr<ProbabilisticSubstitutionMapping::mapTree::EdgeIterator> brIt=substitutions[0]->allEdgesIterator();
 
-  size_t nn=0;
-  
   for (;!brIt->end();brIt->next())
   {
-    if (verbose)
-      ApplicationTools::displayGauge(nn++, nbNodes - 1);
-    
-    shared_ptr<PhyloBranchMapping> br=**brIt;
-    
-    // For each branch
-    uint edid=substitutions->getEdgeIndex(br);
-
+    uint edid=substitutions[0]->getEdgeIndex(**brIt);
     if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, (int)edid))
       continue;
+    branches.push_back(edid);
+  }
+
+  vector<uint> fatherIds;
+  for (auto edid : branches)
+  {
+    uint fathid=substitutions[0]->getFather(edid);
+    if (!VectorTools::contains(fatherIds, fathid))
+    {
+      rltc.computeLikelihoodsAtNode(fathid);
+      fatherIds.push_back(fathid);
+    }
+  }
 
-    uint fathid=substitutions->getFather(edid);
-    uint icid=substitutions->getSon(edid);
+  // Transition probabilities may be cached by models, they are hence
+  // read by one thread at a time:
+  mutex processMutex;
+  mutex displayMutex;
+  size_t nn=0;
 
-    double d=br->getLength();
-    
-    VVdouble likelihoodsFatherConstantPart;    
+  // Compute the number of substitutions for each class and each branch in the tree:
+  if (verbose)
+    ApplicationTools::displayTask("Compute counts", true);
+
+  std::function<void(size_t, size_t)> loop = [&](size_t first, size_t last)
+  {
+    // Each thread has its own substitution counts and scratch buffers,
+    // the likelihood products being shared by all counts:
+    vector<unique_ptr<SubstitutionCount> > localCounts(nbCounts);
+    vector<SubstitutionCount*> counts(substitutionCounts);
+    if (nbThreads > 1)
+    {
+      for (size_t k = 0; k < nbCounts; k++)
+      {
+        localCounts[k].reset(substitutionCounts[k]->clone());
+        counts[k] = localCounts[k].get();
+      }
+    }
+
+    VVdouble likelihoodsFatherConstantPart;
     VectorTools::resize2(likelihoodsFatherConstantPart, nbDistinctSites, nbStates);
 
-    // now the counts
-      
-    VVdouble substitutionsForCurrentNode;
-    VectorTools::resize2(substitutionsForCurrentNode,nbDistinctSites,nbTypes);
+    vector<VVdouble> substitutionsForCurrentNode(nbCounts);
+    vector<VVVdouble> npxys(nbCounts);
+    for (size_t k = 0; k < nbCounts; k++)
+    {
+      VectorTools::resize2(substitutionsForCurrentNode[k],nbDistinctSites,nbTypes[k]);
+      VectorTools::resize3(npxys[k],nbTypes[k],nbStates,nbStates);
+    }
 
-    bool usesLog=false;
-    
-    for (size_t ncl=0; ncl<nbClasses; ncl++)
+    RowMatrix<double> pxy;
+    vector<const SubstitutionModel*> currentModels(nbCounts, 0);
+
+    // Models write their transition probabilities when the counts
+    // compute them, so that with several threads the counts use copies
+    // of the models of their own (and are hence always set up again):
+    map<const SubstitutionModel*, unique_ptr<SubstitutionModel> > localModels;
+
+    if (countsAreSet && nbThreads <= 1)
     {
-      const RecursiveLikelihoodTree::LikTree& rlt_c=rlt[ncl];
-      
-      shared_ptr<RecursiveLikelihoodNode> ici = rlt_c.getNode(icid);
+      for (size_t k = 0; k < nbCounts; k++)
+      {
+        const DecompositionMethods* dm = dynamic_cast<const DecompositionMethods*>(counts[k]);
+        if (dm)
+          currentModels[k] = dm->getSubstitutionModel();
+      }
+    }
 
-      // reinit substitutionsForCurrentNode for log 
-      if (!usesLog && ici->usesLog())
+    for (size_t b = first; b < last; b++)
+    {
+      if (verbose)
       {
-        for (auto& vi : substitutionsForCurrentNode)
-          std::fill(vi.begin(), vi.end(), NumConstants::MINF());
+        lock_guard<mutex> lock(displayMutex);
+        ApplicationTools::displayGauge(nn++, nbNodes - 1);
       }
-        
-      usesLog=ici->usesLog();
 
-      double pr=sp.getProbabilityForModel(ncl);
-      double rate=sp.getRateForModel(ncl);
-      
-      for (size_t i=0; i<nbDistinctSites; i++)
-        VectorTools::fill(likelihoodsFatherConstantPart[i],usesLog?log(pr):pr);
+      // For each branch
+      uint edid=branches[b];
 
-      rltc.computeLikelihoodsAtNode(fathid);
+      uint fathid=substitutions[0]->getFather(edid);
+      uint icid=substitutions[0]->getSon(edid);
 
-      // up father
-      shared_ptr<RecursiveLikelihoodNode> father = rlt_c.getNode(fathid);
-      
-      // down the brothers
+      double d=substitutions[0]->getEdge(edid)->getLength();
+
+      // now the counts
 
-      unique_ptr<RecursiveLikelihoodTree::LikTree::EdgeIterator> brothIt=rlt_c.branchesIterator(father);
+      for (auto& vk : substitutionsForCurrentNode)
+        for (auto& vi : vk)
+          std::fill(vi.begin(), vi.end(), 0.);
 
-      for (;!brothIt->end();brothIt->next())
+      bool usesLog=false;
+
+      for (size_t ncl=0; ncl<nbClasses; ncl++)
       {
-        if (rlt_c.getEdgeIndex(**brothIt)!=edid)
+        const RecursiveLikelihoodTree::LikTree& rlt_c=rlt[ncl];
+
+        shared_ptr<RecursiveLikelihoodNode> ici = rlt_c.getNode(icid);
+
+        // reinit substitutionsForCurrentNode for log 
+        if (!usesLog && ici->usesLog())
         {
-          bool slog=rlt_c.getSon(**brothIt)->usesLog();
-          
-          if (!usesLog)
-          {
-            if (!slog)
-              likelihoodsFatherConstantPart *= rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0);
-            else
-              likelihoodsFatherConstantPart *= VectorTools::exp(rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0));
-          }
-          else {
-            if (slog)
-              likelihoodsFatherConstantPart += rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0);
-            else
-              likelihoodsFatherConstantPart += VectorTools::log(rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0));
-          }
+          for (auto& vk : substitutionsForCurrentNode)
+            for (auto& vi : vk)
+              std::fill(vi.begin(), vi.end(), NumConstants::MINF());
         }
-      }
 
-      bool flog=father->usesLog();
+        usesLog=ici->usesLog();
 
-      if (!usesLog)
-      {
-        if (!flog)
-          likelihoodsFatherConstantPart *= father->getAboveLikelihoodArray();
-        else
-          likelihoodsFatherConstantPart *= VectorTools::exp(father->getAboveLikelihoodArray());
-      }
-      else {
-        if (flog)
-          likelihoodsFatherConstantPart += father->getAboveLikelihoodArray();
-        else
-          likelihoodsFatherConstantPart += VectorTools::log(father->getAboveLikelihoodArray());
-      }
-      
-      // Then, we deal with the node of interest.
-      // We first average upon 'y' to save computations, and then upon 'x'.
-      // ('y' is the state at 'node' and 'x' the state at 'father'.)
+        double pr=sp.getProbabilityForModel(ncl);
+        double rate=sp.getRateForModel(ncl);
 
-      const VVdouble& likelihoodsFather_node = ici->getBelowLikelihoodArray(ComputingNode::D0);
+        computeLikelihoodsFatherConstantPart(rlt_c, edid, fathid, pr, usesLog, likelihoodsFatherConstantPart);
 
-      const SubstitutionModel* sm=dynamic_cast<const SubstitutionModel*>(sp.getModel(icid,ncl));
-      if (!sm)
-        throw Exception("SubstitutionMappingTools:: non substitution model in node " + TextTools::toString(icid));
-      
-      substitutionCount.setSubstitutionModel(sm);
-      
-      // compute all nxy * pxy first:
-      VVVdouble npxy;
+        // Then, we deal with the node of interest.
+        // We first average upon 'y' to save computations, and then upon 'x'.
+        // ('y' is the state at 'node' and 'x' the state at 'father'.)
 
-      VectorTools::resize3(npxy,nbTypes,nbStates,nbStates);
+        const VVdouble& likelihoodsFather_node = ici->getBelowLikelihoodArray(ComputingNode::D0);
 
-      const Matrix<double>& pxy = sp.getTransitionProbabilities(icid,ncl);
-      
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        VVdouble& npxy_t=npxy[t];
-        Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rate, t + 1);
-        MatrixTools::hadamardMult((*nijt),pxy,(*nijt));
+        const SubstitutionModel* sm=dynamic_cast<const SubstitutionModel*>(sp.getModel(icid,ncl));
+        if (!sm)
+          throw Exception("SubstitutionMappingTools:: non substitution model in node " + TextTools::toString(icid));
 
-        for (size_t x=0; x<nbStates; x++)
-          for (size_t y=0; y<nbStates; y++)
-            npxy_t[x][y]=(*nijt)(x,y);
-        
-        delete nijt;
-      }
-      
-      // Now loop over sites:
+        const SubstitutionModel* countModel=sm;
+        {
+          lock_guard<mutex> lock(processMutex);
+          pxy = sp.getTransitionProbabilities(icid,ncl);
 
-      for (size_t i=0; i< nbDistinctSites; i++)
-      {
-        const Vdouble* likelihoodsFather_node_i = &(likelihoodsFather_node[i]);
-        const Vdouble* likelihoodsFatherConstantPart_i = &(likelihoodsFatherConstantPart[i]);
-        
-        for (size_t x = 0; x < nbStates; ++x)
+          if (nbThreads > 1)
+          {
+            unique_ptr<SubstitutionModel>& localModel=localModels[sm];
+            if (!localModel)
+              localModel.reset(sm->clone());
+            countModel=localModel.get();
+          }
+        }
+
+        for (size_t k = 0; k < nbCounts; k++)
         {
-          double likelihoodsFatherConstantPart_i_x = (*likelihoodsFatherConstantPart_i)[x];
-          for (size_t y = 0; y < nbStates; ++y)
+          SubstitutionCount& count = *counts[k];
+          VVdouble& substitutionsForCurrentNode_k = substitutionsForCurrentNode[k];
+          VVVdouble& npxy = npxys[k];
+          size_t nbTypes_k = nbTypes[k];
+
+          // Models are shared by many branches, so that counts are only
+          // set up again when the model changes:
+          if (countModel != currentModels[k])
+          {
+            count.setSubstitutionModel(countModel);
+            currentModels[k] = countModel;
+          }
+
+          // compute all nxy * pxy first:
+
+          for (size_t t = 0; t < nbTypes_k; ++t)
+          {
+            VVdouble& npxy_t=npxy[t];
+            Matrix<double>* nijt = count.getAllNumbersOfSubstitutions(d * rate, t + 1);
+            MatrixTools::hadamardMult((*nijt),pxy,(*nijt));
+
+            for (size_t x=0; x<nbStates; x++)
+              for (size_t y=0; y<nbStates; y++)
+                npxy_t[x][y]=(*nijt)(x,y);
+
+            delete nijt;
+          }
+
+          // Now loop over sites:
+
+          for (size_t i=0; i< nbDistinctSites; i++)
           {
-            double likelihood_xy = usesLog
-              ?likelihoodsFatherConstantPart_i_x + (*likelihoodsFather_node_i)[y]
-              :likelihoodsFatherConstantPart_i_x * (*likelihoodsFather_node_i)[y];
-            
-            if (!usesLog)
+            const Vdouble* likelihoodsFather_node_i = &(likelihoodsFather_node[i]);
+            const Vdouble* likelihoodsFatherConstantPart_i = &(likelihoodsFatherConstantPart[i]);
+
+            for (size_t x = 0; x < nbStates; ++x)
             {
-              if (likelihood_xy!=0) // to avoid multiplication per nan
-                                    // (stop codons)
-                for (size_t t = 0; t < nbTypes; ++t)
+              double likelihoodsFatherConstantPart_i_x = (*likelihoodsFatherConstantPart_i)[x];
+              for (size_t y = 0; y < nbStates; ++y)
+              {
+                double likelihood_xy = usesLog
+                  ?likelihoodsFatherConstantPart_i_x + (*likelihoodsFather_node_i)[y]
+                  :likelihoodsFatherConstantPart_i_x * (*likelihoodsFather_node_i)[y];
+
+                if (!usesLog)
                 {
-                  substitutionsForCurrentNode[i][t] += likelihood_xy * npxy[t][x][y];
-                 //                                <------------>  <----------->
-                 // Posterior probability              |               |
-                 // for site i *                       |               |
-                 // likelihood for this site ----------+               |
-                 //                                                    |
-                 // Substitution function for site i ------------------+
+                  if (likelihood_xy!=0) // to avoid multiplication per nan
+                                        // (stop codons)
+                    for (size_t t = 0; t < nbTypes_k; ++t)
+                    {
+                      substitutionsForCurrentNode_k[i][t] += likelihood_xy * npxy[t][x][y];
+                     //                                <------------>  <----------->
+                     // Posterior probability              |               |
+                     // for site i *                       |               |
+                     // likelihood for this site ----------+               |
+                     //                                                    |
+                     // Substitution function for site i ------------------+
+                    }
                 }
-            }
-            else
-            {
-              if (likelihood_xy!=NumConstants::MINF())  // to avoid add per -inf
-                for (size_t t = 0; t < nbTypes; ++t)
+                else
                 {
-                  if (npxy[t][x][y]< -NumConstants::MILLI())
-                  {
-                    ApplicationTools::displayWarning("These counts are negative, their logs could not be computed:" + TextTools::toString(npxy[t][x][y]));
-                    throw Exception("Stop in SubstitutionMappingTools");
-                  }
-                  else
-                  {
-                    if (npxy[t][x][y]>0)
+                  if (likelihood_xy!=NumConstants::MINF())  // to avoid add per -inf
+                    for (size_t t = 0; t < nbTypes_k; ++t)
                     {
-                      double ll=likelihood_xy + log(npxy[t][x][y]);
-                      if (ll>substitutionsForCurrentNode[i][t])
-                        substitutionsForCurrentNode[i][t] = ll + log(1 + exp(substitutionsForCurrentNode[i][t] - ll));
+                      if (npxy[t][x][y]< -NumConstants::MILLI())
+                      {
+                        lock_guard<mutex> lock(displayMutex);
+                        ApplicationTools::displayWarning("These counts are negative, their logs could not be computed:" + TextTools::toString(npxy[t][x][y]));
+                        throw Exception("Stop in SubstitutionMappingTools");
+                      }
                       else
-                        substitutionsForCurrentNode[i][t] += log(1 + exp(ll - substitutionsForCurrentNode[i][t]));
+                      {
+                        if (npxy[t][x][y]>0)
+                        {
+                          double ll=likelihood_xy + log(npxy[t][x][y]);
+                          if (ll>substitutionsForCurrentNode_k[i][t])
+                            substitutionsForCurrentNode_k[i][t] = ll + log(1 + exp(substitutionsForCurrentNode_k[i][t] - ll));
+                          else
+                            substitutionsForCurrentNode_k[i][t] += log(1 + exp(ll - substitutionsForCurrentNode_k[i][t]));
+                        }
+                      } 
                     }
-                  } 
                 }
+              }
             }
           }
         }
       }
-    }
 
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbDistinctSites; ++i)
-    {
-      for (size_t t = 0; t < nbTypes; ++t)
+      // Now we just have to copy the substitutions into the result vectors:
+      for (size_t k = 0; k < nbCounts; k++)
       {
-        double x = usesLog?exp(substitutionsForCurrentNode[i][t] - Lr[i]):substitutionsForCurrentNode[i][t]/exp(Lr[i]);
-        
-        if (std::isnan(x) || std::isinf(x))
-        {
-          if (verbose)
-            ApplicationTools::displayWarning("On branch " + TextTools::toString(edid) + ", site index " + TextTools::toString(i) + ", and type " + TextTools::toString(t) + ", counts could not be computed.");
-          (*br)(i,t)=0;
-        }
-        else
+        shared_ptr<PhyloBranchMapping> br = substitutions[k]->getEdge(edid);
+        const VVdouble& substitutionsForCurrentNode_k = substitutionsForCurrentNode[k];
+
+        for (size_t i = 0; i < nbDistinctSites; ++i)
         {
-          if (threshold>=0 && x > threshold)
+          for (size_t t = 0; t < nbTypes[k]; ++t)
           {
-            if (verbose)
-              ApplicationTools::displayWarning("On branch " + TextTools::toString(edid) + ", site index" + TextTools::toString(i) + ", and type " + TextTools::toString(t) + " count has been ignored because it is presumably saturated.");
-            (*br)(i,t)=0;
+            double x = usesLog?exp(substitutionsForCurrentNode_k[i][t] - Lr[i]):substitutionsForCurrentNode_k[i][t]/exp(Lr[i]);
+
+            if (std::isnan(x) || std::isinf(x))
+            {
+              if (verbose)
+              {
+                lock_guard<mutex> lock(displayMutex);
+                ApplicationTools::displayWarning("On branch " + TextTools::toString(edid) + ", site index " + TextTools::toString(i) + ", and type " + TextTools::toString(t) + ", counts could not be computed.");
+              }
+              (*br)(i,t)=0;
+            }
+            else
+            {
+              if (threshold>=0 && x > threshold)
+              {
+                if (verbose)
+                {
+                  lock_guard<mutex> lock(displayMutex);
+                  ApplicationTools::displayWarning("On branch " + TextTools::toString(edid) + ", site index" + TextTools::toString(i) + ", and type " + TextTools::toString(t) + " count has been ignored because it is presumably saturated.");
+                }
+                (*br)(i,t)=0;
+              }
+              else     
+                (*br)(i,t)= x;;
+            }
           }
-          else     
-            (*br)(i,t)= x;;
         }
       }
     }
+  };
+
+  if (nbThreads > 1)
+  {
+    SiteLoopExecutor executor(nbThreads);
+    executor.run(branches.size(), loop);
   }
+  else
+    loop(0, branches.size());
   
   if (verbose)
   {
@@ -387,8 +487,70 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeCounts(
       *ApplicationTools::message << " ";
     ApplicationTools::displayTaskDone();
   }
-  
-  return substitutions.release();
+
+  vector<ProbabilisticSubstitutionMapping*> mappings(nbCounts);
+  for (size_t k = 0; k < nbCounts; k++)
+    mappings[k] = substitutions[k].release();
+  return mappings;
+}
+
+/**************************************************************************************************/
+
+void SubstitutionMappingTools::computeLikelihoodsFatherConstantPart(
+  const RecursiveLikelihoodTree::LikTree& rlt_c,
+  uint edid,
+  uint fathid,
+  double pr,
+  bool usesLog,
+  VVdouble& likelihoodsFatherConstantPart)
+{
+  for (auto& li : likelihoodsFatherConstantPart)
+    VectorTools::fill(li,usesLog?log(pr):pr);
+
+  // up father
+  shared_ptr<RecursiveLikelihoodNode> father = rlt_c.getNode(fathid);
+
+  // down the brothers
+
+  unique_ptr<RecursiveLikelihoodTree::LikTree::EdgeIterator> brothIt=rlt_c.branchesIterator(father);
+
+  for (;!brothIt->end();brothIt->next())
+  {
+    if (rlt_c.getEdgeIndex(**brothIt)!=edid)
+    {
+      bool slog=rlt_c.getSon(**brothIt)->usesLog();
+
+      if (!usesLog)
+      {
+        if (!slog)
+          likelihoodsFatherConstantPart *= rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0);
+        else
+          likelihoodsFatherConstantPart *= VectorTools::exp(rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0));
+      }
+      else {
+        if (slog)
+          likelihoodsFatherConstantPart += rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0);
+        else
+          likelihoodsFatherConstantPart += VectorTools::log(rlt_c.getSon(**brothIt)->getToFatherBelowLikelihoodArray(ComputingNode::D0));
+      }
+    }
+  }
+
+  bool flog=father->usesLog();
+
+  if (!usesLog)
+  {
+    if (!flog)
+      likelihoodsFatherConstantPart *= father->getAboveLikelihoodArray();
+    else
+      likelihoodsFatherConstantPart *= VectorTools::exp(father->getAboveLikelihoodArray());
+  }
+  else {
+    if (flog)
+      likelihoodsFatherConstantPart += father->getAboveLikelihoodArray();
+    else
+      likelihoodsFatherConstantPart += VectorTools::log(father->getAboveLikelihoodArray());
+  }
 }
 
 /**************************************************************************************************/
@@ -461,24 +623,38 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeNormalization
         for (size_t i = 0; i < nbStates; i++)
           usai[nbt].setIndex(supportedStates[i], 0);
 
+      const vector<size_t>& types = reg.getTypeMatrix();
+      size_t nbTypeStates = reg.getStateMap().getNumberOfModelStates();
       for (size_t i = 0; i < nbStates; i++)
       {
         for (size_t j = 0; j < nbStates; j++)
         {
           if (i != j)
           {
-            size_t nbt = reg.getType(i, j);
+            size_t nbt = types[i * nbTypeStates + j];
             if (nbt != 0)
               usai[nbt - 1].setIndex(supportedStates[i], usai[nbt - 1].getIndex(supportedStates[i]) + modn->Qij(i, j)*(distances?distances->getIndex(supportedStates[i],supportedStates[j]):1));
           }
         }
       }
       
+      // All types are mapped in a single traversal of the tree:
+      vector<unique_ptr<Reward> > vrewards(nbTypes);
+      vector<Reward*> prewards(nbTypes);
       for (size_t nbt = 0; nbt < nbTypes; nbt++)
       {
-        unique_ptr<Reward> reward(new DecompositionReward(modn, &usai[nbt]));
-        
-        unique_ptr<ProbabilisticRewardMapping> mapping(RewardMappingTools::computeRewardVectors(rltc, mids, *reward, verbose));
+        vrewards[nbt].reset(new DecompositionReward(modn, &usai[nbt]));
+        prewards[nbt] = vrewards[nbt].get();
+      }
+
+      vector<ProbabilisticRewardMapping*> pmappings(RewardMappingTools::computeRewardVectors(rltc, mids, prewards, verbose));
+      vector<unique_ptr<ProbabilisticRewardMapping> > vmappings(nbTypes);
+      for (size_t nbt = 0; nbt < nbTypes; nbt++)
+        vmappings[nbt].reset(pmappings[nbt]);
+
+      for (size_t nbt = 0; nbt < nbTypes; nbt++)
+      {
+        ProbabilisticRewardMapping* mapping = vmappings[nbt].get();
 
         for (size_t k = 0; k < mids.size(); k++)
         {
@@ -538,23 +714,22 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeNormalizedCou
   {
     shared_ptr<PhyloBranchMapping> brNormCount=**brIt;
 
-    VVdouble& brnCou=brNormCount->getCounts();
+    Vdouble& brnCou=brNormCount->getCounts();
 
     // For each branch
     uint edid=normCounts->getEdgeIndex(brNormCount);
 
     if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, (int)edid))
     {
-      for (auto& brk : brnCou)
-        VectorTools::fill(brk,0.);
+      VectorTools::fill(brnCou,0.);
       continue;
     }
         
     shared_ptr<PhyloBranchMapping> brFactor=factors->getEdge(edid);
     shared_ptr<PhyloBranchMapping> brCount=counts->getEdge(edid);
 
-    const VVdouble& cou=brCount->getCounts();
-    const VVdouble& fac=brFactor->getCounts();
+    const Vdouble& cou=brCount->getCounts();
+    const Vdouble& fac=brFactor->getCounts();
 
 
     // if not per time, multiply by the lengths of the branches of
@@ -562,16 +737,9 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeNormalizedCou
     
     double slg=(!perTimeUnit?brCount->getLength():1)/siteSize;
     
-    for (size_t k = 0; k < nbDistinctSites; k++)
-    {
-      Vdouble& ncou_k = brnCou[k];
-      
-      const Vdouble& cou_k=cou[k];
-      const Vdouble& fac_k=fac[k];
-      
-      for (size_t t = 0; t < nbTypes; ++t)
-        ncou_k[t]=(fac_k[t]!=0? cou_k[t]/fac_k[t]*slg : 0);
-    }
+    // counts are stored by site / type in a single vector
+    for (size_t k = 0; k < nbDistinctSites * nbTypes; k++)
+      brnCou[k]=(fac[k]!=0? cou[k]/fac[k]*slg : 0);
   }
 
   return normCounts.release();
@@ -680,7 +848,7 @@ Vdouble SubstitutionMappingTools::getCountsForSitePerBranch(
   
   Vdouble v(counts.getNumberOfBranches(),0);
   for (;!brIt->end();brIt->next())
-    v[counts.getEdgeIndex(**brIt)] = VectorTools::sum((***brIt).getSiteCount(siteIndex));
+    v[counts.getEdgeIndex(**brIt)] = (***brIt).getSiteCount(siteIndex).sum();
   
   return v;
 }
@@ -702,7 +870,7 @@ Vdouble SubstitutionMappingTools::getCountsForSitePerBranch(
     shared_ptr<PhyloBranchMapping> brf=factors.getEdge(edid);
 
     
-    v[edid] = VectorTools::sum(brm->getSiteCount(siteIndex))/VectorTools::sum(brf->getSiteCount(siteIndex));
+    v[edid] = brm->getSiteCount(siteIndex).sum()/brf->getSiteCount(siteIndex).sum();
   }
   
   return v;
@@ -722,13 +890,12 @@ VVdouble SubstitutionMappingTools::getCountsPerSitePerBranch(
   VVdouble result;
   VectorTools::resize2(result,nbSites, nbBr);
 
-  for (size_t k = 0; k < nbSites; ++k)
+  // Counts are read in place, branch by branch:
+  for (size_t i = 0; i < nbBr; ++i)
   {
-    vector<double> countsf(SubstitutionMappingTools::getCountsForSitePerBranch(counts, k));
-    Vdouble* resS=&result[k];
-    
-    for (size_t i = 0; i < nbBr; ++i)
-      (*resS)[i]= countsf[idc[i]];
+    shared_ptr<PhyloBranchMapping> br=counts.getEdge(idc[i]);
+    for (size_t k = 0; k < nbSites; ++k)
+      result[k][i] = br->getSiteCount(counts.getSiteIndex(k)).sum();
   }
   return result;
 }
@@ -746,13 +913,16 @@ VVdouble SubstitutionMappingTools::getCountsPerSitePerBranch(
   VVdouble result;
   VectorTools::resize2(result,nbSites, nbBr);
 
-  for (size_t k = 0; k < nbSites; ++k)
+  // Counts are read in place, branch by branch:
+  for (size_t i = 0; i < nbBr; ++i)
   {
-    vector<double> countsf(SubstitutionMappingTools::getCountsForSitePerBranch(counts, factors, k));
-    Vdouble* resS=&result[k];
-    
-    for (size_t i = 0; i < nbBr; ++i)
-      (*resS)[i]= countsf[idc[i]];
+    shared_ptr<PhyloBranchMapping> brm=counts.getEdge(idc[i]);
+    shared_ptr<PhyloBranchMapping> brf=factors.getEdge(idc[i]);
+    for (size_t k = 0; k < nbSites; ++k)
+    {
+      size_t siteIndex = counts.getSiteIndex(k);
+      result[k][i] = brm->getSiteCount(siteIndex).sum()/brf->getSiteCount(siteIndex).sum();
+    }
   }
   return result;
 }
@@ -1178,6 +1348,163 @@ void SubstitutionMappingTools::outputPerSitePerBranchPerType(
   }
 }
 
+/**************************************************************************************************/
+
+void SubstitutionMappingTools::outputPerGenePerBranchPerType(
+  const vector<RecursiveLikelihoodTreeCalculation*>& genes,
+  const vector<string>& geneNames,
+  const vector<uint>& nodeIds,
+  const SubstitutionRegister& reg,
+  ostream& out,
+  std::shared_ptr<const AlphabetIndex2> weights,
+  std::shared_ptr<const AlphabetIndex2> distances,
+  double threshold,
+  bool verbose,
+  size_t nbThreads)
+{
+  size_t nbGenes = genes.size();
+  if (geneNames.size() != nbGenes)
+    throw Exception("SubstitutionMappingTools::outputPerGenePerBranchPerType(). Numbers of genes and names do not match.");
+
+  size_t nbTypes = reg.getNumberOfSubstitutionTypes();
+
+  out << "Gene\tBranch";
+  for (size_t t = 0; t < nbTypes; ++t)
+    out << "\t" << reg.getTypeName(t + 1);
+  out << endl;
+
+  if (nbGenes == 0)
+    return;
+  if (nbThreads > nbGenes)
+    nbThreads = nbGenes;
+
+  // One count per model, set up on the first gene using it and then
+  // copied by each thread:
+  map<const SubstitutionModel*, unique_ptr<SubstitutionCount> > sharedCounts;
+
+  // Models may be shared by the processes of distinct genes, and they
+  // write their transition probabilities when these are computed. The
+  // genes sharing a model with another gene are hence computed and
+  // mapped by one thread at a time, the others concurrently:
+  mutex likelihoodMutex;
+
+  vector<set<const TransitionModel*> > geneModels(nbGenes);
+  map<const TransitionModel*, size_t> modelUses;
+  for (size_t g = 0; g < nbGenes; g++)
+  {
+    const SubstitutionProcess& sp = *genes[g]->getSubstitutionProcess();
+    vector<uint> allIds = sp.getParametrizablePhyloTree().getAllEdgesIndexes();
+    for (auto id : allIds)
+      for (size_t c = 0; c < sp.getNumberOfClasses(); c++)
+        geneModels[g].insert(sp.getModel(id, c));
+    for (auto model : geneModels[g])
+      modelUses[model]++;
+  }
+
+  vector<bool> sharesModels(nbGenes, false);
+  for (size_t g = 0; g < nbGenes; g++)
+    for (auto model : geneModels[g])
+      if (modelUses[model] > 1)
+        sharesModels[g] = true;
+
+  // Genes are dealt with in the input order, and written as soon as
+  // all preceding genes are:
+  mutex outputMutex;
+  size_t nextGene = 0;
+  size_t nextOutput = 0;
+  map<size_t, string> pendingOutputs;
+
+  if (verbose)
+    ApplicationTools::displayTask("Map genes", true);
+
+  std::function<void(size_t, size_t)> loop = [&](size_t, size_t)
+  {
+    map<const SubstitutionModel*, unique_ptr<SubstitutionCount> > localCounts;
+
+    while (true)
+    {
+      size_t g;
+      {
+        lock_guard<mutex> lock(outputMutex);
+        if (nextGene == nbGenes)
+          return;
+        g = nextGene++;
+      }
+
+      RecursiveLikelihoodTreeCalculation& rltc = *genes[g];
+      if (!rltc.isInitialized())
+        throw Exception("SubstitutionMappingTools::outputPerGenePerBranchPerType(). Likelihood object of gene " + geneNames[g] + " is not initialized.");
+
+      const SubstitutionProcess& sp = *rltc.getSubstitutionProcess();
+      vector<uint> ids = nodeIds.size() == 0 ? sp.getParametrizablePhyloTree().getAllEdgesIndexes() : nodeIds;
+
+      ostringstream geneOut;
+      if (ids.size() > 0)
+      {
+        vector<SubstitutionCount*> counts(1, 0);
+        unique_lock<mutex> lock(likelihoodMutex);
+        {
+          rltc.computeTreeLikelihood();
+
+          const SubstitutionModel* sm = dynamic_cast<const SubstitutionModel*>(sp.getModel(ids[0], 0));
+          if (!sm)
+            throw Exception("SubstitutionMappingTools::outputPerGenePerBranchPerType(). Gene " + geneNames[g] + " does not use a SubstitutionModel on branch " + TextTools::toString(ids[0]) + ".");
+
+          unique_ptr<SubstitutionCount>& localCount = localCounts[sm];
+          if (!localCount)
+          {
+            unique_ptr<SubstitutionCount>& sharedCount = sharedCounts[sm];
+            if (!sharedCount)
+              sharedCount.reset(new DecompositionSubstitutionCount(sm, reg.clone(), weights, distances));
+            localCount.reset(sharedCount->clone());
+          }
+          counts[0] = localCount.get();
+        }
+        if (!sharesModels[g])
+          lock.unlock();
+
+        unique_ptr<ProbabilisticSubstitutionMapping> mapping(computeCounts(rltc, ids, counts, threshold, false, 1, true)[0]);
+        if (lock.owns_lock())
+          lock.unlock();
+
+        for (auto id : ids)
+        {
+          Vdouble cou = getCountsForBranchPerType(*mapping, id);
+          geneOut << geneNames[g] << "\t" << id;
+          for (size_t t = 0; t < nbTypes; ++t)
+            geneOut << "\t" << cou[t];
+          geneOut << endl;
+        }
+      }
+
+      lock_guard<mutex> lock(outputMutex);
+      pendingOutputs[g] = geneOut.str();
+      while (pendingOutputs.size() > 0 && pendingOutputs.begin()->first == nextOutput)
+      {
+        out << pendingOutputs.begin()->second;
+        pendingOutputs.erase(pendingOutputs.begin());
+        if (verbose)
+          ApplicationTools::displayGauge(nextOutput, nbGenes - 1);
+        nextOutput++;
+      }
+    }
+  };
+
+  if (nbThreads > 1)
+  {
+    SiteLoopExecutor executor(nbThreads);
+    executor.run(nbThreads, loop);
+  }
+  else
+    loop(0, 1);
+
+  if (verbose)
+  {
+    if (ApplicationTools::message)
+      *ApplicationTools::message << " ";
+    ApplicationTools::displayTaskDone();
+  }
+}
 
 /**************************************************************************************************/
 
@@ -1257,6 +1584,60 @@ void SubstitutionMappingTools::readFromStream(istream& in, ProbabilisticSubstitu
 }
 
 
+/**************************************************************************************************/
+
+void SubstitutionMappingTools::writeToBinaryStream(
+  const ProbabilisticSubstitutionMapping& substitutions,
+  const SubstitutionRegister& reg,
+  ostream& out,
+  size_t blockSize)
+{
+  vector<uint> ids = substitutions.getAllEdgesIndexes();
+  size_t nbTypes = substitutions.getNumberOfSubstitutionTypes();
+  vector<string> typeNames(nbTypes);
+  for (size_t t = 0; t < nbTypes; ++t)
+    typeNames[t] = reg.getTypeName(t + 1);
+
+  BinaryMappingWriter writer(out, ids, typeNames);
+  size_t nbSites = substitutions.getNumberOfSites();
+  for (size_t first = 0; first < nbSites; first += blockSize)
+    writer.writeBlock(substitutions, ids, first, min(blockSize, nbSites - first));
+  if (!out)
+    throw IOException("SubstitutionMappingTools::writeToBinaryStream. Can't write to stream.");
+}
+
+/**************************************************************************************************/
+
+void SubstitutionMappingTools::readFromBinaryStream(istream& in, ProbabilisticSubstitutionMapping& substitutions)
+{
+  BinaryMappingReader reader(in);
+  const vector<uint>& ids = reader.getBranchIds();
+  size_t nbTypes = reader.getTypeNames().size();
+
+  vector<shared_ptr<PhyloBranchMapping> > branches(ids.size());
+  for (size_t k = 0; k < ids.size(); ++k)
+  {
+    if (!substitutions.hasEdge(ids[k]))
+      throw IOException("SubstitutionMappingTools::readFromBinaryStream. Unknown branch " + TextTools::toString(ids[k]) + ".");
+    branches[k] = substitutions.getEdge(ids[k]);
+  }
+
+  substitutions.setNumberOfSitesAndTypes(0, nbTypes);
+  substitutions.setNumberOfSubstitutionTypes(nbTypes);
+
+  VVVdouble block;
+  size_t nbSites = 0;
+  while (reader.readBlock(block))
+  {
+    substitutions.setNumberOfSites(nbSites + block.size());
+    for (size_t i = 0; i < block.size(); ++i)
+      for (size_t k = 0; k < branches.size(); ++k)
+        for (size_t t = 0; t < nbTypes; ++t)
+          (*branches[k])(nbSites + i, t) = block[i][k][t];
+    nbSites += block.size();
+  }
+}
+
 /**************************************************************************************************/
 
 /*ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectorsNoAveraging(
@@ -1337,7 +1718,7 @@ for (size_t n = 0; n < nbSons; ++n)
 const Node* currentSon = father->getSon(n);
 if (currentSon->getId() != currentNode->getId())
 {
-const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodArrayForNeighbor(father->getId(), currentSon->getId());
 
 // Now iterate over all site partitions:
 unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
@@ -1382,7 +1763,7 @@ likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
 if (father->hasFather())
 {
 const Node* currentSon = father->getFather();
-const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodArrayForNeighbor(father->getId(), currentSon->getId());
 // Now iterate over all site partitions:
 unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
 VVVdouble pxy;
@@ -1445,7 +1826,7 @@ for (size_t x = 0; x < nbStates; ++x)
 // ('y' is the state at 'node' and 'x' the state at 'father'.)
 
 // Iterate over all site partitions:
-const VVVdouble* likelihoodsFather_node = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId());
+const VVVdouble* likelihoodsFather_node = &drtl.getLikelihoodArrayForNeighbor(father->getId(), currentNode->getId());
 unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
 VVVdouble pxy;
 bool first;
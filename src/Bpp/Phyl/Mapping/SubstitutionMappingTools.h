@@ -84,6 +84,8 @@ namespace bpp
      * @param threshold         value above which counts are considered
      *                          saturated (default: -1 means no threshold).
      * @param verbose           Print info to screen.
+     * @param nbThreads         The number of threads mapping distinct branches
+     *                          concurrently (default: 1).
      * @return A tree <PhyloNode, PhyloBranchMapping>
      */
 
@@ -91,10 +93,11 @@ namespace bpp
       RecursiveLikelihoodTreeCalculation& rltc,
       SubstitutionCount& substitutionCount,
       double threshold = -1,
-      bool verbose = true)
+      bool verbose = true,
+      size_t nbThreads = 1)
     {
       std::vector<uint> nodeIds=rltc.getSubstitutionProcess()->getParametrizablePhyloTree().getAllEdgesIndexes();
-      return computeCounts(rltc, nodeIds, substitutionCount, threshold, verbose);
+      return computeCounts(rltc, nodeIds, substitutionCount, threshold, verbose, nbThreads);
     }
 
     /**
@@ -111,6 +114,8 @@ namespace bpp
      * @param threshold         value above which counts are considered
      *                          saturated (default: -1 means no threshold).
      * @param verbose           Print info to screen.
+     * @param nbThreads         The number of threads mapping distinct branches
+     *                          concurrently (default: 1).
      * @return A tree <PhyloNode, PhyloBranchMapping>
      */
 
@@ -120,10 +125,11 @@ namespace bpp
       std::shared_ptr<const AlphabetIndex2> weights = 0,
       std::shared_ptr<const AlphabetIndex2> distances = 0,
       double threshold = -1,
-      bool verbose = true)
+      bool verbose = true,
+      size_t nbThreads = 1)
     {
       std::vector<uint> nodeIds=rltc.getSubstitutionProcess()->getParametrizablePhyloTree().getAllEdgesIndexes();
-      return computeCounts(rltc, nodeIds, reg, weights, distances, threshold, verbose);
+      return computeCounts(rltc, nodeIds, reg, weights, distances, threshold, verbose, nbThreads);
     }
 
     /**
@@ -137,6 +143,9 @@ namespace bpp
      * @param threshold         value above which counts are considered
      *                          saturated (default: -1 means no threshold).
      * @param verbose           Print info to screen.
+     * @param nbThreads         The number of threads mapping distinct branches
+     *                          concurrently (default: 1). Each thread uses
+     *                          a clone of substitutionCount.
      * @return A tree <PhyloNode, PhyloBranchMapping>
      */
 
@@ -145,7 +154,43 @@ namespace bpp
       const std::vector<uint>& nodeIds,
       SubstitutionCount& substitutionCount,
       double threshold = -1,
-      bool verbose = true);
+      bool verbose = true,
+      size_t nbThreads = 1);
+
+    /**
+     * @brief Compute the substitutions trees of several counts in a
+     * single traversal of the tree.
+     *
+     * The likelihood arrays and the conditional products at each
+     * branch are computed once and shared by all counts, so that
+     * mapping several registers costs little more than mapping one.
+     *
+     * @param rltc               A RecursiveLikelihoodTreeCalculation object.
+     * @param nodeIds            The Ids of the nodes the substitutions
+     *                           are counted on. If empty, count substitutions
+     *                           on all nodes.
+     * @param substitutionCounts The SubstitutionCounts to use.
+     * @param threshold          value above which counts are considered
+     *                           saturated (default: -1 means no threshold).
+     * @param verbose            Print info to screen.
+     * @param nbThreads          The number of threads mapping distinct branches
+     *                           concurrently (default: 1).
+     * @param countsAreSet       Tell if the decomposition counts are
+     *                           already set on the current parameters of
+     *                           their models, so that they are not set up
+     *                           again for these models (default: false).
+     * @return One tree <PhyloNode, PhyloBranchMapping> per count, in
+     * the same order, to be deleted by the caller.
+     */
+
+    static std::vector<ProbabilisticSubstitutionMapping*> computeCounts(
+      RecursiveLikelihoodTreeCalculation& rltc,
+      const std::vector<uint>& nodeIds,
+      const std::vector<SubstitutionCount*>& substitutionCounts,
+      double threshold = -1,
+      bool verbose = true,
+      size_t nbThreads = 1,
+      bool countsAreSet = false);
 
     /**
      * @brief Compute the substitutions tree for a particular dataset
@@ -164,6 +209,8 @@ namespace bpp
      * @param threshold         value above which counts are considered
      *                          saturated (default: -1 means no threshold).
      * @param verbose           Print info to screen.
+     * @param nbThreads         The number of threads mapping distinct branches
+     *                          concurrently (default: 1).
      * @return A tree <PhyloNode, PhyloBranchMapping>
      */
 
@@ -174,7 +221,35 @@ namespace bpp
       std::shared_ptr<const AlphabetIndex2> weights = 0,
       std::shared_ptr<const AlphabetIndex2> distances = 0,
       double threshold = -1,
-      bool verbose = true);
+      bool verbose = true,
+      size_t nbThreads = 1);
+
+    /**
+     * @brief Compute, for a rate class, the product of the likelihoods
+     * on the father side of a branch: the probability of the class,
+     * the below likelihoods of the brothers and the above likelihoods
+     * of the father.
+     *
+     * This is the part shared by substitution and reward mappings on
+     * a branch. The above likelihoods of the father must be up to
+     * date (see RecursiveLikelihoodTreeCalculation::computeLikelihoodsAtNode).
+     *
+     * @param rlt_c   The likelihood tree of the class.
+     * @param edid    The id of the branch.
+     * @param fathid  The id of the father node of the branch.
+     * @param pr      The probability of the class.
+     * @param usesLog Whether the product is computed in log.
+     * @param likelihoodsFatherConstantPart [out] The product, by site
+     *                and state, already sized.
+     */
+
+    static void computeLikelihoodsFatherConstantPart(
+      const RecursiveLikelihoodTree::LikTree& rlt_c,
+      uint edid,
+      uint fathid,
+      double pr,
+      bool usesLog,
+      VVdouble& likelihoodsFatherConstantPart);
 
     /**
      * @brief Compute the normalizations tree due to the models of "null"
@@ -700,6 +775,56 @@ namespace bpp
                                               const std::vector<uint>& ids,
                                               const SubstitutionRegister& reg,
                                               const VVVdouble& counts);
+
+    /**
+     * @brief Map several genes and write their counts per branch per
+     * type to a single stream.
+     *
+     * This is meant for genome-wide scans (dN/dS for instance), where
+     * the same register and often the same models are used for
+     * thousands of genes. Genes are grouped by the model of their first
+     * mapped branch: the register is cloned and the decomposition of
+     * the model is computed once per group, instead of once per gene.
+     *
+     * Genes are mapped concurrently, each thread holding the mapping of
+     * one gene at a time. For each gene and each branch, a line with the
+     * gene name, the branch id and the counts of each type summed over
+     * sites is written, genes being written in the input order as soon
+     * as all preceding genes are done.
+     *
+     * Models may be shared by the processes of distinct genes: the
+     * genes using a model used by another gene are computed and mapped
+     * by one thread at a time, the other genes concurrently.
+     *
+     * @param genes     The RecursiveLikelihoodTreeCalculation objects of the genes.
+     * @param geneNames The names of the genes, in the same order.
+     * @param nodeIds   The Ids of the nodes the substitutions are
+     *                  counted on. If empty, count substitutions on all nodes.
+     * @param reg       The SubstitutionRegister to use.
+     * @param out       The stream where to write the counts.
+     * @param weights   Pointer to AlphabetIndex2 for weights
+     *                  for all substitutions (default: null
+     *                  means no weight),
+     * @param distances Pointer to AlphabetIndex2 for distances
+     *                  for all substitutions (default: null
+     *                  means each distance = 1),
+     * @param threshold value above which counts are considered
+     *                  saturated (default: -1 means no threshold).
+     * @param verbose   Print info to screen.
+     * @param nbThreads The number of genes mapped concurrently (default: 1).
+     * @throw Exception If the numbers of genes and names differ.
+     */
+    static void outputPerGenePerBranchPerType(
+      const std::vector<RecursiveLikelihoodTreeCalculation*>& genes,
+      const std::vector<std::string>& geneNames,
+      const std::vector<uint>& nodeIds,
+      const SubstitutionRegister& reg,
+      std::ostream& out,
+      std::shared_ptr<const AlphabetIndex2> weights = 0,
+      std::shared_ptr<const AlphabetIndex2> distances = 0,
+      double threshold = -1,
+      bool verbose = true,
+      size_t nbThreads = 1);
     
 
     /**
@@ -731,6 +856,39 @@ namespace bpp
 
     static void readFromStream(std::istream& in, ProbabilisticSubstitutionMapping& substitutions, size_t type);
 
+    /**
+     * @brief Write the counts of all branches and types to a binary
+     * stream, by blocks of sites.
+     *
+     * Counts are read in place from the mapping. Sites positions are
+     * not written.
+     *
+     * @param substitutions The substitutions to write.
+     * @param reg           The register giving the names of the types.
+     * @param out           The output stream.
+     * @param blockSize     The number of sites per block.
+     * @throw IOException If an output error happens.
+     * @see BinaryMappingWriter to write counts as they are computed.
+     */
+
+    static void writeToBinaryStream(
+      const ProbabilisticSubstitutionMapping& substitutions,
+      const SubstitutionRegister& reg,
+      std::ostream& out,
+      size_t blockSize = 1000);
+
+    /**
+     * @brief Read counts written by writeToBinaryStream or a
+     * BinaryMappingWriter.
+     *
+     * @param in            The input stream.
+     * @param substitutions The mapping object to fill, which sites and
+     *                      types are set from the stream.
+     * @throw IOException If an input error happens or a branch is unknown.
+     */
+
+    static void readFromBinaryStream(std::istream& in, ProbabilisticSubstitutionMapping& substitutions);
+
     /*
      *
      *@}
@@ -54,4 +54,5 @@ void GeneralSubstitutionRegister::updateTypes_()
       reg[i].push_back(j);
     }
   }
+  resetTypeMatrix_();
 }
@@ -112,6 +112,18 @@ namespace bpp
      */
     virtual size_t getType(size_t fromState, size_t toState) const = 0;
 
+    /**
+     * @brief Get the substitution types of all pairs of model states.
+     *
+     * The table is built once from getType, and kept by the register:
+     * loops over all pairs of states should use it instead of calling
+     * getType for each pair.
+     *
+     * @return The types, with the type of (fromState, toState) at index
+     * fromState * n + toState, where n is the number of model states.
+     */
+    virtual const std::vector<size_t>& getTypeMatrix() const = 0;
+
     /**
      * @brief Get the name of a given substitution type.
      *
@@ -130,20 +142,27 @@ namespace bpp
   protected:
     const StateMap* stateMap_;
     std::string name_;
+
+  private:
+    /**
+     * @brief Cache of getTypeMatrix, empty until the first call.
+     */
+    mutable std::vector<size_t> typeMatrix_;
     
   public:
     AbstractSubstitutionRegister(const StateMap& stateMap, const std::string& name) :
-      stateMap_(&stateMap), name_(name)
+      stateMap_(&stateMap), name_(name), typeMatrix_()
     {}
 
     AbstractSubstitutionRegister(const AbstractSubstitutionRegister& asr) :
-      stateMap_(asr.stateMap_), name_(asr.name_)
+      stateMap_(asr.stateMap_), name_(asr.name_), typeMatrix_(asr.typeMatrix_)
     {}
 
     AbstractSubstitutionRegister& operator=(const AbstractSubstitutionRegister& asr)
     {
       stateMap_ = asr.stateMap_;
       name_ = asr.name_;
+      typeMatrix_ = asr.typeMatrix_;
       return *this;
     }
 
@@ -158,6 +177,29 @@ namespace bpp
     {
       return name_;
     }
+
+    /**
+     * @brief The table is built at the first call (this is not thread safe).
+     */
+    const std::vector<size_t>& getTypeMatrix() const
+    {
+      if (typeMatrix_.empty())
+      {
+        size_t n = stateMap_->getNumberOfModelStates();
+        typeMatrix_.resize(n * n);
+        for (size_t i = 0; i < n; ++i)
+          for (size_t j = 0; j < n; ++j)
+            typeMatrix_[i * n + j] = getType(i, j);
+      }
+      return typeMatrix_;
+    }
+
+  protected:
+    /**
+     * @brief To be called by methods changing the types, so that the
+     * table of getTypeMatrix is built again.
+     */
+    void resetTypeMatrix_() { typeMatrix_.clear(); }
     
   };
 
@@ -367,6 +409,7 @@ namespace bpp
           throw Exception("VectorOfSubstitionRegisters::addRegister : mismatch between state maps");
       
         vSubReg_.push_back(reg);
+        resetTypeMatrix_();
       }
     }
     
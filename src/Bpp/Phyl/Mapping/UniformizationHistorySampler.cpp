@@ -0,0 +1,193 @@
+//
+// File: UniformizationHistorySampler.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "UniformizationHistorySampler.h"
+
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/******************************************************************************/
+
+UniformizationHistorySampler::UniformizationHistorySampler(const SubstitutionModel* model) :
+  alphabet_(model->getAlphabet()),
+  nbStates_(model->getNumberOfStates()),
+  miu_(0),
+  r_(model->getGenerator()),
+  powers_(),
+  powersMutex_()
+{
+  for (size_t i = 0; i < nbStates_; ++i) {
+    double diagQ = abs(r_(i, i));
+    if (diagQ > miu_)
+      miu_ = diagQ;
+  }
+
+  if (miu_ > 10000)
+    throw Exception("UniformizationHistorySampler::UniformizationHistorySampler The maximum diagonal values of generator is above 10000. Abort, chose another sampling method");
+
+  RowMatrix<double> I;
+  MatrixTools::getId(nbStates_, I);
+  if (miu_ > 0)
+    MatrixTools::scale(r_, 1. / miu_);
+  MatrixTools::add(r_, I);
+
+  powers_.push_back(unique_ptr<RowMatrix<double> >(new RowMatrix<double>(I)));
+}
+
+/******************************************************************************/
+
+const RowMatrix<double>& UniformizationHistorySampler::getPower_(size_t n) const
+{
+  lock_guard<mutex> lock(powersMutex_);
+  while (powers_.size() <= n)
+  {
+    unique_ptr<RowMatrix<double> > p(new RowMatrix<double>());
+    MatrixTools::mult(*powers_.back(), r_, *p);
+    powers_.push_back(move(p));
+  }
+  return *powers_[n];
+}
+
+/******************************************************************************/
+
+MutationPath UniformizationHistorySampler::sample(size_t initialState, size_t finalState, double length) const
+{
+  return sample_(initialState, finalState, length, [](){ return RandomTools::giveRandomNumberBetweenZeroAndEntry(1.); });
+}
+
+/******************************************************************************/
+
+MutationPath UniformizationHistorySampler::sample(size_t initialState, size_t finalState, double length, CounterBasedRandomStream& random) const
+{
+  return sample_(initialState, finalState, length, [&random](){ return random.giveRandomNumberBetweenZeroAndEntry(1.); });
+}
+
+/******************************************************************************/
+
+MutationPath UniformizationHistorySampler::sample_(size_t initialState, size_t finalState, double length, const std::function<double()>& random) const
+{
+  MutationPath mp(alphabet_, initialState, length);
+  double lam = miu_ * length;
+
+  // Draw the number of jumps, the Poisson tail being truncated as in
+  // UniformizationSubstitutionCount:
+  size_t nMax = static_cast<size_t>(ceil(4 + 6 * sqrt(lam) + lam));
+  Vdouble weights(nMax + 1);
+  double total = 0;
+  double logPois = -lam;
+  for (size_t n = 0; n <= nMax; ++n)
+  {
+    if (n > 0)
+      logPois += log(lam) - log(static_cast<double>(n));
+    weights[n] = exp(logPois) * getPower_(n)(initialState, finalState);
+    total += weights[n];
+  }
+  if (!(total > 0))
+    throw Exception("UniformizationHistorySampler::sample. State " + TextTools::toString(finalState) + " cannot be reached from state " + TextTools::toString(initialState) + ".");
+
+  double u = random() * total;
+  size_t nbJumps = nMax;
+  double cum = 0;
+  for (size_t n = 0; n <= nMax; ++n)
+  {
+    cum += weights[n];
+    if (u < cum)
+    {
+      nbJumps = n;
+      break;
+    }
+  }
+  if (nbJumps == 0)
+    return mp;
+
+  // Jump times:
+  Vdouble times(nbJumps);
+  for (size_t k = 0; k < nbJumps; ++k)
+  {
+    times[k] = random() * length;
+  }
+  sort(times.begin(), times.end());
+
+  // Jumps, the last one leading to the final state:
+  Vdouble probs(nbStates_);
+  size_t current = initialState;
+  for (size_t k = 1; k <= nbJumps; ++k)
+  {
+    size_t next = finalState;
+    if (k < nbJumps)
+    {
+      const RowMatrix<double>& rest = getPower_(nbJumps - k);
+      double sum = 0;
+      for (size_t s = 0; s < nbStates_; ++s)
+      {
+        probs[s] = r_(current, s) * rest(s, finalState);
+        sum += probs[s];
+      }
+      double v = random() * sum;
+      cum = 0;
+      next = nbStates_ - 1;
+      for (size_t s = 0; s < nbStates_; ++s)
+      {
+        cum += probs[s];
+        if (v < cum)
+        {
+          next = s;
+          break;
+        }
+      }
+    }
+    if (next != current)
+      mp.addEvent(next, times[k - 1]);
+    current = next;
+  }
+
+  return mp;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,141 @@
+//
+// File: UniformizationHistorySampler.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _UNIFORMIZATIONHISTORYSAMPLER_H_
+#define _UNIFORMIZATIONHISTORYSAMPLER_H_
+
+#include "../Model/SubstitutionModel.h"
+#include "../Simulation/MutationProcess.h"
+#include "../Simulation/CounterBasedRandomStream.h"
+
+#include <Bpp/Numeric/Matrix/Matrix.h>
+
+// From the STL:
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Sample substitution histories along a branch, conditioned on
+ * the states at both ends, using the uniformization method.
+ *
+ * With @f$\mu = \max_i -Q_{i,i}@f$ and @f$R = I + Q/\mu@f$, the number
+ * of jumps n of the uniformized chain on a branch of length t is drawn
+ * with probability proportional to
+ * @f$\mathrm{Pois}(n; \mu t) (R^n)_{a,b}@f$, the intermediate states
+ * with probabilities proportional to
+ * @f$R_{s_{k-1},s} (R^{n-k})_{s,b}@f$, and the jump times as ordered
+ * uniform times on [0, t]. Virtual jumps (from a state to itself) are
+ * then dropped. See Hobolth and Stone (2009), Ann Appl Stat 3:1204.
+ *
+ * Powers of R are computed once and cached, so that many histories can
+ * be drawn cheaply, for instance for the states of each site given by
+ * an ancestral reconstruction. The generator is copied at construction:
+ * a new sampler must be built if the model changes.
+ *
+ * The sample() methods can be called concurrently, each thread using
+ * its own CounterBasedRandomStream.
+ *
+ * @author Julien Dutheil
+ */
+class UniformizationHistorySampler
+{
+  private:
+    const Alphabet* alphabet_;
+    size_t nbStates_;
+    double miu_;
+    RowMatrix<double> r_;
+
+    /**
+     * @brief Powers of R, owned by pointers so that references to them
+     * stay valid when more powers are added.
+     */
+    mutable std::vector<std::unique_ptr<RowMatrix<double> > > powers_;
+    mutable std::mutex powersMutex_;
+
+  public:
+    /**
+     * @param model The substitution model, only used during construction.
+     * @throw Exception If the rate of the uniformized chain is above 10000.
+     */
+    UniformizationHistorySampler(const SubstitutionModel* model);
+
+    virtual ~UniformizationHistorySampler() {}
+
+    UniformizationHistorySampler(const UniformizationHistorySampler&) = delete;
+    UniformizationHistorySampler& operator=(const UniformizationHistorySampler&) = delete;
+
+  public:
+    /**
+     * @brief Draw a history, using RandomTools.
+     *
+     * @param initialState The state at the top of the branch.
+     * @param finalState   The state at the bottom of the branch.
+     * @param length       The branch length.
+     * @return The history, with event times counted from the top of the branch, as in MutationProcess::detailedEvolve().
+     * @throw Exception If finalState cannot be reached from initialState.
+     */
+    MutationPath sample(size_t initialState, size_t finalState, double length) const;
+
+    /**
+     * @brief Draw a history, using the given random stream.
+     *
+     * @see sample(size_t, size_t, double)
+     */
+    MutationPath sample(size_t initialState, size_t finalState, double length, CounterBasedRandomStream& random) const;
+
+    double getUniformizationRate() const { return miu_; }
+
+  private:
+    const RowMatrix<double>& getPower_(size_t n) const;
+
+    /**
+     * @param random A function drawing a number uniformly in [0, 1).
+     */
+    MutationPath sample_(size_t initialState, size_t finalState, double length, const std::function<double()>& random) const;
+};
+
+} //end of namespace bpp.
+
+#endif // _UNIFORMIZATIONHISTORYSAMPLER_H_
+
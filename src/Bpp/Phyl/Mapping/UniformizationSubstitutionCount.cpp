@@ -55,6 +55,7 @@ UniformizationSubstitutionCount::UniformizationSubstitutionCount(const Substitut
   model_(model),
   nbStates_(model->getNumberOfStates()),
   bMatrices_(reg->getNumberOfSubstitutionTypes()),
+  r_(),
   power_(),
   s_(reg->getNumberOfSubstitutionTypes()),
   miu_(0),
@@ -89,6 +90,7 @@ void UniformizationSubstitutionCount::resetBMatrices_()
   bMatrices_.resize(nbTypes);
   counts_.resize(nbTypes);
   s_.resize(nbTypes);
+  resetPowers_();
 }
 
 
@@ -104,9 +106,11 @@ void UniformizationSubstitutionCount::initBMatrices_()
 void UniformizationSubstitutionCount::fillBMatrices_()
 {
   vector<int> supportedStates = model_->getAlphabetStates();
+  const vector<size_t>& types = register_->getTypeMatrix();
+  size_t nbTypeStates = register_->getStateMap().getNumberOfModelStates();
   for (size_t j = 0; j < nbStates_; ++j) {
     for (size_t k = 0; k < nbStates_; ++k) {
-      size_t i = register_->getType(j, k);
+      size_t i = types[j * nbTypeStates + k];
       if (i > 0 && k != j) {
         bMatrices_[i - 1](j, k) = model_->Qij(j, k);
       }
@@ -120,9 +124,11 @@ void UniformizationSubstitutionCount::fillBMatrices_()
 void UniformizationSubstitutionCount::setDistanceBMatrices_()
 {
   vector<int> supportedStates = model_->getAlphabetStates();
+  const vector<size_t>& types = register_->getTypeMatrix();
+  size_t nbTypeStates = register_->getStateMap().getNumberOfModelStates();
   for (size_t j = 0; j < nbStates_; ++j) {
     for (size_t k = 0; k < nbStates_; ++k) {
-      size_t i = register_->getType(j, k);
+      size_t i = types[j * nbTypeStates + k];
       if (i > 0 && k != j) {
         bMatrices_[i - 1](j, k) *= distances_->getIndex(supportedStates[j], supportedStates[k]);
       }
@@ -133,42 +139,118 @@ void UniformizationSubstitutionCount::setDistanceBMatrices_()
 
 /******************************************************************************/
 
+void UniformizationSubstitutionCount::resetPowers_() const
+{
+  power_.clear();
+  for (auto& s : s_)
+    s.clear();
+}
+
+size_t UniformizationSubstitutionCount::getTruncationOrder_(double lam)
+{
+  if (lam <= 0)
+    return 0;
+
+  // The weights of the series are P(N = l + 1) / miu, l = 0..nMax,
+  // with N Poisson distributed of parameter lam. The entries of s_l
+  // are at most (l + 1) b, with b the largest row sum of the B
+  // matrix, so that the neglected terms sum to at most
+  // b / miu * sum_{N > nMax + 1} N P(N) = b * length * P(N > nMax).
+  // For n + 2 > lam, the tail P(N > n) is bounded by
+  // P(N = n + 1) / (1 - lam / (n + 2)).
+  const double logEps = log(1e-12);
+  double logLam = log(lam);
+  double logP = -lam;
+  size_t n = 0;
+  while (true)
+  {
+    double logNext = logP + logLam - log(static_cast<double>(n + 1));
+    if (static_cast<double>(n + 2) > lam && logNext - log(1. - lam / static_cast<double>(n + 2)) < logEps)
+      break;
+    logP = logNext;
+    n++;
+  }
+  return n;
+}
+
+void UniformizationSubstitutionCount::multSparse_(const RowMatrix<double>& A, const RowMatrix<double>& B, RowMatrix<double>& O)
+{
+  size_t nr = A.getNumberOfRows();
+  size_t nk = A.getNumberOfColumns();
+  size_t nc = B.getNumberOfColumns();
+  O.resize(nr, nc);
+  for (size_t i = 0; i < nr; i++)
+  {
+    for (size_t j = 0; j < nc; j++)
+      O(i, j) = 0;
+    for (size_t k = 0; k < nk; k++)
+    {
+      double a = A(i, k);
+      if (a == 0)
+        continue;
+      for (size_t j = 0; j < nc; j++)
+        O(i, j) += a * B(k, j);
+    }
+  }
+}
+
+void UniformizationSubstitutionCount::computePowers_(size_t nMax) const
+{
+  if (power_.empty())
+  {
+    RowMatrix<double> I;
+    MatrixTools::getId(nbStates_, I);
+    r_ = model_->getGenerator();
+    MatrixTools::scale(r_, 1. / miu_);
+    MatrixTools::add(r_, I);
+    power_.push_back(I);
+  }
+
+  //compute the powers of R
+  for (size_t i = power_.size(); i < nMax + 1; ++i)
+  {
+    power_.push_back(RowMatrix<double>());
+    MatrixTools::mult(power_[i - 1], r_, power_[i]);
+  }
+
+  RowMatrix<double> tmp(nbStates_, nbStates_);
+  for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i) {
+    vector< RowMatrix<double> >& s_i = s_[i];
+    if (s_i.empty())
+    {
+      s_i.push_back(RowMatrix<double>());
+      multSparse_(bMatrices_[i], power_[0], s_i[0]);
+    }
+    for (size_t l = s_i.size(); l < nMax + 1; ++l) {
+      s_i.push_back(RowMatrix<double>());
+      MatrixTools::mult(r_, s_i[l - 1], s_i[l]);
+      multSparse_(bMatrices_[i], power_[l], tmp);
+      MatrixTools::add(s_i[l], tmp);
+    }
+  }
+}
+
 void UniformizationSubstitutionCount::computeCounts_(double length) const
 {
   double lam = miu_ * length;
-  RowMatrix<double> I;
-  MatrixTools::getId(nbStates_, I);
-  RowMatrix<double> R(model_->getGenerator());
-  MatrixTools::scale(R, 1. / miu_);
-  MatrixTools::add(R, I);
   
-  //compute the stopping point
-  //use the tail of Poisson distribution
-  //can be approximated by 4 + 6 * sqrt(lam) + lam
-  size_t nMax = static_cast<size_t>(ceil(4 + 6 * sqrt(lam) + lam));
+  //compute the stopping point, from the tail of the Poisson
+  //distribution for this length
+  size_t nMax = getTruncationOrder_(lam);
 
-  //compute the powers of R
-  power_.resize(nMax + 1);
-  power_[0] = I;
-  for (size_t i = 1; i < nMax + 1; ++i)
-    MatrixTools::mult(power_[i - 1], R, power_[i]);
+  //the powers already computed for previous lengths are reused
+  computePowers_(nMax);
 
   for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i) {
-    s_[i].resize(nMax + 1);
-    MatrixTools::mult(bMatrices_[i], power_[0], s_[i][0]);
-    RowMatrix<double> tmp(nbStates_, nbStates_);
-    for (size_t l = 1; l < nMax + 1; ++l) {
-      MatrixTools::mult(R, s_[i][l - 1], s_[i][l]);
-      MatrixTools::mult(bMatrices_[i], power_[l], tmp);
-      MatrixTools::add(s_[i][l], tmp);
-    }
     MatrixTools::fill(counts_[i], 0);
     for (size_t l = 0; l < nMax + 1; ++l) {
-      tmp = s_[i][l];
       //double f = (pow(lam, static_cast<double>(l + 1)) * exp(-lam) / static_cast<double>(NumTools::fact(l + 1))) / miu_;
       double logF = static_cast<double>(l + 1) * log(lam) - lam - log(miu_) - NumTools::logFact(static_cast<double>(l + 1));
-      MatrixTools::scale(tmp, exp(logF));
-      MatrixTools::add(counts_[i], tmp);
+      double f = exp(logF);
+      const RowMatrix<double>& s_il = s_[i][l];
+      for (size_t j = 0; j < nbStates_; j++)
+        for (size_t k = 0; k < nbStates_; k++)
+          counts_[i](j, k) += f * s_il(j, k);
     }
   }
 
@@ -261,6 +343,8 @@ void UniformizationSubstitutionCount::setSubstitutionModel(const SubstitutionMod
   if (miu_ > 10000)
     throw Exception("UniformizationSubstitutionCount::setSubstitutionModel(). The maximum diagonal values of generator is above 10000. Abort, chose another mapping method.");
 
+  resetPowers_();
+
   //Recompute counts:
   computeCounts_(currentLength_);
 }
@@ -276,6 +360,7 @@ void UniformizationSubstitutionCount::substitutionRegisterHasChanged()
   resetBMatrices_();
   initBMatrices_();
   fillBMatrices_();
+  resetPowers_();
   
   //Recompute counts:
   if (currentLength_ > 0)
@@ -301,6 +386,7 @@ void UniformizationSubstitutionCount::distancesHaveChanged()
 
   //Recompute counts:
   setDistanceBMatrices_();
+  resetPowers_();
 
   if (currentLength_ > 0)
     computeCounts_(currentLength_);
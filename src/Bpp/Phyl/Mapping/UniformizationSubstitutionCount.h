@@ -65,6 +65,17 @@ namespace bpp
     const SubstitutionModel* model_;
     size_t nbStates_;
     std::vector< RowMatrix<double> > bMatrices_;
+
+    /*
+     * @brief The uniformized matrix R, its powers and the s_ series.
+     *
+     * They do not depend on the length, so that they are shared by
+     * all branches, and only extended when a longer branch needs
+     * higher orders. They are cleared when the model or the B
+     * matrices change.
+     */
+    
+    mutable RowMatrix<double> r_;
     mutable std::vector< RowMatrix<double> > power_;
     mutable std::vector < std::vector< RowMatrix<double> > > s_;
     double miu_;
@@ -81,6 +92,7 @@ namespace bpp
       model_(usc.model_),
       nbStates_(usc.nbStates_),
       bMatrices_(usc.bMatrices_),
+      r_(usc.r_),
       power_(usc.power_),
       s_(usc.s_),
       miu_(usc.miu_),
@@ -96,6 +108,7 @@ namespace bpp
       model_          = usc.model_;
       nbStates_       = usc.nbStates_;
       bMatrices_      = usc.bMatrices_;
+      r_              = usc.r_;
       power_          = usc.power_;
       s_              = usc.s_;
       miu_            = usc.miu_;
@@ -129,6 +142,36 @@ namespace bpp
     void fillBMatrices_();
 
     void setDistanceBMatrices_();
+
+    /**
+     * @brief Compute the powers of R and the s_ series up to order
+     * nMax, keeping those already computed.
+     */
+    
+    void computePowers_(size_t nMax) const;
+
+    void resetPowers_() const;
+
+    /**
+     * @brief The truncation order of the series for a given lambda =
+     * miu * length.
+     *
+     * The neglected part of each count, before its division by the
+     * transition probability, is at most 1e-12 * b * length, where b
+     * is the largest row sum of the B matrix (the largest exit rate
+     * of the counted substitutions, times the distances if any). The
+     * counts themselves, conditioned on the end states, are only
+     * bounded relatively to the probability of these states.
+     */
+    
+    static size_t getTruncationOrder_(double lam);
+
+    /**
+     * @brief Matrix product O = A * B, skipping the null entries of A
+     * (the B matrices are mostly null).
+     */
+    
+    static void multSparse_(const RowMatrix<double>& A, const RowMatrix<double>& B, RowMatrix<double>& O);
   };
 
 } //end of namespace bpp.
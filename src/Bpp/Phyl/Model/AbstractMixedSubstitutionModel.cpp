@@ -193,6 +193,48 @@ const Matrix<double>& AbstractMixedSubstitutionModel::getd2Pij_dt2(double t) con
 }
 
 
+void AbstractMixedSubstitutionModel::computeMixture_(unsigned short order, double t, RowMatrix<double>& matrix) const
+{
+  size_t nbStates = getNumberOfStates();
+  matrix.resize(nbStates, nbStates);
+  for (size_t i = 0; i < nbStates; i++)
+  {
+    for (size_t j = 0; j < nbStates; j++)
+    {
+      matrix(i, j) = 0;
+    }
+  }
+
+  RowMatrix<double> sub;
+  double sP = 0;
+  for (size_t n = 0; n < modelsContainer_.size(); n++)
+  {
+    if (order == 0)
+      modelsContainer_[n]->computePij_t(t, sub);
+    else if (order == 1)
+      modelsContainer_[n]->computedPij_dt(t, sub);
+    else
+      modelsContainer_[n]->computed2Pij_dt2(t, sub);
+    for (size_t i = 0; i < nbStates; i++)
+    {
+      for (size_t j = 0; j < nbStates; j++)
+      {
+        matrix(i, j) += sub(i, j) * vProbas_[n];
+      }
+    }
+    sP += vProbas_[n];
+  }
+
+  for (size_t i = 0; i < nbStates; i++)
+  {
+    for (size_t j = 0; j < nbStates; j++)
+    {
+      matrix(i, j) /= sP;
+    }
+  }
+}
+
+
 void AbstractMixedSubstitutionModel::setRate(double rate)
 {
   AbstractSubstitutionModel::setRate(rate);
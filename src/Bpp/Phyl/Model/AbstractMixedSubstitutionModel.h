@@ -216,6 +216,27 @@ public:
   virtual const Matrix<double>& getPij_t(double t) const;
   virtual const Matrix<double>& getdPij_dt(double t) const;
   virtual const Matrix<double>& getd2Pij_dt2(double t) const;
+
+  /**
+   * @brief Re-entrant versions, which mix the matrices computed by the
+   * re-entrant methods of the submodels.
+   */
+  virtual void computePij_t(double t, RowMatrix<double>& pij) const { computeMixture_(0, t, pij); }
+  virtual void computedPij_dt(double t, RowMatrix<double>& dpij) const { computeMixture_(1, t, dpij); }
+  virtual void computed2Pij_dt2(double t, RowMatrix<double>& d2pij) const { computeMixture_(2, t, d2pij); }
+
+  virtual void computePij_t(const std::vector<double>& vt, const std::vector<RowMatrix<double>*>& vPij) const
+  {
+    for (size_t k = 0; k < vt.size(); k++)
+      computeMixture_(0, vt[k], *vPij[k]);
+  }
+
+private:
+  /**
+   * @brief Compute in matrix the mean of the submodel matrices of the
+   * given order (0: transition probabilities, 1 and 2: derivatives).
+   */
+  void computeMixture_(unsigned short order, double t, RowMatrix<double>& matrix) const;
 };
 } // end of namespace bpp.
 
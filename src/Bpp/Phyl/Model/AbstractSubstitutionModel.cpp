@@ -48,6 +48,13 @@
 // From SeqLib:
 #include <Bpp/Seq/Container/SequenceContainerTools.h>
 
+// From Eigen:
+#include <Eigen/Eigenvalues>
+#include <Eigen/LU>
+
+// From the STL:
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
@@ -75,7 +82,22 @@ AbstractSubstitutionModel::AbstractSubstitutionModel(const Alphabet* alpha, cons
   isNonSingular_(false),
   leftEigenVectors_(size_, size_),
   vPowGen_(),
-  tmpMat_(size_, size_)
+  tmpMat_(size_, size_),
+  usePade_(true),
+  padeWork_(),
+  decomposedGenerator_(),
+  decomposedEigenValues_(),
+  decomposedIEigenValues_(),
+  eigenSystemHint_(0),
+  version_(0),
+  pijtCache_(),
+  pijtCacheSize_(16),
+  pijtCacheVersion_(0),
+  pijtCacheClock_(0),
+  sparseGenerator_(),
+  sparseVersion_(0),
+  sparseReady_(false),
+  uniformization_(false)
 {
   if (computeFrequencies())
     for (auto& fr : freq_)
@@ -87,6 +109,14 @@ AbstractSubstitutionModel::AbstractSubstitutionModel(const Alphabet* alpha, cons
 
 void AbstractSubstitutionModel::updateMatrices()
 {
+  version_++;
+
+  // Rescaled generators share the eigen vectors:
+  if (enableEigenDecomposition() && reuseEigenSystem_())
+  {
+    normalize();
+    return;
+  }
 
   // Compute eigen values and vectors:
   if (enableEigenDecomposition())
@@ -296,6 +326,15 @@ void AbstractSubstitutionModel::updateMatrices()
       isDiagonalizable_ = false;
     }
 
+    if (isNonSingular_)
+    {
+      decomposedGenerator_ = generator_;
+      decomposedEigenValues_ = eigenValues_;
+      decomposedIEigenValues_ = iEigenValues_;
+    }
+    else
+      decomposedGenerator_.resize(0, 0);
+
     if (!isNonSingular_)
     {
       double min = generator_(0, 0);
@@ -334,19 +373,213 @@ void AbstractSubstitutionModel::updateMatrices()
 }
 
 
+/******************************************************************************/
+
+bool AbstractSubstitutionModel::reuseEigenSystem_(const AbstractSubstitutionModel& model)
+{
+  size_t salph = getNumberOfStates();
+  const RowMatrix<double>& ref = model.decomposedGenerator_;
+  if (ref.getNumberOfRows() != salph || ref.getNumberOfColumns() != salph)
+    return false;
+
+  // Look for the ratio on the largest term, and check it on all terms:
+  double maxRef = 0, c = 0;
+  for (size_t i = 0; i < salph; i++)
+    if (abs(ref(i, i)) > maxRef)
+    {
+      maxRef = abs(ref(i, i));
+      c = generator_(i, i) / ref(i, i);
+    }
+
+  if (maxRef == 0 || c <= 0)
+    return false;
+
+  double tol = NumConstants::TINY() * c * maxRef;
+  for (size_t i = 0; i < salph; i++)
+    for (size_t j = 0; j < salph; j++)
+      if (abs(generator_(i, j) - c * ref(i, j)) > tol)
+        return false;
+
+  if (&model != this)
+  {
+    rightEigenVectors_ = model.rightEigenVectors_;
+    leftEigenVectors_ = model.leftEigenVectors_;
+    isDiagonalizable_ = model.isDiagonalizable_;
+    isNonSingular_ = true;
+    decomposedGenerator_ = model.decomposedGenerator_;
+    decomposedEigenValues_ = model.decomposedEigenValues_;
+    decomposedIEigenValues_ = model.decomposedIEigenValues_;
+    if (computeFrequencies())
+      freq_ = model.freq_;
+  }
+
+  eigenValues_ = decomposedEigenValues_ * c;
+  iEigenValues_ = decomposedIEigenValues_ * c;
+  return true;
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::setTransitionMatrixCacheSize(size_t size)
+{
+  pijtCacheSize_ = size;
+  if (pijtCache_.size() > size)
+    pijtCache_.clear();
+}
+
+/******************************************************************************/
+
+bool AbstractSubstitutionModel::getCachedPij_(unsigned short order, double t, RowMatrix<double>& matrix) const
+{
+  if (pijtCacheVersion_ != version_)
+  {
+    pijtCache_.clear();
+    pijtCacheVersion_ = version_;
+    return false;
+  }
+
+  for (auto& cached : pijtCache_)
+  {
+    if (cached.order == order && cached.t == t && cached.rate == rate_)
+    {
+      cached.lastUse = ++pijtCacheClock_;
+      matrix = cached.matrix;
+      return true;
+    }
+  }
+  return false;
+}
+
+void AbstractSubstitutionModel::cachePij_(unsigned short order, double t, const RowMatrix<double>& matrix) const
+{
+  if (pijtCacheSize_ == 0)
+    return;
+
+  CachedPij_* cached;
+  if (pijtCache_.size() < pijtCacheSize_)
+  {
+    pijtCache_.push_back(CachedPij_());
+    cached = &pijtCache_.back();
+  }
+  else
+  {
+    // Replace the least recently used matrix:
+    cached = &pijtCache_[0];
+    for (auto& other : pijtCache_)
+      if (other.lastUse < cached->lastUse)
+        cached = &other;
+  }
+
+  cached->matrix = matrix;
+  cached->order = order;
+  cached->rate = rate_;
+  cached->t = t;
+  cached->lastUse = ++pijtCacheClock_;
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computePadeExponential_(double v, RowMatrix<double>& matrix, Vdouble& work) const
+{
+  static const double b[] = {
+    64764752532480000., 32382376266240000., 7771770303897600., 1187353796428800.,
+    129060195264000., 10559470521600., 670442572800., 33522128640., 1323241920.,
+    40840800., 960960., 16380., 182., 1.
+  };
+  static const double theta13 = 5.371920351148152;
+
+  typedef Eigen::Map<Eigen::MatrixXd> MapMatrix;
+
+  Eigen::Index n = Eigen::Index(size_);
+  size_t n2 = size_ * size_;
+  if (work.size() < 8 * n2)
+    work.resize(8 * n2);
+
+  MapMatrix a(&work[0], n, n);
+  MapMatrix a2(&work[n2], n, n);
+  MapMatrix a4(&work[2 * n2], n, n);
+  MapMatrix a6(&work[3 * n2], n, n);
+  MapMatrix u(&work[4 * n2], n, n);
+  MapMatrix w(&work[5 * n2], n, n);
+  MapMatrix tmp(&work[6 * n2], n, n);
+  MapMatrix f(&work[7 * n2], n, n);
+
+  for (size_t i = 0; i < size_; i++)
+    for (size_t j = 0; j < size_; j++)
+      a(Eigen::Index(i), Eigen::Index(j)) = v * generator_(i, j);
+
+  // Scaling, such that the 1-norm of a is below theta13:
+  double norm = a.cwiseAbs().colwise().sum().maxCoeff();
+  int s = 0;
+  if (norm > theta13)
+  {
+    s = static_cast<int>(ceil(log2(norm / theta13)));
+    a /= ldexp(1., s);
+  }
+
+  a2.noalias() = a * a;
+  a4.noalias() = a2 * a2;
+  a6.noalias() = a4 * a2;
+
+  // Odd part u and even part w of the approximant:
+  tmp = b[13] * a6 + b[11] * a4 + b[9] * a2;
+  w.noalias() = a6 * tmp;
+  w += b[7] * a6 + b[5] * a4 + b[3] * a2;
+  w.diagonal().array() += b[1];
+  u.noalias() = a * w;
+
+  tmp = b[12] * a6 + b[10] * a4 + b[8] * a2;
+  w.noalias() = a6 * tmp;
+  w += b[6] * a6 + b[4] * a4 + b[2] * a2;
+  w.diagonal().array() += b[0];
+
+  // exp(a) ~ (w - u)^-1 (w + u):
+  tmp = w - u;
+  f = w + u;
+  Eigen::PartialPivLU<Eigen::Ref<Eigen::MatrixXd> > lu(tmp);
+  w.noalias() = lu.solve(f);
+
+  // Squaring:
+  MapMatrix* res = &w;
+  MapMatrix* other = &f;
+  for (; s > 0; s--)
+  {
+    other->noalias() = (*res) * (*res);
+    swap(res, other);
+  }
+
+  matrix.resize(size_, size_);
+  for (size_t i = 0; i < size_; i++)
+    for (size_t j = 0; j < size_; j++)
+      matrix(i, j) = (*res)(Eigen::Index(i), Eigen::Index(j));
+}
+
 /******************************************************************************/
 
 const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
 {
+  if (getCachedPij_(0, t, pijt_))
+    return pijt_;
+
+  computePij_t_(t, pijt_, padeWork_);
+  cachePij_(0, t, pijt_);
+  return pijt_;
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computePij_t_(double t, RowMatrix<double>& matrix, Vdouble& work) const
+{
+  RowMatrix<double> tmp;
   if (t ==0)
   {
-    MatrixTools::getId(size_, pijt_);
+    MatrixTools::getId(size_, matrix);
   }
   else if (isNonSingular_)
   {
     if (isDiagonalizable_)
     {
-      MatrixTools::mult<double>(rightEigenVectors_, VectorTools::exp(eigenValues_ * (rate_ * t)), leftEigenVectors_, pijt_);
+      MatrixTools::mult<double>(rightEigenVectors_, VectorTools::exp(eigenValues_ * (rate_ * t)), leftEigenVectors_, matrix);
     }
     else
     {
@@ -377,12 +610,14 @@ const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
           }
         }
       }
-      MatrixTools::mult<double>(rightEigenVectors_, vdia, vup, vlo, leftEigenVectors_, pijt_);
+      MatrixTools::mult<double>(rightEigenVectors_, vdia, vup, vlo, leftEigenVectors_, matrix);
     }
   }
+  else if (usePade_)
+    computePadeExponential_(rate_ * t, matrix, work);
   else
   {
-    MatrixTools::getId(size_, pijt_);
+    MatrixTools::getId(size_, matrix);
     double s = 1.0;
     double v = rate_ * t;
     size_t m = 0;
@@ -394,36 +629,120 @@ const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
     for (size_t i = 1; i < vPowGen_.size(); i++)
     {
       s *= v / static_cast<double>(i);
-      MatrixTools::add(pijt_, s, vPowGen_[i]);
+      MatrixTools::add(matrix, s, vPowGen_[i]);
     }
     while (m > 0)  // recover the 2^m
     {
-      MatrixTools::mult(pijt_, pijt_, tmpMat_);
-      MatrixTools::copy(tmpMat_, pijt_);
+      MatrixTools::mult(matrix, matrix, tmp);
+      MatrixTools::copy(tmp, matrix);
       m--;
     }
   }
-//  MatrixTools::print(pijt_);
 
   // Check to avoid numerical issues
   if (t<= NumConstants::SMALL())
     for (size_t i = 0; i < size_; i++)
       for (size_t j = 0; j < size_; j++)
-        if (pijt_(i,j)<0.)
-          pijt_(i,j)=0.;
+        if (matrix(i,j)<0.)
+          matrix(i,j)=0.;
+}
 
-  return pijt_;
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computePij_t(const std::vector<double>& vt, const std::vector<RowMatrix<double>*>& vPij) const
+{
+  if (!isNonSingular_ || !isDiagonalizable_)
+  {
+    TransitionModel::computePij_t(vt, vPij);
+    return;
+  }
+
+  // Indices of the times to compute, the others being cached or small:
+  vector<size_t> vk;
+  for (size_t k = 0; k < vt.size(); k++)
+  {
+    if (vt[k] <= NumConstants::SMALL())
+      *vPij[k] = getPij_t(vt[k]);
+    else if (!getCachedPij_(0, vt[k], *vPij[k]))
+      vk.push_back(k);
+  }
+
+  size_t nk = vk.size();
+  if (nk == 0)
+    return;
+
+  VVdouble vexp(nk, Vdouble(size_));
+  for (size_t k = 0; k < nk; k++)
+  {
+    double l = rate_ * vt[vk[k]];
+    for (size_t m = 0; m < size_; m++)
+      vexp[k][m] = std::exp(eigenValues_[m] * l);
+
+    RowMatrix<double>& pij = *vPij[vk[k]];
+    pij.resize(size_, size_);
+    for (size_t i = 0; i < size_; i++)
+      std::fill(pij.getRow(i).begin(), pij.getRow(i).end(), 0.);
+  }
+
+  // Pij(t_k) = U^-1 . exp(D.t_k) . U, accumulated row by row of U:
+  for (size_t i = 0; i < size_; i++)
+  {
+    const Vdouble& rRow = rightEigenVectors_.getRow(i);
+    for (size_t m = 0; m < size_; m++)
+    {
+      if (rRow[m] == 0)
+        continue;
+      const Vdouble& lRow = leftEigenVectors_.getRow(m);
+      for (size_t k = 0; k < nk; k++)
+      {
+        double c = rRow[m] * vexp[k][m];
+        Vdouble& pRow = vPij[vk[k]]->getRow(i);
+        for (size_t j = 0; j < size_; j++)
+          pRow[j] += c * lRow[j];
+      }
+    }
+  }
+
+  for (size_t k = 0; k < nk; k++)
+    cachePij_(0, vt[vk[k]], *vPij[vk[k]]);
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::applyPij_t(double t, const Vdouble& v, Vdouble& res) const
+{
+  if (!sparseReady_ || sparseVersion_ != version_)
+  {
+    sparseGenerator_.build(generator_);
+    sparseVersion_ = version_;
+    sparseReady_ = true;
+  }
+
+  sparseGenerator_.applyExponential(rate_ * t, v, res);
 }
 
 /******************************************************************************/
 
 const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
 {
+  if (getCachedPij_(1, t, dpijt_))
+    return dpijt_;
+
+  computedPij_dt_(t, dpijt_, padeWork_);
+  cachePij_(1, t, dpijt_);
+  return dpijt_;
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computedPij_dt_(double t, RowMatrix<double>& matrix, Vdouble& work) const
+{
+  RowMatrix<double> tmp;
   if (isNonSingular_)
   {
     if (isDiagonalizable_)
     {
-      MatrixTools::mult(rightEigenVectors_, rate_ * eigenValues_ * VectorTools::exp(eigenValues_ * (rate_ * t)), leftEigenVectors_, dpijt_);
+      MatrixTools::mult(rightEigenVectors_, rate_ * eigenValues_ * VectorTools::exp(eigenValues_ * (rate_ * t)), leftEigenVectors_, matrix);
     }
     else
     {
@@ -454,47 +773,64 @@ const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
           }
         }
       }
-      MatrixTools::mult<double>(rightEigenVectors_, vdia, vup, vlo, leftEigenVectors_, dpijt_);
+      MatrixTools::mult<double>(rightEigenVectors_, vdia, vup, vlo, leftEigenVectors_, matrix);
     }
   }
   else
   {
-    MatrixTools::getId(size_, dpijt_);
-    double s = 1.0;
-    double v = rate_ * t;
-    size_t m = 0;
-    while (v > 0.5)    // r*A*exp(t*r*A)=r*A*(exp(r*t/(2^m) A))^(2^m)
-    {
-      m += 1;
-      v /= 2;
-    }
-    for (size_t i = 1; i < vPowGen_.size(); i++)
-    {
-      s *= v / static_cast<double>(i);
-      MatrixTools::add(dpijt_, s, vPowGen_[i]);
-    }
-    while (m > 0)  // recover the 2^m
+    if (usePade_)
+      computePadeExponential_(rate_ * t, matrix, work);
+    else
     {
-      MatrixTools::mult(dpijt_, dpijt_, tmpMat_);
-      MatrixTools::copy(tmpMat_, dpijt_);
-      m--;
+      MatrixTools::getId(size_, matrix);
+      double s = 1.0;
+      double v = rate_ * t;
+      size_t m = 0;
+      while (v > 0.5)    // r*A*exp(t*r*A)=r*A*(exp(r*t/(2^m) A))^(2^m)
+      {
+        m += 1;
+        v /= 2;
+      }
+      for (size_t i = 1; i < vPowGen_.size(); i++)
+      {
+        s *= v / static_cast<double>(i);
+        MatrixTools::add(matrix, s, vPowGen_[i]);
+      }
+      while (m > 0)  // recover the 2^m
+      {
+        MatrixTools::mult(matrix, matrix, tmp);
+        MatrixTools::copy(tmp, matrix);
+        m--;
+      }
     }
-    MatrixTools::scale(dpijt_, rate_);
-    MatrixTools::mult(vPowGen_[1], dpijt_, tmpMat_);
-    MatrixTools::copy(tmpMat_, dpijt_);
+    MatrixTools::scale(matrix, rate_);
+    MatrixTools::mult(vPowGen_[1], matrix, tmp);
+    MatrixTools::copy(tmp, matrix);
   }
-  return dpijt_;
 }
 
 /******************************************************************************/
 
 const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
 {
+  if (getCachedPij_(2, t, d2pijt_))
+    return d2pijt_;
+
+  computed2Pij_dt2_(t, d2pijt_, padeWork_);
+  cachePij_(2, t, d2pijt_);
+  return d2pijt_;
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computed2Pij_dt2_(double t, RowMatrix<double>& matrix, Vdouble& work) const
+{
+  RowMatrix<double> tmp;
   if (isNonSingular_)
   {
     if (isDiagonalizable_)
     {
-      MatrixTools::mult(rightEigenVectors_, VectorTools::sqr(rate_ * eigenValues_) * VectorTools::exp(eigenValues_ * (rate_ * t)), leftEigenVectors_, d2pijt_);
+      MatrixTools::mult(rightEigenVectors_, VectorTools::sqr(rate_ * eigenValues_) * VectorTools::exp(eigenValues_ * (rate_ * t)), leftEigenVectors_, matrix);
     }
     else
     {
@@ -529,36 +865,40 @@ const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
           }
         }
       }
-      MatrixTools::mult<double>(rightEigenVectors_, vdia, vup, vlo, leftEigenVectors_, d2pijt_);
+      MatrixTools::mult<double>(rightEigenVectors_, vdia, vup, vlo, leftEigenVectors_, matrix);
     }
   }
   else
   {
-    MatrixTools::getId(size_, d2pijt_);
-    double s = 1.0;
-    double v = rate_ * t;
-    size_t m = 0;
-    while (v > 0.5)    // r^2*A^2*exp(t*r*A)=r^2*A^2*(exp(r*t/(2^m) A))^(2^m)
-    {
-      m += 1;
-      v /= 2;
-    }
-    for (size_t i = 1; i < vPowGen_.size(); i++)
-    {
-      s *= v / static_cast<double>(i);
-      MatrixTools::add(d2pijt_, s, vPowGen_[i]);
-    }
-    while (m > 0)  // recover the 2^m
+    if (usePade_)
+      computePadeExponential_(rate_ * t, matrix, work);
+    else
     {
-      MatrixTools::mult(d2pijt_, d2pijt_, tmpMat_);
-      MatrixTools::copy(tmpMat_, d2pijt_);
-      m--;
+      MatrixTools::getId(size_, matrix);
+      double s = 1.0;
+      double v = rate_ * t;
+      size_t m = 0;
+      while (v > 0.5)    // r^2*A^2*exp(t*r*A)=r^2*A^2*(exp(r*t/(2^m) A))^(2^m)
+      {
+        m += 1;
+        v /= 2;
+      }
+      for (size_t i = 1; i < vPowGen_.size(); i++)
+      {
+        s *= v / static_cast<double>(i);
+        MatrixTools::add(matrix, s, vPowGen_[i]);
+      }
+      while (m > 0)  // recover the 2^m
+      {
+        MatrixTools::mult(matrix, matrix, tmp);
+        MatrixTools::copy(tmp, matrix);
+        m--;
+      }
     }
-    MatrixTools::scale(d2pijt_, rate_ * rate_);
-    MatrixTools::mult(vPowGen_[2], d2pijt_, tmpMat_);
-    MatrixTools::copy(tmpMat_, d2pijt_);
+    MatrixTools::scale(matrix, rate_ * rate_);
+    MatrixTools::mult(vPowGen_[2], matrix, tmp);
+    MatrixTools::copy(tmp, matrix);
   }
-  return d2pijt_;
 }
 
 /******************************************************************************/
@@ -598,6 +938,7 @@ void AbstractSubstitutionModel::setFreq(map<int, double>& freqs)
   {
     freq_[i] = freqs[static_cast<int>(i)];
   }
+  version_++;
   // Re-compute generator and eigen values:
   updateMatrices();
 }
@@ -620,6 +961,7 @@ void AbstractSubstitutionModel::setScale(double scale)
     MatrixTools::scale(generator_, scale);
     eigenValues_ *= scale;
     iEigenValues_ *= scale;
+    version_++;
   }
 }
 
@@ -686,7 +1028,103 @@ void AbstractReversibleSubstitutionModel::updateMatrices()
   setDiagonal();
   normalize();
   
-  AbstractSubstitutionModel::updateMatrices();
+  if (!enableEigenDecomposition() || !updateSymmetricMatrices_())
+    AbstractSubstitutionModel::updateMatrices();
+}
+
+/******************************************************************************/
+
+bool AbstractReversibleSubstitutionModel::updateSymmetricMatrices_()
+{
+  if (reuseEigenSystem_())
+  {
+    version_++;
+    return true;
+  }
+
+  size_t salph = getNumberOfStates();
+
+  // States with a null frequency (such as stop codons) must have null
+  // generator lines and columns. They are put after the others.
+  vector<size_t> vok;
+  vector<size_t> vnull;
+  Vdouble sqrtFreq(salph);
+  for (size_t i = 0; i < salph; i++)
+  {
+    sqrtFreq[i] = sqrt(freq_[i]);
+    if (freq_[i] > 0)
+      vok.push_back(i);
+    else
+    {
+      for (size_t j = 0; j < salph; j++)
+        if (abs(generator_(i, j)) >= NumConstants::TINY() || abs(generator_(j, i)) >= NumConstants::TINY())
+          return false;
+      vnull.push_back(i);
+    }
+  }
+
+  size_t salphok = vok.size();
+  if (salphok == 0)
+    return false;
+
+  Eigen::MatrixXd sym(salphok, salphok);
+  for (size_t i = 0; i < salphok; i++)
+    for (size_t j = 0; j <= i; j++)
+    {
+      size_t ki = vok[i], kj = vok[j];
+      double sij = sqrtFreq[ki] * generator_(ki, kj) / sqrtFreq[kj];
+      double sji = sqrtFreq[kj] * generator_(kj, ki) / sqrtFreq[ki];
+      if (abs(sij - sji) > NumConstants::SMALL() * (abs(sij) + abs(sji)))
+        return false;
+      sym(Eigen::Index(i), Eigen::Index(j)) = sym(Eigen::Index(j), Eigen::Index(i)) = (sij + sji) / 2;
+    }
+
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> es(sym);
+  if (es.info() != Eigen::Success)
+    return false;
+
+  version_++;
+
+  const Eigen::VectorXd& lambda = es.eigenvalues();
+  const Eigen::MatrixXd& v = es.eigenvectors();
+
+  eigenValues_.assign(salph, 0);
+  iEigenValues_.assign(salph, 0);
+  rightEigenVectors_.resize(salph, salph);
+  leftEigenVectors_.resize(salph, salph);
+  for (size_t i = 0; i < salph; i++)
+    for (size_t j = 0; j < salph; j++)
+      rightEigenVectors_(i, j) = leftEigenVectors_(i, j) = 0;
+
+  for (size_t j = 0; j < salphok; j++)
+  {
+    eigenValues_[j] = lambda(Eigen::Index(j));
+    for (size_t i = 0; i < salphok; i++)
+    {
+      double vij = v(Eigen::Index(i), Eigen::Index(j));
+      rightEigenVectors_(vok[i], j) = vij / sqrtFreq[vok[i]];
+      leftEigenVectors_(j, vok[i]) = vij * sqrtFreq[vok[i]];
+    }
+  }
+
+  for (size_t k = 0; k < vnull.size(); k++)
+  {
+    rightEigenVectors_(vnull[k], salphok + k) = 1;
+    leftEigenVectors_(salphok + k, vnull[k]) = 1;
+  }
+
+  // Eigen values are sorted increasingly and are all non positive, so
+  // the last one is the null one: set it exactly to avoid
+  // approximation errors on long branches.
+  eigenValues_[salphok - 1] = 0;
+
+  isDiagonalizable_ = true;
+  isNonSingular_ = true;
+
+  decomposedGenerator_ = generator_;
+  decomposedEigenValues_ = eigenValues_;
+  decomposedIEigenValues_ = iEigenValues_;
+  return true;
 }
 
 /******************************************************************************/
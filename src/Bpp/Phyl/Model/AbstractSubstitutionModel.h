@@ -41,11 +41,13 @@
 #define _ABSTRACTSUBSTITUTIONMODEL_H_
 
 #include "SubstitutionModel.h"
+#include "SparseGenerator.h"
 
 #include <Bpp/Numeric/AbstractParameterAliasable.h>
 #include <Bpp/Numeric/VectorTools.h>
 
 #include <memory>
+#include <vector>
 
 namespace bpp
 {
@@ -187,6 +189,76 @@ namespace bpp
      * @brief For computational issues
      */
     mutable RowMatrix<double> tmpMat_;
+
+    /**
+     * @brief Tell if the Pade approximant is used instead of the
+     * Taylor series when rightEigenVectors_ is singular.
+     */
+    bool usePade_;
+
+    /**
+     * @brief Preallocated workspace of the Pade approximant.
+     */
+    mutable Vdouble padeWork_;
+
+    /**
+     * @brief The generator and the eigen values of the last
+     * non-singular eigen decomposition, before normalization.
+     *
+     * Empty if there is none. They are used to skip the decomposition
+     * of a generator that is only a rescaling of this one.
+     */
+    RowMatrix<double> decomposedGenerator_;
+    Vdouble decomposedEigenValues_;
+    Vdouble decomposedIEigenValues_;
+
+    /**
+     * @brief Another model whose eigen system is tried first (see
+     * shareEigenSystemWith()).
+     */
+    const AbstractSubstitutionModel* eigenSystemHint_;
+
+    /**
+     * @brief Version of the generator, incremented each time the
+     * matrices of the model may have changed.
+     */
+    unsigned int version_;
+
+  private:
+    /**
+     * @brief A transition matrix computed by getPij_t (order 0),
+     * getdPij_dt (order 1) or getd2Pij_dt2 (order 2).
+     */
+    struct CachedPij_
+    {
+      unsigned short order;
+      double rate;
+      double t;
+      RowMatrix<double> matrix;
+      unsigned long lastUse;
+    };
+
+    /**
+     * @brief Bounded LRU cache of the last transition matrices
+     * computed, valid for the generator version pijtCacheVersion_.
+     */
+    mutable std::vector<CachedPij_> pijtCache_;
+    size_t pijtCacheSize_;
+    mutable unsigned int pijtCacheVersion_;
+    mutable unsigned long pijtCacheClock_;
+
+    /**
+     * @brief The generator in compressed sparse row form, built from
+     * generator_ for the version sparseVersion_ of the model.
+     */
+    mutable SparseGenerator sparseGenerator_;
+    mutable unsigned int sparseVersion_;
+    mutable bool sparseReady_;
+
+    /**
+     * @brief Tell if likelihood computations should use applyPij_t().
+     */
+    bool uniformization_;
   
   public:
     AbstractSubstitutionModel(const Alphabet* alpha, const StateMap* stateMap, const std::string& prefix);
@@ -213,7 +285,22 @@ namespace bpp
       isNonSingular_(model.isNonSingular_),
       leftEigenVectors_(model.leftEigenVectors_),
       vPowGen_(model.vPowGen_),
-      tmpMat_(model.tmpMat_)
+      tmpMat_(model.tmpMat_),
+      usePade_(model.usePade_),
+      padeWork_(model.padeWork_),
+      decomposedGenerator_(model.decomposedGenerator_),
+      decomposedEigenValues_(model.decomposedEigenValues_),
+      decomposedIEigenValues_(model.decomposedIEigenValues_),
+      eigenSystemHint_(0),
+      version_(model.version_),
+      pijtCache_(model.pijtCache_),
+      pijtCacheSize_(model.pijtCacheSize_),
+      pijtCacheVersion_(model.pijtCacheVersion_),
+      pijtCacheClock_(model.pijtCacheClock_),
+      sparseGenerator_(model.sparseGenerator_),
+      sparseVersion_(model.sparseVersion_),
+      sparseReady_(model.sparseReady_),
+      uniformization_(model.uniformization_)
     {}
 
     AbstractSubstitutionModel& operator=(const AbstractSubstitutionModel& model)
@@ -240,6 +327,21 @@ namespace bpp
       leftEigenVectors_  = model.leftEigenVectors_;
       vPowGen_           = model.vPowGen_;
       tmpMat_            = model.tmpMat_;
+      usePade_           = model.usePade_;
+      padeWork_          = model.padeWork_;
+      decomposedGenerator_    = model.decomposedGenerator_;
+      decomposedEigenValues_  = model.decomposedEigenValues_;
+      decomposedIEigenValues_ = model.decomposedIEigenValues_;
+      eigenSystemHint_   = 0;
+      version_           = model.version_;
+      pijtCache_         = model.pijtCache_;
+      pijtCacheSize_     = model.pijtCacheSize_;
+      pijtCacheVersion_  = model.pijtCacheVersion_;
+      pijtCacheClock_    = model.pijtCacheClock_;
+      sparseGenerator_   = model.sparseGenerator_;
+      sparseVersion_     = model.sparseVersion_;
+      sparseReady_       = model.sparseReady_;
+      uniformization_    = model.uniformization_;
       return *this;
     }
   
@@ -278,6 +380,60 @@ namespace bpp
     virtual const Matrix<double>& getdPij_dt(double t) const;
     virtual const Matrix<double>& getd2Pij_dt2(double t) const;
 
+    /**
+     * @brief Batched version of getPij_t().
+     *
+     * For diagonalizable models, each row of the left eigen vectors is
+     * used once for all times, instead of once per matrix product.
+     */
+    virtual void computePij_t(const std::vector<double>& vt, const std::vector<RowMatrix<double>*>& vPij) const;
+
+    /**
+     * @brief Re-entrant versions of getPij_t(), getdPij_dt() and
+     * getd2Pij_dt2(): the matrices are computed in local buffers,
+     * without reading nor filling the cache.
+     */
+    virtual void computePij_t(double t, RowMatrix<double>& pij) const
+    {
+      Vdouble work;
+      computePij_t_(t, pij, work);
+    }
+
+    virtual void computedPij_dt(double t, RowMatrix<double>& dpij) const
+    {
+      Vdouble work;
+      computedPij_dt_(t, dpij, work);
+    }
+
+    virtual void computed2Pij_dt2(double t, RowMatrix<double>& d2pij) const
+    {
+      Vdouble work;
+      computed2Pij_dt2_(t, d2pij, work);
+    }
+
+    /**
+     * @brief Compute \f$ \exp(r t Q) v \f$ through a sparse copy of
+     * the generator by uniformization (see
+     * SparseGenerator::applyExponential), without computing the
+     * transition matrix.
+     *
+     * The sparse generator is rebuilt on the first call after a change
+     * of the model.
+     */
+    virtual void applyPij_t(double t, const std::vector<double>& v, std::vector<double>& res) const;
+
+    /**
+     * @brief Tell likelihood computations to propagate vectors through
+     * applyPij_t() instead of computing transition matrices (default:
+     * false).
+     *
+     * This pays for models with many states and a sparse generator,
+     * such as words on many positions.
+     */
+    void enableUniformization(bool yn) { uniformization_ = yn; }
+
+    bool usesUniformization() const { return uniformization_; }
+
     const Vdouble& getEigenValues() const { return eigenValues_; }
 
     const Vdouble& getIEigenValues() const { return iEigenValues_; }
@@ -308,6 +464,51 @@ namespace bpp
 
     bool enableEigenDecomposition() { return eigenDecompose_; }
 
+    /**
+     * @brief Tell if the exponential of the generator is computed with
+     * a degree 13 Pade approximant and scaling and squaring (default),
+     * or with the Taylor series, when the generator cannot be
+     * diagonalized with non-singular eigen vectors.
+     */
+    void enablePadeExponential(bool yn)
+    {
+      usePade_ = yn;
+      version_++;
+    }
+
+    bool enablePadeExponential() const { return usePade_; }
+
+    /**
+     * @brief Tell updateMatrices() to first check if the generator is
+     * a rescaling of the one of another model, in which case its eigen
+     * vectors are copied and its eigen values rescaled, without any
+     * decomposition.
+     *
+     * This is used by mixtures, whose components often differ only by
+     * a scalar. The given model must stay alive while it is used, or be
+     * reset to 0.
+     *
+     * The eigen system of the given model is read without any lock,
+     * in updateMatrices() only: the given model must not be updated
+     * concurrently, as for any other change of parameters. Reading
+     * transition probabilities from several threads is not affected.
+     * The link is not copied with the model.
+     */
+    void shareEigenSystemWith(const AbstractSubstitutionModel* model) { eigenSystemHint_ = model; }
+
+    /**
+     * @brief Set the maximum number of transition matrices kept by
+     * getPij_t, getdPij_dt and getd2Pij_dt2 (default: 16, 0 disables
+     * the cache).
+     *
+     * Computed matrices are cached by rate and branch length, and the
+     * least recently used one is dropped when the cache is full. The
+     * cache is invalidated when the generator changes.
+     */
+    void setTransitionMatrixCacheSize(size_t size);
+
+    size_t getTransitionMatrixCacheSize() const { return pijtCacheSize_; }
+
     /**
      * @brief Tells the model that a parameter value has changed.
      *
@@ -316,6 +517,7 @@ namespace bpp
     virtual void fireParameterChanged(const ParameterList& parameters)
     {
       AbstractParameterAliasable::fireParameterChanged(parameters);
+      version_++;
     
       if (parameters.hasParameter(getNamespace()+"rate"))
       {
@@ -356,6 +558,55 @@ namespace bpp
      */
     virtual void updateMatrices();
 
+  private:
+    /**
+     * @brief Copy in matrix the transition matrix of the given order
+     * at time t if it is in the cache.
+     *
+     * @return true if the matrix was found.
+     */
+    bool getCachedPij_(unsigned short order, double t, RowMatrix<double>& matrix) const;
+
+    /**
+     * @brief Store a copy of matrix in the cache.
+     */
+    void cachePij_(unsigned short order, double t, const RowMatrix<double>& matrix) const;
+
+    /**
+     * @brief Compute \f$\exp(v Q)\f$ in matrix with a degree 13 Pade
+     * approximant and scaling and squaring (Higham, 2005).
+     */
+    void computePadeExponential_(double v, RowMatrix<double>& matrix, Vdouble& work) const;
+
+    /**
+     * @brief Compute the transition matrix (resp. its first and second
+     * order derivatives) at time t in matrix, using work as a buffer
+     * for the Pade approximant. These methods do not modify the model.
+     */
+    void computePij_t_(double t, RowMatrix<double>& matrix, Vdouble& work) const;
+    void computedPij_dt_(double t, RowMatrix<double>& matrix, Vdouble& work) const;
+    void computed2Pij_dt2_(double t, RowMatrix<double>& matrix, Vdouble& work) const;
+
+  protected:
+    /**
+     * @brief Copy the eigen system of the last decomposition of model,
+     * rescaled, if generator_ is a rescaling of its decomposed
+     * generator.
+     *
+     * @return true if the eigen system has been set.
+     */
+    bool reuseEigenSystem_(const AbstractSubstitutionModel& model);
+
+    /**
+     * @brief Try reuseEigenSystem_() with the model given to
+     * shareEigenSystemWith(), then with this model.
+     */
+    bool reuseEigenSystem_()
+    {
+      return (eigenSystemHint_ && eigenSystemHint_ != this && reuseEigenSystem_(*eigenSystemHint_))
+        || reuseEigenSystem_(*this);
+    }
+
     /*
      * @brief : To update the eq freq
      *
@@ -495,6 +746,21 @@ namespace bpp
      */
     virtual void updateMatrices();
 
+  private:
+    /**
+     * @brief Diagonalize the generator through the symmetric matrix
+     * \f$\Pi^{1/2} Q \Pi^{-1/2}\f$.
+     *
+     * If \f$\Pi^{1/2} Q \Pi^{-1/2} = V \Lambda V^T\f$, then
+     * \f$U^{-1} = \Pi^{-1/2} V\f$ and \f$U = V^T \Pi^{1/2}\f$, so no
+     * matrix inversion is needed.
+     *
+     * @return false, leaving the matrices unchanged, if some
+     * frequencies are null or the generator is not reversible with
+     * respect to freq_. The general decomposition must then be used.
+     */
+    bool updateSymmetricMatrices_();
+
   };
 
 } //end of namespace bpp.
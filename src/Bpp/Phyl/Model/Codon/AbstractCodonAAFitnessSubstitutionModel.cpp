@@ -40,6 +40,9 @@
 
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
 
+// From the STL:
+#include <cmath>
+
 using namespace bpp;
 using namespace std;
 
@@ -47,7 +50,7 @@ using namespace std;
 
 AbstractCodonAAFitnessSubstitutionModel::AbstractCodonAAFitnessSubstitutionModel(FrequenciesSet* pfitset, const GeneticCode* pgencode, const string& prefix):
   AbstractParameterAliasable(prefix), pfitset_(pfitset), pgencode_(pgencode), fitName_(""), stateMap_(new CanonicalStateMap(pgencode->getSourceAlphabet(), false)),
-  protStateMap_(&pfitset->getStateMap()), Ns_(1)
+  protStateMap_(&pfitset->getStateMap()), Ns_(1), codonFitnessIndex_(), aaMulRates_()
 {
   if (!AlphabetTools::isProteicAlphabet(pfitset_->getAlphabet()))
     throw Exception("AbstractCodonAAFitnessSubstitutionModel::AbstractCodonAAFitnessSubstitutionModel need Proteic Fitness.");
@@ -56,6 +59,16 @@ AbstractCodonAAFitnessSubstitutionModel::AbstractCodonAAFitnessSubstitutionModel
   pfitset_->setNamespace(prefix + fitName_);
   
   addParameters_(pfitset_->getParameters());
+
+  size_t nbFitnesses = pfitset_->getFrequencies().size();
+  codonFitnessIndex_.resize(stateMap_->getNumberOfModelStates());
+  for (size_t i = 0; i < codonFitnessIndex_.size(); i++)
+  {
+    int codon = stateMap_->getAlphabetStateAsInt(i);
+    codonFitnessIndex_[i] = pgencode_->isStop(codon) ? nbFitnesses : protStateMap_->getModelStates(pgencode_->translate(codon))[0];
+  }
+
+  computeMulRates_();
 }
 
 AbstractCodonAAFitnessSubstitutionModel::~AbstractCodonAAFitnessSubstitutionModel()
@@ -69,41 +82,55 @@ void AbstractCodonAAFitnessSubstitutionModel::fireParameterChanged (const Parame
     Ns_=getParameterValue("Ns");
   
   pfitset_->matchParametersValues(parameters);
+  computeMulRates_();
 }
 
 void AbstractCodonAAFitnessSubstitutionModel::setFreq(map<int, double>& frequencies)
 {
   pfitset_->setFrequenciesFromAlphabetStatesFrequencies(frequencies);
   matchParametersValues(pfitset_->getParameters() );
+  computeMulRates_();
 }
 
-double AbstractCodonAAFitnessSubstitutionModel::getCodonsMulRate(size_t i, size_t j) const
+void AbstractCodonAAFitnessSubstitutionModel::computeMulRates_()
 {
-  double mu;
+  const Vdouble& phi = pfitset_->getFrequencies();
+  size_t n = phi.size();
 
-  int aai = pgencode_->translate(stateMap_->getAlphabetStateAsInt(i));
-  int aaj = pgencode_->translate(stateMap_->getAlphabetStateAsInt(j));
-  
-  double phi_i= pfitset_->getFrequencies() [protStateMap_->getModelStates(aai)[0]];
-  double phi_j= pfitset_->getFrequencies() [protStateMap_->getModelStates(aaj)[0]];
-
-  if (phi_i == phi_j || Ns_==0)
-    mu=1;
-  else if (phi_i==0)
-    mu=100;
-  else if (phi_j==0)
-    mu=0;
-  else
+  // With S = Ns * (log(phi_j) - log(phi_i)), the factor is
+  // S / (1 - exp(-S)), computed once per pair of amino acids:
+  Vdouble logPhi(n);
+  for (size_t i = 0; i < n; i++)
+    logPhi[i] = phi[i] > 0 ? log(phi[i]) : 0;
+
+  aaMulRates_.resize(n * n);
+  for (size_t i = 0; i < n; i++)
   {
-    if (Ns_==1)
-      mu = -(log(phi_i/phi_j)/(1-(phi_i/phi_j)));
-    else
+    double* mu = &aaMulRates_[i * n];
+    for (size_t j = 0; j < n; j++)
     {
-      double x=pow(phi_i/phi_j,Ns_);
-      mu = -log(x)/(1-x);
+      if (phi[i] == phi[j] || Ns_ == 0)
+        mu[j] = 1;
+      else if (phi[i] == 0)
+        mu[j] = 100;
+      else if (phi[j] == 0)
+        mu[j] = 0;
+      else
+      {
+        double S = Ns_ * (logPhi[j] - logPhi[i]);
+        mu[j] = -S / expm1(-S);
+      }
     }
   }
-  
-  return mu;
 }
 
+double AbstractCodonAAFitnessSubstitutionModel::getCodonsMulRate(size_t i, size_t j) const
+{
+  size_t n = pfitset_->getFrequencies().size();
+  size_t aai = codonFitnessIndex_[i];
+  size_t aaj = codonFitnessIndex_[j];
+  if (aai == n || aaj == n)
+    throw Exception("AbstractCodonAAFitnessSubstitutionModel::getCodonsMulRate. Stop codons have no fitness.");
+
+  return aaMulRates_[aai * n + aaj];
+}
@@ -89,6 +89,18 @@ namespace bpp
      */ 
     double Ns_;
 
+    /**
+     * @brief The position in the fitness set of the amino acid of each
+     * codon (the number of fitnesses for stop codons).
+     */
+    std::vector<size_t> codonFitnessIndex_;
+
+    /**
+     * @brief The multiplicative factors of all pairs of amino acids, as
+     * a row-major matrix, computed each time the fitnesses or Ns change.
+     */
+    std::vector<double> aaMulRates_;
+
   public:
     AbstractCodonAAFitnessSubstitutionModel(
       FrequenciesSet* pfitset,
@@ -102,7 +114,9 @@ namespace bpp
       fitName_(model.fitName_),
       stateMap_(model.stateMap_),
       protStateMap_(&pfitset_->getStateMap()),
-      Ns_(1)
+      Ns_(model.Ns_),
+      codonFitnessIndex_(model.codonFitnessIndex_),
+      aaMulRates_(model.aaMulRates_)
     {}
 
     AbstractCodonAAFitnessSubstitutionModel& operator=(const AbstractCodonAAFitnessSubstitutionModel& model){
@@ -112,7 +126,9 @@ namespace bpp
       fitName_ = model.fitName_ ;
       stateMap_ = model.stateMap_;
       protStateMap_ = &pfitset_->getStateMap();
-      Ns_ = 1;
+      Ns_ = model.Ns_;
+      codonFitnessIndex_ = model.codonFitnessIndex_;
+      aaMulRates_ = model.aaMulRates_;
       
       return *this;
     }
@@ -150,6 +166,13 @@ namespace bpp
       addParameter_(new Parameter("Ns", 1, new IntervalConstraint(NumConstants::MILLI(), 100, true, true), true));
     }
 
+  private:
+    /**
+     * @brief Compute the factors of all pairs of amino acids from the
+     * fitnesses and Ns.
+     */
+    void computeMulRates_();
+
 
   };
 } // end of namespace bpp
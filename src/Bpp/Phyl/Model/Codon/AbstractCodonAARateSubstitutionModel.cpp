@@ -55,8 +55,11 @@ AbstractCodonAARateSubstitutionModel::AbstractCodonAARateSubstitutionModel(
   pgencode_(pgencode),
   beta_(19),
   gamma_(1),
-  stateMap_(new CanonicalStateMap(pgencode->getSourceAlphabet(), false))
+  pairTable_(CodonPairTable::getTable(*pgencode)),
+  aaStates_()
 {
+  updateAAStates_();
+
   if (paramSynRate)
     addParameter_(new Parameter(prefix + "gamma", 1, new IntervalConstraint(NumConstants::SMALL(), 999, true, true), true));
 
@@ -80,10 +83,18 @@ void AbstractCodonAARateSubstitutionModel::fireParameterChanged(const ParameterL
 
 double AbstractCodonAARateSubstitutionModel::getCodonsMulRate(size_t i, size_t j) const
 {
-  int si(stateMap_->getAlphabetStateAsInt(i)), sj(stateMap_->getAlphabetStateAsInt(j));
-  
-  return pgencode_->areSynonymous(si,sj) ? gamma_ :
-    beta_ * pAAmodel_->Qij(pAAmodel_->getModelStates(pgencode_->translate(si))[0],
-                           pAAmodel_->getModelStates(pgencode_->translate(sj))[0]);
+  return pairTable_->areSynonymous(i, j) ? gamma_ :
+    beta_ * pAAmodel_->Qij(aaStates_[i], aaStates_[j]);
+}
+
+void AbstractCodonAARateSubstitutionModel::updateAAStates_()
+{
+  size_t n = pairTable_->getNumberOfStates();
+  aaStates_.assign(n, 0);
+  for (size_t i = 0; i < n; i++)
+  {
+    if (!pairTable_->isStop(i))
+      aaStates_[i] = pAAmodel_->getModelStates(pairTable_->getAminoAcid(i))[0];
+  }
 }
 
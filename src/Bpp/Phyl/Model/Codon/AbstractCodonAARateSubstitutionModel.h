@@ -41,6 +41,7 @@
 #define _ABSTRACTCODON_AARATE_SUBSTITUTIONMODEL_H_
 
 #include "CodonSubstitutionModel.h"
+#include "CodonPairTable.h"
 #include "../Protein/ProteinSubstitutionModel.h"
 
 // From bpp-seq:
@@ -80,7 +81,13 @@ namespace bpp
 
     double gamma_;
 
-    std::shared_ptr<StateMap> stateMap_;
+    std::shared_ptr<const CodonPairTable> pairTable_;
+
+    /**
+     * @brief States of pAAmodel_ coding the amino-acids of the codons
+     * (0 for stop codons).
+     */
+    std::vector<size_t> aaStates_;
     
   public:
     /**
@@ -107,7 +114,8 @@ namespace bpp
       pgencode_(model.pgencode_),
       beta_(model.beta_),
       gamma_(model.gamma_),
-      stateMap_(model.stateMap_)
+      pairTable_(model.pairTable_),
+      aaStates_(model.aaStates_)
     {}
 
     AbstractCodonAARateSubstitutionModel& operator=(
@@ -118,7 +126,8 @@ namespace bpp
       pgencode_ = model.pgencode_;
       beta_ = model.beta_;
       gamma_ = model.gamma_;
-      stateMap_ = model.stateMap_;
+      pairTable_ = model.pairTable_;
+      aaStates_ = model.aaStates_;
       
       return *this;
     }
@@ -149,6 +158,7 @@ namespace bpp
     void setAAModel(std::shared_ptr<ProteinSubstitutionModel> model)
     {
       pAAmodel_=model;
+      updateAAStates_();
     }
 
     const std::shared_ptr<ProteinSubstitutionModel>  getAAModel() const
@@ -162,6 +172,9 @@ namespace bpp
     }
 
     void setFreq(std::map<int, double>& frequencies){};
+
+  private:
+    void updateAAStates_();
   };
 
 } // end of namespace bpp.
@@ -56,10 +56,25 @@ AbstractCodonDistanceSubstitutionModel::AbstractCodonDistanceSubstitutionModel(
   alpha_(10000),
   beta_(1),
   gamma_(1),
-  stateMap_(new CanonicalStateMap(pgencode->getSourceAlphabet(), false))
+  pairTable_(CodonPairTable::getTable(*pgencode)),
+  aaDistances_()
 {
   if (pdistance_)
+  {
+    size_t n = pairTable_->getNumberOfStates();
+    aaDistances_.assign(n * n, 0);
+    for (size_t i = 0; i < n; i++)
+    {
+      if (pairTable_->isStop(i))
+        continue;
+      for (size_t j = 0; j < n; j++)
+      {
+        if (!pairTable_->isStop(j) && !pairTable_->areSynonymous(i, j))
+          aaDistances_[i * n + j] = pdistance_->getIndex(pairTable_->getAminoAcid(i), pairTable_->getAminoAcid(j));
+      }
+    }
     addParameter_(new Parameter(prefix + "alpha", 10000, &Parameter::R_PLUS_STAR));
+  }
 
   if (paramSynRate)
     addParameter_(new Parameter(prefix + "gamma", 1, new IntervalConstraint(NumConstants::SMALL(), 999, true, true), true));
@@ -79,11 +94,7 @@ void AbstractCodonDistanceSubstitutionModel::fireParameterChanged(const Paramete
 
 double AbstractCodonDistanceSubstitutionModel::getCodonsMulRate(size_t i, size_t j) const
 {
-  int si(stateMap_->getAlphabetStateAsInt(i)), sj(stateMap_->getAlphabetStateAsInt(j));
-
-  return pgencode_->areSynonymous(si, sj) ? gamma_ :
-    beta_ * (pdistance_ ? exp(-pdistance_->getIndex(
-                                pgencode_->translate(si),
-                                pgencode_->translate(sj)) / alpha_) : 1);
+  return pairTable_->areSynonymous(i, j) ? gamma_ :
+    beta_ * (pdistance_ ? exp(-aaDistances_[i * pairTable_->getNumberOfStates() + j] / alpha_) : 1);
 }
 
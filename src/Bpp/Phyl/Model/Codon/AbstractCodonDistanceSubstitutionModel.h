@@ -41,6 +41,7 @@
 #define _ABSTRACTCODONDISTANCESUBSTITUTIONMODEL_H_
 
 #include "CodonSubstitutionModel.h"
+#include "CodonPairTable.h"
 #include <Bpp/Numeric/AbstractParameterAliasable.h>
 
 
@@ -70,6 +71,10 @@ namespace bpp
  *  multiplied with @f$\gamma@f$ (with optional positive parameter \c
  *  "gamma"), else it is multiplied with 1.
  *
+ * Synonymy of codons is read from the CodonPairTable of the genetic
+ *  code, and the distances between the coded amino-acids are computed
+ *  once at construction.
+ *
  * References:
  * - Goldman N. and Yang Z. (1994), _Molecular Biology And Evolution_ 11(5) 725--736. 
  * - Kosakovsky Pond, S. and Muse, S.V. (2005), _Molecular Biology And Evolution_,
@@ -91,7 +96,13 @@ namespace bpp
 
     double gamma_;
 
-    std::shared_ptr<StateMap> stateMap_;
+    std::shared_ptr<const CodonPairTable> pairTable_;
+
+    /**
+     * @brief Amino-acid distances between the codons, row-major
+     * (empty if no distance is defined).
+     */
+    std::vector<double> aaDistances_;
     
   public:
     /**
@@ -117,7 +128,8 @@ namespace bpp
       alpha_(model.alpha_),
       beta_(model.beta_),
       gamma_(model.gamma_),
-      stateMap_(model.stateMap_)
+      pairTable_(model.pairTable_),
+      aaDistances_(model.aaDistances_)
     {}
 
     AbstractCodonDistanceSubstitutionModel& operator=(
@@ -129,7 +141,8 @@ namespace bpp
       alpha_ = model.alpha_;
       beta_ = model.beta_;
       gamma_ = model.gamma_;
-      stateMap_ = model.stateMap_;
+      pairTable_ = model.pairTable_;
+      aaDistances_ = model.aaDistances_;
       
       return *this;
     }
@@ -37,17 +37,22 @@
 */
 
 # include "AbstractCodonFitnessSubstitutionModel.h"
+
+// From the STL:
+#include <cmath>
+
 using namespace bpp;
 using namespace std;
 /****************************************************************************************/
 AbstractCodonFitnessSubstitutionModel::AbstractCodonFitnessSubstitutionModel(FrequenciesSet* pfitset, const GeneticCode* pgencode, const string& prefix):
-  AbstractParameterAliasable(prefix), pfitset_(pfitset), pgencode_(pgencode), fitName_("")
+  AbstractParameterAliasable(prefix), pfitset_(pfitset), pgencode_(pgencode), fitName_(""), mulRates_()
 {
   if (dynamic_cast<CodonFrequenciesSet*>(pfitset) == NULL)
     throw Exception ("Bad type for fitness parameters"+ pfitset ->getName());
   fitName_="fit_"+ pfitset_->getNamespace();
   pfitset_->setNamespace(prefix + fitName_);
   addParameters_(pfitset_->getParameters());
+  computeMulRates_();
 }
 
 AbstractCodonFitnessSubstitutionModel::~AbstractCodonFitnessSubstitutionModel()
@@ -58,28 +63,45 @@ AbstractCodonFitnessSubstitutionModel::~AbstractCodonFitnessSubstitutionModel()
 void AbstractCodonFitnessSubstitutionModel::fireParameterChanged (const ParameterList& parameters)
 {
   pfitset_->matchParametersValues(parameters);
+  computeMulRates_();
 }
 
 void AbstractCodonFitnessSubstitutionModel::setFreq(map<int, double>& frequencies)
 {
   pfitset_->setFrequenciesFromAlphabetStatesFrequencies(frequencies);
   matchParametersValues(pfitset_->getParameters() );
+  computeMulRates_();
 }
 
-double AbstractCodonFitnessSubstitutionModel::getCodonsMulRate(size_t i, size_t j) const
+void AbstractCodonFitnessSubstitutionModel::computeMulRates_()
 {
-  double mu;
+  const Vdouble& phi = pfitset_->getFrequencies();
+  size_t n = phi.size();
+
+  // The factor of a pair only depends on the difference of the logs
+  // of the fitnesses, S = log(phi_j) - log(phi_i), as S / (1 - exp(-S)):
+  Vdouble logPhi(n);
+  for (size_t i = 0; i < n; i++)
+    logPhi[i] = phi[i] > 0 ? log(phi[i]) : 0;
 
-  double phi_j= pfitset_->getFrequencies() [j];
-  double phi_i= pfitset_->getFrequencies() [i];
-  
-  if (phi_i == phi_j) mu=1;
-  else if (phi_i==0)
-    mu=100;
-  else if (phi_j==0)
-    mu=0;
-  else
-    mu = -(log(phi_i/phi_j)/(1-(phi_i/phi_j)));
-  return mu;
+  mulRates_.resize(n * n);
+  for (size_t i = 0; i < n; i++)
+  {
+    double* mu = &mulRates_[i * n];
+    for (size_t j = 0; j < n; j++)
+    {
+      if (phi[i] == phi[j])
+        mu[j] = 1;
+      else if (phi[i] == 0)
+        mu[j] = 100;
+      else if (phi[j] == 0)
+        mu[j] = 0;
+      else
+      {
+        double S = logPhi[j] - logPhi[i];
+        mu[j] = -S / expm1(-S);
+      }
+    }
+  }
 }
 
@@ -73,6 +73,12 @@ namespace bpp
   
     std::string fitName_;
 
+    /**
+     * @brief The multiplicative factors of all pairs of codons, as a
+     * row-major matrix, computed each time the fitnesses change.
+     */
+    std::vector<double> mulRates_;
+
   public:
     AbstractCodonFitnessSubstitutionModel(
       FrequenciesSet* pfitset,
@@ -83,7 +89,8 @@ namespace bpp
       AbstractParameterAliasable(model),
       pfitset_(model.pfitset_->clone()),
       pgencode_(model.pgencode_),
-      fitName_(model.fitName_)
+      fitName_(model.fitName_),
+      mulRates_(model.mulRates_)
     {}
 
     AbstractCodonFitnessSubstitutionModel& operator=(const AbstractCodonFitnessSubstitutionModel& model){
@@ -92,6 +99,7 @@ namespace bpp
       pfitset_ = model.pfitset_->clone();
       pgencode_ = model.pgencode_;
       fitName_ = model.fitName_ ;
+      mulRates_ = model.mulRates_;
       return *this;
     }
 
@@ -114,7 +122,10 @@ namespace bpp
       pfitset_->setNamespace(prefix + fitName_);
     }
 
-    double getCodonsMulRate(size_t i, size_t j) const;
+    double getCodonsMulRate(size_t i, size_t j) const
+    {
+      return mulRates_[i * pfitset_->getFrequencies().size() + j];
+    }
 
     const FrequenciesSet* getFitness() const { return pfitset_;}
 
@@ -123,6 +134,12 @@ namespace bpp
       return 0;
     }
 
+  private:
+    /**
+     * @brief Compute the factors of all pairs of codons from the
+     * fitnesses.
+     */
+    void computeMulRates_();
   };
 } // end of namespace bpp
 # endif
@@ -176,15 +176,21 @@ void AbstractCodonSubstitutionModel::completeMatrices()
   size_t i, j;
   size_t salph = getNumberOfStates();
 
+  vector<bool> vstop(salph);
+  for (i = 0; i < salph; i++)
+    vstop[i] = gCode_->isStop(getAlphabetStateAsInt(i));
+
+  // Only single position changes are non null, so the codon rates
+  // are computed only for them.
   for (i = 0; i < salph; i++)
   {
     for (j = 0; j < salph; j++)
     {
-      if (gCode_->isStop(getAlphabetStateAsInt(i)) || gCode_->isStop(getAlphabetStateAsInt(j)))
+      if (vstop[i] || vstop[j])
       {
         generator_(i, j) = 0;
       }
-      else
+      else if (generator_(i, j) != 0)
         generator_(i, j) *= getCodonsMulRate(i, j);
     }
   }
@@ -196,15 +196,20 @@ void AbstractKroneckerCodonSubstitutionModel::completeMatrices()
   size_t i, j;
   size_t salph = getNumberOfStates();
 
+  vector<bool> vstop(salph);
+  for (i = 0; i < salph; i++)
+    vstop[i] = gCode_->isStop(static_cast<int>(i));
+
+  // The codon rates are computed only for the allowed changes.
   for (i = 0; i < salph; i++)
   {
     for (j = 0; j < salph; j++)
     {
-      if (gCode_->isStop(static_cast<int>(i)) || gCode_->isStop(static_cast<int>(j)))
+      if (vstop[i] || vstop[j])
       {
         generator_(i, j) = 0;
       }
-      else
+      else if (generator_(i, j) != 0)
         generator_(i, j) *= getCodonsMulRate(i, j);
     }
   }
@@ -0,0 +1,119 @@
+//
+// File: CodonPairTable.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "CodonPairTable.h"
+#include "../StateMap.h"
+
+// From bpp-seq:
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+
+// From the STL:
+#include <map>
+#include <mutex>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+CodonPairTable::CodonPairTable(const GeneticCode& gCode) :
+  nbStates_(0),
+  states_(),
+  aa_(),
+  synonymous_(),
+  changes_()
+{
+  const CodonAlphabet* alphabet = gCode.getSourceAlphabet();
+  CanonicalStateMap stateMap(alphabet, false);
+
+  nbStates_ = stateMap.getNumberOfModelStates();
+  states_.resize(nbStates_);
+  aa_.resize(nbStates_);
+  for (size_t i = 0; i < nbStates_; i++)
+  {
+    states_[i] = stateMap.getAlphabetStateAsInt(i);
+    aa_[i] = gCode.isStop(states_[i]) ? -1 : gCode.translate(states_[i]);
+  }
+
+  synonymous_.assign(nbStates_ * nbStates_, 0);
+  changes_.assign(nbStates_ * nbStates_, 0);
+  for (size_t i = 0; i < nbStates_; i++)
+  {
+    int si = states_[i];
+    for (size_t j = 0; j < nbStates_; j++)
+    {
+      int sj = states_[j];
+      synonymous_[i * nbStates_ + j] = (aa_[i] >= 0 && aa_[i] == aa_[j]) ? 1 : 0;
+      unsigned char c = 0;
+      if (alphabet->getFirstPosition(si) != alphabet->getFirstPosition(sj))
+        c |= 1;
+      if (alphabet->getSecondPosition(si) != alphabet->getSecondPosition(sj))
+        c |= 2;
+      if (alphabet->getThirdPosition(si) != alphabet->getThirdPosition(sj))
+        c |= 4;
+      changes_[i * nbStates_ + j] = c;
+    }
+  }
+}
+
+/******************************************************************************/
+
+shared_ptr<const CodonPairTable> CodonPairTable::getTable(const GeneticCode& gCode)
+{
+  static mutex registryMutex;
+  static map<vector<int>, shared_ptr<const CodonPairTable> > registry;
+
+  // The translation of every codon identifies the code:
+  const CodonAlphabet* alphabet = gCode.getSourceAlphabet();
+  vector<int> signature(alphabet->getSize());
+  for (size_t i = 0; i < signature.size(); i++)
+  {
+    int state = static_cast<int>(i);
+    signature[i] = gCode.isStop(state) ? -1 : gCode.translate(state);
+  }
+
+  lock_guard<mutex> lock(registryMutex);
+  shared_ptr<const CodonPairTable>& table = registry[signature];
+  if (!table)
+    table.reset(new CodonPairTable(gCode));
+  return table;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,132 @@
+//
+// File: CodonPairTable.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _CODONPAIRTABLE_H_
+#define _CODONPAIRTABLE_H_
+
+// From bpp-seq:
+#include <Bpp/Seq/GeneticCode/GeneticCode.h>
+
+// From the STL:
+#include <vector>
+#include <memory>
+
+namespace bpp
+{
+/**
+ * @brief Pairwise codon properties precomputed for a genetic code.
+ *
+ * The table is indexed by model states (the canonical state map of
+ * the codon alphabet, gaps excluded), and stores for each codon its
+ * stop status and coded amino-acid, and for each pair of codons
+ * whether they are synonymous and which positions differ.
+ *
+ * Tables only depend on the genetic code, hence a single instance is
+ * built per distinct code by getTable(), and shared by all codon
+ * models using it.
+ */
+  class CodonPairTable
+  {
+  private:
+    size_t nbStates_;
+
+    /**
+     * @brief Alphabet states of the model states.
+     */
+    std::vector<int> states_;
+
+    /**
+     * @brief Coded amino-acids of the states, -1 for stop codons.
+     */
+    std::vector<int> aa_;
+
+    /**
+     * @brief Synonymy of pairs of non-stop codons, row-major.
+     */
+    std::vector<char> synonymous_;
+
+    /**
+     * @brief Bitmask of the differing positions (bit k for position
+     * k+1), row-major.
+     */
+    std::vector<unsigned char> changes_;
+
+  public:
+    CodonPairTable(const GeneticCode& gCode);
+
+  public:
+    size_t getNumberOfStates() const { return nbStates_; }
+
+    int getAlphabetState(size_t i) const { return states_[i]; }
+
+    bool isStop(size_t i) const { return aa_[i] < 0; }
+
+    /**
+     * @return The coded amino-acid, or -1 if the codon is a stop codon.
+     */
+    int getAminoAcid(size_t i) const { return aa_[i]; }
+
+    bool areSynonymous(size_t i, size_t j) const { return synonymous_[i * nbStates_ + j] != 0; }
+
+    unsigned char getChangedPositions(size_t i, size_t j) const { return changes_[i * nbStates_ + j]; }
+
+    /**
+     * @return The number of positions that differ between two codons.
+     */
+    unsigned int getNumberOfChanges(size_t i, size_t j) const
+    {
+      unsigned char c = changes_[i * nbStates_ + j];
+      return (c & 1u) + ((c >> 1) & 1u) + ((c >> 2) & 1u);
+    }
+
+    /**
+     * @brief Get the table shared by all the models using a given
+     * genetic code.
+     *
+     * Tables are built on first request, and kept for the lifetime of
+     * the program. Two genetic codes translating identically share the
+     * same table. This method is thread-safe.
+     */
+    static std::shared_ptr<const CodonPairTable> getTable(const GeneticCode& gCode);
+  };
+
+} // end of namespace bpp.
+
+#endif // _CODONPAIRTABLE_H_
+
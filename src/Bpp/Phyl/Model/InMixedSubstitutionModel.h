@@ -172,6 +172,27 @@ namespace bpp
 
     const Matrix<double>& getd2Pij_dt2(double t) const { return getModel().getd2Pij_dt2(t); }
 
+    void computePij_t(const std::vector<double>& vt, const std::vector<RowMatrix<double>*>& vPij) const
+    {
+      getModel().computePij_t(vt, vPij);
+    }
+
+    void computePij_t(double t, RowMatrix<double>& pij) const { getModel().computePij_t(t, pij); }
+
+    void computedPij_dt(double t, RowMatrix<double>& dpij) const { getModel().computedPij_dt(t, dpij); }
+
+    void computed2Pij_dt2(double t, RowMatrix<double>& d2pij) const { getModel().computed2Pij_dt2(t, d2pij); }
+
+    void applyPij_t(double t, const std::vector<double>& v, std::vector<double>& res) const
+    {
+      getModel().applyPij_t(t, v, res);
+    }
+
+    bool usesUniformization() const
+    {
+      return getModel().usesUniformization();
+    }
+
     double getInitValue(size_t i, int state) const
     {
       return getModel().getInitValue(i,state);
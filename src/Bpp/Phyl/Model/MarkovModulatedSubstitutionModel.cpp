@@ -71,6 +71,8 @@ MarkovModulatedSubstitutionModel::MarkovModulatedSubstitutionModel(
   dpijt_               (model.dpijt_),
   d2pijt_              (model.d2pijt_),
   freq_                (model.freq_),
+  sparseGenerator_     (model.sparseGenerator_),
+  uniformization_      (model.uniformization_),
   normalizeRateChanges_(model.normalizeRateChanges_),
   nestedPrefix_        (model.nestedPrefix_)
 {}
@@ -99,6 +101,8 @@ MarkovModulatedSubstitutionModel& MarkovModulatedSubstitutionModel::operator=(
   dpijt_                = model.dpijt_;
   d2pijt_               = model.d2pijt_;
   freq_                 = model.freq_;
+  sparseGenerator_      = model.sparseGenerator_;
+  uniformization_       = model.uniformization_;
   normalizeRateChanges_ = model.normalizeRateChanges_;
   nestedPrefix_         = model.nestedPrefix_;
   return *this;
@@ -139,16 +143,31 @@ void MarkovModulatedSubstitutionModel::updateMatrices()
       MatrixTools::scale(exchangeability_, 1. / scale);
   }
 
+  // Built eagerly, so that applyPij_t is read only:
+  sparseGenerator_.build(generator_);
+
   // Compute eigen values and vectors:
   eigenValues_.resize(nbRates_ * nbStates_);
   iEigenValues_.resize(nbRates_ * nbStates_);
   rightEigenVectors_.resize(nbStates_ * nbRates_, nbStates_ * nbRates_);
+  leftEigenVectors_.resize(nbStates_ * nbRates_, nbStates_ * nbRates_);
   pijt_.resize(nbStates_ * nbRates_, nbStates_ * nbRates_);
   dpijt_.resize(nbStates_ * nbRates_, nbStates_ * nbRates_);
   d2pijt_.resize(nbStates_ * nbRates_, nbStates_ * nbRates_);
 
   vector<double>    modelEigenValues       = model_->getEigenValues();
   RowMatrix<double> modelRightEigenVectors = model_->getColumnRightEigenVectors();
+  // The generator is the Kronecker sum of the rate-scaled base generator and
+  // the rate-switching matrix, so its eigen vectors are Kronecker products of
+  // the base ones and of those of a nbRates_ x nbRates_ problem per base eigen
+  // value. If the base model is diagonalizable, the left eigen vectors are
+  // obtained the same way from the inverses of these small matrices, instead
+  // of inverting the full matrix of right eigen vectors.
+  bool structuredInverse = model_->isDiagonalizable();
+  RowMatrix<double> modelLeftEigenVectors;
+  if (structuredInverse)
+    modelLeftEigenVectors = model_->getRowLeftEigenVectors();
+  RowMatrix<double> invVectors;
   for (unsigned int i = 0; i < nbStates_; i++)
   {
     RowMatrix<double> tmp = rates_;
@@ -171,9 +190,28 @@ void MarkovModulatedSubstitutionModel::updateMatrices()
         }
       }
     }
+    if (structuredInverse)
+    {
+      MatrixTools::inv(vectors, invVectors);
+      for (size_t j = 0; j < nbRates_; j++)
+      {
+        size_t c = i * nbRates_ + j;
+        // The cth left eigen vector is the Kronecker product of the jth row
+        // of the inverse and of the ith modelLeftEigenVector.
+        for (unsigned int ii = 0; ii < nbRates_; ii++)
+        {
+          double wii = invVectors(j, ii);
+          for (unsigned int jj = 0; jj < nbStates_; jj++)
+          {
+            leftEigenVectors_(c, ii * nbStates_ + jj) = wii * modelLeftEigenVectors(i, jj);
+          }
+        }
+      }
+    }
   }
-  // Now compute left eigen vectors by inversion:
-  MatrixTools::inv(rightEigenVectors_, leftEigenVectors_);
+  // Otherwise compute left eigen vectors by inversion:
+  if (!structuredInverse)
+    MatrixTools::inv(rightEigenVectors_, leftEigenVectors_);
 }
 
 void MarkovModulatedSubstitutionModel::setDiagonal()
@@ -190,6 +228,7 @@ void MarkovModulatedSubstitutionModel::setDiagonal()
     }
     row[i] = -lambda;
   }
+  sparseGenerator_.build(generator_);
 }
 
 /******************************************************************************/
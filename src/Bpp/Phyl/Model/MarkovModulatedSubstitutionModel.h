@@ -41,6 +41,7 @@
 #define _MARKOVMODULATEDSUBSTITUTIONMODEL_H_
 
 #include "SubstitutionModel.h"
+#include "SparseGenerator.h"
 
 #include <Bpp/Numeric/AbstractParameterAliasable.h>
 #include <Bpp/Numeric/Matrix/MatrixTools.h>
@@ -156,6 +157,17 @@ namespace bpp
      */
     Vdouble freq_;
 
+    /**
+     * @brief The generator in compressed sparse row form, rebuilt
+     * with generator_.
+     */
+    SparseGenerator sparseGenerator_;
+
+    /**
+     * @brief Tell if likelihood computations should use applyPij_t().
+     */
+    bool uniformization_;
+
     bool normalizeRateChanges_;
 
     std::string nestedPrefix_;
@@ -177,7 +189,7 @@ namespace bpp
       nbRates_(nbRates), rates_(nbRates, nbRates), ratesExchangeability_(nbRates, nbRates),
       ratesFreq_(nbRates), ratesGenerator_(nbRates, nbRates), generator_(), exchangeability_(),
       leftEigenVectors_(), rightEigenVectors_(), eigenValues_(), iEigenValues_(), eigenDecompose_(true), compFreq_(false), 
-      pijt_(), dpijt_(), d2pijt_(), freq_(),
+      pijt_(), dpijt_(), d2pijt_(), freq_(), sparseGenerator_(), uniformization_(false),
       normalizeRateChanges_(normalizeRateChanges),
       nestedPrefix_("model_" + model->getNamespace())
     {
@@ -236,6 +248,29 @@ namespace bpp
     double Pij_t    (size_t i, size_t j, double t) const { return getPij_t(t)(i, j); }
     double dPij_dt  (size_t i, size_t j, double t) const { return getdPij_dt(t)(i, j); }
     double d2Pij_dt2(size_t i, size_t j, double t) const { return getd2Pij_dt2(t)(i, j); }
+
+    /**
+     * @brief Compute \f$ \exp(t Q) v \f$ by uniformization (see
+     * SparseGenerator::applyExponential), without computing the
+     * transition matrix.
+     *
+     * The generator of a Markov modulated model is the sum of two
+     * Kronecker products, so that each line has at most
+     * \f$n_{states} + n_{rates} - 1\f$ non-zero terms.
+     */
+    void applyPij_t(double t, const std::vector<double>& v, std::vector<double>& res) const
+    {
+      sparseGenerator_.applyExponential(t, v, res);
+    }
+
+    /**
+     * @brief Tell likelihood computations to propagate vectors through
+     * applyPij_t() instead of computing transition matrices (default:
+     * false).
+     */
+    void enableUniformization(bool yn) { uniformization_ = yn; }
+
+    bool usesUniformization() const { return uniformization_; }
     
     double getInitValue(size_t i, int state) const;
     
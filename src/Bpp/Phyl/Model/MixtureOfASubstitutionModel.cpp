@@ -244,6 +244,16 @@ void MixtureOfASubstitutionModel::updateMatrices()
       j = j / it->second->getNumberOfCategories();
     }
 
+    // A component that is a rescaling of the previous one shares its
+    // eigen system. Components are updated in order by this loop only,
+    // so the previous one has already been updated when it is read.
+    if (i > 0)
+    {
+      AbstractSubstitutionModel* pSM = dynamic_cast<AbstractSubstitutionModel*>(modelsContainer_[i]);
+      if (pSM)
+        pSM->shareEigenSystemWith(dynamic_cast<const AbstractSubstitutionModel*>(modelsContainer_[i - 1]));
+    }
+
     modelsContainer_[i]->matchParametersValues(pl);
   }
 
@@ -60,11 +60,77 @@ using namespace bpp;
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <map>
+#include <mutex>
+#include <memory>
 
 using namespace std;
 
 /******************************************************************************/
 
+namespace
+{
+  /**
+   * @brief Result of a correspondence analysis, shared by all CoalaCore
+   * instances built on the same amino-acid composition.
+   */
+  struct COAResult
+  {
+    RowMatrix<double> P;
+    RowMatrix<double> R;
+    vector<double> colWeights;
+    size_t nbKeptAxes;
+  };
+
+  /*
+   * The cache is keyed on the (flattened) matrix of observed frequencies,
+   * which is all the COA depends on. Its size is bounded, as few distinct
+   * alignments are typically analysed in one run.
+   */
+  const size_t COA_CACHE_MAX_SIZE = 16;
+  map<vector<double>, shared_ptr<const COAResult> > coaCache;
+  mutex coaCacheMutex;
+
+  shared_ptr<const COAResult> getCOAResult(const RowMatrix<double>& freqMatrix)
+  {
+    vector<double> key;
+    key.reserve(freqMatrix.getNumberOfRows() * freqMatrix.getNumberOfColumns());
+    for (size_t i = 0; i < freqMatrix.getNumberOfRows(); i++)
+    {
+      for (size_t j = 0; j < freqMatrix.getNumberOfColumns(); j++)
+      {
+        key.push_back(freqMatrix(i, j));
+      }
+    }
+
+    {
+      lock_guard<mutex> lock(coaCacheMutex);
+      map<vector<double>, shared_ptr<const COAResult> >::const_iterator it = coaCache.find(key);
+      if (it != coaCache.end())
+        return it->second;
+    }
+
+    // The COA analysis:
+    CorrespondenceAnalysis coa(freqMatrix, 19);
+    shared_ptr<COAResult> res(new COAResult());
+    // The transpose of the matrix of principal axes is computed:
+    MatrixTools::transpose(coa.getPrincipalAxes(), res->P);
+    // The matrix of row coordinates is stored:
+    res->R = coa.getRowCoordinates();
+    // The column weights are retrieved:
+    res->colWeights = coa.getColumnWeights();
+    res->nbKeptAxes = coa.getNbOfKeptAxes();
+
+    lock_guard<mutex> lock(coaCacheMutex);
+    if (coaCache.size() >= COA_CACHE_MAX_SIZE)
+      coaCache.clear();
+    coaCache[key] = res;
+    return res;
+  }
+}
+
+/******************************************************************************/
+
 CoalaCore::CoalaCore(size_t nbAxes, const string& exch) :
   init_(true),
   nbrOfAxes_(nbAxes),
@@ -80,6 +146,11 @@ CoalaCore::CoalaCore(size_t nbAxes, const string& exch) :
 ParameterList CoalaCore::computeCOA(const SequencedValuesContainer& data, bool param)
 {
   ParameterList pList;
+  // The summary is computed in a single pass over the data, the COA itself
+  // being shared by all instances built on the same composition (for instance
+  // all the per-branch copies of a non-homogeneous model).
+  const SequenceContainer* sc = dynamic_cast<const SequenceContainer*>(&data);
+  const ProbabilisticSequenceContainer* psc = dynamic_cast<const ProbabilisticSequenceContainer*>(&data);
   // Now we perform the Correspondence Analysis on from the matrix of observed frequencies computed on the alignment, to obtain the matrix of principal axes.
   // First, the matrix of amino acid frequencies is calculated from the alignment:
   vector<string> names = data.getSequencesNames();
@@ -87,9 +158,6 @@ ParameterList CoalaCore::computeCOA(const SequencedValuesContainer& data, bool p
   // Each map is filled with the corresponding frequencies, which are then normalized.
   for (size_t i = 0; i < names.size(); ++i)
   {
-    const SequenceContainer* sc=dynamic_cast<const SequenceContainer*>(&data);
-    const ProbabilisticSequenceContainer* psc=dynamic_cast<const ProbabilisticSequenceContainer*>(&data);
-    
     shared_ptr<CruxSymbolList> seq(sc?
                                    dynamic_cast<CruxSymbolList*>(new BasicSequence(sc->getSequence(names[i]))):
                                    dynamic_cast<CruxSymbolList*>(new BasicProbabilisticSequence(*psc->getSequence(names[i]))));
@@ -140,21 +208,16 @@ ParameterList CoalaCore::computeCOA(const SequencedValuesContainer& data, bool p
     }
   }
 
-  // The COA analysis:
-  CorrespondenceAnalysis* coa = new CorrespondenceAnalysis(freqMatrix, 19);
-  // Matrix of principal axes:
-  RowMatrix<double> ppalAxes = coa->getPrincipalAxes();
-  // The transpose of the matrix of principal axes is computed:
-  MatrixTools::transpose(ppalAxes, P_);
-  // The matrix of row coordinates is stored:
-  R_ = coa->getRowCoordinates();
-  // The column weights are retrieved:
-  colWeights_ = coa->getColumnWeights();
+  // The COA analysis, computed once per composition:
+  shared_ptr<const COAResult> coa = getCOAResult(freqMatrix);
+  P_ = coa->P;
+  R_ = coa->R;
+  colWeights_ = coa->colWeights;
 
   if (param)
   {
     // Parameters are defined:
-    size_t nbAxesConserved = coa->getNbOfKeptAxes();
+    size_t nbAxesConserved = coa->nbKeptAxes;
     if (nbrOfAxes_ > nbAxesConserved)
     {
       ApplicationTools::displayWarning("The specified number of parameters per branch (" + TextTools::toString(nbrOfAxes_) +
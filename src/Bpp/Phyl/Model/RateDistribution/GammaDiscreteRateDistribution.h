@@ -43,19 +43,73 @@
 //From bpp-core
 #include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
 
+// From the STL:
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 namespace bpp {
 
+/**
+ * @brief Gamma distribution of rates, with mean 1.
+ *
+ * Discretizations are cached by value of the shape parameter, so that
+ * line searches and optimizers coming back to a previously evaluated
+ * alpha do not compute the quantiles and incomplete gamma functions
+ * again. Cached categories are those of the exact discretization, so
+ * that results do not depend on the cache.
+ */
 class GammaDiscreteRateDistribution:
   public GammaDiscreteDistribution
 {
+  private:
+    typedef std::pair<decltype(distribution_), std::vector<double> > Discretization;
+
+    /**
+     * @brief Categories and bounds, for each median flag and values of
+     * alpha and beta (which may differ while the alias is updated).
+     */
+    std::map<std::tuple<bool, double, double>, Discretization> discretizations_;
+
+    static const size_t MAX_NUMBER_OF_CACHED_DISCRETIZATIONS = 100;
+
   public:
     GammaDiscreteRateDistribution(size_t nbClasses, double alpha = 1.):
-      GammaDiscreteDistribution(nbClasses, alpha, alpha)
+      GammaDiscreteDistribution(nbClasses, alpha, alpha),
+      discretizations_()
     {
       aliasParameters("alpha", "beta");
     }
 
     GammaDiscreteRateDistribution* clone() const { return new GammaDiscreteRateDistribution(*this); }
+
+  public:
+    void restrictToConstraint(const Constraint& c)
+    {
+      // Bounds of the distribution change:
+      discretizations_.clear();
+      GammaDiscreteDistribution::restrictToConstraint(c);
+    }
+
+  protected:
+    void discretize()
+    {
+      std::tuple<bool, double, double> key(median_, getParameterValue("alpha"), getParameterValue("beta"));
+      std::map<std::tuple<bool, double, double>, Discretization>::const_iterator it = discretizations_.find(key);
+      if (it != discretizations_.end())
+      {
+        distribution_ = it->second.first;
+        bounds_ = it->second.second;
+        return;
+      }
+
+      GammaDiscreteDistribution::discretize();
+
+      if (discretizations_.size() >= MAX_NUMBER_OF_CACHED_DISCRETIZATIONS)
+        discretizations_.clear();
+      discretizations_[key] = Discretization(distribution_, bounds_);
+    }
     
 };
 
@@ -0,0 +1,136 @@
+//
+// File: SparseGenerator.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "SparseGenerator.h"
+
+#include <Bpp/Numeric/NumConstants.h>
+
+// From the STL:
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+void SparseGenerator::build(const Matrix<double>& generator)
+{
+  size_ = generator.getNumberOfRows();
+  rowStarts_.resize(size_ + 1);
+  columns_.clear();
+  values_.clear();
+  maxRate_ = 0;
+
+  for (size_t i = 0; i < size_; i++)
+  {
+    rowStarts_[i] = columns_.size();
+    for (size_t j = 0; j < size_; j++)
+    {
+      double g = generator(i, j);
+      if (g != 0)
+      {
+        columns_.push_back(j);
+        values_.push_back(g);
+      }
+    }
+    if (-generator(i, i) > maxRate_)
+      maxRate_ = -generator(i, i);
+  }
+  rowStarts_[size_] = columns_.size();
+}
+
+/******************************************************************************/
+
+void SparseGenerator::multiply(const vector<double>& v, vector<double>& res) const
+{
+  res.resize(size_);
+  for (size_t i = 0; i < size_; i++)
+  {
+    double s = 0;
+    for (size_t l = rowStarts_[i]; l < rowStarts_[i + 1]; l++)
+      s += values_[l] * v[columns_[l]];
+    res[i] = s;
+  }
+}
+
+/******************************************************************************/
+
+void SparseGenerator::applyExponential(double t, const vector<double>& v, vector<double>& res) const
+{
+  res = v;
+  double lt = maxRate_ * t;
+  if (lt <= 0)
+    return;
+
+  size_t nbSteps = static_cast<size_t>(ceil(lt / 50.));
+  lt /= static_cast<double>(nbSteps);
+
+  // Twice the approximation of the tail of the Poisson distribution
+  // used in UniformizationSubstitutionCount, which alone leaves errors
+  // around 1e-9:
+  size_t nMax = 2 * static_cast<size_t>(ceil(4 + 6 * sqrt(lt) + lt));
+
+  vector<double> term(size_), next(size_);
+  for (size_t step = 0; step < nbSteps; step++)
+  {
+    term.swap(res);
+    double weight = exp(-lt);
+    double cumul = weight;
+    res.resize(size_);
+    for (size_t i = 0; i < size_; i++)
+      res[i] = weight * term[i];
+
+    for (size_t k = 1; k <= nMax && 1 - cumul > NumConstants::TINY(); k++)
+    {
+      // next = (I + Q / lambda) term
+      multiply(term, next);
+      for (size_t i = 0; i < size_; i++)
+        next[i] = term[i] + next[i] / maxRate_;
+      term.swap(next);
+
+      weight *= lt / static_cast<double>(k);
+      cumul += weight;
+      for (size_t i = 0; i < size_; i++)
+        res[i] += weight * term[i];
+    }
+  }
+}
+
+/******************************************************************************/
+
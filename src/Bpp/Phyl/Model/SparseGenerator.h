@@ -0,0 +1,123 @@
+//
+// File: SparseGenerator.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _SPARSEGENERATOR_H_
+#define _SPARSEGENERATOR_H_
+
+#include <Bpp/Numeric/Matrix/Matrix.h>
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief A generator stored in compressed sparse row form, and the
+ * action of its exponential on vectors.
+ *
+ * This is meant for models with many states and few non-zero rates
+ * per row (words, Markov modulated models), for which the
+ * exponential is applied to likelihood vectors without computing the
+ * transition matrix.
+ */
+  class SparseGenerator
+  {
+  private:
+    size_t size_;
+    std::vector<size_t> rowStarts_;
+    std::vector<size_t> columns_;
+    std::vector<double> values_;
+
+    /**
+     * @brief The largest exit rate \f$\max_i |Q_{ii}|\f$.
+     */
+    double maxRate_;
+
+  public:
+    SparseGenerator() :
+      size_(0),
+      rowStarts_(1, 0),
+      columns_(),
+      values_(),
+      maxRate_(0)
+    {}
+
+  public:
+    /**
+     * @brief Copy the non-zero terms of a generator.
+     */
+    void build(const Matrix<double>& generator);
+
+    size_t getSize() const { return size_; }
+
+    size_t getNumberOfNonZeros() const { return values_.size(); }
+
+    double getMaxRate() const { return maxRate_; }
+
+    /**
+     * @brief Compute \f$ Q v \f$.
+     *
+     * @param v The vector, of size getSize().
+     * @param res The result. It must not be v.
+     */
+    void multiply(const std::vector<double>& v, std::vector<double>& res) const;
+
+    /**
+     * @brief Compute \f$ \exp(t Q) v \f$ by uniformization.
+     *
+     * With \f$\lambda = \max_i |Q_{ii}|\f$ and \f$P = I + Q /
+     * \lambda\f$, \f$\exp(t Q) v = \sum_k e^{-\lambda t} (\lambda
+     * t)^k / k! \, P^k v\f$, where each term costs one sparse product.
+     * The series is truncated as soon as the remaining Poisson mass is
+     * negligible, and after at most twice the \f$4 + 6\sqrt{\lambda t}
+     * + \lambda t\f$ terms of UniformizationSubstitutionCount. Long times are
+     * split so that \f$\lambda t \le 50\f$ on each part, which keeps
+     * \f$e^{-\lambda t}\f$ away from underflow.
+     *
+     * @param t The time, including any rate.
+     * @param v The vector, of size getSize().
+     * @param res The result. It must not be v.
+     */
+    void applyExponential(double t, const std::vector<double>& v, std::vector<double>& res) const;
+  };
+
+} // end of namespace bpp.
+
+#endif // _SPARSEGENERATOR_H_
+
@@ -73,3 +73,14 @@ MarkovModulatedStateMap::MarkovModulatedStateMap(const StateMap& unitMap, unsign
   }
 }
 
+const vector<double>& StateIndicatorTable::getIndicators(int code) const
+{
+  map<int, vector<double> >::const_iterator it = indicators_.find(code);
+  if (it != indicators_.end())
+    return it->second;
+  vector<double> indicators(states_.size());
+  for (size_t s = 0; s < states_.size(); ++s) {
+    indicators[s] = alphabet_->isResolvedIn(code, states_[s]) ? 1. : 0.;
+  }
+  return indicators_[code] = indicators;
+}
@@ -48,6 +48,7 @@
 //From the STL:
 #include <vector>
 #include <string>
+#include <map>
 
 namespace bpp
 {
@@ -202,6 +203,38 @@ namespace bpp
     virtual std::string getStateDescription(size_t index) const { return getAlphabetStateAsChar(index) + TextTools::toString(index % nbClasses_); }
   };
 
+  /**
+   * @brief A table of the values of all model states for each alphabet state.
+   *
+   * For an alphabet state code, the value of model state s is 1 if the
+   * alphabet state is resolved in the alphabet state of s, 0 otherwise, as
+   * computed by getStateValueAt for integer-coded containers. Each vector
+   * is computed once, the first time its code is requested, so that
+   * initializing the likelihoods of a leaf is a simple gather, even with
+   * large state spaces and many ambiguous characters.
+   */
+  class StateIndicatorTable
+  {
+  private:
+    const Alphabet* alphabet_;
+    std::vector<int> states_;
+    mutable std::map<int, std::vector<double> > indicators_;
+
+  public:
+    StateIndicatorTable(const StateMap& stateMap):
+      alphabet_(stateMap.getAlphabet()),
+      states_(stateMap.getAlphabetStates()),
+      indicators_()
+    {}
+
+  public:
+    /**
+     * @param code The int code of an alphabet state.
+     * @return The values of all model states for this alphabet state.
+     */
+    const std::vector<double>& getIndicators(int code) const;
+  };
+
 }// end of namespace bpp
 
 #endif //_STATEMAP_H_
@@ -56,8 +56,10 @@
 #include <Bpp/Seq/Container/SequencedValuesContainer.h>
 
 // From the STL:
+#include <cstdint>
 #include <cstdlib>
 #include <map>
+#include <mutex>
 #include <string>
 
 namespace bpp
@@ -242,6 +244,97 @@ namespace bpp
      */
     virtual const Matrix<double>& getd2Pij_dt2(double t) const = 0;
 
+    /**
+     * @brief Compute at once all probabilities of change during
+     * several times, for instance for all the branches of a tree.
+     *
+     * @param vt The times.
+     * @param vPij The matrices to be filled, in the same order as vt.
+     *
+     * The default implementation calls getPij_t() for each time.
+     */
+    virtual void computePij_t(const std::vector<double>& vt, const std::vector<RowMatrix<double>*>& vPij) const
+    {
+      for (size_t k = 0; k < vt.size(); k++)
+        *vPij[k] = getPij_t(vt[k]);
+    }
+
+    /**
+     * @brief Re-entrant versions of getPij_t(), getdPij_dt() and
+     * getd2Pij_dt2(), which fill a matrix given by the caller.
+     *
+     * The get methods return a buffer of the model, which is
+     * overwritten by the next call: threads sharing a model must use
+     * these methods instead. They may be called concurrently as long
+     * as the model is not modified.
+     *
+     * The default implementations copy the result of the get methods
+     * under a lock on the model. Models able to compute the matrices
+     * without their buffers override them.
+     */
+    virtual void computePij_t(double t, RowMatrix<double>& pij) const
+    {
+      std::lock_guard<std::mutex> lock(getComputationMutex_());
+      pij = getPij_t(t);
+    }
+
+    virtual void computedPij_dt(double t, RowMatrix<double>& dpij) const
+    {
+      std::lock_guard<std::mutex> lock(getComputationMutex_());
+      dpij = getdPij_dt(t);
+    }
+
+    virtual void computed2Pij_dt2(double t, RowMatrix<double>& d2pij) const
+    {
+      std::lock_guard<std::mutex> lock(getComputationMutex_());
+      d2pij = getd2Pij_dt2(t);
+    }
+
+  protected:
+    /**
+     * @return The mutex of the default re-entrant methods, picked
+     * in a fixed pool according to the address of the model.
+     */
+    std::mutex& getComputationMutex_() const
+    {
+      static std::mutex mutexes[64];
+      return mutexes[(reinterpret_cast<std::uintptr_t>(this) >> 4) % 64];
+    }
+
+  public:
+
+    /**
+     * @brief Compute the product of the transition matrix during
+     * time t with a vector: \f$ res_i = \sum_j P_{ij}(t) v_j \f$.
+     *
+     * @param t The time.
+     * @param v The vector, of size the number of states.
+     * @param res The result.
+     *
+     * The default implementation uses getPij_t().
+     *
+     * Implementations may build some data lazily on the first call
+     * after a change of the model. Once it has been called (for
+     * instance with t = 0), concurrent calls are safe until the model
+     * changes again.
+     */
+    virtual void applyPij_t(double t, const std::vector<double>& v, std::vector<double>& res) const
+    {
+      const Matrix<double>& pij = getPij_t(t);
+      size_t n = v.size();
+      res.assign(n, 0);
+      for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+          res[i] += pij(i, j) * v[j];
+    }
+
+    /**
+     * @return True if applyPij_t() should be preferred to getPij_t()
+     * to propagate likelihood vectors, because it does not compute the
+     * transition matrix (default: false).
+     */
+    virtual bool usesUniformization() const { return false; }
+
     /**
      * @return Get the alphabet associated to this model.
      */
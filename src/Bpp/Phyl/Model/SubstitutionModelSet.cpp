@@ -55,13 +55,16 @@ SubstitutionModelSet::SubstitutionModelSet(const SubstitutionModelSet& set) :
   nodeToModel_          (set.nodeToModel_),
   modelToNodes_         (set.modelToNodes_),
   modelParameters_      (set.modelParameters_),
-  stationarity_         (set.stationarity_)
+  stationarity_         (set.stationarity_),
+  modelLoopExecutor_    ()
 {
   // Duplicate all model objects:
   for (size_t i = 0; i < set.modelSet_.size(); i++)
     {
       modelSet_[i] = dynamic_cast<TransitionModel*>(set.modelSet_[i]->clone());
     }
+
+  setNumberOfThreads(set.getNumberOfThreads());
 }
 
 SubstitutionModelSet& SubstitutionModelSet::operator=(const SubstitutionModelSet& set)
@@ -84,9 +87,19 @@ SubstitutionModelSet& SubstitutionModelSet::operator=(const SubstitutionModelSet
     {
       modelSet_[i] = dynamic_cast<TransitionModel*>(set.modelSet_[i]->clone());
     }
+
+  setNumberOfThreads(set.getNumberOfThreads());
   return *this;
 }
 
+void SubstitutionModelSet::setNumberOfThreads(size_t nbThreads)
+{
+  if (nbThreads <= 1)
+    modelLoopExecutor_.reset();
+  else if (!modelLoopExecutor_ || modelLoopExecutor_->getNumberOfThreads() != nbThreads)
+    modelLoopExecutor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
 void SubstitutionModelSet::clear()
 {
   resetParameters_();
@@ -242,8 +255,20 @@ void SubstitutionModelSet::fireParameterChanged(const ParameterList& parameters)
         {
           modelParameters_[i][np].setValue(getParameterValue(modelParameters_[i][np].getName()+"_"+TextTools::toString(i+1)));
         }
-      modelSet_[i]->matchParametersValues(modelParameters_[i]);
     }
+
+  // Models only read their own parameters, so that they can be
+  // updated concurrently:
+  std::function<void(size_t, size_t)> loop = [this](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; i++)
+        modelSet_[i]->matchParametersValues(modelParameters_[i]);
+    };
+
+  if (modelLoopExecutor_)
+    modelLoopExecutor_->run(modelParameters_.size(), loop);
+  else
+    loop(0, modelParameters_.size());
 }
 
 bool SubstitutionModelSet::checkOrphanModels(bool throwEx) const
@@ -46,6 +46,7 @@
 #include "SubstitutionModel.h"
 #include "AbstractSubstitutionModel.h"
 #include "FrequenciesSet/FrequenciesSet.h"
+#include "../SiteLoopExecutor.h"
 
 #include <Bpp/Exceptions.h>
 #include <Bpp/Numeric/Random/RandomTools.h>
@@ -141,6 +142,11 @@ private:
 
   bool stationarity_;
 
+  /**
+   * @brief Threads updating the models, null if there is only one thread.
+   */
+  std::unique_ptr<SiteLoopExecutor> modelLoopExecutor_;
+
 public:
   /**
    * @brief Create a model set according to the specified alphabet.
@@ -157,7 +163,8 @@ public:
     nodeToModel_(),
     modelToNodes_(),
     modelParameters_(),
-    stationarity_(true)
+    stationarity_(true),
+    modelLoopExecutor_()
   {
   }
 
@@ -177,7 +184,8 @@ public:
     nodeToModel_(),
     modelToNodes_(),
     modelParameters_(),
-    stationarity_(true)
+    stationarity_(true),
+    modelLoopExecutor_()
   {
     setRootFrequencies(rootFreqs);
   }
@@ -214,6 +222,20 @@ public:
 
   SubstitutionModelSet* clone() const { return new SubstitutionModelSet(*this); }
 
+  /**
+   * @brief Set the number of threads updating the models when
+   * parameters change.
+   *
+   * Models are split into one contiguous block per thread, each model
+   * being updated (generator and diagonalization) by a single thread.
+   * Models of the set must hence not share any mutable object.
+   *
+   * @param nbThreads The number of threads, including the calling one. 1 (the default) means no additional thread.
+   */
+  void setNumberOfThreads(size_t nbThreads);
+
+  size_t getNumberOfThreads() const { return modelLoopExecutor_ ? modelLoopExecutor_->getNumberOfThreads() : 1; }
+
 public:
   /**
    * @brief Get the number of states associated to this model set.
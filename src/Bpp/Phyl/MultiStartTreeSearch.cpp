@@ -0,0 +1,174 @@
+//
+// File: MultiStartTreeSearch.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "MultiStartTreeSearch.h"
+#include "Likelihood/NNIHomogeneousTreeLikelihood.h"
+#include "SiteLoopExecutor.h"
+#include "Tree/NNITopologySearch.h"
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+/******************************************************************************/
+
+/**
+ * @brief Stop a search when it is worse than the best one so far.
+ */
+class MultiStartTreeSearch::Listener_ :
+  public TopologyListener
+{
+private:
+  MultiStartTreeSearch* driver_;
+  NNITopologySearch* topoSearch_;
+
+public:
+  Listener_(MultiStartTreeSearch* driver, NNITopologySearch* ts) :
+    driver_(driver),
+    topoSearch_(ts)
+  {}
+
+  Listener_(const Listener_& l) :
+    driver_(l.driver_),
+    topoSearch_(l.topoSearch_)
+  {}
+
+  Listener_& operator=(const Listener_& l)
+  {
+    driver_     = l.driver_;
+    topoSearch_ = l.topoSearch_;
+    return *this;
+  }
+
+  Listener_* clone() const { return new Listener_(*this); }
+
+  virtual ~Listener_() {}
+
+public:
+  void topologyChangeTested(const TopologyChangeEvent& event) {}
+
+  void topologyChangeSuccessful(const TopologyChangeEvent& event)
+  {
+    if (driver_->isHopeless_(topoSearch_->getSearchableObject()->getTopologyValue()))
+      topoSearch_->stop();
+  }
+};
+
+/******************************************************************************/
+
+vector<MultiStartTreeSearch::Result> MultiStartTreeSearch::search(const vector<const Tree*>& startTrees, size_t nbThreads)
+{
+  size_t nbSearches = startTrees.size();
+  vector<Result> results(nbSearches);
+  bestValue_ = numeric_limits<double>::infinity();
+  if (nbSearches == 0)
+    return results;
+
+  // Searches are dealt in turn to the threads:
+  size_t nbBlocks = max(static_cast<size_t>(1), min(nbThreads, nbSearches));
+  std::function<void(size_t, size_t)> searchBlocks = [&](size_t first, size_t last)
+  {
+    for (size_t b = first; b < last; ++b)
+    {
+      for (size_t i = b; i < nbSearches; i += nbBlocks)
+        results[i] = search_(*startTrees[i]);
+    }
+  };
+
+  if (nbBlocks > 1)
+  {
+    SiteLoopExecutor executor(nbBlocks);
+    executor.run(nbBlocks, searchBlocks);
+  }
+  else
+    searchBlocks(0, 1);
+
+  return results;
+}
+
+/******************************************************************************/
+
+MultiStartTreeSearch::Result MultiStartTreeSearch::search_(const Tree& startTree)
+{
+  unique_ptr<TransitionModel> model(model_->clone());
+  unique_ptr<DiscreteDistribution> rDist(rDist_->clone());
+  unique_ptr<NNIHomogeneousTreeLikelihood> tl(new NNIHomogeneousTreeLikelihood(startTree, *data_, model.get(), rDist.get(), true, false));
+  tl->initialize();
+
+  ParameterList parameters = tl->getParameters();
+  parameters.deleteParameters(parametersToIgnore_, false);
+
+  // Roughly optimize parameters:
+  OptimizationTools::optimizeNumericalParameters2(tl.get(), parameters, 0, tolBefore_, 1000000, 0, 0, false, false, 0, optMethod_);
+
+  Result result;
+  result.abandoned = isHopeless_(tl->getValue());
+  if (!result.abandoned)
+  {
+    NNITopologySearch topoSearch(*tl, nniMethod_, 0);
+    NNITopologyListener2* topoListener = new NNITopologyListener2(&topoSearch, parameters, tolDuring_, 0, 0, 0, optMethod_, false);
+    topoListener->setNumericalOptimizationCounter(numStep_);
+    topoSearch.addTopologyListener(topoListener);
+    topoSearch.addTopologyListener(new Listener_(this, &topoSearch));
+    topoSearch.search();
+    result.abandoned = topoSearch.isStopped();
+  }
+
+  result.tree.reset(tl->getTree().clone());
+  result.logLikelihood = -tl->getValue();
+  isHopeless_(tl->getValue());
+  return result;
+}
+
+/******************************************************************************/
+
+bool MultiStartTreeSearch::isHopeless_(double value)
+{
+  lock_guard<mutex> lock(mutex_);
+  if (value < bestValue_)
+    bestValue_ = value;
+  return value > bestValue_ + abandonThreshold_;
+}
+
+/******************************************************************************/
+
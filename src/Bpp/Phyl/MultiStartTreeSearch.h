@@ -0,0 +1,185 @@
+//
+// File: MultiStartTreeSearch.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _MULTISTARTTREESEARCH_H_
+#define _MULTISTARTTREESEARCH_H_
+
+#include "Tree/Tree.h"
+#include "Model/SubstitutionModel.h"
+#include "OptimizationTools.h"
+
+#include <Bpp/Numeric/Prob/DiscreteDistribution.h>
+#include <Bpp/Seq/Container/AlignedValuesContainer.h>
+
+// From the STL:
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+  /**
+   * @brief Run several NNI tree searches from different start trees,
+   * concurrently.
+   *
+   * Each search builds a NNIHomogeneousTreeLikelihood from a start tree,
+   * the shared alignment and clones of the model and rate distribution
+   * prototypes, then proceeds as OptimizationTools::optimizeTreeNNI2:
+   * numerical parameters are roughly optimized, and NNIs are performed
+   * with numerical parameters optimized every few topological moves.
+   *
+   * Searches may be abandoned: after each topological move, a search
+   * whose minus log-likelihood is worse than the best one reached so far
+   * by any search by more than a given threshold is stopped.
+   *
+   * Searches do not output any message, and do not share any likelihood
+   * object, so that they can run in parallel.
+   */
+  class MultiStartTreeSearch
+  {
+  public:
+    struct Result
+    {
+      std::unique_ptr<Tree> tree;
+      double logLikelihood;
+      bool abandoned;
+
+      Result() : tree(), logLikelihood(0), abandoned(false) {}
+    };
+
+  private:
+    class Listener_;
+
+    const AlignedValuesContainer* data_;
+    const TransitionModel* model_;
+    const DiscreteDistribution* rDist_;
+    std::vector<std::string> parametersToIgnore_;
+    double tolBefore_;
+    double tolDuring_;
+    unsigned int numStep_;
+    std::string optMethod_;
+    std::string nniMethod_;
+    double abandonThreshold_;
+
+    std::mutex mutex_;
+    double bestValue_;
+
+  public:
+    /**
+     * @param data  The alignment, which is not copied and must outlive this object.
+     * @param model The model prototype, cloned by each search.
+     * @param rDist The rate distribution prototype, cloned by each search.
+     */
+    MultiStartTreeSearch(const AlignedValuesContainer& data, const TransitionModel& model, const DiscreteDistribution& rDist) :
+      data_(&data),
+      model_(&model),
+      rDist_(&rDist),
+      parametersToIgnore_(),
+      tolBefore_(100),
+      tolDuring_(100),
+      numStep_(1),
+      optMethod_(OptimizationTools::OPTIMIZATION_NEWTON),
+      nniMethod_(NNITopologySearch::PHYML),
+      abandonThreshold_(std::numeric_limits<double>::infinity()),
+      mutex_(),
+      bestValue_(std::numeric_limits<double>::infinity())
+    {}
+
+    MultiStartTreeSearch(const MultiStartTreeSearch& mss) = delete;
+    MultiStartTreeSearch& operator=(const MultiStartTreeSearch& mss) = delete;
+
+    virtual ~MultiStartTreeSearch() {}
+
+  public:
+    /**
+     * @brief Set the names of the parameters which are not estimated.
+     */
+    void setParametersToIgnore(const std::vector<std::string>& names) { parametersToIgnore_ = names; }
+
+    /**
+     * @brief Set the tolerances of the numerical optimizations before and
+     * during the topology search (see OptimizationTools::optimizeTreeNNI2).
+     */
+    void setTolerances(double tolBefore, double tolDuring)
+    {
+      tolBefore_ = tolBefore;
+      tolDuring_ = tolDuring;
+    }
+
+    /**
+     * @brief Set the number of topological moves between two numerical optimizations.
+     */
+    void setNumericalOptimizationCounter(unsigned int numStep) { numStep_ = numStep; }
+
+    void setOptimizationMethod(const std::string& optMethod) { optMethod_ = optMethod; }
+
+    void setNNIMethod(const std::string& nniMethod) { nniMethod_ = nniMethod; }
+
+    /**
+     * @brief Set the difference in log-likelihood with the best search
+     * above which a search is abandoned (infinity by default, ie never).
+     */
+    void setAbandonThreshold(double threshold) { abandonThreshold_ = threshold; }
+
+    /**
+     * @brief Run one search per start tree.
+     *
+     * @param startTrees The start trees, for instance random or parsimony trees.
+     * @param nbThreads The number of searches running concurrently.
+     * @return The final tree and log-likelihood of each search, in the
+     * order of the start trees.
+     */
+    std::vector<Result> search(const std::vector<const Tree*>& startTrees, size_t nbThreads = 1);
+
+  private:
+    Result search_(const Tree& startTree);
+
+    /**
+     * @brief Record the value of a search, and tell if it should be abandoned.
+     */
+    bool isHopeless_(double value);
+  };
+
+} // end of namespace bpp.
+
+#endif // _MULTISTARTTREESEARCH_H_
+
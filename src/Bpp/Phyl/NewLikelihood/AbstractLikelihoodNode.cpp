@@ -87,6 +87,9 @@ void AbstractLikelihoodNode::setUseLog(bool useLog)
   if (useLog==usesLog())
     return;
 
+  if (useLog && usesScaling())
+    setUseScaling(false);
+
   if (isUp2date(ComputingNode::D0))
   {
     size_t nSites=nodeLikelihoods_.size();
@@ -128,3 +131,27 @@ void AbstractLikelihoodNode::setUseLogDownward(bool useLog)
     static_cast<AbstractLikelihoodNode*>(getSon(i))->setUseLogDownward(useLog);
 }
     
+
+void AbstractLikelihoodNode::setUseScaling(bool useScaling)
+{
+  if (useScaling==usesScaling())
+    return;
+
+  if (useScaling && usesLog())
+    setUseLog(false);
+
+  // Stored values do not follow the new convention.
+  update(false, ComputingNode::D0);
+  likelihoodScales_.clear();
+  usesScaling_=useScaling;
+}
+
+
+void AbstractLikelihoodNode::setUseScalingDownward(bool useScaling)
+{
+  setUseScaling(useScaling);
+
+  size_t nS=getNumberOfSons();
+  for (size_t i=0; i<nS; i++)
+    static_cast<AbstractLikelihoodNode*>(getSon(i))->setUseScalingDownward(useScaling);
+}
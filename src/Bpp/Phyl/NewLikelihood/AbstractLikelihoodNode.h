@@ -64,6 +64,12 @@ namespace bpp
  * We call this the <i>likelihood array</i> for each node.
  * In the same way, we store first and second order derivatives.
  *
+ * The arrays are always in double precision: they are returned by
+ * reference as VVdouble by the likelihood trees, and read as such by
+ * the mapping and ancestral state tools. Single precision storage is
+ * only available in the data flow engine (see
+ * SingleExtendedFloatMatrix in NewPhyl/DataFlowExtendedFloat.h).
+ *
  * @see AbstractLikelihoodTree
  */
   
@@ -107,6 +113,18 @@ namespace bpp
      */
 
     bool usesLog_;
+
+    /* @brief says if the likelihood arrays are rescaled by powers of
+     * 2 to avoid underflows, instead of using log (see
+     * RecursiveLikelihoodNode).
+     *
+     * If so, the likelihoods and their derivatives at site i are the
+     * stored values times 2^likelihoodScales_[i].
+     *
+     */
+
+    bool usesScaling_;
+    std::vector<int> likelihoodScales_;
        
   public:
     AbstractLikelihoodNode() :
@@ -118,7 +136,9 @@ namespace bpp
       up2dateD_(false),
       up2dateD2_(false),
       vPatt_(),
-      usesLog_(false)
+      usesLog_(false),
+      usesScaling_(false),
+      likelihoodScales_()
     {}
 
     AbstractLikelihoodNode(const PhyloNode& np) :
@@ -130,7 +150,9 @@ namespace bpp
       up2dateD_(false),
       up2dateD2_(false),
       vPatt_(),
-      usesLog_(false)
+      usesLog_(false),
+      usesScaling_(false),
+      likelihoodScales_()
     {}
 
     AbstractLikelihoodNode(const AbstractLikelihoodNode& data) :
@@ -142,7 +164,9 @@ namespace bpp
       up2dateD_(data.up2dateD_),
       up2dateD2_(data.up2dateD2_),
       vPatt_(data.vPatt_),
-      usesLog_(data.usesLog_)
+      usesLog_(data.usesLog_),
+      usesScaling_(data.usesScaling_),
+      likelihoodScales_(data.likelihoodScales_)
     {}
     
     AbstractLikelihoodNode& operator=(const AbstractLikelihoodNode& data)
@@ -159,6 +183,8 @@ namespace bpp
 
       vPatt_ = data.vPatt_;
       usesLog_ = data.usesLog_;
+      usesScaling_ = data.usesScaling_;
+      likelihoodScales_ = data.likelihoodScales_;
 
       return *this;
     }
@@ -179,6 +205,35 @@ namespace bpp
 
     void setUseLogDownward(bool useLog);
 
+    bool usesScaling() const
+    {
+      return usesScaling_;
+    }
+
+    /*
+     * @brief Set if likelihood arrays are rescaled to avoid
+     * underflows. Scaling and log are exclusive: log is switched off
+     * when scaling is switched on (and conversely). The likelihood
+     * arrays have to be computed again.
+     *
+     */
+    
+    virtual void setUseScaling(bool useScaling);
+
+    void setUseScalingDownward(bool useScaling);
+
+    /*
+     * @brief The binary exponent of the likelihoods at a site: the
+     * likelihoods (and their derivatives) are the stored values times
+     * 2^exponent. Always 0 without scaling.
+     *
+     */
+
+    int getLikelihoodScale(size_t nSite) const
+    {
+      return likelihoodScales_.empty() ? 0 : likelihoodScales_[nSite];
+    }
+
     /**
      * @brief Several Likelihood Arrays
      *
@@ -210,7 +265,7 @@ namespace bpp
       }
     }
     
-    bool isUp2date(unsigned char DX) const
+    virtual bool isUp2date(unsigned char DX) const
     {
       switch(DX){
       case ComputingNode::D0:
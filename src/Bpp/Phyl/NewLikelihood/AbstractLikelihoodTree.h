@@ -44,6 +44,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "AbstractLikelihoodNode.h"
 #include "LikelihoodTree.h"
+#include "../Likelihood/MemoryUsage.h"
 
 namespace bpp
 {
@@ -204,6 +205,18 @@ public:
 
     size_t getNumberOfClasses() const { return nbClasses_; }
 
+    /*
+     * @brief Add the memory held by the likelihood arrays to a usage
+     * report.
+     *
+     */
+
+    virtual void getMemoryUsage(MemoryUsage& usage) const
+    {
+      usage.add(MemoryUsage::OTHER, MemoryUsage::getHeapBytes(rootPatternLinks_)
+          + MemoryUsage::getHeapBytes(rootWeights_) + MemoryUsage::getHeapBytes(vProbClass_));
+    }
+
     /*
      * @brief the Node Data
      *
@@ -262,6 +275,38 @@ public:
       for (size_t i=0; i<nbClasses_;i++)
         getRootData(i).setUseLogDownward(useLog);
     }
+
+    /**
+     * @brief returns if root at given class uses scaling in arrays.
+     *
+     */
+    
+    bool usesScalingAtRoot(size_t nClass) const
+    {
+      return getRootData(nClass).usesScaling();
+    }
+
+    /**
+     * @brief returns the binary exponent of the likelihoods of a
+     * site at root for given class (0 without scaling).
+     *
+     */
+    
+    int getLikelihoodScaleAtRoot(size_t nClass, size_t nSite) const
+    {
+      return getRootData(nClass).getLikelihoodScale(nSite);
+    }
+
+    /**
+     * @brief sets using scaling in all likelihood arrays.
+     *
+     */
+    
+    void setAllUseScaling(bool useScaling)
+    {
+      for (size_t i=0; i<nbClasses_;i++)
+        getRootData(i).setUseScalingDownward(useScaling);
+    }
     
 
     /**
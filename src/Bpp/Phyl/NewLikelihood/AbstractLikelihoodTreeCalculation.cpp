@@ -40,19 +40,61 @@
 #include "AbstractLikelihoodTreeCalculation.h"
 #include "../PatternTools.h"
 
+#include <Bpp/Exceptions.h>
+
 using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+#include <cmath>
+
 using namespace std;
 
 /******************************************************************************/
 
 void AbstractLikelihoodTreeCalculation::setData(const AlignedValuesContainer& sites)
 {
-  data_.reset(PatternTools::getSequenceSubset(sites, process_->getParametrizablePhyloTree().getRoot(), process_->getParametrizablePhyloTree())) ;
+  setData_(shared_ptr<const AlignedValuesContainer>(PatternTools::getSequenceSubset(sites, process_->getParametrizablePhyloTree().getRoot(), process_->getParametrizablePhyloTree())), 0);
+}
+
+/******************************************************************************/
+
+void AbstractLikelihoodTreeCalculation::setData(const AlignedValuesContainer& sites, const LikelihoodTreeCalculation& shared)
+{
+  const AbstractLikelihoodTreeCalculation* aShared = dynamic_cast<const AbstractLikelihoodTreeCalculation*>(&shared);
+  if (!aShared || !aShared->data_)
+  {
+    setData(sites);
+    return;
+  }
+
+  // The data subset only depends on the names of the leaves.
+  vector<string> leaves;
+  for (const auto& leaf : process_->getParametrizablePhyloTree().getAllLeaves())
+    leaves.push_back(leaf->getName());
+  vector<string> names = aShared->data_->getSequencesNames();
+  sort(leaves.begin(), leaves.end());
+  sort(names.begin(), names.end());
+
+  if (leaves == names)
+    setData_(aShared->data_, &aShared->getLikelihoodData());
+  else
+    setData(sites);
+}
+
+/******************************************************************************/
+
+void AbstractLikelihoodTreeCalculation::setData_(shared_ptr<const AlignedValuesContainer> data, const LikelihoodTree* shared)
+{
+  data_ = data;
 
   if (verbose_)
     ApplicationTools::displayTask("Initializing data structure");
 
-  getLikelihoodData().initLikelihoods(*data_, *process_);
+  if (shared)
+    getLikelihoodData().initLikelihoods(*data_, *process_, *shared);
+  else
+    getLikelihoodData().initLikelihoods(*data_, *process_);
 
 // We assume here that all models have the same number of states, and
 // that they have the same 'init' method, which is a reasonable
@@ -70,6 +112,17 @@ void AbstractLikelihoodTreeCalculation::setData(const AlignedValuesContainer& si
 
   initialized_ = true;
   vSites_.resize(nbSites_);
+  patternWeights_.clear();
+}
+
+/******************************************************************************/
+
+void AbstractLikelihoodTreeCalculation::setPatternWeights(const std::vector<double>& weights)
+{
+  if (weights.size() != 0 && weights.size() != nbDistinctSites_)
+    throw BadSizeException("AbstractLikelihoodTreeCalculation::setPatternWeights. One weight per distinct pattern is needed.", weights.size(), nbDistinctSites_);
+  patternWeights_ = weights;
+  vSites_.resize(weights.size() == 0 ? nbSites_ : nbDistinctSites_);
 }
 
 
@@ -77,13 +130,22 @@ void AbstractLikelihoodTreeCalculation::setData(const AlignedValuesContainer& si
 
 double AbstractLikelihoodTreeCalculation::getLogLikelihood()
 {
-  for (size_t i = 0; i < nbSites_; ++i){
-    vSites_[i] = getLogLikelihoodForASite(i);
+  if (patternWeights_.size() != 0)
+  {
+    // Patterns with a null weight are skipped, their likelihood may be 0.
+    for (size_t i = 0; i < nbDistinctSites_; ++i)
+      vSites_[i] = (patternWeights_[i] == 0) ? 0 : patternWeights_[i] * getLogLikelihoodForASiteIndex(i);
+  }
+  else
+  {
+    for (size_t i = 0; i < nbSites_; ++i){
+      vSites_[i] = getLogLikelihoodForASite(i);
+    }
   }
   
   sort(vSites_.begin(), vSites_.end());
   double ll = 0;
-  for (size_t i = nbSites_; i > 0; i--)
+  for (size_t i = vSites_.size(); i > 0; i--)
   {
     ll += vSites_[i - 1];
   }
@@ -97,12 +159,20 @@ double AbstractLikelihoodTreeCalculation::getDLogLikelihood()
 {
   // Derivative of the sum is the sum of derivatives:
 
-  for (size_t i = 0; i < nbSites_; ++i)
-    vSites_[i] = getDLogLikelihoodForASite(i);
+  if (patternWeights_.size() != 0)
+  {
+    for (size_t i = 0; i < nbDistinctSites_; ++i)
+      vSites_[i] = (patternWeights_[i] == 0) ? 0 : patternWeights_[i] * getDLogLikelihoodForASiteIndex(i);
+  }
+  else
+  {
+    for (size_t i = 0; i < nbSites_; ++i)
+      vSites_[i] = getDLogLikelihoodForASite(i);
+  }
   
   sort(vSites_.begin(), vSites_.end());
   double dl = 0;
-  for (size_t i = nbSites_; i > 0; --i)
+  for (size_t i = vSites_.size(); i > 0; --i)
   {
     dl += vSites_[i - 1];
   }
@@ -116,9 +186,20 @@ double AbstractLikelihoodTreeCalculation::getD2LogLikelihood()
 {
   // Derivative of the sum is the sum of derivatives:
   double dl = 0;
-  for (size_t i = 0; i < nbSites_; ++i)
+  if (patternWeights_.size() != 0)
   {
-    dl += getD2LogLikelihoodForASite(i);
+    for (size_t i = 0; i < nbDistinctSites_; ++i)
+    {
+      if (patternWeights_[i] != 0)
+        dl += patternWeights_[i] * getD2LogLikelihoodForASiteIndex(i);
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i < nbSites_; ++i)
+    {
+      dl += getD2LogLikelihoodForASite(i);
+    }
   }
 
   return dl;
@@ -132,6 +213,12 @@ double AbstractLikelihoodTreeCalculation::getLikelihoodForASiteIndex(size_t site
   if (usesLogAtRoot(0))
     return exp(getLogLikelihoodForASiteIndex(siteindex));
 
+  if (usesScalingAtRoot(0))
+  {
+    int scale = getMaxScaleForASiteIndex_(siteindex);
+    return ldexp(getScaledSumForASiteIndex_(siteindex, ComputingNode::D0, scale), scale);
+  }
+
   double l = 0;
   
   int Rid=getRootId();
@@ -158,6 +245,12 @@ double AbstractLikelihoodTreeCalculation::getLikelihoodForASiteIndex(size_t site
 
 double AbstractLikelihoodTreeCalculation::getLogLikelihoodForASiteIndex(size_t siteindex) const
 {
+  if (usesScalingAtRoot(0))
+  {
+    int scale = getMaxScaleForASiteIndex_(siteindex);
+    return log(getScaledSumForASiteIndex_(siteindex, ComputingNode::D0, scale)) + scale * log(2.);
+  }
+
   if (!usesLogAtRoot(0))
     return log(getLikelihoodForASiteIndex(siteindex));
 
@@ -184,7 +277,9 @@ double AbstractLikelihoodTreeCalculation::getLikelihoodForASiteIndexForAClass(si
 {
   const Vdouble& la = getLikelihoodData().getLikelihoodArray(getRootId(),classIndex, ComputingNode::D0)[siteindex];
 
-  if (!usesLogAtRoot(classIndex))
+  if (usesScalingAtRoot(classIndex))
+    return ldexp(VectorTools::sum(la), getLikelihoodData().getLikelihoodScaleAtRoot(classIndex, siteindex));
+  else if (!usesLogAtRoot(classIndex))
     return VectorTools::sum(la);
   else
     return VectorTools::sumExp(la);
@@ -196,7 +291,9 @@ double AbstractLikelihoodTreeCalculation::getLogLikelihoodForASiteIndexForAClass
 {
   const Vdouble& la = getLikelihoodData().getLikelihoodArray(getRootId(),classIndex, ComputingNode::D0)[siteindex];
 
-  if (!usesLogAtRoot(classIndex))
+  if (usesScalingAtRoot(classIndex))
+    return log(VectorTools::sum(la)) + getLikelihoodData().getLikelihoodScaleAtRoot(classIndex, siteindex) * log(2.);
+  else if (!usesLogAtRoot(classIndex))
     return log(VectorTools::sum(la));
   else
     return VectorTools::logSumExp(la);
@@ -214,7 +311,9 @@ double AbstractLikelihoodTreeCalculation::getLikelihoodForASiteIndexForAState(si
   {
     const VVdouble& lla = getLikelihoodData().getLikelihoodArray(Rid, c, ComputingNode::D0);
 
-    if (!usesLogAtRoot(c))
+    if (usesScalingAtRoot(c))
+      l += ldexp(lla[siteindex][state], getLikelihoodData().getLikelihoodScaleAtRoot(c, siteindex)) * process_->getProbabilityForModel(c);
+    else if (!usesLogAtRoot(c))
       l += lla[siteindex][state] * process_->getProbabilityForModel(c);
     else
       l += exp(lla[siteindex][state]) * process_->getProbabilityForModel(c);
@@ -236,7 +335,9 @@ double AbstractLikelihoodTreeCalculation::getLogLikelihoodForASiteIndexForAState
   {
     const VVdouble& lla = getLikelihoodData().getLikelihoodArray(Rid, c, ComputingNode::D0);
 
-    if (!usesLogAtRoot(c))
+    if (usesScalingAtRoot(c))
+      v[c] = log(lla[siteindex][state]) + getLikelihoodData().getLikelihoodScaleAtRoot(c, siteindex) * log(2.) + log(process_->getProbabilityForModel(c));
+    else if (!usesLogAtRoot(c))
       v[c] = log(lla[siteindex][state]) + log(process_->getProbabilityForModel(c));
     else
       v[c] = lla[siteindex][state] + log(process_->getProbabilityForModel(c));
@@ -249,7 +350,10 @@ double AbstractLikelihoodTreeCalculation::getLogLikelihoodForASiteIndexForAState
 
 double AbstractLikelihoodTreeCalculation::getLikelihoodForASiteIndexForAClassForAState(size_t siteindex, size_t classIndex, int state)
 {
-  if (!usesLogAtRoot(classIndex))
+  if (usesScalingAtRoot(classIndex))
+    return ldexp(getLikelihoodData().getLikelihoodArray(getRootId(),classIndex, ComputingNode::D0)[siteindex][state],
+                 getLikelihoodData().getLikelihoodScaleAtRoot(classIndex, siteindex));
+  else if (!usesLogAtRoot(classIndex))
     return getLikelihoodData().getLikelihoodArray(getRootId(),classIndex, ComputingNode::D0)[siteindex][state];
   else
     return exp(getLikelihoodData().getLikelihoodArray(getRootId(),classIndex, ComputingNode::D0)[siteindex][state]);
@@ -259,7 +363,10 @@ double AbstractLikelihoodTreeCalculation::getLikelihoodForASiteIndexForAClassFor
 
 double AbstractLikelihoodTreeCalculation::getLogLikelihoodForASiteIndexForAClassForAState(size_t siteindex, size_t classIndex, int state)
 {
-  if (!usesLogAtRoot(classIndex))
+  if (usesScalingAtRoot(classIndex))
+    return log(getLikelihoodData().getLikelihoodArray(getRootId(),classIndex, ComputingNode::D0)[siteindex][state])
+      + getLikelihoodData().getLikelihoodScaleAtRoot(classIndex, siteindex) * log(2.);
+  else if (!usesLogAtRoot(classIndex))
     return log(getLikelihoodData().getLikelihoodArray(getRootId(),classIndex, ComputingNode::D0)[siteindex][state]);
   else
     return getLikelihoodData().getLikelihoodArray(getRootId(),classIndex, ComputingNode::D0)[siteindex][state];
@@ -281,8 +388,10 @@ double AbstractLikelihoodTreeCalculation::getDLikelihoodForASiteIndex(size_t sit
   for (size_t c = 0; c < nbClasses_; c++)
   {
     const VVdouble& ldla = getLikelihoodData().getLikelihoodArray(Rid, c, ComputingNode::D1);
+    double dlc = 0;
     for (size_t j = 0; j < nbStates_; ++j)
-      dl += ldla[siteindex][j] * process_->getProbabilityForModel(c);
+      dlc += ldla[siteindex][j];
+    dl += ldexp(dlc, getLikelihoodData().getLikelihoodScaleAtRoot(c, siteindex)) * process_->getProbabilityForModel(c);
   }
   
   return dl;
@@ -302,13 +411,94 @@ double AbstractLikelihoodTreeCalculation::getD2LikelihoodForASiteIndex(size_t si
   for (size_t c = 0; c < nbClasses_; c++)
   {
     const VVdouble& d2la = getLikelihoodData().getLikelihoodArray(Rid, c, ComputingNode::D2);
+    double d2lc = 0;
     for (size_t j = 0; j < nbStates_; ++j)
-      d2l += d2la[siteindex][j] * process_->getProbabilityForModel(c);
+      d2lc += d2la[siteindex][j];
+    d2l += ldexp(d2lc, getLikelihoodData().getLikelihoodScaleAtRoot(c, siteindex)) * process_->getProbabilityForModel(c);
   }
 
   return d2l;
 }
 
+/******************************************************************************/
+
+void AbstractLikelihoodTreeCalculation::getPosteriorProbabilitiesForASiteIndexPerClass(size_t siteindex, double* posteriors) const
+{
+  int Rid = getRootId();
+
+  if (!usesLogAtRoot(0) && !usesScalingAtRoot(0))
+  {
+    double l = 0;
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      const Vdouble& la = getLikelihoodData().getLikelihoodArray(Rid, c, ComputingNode::D0)[siteindex];
+      posteriors[c] = VectorTools::sum(la) * process_->getProbabilityForModel(c);
+      l += posteriors[c];
+    }
+    for (size_t c = 0; c < nbClasses_; c++)
+      posteriors[c] /= l;
+    return;
+  }
+
+  // With log or scaled arrays, the joint likelihoods of the classes are
+  // first computed in log, then normalized by the largest one.
+  double maxLog = 0;
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    const Vdouble& la = getLikelihoodData().getLikelihoodArray(Rid, c, ComputingNode::D0)[siteindex];
+    double lc;
+    if (usesScalingAtRoot(c))
+      lc = log(VectorTools::sum(la)) + getLikelihoodData().getLikelihoodScaleAtRoot(c, siteindex) * log(2.);
+    else if (!usesLogAtRoot(c))
+      lc = log(VectorTools::sum(la));
+    else
+      lc = VectorTools::logSumExp(la);
+    posteriors[c] = lc + log(process_->getProbabilityForModel(c));
+    if (c == 0 || posteriors[c] > maxLog)
+      maxLog = posteriors[c];
+  }
+
+  double l = 0;
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    posteriors[c] = exp(posteriors[c] - maxLog);
+    l += posteriors[c];
+  }
+  for (size_t c = 0; c < nbClasses_; c++)
+    posteriors[c] /= l;
+}
+
+/******************************************************************************/
+
+int AbstractLikelihoodTreeCalculation::getMaxScaleForASiteIndex_(size_t siteindex) const
+{
+  int scale = getLikelihoodData().getLikelihoodScaleAtRoot(0, siteindex);
+  for (size_t c = 1; c < nbClasses_; c++)
+    scale = max(scale, getLikelihoodData().getLikelihoodScaleAtRoot(c, siteindex));
+
+  return scale;
+}
+
+/******************************************************************************/
+
+double AbstractLikelihoodTreeCalculation::getScaledSumForASiteIndex_(size_t siteindex, unsigned char DX, int scale) const
+{
+  if ((DX == ComputingNode::D1 && nullDLogLikelihood_) || (DX == ComputingNode::D2 && nullD2LogLikelihood_))
+    return 0;
+
+  int Rid=getRootId();
+
+  double l = 0;
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    const Vdouble& la = getLikelihoodData().getLikelihoodArray(Rid, c, DX)[siteindex];
+    l += ldexp(VectorTools::sum(la), getLikelihoodData().getLikelihoodScaleAtRoot(c, siteindex) - scale)
+      * process_->getProbabilityForModel(c);
+  }
+
+  return l;
+}
+
 
 /******************************************************************************/
 
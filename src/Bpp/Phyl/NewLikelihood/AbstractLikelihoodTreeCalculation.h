@@ -57,7 +57,11 @@ namespace bpp
 
   protected:
     const SubstitutionProcess* process_;
-    std::unique_ptr<const AlignedValuesContainer> data_;
+    /**
+     * @brief The data subset of the leaves, shared by the copies of
+     * this object and by the calculations it was shared with.
+     */
+    std::shared_ptr<const AlignedValuesContainer> data_;
 
     size_t nbSites_;
     size_t nbDistinctSites_;
@@ -83,6 +87,20 @@ namespace bpp
      *
      */
     mutable std::vector<double> vSites_;
+
+    /**
+     * @brief Weights of the distinct patterns, empty if the original
+     * sites are used.
+     */
+    std::vector<double> patternWeights_;
+
+  protected:
+    /**
+     * @brief Set the data subset and initialize the likelihood arrays,
+     * reusing the site compression of another likelihood tree if the
+     * pointer is not null.
+     */
+    void setData_(std::shared_ptr<const AlignedValuesContainer> data, const LikelihoodTree* shared);
       
   public:
     AbstractLikelihoodTreeCalculation(const SubstitutionProcess* process, bool verbose = true):
@@ -97,7 +115,8 @@ namespace bpp
       up2date_(false),
       nullDLogLikelihood_(true),
       nullD2LogLikelihood_(true),
-      vSites_()
+      vSites_(),
+      patternWeights_()
     {
     }
   
@@ -113,16 +132,16 @@ namespace bpp
     up2date_(tlc.up2date_),
     nullDLogLikelihood_(tlc.nullDLogLikelihood_),
     nullD2LogLikelihood_(tlc.nullD2LogLikelihood_),
-    vSites_(tlc.vSites_)
+    vSites_(tlc.vSites_),
+    patternWeights_(tlc.patternWeights_)
     {
-      if (tlc.data_.get()) data_.reset(tlc.data_->clone());
+      data_ = tlc.data_;
     }
   
     AbstractLikelihoodTreeCalculation& operator=(const AbstractLikelihoodTreeCalculation& tlc)
     {
       process_ = tlc.process_;
-      if (tlc.data_.get()) data_.reset(tlc.data_->clone());
-      else data_.reset();
+      data_                          = tlc.data_;
       nbSites_                       = tlc.nbSites_;
       nbDistinctSites_               = tlc.nbDistinctSites_;
       nbStates_                      = tlc.nbStates_;
@@ -133,6 +152,7 @@ namespace bpp
       nullDLogLikelihood_            = tlc.nullDLogLikelihood_;
       nullD2LogLikelihood_           = tlc.nullD2LogLikelihood_;
       vSites_                        = tlc.vSites_;
+      patternWeights_                = tlc.patternWeights_;
         
       return *this;
     }
@@ -158,6 +178,8 @@ namespace bpp
 
     void setData(const AlignedValuesContainer& sites);
 
+    void setData(const AlignedValuesContainer& sites, const LikelihoodTreeCalculation& shared);
+
     const AlignedValuesContainer* getData() const
     {
       if (!initialized_)
@@ -165,6 +187,10 @@ namespace bpp
       return data_.get();
     }
   
+    void setPatternWeights(const std::vector<double>& weights);
+
+    const std::vector<double>& getPatternWeights() const { return patternWeights_; }
+
     const SubstitutionProcess* getSubstitutionProcess() const { return process_;}
 
 
@@ -199,6 +225,17 @@ namespace bpp
     {
       return getLikelihoodData().usesLogAtRoot(classIndex);
     }
+
+    /**
+     * @return if the likelihoods are rescaled by powers of 2 at root
+     * in class classIndex.
+     *
+     */
+       
+    bool usesScalingAtRoot(size_t classIndex) const
+    {
+      return getLikelihoodData().usesScalingAtRoot(classIndex);
+    }
       
     /**
      * @brief sets using log in all likelihood arrays.
@@ -210,6 +247,16 @@ namespace bpp
       getLikelihoodData().setAllUseLog(useLog);
     }
 
+    /**
+     * @brief sets using scaling in all likelihood arrays.
+     *
+     */
+    
+    void setAllUseScaling(bool useScaling)
+    {
+      getLikelihoodData().setAllUseScaling(useScaling);
+    }
+
     /*
      * @brief Retrieve the likelihood data.
      *
@@ -333,6 +380,8 @@ namespace bpp
 
     double getLogLikelihoodForASiteIndexForAClassForAState(size_t siteindex, size_t classIndex, int state);
 
+    void getPosteriorProbabilitiesForASiteIndexPerClass(size_t siteindex, double* posteriors) const;
+
 
     double getDLikelihoodForASiteIndex(size_t siteindex) const;
 
@@ -341,12 +390,29 @@ namespace bpp
       
     double getDLogLikelihoodForASiteIndex(size_t siteindex) const
     {
+      // With scaling, the ratio is computed on the scaled sums, which
+      // may not be representable unscaled.
+      if (usesScalingAtRoot(0))
+      {
+        int scale = getMaxScaleForASiteIndex_(siteindex);
+        return getScaledSumForASiteIndex_(siteindex, ComputingNode::D1, scale)
+          / getScaledSumForASiteIndex_(siteindex, ComputingNode::D0, scale);
+      }
+
       // d(f(g(x)))/dx = dg(x)/dx . df(g(x))/dg :
       return getDLikelihoodForASiteIndex(siteindex) / getLikelihoodForASiteIndex(siteindex);
     }
 
     double getD2LogLikelihoodForASiteIndex(size_t siteindex) const
     {
+      if (usesScalingAtRoot(0))
+      {
+        int scale = getMaxScaleForASiteIndex_(siteindex);
+        double l = getScaledSumForASiteIndex_(siteindex, ComputingNode::D0, scale);
+        return getScaledSumForASiteIndex_(siteindex, ComputingNode::D2, scale) / l
+          - pow(getScaledSumForASiteIndex_(siteindex, ComputingNode::D1, scale) / l, 2);
+      }
+
       return getD2LikelihoodForASiteIndex(siteindex) / getLikelihoodForASiteIndex(siteindex)
         - pow( getDLikelihoodForASiteIndex(siteindex) / getLikelihoodForASiteIndex(siteindex), 2);
     }
@@ -359,6 +425,25 @@ namespace bpp
 
     static void displayLikelihoodArray(const VVVdouble& likelihoodArray);
 
+  private:
+    /**
+     * @brief With scaling, the largest binary exponent over the
+     * classes of the root likelihoods of a site.
+     *
+     */
+
+    int getMaxScaleForASiteIndex_(size_t siteindex) const;
+
+    /**
+     * @brief With scaling, the DX likelihood of a site mixed over the
+     * classes, divided by 2^scale.
+     *
+     */
+
+    double getScaledSumForASiteIndex_(size_t siteindex, unsigned char DX, int scale) const;
+
+  public:
+
     /**
      * @brief compute ancestral frequencies
      *
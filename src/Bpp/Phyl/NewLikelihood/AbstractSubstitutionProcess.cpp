@@ -83,10 +83,17 @@ ParameterList AbstractSubstitutionProcess::getNonDerivableParameters() const
 void AbstractSubstitutionProcess::fireParameterChanged(const ParameterList& pl)
 {
   ParameterList gAP=getAliasedParameters(pl);
-  gAP.addParameters(pl);
 
-  pTree_->matchParametersValues(gAP);
+  // Without aliases, changed parameters are forwarded without copy:
+  const ParameterList* changed = &pl;
+  if (gAP.size() > 0)
+  {
+    gAP.addParameters(pl);
+    changed = &gAP;
+  }
+
+  pTree_->matchParametersValues(*changed);
   
-  getComputingTree().matchParametersValues(gAP);
+  getComputingTree().matchParametersValues(*changed);
 }
 
@@ -321,6 +321,24 @@ Vuint ComputingTree::toBeUpdatedNodes() const
   return lId;
 }
 
+void ComputingTree::computeTransitionProbabilities() const
+{
+  vector<const SpeciationComputingNode*> vNodes;
+
+  for (size_t i = 0; i < vTree_.size(); i++)
+  {
+    vector<shared_ptr<ComputingNode> > vCN = vTree_[i]->getAllNodes();
+    for (size_t j = 0; j < vCN.size(); j++)
+    {
+      const SpeciationComputingNode* node = dynamic_cast<const SpeciationComputingNode*>(vCN[j].get());
+      if (node && node->hasFather())
+        vNodes.push_back(node);
+    }
+  }
+
+  SpeciationComputingNode::computeTransitionProbabilities(vNodes);
+}
+
 void ComputingTree::updateAll()
 {
   if (!isReadyToCompute_)
@@ -166,6 +166,13 @@ namespace bpp
     
     size_t getNumberOfClasses() const { return vTree_.size();}
 
+    /*
+     * @brief The rate of a class, ie the scale of its branch lengths.
+     *
+     */
+
+    double getRateForClass(size_t nClass) const { return pDist_ ? pDist_->getCategory(nClass) : 1.; }
+
   private:
     
     void clearAllModels_();
@@ -221,6 +228,14 @@ namespace bpp
     
     Vuint toBeUpdatedNodes() const;
 
+    /*
+     * @brief Computes the transition probabilities of all the nodes
+     * of all the classes that are not up to date, batched by model.
+     *
+     */
+
+    void computeTransitionProbabilities() const;
+
   };
   
 } //end of namespace bpp.
@@ -83,6 +83,17 @@ void HmmProcessEmissionProbabilities::updateEmissionProbabilities_() const
   upToDate_=true;
 }
 
+void HmmProcessEmissionProbabilities::fillEmissionProbabilities(double* emissions) const
+{
+  multiPL_->computeLikelihood();
+
+  size_t nbSites=multiPL_->getNumberOfSites();
+  size_t nbStates=multiPL_->getNumberOfSubstitutionProcess();
+  for (size_t i=0;i<nbSites;i++)
+    for (size_t j=0;j<nbStates;j++)
+      emissions[i*nbStates+j]=multiPL_->getLikelihoodForASiteForAProcess(i, j);
+}
+
 void HmmProcessEmissionProbabilities::computeDEmissionProbabilities(std::string& variable) const
 {
   for (size_t i=0;i<multiPL_->getNumberOfSubstitutionProcess();i++)
@@ -140,6 +140,15 @@ namespace bpp
       return emProb_[pos][state];
     }
 
+    /**
+     * @brief Write the emission probabilities in a contiguous buffer,
+     * in [site * nbStates + state], straight from the site likelihoods
+     * of the processes.
+     *
+     */
+    
+    void fillEmissionProbabilities(double* emissions) const;
+
     void computeDEmissionProbabilities(std::string& variable) const;
   
     void computeD2EmissionProbabilities(std::string& variable) const;
@@ -0,0 +1,136 @@
+//
+// File: JointAncestralReconstruction.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "JointAncestralReconstruction.h"
+
+using namespace bpp;
+
+// From the STL:
+#include <cmath>
+
+using namespace std;
+
+/******************************************************************************/
+
+JointAncestralReconstruction::JointAncestralReconstruction(const RecursiveLikelihoodTreeCalculation& rltc, size_t nbThreads) :
+  AbstractJointAncestralStateReconstruction(rltc.getAlphabet(), nbThreads)
+{
+  const SubstitutionProcess& sp = *rltc.getSubstitutionProcess();
+  nbSites_          = rltc.getLikelihoodData().getNumberOfSites();
+  nbDistinctSites_  = rltc.getLikelihoodData().getNumberOfDistinctSites();
+  nbClasses_        = sp.getNumberOfClasses();
+  nbStates_         = sp.getNumberOfStates();
+  rootPatternLinks_ = rltc.getLikelihoodData().getRootArrayPositions();
+
+  const ParametrizablePhyloTree& tree = sp.getParametrizablePhyloTree();
+  size_t root = addNodes_(rltc, tree.getRoot());
+  fathers_[root] = nodeIds_.size();
+
+  const vector<double>& freqs = sp.getRootFrequencies();
+  logRootFreqs_.resize(nbStates_);
+  for (size_t x = 0; x < nbStates_; ++x)
+    logRootFreqs_[x] = log(freqs[x]);
+
+  logClassProbs_.resize(nbClasses_);
+  for (size_t c = 0; c < nbClasses_; ++c)
+    logClassProbs_[c] = log(sp.getProbabilityForModel(c));
+
+  const TransitionModel& model = *sp.getModel(tree.getNodeIndex(tree.getAllLeaves()[0]), 0); // We assume all nodes have a model with the same set of states.
+  alphabetStates_.resize(nbStates_);
+  for (size_t x = 0; x < nbStates_; ++x)
+    alphabetStates_[x] = model.getAlphabetStateAsInt(x);
+
+  reconstruct_();
+}
+
+/******************************************************************************/
+
+size_t JointAncestralReconstruction::addNodes_(const RecursiveLikelihoodTreeCalculation& rltc, const shared_ptr<PhyloNode> node)
+{
+  const ParametrizablePhyloTree& tree = rltc.getSubstitutionProcess()->getParametrizablePhyloTree();
+  vector<shared_ptr<PhyloNode> > vsons = tree.getSons(node);
+  vector<size_t> sons(vsons.size());
+  for (size_t i = 0; i < vsons.size(); i++)
+    sons[i] = addNodes_(rltc, vsons[i]);
+
+  size_t k = nodeIds_.size();
+  unsigned int nodeId = tree.getNodeIndex(node);
+  bool leaf = tree.isLeaf(node);
+  nodeIds_.push_back(static_cast<int>(nodeId));
+  fathers_.push_back(0);
+  isLeaf_.push_back(leaf);
+  names_.push_back(node->hasName() ? node->getName() : "");
+  logLeaves_.push_back(vector<double>());
+  for (size_t i = 0; i < sons.size(); i++)
+    fathers_[sons[i]] = k;
+
+  size_t n2 = nbStates_ * nbStates_;
+  logPxy_.resize((k + 1) * nbClasses_ * n2);
+
+  if (leaf)
+  {
+    // Leaf likelihoods do not depend on the class:
+    const RecursiveLikelihoodTree& rlt = dynamic_cast<const RecursiveLikelihoodTree&>(rltc.getLikelihoodData());
+    const RecursiveLikelihoodNode& lnode = *rlt[0].getNode(nodeId);
+    const VVdouble& larray = lnode.getBelowLikelihoodArray(ComputingNode::D0);
+    if (larray.size() != nbDistinctSites_)
+      throw Exception("JointAncestralReconstruction: leaf likelihoods are not indexed by distinct sites. Build the calculation without patterns.");
+    vector<double>& leafArray = logLeaves_[k];
+    leafArray.resize(nbDistinctSites_ * nbStates_);
+    for (size_t i = 0; i < nbDistinctSites_; i++)
+      for (size_t y = 0; y < nbStates_; y++)
+        leafArray[i * nbStates_ + y] = lnode.usesLog() ? larray[i][y] : log(larray[i][y]);
+  }
+
+  if (tree.hasFather(node))
+  {
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      const Matrix<double>& pxy = rltc.getSubstitutionProcess()->getTransitionProbabilities(nodeId, c);
+      double* pxy_c = &logPxy_[(k * nbClasses_ + c) * n2];
+      for (size_t x = 0; x < nbStates_; x++)
+        for (size_t y = 0; y < nbStates_; y++)
+          pxy_c[x * nbStates_ + y] = log(pxy(x, y));
+    }
+  }
+  return k;
+}
+
+/******************************************************************************/
+
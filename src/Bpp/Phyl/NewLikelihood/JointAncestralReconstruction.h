@@ -0,0 +1,85 @@
+//
+// File: JointAncestralReconstruction.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _JOINTANCESTRALRECONSTRUCTION_H_
+#define _JOINTANCESTRALRECONSTRUCTION_H_
+
+#include "../AbstractJointAncestralStateReconstruction.h"
+#include "RecursiveLikelihoodTreeCalculation.h"
+
+// From the STL:
+#include <memory>
+
+namespace bpp
+{
+
+/**
+ * @brief Joint likelihood ancestral states reconstruction for
+ * recursive likelihood calculations.
+ *
+ * States are computed once, when the object is built, from the current
+ * parameter values of the process. As for substitution mappings, the
+ * likelihood arrays must be indexed by distinct sites, ie the calculation
+ * must be built without recursive site compression.
+ *
+ * @see AbstractJointAncestralStateReconstruction
+ */
+  class JointAncestralReconstruction:
+    public AbstractJointAncestralStateReconstruction
+  {
+  public:
+    /**
+     * @param rltc      The likelihood calculation, which must be up to date.
+     * @param nbThreads The number of threads over which sites are shared.
+     * @throw Exception If the leaf arrays do not match the distinct sites.
+     */
+    JointAncestralReconstruction(const RecursiveLikelihoodTreeCalculation& rltc, size_t nbThreads = 1);
+
+    JointAncestralReconstruction* clone() const { return new JointAncestralReconstruction(*this); }
+
+    virtual ~JointAncestralReconstruction() {}
+
+  private:
+    size_t addNodes_(const RecursiveLikelihoodTreeCalculation& rltc, const std::shared_ptr<PhyloNode> node);
+  };
+
+} // end of namespace bpp.
+
+#endif // _JOINTANCESTRALRECONSTRUCTION_H_
+
@@ -118,6 +118,17 @@ namespace bpp
 
       virtual void initLikelihoods(const AlignedValuesContainer& sites, const SubstitutionProcess& process) = 0;
 
+      /**
+       * @brief Same as initLikelihoods(sites, process), but may reuse
+       * the site compression of another tree initialized on the same
+       * sites. By default nothing is shared.
+       */
+
+      virtual void initLikelihoods(const AlignedValuesContainer& sites, const SubstitutionProcess& process, const LikelihoodTree& shared)
+      {
+        initLikelihoods(sites, process);
+      }
+
       /**
        * @brief Resize and initialize all likelihood arrays at a given
        * node according to the given sizes, for a given derivation
@@ -134,6 +145,13 @@ namespace bpp
     
       virtual void setAllUseLog(bool useLog) = 0;
 
+      /**
+       * @brief sets using scaling in all likelihood arrays.
+       *
+       */
+    
+      virtual void setAllUseScaling(bool useScaling) = 0;
+
     };
 
 } //end of namespace bpp.
@@ -126,6 +126,21 @@ public:
    */
   
   virtual void setData(const AlignedValuesContainer& sites) = 0;
+
+  /**
+   * @brief Initialize the object according to a data set, sharing
+   * what can be with an already initialized calculation on the same
+   * data set.
+   *
+   * If both calculations have the same set of leaves, the data subset
+   * and the site compression of @p shared are reused instead of being
+   * computed again. Otherwise this is the same as setData(sites).
+   *
+   * @param sites A sequence alignment to initialize the object with.
+   * @param shared A calculation already initialized with @p sites.
+   */
+  
+  virtual void setData(const AlignedValuesContainer& sites, const LikelihoodTreeCalculation& shared) = 0;
   
   /**
    * @return The data set used to initialize this object.
@@ -133,6 +148,24 @@ public:
    */
   virtual const AlignedValuesContainer* getData() const = 0;
 
+  /**
+   * @brief Set the weight of each distinct pattern in the log-likelihood
+   * and its derivatives, in place of its number of occurrences.
+   *
+   * Likelihood arrays do not depend on weights and are not computed
+   * again. This is what a site bootstrap replicate changes.
+   *
+   * @param weights One weight per distinct pattern, or an empty vector
+   * to go back to the original sites.
+   * @throw BadSizeException If the size does not match the number of distinct patterns.
+   */
+  virtual void setPatternWeights(const std::vector<double>& weights) = 0;
+
+  /**
+   * @return The weights of the distinct patterns, empty if the original sites are used.
+   */
+  virtual const std::vector<double>& getPatternWeights() const = 0;
+
   virtual LikelihoodTree& getLikelihoodData() = 0;
   
   virtual const LikelihoodTree& getLikelihoodData() const = 0;
@@ -151,6 +184,14 @@ public:
   
   virtual void setAllUseLog(bool useLog) = 0;
 
+  /**
+   * @brief sets using power-of-two scaling in all likelihood arrays,
+   * instead of log.
+   *
+   */
+  
+  virtual void setAllUseScaling(bool useScaling) = 0;
+
   /**
    * @brief Get the log-likelihood for the data set.
    *
@@ -238,6 +279,16 @@ public:
 
   virtual double getLogLikelihoodForASiteIndexForAClass(size_t siteindex, size_t classIndex) = 0;
 
+  /**
+   * @brief Get the posterior probabilities of the model classes for a
+   * site index, read directly from the root arrays.
+   *
+   * @param siteindex  The site index.
+   * @param posteriors Filled with one probability per class [out].
+   */
+
+  virtual void getPosteriorProbabilitiesForASiteIndexPerClass(size_t siteindex, double* posteriors) const = 0;
+
   /**
    * @brief Get the likelihood for a site knowing its model class and its ancestral state.
    *
@@ -375,6 +426,19 @@ public:
   
   virtual void computeTreeD2LogLikelihood(const Vuint& vbrId) = 0;
 
+  /**
+   * @brief Compute the transition probabilities needed by the next
+   * computation of the given order, so that this computation does not
+   * use the substitution models anymore. Computations of trees
+   * sharing models can then be run concurrently.
+   *
+   * @param DX the order of the computation (ComputingNode::D0, D1 or D2).
+   * @param vbrId the Ids of the branches that are derivated.
+   *
+   */
+  
+  virtual void prepareTransitionProbabilities(unsigned char DX, const Vuint& vbrId) = 0;
+
 };
 
 } // end of namespace bpp.
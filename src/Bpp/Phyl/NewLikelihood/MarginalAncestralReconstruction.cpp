@@ -38,10 +38,17 @@
  */
 
 #include "MarginalAncestralReconstruction.h"
+#include "../SiteLoopExecutor.h"
+
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Random/RandomTools.h>
 
 using namespace bpp;
+
+// From the STL:
+#include <cmath>
+#include <functional>
+
 using namespace std;
 
 vector<size_t> MarginalAncestralReconstruction::getAncestralStatesForNode(int nodeId, VVdouble& probs, bool sample) const
@@ -53,7 +60,27 @@ vector<size_t> MarginalAncestralReconstruction::getAncestralStatesForNode(int no
 
   likelihood_->computeLikelihoodsAtNode(nodeId);
 
-  if (!likelihood_->getLikelihoodData().getNodeData(nodeId, 0).usesLog())
+  if (likelihood_->getLikelihoodData().getNodeData(nodeId, 0).usesScaling())
+  {
+    // Classes are weighted relatively to the largest exponent of each site.
+    for (size_t i = 0; i < nbDistinctSites_; i++)
+    {
+      int maxScale = likelihood_->getLikelihoodData().getNodeData(nodeId, 0).getLikelihoodScale(i);
+      for (size_t c = 1; c < nbClasses_; c++)
+        maxScale = max(maxScale, likelihood_->getLikelihoodData().getNodeData(nodeId, c).getLikelihoodScale(i));
+
+      probs[i].assign(nbStates_, 0);
+      for (size_t c = 0; c < nbClasses_; c++)
+      {
+        const AbstractLikelihoodNode& node = likelihood_->getLikelihoodData().getNodeData(nodeId, c);
+        double w = ldexp(likelihood_->getSubstitutionProcess()->getProbabilityForModel(c), node.getLikelihoodScale(i) - maxScale);
+        const Vdouble& larray_i = node.getLikelihoodArray(ComputingNode::D0)[i];
+        for (size_t x = 0; x < nbStates_; x++)
+          probs[i][x] += larray_i[x] * w;
+      }
+    }
+  }
+  else if (!likelihood_->getLikelihoodData().getNodeData(nodeId, 0).usesLog())
     probs=likelihood_->getLikelihoodData().getNodeData(nodeId, 0).getLikelihoodArray(ComputingNode::D0)*likelihood_->getSubstitutionProcess()->getProbabilityForModel(0);
   else
     probs=VectorTools::exp(likelihood_->getLikelihoodData().getNodeData(nodeId, 0).getLikelihoodArray(ComputingNode::D0) + log(likelihood_->getSubstitutionProcess()->getProbabilityForModel(0)));
@@ -63,7 +90,7 @@ vector<size_t> MarginalAncestralReconstruction::getAncestralStatesForNode(int no
     if (!likelihood_->getLikelihoodData().getNodeData(nodeId, c).usesLog())
       probs+=likelihood_->getLikelihoodData().getNodeData(nodeId, c).getLikelihoodArray(ComputingNode::D0)*likelihood_->getSubstitutionProcess()->getProbabilityForModel(c);
     else
-      probs+=VectorTools::exp(likelihood_->getLikelihoodData().getNodeData(nodeId, 0).getLikelihoodArray(ComputingNode::D0) + log(likelihood_->getSubstitutionProcess()->getProbabilityForModel(0)));
+      probs+=VectorTools::exp(likelihood_->getLikelihoodData().getNodeData(nodeId, c).getLikelihoodArray(ComputingNode::D0) + log(likelihood_->getSubstitutionProcess()->getProbabilityForModel(c)));
   } 
 
   for (size_t i = 0; i < nbDistinctSites_; i++)
@@ -98,6 +125,107 @@ vector<size_t> MarginalAncestralReconstruction::getAncestralStatesForNode(int no
   return ancestors;
 }
 
+void MarginalAncestralReconstruction::getAncestralStatesForNodes(
+  const vector<int>& nodeIds,
+  vector<double>& probs,
+  vector<size_t>& states,
+  bool sample,
+  size_t nbThreads) const
+{
+  size_t nbNodes = nodeIds.size();
+  probs.assign(nbNodes * nbDistinctSites_ * nbStates_, 0);
+  states.assign(nbNodes * nbDistinctSites_, 0);
+
+  likelihood_->computeLikelihoodsAtAllNodes();
+
+  const SubstitutionProcess* process = likelihood_->getSubstitutionProcess();
+  Vdouble classProbs(nbClasses_);
+  for (size_t c = 0; c < nbClasses_; c++)
+    classProbs[c] = process->getProbabilityForModel(c);
+
+  // Random numbers are drawn beforehand, as the generator is shared:
+  Vdouble draws;
+  if (sample)
+  {
+    draws.resize(nbNodes * nbDistinctSites_);
+    for (size_t i = 0; i < draws.size(); i++)
+      draws[i] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+  }
+
+  function<void(size_t, size_t)> loop = [&](size_t first, size_t last)
+  {
+    vector<int> maxScales(last - first, 0);
+    for (size_t k = 0; k < nbNodes; k++)
+    {
+      if (likelihood_->getLikelihoodData().getNodeData(nodeIds[k], 0).usesScaling())
+        for (size_t i = first; i < last; i++)
+        {
+          maxScales[i - first] = likelihood_->getLikelihoodData().getNodeData(nodeIds[k], 0).getLikelihoodScale(i);
+          for (size_t c = 1; c < nbClasses_; c++)
+            maxScales[i - first] = max(maxScales[i - first], likelihood_->getLikelihoodData().getNodeData(nodeIds[k], c).getLikelihoodScale(i));
+        }
+
+      for (size_t c = 0; c < nbClasses_; c++)
+      {
+        const AbstractLikelihoodNode& node = likelihood_->getLikelihoodData().getNodeData(nodeIds[k], c);
+        const VVdouble& larray = node.getLikelihoodArray(ComputingNode::D0);
+        bool usesLog = node.usesLog();
+        bool usesScaling = node.usesScaling();
+        for (size_t i = first; i < last; i++)
+        {
+          double* probs_i = &probs[(k * nbDistinctSites_ + i) * nbStates_];
+          const Vdouble& larray_i = larray[i];
+          double w = usesScaling ? ldexp(classProbs[c], node.getLikelihoodScale(i) - maxScales[i - first]) : classProbs[c];
+          for (size_t x = 0; x < nbStates_; x++)
+            probs_i[x] += (usesLog ? exp(larray_i[x]) : larray_i[x]) * w;
+        }
+      }
+
+      for (size_t i = first; i < last; i++)
+      {
+        double* probs_i = &probs[(k * nbDistinctSites_ + i) * nbStates_];
+        double s = 0;
+        for (size_t x = 0; x < nbStates_; x++)
+          s += probs_i[x];
+        for (size_t x = 0; x < nbStates_; x++)
+          probs_i[x] /= s;
+
+        size_t& state = states[k * nbDistinctSites_ + i];
+        if (sample)
+        {
+          double r = draws[k * nbDistinctSites_ + i];
+          double cumProb = 0;
+          state = nbStates_ - 1;
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            cumProb += probs_i[x];
+            if (r <= cumProb)
+            {
+              state = x;
+              break;
+            }
+          }
+        }
+        else
+        {
+          state = 0;
+          for (size_t x = 1; x < nbStates_; x++)
+            if (probs_i[x] > probs_i[state])
+              state = x;
+        }
+      }
+    }
+  };
+
+  if (nbThreads > 1)
+  {
+    SiteLoopExecutor executor(nbThreads);
+    executor.run(nbDistinctSites_, loop);
+  }
+  else
+    loop(0, nbDistinctSites_);
+}
+
 map<int, vector<size_t> > MarginalAncestralReconstruction::getAllAncestralStates() const
 {
   map<int, vector<size_t> > ancestors;
@@ -181,11 +309,24 @@ AlignedSequenceContainer* MarginalAncestralReconstruction::getAncestralSequences
 {
   AlignedSequenceContainer* asc = new AlignedSequenceContainer(alphabet_);
   vector<shared_ptr<PhyloNode> > inNodes = tree_->getAllInnerNodes();
-  for (size_t i = 0; i < inNodes.size(); i++)
+  vector<int> ids(inNodes.size());
+  for (size_t k = 0; k < inNodes.size(); k++)
+    ids[k] = static_cast<int>(tree_->getNodeIndex(inNodes[k]));
+
+  vector<double> probs;
+  vector<size_t> states;
+  getAncestralStatesForNodes(ids, probs, states, sample);
+
+  const TransitionModel& model = *likelihood_->getSubstitutionProcess()->getModel(tree_->getNodeIndex(tree_->getAllLeaves()[0]), 0); // We assume all nodes have a model with the same set of states.
+  vector<int> allStates(nbSites_);
+  for (size_t k = 0; k < ids.size(); k++)
   {
-    Sequence* seq = getAncestralSequenceForNode(tree_->getNodeIndex(inNodes[i]), NULL, sample);
-    asc->addSequence(*seq);
-    delete seq;
+    for (size_t i = 0; i < nbSites_; i++)
+    {
+      allStates[i] = model.getAlphabetStateAsInt(states[k * nbDistinctSites_ + rootPatternLinks_[i]]);
+    }
+    string name = inNodes[k]->hasName() ? inNodes[k]->getName() : TextTools::toString(ids[k]);
+    asc->addSequence(BasicSequence(name, allStates, alphabet_));
   }
   return asc;
 }
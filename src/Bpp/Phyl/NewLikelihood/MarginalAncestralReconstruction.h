@@ -147,6 +147,34 @@ namespace bpp
 		
       std::map<int, std::vector<size_t> > getAllAncestralStates() const;
 
+      /**
+       * @brief Get the posterior probabilities and states of several
+       * nodes at once.
+       *
+       * Likelihoods at all nodes are computed in a single up/down sweep
+       * of the tree, instead of one computeLikelihoodsAtNode() call per
+       * node, and sites are then dealt with concurrently. The calculation
+       * must hence be built without patterns.
+       *
+       * @param nodeIds   The ids of the nodes [in].
+       * @param probs     Filled with the posterior probabilities, in
+       * [(node * nbDistinctSites + site) * nbStates + state], node being
+       * the position in nodeIds [out].
+       * @param states    Filled with the states, in
+       * [node * nbDistinctSites + site] [out].
+       * @param sample    Tell if states should be sampled from the
+       * posterior distribution instead of taking the one with maximum
+       * probability.
+       * @param nbThreads The number of threads sharing the sites.
+       */
+      
+      void getAncestralStatesForNodes(
+        const std::vector<int>& nodeIds,
+        std::vector<double>& probs,
+        std::vector<size_t>& states,
+        bool sample = false,
+        size_t nbThreads = 1) const;
+
       /**
        * @brief Get an ancestral sequence for a given node.
        *
@@ -58,7 +58,8 @@ NonHomogeneousSubstitutionProcess::NonHomogeneousSubstitutionProcess(const NonHo
   modelToNodes_         (set.modelToNodes_),
   modelParameters_      (set.modelParameters_),
   stationarity_         (set.stationarity_),
-  computingTree_()
+  computingTree_(),
+  modelLoopExecutor_()
 {
   computingTree_.reset(new ComputingTree(*pTree_.get(), *rDist_.get()));
 
@@ -70,6 +71,8 @@ NonHomogeneousSubstitutionProcess::NonHomogeneousSubstitutionProcess(const NonHo
   }
 
   computingTree_->checkModelOnEachNode();
+
+  setNumberOfThreads(set.getNumberOfThreads());
 }
 
 NonHomogeneousSubstitutionProcess& NonHomogeneousSubstitutionProcess::operator=(const NonHomogeneousSubstitutionProcess& set)
@@ -103,10 +106,20 @@ NonHomogeneousSubstitutionProcess& NonHomogeneousSubstitutionProcess::operator=(
   }
 
   computingTree_->checkModelOnEachNode();
+
+  setNumberOfThreads(set.getNumberOfThreads());
   
   return *this;
 }
 
+void NonHomogeneousSubstitutionProcess::setNumberOfThreads(size_t nbThreads)
+{
+  if (nbThreads <= 1)
+    modelLoopExecutor_.reset();
+  else if (!modelLoopExecutor_ || modelLoopExecutor_->getNumberOfThreads() != nbThreads)
+    modelLoopExecutor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
 void NonHomogeneousSubstitutionProcess::clear()
 {
   resetParameters_();
@@ -247,10 +260,27 @@ void NonHomogeneousSubstitutionProcess::fireParameterChanged(const ParameterList
     {
       modelParameters_[i][np].setValue(getParameterValue(modelParameters_[i][np].getName()+"_"+TextTools::toString(i+1)));
     }
-    if (modelSet_[i]->matchParametersValues(modelParameters_[i]))
-      computingTree_->update(modelToNodes_[i]);
   }
 
+  // Models only read their own parameters, so that they can be
+  // updated concurrently. The computing tree is then updated by the
+  // calling thread.
+  std::vector<char> changed(modelParameters_.size(), 0);
+  std::function<void(size_t, size_t)> loop = [this, &changed](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; i++)
+      changed[i] = modelSet_[i]->matchParametersValues(modelParameters_[i]) ? 1 : 0;
+  };
+
+  if (modelLoopExecutor_)
+    modelLoopExecutor_->run(modelParameters_.size(), loop);
+  else
+    loop(0, modelParameters_.size());
+
+  for (size_t i = 0; i < modelParameters_.size(); i++)
+    if (changed[i])
+      computingTree_->update(modelToNodes_[i]);
+
   AbstractSubstitutionProcess::fireParameterChanged(parameters);
 }
 
@@ -42,6 +42,7 @@
 
 #include "AbstractSubstitutionProcess.h"
 #include "../Model/FrequenciesSet/FrequenciesSet.h"
+#include "../SiteLoopExecutor.h"
 
 //From bpp-core:
 #include <Bpp/Exceptions.h>
@@ -146,6 +147,10 @@ namespace bpp
      */
     mutable std::unique_ptr<ComputingTree> computingTree_;
 
+    /**
+     * @brief Threads updating the models, null if there is only one thread.
+     */
+    std::unique_ptr<SiteLoopExecutor> modelLoopExecutor_;
 
   public:
     /**
@@ -164,7 +169,8 @@ namespace bpp
       modelToNodes_(),
       modelParameters_(),
       stationarity_(true),
-      computingTree_()
+      computingTree_(),
+      modelLoopExecutor_()
     {
       // Add parameters:
       addParameters_(tree->getParameters());  //Branch lengths
@@ -191,7 +197,8 @@ namespace bpp
       modelToNodes_(),
       modelParameters_(),
       stationarity_(false),
-      computingTree_()
+      computingTree_(),
+      modelLoopExecutor_()
     {
       addParameters_(tree->getParameters());  //Branch lengths
       addParameters_(rdist->getIndependentParameters());  
@@ -209,6 +216,21 @@ namespace bpp
 
     NonHomogeneousSubstitutionProcess* clone() const { return new NonHomogeneousSubstitutionProcess(*this); }
 
+    /**
+     * @brief Set the number of threads updating the models when
+     * parameters change.
+     *
+     * Models are split into one contiguous block per thread, each model
+     * being updated (generator and diagonalization) by a single thread.
+     * Models of the process must hence not share any mutable object.
+     *
+     * @param nbThreads The number of threads, including the calling
+     * one. 1 (the default) means no additional thread.
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    size_t getNumberOfThreads() const { return modelLoopExecutor_ ? modelLoopExecutor_->getNumberOfThreads() : 1; }
+
     /**
      * @brief Resets all the information contained in this object.
      *
@@ -38,8 +38,49 @@
 */
 
 #include "AbstractPhyloLikelihood.h"
+#include "../../Io/BinaryTools.h"
 
 using namespace bpp;
 using namespace std;
 
+namespace
+{
+  const char PARAMETERS_MAGIC[4] = {'B', 'P', 'P', 'P'};
+  const uint32_t PARAMETERS_VERSION = 1;
+}
+
+/******************************************************************************/
+
+void AbstractPhyloLikelihood::writeParameters(std::ostream& out) const
+{
+  const ParameterList& pl = getParameters();
+  BinaryTools::writeHeader(out, PARAMETERS_MAGIC, PARAMETERS_VERSION);
+  BinaryTools::writeValue(out, static_cast<uint64_t>(pl.size()));
+  for (size_t i = 0; i < pl.size(); i++)
+  {
+    BinaryTools::writeString(out, pl[i].getName());
+    BinaryTools::writeValue(out, pl[i].getValue());
+  }
+}
+
+/******************************************************************************/
+
+void AbstractPhyloLikelihood::readParameters(std::istream& in)
+{
+  if (!BinaryTools::readHeader(in, PARAMETERS_MAGIC, PARAMETERS_VERSION))
+    throw IOException("AbstractPhyloLikelihood::readParameters. No parameters found in stream.");
+  uint64_t nbParameters;
+  BinaryTools::readValue(in, nbParameters);
+  ParameterList pl;
+  string name;
+  for (uint64_t i = 0; i < nbParameters; i++)
+  {
+    double value;
+    BinaryTools::readString(in, name);
+    BinaryTools::readValue(in, value);
+    pl.addParameter(Parameter(name, value));
+  }
+  matchParametersValues(pl);
+}
+
 
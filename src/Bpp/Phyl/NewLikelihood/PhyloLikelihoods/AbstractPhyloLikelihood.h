@@ -42,6 +42,9 @@
 
 #include "PhyloLikelihood.h"
 
+// From the STL:
+#include <iostream>
+
 namespace bpp
 {
   class AbstractPhyloLikelihood :
@@ -152,6 +155,30 @@ namespace bpp
 
     virtual bool isInitialized() const { return initialized_; }
 
+    /**
+     * @name Checkpointing
+     *
+     * @{
+     */
+
+    /**
+     * @brief Write the current parameter values to a binary stream.
+     *
+     * Values are stored by name with their full precision.
+     */
+    virtual void writeParameters(std::ostream& out) const;
+
+    /**
+     * @brief Set the parameter values written by writeParameters().
+     *
+     * Saved parameters that are not in this object are ignored.
+     *
+     * @throw IOException If the stream does not contain parameter values.
+     */
+    virtual void readParameters(std::istream& in);
+
+    /** @} */
+
     /*
      * @brief return the value, ie -loglikelihood
      *
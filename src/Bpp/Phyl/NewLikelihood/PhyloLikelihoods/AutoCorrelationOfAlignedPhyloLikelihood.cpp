@@ -55,7 +55,10 @@ AutoCorrelationOfAlignedPhyloLikelihood::AutoCorrelationOfAlignedPhyloLikelihood
   hma_(),
   htm_(),
   hpep_(),
-  hmm_()
+  hmm_(),
+  fb_(),
+  fbUpToDate_(false),
+  hmmUpToDate_(false)
 {
   hma_ = unique_ptr<HmmPhyloAlphabet>(new HmmPhyloAlphabet(*this));
 
@@ -77,8 +80,38 @@ void AutoCorrelationOfAlignedPhyloLikelihood::setNamespace(const std::string& na
 void AutoCorrelationOfAlignedPhyloLikelihood::fireParameterChanged(const ParameterList& parameters)
 {
   SetOfAlignedPhyloLikelihood::fireParameterChanged(parameters);
-  hpep_->update();
-  hmm_->matchParametersValues(parameters);
+
+  // Only the emissions of the members depending on the changed
+  // parameters are computed again (HMM states are the members, in
+  // order):
+  vector<bool> changed=getChangedPhyloLikelihoods_(parameters);
+  for (size_t i=0; i<changed.size(); i++)
+    if (changed[i])
+      hpep_->update(i);
+
+  htm_->matchParametersValues(parameters);
+  fbUpToDate_=false;
+  hmmUpToDate_=false;
+}
+
+void AutoCorrelationOfAlignedPhyloLikelihood::computeForward_() const
+{
+  if (fbUpToDate_)
+    return;
+
+  fb_.resize(hpep_->getNumberOfSites(), hpep_->getNumberOfStates());
+  hpep_->fillEmissionProbabilities(fb_.getEmissions());
+  fb_.computeForward(htm_->getPij(), htm_->getEquilibriumFrequencies());
+  fbUpToDate_=true;
+}
+
+void AutoCorrelationOfAlignedPhyloLikelihood::updateHmm_() const
+{
+  if (hmmUpToDate_)
+    return;
+
+  hmm_->computeLikelihood();
+  hmmUpToDate_=true;
 }
 
 ParameterList AutoCorrelationOfAlignedPhyloLikelihood::getNonDerivableParameters() const
@@ -43,6 +43,7 @@
 
 #include "SetOfAlignedPhyloLikelihood.h"
 #include "HmmPhyloEmissionProbabilities.h"
+#include "ScaledHmmForwardBackward.h"
 
 // From Numeric
 #include <Bpp/Numeric/Hmm/HmmLikelihood.h>
@@ -75,6 +76,18 @@ private:
 
   mutable std::unique_ptr<LogsumHmmLikelihood> hmm_;
 
+  /**
+   * @brief The likelihood and posteriors are computed on contiguous
+   * buffers, the auto-correlation transitions being applied in
+   * O(number of members) per site. The bpp-core HMM is only used (and
+   * then brought up to date) for derivatives.
+   */
+  mutable ScaledHmmForwardBackward fb_;
+
+  mutable bool fbUpToDate_;
+
+  mutable bool hmmUpToDate_;
+
 public:
   AutoCorrelationOfAlignedPhyloLikelihood(PhyloLikelihoodContainer* pC, const std::vector<size_t>& nPhylo);
 
@@ -85,7 +98,10 @@ public:
     hma_(std::unique_ptr<HmmPhyloAlphabet>(mlc.hma_->clone())),
     htm_(std::unique_ptr<AutoCorrelationTransitionMatrix>(mlc.htm_->clone())),
     hpep_(std::unique_ptr<HmmPhyloEmissionProbabilities>(mlc.hpep_->clone())),
-    hmm_(std::unique_ptr<LogsumHmmLikelihood>(mlc.hmm_->clone()))
+    hmm_(std::unique_ptr<LogsumHmmLikelihood>(mlc.hmm_->clone())),
+    fb_(mlc.fb_),
+    fbUpToDate_(mlc.fbUpToDate_),
+    hmmUpToDate_(mlc.hmmUpToDate_)
   {}
 
   AutoCorrelationOfAlignedPhyloLikelihood& operator=(const AutoCorrelationOfAlignedPhyloLikelihood& mlc)
@@ -96,6 +112,9 @@ public:
     htm_ = std::unique_ptr<AutoCorrelationTransitionMatrix>(mlc.htm_->clone());
     hpep_ = std::unique_ptr<HmmPhyloEmissionProbabilities>(mlc.hpep_->clone());
     hmm_ = std::unique_ptr<LogsumHmmLikelihood>(mlc.hmm_->clone());
+    fb_ = mlc.fb_;
+    fbUpToDate_ = mlc.fbUpToDate_;
+    hmmUpToDate_ = mlc.hmmUpToDate_;
 
     return *this;
   }
@@ -107,6 +126,18 @@ public:
 public:
   void setNamespace(const std::string& nameSpace);
 
+  /**
+   * @brief Set the number of threads running the forward and backward
+   * recursions over blocks of sites (1 by default).
+   *
+   * @see ScaledHmmForwardBackward::setNumberOfThreads
+   */
+  void setNumberOfForwardThreads(size_t nbThreads)
+  {
+    fb_.setNumberOfThreads(nbThreads);
+    fbUpToDate_ = false;
+  }
+
   void fireParameterChanged(const ParameterList& parameters);
 
   /**
@@ -116,7 +147,8 @@ public:
    */
   double getLogLikelihood() const
   {
-    return hmm_->getLogLikelihood();
+    computeForward_();
+    return fb_.getLogLikelihood();
   }
 
   double getDLogLikelihood(const std::string& variable) const
@@ -137,12 +169,14 @@ public:
    */
   double getLikelihoodForASite(size_t site) const
   {
-    return hmm_->getLikelihoodForASite(site);
+    computeForward_();
+    return fb_.getLikelihoodForASite(site);
   }
 
   double getLogLikelihoodForASite(size_t site) const
   {
-    return log(hmm_->getLikelihoodForASite(site));
+    computeForward_();
+    return log(fb_.getLikelihoodForASite(site));
   }
 
   double getDLogLikelihoodForASite(const std::string& variable, size_t site) const
@@ -157,19 +191,22 @@ public:
 
   Vdouble getLikelihoodPerSite() const
   {
-    return hmm_->getLikelihoodForEachSite();
+    computeForward_();
+    return fb_.getLikelihoodPerSite();
   }
 
   VVdouble getPosteriorProbabilitiesPerSitePerAligned() const
   {
+    computeForward_();
     VVdouble pp;
-    hmm_->getHiddenStatesPosteriorProbabilities(pp, false);
+    fb_.getPosteriorProbabilities(pp);
     return pp;
   }
 
   Vdouble getPosteriorProbabilitiesForASitePerAligned(size_t site) const
   {
-    return hmm_->getHiddenStatesPosteriorProbabilitiesForASite(site);
+    computeForward_();
+    return fb_.getPosteriorProbabilitiesForASite(site);
   }
 
   const HmmTransitionMatrix& getHmmTransitionMatrix() const
@@ -180,6 +217,7 @@ public:
 protected:
   void computeDLogLikelihood_(const std::string& variable) const
   {
+    updateHmm_();
     hmm_->getFirstOrderDerivative(variable);
     // derivative exists and ready to compute
   
@@ -189,6 +227,7 @@ protected:
 
   void computeD2LogLikelihood_(const std::string& variable) const
   {
+    updateHmm_();
     hmm_->getSecondOrderDerivative(variable);
     
     d2Values_[variable]= std::nan("");
@@ -196,6 +235,11 @@ protected:
 
   ParameterList getNonDerivableParameters() const;
 
+private:
+  void computeForward_() const;
+
+  void updateHmm_() const;
+
   /*
    * @}
    */
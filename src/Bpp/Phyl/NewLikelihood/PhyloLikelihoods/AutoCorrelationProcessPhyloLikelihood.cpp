@@ -60,7 +60,9 @@ AutoCorrelationProcessPhyloLikelihood::AutoCorrelationProcessPhyloLikelihood(
   AbstractAlignedPhyloLikelihood(data.getNumberOfSites()),
   MultiProcessSequencePhyloLikelihood(data, processSeqEvol, nSeqEvol, nData, verbose, patterns),
   Hpep_(),
-  Hmm_()
+  Hmm_(),
+  fb_(),
+  hmmUpToDate_(false)
 {
   Hpep_ = unique_ptr<HmmProcessEmissionProbabilities>(new HmmProcessEmissionProbabilities(&processSeqEvol.getHmmProcessAlphabet(), this));
 
@@ -77,9 +79,9 @@ void AutoCorrelationProcessPhyloLikelihood::setNamespace(const std::string& name
 void AutoCorrelationProcessPhyloLikelihood::fireParameterChanged(const ParameterList& parameters)
 {
   MultiProcessSequencePhyloLikelihood::fireParameterChanged(parameters);
-  MultiProcessSequencePhyloLikelihood::updateLikelihood();
-  MultiProcessSequencePhyloLikelihood::computeLikelihood();
 
-  Hmm_->matchParametersValues(parameters);
+  // The transition matrix is updated through the sequence evolution.
+  Hpep_->matchParametersValues(parameters);
+  hmmUpToDate_=false;
 }
 
@@ -44,6 +44,7 @@
 #include "MultiProcessSequencePhyloLikelihood.h"
 #include "../AutoCorrelationSequenceEvolution.h"
 #include "../HmmProcessEmissionProbabilities.h"
+#include "ScaledHmmForwardBackward.h"
 
 // From bpp-seq:
 #include <Bpp/Seq/Container/AlignedValuesContainer.h>
@@ -71,6 +72,16 @@ private:
 
   mutable std::unique_ptr<LogsumHmmLikelihood> Hmm_;
 
+  /**
+   * @brief The likelihood and posteriors are computed on contiguous
+   * buffers, the auto-correlation transitions being applied in
+   * O(number of processes) per site. The bpp-core HMM is only used (and
+   * then brought up to date) for derivatives.
+   */
+  mutable ScaledHmmForwardBackward fb_;
+
+  mutable bool hmmUpToDate_;
+
 public:
   AutoCorrelationProcessPhyloLikelihood(
     const AlignedValuesContainer& data,
@@ -85,13 +96,17 @@ public:
     AbstractAlignedPhyloLikelihood(mlc),
     MultiProcessSequencePhyloLikelihood(mlc),
     Hpep_(std::unique_ptr<HmmProcessEmissionProbabilities>(mlc.Hpep_->clone())),
-    Hmm_(std::unique_ptr<LogsumHmmLikelihood>(mlc.Hmm_->clone())) {}
+    Hmm_(std::unique_ptr<LogsumHmmLikelihood>(mlc.Hmm_->clone())),
+    fb_(mlc.fb_),
+    hmmUpToDate_(mlc.hmmUpToDate_) {}
 
   AutoCorrelationProcessPhyloLikelihood& operator=(const AutoCorrelationProcessPhyloLikelihood& mlc)
   {
     MultiProcessSequencePhyloLikelihood::operator=(mlc);
     Hpep_ = std::unique_ptr<HmmProcessEmissionProbabilities>(mlc.Hpep_->clone());
     Hmm_ = std::unique_ptr<LogsumHmmLikelihood>(mlc.Hmm_->clone());
+    fb_ = mlc.fb_;
+    hmmUpToDate_ = mlc.hmmUpToDate_;
     return *this;
   }
 
@@ -102,6 +117,17 @@ public:
 public:
   void setNamespace(const std::string& nameSpace);
 
+  /**
+   * @brief Set the number of threads running the forward and backward
+   * recursions over blocks of sites (1 by default).
+   *
+   * @see ScaledHmmForwardBackward::setNumberOfThreads
+   */
+  void setNumberOfForwardThreads(size_t nbThreads)
+  {
+    fb_.setNumberOfThreads(nbThreads);
+  }
+
   void fireParameterChanged(const ParameterList& parameters);
 
   void updateLikelihood() const
@@ -115,7 +141,11 @@ public:
     if (computeLikelihoods_)
     {
       MultiProcessSequencePhyloLikelihood::computeLikelihood();
-      Hmm_->computeLikelihood();
+
+      const HmmTransitionMatrix& htm = Hmm_->getHmmTransitionMatrix();
+      fb_.resize(getNumberOfSites(), getNumberOfSubstitutionProcess());
+      Hpep_->fillEmissionProbabilities(fb_.getEmissions());
+      fb_.computeForward(htm.getPij(), htm.getEquilibriumFrequencies());
 
       computeLikelihoods_ = false;
     }
@@ -131,7 +161,7 @@ public:
   {
     updateLikelihood();
     computeLikelihood();
-    return Hmm_->getLogLikelihood();
+    return fb_.getLogLikelihood();
   }
 
 
@@ -156,7 +186,7 @@ public:
     updateLikelihood();
     computeLikelihood();
 
-    return Hmm_->getLikelihoodForASite(site);
+    return fb_.getLikelihoodForASite(site);
   }
 
   double getLogLikelihoodForASite(size_t site) const
@@ -164,7 +194,7 @@ public:
     updateLikelihood();
     computeLikelihood();
 
-    return log(Hmm_->getLikelihoodForASite(site));
+    return log(fb_.getLikelihoodForASite(site));
   }
 
   double getDLogLikelihoodForASite(const std::string& variable, size_t site) const
@@ -182,7 +212,7 @@ public:
     updateLikelihood();
     computeLikelihood();
 
-    return Hmm_->getLikelihoodForEachSite();
+    return fb_.getLikelihoodPerSite();
   }
 
   VVdouble getPosteriorProbabilitiesPerSitePerProcess() const
@@ -191,7 +221,7 @@ public:
     computeLikelihood();
 
     VVdouble pp;
-    Hmm_->getHiddenStatesPosteriorProbabilities(pp, false);
+    fb_.getPosteriorProbabilities(pp);
     return pp;
   }
 
@@ -203,15 +233,29 @@ public:
 protected:
   void computeDLogLikelihood_(const std::string& variable) const
   {
+    updateHmm_();
     Hmm_->getFirstOrderDerivative(variable);
   }
 
 
   void computeD2LogLikelihood_(const std::string& variable) const
   {
+    updateHmm_();
     Hmm_->getSecondOrderDerivative(variable);
   }
 
+private:
+  void updateHmm_() const
+  {
+    if (hmmUpToDate_)
+      return;
+
+    updateLikelihood();
+    computeLikelihood();
+    Hmm_->computeLikelihood();
+    hmmUpToDate_ = true;
+  }
+
   /*
    * @}
    */
@@ -40,13 +40,23 @@
 #include "FormulaOfPhyloLikelihood.h"
 
 using namespace bpp;
+
+// From the STL:
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
 using namespace std;
 
 FormulaOfPhyloLikelihood::FormulaOfPhyloLikelihood(PhyloLikelihoodContainer* pC) :
   PhyloLikelihood(),
   AbstractPhyloLikelihood(),
   SetOfAbstractPhyloLikelihood(pC),
-  compTree_()
+  compTree_(),
+  program_(),
+  registers_(),
+  dRegisters_(),
+  d2Registers_()
 {
 }
 
@@ -54,7 +64,11 @@ FormulaOfPhyloLikelihood::FormulaOfPhyloLikelihood(PhyloLikelihoodContainer* pC,
   PhyloLikelihood(),
   AbstractPhyloLikelihood(),
   SetOfAbstractPhyloLikelihood(pC),
-  compTree_()
+  compTree_(),
+  program_(),
+  registers_(),
+  dRegisters_(),
+  d2Registers_()
 {
   readFormula(formula);
 }
@@ -63,14 +77,22 @@ FormulaOfPhyloLikelihood::FormulaOfPhyloLikelihood(PhyloLikelihoodContainer* pC,
 FormulaOfPhyloLikelihood::FormulaOfPhyloLikelihood(const FormulaOfPhyloLikelihood& sd) :
   AbstractPhyloLikelihood(sd),
   SetOfAbstractPhyloLikelihood(sd),
-  compTree_(sd.compTree_->clone())
+  compTree_(sd.compTree_ ? sd.compTree_->clone() : 0),
+  program_(sd.program_),
+  registers_(sd.registers_),
+  dRegisters_(sd.dRegisters_),
+  d2Registers_(sd.d2Registers_)
 {
 }
 
 FormulaOfPhyloLikelihood& FormulaOfPhyloLikelihood::operator=(const FormulaOfPhyloLikelihood& sd)
 {
   SetOfAbstractPhyloLikelihood::operator=(sd);
-  compTree_.reset(compTree_->clone());
+  compTree_.reset(sd.compTree_ ? sd.compTree_->clone() : 0);
+  program_=sd.program_;
+  registers_=sd.registers_;
+  dRegisters_=sd.dRegisters_;
+  d2Registers_=sd.d2Registers_;
 
   return *this;
 }
@@ -88,30 +110,260 @@ void FormulaOfPhyloLikelihood::readFormula(const std::string& formula)
   
   compTree_=unique_ptr<ComputationTree>(new ComputationTree(formula, functionNames));
 
-  // add used Phylolikelihoods
+  compile_(formula);
   
-  string popout=output();
+  // add used Phylolikelihoods
   
-  StringTokenizer st(popout,"phylo",true, true);
-  st.nextToken();
+  for (size_t i = 0; i < program_.size(); i++)
+    if (program_[i].op == PHYLO)
+      addPhyloLikelihood((size_t)program_[i].value);
+}
 
-  vector<size_t> phyldep;
-  
-  while (st.hasMoreToken())
+std::string FormulaOfPhyloLikelihood::output() const
+{
+  return compTree_ ? compTree_->output() : "";
+}
+
+
+
+
+
+
+
+/******************************************************************************/
+
+void FormulaOfPhyloLikelihood::compile_(const std::string& formula)
+{
+  program_.clear();
+
+  size_t pos = 0;
+  parseSum_(formula, pos);
+  while (pos < formula.size() && isspace(formula[pos]))
+    pos++;
+  if (pos != formula.size())
+    throw Exception("FormulaOfPhyloLikelihood::compile_: unexpected character at position " + TextTools::toString(pos) + " of " + formula);
+
+  registers_.resize(program_.size());
+  dRegisters_.resize(program_.size());
+  d2Registers_.resize(program_.size());
+}
+
+size_t FormulaOfPhyloLikelihood::emit_(Operation op, size_t a, size_t b, double value)
+{
+  Instruction ins;
+  ins.op = op;
+  ins.a = a;
+  ins.b = b;
+  ins.value = value;
+  program_.push_back(ins);
+  return program_.size() - 1;
+}
+
+namespace
+{
+  /*
+   * Skips the spaces and returns the next character (0 at the end).
+   */
+  char peek(const std::string& formula, size_t& pos)
   {
-    string ex=st.nextToken();
-    addPhyloLikelihood((size_t)(atoi(ex.c_str())));
+    while (pos < formula.size() && isspace(formula[pos]))
+      pos++;
+    return pos < formula.size() ? formula[pos] : 0;
   }
+}
 
+size_t FormulaOfPhyloLikelihood::parseSum_(const std::string& formula, size_t& pos)
+{
+  size_t r = parseProduct_(formula, pos);
+  char c = peek(formula, pos);
+  while (c == '+' || c == '-')
+  {
+    pos++;
+    size_t r2 = parseProduct_(formula, pos);
+    r = emit_(c == '+' ? ADD : SUB, r, r2, 0);
+    c = peek(formula, pos);
+  }
+  return r;
 }
 
-std::string FormulaOfPhyloLikelihood::output() const
+size_t FormulaOfPhyloLikelihood::parseProduct_(const std::string& formula, size_t& pos)
 {
-  return compTree_->output();
+  size_t r = parseUnary_(formula, pos);
+  char c = peek(formula, pos);
+  while (c == '*' || c == '/')
+  {
+    pos++;
+    size_t r2 = parseUnary_(formula, pos);
+    r = emit_(c == '*' ? MUL : DIV, r, r2, 0);
+    c = peek(formula, pos);
+  }
+  return r;
+}
+
+size_t FormulaOfPhyloLikelihood::parseUnary_(const std::string& formula, size_t& pos)
+{
+  if (peek(formula, pos) == '-')
+  {
+    pos++;
+    size_t r = parseUnary_(formula, pos);
+    return emit_(NEG, r, 0, 0);
+  }
+  return parsePower_(formula, pos);
 }
 
+size_t FormulaOfPhyloLikelihood::parsePower_(const std::string& formula, size_t& pos)
+{
+  size_t r = parsePrimary_(formula, pos);
+  if (peek(formula, pos) == '^')
+  {
+    pos++;
+    // right associative, and tighter than the unary minus on its left
+    size_t r2 = parseUnary_(formula, pos);
+    r = emit_(POW, r, r2, 0);
+  }
+  return r;
+}
 
+size_t FormulaOfPhyloLikelihood::parsePrimary_(const std::string& formula, size_t& pos)
+{
+  char c = peek(formula, pos);
+  if (c == '(')
+  {
+    pos++;
+    size_t r = parseSum_(formula, pos);
+    if (peek(formula, pos) != ')')
+      throw Exception("FormulaOfPhyloLikelihood::compile_: missing ')' in " + formula);
+    pos++;
+    return r;
+  }
 
+  if (isdigit(c) || c == '.')
+  {
+    const char* begin = formula.c_str() + pos;
+    char* end;
+    double x = strtod(begin, &end);
+    pos += (size_t)(end - begin);
+    return emit_(CONSTANT, 0, 0, x);
+  }
 
+  size_t begin = pos;
+  while (pos < formula.size() && (isalnum(formula[pos]) || formula[pos] == '_'))
+    pos++;
+  string name = formula.substr(begin, pos - begin);
 
+  if (name.size() > 5 && name.compare(0, 5, "phylo") == 0 && TextTools::isDecimalInteger(name.substr(5)))
+    return emit_(PHYLO, 0, 0, (double)atoi(name.substr(5).c_str()));
 
+  if ((name == "exp" || name == "log") && peek(formula, pos) == '(')
+  {
+    size_t r = parsePrimary_(formula, pos);
+    return emit_(name == "exp" ? EXP : LOG, r, 0, 0);
+  }
+
+  throw Exception("FormulaOfPhyloLikelihood::compile_: unknown expression '" + (name.size() ? name : string(1, c)) + "' in " + formula);
+}
+
+/******************************************************************************/
+
+double FormulaOfPhyloLikelihood::evaluate_(const std::string& variable, size_t order) const
+{
+  bool first = order > 0;
+  bool second = order > 1;
+
+  double* v = registers_.data();
+  double* d = dRegisters_.data();
+  double* d2 = d2Registers_.data();
+  
+  for (size_t i = 0; i < program_.size(); i++)
+  {
+    const Instruction& ins = program_[i];
+    size_t a = ins.a;
+    size_t b = ins.b;
+
+    // Derivatives follow the chain rule: (uv)' = u'v + uv', ...
+    switch (ins.op)
+    {
+    case CONSTANT:
+      v[i] = ins.value;
+      d[i] = d2[i] = 0;
+      break;
+    case PHYLO:
+    {
+      const AbstractPhyloLikelihood* aPL = getAbstractPhyloLikelihood((size_t)ins.value);
+      v[i] = aPL->getValue();
+      d[i] = first ? aPL->getFirstOrderDerivative(variable) : 0;
+      d2[i] = second ? aPL->getSecondOrderDerivative(variable) : 0;
+      break;
+    }
+    case ADD:
+      v[i] = v[a] + v[b];
+      d[i] = d[a] + d[b];
+      d2[i] = d2[a] + d2[b];
+      break;
+    case SUB:
+      v[i] = v[a] - v[b];
+      d[i] = d[a] - d[b];
+      d2[i] = d2[a] - d2[b];
+      break;
+    case NEG:
+      v[i] = -v[a];
+      d[i] = -d[a];
+      d2[i] = -d2[a];
+      break;
+    case MUL:
+      v[i] = v[a] * v[b];
+      if (first)
+      {
+        d[i] = d[a] * v[b] + v[a] * d[b];
+        d2[i] = d2[a] * v[b] + 2 * d[a] * d[b] + v[a] * d2[b];
+      }
+      break;
+    case DIV:
+      v[i] = v[a] / v[b];
+      if (first)
+      {
+        d[i] = (d[a] - v[i] * d[b]) / v[b];
+        d2[i] = (d2[a] - 2 * d[i] * d[b] - v[i] * d2[b]) / v[b];
+      }
+      break;
+    case POW:
+      v[i] = pow(v[a], v[b]);
+      if (!first)
+        break;
+      if (d[b] == 0 && d2[b] == 0)
+      {
+        // constant exponent, valid for negative bases
+        double y = v[b];
+        double p1 = y * pow(v[a], y - 1);
+        d[i] = p1 * d[a];
+        d2[i] = y * (y - 1) * pow(v[a], y - 2) * d[a] * d[a] + p1 * d2[a];
+      }
+      else
+      {
+        // x^y = exp(y log(x))
+        double lx = log(v[a]);
+        double w1 = d[b] * lx + v[b] * d[a] / v[a];
+        double w2 = d2[b] * lx + 2 * d[b] * d[a] / v[a] + v[b] * (d2[a] / v[a] - d[a] * d[a] / (v[a] * v[a]));
+        d[i] = v[i] * w1;
+        d2[i] = v[i] * (w2 + w1 * w1);
+      }
+      break;
+    case EXP:
+      v[i] = exp(v[a]);
+      d[i] = v[i] * d[a];
+      d2[i] = v[i] * (d2[a] + d[a] * d[a]);
+      break;
+    case LOG:
+      v[i] = log(v[a]);
+      d[i] = d[a] / v[a];
+      d2[i] = d2[a] / v[a] - d[i] * d[i];
+      break;
+    }
+  }
+
+  if (program_.size() == 0)
+    return 0;
+
+  size_t r = program_.size() - 1;
+  return order == 0 ? v[r] : (order == 1 ? d[r] : d2[r]);
+}
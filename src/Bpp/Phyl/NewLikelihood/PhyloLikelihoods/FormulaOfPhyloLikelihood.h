@@ -54,6 +54,11 @@ namespace bpp
    *
    * WARNING: This formula applies on the log-likelihoods (ie getValues())
    *
+   * The formula is parsed in a ComputationTree, and also compiled in a
+   * flat sequence of instructions, on which the value and the
+   * derivatives are computed in a single pass, without any allocation.
+   * Operators +, -, *, /, ^ and functions exp and log are supported.
+   *
    */
   
   class FormulaOfPhyloLikelihood:
@@ -62,6 +67,32 @@ namespace bpp
   private:
     std::unique_ptr<ComputationTree> compTree_;
 
+    enum Operation { CONSTANT, PHYLO, ADD, SUB, MUL, DIV, POW, NEG, EXP, LOG };
+
+    /**
+     * @brief The result of instruction i is stored in register i, and
+     * its operands a and b are previous registers.
+     *
+     */
+    
+    struct Instruction
+    {
+      Operation op;
+      size_t a;
+      size_t b;
+      double value; // the constant, or the number of the phylo likelihood
+    };
+
+    std::vector<Instruction> program_;
+
+    /**
+     * @brief The registers of the values, and of their first and
+     * second order derivatives.
+     *
+     */
+    
+    mutable std::vector<double> registers_, dRegisters_, d2Registers_;
+
   public:
     FormulaOfPhyloLikelihood(PhyloLikelihoodContainer* pC);
 
@@ -111,7 +142,7 @@ namespace bpp
       updateLikelihood();
       computeLikelihood();
 
-      return -compTree_->getValue();
+      return -evaluate_("", 0);
     }
     
     /**
@@ -121,16 +152,54 @@ namespace bpp
     
     double getDLogLikelihood(const std::string& variable) const
     {
-      return -compTree_->getFirstOrderDerivative(variable);      
+      return -evaluate_(variable, 1);
     }
     
 
     double getD2LogLikelihood(const std::string& variable) const
     {
-      return -compTree_->getSecondOrderDerivative(variable);
+      return -evaluate_(variable, 2);
     }
     
     /** @} */
+
+  private:
+
+    /**
+     * @brief Compile the formula in program_.
+     *
+     * @throw Exception If the formula can not be parsed.
+     */
+    
+    void compile_(const std::string& formula);
+
+    size_t emit_(Operation op, size_t a, size_t b, double value);
+    
+    /**
+     * @brief Recursive descent parser, from the lowest to the highest
+     * priority. Each method returns the register of the parsed
+     * expression.
+     *
+     */
+    
+    size_t parseSum_(const std::string& formula, size_t& pos);
+
+    size_t parseProduct_(const std::string& formula, size_t& pos);
+
+    size_t parseUnary_(const std::string& formula, size_t& pos);
+
+    size_t parsePower_(const std::string& formula, size_t& pos);
+
+    size_t parsePrimary_(const std::string& formula, size_t& pos);
+
+    /**
+     * @brief Run the program.
+     *
+     * @param variable The variable of the derivatives.
+     * @param order 0 for the value, 1 or 2 for the derivatives.
+     */
+    
+    double evaluate_(const std::string& variable, size_t order) const;
     
   };
 
@@ -169,16 +169,24 @@ namespace bpp {
         vAP_[i]->computeLikelihood();
     }
 
+    /**
+     * @brief Derivatives are only computed for the members
+     * depending on the variable.
+     *
+     */
+    
     void computeDLogLikelihood(const std::string& variable) const
     {
       for (size_t i=0; i<vAP_.size(); i++)
-        vAP_[i]->computeDLogLikelihood_(variable);
+        if (vAP_[i]->hasParameter(variable))
+          vAP_[i]->computeDLogLikelihood_(variable);
     }
 
     void computeD2LogLikelihood(const std::string& variable) const
     {
       for (size_t i=0; i<vAP_.size(); i++)
-        vAP_[i]->computeD2LogLikelihood_(variable);
+        if (vAP_[i]->hasParameter(variable))
+          vAP_[i]->computeD2LogLikelihood_(variable);
     }
 
     /**
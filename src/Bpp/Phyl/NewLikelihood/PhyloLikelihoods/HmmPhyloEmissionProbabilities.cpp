@@ -49,6 +49,8 @@ HmmPhyloEmissionProbabilities::HmmPhyloEmissionProbabilities(const HmmPhyloAlpha
   dEmProb_(),
   d2EmProb_(),
   upToDate_(false),
+  changed_(alphabet->getNumberOfStates(), true),
+  changedInBuffer_(alphabet->getNumberOfStates(), true),
   nbSites_(alphabet->getNumberOfSites())
 {
   for (size_t i=0;i<emProb_.size();i++)
@@ -68,7 +70,7 @@ void HmmPhyloEmissionProbabilities::setHmmStateAlphabet(const HmmStateAlphabet*
   emProb_.resize(nbSites_);
   for (size_t i=0;i<emProb_.size();i++)
     emProb_[i].resize(getNumberOfStates());
-  upToDate_=false;
+  update();
 }
 
 
@@ -77,13 +79,36 @@ void HmmPhyloEmissionProbabilities::computeEmissionProbabilities_() const
   phylAlph_->updateLikelihood();
   phylAlph_->computeLikelihood();
   
-  for (size_t i=0;i<nbSites_;i++)
-    for (size_t j=0;j<getNumberOfStates();j++)
-      emProb_[i][j]= phylAlph_->getPhyloLikelihood(j).getLikelihoodForASite(i);
+  for (size_t j=0;j<getNumberOfStates();j++)
+  {
+    if (!changed_[j])
+      continue;
+    Vdouble lik=phylAlph_->getPhyloLikelihood(j).getLikelihoodPerSite();
+    for (size_t i=0;i<nbSites_;i++)
+      emProb_[i][j]=lik[i];
+    changed_[j]=false;
+  }
 
   upToDate_=true;
 }
 
+void HmmPhyloEmissionProbabilities::fillEmissionProbabilities(double* emissions) const
+{
+  phylAlph_->updateLikelihood();
+  phylAlph_->computeLikelihood();
+
+  size_t nbStates=getNumberOfStates();
+  for (size_t j=0;j<nbStates;j++)
+  {
+    if (!changedInBuffer_[j])
+      continue;
+    changedInBuffer_[j]=false;
+    Vdouble lik=phylAlph_->getPhyloLikelihood(j).getLikelihoodPerSite();
+    for (size_t i=0;i<nbSites_;i++)
+      emissions[i*nbStates+j]=lik[i];
+  }
+}
+
 void HmmPhyloEmissionProbabilities::computeDEmissionProbabilities(std::string& variable) const
 {
   phylAlph_->computeDLogLikelihood(variable);
@@ -95,12 +120,14 @@ void HmmPhyloEmissionProbabilities::computeDEmissionProbabilities(std::string& v
       dEmProb_[i].resize(getNumberOfStates());
   }
 
-  for (size_t i=0;i<nbSites_;i++)
-    for (size_t j=0;j<getNumberOfStates();j++)
-    {
-      const AlignedPhyloLikelihood& apl=phylAlph_->getPhyloLikelihood(j);
-      dEmProb_[i][j]= apl.getDLogLikelihoodForASite(variable, i) * apl.getLikelihoodForASite(i);
-    }
+  // States not depending on the variable have null derivatives:
+  for (size_t j=0;j<getNumberOfStates();j++)
+  {
+    const AlignedPhyloLikelihood& apl=phylAlph_->getPhyloLikelihood(j);
+    bool depends=apl.hasParameter(variable);
+    for (size_t i=0;i<nbSites_;i++)
+      dEmProb_[i][j]= depends ? apl.getDLogLikelihoodForASite(variable, i) * apl.getLikelihoodForASite(i) : 0;
+  }
 }
   
 void HmmPhyloEmissionProbabilities::computeD2EmissionProbabilities(std::string& variable) const
@@ -114,14 +141,23 @@ void HmmPhyloEmissionProbabilities::computeD2EmissionProbabilities(std::string&
       d2EmProb_[i].resize(getNumberOfStates());
   }
 
-  for (size_t i=0;i<nbSites_;i++)
-    for (size_t j=0;j<getNumberOfStates();j++)
+  for (size_t j=0;j<getNumberOfStates();j++)
+  {
+    const AlignedPhyloLikelihood& apl=phylAlph_->getPhyloLikelihood(j);
+    if (!apl.hasParameter(variable))
+    {
+      for (size_t i=0;i<nbSites_;i++)
+        d2EmProb_[i][j]=0;
+      continue;
+    }
+    
+    for (size_t i=0;i<nbSites_;i++)
     {
-      const AlignedPhyloLikelihood& apl=phylAlph_->getPhyloLikelihood(j);
       double x= apl.getDLogLikelihoodForASite(variable, i);
       
       d2EmProb_[i][j]= (apl.getD2LogLikelihoodForASite(variable, i) + x*x) * apl.getLikelihoodForASite(i);
     }
+  }
 }
 
 
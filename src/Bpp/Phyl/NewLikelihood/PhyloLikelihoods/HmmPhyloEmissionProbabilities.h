@@ -70,6 +70,17 @@ namespace bpp
 
     mutable bool upToDate_;
 
+    /**
+     * @brief For each state, tell if its emission probabilities have
+     * changed since they were last stored in emProb_, and since they
+     * were last written by fillEmissionProbabilities().
+     *
+     */
+    
+    mutable std::vector<bool> changed_;
+
+    mutable std::vector<bool> changedInBuffer_;
+
     size_t nbSites_;
     
     void computeEmissionProbabilities_() const;
@@ -84,6 +95,8 @@ namespace bpp
       dEmProb_(hEP.dEmProb_),
       d2EmProb_(hEP.d2EmProb_),
       upToDate_(hEP.upToDate_),
+      changed_(hEP.changed_),
+      changedInBuffer_(hEP.changedInBuffer_),
       nbSites_(hEP.nbSites_)
     {}
 
@@ -95,6 +108,8 @@ namespace bpp
       dEmProb_=hEP.dEmProb_;
       d2EmProb_=hEP.d2EmProb_;
       upToDate_=hEP.upToDate_;
+      changed_=hEP.changed_;
+      changedInBuffer_=hEP.changedInBuffer_;
       nbSites_=hEP.nbSites_;
 
       return *this;
@@ -121,9 +136,30 @@ namespace bpp
       return nbSites_;
     }
 
+    /**
+     * @brief Tell that the emission probabilities of all states have
+     * changed.
+     *
+     */
+    
     void update()
     {
       upToDate_=false;
+      changed_.assign(getNumberOfStates(), true);
+      changedInBuffer_.assign(getNumberOfStates(), true);
+    }
+
+    /**
+     * @brief Tell that the emission probabilities of a state have
+     * changed, the others being only recomputed when they change.
+     *
+     */
+    
+    void update(size_t state)
+    {
+      upToDate_=false;
+      changed_[state]=true;
+      changedInBuffer_[state]=true;
     }
     
     /**
@@ -154,6 +190,18 @@ namespace bpp
       return emProb_[pos][state];
     }
 
+    /**
+     * @brief Write the emission probabilities in a contiguous buffer,
+     * in [site * nbStates + state], straight from the site likelihoods
+     * of the members.
+     *
+     * Only the states that changed since the last call are written, so
+     * the same buffer must be given at each call.
+     *
+     */
+    
+    void fillEmissionProbabilities(double* emissions) const;
+
     void computeDEmissionProbabilities(std::string& variable) const;
   
     void computeD2EmissionProbabilities(std::string& variable) const;
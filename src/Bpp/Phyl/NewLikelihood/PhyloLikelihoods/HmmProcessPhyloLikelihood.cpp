@@ -60,7 +60,9 @@ HmmProcessPhyloLikelihood::HmmProcessPhyloLikelihood(
   AbstractAlignedPhyloLikelihood(data.getNumberOfSites()),
   MultiProcessSequencePhyloLikelihood(data, processSeqEvol, verbose, patterns, nData),
   Hpep_(),
-  Hmm_()
+  Hmm_(),
+  fb_(),
+  hmmUpToDate_(false)
 {
   Hpep_ = unique_ptr<HmmProcessEmissionProbabilities>(new HmmProcessEmissionProbabilities(&processSeqEvol.getHmmProcessAlphabet(), this));
 
@@ -76,5 +78,8 @@ void HmmProcessPhyloLikelihood::setNamespace(const std::string& nameSpace)
 void HmmProcessPhyloLikelihood::fireParameterChanged(const ParameterList& parameters)
 {
   MultiProcessSequencePhyloLikelihood::fireParameterChanged(parameters);
-  Hmm_->matchParametersValues(parameters);
+
+  // The transition matrix is updated through the sequence evolution.
+  Hpep_->matchParametersValues(parameters);
+  hmmUpToDate_=false;
 }
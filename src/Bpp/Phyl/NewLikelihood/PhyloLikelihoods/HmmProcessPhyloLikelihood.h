@@ -44,6 +44,7 @@
 #include "MultiProcessSequencePhyloLikelihood.h"
 #include "../HmmSequenceEvolution.h"
 #include "../HmmProcessEmissionProbabilities.h"
+#include "ScaledHmmForwardBackward.h"
 
 // From SeqLib:
 #include <Bpp/Seq/Container/AlignedValuesContainer.h>
@@ -72,6 +73,15 @@ private:
 
   mutable std::unique_ptr<LogsumHmmLikelihood> Hmm_;
 
+  /**
+   * @brief The likelihood and posteriors are computed on contiguous
+   * buffers, the bpp-core HMM being only used (and then brought up to
+   * date) for derivatives.
+   */
+  mutable ScaledHmmForwardBackward fb_;
+
+  mutable bool hmmUpToDate_;
+
 public:
   HmmProcessPhyloLikelihood(
     const AlignedValuesContainer& data,
@@ -86,13 +96,17 @@ public:
     AbstractAlignedPhyloLikelihood(mlc),
     MultiProcessSequencePhyloLikelihood(mlc),
     Hpep_(std::unique_ptr<HmmProcessEmissionProbabilities>(mlc.Hpep_->clone())),
-    Hmm_(std::unique_ptr<LogsumHmmLikelihood>(mlc.Hmm_->clone())) {}
+    Hmm_(std::unique_ptr<LogsumHmmLikelihood>(mlc.Hmm_->clone())),
+    fb_(mlc.fb_),
+    hmmUpToDate_(mlc.hmmUpToDate_) {}
 
   HmmProcessPhyloLikelihood& operator=(const HmmProcessPhyloLikelihood& mlc)
   {
     MultiProcessSequencePhyloLikelihood::operator=(mlc);
     Hpep_ = std::unique_ptr<HmmProcessEmissionProbabilities>(mlc.Hpep_->clone());
     Hmm_ = std::unique_ptr<LogsumHmmLikelihood>(mlc.Hmm_->clone());
+    fb_ = mlc.fb_;
+    hmmUpToDate_ = mlc.hmmUpToDate_;
     return *this;
   }
 
@@ -103,6 +117,17 @@ public:
 public:
   void setNamespace(const std::string& nameSpace);
 
+  /**
+   * @brief Set the number of threads running the forward and backward
+   * recursions over blocks of sites (1 by default).
+   *
+   * @see ScaledHmmForwardBackward::setNumberOfThreads
+   */
+  void setNumberOfForwardThreads(size_t nbThreads)
+  {
+    fb_.setNumberOfThreads(nbThreads);
+  }
+
   void fireParameterChanged(const ParameterList& parameters);
 
   void updateLikelihood() const
@@ -116,7 +141,11 @@ public:
     if (computeLikelihoods_)
     {
       MultiProcessSequencePhyloLikelihood::computeLikelihood();
-      Hmm_->computeLikelihood();
+
+      const HmmTransitionMatrix& htm = Hmm_->getHmmTransitionMatrix();
+      fb_.resize(getNumberOfSites(), getNumberOfSubstitutionProcess());
+      Hpep_->fillEmissionProbabilities(fb_.getEmissions());
+      fb_.computeForward(htm.getPij(), htm.getEquilibriumFrequencies());
 
       computeLikelihoods_ = false;
     }
@@ -132,7 +161,7 @@ public:
     updateLikelihood();
     computeLikelihood();
 
-    return Hmm_->getLogLikelihood();
+    return fb_.getLogLikelihood();
   }
 
   double getDLogLikelihood(const std::string& variable) const
@@ -156,7 +185,7 @@ public:
     updateLikelihood();
     computeLikelihood();
 
-    return Hmm_->getLikelihoodForASite(site);
+    return fb_.getLikelihoodForASite(site);
   }
 
   double getLogLikelihoodForASite(size_t site) const
@@ -164,7 +193,7 @@ public:
     updateLikelihood();
     computeLikelihood();
 
-    return log(Hmm_->getLikelihoodForASite(site));
+    return log(fb_.getLikelihoodForASite(site));
   }
 
   double getDLogLikelihoodForASite(const std::string& variable, size_t site) const
@@ -182,7 +211,7 @@ public:
     updateLikelihood();
     computeLikelihood();
 
-    return Hmm_->getLikelihoodForEachSite();
+    return fb_.getLikelihoodPerSite();
   }
 
   VVdouble getPosteriorProbabilitiesPerSitePerProcess() const
@@ -191,7 +220,7 @@ public:
     computeLikelihood();
 
     VVdouble pp;
-    Hmm_->getHiddenStatesPosteriorProbabilities(pp, false);
+    fb_.getPosteriorProbabilities(pp);
     return pp;
   }
 
@@ -203,6 +232,7 @@ public:
 protected:
   void computeDLogLikelihood_(const std::string& variable) const
   {
+    updateHmm_();
     Hmm_->getFirstOrderDerivative(variable);
     dValues_[variable]= std::nan("");
   }
@@ -210,10 +240,23 @@ protected:
 
   void computeD2LogLikelihood_(const std::string& variable) const
   {
+    updateHmm_();
     Hmm_->getSecondOrderDerivative(variable);
     d2Values_[variable]= std::nan("");
   }
 
+private:
+  void updateHmm_() const
+  {
+    if (hmmUpToDate_)
+      return;
+
+    updateLikelihood();
+    computeLikelihood();
+    Hmm_->computeLikelihood();
+    hmmUpToDate_ = true;
+  }
+
 
   /*
    * @}
@@ -0,0 +1,201 @@
+//
+// File: MPIProductOfPhyloLikelihood.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "MPIProductOfPhyloLikelihood.h"
+#include "AlignedPhyloLikelihood.h"
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+
+using namespace std;
+
+MPIProductOfPhyloLikelihood::MPIProductOfPhyloLikelihood(PhyloLikelihoodContainer* pC, MPI_Comm comm, const std::string& prefix) :
+  AbstractPhyloLikelihood(),
+  SetOfAbstractPhyloLikelihood(pC, prefix),
+  comm_(comm),
+  rank_(0),
+  nbRanks_(1),
+  memberRanks_()
+{
+  MPI_Comm_rank(comm_, &rank_);
+  MPI_Comm_size(comm_, &nbRanks_);
+}
+
+/******************************************************************************/
+
+bool MPIProductOfPhyloLikelihood::addPhyloLikelihood(size_t nPhyl)
+{
+  if (SetOfAbstractPhyloLikelihood::addPhyloLikelihood(nPhyl))
+  {
+    distributeMembers_();
+    return true;
+  }
+  return false;
+}
+
+void MPIProductOfPhyloLikelihood::distributeMembers_()
+{
+  size_t nbPhylo = nPhylo_.size();
+  vector<size_t> weights(nbPhylo, 1);
+  for (size_t i=0; i<nbPhylo; i++)
+  {
+    const AlignedPhyloLikelihood* aPL=dynamic_cast<const AlignedPhyloLikelihood*>(getAbstractPhyloLikelihood(nPhylo_[i]));
+    if (aPL)
+      weights[i]=aPL->getNumberOfSites();
+  }
+  
+  vector<size_t> order(nbPhylo);
+  for (size_t i=0; i<nbPhylo; i++)
+    order[i]=i;
+  stable_sort(order.begin(), order.end(), [&weights](size_t a, size_t b) { return weights[a] > weights[b]; });
+
+  // Same on all ranks: ties go to the lowest rank.
+  vector<size_t> loads(static_cast<size_t>(nbRanks_), 0);
+  memberRanks_.assign(nbPhylo, 0);
+  for (size_t i : order)
+  {
+    size_t r = static_cast<size_t>(min_element(loads.begin(), loads.end()) - loads.begin());
+    memberRanks_[i] = static_cast<int>(r);
+    loads[r] += weights[i];
+  }
+}
+
+vector<size_t> MPIProductOfPhyloLikelihood::getComputedPhyloLikelihoods_() const
+{
+  vector<size_t> members;
+  for (size_t i=0; i<nPhylo_.size(); i++)
+    if (memberRanks_[i]==rank_)
+      members.push_back(nPhylo_[i]);
+  return members;
+}
+
+/******************************************************************************/
+
+void MPIProductOfPhyloLikelihood::initialize()
+{
+  AbstractPhyloLikelihood::initialize();
+  for (size_t nPhyl : getComputedPhyloLikelihoods_())
+    getAbstractPhyloLikelihood(nPhyl)->initialize();
+  buildParameterIndex_();
+}
+
+bool MPIProductOfPhyloLikelihood::isInitialized() const
+{
+  for (size_t nPhyl : getComputedPhyloLikelihoods_())
+    if (!getAbstractPhyloLikelihood(nPhyl)->isInitialized())
+      return false;
+  return true;
+}
+
+void MPIProductOfPhyloLikelihood::updateLikelihood() const
+{
+  if (computeLikelihoods_)
+  {
+    for (size_t nPhyl : getComputedPhyloLikelihoods_())
+      getAbstractPhyloLikelihood(nPhyl)->updateLikelihood();
+  }
+}
+
+void MPIProductOfPhyloLikelihood::fireParameterChanged(const ParameterList& params)
+{
+  // Values of rank 0, so that all ranks compute with the same ones.
+  vector<double> values(params.size());
+  for (size_t i=0; i<params.size(); i++)
+    values[i]=params[i].getValue();
+  MPI_Bcast(values.data(), static_cast<int>(values.size()), MPI_DOUBLE, 0, comm_);
+
+  ParameterList pl(params);
+  for (size_t i=0; i<pl.size(); i++)
+  {
+    pl[i].setValue(values[i]);
+    if (hasParameter(pl[i].getName()))
+      getParameter_(pl[i].getName()).setValue(values[i]);
+  }
+
+  vector<bool> changed=getChangedPhyloLikelihoods_(pl);
+  
+  for (size_t i=0; i<nPhylo_.size(); i++)
+  {
+    if (!changed[i] || memberRanks_[i]!=rank_)
+      continue;
+    
+    getAbstractPhyloLikelihood(nPhylo_[i])->matchParametersValues(pl);
+    getAbstractPhyloLikelihood(nPhylo_[i])->update();
+  }
+  
+  update();
+}
+
+/******************************************************************************/
+
+double MPIProductOfPhyloLikelihood::sumOverRanks_(double value) const
+{
+  double sum = 0;
+  MPI_Reduce(&value, &sum, 1, MPI_DOUBLE, MPI_SUM, 0, comm_);
+  MPI_Bcast(&sum, 1, MPI_DOUBLE, 0, comm_);
+  return sum;
+}
+
+double MPIProductOfPhyloLikelihood::localSum_(const std::function<double(const AbstractPhyloLikelihood&)>& f) const
+{
+  double x = 0;
+  for (size_t nPhyl : getComputedPhyloLikelihoods_())
+    x += f(*getAbstractPhyloLikelihood(nPhyl));
+  return x;
+}
+
+double MPIProductOfPhyloLikelihood::getLogLikelihood() const
+{
+  updateLikelihood();
+  computeLikelihood();
+
+  return sumOverRanks_(localSum_([](const AbstractPhyloLikelihood& aPL) { return aPL.getLogLikelihood(); }));
+}
+
+double MPIProductOfPhyloLikelihood::getDLogLikelihood(const std::string& variable) const
+{
+  return sumOverRanks_(localSum_([&variable](const AbstractPhyloLikelihood& aPL) { return aPL.getDLogLikelihood(variable); }));
+}
+
+double MPIProductOfPhyloLikelihood::getD2LogLikelihood(const std::string& variable) const
+{
+  return sumOverRanks_(localSum_([&variable](const AbstractPhyloLikelihood& aPL) { return aPL.getD2LogLikelihood(variable); }));
+}
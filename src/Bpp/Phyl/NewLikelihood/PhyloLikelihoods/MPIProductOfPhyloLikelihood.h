@@ -0,0 +1,170 @@
+//
+// File: MPIProductOfPhyloLikelihood.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _MPI_PRODUCT_OF_PHYLOLIKELIHOOD_H_
+#define _MPI_PRODUCT_OF_PHYLOLIKELIHOOD_H_
+
+#include "SetOfAbstractPhyloLikelihood.h"
+
+#include <mpi.h>
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+
+  /**
+   * @brief The MPIProductOfPhyloLikelihood class, for the likelihood
+   * of independent data sets (genes, partitions) computed by the
+   * processes of an MPI communicator.
+   *
+   * The likelihood is the product of the member likelihoods (the log
+   * likelihood is the sum of their log likelihoods). Members are
+   * distributed over the ranks of the communicator, balanced by their
+   * number of sites (aligned members, 1 for the others): each process
+   * only initializes and computes its own members, possibly with
+   * several threads (see setNumberOfThreads()).
+   *
+   * All processes must build the same object (same container, same
+   * members, in the same order), and call its methods in the same
+   * order: this is the case when they all run the same optimizer.
+   * Values and derivatives are summed over the ranks (MPI_Reduce),
+   * then broadcast from rank 0, so that all processes get exactly the
+   * same values and take the same decisions. Parameter values are
+   * also broadcast from rank 0 when they change.
+   *
+   * Available only if bpp-phyl is built with the WITH_MPI CMake option.
+   *
+   */
+  
+  class MPIProductOfPhyloLikelihood:
+    public SetOfAbstractPhyloLikelihood
+  {
+  private:
+    MPI_Comm comm_;
+
+    int rank_;
+
+    int nbRanks_;
+
+    /**
+     * @brief For each position in nPhylo_, the rank computing the member.
+     *
+     */
+    
+    std::vector<int> memberRanks_;
+    
+  public:
+    MPIProductOfPhyloLikelihood(PhyloLikelihoodContainer* pC, MPI_Comm comm = MPI_COMM_WORLD, const std::string& prefix = "");
+
+    ~MPIProductOfPhyloLikelihood() {}
+    
+    MPIProductOfPhyloLikelihood* clone() const
+    {
+      return new MPIProductOfPhyloLikelihood(*this);
+    }
+
+  public:
+    int getRank() const { return rank_; }
+
+    int getNumberOfRanks() const { return nbRanks_; }
+
+    /**
+     * @return The rank computing each member, in the order of
+     * getNumbersOfPhyloLikelihoods().
+     *
+     */
+    
+    const std::vector<int>& getMemberRanks() const { return memberRanks_; }
+
+    bool addPhyloLikelihood(size_t nPhyl);
+    
+    void initialize();
+
+    bool isInitialized() const;
+
+    void updateLikelihood() const;
+
+    void fireParameterChanged(const ParameterList& params);
+
+    /**
+     * @name The likelihood functions: collective calls.
+     *
+     * @{
+     */
+    
+    double getLogLikelihood() const;
+
+    double getDLogLikelihood(const std::string& variable) const;
+
+    double getD2LogLikelihood(const std::string& variable) const;
+
+    /** @} */
+    
+  protected:
+    std::vector<size_t> getComputedPhyloLikelihoods_() const;
+
+  private:
+    /**
+     * @brief Distribute the members over the ranks, largest first,
+     * each to the least loaded rank.
+     *
+     */
+    
+    void distributeMembers_();
+
+    /**
+     * @brief Sum of the values of all ranks, identical on all of them.
+     *
+     */
+    
+    double sumOverRanks_(double value) const;
+
+    /**
+     * @brief Sum over the local members of the given value.
+     *
+     */
+    
+    double localSum_(const std::function<double(const AbstractPhyloLikelihood&)>& f) const;
+  };
+
+} //end of namespace bpp.
+
+#endif  //_MPI_PRODUCT_OF_PHYLOLIKELIHOOD_H_
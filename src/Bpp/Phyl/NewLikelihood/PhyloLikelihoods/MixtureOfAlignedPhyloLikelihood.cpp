@@ -40,13 +40,21 @@
 #include "MixtureOfAlignedPhyloLikelihood.h"
 
 using namespace bpp;
+
+// From the STL:
+#include <cmath>
+
 using namespace std;
 
 MixtureOfAlignedPhyloLikelihood::MixtureOfAlignedPhyloLikelihood(PhyloLikelihoodContainer* pC, const std::vector<size_t>& nPhylo) :
   AbstractPhyloLikelihood(),
   AbstractAlignedPhyloLikelihood(0),
   SetOfAlignedPhyloLikelihood(pC, nPhylo, ""),
-  simplex_(getNumbersOfPhyloLikelihoods().size(), 1, false, "Mixture.")
+  simplex_(getNumbersOfPhyloLikelihoods().size(), 1, false, "Mixture."),
+  logLikelihoods_(),
+  logLikelihoodsUpToDate_(false),
+  dProbs_(),
+  d2Probs_()
 {
   addParameters_(simplex_.getParameters());
   update();  
@@ -57,7 +65,11 @@ MixtureOfAlignedPhyloLikelihood::MixtureOfAlignedPhyloLikelihood(const MixtureOf
   AbstractPhyloLikelihood(sd),
   AbstractAlignedPhyloLikelihood(sd),
   SetOfAlignedPhyloLikelihood(sd),
-  simplex_(sd.simplex_)
+  simplex_(sd.simplex_),
+  logLikelihoods_(sd.logLikelihoods_),
+  logLikelihoodsUpToDate_(sd.logLikelihoodsUpToDate_),
+  dProbs_(sd.dProbs_),
+  d2Probs_(sd.d2Probs_)
 {
 }
 
@@ -65,6 +77,10 @@ MixtureOfAlignedPhyloLikelihood& MixtureOfAlignedPhyloLikelihood::operator=(cons
 {
   SetOfAlignedPhyloLikelihood::operator=(sd);
   simplex_=sd.simplex_;
+  logLikelihoods_=sd.logLikelihoods_;
+  logLikelihoodsUpToDate_=sd.logLikelihoodsUpToDate_;
+  dProbs_=sd.dProbs_;
+  d2Probs_=sd.d2Probs_;
   
   return *this;
 }
@@ -82,12 +98,153 @@ void MixtureOfAlignedPhyloLikelihood::fireParameterChanged(const ParameterList&
 {
   simplex_.matchParametersValues(parameters);
   SetOfAbstractPhyloLikelihood::fireParameterChanged(parameters);
+
+  logLikelihoodsUpToDate_=false;
+  dProbs_.clear();
+  d2Probs_.clear();
   
   update();
 }
 
 /******************************************************************************/
 
+void MixtureOfAlignedPhyloLikelihood::updateLogLikelihoods_() const
+{
+  if (logLikelihoodsUpToDate_)
+    return;
+  
+  updateLikelihood();
+  computeLikelihood();
+
+  const std::vector<size_t>& nPhylo=getNumbersOfPhyloLikelihoods();
+  size_t nbPhylo=nPhylo.size();
+  
+  logLikelihoods_.resize(nbSites_ * nbPhylo);
+  for (size_t i=0; i<nbPhylo; i++)
+  {
+    const AbstractAlignedPhyloLikelihood* aPL=getAbstractPhyloLikelihood(nPhylo[i]);
+    for (size_t j=0; j<nbSites_; j++)
+      logLikelihoods_[j * nbPhylo + i] = aPL->getLogLikelihoodForASite(j);
+  }
+  
+  logLikelihoodsUpToDate_=true;
+}
+
+/******************************************************************************/
+
+double MixtureOfAlignedPhyloLikelihood::getCachedLogLikelihoodForASite_(size_t site) const
+{
+  size_t nbPhylo=getNumbersOfPhyloLikelihoods().size();
+  const vector<double>& probs=simplex_.getFrequencies();
+  const double* ll=&logLikelihoods_[site * nbPhylo];
+
+  double lmax=-INFINITY;
+  for (size_t i=0; i<nbPhylo; i++)
+    if (probs[i]>0 && ll[i]>lmax)
+      lmax=ll[i];
+
+  double x=0;
+  for (size_t i=0; i<nbPhylo; i++)
+    if (probs[i]>0)
+      x += probs[i] * exp(ll[i] - lmax);
+
+  return lmax + log(x);
+}
+
+/******************************************************************************/
+
+void MixtureOfAlignedPhyloLikelihood::computeDProbs_(const std::string& variable) const
+{
+  if (dProbs_.find(variable)!=dProbs_.end())
+    return;
+
+  const double h=0.0001;
+  double x=simplex_.getParameters().getParameter(variable).getValue();
+  const vector<double>& probs=simplex_.getFrequencies();
+  size_t nbPhylo=probs.size();
+  
+  // Probabilities slightly on each side of the current value, with a
+  // one-sided difference at the bounds of the parameter:
+  Simplex si(simplex_);
+  ParameterList pl=si.getParameters();
+
+  vector<double> vPlus(probs), vMinus(probs);
+  double hPlus=0, hMinus=0;
+  try 
+  {
+    pl.setParameterValue(variable, x + h);
+    si.matchParametersValues(pl);
+    vPlus=si.getFrequencies();
+    hPlus=h;
+  }
+  catch (Exception& e) {}
+  
+  try 
+  {
+    pl.setParameterValue(variable, x - h);
+    si.matchParametersValues(pl);
+    vMinus=si.getFrequencies();
+    hMinus=h;
+  }
+  catch (Exception& e) {}
+
+  vector<double>& dp=dProbs_[variable];
+  vector<double>& d2p=d2Probs_[variable];
+  dp.assign(nbPhylo, 0);
+  d2p.assign(nbPhylo, 0);
+  
+  if (hPlus + hMinus == 0)
+    return;
+  
+  for (size_t i=0; i<nbPhylo; i++)
+  {
+    dp[i] = (vPlus[i] - vMinus[i]) / (hPlus + hMinus);
+    if (hPlus>0 && hMinus>0)
+      d2p[i] = (vPlus[i] - 2 * probs[i] + vMinus[i]) / (h * h);
+  }
+}
+
+/******************************************************************************/
+
+void MixtureOfAlignedPhyloLikelihood::computeDLogLikelihood_(const std::string& variable) const
+{
+  updateLogLikelihoods_();
+  
+  if (simplex_.hasParameter(variable))
+    computeDProbs_(variable);
+  else
+    runOnPhyloLikelihoods_([&variable](const AbstractPhyloLikelihood& aPL)
+                           {
+                             if (aPL.hasParameter(variable))
+                               aPL.computeDLogLikelihood_(variable);
+                           });
+  
+  dValues_[variable]= nan("");
+}
+
+/******************************************************************************/
+
+void MixtureOfAlignedPhyloLikelihood::computeD2LogLikelihood_(const std::string& variable) const
+{
+  updateLogLikelihoods_();
+  
+  if (simplex_.hasParameter(variable))
+    computeDProbs_(variable);
+  else
+    runOnPhyloLikelihoods_([&variable](const AbstractPhyloLikelihood& aPL)
+                           {
+                             if (aPL.hasParameter(variable))
+                             {
+                               aPL.computeDLogLikelihood_(variable);
+                               aPL.computeD2LogLikelihood_(variable);
+                             }
+                           });
+  
+  d2Values_[variable]= nan("");
+}
+
+/******************************************************************************/
+
 double MixtureOfAlignedPhyloLikelihood::getLogLikelihood() const
 {
   updateLikelihood();
@@ -166,13 +323,36 @@ double MixtureOfAlignedPhyloLikelihood::getDLogLikelihood(const std::string& var
 
 double MixtureOfAlignedPhyloLikelihood::getDLogLikelihoodForASite(const std::string& variable, size_t site) const
 {
-  const std::vector<size_t>& nPhylo=getNumbersOfPhyloLikelihoods();
-  vector<double> vD(nPhylo.size());
-        
-  for (size_t i=0; i<nPhylo.size(); i++)
-    vD[i] = getAbstractPhyloLikelihood(nPhylo[i])->getDLogLikelihoodForASite(variable, site);
+  updateLogLikelihoods_();
 
-  return VectorTools::logSumExp(vD, simplex_.getFrequencies());
+  const std::vector<size_t>& nPhylo=getNumbersOfPhyloLikelihoods();
+  size_t nbPhylo=nPhylo.size();
+  const double* ll=&logLikelihoods_[site * nbPhylo];
+  double lmix=getCachedLogLikelihoodForASite_(site);
+
+  // dL/L = sum_i dp_i L_i / L for the probabilities,
+  //        sum_i p_i L_i / L * dlogL_i for the members.
+  double d=0;
+  if (simplex_.hasParameter(variable))
+  {
+    computeDProbs_(variable);
+    const vector<double>& dp=dProbs_[variable];
+    for (size_t i=0; i<nbPhylo; i++)
+      if (dp[i]!=0)
+        d += dp[i] * exp(ll[i] - lmix);
+  }
+  else
+  {
+    const vector<double>& probs=simplex_.getFrequencies();
+    for (size_t i=0; i<nbPhylo; i++)
+    {
+      const AbstractAlignedPhyloLikelihood* aPL=getAbstractPhyloLikelihood(nPhylo[i]);
+      if (probs[i]>0 && aPL->hasParameter(variable))
+        d += probs[i] * exp(ll[i] - lmix) * aPL->getDLogLikelihoodForASite(variable, site);
+    }
+  }
+  
+  return d;
 }
 
 /******************************************************************************/
@@ -198,23 +378,51 @@ double MixtureOfAlignedPhyloLikelihood::getD2LogLikelihood(const std::string& va
 
 double MixtureOfAlignedPhyloLikelihood::getD2LogLikelihoodForASite(const std::string& variable, size_t site) const
 {
-  const std::vector<size_t>& nPhylo=getNumbersOfPhyloLikelihoods();
-  vector<double> vD2(nPhylo.size());
-        
-  for (size_t i=0; i<nPhylo.size(); i++)
-    vD2[i] = getAbstractPhyloLikelihood(nPhylo[i])->getD2LogLikelihoodForASite(variable, site);
+  updateLogLikelihoods_();
 
-  return VectorTools::logSumExp(vD2, simplex_.getFrequencies());
+  const std::vector<size_t>& nPhylo=getNumbersOfPhyloLikelihoods();
+  size_t nbPhylo=nPhylo.size();
+  const double* ll=&logLikelihoods_[site * nbPhylo];
+  double lmix=getCachedLogLikelihoodForASite_(site);
+
+  // d2logL = d2L/L - (dL/L)^2, with
+  // d2L/L = sum_i d2p_i L_i / L for the probabilities,
+  //         sum_i p_i L_i / L * (d2logL_i + dlogL_i^2) for the members.
+  double d=0, d2=0;
+  if (simplex_.hasParameter(variable))
+  {
+    computeDProbs_(variable);
+    const vector<double>& dp=dProbs_[variable];
+    const vector<double>& d2p=d2Probs_[variable];
+    for (size_t i=0; i<nbPhylo; i++)
+    {
+      double r=exp(ll[i] - lmix);
+      d += dp[i] * r;
+      d2 += d2p[i] * r;
+    }
+  }
+  else
+  {
+    const vector<double>& probs=simplex_.getFrequencies();
+    for (size_t i=0; i<nbPhylo; i++)
+    {
+      const AbstractAlignedPhyloLikelihood* aPL=getAbstractPhyloLikelihood(nPhylo[i]);
+      if (probs[i]==0 || !aPL->hasParameter(variable))
+        continue;
+      double w=probs[i] * exp(ll[i] - lmix);
+      double di=aPL->getDLogLikelihoodForASite(variable, site);
+      d += w * di;
+      d2 += w * (aPL->getD2LogLikelihoodForASite(variable, site) + di * di);
+    }
+  }
+  
+  return d2 - d * d;
 }
 
 /******************************************************************************/
 
 ParameterList MixtureOfAlignedPhyloLikelihood::getNonDerivableParameters() const
 {
-  ParameterList pl=SetOfAlignedPhyloLikelihood::getNonDerivableParameters();
-  
-  pl.includeParameters(simplex_.getParameters());
-
-  return pl;
+  return SetOfAlignedPhyloLikelihood::getNonDerivableParameters();
 }
 
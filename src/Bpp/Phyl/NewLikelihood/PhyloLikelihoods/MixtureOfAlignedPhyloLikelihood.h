@@ -48,6 +48,9 @@
 
 #include <Bpp/Numeric/Prob/Simplex.h>
 
+// From the STL:
+#include <map>
+
 namespace bpp
 {
 /**
@@ -72,6 +75,25 @@ namespace bpp
 
     Simplex simplex_;
 
+    /**
+     * @brief Log-likelihoods of the members for each site, stored as
+     * [site * nbMembers + member], computed once per parameter change
+     * and shared by all derivatives.
+     *
+     */
+
+    mutable std::vector<double> logLikelihoods_;
+
+    mutable bool logLikelihoodsUpToDate_;
+
+    /**
+     * @brief First and second derivatives of the probabilities wrt
+     * the simplex parameters, [member] for each variable.
+     *
+     */
+
+    mutable std::map<std::string, std::vector<double> > dProbs_, d2Probs_;
+
   public:
     MixtureOfAlignedPhyloLikelihood(PhyloLikelihoodContainer* pC, const std::vector<size_t>& nPhylo);
       
@@ -89,19 +111,43 @@ namespace bpp
     void setPhyloProb(const Simplex& si);
 
   protected:
-      
-    void computeDLogLikelihood_(const std::string& variable) const
-    {
-      SetOfAbstractPhyloLikelihood::computeDLogLikelihood_(variable);
-    }
 
-    void computeD2LogLikelihood_(const std::string& variable) const
-    {
-      SetOfAbstractPhyloLikelihood::computeD2LogLikelihood_(variable);
-    }
+    /**
+     * @brief Derivatives wrt the simplex parameters only rescale the
+     * member likelihoods, and are computed from the cached
+     * log-likelihoods without calling the members. Otherwise only the
+     * members depending on the variable compute their derivatives.
+     *
+     */
+    
+    void computeDLogLikelihood_(const std::string& variable) const;
+
+    void computeD2LogLikelihood_(const std::string& variable) const;
 
     void fireParameterChanged(const ParameterList& parameters);
 
+  private:
+    
+    void updateLogLikelihoods_() const;
+
+    /**
+     * @brief Compute the derivatives of the probabilities wrt a
+     * simplex parameter, by central differences on a copy of the
+     * simplex (the probabilities are linear in each parameter with
+     * the parametrization used here, so these are exact).
+     *
+     */
+    
+    void computeDProbs_(const std::string& variable) const;
+
+    /**
+     * @brief The log-likelihood of the site, from the cached
+     * log-likelihoods of the members.
+     *
+     */
+    
+    double getCachedLogLikelihoodForASite_(size_t site) const;
+
   public:
 
     /**
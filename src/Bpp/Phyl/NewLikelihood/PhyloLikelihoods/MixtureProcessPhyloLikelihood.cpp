@@ -56,7 +56,8 @@ MixtureProcessPhyloLikelihood::MixtureProcessPhyloLikelihood(
   AbstractPhyloLikelihood(),
   AbstractAlignedPhyloLikelihood(data.getNumberOfSites()),
   MultiProcessSequencePhyloLikelihood(data, processSeqEvol, nSeqEvol, nData, verbose, patterns),
-  mSeqEvol_(processSeqEvol)
+  mSeqEvol_(processSeqEvol),
+  derivedProcesses_()
 {
 }
 
@@ -91,12 +92,22 @@ double MixtureProcessPhyloLikelihood::getDLogLikelihoodForASite(const std::strin
   if (!hasParameter(variable) || (variable.compare(0,5,"BrLen")!=0))
     return 0;
 
-  Vdouble vD;
-
+  if (derivedProcesses_.size()!=vpTreelik_.size())
+    computeDLogLikelihood_(variable);
+  
+  // dlogL = sum_i p_i L_i / L * dlogL_i
+  double lmix=getLogLikelihoodForASite(site);
+  
+  double d=0;
   for (size_t i = 0; i < vpTreelik_.size(); i++)
-    vD.push_back(vpTreelik_[i]->getDLogLikelihoodForASite(site));
-
-  return VectorTools::logSumExp(vD,mSeqEvol_.getSubProcessProbabilities());
+  {
+    if (!derivedProcesses_[i] || getSubProcessProb(i)==0)
+      continue;
+    double w=getSubProcessProb(i) * exp(vpTreelik_[i]->getLogLikelihoodForASite(site) - lmix);
+    d += w * vpTreelik_[i]->getDLogLikelihoodForASite(site);
+  }
+  
+  return d;
 }
 
 /******************************************************************************/
@@ -108,12 +119,78 @@ double MixtureProcessPhyloLikelihood::getD2LogLikelihoodForASite(const std::stri
   if (!hasParameter(variable) || (variable.compare(0,5,"BrLen")!=0))
     return 0;
 
-  Vdouble vD2;
+  if (derivedProcesses_.size()!=vpTreelik_.size())
+    computeD2LogLikelihood_(variable);
+
+  // d2logL = sum_i p_i L_i / L * (d2logL_i + dlogL_i^2) - dlogL^2
+  double lmix=getLogLikelihoodForASite(site);
 
+  double d=0, d2=0;
   for (size_t i = 0; i < vpTreelik_.size(); i++)
-    vD2.push_back(vpTreelik_[i]->getD2LogLikelihoodForASite(site));
+  {
+    if (!derivedProcesses_[i] || getSubProcessProb(i)==0)
+      continue;
+    double w=getSubProcessProb(i) * exp(vpTreelik_[i]->getLogLikelihoodForASite(site) - lmix);
+    double di=vpTreelik_[i]->getDLogLikelihoodForASite(site);
+    d += w * di;
+    d2 += w * (vpTreelik_[i]->getD2LogLikelihoodForASite(site) + di * di);
+  }
+  
+  return d2 - d * d;
+}
+
+/******************************************************************************/
+
+void MixtureProcessPhyloLikelihood::computeDLogLikelihood_(const std::string& variable) const
+{
+  derivedProcesses_.assign(vpTreelik_.size(), false);
 
-  return VectorTools::logSumExp(vD2,mSeqEvol_.getSubProcessProbabilities());
+  if (hasParameter(variable) && variable.compare(0,5,"BrLen")==0)
+  {
+    vector<Vuint> vbrIds(vpTreelik_.size());
+    for (size_t i=0; i<vpTreelik_.size(); i++)
+    {
+      vbrIds[i]=getBranchIds_(variable, i);
+      derivedProcesses_[i]=(vbrIds[i].size()!=0);
+    }
+    
+    runOnProcesses_(ComputingNode::D1, vbrIds, [this, &vbrIds](size_t i)
+                    {
+                      if (derivedProcesses_[i])
+                        vpTreelik_[i]->computeTreeDLogLikelihood(vbrIds[i]);
+                    });
+  }
+  
+  dValues_[variable]= std::nan("");
+}
+
+/******************************************************************************/
+
+void MixtureProcessPhyloLikelihood::computeD2LogLikelihood_(const std::string& variable) const
+{
+  derivedProcesses_.assign(vpTreelik_.size(), false);
+
+  // The first order derivatives are needed too:
+  if (hasParameter(variable) && variable.compare(0,5,"BrLen")==0)
+  {
+    vector<Vuint> vbrIds(vpTreelik_.size());
+    for (size_t i=0; i<vpTreelik_.size(); i++)
+    {
+      vbrIds[i]=getBranchIds_(variable, i);
+      derivedProcesses_[i]=(vbrIds[i].size()!=0);
+    }
+    
+    runOnProcesses_(ComputingNode::D2, vbrIds, [this, &vbrIds](size_t i)
+                    {
+                      if (derivedProcesses_[i])
+                      {
+                        vpTreelik_[i]->computeTreeDLogLikelihood(vbrIds[i]);
+                        vpTreelik_[i]->computeTreeD2LogLikelihood(vbrIds[i]);
+                      }
+                    });
+  }
+  
+  d2Values_[variable]= std::nan("");
 }
 
 /******************************************************************************/
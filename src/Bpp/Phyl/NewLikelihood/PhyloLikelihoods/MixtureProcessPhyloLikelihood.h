@@ -70,6 +70,14 @@ namespace bpp
        */
 
       MixtureSequenceEvolution& mSeqEvol_;
+
+      /**
+       * @brief Tells which processes depend on the last derived
+       * variable, the other ones having null derivatives.
+       *
+       */
+      
+      mutable std::vector<bool> derivedProcesses_;
       
     public:
       MixtureProcessPhyloLikelihood(
@@ -84,13 +92,15 @@ namespace bpp
         AbstractPhyloLikelihood(mlc),
         AbstractAlignedPhyloLikelihood(mlc),
         MultiProcessSequencePhyloLikelihood(mlc),
-        mSeqEvol_(mlc.mSeqEvol_)
+        mSeqEvol_(mlc.mSeqEvol_),
+        derivedProcesses_(mlc.derivedProcesses_)
       {}
 
       MixtureProcessPhyloLikelihood& operator=(const MixtureProcessPhyloLikelihood& mlc)
       {
         MultiProcessSequencePhyloLikelihood::operator=(mlc);
         mSeqEvol_=mlc.mSeqEvol_;
+        derivedProcesses_=mlc.derivedProcesses_;
         
         return *this;
       }
@@ -136,6 +146,18 @@ namespace bpp
       /*
        * @}
        */
+
+    protected:
+
+      /**
+       * @brief Derivatives are only computed for the processes whose
+       * tree has the derived branch length.
+       *
+       */
+      
+      void computeDLogLikelihood_(const std::string& variable) const;
+
+      void computeD2LogLikelihood_(const std::string& variable) const;
     };
 } // end of namespace bpp.
 
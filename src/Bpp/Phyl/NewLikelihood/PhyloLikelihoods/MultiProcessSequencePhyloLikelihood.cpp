@@ -57,6 +57,8 @@ MultiProcessSequencePhyloLikelihood::MultiProcessSequencePhyloLikelihood(
   AbstractAlignedPhyloLikelihood(data.getNumberOfSites()),
   AbstractSequencePhyloLikelihood(processSeqEvol, nSeqEvol, nData),
   mSeqEvol_(processSeqEvol),
+  nbThreads_(1),
+  executor_(),
   vpTreelik_()
 {
   // initialize parameters:
@@ -81,9 +83,14 @@ void MultiProcessSequencePhyloLikelihood::setData(const AlignedValuesContainer&
 {
   AbstractSequencePhyloLikelihood::setData(sites, nData);
   
+  // The processes share the data subset and the site compression
+  // of the first one when they have the same leaves.
   for (size_t i = 0; i < vpTreelik_.size(); i++)
   {
-    vpTreelik_[i]->setData(sites);
+    if (i == 0)
+      vpTreelik_[i]->setData(sites);
+    else
+      vpTreelik_[i]->setData(sites, *vpTreelik_[0]);
   }
   updateLikelihood();
   computeLikelihood();
@@ -107,12 +114,63 @@ VVdouble MultiProcessSequencePhyloLikelihood::getLikelihoodPerSitePerProcess() c
 }
 
 
+/******************************************************************************/
+
+void MultiProcessSequencePhyloLikelihood::computeLikelihood() const
+{
+  if (computeLikelihoods_)
+  {
+    runOnProcesses_(ComputingNode::D0, vector<Vuint>(), [this](size_t i)
+                    {
+                      vpTreelik_[i]->computeTreeLikelihood();
+                    });
+
+    computeLikelihoods_=false;
+  }
+}
+
+/******************************************************************************/
+
+void MultiProcessSequencePhyloLikelihood::runOnProcesses_(unsigned char DX, const std::vector<Vuint>& vbrIds, const std::function<void(size_t)>& f) const
+{
+  size_t nbProc=vpTreelik_.size();
+  size_t nbThreads=min(nbThreads_, nbProc);
+
+  if (nbThreads <= 1)
+  {
+    for (size_t i=0; i<nbProc; i++)
+      f(i);
+    return;
+  }
+
+  for (size_t i=0; i<nbProc; i++)
+    vpTreelik_[i]->prepareTransitionProbabilities(DX, DX == ComputingNode::D0 ? Vuint() : vbrIds[i]);
+
+  if (!executor_ || executor_->getNumberOfThreads() != nbThreads)
+    executor_.reset(new SiteLoopExecutor(nbThreads));
+
+  executor_->run(nbProc, [&f](size_t first, size_t last)
+                 {
+                   for (size_t i=first; i<last; i++)
+                     f(i);
+                 });
+}
+
 /******************************************************************************/
 
 void MultiProcessSequencePhyloLikelihood::computeDLogLikelihood_(const std::string& variable) const
 {
-  for (size_t i=0; i<vpTreelik_.size();i++)
-    computeDLogLikelihoodForAProcess(variable, i);
+  if (hasParameter(variable) && (variable.compare(0,5,"BrLen")==0))
+  {
+    vector<Vuint> vbrIds(vpTreelik_.size());
+    for (size_t i=0; i<vpTreelik_.size();i++)
+      vbrIds[i]=getBranchIds_(variable, i);
+
+    runOnProcesses_(ComputingNode::D1, vbrIds, [this, &vbrIds](size_t i)
+                    {
+                      vpTreelik_[i]->computeTreeDLogLikelihood(vbrIds[i]);
+                    });
+  }
   
   dValues_[variable]= std::nan("");
 }
@@ -121,8 +179,17 @@ void MultiProcessSequencePhyloLikelihood::computeDLogLikelihood_(const std::stri
 
 void MultiProcessSequencePhyloLikelihood::computeD2LogLikelihood_(const std::string& variable) const
 {
-  for (size_t i=0; i<vpTreelik_.size();i++)
-    computeD2LogLikelihoodForAProcess(variable, i);
+  if (hasParameter(variable) && (variable.compare(0,5,"BrLen")==0))
+  {
+    vector<Vuint> vbrIds(vpTreelik_.size());
+    for (size_t i=0; i<vpTreelik_.size();i++)
+      vbrIds[i]=getBranchIds_(variable, i);
+
+    runOnProcesses_(ComputingNode::D2, vbrIds, [this, &vbrIds](size_t i)
+                    {
+                      vpTreelik_[i]->computeTreeD2LogLikelihood(vbrIds[i]);
+                    });
+  }
 
   d2Values_[variable]= std::nan("");
 }
@@ -130,13 +197,8 @@ void MultiProcessSequencePhyloLikelihood::computeD2LogLikelihood_(const std::str
 /******************************************************************************/
 
 
-void MultiProcessSequencePhyloLikelihood::computeDLogLikelihoodForAProcess(const std::string& variable, size_t p) const
+Vuint MultiProcessSequencePhyloLikelihood::getBranchIds_(const std::string& variable, size_t p) const
 {
-  // check it is a "BrLen" variable
-
-  if (!hasParameter(variable) || (variable.compare(0,5,"BrLen")!=0))
-    return;
-
   // Get the node with the branch whose length must be derivated:
   
   Vuint VbrId;
@@ -145,7 +207,7 @@ void MultiProcessSequencePhyloLikelihood::computeDLogLikelihoodForAProcess(const
   try {
     i=(size_t)atoi(variable.substr(variable.rfind('_')+1).c_str());
     if (p+1==i)
-      VbrId.push_back(atoi(variable.substr(5).c_str()));
+      VbrId.push_back((unsigned int)atoi(variable.substr(5).c_str()));
   }
   catch (exception& e){}
   
@@ -163,44 +225,30 @@ void MultiProcessSequencePhyloLikelihood::computeDLogLikelihoodForAProcess(const
     {}
   }
 
-  vpTreelik_[p]->computeTreeDLogLikelihood(VbrId);
+  return VbrId;
 }
 
-
 /************************************************************/
 
-void MultiProcessSequencePhyloLikelihood::computeD2LogLikelihoodForAProcess(const std::string& variable, size_t p) const
+void MultiProcessSequencePhyloLikelihood::computeDLogLikelihoodForAProcess(const std::string& variable, size_t p) const
 {
   // check it is a "BrLen" variable
 
   if (!hasParameter(variable) || (variable.compare(0,5,"BrLen")!=0))
     return;
 
-  // Get the node with the branch whose length must be derivated:
+  vpTreelik_[p]->computeTreeDLogLikelihood(getBranchIds_(variable, p));
+}
 
-  Vuint VbrId;
 
-  size_t i=0;
-  try {
-    i=(size_t)atoi(variable.substr(variable.rfind('_')+1).c_str());
-    if (p+1==i)
-      VbrId.push_back((unsigned int)atoi(variable.substr(5).c_str()));
-  }
-  catch (exception& e){}
-  
-  vector<string> valias= mSeqEvol_.getCollection().getAlias(variable);
-  
-  for (size_t v=0; v<valias.size();v++)
-  {
-    try {
-      i=(size_t)atoi(valias[v].substr(valias[v].rfind('_')+1).c_str());
-      if (p+1==i){
-        VbrId.push_back(atoi(valias[v].substr(5).c_str()));
-      }
-    }
-    catch (exception& e)
-    {}
-  }
+/************************************************************/
+
+void MultiProcessSequencePhyloLikelihood::computeD2LogLikelihoodForAProcess(const std::string& variable, size_t p) const
+{
+  // check it is a "BrLen" variable
+
+  if (!hasParameter(variable) || (variable.compare(0,5,"BrLen")!=0))
+    return;
 
-  vpTreelik_[p]->computeTreeD2LogLikelihood(VbrId);
+  vpTreelik_[p]->computeTreeD2LogLikelihood(getBranchIds_(variable, p));
 }
@@ -44,12 +44,17 @@
 #include "../MultiProcessSequenceEvolution.h"
 
 #include "../LikelihoodTreeCalculation.h"
+#include "../../SiteLoopExecutor.h"
 
 #include <Bpp/Numeric/AbstractParametrizable.h>
 
 // From SeqLib:
 #include <Bpp/Seq/Container/AlignedValuesContainer.h>
 
+// From the STL:
+#include <functional>
+#include <memory>
+
 using namespace std;
 
 namespace bpp
@@ -75,6 +80,16 @@ namespace bpp
 
       MultiProcessSequenceEvolution& mSeqEvol_;
 
+      /**
+       * @brief Number of threads computing the processes
+       * concurrently, and the pool they run on (built on first use).
+       *
+       */
+      
+      size_t nbThreads_;
+
+      mutable std::unique_ptr<SiteLoopExecutor> executor_;
+
     protected:
       /**
        * vector of pointers towards TreelikelihoodCalculations, used
@@ -97,6 +112,8 @@ namespace bpp
         AbstractAlignedPhyloLikelihood(lik),
         AbstractSequencePhyloLikelihood(lik),
         mSeqEvol_(lik.mSeqEvol_),
+        nbThreads_(lik.nbThreads_),
+        executor_(),
         vpTreelik_()
       {
         for (size_t i = 0; i < lik.vpTreelik_.size(); i++)
@@ -109,6 +126,8 @@ namespace bpp
       {
         AbstractSequencePhyloLikelihood::operator=(lik);
         mSeqEvol_=lik.mSeqEvol_;
+        nbThreads_=lik.nbThreads_;
+        executor_.reset();
 
         for (size_t i = 0; i < vpTreelik_.size(); i++)
         {
@@ -170,17 +189,26 @@ namespace bpp
         }
       }
       
-      void computeLikelihood() const
-      {
-        if (computeLikelihoods_)
-        {
-          for (size_t i = 0; i < vpTreelik_.size(); i++)
-            vpTreelik_[i]->computeTreeLikelihood();
+      void computeLikelihood() const;
 
-          computeLikelihoods_=false;
-        }
-        
+      /**
+       * @brief Set the number of threads computing the processes
+       * concurrently (1 by default, ie no additional thread).
+       *
+       * Processes may share substitution models, whose caches are not
+       * protected: all the transition probabilities are then computed
+       * sequentially before the trees are computed concurrently.
+       *
+       */
+
+      void setNumberOfThreads(size_t nbThreads)
+      {
+        nbThreads_ = nbThreads;
+        executor_.reset();
       }
+
+      size_t getNumberOfThreads() const { return nbThreads_; }
+
       /**
        * @brief sets using log in all likelihood arrays.
        *
@@ -288,6 +316,25 @@ namespace bpp
 
     protected:
 
+      /**
+       * @brief The ids of the branches of the tree of process p whose
+       * length is the variable (directly or through aliases).
+       *
+       */
+      
+      Vuint getBranchIds_(const std::string& variable, size_t p) const;
+
+      /**
+       * @brief Call f on each process index, concurrently with several
+       * threads.
+       *
+       * @param DX the order of the computation run by f.
+       * @param vbrIds the derivated branches of each process (empty for D0).
+       * @param f the computation.
+       */
+      
+      void runOnProcesses_(unsigned char DX, const std::vector<Vuint>& vbrIds, const std::function<void(size_t)>& f) const;
+      
       virtual void computeDLogLikelihood_(const std::string& variable) const;
 
       virtual void computeD2LogLikelihood_(const std::string& variable) const;
@@ -46,6 +46,9 @@
 
 #include <Bpp/Seq/Container/SiteContainerTools.h>
 
+// From the STL:
+#include <algorithm>
+
 using namespace std;
 using namespace bpp;
 
@@ -154,6 +157,34 @@ bool PartitionProcessPhyloLikelihood::addPhyloLikelihood(size_t nPhyl)
 
 /******************************************************************************/
 
+void PartitionProcessPhyloLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  ProductOfAlignedPhyloLikelihood::setNumberOfThreads(nbThreads);
+
+  const map<size_t, vector<size_t> >& mProcPos=mSeqEvol_.getMapOfProcessSites();
+
+  vector<size_t> large;
+  for (std::map<size_t, std::vector<size_t> >::const_iterator it=mProcPos.begin(); it!=mProcPos.end(); it++)
+  {
+    SingleProcessPhyloLikelihood* sPL=dynamic_cast<SingleProcessPhyloLikelihood*>(getAbstractPhyloLikelihood(it->first));
+    RecursiveLikelihoodTreeCalculation* rltc=sPL ? dynamic_cast<RecursiveLikelihoodTreeCalculation*>(sPL->getLikelihoodCalculation()) : 0;
+    if (!rltc)
+      continue;
+
+    if (nbThreads > 1 && it->second.size() * nbThreads > mSeqEvol_.getNumberOfSites())
+    {
+      rltc->setNumberOfThreads(min(nbThreads, sPL->getNumberOfClasses()));
+      large.push_back(it->first);
+    }
+    else
+      rltc->setNumberOfThreads(1);
+  }
+
+  setSplitMembers_(large);
+}
+
+/******************************************************************************/
+
 void PartitionProcessPhyloLikelihood::setData(const AlignedValuesContainer& data, size_t nData)
 {
   if (data.getNumberOfSites()!=mSeqEvol_.getNumberOfSites())
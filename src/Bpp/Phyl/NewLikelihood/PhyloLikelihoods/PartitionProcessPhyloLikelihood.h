@@ -145,6 +145,21 @@ namespace bpp
       
       bool addPhyloLikelihood(size_t nPhyl);
 
+      /**
+       * @brief Set the number of threads computing the partitions.
+       *
+       * Partitions holding more than an even share of the sites per
+       * thread are computed one at a time, their classes being split
+       * over the threads (see RecursiveLikelihoodTree::setNumberOfThreads).
+       * The smaller partitions are then dispatched to the threads,
+       * largest first, each thread taking the next one when done.
+       *
+       * @param nbThreads The number of threads, including the calling one.
+       * 1 (the default) means no additional thread.
+       */
+      
+      void setNumberOfThreads(size_t nbThreads);
+
       /*
        * @brief Get PhyloLikelihood Number for a given site.
        * @param siteIndex the index of the site
@@ -0,0 +1,193 @@
+//
+// File: PhyloBootstrap.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "PhyloBootstrap.h"
+#include "../RecursiveLikelihoodTreeCalculation.h"
+#include "../../SiteLoopExecutor.h"
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+
+using namespace std;
+
+/******************************************************************************/
+
+PhyloBootstrap::PhyloBootstrap(SingleProcessPhyloLikelihood& lik) :
+  lik_(&lik),
+  patternSites_(),
+  replicates_(),
+  parameters_(),
+  logLikelihoods_()
+{
+  if (!lik.isInitialized())
+    throw Exception("PhyloBootstrap::PhyloBootstrap. The likelihood is not initialized.");
+
+  const LikelihoodTree* data = lik.getLikelihoodData();
+  patternSites_.resize(data->getNumberOfDistinctSites(), data->getNumberOfSites());
+  for (size_t i = data->getNumberOfSites(); i > 0; --i)
+    patternSites_[data->getRootArrayPosition(i - 1)] = i - 1;
+}
+
+/******************************************************************************/
+
+void PhyloBootstrap::drawReplicates(size_t nbReplicates)
+{
+  const LikelihoodTree* data = lik_->getLikelihoodData();
+  size_t nbSites = data->getNumberOfSites();
+  replicates_.assign(nbReplicates, vector<double>(patternSites_.size(), 0));
+  for (auto& weights : replicates_)
+  {
+    for (size_t i = 0; i < nbSites; ++i)
+      weights[data->getRootArrayPosition(RandomTools::giveIntRandomNumberBetweenZeroAndEntry<size_t>(nbSites))] += 1;
+  }
+  parameters_.clear();
+  logLikelihoods_.clear();
+}
+
+/******************************************************************************/
+
+SingleProcessPhyloLikelihood* PhyloBootstrap::copyLikelihood_(vector<unique_ptr<SubstitutionProcess> >& processes) const
+{
+  RecursiveLikelihoodTree* data = dynamic_cast<RecursiveLikelihoodTree*>(lik_->getLikelihoodData());
+  if (!data)
+    throw Exception("PhyloBootstrap::copyLikelihood_. The likelihood must use a RecursiveLikelihoodTreeCalculation.");
+
+  SubstitutionProcess* process = lik_->getSubstitutionProcess().clone();
+  processes.emplace_back(process);
+  RecursiveLikelihoodTreeCalculation* tlComp = new RecursiveLikelihoodTreeCalculation(process, false, data->usePatterns());
+  tlComp->setData(*lik_->getData(), *lik_->getLikelihoodCalculation());
+  return new SingleProcessPhyloLikelihood(process, tlComp, lik_->getSubstitutionProcessNumber(), lik_->getNData());
+}
+
+/******************************************************************************/
+
+void PhyloBootstrap::estimate(const Estimator& estimator, size_t nbThreads)
+{
+  size_t nbReplicates = replicates_.size();
+  parameters_.assign(nbReplicates, ParameterList());
+  logLikelihoods_.assign(nbReplicates, 0);
+  if (nbReplicates == 0)
+    return;
+
+  size_t nbCopies = max(static_cast<size_t>(1), min(nbThreads, nbReplicates));
+  vector<unique_ptr<SubstitutionProcess> > processes;
+  vector<unique_ptr<SingleProcessPhyloLikelihood> > copies;
+  for (size_t c = 0; c < nbCopies; ++c)
+    copies.emplace_back(copyLikelihood_(processes));
+
+  ParameterList start = lik_->getParameters();
+
+  // Each copy estimates the replicates c, c + nbCopies, ...
+  std::function<void(size_t, size_t)> estimateCopies = [&](size_t first, size_t last)
+  {
+    for (size_t c = first; c < last; ++c)
+    {
+      SingleProcessPhyloLikelihood& copy = *copies[c];
+      for (size_t r = c; r < nbReplicates; r += nbCopies)
+      {
+        copy.matchParametersValues(start);
+        copy.setPatternWeights(replicates_[r]);
+        estimator(copy);
+        parameters_[r] = copy.getParameters();
+        logLikelihoods_[r] = copy.getLogLikelihood();
+      }
+    }
+  };
+
+  if (nbCopies > 1)
+  {
+    SiteLoopExecutor executor(nbCopies);
+    executor.run(nbCopies, estimateCopies);
+  }
+  else
+    estimateCopies(0, 1);
+}
+
+/******************************************************************************/
+
+vector<double> PhyloBootstrap::computeRELLSupports(const vector<const SingleProcessPhyloLikelihood*>& candidates) const
+{
+  if (replicates_.size() == 0)
+    throw Exception("PhyloBootstrap::computeRELLSupports. No replicate was drawn.");
+
+  size_t nbCandidates = candidates.size();
+  size_t nbPatterns = patternSites_.size();
+  vector< vector<double> > patternLogLik(nbCandidates, vector<double>(nbPatterns));
+  for (size_t c = 0; c < nbCandidates; ++c)
+  {
+    if (candidates[c]->getNumberOfSites() != lik_->getNumberOfSites())
+      throw Exception("PhyloBootstrap::computeRELLSupports. Candidate " + TextTools::toString(c) + " has not the same number of sites.");
+    for (size_t p = 0; p < nbPatterns; ++p)
+      patternLogLik[c][p] = candidates[c]->getLogLikelihoodForASite(patternSites_[p]);
+  }
+
+  vector<double> supports(nbCandidates, 0);
+  vector<double> scores(nbCandidates);
+  for (const auto& weights : replicates_)
+  {
+    for (size_t c = 0; c < nbCandidates; ++c)
+    {
+      scores[c] = 0;
+      for (size_t p = 0; p < nbPatterns; ++p)
+      {
+        if (weights[p] != 0)
+          scores[c] += weights[p] * patternLogLik[c][p];
+      }
+    }
+    double best = *max_element(scores.begin(), scores.end());
+    double nbBest = static_cast<double>(count(scores.begin(), scores.end(), best));
+    for (size_t c = 0; c < nbCandidates; ++c)
+    {
+      if (scores[c] == best)
+        supports[c] += 1. / nbBest;
+    }
+  }
+
+  for (auto& s : supports)
+    s /= static_cast<double>(replicates_.size());
+  return supports;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,167 @@
+//
+// File: PhyloBootstrap.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _PHYLOBOOTSTRAP_H_
+#define _PHYLOBOOTSTRAP_H_
+
+#include "SingleProcessPhyloLikelihood.h"
+
+#include <Bpp/Numeric/ParameterList.h>
+
+// From the STL:
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace bpp
+{
+
+  /**
+   * @brief Site bootstrap on a single, already initialized likelihood.
+   *
+   * Resampling sites only changes the number of times each distinct
+   * pattern is counted, so a replicate is a vector of pattern weights
+   * (see SingleProcessPhyloLikelihood::setPatternWeights). The data
+   * subset, the site compression and the likelihood arrays are never
+   * computed again.
+   *
+   * Replicates are estimated by copies of the likelihood, one per
+   * thread, each with its own substitution process and sharing the
+   * data and compression of the original one. The original likelihood
+   * is left untouched.
+   *
+   * The RELL approximation (Kishino, Miyata and Hasegawa, 1990) is also
+   * available: replicates are then scored with the site log-likelihoods
+   * of already estimated candidates, without any reestimation.
+   */
+  class PhyloBootstrap
+  {
+  public:
+    /**
+     * @brief A function estimating the parameters of one replicate, for
+     * instance by calling OptimizationTools::optimizeNumericalParameters2.
+     *
+     * It is called concurrently on different likelihoods when several
+     * threads are used, and must hence not share any state between calls.
+     */
+    typedef std::function<void (SingleProcessPhyloLikelihood&)> Estimator;
+
+  private:
+    SingleProcessPhyloLikelihood* lik_;
+
+    /**
+     * @brief One representative site per distinct pattern.
+     */
+    std::vector<size_t> patternSites_;
+
+    std::vector<std::vector<double> > replicates_;
+
+    std::vector<ParameterList> parameters_;
+    std::vector<double> logLikelihoods_;
+
+  public:
+    /**
+     * @param lik An initialized likelihood, which must use a RecursiveLikelihoodTreeCalculation.
+     * @throw Exception If the likelihood is not initialized.
+     */
+    PhyloBootstrap(SingleProcessPhyloLikelihood& lik);
+
+    PhyloBootstrap(const PhyloBootstrap& bs) = delete;
+    PhyloBootstrap& operator=(const PhyloBootstrap& bs) = delete;
+
+    virtual ~PhyloBootstrap() {}
+
+  public:
+    /**
+     * @brief Draw the pattern weights of new replicates, replacing the
+     * previous ones. Random numbers are drawn serially, so that replicates
+     * do not depend on the number of threads.
+     */
+    void drawReplicates(size_t nbReplicates);
+
+    size_t getNumberOfReplicates() const { return replicates_.size(); }
+
+    const std::vector<double>& getPatternWeights(size_t replicate) const { return replicates_[replicate]; }
+
+    /**
+     * @brief Estimate all replicates.
+     *
+     * For each replicate, a copy of the likelihood starts from the
+     * parameter values of the original one, with the pattern weights of
+     * the replicate, and is given to the estimator.
+     *
+     * @param estimator The function estimating parameters.
+     * @param nbThreads The number of likelihood copies working concurrently.
+     */
+    void estimate(const Estimator& estimator, size_t nbThreads = 1);
+
+    /**
+     * @return The parameters estimated for each replicate by estimate().
+     */
+    const std::vector<ParameterList>& getEstimatedParameters() const { return parameters_; }
+
+    /**
+     * @return The log-likelihood of each replicate after estimate().
+     */
+    const std::vector<double>& getLogLikelihoods() const { return logLikelihoods_; }
+
+    /**
+     * @brief RELL support values.
+     *
+     * Each replicate is scored on each candidate by weighting its site
+     * log-likelihoods, and the support of a candidate is the proportion
+     * of replicates where it has the highest score. Ties are shared.
+     *
+     * @param candidates Estimated likelihoods on the same data as the one of this object (for instance on different trees).
+     * @return The support of each candidate.
+     * @throw Exception If a candidate has not the same number of sites.
+     */
+    std::vector<double> computeRELLSupports(const std::vector<const SingleProcessPhyloLikelihood*>& candidates) const;
+
+  private:
+    /**
+     * @brief Build an independent copy of the likelihood.
+     */
+    SingleProcessPhyloLikelihood* copyLikelihood_(std::vector<std::unique_ptr<SubstitutionProcess> >& processes) const;
+  };
+
+} // end of namespace bpp.
+
+#endif // _PHYLOBOOTSTRAP_H_
+
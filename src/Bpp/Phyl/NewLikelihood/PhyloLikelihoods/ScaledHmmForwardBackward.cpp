@@ -0,0 +1,515 @@
+//
+// File: ScaledHmmForwardBackward.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "ScaledHmmForwardBackward.h"
+
+#include <Bpp/Exceptions.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+namespace
+{
+  /*
+   * Transition matrices are either dense (off == 0), or the diagonal
+   * trans plus, for each row k, off[k] for all the columns.
+   *
+   * cur = prev . T
+   */
+  template<size_t N>
+  inline void leftProduct(size_t n, const double* trans, const double* off, const double* prev, double* cur)
+  {
+    const size_t ns = N > 0 ? N : n;
+
+    if (off)
+    {
+      double x = 0;
+      for (size_t k = 0; k < ns; k++)
+        x += prev[k] * off[k];
+      for (size_t j = 0; j < ns; j++)
+        cur[j] = prev[j] * trans[j] + x;
+      return;
+    }
+
+    for (size_t j = 0; j < ns; j++)
+      cur[j] = 0;
+    for (size_t k = 0; k < ns; k++)
+    {
+      const double* trans_k = trans + k * ns;
+      double p = prev[k];
+      for (size_t j = 0; j < ns; j++)
+        cur[j] += p * trans_k[j];
+    }
+  }
+
+  /*
+   * cur = T . next
+   */
+  template<size_t N>
+  inline void rightProduct(size_t n, const double* trans, const double* off, const double* next, double* cur)
+  {
+    const size_t ns = N > 0 ? N : n;
+
+    if (off)
+    {
+      double x = 0;
+      for (size_t j = 0; j < ns; j++)
+        x += next[j];
+      for (size_t k = 0; k < ns; k++)
+        cur[k] = trans[k] * next[k] + off[k] * x;
+      return;
+    }
+
+    for (size_t k = 0; k < ns; k++)
+    {
+      const double* trans_k = trans + k * ns;
+      double x = 0;
+      for (size_t j = 0; j < ns; j++)
+        x += trans_k[j] * next[j];
+      cur[k] = x;
+    }
+  }
+
+  /*
+   * The recursions over sites [first, last), for a number of states
+   * known at compile time (N > 0) or not (N == 0, n being then used).
+   * The forward one starts from the (normalised) vector of the previous
+   * site, or the equilibrium frequencies for the first site.
+   *
+   * A site of null likelihood is not normalised: its vector and those of
+   * all the following sites are null, and the log-likelihood is -inf.
+   */
+  template<size_t N>
+  double forward(size_t first, size_t last, size_t n, const double* trans, const double* off, const double* entry, const double* em, double* fw, double* scales)
+  {
+    const size_t ns = N > 0 ? N : n;
+
+    double logL = 0;
+    const double* prev = entry;
+    for (size_t i = first; i < last; i++)
+    {
+      double* cur = fw + i * ns;
+      const double* em_i = em + i * ns;
+
+      leftProduct<N>(ns, trans, off, prev, cur);
+
+      double s = 0;
+      for (size_t j = 0; j < ns; j++)
+      {
+        cur[j] *= em_i[j];
+        s += cur[j];
+      }
+      if (s > 0)
+        for (size_t j = 0; j < ns; j++)
+          cur[j] /= s;
+      scales[i] = s;
+      logL += log(s);
+      prev = cur;
+    }
+    return logL;
+  }
+
+  /*
+   * The backward recursion, from the vector of the last site of the
+   * range.
+   */
+  template<size_t N>
+  void backward(size_t first, size_t last, size_t n, const double* trans, const double* off, const double* em, const double* scales, const double* exit, double* bw)
+  {
+    const size_t ns = N > 0 ? N : n;
+
+    double* end = bw + (last - 1) * ns;
+    for (size_t k = 0; k < ns; k++)
+      end[k] = exit[k];
+
+    vector<double> tmp(ns);
+    for (size_t i = last - 1; i > first; i--)
+    {
+      const double* next = bw + i * ns;
+      const double* em_i = em + i * ns;
+      double* cur = bw + (i - 1) * ns;
+      double s = scales[i];
+      for (size_t j = 0; j < ns; j++)
+        tmp[j] = em_i[j] * next[j] / s;
+      rightProduct<N>(ns, trans, off, tmp.data(), cur);
+    }
+  }
+
+  /*
+   * The product over sites [first, last) of the transition matrix times
+   * the emissions, rescaled at each site, the log of the rescaling being
+   * returned (-inf if the product is null).
+   */
+  template<size_t N>
+  double product(size_t first, size_t last, size_t n, const double* trans, const double* off, const double* em, double* prod)
+  {
+    const size_t ns = N > 0 ? N : n;
+
+    vector<double> tmp(ns * ns);
+    for (size_t r = 0; r < ns; r++)
+      for (size_t j = 0; j < ns; j++)
+        prod[r * ns + j] = (r == j) ? 1. : 0.;
+
+    double logScale = 0;
+    for (size_t i = first; i < last; i++)
+    {
+      const double* em_i = em + i * ns;
+      double m = 0;
+      for (size_t r = 0; r < ns; r++)
+      {
+        double* tmp_r = &tmp[r * ns];
+        leftProduct<N>(ns, trans, off, prod + r * ns, tmp_r);
+        for (size_t j = 0; j < ns; j++)
+        {
+          tmp_r[j] *= em_i[j];
+          if (tmp_r[j] > m)
+            m = tmp_r[j];
+        }
+      }
+      if (m == 0)
+      {
+        for (size_t l = 0; l < ns * ns; l++)
+          prod[l] = 0;
+        return -numeric_limits<double>::infinity();
+      }
+      for (size_t l = 0; l < ns * ns; l++)
+        prod[l] = tmp[l] / m;
+      logScale += log(m);
+    }
+    return logScale;
+  }
+}
+
+/*
+ * Calls a template function with the number of states known at compile
+ * time for small numbers.
+ */
+#define BPP_HMM_DISPATCH(result, f, ...) \
+  switch (nbStates_) \
+  { \
+  case 2: result f<2>(__VA_ARGS__); break; \
+  case 3: result f<3>(__VA_ARGS__); break; \
+  case 4: result f<4>(__VA_ARGS__); break; \
+  default: result f<0>(__VA_ARGS__); \
+  }
+
+/******************************************************************************/
+
+ScaledHmmForwardBackward::ScaledHmmForwardBackward(const ScaledHmmForwardBackward& fb) :
+  nbSites_(fb.nbSites_),
+  nbStates_(fb.nbStates_),
+  emissions_(fb.emissions_),
+  forward_(fb.forward_),
+  backward_(fb.backward_),
+  scales_(fb.scales_),
+  transitions_(fb.transitions_),
+  offDiagonals_(fb.offDiagonals_),
+  logLikelihood_(fb.logLikelihood_),
+  backwardUpToDate_(fb.backwardUpToDate_),
+  nbThreads_(fb.nbThreads_),
+  nbBlocks_(fb.nbBlocks_),
+  executor_(),
+  blockProducts_(fb.blockProducts_),
+  blockLogScales_(fb.blockLogScales_),
+  blockLogLikelihoods_(fb.blockLogLikelihoods_),
+  blockEntries_(fb.blockEntries_)
+{}
+
+ScaledHmmForwardBackward& ScaledHmmForwardBackward::operator=(const ScaledHmmForwardBackward& fb)
+{
+  nbSites_ = fb.nbSites_;
+  nbStates_ = fb.nbStates_;
+  emissions_ = fb.emissions_;
+  forward_ = fb.forward_;
+  backward_ = fb.backward_;
+  scales_ = fb.scales_;
+  transitions_ = fb.transitions_;
+  offDiagonals_ = fb.offDiagonals_;
+  logLikelihood_ = fb.logLikelihood_;
+  backwardUpToDate_ = fb.backwardUpToDate_;
+  nbThreads_ = fb.nbThreads_;
+  nbBlocks_ = fb.nbBlocks_;
+  executor_.reset();
+  blockProducts_ = fb.blockProducts_;
+  blockLogScales_ = fb.blockLogScales_;
+  blockLogLikelihoods_ = fb.blockLogLikelihoods_;
+  blockEntries_ = fb.blockEntries_;
+  return *this;
+}
+
+/******************************************************************************/
+
+void ScaledHmmForwardBackward::resize(size_t nbSites, size_t nbStates)
+{
+  if (nbSites == nbSites_ && nbStates == nbStates_)
+    return;
+  nbSites_ = nbSites;
+  nbStates_ = nbStates;
+  emissions_.resize(nbSites * nbStates);
+  forward_.resize(nbSites * nbStates);
+  backward_.clear();
+  scales_.resize(nbSites);
+  backwardUpToDate_ = false;
+}
+
+/******************************************************************************/
+
+void ScaledHmmForwardBackward::setNumberOfThreads(size_t nbThreads)
+{
+  nbThreads_ = nbThreads;
+  executor_.reset();
+}
+
+/******************************************************************************/
+
+size_t ScaledHmmForwardBackward::chooseNumberOfBlocks_() const
+{
+  // Blocks are only worth it when they are long enough:
+  if (nbThreads_ <= 1 || nbSites_ < 64 * nbThreads_)
+    return 1;
+  return nbThreads_;
+}
+
+/******************************************************************************/
+
+void ScaledHmmForwardBackward::runBlocks_(const function<void(size_t)>& f)
+{
+  if (!executor_)
+    executor_.reset(new SiteLoopExecutor(nbThreads_));
+  executor_->run(nbBlocks_, [&f](size_t first, size_t last)
+                 {
+                   for (size_t b = first; b < last; b++)
+                     f(b);
+                 });
+}
+
+/******************************************************************************/
+
+void ScaledHmmForwardBackward::computeForward(const Matrix<double>& transitions, const vector<double>& freqs)
+{
+  size_t n = nbStates_;
+
+  // Are all the off-diagonal probabilities of each row the same?
+  bool banded = true;
+  for (size_t k = 0; banded && k < n; k++)
+    for (size_t j = 0; j < n; j++)
+      if (j != k && transitions(k, j) != transitions(k, k == 0 ? 1 : 0))
+      {
+        banded = false;
+        break;
+      }
+
+  if (banded)
+  {
+    transitions_.resize(n);
+    offDiagonals_.resize(n);
+    for (size_t k = 0; k < n; k++)
+    {
+      offDiagonals_[k] = n > 1 ? transitions(k, k == 0 ? 1 : 0) : 0.;
+      transitions_[k] = transitions(k, k) - offDiagonals_[k];
+    }
+  }
+  else
+  {
+    transitions_.resize(n * n);
+    offDiagonals_.clear();
+    for (size_t k = 0; k < n; k++)
+      for (size_t j = 0; j < n; j++)
+        transitions_[k * n + j] = transitions(k, j);
+  }
+
+  backwardUpToDate_ = false;
+  if (nbSites_ == 0)
+  {
+    logLikelihood_ = 0;
+    return;
+  }
+
+  const double* t = transitions_.data();
+  const double* o = banded ? offDiagonals_.data() : 0;
+  const double* e = emissions_.data();
+  nbBlocks_ = chooseNumberOfBlocks_();
+  size_t nbBlocks = nbBlocks_;
+
+  if (nbBlocks == 1)
+  {
+    BPP_HMM_DISPATCH(logLikelihood_ =, forward, 0, nbSites_, n, t, o, freqs.data(), e, forward_.data(), scales_.data());
+    return;
+  }
+
+  // Products of blocks, concurrently:
+  blockProducts_.resize(nbBlocks * n * n);
+  blockLogScales_.resize(nbBlocks);
+  blockLogLikelihoods_.resize(nbBlocks);
+  blockEntries_.resize(nbBlocks * n);
+  runBlocks_([&](size_t b)
+             {
+               // The first block does not need its product.
+               if (b == 0)
+                 return;
+               double* prod = &blockProducts_[b * n * n];
+               BPP_HMM_DISPATCH(blockLogScales_[b] =, product, getBlockBegin_(b), getBlockBegin_(b + 1), n, t, o, e, prod);
+             });
+
+  // Entering vectors, sequentially over blocks. That of block b > 0 is
+  // known once the forward of block 0 is done, so the first block is
+  // run here:
+  BPP_HMM_DISPATCH(blockLogLikelihoods_[0] =, forward, 0, getBlockBegin_(1), n, t, o, freqs.data(), e, forward_.data(), scales_.data());
+  for (size_t j = 0; j < n; j++)
+    blockEntries_[n + j] = forward_[(getBlockBegin_(1) - 1) * n + j];
+  for (size_t b = 2; b < nbBlocks; b++)
+  {
+    const double* prev = &blockEntries_[(b - 1) * n];
+    const double* prod = &blockProducts_[(b - 1) * n * n];
+    double* cur = &blockEntries_[b * n];
+    double s = 0;
+    for (size_t j = 0; j < n; j++)
+    {
+      double x = 0;
+      for (size_t k = 0; k < n; k++)
+        x += prev[k] * prod[k * n + j];
+      cur[j] = x;
+      s += x;
+    }
+    if (s > 0)
+      for (size_t j = 0; j < n; j++)
+        cur[j] /= s;
+  }
+
+  // Forward of the other blocks, concurrently:
+  runBlocks_([&](size_t b)
+             {
+               if (b == 0)
+                 return;
+               BPP_HMM_DISPATCH(blockLogLikelihoods_[b] =, forward, getBlockBegin_(b), getBlockBegin_(b + 1), n, t, o, &blockEntries_[b * n], e, forward_.data(), scales_.data());
+             });
+
+  logLikelihood_ = 0;
+  for (size_t b = 0; b < nbBlocks; b++)
+    logLikelihood_ += blockLogLikelihoods_[b];
+}
+
+/******************************************************************************/
+
+void ScaledHmmForwardBackward::computeBackward_()
+{
+  if (std::isinf(logLikelihood_))
+    throw Exception("ScaledHmmForwardBackward::computeBackward_. Posterior probabilities are undefined, the likelihood is null.");
+  size_t n = nbStates_;
+  backward_.resize(nbSites_ * n);
+  if (nbSites_ > 0)
+  {
+    const double* t = transitions_.data();
+    const double* o = offDiagonals_.size() > 0 ? offDiagonals_.data() : 0;
+    const double* e = emissions_.data();
+    size_t nbBlocks = nbBlocks_;
+
+    // The vectors leaving each block (at its last site), sequentially
+    // from the last block, using the products of the forward pass:
+    vector<double> exits(nbBlocks * n, 1.);
+    for (size_t b = nbBlocks - 1; b > 0; b--)
+    {
+      const double* next = &exits[b * n];
+      const double* prod = &blockProducts_[b * n * n];
+      double f = exp(blockLogScales_[b] - blockLogLikelihoods_[b]);
+      double* cur = &exits[(b - 1) * n];
+      for (size_t k = 0; k < n; k++)
+      {
+        double x = 0;
+        for (size_t j = 0; j < n; j++)
+          x += prod[k * n + j] * next[j];
+        cur[k] = x * f;
+      }
+    }
+
+    if (nbBlocks == 1)
+    {
+      BPP_HMM_DISPATCH(, backward, 0, nbSites_, n, t, o, e, scales_.data(), exits.data(), backward_.data());
+    }
+    else
+    {
+      runBlocks_([&](size_t b)
+                 {
+                   BPP_HMM_DISPATCH(, backward, getBlockBegin_(b), getBlockBegin_(b + 1), n, t, o, e, scales_.data(), &exits[b * n], backward_.data());
+                 });
+    }
+  }
+  backwardUpToDate_ = true;
+}
+
+/******************************************************************************/
+
+void ScaledHmmForwardBackward::getPosteriorProbabilities(VVdouble& probs)
+{
+  if (!backwardUpToDate_)
+    computeBackward_();
+
+  probs.resize(nbSites_);
+  for (size_t i = 0; i < nbSites_; i++)
+  {
+    probs[i].resize(nbStates_);
+    const double* fw = &forward_[i * nbStates_];
+    const double* bw = &backward_[i * nbStates_];
+    for (size_t k = 0; k < nbStates_; k++)
+      probs[i][k] = fw[k] * bw[k];
+  }
+}
+
+/******************************************************************************/
+
+Vdouble ScaledHmmForwardBackward::getPosteriorProbabilitiesForASite(size_t site)
+{
+  if (!backwardUpToDate_)
+    computeBackward_();
+
+  Vdouble probs(nbStates_);
+  const double* fw = &forward_[site * nbStates_];
+  const double* bw = &backward_[site * nbStates_];
+  for (size_t k = 0; k < nbStates_; k++)
+    probs[k] = fw[k] * bw[k];
+  return probs;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,233 @@
+//
+// File: ScaledHmmForwardBackward.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _SCALED_HMM_FORWARD_BACKWARD_H_
+#define _SCALED_HMM_FORWARD_BACKWARD_H_
+
+#include "../../SiteLoopExecutor.h"
+
+// From Numeric
+#include <Bpp/Numeric/Matrix/Matrix.h>
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Scaled forward and backward recursions of a hidden Markov
+ * model, on contiguous buffers.
+ *
+ * Emission probabilities are written in place by the caller, in
+ * [site * nbStates + state], without any intermediate per site vector.
+ * Forward probabilities are normalised at each site, the normalisation
+ * being the likelihood of the site given the previous ones, so that the
+ * log-likelihood is the sum of their logs.
+ *
+ * Loops are unrolled at compile time for 2, 3 and 4 hidden states, so
+ * that the compiler can vectorise them.
+ *
+ * Transition matrices where each state is left towards all the other
+ * ones with the same probability (such as auto-correlation ones) are
+ * the sum of a diagonal matrix and of a rank one matrix. They are
+ * detected, and applied in O(nbStates) per site instead of
+ * O(nbStates^2).
+ *
+ * As in the HMM likelihoods of bpp-core, the hidden state of the first
+ * site is drawn from the equilibrium frequencies followed by one
+ * transition.
+ *
+ * With several threads, sites are cut into one block per thread, and
+ * the recursions are run as a prefix scan over blocks: the rescaled
+ * product of the transition-emission matrices of each block is computed
+ * concurrently, the vectors entering each block are then propagated
+ * over blocks, and each block finally runs its own recursion from its
+ * entering vector. Products cost nbStates times more than the plain
+ * recursion, which suits models with few hidden states. Results may
+ * differ from the sequential ones by rounding errors.
+ */
+  class ScaledHmmForwardBackward
+  {
+  private:
+    size_t nbSites_;
+    size_t nbStates_;
+
+    std::vector<double> emissions_;
+    std::vector<double> forward_;
+    std::vector<double> backward_;
+    std::vector<double> scales_;
+    std::vector<double> transitions_;
+
+    /**
+     * @brief If not empty, the probabilities of leaving each state
+     * towards each other one, transitions_ being then the diagonal
+     * minus these probabilities.
+     */
+    std::vector<double> offDiagonals_;
+
+    double logLikelihood_;
+    bool backwardUpToDate_;
+
+    size_t nbThreads_;
+    size_t nbBlocks_;
+    std::unique_ptr<SiteLoopExecutor> executor_;
+
+    /**
+     * @brief For each block, the rescaled product of its matrices, the
+     * log of the rescaling, the sum of the logs of its site likelihoods
+     * and the forward vector entering it.
+     */
+    std::vector<double> blockProducts_;
+    std::vector<double> blockLogScales_;
+    std::vector<double> blockLogLikelihoods_;
+    std::vector<double> blockEntries_;
+
+  public:
+    ScaledHmmForwardBackward() :
+      nbSites_(0),
+      nbStates_(0),
+      emissions_(),
+      forward_(),
+      backward_(),
+      scales_(),
+      transitions_(),
+      offDiagonals_(),
+      logLikelihood_(0),
+      backwardUpToDate_(false),
+      nbThreads_(1),
+      nbBlocks_(1),
+      executor_(),
+      blockProducts_(),
+      blockLogScales_(),
+      blockLogLikelihoods_(),
+      blockEntries_()
+    {}
+
+    ScaledHmmForwardBackward(const ScaledHmmForwardBackward& fb);
+
+    ScaledHmmForwardBackward& operator=(const ScaledHmmForwardBackward& fb);
+
+    virtual ~ScaledHmmForwardBackward() {}
+
+  public:
+    /**
+     * @brief Set the dimensions of the buffers.
+     *
+     * Emissions are kept if the dimensions do not change.
+     */
+    void resize(size_t nbSites, size_t nbStates);
+
+    size_t getNumberOfSites() const { return nbSites_; }
+
+    size_t getNumberOfStates() const { return nbStates_; }
+
+    /**
+     * @return True if the transitions of the last forward pass were
+     * applied as a diagonal plus a rank one matrix.
+     */
+    bool hasBandedTransitions() const { return offDiagonals_.size() > 0; }
+
+    /**
+     * @brief Set the number of threads running the recursions over
+     * blocks of sites (1 by default, ie the plain sequential recursions).
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    size_t getNumberOfThreads() const { return nbThreads_; }
+
+    /**
+     * @return The emission buffer, in [site * nbStates + state], to be
+     * filled before computeForward() is called.
+     */
+    double* getEmissions() { return emissions_.data(); }
+
+    /**
+     * @brief Run the forward recursion.
+     *
+     * If a site has a null likelihood given the previous ones (for
+     * instance when all its emission probabilities are 0), the
+     * log-likelihood is -inf, and no posterior probability can be
+     * computed.
+     *
+     * @param transitions The transition probabilities between hidden states.
+     * @param freqs The equilibrium frequencies of hidden states.
+     */
+    void computeForward(const Matrix<double>& transitions, const std::vector<double>& freqs);
+
+    double getLogLikelihood() const { return logLikelihood_; }
+
+    double getLikelihoodForASite(size_t site) const { return scales_[site]; }
+
+    const std::vector<double>& getLikelihoodPerSite() const { return scales_; }
+
+    /**
+     * @brief Get the posterior probabilities of hidden states, in
+     * [site][state].
+     *
+     * The backward recursion is run the first time after each forward one.
+     *
+     * @throw Exception If the likelihood is null.
+     */
+    void getPosteriorProbabilities(VVdouble& probs);
+
+    Vdouble getPosteriorProbabilitiesForASite(size_t site);
+
+  private:
+    void computeBackward_();
+
+    size_t chooseNumberOfBlocks_() const;
+
+    /**
+     * @brief The first site of a block, in the blocks of the last
+     * forward pass.
+     */
+    size_t getBlockBegin_(size_t block) const
+    {
+      return block * nbSites_ / nbBlocks_;
+    }
+
+    void runBlocks_(const std::function<void(size_t)>& f);
+  };
+} // end of namespace bpp.
+
+#endif  // _SCALED_HMM_FORWARD_BACKWARD_H_
+
@@ -38,15 +38,25 @@
 */
 
 #include "SetOfAbstractPhyloLikelihood.h"
+#include "AlignedPhyloLikelihood.h"
 
 using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+#include <atomic>
+
 using namespace std;
 
 SetOfAbstractPhyloLikelihood::SetOfAbstractPhyloLikelihood(PhyloLikelihoodContainer* pC, const std::string& prefix) :
   AbstractPhyloLikelihood(),
   AbstractParametrizable(prefix),
   pPhyloCont_(pC),
-  nPhylo_()
+  nPhylo_(),
+  nbThreads_(1),
+  executor_(),
+  splitMembers_(),
+  parameterMembers_()
 {
 }
 
@@ -55,7 +65,11 @@ SetOfAbstractPhyloLikelihood::SetOfAbstractPhyloLikelihood(const SetOfAbstractPh
   AbstractPhyloLikelihood(sd),
   AbstractParametrizable(sd),
   pPhyloCont_(sd.pPhyloCont_),
-  nPhylo_(sd.nPhylo_)
+  nPhylo_(sd.nPhylo_),
+  nbThreads_(sd.nbThreads_),
+  executor_(),
+  splitMembers_(sd.splitMembers_),
+  parameterMembers_(sd.parameterMembers_)
 {
 }
 
@@ -66,6 +80,12 @@ SetOfAbstractPhyloLikelihood& SetOfAbstractPhyloLikelihood::operator=(const SetO
   pPhyloCont_=sd.pPhyloCont_;
   
   nPhylo_=sd.nPhylo_;
+
+  nbThreads_=sd.nbThreads_;
+  executor_.reset();
+  splitMembers_=sd.splitMembers_;
+
+  parameterMembers_=sd.parameterMembers_;
   
   return *this;
 }
@@ -78,6 +98,7 @@ bool SetOfAbstractPhyloLikelihood::addPhyloLikelihood(size_t nPhyl)
   if (aPL!=NULL){
     nPhylo_.push_back(nPhyl);
     includeParameters_(aPL->getParameters());
+    buildParameterIndex_();
     update();
     return true;
   }
@@ -92,10 +113,56 @@ void SetOfAbstractPhyloLikelihood::addAllPhyloLikelihoods()
     addPhyloLikelihood(vPhyl[i]);
 }
 
-void SetOfAbstractPhyloLikelihood::computeDLogLikelihood_(const std::string& variable) const
+void SetOfAbstractPhyloLikelihood::buildParameterIndex_()
+{
+  parameterMembers_.clear();
+  for (size_t i=0; i<nPhylo_.size(); i++)
+  {
+    const ParameterList& pl=getAbstractPhyloLikelihood(nPhylo_[i])->getParameters();
+    for (size_t j=0; j<pl.size(); j++)
+      parameterMembers_[pl[j].getName()].push_back(i);
+  }
+}
+
+vector<bool> SetOfAbstractPhyloLikelihood::getChangedPhyloLikelihoods_(const ParameterList& params) const
+{
+  vector<bool> changed(nPhylo_.size(), false);
+  for (size_t j=0; j<params.size(); j++)
+  {
+    map<string, vector<size_t> >::const_iterator it=parameterMembers_.find(params[j].getName());
+    if (it==parameterMembers_.end())
+      continue;
+    for (size_t i : it->second)
+      changed[i]=true;
+  }
+  return changed;
+}
+
+void SetOfAbstractPhyloLikelihood::fireParameterChanged(const ParameterList& params)
 {
+  vector<bool> changed=getChangedPhyloLikelihoods_(params);
+  
   for (size_t i=0; i<nPhylo_.size(); i++)
-    getAbstractPhyloLikelihood(nPhylo_[i])->computeDLogLikelihood_(variable);
+  {
+    if (!changed[i])
+      continue;
+    
+    getAbstractPhyloLikelihood(nPhylo_[i])->matchParametersValues(params);
+
+    // to ensure each phylolikelihood is recomputed, such as in
+    // case of total aliasing
+    getAbstractPhyloLikelihood(nPhylo_[i])->update();
+  }
+  
+  update();
+}
+
+void SetOfAbstractPhyloLikelihood::computeDLogLikelihood_(const std::string& variable) const
+{
+  runOnPhyloLikelihoods_([&variable](const AbstractPhyloLikelihood& aPL)
+                         {
+                           aPL.computeDLogLikelihood_(variable);
+                         });
 
   // derivative exists and ready to compute
   
@@ -104,14 +171,67 @@ void SetOfAbstractPhyloLikelihood::computeDLogLikelihood_(const std::string& var
 
 void SetOfAbstractPhyloLikelihood::computeD2LogLikelihood_(const std::string& variable) const
 {
-  for (size_t i=0; i<nPhylo_.size(); i++)
-    getAbstractPhyloLikelihood(nPhylo_[i])->computeD2LogLikelihood_(variable);
+  runOnPhyloLikelihoods_([&variable](const AbstractPhyloLikelihood& aPL)
+                         {
+                           aPL.computeD2LogLikelihood_(variable);
+                         });
 
   // derivative exists and ready to compute
   
   d2Values_[variable]= nan("");
 }
   
+void SetOfAbstractPhyloLikelihood::runOnPhyloLikelihoods_(const std::function<void(const AbstractPhyloLikelihood&)>& f) const
+{
+  // Members split over threads by themselves are computed first, one
+  // at a time:
+  const vector<size_t> members = getComputedPhyloLikelihoods_();
+  vector<size_t> shared;
+  for (size_t i=0; i<members.size(); i++)
+  {
+    if (nbThreads_ > 1 && splitMembers_.find(members[i]) != splitMembers_.end())
+      f(*getAbstractPhyloLikelihood(members[i]));
+    else
+      shared.push_back(members[i]);
+  }
+
+  size_t nbPhylo = shared.size();
+  size_t nbThreads = min(nbThreads_, nbPhylo);
+  
+  if (nbThreads <= 1)
+  {
+    for (size_t i=0; i<nbPhylo; i++)
+      f(*getAbstractPhyloLikelihood(shared[i]));
+    return;
+  }
+
+  // Largest members first, so that the last ones to be dispatched are
+  // the shortest:
+  vector<size_t> weights(nbPhylo, 1);
+  for (size_t i=0; i<nbPhylo; i++)
+  {
+    const AlignedPhyloLikelihood* aPL=dynamic_cast<const AlignedPhyloLikelihood*>(getAbstractPhyloLikelihood(shared[i]));
+    if (aPL)
+      weights[i]=aPL->getNumberOfSites();
+  }
+  
+  vector<size_t> order(nbPhylo);
+  for (size_t i=0; i<nbPhylo; i++)
+    order[i]=i;
+  stable_sort(order.begin(), order.end(), [&weights](size_t a, size_t b) { return weights[a] > weights[b]; });
+
+  if (!executor_ || executor_->getNumberOfThreads() != nbThreads)
+    executor_.reset(new SiteLoopExecutor(nbThreads));
+
+  // One block per thread, each taking the next member when done:
+  atomic<size_t> next(0);
+  executor_->run(nbThreads, [&](size_t, size_t)
+                 {
+                   for (size_t i = next++; i < nbPhylo; i = next++)
+                     f(*getAbstractPhyloLikelihood(shared[order[i]]));
+                 });
+}
+
 ParameterList SetOfAbstractPhyloLikelihood::getBranchLengthParameters() const
 {
   ParameterList pl;
@@ -44,6 +44,13 @@
 #include "PhyloLikelihood.h"
 #include "AbstractPhyloLikelihood.h"
 #include "PhyloLikelihoodContainer.h"
+#include "../../SiteLoopExecutor.h"
+
+// From the STL:
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
 
 namespace bpp
 {
@@ -75,6 +82,34 @@ namespace bpp
 
       std::vector<size_t> nPhylo_;
 
+    private:
+
+      /**
+       * @brief Number of threads computing the members concurrently,
+       * and the pool they run on (built on first use).
+       *
+       */
+      
+      size_t nbThreads_;
+
+      mutable std::unique_ptr<SiteLoopExecutor> executor_;
+
+      /**
+       * @brief Numbers of the members which share their computation
+       * over threads by themselves.
+       *
+       */
+      
+      std::set<size_t> splitMembers_;
+
+      /**
+       * @brief For each parameter name, the positions in nPhylo_ of
+       * the members depending on it.
+       *
+       */
+      
+      std::map<std::string, std::vector<size_t> > parameterMembers_;
+
     public:
       SetOfAbstractPhyloLikelihood(PhyloLikelihoodContainer* pC, const std::string& prefix = "");
 
@@ -101,6 +136,29 @@ namespace bpp
         return nPhylo_;
       }
 
+      /**
+       * @brief Set the number of threads computing the members
+       * concurrently (1 by default, ie no additional thread).
+       *
+       * Members are dispatched largest first (in number of sites for
+       * aligned members), each thread taking the next one when done.
+       * Combined values are still summed in member order, so that
+       * results do not depend on the number of threads.
+       *
+       * Members are computed at the same time, so they must not share
+       * substitution models or processes, whose caches are not
+       * protected (eg partitions each with its own process).
+       *
+       */
+
+      void setNumberOfThreads(size_t nbThreads)
+      {
+        nbThreads_ = nbThreads;
+        executor_.reset();
+      }
+
+      size_t getNumberOfThreads() const { return nbThreads_; }
+
       /**
        *
        * @brief adds a PhyloLikelihood already stored in the
@@ -174,6 +232,7 @@ namespace bpp
         AbstractPhyloLikelihood::initialize();
         for (size_t i=0; i<nPhylo_.size(); i++)
            (*getPhyloContainer())[nPhylo_[i]]->initialize();
+        buildParameterIndex_();
       }
         
 
@@ -208,8 +267,10 @@ namespace bpp
       {
         if (computeLikelihoods_)
         {
-          for (size_t i=0; i<nPhylo_.size(); i++)
-            getAbstractPhyloLikelihood(nPhylo_[i])->computeLikelihood();
+          runOnPhyloLikelihoods_([](const AbstractPhyloLikelihood& aPL)
+                                 {
+                                   aPL.computeLikelihood();
+                                 });
           computeLikelihoods_=false;
         }
       }
@@ -220,21 +281,67 @@ namespace bpp
 
       void computeD2LogLikelihood_(const std::string& variable) const;
 
-    public:
+      /**
+       * @brief Call a function on all members, concurrently if several
+       * threads are set.
+       *
+       */
       
-      virtual void fireParameterChanged(const ParameterList& params)
+      void runOnPhyloLikelihoods_(const std::function<void(const AbstractPhyloLikelihood&)>& f) const;
+
+      /**
+       * @brief The numbers of the members computed by this object
+       * (all of them by default).
+       *
+       */
+      
+      virtual std::vector<size_t> getComputedPhyloLikelihoods_() const
       {
-        for (size_t i=0; i<nPhylo_.size(); i++){
-          getAbstractPhyloLikelihood(nPhylo_[i])->matchParametersValues(params);
+        return nPhylo_;
+      }
 
-          // to ensure each phylolikelihood is recomputed, such as in
-          // case of total aliasing
-          getAbstractPhyloLikelihood(nPhylo_[i])->update();
-        }
-        
-        update();
+      /**
+       * @brief Set the members which share their own computation over
+       * threads.
+       *
+       * These members are computed one at a time on the calling
+       * thread, before the other ones are dispatched, so that threads
+       * are not oversubscribed.
+       *
+       * @param nPhyl The numbers of these members.
+       */
+      
+      void setSplitMembers_(const std::vector<size_t>& nPhyl)
+      {
+        splitMembers_ = std::set<size_t>(nPhyl.begin(), nPhyl.end());
       }
 
+      /**
+       * @brief Build the index of the members depending on each
+       * parameter.
+       *
+       */
+      
+      void buildParameterIndex_();
+
+      /**
+       * @return For each position in nPhylo_, if the member depends on
+       * at least one of the given parameters.
+       *
+       */
+      
+      std::vector<bool> getChangedPhyloLikelihoods_(const ParameterList& params) const;
+
+    public:
+      
+      /**
+       * @brief Only the members depending on the changed parameters
+       * are updated, the others keeping their computed likelihoods.
+       *
+       */
+      
+      virtual void fireParameterChanged(const ParameterList& params);
+
       double getFirstOrderDerivative(const std::string& variable) const 
       {
         if (dValues_.find(variable)==dValues_.end())
@@ -38,6 +38,11 @@
  */
 
 #include "SingleProcessPhyloLikelihood.h"
+#include "../../Io/BinaryTools.h"
+#include "../../SiteLoopExecutor.h"
+
+#include <cmath>
+#include <functional>
 
 using namespace std;
 using namespace bpp;
@@ -150,16 +155,12 @@ VVdouble SingleProcessPhyloLikelihood::getPosteriorProbabilitiesPerClass() const
 {
   size_t nbSites   = getNumberOfSites();
   size_t nbClasses = getNumberOfClasses();
-  VVdouble pb = getLikelihoodPerSitePerClass();
-  Vdouble l = getLikelihoodPerSite();
+  Vdouble post(nbSites * nbClasses);
+  computePosteriorsPerSite(&post[0], 0, 0);
 
+  VVdouble pb(nbSites);
   for (size_t i = 0; i < nbSites; ++i)
-  {
-    for (size_t j = 0; j < nbClasses; ++j)
-    {
-      pb[i][j] = pb[i][j] * process_->getProbabilityForModel(j) / l[i];
-    }
-  }
+    pb[i].assign(post.begin() + static_cast<ptrdiff_t>(i * nbClasses), post.begin() + static_cast<ptrdiff_t>((i + 1) * nbClasses));
   return pb;
 }
 
@@ -193,6 +194,57 @@ vector<size_t> SingleProcessPhyloLikelihood::getClassWithMaxPostProbPerSite() co
 }
 
 
+/******************************************************************************/
+
+void SingleProcessPhyloLikelihood::computePosteriorsPerSite(double* posteriors, size_t* classes, double* rates, size_t nbThreads) const
+{
+  updateLikelihood();
+  computeLikelihood();
+
+  size_t nbSites   = getNumberOfSites();
+  size_t nbClasses = getNumberOfClasses();
+  Vdouble classRates(nbClasses);
+  for (size_t c = 0; c < nbClasses; ++c)
+    classRates[c] = process_->getRateForModel(c);
+
+  const LikelihoodTreeCalculation* tlComp = tlComp_.get();
+  const LikelihoodTree& lTree = tlComp->getLikelihoodData();
+
+  function<void(size_t, size_t)> loop = [&](size_t first, size_t last)
+  {
+    // Sites without a posteriors buffer are computed in a local one:
+    Vdouble local(posteriors ? 0 : nbClasses);
+    for (size_t i = first; i < last; ++i)
+    {
+      double* post_i = posteriors ? posteriors + i * nbClasses : &local[0];
+      tlComp->getPosteriorProbabilitiesForASiteIndexPerClass(lTree.getRootArrayPosition(i), post_i);
+      if (classes)
+      {
+        size_t best = 0;
+        for (size_t c = 1; c < nbClasses; ++c)
+          if (post_i[c] > post_i[best])
+            best = c;
+        classes[i] = best;
+      }
+      if (rates)
+      {
+        double r = 0;
+        for (size_t c = 0; c < nbClasses; ++c)
+          r += post_i[c] * classRates[c];
+        rates[i] = r;
+      }
+    }
+  };
+
+  if (nbThreads > 1)
+  {
+    SiteLoopExecutor executor(nbThreads);
+    executor.run(nbSites, loop);
+  }
+  else
+    loop(0, nbSites);
+}
+
 /******************************************************************************/
 
 Vdouble SingleProcessPhyloLikelihood::getPosteriorRatePerSite() const
@@ -265,3 +317,202 @@ void SingleProcessPhyloLikelihood::computeD2LogLikelihood_(const string& variabl
 }
 
 /******************************************************************************/
+
+/******************************************************************************/
+
+namespace
+{
+  /*
+   * A likelihood of an array, whatever the node computes in log or not.
+   */
+  inline double likelihoodValue(const RecursiveLikelihoodNode& node, const VVdouble& array, size_t i, size_t x)
+  {
+    return node.usesLog() ? exp(array[i][x]) : array[i][x];
+  }
+
+  /*
+   * The nodes of a NNI in a class tree, and the transition
+   * probabilities of the father branch.
+   */
+  struct NNINodes
+  {
+    const RecursiveLikelihoodNode* son;
+    const RecursiveLikelihoodNode* parent;
+    const RecursiveLikelihoodNode* grandFather;
+    const RecursiveLikelihoodNode* uncle;
+    const Matrix<double>* parentProbabilities;
+  };
+}
+
+double SingleProcessPhyloLikelihood::testNNI(int nodeId) const
+{
+  vector<int> nodeIds(1, nodeId);
+  vector<double> diffs;
+  testNNIs(nodeIds, diffs);
+  return diffs[0];
+}
+
+void SingleProcessPhyloLikelihood::testNNIs(const vector<int>& nodeIds, vector<double>& diffs, size_t nbThreads) const
+{
+  RecursiveLikelihoodTreeCalculation* rlComp = dynamic_cast<RecursiveLikelihoodTreeCalculation*>(tlComp_.get());
+  if (!rlComp)
+    throw Exception("SingleProcessPhyloLikelihood::testNNIs. NNIs can only be tested with a RecursiveLikelihoodTreeCalculation.");
+
+  updateLikelihood();
+  computeLikelihood();
+
+  const RecursiveLikelihoodTree& data = dynamic_cast<const RecursiveLikelihoodTree&>(rlComp->getLikelihoodData());
+  size_t nbClasses = getNumberOfClasses();
+  size_t nbCandidates = nodeIds.size();
+
+  // Topologies and up to date arrays are set up first, since the
+  // arrays are computed lazily:
+  vector<vector<NNINodes> > nodes(nbCandidates, vector<NNINodes>(nbClasses));
+  for (size_t k = 0; k < nbCandidates; ++k)
+  {
+    const AwareNode* son = &data.getNodeData(nodeIds[k], 0);
+    if (!son->hasFather())
+      throw Exception("SingleProcessPhyloLikelihood::testNNIs. Node 'son' must not be the root node: " + TextTools::toString(nodeIds[k]));
+    const AwareNode* parent = son->getFather();
+    if (!parent->hasFather())
+      throw Exception("SingleProcessPhyloLikelihood::testNNIs. Node 'parent' must not be the root node: " + TextTools::toString(parent->getId()));
+    const AwareNode* grandFather = parent->getFather();
+    // In case of multifurcation, the same uncle as in the old NNI implementation is chosen:
+    size_t parentPosition = 0;
+    while (grandFather->getSon(parentPosition) != parent)
+      parentPosition++;
+    const AwareNode* uncle = grandFather->getSon(parentPosition > 1 ? 0 : 1 - parentPosition);
+
+    rlComp->computeLikelihoodsAtNode(static_cast<int>(grandFather->getId()));
+
+    for (size_t c = 0; c < nbClasses; ++c)
+    {
+      NNINodes* n = &nodes[k][c];
+      n->son = &dynamic_cast<const RecursiveLikelihoodNode&>(data.getNodeData(static_cast<int>(son->getId()), c));
+      n->parent = &dynamic_cast<const RecursiveLikelihoodNode&>(data.getNodeData(static_cast<int>(parent->getId()), c));
+      n->grandFather = &dynamic_cast<const RecursiveLikelihoodNode&>(data.getNodeData(static_cast<int>(grandFather->getId()), c));
+      n->uncle = &dynamic_cast<const RecursiveLikelihoodNode&>(data.getNodeData(static_cast<int>(uncle->getId()), c));
+      n->parentProbabilities = &process_->getTransitionProbabilities(parent->getId(), c);
+      if (n->grandFather->usesScaling() || n->parent->usesScaling())
+        throw Exception("SingleProcessPhyloLikelihood::testNNIs. NNIs can not be tested with scaled likelihoods.");
+    }
+  }
+
+  Vdouble classProbabilities(nbClasses);
+  for (size_t c = 0; c < nbClasses; ++c)
+    classProbabilities[c] = process_->getProbabilityForModel(c);
+  const vector<double>& weights = tlComp_->getPatternWeights();
+  size_t nbPatterns = weights.size();
+  size_t nbStates = getNumberOfStates();
+
+  // Site likelihoods with the current and the new topologies: at the
+  // grand father, the uncle moves below the father and the son takes
+  // its place.
+  diffs.resize(nbCandidates);
+  function<void(size_t, size_t)> loop = [&](size_t first, size_t last)
+  {
+    Vdouble current(nbPatterns), moved(nbPatterns), a(nbStates), q(nbStates);
+    for (size_t k = first; k < last; ++k)
+    {
+      current.assign(nbPatterns, 0.);
+      moved.assign(nbPatterns, 0.);
+      for (size_t c = 0; c < nbClasses; ++c)
+      {
+        const NNINodes& n = nodes[k][c];
+        const VVdouble& above = n.grandFather->getAboveLikelihoodArray();
+        const VVdouble& toSon = n.son->getToFatherBelowLikelihoodArray(ComputingNode::D0);
+        const VVdouble& toParent = n.parent->getToFatherBelowLikelihoodArray(ComputingNode::D0);
+        const VVdouble& toUncle = n.uncle->getToFatherBelowLikelihoodArray(ComputingNode::D0);
+        const Matrix<double>& pxy = *n.parentProbabilities;
+
+        for (size_t i = 0; i < nbPatterns; ++i)
+        {
+          // The father gets its other sons and the uncle:
+          for (size_t y = 0; y < nbStates; ++y)
+          {
+            double qy = likelihoodValue(*n.uncle, toUncle, i, y);
+            for (size_t l = 0; l < n.parent->getNumberOfSons(); ++l)
+            {
+              const RecursiveLikelihoodNode* s = static_cast<const RecursiveLikelihoodNode*>(n.parent->getSon(l));
+              if (s != n.son)
+                qy *= likelihoodValue(*s, s->getToFatherBelowLikelihoodArray(ComputingNode::D0), i, y);
+            }
+            q[y] = qy;
+          }
+
+          double lc = 0., lm = 0.;
+          for (size_t x = 0; x < nbStates; ++x)
+          {
+            // The grand father keeps its other sons:
+            double ax = likelihoodValue(*n.grandFather, above, i, x);
+            for (size_t l = 0; l < n.grandFather->getNumberOfSons(); ++l)
+            {
+              const RecursiveLikelihoodNode* s = static_cast<const RecursiveLikelihoodNode*>(n.grandFather->getSon(l));
+              if (s != n.parent && s != n.uncle)
+                ax *= likelihoodValue(*s, s->getToFatherBelowLikelihoodArray(ComputingNode::D0), i, x);
+            }
+            lc += ax * likelihoodValue(*n.parent, toParent, i, x) * likelihoodValue(*n.uncle, toUncle, i, x);
+
+            double px = 0.;
+            for (size_t y = 0; y < nbStates; ++y)
+              px += pxy(x, y) * q[y];
+            lm += ax * likelihoodValue(*n.son, toSon, i, x) * px;
+          }
+          current[i] += classProbabilities[c] * lc;
+          moved[i] += classProbabilities[c] * lm;
+        }
+      }
+
+      double d = 0.;
+      for (size_t i = 0; i < nbPatterns; ++i)
+        d += weights[i] * (log(moved[i]) - log(current[i]));
+      diffs[k] = -d;
+    }
+  };
+
+  if (nbThreads > 1)
+  {
+    SiteLoopExecutor executor(nbThreads);
+    executor.run(nbCandidates, loop);
+  }
+  else
+    loop(0, nbCandidates);
+}
+
+/******************************************************************************/
+
+void SingleProcessPhyloLikelihood::writeCheckpoint(std::ostream& out, bool withLikelihoods) const
+{
+  RecursiveLikelihoodTreeCalculation* rlComp = dynamic_cast<RecursiveLikelihoodTreeCalculation*>(tlComp_.get());
+  if (withLikelihoods && !rlComp)
+    throw Exception("SingleProcessPhyloLikelihood::writeCheckpoint. Likelihood arrays can only be saved with a RecursiveLikelihoodTreeCalculation.");
+
+  writeParameters(out);
+  BinaryTools::writeValue(out, static_cast<uint8_t>(withLikelihoods));
+  if (withLikelihoods)
+  {
+    updateLikelihood();
+    computeLikelihood();
+    rlComp->writeLikelihoods(out);
+  }
+}
+
+/******************************************************************************/
+
+void SingleProcessPhyloLikelihood::readCheckpoint(std::istream& in)
+{
+  readParameters(in);
+  uint8_t withLikelihoods;
+  BinaryTools::readValue(in, withLikelihoods);
+  if (withLikelihoods)
+  {
+    RecursiveLikelihoodTreeCalculation* rlComp = dynamic_cast<RecursiveLikelihoodTreeCalculation*>(tlComp_.get());
+    if (!rlComp)
+      throw IOException("SingleProcessPhyloLikelihood::readCheckpoint. Likelihood arrays can only be restored with a RecursiveLikelihoodTreeCalculation.");
+    rlComp->readLikelihoods(in);
+    // The arrays were saved up to date, for the restored parameters:
+    computeLikelihoods_ = false;
+  }
+}
+
+/******************************************************************************/
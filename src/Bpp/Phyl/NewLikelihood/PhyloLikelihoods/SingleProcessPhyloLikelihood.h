@@ -147,6 +147,17 @@ namespace bpp
       return tlComp_->getAlphabet();
     }
 
+    /**
+     * @brief Add the memory held by the likelihood arrays to a usage
+     * report. It is computed on demand.
+     */
+    void getMemoryUsage(MemoryUsage& usage) const
+    {
+      const AbstractLikelihoodTree* data = dynamic_cast<const AbstractLikelihoodTree*>(&tlComp_->getLikelihoodData());
+      if (data)
+        data->getMemoryUsage(usage);
+    }
+
     /** @} */
 
     /**
@@ -267,6 +278,24 @@ namespace bpp
     
     double getSecondOrderDerivative(const std::string& variable1, const std::string& variable2) const { return 0; } // Not implemented for now.
     
+    /**
+     * @brief Set the weight of each distinct pattern, as in a site
+     * bootstrap replicate.
+     *
+     * Only the derivatives are computed again, the likelihood arrays do
+     * not depend on weights.
+     *
+     * @see LikelihoodTreeCalculation::setPatternWeights
+     */
+    void setPatternWeights(const std::vector<double>& weights)
+    {
+      tlComp_->setPatternWeights(weights);
+      dValues_.clear();
+      d2Values_.clear();
+    }
+
+    const std::vector<double>& getPatternWeights() const { return tlComp_->getPatternWeights(); }
+
     /**
      * @return The underlying likelihood computation structure.
      */
@@ -292,6 +321,42 @@ namespace bpp
     {
       tlComp_->setAllUseLog(useLog);
     }
+
+    /**
+     * @brief set if arrays should be rescaled by powers of 2, which
+     * avoids underflow on large trees without the cost of log
+     * arrays. Exclusive with log.
+     *
+     */
+
+    void setUseScaling(bool useScaling)
+    {
+      tlComp_->setAllUseScaling(useScaling);
+    }
+
+    /**
+     * @brief Write a checkpoint to a binary stream: the parameter values
+     * and, optionally, the conditional likelihood arrays.
+     *
+     * Likelihood arrays can only be saved with a
+     * RecursiveLikelihoodTreeCalculation, and are computed first if
+     * needed.
+     *
+     * @param out The output stream, opened in binary mode.
+     * @param withLikelihoods Tell if likelihood arrays should be saved.
+     */
+    void writeCheckpoint(std::ostream& out, bool withLikelihoods = true) const;
+
+    /**
+     * @brief Resume from a checkpoint written by writeCheckpoint().
+     *
+     * This object must have been built with the same data, tree and
+     * model as the saved one. If likelihood arrays were saved, they are
+     * restored instead of being computed again.
+     *
+     * @throw IOException If the checkpoint does not match this object.
+     */
+    void readCheckpoint(std::istream& in);
       
     /**
      * @brief Implements the Function interface.
@@ -418,6 +483,71 @@ namespace bpp
       
     Vdouble getPosteriorRatePerSite() const;
 
+    /**
+     * @brief Compute in a single pass over the sites the posterior
+     * probabilities of the model classes, the classes with maximum
+     * posterior probability and the posterior mean rates.
+     *
+     * Results are written to caller-provided contiguous buffers, and
+     * computed directly from the root arrays, without intermediate
+     * tables. Any of the buffers may be null, in which case the
+     * corresponding result is not computed.
+     *
+     * @param posteriors Filled with the posterior probabilities, in
+     * [site * nbClasses + class], of size nbSites * nbClasses [out].
+     * @param classes    Filled with the class of maximum posterior
+     * probability of each site, of size nbSites [out].
+     * @param rates      Filled with the posterior mean rate of each site
+     * (rates of the classes weighted by their posterior probabilities),
+     * of size nbSites [out].
+     * @param nbThreads  The number of threads sharing the sites.
+     */
+
+    void computePosteriorsPerSite(double* posteriors, size_t* classes, double* rates, size_t nbThreads = 1) const;
+
+    /* @} */
+
+    /**
+     * @name Scoring of NNI movements
+     *
+     * NNIs are defined as in the NNISearchable interface: the node
+     * swaps with its uncle, the son of its grand father at position 0
+     * (or 1 if its father is at position 0).
+     *
+     * Candidates are scored from the existing arrays: the above
+     * likelihoods of the grand father and the to-father likelihoods of
+     * the neighbors, the branch lengths being unchanged. Each score
+     * costs one pass over the sites, without recursion over the tree.
+     * These methods need a RecursiveLikelihoodTreeCalculation without
+     * patterns and without scaling.
+     *
+     * @{
+     */
+
+    /**
+     * @brief The log-likelihood variation of a NNI, without performing it.
+     *
+     * As in NNISearchable::testNNI, the variation is negative if the
+     * new topology is better.
+     *
+     * @param nodeId The id of the node defining the NNI.
+     * @throw Exception If the node does not define a valid NNI.
+     */
+    double testNNI(int nodeId) const;
+
+    /**
+     * @brief The log-likelihood variations of several NNIs.
+     *
+     * The arrays are first brought up to date, then the candidates are
+     * scored concurrently, the result not depending on the number of
+     * threads.
+     *
+     * @param nodeIds   The ids of the nodes defining the NNIs.
+     * @param diffs     [out] The variations, in the same order.
+     * @param nbThreads The number of threads sharing the candidates.
+     */
+    void testNNIs(const std::vector<int>& nodeIds, std::vector<double>& diffs, size_t nbThreads = 1) const;
+
     /* @} */
 
   };
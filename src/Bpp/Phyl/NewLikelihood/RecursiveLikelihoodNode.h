@@ -47,6 +47,8 @@
 
 // From the STL:
 #include <map>
+#include <algorithm>
+#include <cmath>
 
 namespace bpp
 {
@@ -108,6 +110,48 @@ namespace bpp
 
     VVdouble temp_;
     VVdouble temp2_;
+
+    /*
+     * @brief For leaves, the observed state of each site, or -1 if
+     * the site is ambiguous. Empty for inner nodes.
+     *
+     */
+
+    std::vector<int> leafStates_;
+
+    /*
+     * @brief With scaling, the binary exponents of the below (and to
+     * father) likelihoods of each site, and the part of them coming
+     * from the rescaling of this node. Empty for leaves, which are
+     * not rescaled.
+     *
+     * The D1 and D2 arrays have the same exponents as the D0 ones,
+     * so that they can be multiplied together.
+     *
+     */
+
+    std::vector<int> belowScales_;
+    std::vector<int> belowRescales_;
+
+    /*
+     * @brief With scaling, the binary exponents of the above
+     * likelihoods of each site. Empty for the root.
+     *
+     */
+
+    std::vector<int> aboveScales_;
+
+    /*
+     * @brief The sites (of this node) with only missing data in the
+     * subtree, whose below likelihoods are all 1. Empty if there is
+     * none.
+     *
+     * Transition matrices are then not applied to them: the product
+     * is 1 (and its derivatives 0).
+     *
+     */
+
+    std::vector<bool> missingSites_;
      
     /*
      * @brief Check if likelihood arrays are up to date
@@ -122,6 +166,20 @@ namespace bpp
     bool up2dateD2_BF_;
     bool up2date_A_;
 
+    /*
+     * @brief Versions of the above likelihoods, incremented each time
+     * they are computed, and version of the father's ones when they
+     * were last used here.
+     *
+     * Sons check them lazily in isUp2dateAbove(), so that a change
+     * above a node does not need to be propagated eagerly to the
+     * whole subtree.
+     *
+     */
+
+    unsigned int aboveVersion_;
+    unsigned int fatherAboveVersion_;
+
   public:
     RecursiveLikelihoodNode() :
       AbstractLikelihoodNode(),
@@ -134,13 +192,20 @@ namespace bpp
       nodeLikelihoods_A_(),
       temp_(),
       temp2_(),
+      leafStates_(),
+      belowScales_(),
+      belowRescales_(),
+      aboveScales_(),
+      missingSites_(),
       up2date_B_(false),
       up2dateD_B_(false),
       up2dateD2_B_(false),
       up2date_BF_(false),
       up2dateD_BF_(false),
       up2dateD2_BF_(false),
-      up2date_A_(false)
+      up2date_A_(false),
+      aboveVersion_(0),
+      fatherAboveVersion_(0)
     {}
     
     RecursiveLikelihoodNode(const PhyloNode& np):
@@ -154,13 +219,20 @@ namespace bpp
       nodeLikelihoods_A_(),
       temp_(),
       temp2_(),
+      leafStates_(),
+      belowScales_(),
+      belowRescales_(),
+      aboveScales_(),
+      missingSites_(),
       up2date_B_(false),
       up2dateD_B_(false),
       up2dateD2_B_(false),
       up2date_BF_(false),
       up2dateD_BF_(false),
       up2dateD2_BF_(false),
-      up2date_A_(false)
+      up2date_A_(false),
+      aboveVersion_(0),
+      fatherAboveVersion_(0)
     {}
 
     RecursiveLikelihoodNode(const RecursiveLikelihoodNode& data) :
@@ -174,13 +246,20 @@ namespace bpp
       nodeLikelihoods_A_(data.nodeLikelihoods_A_),
       temp_(data.temp_),
       temp2_(data.temp2_),
+      leafStates_(data.leafStates_),
+      belowScales_(data.belowScales_),
+      belowRescales_(data.belowRescales_),
+      aboveScales_(data.aboveScales_),
+      missingSites_(data.missingSites_),
       up2date_B_(data.up2date_B_),
       up2dateD_B_(data.up2dateD_B_),
       up2dateD2_B_(data.up2dateD2_B_),
       up2date_BF_(data.up2date_BF_),
       up2dateD_BF_(data.up2dateD_BF_),
       up2dateD2_BF_(data.up2dateD2_BF_),
-      up2date_A_(data.up2date_A_)
+      up2date_A_(data.up2date_A_),
+      aboveVersion_(data.aboveVersion_),
+      fatherAboveVersion_(data.fatherAboveVersion_)
     {}
     
     RecursiveLikelihoodNode& operator=(const RecursiveLikelihoodNode& data)
@@ -202,9 +281,16 @@ namespace bpp
       up2dateD_BF_ = data.up2dateD_BF_;
       up2dateD2_BF_ = data.up2dateD2_BF_;
       up2date_A_ = data.up2date_A_;
+      aboveVersion_ = data.aboveVersion_;
+      fatherAboveVersion_ = data.fatherAboveVersion_;
 
       temp_ = data.temp_;
       temp2_ = data.temp2_;
+      leafStates_ = data.leafStates_;
+      belowScales_ = data.belowScales_;
+      belowRescales_ = data.belowRescales_;
+      aboveScales_ = data.aboveScales_;
+      missingSites_ = data.missingSites_;
 
       return *this;
     }
@@ -220,6 +306,9 @@ namespace bpp
     {
       if (useLog==usesLog())
         return;
+
+      if (useLog && usesScaling())
+        setUseScaling(false);
       
       AbstractLikelihoodNode::setUseLog(useLog);
 
@@ -308,29 +397,81 @@ namespace bpp
     }
 
     /*
-     * @brief Updates Above Likelihood flags, recursively down to the
-     * leaves if false and needed.
+     * @brief Switch rescaling of the likelihood arrays.
+     *
+     * With scaling, the values of a site are multiplied by a power of
+     * 2 when their maximum drops below 2^-256 after a product, and the
+     * exponent is accumulated along the tree (as in ExtendedFloat).
+     * Computations stay plain products, instead of sums of logs.
+     *
+     * The arrays of inner nodes are computed again; leaf arrays are
+     * only converted from log.
+     *
+     */
+
+    void setUseScaling(bool useScaling)
+    {
+      if (useScaling==usesScaling())
+        return;
+
+      AbstractLikelihoodNode::setUseScaling(useScaling);
+
+      if (getNumberOfSons()!=0)
+        updateBelow_(false, ComputingNode::D0);
+      updateFatherBelow_(false, ComputingNode::D0);
+      updateAbove(false);
+
+      belowScales_.clear();
+      belowRescales_.clear();
+      aboveScales_.clear();
+    }
+
+    /*
+     * @brief Above Likelihood flags.
+     *
+     * Above likelihoods are up to date if they have been computed
+     * since the last call to updateAbove(false) on this node, and
+     * from the current above likelihoods of the father. The latter
+     * is checked lazily up to the root, so invalidating a node does
+     * not cost a traversal of its subtree.
      *
      */
 
     bool isUp2dateAbove() const
     {
-      return up2date_A_;
+      if (!up2date_A_)
+        return false;
+
+      if (!hasFather())
+        return true;
+
+      const RecursiveLikelihoodNode* father = static_cast<const RecursiveLikelihoodNode*>(getFather());
+      return fatherAboveVersion_ == father->aboveVersion_ && father->isUp2dateAbove();
+    }
+
+    /*
+     * @brief The arrays combining below and above likelihoods are
+     * also out of date when the above likelihoods they were computed
+     * from are, which isUp2dateAbove() detects lazily.
+     *
+     */
+
+    bool isUp2date(unsigned char DX) const
+    {
+      return AbstractLikelihoodNode::isUp2date(DX) && isUp2dateAbove();
     }
 
     void updateAbove(bool check)
     {
       if (!check)
-      {
-        if (up2date_A_)
-        {
-          size_t nS=getNumberOfSons();
-          for (size_t i=0; i<nS; i++)
-            static_cast<RecursiveLikelihoodNode*>(getSon(i))->updateAbove(false);
-        }
         update(false, ComputingNode::D0);
+      else
+      {
+        aboveVersion_++;
+        if (hasFather())
+          fatherAboveVersion_ = static_cast<const RecursiveLikelihoodNode*>(getFather())->aboveVersion_;
       }
-      
+
       up2date_A_=check;
     } 
 
@@ -373,6 +514,28 @@ namespace bpp
       }
     }
  
+    /*
+     * @brief allocate the DX Below likelihood arrays with the sizes
+     * of the D0 ones, if they are not allocated yet.
+     *
+     * Derivative arrays are not allocated at initialization, but on
+     * the first computation of the corresponding derivative, so that
+     * likelihoods used without derivatives do not hold them.
+     *
+     */
+
+    void allocateBelowLikelihoods_(unsigned char DX)
+    {
+      const VVdouble& array0=getBelowLikelihoodArray_(ComputingNode::D0);
+      size_t nbSites=array0.size();
+
+      if (getBelowLikelihoodArray_(DX).size()==nbSites &&
+          (!hasFather() || getToFatherBelowLikelihoodArray_(DX).size()==nbSites))
+        return;
+
+      resetBelowLikelihoods(nbSites, nbSites==0?0:array0[0].size(), DX);
+    }
+
     /*
      * @brief reset the Likelihood for downward recursion
      *
@@ -448,6 +611,14 @@ namespace bpp
         else
           res*=getAboveLikelihoodArray_();
 
+        if (usesScaling())
+        {
+          size_t nbSites=res.size();
+          likelihoodScales_.resize(nbSites);
+          for (size_t i = 0; i < nbSites; i++)
+            likelihoodScales_[i]=getBelowScale_(i) + (aboveScales_.empty()?0:aboveScales_[i]);
+        }
+
         update(true, DX);
       }
     }
@@ -461,6 +632,9 @@ namespace bpp
      
     void computeUpwardToFatherBelowLikelihoods(const SpeciationComputingNode& cNode, unsigned char DX, const Vuint* vBrid= NULL)
     {
+      if (DX!=ComputingNode::D0)
+        allocateBelowLikelihoods_(DX);
+
       // First check below dependencies are up to date
       if (!isUp2dateBelow_(ComputingNode::D0))
         computeUpwardBelowLikelihoods(cNode, ComputingNode::D0, vBrid);
@@ -486,14 +660,21 @@ namespace bpp
       
       VVdouble* res=&(getToFatherBelowLikelihoodArray_(DX));
 
+      if (!leafStates_.empty())
+      {
+        computeUpwardToFatherLeafLikelihoods_(cNode, DX, vBrid);
+        updateFatherBelow_(true, DX);
+        return;
+      }
+
       switch(DX){
       case ComputingNode::D0:
-        cNode.setUpwardPartialLikelihoods(res,
+        setUpwardPartialLikelihoods_(cNode, res,
                                           &(getBelowLikelihoodArray_(ComputingNode::D0)), ComputingNode::D0, usesLog());
         break;
         
       case ComputingNode::D1:
-        cNode.setUpwardPartialLikelihoods(res,
+        setUpwardPartialLikelihoods_(cNode, res,
                                           &(getBelowLikelihoodArray_(ComputingNode::D1)),
                                           ComputingNode::D0,
                                           false);
@@ -501,14 +682,14 @@ namespace bpp
         if (vBrid && VectorTools::contains(*vBrid,getId()))
         {
           if (!usesLog())
-            cNode.addUpwardPartialLikelihoods(res,
+            addUpwardPartialLikelihoods_(cNode, res,
                                               &(getBelowLikelihoodArray_(ComputingNode::D0)),
                                               ComputingNode::D1,
                                               false);
           else
           {
             temp_=VectorTools::exp(getBelowLikelihoodArray_(ComputingNode::D0));
-            cNode.addUpwardPartialLikelihoods(res,
+            addUpwardPartialLikelihoods_(cNode, res,
                                               &temp_,
                                               ComputingNode::D1,
                                               false);
@@ -520,7 +701,7 @@ namespace bpp
       case ComputingNode::D2:
         if (vBrid && VectorTools::contains(*vBrid,getId()))
         {
-          cNode.setUpwardPartialLikelihoods(res,
+          setUpwardPartialLikelihoods_(cNode, res,
                                             &(getBelowLikelihoodArray_(ComputingNode::D1)),
                                             ComputingNode::D1,
                                             false);
@@ -529,26 +710,26 @@ namespace bpp
 
           
           if (!usesLog())
-            cNode.addUpwardPartialLikelihoods(res,
+            addUpwardPartialLikelihoods_(cNode, res,
                                               &(getBelowLikelihoodArray_(ComputingNode::D0)),
                                               ComputingNode::D2,
                                               false);
           else
           {
             temp_=VectorTools::exp(getBelowLikelihoodArray_(ComputingNode::D0));
-            cNode.addUpwardPartialLikelihoods(res,
+            addUpwardPartialLikelihoods_(cNode, res,
                                               &temp_,
                                               ComputingNode::D2,
                                               false);
           }
 
-          cNode.addUpwardPartialLikelihoods(res,
+          addUpwardPartialLikelihoods_(cNode, res,
                                             &(getBelowLikelihoodArray_(ComputingNode::D2)),
                                             ComputingNode::D0,
                                             false);
         }
         else
-          cNode.setUpwardPartialLikelihoods(res,
+          setUpwardPartialLikelihoods_(cNode, res,
                                             &(getBelowLikelihoodArray_(ComputingNode::D2)),
                                             ComputingNode::D0,
                                             false);
@@ -565,6 +746,9 @@ namespace bpp
      
     void computeUpwardBelowLikelihoods(const SpeciationComputingNode& cNode, unsigned char DX, const Vuint* vBrid= NULL)
     {
+      if (DX!=ComputingNode::D0)
+        allocateBelowLikelihoods_(DX);
+
       // First check below dependencies are up to date
       size_t nbSons=getNumberOfSons();
 
@@ -628,6 +812,9 @@ namespace bpp
               multiplyLikelihoodsFromSon_(res, &temp_, l);
           }
         }
+
+        if (usesScaling())
+          scaleBelowLikelihoods_();
         
         break;
           
@@ -709,6 +896,10 @@ namespace bpp
         }
       }
 
+      // Derivatives follow the rescaling of the likelihoods.
+      if (usesScaling() && DX!=ComputingNode::D0)
+        applyRescales_(*res, belowRescales_);
+
       updateBelow_(true, DX);
     }
 
@@ -731,6 +922,8 @@ namespace bpp
       else
         for (size_t i=0; i<nbSites; i++)
           abArray[i]=rootFreq;
+
+      aboveScales_.clear();
     }
 
     void setAboveLikelihoods(const VVdouble& initFreq)
@@ -745,6 +938,8 @@ namespace bpp
       else
         for (size_t i=0; i<nbSites; i++)
           abArray[i]=initFreq[i];
+
+      aboveScales_.clear();
     }
 
     /*
@@ -811,6 +1006,9 @@ namespace bpp
         }
               
         cNode.setDownwardPartialLikelihoods(&getAboveLikelihoodArray_(), &temp_, ComputingNode::D0, usesLog());
+
+        if (usesScaling())
+          scaleAboveLikelihoods_(*father);
       }
       
       updateAbove(true);
@@ -913,9 +1111,352 @@ namespace bpp
     VVdouble& getAboveLikelihoodArray_() {
       return nodeLikelihoods_A_; }
 
+    /*
+     * @brief Set the observed states of a leaf from its below
+     * likelihood array: a site is unambiguous if exactly one state
+     * has likelihood 1 and the others 0.
+     *
+     */
+
+    void setLeafStates_()
+    {
+      const VVdouble& array=getBelowLikelihoodArray_(ComputingNode::D0);
+      size_t nbSites=array.size();
+      leafStates_.assign(nbSites, -1);
+
+      double one = usesLog()?0:1;
+      double zero = usesLog()?NumConstants::MINF():0;
+
+      for (size_t i = 0; i < nbSites; i++)
+      {
+        int state = -1;
+        size_t nbStates=array[i].size();
+        for (size_t s = 0; s < nbStates; s++)
+        {
+          if (array[i][s]==one && state==-1)
+            state=static_cast<int>(s);
+          else if (array[i][s]!=zero)
+          {
+            state=-1;
+            break;
+          }
+        }
+        leafStates_[i]=state;
+      }
+    }
+
+    /*
+     * @brief Compute the DXToFatherBelowLikelihoods of a leaf.
+     *
+     * For unambiguous sites, the product of the transition matrix
+     * with the leaf likelihoods is a column of the matrix, so it is
+     * read from a table of columns built once per call. Ambiguous
+     * sites use the general per site computation. If the model uses
+     * uniformization, only the columns of the observed states are
+     * computed.
+     *
+     * For derivatives, the below D1 and D2 arrays of a leaf are
+     * null, so only the term with the derivated matrix remains.
+     *
+     */
+
+    void computeUpwardToFatherLeafLikelihoods_(const SpeciationComputingNode& cNode, unsigned char DX, const Vuint* vBrid)
+    {
+      VVdouble& res=getToFatherBelowLikelihoodArray_(DX);
+      size_t nbSites=res.size();
+
+      bool derivated = (DX==ComputingNode::D0) || (vBrid && VectorTools::contains(*vBrid,getId()));
+      bool logOut = (DX==ComputingNode::D0) && usesLog();
+
+      if (!derivated)
+      {
+        for (size_t i = 0; i < nbSites; i++)
+          std::fill(res[i].begin(), res[i].end(), 0.);
+        return;
+      }
+
+      size_t nbStates=cNode.getModel()->getNumberOfStates();
+
+      // columns of the matrix, indexed by leaf state
+      VVdouble table(nbStates, Vdouble(nbStates));
+      if (DX==ComputingNode::D0 && !logOut && cNode.usesUniformization())
+      {
+        // only the columns of the observed states are computed, as
+        // products of the matrix with unit vectors
+        std::vector<bool> observed(nbStates, false);
+        for (size_t i = 0; i < nbSites; i++)
+          if (leafStates_[i]>=0)
+            observed[static_cast<size_t>(leafStates_[i])]=true;
+
+        Vdouble unit(nbStates, 0.);
+        for (size_t y = 0; y < nbStates; y++)
+          if (observed[y])
+          {
+            unit[y]=1.;
+            cNode.setUpwardLikelihoodsAtASite(&table[y], &unit, DX, false);
+            unit[y]=0.;
+          }
+      }
+      else
+      {
+        const Matrix<double>& P = (DX==ComputingNode::D0)?cNode.getTransitionProbabilities():
+          ((DX==ComputingNode::D1)?cNode.getTransitionProbabilitiesD1():cNode.getTransitionProbabilitiesD2());
+
+        for (size_t y = 0; y < nbStates; y++)
+        {
+          for (size_t x = 0; x < nbStates; x++)
+          {
+            double t=P(x, y);
+            table[y][x] = logOut?(t<=0?NumConstants::MINF():log(t)):t;
+          }
+        }
+      }
+
+      const VVdouble* below=&getBelowLikelihoodArray_(ComputingNode::D0);
+      if (usesLog() && !logOut)
+      {
+        temp_=VectorTools::exp(*below);
+        below=&temp_;
+      }
+
+      for (size_t i = 0; i < nbSites; i++)
+      {
+        int state=leafStates_[i];
+        if (state>=0)
+          res[i]=table[static_cast<size_t>(state)];
+        else if (!missingSites_.empty() && missingSites_[i])
+          res[i].assign(res[i].size(), DX==ComputingNode::D0 ? (logOut ? 0. : 1.) : 0.);
+        else
+          cNode.setUpwardLikelihoodsAtASite(&res[i], &(*below)[i], DX, logOut);
+      }
+    }
+
+    /*
+     * @brief Set the missing sites of this node: at a leaf, the sites
+     * where all states have likelihood 1; at an inner node, the sites
+     * missing in all the sons.
+     *
+     * Sons must have been set before.
+     *
+     */
+
+    void setMissingSites_()
+    {
+      missingSites_.clear();
+      size_t nbSites=getBelowLikelihoodArray_(ComputingNode::D0).size();
+      std::vector<bool> missing(nbSites, true);
+
+      if (getNumberOfSons()==0)
+      {
+        const VVdouble& array=getBelowLikelihoodArray_(ComputingNode::D0);
+        double one = usesLog()?0:1;
+        for (size_t i = 0; i < nbSites; i++)
+          for (size_t s = 0; s < array[i].size() && missing[i]; s++)
+            missing[i] = (array[i][s]==one);
+      }
+      else
+      {
+        for (size_t l = 0; l < getNumberOfSons(); l++)
+        {
+          const RecursiveLikelihoodNode* son=static_cast<const RecursiveLikelihoodNode*>(getSon(l));
+          if (son->missingSites_.empty())
+            return;
+          for (size_t i = 0; i < nbSites; i++)
+            missing[i] = missing[i] && son->missingSites_[vPatt_.size()!=0 ? (*vPatt_[l])[i] : i];
+        }
+      }
+
+      if (std::find(missing.begin(), missing.end(), true)!=missing.end())
+        missingSites_=missing;
+    }
+
+    /*
+     * @brief Apply the transition matrix to the below likelihoods of
+     * the sites that are not missing. With set, missing sites get 1
+     * when likelihoods_self is the D0 below array, 0 otherwise (a D1
+     * or D2 below array is null there); with add, they are skipped
+     * since the derivated matrices have null row sums.
+     *
+     */
+
+    void setUpwardPartialLikelihoods_(const SpeciationComputingNode& cNode, VVdouble* likelihoods, const VVdouble* likelihoods_self, unsigned char DX, bool logOut)
+    {
+      if (missingSites_.empty())
+      {
+        cNode.setUpwardPartialLikelihoods(likelihoods, likelihoods_self, DX, logOut);
+        return;
+      }
+
+      double missingValue = (likelihoods_self==&nodeLikelihoods_B_) ? (logOut ? 0. : 1.) : 0.;
+      size_t nbSites=likelihoods->size();
+      for (size_t i = 0; i < nbSites; i++)
+        if (missingSites_[i])
+          (*likelihoods)[i].assign((*likelihoods)[i].size(), missingValue);
+        else
+          cNode.setUpwardLikelihoodsAtASite(&(*likelihoods)[i], &(*likelihoods_self)[i], DX, logOut);
+    }
+
+    void addUpwardPartialLikelihoods_(const SpeciationComputingNode& cNode, VVdouble* likelihoods, const VVdouble* likelihoods_self, unsigned char DX, bool logOut)
+    {
+      if (missingSites_.empty())
+      {
+        cNode.addUpwardPartialLikelihoods(likelihoods, likelihoods_self, DX, logOut);
+        return;
+      }
+
+      size_t nbSites=likelihoods->size();
+      for (size_t i = 0; i < nbSites; i++)
+        if (!missingSites_[i])
+          cNode.addUpwardLikelihoodsAtASite(&(*likelihoods)[i], &(*likelihoods_self)[i], DX, logOut);
+    }
+
+    /*
+     * @brief Set the likelihoods of a class of rate 0 at the root.
+     *
+     * Transition probabilities are then the identity on all branches,
+     * so the likelihood of state x is the product of the leaf values
+     * for x (given in constantPatterns), times the root frequency.
+     * Derivatives are null.
+     *
+     */
+
+    void setConstantLikelihoods_(const VVdouble& constantPatterns, unsigned char DX)
+    {
+      VVdouble& res=getLikelihoodArray(DX);
+      size_t nbSites=res.size();
+
+      if (DX!=ComputingNode::D0)
+      {
+        for (size_t i = 0; i < nbSites; i++)
+          res[i].assign(res[i].size(), 0);
+      }
+      else
+      {
+        const VVdouble& above=getAboveLikelihoodArray_();
+        for (size_t i = 0; i < nbSites; i++)
+          for (size_t s = 0; s < res[i].size(); s++)
+          {
+            double x = constantPatterns[i][s];
+            res[i][s] = usesLog() ? (x<=0?NumConstants::MINF():log(x)) + above[i][s] : x * above[i][s];
+          }
+      }
+
+      likelihoodScales_.clear();
+      update(true, DX);
+    }
+
+    /*
+     * @brief Scaling helpers.
+     *
+     * A site is rescaled when its largest value is below 2^-256: the
+     * values are multiplied by 2^-e, where 2^e is the binary exponent
+     * of the maximum, so that the maximum is back in [0.5, 1).
+     *
+     */
+
+    int getBelowScale_(size_t nSite) const
+    {
+      return belowScales_.empty() ? 0 : belowScales_[nSite];
+    }
+
+    static void rescaleSites_(VVdouble& array, std::vector<int>& rescales)
+    {
+      const double threshold = std::ldexp(1., -256);
+      size_t nbSites=array.size();
+      rescales.resize(nbSites);
+      for (size_t i = 0; i < nbSites; i++)
+      {
+        Vdouble& array_i = array[i];
+        double max = 0;
+        for (size_t s = 0; s < array_i.size(); s++)
+          if (array_i[s] > max)
+            max = array_i[s];
+
+        int e = 0;
+        if (max > 0 && max < threshold)
+        {
+          std::frexp(max, &e);
+          for (size_t s = 0; s < array_i.size(); s++)
+            array_i[s] = std::ldexp(array_i[s], -e);
+        }
+        rescales[i] = e;
+      }
+    }
+
+    static void applyRescales_(VVdouble& array, const std::vector<int>& rescales)
+    {
+      for (size_t i = 0; i < rescales.size(); i++)
+        if (rescales[i] != 0)
+          for (size_t s = 0; s < array[i].size(); s++)
+            array[i][s] = std::ldexp(array[i][s], -rescales[i]);
+    }
+
+    /*
+     * @brief Rescale the below likelihoods just computed from the
+     * sons, and set their exponents from the exponents of the sons.
+     *
+     */
+
+    void scaleBelowLikelihoods_()
+    {
+      VVdouble& array=getBelowLikelihoodArray_(ComputingNode::D0);
+      rescaleSites_(array, belowRescales_);
+
+      size_t nbSites=array.size();
+      belowScales_=belowRescales_;
+      for (size_t l = 0; l < getNumberOfSons(); l++)
+      {
+        const RecursiveLikelihoodNode* son=static_cast<const RecursiveLikelihoodNode*>(getSon(l));
+        if (son->belowScales_.empty())
+          continue;
+        if (vPatt_.size()!=0)
+        {
+          const std::vector<size_t>& patterns=*vPatt_[l];
+          for (size_t i = 0; i < nbSites; i++)
+            belowScales_[i]+=son->belowScales_[patterns[i]];
+        }
+        else
+          for (size_t i = 0; i < nbSites; i++)
+            belowScales_[i]+=son->belowScales_[i];
+      }
+    }
+
+    /*
+     * @brief Rescale the above likelihoods just computed from the
+     * father and the brothers, and set their exponents.
+     *
+     */
+
+    void scaleAboveLikelihoods_(const RecursiveLikelihoodNode& father)
+    {
+      VVdouble& array=getAboveLikelihoodArray_();
+      std::vector<int> rescales;
+      rescaleSites_(array, rescales);
+
+      size_t nbSites=array.size();
+      aboveScales_=rescales;
+      if (!father.aboveScales_.empty())
+        for (size_t i = 0; i < nbSites; i++)
+          aboveScales_[i]+=father.aboveScales_[i];
+
+      for (size_t l = 0; l < father.getNumberOfSons(); l++)
+      {
+        const RecursiveLikelihoodNode* bro=static_cast<const RecursiveLikelihoodNode*>(father.getSon(l));
+        if (bro!=this && !bro->belowScales_.empty())
+          for (size_t i = 0; i < nbSites; i++)
+            aboveScales_[i]+=bro->belowScales_[i];
+      }
+    }
+
     /*
      * @brief  Use patterns or not for computing likelihood arrays from sons
      *
+     * With patterns, the arrays of each node are sized to the number of
+     * distinct columns of its own clade (see
+     * RecursiveLikelihoodTree::initLikelihoodsWithPatterns_), and
+     * vPatt_[sonNb][i] gives the index of the pattern of son sonNb
+     * matching pattern i of this node.
+     *
      */
     
     void multiplyLikelihoodsFromSon_(VVdouble* likelihoods_out, const VVdouble* likelihoods_in, size_t sonNb)
@@ -41,6 +41,7 @@
 #include "RecursiveLikelihoodTree.h"
 #include "SpeciationComputingNode.h"
 #include "../PatternTools.h"
+#include "../Io/BinaryTools.h"
 
 // From bpp-seq:
 
@@ -60,7 +61,10 @@ RecursiveLikelihoodTree::RecursiveLikelihoodTree(const SubstitutionProcess& proc
   vTree_(),
   patternLinks_(),
   usePatterns_(usepatterns),
-  initializedAboveLikelihoods_(false)
+  initializedAboveLikelihoods_(false),
+  classLoopExecutor_(),
+  constantPatterns_(),
+  constantClasses_(nbClasses_, 0)
 {
   for (size_t i = 0; i < nbClasses_; i++)
   {
@@ -79,7 +83,10 @@ RecursiveLikelihoodTree::RecursiveLikelihoodTree(const RecursiveLikelihoodTree&
   vTree_(),
   patternLinks_(data.patternLinks_),
   usePatterns_(data.usePatterns_),
-  initializedAboveLikelihoods_(data.initializedAboveLikelihoods_)
+  initializedAboveLikelihoods_(data.initializedAboveLikelihoods_),
+  classLoopExecutor_(),
+  constantPatterns_(data.constantPatterns_),
+  constantClasses_(data.constantClasses_)
 {
   for (size_t i = 0; i < data.vTree_.size(); i++)
   {
@@ -89,6 +96,8 @@ RecursiveLikelihoodTree::RecursiveLikelihoodTree(const RecursiveLikelihoodTree&
       vCN[j]->updateTree(pTC2.get(), pTC2->getNodeIndex(vCN[j]));
     vTree_.push_back(pTC2);
   }
+
+  setNumberOfThreads(data.getNumberOfThreads());
 }
 
 RecursiveLikelihoodTree& RecursiveLikelihoodTree::operator=(const RecursiveLikelihoodTree& data)
@@ -108,6 +117,10 @@ RecursiveLikelihoodTree& RecursiveLikelihoodTree::operator=(const RecursiveLikel
   patternLinks_      = data.patternLinks_;
   usePatterns_       = data.usePatterns_;
   initializedAboveLikelihoods_ = data.initializedAboveLikelihoods_;
+  constantPatterns_  = data.constantPatterns_;
+  constantClasses_   = data.constantClasses_;
+
+  setNumberOfThreads(data.getNumberOfThreads());
 
   return *this;
 }
@@ -117,6 +130,56 @@ RecursiveLikelihoodTree::~RecursiveLikelihoodTree()
   vTree_.clear();
 }
 
+/******************************************************************************/
+
+void RecursiveLikelihoodTree::setNumberOfThreads(size_t nbThreads)
+{
+  if (nbThreads <= 1)
+    classLoopExecutor_.reset();
+  else if (!classLoopExecutor_ || classLoopExecutor_->getNumberOfThreads() != nbThreads)
+    classLoopExecutor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
+/******************************************************************************/
+
+void RecursiveLikelihoodTree::runClassLoop_(const std::function<void(size_t, size_t)>& loop) const
+{
+  if (classLoopExecutor_)
+    classLoopExecutor_->run(vTree_.size(), loop);
+  else
+    loop(0, vTree_.size());
+}
+
+/******************************************************************************/
+
+void RecursiveLikelihoodTree::computeTransitionProbabilities_(const ComputingTree& lTree, unsigned char DX, const Vuint* brId, bool downward) const
+{
+  for (size_t c = 0; c < vTree_.size(); ++c)
+  {
+    std::vector<std::shared_ptr<ComputingNode> > vCN = lTree[c]->getAllNodes();
+
+    for (size_t j = 0; j < vCN.size(); ++j)
+    {
+      const SpeciationComputingNode* cNode = dynamic_cast<const SpeciationComputingNode*>(vCN[j].get());
+      if (!cNode || !cNode->getModel())
+        continue;
+
+      if (cNode->usesUniformization())
+        cNode->prepareUniformization();
+
+      if (downward || !cNode->usesUniformization())
+        cNode->getTransitionProbabilities();
+
+      if (DX != ComputingNode::D0 && brId && VectorTools::contains(*brId, cNode->getId()))
+      {
+        cNode->getTransitionProbabilitiesD1();
+        if (DX == ComputingNode::D2)
+          cNode->getTransitionProbabilitiesD2();
+      }
+    }
+  }
+}
+
 void RecursiveLikelihoodTree::initLikelihoods(const AlignedValuesContainer& sites, const SubstitutionProcess& process)
 {
   if (sites.getNumberOfSequences() == 1)
@@ -149,6 +212,99 @@ void RecursiveLikelihoodTree::initLikelihoods(const AlignedValuesContainer& site
     nbDistinctSites_  = shrunkData_->getNumberOfSites();
     initLikelihoodsWithoutPatterns_(vTree_[0]->getRoot().get(), *shrunkData_, process);
   }
+
+  constantPatterns_ = computeConstantPatterns_(*vTree_[0]->getRoot());
+  initMissingSites_(*vTree_[0]->getRoot());
+}
+
+/******************************************************************************/
+
+void RecursiveLikelihoodTree::initLikelihoods(const AlignedValuesContainer& sites, const SubstitutionProcess& process, const LikelihoodTree& shared)
+{
+  const RecursiveLikelihoodTree* rShared = dynamic_cast<const RecursiveLikelihoodTree*>(&shared);
+
+  // Patterns depend on the topology, they can not be shared.
+  if (usePatterns_ || !rShared || rShared->usePatterns_ || !rShared->shrunkData_
+      || rShared->nbSites_ != sites.getNumberOfSites())
+  {
+    initLikelihoods(sites, process);
+    return;
+  }
+
+  if (sites.getNumberOfSequences() == 1)
+    throw Exception("RecursiveLikelihoodTree::initLikelihoods. Only 1 sequence in data set.");
+  if (sites.getNumberOfSequences() == 0)
+    throw Exception("RecursiveLikelihoodTree::initLikelihoods. No sequence in data set.");
+  if (!process.isCompatibleWith(sites))
+    throw Exception("RecursiveLikelihoodTree::initLikelihoods. Data and model are not compatible.");
+  alphabet_ = sites.getAlphabet();
+  nbStates_ = process.getNumberOfStates();
+  nbSites_  = sites.getNumberOfSites();
+
+  shrunkData_       = rShared->shrunkData_;
+  rootWeights_      = rShared->rootWeights_;
+  rootPatternLinks_ = rShared->rootPatternLinks_;
+  nbDistinctSites_  = rShared->nbDistinctSites_;
+  initLikelihoodsWithoutPatterns_(vTree_[0]->getRoot().get(), *shrunkData_, process);
+  constantPatterns_ = rShared->constantPatterns_;
+  initMissingSites_(*vTree_[0]->getRoot());
+}
+
+/******************************************************************************/
+
+VVdouble RecursiveLikelihoodTree::computeConstantPatterns_(const RecursiveLikelihoodNode& node) const
+{
+  if (node.hasNoSon())
+  {
+    const VVdouble& array = node.getBelowLikelihoodArray(ComputingNode::D0);
+    return node.usesLog() ? VectorTools::exp(array) : array;
+  }
+
+  int nId = node.getId();
+  VVdouble table;
+  size_t nbSonNodes = node.getNumberOfSons();
+  for (size_t l = 0; l < nbSonNodes; ++l)
+  {
+    const RecursiveLikelihoodNode* son = dynamic_cast<const RecursiveLikelihoodNode*>(node[(int)l]);
+    VVdouble sonTable = computeConstantPatterns_(*son);
+    const std::vector<size_t>& links = patternLinks_[nId][son->getId()];
+
+    if (l == 0)
+      table.assign(links.size(), Vdouble(nbStates_, 1.));
+
+    for (size_t i = 0; i < links.size(); i++)
+      for (size_t s = 0; s < nbStates_; s++)
+        table[i][s] *= sonTable[links[i]][s];
+  }
+
+  return table;
+}
+
+/******************************************************************************/
+
+void RecursiveLikelihoodTree::initMissingSites_(const RecursiveLikelihoodNode& node)
+{
+  size_t nbSonNodes = node.getNumberOfSons();
+  for (size_t l = 0; l < nbSonNodes; ++l)
+    initMissingSites_(*dynamic_cast<const RecursiveLikelihoodNode*>(node[(int)l]));
+
+  for (size_t c = 0; c < nbClasses_; c++)
+    vTree_[c]->getNode(static_cast<NodeIndex>(node.getId()))->setMissingSites_();
+}
+
+/******************************************************************************/
+
+void RecursiveLikelihoodTree::updateConstantClasses_(const ComputingTree& lTree)
+{
+  unsigned int rId = lTree[0]->getNodeIndex(lTree[0]->getRoot());
+
+  for (size_t c = 0; c < vTree_.size(); ++c)
+  {
+    bool constant = !constantPatterns_.empty() && lTree.getRateForClass(c) == 0;
+    if (constantClasses_[c] && !constant)
+      vTree_[c]->getNode(rId)->update(false, ComputingNode::D0);
+    constantClasses_[c] = constant;
+  }
 }
 
 /******************************************************************************/
@@ -172,8 +328,8 @@ void RecursiveLikelihoodTree::initLikelihoodsWithoutPatterns_(const RecursiveLik
   }
   
   resetBelowLikelihoods(nId, nbDistinctSites_, nbStates_, ComputingNode::D0);
-  resetBelowLikelihoods(nId, nbDistinctSites_, nbStates_, ComputingNode::D1);
-  resetBelowLikelihoods(nId, nbDistinctSites_, nbStates_, ComputingNode::D2);
+  // D1 and D2 Below arrays are allocated on the first computation of
+  // derivatives.
   
   // Now initialize likelihood values and pointers:
 
@@ -189,6 +345,9 @@ void RecursiveLikelihoodTree::initLikelihoodsWithoutPatterns_(const RecursiveLik
       throw SequenceNotFoundException("RecursiveLikelihoodTree::initTreelikelihoods. Leaf name in tree not found in site container: ", tree.getNode(node->getId())->getName());
     }
 
+    // Integer-coded characters are looked up in a table rather than resolved for each state:
+    const SiteContainer* sc = dynamic_cast<const SiteContainer*>(&sequences);
+    StateIndicatorTable indicators(statemap);
     for (size_t c = 0; c < nbClasses_; c++)
     {
       RecursiveLikelihoodNode& lNode = dynamic_cast<RecursiveLikelihoodNode&>(*vTree_[c]->getNode(nId));
@@ -197,11 +356,12 @@ void RecursiveLikelihoodTree::initLikelihoodsWithoutPatterns_(const RecursiveLik
       for (size_t i = 0; i < nbDistinctSites_; i++)
       {
         Vdouble* array_i = &array[i];
+        const Vdouble* profile = sc ? &indicators.getIndicators(sc->getSite(i)[posSeq]) : 0;
 
         double test = 0.;
         for (size_t s = 0; s < nbStates_; s++)
         {
-          double x = sequences.getStateValueAt(i, posSeq, statemap.getAlphabetStateAsInt(s));
+          double x = profile ? (*profile)[s] : sequences.getStateValueAt(i, posSeq, statemap.getAlphabetStateAsInt(s));
           
           (*array_i)[s] = lNode.usesLog()?(x<=0?NumConstants::MINF():log(x)):x;
 
@@ -212,6 +372,7 @@ void RecursiveLikelihoodTree::initLikelihoodsWithoutPatterns_(const RecursiveLik
           std::cerr << "WARNING!!! Likelihood will be 0 for this site " << TextTools::toString(i) << std::endl;
       }
       lNode.updateBelow_(true, ComputingNode::D0);
+      lNode.setLeafStates_();
     }
   }
   else
@@ -267,9 +428,8 @@ SitePatterns* RecursiveLikelihoodTree::initLikelihoodsWithPatterns_(const Recurs
   }
 
   resetBelowLikelihoods(nId, nbSites, nbStates_, ComputingNode::D0);
-
-  resetBelowLikelihoods(nId, nbSites, nbStates_, ComputingNode::D1);
-  resetBelowLikelihoods(nId, nbSites, nbStates_, ComputingNode::D2);
+  // D1 and D2 Below arrays are allocated on the first computation of
+  // derivatives.
 
 
   // Now initialize likelihood values and pointers:
@@ -286,6 +446,8 @@ SitePatterns* RecursiveLikelihoodTree::initLikelihoodsWithPatterns_(const Recurs
       throw SequenceNotFoundException("RecursiveLikelihoodTree::initTreelikelihoodsWithPatterns_. Leaf name in tree not found in site container: ", tree.getNode(node->getId())->getName());
     }
 
+    const SiteContainer* sc = dynamic_cast<const SiteContainer*>(subSequences.get());
+    StateIndicatorTable indicators(statemap);
     for (size_t c = 0; c < nbClasses_; c++)
     {
       RecursiveLikelihoodNode& lNode = dynamic_cast<RecursiveLikelihoodNode&>(*vTree_[c]->getNode(nId));
@@ -294,11 +456,12 @@ SitePatterns* RecursiveLikelihoodTree::initLikelihoodsWithPatterns_(const Recurs
       for (size_t i = 0; i < nbSites; i++)
       {
         Vdouble* array_i = &array[i];
+        const Vdouble* profile = sc ? &indicators.getIndicators(sc->getSite(i)[posSeq]) : 0;
 
         double test = 0.;
         for (size_t s = 0; s < nbStates_; s++)
         {
-          double x = subSequences->getStateValueAt(i, posSeq, statemap.getAlphabetStateAsInt(s));
+          double x = profile ? (*profile)[s] : subSequences->getStateValueAt(i, posSeq, statemap.getAlphabetStateAsInt(s));
 
           (*array_i)[s] = lNode.usesLog()?(x <= 0?NumConstants::MINF():log(x)):x;
 
@@ -309,6 +472,7 @@ SitePatterns* RecursiveLikelihoodTree::initLikelihoodsWithPatterns_(const Recurs
           std::cerr << "WARNING!!! Likelihood will be 0 for this site " << TextTools::toString(i) << std::endl;
       }
       lNode.updateBelow_(true, ComputingNode::D0);
+      lNode.setLeafStates_();
     }
   }
   else
@@ -357,3 +521,155 @@ void RecursiveLikelihoodTree::resetInnerAboveLikelihoods()
 
   initializedAboveLikelihoods_ = true;
 }
+
+/******************************************************************************/
+
+namespace
+{
+  const char LIKELIHOODS_MAGIC[4] = {'B', 'P', 'P', 'L'};
+  const uint32_t LIKELIHOODS_VERSION = 1;
+
+  void writeVVdouble(ostream& out, const VVdouble& v)
+  {
+    BinaryTools::writeValue(out, static_cast<uint64_t>(v.size()));
+    BinaryTools::writeValue(out, static_cast<uint64_t>(v.empty() ? 0 : v[0].size()));
+    for (size_t i = 0; i < v.size(); i++)
+      BinaryTools::writeArray(out, v[i]);
+  }
+
+  /**
+   * @brief Read an array written by writeVVdouble, which must be empty or
+   * have the expected dimensions.
+   */
+  void readVVdouble(istream& in, VVdouble& v, size_t expectedRows, size_t expectedCols)
+  {
+    uint64_t nbRows, nbCols;
+    BinaryTools::readValue(in, nbRows);
+    BinaryTools::readValue(in, nbCols);
+    if (nbRows != 0 && (nbRows != expectedRows || nbCols != expectedCols))
+      throw IOException("RecursiveLikelihoodTree::readLikelihoods. Saved array of size " + TextTools::toString(nbRows) + "x" + TextTools::toString(nbCols)
+          + " does not match the data (" + TextTools::toString(expectedRows) + "x" + TextTools::toString(expectedCols) + ").");
+    v.resize(static_cast<size_t>(nbRows));
+    for (size_t i = 0; i < v.size(); i++)
+    {
+      v[i].resize(static_cast<size_t>(nbCols));
+      BinaryTools::readArray(in, v[i]);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void RecursiveLikelihoodTree::writeLikelihoods(std::ostream& out) const
+{
+  BinaryTools::writeHeader(out, LIKELIHOODS_MAGIC, LIKELIHOODS_VERSION);
+  BinaryTools::writeValue(out, static_cast<uint64_t>(nbClasses_));
+  BinaryTools::writeValue(out, static_cast<uint8_t>(usePatterns_));
+  BinaryTools::writeValue(out, static_cast<uint8_t>(initializedAboveLikelihoods_));
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    vector<shared_ptr<RecursiveLikelihoodNode> > vNd = vTree_[c]->getAllNodes();
+    BinaryTools::writeValue(out, static_cast<uint64_t>(vNd.size()));
+    for (size_t j = 0; j < vNd.size(); j++)
+    {
+      const RecursiveLikelihoodNode& node = *vNd[j];
+      BinaryTools::writeValue(out, static_cast<uint32_t>(vTree_[c]->getNodeIndex(vNd[j])));
+      uint8_t flags = static_cast<uint8_t>(
+        (node.up2date_ ? 1 : 0) | (node.up2date_B_ ? 2 : 0) | (node.up2date_BF_ ? 4 : 0)
+        | (node.up2date_A_ ? 8 : 0) | (node.usesLog_ ? 16 : 0));
+      BinaryTools::writeValue(out, flags);
+      BinaryTools::writeValue(out, static_cast<uint32_t>(node.aboveVersion_));
+      BinaryTools::writeValue(out, static_cast<uint32_t>(node.fatherAboveVersion_));
+      writeVVdouble(out, node.nodeLikelihoods_);
+      writeVVdouble(out, node.nodeLikelihoods_B_);
+      writeVVdouble(out, node.node_fatherLikelihoods_B_);
+      writeVVdouble(out, node.nodeLikelihoods_A_);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void RecursiveLikelihoodTree::readLikelihoods(std::istream& in)
+{
+  if (!BinaryTools::readHeader(in, LIKELIHOODS_MAGIC, LIKELIHOODS_VERSION))
+    throw IOException("RecursiveLikelihoodTree::readLikelihoods. No likelihood arrays found in stream.");
+  uint64_t nbClasses;
+  uint8_t usePatterns, initializedAbove;
+  BinaryTools::readValue(in, nbClasses);
+  BinaryTools::readValue(in, usePatterns);
+  BinaryTools::readValue(in, initializedAbove);
+  if (nbClasses != nbClasses_ || (usePatterns != 0) != usePatterns_)
+    throw IOException("RecursiveLikelihoodTree::readLikelihoods. Saved arrays do not match the process.");
+
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    vector<shared_ptr<RecursiveLikelihoodNode> > vNd = vTree_[c]->getAllNodes();
+    map<uint32_t, RecursiveLikelihoodNode*> nodes;
+    for (size_t j = 0; j < vNd.size(); j++)
+      nodes[static_cast<uint32_t>(vTree_[c]->getNodeIndex(vNd[j]))] = vNd[j].get();
+
+    uint64_t nbNodes;
+    BinaryTools::readValue(in, nbNodes);
+    if (nbNodes != nodes.size())
+      throw IOException("RecursiveLikelihoodTree::readLikelihoods. Saved arrays do not match the tree.");
+    for (size_t j = 0; j < nbNodes; j++)
+    {
+      uint32_t index, aboveVersion, fatherAboveVersion;
+      uint8_t flags;
+      BinaryTools::readValue(in, index);
+      map<uint32_t, RecursiveLikelihoodNode*>::iterator it = nodes.find(index);
+      if (it == nodes.end())
+        throw IOException("RecursiveLikelihoodTree::readLikelihoods. Unknown node index " + TextTools::toString(index) + ".");
+      RecursiveLikelihoodNode& node = *it->second;
+      BinaryTools::readValue(in, flags);
+      BinaryTools::readValue(in, aboveVersion);
+      BinaryTools::readValue(in, fatherAboveVersion);
+      readVVdouble(in, node.nodeLikelihoods_, nbDistinctSites_, nbStates_);
+      readVVdouble(in, node.nodeLikelihoods_B_, nbDistinctSites_, nbStates_);
+      readVVdouble(in, node.node_fatherLikelihoods_B_, nbDistinctSites_, nbStates_);
+      readVVdouble(in, node.nodeLikelihoods_A_, nbDistinctSites_, nbStates_);
+      node.up2date_ = (flags & 1) != 0;
+      node.up2date_B_ = (flags & 2) != 0;
+      node.up2date_BF_ = (flags & 4) != 0;
+      node.up2date_A_ = (flags & 8) != 0;
+      node.usesLog_ = (flags & 16) != 0;
+      node.up2dateD_ = node.up2dateD2_ = false;
+      node.up2dateD_B_ = node.up2dateD2_B_ = false;
+      node.up2dateD_BF_ = node.up2dateD2_BF_ = false;
+      node.aboveVersion_ = aboveVersion;
+      node.fatherAboveVersion_ = fatherAboveVersion;
+    }
+  }
+  initializedAboveLikelihoods_ = (initializedAbove != 0);
+}
+
+/******************************************************************************/
+
+void RecursiveLikelihoodTree::getMemoryUsage(MemoryUsage& usage) const
+{
+  AbstractLikelihoodTree::getMemoryUsage(usage);
+  for (size_t c = 0; c < vTree_.size(); c++)
+  {
+    vector<shared_ptr<RecursiveLikelihoodNode> > vNd = vTree_[c]->getAllNodes();
+    for (size_t j = 0; j < vNd.size(); j++)
+    {
+      const RecursiveLikelihoodNode& node = *vNd[j];
+      MemoryUsage::Category below = vTree_[c]->isLeaf(vNd[j]) ? MemoryUsage::LEAF_ARRAYS : MemoryUsage::INNER_ARRAYS;
+      usage.add(below, MemoryUsage::getHeapBytes(node.nodeLikelihoods_)
+          + MemoryUsage::getHeapBytes(node.nodeLikelihoods_B_)
+          + MemoryUsage::getHeapBytes(node.node_fatherLikelihoods_B_));
+      usage.add(MemoryUsage::INNER_ARRAYS, MemoryUsage::getHeapBytes(node.nodeLikelihoods_A_));
+      usage.add(MemoryUsage::DERIVATIVE_ARRAYS, MemoryUsage::getHeapBytes(node.nodeDLikelihoods_)
+          + MemoryUsage::getHeapBytes(node.nodeD2Likelihoods_)
+          + MemoryUsage::getHeapBytes(node.nodeDLikelihoods_B_)
+          + MemoryUsage::getHeapBytes(node.nodeD2Likelihoods_B_)
+          + MemoryUsage::getHeapBytes(node.node_fatherDLikelihoods_B_)
+          + MemoryUsage::getHeapBytes(node.node_fatherD2Likelihoods_B_));
+      usage.add(MemoryUsage::OTHER, MemoryUsage::getHeapBytes(node.temp_)
+          + MemoryUsage::getHeapBytes(node.temp2_)
+          + MemoryUsage::getHeapBytes(node.leafStates_));
+    }
+  }
+  usage.add(MemoryUsage::OTHER, MemoryUsage::getHeapBytes(patternLinks_));
+}
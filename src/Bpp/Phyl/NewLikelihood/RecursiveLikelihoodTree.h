@@ -46,11 +46,15 @@
 #include "../SitePatterns.h"
 #include "LikelihoodNode.h"
 #include "RecursiveLikelihoodNode.h"
+#include "../SiteLoopExecutor.h"
 
 #include <Bpp/Numeric/VectorTools.h>
 
 // From the STL:
+#include <functional>
+#include <iostream>
 #include <map>
+#include <memory>
 using namespace std;
 
 namespace bpp
@@ -100,6 +104,34 @@ private:
 
   bool initializedAboveLikelihoods_;
 
+  /*
+   * @brief Threads computing the classes concurrently, null if there
+   * is only one thread.
+   *
+   */
+
+  std::unique_ptr<SiteLoopExecutor> classLoopExecutor_;
+
+  /*
+   * @brief For each site at root and each state x, the product over
+   * the leaves of their likelihoods for x: the likelihood of the site
+   * given x when there is no substitution.
+   *
+   * Classes of rate 0 (such as the invariant class of a +I
+   * distribution) are computed from this table, without recursion.
+   *
+   */
+
+  VVdouble constantPatterns_;
+
+  /*
+   * @brief Classes computed from constantPatterns_ at the last
+   * computation.
+   *
+   */
+
+  std::vector<char> constantClasses_;
+
 public:
   RecursiveLikelihoodTree(const SubstitutionProcess& process, bool usePatterns);
 
@@ -216,16 +248,32 @@ public:
 
   void initLikelihoods(const AlignedValuesContainer& sites, const SubstitutionProcess& process);
 
+  /*
+   * @brief initialize the likelihoods from the data & the process,
+   * reusing the compressed sites, weights and site indices of another
+   * tree when neither uses patterns, since they only depend on the
+   * data then.
+   *
+   */
+
+  void initLikelihoods(const AlignedValuesContainer& sites, const SubstitutionProcess& process, const LikelihoodTree& shared);
+
   /*
    * @brief compute full likelihoods at a given node
    *
    */
   void computeLikelihoodsAtNode(const ComputingTree& lTree, int nodeId)
   {
-    for (size_t c = 0; c < vTree_.size(); ++c)
+    if (classLoopExecutor_)
+      computeTransitionProbabilities_(lTree, ComputingNode::D0, NULL, true);
+
+    runClassLoop_([&](size_t firstClass, size_t lastClass)
     {
-      vTree_[c]->getNode(static_cast<NodeIndex>(nodeId))->computeLikelihoods(dynamic_cast<SpeciationComputingNode&>(*(lTree[c]->getNode(static_cast<NodeIndex>(nodeId)))), ComputingNode::D0);
-    }
+      for (size_t c = firstClass; c < lastClass; ++c)
+      {
+        vTree_[c]->getNode(static_cast<NodeIndex>(nodeId))->computeLikelihoods(dynamic_cast<SpeciationComputingNode&>(*(lTree[c]->getNode(static_cast<NodeIndex>(nodeId)))), ComputingNode::D0);
+      }
+    });
   }
 
   /*
@@ -237,12 +285,130 @@ public:
   {
     unsigned int rId = lTree[0]->getNodeIndex(lTree[0]->getRoot());
 
-    for (size_t c = 0; c < vTree_.size(); ++c)
+    lTree.computeTransitionProbabilities();
+
+    if (classLoopExecutor_)
+      computeTransitionProbabilities_(lTree, DX, brId, false);
+
+    updateConstantClasses_(lTree);
+
+    runClassLoop_([&](size_t firstClass, size_t lastClass)
     {
-      vTree_[c]->getNode(rId)->computeLikelihoods(dynamic_cast<SpeciationComputingNode&>(*(lTree[c]->getNode(rId))), DX, brId);
-    }
+      for (size_t c = firstClass; c < lastClass; ++c)
+      {
+        if (constantClasses_[c])
+          vTree_[c]->getNode(rId)->setConstantLikelihoods_(constantPatterns_, DX);
+        else
+          vTree_[c]->getNode(rId)->computeLikelihoods(dynamic_cast<SpeciationComputingNode&>(*(lTree[c]->getNode(rId))), DX, brId);
+      }
+    });
+  }
+
+  /*
+   * @brief Compute all the transition probabilities used by
+   * computeLikelihoods(lTree, DX, brId), which then only reads them.
+   *
+   */
+  void prepareTransitionProbabilities(const ComputingTree& lTree, unsigned char DX, const Vuint* brId = NULL) const
+  {
+    lTree.computeTransitionProbabilities();
+    computeTransitionProbabilities_(lTree, DX, brId, false);
   }
 
+  /*
+   * @brief Set the number of threads computing the classes.
+   *
+   * Each class tree is computed by a single thread, and the classes
+   * are split into one contiguous block per thread, so that results
+   * do not depend on the number of threads.
+   *
+   * @param nbThreads The number of threads, including the calling
+   * one. 1 (the default) means no additional thread.
+   *
+   */
+
+  void setNumberOfThreads(size_t nbThreads);
+
+  size_t getNumberOfThreads() const
+  {
+    return classLoopExecutor_ ? classLoopExecutor_->getNumberOfThreads() : 1;
+  }
+
+  /*
+   * @brief Write the likelihood arrays of all classes and nodes, with
+   * their up to date flags, to a binary stream.
+   *
+   * Derivatives are not saved.
+   *
+   */
+
+  void writeLikelihoods(std::ostream& out) const;
+
+  /*
+   * @brief Restore the likelihood arrays written by
+   * writeLikelihoods().
+   *
+   * The tree must have been built from the same process and data.
+   * Derivatives are flagged as not up to date.
+   *
+   * @throw IOException If the stream does not match this tree.
+   *
+   */
+
+  void readLikelihoods(std::istream& in);
+
+  void getMemoryUsage(MemoryUsage& usage) const;
+
+private:
+  /*
+   * @brief Run a loop over all classes, split over the threads if any.
+   *
+   */
+
+  void runClassLoop_(const std::function<void(size_t, size_t)>& loop) const;
+
+  /*
+   * @brief Compute beforehand the transition probabilities needed by
+   * a computation of DXlikelihoods.
+   *
+   * Classes may share a model, whose transition probabilities
+   * computation is not thread safe: they are thus computed by the
+   * calling thread and cached in the SpeciationComputingNodes before
+   * classes are run in parallel.
+   *
+   * Nodes whose model uses uniformization only need their transition
+   * matrix for downward computations, and their models are prepared
+   * for concurrent calls otherwise.
+   *
+   */
+
+  void computeTransitionProbabilities_(const ComputingTree& lTree, unsigned char DX, const Vuint* brId, bool downward) const;
+
+  /*
+   * @brief Compute the constantPatterns_ table in the subtree of a
+   * node, for the sites of this node.
+   *
+   */
+
+  VVdouble computeConstantPatterns_(const RecursiveLikelihoodNode& node) const;
+
+  /*
+   * @brief Set the classes of rate 0 in constantClasses_. The root
+   * likelihoods of a class that is no more of rate 0 are flagged to
+   * be computed again.
+   *
+   */
+
+  void updateConstantClasses_(const ComputingTree& lTree);
+
+  /*
+   * @brief Set the sites with only missing data below each node of
+   * the subtree of a node, in all classes.
+   *
+   */
+
+  void initMissingSites_(const RecursiveLikelihoodNode& node);
+
 protected:
   /**
    * @brief This method initializes the leaves according to a sequence file.
@@ -40,6 +40,7 @@
 
 #include "RecursiveLikelihoodTreeCalculation.h"
 #include "RecursiveLikelihoodTree.h"
+#include "../Io/BinaryTools.h"
 
 using namespace bpp;
 
@@ -110,6 +111,48 @@ RecursiveLikelihoodTreeCalculation& RecursiveLikelihoodTreeCalculation::operator
   return *this;
 }
 
+namespace
+{
+  const char CALCULATION_MAGIC[4] = {'B', 'P', 'P', 'C'};
+  const uint32_t CALCULATION_VERSION = 1;
+}
+
+/******************************************************************************/
+
+void RecursiveLikelihoodTreeCalculation::writeLikelihoods(std::ostream& out) const
+{
+  if (!initialized_)
+    throw Exception("RecursiveLikelihoodTreeCalculation::writeLikelihoods. Object is not initialized.");
+  BinaryTools::writeHeader(out, CALCULATION_MAGIC, CALCULATION_VERSION);
+  BinaryTools::writeValue(out, static_cast<uint64_t>(nbDistinctSites_));
+  BinaryTools::writeValue(out, static_cast<uint64_t>(nbStates_));
+  BinaryTools::writeValue(out, static_cast<uint8_t>(up2date_));
+  likelihoodData_->writeLikelihoods(out);
+}
+
+/******************************************************************************/
+
+void RecursiveLikelihoodTreeCalculation::readLikelihoods(std::istream& in)
+{
+  if (!initialized_)
+    throw Exception("RecursiveLikelihoodTreeCalculation::readLikelihoods. Object is not initialized.");
+  if (!BinaryTools::readHeader(in, CALCULATION_MAGIC, CALCULATION_VERSION))
+    throw IOException("RecursiveLikelihoodTreeCalculation::readLikelihoods. No likelihood arrays found in stream.");
+  uint64_t nbDistinctSites, nbStates;
+  uint8_t up2date;
+  BinaryTools::readValue(in, nbDistinctSites);
+  BinaryTools::readValue(in, nbStates);
+  BinaryTools::readValue(in, up2date);
+  if (nbDistinctSites != nbDistinctSites_ || nbStates != nbStates_)
+    throw IOException("RecursiveLikelihoodTreeCalculation::readLikelihoods. Saved arrays do not match the data.");
+
+  // Clears the transition probabilities flags, so that the restored
+  // arrays are not invalidated by the next updateLikelihood():
+  process_->getComputingTree().computeTransitionProbabilities();
+  likelihoodData_->readLikelihoods(in);
+  up2date_ = (up2date != 0);
+}
+
 /******************************************************************************
  *                           Likelihood computation                           *
  ******************************************************************************/
@@ -129,6 +172,23 @@ void RecursiveLikelihoodTreeCalculation::updateLikelihoodFlags_()
         {
           node->updateFatherBelow_(false, ComputingNode::D0);
           node->updateAbove(false);
+
+          // Above likelihoods depending on this branch are those of
+          // the brothers of the nodes on the path to the root; their
+          // subtrees are checked lazily through isUp2dateAbove().
+          RecursiveLikelihoodNode* n = node.get();
+          while (n->hasFather())
+          {
+            RecursiveLikelihoodNode* father = static_cast<RecursiveLikelihoodNode*>(n->getFather());
+            size_t nbBr = father->getNumberOfSons();
+            for (size_t j = 0; j < nbBr; j++)
+            {
+              RecursiveLikelihoodNode* bro = static_cast<RecursiveLikelihoodNode*>(father->getSon(j));
+              if (bro != n)
+                bro->updateAbove(false);
+            }
+            n = father;
+          }
         }
         else{
           const Vdouble& rf=process_->getRootFrequencies();
@@ -228,6 +288,13 @@ void RecursiveLikelihoodTreeCalculation::computeTreeDLogLikelihood(const Vuint&
  *                           Second Order Derivatives                         *
  ******************************************************************************/
 
+void RecursiveLikelihoodTreeCalculation::prepareTransitionProbabilities(unsigned char DX, const Vuint& vbrId)
+{
+  likelihoodData_->prepareTransitionProbabilities(process_->getComputingTree(), DX, vbrId.size() ? &vbrId : NULL);
+}
+
+/******************************************************************************/
+
 void RecursiveLikelihoodTreeCalculation::computeTreeD2LogLikelihood(const Vuint& vbrId)
 {
   if (vbrId.size()==0)
@@ -151,14 +151,50 @@ namespace bpp
 
       const AbstractLikelihoodTree& getLikelihoodData() const { return *likelihoodData_.get(); }
 
+      /**
+       * @brief Set the number of threads computing the rate classes
+       * concurrently (1 by default, ie no additional thread).
+       *
+       * @see RecursiveLikelihoodTree::setNumberOfThreads
+       */
+
+      void setNumberOfThreads(size_t nbThreads) { likelihoodData_->setNumberOfThreads(nbThreads); }
+
+      size_t getNumberOfThreads() const { return likelihoodData_->getNumberOfThreads(); }
+
+      /**
+       * @brief Write the current likelihood arrays to a binary stream,
+       * so that a later run can resume without computing them again.
+       *
+       * @see RecursiveLikelihoodTree::writeLikelihoods
+       * @throw Exception If no data were set.
+       */
+
+      void writeLikelihoods(std::ostream& out) const;
+
+      /**
+       * @brief Restore likelihood arrays written by writeLikelihoods().
+       *
+       * The object must have been built with the same process, data and
+       * parameter values as the saved one. Transition probabilities are
+       * computed again, but not the likelihood arrays.
+       *
+       * @throw IOException If the saved arrays do not match the data.
+       */
+
+      void readLikelihoods(std::istream& in);
+
     protected:
       
       /**
        * @brief check the SpeciationComputingNodes to update recursively the
-       * Likelihoods flags. If at least one SpeciationComputingNode has changed
-       * all Above Likelihood flags of the trees are set to false.
-       * Below DXLikelihood flags of the changed nodes are set to
-       * false, and all their ancestors.
+       * Likelihoods flags. Below DXLikelihood flags of the changed nodes
+       * are set to false, and all their ancestors. Above Likelihood flags
+       * of the changed nodes, and of the brothers of their ancestors,
+       * are set to false; those of their subtrees are checked lazily.
+       *
+       * Only the path from the changed branches to the root is hence
+       * recomputed by computeTreeLikelihood().
        *
        *
        * Set up2date_ to false if at least one SpeciationComputingNode has
@@ -186,6 +222,8 @@ namespace bpp
 
       void computeTreeD2LogLikelihood(const Vuint& vbrId);
 
+      void prepareTransitionProbabilities(unsigned char DX, const Vuint& vbrId);
+
       /*
        * @brief compute likelihood and set up2date_ to true.
        *
@@ -41,6 +41,7 @@
 #define _SIMPLESUBSTITUTIONPROCESS_H_
 
 #include "AbstractSubstitutionProcess.h"
+#include "../Likelihood/ParameterHandles.h"
 
 //From the stl:
 #include <memory>
@@ -177,12 +178,10 @@ protected:
   void fireParameterChanged(const ParameterList& pl); //Forward parameters and updates probabilities if needed.
 
   bool modelChangesWithParameter_(size_t i, const ParameterList& pl) const {
-    if (pl.getCommonParametersWith(model_->getParameters()).size() > 0)
+    if (haveCommonParameters(pl, model_->getParameters()))
       return true; 
-    ParameterList plbl = pTree_->getBranchLengthParameters(i);
-    if (plbl.getCommonParametersWith(pl).size() > 0)
-      return true;
-    return false;
+    // Same as pTree_->getBranchLengthParameters(i), without copy:
+    return pl.hasParameter(pTree_->getParameters()[i].getName());
   }
 
 };
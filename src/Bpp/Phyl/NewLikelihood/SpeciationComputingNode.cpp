@@ -40,6 +40,8 @@
 #include <Bpp/Numeric/Constraints.h>
 #include <Bpp/Numeric/Matrix/MatrixTools.h>
 
+#include <map>
+
 using namespace bpp;
 using namespace std;
 
@@ -150,6 +152,45 @@ void SpeciationComputingNode::computeTransitionProbabilities() const
   }
 }
 
+void SpeciationComputingNode::computeTransitionProbabilities(const std::vector<const SpeciationComputingNode*>& vNodes)
+{
+  map<const TransitionModel*, pair<Vdouble, vector<RowMatrix<double>*> > > batches;
+  map<const TransitionModel*, const SpeciationComputingNode*> uniformized;
+
+  for (size_t i = 0; i < vNodes.size(); i++)
+  {
+    const SpeciationComputingNode* node = vNodes[i];
+    if (!node->model_)
+      continue;
+
+    if (node->usesUniformization())
+    {
+      uniformized[node->model_] = node;
+      continue;
+    }
+
+    if (!node->computeProbabilities_)
+      continue;
+
+    pair<Vdouble, vector<RowMatrix<double>*> >& batch = batches[node->model_];
+    batch.first.push_back(node->scale_ * node->getDistanceToFather());
+    batch.second.push_back(&node->probabilities_);
+    node->computeProbabilities_ = false;
+  }
+
+  for (auto& batch : batches)
+    batch.first->computePij_t(batch.second.first, batch.second.second);
+
+  for (auto& model : uniformized)
+    model.second->prepareUniformization();
+}
+
+void SpeciationComputingNode::prepareUniformization() const
+{
+  Vdouble v(nbStates_, 1.), res;
+  model_->applyPij_t(0, v, res);
+}
+
 void SpeciationComputingNode::computeTransitionProbabilitiesD1() const
 {
   if (computeProbabilitiesD1_) {
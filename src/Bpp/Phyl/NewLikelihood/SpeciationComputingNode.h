@@ -99,6 +99,75 @@ namespace bpp
      */
     
     mutable Vdouble vLogStates_;
+
+    /*
+     * @brief Return the (D)transition matrix selected by DX, computed
+     * if needed.
+     *
+     */
+
+    const RowMatrix<double>& getTransitionMatrix_(unsigned char DX, const char* method) const
+    {
+      if (DX==D0)
+      {
+        if (computeProbabilities_)
+          computeTransitionProbabilities();
+        return probabilities_;
+      }
+      else if (DX==D1)
+      {
+        if (computeProbabilitiesD1_)
+          computeTransitionProbabilitiesD1();
+        return probabilitiesD1_;
+      }
+      else if (DX==D2)
+      {
+        if (computeProbabilitiesD2_)
+          computeTransitionProbabilitiesD2();
+        return probabilitiesD2_;
+      }
+      else
+        throw Exception(std::string(method) + ": unknown function modifier " + TextTools::toString(DX));
+    }
+
+    /*
+     * @brief Tell if the product of the DX transition matrix with
+     * likelihoods is computed through TransitionModel::applyPij_t,
+     * without computing the matrix.
+     *
+     */
+
+    bool appliesModel_(unsigned char DX, bool usesLog) const
+    {
+      return DX==D0 && !usesLog && model_->usesUniformization();
+    }
+
+    /*
+     * @brief Dot product of a row of transition matrix with a
+     * likelihood vector.
+     *
+     * The sum is split in four independent partial sums, so that the
+     * compiler can vectorize it (see the BUILD_NATIVE option) without
+     * reassociating floating point operations itself.
+     *
+     */
+
+    static double dotProduct_(const double* row, const double* v, size_t n)
+    {
+      double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+      size_t y = 0;
+      for (; y + 4 <= n; y += 4)
+      {
+        s0 += row[y] * v[y];
+        s1 += row[y + 1] * v[y + 1];
+        s2 += row[y + 2] * v[y + 2];
+        s3 += row[y + 3] * v[y + 3];
+      }
+      for (; y < n; y++)
+        s0 += row[y] * v[y];
+
+      return (s0 + s1) + (s2 + s3);
+    }
     
   public:
     SpeciationComputingNode(const TransitionModel* model);
@@ -126,6 +195,26 @@ namespace bpp
       return model_;      
     }
 
+    /*
+     * @brief return if the likelihoods are propagated through
+     * TransitionModel::applyPij_t instead of the transition matrix
+     * (see TransitionModel::usesUniformization).
+     *
+     */
+
+    bool usesUniformization() const
+    {
+      return model_ && model_->usesUniformization();
+    }
+
+    /*
+     * @brief prepare the model for concurrent calls to applyPij_t,
+     * until its next change.
+     *
+     */
+
+    void prepareUniformization() const;
+
     /*
      * @brief return if transition probabilities need to be
      * recomputed.
@@ -159,6 +248,18 @@ namespace bpp
 
     void computeTransitionProbabilitiesD2() const;
 
+    /*
+     * @brief compute the transition probabilities of all the nodes
+     * that need it, with one batched TransitionModel::computePij_t
+     * call per model.
+     *
+     * Nodes whose model uses uniformization are not computed, but
+     * their models are prepared (see prepareUniformization).
+     *
+     */
+
+    static void computeTransitionProbabilities(const std::vector<const SpeciationComputingNode*>& vNodes);
+
     /**
      * @brief Return the transition probability between two states.
      *
@@ -298,25 +399,22 @@ namespace bpp
 
     void addUpwardLikelihoodsAtASite(Vdouble* likelihoods_target, const Vdouble* likelihoods_node, unsigned char DX, bool usesLog) const
     {
-      double (SpeciationComputingNode::*gtP)(size_t,size_t) const = NULL;
+      if (appliesModel_(DX, usesLog))
+      {
+        model_->applyPij_t(scale_*getDistanceToFather(), *likelihoods_node, vLogStates_);
+        for (size_t x = 0; x < nbStates_; x++)
+          (*likelihoods_target)[x] += vLogStates_[x];
+        return;
+      }
 
-      if (DX==D0)
-        gtP=&SpeciationComputingNode::getTransitionProbability;
-      else
-        if (DX==D1)
-          gtP=&SpeciationComputingNode::getTransitionProbabilityD1;
-        else
-          if (DX==D2)
-            gtP=&SpeciationComputingNode::getTransitionProbabilityD2;
-          else
-            throw Exception("SpeciationComputingNode::addUpwardLikelihoodsAtASite: unknown function modifier " + TextTools::toString(DX));
+      const RowMatrix<double>& tP = getTransitionMatrix_(DX, "SpeciationComputingNode::addUpwardLikelihoodsAtASite");
 
       if (usesLog){        
         for (size_t x = 0; x < nbStates_; x++)
         {
           for (size_t y = 0; y < nbStates_; y++)
           {
-            double t=(*this.*gtP)(x, y);  
+            double t=tP(x, y);  
             vLogStates_[y]=(t<=0?NumConstants::MINF():log(t)) + (*likelihoods_node)[y];
           }
           
@@ -330,28 +428,19 @@ namespace bpp
         for (size_t x = 0; x < nbStates_; x++)
         {
           // For each initial state,
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates_; y++)
-            likelihood += (*this.*gtP)(x, y) * (*likelihoods_node)[y];
-          
-          (*likelihoods_target)[x] += likelihood;
+          (*likelihoods_target)[x] += dotProduct_(&tP.getRow(x)[0], &(*likelihoods_node)[0], nbStates_);
         }
     }
 
     void setUpwardLikelihoodsAtASite(Vdouble* likelihoods_target, const Vdouble* likelihoods_node, unsigned char DX, bool usesLog) const
     {
-      double (SpeciationComputingNode::*gtP)(size_t,size_t) const = NULL;
+      if (appliesModel_(DX, usesLog))
+      {
+        model_->applyPij_t(scale_*getDistanceToFather(), *likelihoods_node, *likelihoods_target);
+        return;
+      }
 
-      if (DX==D0)
-        gtP=&SpeciationComputingNode::getTransitionProbability;
-      else
-        if (DX==D1)
-          gtP=&SpeciationComputingNode::getTransitionProbabilityD1;
-        else
-          if (DX==D2)
-            gtP=&SpeciationComputingNode::getTransitionProbabilityD2;
-          else
-            throw Exception("SpeciationComputingNode::setUpwardLikelihoodsAtASite: unknown function modifier " + TextTools::toString(DX));
+      const RowMatrix<double>& tP = getTransitionMatrix_(DX, "SpeciationComputingNode::setUpwardLikelihoodsAtASite");
 
       if (usesLog){
         
@@ -360,7 +449,7 @@ namespace bpp
           // For each initial state,
           for (size_t y = 0; y < nbStates_; y++)
           {
-            double t=(*this.*gtP)(x, y);
+            double t=tP(x, y);
             vLogStates_[y]=(t<=0?NumConstants::MINF():log(t)) + (*likelihoods_node)[y];
           }
           
@@ -371,11 +460,7 @@ namespace bpp
         for (size_t x = 0; x < nbStates_; x++)
         {
           // For each initial state,
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates_; y++)
-            likelihood += (*this.*gtP)(x, y) * (*likelihoods_node)[y];
-
-          (*likelihoods_target)[x] = likelihood;
+          (*likelihoods_target)[x] = dotProduct_(&tP.getRow(x)[0], &(*likelihoods_node)[0], nbStates_);
         }
     }
 
@@ -396,18 +481,7 @@ namespace bpp
     
     void setDownwardLikelihoodsAtASite(Vdouble* likelihoods_node, const Vdouble* likelihoods_father, unsigned char DX, bool usesLog) const
     {
-      double (SpeciationComputingNode::*gtP)(size_t,size_t) const = NULL;
-
-      if (DX==D0)
-        gtP=&SpeciationComputingNode::getTransitionProbability;
-      else
-        if (DX==D1)
-          gtP=&SpeciationComputingNode::getTransitionProbabilityD1;
-        else
-          if (DX==D2)
-            gtP=&SpeciationComputingNode::getTransitionProbabilityD2;
-          else
-            throw Exception("SpeciationComputingNode::setDownwardLikelihoodsAtASite: unknown function modifier " + TextTools::toString(DX));
+      const RowMatrix<double>& tP = getTransitionMatrix_(DX, "SpeciationComputingNode::setDownwardLikelihoodsAtASite");
 
       if (usesLog)
         for (size_t x = 0; x < nbStates_; x++)
@@ -415,22 +489,28 @@ namespace bpp
           // For each initial state,
           for (size_t y = 0; y < nbStates_; y++)
           {
-            double t=(*this.*gtP)(x, y);  
+            double t=tP(x, y);  
             vLogStates_[y]=(t<=0?NumConstants::MINF():log(t)) + (*likelihoods_father)[y];
           }
           
           (*likelihoods_node)[x] = VectorTools::logSumExp(vLogStates_);
         }
       else
+      {
+        // Rows of the matrix are accumulated one father state after the
+        // other, which keeps the inner loop contiguous.
+        double* target = &(*likelihoods_node)[0];
         for (size_t x = 0; x < nbStates_; x++)
+          target[x] = 0;
+
+        for (size_t y = 0; y < nbStates_; y++)
         {
-          // For each initial state,
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates_; y++)
-            likelihood += (*this.*gtP)(y, x) * (*likelihoods_father)[y];
-          
-          (*likelihoods_node)[x] = likelihood;
+          const double* row = &tP.getRow(y)[0];
+          double f = (*likelihoods_father)[y];
+          for (size_t x = 0; x < nbStates_; x++)
+            target[x] += row[x] * f;
         }
+      }
     }
 
     
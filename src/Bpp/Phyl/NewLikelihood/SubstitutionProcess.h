@@ -267,6 +267,18 @@ namespace bpp
 
     virtual ComputingTree& getComputingTree() = 0;
 
+    /**
+     * @brief Compute at once the transition probabilities of all the
+     * branches and classes that are not up to date.
+     *
+     * The matrices are computed through one
+     * TransitionModel::computePij_t() call per model.
+     */
+    virtual void computeTransitionProbabilities() const
+    {
+      getComputingTree().computeTransitionProbabilities();
+    }
+
   };
 
 } // end namespace bpp
@@ -61,7 +61,10 @@ SubstitutionProcessCollection::SubstitutionProcessCollection(const SubstitutionP
   mDistToSubPro_(set.mDistToSubPro_),
   treeColl_(set.treeColl_),
   mTreeToSubPro_(set.mTreeToSubPro_),
-  mSubProcess_()
+  mSubProcess_(),
+  aliasGraph_(),
+  aliasGraphValid_(false),
+  aliasGraphNbParameters_(0)
 {
   map<size_t, SubstitutionProcessCollectionMember*>::const_iterator it;
   
@@ -83,6 +86,7 @@ SubstitutionProcessCollection& SubstitutionProcessCollection::operator=(const Su
   mVConstDist_=set.mVConstDist_;
   treeColl_=set.treeColl_;
   mTreeToSubPro_=set.mTreeToSubPro_;
+  aliasGraphValid_=false;
 
   map<size_t, SubstitutionProcessCollectionMember*>::const_iterator it;
   
@@ -95,6 +99,7 @@ SubstitutionProcessCollection& SubstitutionProcessCollection::operator=(const Su
 void SubstitutionProcessCollection::clear()
 {
   resetParameters_();
+  aliasGraphValid_=false;
   
   modelColl_.clear();
   mModelToSubPro_.clear();
@@ -141,7 +146,10 @@ void SubstitutionProcessCollection::addParametrizable(Parametrizable* parametriz
           throw Exception("Unknown parametrizable object in SubstitutionProcessCollection::addParametrizable.");
 
   if (withParameters)
+  {
     addParameters_(pl);
+    aliasGraphValid_=false;
+  }
 }
 
 ParameterList SubstitutionProcessCollection::getNonDerivableParameters() const
@@ -155,15 +163,84 @@ ParameterList SubstitutionProcessCollection::getNonDerivableParameters() const
 
   return pl;
 }
+
+void SubstitutionProcessCollection::compileAliasGraph_() const
+{
+  aliasGraph_.clear();
+  const ParameterList& pl=getParameters();
+  for (size_t k=0; k<pl.size(); k++)
+  {
+    ParameterList single;
+    single.addParameter(pl[k]);
+    ParameterList aliases=AbstractParameterAliasable::getAliasedParameters(single);
+    if (aliases.size()==0)
+      continue;
+
+    pair<size_t, vector<size_t> >& node=aliasGraph_[pl[k].getName()];
+    node.first=k;
+    for (size_t i=0; i<aliases.size(); i++)
+    {
+      size_t a=pl.whichParameterHasName(aliases[i].getName());
+      node.second.push_back(a);
+      // An alias has an entry too, so that lists holding it do not get it twice:
+      if (aliasGraph_.find(pl[a].getName())==aliasGraph_.end())
+        aliasGraph_[pl[a].getName()].first=a;
+    }
+  }
+  aliasGraphNbParameters_=pl.size();
+  aliasGraphValid_=true;
+}
+
+ParameterList SubstitutionProcessCollection::getAliasedParameters(const ParameterList& pl) const
+{
+  if (!aliasGraphValid_ || aliasGraphNbParameters_!=getNumberOfParameters())
+    compileAliasGraph_();
+
+  ParameterList aliases;
+  if (aliasGraph_.empty())
+    return aliases;
+
+  vector<const vector<size_t>*> targets;
+  vector<bool> listed(aliasGraphNbParameters_, false);
+  for (size_t i=0; i<pl.size(); i++)
+  {
+    map<string, pair<size_t, vector<size_t> > >::const_iterator it=aliasGraph_.find(pl[i].getName());
+    if (it==aliasGraph_.end())
+      continue;
+    listed[it->second.first]=true;
+    if (it->second.second.size()>0)
+      targets.push_back(&it->second.second);
+  }
+
+  const ParameterList& all=getParameters();
+  for (size_t i=0; i<targets.size(); i++)
+    for (size_t j=0; j<targets[i]->size(); j++)
+    {
+      size_t a=(*targets[i])[j];
+      if (!listed[a])
+      {
+        listed[a]=true;
+        aliases.addParameter(all[a]);
+      }
+    }
+
+  return aliases;
+}
   
 void SubstitutionProcessCollection::fireParameterChanged(const ParameterList& parameters)
 {
   ParameterList gAP=getAliasedParameters(parameters);
 
-  gAP.addParameters(parameters);
+  // Without aliases, changed parameters are forwarded without copy:
+  const ParameterList* changed = &parameters;
+  if (gAP.size() > 0)
+  {
+    gAP.addParameters(parameters);
+    changed = &gAP;
+  }
 
   modelColl_.clearChanged();
-  modelColl_.matchParametersValues(gAP);
+  modelColl_.matchParametersValues(*changed);
 
   
   const vector<size_t>& vM=modelColl_.hasChanged();
@@ -178,7 +255,7 @@ void SubstitutionProcessCollection::fireParameterChanged(const ParameterList& pa
   }
   
   freqColl_.clearChanged();
-  freqColl_.matchParametersValues(gAP);
+  freqColl_.matchParametersValues(*changed);
 
   vector<size_t> keys=freqColl_.keys();
 
@@ -196,7 +273,7 @@ void SubstitutionProcessCollection::fireParameterChanged(const ParameterList& pa
   map<size_t, bool> toFire;
 
   distColl_.clearChanged();
-  distColl_.matchParametersValues(gAP);
+  distColl_.matchParametersValues(*changed);
   const vector<size_t>& vD=distColl_.hasChanged();
   
   for (size_t i=0; i<vD.size(); i++)
@@ -209,6 +286,12 @@ void SubstitutionProcessCollection::fireParameterChanged(const ParameterList& pa
       const DiscreteDistribution& dd=getRateDistribution(vD[i]);
       vector<size_t>& vv=mVConstDist_[vD[i]];
       
+      if (changed != &gAP)
+      {
+        gAP.addParameters(parameters);
+        changed = &gAP;
+      }
+      
       for (size_t j=0;j<vv.size();j++){
         gAP.addParameter(new Parameter("Constant.value_"+TextTools::toString(10000*(vD[i]+1)+vv[j]),dd.getCategory(j)));
         dynamic_cast<ConstantDistribution*>(distColl_[10000*(vD[i]+1)+vv[j]])->setParameterValue("value",dd.getCategory(j));
@@ -221,7 +304,7 @@ void SubstitutionProcessCollection::fireParameterChanged(const ParameterList& pa
 
   
   treeColl_.clearChanged();
-  treeColl_.matchParametersValues(gAP);
+  treeColl_.matchParametersValues(*changed);
   
   const vector<size_t>& vT=treeColl_.hasChanged();
 
@@ -238,7 +321,7 @@ void SubstitutionProcessCollection::fireParameterChanged(const ParameterList& pa
   map<size_t, bool>::const_iterator it;
   
   for (it=toFire.begin(); it != toFire.end(); it++)
-    mSubProcess_[it->first]->fireParameterChanged(gAP);
+    mSubProcess_[it->first]->fireParameterChanged(*changed);
   
 }
 
@@ -246,6 +329,7 @@ void SubstitutionProcessCollection::fireParameterChanged(const ParameterList& pa
 void SubstitutionProcessCollection::setNamespace(const string& prefix)
 {
   AbstractParameterAliasable::setNamespace(prefix);
+  aliasGraphValid_=false;
   for (std::map<size_t, SubstitutionProcessCollectionMember*>::iterator it=mSubProcess_.begin(); it != mSubProcess_.end(); it++)
     it->second->setNamespace(prefix);
 }
@@ -253,6 +337,7 @@ void SubstitutionProcessCollection::setNamespace(const string& prefix)
 void SubstitutionProcessCollection::aliasParameters(const std::string& p1, const std::string& p2) 
 {
   AbstractParameterAliasable::aliasParameters(p1, p2);
+  aliasGraphValid_=false;
   for (std::map<size_t, SubstitutionProcessCollectionMember*>::iterator it=mSubProcess_.begin(); it != mSubProcess_.end(); it++)
     if (it->second->hasParameter(p2))
     {
@@ -264,6 +349,7 @@ void SubstitutionProcessCollection::aliasParameters(const std::string& p1, const
 void SubstitutionProcessCollection::unaliasParameters(const std::string& p1, const std::string& p2)
 {
   AbstractParameterAliasable::unaliasParameters(p1, p2);
+  aliasGraphValid_=false;
   for (std::map<size_t, SubstitutionProcessCollectionMember*>::iterator it=mSubProcess_.begin(); it != mSubProcess_.end(); it++)
     it->second->updateParameters();
 }
@@ -271,6 +357,7 @@ void SubstitutionProcessCollection::unaliasParameters(const std::string& p1, con
 void SubstitutionProcessCollection::aliasParameters(std::map<std::string, std::string>& unparsedParams, bool verbose)
 {
   AbstractParameterAliasable::aliasParameters(unparsedParams, verbose);
+  aliasGraphValid_=false;
   for (std::map<std::string, std::string>::iterator itp=unparsedParams.begin(); itp!=unparsedParams.end(); itp++)
   {
     string p2=itp->second;
@@ -162,6 +162,18 @@ private:
 
   std::map<size_t, SubstitutionProcessCollectionMember*> mSubProcess_;
 
+  /**
+   * @brief The alias graph compiled by compileAliasGraph_(): for each
+   * parameter involved in an alias, its index in getParameters() and
+   * the indices of the parameters aliased to it.
+   */
+
+  mutable std::map<std::string, std::pair<size_t, std::vector<size_t> > > aliasGraph_;
+
+  mutable bool aliasGraphValid_;
+
+  mutable size_t aliasGraphNbParameters_;
+
 public:
   /**
    * @brief Create empty collections.
@@ -179,7 +191,10 @@ public:
     mDistToSubPro_(),
     treeColl_(),
     mTreeToSubPro_(),
-    mSubProcess_()
+    mSubProcess_(),
+    aliasGraph_(),
+    aliasGraphValid_(false),
+    aliasGraphNbParameters_(0)
   {
   }
 
@@ -413,6 +428,19 @@ public:
 
   void aliasParameters(std::map<std::string, std::string>& unparsedParams, bool verbose);  
 
+  /**
+   * @brief The parameters aliased to the ones in a list, with their
+   * current values.
+   *
+   * The alias graph is compiled once into index lists, and compiled
+   * again only after the aliases or the parameters changed, so that
+   * this method does not walk the alias listeners.
+   *
+   * @param pl The parameters to look aliases for.
+   */
+
+  ParameterList getAliasedParameters(const ParameterList& pl) const;
+
   /**
    * @}
    **/
@@ -647,6 +675,12 @@ public:
       return pl;
   }
   
+private:
+  /**
+   * @brief Fill aliasGraph_ from the alias listeners.
+   */
+
+  void compileAliasGraph_() const;
 
 };
 } // end of namespace bpp.
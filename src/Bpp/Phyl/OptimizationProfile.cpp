@@ -0,0 +1,222 @@
+//
+// File: OptimizationProfile.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "OptimizationProfile.h"
+
+using namespace bpp;
+
+// From the STL:
+#include <chrono>
+
+using namespace std;
+
+/******************************************************************************/
+
+const string OptimizationProfile::MODEL_EVALUATION = "model evaluation";
+const string OptimizationProfile::BRANCH_LENGTH_EVALUATION = "branch length evaluation";
+const string OptimizationProfile::VALUE = "value";
+const string OptimizationProfile::FIRST_ORDER_DERIVATIVE = "first order derivative";
+const string OptimizationProfile::SECOND_ORDER_DERIVATIVE = "second order derivative";
+
+/******************************************************************************/
+
+void OptimizationProfile::add(const string& phase, const string& kind, double seconds)
+{
+  pair<string, string> key(phase, kind);
+  map<pair<string, string>, size_t>::iterator it = index_.find(key);
+  if (it == index_.end())
+  {
+    index_[key] = entries_.size();
+    Entry entry = {phase, kind, 1, seconds};
+    entries_.push_back(entry);
+  }
+  else
+  {
+    entries_[it->second].nbCalls++;
+    entries_[it->second].seconds += seconds;
+  }
+}
+
+/******************************************************************************/
+
+void OptimizationProfile::writeCsv(ostream& out) const
+{
+  out << "phase,kind,calls,seconds" << endl;
+  for (size_t i = 0; i < entries_.size(); i++)
+  {
+    const Entry& e = entries_[i];
+    out << "\"" << e.phase << "\",\"" << e.kind << "\"," << e.nbCalls << "," << e.seconds << endl;
+  }
+}
+
+/******************************************************************************/
+
+namespace
+{
+  string jsonString(const string& s)
+  {
+    string res = "\"";
+    for (size_t i = 0; i < s.size(); i++)
+    {
+      if (s[i] == '"' || s[i] == '\\')
+        res += '\\';
+      res += s[i];
+    }
+    return res + "\"";
+  }
+}
+
+void OptimizationProfile::writeJson(ostream& out) const
+{
+  out << "[" << endl;
+  for (size_t i = 0; i < entries_.size(); i++)
+  {
+    const Entry& e = entries_[i];
+    out << "  {\"phase\": " << jsonString(e.phase)
+        << ", \"kind\": " << jsonString(e.kind)
+        << ", \"calls\": " << e.nbCalls
+        << ", \"seconds\": " << e.seconds << "}"
+        << (i + 1 < entries_.size() ? "," : "") << endl;
+  }
+  out << "]" << endl;
+}
+
+/******************************************************************************/
+
+namespace
+{
+  double secondsSince(chrono::steady_clock::time_point start)
+  {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  }
+}
+
+const string& ProfiledFunctionWrapper::getEvaluationKind_(const ParameterList& parameters) const
+{
+  for (size_t i = 0; i < parameters.size(); i++)
+  {
+    const string& name = parameters[i].getName();
+    if (!branchLengths_.hasParameter(name) && function_->hasParameter(name)
+        && function_->getParameterValue(name) != parameters[i].getValue())
+      return OptimizationProfile::MODEL_EVALUATION;
+  }
+  return OptimizationProfile::BRANCH_LENGTH_EVALUATION;
+}
+
+void ProfiledFunctionWrapper::setParameters(const ParameterList& parameters)
+{
+  const string& kind = getEvaluationKind_(parameters);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  DerivableSecondOrderWrapper::setParameters(parameters);
+  profile_->add(phase_, kind, secondsSince(start));
+}
+
+void ProfiledFunctionWrapper::setAllParametersValues(const ParameterList& parameters)
+{
+  const string& kind = getEvaluationKind_(parameters);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  DerivableSecondOrderWrapper::setAllParametersValues(parameters);
+  profile_->add(phase_, kind, secondsSince(start));
+}
+
+void ProfiledFunctionWrapper::setParameterValue(const string& name, double value)
+{
+  const string& kind = (branchLengths_.hasParameter(name) ? OptimizationProfile::BRANCH_LENGTH_EVALUATION : OptimizationProfile::MODEL_EVALUATION);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  DerivableSecondOrderWrapper::setParameterValue(name, value);
+  profile_->add(phase_, kind, secondsSince(start));
+}
+
+void ProfiledFunctionWrapper::setParametersValues(const ParameterList& parameters)
+{
+  const string& kind = getEvaluationKind_(parameters);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  DerivableSecondOrderWrapper::setParametersValues(parameters);
+  profile_->add(phase_, kind, secondsSince(start));
+}
+
+bool ProfiledFunctionWrapper::matchParametersValues(const ParameterList& parameters)
+{
+  const string& kind = getEvaluationKind_(parameters);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  bool test = DerivableSecondOrderWrapper::matchParametersValues(parameters);
+  profile_->add(phase_, kind, secondsSince(start));
+  return test;
+}
+
+double ProfiledFunctionWrapper::f(const ParameterList& parameters)
+{
+  setParameters(parameters);
+  return getValue();
+}
+
+double ProfiledFunctionWrapper::getValue() const
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  double value = DerivableSecondOrderWrapper::getValue();
+  profile_->add(phase_, OptimizationProfile::VALUE, secondsSince(start));
+  return value;
+}
+
+double ProfiledFunctionWrapper::getFirstOrderDerivative(const string& variable) const
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  double d = DerivableSecondOrderWrapper::getFirstOrderDerivative(variable);
+  profile_->add(phase_, OptimizationProfile::FIRST_ORDER_DERIVATIVE, secondsSince(start));
+  return d;
+}
+
+double ProfiledFunctionWrapper::getSecondOrderDerivative(const string& variable) const
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  double d = DerivableSecondOrderWrapper::getSecondOrderDerivative(variable);
+  profile_->add(phase_, OptimizationProfile::SECOND_ORDER_DERIVATIVE, secondsSince(start));
+  return d;
+}
+
+double ProfiledFunctionWrapper::getSecondOrderDerivative(const string& variable1, const string& variable2) const
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  double d = DerivableSecondOrderWrapper::getSecondOrderDerivative(variable1, variable2);
+  profile_->add(phase_, OptimizationProfile::SECOND_ORDER_DERIVATIVE, secondsSince(start));
+  return d;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,182 @@
+//
+// File: OptimizationProfile.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _OPTIMIZATIONPROFILE_H_
+#define _OPTIMIZATIONPROFILE_H_
+
+#include <Bpp/Numeric/Function/Functions.h>
+#include <Bpp/Numeric/ParameterList.h>
+
+// From the STL:
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+  /**
+   * @brief Number of calls and time spent, per optimization phase and
+   * per kind of call.
+   *
+   * Phases are named after the optimizers of a MetaOptimizer run (for
+   * instance "Branch length parameters"), and kinds of calls are the
+   * constants of this class. Entries are kept in their order of first
+   * appearance.
+   *
+   * @see ProfiledFunctionWrapper
+   */
+  class OptimizationProfile
+  {
+  public:
+    struct Entry
+    {
+      std::string phase;
+      std::string kind;
+      size_t nbCalls;
+      double seconds;
+    };
+
+    /**
+     * @brief Evaluations where model or rate parameters changed, hence
+     * all transition probabilities and likelihood arrays are computed.
+     */
+    static const std::string MODEL_EVALUATION;
+
+    /**
+     * @brief Evaluations where only branch lengths changed, hence only
+     * their transition probabilities and the likelihood arrays are computed.
+     */
+    static const std::string BRANCH_LENGTH_EVALUATION;
+
+    static const std::string VALUE;
+    static const std::string FIRST_ORDER_DERIVATIVE;
+    static const std::string SECOND_ORDER_DERIVATIVE;
+
+  private:
+    std::vector<Entry> entries_;
+    std::map<std::pair<std::string, std::string>, size_t> index_;
+
+  public:
+    OptimizationProfile() : entries_(), index_() {}
+
+  public:
+    /**
+     * @brief Record one call.
+     */
+    void add(const std::string& phase, const std::string& kind, double seconds);
+
+    const std::vector<Entry>& getEntries() const { return entries_; }
+
+    void clear()
+    {
+      entries_.clear();
+      index_.clear();
+    }
+
+    /**
+     * @brief Write all entries as CSV, with a header line "phase,kind,calls,seconds".
+     */
+    void writeCsv(std::ostream& out) const;
+
+    /**
+     * @brief Write all entries as a JSON array of objects with members
+     * "phase", "kind", "calls" and "seconds".
+     */
+    void writeJson(std::ostream& out) const;
+  };
+
+  /**
+   * @brief Forward all calls to a function, recording their number and
+   * duration in an OptimizationProfile.
+   *
+   * Each optimizer of a run is given its own wrapper, named after its
+   * phase. Calls setting parameters are recorded as model evaluations if
+   * a parameter which is not a branch length changes, and as branch
+   * length evaluations otherwise.
+   */
+  class ProfiledFunctionWrapper:
+    public DerivableSecondOrderWrapper
+  {
+  private:
+    OptimizationProfile* profile_;
+    std::string phase_;
+    ParameterList branchLengths_;
+
+  public:
+    /**
+     * @param function The function to profile (not owned).
+     * @param profile Where to record calls (not owned).
+     * @param phase The name of the phase.
+     * @param branchLengths The branch length parameters of the function.
+     */
+    ProfiledFunctionWrapper(DerivableSecondOrder* function, OptimizationProfile* profile, const std::string& phase, const ParameterList& branchLengths) :
+      DerivableSecondOrderWrapper(function),
+      profile_(profile),
+      phase_(phase),
+      branchLengths_(branchLengths)
+    {}
+
+    ProfiledFunctionWrapper* clone() const { return new ProfiledFunctionWrapper(*this); }
+
+  public:
+    void setParameters(const ParameterList& parameters);
+    void setAllParametersValues(const ParameterList& parameters);
+    void setParameterValue(const std::string& name, double value);
+    void setParametersValues(const ParameterList& parameters);
+    bool matchParametersValues(const ParameterList& parameters);
+    double f(const ParameterList& parameters);
+
+    double getValue() const;
+    double getFirstOrderDerivative(const std::string& variable) const;
+    double getSecondOrderDerivative(const std::string& variable) const;
+    double getSecondOrderDerivative(const std::string& variable1, const std::string& variable2) const;
+
+  private:
+    /**
+     * @return The kind of evaluation triggered by setting these parameters.
+     */
+    const std::string& getEvaluationKind_(const ParameterList& parameters) const;
+  };
+
+} //end of namespace bpp.
+
+#endif //_OPTIMIZATIONPROFILE_H_
+
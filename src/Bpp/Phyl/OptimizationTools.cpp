@@ -39,7 +39,11 @@
 
 #include "OptimizationTools.h"
 #include "PseudoNewtonOptimizer.h"
+#include "BranchwiseNewtonOptimizer.h"
+#include "OptimizationProfile.h"
+#include "ParallelThreePointsNumericalDerivative.h"
 #include "Likelihood/GlobalClockTreeLikelihoodFunctionWrapper.h"
+#include "Likelihood/DRHomogeneousMixedTreeLikelihood.h"
 #include "Tree/NNISearchable.h"
 #include "Tree/NNITopologySearch.h"
 #include "Io/Newick.h"
@@ -59,6 +63,34 @@
 using namespace bpp;
 using namespace std;
 
+namespace
+{
+  /**
+   * @brief Run an optimization with the successive tolerances of a schedule.
+   *
+   * @param optimize Called with the tolerance and maximum number of evaluations
+   * of each round, returns the number of evaluations performed.
+   * @return The total number of evaluations.
+   */
+  template<class Optimize>
+  unsigned int optimizeWithSchedule(const ToleranceSchedule& schedule, const Function& f, double tolerance, unsigned int tlEvalMax, Optimize optimize)
+  {
+    unsigned int n = 0;
+    double tol = std::max(schedule.getInitialTolerance(), tolerance);
+    double value = f.getValue();
+    while (true)
+    {
+      n += optimize(tol, tlEvalMax - n);
+      if (tol <= tolerance || n >= tlEvalMax)
+        break;
+      double newValue = f.getValue();
+      tol = schedule.getNextTolerance(tol, value - newValue, tolerance);
+      value = newValue;
+    }
+    return n;
+  }
+}
+
 /******************************************************************************/
 
 OptimizationTools::OptimizationTools() {}
@@ -68,6 +100,7 @@ OptimizationTools::~OptimizationTools() {}
 /******************************************************************************/
 
 std::string OptimizationTools::OPTIMIZATION_NEWTON = "newton";
+std::string OptimizationTools::OPTIMIZATION_NEWTON_BRANCHWISE = "newtonBranchwise";
 std::string OptimizationTools::OPTIMIZATION_GRADIENT = "gradient";
 std::string OptimizationTools::OPTIMIZATION_BRENT = "Brent";
 std::string OptimizationTools::OPTIMIZATION_BFGS = "BFGS";
@@ -77,13 +110,24 @@ std::string OptimizationTools::OPTIMIZATION_BFGS = "BFGS";
 OptimizationTools::ScaleFunction::ScaleFunction(TreeLikelihood* tl) :
   tl_(tl),
   brLen_(),
-  lambda_()
+  lambda_(),
+  bulk_(0)
 {
   // We work only on the branch lengths:
   brLen_ = tl->getBranchLengthsParameters();
   if (brLen_.hasParameter("RootPosition"))
     brLen_.deleteParameter("RootPosition");
   lambda_.addParameter(Parameter("scale factor", 0));
+
+  // Branch lengths are set at once if they are all parameters, BrLen0 to BrLen(n-1):
+  bulk_ = dynamic_cast<AbstractHomogeneousTreeLikelihood*>(tl);
+  if (bulk_ && brLen_.size() + 1 != bulk_->getTree().getNumberOfNodes())
+    bulk_ = 0;
+  for (size_t i = 0; bulk_ && i < brLen_.size(); i++)
+  {
+    if (brLen_[i].getName() != "BrLen" + TextTools::toString(i))
+      bulk_ = 0;
+  }
 }
 
 OptimizationTools::ScaleFunction::~ScaleFunction() {}
@@ -98,8 +142,18 @@ void OptimizationTools::ScaleFunction::setParameters(const ParameterList& lambda
 double OptimizationTools::ScaleFunction::getValue() const
 {
   // Scale the tree:
-  ParameterList brLen = brLen_;
   double s = exp(lambda_[0].getValue());
+  if (bulk_)
+  {
+    vector<double> lengths(brLen_.size());
+    for (size_t i = 0; i < brLen_.size(); i++)
+    {
+      lengths[i] = brLen_[i].getValue() * s;
+    }
+    bulk_->setBranchLengths(lengths);
+    return bulk_->getValue();
+  }
+  ParameterList brLen = brLen_;
   for (unsigned int i = 0; i < brLen.size(); i++)
   {
     try
@@ -156,8 +210,21 @@ unsigned int OptimizationTools::optimizeNumericalParameters(
   bool reparametrization,
   unsigned int verbose,
   const std::string& optMethodDeriv,
-  const std::string& optMethodModel)
+  const std::string& optMethodModel,
+  unsigned int nbThreads,
+  OptimizationProfile* profile,
+  const ToleranceSchedule* schedule)
 {
+  if (schedule)
+  {
+    // Each round starts from the values reached by the previous one:
+    ParameterList current = parameters;
+    return optimizeWithSchedule(*schedule, *tl, tolerance, tlEvalMax, [&](double tol, unsigned int evalMax) {
+      current.matchParametersValues(tl->getParameters());
+      return optimizeNumericalParameters(tl, current, listener, nstep, tol, evalMax, messageHandler, profiler, reparametrization, verbose, optMethodDeriv, optMethodModel, nbThreads, profile);
+    });
+  }
+
   DerivableSecondOrder* f = tl;
   ParameterList pl = parameters;
 
@@ -179,14 +246,54 @@ unsigned int OptimizationTools::optimizeNumericalParameters(
 
   MetaOptimizerInfos* desc = new MetaOptimizerInfos();
   MetaOptimizer* poptimizer = 0;
-  AbstractNumericalDerivative* fnum = new ThreePointsNumericalDerivative(f);
+
+  // Each optimizer gets its own profiled view of the function:
+  vector<unique_ptr<DerivableSecondOrder> > profiled;
+  auto phaseFunction = [&](const string& phase) -> DerivableSecondOrder*
+  {
+    if (!profile)
+      return f;
+    profiled.push_back(unique_ptr<DerivableSecondOrder>(new ProfiledFunctionWrapper(f, profile, phase, tl->getBranchLengthsParameters())));
+    return profiled.back().get();
+  };
+  AbstractNumericalDerivative* fnum = 0;
+
+  // Shifted points of numerical derivatives are computed on
+  // independent clones of the likelihood, one per thread.
+  vector<unique_ptr<DerivableSecondOrder> > tlCopies;
+  vector<unique_ptr<DerivableSecondOrder> > repCopies;
+  if (optMethodModel == OPTIMIZATION_BFGS && nbThreads > 1)
+  {
+    vector<Function*> copies;
+    for (unsigned int t = 0; t < nbThreads; ++t)
+    {
+      tlCopies.push_back(unique_ptr<DerivableSecondOrder>(tl->clone()));
+      if (reparametrization)
+      {
+        repCopies.push_back(unique_ptr<DerivableSecondOrder>(new ReparametrizationDerivableSecondOrderWrapper(tlCopies.back().get(), parameters)));
+        copies.push_back(repCopies.back().get());
+      }
+      else
+        copies.push_back(tlCopies.back().get());
+    }
+    fnum = new ParallelThreePointsNumericalDerivative(phaseFunction("Rate & model distribution parameters"), copies);
+  }
+  else
+    fnum = new ThreePointsNumericalDerivative(phaseFunction("Rate & model distribution parameters"));
 
   if (optMethodDeriv == OPTIMIZATION_GRADIENT)
-    desc->addOptimizer("Branch length parameters", new ConjugateGradientMultiDimensions(f), tl->getBranchLengthsParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
+    desc->addOptimizer("Branch length parameters", new ConjugateGradientMultiDimensions(phaseFunction("Branch length parameters")), tl->getBranchLengthsParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
   else if (optMethodDeriv == OPTIMIZATION_NEWTON)
-    desc->addOptimizer("Branch length parameters", new PseudoNewtonOptimizer(f), tl->getBranchLengthsParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
+    desc->addOptimizer("Branch length parameters", new PseudoNewtonOptimizer(phaseFunction("Branch length parameters")), tl->getBranchLengthsParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
   else if (optMethodDeriv == OPTIMIZATION_BFGS)
-    desc->addOptimizer("Branch length parameters", new BfgsMultiDimensions(f), tl->getBranchLengthsParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
+    desc->addOptimizer("Branch length parameters", new BfgsMultiDimensions(phaseFunction("Branch length parameters")), tl->getBranchLengthsParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
+  else if (optMethodDeriv == OPTIMIZATION_NEWTON_BRANCHWISE)
+  {
+    DRHomogeneousTreeLikelihood* drtl = dynamic_cast<DRHomogeneousTreeLikelihood*>(tl);
+    if (!drtl || reparametrization)
+      throw Exception("OptimizationTools::optimizeNumericalParameters. Branchwise Newton optimization needs a DRHomogeneousTreeLikelihood, without reparametrization.");
+    desc->addOptimizer("Branch length parameters", new BranchwiseNewtonOptimizer(drtl), tl->getBranchLengthsParameters().getParameterNames(), 0, MetaOptimizerInfos::IT_TYPE_FULL);
+  }
   else
     throw Exception("OptimizationTools::optimizeNumericalParameters. Unknown optimization method: " + optMethodDeriv);
 
@@ -195,11 +302,11 @@ unsigned int OptimizationTools::optimizeNumericalParameters(
   if (optMethodModel == OPTIMIZATION_BRENT)
   {
     ParameterList plsm = parameters.getCommonParametersWith(tl->getSubstitutionModelParameters());
-    desc->addOptimizer("Substitution model parameter", new SimpleMultiDimensions(f), plsm.getParameterNames(), 0, MetaOptimizerInfos::IT_TYPE_STEP);
+    desc->addOptimizer("Substitution model parameter", new SimpleMultiDimensions(phaseFunction("Substitution model parameter")), plsm.getParameterNames(), 0, MetaOptimizerInfos::IT_TYPE_STEP);
 
 
     ParameterList plrd = parameters.getCommonParametersWith(tl->getRateDistributionParameters());
-    desc->addOptimizer("Rate distribution parameter", new SimpleMultiDimensions(f), plrd.getParameterNames(), 0, MetaOptimizerInfos::IT_TYPE_STEP);
+    desc->addOptimizer("Rate distribution parameter", new SimpleMultiDimensions(phaseFunction("Rate distribution parameter")), plrd.getParameterNames(), 0, MetaOptimizerInfos::IT_TYPE_STEP);
     poptimizer = new MetaOptimizer(f, desc, nstep);
   }
   else if (optMethodModel == OPTIMIZATION_BFGS)
@@ -258,8 +365,20 @@ unsigned int OptimizationTools::optimizeNumericalParameters(
   bool reparametrization,
   unsigned int verbose,
   const std::string& optMethodDeriv,
-  const std::string& optMethodModel)
+  const std::string& optMethodModel,
+  OptimizationProfile* profile,
+  const ToleranceSchedule* schedule)
 {
+  if (schedule)
+  {
+    // Each round starts from the values reached by the previous one:
+    ParameterList current = parameters;
+    return optimizeWithSchedule(*schedule, *lik, tolerance, tlEvalMax, [&](double tol, unsigned int evalMax) {
+      current.matchParametersValues(lik->getParameters());
+      return optimizeNumericalParameters(lik, current, listener, nstep, tol, evalMax, messageHandler, profiler, reparametrization, verbose, optMethodDeriv, optMethodModel, profile);
+    });
+  }
+
   DerivableSecondOrder* f = lik;
   ParameterList pl = parameters;
 
@@ -281,14 +400,25 @@ unsigned int OptimizationTools::optimizeNumericalParameters(
 
   MetaOptimizerInfos* desc = new MetaOptimizerInfos();
   MetaOptimizer* poptimizer = 0;
-  AbstractNumericalDerivative* fnum = new ThreePointsNumericalDerivative(f);
+
+  // Each optimizer gets its own profiled view of the function:
+  vector<unique_ptr<DerivableSecondOrder> > profiled;
+  auto phaseFunction = [&](const string& phase) -> DerivableSecondOrder*
+  {
+    if (!profile)
+      return f;
+    profiled.push_back(unique_ptr<DerivableSecondOrder>(new ProfiledFunctionWrapper(f, profile, phase, lik->getBranchLengthParameters())));
+    return profiled.back().get();
+  };
+
+  AbstractNumericalDerivative* fnum = new ThreePointsNumericalDerivative(phaseFunction("Rate & model distribution parameters"));
 
   if (optMethodDeriv == OPTIMIZATION_GRADIENT)
-    desc->addOptimizer("Branch length parameters", new ConjugateGradientMultiDimensions(f), lik->getBranchLengthParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
+    desc->addOptimizer("Branch length parameters", new ConjugateGradientMultiDimensions(phaseFunction("Branch length parameters")), lik->getBranchLengthParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
   else if (optMethodDeriv == OPTIMIZATION_NEWTON)
-    desc->addOptimizer("Branch length parameters", new PseudoNewtonOptimizer(f), lik->getBranchLengthParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
+    desc->addOptimizer("Branch length parameters", new PseudoNewtonOptimizer(phaseFunction("Branch length parameters")), lik->getBranchLengthParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
   else if (optMethodDeriv == OPTIMIZATION_BFGS)
-    desc->addOptimizer("Branch length parameters", new BfgsMultiDimensions(f), lik->getBranchLengthParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
+    desc->addOptimizer("Branch length parameters", new BfgsMultiDimensions(phaseFunction("Branch length parameters")), lik->getBranchLengthParameters().getParameterNames(), 2, MetaOptimizerInfos::IT_TYPE_FULL);
   else
     throw Exception("OptimizationTools::optimizeNumericalParameters. Unknown optimization method: " + optMethodDeriv);
 
@@ -297,11 +427,11 @@ unsigned int OptimizationTools::optimizeNumericalParameters(
   if (optMethodModel == OPTIMIZATION_BRENT)
   {
     ParameterList plsm = parameters.getCommonParametersWith(lik->getSubstitutionModelParameters());
-    desc->addOptimizer("Substitution model parameter", new SimpleMultiDimensions(f), plsm.getParameterNames(), 0, MetaOptimizerInfos::IT_TYPE_STEP);
+    desc->addOptimizer("Substitution model parameter", new SimpleMultiDimensions(phaseFunction("Substitution model parameter")), plsm.getParameterNames(), 0, MetaOptimizerInfos::IT_TYPE_STEP);
 
 
     ParameterList plrd = parameters.getCommonParametersWith(lik->getRateDistributionParameters());
-    desc->addOptimizer("Rate distribution parameter", new SimpleMultiDimensions(f), plrd.getParameterNames(), 0, MetaOptimizerInfos::IT_TYPE_STEP);
+    desc->addOptimizer("Rate distribution parameter", new SimpleMultiDimensions(phaseFunction("Rate distribution parameter")), plrd.getParameterNames(), 0, MetaOptimizerInfos::IT_TYPE_STEP);
     poptimizer = new MetaOptimizer(f, desc, nstep);
   }
   else if (optMethodModel == OPTIMIZATION_BFGS)
@@ -361,7 +491,8 @@ unsigned int OptimizationTools::optimizeNumericalParameters2(
   bool reparametrization,
   bool useClock,
   unsigned int verbose,
-  const std::string& optMethodDeriv)
+  const std::string& optMethodDeriv,
+  OptimizationProfile* profile)
 {
   DerivableSecondOrder* f = tl;
   ParameterList pl = parameters;
@@ -389,6 +520,13 @@ unsigned int OptimizationTools::optimizeNumericalParameters2(
     pl = f->getParameters().subList(pl.getParameterNames());
   }
 
+  unique_ptr<DerivableSecondOrder> fprof;
+  if (profile)
+  {
+    fprof.reset(new ProfiledFunctionWrapper(f, profile, "All parameters", tl->getBranchLengthsParameters()));
+    f = fprof.get();
+  }
+
   unique_ptr<AbstractNumericalDerivative> fnum;
   // Build optimizer:
   unique_ptr<Optimizer> optimizer;
@@ -454,7 +592,8 @@ unsigned int OptimizationTools::optimizeNumericalParameters2(
   bool reparametrization,
   bool useClock,
   unsigned int verbose,
-  const std::string& optMethodDeriv)
+  const std::string& optMethodDeriv,
+  OptimizationProfile* profile)
 {
   DerivableSecondOrder* f = lik;
   ParameterList pl = parameters;
@@ -483,6 +622,13 @@ unsigned int OptimizationTools::optimizeNumericalParameters2(
     pl = f->getParameters().subList(pl.getParameterNames());
   }
 
+  unique_ptr<DerivableSecondOrder> fprof;
+  if (profile)
+  {
+    fprof.reset(new ProfiledFunctionWrapper(f, profile, "All parameters", lik->getBranchLengthParameters()));
+    f = fprof.get();
+  }
+
   unique_ptr<AbstractNumericalDerivative> fnum;
   // Build optimizer:
   unique_ptr<Optimizer> optimizer;
@@ -601,6 +747,27 @@ unsigned int OptimizationTools::optimizeBranchLengthsParameters(
 
 /******************************************************************************/
 
+void OptimizationTools::optimizeLocalBranchLengths(
+  DRHomogeneousTreeLikelihood* tl,
+  const ParameterList& parameters,
+  const std::vector<int>& nodeIds,
+  unsigned int distance,
+  double tolerance,
+  unsigned int maxNbSteps)
+{
+  if (!tl)
+    throw Exception("OptimizationTools::optimizeLocalBranchLengths. A DRHomogeneousTreeLikelihood object is required.");
+  ParameterList pl = parameters.getCommonParametersWith(tl->getBranchLengthsParameters(nodeIds, distance));
+  if (pl.size() == 0)
+    return;
+  if (dynamic_cast<DRHomogeneousMixedTreeLikelihood*>(tl))
+  {
+    optimizeBranchLengthsParameters(tl, pl, 0, tolerance, 1000000, 0, 0, 0);
+    return;
+  }
+  tl->optimizeBranchLengthsOneByOne(pl.getParameterNames(), tolerance, maxNbSteps);
+}
+
 unsigned int OptimizationTools::optimizeNumericalParametersWithGlobalClock(
   DiscreteRatesAcrossSitesClockTreeLikelihood* cl,
   const ParameterList& parameters,
@@ -739,6 +906,8 @@ void NNITopologyListener::topologyChangeSuccessful(const TopologyChangeEvent& ev
     OptimizationTools::optimizeNumericalParameters(likelihood, parameters_, 0, nStep_, tolerance_, 1000000, messenger_, profiler_, reparametrization_, verbose_, optMethod_);
     optimizeCounter_ = 0;
   }
+  else if (localOptimization_)
+    OptimizationTools::optimizeLocalBranchLengths(dynamic_cast<DRHomogeneousTreeLikelihood*>(topoSearch_->getSearchableObject()), parameters_, event.getNodeIds(), localDistance_, localTolerance_, localMaxNbSteps_);
 }
 
 /******************************************************************************/
@@ -753,6 +922,8 @@ void NNITopologyListener2::topologyChangeSuccessful(const TopologyChangeEvent& e
     OptimizationTools::optimizeNumericalParameters2(likelihood, parameters_, 0, tolerance_, 1000000, messenger_, profiler_, reparametrization_, false, verbose_, optMethod_);
     optimizeCounter_ = 0;
   }
+  else if (localOptimization_)
+    OptimizationTools::optimizeLocalBranchLengths(dynamic_cast<DRHomogeneousTreeLikelihood*>(topoSearch_->getSearchableObject()), parameters_, event.getNodeIds(), localDistance_, localTolerance_, localMaxNbSteps_);
 }
 
 // ******************************************************************************/
@@ -771,8 +942,11 @@ NNIHomogeneousTreeLikelihood* OptimizationTools::optimizeTreeNNI(
   unsigned int verbose,
   const std::string& optMethodDeriv,
   unsigned int nStep,
-  const std::string& nniMethod)
+  const std::string& nniMethod,
+  double nniScreeningThreshold,
+  int nniLocalDistance)
 {
+  tl->setNNIScreeningThreshold(nniScreeningThreshold);
   // Roughly optimize parameter
   if (optimizeNumFirst)
   {
@@ -782,6 +956,8 @@ NNIHomogeneousTreeLikelihood* OptimizationTools::optimizeTreeNNI(
   NNITopologySearch topoSearch(*tl, nniMethod, verbose > 2 ? verbose - 2 : 0);
   NNITopologyListener* topoListener = new NNITopologyListener(&topoSearch, parameters, tolDuring, messageHandler, profiler, verbose, optMethodDeriv, nStep, reparametrization);
   topoListener->setNumericalOptimizationCounter(numStep);
+  if (nniLocalDistance >= 0)
+    topoListener->setLocalOptimization(static_cast<unsigned int>(nniLocalDistance));
   topoSearch.addTopologyListener(topoListener);
   topoSearch.search();
   return dynamic_cast<NNIHomogeneousTreeLikelihood*>(topoSearch.getSearchableObject());
@@ -802,8 +978,11 @@ NNIHomogeneousTreeLikelihood* OptimizationTools::optimizeTreeNNI2(
   bool reparametrization,
   unsigned int verbose,
   const std::string& optMethodDeriv,
-  const std::string& nniMethod)
+  const std::string& nniMethod,
+  double nniScreeningThreshold,
+  int nniLocalDistance)
 {
+  tl->setNNIScreeningThreshold(nniScreeningThreshold);
   // Roughly optimize parameter
   if (optimizeNumFirst)
   {
@@ -813,6 +992,8 @@ NNIHomogeneousTreeLikelihood* OptimizationTools::optimizeTreeNNI2(
   NNITopologySearch topoSearch(*tl, nniMethod, verbose > 2 ? verbose - 2 : 0);
   NNITopologyListener2* topoListener = new NNITopologyListener2(&topoSearch, parameters, tolDuring, messageHandler, profiler, verbose, optMethodDeriv, reparametrization);
   topoListener->setNumericalOptimizationCounter(numStep);
+  if (nniLocalDistance >= 0)
+    topoListener->setLocalOptimization(static_cast<unsigned int>(nniLocalDistance));
   topoSearch.addTopologyListener(topoListener);
   topoSearch.search();
   return dynamic_cast<NNIHomogeneousTreeLikelihood*>(topoSearch.getSearchableObject());
@@ -832,6 +1013,32 @@ DRTreeParsimonyScore* OptimizationTools::optimizeTreeNNI(
 
 /******************************************************************************/
 
+DRTreeParsimonyScore* OptimizationTools::optimizeTreeSPR(
+  DRTreeParsimonyScore* tp,
+  unsigned int radius,
+  unsigned int verbose,
+  const std::string& algorithm)
+{
+  SPRTopologySearch topoSearch(*tp, algorithm, radius, verbose);
+  topoSearch.search();
+  return dynamic_cast<DRTreeParsimonyScore*>(topoSearch.getSearchableObject());
+}
+
+/******************************************************************************/
+
+NNIHomogeneousTreeLikelihood* OptimizationTools::optimizeTreeSPR(
+  NNIHomogeneousTreeLikelihood* tl,
+  unsigned int radius,
+  unsigned int verbose,
+  const std::string& algorithm)
+{
+  SPRTopologySearch topoSearch(*tl, algorithm, radius, verbose);
+  topoSearch.search();
+  return dynamic_cast<NNIHomogeneousTreeLikelihood*>(topoSearch.getSearchableObject());
+}
+
+/******************************************************************************/
+
 std::string OptimizationTools::DISTANCEMETHOD_INIT       = "init";
 std::string OptimizationTools::DISTANCEMETHOD_PAIRWISE   = "pairwise";
 std::string OptimizationTools::DISTANCEMETHOD_ITERATIONS = "iterations";
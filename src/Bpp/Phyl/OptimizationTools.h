@@ -44,17 +44,23 @@
 #include "Likelihood/NNIHomogeneousTreeLikelihood.h"
 #include "Likelihood/ClockTreeLikelihood.h"
 #include "Tree/NNITopologySearch.h"
+#include "Tree/SPRTopologySearch.h"
 #include "Parsimony/DRTreeParsimonyScore.h"
 #include "Tree/TreeTemplate.h"
 #include "Distance/DistanceEstimation.h"
 #include "Distance/DistanceMethod.h"
 
 #include "NewLikelihood/PhyloLikelihoods/PhyloLikelihood.h"
+#include "OptimizationProfile.h"
+#include "ToleranceSchedule.h"
 
 #include <Bpp/Io/OutputStream.h>
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/Function/SimpleNewtonMultiDimensions.h>
 
+// From the STL:
+#include <limits>
+
 namespace bpp
 {
 /**
@@ -115,6 +121,10 @@ private:
   std::string optMethod_;
   unsigned int nStep_;
   bool reparametrization_;
+  bool localOptimization_;
+  unsigned int localDistance_;
+  double localTolerance_;
+  unsigned int localMaxNbSteps_;
 
 public:
   /**
@@ -154,7 +164,11 @@ public:
     optimizeNumerical_(1),
     optMethod_(optMethod),
     nStep_(nStep),
-    reparametrization_(reparametrization) {}
+    reparametrization_(reparametrization),
+    localOptimization_(false),
+    localDistance_(0),
+    localTolerance_(0.000001),
+    localMaxNbSteps_(10) {}
 
   NNITopologyListener(const NNITopologyListener& tl) :
     topoSearch_(tl.topoSearch_),
@@ -167,7 +181,11 @@ public:
     optimizeNumerical_(tl.optimizeNumerical_),
     optMethod_(tl.optMethod_),
     nStep_(tl.nStep_),
-    reparametrization_(tl.reparametrization_)
+    reparametrization_(tl.reparametrization_),
+    localOptimization_(tl.localOptimization_),
+    localDistance_(tl.localDistance_),
+    localTolerance_(tl.localTolerance_),
+    localMaxNbSteps_(tl.localMaxNbSteps_)
   {}
 
   NNITopologyListener& operator=(const NNITopologyListener& tl)
@@ -183,6 +201,10 @@ public:
     optMethod_         = tl.optMethod_;
     nStep_             = tl.nStep_;
     reparametrization_ = tl.reparametrization_;
+    localOptimization_ = tl.localOptimization_;
+    localDistance_     = tl.localDistance_;
+    localTolerance_    = tl.localTolerance_;
+    localMaxNbSteps_   = tl.localMaxNbSteps_;
     return *this;
   }
 
@@ -194,6 +216,26 @@ public:
   void topologyChangeTested(const TopologyChangeEvent& event) {}
   void topologyChangeSuccessful(const TopologyChangeEvent& event);
   void setNumericalOptimizationCounter(unsigned int c) { optimizeNumerical_ = c; }
+
+  /**
+   * @brief Re-optimize only the branches around the NNIs between two full optimizations.
+   *
+   * After each successful round of NNIs which does not trigger a full numerical optimization,
+   * the branches at most @p distance branches away from the central branch of a performed NNI
+   * are optimized one by one (see DRHomogeneousTreeLikelihood::optimizeBranchLengthsOneByOne).
+   * All parameters are still optimized every *n* rounds (see setNumericalOptimizationCounter).
+   *
+   * @param distance   The size of the neighbourhood, in number of branches.
+   * @param tolerance  Tolerance on each branch length.
+   * @param maxNbSteps Maximum number of Newton steps for each branch.
+   */
+  void setLocalOptimization(unsigned int distance, double tolerance = 0.000001, unsigned int maxNbSteps = 10)
+  {
+    localOptimization_ = true;
+    localDistance_     = distance;
+    localTolerance_    = tolerance;
+    localMaxNbSteps_   = maxNbSteps;
+  }
 };
 
 /**
@@ -213,6 +255,10 @@ private:
   unsigned int optimizeNumerical_;
   std::string optMethod_;
   bool reparametrization_;
+  bool localOptimization_;
+  unsigned int localDistance_;
+  double localTolerance_;
+  unsigned int localMaxNbSteps_;
 
 public:
   /**
@@ -249,7 +295,11 @@ public:
     optimizeCounter_(0),
     optimizeNumerical_(1),
     optMethod_(optMethod),
-    reparametrization_(reparametrization) {}
+    reparametrization_(reparametrization),
+    localOptimization_(false),
+    localDistance_(0),
+    localTolerance_(0.000001),
+    localMaxNbSteps_(10) {}
 
   NNITopologyListener2(const NNITopologyListener2& tl) :
     topoSearch_(tl.topoSearch_),
@@ -261,7 +311,11 @@ public:
     optimizeCounter_(tl.optimizeCounter_),
     optimizeNumerical_(tl.optimizeNumerical_),
     optMethod_(tl.optMethod_),
-    reparametrization_(tl.reparametrization_)
+    reparametrization_(tl.reparametrization_),
+    localOptimization_(tl.localOptimization_),
+    localDistance_(tl.localDistance_),
+    localTolerance_(tl.localTolerance_),
+    localMaxNbSteps_(tl.localMaxNbSteps_)
   {}
 
   NNITopologyListener2& operator=(const NNITopologyListener2& tl)
@@ -276,6 +330,10 @@ public:
     optimizeNumerical_ = tl.optimizeNumerical_;
     optMethod_         = tl.optMethod_;
     reparametrization_ = tl.reparametrization_;
+    localOptimization_ = tl.localOptimization_;
+    localDistance_     = tl.localDistance_;
+    localTolerance_    = tl.localTolerance_;
+    localMaxNbSteps_   = tl.localMaxNbSteps_;
     return *this;
   }
 
@@ -287,6 +345,26 @@ public:
   void topologyChangeTested(const TopologyChangeEvent& event) {}
   void topologyChangeSuccessful(const TopologyChangeEvent& event);
   void setNumericalOptimizationCounter(unsigned int c) { optimizeNumerical_ = c; }
+
+  /**
+   * @brief Re-optimize only the branches around the NNIs between two full optimizations.
+   *
+   * After each successful round of NNIs which does not trigger a full numerical optimization,
+   * the branches at most @p distance branches away from the central branch of a performed NNI
+   * are optimized one by one (see DRHomogeneousTreeLikelihood::optimizeBranchLengthsOneByOne).
+   * All parameters are still optimized every *n* rounds (see setNumericalOptimizationCounter).
+   *
+   * @param distance   The size of the neighbourhood, in number of branches.
+   * @param tolerance  Tolerance on each branch length.
+   * @param maxNbSteps Maximum number of Newton steps for each branch.
+   */
+  void setLocalOptimization(unsigned int distance, double tolerance = 0.000001, unsigned int maxNbSteps = 10)
+  {
+    localOptimization_ = true;
+    localDistance_     = distance;
+    localTolerance_    = tolerance;
+    localMaxNbSteps_   = maxNbSteps;
+  }
 };
 
 
@@ -307,6 +385,7 @@ public:
 public:
   static std::string OPTIMIZATION_GRADIENT;
   static std::string OPTIMIZATION_NEWTON;
+  static std::string OPTIMIZATION_NEWTON_BRANCHWISE;
   static std::string OPTIMIZATION_BRENT;
   static std::string OPTIMIZATION_BFGS;
 
@@ -331,9 +410,19 @@ public:
    *                          This can improve optimization, but is a bit slower.
    * @param verbose        The verbose level.
    * @param optMethodDeriv Optimization type for derivable parameters (first or second order derivatives).
-   * @see OPTIMIZATION_NEWTON, OPTIMIZATION_GRADIENT
+   * OPTIMIZATION_NEWTON_BRANCHWISE optimizes one branch at a time (see BranchwiseNewtonOptimizer),
+   * and needs a DRHomogeneousTreeLikelihood without reparametrization.
+   * @see OPTIMIZATION_NEWTON, OPTIMIZATION_GRADIENT, OPTIMIZATION_NEWTON_BRANCHWISE
    * @param optMethodModel Optimization type for model parameters (Brent or BFGS).
    * @see OPTIMIZATION_BRENT, OPTIMIZATION_BFGS
+   * @param nbThreads      With BFGS for model parameters, the number of threads computing
+   *                       numerical derivatives, each one on a clone of the likelihood
+   *                       (see ParallelThreePointsNumericalDerivative).
+   * @param profile        If not null, where to record the number and duration of calls
+   *                       made by each optimizer (see OptimizationProfile).
+   * @param schedule       If not null, the optimization is run several times, from the initial
+   *                       tolerance of the schedule down to @p tolerance (see ToleranceSchedule).
+   *                       The maximum number of evaluations is shared by all rounds.
    * @throw Exception any exception thrown by the Optimizer.
    */
   static unsigned int optimizeNumericalParameters(
@@ -348,7 +437,10 @@ public:
     bool reparametrization            = false,
     unsigned int verbose              = 1,
     const std::string& optMethodDeriv = OPTIMIZATION_NEWTON,
-    const std::string& optMethodModel = OPTIMIZATION_BRENT);
+    const std::string& optMethodModel = OPTIMIZATION_BRENT,
+    unsigned int nbThreads            = 1,
+    OptimizationProfile* profile      = 0,
+    const ToleranceSchedule* schedule = 0);
 
   static unsigned int optimizeNumericalParameters(
       PhyloLikelihood* lik,
@@ -362,7 +454,9 @@ public:
       bool reparametrization            = false,
       unsigned int verbose              = 1,
       const std::string& optMethodDeriv = OPTIMIZATION_NEWTON,
-      const std::string& optMethodModel = OPTIMIZATION_BRENT);
+      const std::string& optMethodModel = OPTIMIZATION_BRENT,
+      OptimizationProfile* profile      = 0,
+      const ToleranceSchedule* schedule = 0);
   
   /**
    * @brief Optimize numerical parameters (branch length, substitution model & rate distribution) of a TreeLikelihood function.
@@ -384,6 +478,8 @@ public:
    * @param verbose        The verbose level.
    * @param optMethodDeriv Optimization type for derivable parameters (first or second order derivatives).
    * @see OPTIMIZATION_NEWTON, OPTIMIZATION_GRADIENT
+   * @param profile        If not null, where to record the number and duration of calls
+   *                       to the function (see OptimizationProfile).
    * @throw Exception any exception thrown by the Optimizer.
    */
   static unsigned int optimizeNumericalParameters2(
@@ -397,7 +493,8 @@ public:
     bool reparametrization             = false,
     bool useClock                      = false,
     unsigned int verbose               = 1,
-    const std::string& optMethodDeriv  = OPTIMIZATION_NEWTON);
+    const std::string& optMethodDeriv  = OPTIMIZATION_NEWTON,
+    OptimizationProfile* profile       = 0);
 
   static unsigned int optimizeNumericalParameters2(
       PhyloLikelihood* lik,
@@ -410,7 +507,8 @@ public:
       bool reparametrization             = false,
       bool useClock                      = false,
       unsigned int verbose               = 1,
-      const std::string& optMethodDeriv  = OPTIMIZATION_NEWTON);
+      const std::string& optMethodDeriv  = OPTIMIZATION_NEWTON,
+      OptimizationProfile* profile       = 0);
 
   /**
    * @brief Optimize branch lengths parameters of a TreeLikelihood function.
@@ -444,6 +542,30 @@ public:
     unsigned int verbose               = 1,
     const std::string& optMethodDeriv  = OPTIMIZATION_NEWTON);
 
+  /**
+   * @brief Optimize the branch lengths in the neighbourhood of some branches.
+   *
+   * Only the branches at most @p distance branches away from one of the input branches are optimized
+   * (see AbstractHomogeneousTreeLikelihood::getBranchLengthsParameters). They are optimized one by one
+   * with DRHomogeneousTreeLikelihood::optimizeBranchLengthsOneByOne, or with optimizeBranchLengthsParameters
+   * for mixed models.
+   *
+   * @param tl          A pointer toward the likelihood object to optimize.
+   * @param parameters  The list of parameters allowed to be optimized. Only branch lengths are considered.
+   * @param nodeIds     The ids of the nodes under the central branches.
+   * @param distance    The size of the neighbourhood, in number of branches.
+   * @param tolerance   The tolerance on each branch length.
+   * @param maxNbSteps  The maximum number of Newton steps for each branch.
+   * @throw Exception any exception thrown by the optimizer.
+   */
+  static void optimizeLocalBranchLengths(
+    DRHomogeneousTreeLikelihood* tl,
+    const ParameterList& parameters,
+    const std::vector<int>& nodeIds,
+    unsigned int distance,
+    double tolerance        = 0.000001,
+    unsigned int maxNbSteps = 10);
+
   /**
    * @brief Optimize numerical parameters assuming a global clock (branch heights, substitution model & rate distribution) of a ClockTreeLikelihood function.
    *
@@ -521,13 +643,19 @@ private:
     TreeLikelihood* tl_;
     mutable ParameterList brLen_, lambda_;
 
+    /**
+     * @brief tl_, if all its branch lengths can be set at once, else 0.
+     */
+    AbstractHomogeneousTreeLikelihood* bulk_;
+
 public:
     ScaleFunction(TreeLikelihood* tl);
 
     ScaleFunction(const ScaleFunction& sf) :
       tl_(sf.tl_),
       brLen_(sf.brLen_),
-      lambda_(sf.lambda_)
+      lambda_(sf.lambda_),
+      bulk_(sf.bulk_)
     {}
 
     ScaleFunction& operator=(const ScaleFunction& sf)
@@ -535,6 +663,7 @@ public:
       tl_     = sf.tl_;
       brLen_  = sf.brLen_;
       lambda_ = sf.lambda_;
+      bulk_   = sf.bulk_;
       return *this;
     }
 
@@ -620,6 +749,13 @@ public:
    * @param optMethod         Option passed to optimizeNumericalParameters.
    * @param nStep             Option passed to optimizeNumericalParameters.
    * @param nniMethod         NNI algorithm to use.
+   * @param nniScreeningThreshold Score variation above which a NNI is rejected before its
+   *                          branch length is optimized (see NNIHomogeneousTreeLikelihood::setNNIScreeningThreshold).
+   *                          Infinity (the default) disables screening.
+   * @param nniLocalDistance  If positive or zero, only the branches at most this number of branches away
+   *                          from the NNIs are re-optimized between two full optimizations
+   *                          (see NNITopologyListener::setLocalOptimization). A negative value (the default)
+   *                          disables local optimization.
    * @return A pointer toward the final likelihood object.
    * This pointer may be the same as passed in argument (tl), but in some cases the algorithm
    * clone this object. We may change this bahavior in the future...
@@ -643,7 +779,9 @@ public:
     unsigned int verbose         = 1,
     const std::string& optMethod = OptimizationTools::OPTIMIZATION_NEWTON,
     unsigned int nStep           = 1,
-    const std::string& nniMethod = NNITopologySearch::PHYML);
+    const std::string& nniMethod = NNITopologySearch::PHYML,
+    double nniScreeningThreshold = std::numeric_limits<double>::infinity(),
+    int nniLocalDistance         = -1);
 
   /**
    * @brief Optimize all parameters from a TreeLikelihood object, including tree topology using Nearest Neighbor Interchanges.
@@ -674,6 +812,13 @@ public:
    * @param verbose           The verbose level.
    * @param optMethod         Option passed to optimizeNumericalParameters2.
    * @param nniMethod         NNI algorithm to use.
+   * @param nniScreeningThreshold Score variation above which a NNI is rejected before its
+   *                          branch length is optimized (see NNIHomogeneousTreeLikelihood::setNNIScreeningThreshold).
+   *                          Infinity (the default) disables screening.
+   * @param nniLocalDistance  If positive or zero, only the branches at most this number of branches away
+   *                          from the NNIs are re-optimized between two full optimizations
+   *                          (see NNITopologyListener::setLocalOptimization). A negative value (the default)
+   *                          disables local optimization.
    * @return A pointer toward the final likelihood object.
    * This pointer may be the same as passed in argument (tl), but in some cases the algorithm
    * clone this object. We may change this bahavior in the future...
@@ -696,7 +841,9 @@ public:
     bool reparametrization       = false,
     unsigned int verbose         = 1,
     const std::string& optMethod = OptimizationTools::OPTIMIZATION_NEWTON,
-    const std::string& nniMethod = NNITopologySearch::PHYML);
+    const std::string& nniMethod = NNITopologySearch::PHYML,
+    double nniScreeningThreshold = std::numeric_limits<double>::infinity(),
+    int nniLocalDistance         = -1);
 
   /**
    * @brief Optimize tree topology from a DRTreeParsimonyScore using Nearest Neighbor Interchanges.
@@ -716,6 +863,40 @@ public:
     DRTreeParsimonyScore* tp,
     unsigned int verbose = 1);
 
+  /**
+   * @brief Optimize tree topology from a DRTreeParsimonyScore using Subtree Pruning and Regrafting.
+   *
+   * @param tp        A pointer toward the DRTreeParsimonyScore object to optimize.
+   * @param radius    The maximum distance between the pruning and the regrafting points (see SPRTopologySearch).
+   * @param verbose   The verbose level.
+   * @param algorithm The SPR algorithm to use (SPRTopologySearch::FAST or SPRTopologySearch::BETTER).
+   * @return A pointer toward the final parsimony score object.
+   */
+  static DRTreeParsimonyScore* optimizeTreeSPR(
+    DRTreeParsimonyScore* tp,
+    unsigned int radius = 3,
+    unsigned int verbose = 1,
+    const std::string& algorithm = SPRTopologySearch::FAST);
+
+  /**
+   * @brief Optimize tree topology from a NNIHomogeneousTreeLikelihood using Subtree Pruning and Regrafting.
+   *
+   * Only the lengths of the branches changed by each move are re-estimated.
+   * Other numerical parameters are left unchanged, and should be optimized afterwards,
+   * for instance with optimizeNumericalParameters().
+   *
+   * @param tl        A pointer toward the likelihood object to optimize.
+   * @param radius    The maximum distance between the pruning and the regrafting points (see SPRTopologySearch).
+   * @param verbose   The verbose level.
+   * @param algorithm The SPR algorithm to use (SPRTopologySearch::FAST or SPRTopologySearch::BETTER).
+   * @return A pointer toward the final likelihood object.
+   */
+  static NNIHomogeneousTreeLikelihood* optimizeTreeSPR(
+    NNIHomogeneousTreeLikelihood* tl,
+    unsigned int radius = 3,
+    unsigned int verbose = 1,
+    const std::string& algorithm = SPRTopologySearch::FAST);
+
   /**
    * @brief Estimate a distance matrix using maximum likelihood.
    *
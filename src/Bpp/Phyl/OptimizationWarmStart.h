@@ -0,0 +1,128 @@
+//
+// File: OptimizationWarmStart.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _OPTIMIZATIONWARMSTART_H_
+#define _OPTIMIZATIONWARMSTART_H_
+
+#include <Bpp/Numeric/ParameterList.h>
+
+// From the STL:
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+  /**
+   * @brief Converged values carried from one optimization to the next.
+   *
+   * When the same model is fitted again on a slightly different tree
+   * (bootstrap replicate, tree after a few NNIs), starting from the
+   * previously converged model parameters saves most of the model phases.
+   * Branch lengths are not carried, as they are tied to a given tree:
+   * the lengths of the new tree are used as starting values.
+   *
+   * If the caller knows the change is local, setLocalTreeChange(true)
+   * tells the optimization to keep model parameters at their previous
+   * values and to estimate branch lengths only.
+   *
+   * @see PhylogeneticsApplicationTools::optimizeParameters
+   */
+  class OptimizationWarmStart
+  {
+  private:
+    ParameterList parameters_;
+    double value_;
+    bool hasState_;
+    bool localTreeChange_;
+
+  public:
+    OptimizationWarmStart() :
+      parameters_(),
+      value_(0),
+      hasState_(false),
+      localTreeChange_(false)
+    {}
+
+  public:
+    /**
+     * @brief Store the converged parameters of a run, and the final
+     * value of the function.
+     *
+     * @param parameters All parameters of the likelihood.
+     * @param branchLengths The branch length parameters, which are not kept.
+     * @param value The final value of the function.
+     */
+    void record(const ParameterList& parameters, const ParameterList& branchLengths, double value)
+    {
+      parameters_ = parameters;
+      parameters_.deleteParameters(branchLengths.getParameterNames(), false);
+      value_ = value;
+      hasState_ = true;
+    }
+
+    bool hasState() const { return hasState_; }
+
+    /**
+     * @return The converged parameters of the last run, without branch lengths.
+     */
+    const ParameterList& getParameters() const { return parameters_; }
+
+    /**
+     * @return The final value of the last run (minus log-likelihood).
+     */
+    double getValue() const { return value_; }
+
+    void setLocalTreeChange(bool yn) { localTreeChange_ = yn; }
+
+    bool isLocalTreeChange() const { return localTreeChange_; }
+
+    void clear()
+    {
+      parameters_.reset();
+      value_ = 0;
+      hasState_ = false;
+      localTreeChange_ = false;
+    }
+  };
+
+} // end of namespace bpp.
+
+#endif // _OPTIMIZATIONWARMSTART_H_
+
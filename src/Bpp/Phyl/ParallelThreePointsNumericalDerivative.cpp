@@ -0,0 +1,237 @@
+//
+// File: ParallelThreePointsNumericalDerivative.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "ParallelThreePointsNumericalDerivative.h"
+
+#include <Bpp/Numeric/NumConstants.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <cmath>
+
+using namespace std;
+
+/******************************************************************************/
+
+ParallelThreePointsNumericalDerivative::ParallelThreePointsNumericalDerivative(Function* function, const vector<Function*>& copies) :
+  AbstractNumericalDerivative(function),
+  copies_(copies),
+  f0_(),
+  executor_()
+{
+  if (copies_.size() == 0)
+    throw Exception("ParallelThreePointsNumericalDerivative. At least one copy of the function is needed.");
+}
+
+ParallelThreePointsNumericalDerivative::ParallelThreePointsNumericalDerivative(DerivableFirstOrder* function, const vector<Function*>& copies) :
+  AbstractNumericalDerivative(function),
+  copies_(copies),
+  f0_(),
+  executor_()
+{
+  if (copies_.size() == 0)
+    throw Exception("ParallelThreePointsNumericalDerivative. At least one copy of the function is needed.");
+}
+
+ParallelThreePointsNumericalDerivative::ParallelThreePointsNumericalDerivative(DerivableSecondOrder* function, const vector<Function*>& copies) :
+  AbstractNumericalDerivative(function),
+  copies_(copies),
+  f0_(),
+  executor_()
+{
+  if (copies_.size() == 0)
+    throw Exception("ParallelThreePointsNumericalDerivative. At least one copy of the function is needed.");
+}
+
+/******************************************************************************/
+
+void ParallelThreePointsNumericalDerivative::updateDerivatives(const ParameterList& parameters)
+{
+  // The function is only evaluated at the current point, so analytical
+  // derivatives can be computed at the same time.
+  if (function1_)
+    function1_->enableFirstOrderDerivatives(computeD1_);
+  if (function2_)
+    function2_->enableSecondOrderDerivatives(computeD2_);
+  function_->setParameters(parameters);
+  f0_ = function_->getValue();
+
+  if (!computeD1_ || variables_.size() == 0)
+    return;
+
+  if ((abs(f0_) >= NumConstants::VERY_BIG()) || std::isnan(f0_))
+  {
+    for (size_t i = 0; i < variables_.size(); ++i)
+    {
+      der1_[i] = log(-1.);
+      der2_[i] = log(-1.);
+    }
+    return;
+  }
+
+  // Each derivated variable i is shifted by a_i * h_i and b_i * h_i,
+  // on both sides if possible, on one side next to a bound.
+  vector<size_t> vars;
+  vector<double> h, a, b;
+  for (size_t i = 0; i < variables_.size(); ++i)
+  {
+    const string& var = variables_[i];
+    if (!parameters.hasParameter(var))
+      continue;
+    const Parameter& param = function_->getParameter(var);
+    double value = param.getValue();
+    double hi = (1. + std::abs(value)) * h_;
+    double ai = -1., bi = 1.;
+    if (param.hasConstraint())
+    {
+      if (!param.getConstraint()->isCorrect(value - hi))
+      {
+        ai = 1.; bi = 2.;
+      }
+      else if (!param.getConstraint()->isCorrect(value + hi))
+      {
+        ai = -1.; bi = -2.;
+      }
+    }
+    vars.push_back(i);
+    h.push_back(hi);
+    a.push_back(ai);
+    b.push_back(bi);
+  }
+
+  // The points to evaluate: one or two shifted variables.
+  struct Point
+  {
+    size_t k1;
+    double s1;
+    size_t k2;
+    double s2;
+  };
+
+  size_t nbVars = vars.size();
+  vector<Point> points;
+  for (size_t k = 0; k < nbVars; ++k)
+  {
+    points.push_back({k, a[k] * h[k], nbVars, 0.});
+    points.push_back({k, b[k] * h[k], nbVars, 0.});
+  }
+  if (computeCrossD2_)
+  {
+    for (size_t k = 0; k < nbVars; ++k)
+    {
+      for (size_t l = k + 1; l < nbVars; ++l)
+      {
+        points.push_back({k, a[k] * h[k], l, a[l] * h[l]});
+        points.push_back({k, a[k] * h[k], l, b[l] * h[l]});
+        points.push_back({k, b[k] * h[k], l, a[l] * h[l]});
+        points.push_back({k, b[k] * h[k], l, b[l] * h[l]});
+      }
+    }
+  }
+
+  if (!executor_ && copies_.size() > 1)
+    executor_.reset(new SiteLoopExecutor(copies_.size()));
+
+  const ParameterList& center = function_->getParameters();
+  vector<double> values(points.size());
+
+  // Points are dealt to the copies in turn. Since a copy only differs
+  // from the current point by the variables of its previous point,
+  // setting the next one does not need more than one evaluation.
+  auto evaluate = [&](size_t first, size_t last)
+  {
+    for (size_t t = first; t < last; ++t)
+    {
+      Function* copy = copies_[t];
+      for (size_t p = t; p < points.size(); p += copies_.size())
+      {
+        const Point& point = points[p];
+        ParameterList pl = center;
+        const string& var1 = variables_[vars[point.k1]];
+        pl.setParameterValue(var1, center.getParameterValue(var1) + point.s1);
+        if (point.k2 < nbVars)
+        {
+          const string& var2 = variables_[vars[point.k2]];
+          pl.setParameterValue(var2, center.getParameterValue(var2) + point.s2);
+        }
+        copy->matchParametersValues(pl);
+        values[p] = copy->getValue();
+      }
+    }
+  };
+
+  if (executor_)
+    executor_->run(copies_.size(), evaluate);
+  else
+    evaluate(0, 1);
+
+  // Derivatives of the quadratic going through the three points.
+  for (size_t k = 0; k < nbVars; ++k)
+  {
+    size_t i = vars[k];
+    double fa = values[2 * k] - f0_;
+    double fb = values[2 * k + 1] - f0_;
+    double ak = a[k], bk = b[k];
+    der1_[i] = (bk * bk * fa - ak * ak * fb) / (h[k] * ak * bk * (bk - ak));
+    der2_[i] = 2. * (bk * fa - ak * fb) / (h[k] * h[k] * ak * bk * (ak - bk));
+  }
+
+  if (computeCrossD2_)
+  {
+    size_t p = 2 * nbVars;
+    for (size_t k = 0; k < nbVars; ++k)
+    {
+      size_t i = vars[k];
+      crossDer2_(i, i) = der2_[i];
+      for (size_t l = k + 1; l < nbVars; ++l)
+      {
+        size_t j = vars[l];
+        double d = (values[p + 3] - values[p + 2] - values[p + 1] + values[p])
+          / ((b[k] - a[k]) * h[k] * (b[l] - a[l]) * h[l]);
+        crossDer2_(i, j) = d;
+        crossDer2_(j, i) = d;
+        p += 4;
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,120 @@
+//
+// File: ParallelThreePointsNumericalDerivative.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _PARALLELTHREEPOINTSNUMERICALDERIVATIVE_H_
+#define _PARALLELTHREEPOINTSNUMERICALDERIVATIVE_H_
+
+#include "SiteLoopExecutor.h"
+
+#include <Bpp/Numeric/Function/AbstractNumericalDerivative.h>
+
+// From the STL:
+#include <memory>
+#include <vector>
+
+namespace bpp
+{
+
+  /**
+   * @brief Three points numerical derivatives, with the shifted points
+   * evaluated concurrently.
+   *
+   * As in ThreePointsNumericalDerivative, the function is evaluated at
+   * the current point and at two points shifted along each variable to
+   * derivate (on one side only, next to the bounds of a constraint).
+   * The 2k shifted points are shared between copies of the function,
+   * one per thread, which must be independent (for instance clones of
+   * a likelihood object sharing no model) and have the same parameters
+   * as the function. The function itself is only evaluated at the
+   * current point, with its own analytical derivatives if any.
+   *
+   * Copies are not owned by this object.
+   */
+  class ParallelThreePointsNumericalDerivative:
+    public AbstractNumericalDerivative
+  {
+  private:
+    std::vector<Function*> copies_;
+    double f0_;
+
+    mutable std::unique_ptr<SiteLoopExecutor> executor_;
+
+  public:
+    /**
+     * @param function The function to derivate.
+     * @param copies Independent copies of the function, one per thread (at least one).
+     * @throw Exception If no copy is given.
+     */
+    ParallelThreePointsNumericalDerivative(Function* function, const std::vector<Function*>& copies);
+    ParallelThreePointsNumericalDerivative(DerivableFirstOrder* function, const std::vector<Function*>& copies);
+    ParallelThreePointsNumericalDerivative(DerivableSecondOrder* function, const std::vector<Function*>& copies);
+
+    ParallelThreePointsNumericalDerivative(const ParallelThreePointsNumericalDerivative& pd) :
+      AbstractNumericalDerivative(pd),
+      copies_(pd.copies_),
+      f0_(pd.f0_),
+      executor_()
+    {}
+
+    ParallelThreePointsNumericalDerivative& operator=(const ParallelThreePointsNumericalDerivative& pd)
+    {
+      AbstractNumericalDerivative::operator=(pd);
+      copies_ = pd.copies_;
+      f0_ = pd.f0_;
+      executor_.reset();
+      return *this;
+    }
+
+    virtual ~ParallelThreePointsNumericalDerivative() {}
+
+    ParallelThreePointsNumericalDerivative* clone() const { return new ParallelThreePointsNumericalDerivative(*this); }
+
+  public:
+    double getValue() const { return f0_; }
+
+    size_t getNumberOfThreads() const { return copies_.size(); }
+
+  protected:
+    void updateDerivatives(const ParameterList& parameters);
+  };
+
+} // end of namespace bpp.
+
+#endif // _PARALLELTHREEPOINTSNUMERICALDERIVATIVE_H_
+
@@ -52,7 +52,7 @@ AbstractTreeParsimonyScore::AbstractTreeParsimonyScore(
   bool verbose,
   bool includeGaps) :
   tree_(new TreeTemplate<Node>(tree)),
-  data_(0),
+  data_(),
   alphabet_(data.getAlphabet()),
   statesMap_(0),
   nbStates_(0)
@@ -69,7 +69,7 @@ AbstractTreeParsimonyScore::AbstractTreeParsimonyScore(
   const StateMap* statesMap,
   bool verbose) :
   tree_(new TreeTemplate<Node>(tree)),
-  data_(0),
+  data_(),
   alphabet_(data.getAlphabet()),
   statesMap_(statesMap),
   nbStates_(statesMap->getNumberOfModelStates())
@@ -88,13 +88,16 @@ void AbstractTreeParsimonyScore::init_(const SiteContainer& data, bool verbose)
   TreeTemplateTools::deleteBranchLengths(*tree_->getRootNode());
 
   // Sequences will be in the same order than in the tree:
-  data_ = dynamic_cast<const SiteContainer*>(PatternTools::getSequenceSubset(data, *tree_->getRootNode()));
+  AlignedValuesContainer* subset = PatternTools::getSequenceSubset(data, *tree_->getRootNode());
+  data_.reset(dynamic_cast<const SiteContainer*>(subset));
   if (!data_)
+  {
+    delete subset;
     throw Exception("AbstractTreeParsimonyScore::init_ : Data must be plain alignments.");
+  }
   
   if (data_->getNumberOfSequences() == 1) throw Exception("Error, only 1 sequence!");
   if (data_->getNumberOfSequences() == 0) throw Exception("Error, no sequence!");
-  if (data_->getAlphabet()->getSize() > 20) throw Exception("Error, only alphabet with size <= 20 are supported. See the source file of AbstractTreeParsimonyScore.");
 }
 
 std::vector<unsigned int> AbstractTreeParsimonyScore::getScorePerSite() const
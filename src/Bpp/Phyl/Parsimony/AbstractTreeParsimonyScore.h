@@ -46,6 +46,9 @@
 // From SeqLib:
 #include <Bpp/Seq/Container/SiteContainer.h>
 
+// From the STL:
+#include <memory>
+
 namespace bpp
 {
 /**
@@ -56,7 +59,8 @@ class AbstractTreeParsimonyScore :
 {
 private:
   TreeTemplate<Node>* tree_;
-  const SiteContainer* data_;
+  // Not modified, and shared by the copies of this object:
+  std::shared_ptr<const SiteContainer> data_;
   const Alphabet* alphabet_;
   const StateMap* statesMap_;
   size_t nbStates_;
@@ -76,20 +80,19 @@ public:
 
   AbstractTreeParsimonyScore(const AbstractTreeParsimonyScore& tp) :
     tree_(0),
-    data_(0),
+    data_(tp.data_),
     alphabet_(tp.alphabet_),
     statesMap_(0),
     nbStates_(tp.nbStates_)
   {
     tree_      = tp.tree_->clone();
-    data_      = dynamic_cast<SiteContainer*>(tp.data_->clone());
     statesMap_ = tp.statesMap_->clone();
   }
 
   AbstractTreeParsimonyScore& operator=(const AbstractTreeParsimonyScore& tp)
   {
     tree_      = dynamic_cast<TreeTemplate<Node>*>(tp.tree_->clone());
-    data_      = dynamic_cast<SiteContainer*>(tp.data_->clone());
+    data_      = tp.data_;
     alphabet_  = tp.alphabet_;
     statesMap_ = tp.statesMap_->clone();
     nbStates_  = tp.nbStates_;
@@ -99,7 +102,6 @@ public:
   virtual ~AbstractTreeParsimonyScore()
   {
     delete tree_;
-    if (data_) delete data_;
   }
 
 private:
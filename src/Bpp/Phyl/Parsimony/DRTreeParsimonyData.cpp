@@ -44,6 +44,9 @@
 // From SeqLib:
 #include <Bpp/Seq/Container/AlignedSequenceContainer.h>
 
+// From the STL:
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
@@ -55,16 +58,11 @@ DRTreeParsimonyData::DRTreeParsimonyData(const DRTreeParsimonyData& data) :
   leafData_(data.leafData_),
   rootBitsets_(data.rootBitsets_),
   rootScores_(data.rootScores_),
-  shrunkData_(0),
+  shrunkData_(data.shrunkData_),
   nbSites_(data.nbSites_),
   nbStates_(data.nbStates_),
   nbDistinctSites_(data.nbDistinctSites_)
-{
-  if (data.shrunkData_)
-    shrunkData_ = shared_ptr<SiteContainer>(data.shrunkData_->clone());
-  else
-    shrunkData_ = shared_ptr<SiteContainer>(0);
-}
+{}
 
 /******************************************************************************/
 
@@ -75,10 +73,7 @@ DRTreeParsimonyData& DRTreeParsimonyData::operator=(const DRTreeParsimonyData& d
   leafData_        = data.leafData_;
   rootBitsets_     = data.rootBitsets_;
   rootScores_      = data.rootScores_;
-  if (data.shrunkData_)
-    shrunkData_ = shared_ptr<SiteContainer>(data.shrunkData_->clone());
-  else
-    shrunkData_ = shared_ptr<SiteContainer>(0);
+  shrunkData_      = data.shrunkData_;
   nbSites_         = data.nbSites_;
   nbStates_        = data.nbStates_;
   nbDistinctSites_ = data.nbDistinctSites_;
@@ -104,11 +99,12 @@ void DRTreeParsimonyData::init(const SiteContainer& sites, const StateMap& state
   // Init data:
   // Clone data for more efficiency on sequences access:
   const SiteContainer* sequences = new AlignedSequenceContainer(*shrunkData_);
+  resizeNodeData_();
   init(getTreeP_()->getRootNode(), *sequences, stateMap);
   delete sequences;
 
   // Now initialize root arrays:
-  rootBitsets_.resize(nbDistinctSites_);
+  rootBitsets_.resize(nbDistinctSites_, nbStates_);
   rootScores_.resize(nbDistinctSites_);
 }
 
@@ -127,32 +123,34 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
     {
       throw SequenceNotFoundException("DRTreeParsimonyData:init(node, sites). Leaf name in tree not found in site container: ", (node->getName()));
     }
-    DRTreeParsimonyLeafData* leafData    = &leafData_[node->getId()];
-    vector<Bitset>* leafData_bitsets     = &leafData->getBitsetsArray();
+    DRTreeParsimonyLeafData* leafData    = &leafData_[static_cast<size_t>(node->getId())];
+    BitsetArray* leafData_bitsets     = &leafData->getBitsetsArray();
     leafData->setNode(node);
 
-    leafData_bitsets->resize(nbDistinctSites_);
+    leafData_bitsets->resize(nbDistinctSites_, nbStates_);
 
     for (unsigned int i = 0; i < nbDistinctSites_; i++)
     {
-      Bitset* leafData_bitsets_i = &(*leafData_bitsets)[i];
+      // Leaves bitset are set to 1 if the char correspond to the site in the sequence,
+      // otherwise value set to 0:
+      int state = seq->getValue(i);
+      vector<int> states = alphabet->getAlias(state);
       for (unsigned int s = 0; s < nbStates_; s++)
       {
-        // Leaves bitset are set to 1 if the char correspond to the site in the sequence,
-        // otherwise value set to 0:
-        int state = seq->getValue(i);
-        vector<int> states = alphabet->getAlias(state);
         for (size_t j = 0; j < states.size(); j++)
         {
           if (stateMap.getAlphabetStateAsInt(s) == states[j])
-            (*leafData_bitsets_i)[s].flip();
+          {
+            leafData_bitsets->set(i, s);
+            break;
+          }
         }
       }
     }
   }
   else
   {
-    DRTreeParsimonyNodeData* nodeData = &nodeData_[node->getId()];
+    DRTreeParsimonyNodeData* nodeData = &nodeData_[static_cast<size_t>(node->getId())];
     nodeData->setNode(node);
     nodeData->eraseNeighborArrays();
 
@@ -161,10 +159,10 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
     for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
     {
       const Node* neighbor = (*node)[n];
-      vector<Bitset>* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
+      BitsetArray* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
       vector<unsigned int>* neighborData_scores  = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
 
-      neighborData_bitsets->resize(nbDistinctSites_);
+      neighborData_bitsets->resize(nbDistinctSites_, nbStates_);
       neighborData_scores->resize(nbDistinctSites_);
     }
   }
@@ -181,9 +179,21 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
 /******************************************************************************/
 void DRTreeParsimonyData::reInit()
 {
+  resizeNodeData_();
   reInit(getTreeP_()->getRootNode());
 }
 
+/******************************************************************************/
+void DRTreeParsimonyData::resizeNodeData_()
+{
+  vector<int> ids = getTreeP_()->getNodesId();
+  size_t size = static_cast<size_t>(*max_element(ids.begin(), ids.end())) + 1;
+  if (nodeData_.size() < size)
+    nodeData_.resize(size);
+  if (leafData_.size() < size)
+    leafData_.resize(size);
+}
+
 /******************************************************************************/
 void DRTreeParsimonyData::reInit(const Node* node)
 {
@@ -193,7 +203,7 @@ void DRTreeParsimonyData::reInit(const Node* node)
   }
   else
   {
-    DRTreeParsimonyNodeData* nodeData = &nodeData_[node->getId()];
+    DRTreeParsimonyNodeData* nodeData = &nodeData_[static_cast<size_t>(node->getId())];
     nodeData->setNode(node);
     nodeData->eraseNeighborArrays();
 
@@ -202,10 +212,10 @@ void DRTreeParsimonyData::reInit(const Node* node)
     for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
     {
       const Node* neighbor = (*node)[n];
-      vector<Bitset>* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
+      BitsetArray* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
       vector<unsigned int>* neighborData_scores  = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
 
-      neighborData_bitsets->resize(nbDistinctSites_);
+      neighborData_bitsets->resize(nbDistinctSites_, nbStates_);
       neighborData_scores->resize(nbDistinctSites_);
     }
   }
@@ -48,11 +48,97 @@
 #include <Bpp/Seq/Container/SiteContainer.h>
 
 // From the STL:
-#include <bitset>
+#include <cstdint>
+#include <vector>
 
 namespace bpp
 {
-typedef std::bitset<21> Bitset; // 20AA + gaps, codon not lalowed so far :s
+/**
+ * @brief Sets of states of a range of sites, in bit-sliced layout.
+ *
+ * For each state, the sites are packed 64 per word, bit i of word b
+ * telling if the state belongs to the set of site 64 b + i. The words
+ * of a state are contiguous, so that Fitch operations are performed
+ * on 64 sites at once, and vectorized by the compiler over several
+ * words. Any number of states is supported (codons included).
+ *
+ * Bits beyond the number of sites are always null.
+ */
+class BitsetArray
+{
+public:
+  typedef uint64_t Block;
+
+private:
+  size_t nbSites_;
+  size_t nbStates_;
+  size_t nbBlocks_;
+  std::vector<Block> blocks_;
+
+public:
+  BitsetArray() :
+    nbSites_(0),
+    nbStates_(0),
+    nbBlocks_(0),
+    blocks_()
+  {}
+
+  BitsetArray(size_t nbSites, size_t nbStates) :
+    nbSites_(0),
+    nbStates_(0),
+    nbBlocks_(0),
+    blocks_()
+  {
+    resize(nbSites, nbStates);
+  }
+
+public:
+  /**
+   * @brief Resize the array, all sets being reset to empty.
+   */
+  void resize(size_t nbSites, size_t nbStates)
+  {
+    nbSites_  = nbSites;
+    nbStates_ = nbStates;
+    nbBlocks_ = (nbSites + 63) / 64;
+    blocks_.assign(nbStates_ * nbBlocks_, 0);
+  }
+
+  /**
+   * @return The number of sites.
+   */
+  size_t size() const { return nbSites_; }
+
+  size_t getNumberOfStates() const { return nbStates_; }
+
+  size_t getNumberOfBlocks() const { return nbBlocks_; }
+
+  bool test(size_t site, size_t state) const
+  {
+    return (blocks_[state * nbBlocks_ + site / 64] >> (site % 64)) & 1;
+  }
+
+  void set(size_t site, size_t state)
+  {
+    blocks_[state * nbBlocks_ + site / 64] |= Block(1) << (site % 64);
+  }
+
+  /**
+   * @return The words of a state.
+   */
+  Block* getBlocks(size_t state) { return &blocks_[state * nbBlocks_]; }
+
+  const Block* getBlocks(size_t state) const { return &blocks_[state * nbBlocks_]; }
+
+  /**
+   * @return The mask of the bits of a word which correspond to sites.
+   */
+  Block getSitesMask(size_t block) const
+  {
+    size_t r = nbSites_ - 64 * block;
+    return r >= 64 ? ~Block(0) : (Block(1) << r) - 1;
+  }
+};
 
 /**
  * @brief Parsimony data structure for a node.
@@ -60,7 +146,7 @@ typedef std::bitset<21> Bitset; // 20AA + gaps, codon not lalowed so far :s
  * This class is for use with the DRTreeParsimonyData class.
  *
  * Store for each neighbor node
- * - a vector of bitsets,
+ * - an array of bitsets,
  * - a vector of score for the corresponding subtree.
  *
  * @see DRTreeParsimonyData
@@ -69,7 +155,7 @@ class DRTreeParsimonyNodeData :
   public TreeParsimonyNodeData
 {
 private:
-  mutable std::map<int, std::vector<Bitset> > nodeBitsets_;
+  mutable std::map<int, BitsetArray> nodeBitsets_;
   mutable std::map<int, std::vector<unsigned int> > nodeScores_;
   const Node* node_;
 
@@ -101,11 +187,11 @@ public:
 
   void setNode(const Node* node) { node_ = node; }
 
-  std::vector<Bitset>& getBitsetsArrayForNeighbor(int neighborId)
+  BitsetArray& getBitsetsArrayForNeighbor(int neighborId)
   {
     return nodeBitsets_[neighborId];
   }
-  const std::vector<Bitset>& getBitsetsArrayForNeighbor(int neighborId) const
+  const BitsetArray& getBitsetsArrayForNeighbor(int neighborId) const
   {
     return nodeBitsets_[neighborId];
   }
@@ -135,7 +221,7 @@ public:
  *
  * This class is for use with the DRTreeParsimonyData class.
  *
- * Store the vector of bitsets associated to a leaf.
+ * Store the array of bitsets associated to a leaf.
  *
  * @see DRTreeParsimonyData
  */
@@ -143,7 +229,7 @@ class DRTreeParsimonyLeafData :
   public TreeParsimonyNodeData
 {
 private:
-  mutable std::vector<Bitset> leafBitsets_;
+  mutable BitsetArray leafBitsets_;
   const Node* leaf_;
 
 public:
@@ -171,11 +257,11 @@ public:
   const Node* getNode() const { return leaf_; }
   void setNode(const Node* node) { leaf_ = node; }
 
-  std::vector<Bitset>& getBitsetsArray()
+  BitsetArray& getBitsetsArray()
   {
     return leafBitsets_;
   }
-  const std::vector<Bitset>& getBitsetsArray() const
+  const BitsetArray& getBitsetsArray() const
   {
     return leafBitsets_;
   }
@@ -196,9 +282,12 @@ class DRTreeParsimonyData :
   public AbstractTreeParsimonyData
 {
 private:
-  mutable std::map<int, DRTreeParsimonyNodeData> nodeData_;
-  mutable std::map<int, DRTreeParsimonyLeafData> leafData_;
-  mutable std::vector<Bitset> rootBitsets_;
+  /**
+   * @brief Node and leaf data, indexed by node id.
+   */
+  mutable std::vector<DRTreeParsimonyNodeData> nodeData_;
+  mutable std::vector<DRTreeParsimonyLeafData> leafData_;
+  mutable BitsetArray rootBitsets_;
   mutable std::vector<unsigned int> rootScores_;
   std::shared_ptr<SiteContainer> shrunkData_;
   size_t nbSites_;
@@ -239,52 +328,56 @@ public:
   void setTree(const TreeTemplate<Node>* tree)
   {
     AbstractTreeParsimonyData::setTreeP_(tree);
-    for (std::map<int, DRTreeParsimonyNodeData>::iterator it = nodeData_.begin(); it != nodeData_.end(); it++)
+    for (std::vector<DRTreeParsimonyNodeData>::iterator it = nodeData_.begin(); it != nodeData_.end(); it++)
     {
-      int id = it->second.getNode()->getId();
-      it->second.setNode(tree_->getNode(id));
+      if (!it->getNode())
+        continue;
+      int id = it->getNode()->getId();
+      it->setNode(tree_->getNode(id));
     }
-    for (std::map<int, DRTreeParsimonyLeafData>::iterator it = leafData_.begin(); it != leafData_.end(); it++)
+    for (std::vector<DRTreeParsimonyLeafData>::iterator it = leafData_.begin(); it != leafData_.end(); it++)
     {
-      int id = it->second.getNode()->getId();
-      it->second.setNode(tree_->getNode(id));
+      if (!it->getNode())
+        continue;
+      int id = it->getNode()->getId();
+      it->setNode(tree_->getNode(id));
     }
   }
 
   DRTreeParsimonyNodeData& getNodeData(int nodeId)
   {
-    return nodeData_[nodeId];
+    return nodeData_[static_cast<size_t>(nodeId)];
   }
   const DRTreeParsimonyNodeData& getNodeData(int nodeId) const
   {
-    return nodeData_[nodeId];
+    return nodeData_[static_cast<size_t>(nodeId)];
   }
 
   DRTreeParsimonyLeafData& getLeafData(int nodeId)
   {
-    return leafData_[nodeId];
+    return leafData_[static_cast<size_t>(nodeId)];
   }
   const DRTreeParsimonyLeafData& getLeafData(int nodeId) const
   {
-    return leafData_[nodeId];
+    return leafData_[static_cast<size_t>(nodeId)];
   }
 
-  std::vector<Bitset>& getBitsetsArray(int nodeId, int neighborId)
+  BitsetArray& getBitsetsArray(int nodeId, int neighborId)
   {
-    return nodeData_[nodeId].getBitsetsArrayForNeighbor(neighborId);
+    return nodeData_[static_cast<size_t>(nodeId)].getBitsetsArrayForNeighbor(neighborId);
   }
-  const std::vector<Bitset>& getBitsetsArray(int nodeId, int neighborId) const
+  const BitsetArray& getBitsetsArray(int nodeId, int neighborId) const
   {
-    return nodeData_[nodeId].getBitsetsArrayForNeighbor(neighborId);
+    return nodeData_[static_cast<size_t>(nodeId)].getBitsetsArrayForNeighbor(neighborId);
   }
 
   std::vector<unsigned int>& getScoresArray(int nodeId, int neighborId)
   {
-    return nodeData_[nodeId].getScoresArrayForNeighbor(neighborId);
+    return nodeData_[static_cast<size_t>(nodeId)].getScoresArrayForNeighbor(neighborId);
   }
   const std::vector<unsigned int>& getScoresArray(int nodeId, int neighborId) const
   {
-    return nodeData_[nodeId].getScoresArrayForNeighbor(neighborId);
+    return nodeData_[static_cast<size_t>(nodeId)].getScoresArrayForNeighbor(neighborId);
   }
 
   size_t getArrayPosition(int parentId, int sonId, size_t currentPosition) const
@@ -292,9 +385,8 @@ public:
     return currentPosition;
   }
 
-  std::vector<Bitset>& getRootBitsets() { return rootBitsets_; }
-  const std::vector<Bitset>& getRootBitsets() const { return rootBitsets_; }
-  const Bitset& getRootBitset(size_t i) const { return rootBitsets_[i]; }
+  BitsetArray& getRootBitsets() { return rootBitsets_; }
+  const BitsetArray& getRootBitsets() const { return rootBitsets_; }
 
   std::vector<unsigned int>& getRootScores() { return rootScores_; }
   const std::vector<unsigned int>& getRootScores() const { return rootScores_; }
@@ -310,6 +402,11 @@ public:
 protected:
   void init(const Node* node, const SiteContainer& sites, const StateMap& stateMap);
   void reInit(const Node* node);
+
+  /**
+   * @brief Resize the node and leaf data so that they can be indexed by any node id of the tree.
+   */
+  void resizeNodeData_();
 };
 } // end of namespace bpp.
 
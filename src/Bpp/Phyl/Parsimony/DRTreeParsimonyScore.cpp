@@ -40,15 +40,42 @@
 #include "DRTreeParsimonyScore.h"
 #include "../PatternTools.h"
 #include "../Tree/TreeTemplateTools.h" // Needed for NNIs
+#include "../Tree/FlatTopology.h"
 
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/VectorTools.h>
 
+// From the STL:
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
 /******************************************************************************/
 
+namespace
+{
+  /**
+   * @brief Index of the lowest bit set in a non-null word.
+   */
+  inline size_t countTrailingZeros(BitsetArray::Block m)
+  {
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_ctzll(m));
+#else
+    size_t n = 0;
+    while (!(m & 1))
+    {
+      m >>= 1;
+      n++;
+    }
+    return n;
+#endif
+  }
+}
+
+/******************************************************************************/
+
 DRTreeParsimonyScore::DRTreeParsimonyScore(
   const Tree& tree,
   const SiteContainer& data,
@@ -56,7 +83,8 @@ DRTreeParsimonyScore::DRTreeParsimonyScore(
   bool includeGaps) :
   AbstractTreeParsimonyScore(tree, data, verbose, includeGaps),
   parsimonyData_(new DRTreeParsimonyData(getTreeP_())),
-  nbDistinctSites_()
+  nbDistinctSites_(),
+  score_(0)
 {
   init_(data, verbose);
 }
@@ -68,7 +96,8 @@ DRTreeParsimonyScore::DRTreeParsimonyScore(
   bool verbose) :
   AbstractTreeParsimonyScore(tree, data, statesMap, verbose),
   parsimonyData_(new DRTreeParsimonyData(getTreeP_())),
-  nbDistinctSites_()
+  nbDistinctSites_(),
+  score_(0)
 {
   init_(data, verbose);
 }
@@ -92,7 +121,8 @@ void DRTreeParsimonyScore::init_(const SiteContainer& data, bool verbose)
 DRTreeParsimonyScore::DRTreeParsimonyScore(const DRTreeParsimonyScore& tp) :
   AbstractTreeParsimonyScore(tp),
   parsimonyData_(dynamic_cast<DRTreeParsimonyData*>(tp.parsimonyData_->clone())),
-  nbDistinctSites_(tp.nbDistinctSites_)
+  nbDistinctSites_(tp.nbDistinctSites_),
+  score_(tp.score_)
 {
   parsimonyData_->setTree(getTreeP_());
 }
@@ -105,6 +135,7 @@ DRTreeParsimonyScore& DRTreeParsimonyScore::operator=(const DRTreeParsimonyScore
   parsimonyData_ = dynamic_cast<DRTreeParsimonyData*>(tp.parsimonyData_->clone());
   parsimonyData_->setTree(getTreeP_());
   nbDistinctSites_ = tp.nbDistinctSites_;
+  score_ = tp.score_;
   return *this;
 }
 
@@ -118,12 +149,62 @@ DRTreeParsimonyScore::~DRTreeParsimonyScore()
 /******************************************************************************/
 void DRTreeParsimonyScore::computeScores()
 {
-  computeScoresPostorder(getTreeP_()->getRootNode());
-  computeScoresPreorder(getTreeP_()->getRootNode());
+  //Same recursions as computeScoresPostorder and computeScoresPreorder, as loops over a flat snapshot of the topology:
+  FlatTopology topology(getTree());
+
+  const vector<size_t>& postorder = topology.getPostorder();
+  for (size_t p = 0; p < postorder.size(); p++)
+  {
+    size_t node = postorder[p];
+    if (topology.isLeaf(node)) continue;
+    DRTreeParsimonyNodeData* pData = &parsimonyData_->getNodeData(topology.getNodeId(node));
+    for (size_t k = 0; k < topology.getNumberOfSons(node); k++)
+    {
+      size_t son = topology.getSon(node, k);
+      int sonId = topology.getNodeId(son);
+      BitsetArray* bitsets      = &pData->getBitsetsArrayForNeighbor(sonId);
+      vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(sonId);
+      if (topology.isLeaf(son))
+      {
+        *bitsets = parsimonyData_->getLeafData(sonId).getBitsetsArray();
+        scores->assign(bitsets->size(), 0);
+      }
+      else
+      {
+        computeScoresPostorderForNode(parsimonyData_->getNodeData(sonId), *bitsets, *scores);
+      }
+    }
+  }
+
+  //Preorder is the index order of the snapshot:
+  for (size_t node = 1; node < topology.getNumberOfNodes(); node++)
+  {
+    if (topology.isLeaf(node)) continue;
+    DRTreeParsimonyNodeData* pData = &parsimonyData_->getNodeData(topology.getNodeId(node));
+    size_t father = topology.getFather(node);
+    int fatherId = topology.getNodeId(father);
+    BitsetArray* bitsets      = &pData->getBitsetsArrayForNeighbor(fatherId);
+    vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(fatherId);
+    if (topology.isLeaf(father))
+    { // Tree rooted by a leaf.
+      *bitsets = parsimonyData_->getLeafData(fatherId).getBitsetsArray();
+      scores->assign(bitsets->size(), 0);
+    }
+    else
+    {
+      computeScoresPreorderForNode(parsimonyData_->getNodeData(fatherId), pData->getNode(), *bitsets, *scores);
+    }
+  }
+
   computeScoresForNode(
     parsimonyData_->getNodeData(getTree().getRootId()),
     parsimonyData_->getRootBitsets(),
     parsimonyData_->getRootScores());
+  score_ = 0;
+  for (size_t i = 0; i < nbDistinctSites_; i++)
+  {
+    score_ += parsimonyData_->getRootScore(i) * parsimonyData_->getWeight(i);
+  }
 }
 
 void DRTreeParsimonyScore::computeScoresPostorder(const Node* node)
@@ -134,15 +215,15 @@ void DRTreeParsimonyScore::computeScoresPostorder(const Node* node)
   {
     const Node* son = node->getSon(k);
     computeScoresPostorder(son);
-    vector<Bitset>* bitsets      = &pData->getBitsetsArrayForNeighbor(son->getId());
+    BitsetArray* bitsets      = &pData->getBitsetsArrayForNeighbor(son->getId());
     vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(son->getId());
     if (son->isLeaf())
     {
       // son has no NodeData associated, must use LeafData instead
-      vector<Bitset>* sonBitsets = &parsimonyData_->getLeafData(son->getId()).getBitsetsArray();
+      BitsetArray* sonBitsets = &parsimonyData_->getLeafData(son->getId()).getBitsetsArray();
+      *bitsets = *sonBitsets;
       for (unsigned int i = 0; i < sonBitsets->size(); i++)
       {
-        (*bitsets)[i] = (*sonBitsets)[i];
         (*scores)[i]  = 0;
       }
     }
@@ -156,14 +237,14 @@ void DRTreeParsimonyScore::computeScoresPostorder(const Node* node)
   }
 }
 
-void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNodeData& pData, vector<Bitset>& rBitsets, vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNodeData& pData, BitsetArray& rBitsets, vector<unsigned int>& rScores)
 {
   // First initialize the vectors from input:
   const Node* node = pData.getNode();
   const Node* source = node->getFather();
   vector<const Node*> neighbors = node->getNeighbors();
   size_t nbNeighbors = node->degree();
-  vector< const vector<Bitset>*> iBitsets;
+  vector< const BitsetArray*> iBitsets;
   vector< const vector<unsigned int>*> iScores;
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
@@ -185,15 +266,15 @@ void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    vector<Bitset>* bitsets      = &pData->getBitsetsArrayForNeighbor(father->getId());
+    BitsetArray* bitsets      = &pData->getBitsetsArrayForNeighbor(father->getId());
     vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(father->getId());
     if (father->isLeaf())
     { // Means that the tree is rooted by a leaf... dunno if we must allow that! Let it be for now.
       // son has no NodeData associated, must use LeafData instead
-      vector<Bitset>* sonBitsets = &parsimonyData_->getLeafData(father->getId()).getBitsetsArray();
+      BitsetArray* sonBitsets = &parsimonyData_->getLeafData(father->getId()).getBitsetsArray();
+      *bitsets = *sonBitsets;
       for (unsigned int i = 0; i < sonBitsets->size(); i++)
       {
-        (*bitsets)[i] = (*sonBitsets)[i];
         (*scores)[i]  = 0;
       }
     }
@@ -213,13 +294,13 @@ void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
   }
 }
 
-void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNodeData& pData, const Node* source, std::vector<Bitset>& rBitsets, std::vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNodeData& pData, const Node* source, BitsetArray& rBitsets, std::vector<unsigned int>& rScores)
 {
   // First initialize the vectors from input:
   const Node* node = pData.getNode();
   vector<const Node*> neighbors = node->getNeighbors();
   size_t nbNeighbors = node->degree();
-  vector< const vector<Bitset>*> iBitsets;
+  vector< const BitsetArray*> iBitsets;
   vector< const vector<unsigned int>*> iScores;
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
@@ -234,13 +315,13 @@ void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNod
   computeScoresFromArrays(iBitsets, iScores, rBitsets, rScores);
 }
 
-void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& pData, std::vector<Bitset>& rBitsets, std::vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& pData, BitsetArray& rBitsets, std::vector<unsigned int>& rScores)
 {
   const Node* node = pData.getNode();
   size_t nbNeighbors = node->degree();
   vector<const Node*> neighbors = node->getNeighbors();
   // First initialize the vectors fro input:
-  vector< const vector<Bitset>*> iBitsets(nbNeighbors);
+  vector< const BitsetArray*> iBitsets(nbNeighbors);
   vector< const vector<unsigned int>*> iScores(nbNeighbors);
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
@@ -255,12 +336,7 @@ void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& p
 /******************************************************************************/
 unsigned int DRTreeParsimonyScore::getScore() const
 {
-  unsigned int score = 0;
-  for (unsigned int i = 0; i < nbDistinctSites_; i++)
-  {
-    score += parsimonyData_->getRootScore(i) * parsimonyData_->getWeight(i);
-  }
-  return score;
+  return score_;
 }
 
 /******************************************************************************/
@@ -271,38 +347,83 @@ unsigned int DRTreeParsimonyScore::getScoreForSite(size_t site) const
 
 /******************************************************************************/
 void DRTreeParsimonyScore::computeScoresFromArrays(
-  const vector< const vector<Bitset>*>& iBitsets,
+  const vector< const BitsetArray*>& iBitsets,
   const vector< const vector<unsigned int>*>& iScores,
-  vector<Bitset>& oBitsets,
+  BitsetArray& oBitsets,
   vector<unsigned int>& oScores)
 {
-  size_t nbPos  = oBitsets.size();
+  if (iBitsets.size() < 1)
+    throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have a size >= 1.");
+  oBitsets.resize(iBitsets[0]->size(), iBitsets[0]->getNumberOfStates());
+  computeScoresFromArrays(iBitsets, iScores, oBitsets, oScores, 0, oBitsets.getNumberOfBlocks());
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::computeScoresFromArrays(
+  const vector< const BitsetArray*>& iBitsets,
+  const vector< const vector<unsigned int>*>& iScores,
+  BitsetArray& oBitsets,
+  vector<unsigned int>& oScores,
+  size_t firstBlock,
+  size_t lastBlock)
+{
   size_t nbNodes = iBitsets.size();
   if (iScores.size() != nbNodes)
     throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have the same length.");
   if (nbNodes < 1)
     throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have a size >= 1.");
-  const vector<Bitset>* bitsets0 = iBitsets[0];
+  size_t nbStates = oBitsets.getNumberOfStates();
+  size_t firstPos = 64 * firstBlock;
+  size_t lastPos  = std::min(64 * lastBlock, oBitsets.size());
+
+  const BitsetArray* bitsets0 = iBitsets[0];
+  for (size_t s = 0; s < nbStates; s++)
+  {
+    std::copy(bitsets0->getBlocks(s) + firstBlock, bitsets0->getBlocks(s) + lastBlock, oBitsets.getBlocks(s) + firstBlock);
+  }
   const vector<unsigned int>* scores0 = iScores[0];
-  for (size_t i = 0; i < nbPos; i++)
+  for (size_t i = firstPos; i < lastPos; i++)
   {
-    oBitsets[i] = (*bitsets0)[i];
     oScores[i]  = (*scores0)[i];
   }
+
+  vector<BitsetArray::Block> empty(lastBlock - firstBlock);
   for (size_t k = 1; k < nbNodes; k++)
   {
-    const vector<Bitset>* bitsetsk = iBitsets[k];
+    const BitsetArray* bitsetsk = iBitsets[k];
     const vector<unsigned int>* scoresk = iScores[k];
-    for (unsigned int i = 0; i < nbPos; i++)
+    for (size_t i = firstPos; i < lastPos; i++)
     {
-      Bitset bs = oBitsets[i] & (*bitsetsk)[i];
       oScores[i] += (*scoresk)[i];
-      if (bs == 0)
+    }
+
+    // Sites with empty intersections:
+    std::fill(empty.begin(), empty.end(), ~BitsetArray::Block(0));
+    for (size_t s = 0; s < nbStates; s++)
+    {
+      const BitsetArray::Block* o = oBitsets.getBlocks(s) + firstBlock;
+      const BitsetArray::Block* b = bitsetsk->getBlocks(s) + firstBlock;
+      for (size_t j = 0; j < empty.size(); j++)
+        empty[j] &= ~(o[j] & b[j]);
+    }
+
+    // Intersection, or union if it is empty:
+    for (size_t s = 0; s < nbStates; s++)
+    {
+      BitsetArray::Block* o = oBitsets.getBlocks(s) + firstBlock;
+      const BitsetArray::Block* b = bitsetsk->getBlocks(s) + firstBlock;
+      for (size_t j = 0; j < empty.size(); j++)
+        o[j] = (o[j] & b[j]) | (empty[j] & (o[j] | b[j]));
+    }
+
+    for (size_t j = firstBlock; j < lastBlock; j++)
+    {
+      BitsetArray::Block m = empty[j - firstBlock] & oBitsets.getSitesMask(j);
+      while (m)
       {
-        bs = oBitsets[i] | (*bitsetsk)[i];
-        oScores[i] += 1;
+        oScores[64 * j + countTrailingZeros(m)] += 1;
+        m &= m - 1;
       }
-      oBitsets[i] = bs;
     }
   }
 }
@@ -323,11 +444,11 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const
 
   // Retrieving arrays of interest:
   const DRTreeParsimonyNodeData* parentData = &parsimonyData_->getNodeData(parent->getId());
-  const vector<Bitset>* sonBitsets = &parentData->getBitsetsArrayForNeighbor(son->getId());
+  const BitsetArray* sonBitsets = &parentData->getBitsetsArrayForNeighbor(son->getId());
   const vector<unsigned int>* sonScores  = &parentData->getScoresArrayForNeighbor(son->getId());
   vector<const Node*> parentNeighbors = TreeTemplateTools::getRemainingNeighbors(parent, grandFather, son);
   size_t nbParentNeighbors = parentNeighbors.size();
-  vector< const vector<Bitset>*> parentBitsets(nbParentNeighbors);
+  vector< const BitsetArray*> parentBitsets(nbParentNeighbors);
   vector< const vector<unsigned int>*> parentScores(nbParentNeighbors);
   for (unsigned int k = 0; k < nbParentNeighbors; k++)
   {
@@ -337,11 +458,11 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const
   }
 
   const DRTreeParsimonyNodeData* grandFatherData = &parsimonyData_->getNodeData(grandFather->getId());
-  const vector<Bitset>* uncleBitsets = &grandFatherData->getBitsetsArrayForNeighbor(uncle->getId());
+  const BitsetArray* uncleBitsets = &grandFatherData->getBitsetsArrayForNeighbor(uncle->getId());
   const vector<unsigned int>* uncleScores  = &grandFatherData->getScoresArrayForNeighbor(uncle->getId());
   vector<const Node*> grandFatherNeighbors = TreeTemplateTools::getRemainingNeighbors(grandFather, parent, uncle);
   size_t nbGrandFatherNeighbors = grandFatherNeighbors.size();
-  vector< const vector<Bitset>*> grandFatherBitsets(nbGrandFatherNeighbors);
+  vector< const BitsetArray*> grandFatherBitsets(nbGrandFatherNeighbors);
   vector< const vector<unsigned int>*> grandFatherScores(nbGrandFatherNeighbors);
   for (unsigned int k = 0; k < nbGrandFatherNeighbors; k++)
   {
@@ -354,10 +475,8 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const
   grandFatherBitsets.push_back(sonBitsets);
   grandFatherScores.push_back(sonScores);
   // Init arrays:
-  vector<Bitset> gfBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
+  BitsetArray gfBitsets(sonBitsets->size(), sonBitsets->getNumberOfStates()); // All arrays supposed to have the same size!
   vector<unsigned int> gfScores(sonScores->size());
-  // Fill arrays:
-  computeScoresFromArrays(grandFatherBitsets, grandFatherScores, gfBitsets, gfScores);
 
   // Now computes arrays and scores for parent node:
   parentBitsets.push_back(uncleBitsets);
@@ -365,18 +484,28 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const
   parentBitsets.push_back(&gfBitsets);
   parentScores.push_back(&gfScores);
   // Init arrays:
-  vector<Bitset> pBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
+  BitsetArray pBitsets(sonBitsets->size(), sonBitsets->getNumberOfStates()); // All arrays supposed to have the same size!
   vector<unsigned int> pScores(sonScores->size());
-  // Fill arrays:
-  computeScoresFromArrays(parentBitsets, parentScores, pBitsets, pScores);
 
-  // Final computation:
+  // Both nodes are computed chunk by chunk, so that the evaluation can
+  // stop as soon as the partial score shows the move does not improve:
+  unsigned int currentScore = score_;
   unsigned int score = 0;
-  for (unsigned int i = 0; i < nbDistinctSites_; i++)
+  size_t nbBlocks = pBitsets.getNumberOfBlocks();
+  for (size_t first = 0; first < nbBlocks; first += NNI_CHUNK_SIZE)
   {
-    score += pScores[i] * parsimonyData_->getWeight(i);
+    size_t last = std::min(first + NNI_CHUNK_SIZE, nbBlocks);
+    computeScoresFromArrays(grandFatherBitsets, grandFatherScores, gfBitsets, gfScores, first, last);
+    computeScoresFromArrays(parentBitsets, parentScores, pBitsets, pScores, first, last);
+    size_t lastPos = std::min(64 * last, nbDistinctSites_);
+    for (size_t i = 64 * first; i < lastPos; i++)
+    {
+      score += pScores[i] * parsimonyData_->getWeight(i);
+    }
+    if (score >= currentScore)
+      return (double)score - (double)currentScore;
   }
-  return (double)score - (double)getScore();
+  return (double)score - (double)currentScore;
 }
 
 /******************************************************************************/
@@ -400,4 +529,88 @@ void DRTreeParsimonyScore::doNNI(int nodeId)
 }
 
 /******************************************************************************/
+double DRTreeParsimonyScore::testSPR(int nodeId, int targetId) const
+{
+  const Node* son = getTreeP_()->getNode(nodeId);
+  const Node* target = getTreeP_()->getNode(targetId);
+  // The path from the pruning point (path[0]) to the regrafting branch (last two nodes):
+  vector<const Node*> path = TreeTemplateTools::getRegraftingPath(son, target);
+  size_t nbSteps = path.size() - 2;
+  const Node* parent = path[0];
+  const Node* brother = TreeTemplateTools::getRemainingNeighbors(parent, son, path[1])[0];
+
+  // Arrays of the pruned tree along the path, each one computed from the previous one
+  // and from the cached arrays of the other neighbors:
+  size_t nbSites = parsimonyData_->getNodeData(parent->getId()).getScoresArrayForNeighbor(son->getId()).size();
+  size_t nbStates = parsimonyData_->getNodeData(parent->getId()).getBitsetsArrayForNeighbor(son->getId()).getNumberOfStates();
+  vector<BitsetArray> stepBitsets(nbSteps, BitsetArray(nbSites, nbStates));
+  vector< vector<unsigned int> > stepScores(nbSteps, vector<unsigned int>(nbSites));
+  vector< vector<const BitsetArray*> > stepInputBitsets(nbSteps);
+  vector< vector<const vector<unsigned int>*> > stepInputScores(nbSteps);
+  for (size_t i = 0; i < nbSteps; i++)
+  {
+    const Node* node = path[i + 1];
+    if (i == 0)
+    {
+      const DRTreeParsimonyNodeData* parentData = &parsimonyData_->getNodeData(parent->getId());
+      stepInputBitsets[i].push_back(&parentData->getBitsetsArrayForNeighbor(brother->getId()));
+      stepInputScores[i].push_back(&parentData->getScoresArrayForNeighbor(brother->getId()));
+    }
+    else
+    {
+      stepInputBitsets[i].push_back(&stepBitsets[i - 1]);
+      stepInputScores[i].push_back(&stepScores[i - 1]);
+    }
+    const DRTreeParsimonyNodeData* nodeData = &parsimonyData_->getNodeData(node->getId());
+    vector<const Node*> neighbors = TreeTemplateTools::getRemainingNeighbors(node, path[i], path[i + 2]);
+    for (size_t k = 0; k < neighbors.size(); k++)
+    {
+      stepInputBitsets[i].push_back(&nodeData->getBitsetsArrayForNeighbor(neighbors[k]->getId()));
+      stepInputScores[i].push_back(&nodeData->getScoresArrayForNeighbor(neighbors[k]->getId()));
+    }
+  }
+
+  // The regrafted node joins the pruned subtree and both sides of the target branch:
+  const DRTreeParsimonyNodeData* parentData = &parsimonyData_->getNodeData(parent->getId());
+  const DRTreeParsimonyNodeData* endData = &parsimonyData_->getNodeData(path[nbSteps]->getId());
+  vector<const BitsetArray*> rBitsets;
+  vector<const vector<unsigned int>*> rScores;
+  rBitsets.push_back(&parentData->getBitsetsArrayForNeighbor(son->getId()));
+  rScores.push_back(&parentData->getScoresArrayForNeighbor(son->getId()));
+  rBitsets.push_back(&stepBitsets[nbSteps - 1]);
+  rScores.push_back(&stepScores[nbSteps - 1]);
+  rBitsets.push_back(&endData->getBitsetsArrayForNeighbor(path[nbSteps + 1]->getId()));
+  rScores.push_back(&endData->getScoresArrayForNeighbor(path[nbSteps + 1]->getId()));
+  BitsetArray pBitsets(nbSites, nbStates);
+  vector<unsigned int> pScores(nbSites);
+
+  unsigned int currentScore = score_;
+  unsigned int score = 0;
+  size_t nbBlocks = pBitsets.getNumberOfBlocks();
+  for (size_t first = 0; first < nbBlocks; first += NNI_CHUNK_SIZE)
+  {
+    size_t last = std::min(first + NNI_CHUNK_SIZE, nbBlocks);
+    for (size_t i = 0; i < nbSteps; i++)
+    {
+      computeScoresFromArrays(stepInputBitsets[i], stepInputScores[i], stepBitsets[i], stepScores[i], first, last);
+    }
+    computeScoresFromArrays(rBitsets, rScores, pBitsets, pScores, first, last);
+    size_t lastPos = std::min(64 * last, nbDistinctSites_);
+    for (size_t i = 64 * first; i < lastPos; i++)
+    {
+      score += pScores[i] * parsimonyData_->getWeight(i);
+    }
+    if (score >= currentScore)
+      return (double)score - (double)currentScore;
+  }
+  return (double)score - (double)currentScore;
+}
+
+/******************************************************************************/
+void DRTreeParsimonyScore::doSPR(int nodeId, int targetId)
+{
+  TreeTemplateTools::pruneAndRegraft(getTreeP_()->getNode(nodeId), getTreeP_()->getNode(targetId));
+}
+
+/******************************************************************************/
 
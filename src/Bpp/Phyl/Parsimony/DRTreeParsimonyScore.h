@@ -42,7 +42,7 @@
 
 #include "AbstractTreeParsimonyScore.h"
 #include "DRTreeParsimonyData.h"
-#include "../Tree/NNISearchable.h"
+#include "../Tree/SPRSearchable.h"
 #include "../Tree/TreeTools.h"
 
 namespace bpp
@@ -54,11 +54,18 @@ namespace bpp
  */
 class DRTreeParsimonyScore :
   public AbstractTreeParsimonyScore,
-  public virtual NNISearchable
+  public virtual SPRSearchable
 {
 private:
   DRTreeParsimonyData* parsimonyData_;
   size_t nbDistinctSites_;
+  unsigned int score_;
+
+  /**
+   * @brief Number of 64-site blocks evaluated by testNNI before the
+   * partial score is compared to the current one.
+   */
+  static const size_t NNI_CHUNK_SIZE = 16;
 
 public:
   DRTreeParsimonyScore(
@@ -88,7 +95,8 @@ protected:
   /**
    * @brief Compute all scores.
    *
-   * Call the computeScoresPreorder and computeScoresPostorder methods, and then initialize rootBitsets_ and rootScores_.
+   * Perform the same recursions as the computeScoresPostorder and computeScoresPreorder methods,
+   * as loops over a FlatTopology snapshot of the tree, and then initialize rootBitsets_ and rootScores_.
    */
   virtual void computeScores();
   /**
@@ -113,7 +121,7 @@ public:
    */
   static void computeScoresPostorderForNode(
     const DRTreeParsimonyNodeData& pData,
-    std::vector<Bitset>& rBitsets,
+    BitsetArray& rBitsets,
     std::vector<unsigned int>& rScores);
 
   /**
@@ -127,7 +135,7 @@ public:
   static void computeScoresPreorderForNode(
     const DRTreeParsimonyNodeData& pData,
     const Node* source,
-    std::vector<Bitset>& rBitsets,
+    BitsetArray& rBitsets,
     std::vector<unsigned int>& rScores);
 
   /**
@@ -138,7 +146,7 @@ public:
    * @param rScores  The score array where to write the resulting scores.
    */
   static void computeScoresForNode(
-    const DRTreeParsimonyNodeData& pData, std::vector<Bitset>& rBitsets,
+    const DRTreeParsimonyNodeData& pData, BitsetArray& rBitsets,
     std::vector<unsigned int>& rScores);
 
   /**
@@ -148,28 +156,75 @@ public:
    * Depending on what is passed as input, it may computes scroes fo a subtree
    * or the whole tree.
    *
+   * The Fitch step is performed on whole words of sites (see
+   * BitsetArray): intersections and unions are computed for 64 sites
+   * at once, and the sites with empty intersections are then read from
+   * a mask.
+   *
    * @param iBitsets The vector of bitset arrays to use.
    * @param iScores  The vector of score arrays to use.
    * @param oBitsets The bitset array where to store the resulting bitsets.
    * @param oScores  The score array where to write the resulting scores.
    */
   static void computeScoresFromArrays(
-    const std::vector<const std::vector<Bitset>*>& iBitsets,
+    const std::vector<const BitsetArray*>& iBitsets,
     const std::vector<const std::vector<unsigned int>*>& iScores,
-    std::vector<Bitset>& oBitsets,
+    BitsetArray& oBitsets,
     std::vector<unsigned int>& oScores);
 
   /**
-   * @name Thee NNISearchable interface.
+   * @brief Compute bitsets and scores from an array of arrays, for a range of sites only.
+   *
+   * Same as the whole-array version, restricted to the 64-site blocks
+   * [firstBlock, lastBlock). The output arrays must already have the
+   * correct size, and other blocks are left unchanged.
+   *
+   * @param iBitsets   The vector of bitset arrays to use.
+   * @param iScores    The vector of score arrays to use.
+   * @param oBitsets   The bitset array where to store the resulting bitsets.
+   * @param oScores    The score array where to write the resulting scores.
+   * @param firstBlock The first block of sites to compute.
+   * @param lastBlock  The block after the last one to compute.
+   */
+  static void computeScoresFromArrays(
+    const std::vector<const BitsetArray*>& iBitsets,
+    const std::vector<const std::vector<unsigned int>*>& iScores,
+    BitsetArray& oBitsets,
+    std::vector<unsigned int>& oScores,
+    size_t firstBlock,
+    size_t lastBlock);
+
+  /**
+   * @name Thee NNISearchable and SPRSearchable interfaces.
    *
    * @{
    */
   double getTopologyValue() const { return getScore(); }
 
+  /**
+   * @brief Score difference of a NNI, computed from the cached directional arrays.
+   *
+   * Only the two nodes around the tested branch are recomputed, and the
+   * sites are processed by chunks. As soon as the partial score reaches the
+   * current one, the move cannot improve the tree and the evaluation stops:
+   * in that case the returned value is a non-negative lower bound of the
+   * difference, not its exact value. Improving moves get their exact
+   * (negative) difference.
+   */
   double testNNI(int nodeId) const;
 
   void doNNI(int nodeId);
 
+  /**
+   * @brief Score difference of a SPR, computed from the cached directional arrays.
+   *
+   * Only the nodes on the path between the pruning point and the regrafting branch
+   * are recomputed, with the same chunked evaluation and early exit as testNNI.
+   */
+  double testSPR(int nodeId, int targetId) const;
+
+  void doSPR(int nodeId, int targetId);
+
   // Tree& getTopology() { return getTree(); } do we realy need this one?
   const Tree& getTopology() const { return getTree(); }
 
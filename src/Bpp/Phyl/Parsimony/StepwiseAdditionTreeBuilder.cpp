@@ -0,0 +1,479 @@
+//
+// File: StepwiseAdditionTreeBuilder.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "StepwiseAdditionTreeBuilder.h"
+#include "../PatternTools.h"
+#include "../SiteLoopExecutor.h"
+
+#include <Bpp/Seq/Container/AlignedSequenceContainer.h>
+
+// From the STL:
+#include <algorithm>
+#include <limits>
+#include <random>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+namespace
+{
+  /**
+   * @brief Index of the lowest bit set in a non-null word.
+   */
+  inline size_t countTrailingZeros(BitsetArray::Block m)
+  {
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_ctzll(m));
+#else
+    size_t n = 0;
+    while (!(m & 1))
+    {
+      m >>= 1;
+      n++;
+    }
+    return n;
+#endif
+  }
+
+  /**
+   * @brief Mask of the sites where two arrays have an empty intersection.
+   */
+  inline BitsetArray::Block emptyIntersections(const BitsetArray& a, const BitsetArray& b, size_t block)
+  {
+    BitsetArray::Block empty = ~BitsetArray::Block(0);
+    for (size_t s = 0; s < a.getNumberOfStates(); s++)
+      empty &= ~(a.getBlocks(s)[block] & b.getBlocks(s)[block]);
+    return empty & a.getSitesMask(block);
+  }
+
+  /**
+   * @brief Fitch set of two arrays: their intersection, or their union where it is empty.
+   */
+  void fitch(const BitsetArray& a, const BitsetArray& b, BitsetArray& o)
+  {
+    o.resize(a.size(), a.getNumberOfStates());
+    for (size_t j = 0; j < a.getNumberOfBlocks(); j++)
+    {
+      BitsetArray::Block empty = emptyIntersections(a, b, j);
+      for (size_t s = 0; s < a.getNumberOfStates(); s++)
+      {
+        BitsetArray::Block x = a.getBlocks(s)[j];
+        BitsetArray::Block y = b.getBlocks(s)[j];
+        o.getBlocks(s)[j] = (x & y) | (empty & (x | y));
+      }
+    }
+  }
+
+  /**
+   * @brief Weighted number of sites where two arrays have an empty intersection.
+   */
+  unsigned int countEmptyIntersections(const BitsetArray& a, const BitsetArray& b, const vector<unsigned int>& weights)
+  {
+    unsigned int count = 0;
+    for (size_t j = 0; j < a.getNumberOfBlocks(); j++)
+    {
+      BitsetArray::Block m = emptyIntersections(a, b, j);
+      while (m)
+      {
+        count += weights[64 * j + countTrailingZeros(m)];
+        m &= m - 1;
+      }
+    }
+    return count;
+  }
+
+  /**
+   * @brief The unrooted tree being built.
+   *
+   * Leaves have one neighbor and internal nodes three. For each node u
+   * and each of its neighbors v, sets[u][k] is the Fitch set of the
+   * subtree containing u when the branch to v = neighbors[u][k] is removed.
+   */
+  struct AdditionTree
+  {
+    static const size_t NONE = static_cast<size_t>(-1);
+
+    vector< vector<size_t> > neighbors;
+    vector<size_t> sequences; // NONE for internal nodes.
+    vector< vector<BitsetArray> > sets;
+
+    AdditionTree() : neighbors(), sequences(), sets() {}
+
+    size_t addNode(size_t sequence)
+    {
+      neighbors.push_back(vector<size_t>());
+      sequences.push_back(sequence);
+      sets.push_back(vector<BitsetArray>());
+      return neighbors.size() - 1;
+    }
+
+    size_t indexOf(size_t u, size_t v) const
+    {
+      return static_cast<size_t>(find(neighbors[u].begin(), neighbors[u].end(), v) - neighbors[u].begin());
+    }
+
+    /**
+     * @brief Nodes in preorder from node 0, with their father.
+     */
+    void getPreorder(vector<size_t>& nodes, vector<size_t>& fathers) const
+    {
+      nodes.clear();
+      fathers.assign(neighbors.size(), NONE);
+      vector<size_t> stack(1, 0);
+      while (!stack.empty())
+      {
+        size_t u = stack.back();
+        stack.pop_back();
+        nodes.push_back(u);
+        for (size_t v : neighbors[u])
+        {
+          if (v != fathers[u])
+          {
+            fathers[v] = u;
+            stack.push_back(v);
+          }
+        }
+      }
+    }
+
+    /**
+     * @brief Compute all sets, with one postorder and one preorder traversal.
+     */
+    void updateSets(const vector<BitsetArray>& leafBitsets)
+    {
+      vector<size_t> nodes, fathers;
+      getPreorder(nodes, fathers);
+      for (size_t u = 0; u < neighbors.size(); u++)
+        sets[u].resize(neighbors[u].size());
+
+      // Sets towards node 0:
+      for (size_t i = nodes.size(); i > 1; i--)
+      {
+        size_t u = nodes[i - 1];
+        size_t k = indexOf(u, fathers[u]);
+        if (sequences[u] != NONE)
+          sets[u][k] = leafBitsets[sequences[u]];
+        else
+        {
+          const BitsetArray* sons[2];
+          size_t n = 0;
+          for (size_t v : neighbors[u])
+            if (v != fathers[u])
+              sons[n++] = &sets[v][indexOf(v, u)];
+          fitch(*sons[0], *sons[1], sets[u][k]);
+        }
+      }
+
+      // Sets away from node 0:
+      sets[0][0] = leafBitsets[sequences[0]];
+      for (size_t i = 1; i < nodes.size(); i++)
+      {
+        size_t u = nodes[i];
+        if (sequences[u] != NONE)
+          continue;
+        for (size_t k = 0; k < 3; k++)
+        {
+          const BitsetArray* others[2];
+          size_t n = 0;
+          for (size_t l = 0; l < 3; l++)
+          {
+            if (l != k)
+            {
+              size_t v = neighbors[u][l];
+              others[n++] = &sets[v][indexOf(v, u)];
+            }
+          }
+          if (neighbors[u][k] != fathers[u])
+            fitch(*others[0], *others[1], sets[u][k]);
+        }
+      }
+    }
+
+    /**
+     * @brief Insert a new leaf on the branch between u and its k-th neighbor.
+     */
+    void insert(size_t u, size_t k, size_t sequence)
+    {
+      size_t v = neighbors[u][k];
+      size_t w = addNode(NONE);
+      size_t l = addNode(sequence);
+      neighbors[u][k] = w;
+      neighbors[v][indexOf(v, u)] = w;
+      neighbors[w].push_back(u);
+      neighbors[w].push_back(v);
+      neighbors[w].push_back(l);
+      neighbors[l].push_back(w);
+    }
+  };
+
+  const size_t AdditionTree::NONE;
+}
+
+/******************************************************************************/
+
+StepwiseAdditionTreeBuilder::StepwiseAdditionTreeBuilder(const SiteContainer& sites, const StateMap& stateMap) :
+  names_(sites.getSequencesNames()),
+  leafBitsets_(),
+  weights_(),
+  nbStates_(stateMap.getNumberOfModelStates())
+{
+  if (names_.size() < 3)
+    throw Exception("StepwiseAdditionTreeBuilder. At least three sequences are needed.");
+
+  SitePatterns pattern(&sites);
+  shared_ptr<SiteContainer> shrunkData = dynamic_pointer_cast<SiteContainer>(pattern.getSites());
+  if (shrunkData == nullptr)
+    throw Exception("StepwiseAdditionTreeBuilder. Data must be plain alignments.");
+  weights_ = pattern.getWeights();
+  size_t nbDistinctSites = shrunkData->getNumberOfSites();
+
+  // Clone data for more efficiency on sequences access:
+  AlignedSequenceContainer sequences(*shrunkData);
+  const Alphabet* alphabet = sites.getAlphabet();
+  leafBitsets_.resize(names_.size());
+  for (size_t n = 0; n < names_.size(); n++)
+  {
+    const Sequence& seq = sequences.getSequence(names_[n]);
+    leafBitsets_[n].resize(nbDistinctSites, nbStates_);
+    for (size_t i = 0; i < nbDistinctSites; i++)
+    {
+      vector<int> states = alphabet->getAlias(seq.getValue(i));
+      for (size_t s = 0; s < nbStates_; s++)
+      {
+        if (find(states.begin(), states.end(), stateMap.getAlphabetStateAsInt(s)) != states.end())
+          leafBitsets_[n].set(i, s);
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+StepwiseAdditionTreeBuilder::Result StepwiseAdditionTreeBuilder::build(const vector<size_t>& order, unsigned int seed, SiteLoopExecutor* executor) const
+{
+  return build_(order, seed, executor, 0);
+}
+
+/******************************************************************************/
+
+StepwiseAdditionTreeBuilder::Result StepwiseAdditionTreeBuilder::build_(const vector<size_t>& order, unsigned int seed, SiteLoopExecutor* executor, vector< vector<size_t> >* splits) const
+{
+  size_t nbSequences = names_.size();
+  vector<size_t> sorted(order);
+  sort(sorted.begin(), sorted.end());
+  bool isPermutation = (sorted.size() == nbSequences);
+  for (size_t i = 0; i < sorted.size() && isPermutation; i++)
+  {
+    isPermutation = (sorted[i] == i);
+  }
+  if (!isPermutation)
+    throw Exception("StepwiseAdditionTreeBuilder::build(). The order must be a permutation of the sequences.");
+
+  mt19937 rng(seed);
+  Result result;
+
+  // Start from the first two sequences:
+  AdditionTree tree;
+  size_t a = tree.addNode(order[0]);
+  size_t b = tree.addNode(order[1]);
+  tree.neighbors[a].push_back(b);
+  tree.neighbors[b].push_back(a);
+  result.score = countEmptyIntersections(leafBitsets_[order[0]], leafBitsets_[order[1]], weights_);
+
+  vector<size_t> branches; // (node, index of neighbor) pairs, as node * 3 + index.
+  vector<unsigned int> costs;
+  for (size_t i = 2; i < nbSequences; i++)
+  {
+    tree.updateSets(leafBitsets_);
+    branches.clear();
+    for (size_t u = 0; u < tree.neighbors.size(); u++)
+    {
+      for (size_t k = 0; k < tree.neighbors[u].size(); k++)
+      {
+        if (u < tree.neighbors[u][k])
+          branches.push_back(3 * u + k);
+      }
+    }
+
+    const BitsetArray& leaf = leafBitsets_[order[i]];
+    costs.resize(branches.size());
+    auto loop = [&](size_t first, size_t last) {
+      BitsetArray branchSet;
+      for (size_t e = first; e < last; e++)
+      {
+        size_t u = branches[e] / 3, k = branches[e] % 3;
+        size_t v = tree.neighbors[u][k];
+        fitch(tree.sets[u][k], tree.sets[v][tree.indexOf(v, u)], branchSet);
+        costs[e] = countEmptyIntersections(branchSet, leaf, weights_);
+      }
+    };
+    if (executor)
+      executor->run(branches.size(), loop);
+    else
+      loop(0, branches.size());
+
+    unsigned int minCost = *min_element(costs.begin(), costs.end());
+    vector<size_t> best;
+    for (size_t e = 0; e < costs.size(); e++)
+    {
+      if (costs[e] == minCost)
+        best.push_back(branches[e]);
+    }
+    size_t chosen = best[uniform_int_distribution<size_t>(0, best.size() - 1)(rng)];
+    tree.insert(chosen / 3, chosen % 3, order[i]);
+    result.score += minCost;
+  }
+
+  // Convert to a tree rooted on the internal node next to node 0:
+  size_t root = tree.neighbors[0][0];
+  vector<Node*> nodes(tree.neighbors.size(), 0);
+  vector<size_t> fathers(tree.neighbors.size(), AdditionTree::NONE);
+  vector<size_t> stack(1, root);
+  nodes[root] = new Node();
+  while (!stack.empty())
+  {
+    size_t u = stack.back();
+    stack.pop_back();
+    for (size_t v : tree.neighbors[u])
+    {
+      if (v == fathers[u])
+        continue;
+      fathers[v] = u;
+      nodes[v] = tree.sequences[v] == AdditionTree::NONE ? new Node() : new Node(names_[tree.sequences[v]]);
+      nodes[u]->addSon(nodes[v]);
+      stack.push_back(v);
+    }
+  }
+  result.tree.reset(new TreeTemplate<Node>(nodes[root]));
+  result.tree->resetNodesId();
+
+  if (splits)
+  {
+    // Sequences below each node, the sequence at node 0 being above all of them:
+    vector<size_t> preorder;
+    tree.getPreorder(preorder, fathers);
+    vector< vector<size_t> > below(tree.neighbors.size());
+    splits->clear();
+    for (size_t i = preorder.size(); i > 1; i--)
+    {
+      size_t u = preorder[i - 1];
+      if (tree.sequences[u] != AdditionTree::NONE)
+        below[u].push_back(tree.sequences[u]);
+      else if (below[u].size() <= nbSequences - 2)
+      {
+        sort(below[u].begin(), below[u].end());
+        splits->push_back(below[u]);
+      }
+      vector<size_t>& up = below[fathers[u]];
+      up.insert(up.end(), below[u].begin(), below[u].end());
+    }
+    // Make splits comparable whatever the first sequence of the order:
+    for (auto& split : *splits)
+    {
+      if (split[0] != 0)
+        continue;
+      vector<size_t> complement;
+      for (size_t n = 0, j = 0; n < nbSequences; n++)
+      {
+        if (j < split.size() && split[j] == n)
+          j++;
+        else
+          complement.push_back(n);
+      }
+      split.swap(complement);
+    }
+    sort(splits->begin(), splits->end());
+  }
+  return result;
+}
+
+/******************************************************************************/
+
+vector<StepwiseAdditionTreeBuilder::Result> StepwiseAdditionTreeBuilder::build(size_t nbReplicates, size_t nbBest, unsigned int seed, size_t nbThreads) const
+{
+  vector<Result> results(nbReplicates);
+  vector< vector< vector<size_t> > > splits(nbReplicates);
+  SiteLoopExecutor executor(nbThreads);
+
+  auto replicate = [&](size_t r, SiteLoopExecutor* branchExecutor) {
+    mt19937 rng(seed + static_cast<unsigned int>(r));
+    vector<size_t> order(names_.size());
+    for (size_t i = 0; i < order.size(); i++)
+      order[i] = i;
+    shuffle(order.begin(), order.end(), rng);
+    results[r] = build_(order, static_cast<unsigned int>(rng()), branchExecutor, &splits[r]);
+  };
+  if (nbReplicates >= executor.getNumberOfThreads())
+  {
+    executor.run(nbReplicates, [&](size_t first, size_t last) {
+      for (size_t r = first; r < last; r++)
+        replicate(r, 0);
+    });
+  }
+  else
+  {
+    for (size_t r = 0; r < nbReplicates; r++)
+      replicate(r, &executor);
+  }
+
+  // Keep the best distinct topologies:
+  vector<size_t> ranks(nbReplicates);
+  for (size_t r = 0; r < nbReplicates; r++)
+    ranks[r] = r;
+  stable_sort(ranks.begin(), ranks.end(), [&](size_t r1, size_t r2) { return results[r1].score < results[r2].score; });
+  vector<Result> best;
+  vector<size_t> kept;
+  for (size_t i = 0; i < nbReplicates && best.size() < nbBest; i++)
+  {
+    size_t r = ranks[i];
+    bool found = false;
+    for (size_t j = 0; j < kept.size() && !found; j++)
+      found = (splits[kept[j]] == splits[r]);
+    if (found)
+      continue;
+    kept.push_back(r);
+    best.push_back(std::move(results[r]));
+  }
+  return best;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,140 @@
+//
+// File: StepwiseAdditionTreeBuilder.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _STEPWISEADDITIONTREEBUILDER_H_
+#define _STEPWISEADDITIONTREEBUILDER_H_
+
+#include "DRTreeParsimonyData.h"
+#include "../Model/StateMap.h"
+#include "../Tree/TreeTemplate.h"
+
+#include <Bpp/Seq/Container/SiteContainer.h>
+
+// From the STL:
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+class SiteLoopExecutor;
+
+/**
+ * @brief Build starting trees by random stepwise addition, scored with parsimony.
+ *
+ * Each replicate draws a random order of the sequences, starts from the
+ * tree of the first three ones, and inserts the others one at a time on
+ * the branch which increases the Fitch score the least (ties being broken
+ * at random). For every branch, the state sets of the two subtrees it
+ * separates are kept up to date, so that the cost of an insertion is
+ * obtained by comparing the set of the new leaf with the Fitch set of the
+ * branch, without any traversal of the tree.
+ *
+ * Replicates run concurrently, each one with its own random generator
+ * seeded from the seed and the replicate index, so that the trees do not
+ * depend on the number of threads. When there are fewer replicates than
+ * threads, the branches tested for each insertion are scored concurrently
+ * instead.
+ *
+ * The resulting trees have a root trifurcation and no branch lengths. They
+ * are meant to be used as start trees, for instance by a DRTreeParsimonyScore
+ * topology search, or by MultiStartTreeSearch which ranks them by likelihood.
+ */
+class StepwiseAdditionTreeBuilder
+{
+public:
+  struct Result
+  {
+    std::unique_ptr< TreeTemplate<Node> > tree;
+    unsigned int score;
+
+    Result() : tree(), score(0) {}
+  };
+
+private:
+  std::vector<std::string> names_;
+  std::vector<BitsetArray> leafBitsets_;
+  std::vector<unsigned int> weights_;
+  size_t nbStates_;
+
+public:
+  /**
+   * @param sites The alignment, with at least three sequences.
+   * @param stateMap The states used for the Fitch sets.
+   * @throw Exception If the alignment has less than three sequences.
+   */
+  StepwiseAdditionTreeBuilder(const SiteContainer& sites, const StateMap& stateMap);
+
+  virtual ~StepwiseAdditionTreeBuilder() {}
+
+public:
+  size_t getNumberOfSequences() const { return names_.size(); }
+
+  /**
+   * @brief Run the replicates and return the best trees.
+   *
+   * @param nbReplicates The number of random addition orders.
+   * @param nbBest The maximum number of trees returned.
+   * @param seed The seed of the random generators.
+   * @param nbThreads The number of threads used.
+   * @return The best distinct topologies found, sorted by increasing score
+   * (replicates with equal scores being kept in their order).
+   */
+  std::vector<Result> build(size_t nbReplicates, size_t nbBest, unsigned int seed = 1, size_t nbThreads = 1) const;
+
+  /**
+   * @brief Build one tree by adding the sequences in a given order.
+   *
+   * @param order A permutation of the indices of the sequences.
+   * @param seed The seed of the random generator used to break ties.
+   * @param executor If not null, used to score the branches concurrently.
+   */
+  Result build(const std::vector<size_t>& order, unsigned int seed, SiteLoopExecutor* executor = 0) const;
+
+private:
+  /**
+   * @brief Build one tree, and optionally return its non-trivial splits
+   * as sorted sets of sequence indices, the first sequence being excluded.
+   */
+  Result build_(const std::vector<size_t>& order, unsigned int seed, SiteLoopExecutor* executor, std::vector< std::vector<size_t> >* splits) const;
+};
+} // end of namespace bpp.
+
+#endif // _STEPWISEADDITIONTREEBUILDER_H_
+
@@ -0,0 +1,153 @@
+//
+// File: CounterBasedRandomStream.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _COUNTERBASEDRANDOMSTREAM_H_
+#define _COUNTERBASEDRANDOMSTREAM_H_
+
+// From the STL:
+#include <cstddef>
+#include <cstdint>
+
+namespace bpp
+{
+/**
+ * @brief A stream of random numbers given by a counter-based generator.
+ *
+ * The i-th number of stream s under seed k is a pure function of (k, s, i),
+ * computed with the Philox4x32-10 bijection (Salmon et al. 2011, "Parallel
+ * random numbers: as easy as 1, 2, 3"). Streams are hence independent of
+ * each other, and can be generated in any order and on any thread: giving
+ * one stream to each site makes a simulation reproducible whatever the
+ * number of threads used.
+ *
+ * Instances are cheap to build and are not meant to be shared between
+ * threads.
+ */
+class CounterBasedRandomStream
+{
+private:
+  uint32_t key_[2];
+  uint64_t stream_;
+  uint64_t counter_;
+  uint32_t buffer_[4];
+  size_t nbUsed_;
+
+public:
+  /**
+   * @param seed The seed, shared by all streams of a simulation.
+   * @param stream The index of the stream, typically a site position.
+   */
+  CounterBasedRandomStream(uint64_t seed, uint64_t stream) :
+    key_(), stream_(stream), counter_(0), buffer_(), nbUsed_(4)
+  {
+    key_[0] = static_cast<uint32_t>(seed);
+    key_[1] = static_cast<uint32_t>(seed >> 32);
+  }
+
+public:
+  /**
+   * @return A number drawn uniformly in [0, entry).
+   */
+  double giveRandomNumberBetweenZeroAndEntry(double entry)
+  {
+    uint64_t hi = next32_();
+    uint64_t lo = next32_();
+    // 53 random bits, as many as a double can hold:
+    double u = static_cast<double>(((hi << 32) | lo) >> 11) * (1. / 9007199254740992.);
+    return u * entry;
+  }
+
+  /**
+   * @return An integer drawn uniformly in [0, entry).
+   */
+  size_t giveIntRandomNumberBetweenZeroAndEntry(size_t entry)
+  {
+    size_t i = static_cast<size_t>(giveRandomNumberBetweenZeroAndEntry(static_cast<double>(entry)));
+    return i < entry ? i : entry - 1;
+  }
+
+  /**
+   * @brief The Philox4x32-10 bijection.
+   *
+   * @param counter The 128 bits counter.
+   * @param key The 64 bits key.
+   * @param result Where to store the 128 random bits.
+   */
+  static void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t result[4])
+  {
+    uint32_t x0 = counter[0], x1 = counter[1], x2 = counter[2], x3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (size_t r = 0; r < 10; r++)
+    {
+      uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * x0;
+      uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * x2;
+      uint32_t y0 = static_cast<uint32_t>(p1 >> 32) ^ x1 ^ k0;
+      uint32_t y1 = static_cast<uint32_t>(p1);
+      uint32_t y2 = static_cast<uint32_t>(p0 >> 32) ^ x3 ^ k1;
+      uint32_t y3 = static_cast<uint32_t>(p0);
+      x0 = y0; x1 = y1; x2 = y2; x3 = y3;
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+    result[0] = x0;
+    result[1] = x1;
+    result[2] = x2;
+    result[3] = x3;
+  }
+
+private:
+  uint32_t next32_()
+  {
+    if (nbUsed_ == 4)
+    {
+      uint32_t counter[4] = {
+        static_cast<uint32_t>(counter_), static_cast<uint32_t>(counter_ >> 32),
+        static_cast<uint32_t>(stream_), static_cast<uint32_t>(stream_ >> 32)
+      };
+      philox4x32(counter, key_, buffer_);
+      counter_++;
+      nbUsed_ = 0;
+    }
+    return buffer_[nbUsed_++];
+  }
+};
+} // end of namespace bpp.
+
+#endif // _COUNTERBASEDRANDOMSTREAM_H_
+
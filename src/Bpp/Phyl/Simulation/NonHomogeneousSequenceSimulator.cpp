@@ -41,6 +41,7 @@
 
 #include "NonHomogeneousSequenceSimulator.h"
 #include "../Model/SubstitutionModelSetTools.h"
+#include <algorithm>
 
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/VectorTools.h>
@@ -71,7 +72,9 @@ NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
   nbClasses_(rate_->getNumberOfCategories()),
   nbStates_(modelSet_->getNumberOfStates()),
   continuousRates_(false),
-  outputInternalSequences_(false)
+  outputInternalSequences_(false),
+  executor_(),
+  mutationProcesses_()
 {
   if (!modelSet->isFullySetUpFor(*tree))
     throw Exception("NonHomogeneousSequenceSimulator(constructor). Model set is not fully specified.");
@@ -97,7 +100,9 @@ NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
   nbClasses_(rate_->getNumberOfCategories()),
   nbStates_(model->getNumberOfStates()),
   continuousRates_(false),
-  outputInternalSequences_(false)
+  outputInternalSequences_(false),
+  executor_(),
+  mutationProcesses_()
 {
   FixedFrequenciesSet* fSet = new FixedFrequenciesSet(model->getStateMap().clone(), model->getFrequencies());
   fSet->setNamespace("anc.");
@@ -138,6 +143,9 @@ void NonHomogeneousSequenceSimulator::init()
   {
     SNode* node = nodes[i];
     node->getInfos().model = modelSet_->getModelForNode(node->getId());
+    const SubstitutionModel* sm = dynamic_cast<const SubstitutionModel*>(node->getInfos().model);
+    if (sm && mutationProcesses_.find(node->getInfos().model) == mutationProcesses_.end())
+      mutationProcesses_[node->getInfos().model].reset(new SimpleMutationProcess(sm));
     double d = node->getDistanceToFather();
     VVVdouble* cumpxy_node_ = &node->getInfos().cumpxy;
     cumpxy_node_->resize(nbClasses_);
@@ -352,6 +360,226 @@ SiteContainer* NonHomogeneousSequenceSimulator::simulate(size_t numberOfSites) c
 
 /******************************************************************************/
 
+SiteContainer* NonHomogeneousSequenceSimulator::simulate(size_t numberOfSites, uint64_t seed, size_t firstSite) const
+{
+  if (continuousRates_)
+    throw Exception("NonHomogeneousSequenceSimulator::simulate. Random streams are not available with continuous rates.");
+
+  StreamPlan_ plan;
+  buildStreamPlan_(plan);
+
+  vector< vector<int> > contents(plan.outputNodes.size(), vector<int>(numberOfSites));
+
+  runParallelLoop_(numberOfSites, [&](size_t first, size_t last) {
+    simulateStreams_(plan, seed, firstSite, first, last, contents);
+  });
+
+  return buildStreamContainer_(plan, contents);
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::simulateReplicates(
+  size_t numberOfReplicates,
+  size_t numberOfSites,
+  uint64_t seed,
+  const std::function<void(size_t, const SiteContainer&)>& writer) const
+{
+  simulateReplicates_(numberOfReplicates, numberOfSites, seed, [&](size_t r, SiteContainer* sites) {
+    unique_ptr<SiteContainer> replicate(sites);
+    writer(r, *replicate);
+  });
+}
+
+/******************************************************************************/
+
+vector<SiteContainer*> NonHomogeneousSequenceSimulator::simulateReplicates(
+  size_t numberOfReplicates,
+  size_t numberOfSites,
+  uint64_t seed) const
+{
+  vector<SiteContainer*> replicates;
+  replicates.reserve(numberOfReplicates);
+  try
+  {
+    simulateReplicates_(numberOfReplicates, numberOfSites, seed, [&](size_t, SiteContainer* sites) {
+      replicates.push_back(sites);
+    });
+  }
+  catch (...)
+  {
+    for (auto sites : replicates)
+      delete sites;
+    throw;
+  }
+  return replicates;
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::simulateReplicates_(
+  size_t numberOfReplicates,
+  size_t numberOfSites,
+  uint64_t seed,
+  const std::function<void(size_t, SiteContainer*)>& output) const
+{
+  if (continuousRates_)
+    throw Exception("NonHomogeneousSequenceSimulator::simulateReplicates. Random streams are not available with continuous rates.");
+
+  StreamPlan_ plan;
+  buildStreamPlan_(plan);
+  size_t nbRows = plan.outputNodes.size();
+
+  // Each thread simulates one replicate at a time, the calling thread
+  // then outputs them in order:
+  size_t nbThreads = getNumberOfThreads();
+  vector< vector< vector<int> > > contents(std::min(nbThreads, numberOfReplicates));
+
+  for (size_t r0 = 0; r0 < numberOfReplicates; r0 += nbThreads)
+  {
+    size_t nb = std::min(nbThreads, numberOfReplicates - r0);
+    runParallelLoop_(nb, [&](size_t first, size_t last) {
+      for (size_t k = first; k < last; k++)
+      {
+        contents[k].assign(nbRows, vector<int>(numberOfSites));
+        simulateStreams_(plan, seed, (r0 + k) * numberOfSites, 0, numberOfSites, contents[k]);
+      }
+    });
+    for (size_t k = 0; k < nb; k++)
+    {
+      output(r0 + k, buildStreamContainer_(plan, contents[k]));
+    }
+  }
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::buildStreamPlan_(StreamPlan_& plan) const
+{
+  // All nodes, each one after its father:
+  plan.nodes.assign(1, tree_.getRootNode());
+  plan.fathers.assign(1, 0);
+  map<int, size_t> nodeIndex;
+  for (size_t k = 0; k < plan.nodes.size(); k++)
+  {
+    nodeIndex[plan.nodes[k]->getId()] = k;
+    for (size_t i = 0; i < plan.nodes[k]->getNumberOfSons(); i++)
+    {
+      plan.nodes.push_back(plan.nodes[k]->getSon(i));
+      plan.fathers.push_back(k);
+    }
+  }
+
+  // The output sequences, with the models giving their alphabet states:
+  if (outputInternalSequences_)
+    plan.outputNodes = tree_.getNodes();
+  else
+  {
+    plan.outputNodes.clear();
+    for (size_t i = 0; i < leaves_.size(); i++)
+    {
+      plan.outputNodes.push_back(plan.nodes[nodeIndex[leaves_[i]->getId()]]);
+    }
+  }
+  size_t nbRows = plan.outputNodes.size();
+  plan.rowNodes.resize(nbRows);
+  plan.rowModels.resize(nbRows);
+  for (size_t i = 0; i < nbRows; i++)
+  {
+    plan.rowNodes[i] = nodeIndex[plan.outputNodes[i]->getId()];
+    if (outputInternalSequences_ && i == nbRows - 1) // If at the root, there is no model, so we take the model of node n-1.
+      plan.rowModels[i] = plan.outputNodes[i - 1]->getInfos().model;
+    else
+      plan.rowModels[i] = plan.outputNodes[i]->getInfos().model;
+  }
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::simulateStreams_(
+  const StreamPlan_& plan,
+  uint64_t seed,
+  size_t firstSite,
+  size_t first,
+  size_t last,
+  vector< vector<int> >& contents) const
+{
+  vector<double> freqs = modelSet_->getRootFrequencies();
+  size_t nbRows = plan.outputNodes.size();
+  vector<size_t> states(plan.nodes.size());
+  for (size_t j = first; j < last; j++)
+  {
+    CounterBasedRandomStream random(seed, firstSite + j);
+    double r = random.giveRandomNumberBetweenZeroAndEntry(1.);
+    double cumprob = 0;
+    states[0] = 0;
+    for (size_t i = 0; i < nbStates_; i++)
+    {
+      cumprob += freqs[i];
+      if (r <= cumprob)
+      {
+        states[0] = i;
+        break;
+      }
+    }
+    size_t c = random.giveIntRandomNumberBetweenZeroAndEntry(nbClasses_);
+    for (size_t k = 1; k < plan.nodes.size(); k++)
+    {
+      const Vdouble& cumpxy = plan.nodes[k]->getInfos().cumpxy[c][states[plan.fathers[k]]];
+      double rand = random.giveRandomNumberBetweenZeroAndEntry(1.);
+      size_t y = 0;
+      while (y < nbStates_ - 1 && rand >= cumpxy[y])
+      {
+        y++;
+      }
+      states[k] = y;
+    }
+    for (size_t i = 0; i < nbRows; i++)
+    {
+      contents[i][j] = plan.rowModels[i]->getAlphabetStateAsInt(states[plan.rowNodes[i]]);
+    }
+  }
+}
+
+/******************************************************************************/
+
+SiteContainer* NonHomogeneousSequenceSimulator::buildStreamContainer_(const StreamPlan_& plan, const vector< vector<int> >& contents) const
+{
+  AlignedSequenceContainer* sites = new AlignedSequenceContainer(alphabet_);
+  for (size_t i = 0; i < plan.outputNodes.size(); i++)
+  {
+    if (plan.outputNodes[i]->isLeaf())
+      sites->addSequence(BasicSequence(plan.outputNodes[i]->getName(), contents[i], alphabet_), false);
+    else
+      sites->addSequence(BasicSequence(TextTools::toString(plan.outputNodes[i]->getId()), contents[i], alphabet_), false);
+  }
+  return sites;
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::setNumberOfThreads(size_t nbThreads)
+{
+  if (nbThreads == getNumberOfThreads())
+    return;
+  if (nbThreads <= 1)
+    executor_.reset();
+  else
+    executor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::runParallelLoop_(size_t n, const std::function<void(size_t, size_t)>& loop) const
+{
+  if (executor_)
+    executor_->run(n, loop);
+  else
+    loop(0, n);
+}
+
+/******************************************************************************/
+
 RASiteSimulationResult* NonHomogeneousSequenceSimulator::dSimulateSite() const
 {
   // Draw an initial state randomly according to equilibrum frequencies:
@@ -613,12 +841,11 @@ void NonHomogeneousSequenceSimulator::dEvolveInternal(SNode* node, double rate,
     return;
   }
   const TransitionModel* tm=node->getInfos().model;
-  if (dynamic_cast<const SubstitutionModel*>(tm)==0)
+  map<const TransitionModel*, shared_ptr<const MutationProcess> >::const_iterator itp = mutationProcesses_.find(tm);
+  if (itp == mutationProcesses_.end())
     throw Exception("NonHomogeneousSequenceSimulator::dEvolveInternal : detailed simulation not possible for non-markovian model");
   
-  SimpleMutationProcess process(dynamic_cast<const SubstitutionModel*>(tm));
-  
-  MutationPath mp = process.detailedEvolve(node->getFather()->getInfos().state, node->getDistanceToFather() * rate);
+  MutationPath mp = itp->second->detailedEvolve(node->getFather()->getInfos().state, node->getDistanceToFather() * rate);
   node->getInfos().state = mp.getFinalState();
 
   // Now append infos in rassr:
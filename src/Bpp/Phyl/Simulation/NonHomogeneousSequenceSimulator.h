@@ -43,6 +43,8 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "DetailedSiteSimulator.h"
 #include "SequenceSimulator.h"
+#include "CounterBasedRandomStream.h"
+#include "../SiteLoopExecutor.h"
 #include "../Tree/TreeTemplate.h"
 #include "../Tree/NodeTemplate.h"
 #include "../Model/SubstitutionModel.h"
@@ -56,7 +58,10 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Seq/Container/SiteContainer.h>
 
 // From the STL:
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
 #include <vector>
 
 #include "../Model/SubstitutionModelSet.h"
@@ -122,6 +127,14 @@ class NonHomogeneousSequenceSimulator:
     // Should we ouptut internal sequences as well?
     bool outputInternalSequences_;
 
+    std::unique_ptr<SiteLoopExecutor> executor_;
+
+    /**
+     * @brief The jump chains of the Markovian models, built once by
+     * init() for detailed simulations.
+     */
+    std::map<const TransitionModel*, std::shared_ptr<const MutationProcess> > mutationProcesses_;
+
     /**
      * @name Stores intermediate results.
      *
@@ -160,8 +173,12 @@ class NonHomogeneousSequenceSimulator:
       nbClasses_      (nhss.nbClasses_),
       nbStates_       (nhss.nbStates_),
       continuousRates_(nhss.continuousRates_),
-      outputInternalSequences_(nhss.outputInternalSequences_)
-    {}
+      outputInternalSequences_(nhss.outputInternalSequences_),
+      executor_(),
+      mutationProcesses_(nhss.mutationProcesses_)
+    {
+      setNumberOfThreads(nhss.getNumberOfThreads());
+    }
 
     NonHomogeneousSequenceSimulator& operator=(const NonHomogeneousSequenceSimulator& nhss)
     {
@@ -179,6 +196,8 @@ class NonHomogeneousSequenceSimulator:
       nbStates_        = nhss.nbStates_;
       continuousRates_ = nhss.continuousRates_;
       outputInternalSequences_ = nhss.outputInternalSequences_;
+      mutationProcesses_ = nhss.mutationProcesses_;
+      setNumberOfThreads(nhss.getNumberOfThreads());
       return *this;
     }
 
@@ -232,6 +251,63 @@ class NonHomogeneousSequenceSimulator:
     SiteContainer* simulate(size_t numberOfSites) const;
     /** @} */
 
+    /**
+     * @brief Simulate sites with one random stream per site.
+     *
+     * All random numbers of site j are drawn from the
+     * CounterBasedRandomStream (seed, firstSite + j), and not from
+     * RandomTools, so that the alignment only depends on the seed. Sites
+     * are simulated concurrently if several threads were set, with the
+     * same result, and an alignment simulated by chunks is the same as
+     * when simulated at once.
+     *
+     * Continuous rates are not supported in this mode.
+     *
+     * @param numberOfSites The number of sites to simulate.
+     * @param seed The seed of the random streams.
+     * @param firstSite The position of the first simulated site in the whole alignment.
+     * @throw Exception If continuous rates are enabled.
+     */
+    SiteContainer* simulate(size_t numberOfSites, uint64_t seed, size_t firstSite = 0) const;
+
+    /**
+     * @brief Simulate several alignments of the same length, for
+     * parametric bootstrap for instance.
+     *
+     * Replicate r is the alignment given by simulate(numberOfSites,
+     * seed, r * numberOfSites), so that all replicates use independent
+     * random streams. The transition tables and the order of nodes are
+     * shared by all replicates, and replicates are distributed among the
+     * threads set, one replicate per thread at a time.
+     *
+     * @param numberOfReplicates The number of alignments to simulate.
+     * @param numberOfSites The number of sites of each alignment.
+     * @param seed The seed of the random streams.
+     * @param writer Called by the calling thread on each replicate index
+     * and alignment, in the replicate order. The alignment is deleted
+     * afterwards, so that at most one alignment per thread is in memory.
+     * @throw Exception If continuous rates are enabled.
+     */
+    void simulateReplicates(size_t numberOfReplicates, size_t numberOfSites, uint64_t seed, const std::function<void(size_t, const SiteContainer&)>& writer) const;
+
+    /**
+     * @brief Simulate several alignments of the same length in memory.
+     *
+     * @see simulateReplicates(numberOfReplicates, numberOfSites, seed, writer)
+     * @return The replicates, to be deleted by the caller.
+     */
+    std::vector<SiteContainer*> simulateReplicates(size_t numberOfReplicates, size_t numberOfSites, uint64_t seed) const;
+
+    /**
+     * @brief Set the number of threads used by simulate(numberOfSites,
+     * seed) and simulateReplicates (1 by default, ie no additional thread).
+     *
+     * @param nbThreads The total number of threads, including the calling one.
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    size_t getNumberOfThreads() const { return executor_ ? executor_->getNumberOfThreads() : 1; }
+
     /**
      * @name SiteSimulator and SequenceSimulator interface
      *
@@ -288,6 +364,40 @@ class NonHomogeneousSequenceSimulator:
     void outputInternalSequences(bool yn) ;
 
 
+  private:
+    /**
+     * @brief Run loop(first, last) on blocks of [0, n), on several threads if any.
+     */
+    void runParallelLoop_(size_t n, const std::function<void(size_t, size_t)>& loop) const;
+
+    /**
+     * @brief The nodes and output sequences of simulations with random
+     * streams, computed once for all sites and replicates.
+     */
+    struct StreamPlan_
+    {
+      std::vector<SNode*> nodes; // each one after its father
+      std::vector<size_t> fathers;
+      std::vector<SNode*> outputNodes;
+      std::vector<size_t> rowNodes;
+      std::vector<const TransitionModel*> rowModels;
+    };
+
+    void buildStreamPlan_(StreamPlan_& plan) const;
+
+    /**
+     * @brief Simulate the sites j in [first, last) of contents, with
+     * the random stream (seed, firstSite + j).
+     */
+    void simulateStreams_(const StreamPlan_& plan, uint64_t seed, size_t firstSite, size_t first, size_t last, std::vector< std::vector<int> >& contents) const;
+
+    SiteContainer* buildStreamContainer_(const StreamPlan_& plan, const std::vector< std::vector<int> >& contents) const;
+
+    /**
+     * @brief Simulate replicates, and give each one to output, which takes its ownership.
+     */
+    void simulateReplicates_(size_t numberOfReplicates, size_t numberOfSites, uint64_t seed, const std::function<void(size_t, SiteContainer*)>& output) const;
+
   protected:
 
     /**
@@ -39,10 +39,18 @@
 
 #include "SequenceSimulationTools.h"
 
+// From bpp-core:
+#include <Bpp/Text/TextTools.h>
+
 // From bpp-seq:
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 
 using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+#include <memory>
+
 using namespace std;
 
 SiteContainer* SequenceSimulationTools::simulateSites(const SiteSimulator& simulator, const vector<double>& rates)
@@ -110,3 +118,47 @@ SiteContainer* SequenceSimulationTools::simulateSites(const SiteSimulator& simul
   return sites;
 }
 
+void SequenceSimulationTools::simulateSites(const SiteChunkSimulator& chunkSimulator, size_t numberOfSites, size_t chunkSize, const SiteChunkHandler& handler)
+{
+  if (chunkSize == 0)
+    throw Exception("SequenceSimulationTools::simulateSites. The chunk size must be positive.");
+  for (size_t first = 0; first < numberOfSites; first += chunkSize)
+  {
+    unique_ptr<SiteContainer> chunk(chunkSimulator(first, min(chunkSize, numberOfSites - first)));
+    handler(*chunk, first);
+  }
+}
+
+void SequenceSimulationTools::simulateSites(const SequenceSimulator& simulator, size_t numberOfSites, size_t chunkSize, const SiteChunkHandler& handler)
+{
+  simulateSites([&simulator](size_t, size_t nbSites) { return simulator.simulate(nbSites); }, numberOfSites, chunkSize, handler);
+}
+
+void PhylipSiteChunkWriter::operator()(const SiteContainer& chunk, size_t firstSite)
+{
+  if (firstSite != nbWritten_)
+    throw Exception("PhylipSiteChunkWriter. Chunk starting at site " + TextTools::toString(firstSite) + ", expected at site " + TextTools::toString(nbWritten_) + ".");
+
+  size_t nbSeq = chunk.getNumberOfSequences();
+  vector<string> lines(nbSeq);
+  for (size_t i = 0; i < nbSeq; i++)
+  {
+    lines[i] = chunk.getSequence(i).toString();
+  }
+  size_t length = nbSeq > 0 ? lines[0].size() : 0;
+
+  if (nbWritten_ == 0)
+    *out_ << nbSeq << " " << numberOfSites_ << endl;
+
+  for (size_t pos = 0; pos < length; pos += charsByLine_)
+  {
+    for (size_t i = 0; i < nbSeq; i++)
+    {
+      if (nbWritten_ == 0 && pos == 0)
+        *out_ << chunk.getSequence(i).getName() << "  ";
+      *out_ << lines[i].substr(pos, charsByLine_) << endl;
+    }
+    *out_ << endl;
+  }
+  nbWritten_ += chunk.getNumberOfSites();
+}
@@ -41,11 +41,15 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _SEQUENCESIMULATIONTOOLS_H_
 
 #include "SiteSimulator.h"
+#include "SequenceSimulator.h"
 
 //From Seqlib:
 #include <Bpp/Seq/Container/SiteContainer.h>
 
 //From the STL:
+#include <functional>
+#include <iostream>
+#include <string>
 #include <vector>
 
 namespace bpp
@@ -105,6 +109,81 @@ class SequenceSimulationTools
      */
     static SiteContainer* simulateSites(const SiteSimulator& simulator, const std::vector<size_t>& states);
 
+    /**
+     * @brief Function receiving a chunk of simulated sites, together with
+     * the position of its first site in the whole alignment.
+     */
+    typedef std::function<void(const SiteContainer& chunk, size_t firstSite)> SiteChunkHandler;
+
+    /**
+     * @brief Function simulating nbSites sites, starting at position
+     * firstSite of the whole alignment.
+     */
+    typedef std::function<SiteContainer*(size_t firstSite, size_t nbSites)> SiteChunkSimulator;
+
+    /**
+     * @brief Simulate a long alignment chunk by chunk.
+     *
+     * Each chunk is handed to the handler, then freed before the next one
+     * is simulated, so that memory only depends on the chunk size.
+     * Combined with random streams, the alignment does not depend on the
+     * chunk size, for instance:
+     * @code
+     * SequenceSimulationTools::simulateSites(
+     *   [&](size_t first, size_t n) { return simulator.simulate(n, seed, first); },
+     *   numberOfSites, 10000, PhylipSiteChunkWriter(out, numberOfSites));
+     * @endcode
+     *
+     * @param chunkSimulator The function simulating each chunk.
+     * @param numberOfSites  The total number of sites.
+     * @param chunkSize      The maximum number of sites in a chunk.
+     * @param handler        The function receiving the chunks, in order.
+     */
+    static void simulateSites(const SiteChunkSimulator& chunkSimulator, size_t numberOfSites, size_t chunkSize, const SiteChunkHandler& handler);
+
+    /**
+     * @brief Simulate a long alignment chunk by chunk, with
+     * SequenceSimulator::simulate().
+     *
+     * @see simulateSites(const SiteChunkSimulator&, size_t, size_t, const SiteChunkHandler&)
+     */
+    static void simulateSites(const SequenceSimulator& simulator, size_t numberOfSites, size_t chunkSize, const SiteChunkHandler& handler);
+
+};
+
+/**
+ * @brief Write chunks of sites to a stream in interleaved Phylip
+ * format, as they are received.
+ *
+ * Names are written with the first chunk, followed by two spaces, as
+ * in the extended Phylip format. Each chunk then gives one or more
+ * blocks. The total number of sites is needed for the header.
+ *
+ * Fasta and sequential formats need each sequence in full, so they
+ * cannot be streamed by sites.
+ */
+class PhylipSiteChunkWriter
+{
+  private:
+    std::ostream* out_;
+    size_t numberOfSites_;
+    size_t charsByLine_;
+    size_t nbWritten_;
+
+  public:
+    /**
+     * @param out           The stream to write to.
+     * @param numberOfSites The total number of sites of the alignment.
+     * @param charsByLine   The number of characters of each line.
+     */
+    PhylipSiteChunkWriter(std::ostream& out, size_t numberOfSites, size_t charsByLine = 100) :
+      out_(&out), numberOfSites_(numberOfSites), charsByLine_(charsByLine), nbWritten_(0) {}
+
+  public:
+    /**
+     * @throw Exception If chunks are not received in order.
+     */
+    void operator()(const SiteContainer& chunk, size_t firstSite);
 };
 
 } //end of namespace bpp.
@@ -66,7 +66,9 @@ SimpleSubstitutionProcessSequenceSimulator::SimpleSubstitutionProcessSequenceSim
   nbClasses_(process_->getNumberOfClasses()),
   nbStates_(process_->getNumberOfStates()),
   continuousRates_(false),
-  outputInternalSequences_(false)
+  outputInternalSequences_(false),
+  executor_(),
+  mutationProcesses_()
 {
   init();
 }
@@ -108,7 +110,7 @@ void SimpleSubstitutionProcessSequenceSimulator::init()
     }
   }
   
-  // Initialize cumulative pxy:
+  // Initialize alias tables of pxy:
   vector<shared_ptr<SimProcessNode> > nodes = tree_.getAllNodes();
   nodes.erase(std::find(nodes.begin(), nodes.end(), tree_.getRoot()));
   
@@ -119,28 +121,31 @@ void SimpleSubstitutionProcessSequenceSimulator::init()
     shared_ptr<SimProcessNode> node = nodes[i];
 
     node->process_ = process_;
-    VVVdouble* cumpxy_node_ = &node->cumpxy;
-    cumpxy_node_->resize(nbClasses_);
+    node->aliasProb.resize(nbClasses_);
+    node->aliasIndex.resize(nbClasses_);
     for (size_t c = 0; c < nbClasses_; c++)
     {
-      VVdouble* cumpxy_node_c_ = &(*cumpxy_node_)[c];
-
-      cumpxy_node_c_->resize(nbStates_);
+      node->aliasProb[c].resize(nbStates_);
+      node->aliasIndex[c].resize(nbStates_);
 
       // process transition probabilities already consider rates &
       // branch length
       
       const RowMatrix<double>& P = process_->getTransitionProbabilities(node->getId(),c);
 
+      const TransitionModel* tm = process_->getModel(node->getId(), c);
+      const SubstitutionModel* sm = dynamic_cast<const SubstitutionModel*>(tm);
+      if (sm && mutationProcesses_.find(tm) == mutationProcesses_.end())
+        mutationProcesses_[tm].reset(new SimpleMutationProcess(sm));
+
+      Vdouble pxy(nbStates_);
       for (size_t x = 0; x < nbStates_; x++)
       {
-        Vdouble* cumpxy_node_c_x_ = &(*cumpxy_node_c_)[x];
-        cumpxy_node_c_x_->resize(nbStates_);
-        (*cumpxy_node_c_x_)[0] = P(x, 0);
-        for (size_t y = 1; y < nbStates_; y++)
+        for (size_t y = 0; y < nbStates_; y++)
         {
-          (*cumpxy_node_c_x_)[y] = (*cumpxy_node_c_x_)[y - 1] + P(x, y);
+          pxy[y] = P(x, y);
         }
+        buildAliasTable_(pxy, node->aliasProb[c][x], node->aliasIndex[c][x]);
       }
     }
   }
@@ -148,6 +153,62 @@ void SimpleSubstitutionProcessSequenceSimulator::init()
 
 /******************************************************************************/
 
+void SimpleSubstitutionProcessSequenceSimulator::buildAliasTable_(const Vdouble& probs, Vdouble& aliasProb, std::vector<size_t>& aliasIndex)
+{
+  // Vose's variant of Walker's method: each cell y keeps its own state
+  // with probability aliasProb[y], and gives the rest of its mass to
+  // aliasIndex[y].
+  size_t n = probs.size();
+  aliasProb.resize(n);
+  aliasIndex.resize(n);
+
+  double sum = VectorTools::sum(probs);
+  if (!(sum > 0))
+    throw Exception("SimpleSubstitutionProcessSequenceSimulator::buildAliasTable_. Transition probabilities sum to " + TextTools::toString(sum) + ".");
+
+  vector<size_t> small, large;
+  for (size_t y = 0; y < n; y++)
+  {
+    aliasProb[y] = probs[y] * static_cast<double>(n) / sum;
+    aliasIndex[y] = y;
+    if (aliasProb[y] < 1.)
+      small.push_back(y);
+    else
+      large.push_back(y);
+  }
+
+  while (!small.empty() && !large.empty())
+  {
+    size_t s = small.back();
+    small.pop_back();
+    size_t l = large.back();
+    aliasIndex[s] = l;
+    aliasProb[l] -= 1. - aliasProb[s];
+    if (aliasProb[l] < 1.)
+    {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+
+  // Remaining cells are full, up to rounding errors:
+  for (size_t y : small)
+    aliasProb[y] = 1.;
+  for (size_t y : large)
+    aliasProb[y] = 1.;
+}
+
+/******************************************************************************/
+
+size_t SimpleSubstitutionProcessSequenceSimulator::drawFromAliasTable_(const Vdouble& aliasProb, const std::vector<size_t>& aliasIndex, double u)
+{
+  size_t n = aliasProb.size();
+  size_t y = std::min(static_cast<size_t>(u), n - 1);
+  return (u - static_cast<double>(y) < aliasProb[y]) ? y : aliasIndex[y];
+}
+
+/******************************************************************************/
+
 Site* SimpleSubstitutionProcessSequenceSimulator::simulateSite() const
 {
   // Draw an initial state randomly according to equilibrum frequencies:
@@ -311,6 +372,216 @@ SiteContainer* SimpleSubstitutionProcessSequenceSimulator::simulate(size_t numbe
 
 /******************************************************************************/
 
+SiteContainer* SimpleSubstitutionProcessSequenceSimulator::simulate(size_t numberOfSites, uint64_t seed, size_t firstSite) const
+{
+  if (continuousRates_ && process_->getRateDistribution())
+    throw Exception("SimpleSubstitutionProcessSequenceSimulator::simulate. Random streams are not available with continuous rates.");
+
+  StreamPlan_ plan;
+  buildStreamPlan_(plan);
+
+  vector< vector<int> > contents(plan.outputNodes.size(), vector<int>(numberOfSites));
+
+  runParallelLoop_(numberOfSites, [&](size_t first, size_t last) {
+    simulateStreams_(plan, seed, firstSite, first, last, contents);
+  });
+
+  return buildStreamContainer_(plan, contents);
+}
+
+/******************************************************************************/
+
+void SimpleSubstitutionProcessSequenceSimulator::simulateReplicates(
+  size_t numberOfReplicates,
+  size_t numberOfSites,
+  uint64_t seed,
+  const std::function<void(size_t, const SiteContainer&)>& writer) const
+{
+  simulateReplicates_(numberOfReplicates, numberOfSites, seed, [&](size_t r, SiteContainer* sites) {
+    unique_ptr<SiteContainer> replicate(sites);
+    writer(r, *replicate);
+  });
+}
+
+/******************************************************************************/
+
+vector<SiteContainer*> SimpleSubstitutionProcessSequenceSimulator::simulateReplicates(
+  size_t numberOfReplicates,
+  size_t numberOfSites,
+  uint64_t seed) const
+{
+  vector<SiteContainer*> replicates;
+  replicates.reserve(numberOfReplicates);
+  try
+  {
+    simulateReplicates_(numberOfReplicates, numberOfSites, seed, [&](size_t, SiteContainer* sites) {
+      replicates.push_back(sites);
+    });
+  }
+  catch (...)
+  {
+    for (auto sites : replicates)
+      delete sites;
+    throw;
+  }
+  return replicates;
+}
+
+/******************************************************************************/
+
+void SimpleSubstitutionProcessSequenceSimulator::simulateReplicates_(
+  size_t numberOfReplicates,
+  size_t numberOfSites,
+  uint64_t seed,
+  const std::function<void(size_t, SiteContainer*)>& output) const
+{
+  if (continuousRates_ && process_->getRateDistribution())
+    throw Exception("SimpleSubstitutionProcessSequenceSimulator::simulateReplicates. Random streams are not available with continuous rates.");
+
+  StreamPlan_ plan;
+  buildStreamPlan_(plan);
+  size_t nbRows = plan.outputNodes.size();
+
+  // Each thread simulates one replicate at a time, the calling thread
+  // then outputs them in order:
+  size_t nbThreads = getNumberOfThreads();
+  vector< vector< vector<int> > > contents(std::min(nbThreads, numberOfReplicates));
+
+  for (size_t r0 = 0; r0 < numberOfReplicates; r0 += nbThreads)
+  {
+    size_t nb = std::min(nbThreads, numberOfReplicates - r0);
+    runParallelLoop_(nb, [&](size_t first, size_t last) {
+      for (size_t k = first; k < last; k++)
+      {
+        contents[k].assign(nbRows, vector<int>(numberOfSites));
+        simulateStreams_(plan, seed, (r0 + k) * numberOfSites, 0, numberOfSites, contents[k]);
+      }
+    });
+    for (size_t k = 0; k < nb; k++)
+    {
+      output(r0 + k, buildStreamContainer_(plan, contents[k]));
+    }
+  }
+}
+
+/******************************************************************************/
+
+void SimpleSubstitutionProcessSequenceSimulator::buildStreamPlan_(StreamPlan_& plan) const
+{
+  // All nodes, each one after its father:
+  plan.nodes.assign(1, tree_.getRoot().get());
+  plan.fathers.assign(1, 0);
+  map<int, size_t> nodeIndex;
+  for (size_t k = 0; k < plan.nodes.size(); k++)
+  {
+    nodeIndex[plan.nodes[k]->getId()] = k;
+    for (size_t i = 0; i < plan.nodes[k]->getNumberOfSons(); i++)
+    {
+      plan.nodes.push_back(plan.nodes[k]->getSon(i));
+      plan.fathers.push_back(k);
+    }
+  }
+
+  // The output sequences, with the models giving their alphabet states:
+  if (outputInternalSequences_)
+    plan.outputNodes = tree_.getAllNodes();
+  else
+    plan.outputNodes = leaves_;
+  size_t nbRows = plan.outputNodes.size();
+  plan.rowNodes.resize(nbRows);
+  plan.rowModels.assign(nbRows, vector<const TransitionModel*>(nbClasses_));
+  for (size_t i = 0; i < nbRows; i++)
+  {
+    plan.rowNodes[i] = nodeIndex[plan.outputNodes[i]->getId()];
+    size_t i2 = (outputInternalSequences_ && i == nbRows - 1) ? i - 1 : i; // at the root, there is no model, so we take the model of node n-1.
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      plan.rowModels[i][c] = process_->getModel(plan.outputNodes[i2]->getId(), c);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void SimpleSubstitutionProcessSequenceSimulator::simulateStreams_(
+  const StreamPlan_& plan,
+  uint64_t seed,
+  size_t firstSite,
+  size_t first,
+  size_t last,
+  vector< vector<int> >& contents) const
+{
+  const vector<double>& freqs = process_->getRootFrequencies();
+  size_t nbRows = plan.outputNodes.size();
+  vector<size_t> states(plan.nodes.size());
+  for (size_t j = first; j < last; j++)
+  {
+    CounterBasedRandomStream random(seed, firstSite + j);
+    double r = random.giveRandomNumberBetweenZeroAndEntry(1.);
+    double cumprob = 0;
+    states[0] = 0;
+    for (size_t i = 0; i < nbStates_; i++)
+    {
+      cumprob += freqs[i];
+      if (r <= cumprob)
+      {
+        states[0] = i;
+        break;
+      }
+    }
+    size_t c = random.giveIntRandomNumberBetweenZeroAndEntry(nbClasses_);
+    for (size_t k = 1; k < plan.nodes.size(); k++)
+    {
+      size_t x = states[plan.fathers[k]];
+      double u = random.giveRandomNumberBetweenZeroAndEntry(static_cast<double>(nbStates_));
+      states[k] = drawFromAliasTable_(plan.nodes[k]->aliasProb[c][x], plan.nodes[k]->aliasIndex[c][x], u);
+    }
+    for (size_t i = 0; i < nbRows; i++)
+    {
+      contents[i][j] = plan.rowModels[i][c]->getAlphabetStateAsInt(states[plan.rowNodes[i]]);
+    }
+  }
+}
+
+/******************************************************************************/
+
+SiteContainer* SimpleSubstitutionProcessSequenceSimulator::buildStreamContainer_(const StreamPlan_& plan, const vector< vector<int> >& contents) const
+{
+  AlignedSequenceContainer* sites = new AlignedSequenceContainer(alphabet_);
+  for (size_t i = 0; i < plan.outputNodes.size(); i++)
+  {
+    if (plan.outputNodes[i]->isLeaf())
+      sites->addSequence(BasicSequence(plan.outputNodes[i]->getName(), contents[i], alphabet_), false);
+    else
+      sites->addSequence(BasicSequence(TextTools::toString(plan.outputNodes[i]->getId()), contents[i], alphabet_), false);
+  }
+  return sites;
+}
+
+/******************************************************************************/
+
+void SimpleSubstitutionProcessSequenceSimulator::setNumberOfThreads(size_t nbThreads)
+{
+  if (nbThreads == getNumberOfThreads())
+    return;
+  if (nbThreads <= 1)
+    executor_.reset();
+  else
+    executor_.reset(new SiteLoopExecutor(nbThreads));
+}
+
+/******************************************************************************/
+
+void SimpleSubstitutionProcessSequenceSimulator::runParallelLoop_(size_t n, const std::function<void(size_t, size_t)>& loop) const
+{
+  if (executor_)
+    executor_->run(n, loop);
+  else
+    loop(0, n);
+}
+
+/******************************************************************************/
+
 New_SiteSimulationResult* SimpleSubstitutionProcessSequenceSimulator::dSimulateSite() const
 {
   // Draw an initial state randomly according to root frequencies:
@@ -392,13 +663,8 @@ New_SiteSimulationResult* SimpleSubstitutionProcessSequenceSimulator::dSimulateS
 
 size_t SimpleSubstitutionProcessSequenceSimulator::evolve(const SimProcessNode* node, size_t initialStateIndex, size_t rateClass) const
 {
-  const Vdouble* cumpxy_node_c_x_ = &node->cumpxy[rateClass][initialStateIndex];
-  double rand = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-  for (size_t y = 0; y < nbStates_; y++)
-  {
-    if (rand < (*cumpxy_node_c_x_)[y]) return y;
-  }
-  throw Exception("SimpleSubstitutionProcessSequenceSimulator::evolve. The impossible happened! rand = " + TextTools::toString(rand) + ".");
+  double u = RandomTools::giveRandomNumberBetweenZeroAndEntry(static_cast<double>(nbStates_));
+  return drawFromAliasTable_(node->aliasProb[rateClass][initialStateIndex], node->aliasIndex[rateClass][initialStateIndex], u);
 }
 
 /******************************************************************************/
@@ -410,13 +676,15 @@ size_t SimpleSubstitutionProcessSequenceSimulator::evolve(const SimProcessNode*
   double l = rate * node->getDistanceToFather();
   
   const TransitionModel* model = node->process_->getModel(node->getId(), rateClass);
+
+  // One matrix computation for the whole row, instead of one per state:
+  const Matrix<double>& P = model->getPij_t(l);
   
   for (size_t y = 0; y < nbStates_; y++)
   {
-    cumpxy += model->Pij_t(initialStateIndex, y, l);
+    cumpxy += P(initialStateIndex, y);
     if (rand < cumpxy) return y;
   }
-  MatrixTools::print(model->getPij_t(l));
   throw Exception("SimpleSubstitutionProcessSequenceSimulator::evolve. The impossible happened! rand = " + TextTools::toString(rand) + ".");
 }
 
@@ -428,20 +696,12 @@ void SimpleSubstitutionProcessSequenceSimulator::multipleEvolve(
     const vector<size_t>& rateClasses,
     std::vector<size_t>& finalStateIndices) const
 {
-  const VVVdouble* cumpxy_node_ = &node->cumpxy;
-  
   for (size_t i = 0; i < initialStateIndices.size(); i++)
   {
-    const Vdouble* cumpxy_node_c_x_ = &(*cumpxy_node_)[rateClasses[i]][initialStateIndices[i]];
-    double rand = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
-    for (size_t y = 0; y < nbStates_; y++)
-    {
-      if (rand < (*cumpxy_node_c_x_)[y])
-      {
-        finalStateIndices[i] = y;
-        break;
-      }
-    }
+    size_t c = rateClasses[i];
+    size_t x = initialStateIndices[i];
+    double u = RandomTools::giveRandomNumberBetweenZeroAndEntry(static_cast<double>(nbStates_));
+    finalStateIndices[i] = drawFromAliasTable_(node->aliasProb[c][x], node->aliasIndex[c][x], u);
   }
 }
 
@@ -595,13 +855,12 @@ void SimpleSubstitutionProcessSequenceSimulator::dEvolveInternal(SimProcessNode*
   }
   
   const TransitionModel* tm=node->process_->getModel(node->getId(), rateClass);
-  
-  if (dynamic_cast<const SubstitutionModel*>(tm)==0)
-    throw Exception("SimpleSubstitutionProcessSequenceSimulator::dEvolveInternal : detailed simulation not possible for non-markovian model");
 
-  SimpleMutationProcess process(dynamic_cast<const SubstitutionModel*>(tm));
+  map<const TransitionModel*, shared_ptr<const MutationProcess> >::const_iterator itp = mutationProcesses_.find(tm);
+  if (itp == mutationProcesses_.end())
+    throw Exception("SimpleSubstitutionProcessSequenceSimulator::dEvolveInternal : detailed simulation not possible for non-markovian model");
 
-  MutationPath mp = process.detailedEvolve(node->getFather()->state, node->getDistanceToFather() * rate);
+  MutationPath mp = itp->second->detailedEvolve(node->getFather()->state, node->getDistanceToFather() * rate);
   node->state = mp.getFinalState();
 
   // Now append infos in ssr:
@@ -625,13 +884,12 @@ void SimpleSubstitutionProcessSequenceSimulator::dEvolveInternal(SimProcessNode*
   }
   
   const TransitionModel* tm=node->process_->getModel(node->getId(), rateClass);
-  
-  if (dynamic_cast<const SubstitutionModel*>(tm)==0)
-    throw Exception("SimpleSubstitutionProcessSequenceSimulator::dEvolveInternal : detailed simulation not possible for non-markovian model");
 
-  SimpleMutationProcess process(dynamic_cast<const SubstitutionModel*>(tm));
+  map<const TransitionModel*, shared_ptr<const MutationProcess> >::const_iterator itp = mutationProcesses_.find(tm);
+  if (itp == mutationProcesses_.end())
+    throw Exception("SimpleSubstitutionProcessSequenceSimulator::dEvolveInternal : detailed simulation not possible for non-markovian model");
 
-  MutationPath mp = process.detailedEvolve(node->getFather()->state, node->getDistanceToFather());
+  MutationPath mp = itp->second->detailedEvolve(node->getFather()->state, node->getDistanceToFather());
   
   node->state = mp.getFinalState();
 
@@ -832,24 +1090,39 @@ void SubstitutionProcessSequenceSimulator::setMap(std::vector<size_t> vMap)
 SiteContainer* SubstitutionProcessSequenceSimulator::simulate(size_t numberOfSites) const
 {
   resetSiteSimulators(numberOfSites);
-  
-  VectorSiteContainer* sites = new VectorSiteContainer(seqNames_.size(), getAlphabet());
-  sites->setSequencesNames(seqNames_);
 
-  Vint vval(seqNames_.size());
-  
+  // Positions of the sites of each process:
+  map<size_t, vector<size_t> > mPositions;
   for (size_t j = 0; j < numberOfSites; j++)
   {
-    
-    Site* site=mProcess_.find(vMap_[j])->second->simulateSite();
+    mPositions[vMap_[j]].push_back(j);
+  }
 
-    const vector<size_t>& vPosNames=mvPosNames_.find(vMap_[j])->second;
-    for (size_t vn=0;vn<vPosNames.size(); vn++)
-      vval[vn]=site->getValue(vPosNames[vn]);
+  size_t nbSeq = seqNames_.size();
+  vector<Vint> contents(nbSeq, Vint(numberOfSites));
 
-    
-    sites->addSite(*new Site(vval,sites->getAlphabet(),static_cast<int>(j)));
-    delete site;
+  for (map<size_t, vector<size_t> >::const_iterator it = mPositions.begin(); it != mPositions.end(); it++)
+  {
+    const vector<size_t>& positions = it->second;
+
+    // All sites of a process are evolved at once, branch by branch:
+    unique_ptr<SiteContainer> psites(mProcess_.find(it->first)->second->simulate(positions.size()));
+
+    for (size_t vn = 0; vn < nbSeq; vn++)
+    {
+      const vector<int>& content = psites->getSequence(seqNames_[vn]).getContent();
+      Vint& dest = contents[vn];
+      for (size_t k = 0; k < positions.size(); k++)
+      {
+        dest[positions[k]] = content[k];
+      }
+    }
+  }
+
+  AlignedSequenceContainer* sites = new AlignedSequenceContainer(getAlphabet());
+  for (size_t vn = 0; vn < nbSeq; vn++)
+  {
+    sites->addSequence(BasicSequence(seqNames_[vn], contents[vn], getAlphabet()), false);
   }
   return sites;
 }
@@ -875,7 +1148,7 @@ SiteContainer* SubstitutionProcessSequenceSimulator::simulate(const vector<doubl
     for (size_t vn=0;vn<vPosNames.size(); vn++)
       vval[vn]=site->getValue(vPosNames[vn]);
     
-    sites->addSite(*new Site(vval,sites->getAlphabet(),static_cast<int>(j)));
+    sites->addSite(Site(vval,sites->getAlphabet(),static_cast<int>(j)));
     delete site;
   }
   return sites;
@@ -899,7 +1172,7 @@ SiteContainer* SubstitutionProcessSequenceSimulator::simulate(const vector<size_
     for (size_t vn=0;vn<vPosNames.size(); vn++)
       vval[vn]=site->getValue(vPosNames[vn]);
     
-    sites->addSite(*new Site(vval,sites->getAlphabet(),static_cast<int>(j)));
+    sites->addSite(Site(vval,sites->getAlphabet(),static_cast<int>(j)));
     delete site;
   }
   return sites;
@@ -926,7 +1199,7 @@ SiteContainer* SubstitutionProcessSequenceSimulator::simulate(const vector<doubl
     for (size_t vn=0;vn<vPosNames.size(); vn++)
       vval[vn]=site->getValue(vPosNames[vn]);
     
-    sites->addSite(*new Site(vval,sites->getAlphabet(),static_cast<int>(j)));
+    sites->addSite(Site(vval,sites->getAlphabet(),static_cast<int>(j)));
     delete site;
   }
   return sites;
@@ -43,7 +43,9 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "New_DetailedSiteSimulator.h"
 #include "SequenceSimulator.h"
+#include "CounterBasedRandomStream.h"
 #include "../NewLikelihood/ParametrizablePhyloTree.h"
+#include "../SiteLoopExecutor.h"
 #include "../Model/SubstitutionModel.h"
 
 #include <Bpp/Numeric/Random/RandomTools.h>
@@ -55,7 +57,10 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Seq/Container/SiteContainer.h>
 
 // From the STL:
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
 #include <vector>
 
 #include "../NewLikelihood/SubstitutionProcessCollection.h"
@@ -73,16 +78,23 @@ namespace bpp
   private:
     size_t state;
     std::vector<size_t> states;
-    VVVdouble cumpxy;
+
+    /**
+     * @brief Walker alias tables of the transition probabilities, for
+     * each rate class and initial state: state y is drawn with
+     * probability aliasProb[c][x][y], else aliasIndex[c][x][y].
+     */
+    VVVdouble aliasProb;
+    std::vector<std::vector<std::vector<size_t> > > aliasIndex;
     const SubstitutionProcess* process_;
     std::string name_;
     
   public:
-    SimProcessNode(): AwareNode(), state(), states(), cumpxy(), process_(0), name_() {}
+    SimProcessNode(): AwareNode(), state(), states(), aliasProb(), aliasIndex(), process_(0), name_() {}
     
-    SimProcessNode(const SimProcessNode& sd): AwareNode(sd), state(sd.state), states(sd.states), cumpxy(), process_(sd.process_), name_(sd.name_) {}
+    SimProcessNode(const SimProcessNode& sd): AwareNode(sd), state(sd.state), states(sd.states), aliasProb(), aliasIndex(), process_(sd.process_), name_(sd.name_) {}
 
-    SimProcessNode(const PhyloNode& pn): AwareNode(pn), state(), states(), cumpxy(), process_(), name_(pn.hasName()?pn.getName():"") {}
+    SimProcessNode(const PhyloNode& pn): AwareNode(pn), state(), states(), aliasProb(), aliasIndex(), process_(), name_(pn.hasName()?pn.getName():"") {}
 
     SimProcessNode& operator=(const SimProcessNode& sd)
     {
@@ -90,7 +102,8 @@ namespace bpp
       
       state  = sd.state;
       states = sd.states;
-      cumpxy = sd.cumpxy;
+      aliasProb = sd.aliasProb;
+      aliasIndex = sd.aliasIndex;
       process_ = sd.process_;
       return *this;
     }
@@ -150,6 +163,14 @@ namespace bpp
 
     // Should we ouptut internal sequences as well?
     bool outputInternalSequences_;
+
+    std::unique_ptr<SiteLoopExecutor> executor_;
+
+    /**
+     * @brief The jump chains of the Markovian models, built once by
+     * init() for detailed simulations.
+     */
+    std::map<const TransitionModel*, std::shared_ptr<const MutationProcess> > mutationProcesses_;
     
     /**
      * @name Stores intermediate results.
@@ -177,8 +198,12 @@ namespace bpp
       nbClasses_      (nhss.nbClasses_),
       nbStates_       (nhss.nbStates_),
       continuousRates_(nhss.continuousRates_),
-      outputInternalSequences_(nhss.outputInternalSequences_)
-    {}
+      outputInternalSequences_(nhss.outputInternalSequences_),
+      executor_(),
+      mutationProcesses_(nhss.mutationProcesses_)
+    {
+      setNumberOfThreads(nhss.getNumberOfThreads());
+    }
 
     SimpleSubstitutionProcessSequenceSimulator& operator=(const SimpleSubstitutionProcessSequenceSimulator& nhss)
     {
@@ -194,6 +219,8 @@ namespace bpp
       nbStates_        = nhss.nbStates_;
       continuousRates_ = nhss.continuousRates_;
       outputInternalSequences_ = nhss.outputInternalSequences_;
+      mutationProcesses_ = nhss.mutationProcesses_;
+      setNumberOfThreads(nhss.getNumberOfThreads());
       
       return *this;
     }
@@ -249,6 +276,63 @@ namespace bpp
      */
     SiteContainer* simulate(size_t numberOfSites) const;
     /** @} */
+
+    /**
+     * @brief Simulate sites with one random stream per site.
+     *
+     * All random numbers of site j are drawn from the
+     * CounterBasedRandomStream (seed, firstSite + j), and not from
+     * RandomTools, so that the alignment only depends on the seed. Sites
+     * are simulated concurrently if several threads were set, with the
+     * same result, and an alignment simulated by chunks is the same as
+     * when simulated at once.
+     *
+     * Continuous rates are not supported in this mode.
+     *
+     * @param numberOfSites The number of sites to simulate.
+     * @param seed The seed of the random streams.
+     * @param firstSite The position of the first simulated site in the whole alignment.
+     * @throw Exception If continuous rates are enabled.
+     */
+    SiteContainer* simulate(size_t numberOfSites, uint64_t seed, size_t firstSite = 0) const;
+
+    /**
+     * @brief Simulate several alignments of the same length, for
+     * parametric bootstrap for instance.
+     *
+     * Replicate r is the alignment given by simulate(numberOfSites,
+     * seed, r * numberOfSites), so that all replicates use independent
+     * random streams. The transition tables and the order of nodes are
+     * shared by all replicates, and replicates are distributed among the
+     * threads set, one replicate per thread at a time.
+     *
+     * @param numberOfReplicates The number of alignments to simulate.
+     * @param numberOfSites The number of sites of each alignment.
+     * @param seed The seed of the random streams.
+     * @param writer Called by the calling thread on each replicate index
+     * and alignment, in the replicate order. The alignment is deleted
+     * afterwards, so that at most one alignment per thread is in memory.
+     * @throw Exception If continuous rates are enabled.
+     */
+    void simulateReplicates(size_t numberOfReplicates, size_t numberOfSites, uint64_t seed, const std::function<void(size_t, const SiteContainer&)>& writer) const;
+
+    /**
+     * @brief Simulate several alignments of the same length in memory.
+     *
+     * @see simulateReplicates(numberOfReplicates, numberOfSites, seed, writer)
+     * @return The replicates, to be deleted by the caller.
+     */
+    std::vector<SiteContainer*> simulateReplicates(size_t numberOfReplicates, size_t numberOfSites, uint64_t seed) const;
+
+    /**
+     * @brief Set the number of threads used by simulate(numberOfSites,
+     * seed) and simulateReplicates (1 by default, ie no additional thread).
+     *
+     * @param nbThreads The total number of threads, including the calling one.
+     */
+    void setNumberOfThreads(size_t nbThreads);
+
+    size_t getNumberOfThreads() const { return executor_ ? executor_->getNumberOfThreads() : 1; }
     
     /**
      * @name SiteSimulator and SequenceSimulator interface
@@ -313,6 +397,54 @@ namespace bpp
      */
     void outputInternalSequences(bool yn) ;
     
+  private:
+    /**
+     * @brief Build the Walker alias table of a probability vector, which
+     * need not sum exactly to 1.
+     */
+    static void buildAliasTable_(const Vdouble& probs, Vdouble& aliasProb, std::vector<size_t>& aliasIndex);
+
+    /**
+     * @brief Draw a state in constant time from an alias table, with a
+     * single random number.
+     *
+     * @param u A number drawn uniformly in [0, n), n being the number of states.
+     */
+    static size_t drawFromAliasTable_(const Vdouble& aliasProb, const std::vector<size_t>& aliasIndex, double u);
+
+    /**
+     * @brief Run loop(first, last) on blocks of [0, n), on several threads if any.
+     */
+    void runParallelLoop_(size_t n, const std::function<void(size_t, size_t)>& loop) const;
+
+    /**
+     * @brief The nodes and output sequences of simulations with random
+     * streams, computed once for all sites and replicates.
+     */
+    struct StreamPlan_
+    {
+      std::vector<SimProcessNode*> nodes; // each one after its father
+      std::vector<size_t> fathers;
+      std::vector<std::shared_ptr<SimProcessNode> > outputNodes;
+      std::vector<size_t> rowNodes;
+      std::vector< std::vector<const TransitionModel*> > rowModels;
+    };
+
+    void buildStreamPlan_(StreamPlan_& plan) const;
+
+    /**
+     * @brief Simulate the sites j in [first, last) of contents, with
+     * the random stream (seed, firstSite + j).
+     */
+    void simulateStreams_(const StreamPlan_& plan, uint64_t seed, size_t firstSite, size_t first, size_t last, std::vector< std::vector<int> >& contents) const;
+
+    SiteContainer* buildStreamContainer_(const StreamPlan_& plan, const std::vector< std::vector<int> >& contents) const;
+
+    /**
+     * @brief Simulate replicates, and give each one to output, which takes its ownership.
+     */
+    void simulateReplicates_(size_t numberOfReplicates, size_t numberOfSites, uint64_t seed, const std::function<void(size_t, SiteContainer*)>& output) const;
+
   protected:
     
     /**
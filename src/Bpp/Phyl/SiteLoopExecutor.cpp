@@ -0,0 +1,172 @@
+//
+// File: SiteLoopExecutor.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "SiteLoopExecutor.h"
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+SiteLoopExecutor::SiteLoopExecutor(size_t nbThreads) :
+  threads_(),
+  mutex_(),
+  workAvailable_(),
+  workDone_(),
+  loop_(0),
+  nbSites_(0),
+  generation_(0),
+  nbRunning_(0),
+  stopping_(false),
+  exception_()
+{
+  for (size_t block = 1; block < nbThreads; block++)
+  {
+    threads_.emplace_back(&SiteLoopExecutor::workerLoop_, this, block);
+  }
+}
+
+/******************************************************************************/
+
+SiteLoopExecutor::~SiteLoopExecutor()
+{
+  {
+    lock_guard<mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  workAvailable_.notify_all();
+  for (size_t i = 0; i < threads_.size(); i++)
+  {
+    threads_[i].join();
+  }
+}
+
+/******************************************************************************/
+
+void SiteLoopExecutor::run(size_t nbSites, const std::function<void(size_t, size_t)>& loop)
+{
+  if (threads_.empty())
+  {
+    if (nbSites > 0)
+      loop(0, nbSites);
+    return;
+  }
+
+  bool busy;
+  {
+    lock_guard<mutex> lock(mutex_);
+    busy = (loop_ != 0);
+    if (!busy)
+    {
+      loop_ = &loop;
+      nbSites_ = nbSites;
+      nbRunning_ = threads_.size();
+      exception_ = exception_ptr();
+      generation_++;
+    }
+  }
+  if (busy)
+  {
+    // Called from a running loop, or concurrently: the pool is not available.
+    if (nbSites > 0)
+      loop(0, nbSites);
+    return;
+  }
+  workAvailable_.notify_all();
+
+  runBlock_(0);
+
+  unique_lock<mutex> lock(mutex_);
+  workDone_.wait(lock, [this] { return nbRunning_ == 0; });
+  loop_ = 0;
+  if (exception_)
+  {
+    exception_ptr e = exception_;
+    exception_ = exception_ptr();
+    rethrow_exception(e);
+  }
+}
+
+/******************************************************************************/
+
+void SiteLoopExecutor::workerLoop_(size_t block)
+{
+  size_t seenGeneration = 0;
+  while (true)
+  {
+    {
+      unique_lock<mutex> lock(mutex_);
+      workAvailable_.wait(lock, [this, seenGeneration] { return stopping_ || generation_ != seenGeneration; });
+      if (stopping_)
+        return;
+      seenGeneration = generation_;
+    }
+
+    runBlock_(block);
+
+    {
+      lock_guard<mutex> lock(mutex_);
+      nbRunning_--;
+    }
+    workDone_.notify_one();
+  }
+}
+
+/******************************************************************************/
+
+void SiteLoopExecutor::runBlock_(size_t block)
+{
+  size_t first = getBlockBegin(block, nbSites_);
+  size_t last = getBlockBegin(block + 1, nbSites_);
+  if (first == last)
+    return;
+  try
+  {
+    (*loop_)(first, last);
+  }
+  catch (...)
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (!exception_)
+      exception_ = current_exception();
+  }
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,126 @@
+//
+// File: SiteLoopExecutor.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _SITELOOPEXECUTOR_H_
+#define _SITELOOPEXECUTOR_H_
+
+// From the STL:
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief A pool of threads running loops over sites.
+ *
+ * The range of sites is cut into one contiguous block per thread, the
+ * calling thread processing the first one. Blocks only depend on the
+ * number of sites and the number of threads, and each site is computed
+ * by the same code whatever the block it belongs to, so that results do
+ * not depend on the scheduling of threads.
+ *
+ * Threads are created once in the constructor and wait for work between
+ * two loops. A loop started while another one is running, either from
+ * inside it or from another thread, is run by its calling thread alone.
+ */
+class SiteLoopExecutor
+{
+private:
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable workAvailable_;
+  std::condition_variable workDone_;
+
+  const std::function<void(size_t, size_t)>* loop_;
+  size_t nbSites_;
+  size_t generation_;
+  size_t nbRunning_;
+  bool stopping_;
+  std::exception_ptr exception_;
+
+public:
+  /**
+   * @brief Build a new executor.
+   *
+   * @param nbThreads The total number of threads used by loops, including the calling thread (at least 1).
+   */
+  explicit SiteLoopExecutor(size_t nbThreads);
+
+  virtual ~SiteLoopExecutor();
+
+  SiteLoopExecutor(const SiteLoopExecutor&) = delete;
+  SiteLoopExecutor& operator=(const SiteLoopExecutor&) = delete;
+
+public:
+  size_t getNumberOfThreads() const { return threads_.size() + 1; }
+
+  /**
+   * @brief Run a loop over sites.
+   *
+   * @param nbSites The number of sites.
+   * @param loop A function computing sites in [first, last), called once per non empty block.
+   * If it throws in any thread, the first exception is rethrown once all blocks are done.
+   */
+  void run(size_t nbSites, const std::function<void(size_t, size_t)>& loop);
+
+  /**
+   * @return The first site of a block.
+   *
+   * @param block The block index, up to the number of threads (which gives nbSites).
+   * @param nbSites The number of sites.
+   */
+  size_t getBlockBegin(size_t block, size_t nbSites) const
+  {
+    return block * nbSites / getNumberOfThreads();
+  }
+
+private:
+  void workerLoop_(size_t block);
+  void runBlock_(size_t block);
+};
+} // end of namespace bpp.
+
+#endif // _SITELOOPEXECUTOR_H_
+
@@ -60,13 +60,52 @@ SitePatterns::SitePatterns(const AlignedValuesContainer* sequences, bool own) :
   own_(own)
 {
   size_t nbSites = sequences->getNumberOfSites();
+  size_t nbSequences = sequences->getNumberOfSequences();
   vector<SortableSite> ss(nbSites);
+
+  // Probabilistic sites are keyed by codes rather than by their text:
+  bool coded = (dynamic_cast<const SiteContainer*>(sequences) == 0);
+  size_t nbStates = coded ? alpha_->getSize() : 0;
+  map<Vdouble, unsigned int> profileIndex;
+  Vdouble profile(nbStates);
+
   for (size_t i = 0; i < nbSites; i++)
   {
     const CruxSymbolListSite* currentSite = own?sequences->getSymbolListSite(i).clone():&sequences->getSymbolListSite(i);
     
     SortableSite* ssi = &ss[i];
-    ssi->siteS = currentSite->toString();
+    if (coded)
+    {
+      ssi->siteC.resize(nbSequences);
+      for (size_t j = 0; j < nbSequences; j++)
+      {
+        size_t certain = nbStates;
+        size_t nbNonZero = 0;
+        for (size_t s = 0; s < nbStates; s++)
+        {
+          profile[s] = sequences->getStateValueAt(i, j, static_cast<int>(s));
+          if (profile[s] != 0)
+          {
+            nbNonZero++;
+            certain = s;
+          }
+        }
+        if (nbNonZero == 1 && profile[certain] == 1)
+          ssi->siteC[j] = static_cast<unsigned int>(certain);
+        else
+        {
+          map<Vdouble, unsigned int>::const_iterator it = profileIndex.find(profile);
+          unsigned int code = static_cast<unsigned int>(profileIndex.size());
+          if (it == profileIndex.end())
+            profileIndex[profile] = code;
+          else
+            code = it->second;
+          ssi->siteC[j] = static_cast<unsigned int>(nbStates) + code;
+        }
+      }
+    }
+    else
+      ssi->siteS = currentSite->toString();
     ssi->siteP = currentSite;
     ssi->originalPosition = i;
   }
@@ -91,7 +130,7 @@ SitePatterns::SitePatterns(const AlignedValuesContainer* sequences, bool own) :
       SortableSite* ssi = &ss[i];
       const CruxSymbolListSite* currentSite = ssi->siteP;
 
-      bool siteExists = SymbolListTools::areSymbolListsIdentical(*currentSite, *previousSite);
+      bool siteExists = coded ? (ssi->siteC == ss[i - 1].siteC) : SymbolListTools::areSymbolListsIdentical(*currentSite, *previousSite);
       if (siteExists)
       {
         weights_[currentPos]++;
@@ -77,21 +77,28 @@ namespace bpp
     {
     public:
       std::string siteS; 
+      /**
+       * @brief Key of a probabilistic site: one code per sequence, the
+       * state index for a certain character, or the number of states plus
+       * the index of the probability vector in a table of distinct vectors.
+       */
+      std::vector<unsigned int> siteC;
       const CruxSymbolListSite* siteP;
       size_t originalPosition;
 	    
     public:
-      SortableSite() : siteS(), siteP(0), originalPosition(0) {}
-      SortableSite(const SortableSite& ss) : siteS(ss.siteS), siteP(ss.siteP), originalPosition(ss.originalPosition) {}
+      SortableSite() : siteS(), siteC(), siteP(0), originalPosition(0) {}
+      SortableSite(const SortableSite& ss) : siteS(ss.siteS), siteC(ss.siteC), siteP(ss.siteP), originalPosition(ss.originalPosition) {}
       SortableSite& operator=(const SortableSite& ss)
       {
         siteS = ss.siteS;
+        siteC = ss.siteC;
         siteP = ss.siteP;
         originalPosition = ss.originalPosition;
         return *this;
       }
 
-      bool operator<(const SortableSite& ss) const { return siteS < ss.siteS; }
+      bool operator<(const SortableSite& ss) const { return siteS < ss.siteS || (siteS == ss.siteS && siteC < ss.siteC); }
 
       virtual ~SortableSite() {}
     };
@@ -118,6 +125,9 @@ namespace bpp
      * @brief Build a new SitePattern object.
      *
      * Look for patterns (unique sites) within a site container.
+     * Sites of a probabilistic container are compared through integer codes:
+     * certain characters are coded by their state, and uncertain ones by
+     * their index in a table of the distinct probability vectors.
      *
      * @param sequences The container to look in.
      * @param own       Tel is the class own the sequence container.
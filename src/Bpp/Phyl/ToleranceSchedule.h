@@ -0,0 +1,98 @@
+//
+// File: ToleranceSchedule.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _TOLERANCESCHEDULE_H_
+#define _TOLERANCESCHEDULE_H_
+
+// From the STL:
+#include <algorithm>
+#include <cmath>
+
+namespace bpp
+{
+
+  /**
+   * @brief Tolerances of successive optimization rounds, from loose to tight.
+   *
+   * The first round is run with the initial tolerance. After each round, the
+   * tolerance is divided by a constant factor, and it is also brought down to a
+   * fraction of the improvement of the function during the round: precision
+   * increases faster as the rounds stop improving. Rounds go on until one is
+   * run at the final tolerance.
+   *
+   * @see OptimizationTools::optimizeNumericalParameters
+   */
+  class ToleranceSchedule
+  {
+  private:
+    double initialTolerance_;
+    double factor_;
+    double deltaFactor_;
+
+  public:
+    /**
+     * @param initialTolerance The tolerance of the first round.
+     * @param factor           The tolerance is multiplied by this factor after each round.
+     * @param deltaFactor      The tolerance of the next round is at most this fraction
+     *                         of the improvement obtained during the last round.
+     */
+    ToleranceSchedule(double initialTolerance, double factor = 0.1, double deltaFactor = 0.1) :
+      initialTolerance_(initialTolerance),
+      factor_(factor),
+      deltaFactor_(deltaFactor)
+    {}
+
+  public:
+    double getInitialTolerance() const { return initialTolerance_; }
+
+    /**
+     * @param tolerance      The tolerance of the last round.
+     * @param delta          The decrease of the function during the last round.
+     * @param finalTolerance The tolerance of the last round of the schedule.
+     * @return The tolerance of the next round.
+     */
+    double getNextTolerance(double tolerance, double delta, double finalTolerance) const
+    {
+      return std::max(finalTolerance, std::min(tolerance * factor_, std::abs(delta) * deltaFactor_));
+    }
+  };
+
+} // end of namespace bpp.
+
+#endif // _TOLERANCESCHEDULE_H_
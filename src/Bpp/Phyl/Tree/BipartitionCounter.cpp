@@ -0,0 +1,192 @@
+//
+// File: BipartitionCounter.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "BipartitionCounter.h"
+#include "TreeTools.h"
+
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/App/ApplicationTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <cmath>
+#include <climits> // defines CHAR_BIT
+
+using namespace std;
+
+/******************************************************************************/
+
+void BipartitionCounter::addTree(const Tree& tree)
+{
+  BipartitionList bipL(tree, true);
+  if (nbTrees_ == 0)
+    elements_ = bipL.getElementNames();
+  else if (bipL.getElementNames() != elements_)
+    throw Exception("BipartitionCounter::addTree. Distinct leaf sets between trees.");
+  bipL.removeTrivialBipartitions();
+
+  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
+  size_t nbword = (elements_.size() + lword - 1) / lword;
+  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
+  const vector<int*>& bitBipL = bipL.getBitBipartitionList();
+  for (size_t i = 0; i < bitBipL.size(); i++)
+  {
+    SplitCount_& split = splits_[BipartitionTools::getCanonicalWords(bitBipL[i], elements_.size())];
+    split.bits.assign(bitBipL[i], bitBipL[i] + nbint);
+    split.count++;
+    split.lastTree = nbTrees_;
+    split.lastPosition = i;
+  }
+  nbTrees_++;
+}
+
+/******************************************************************************/
+
+size_t BipartitionCounter::getNumberOfOccurrences(const BipartitionList& bipL, size_t i) const
+{
+  if (i >= bipL.getNumberOfBipartitions())
+    throw Exception("BipartitionCounter::getNumberOfOccurrences. Bipartition index exceeds BipartitionList size");
+  if (bipL.getPartitionSize(i) < 2)
+    return nbTrees_;
+  auto it = splits_.find(BipartitionTools::getCanonicalWords(bipL.getBitBipartitionList()[i], elements_.size()));
+  return it == splits_.end() ? 0 : it->second.count;
+}
+
+/******************************************************************************/
+
+BipartitionList* BipartitionCounter::getBipartitionOccurrences(vector<size_t>& bipScore) const
+{
+  //Sort splits by last occurrence, as when they are merged from all trees:
+  vector<const SplitCount_*> sorted;
+  sorted.reserve(splits_.size());
+  for (auto& it : splits_)
+  {
+    sorted.push_back(&it.second);
+  }
+  sort(sorted.begin(), sorted.end(), [](const SplitCount_* s1, const SplitCount_* s2) {
+      return s1->lastTree < s2->lastTree || (s1->lastTree == s2->lastTree && s1->lastPosition < s2->lastPosition);
+    });
+
+  vector<int*> bitBipL(sorted.size());
+  bipScore.clear();
+  for (size_t i = 0; i < sorted.size(); i++)
+  {
+    bitBipL[i] = const_cast<int*>(&sorted[i]->bits[0]);
+    bipScore.push_back(sorted[i]->count);
+  }
+  //The list constructor copies the arrays:
+  BipartitionList* bipL = new BipartitionList(elements_, bitBipL);
+
+  /* add terminal branches */
+  bipL->addTrivialBipartitions(false);
+  for (size_t i = 0; i < elements_.size(); i++)
+  {
+    bipScore.push_back(nbTrees_);
+  }
+  return bipL;
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* BipartitionCounter::thresholdConsensus(double threshold) const
+{
+  if (nbTrees_ == 0)
+    throw Exception("BipartitionCounter::thresholdConsensus. No tree was added");
+
+  vector<size_t> bipScore;
+  BipartitionList* bipL = getBipartitionOccurrences(bipScore);
+  double score;
+
+  for (size_t i = bipL->getNumberOfBipartitions(); i > 0; i--)
+  {
+    if (bipL->getPartitionSize(i - 1) == 1)
+      continue;
+    score = static_cast<int>(bipScore[i - 1]) / static_cast<double>(nbTrees_);
+    if (score <= threshold && score != 1.)
+    {
+      bipL->deleteBipartition(i - 1);
+      continue;
+    }
+    if (score > 0.5)
+      continue;
+    for (size_t j = bipL->getNumberOfBipartitions(); j > i; j--)
+    {
+      if (!bipL->areCompatible(i - 1, j - 1))
+      {
+        bipL->deleteBipartition(i - 1);
+        break;
+      }
+    }
+  }
+
+  TreeTemplate<Node>* tr = bipL->toTree();
+  delete bipL;
+  return tr;
+}
+
+/******************************************************************************/
+
+void BipartitionCounter::computeBootstrapValues(Tree& tree, bool verbose, int format) const
+{
+  vector<int> index;
+  BipartitionList bpTree(tree, true, &index);
+  if (nbTrees_ > 0 && bpTree.getElementNames() != elements_)
+    throw Exception("BipartitionCounter::computeBootstrapValues. Distinct leaf sets between trees.");
+
+  vector< Number<double> > bootstrapValues(bpTree.getNumberOfBipartitions());
+
+  for (size_t i = 0; i < bpTree.getNumberOfBipartitions(); i++)
+  {
+    if (verbose)
+      ApplicationTools::displayGauge(i, bpTree.getNumberOfBipartitions() - 1, '=');
+    size_t occurences = getNumberOfOccurrences(bpTree, i);
+    if (occurences > 0)
+      bootstrapValues[i] = format >= 0 ? round(static_cast<double>(occurences) * pow(10., 2 + format) / static_cast<double>(nbTrees_)) / pow(10., format) : static_cast<double>(occurences);
+  }
+
+  for (size_t i = 0; i < index.size(); i++)
+  {
+    if (!tree.isLeaf(index[i]))
+      tree.setBranchProperty(index[i], TreeTools::BOOTSTRAP, bootstrapValues[i]);
+  }
+}
+
+/******************************************************************************/
+
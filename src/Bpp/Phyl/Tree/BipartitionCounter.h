@@ -0,0 +1,159 @@
+//
+// File: BipartitionCounter.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _BIPARTITIONCOUNTER_H_
+#define _BIPARTITIONCOUNTER_H_
+
+#include "BipartitionList.h"
+#include "BipartitionTools.h"
+#include "TreeTemplate.h"
+
+// From the STL:
+#include <unordered_map>
+
+namespace bpp
+{
+
+/**
+ * @brief Incremental counting of bipartitions over a stream of trees.
+ *
+ * Trees are added one at a time, and only the distinct non-trivial bipartitions
+ * seen so far are stored, together with their number of occurrences. Memory therefore
+ * does not depend on the number of trees, which can be read and discarded on the fly:
+ * @code
+ * Newick reader;
+ * ifstream in("bootstrap.dnd");
+ * BipartitionCounter counter;
+ * TreeTemplate<Node>* tree;
+ * while ((tree = reader.readNextTree(in)))
+ * {
+ *   counter.addTree(*tree);
+ *   delete tree;
+ * }
+ * TreeTemplate<Node>* consensus = counter.thresholdConsensus(0.5);
+ * @endcode
+ *
+ * Bipartitions are identified by their canonical words (see BipartitionTools::getCanonicalWords),
+ * and are stored in a hash table. All trees must share the same set of leaves.
+ *
+ * @see TreeTools::bipartitionOccurrences
+ * @see TreeTools::thresholdConsensus
+ * @see TreeTools::computeBootstrapValues
+ */
+class BipartitionCounter
+{
+  private:
+    struct SplitCount_
+    {
+      std::vector<int> bits;  // Bit array of the last occurrence.
+      size_t count;
+      size_t lastTree;        // Tree and position of the last occurrence, used for ordering.
+      size_t lastPosition;
+
+      SplitCount_() : bits(), count(0), lastTree(0), lastPosition(0) {}
+    };
+
+    std::vector<std::string> elements_;
+    size_t nbTrees_;
+    std::unordered_map<std::vector<uint64_t>, SplitCount_, BipartitionTools::CanonicalWordsHash> splits_;
+
+  public:
+    BipartitionCounter() :
+      elements_(),
+      nbTrees_(0),
+      splits_()
+    {}
+
+    virtual ~BipartitionCounter() {}
+
+  public:
+    /**
+     * @brief Count the bipartitions of a new tree.
+     *
+     * @param tree The tree to add.
+     * @throw Exception If the tree does not have the same leaves as the previous ones.
+     */
+    void addTree(const Tree& tree);
+
+    size_t getNumberOfTrees() const { return nbTrees_; }
+
+    size_t getNumberOfDistinctBipartitions() const { return splits_.size(); }
+
+    const std::vector<std::string>& getElementNames() const { return elements_; }
+
+    /**
+     * @brief Get the number of trees containing a given bipartition.
+     *
+     * @param bipL A list sharing the same (ordered) elements as this counter.
+     * @param i The index of the bipartition in bipL.
+     * @return The number of occurrences, 0 if the bipartition was never seen.
+     */
+    size_t getNumberOfOccurrences(const BipartitionList& bipL, size_t i) const;
+
+    /**
+     * @brief Get the list of distinct bipartitions and their number of occurrences.
+     *
+     * The output is the same as TreeTools::bipartitionOccurrences applied to all trees added so far:
+     * non-trivial bipartitions come first, followed by the trivial ones, which occur in all trees.
+     *
+     * @param bipScore Output as the numbers of occurrences of the returned bipartitions.
+     * @return A BipartitionList object including only distinct bipartitions.
+     */
+    BipartitionList* getBipartitionOccurrences(std::vector<size_t>& bipScore) const;
+
+    /**
+     * @brief Greedy consensus of all trees added so far.
+     *
+     * @param threshold Minimal acceptable score = number of occurrence of a bipartition / number of trees (0. <= threshold <= 1.)
+     * @see TreeTools::thresholdConsensus
+     */
+    TreeTemplate<Node>* thresholdConsensus(double threshold) const;
+
+    /**
+     * @brief Annotate a tree with the support of its bipartitions in all trees added so far.
+     *
+     * @see TreeTools::computeBootstrapValues
+     */
+    void computeBootstrapValues(Tree& tree, bool verbose = true, int format = 0) const;
+};
+
+} //end of namespace bpp.
+
+#endif //_BIPARTITIONCOUNTER_H_
+
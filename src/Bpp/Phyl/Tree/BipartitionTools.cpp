@@ -123,6 +123,49 @@ bool BipartitionTools::testBit(int* plist, int num)
 
 /******************************************************************************/
 
+vector<uint64_t> BipartitionTools::getCanonicalWords(const int* list, size_t nbElements)
+{
+  const size_t intBits = CHAR_BIT * sizeof(int);
+  const size_t nbInt = (nbElements + intBits - 1) / intBits;
+  vector<uint64_t> words((nbElements + 63) / 64, 0);
+  for (size_t k = 0; k < nbInt; k++)
+  {
+    size_t offset = k * intBits;
+    words[offset / 64] |= static_cast<uint64_t>(static_cast<unsigned int>(list[k])) << (offset % 64);
+  }
+  if (words.empty())
+    return words;
+  //Choose the representative which does not contain element 0:
+  if (words[0] & 1)
+  {
+    for (size_t w = 0; w < words.size(); w++)
+    {
+      words[w] = ~words[w];
+    }
+  }
+  size_t tail = nbElements % 64;
+  if (tail != 0)
+    words.back() &= (static_cast<uint64_t>(1) << tail) - 1;
+  return words;
+}
+
+/******************************************************************************/
+
+size_t BipartitionTools::CanonicalWordsHash::operator()(const vector<uint64_t>& words) const
+{
+  uint64_t h = 0;
+  for (size_t w = 0; w < words.size(); w++)
+  {
+    uint64_t z = words[w] + 0x9e3779b97f4a7c15ULL * (w + 1);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    h ^= z ^ (z >> 31);
+  }
+  return static_cast<size_t>(h);
+}
+
+/******************************************************************************/
+
 BipartitionList* BipartitionTools::buildBipartitionPair(
   const BipartitionList& bipartL1, size_t i1,
   const BipartitionList& bipartL2, size_t i2,
@@ -263,59 +306,114 @@ BipartitionList* BipartitionTools::mergeBipartitionLists(
 
 /******************************************************************************/
 
-VectorSiteContainer* BipartitionTools::MRPEncode(
-  const vector<BipartitionList*>& vecBipartL)
+void BipartitionTools::MRPEncode_(
+  const vector<BipartitionList*>& vecBipartL,
+  bool multilabel,
+  vector<string>& names,
+  vector<string>& sequences)
 {
-  vector<string> all_elements;
-  map<string, bool> bip;
-  vector<string> bip_elements;
-  const DNA* alpha = &AlphabetTools::DNA_ALPHABET;
-  vector<string> sequences;
-
   if (vecBipartL.size() == 0)
     throw Exception("Empty vector passed");
 
   vector< vector<string> > vecElementLists;
+  size_t nbBipartitions = 0;
   for (size_t i = 0; i < vecBipartL.size(); i++)
   {
     vecElementLists.push_back(vecBipartL[i]->getElementNames());
+    nbBipartitions += vecBipartL[i]->getNumberOfBipartitions();
   }
 
-  all_elements = VectorTools::vectorUnion(vecElementLists);
+  names = VectorTools::vectorUnion(vecElementLists);
+  map<string, size_t> rows;
+  for (size_t k = 0; k < names.size(); k++)
+  {
+    rows[names[k]] = k;
+  }
 
-  sequences.resize(all_elements.size());
+  sequences.assign(names.size(), string());
+  for (size_t k = 0; k < names.size(); k++)
+  {
+    sequences[k].reserve(nbBipartitions);
+  }
 
+  // One column per bipartition, read directly from the bit arrays:
+  vector<char> column(names.size(), 'N');
   for (size_t i = 0; i < vecBipartL.size(); i++)
   {
-    for (size_t j = 0; j < vecBipartL[i]->getNumberOfBipartitions(); j++)
+    const vector<string>& elements = vecElementLists[i];
+    vector<size_t> rowOfElement(elements.size());
+    for (size_t e = 0; e < elements.size(); e++)
     {
-      bip = vecBipartL[i]->getBipartition(j);
-      bip_elements = MapTools::getKeys(bip);
-
-      for (size_t k = 0; k < all_elements.size(); k++)
+      rowOfElement[e] = rows[elements[e]];
+    }
+    const vector<int*>& bits = vecBipartL[i]->getBitBipartitionList();
+    for (size_t j = 0; j < bits.size(); j++)
+    {
+      bool conflict = false;
+      for (size_t e = 0; e < elements.size(); e++)
       {
-        if (VectorTools::contains(bip_elements, all_elements[k]))
+        char c = testBit(bits[j], static_cast<int>(e)) ? 'C' : 'A';
+        char& current = column[rowOfElement[e]];
+        // Check for multilabel trees: if a taxa found on both sides, do not consider the entire bipartition
+        if (current != 'N' && current != c)
+          conflict = true;
+        current = c;
+      }
+      if (multilabel && conflict)
+      {
+        for (size_t e = 0; e < elements.size(); e++)
         {
-          if (bip[all_elements[k]])
-            sequences[k].push_back('C');
-          else
-            sequences[k].push_back('A');
+          column[rowOfElement[e]] = 'N';
         }
-        else
-          sequences[k].push_back('N');
+      }
+      for (size_t k = 0; k < names.size(); k++)
+      {
+        sequences[k].push_back(column[k]);
+      }
+      for (size_t e = 0; e < elements.size(); e++)
+      {
+        column[rowOfElement[e]] = 'N';
       }
     }
   }
+}
 
+/******************************************************************************/
+
+VectorSiteContainer* BipartitionTools::MRPEncode(
+  const vector<BipartitionList*>& vecBipartL)
+{
+  vector<string> all_elements;
+  vector<string> sequences;
+  MRPEncode_(vecBipartL, false, all_elements, sequences);
+  return makeMRPSites_(all_elements, sequences);
+}
+
+/******************************************************************************/
+
+VectorSiteContainer* BipartitionTools::MRPEncodeMultilabel(
+                                                 const vector<BipartitionList*>& vecBipartL)
+{
+  vector<string> all_elements;
+  vector<string> sequences;
+  MRPEncode_(vecBipartL, true, all_elements, sequences);
+  return makeMRPSites_(all_elements, sequences);
+}
+
+/******************************************************************************/
+
+VectorSiteContainer* BipartitionTools::makeMRPSites_(const vector<string>& names, const vector<string>& sequences)
+{
+  const DNA* alpha = &AlphabetTools::DNA_ALPHABET;
   vector<const Sequence*> vec_sequences;
-  for (size_t i = 0; i < all_elements.size(); i++)
+  for (size_t i = 0; i < names.size(); i++)
   {
-    const Sequence* seq = new BasicSequence(all_elements[i], sequences[i], alpha);
+    const Sequence* seq = new BasicSequence(names[i], sequences[i], alpha);
     vec_sequences.push_back(seq);
   }
 
   VectorSequenceContainer vec_seq_cont(vec_sequences, alpha);
-  for (size_t i = 0; i < all_elements.size(); i++)
+  for (size_t i = 0; i < names.size(); i++)
   {
     delete vec_sequences[i];
   }
@@ -327,90 +425,4 @@ VectorSiteContainer* BipartitionTools::MRPEncode(
 
 /******************************************************************************/
 
-VectorSiteContainer* BipartitionTools::MRPEncodeMultilabel(
-                                                 const vector<BipartitionList*>& vecBipartL)
-{
-    vector<string> all_elements;
-    map<string, bool> bip;
-    vector<string> bip_elements;
-    const DNA* alpha = &AlphabetTools::DNA_ALPHABET;
-    vector<string> sequences;
-    
-    if (vecBipartL.size() == 0)
-        throw Exception("Empty vector passed");
-    
-    vector< vector<string> > vecElementLists;
-    for (size_t i = 0; i < vecBipartL.size(); i++)
-    {
-        vecElementLists.push_back(vecBipartL[i]->getElementNames());
-    }
-    
-    all_elements = VectorTools::vectorUnion(vecElementLists);
-    
-    sequences.resize(all_elements.size());
-    
-    for (size_t i = 0; i < vecBipartL.size(); i++)
-    {
-        for (size_t j = 0; j < vecBipartL[i]->getNumberOfBipartitions(); j++)
-        {
-            bip = vecBipartL[i]->getBipartition(j);
-            bip_elements = MapTools::getKeys(bip);
-            //Check for multilabel trees: if a taxa found on both sides, do not consider the entire bipartition
-            vector< string > zeroes;
-            vector< string > ones;
-            for (size_t k = 0; k < all_elements.size(); k++)
-            {
-                if (VectorTools::contains(bip_elements, all_elements[k]))
-                {
-                    if (bip[all_elements[k]])
-                        ones.push_back(all_elements[k]);
-                    else
-                        zeroes.push_back(all_elements[k]);
-                }
-            }
-            vector<string> inter = VectorTools::vectorIntersection(ones, zeroes);
-            if (inter.size() != 0) { //some taxa found on both sides of the bipartition
-                for (size_t k = 0; k < all_elements.size(); k++)
-                {
-                    sequences[k].push_back('N');
-                }
-            }
-            else
-            {
-                for (size_t k = 0; k < all_elements.size(); k++)
-                {
-                    if (VectorTools::contains(bip_elements, all_elements[k]))
-                    {
-                        if (bip[all_elements[k]])
-                            sequences[k].push_back('C');
-                        else
-                            sequences[k].push_back('A');
-                    }
-                    else
-                        sequences[k].push_back('N');
-                }
-            }
-        }
-    }
-    
-    vector<const Sequence*> vec_sequences;
-    for (size_t i = 0; i < all_elements.size(); i++)
-    {
-        const Sequence* seq = new BasicSequence(all_elements[i], sequences[i], alpha);
-        vec_sequences.push_back(seq);
-    }
-    
-    VectorSequenceContainer vec_seq_cont(vec_sequences, alpha);
-    for (size_t i = 0; i < all_elements.size(); i++)
-    {
-        delete vec_sequences[i];
-    }
-    
-    VectorSiteContainer* vec_site_cont = new VectorSiteContainer(vec_seq_cont);
-    
-    return vec_site_cont;
-}
-
-/******************************************************************************/
-
 
@@ -45,6 +45,10 @@
 // From bpp-seq:
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 
+// From the STL:
+#include <cstdint>
+#include <vector>
+
 namespace bpp
 {
 /**
@@ -133,6 +137,32 @@ public:
    */
   static bool testBit(int* list, int num);
 
+  /**
+   * @brief Pack the first nbElements bits of a bit array into 64-bit words, in canonical form.
+   *
+   * A bipartition and its complement describe the same split: the returned
+   * words are complemented if needed so that bit 0 is always zero, and bits
+   * beyond nbElements are cleared. Two bipartitions over the same (ordered)
+   * set of elements are identical if and only if their canonical words are equal.
+   *
+   * @param list The input array of bits.
+   * @param nbElements The number of meaningful bits in list.
+   * @return A vector of (nbElements + 63) / 64 words.
+   */
+  static std::vector<uint64_t> getCanonicalWords(const int* list, size_t nbElements);
+
+  /**
+   * @brief Hash functor for canonical words, to be used with unordered containers.
+   *
+   * Each word is mixed with a position-dependent random key (splitmix64
+   * finalizer) and the results are xor-ed, Zobrist-style, so that hashing
+   * a bipartition costs one pass over its packed words.
+   */
+  struct CanonicalWordsHash
+  {
+    size_t operator()(const std::vector<uint64_t>& words) const;
+  };
+
   /**
    * @brief Makes one BipartitionList out of several
    *
@@ -174,6 +204,26 @@ public:
      */
     static VectorSiteContainer* MRPEncodeMultilabel(                                                                     const std::vector<BipartitionList*>& vecBipartL);
 
+private:
+  /**
+   * @brief Compute the sequences of the MRP encoding, one character per bipartition.
+   *
+   * Characters are read from the bit arrays of the bipartitions, each element of a list
+   * being mapped once to its row in the output.
+   *
+   * @param vecBipartL The input bipartition lists.
+   * @param multilabel Tell if bipartitions with an element on both sides must be coded as missing data.
+   * @param names The union of all elements, in the order of the output rows.
+   * @param sequences The output sequences, made of A, C and N.
+   */
+  static void MRPEncode_(
+    const std::vector<BipartitionList*>& vecBipartL,
+    bool multilabel,
+    std::vector<std::string>& names,
+    std::vector<std::string>& sequences);
+
+  static VectorSiteContainer* makeMRPSites_(const std::vector<std::string>& names, const std::vector<std::string>& sequences);
+
 };
 } // end of namespace bpp.
 
@@ -0,0 +1,197 @@
+//
+// File: FlatTopology.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "FlatTopology.h"
+#include "TreeExceptions.h"
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+
+using namespace std;
+
+const size_t FlatTopology::NO_FATHER = static_cast<size_t>(-1);
+
+/******************************************************************************/
+
+FlatTopology::FlatTopology(const Tree& tree) :
+  nodeIds_(),
+  branchIds_(),
+  fathers_(),
+  sonsBegin_(),
+  sons_(),
+  branchLengths_(),
+  hasBranchLength_(),
+  postorder_(),
+  indexes_()
+{
+  //Iterative preorder traversal, sons being visited in their original order:
+  vector<pair<int, size_t> > stack(1, make_pair(tree.getRootId(), NO_FATHER));
+  while (!stack.empty())
+  {
+    int id = stack.back().first;
+    fathers_.push_back(stack.back().second);
+    stack.pop_back();
+    size_t index = nodeIds_.size();
+    nodeIds_.push_back(id);
+    branchIds_.push_back(tree.hasFather(id) ? id : -1);
+    bool hasLength = tree.hasFather(id) && tree.hasDistanceToFather(id);
+    hasBranchLength_.push_back(hasLength);
+    branchLengths_.push_back(hasLength ? tree.getDistanceToFather(id) : 0.);
+    vector<int> sonsId = tree.getSonsId(id);
+    for (size_t k = sonsId.size(); k > 0; k--)
+    {
+      stack.push_back(make_pair(sonsId[k - 1], index));
+    }
+  }
+  finalize_();
+}
+
+/******************************************************************************/
+
+FlatTopology::FlatTopology(const PhyloTree& tree) :
+  nodeIds_(),
+  branchIds_(),
+  fathers_(),
+  sonsBegin_(),
+  sons_(),
+  branchLengths_(),
+  hasBranchLength_(),
+  postorder_(),
+  indexes_()
+{
+  vector<pair<shared_ptr<PhyloNode>, size_t> > stack(1, make_pair(tree.getRoot(), NO_FATHER));
+  while (!stack.empty())
+  {
+    shared_ptr<PhyloNode> node = stack.back().first;
+    size_t father = stack.back().second;
+    fathers_.push_back(father);
+    stack.pop_back();
+    size_t index = nodeIds_.size();
+    nodeIds_.push_back(static_cast<int>(tree.getNodeIndex(node)));
+    bool hasLength = false;
+    double length = 0.;
+    int branchId = -1;
+    if (father != NO_FATHER)
+    {
+      shared_ptr<PhyloBranch> branch = tree.getEdgeToFather(node);
+      branchId = static_cast<int>(tree.getEdgeIndex(branch));
+      hasLength = branch->hasLength();
+      if (hasLength)
+        length = branch->getLength();
+    }
+    branchIds_.push_back(branchId);
+    hasBranchLength_.push_back(hasLength);
+    branchLengths_.push_back(length);
+    vector<shared_ptr<PhyloNode> > sons = tree.getSons(node);
+    for (size_t k = sons.size(); k > 0; k--)
+    {
+      stack.push_back(make_pair(sons[k - 1], index));
+    }
+  }
+  finalize_();
+}
+
+/******************************************************************************/
+
+void FlatTopology::finalize_()
+{
+  size_t n = nodeIds_.size();
+
+  //Sons ranges, in index order (preorder keeps the original order of sons):
+  sonsBegin_.assign(n + 1, 0);
+  for (size_t i = 1; i < n; i++)
+  {
+    sonsBegin_[fathers_[i] + 1]++;
+  }
+  for (size_t i = 0; i < n; i++)
+  {
+    sonsBegin_[i + 1] += sonsBegin_[i];
+  }
+  sons_.resize(n > 0 ? n - 1 : 0);
+  vector<size_t> next(sonsBegin_.begin(), sonsBegin_.end() - 1);
+  for (size_t i = 1; i < n; i++)
+  {
+    sons_[next[fathers_[i]]++] = i;
+  }
+
+  //Postorder, sons in their original order:
+  postorder_.reserve(n);
+  vector<pair<size_t, size_t> > stack;
+  if (n > 0)
+    stack.push_back(make_pair(0, 0));
+  while (!stack.empty())
+  {
+    size_t node = stack.back().first;
+    size_t& k = stack.back().second;
+    if (k < getNumberOfSons(node))
+    {
+      size_t son = getSon(node, k);
+      k++;
+      stack.push_back(make_pair(son, 0));
+    }
+    else
+    {
+      postorder_.push_back(node);
+      stack.pop_back();
+    }
+  }
+
+  //Reverse lookup:
+  int maxId = n > 0 ? *max_element(nodeIds_.begin(), nodeIds_.end()) : -1;
+  indexes_.assign(static_cast<size_t>(maxId + 1), NO_FATHER);
+  for (size_t i = 0; i < n; i++)
+  {
+    if (nodeIds_[i] >= 0)
+      indexes_[static_cast<size_t>(nodeIds_[i])] = i;
+  }
+}
+
+/******************************************************************************/
+
+size_t FlatTopology::getIndex(int nodeId) const
+{
+  if (nodeId < 0 || static_cast<size_t>(nodeId) >= indexes_.size() || indexes_[static_cast<size_t>(nodeId)] == NO_FATHER)
+    throw NodeNotFoundException("FlatTopology::getIndex.", nodeId);
+  return indexes_[static_cast<size_t>(nodeId)];
+}
+
+/******************************************************************************/
+
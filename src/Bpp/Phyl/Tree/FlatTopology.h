@@ -0,0 +1,145 @@
+//
+// File: FlatTopology.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _FLATTOPOLOGY_H_
+#define _FLATTOPOLOGY_H_
+
+#include "Tree.h"
+#include "PhyloTree.h"
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief An immutable snapshot of a rooted topology, stored in contiguous arrays.
+ *
+ * Nodes are numbered from 0 in preorder, so that the root has index 0 and every node
+ * comes after its father. For each node, the class stores the index of its father,
+ * the range of its sons, the length of the branch leading to it, the id of the node
+ * in the original tree (the node index for a PhyloTree) and the id of the branch leading
+ * to it (the edge index for a PhyloTree, the node id for a Tree). Preorder and postorder sequences
+ * are precomputed, so recursions over the tree can be written as plain loops.
+ *
+ * The snapshot does not follow the original tree: it must be rebuilt after any change
+ * of topology or branch lengths.
+ */
+class FlatTopology
+{
+  public:
+    /**
+     * @brief Index used for the father of the root.
+     */
+    static const size_t NO_FATHER;
+
+  private:
+    std::vector<int> nodeIds_;
+    std::vector<int> branchIds_;     // -1 for the root.
+    std::vector<size_t> fathers_;
+    std::vector<size_t> sonsBegin_;  // Sons of node i are sons_[sonsBegin_[i]] to sons_[sonsBegin_[i + 1] - 1].
+    std::vector<size_t> sons_;
+    std::vector<double> branchLengths_;
+    std::vector<bool> hasBranchLength_;
+    std::vector<size_t> postorder_;
+    std::vector<size_t> indexes_;    // Index of each node id, NO_FATHER if not in the tree.
+
+  public:
+    /**
+     * @brief Build a snapshot of a tree, rooted at its root node.
+     */
+    FlatTopology(const Tree& tree);
+
+    /**
+     * @brief Build a snapshot of a PhyloTree, rooted at its root node.
+     */
+    FlatTopology(const PhyloTree& tree);
+
+  public:
+    size_t getNumberOfNodes() const { return nodeIds_.size(); }
+
+    size_t getRootIndex() const { return 0; }
+
+    int getNodeId(size_t index) const { return nodeIds_[index]; }
+
+    /**
+     * @return The id of the branch leading to a node in the original tree, -1 for the root.
+     */
+    int getBranchId(size_t index) const { return branchIds_[index]; }
+
+    /**
+     * @return The index of a node id in the snapshot.
+     * @throw NodeNotFoundException If no node has this id.
+     */
+    size_t getIndex(int nodeId) const;
+
+    size_t getFather(size_t index) const { return fathers_[index]; }
+
+    /**
+     * @return True if the node has degree 1 at most, as Node::isLeaf(): this includes a root with a single son.
+     */
+    bool isLeaf(size_t index) const { return getNumberOfSons(index) + (index == getRootIndex() ? 0 : 1) <= 1; }
+
+    size_t getNumberOfSons(size_t index) const { return sonsBegin_[index + 1] - sonsBegin_[index]; }
+
+    size_t getSon(size_t index, size_t k) const { return sons_[sonsBegin_[index] + k]; }
+
+    bool hasBranchLength(size_t index) const { return hasBranchLength_[index]; }
+
+    /**
+     * @return The length of the branch leading to a node, 0 if it is not defined.
+     */
+    double getBranchLength(size_t index) const { return branchLengths_[index]; }
+
+    const std::vector<double>& getBranchLengths() const { return branchLengths_; }
+
+    /**
+     * @brief Nodes in postorder: all sons come before their father, the root is last.
+     */
+    const std::vector<size_t>& getPostorder() const { return postorder_; }
+
+  private:
+    void finalize_();
+};
+
+} //end of namespace bpp.
+
+#endif //_FLATTOPOLOGY_H_
+
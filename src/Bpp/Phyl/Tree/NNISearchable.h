@@ -119,6 +119,23 @@ class NNISearchable:
 		 */
 		virtual double testNNI(int nodeId) const = 0;
 
+		/**
+		 * @brief Send the scores of several NNI movements, without performing them.
+		 *
+		 * The default implementation calls testNNI() for each node in turn.
+		 * Implementations may test the movements concurrently, the result being the same.
+		 *
+		 * @param nodeIds The ids of the nodes defining the NNI movements.
+		 * @param diffs   [out] The score variations of the NNIs, in the same order.
+		 * @throw NodeException If a node does not define a valid NNI.
+		 */
+		virtual void testNNIs(const std::vector<int>& nodeIds, std::vector<double>& diffs) const
+		{
+			diffs.resize(nodeIds.size());
+			for (size_t i = 0; i < nodeIds.size(); i++)
+				diffs[i] = testNNI(nodeIds[i]);
+		}
+
 		/**
 		 * @brief Perform a NNI movement.
 		 *
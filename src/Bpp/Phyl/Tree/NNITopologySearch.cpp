@@ -84,6 +84,7 @@ void NNITopologySearch::notifyAllSuccessful(const TopologyChangeEvent& event)
 
 void NNITopologySearch::search()
 {
+  stopped_ = false;
   if (algorithm_ == FAST)
     searchFast();
   else if (algorithm_ == BETTER)
@@ -133,9 +134,10 @@ void NNITopologySearch::searchFast()
                                           + " at " + TextTools::toString(node->getFather()->getId()),
                                           TextTools::toString(diff));
         }
+        int centralId = node->getFather()->getId();
         searchableTree_->doNNI(node->getId());
         // Notify:
-        notifyAllPerformed(TopologyChangeEvent());
+        notifyAllPerformed(TopologyChangeEvent("", vector<int>(1, centralId)));
         test = true;
 
         if (verbose_ >= 1)
@@ -143,7 +145,7 @@ void NNITopologySearch::searchFast()
       }
     }
   }
-  while (test);
+  while (test && !stopped_);
 }
 
 void NNITopologySearch::searchBetter()
@@ -171,10 +173,17 @@ void NNITopologySearch::searchBetter()
     vector<double> improvement;
     if (verbose_ >= 2 && ApplicationTools::message)
       ApplicationTools::message->endLine();
+    vector<int> nodesSubId(nodesSub.size());
+    for (size_t i = 0; i < nodesSub.size(); i++)
+    {
+      nodesSubId[i] = nodesSub[i]->getId();
+    }
+    vector<double> diffs;
+    searchableTree_->testNNIs(nodesSubId, diffs);
     for (size_t i = 0; i < nodesSub.size(); i++)
     {
       Node* node = nodesSub[i];
-      double diff = searchableTree_->testNNI(node->getId());
+      double diff = diffs[i];
       if (verbose_ >= 3)
       {
         ApplicationTools::displayResult("   Testing node " + TextTools::toString(node->getId())
@@ -199,16 +208,17 @@ void NNITopologySearch::searchBetter()
         ApplicationTools::displayResult("   Swapping node " + TextTools::toString(node->getId())
                                         + " at " + TextTools::toString(node->getFather()->getId()),
                                         TextTools::toString(improvement[nodeMin]));
+      int centralId = node->getFather()->getId();
       searchableTree_->doNNI(node->getId());
 
       // Notify:
-      notifyAllPerformed(TopologyChangeEvent());
+      notifyAllPerformed(TopologyChangeEvent("", vector<int>(1, centralId)));
 
       if (verbose_ >= 1)
         ApplicationTools::displayResult("   Current value", TextTools::toString(searchableTree_->getTopologyValue(), 10));
     }
   }
-  while (test);
+  while (test && !stopped_);
 }
 
 void NNITopologySearch::searchPhyML()
@@ -236,10 +246,17 @@ void NNITopologySearch::searchPhyML()
     vector<double> improvement;
     if (verbose_ >= 2 && ApplicationTools::message)
       ApplicationTools::message->endLine();
+    vector<int> nodesSubId(nodesSub.size());
+    for (size_t i = 0; i < nodesSub.size(); i++)
+    {
+      nodesSubId[i] = nodesSub[i]->getId();
+    }
+    vector<double> diffs;
+    searchableTree_->testNNIs(nodesSubId, diffs);
     for (size_t i = 0; i < nodesSub.size(); i++)
     {
       Node* node = nodesSub[i];
-      double diff = searchableTree_->testNNI(node->getId());
+      double diff = diffs[i];
       if (verbose_ >= 3)
       {
         ApplicationTools::displayResult("   Testing node " + TextTools::toString(node->getId())
@@ -311,8 +328,11 @@ void NNITopologySearch::searchPhyML()
       bool test2 = true;
       // Make a backup copy:
       NNISearchable* backup = dynamic_cast<NNISearchable*>(searchableTree_->clone());
+      // Nodes under the central branches of the NNIs performed:
+      vector<int> centralIds;
       do
       {
+        centralIds.clear();
         if (verbose_ >= 1)
           ApplicationTools::displayMessage("Trying to perform " + TextTools::toString(improving.size()) + " NNI(s).");
         for (size_t i = 0; i < improving.size(); i++)
@@ -324,11 +344,12 @@ void NNITopologySearch::searchPhyML()
                                             + string(" at ") + TextTools::toString(searchableTree_->getTopology().getFatherId(nodeId)),
                                             TextTools::toString(improvement[i]));
           }
+          centralIds.push_back(searchableTree_->getTopology().getFatherId(nodeId));
           searchableTree_->doNNI(improving[i]);
         }
 
         // Notify:
-        notifyAllTested(TopologyChangeEvent());
+        notifyAllTested(TopologyChangeEvent("", centralIds));
         if (verbose_ >= 1)
           ApplicationTools::displayResult("   Current value", TextTools::toString(searchableTree_->getTopologyValue(), 10));
         if (searchableTree_->getTopologyValue() >= currentValue)
@@ -359,9 +380,9 @@ void NNITopologySearch::searchPhyML()
       while (test2);
       delete backup;
       // Notify:
-      notifyAllSuccessful(TopologyChangeEvent());
+      notifyAllSuccessful(TopologyChangeEvent("", centralIds));
     }
   }
-  while (test);
+  while (test && !stopped_);
 }
 
@@ -71,20 +71,22 @@ class NNITopologySearch :
     std::string algorithm_;
 		unsigned int verbose_;
     std::vector<TopologyListener*> topoListeners_;
+    bool stopped_;
 		
 	public:
 		NNITopologySearch(
         NNISearchable& tree,
         const std::string& algorithm = FAST,
         unsigned int verbose = 2) :
-      searchableTree_(&tree), algorithm_(algorithm), verbose_(verbose), topoListeners_()
+      searchableTree_(&tree), algorithm_(algorithm), verbose_(verbose), topoListeners_(), stopped_(false)
     {}
 
     NNITopologySearch(const NNITopologySearch& ts) :
       searchableTree_(ts.searchableTree_),
       algorithm_(ts.algorithm_),
       verbose_(ts.verbose_),
-      topoListeners_(ts.topoListeners_)
+      topoListeners_(ts.topoListeners_),
+      stopped_(ts.stopped_)
     {
       //Hard-copy all listeners:
       for (unsigned int i = 0; i < topoListeners_.size(); i++)
@@ -97,6 +99,7 @@ class NNITopologySearch :
       algorithm_      = ts.algorithm_;
       verbose_        = ts.verbose_;
       topoListeners_  = ts.topoListeners_;
+      stopped_        = ts.stopped_;
       //Hard-copy all listeners:
       for (unsigned int i = 0; i < topoListeners_.size(); i++)
         topoListeners_[i] = dynamic_cast<TopologyListener*>(ts.topoListeners_[i]->clone());
@@ -114,6 +117,20 @@ class NNITopologySearch :
 
 	public:
 		void search();
+
+    /**
+     * @brief Ask the search to stop after the current round of NNIs.
+     *
+     * This is meant to be called by a listener, for instance when the
+     * search is not worth continuing. The next call to search() starts
+     * again.
+     */
+    void stop() { stopped_ = true; }
+
+    /**
+     * @return True if the last search was stopped by stop().
+     */
+    bool isStopped() const { return stopped_; }
     
     /**
      * @brief Add a listener to the list.
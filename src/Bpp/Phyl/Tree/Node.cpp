@@ -57,14 +57,10 @@ Node::Node(const Node& node):
   id_(node.id_), name_(0),
   sons_(), father_(0),
   //, sons_(node.sons_), father_(node.father_),
-  distanceToFather_(0), nodeProperties_(), branchProperties_()
+  distanceToFather_(0), nodeProperties_(node.nodeProperties_), branchProperties_(node.branchProperties_)
 {
   name_             = node.hasName() ? new string(* node.name_) : 0;
   distanceToFather_ = node.hasDistanceToFather() ? new double(* node.distanceToFather_) : 0;
-  for (map<string, Clonable *>::iterator i = node.nodeProperties_.begin(); i != node.nodeProperties_.end(); i++)
-    nodeProperties_[i->first] = i->second->clone();
-  for (map<string, Clonable *>::iterator i = node.branchProperties_.begin(); i != node.branchProperties_.end(); i++)
-    branchProperties_[i->first] = i->second->clone();
 }
 
 // Node::Node(const PhyloNode& pn):
@@ -99,19 +95,51 @@ Node& Node::operator=(const Node & node)
   if(distanceToFather_) delete distanceToFather_;
   distanceToFather_ = node.hasDistanceToFather() ? new double(* node.distanceToFather_) : 0;
   //sons_             = node.sons_;
-  for(map<string, Clonable *>::iterator i = node.nodeProperties_.begin(); i != node.nodeProperties_.end(); i++)
+  assignProperties_(nodeProperties_, node.nodeProperties_);
+  assignProperties_(branchProperties_, node.branchProperties_);
+  return * this;
+}
+
+/** Properties: ***************************************************************/
+
+void Node::deleteProperties_(PropertyMap* properties)
+{
+  for (PropertyMap::iterator i = properties->begin(); i != properties->end(); i++)
+    delete i->second;
+  delete properties;
+}
+
+Node::PropertyMap& Node::getWritableProperties_(shared_ptr<PropertyMap>& properties)
+{
+  if (!properties)
+    properties.reset(new PropertyMap(), deleteProperties_);
+  else if (properties.use_count() > 1)
   {
-    Clonable * p = nodeProperties_[i->first];
-    if(p) delete p;
-    nodeProperties_[i->first] = i->second->clone();
+    shared_ptr<PropertyMap> copy(new PropertyMap(), deleteProperties_);
+    for (PropertyMap::const_iterator i = properties->begin(); i != properties->end(); i++)
+      (*copy)[i->first] = i->second->clone();
+    properties = copy;
   }
-  for(map<string, Clonable *>::iterator i = node.branchProperties_.begin(); i != node.branchProperties_.end(); i++)
+  return *properties;
+}
+
+void Node::assignProperties_(shared_ptr<PropertyMap>& to, const shared_ptr<PropertyMap>& from)
+{
+  if (to == from || !from)
+    return;
+  if (!to || to->empty())
   {
-    Clonable * p = branchProperties_[i->first];
-    if(p) delete p;
-    branchProperties_[i->first] = i->second->clone();
+    //Nothing to keep: share the source.
+    to = from;
+    return;
+  }
+  PropertyMap& properties = getWritableProperties_(to);
+  for (PropertyMap::const_iterator i = from->begin(); i != from->end(); i++)
+  {
+    Clonable*& p = properties[i->first];
+    if (p) delete p;
+    p = i->second->clone();
   }
-  return * this;
 }
       
 /** Sons: *********************************************************************/
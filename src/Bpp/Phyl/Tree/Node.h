@@ -55,6 +55,7 @@
 #include <iostream>
 #include <algorithm>
 #include <cstddef>
+#include <memory>
 
 namespace bpp
 {
@@ -79,6 +80,10 @@ namespace bpp
  * - A property map, that may contain any information to link to each node, e.g. bootstrap
  * value or GC content.
  *
+ * Property maps are shared by copies of a node, and only cloned when one of the copies
+ * modifies them, or gives a non-const access to one of its properties. Copying a tree
+ * hence does not clone its properties.
+ *
  * Methods are provided to help the building of trees from scratch.
  * Trees are more easily built from root to leaves:
  * The addSon(Node) method adds a node to the list of direct descendants of a
@@ -97,8 +102,10 @@ protected:
   std::vector<Node*> sons_;
   Node* father_;
   double* distanceToFather_;
-  mutable std::map<std::string, Clonable*> nodeProperties_;
-  mutable std::map<std::string, Clonable*> branchProperties_;
+  typedef std::map<std::string, Clonable*> PropertyMap;
+  // Shared between copies (copy-on-write), 0 if there are no properties:
+  std::shared_ptr<PropertyMap> nodeProperties_;
+  std::shared_ptr<PropertyMap> branchProperties_;
 
 public:
   /**
@@ -181,14 +188,7 @@ public:
   {
     if (name_) delete name_;
     if (distanceToFather_) delete distanceToFather_;
-    for (std::map<std::string, Clonable*>::iterator i = nodeProperties_.begin(); i != nodeProperties_.end(); i++)
-    {
-      delete i->second;
-    }
-    for (std::map<std::string, Clonable*>::iterator i = branchProperties_.begin(); i != branchProperties_.end(); i++)
-    {
-      delete i->second;
-    }
+    //Properties are deleted with the last node sharing them.
   }
 
 public:
@@ -522,23 +522,25 @@ public:
    */
   virtual void setNodeProperty(const std::string& name, const Clonable& property)
   {
-    if (hasNodeProperty(name))
-      delete nodeProperties_[name];
-    nodeProperties_[name] = property.clone();
+    Clonable*& p = getWritableProperties_(nodeProperties_)[name];
+    if (p)
+      delete p;
+    p = property.clone();
   }
 
   virtual Clonable* getNodeProperty(const std::string& name)
   {
     if (hasNodeProperty(name))
-      return nodeProperties_[name];
+      return getWritableProperties_(nodeProperties_)[name];
     else
       throw PropertyNotFoundException("", name, this);
   }
 
   virtual const Clonable* getNodeProperty(const std::string& name) const
   {
-    if (hasNodeProperty(name))
-      return const_cast<const Clonable*>(nodeProperties_[name]);
+    const Clonable* p = findProperty_(nodeProperties_, name);
+    if (p)
+      return p;
     else
       throw PropertyNotFoundException("", name, this);
   }
@@ -547,8 +549,9 @@ public:
   {
     if (hasNodeProperty(name))
     {
-      Clonable* removed = nodeProperties_[name];
-      nodeProperties_.erase(name);
+      PropertyMap& properties = getWritableProperties_(nodeProperties_);
+      Clonable* removed = properties[name];
+      properties.erase(name);
       return removed;
     }
     else
@@ -559,8 +562,9 @@ public:
   {
     if (hasNodeProperty(name))
     {
-      delete nodeProperties_[name];
-      nodeProperties_.erase(name);
+      PropertyMap& properties = getWritableProperties_(nodeProperties_);
+      delete properties[name];
+      properties.erase(name);
     }
     else
       throw PropertyNotFoundException("", name, this);
@@ -573,7 +577,10 @@ public:
    */
   virtual void removeNodeProperties()
   {
-    nodeProperties_.clear();
+    //Shared properties are still owned by the other copies.
+    if (nodeProperties_ && nodeProperties_.use_count() == 1)
+      nodeProperties_->clear();
+    nodeProperties_.reset();
   }
 
   /**
@@ -581,16 +588,15 @@ public:
    */
   virtual void deleteNodeProperties()
   {
-    for (std::map<std::string, Clonable*>::iterator i = nodeProperties_.begin(); i != nodeProperties_.end(); i++)
-    {
-      delete i->second;
-    }
-    nodeProperties_.clear();
+    nodeProperties_.reset();
   }
 
-  virtual bool hasNodeProperty(const std::string& name) const { return nodeProperties_.find(name) != nodeProperties_.end(); }
+  virtual bool hasNodeProperty(const std::string& name) const { return findProperty_(nodeProperties_, name) != 0; }
 
-  virtual std::vector<std::string> getNodePropertyNames() const { return MapTools::getKeys(nodeProperties_); }
+  virtual std::vector<std::string> getNodePropertyNames() const
+  {
+    return nodeProperties_ ? MapTools::getKeys(*nodeProperties_) : std::vector<std::string>();
+  }
 
   /** @} */
 
@@ -612,23 +618,25 @@ public:
    */
   virtual void setBranchProperty(const std::string& name, const Clonable& property)
   {
-    if (hasBranchProperty(name))
-      delete branchProperties_[name];
-    branchProperties_[name] = property.clone();
+    Clonable*& p = getWritableProperties_(branchProperties_)[name];
+    if (p)
+      delete p;
+    p = property.clone();
   }
 
   virtual Clonable* getBranchProperty(const std::string& name)
   {
     if (hasBranchProperty(name))
-      return branchProperties_[name];
+      return getWritableProperties_(branchProperties_)[name];
     else
       throw PropertyNotFoundException("", name, this);
   }
 
   virtual const Clonable* getBranchProperty(const std::string& name) const
   {
-    if (hasBranchProperty(name))
-      return const_cast<const Clonable*>(branchProperties_[name]);
+    const Clonable* p = findProperty_(branchProperties_, name);
+    if (p)
+      return p;
     else
       throw PropertyNotFoundException("", name, this);
   }
@@ -637,8 +645,9 @@ public:
   {
     if (hasBranchProperty(name))
     {
-      Clonable* removed = branchProperties_[name];
-      branchProperties_.erase(name);
+      PropertyMap& properties = getWritableProperties_(branchProperties_);
+      Clonable* removed = properties[name];
+      properties.erase(name);
       return removed;
     }
     else
@@ -649,8 +658,9 @@ public:
   {
     if (hasBranchProperty(name))
     {
-      delete branchProperties_[name];
-      branchProperties_.erase(name);
+      PropertyMap& properties = getWritableProperties_(branchProperties_);
+      delete properties[name];
+      properties.erase(name);
     }
     else
       throw PropertyNotFoundException("", name, this);
@@ -663,7 +673,10 @@ public:
    */
   virtual void removeBranchProperties()
   {
-    branchProperties_.clear();
+    //Shared properties are still owned by the other copies.
+    if (branchProperties_ && branchProperties_.use_count() == 1)
+      branchProperties_->clear();
+    branchProperties_.reset();
   }
 
   /**
@@ -671,16 +684,15 @@ public:
    */
   virtual void deleteBranchProperties()
   {
-    for (std::map<std::string, Clonable*>::iterator i = branchProperties_.begin(); i != branchProperties_.end(); i++)
-    {
-      delete i->second;
-    }
-    branchProperties_.clear();
+    branchProperties_.reset();
   }
 
-  virtual bool hasBranchProperty(const std::string& name) const { return branchProperties_.find(name) != branchProperties_.end(); }
+  virtual bool hasBranchProperty(const std::string& name) const { return findProperty_(branchProperties_, name) != 0; }
 
-  virtual std::vector<std::string> getBranchPropertyNames() const { return MapTools::getKeys(branchProperties_); }
+  virtual std::vector<std::string> getBranchPropertyNames() const
+  {
+    return branchProperties_ ? MapTools::getKeys(*branchProperties_) : std::vector<std::string>();
+  }
 
   virtual bool hasBootstrapValue() const;
 
@@ -696,6 +708,26 @@ public:
 
   virtual bool hasNoSon() const { return getNumberOfSons() ==0; }
 
+protected:
+  /**
+   * @return The map, created if needed, after cloning its properties if it is shared with other nodes.
+   */
+  static PropertyMap& getWritableProperties_(std::shared_ptr<PropertyMap>& properties);
+
+  static const Clonable* findProperty_(const std::shared_ptr<PropertyMap>& properties, const std::string& name)
+  {
+    if (!properties)
+      return 0;
+    PropertyMap::const_iterator it = properties->find(name);
+    return it == properties->end() ? 0 : it->second;
+  }
+
+  /**
+   * @brief Copy properties, keeping those of the target which are not in the source.
+   */
+  static void assignProperties_(std::shared_ptr<PropertyMap>& to, const std::shared_ptr<PropertyMap>& from);
+
+  static void deleteProperties_(PropertyMap* properties);
 };
 } // end of namespace bpp.
 
@@ -0,0 +1,317 @@
+//
+// File: PersistentTree.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "PersistentTree.h"
+#include "TreeExceptions.h"
+
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+/******************************************************************************/
+
+PersistentTree::PersistentTree(const Tree& tree) :
+  root_(),
+  nbNodes_(0)
+{
+  root_ = copyNode_(tree, tree.getRootId(), nbNodes_);
+}
+
+/******************************************************************************/
+
+shared_ptr<const PersistentNode> PersistentTree::copyNode_(const Tree& tree, int nodeId, size_t& nbNodes)
+{
+  shared_ptr<PersistentNode> node(new PersistentNode(nodeId));
+  if (tree.hasNodeName(nodeId))
+  {
+    node->hasName_ = true;
+    node->name_ = tree.getNodeName(nodeId);
+  }
+  if (tree.hasDistanceToFather(nodeId))
+  {
+    node->hasDistance_ = true;
+    node->distance_ = tree.getDistanceToFather(nodeId);
+  }
+  nbNodes++;
+  vector<int> sonsId = tree.getSonsId(nodeId);
+  for (size_t i = 0; i < sonsId.size(); i++)
+  {
+    node->sons_.push_back(copyNode_(tree, sonsId[i], nbNodes));
+  }
+  return node;
+}
+
+/******************************************************************************/
+
+vector<int> PersistentTree::getNodesId() const
+{
+  vector<int> ids;
+  ids.reserve(nbNodes_);
+  vector<const PersistentNode*> stack(1, root_.get());
+  while (!stack.empty())
+  {
+    const PersistentNode* node = stack.back();
+    stack.pop_back();
+    ids.push_back(node->getId());
+    for (size_t i = node->sons_.size(); i > 0; i--)
+    {
+      stack.push_back(node->sons_[i - 1].get());
+    }
+  }
+  return ids;
+}
+
+/******************************************************************************/
+
+bool PersistentTree::findPath_(int nodeId, vector<const PersistentNode*>& path) const
+{
+  // Depth-first search, where 'next' holds the index of the next son to visit at each depth:
+  path.assign(1, root_.get());
+  vector<size_t> next(1, 0);
+  while (!path.empty())
+  {
+    const PersistentNode* node = path.back();
+    if (next.back() == 0 && node->getId() == nodeId)
+      return true;
+    if (next.back() < node->sons_.size())
+    {
+      path.push_back(node->sons_[next.back()++].get());
+      next.push_back(0);
+    }
+    else
+    {
+      path.pop_back();
+      next.pop_back();
+    }
+  }
+  return false;
+}
+
+/******************************************************************************/
+
+bool PersistentTree::hasNode(int nodeId) const
+{
+  vector<const PersistentNode*> path;
+  return findPath_(nodeId, path);
+}
+
+/******************************************************************************/
+
+const PersistentNode& PersistentTree::getNode(int nodeId) const
+{
+  vector<const PersistentNode*> path;
+  if (!findPath_(nodeId, path))
+    throw NodeNotFoundException("PersistentTree::getNode().", nodeId);
+  return *path.back();
+}
+
+/******************************************************************************/
+
+int PersistentTree::getFatherId(int nodeId) const
+{
+  vector<const PersistentNode*> path;
+  if (!findPath_(nodeId, path))
+    throw NodeNotFoundException("PersistentTree::getFatherId().", nodeId);
+  if (path.size() < 2)
+    throw NodeException("PersistentTree::getFatherId(). The root has no father.", nodeId);
+  return path[path.size() - 2]->getId();
+}
+
+/******************************************************************************/
+
+bool PersistentTree::sharesSubtree(const PersistentTree& tree, int nodeId) const
+{
+  vector<const PersistentNode*> path1, path2;
+  if (!findPath_(nodeId, path1) || !tree.findPath_(nodeId, path2))
+    throw NodeNotFoundException("PersistentTree::sharesSubtree().", nodeId);
+  return path1.back() == path2.back();
+}
+
+/******************************************************************************/
+
+shared_ptr<const PersistentNode> PersistentTree::rebuild_(
+    const shared_ptr<const PersistentNode>& node,
+    const set<int>& path,
+    const function<void (PersistentNode&)>& edit)
+{
+  if (path.find(node->getId()) == path.end())
+    return node;
+  shared_ptr<PersistentNode> copy(new PersistentNode(*node));
+  for (size_t i = 0; i < copy->sons_.size(); i++)
+  {
+    copy->sons_[i] = rebuild_(copy->sons_[i], path, edit);
+  }
+  edit(*copy);
+  return copy;
+}
+
+/******************************************************************************/
+
+PersistentTree PersistentTree::setDistanceToFather(int nodeId, double distance) const
+{
+  vector<const PersistentNode*> path;
+  if (!findPath_(nodeId, path))
+    throw NodeNotFoundException("PersistentTree::setDistanceToFather().", nodeId);
+  set<int> ids;
+  for (size_t i = 0; i < path.size(); i++)
+    ids.insert(path[i]->getId());
+  return PersistentTree(rebuild_(root_, ids, [nodeId, distance](PersistentNode& node)
+  {
+    if (node.id_ == nodeId)
+    {
+      node.hasDistance_ = true;
+      node.distance_ = distance;
+    }
+  }), nbNodes_);
+}
+
+/******************************************************************************/
+
+PersistentTree PersistentTree::swapSubtrees(int nodeId1, int nodeId2) const
+{
+  vector<const PersistentNode*> path1, path2;
+  if (!findPath_(nodeId1, path1))
+    throw NodeNotFoundException("PersistentTree::swapSubtrees().", nodeId1);
+  if (!findPath_(nodeId2, path2))
+    throw NodeNotFoundException("PersistentTree::swapSubtrees().", nodeId2);
+  if (nodeId1 == nodeId2)
+    return *this;
+  // A node is in the subtree of the other one if it is on its path:
+  if (find(path1.begin(), path1.end(), path2.back()) != path1.end())
+    throw NodeException("PersistentTree::swapSubtrees(). Node is in the subtree of node " + TextTools::toString(nodeId1) + ".", nodeId2);
+  if (find(path2.begin(), path2.end(), path1.back()) != path2.end())
+    throw NodeException("PersistentTree::swapSubtrees(). Node is in the subtree of node " + TextTools::toString(nodeId2) + ".", nodeId1);
+
+  // The subtrees are shared, only their fathers and ancestors are copied:
+  shared_ptr<const PersistentNode> subtree1, subtree2;
+  const PersistentNode* father1 = path1[path1.size() - 2];
+  const PersistentNode* father2 = path2[path2.size() - 2];
+  for (size_t i = 0; i < father1->sons_.size(); i++)
+  {
+    if (father1->sons_[i]->getId() == nodeId1)
+      subtree1 = father1->sons_[i];
+  }
+  for (size_t i = 0; i < father2->sons_.size(); i++)
+  {
+    if (father2->sons_[i]->getId() == nodeId2)
+      subtree2 = father2->sons_[i];
+  }
+  set<int> ids;
+  for (size_t i = 0; i + 1 < path1.size(); i++)
+    ids.insert(path1[i]->getId());
+  for (size_t i = 0; i + 1 < path2.size(); i++)
+    ids.insert(path2[i]->getId());
+  return PersistentTree(rebuild_(root_, ids, [&](PersistentNode& node)
+  {
+    for (size_t i = 0; i < node.sons_.size(); i++)
+    {
+      if (node.sons_[i] == subtree1)
+        node.sons_[i] = subtree2;
+      else if (node.sons_[i] == subtree2)
+        node.sons_[i] = subtree1;
+    }
+  }), nbNodes_);
+}
+
+/******************************************************************************/
+
+PersistentTree PersistentTree::moveSubtree(int nodeId, int newFatherId) const
+{
+  vector<const PersistentNode*> path, newFatherPath;
+  if (!findPath_(nodeId, path))
+    throw NodeNotFoundException("PersistentTree::moveSubtree().", nodeId);
+  if (!findPath_(newFatherId, newFatherPath))
+    throw NodeNotFoundException("PersistentTree::moveSubtree().", newFatherId);
+  if (path.size() < 2)
+    throw NodeException("PersistentTree::moveSubtree(). The root can not be moved.", nodeId);
+  if (find(newFatherPath.begin(), newFatherPath.end(), path.back()) != newFatherPath.end())
+    throw NodeException("PersistentTree::moveSubtree(). The new father is in the subtree of node " + TextTools::toString(nodeId) + ".", newFatherId);
+
+  const PersistentNode* father = path[path.size() - 2];
+  int fatherId = father->getId();
+  shared_ptr<const PersistentNode> subtree;
+  for (size_t i = 0; i < father->sons_.size(); i++)
+  {
+    if (father->sons_[i]->getId() == nodeId)
+      subtree = father->sons_[i];
+  }
+  set<int> ids;
+  for (size_t i = 0; i + 1 < path.size(); i++)
+    ids.insert(path[i]->getId());
+  for (size_t i = 0; i < newFatherPath.size(); i++)
+    ids.insert(newFatherPath[i]->getId());
+  return PersistentTree(rebuild_(root_, ids, [&](PersistentNode& node)
+  {
+    if (node.id_ == fatherId)
+      node.sons_.erase(std::find(node.sons_.begin(), node.sons_.end(), subtree));
+    if (node.id_ == newFatherId)
+      node.sons_.push_back(subtree);
+  }), nbNodes_);
+}
+
+/******************************************************************************/
+
+Node* PersistentTree::createNode_(const PersistentNode& node)
+{
+  Node* copy = new Node(node.getId());
+  if (node.hasName())
+    copy->setName(node.getName());
+  if (node.hasDistanceToFather())
+    copy->setDistanceToFather(node.getDistanceToFather());
+  for (size_t i = 0; i < node.getNumberOfSons(); i++)
+  {
+    copy->addSon(createNode_(node.getSon(i)));
+  }
+  return copy;
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* PersistentTree::toTreeTemplate() const
+{
+  return new TreeTemplate<Node>(createNode_(*root_));
+}
+
+/******************************************************************************/
@@ -0,0 +1,228 @@
+//
+// File: PersistentTree.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _PERSISTENTTREE_H_
+#define _PERSISTENTTREE_H_
+
+#include "Tree.h"
+#include "TreeTemplate.h"
+#include "Node.h"
+
+// From the STL:
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief An immutable node of a PersistentTree.
+ *
+ * A node holds its id, its name, the length of the branch leading to it and its sons.
+ * It is shared by all the versions of a tree in which the subtree below it did not change.
+ */
+class PersistentNode
+{
+  private:
+    int id_;
+    bool hasName_;
+    std::string name_;
+    bool hasDistance_;
+    double distance_;
+    std::vector< std::shared_ptr<const PersistentNode> > sons_;
+
+  public:
+    PersistentNode(int id) :
+      id_(id), hasName_(false), name_(), hasDistance_(false), distance_(0), sons_()
+    {}
+
+  public:
+    int getId() const { return id_; }
+
+    bool hasName() const { return hasName_; }
+
+    const std::string& getName() const { return name_; }
+
+    bool hasDistanceToFather() const { return hasDistance_; }
+
+    double getDistanceToFather() const { return distance_; }
+
+    size_t getNumberOfSons() const { return sons_.size(); }
+
+    const PersistentNode& getSon(size_t i) const { return *sons_[i]; }
+
+    bool isLeaf() const { return sons_.empty(); }
+
+    friend class PersistentTree;
+};
+
+/**
+ * @brief A persistent tree, whose versions share their unchanged subtrees.
+ *
+ * A PersistentTree is never modified: setDistanceToFather(), swapSubtrees()
+ * and moveSubtree() return a new version, in which only the changed nodes and
+ * their ancestors are copied. Copying a version is constant time, so that
+ * topology searches can keep the best trees found so far, or the trees to
+ * roll back to, for the cost of the nodes on the paths to the changed branches.
+ *
+ * Nodes only hold their id, name and branch length: node and branch properties
+ * are not kept. Finding a node is linear in the number of nodes, but does not
+ * allocate any memory.
+ *
+ * The tree is rooted as the original one. An unrooted tree is stored with its
+ * root multifurcation.
+ */
+class PersistentTree
+{
+  private:
+    std::shared_ptr<const PersistentNode> root_;
+    size_t nbNodes_;
+
+  public:
+    /**
+     * @brief Build the first version of a tree, copying all its nodes.
+     */
+    PersistentTree(const Tree& tree);
+
+  private:
+    PersistentTree(std::shared_ptr<const PersistentNode> root, size_t nbNodes) :
+      root_(root), nbNodes_(nbNodes)
+    {}
+
+  public:
+    const PersistentNode& getRootNode() const { return *root_; }
+
+    int getRootId() const { return root_->getId(); }
+
+    size_t getNumberOfNodes() const { return nbNodes_; }
+
+    /**
+     * @return The ids of all nodes, in preorder.
+     */
+    std::vector<int> getNodesId() const;
+
+    bool hasNode(int nodeId) const;
+
+    /**
+     * @throw NodeNotFoundException If no node has this id.
+     */
+    const PersistentNode& getNode(int nodeId) const;
+
+    /**
+     * @throw NodeNotFoundException If no node has this id.
+     * @throw NodeException If the node is the root.
+     */
+    int getFatherId(int nodeId) const;
+
+    /**
+     * @brief Tell if a subtree is shared with another version of the tree,
+     * that is, did not change between the two versions.
+     *
+     * @param tree Another version of the tree.
+     * @param nodeId The root of the subtree.
+     * @throw NodeNotFoundException If one of the versions has no node with this id.
+     */
+    bool sharesSubtree(const PersistentTree& tree, int nodeId) const;
+
+    /**
+     * @return A new version where the branch leading to a node has another length.
+     *
+     * @param nodeId The node under the branch.
+     * @param distance The new length.
+     * @throw NodeNotFoundException If no node has this id.
+     */
+    PersistentTree setDistanceToFather(int nodeId, double distance) const;
+
+    /**
+     * @return A new version where two subtrees are exchanged, together with
+     * the branches leading to them. An NNI exchanges a node with its uncle.
+     *
+     * @param nodeId1 The root of the first subtree.
+     * @param nodeId2 The root of the second subtree.
+     * @throw NodeNotFoundException If a node is not found.
+     * @throw NodeException If one node is in the subtree of the other one.
+     */
+    PersistentTree swapSubtrees(int nodeId1, int nodeId2) const;
+
+    /**
+     * @return A new version where a subtree is moved to a new father, as its last son.
+     *
+     * No node is added nor removed: a former binary father has a single son
+     * in the new version.
+     *
+     * @param nodeId The root of the subtree.
+     * @param newFatherId The new father.
+     * @throw NodeNotFoundException If a node is not found.
+     * @throw NodeException If the new father is in the subtree, or if the node is the root.
+     */
+    PersistentTree moveSubtree(int nodeId, int newFatherId) const;
+
+    /**
+     * @return A new TreeTemplate with the topology and branch lengths of this version.
+     */
+    TreeTemplate<Node>* toTreeTemplate() const;
+
+  private:
+    static std::shared_ptr<const PersistentNode> copyNode_(const Tree& tree, int nodeId, size_t& nbNodes);
+
+    static Node* createNode_(const PersistentNode& node);
+
+    /**
+     * @brief Get the path from the root to a node, both included.
+     *
+     * @return false if no node has this id.
+     */
+    bool findPath_(int nodeId, std::vector<const PersistentNode*>& path) const;
+
+    /**
+     * @brief Copy the nodes of a subtree whose ids are in @p path, apply @p edit
+     * to each copy once its sons are rebuilt, and share the other nodes.
+     */
+    static std::shared_ptr<const PersistentNode> rebuild_(
+        const std::shared_ptr<const PersistentNode>& node,
+        const std::set<int>& path,
+        const std::function<void (PersistentNode&)>& edit);
+};
+
+} // end of namespace bpp.
+
+#endif // _PERSISTENTTREE_H_
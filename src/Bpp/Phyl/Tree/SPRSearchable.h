@@ -0,0 +1,111 @@
+//
+// File: SPRSearchable.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _SPRSEARCHABLE_H_
+#define _SPRSEARCHABLE_H_
+
+#include "NNISearchable.h"
+
+namespace bpp
+{
+
+/**
+ * @brief Interface for Subtree Pruning and Regrafting algorithms.
+ *
+ * A SPR move is defined by a node, whose subtree is pruned together with
+ * its father node, and by a target node: the subtree is then regrafted
+ * on the branch between the target node and its father.
+ * <pre>
+ * ------------->
+ *        +----- A                  +---------- B
+ *        |                         |
+ *   +----+ F                     --+ X    +----- C
+ *   |    |                         |      |
+ * --+ X  +----- B        ==>       +------+ F
+ *   |                                     |
+ *   +---------- C                         +----- A
+ * </pre>
+ * Here the subtree A (the node) is regrafted on the branch of C (the target).
+ * The father of the pruned node must be a bifurcation, and not the root node,
+ * and the target must be neither in the pruned subtree, nor adjacent to the pruning point
+ * (see TreeTemplateTools::isValidSPR).
+ *
+ * Since SPR moves at distance 1 are NNIs, this interface extends the NNISearchable one.
+ */
+class SPRSearchable:
+  public virtual NNISearchable
+{
+	public:
+		SPRSearchable() {}
+		virtual ~SPRSearchable() {}
+
+    virtual SPRSearchable* clone() const = 0;
+
+	public:
+
+		/**
+		 * @brief Send the score of a SPR movement, without performing it.
+		 *
+		 * This methods sends the score variation.
+		 * This variation must be negative if the new point is better,
+		 * i.e. the object is to be used with a minimizing optimization
+		 * (for consistence with Optimizer objects).
+		 *
+		 * @param nodeId   The id of the pruned node.
+		 * @param targetId The id of the node defining the regrafting branch.
+		 * @return The score variation of the SPR.
+		 * @throw NodeException If the nodes do not define a valid SPR.
+		 */
+		virtual double testSPR(int nodeId, int targetId) const = 0;
+
+		/**
+		 * @brief Perform a SPR movement.
+		 *
+		 * @param nodeId   The id of the pruned node.
+		 * @param targetId The id of the node defining the regrafting branch.
+		 * @throw NodeException If the nodes do not define a valid SPR.
+		 */
+		virtual void doSPR(int nodeId, int targetId) = 0;
+
+};
+
+} //end of namespace bpp.
+
+#endif //_SPRSEARCHABLE_H_
+
@@ -0,0 +1,186 @@
+//
+// File: SPRTopologySearch.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "SPRTopologySearch.h"
+#include "TreeTemplateTools.h"
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Numeric/VectorTools.h>
+
+using namespace bpp;
+
+using namespace std;
+
+const string SPRTopologySearch::FAST   = "Fast";
+const string SPRTopologySearch::BETTER = "Better";
+
+void SPRTopologySearch::notifyAllPerformed(const TopologyChangeEvent& event)
+{
+  searchableTree_->topologyChangePerformed(event);
+  for (size_t i = 0; i < topoListeners_.size(); i++)
+  {
+    topoListeners_[i]->topologyChangePerformed(event);
+  }
+}
+
+void SPRTopologySearch::search()
+{
+  if (algorithm_ == FAST)
+    searchFast();
+  else if (algorithm_ == BETTER)
+    searchBetter();
+  else
+    throw Exception("Unknown SPR algorithm: " + algorithm_ + ".\n");
+}
+
+double SPRTopologySearch::testAllSPRs_(int nodeId, int& targetId)
+{
+  const TreeTemplate<Node>* tree = dynamic_cast<const TreeTemplate<Node>*>(&searchableTree_->getTopology());
+  TreeTemplate<Node>* copy = 0;
+  if (!tree)
+  {
+    copy = new TreeTemplate<Node>(searchableTree_->getTopology());
+    tree = copy;
+  }
+  vector<int> targets = TreeTemplateTools::getRegraftingNodes(tree->getNode(nodeId), radius_);
+  if (copy) delete copy;
+
+  double best = 0.;
+  for (size_t j = 0; j < targets.size(); j++)
+  {
+    double diff = searchableTree_->testSPR(nodeId, targets[j]);
+    if (verbose_ >= 3)
+    {
+      ApplicationTools::displayResult("   Testing node " + TextTools::toString(nodeId)
+                                      + " on " + TextTools::toString(targets[j]),
+                                      TextTools::toString(diff));
+    }
+    if (j == 0 || diff < best)
+    {
+      best = diff;
+      targetId = targets[j];
+    }
+  }
+  return best;
+}
+
+void SPRTopologySearch::searchFast()
+{
+  bool test = true;
+  do
+  {
+    vector<int> nodes = searchableTree_->getTopology().getNodesId();
+
+    // Test all SPRs:
+    test = false;
+    for (size_t i = 0; !test && i < nodes.size(); i++)
+    {
+      int targetId = -1;
+      double diff = testAllSPRs_(nodes[i], targetId);
+      if (diff < 0.)
+      { // Good SPR found...
+        if (verbose_ >= 2)
+        {
+          ApplicationTools::displayResult("   Moving node " + TextTools::toString(nodes[i])
+                                          + " on " + TextTools::toString(targetId),
+                                          TextTools::toString(diff));
+        }
+        searchableTree_->doSPR(nodes[i], targetId);
+        // Notify:
+        notifyAllPerformed(TopologyChangeEvent());
+        test = true;
+
+        if (verbose_ >= 1)
+          ApplicationTools::displayResult("   Current value", TextTools::toString(searchableTree_->getTopologyValue(), 10));
+      }
+    }
+  }
+  while (test);
+}
+
+void SPRTopologySearch::searchBetter()
+{
+  bool test = true;
+  do
+  {
+    vector<int> nodes = searchableTree_->getTopology().getNodesId();
+
+    if (verbose_ >= 3)
+      ApplicationTools::displayTask("Test all possible SPRs...");
+
+    // Test all SPRs:
+    vector<int> improving;
+    vector<int> improvingTargets;
+    vector<double> improvement;
+    if (verbose_ >= 2 && ApplicationTools::message)
+      ApplicationTools::message->endLine();
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+      int targetId = -1;
+      double diff = testAllSPRs_(nodes[i], targetId);
+      if (diff < 0.)
+      {
+        improving.push_back(nodes[i]);
+        improvingTargets.push_back(targetId);
+        improvement.push_back(diff);
+      }
+    }
+    if (verbose_ >= 3)
+      ApplicationTools::displayTaskDone();
+    test = improving.size() > 0;
+    if (test)
+    {
+      size_t best = VectorTools::whichMin(improvement);
+      if (verbose_ >= 2)
+        ApplicationTools::displayResult("   Moving node " + TextTools::toString(improving[best])
+                                        + " on " + TextTools::toString(improvingTargets[best]),
+                                        TextTools::toString(improvement[best]));
+      searchableTree_->doSPR(improving[best], improvingTargets[best]);
+
+      // Notify:
+      notifyAllPerformed(TopologyChangeEvent());
+
+      if (verbose_ >= 1)
+        ApplicationTools::displayResult("   Current value", TextTools::toString(searchableTree_->getTopologyValue(), 10));
+    }
+  }
+  while (test);
+}
+
@@ -0,0 +1,186 @@
+//
+// File: SPRTopologySearch.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _SPRTOPOLOGYSEARCH_H_
+#define _SPRTOPOLOGYSEARCH_H_
+
+#include "TopologySearch.h"
+#include "SPRSearchable.h"
+
+namespace bpp
+{
+
+/**
+ * @brief SPR topology search method.
+ *
+ * Only the moves regrafting a subtree at most 'radius' nodes away from its
+ * pruning point are tested (see TreeTemplateTools::getRegraftingNodes).
+ * A radius of 1 corresponds to the NNI neighbourhood.
+ *
+ * Two algorithms are implemented:
+ * - Fast algorithm: loop over all nodes, check all SPRs of the corresponding subtree
+ *   and perform the best one if it improves the score. Then reloop from the first node.
+ * - Better algorithm: loop over all nodes, check all SPRs.
+ *   Then choose the SPR corresponding to the best improvement and perform it.
+ *   Then re-loop over all nodes.
+ *
+ * Tree bisection and reconnection (TBR) moves are not implemented.
+ *
+ * @see OptimizationTools::optimizeTreeSPR
+ */
+class SPRTopologySearch :
+  public virtual TopologySearch
+{
+	public:
+		const static std::string FAST;
+		const static std::string BETTER;
+		
+	private:
+		SPRSearchable* searchableTree_;
+    std::string algorithm_;
+    unsigned int radius_;
+		unsigned int verbose_;
+    std::vector<TopologyListener*> topoListeners_;
+		
+	public:
+		SPRTopologySearch(
+        SPRSearchable& tree,
+        const std::string& algorithm = FAST,
+        unsigned int radius = 3,
+        unsigned int verbose = 2) :
+      searchableTree_(&tree), algorithm_(algorithm), radius_(radius), verbose_(verbose), topoListeners_()
+    {}
+
+    SPRTopologySearch(const SPRTopologySearch& ts) :
+      searchableTree_(ts.searchableTree_),
+      algorithm_(ts.algorithm_),
+      radius_(ts.radius_),
+      verbose_(ts.verbose_),
+      topoListeners_(ts.topoListeners_)
+    {
+      //Hard-copy all listeners:
+      for (unsigned int i = 0; i < topoListeners_.size(); i++)
+        topoListeners_[i] = dynamic_cast<TopologyListener*>(ts.topoListeners_[i]->clone());
+    }
+	
+    SPRTopologySearch& operator=(const SPRTopologySearch& ts)
+    {
+      searchableTree_ = ts.searchableTree_;
+      algorithm_      = ts.algorithm_;
+      radius_         = ts.radius_;
+      verbose_        = ts.verbose_;
+      topoListeners_  = ts.topoListeners_;
+      //Hard-copy all listeners:
+      for (unsigned int i = 0; i < topoListeners_.size(); i++)
+        topoListeners_[i] = dynamic_cast<TopologyListener*>(ts.topoListeners_[i]->clone());
+      return *this;
+    }
+	
+		virtual ~SPRTopologySearch()
+    {
+      for (std::vector <TopologyListener*>::iterator it = topoListeners_.begin();
+           it != topoListeners_.end();
+           it++)
+        delete *it;
+    }
+
+	public:
+		void search();
+    
+    /**
+     * @brief Add a listener to the list.
+     *
+     * All listeners will be notified in the order of the list.
+     * The first listener to be notified is the SPRSearchable object itself.
+     *
+     * The listener will be owned by this instance, and copied when needed.
+     */
+    void addTopologyListener(TopologyListener* listener)
+    {
+      if (listener)
+        topoListeners_.push_back(listener);
+    }
+
+    /**
+     * @brief Set the maximum distance between the pruning and the regrafting points.
+     */
+    void setRadius(unsigned int radius) { radius_ = radius; }
+
+    unsigned int getRadius() const { return radius_; }
+
+	public:
+		/**
+		 * @brief Retrieve the tree.
+		 *
+		 * @return The tree associated to this instance.
+		 */
+		const Tree& getTopology() const { return searchableTree_->getTopology(); }
+		
+    /**
+     * @return The SPRSearchable object associated to this instance.
+     */
+    SPRSearchable* getSearchableObject() { return searchableTree_; }
+    /**
+     * @return The SPRSearchable object associated to this instance.
+     */
+    const SPRSearchable* getSearchableObject() const { return searchableTree_; }
+
+	protected:
+		void searchFast();
+		void searchBetter();
+
+    /**
+     * @brief Test all SPRs of a subtree.
+     *
+     * @param nodeId   The pruned node.
+     * @param targetId [out] The best target node, if any.
+     * @return The best score variation, or 0 if no SPR was tested.
+     */
+    double testAllSPRs_(int nodeId, int& targetId);
+
+    /**
+     * @brief Process a TopologyChangeEvent to all listeners.
+     */
+    void notifyAllPerformed(const TopologyChangeEvent& event);		
+};
+
+} //end of namespace bpp.
+
+#endif //_SPRTOPOLOGYSEARCH_H_
+
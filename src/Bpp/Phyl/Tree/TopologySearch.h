@@ -57,10 +57,12 @@ class TopologyChangeEvent
 {
 	protected:
     std::string message_;
+    std::vector<int> nodeIds_;
 		
 	public:
-		TopologyChangeEvent(): message_("") {}
-		TopologyChangeEvent(const std::string& message): message_(message) {}
+		TopologyChangeEvent(): message_(""), nodeIds_() {}
+		TopologyChangeEvent(const std::string& message): message_(message), nodeIds_() {}
+		TopologyChangeEvent(const std::string& message, const std::vector<int>& nodeIds): message_(message), nodeIds_(nodeIds) {}
 		virtual ~TopologyChangeEvent() {}
 
 	public:
@@ -71,6 +73,15 @@ class TopologyChangeEvent
 		 */
 		virtual const std::string& getMessage() const { return message_; }
 
+		/**
+		 * @brief Get the ids of the nodes under the branches around which the topology was changed.
+		 *
+		 * The vector may be empty if the search does not record this information.
+		 *
+		 * @return A vector of node ids.
+		 */
+		virtual const std::vector<int>& getNodeIds() const { return nodeIds_; }
+
 };
 
 class TopologySearch;
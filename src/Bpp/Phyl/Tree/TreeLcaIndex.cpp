@@ -0,0 +1,234 @@
+//
+// File: TreeLcaIndex.cpp
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "TreeLcaIndex.h"
+
+#include <Bpp/Exceptions.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+
+using namespace std;
+
+/******************************************************************************/
+
+TreeLcaIndex::TreeLcaIndex(const Tree& tree) :
+  topology_(tree),
+  depths_(),
+  distancesToRoot_(),
+  hasAllBranchLengths_(true),
+  firstOccurrences_(),
+  sparseTable_(),
+  logs_()
+{
+  build_();
+}
+
+TreeLcaIndex::TreeLcaIndex(const PhyloTree& tree) :
+  topology_(tree),
+  depths_(),
+  distancesToRoot_(),
+  hasAllBranchLengths_(true),
+  firstOccurrences_(),
+  sparseTable_(),
+  logs_()
+{
+  build_();
+}
+
+TreeLcaIndex::TreeLcaIndex(const FlatTopology& topology) :
+  topology_(topology),
+  depths_(),
+  distancesToRoot_(),
+  hasAllBranchLengths_(true),
+  firstOccurrences_(),
+  sparseTable_(),
+  logs_()
+{
+  build_();
+}
+
+/******************************************************************************/
+
+void TreeLcaIndex::build_()
+{
+  size_t n = topology_.getNumberOfNodes();
+
+  //Fathers come before their sons:
+  depths_.assign(n, 0);
+  distancesToRoot_.assign(n, 0.);
+  for (size_t i = 1; i < n; i++)
+  {
+    size_t father = topology_.getFather(i);
+    depths_[i] = depths_[father] + 1;
+    distancesToRoot_[i] = distancesToRoot_[father] + topology_.getBranchLength(i);
+    if (!topology_.hasBranchLength(i))
+      hasAllBranchLengths_ = false;
+  }
+
+  //Euler tour: each node is written when entered, and again when coming back from each of its sons.
+  vector<size_t> tour;
+  tour.reserve(n > 0 ? 2 * n - 1 : 0);
+  firstOccurrences_.assign(n, 0);
+  vector<pair<size_t, size_t> > stack;
+  if (n > 0)
+  {
+    stack.push_back(make_pair(topology_.getRootIndex(), 0));
+    tour.push_back(topology_.getRootIndex());
+  }
+  while (!stack.empty())
+  {
+    size_t node = stack.back().first;
+    size_t& k = stack.back().second;
+    if (k < topology_.getNumberOfSons(node))
+    {
+      size_t son = topology_.getSon(node, k);
+      k++;
+      stack.push_back(make_pair(son, 0));
+      firstOccurrences_[son] = tour.size();
+      tour.push_back(son);
+    }
+    else
+    {
+      stack.pop_back();
+      if (!stack.empty())
+        tour.push_back(stack.back().first);
+    }
+  }
+
+  //Sparse table over the tour:
+  size_t size = tour.size();
+  logs_.assign(size + 1, 0);
+  for (size_t i = 2; i <= size; i++)
+  {
+    logs_[i] = logs_[i / 2] + 1;
+  }
+  sparseTable_.assign(1, tour);
+  for (size_t k = 1; (static_cast<size_t>(1) << k) <= size; k++)
+  {
+    const vector<size_t>& previous = sparseTable_[k - 1];
+    size_t half = static_cast<size_t>(1) << (k - 1);
+    vector<size_t> level(size - 2 * half + 1);
+    for (size_t i = 0; i < level.size(); i++)
+    {
+      size_t a = previous[i], b = previous[i + half];
+      level[i] = (depths_[a] <= depths_[b] ? a : b);
+    }
+    sparseTable_.push_back(level);
+  }
+}
+
+/******************************************************************************/
+
+size_t TreeLcaIndex::getLastCommonAncestorIndex_(size_t index1, size_t index2) const
+{
+  size_t i = firstOccurrences_[index1];
+  size_t j = firstOccurrences_[index2];
+  if (i > j)
+    swap(i, j);
+  size_t k = logs_[j - i + 1];
+  size_t a = sparseTable_[k][i];
+  size_t b = sparseTable_[k][j + 1 - (static_cast<size_t>(1) << k)];
+  return depths_[a] <= depths_[b] ? a : b;
+}
+
+/******************************************************************************/
+
+int TreeLcaIndex::getLastCommonAncestor(const vector<int>& nodeIds) const
+{
+  if (nodeIds.size() == 0)
+    throw Exception("TreeLcaIndex::getLastCommonAncestor(). You must provide at least one node id.");
+  size_t lca = topology_.getIndex(nodeIds[0]);
+  for (size_t i = 1; i < nodeIds.size(); i++)
+  {
+    lca = getLastCommonAncestorIndex_(lca, topology_.getIndex(nodeIds[i]));
+  }
+  return topology_.getNodeId(lca);
+}
+
+/******************************************************************************/
+
+size_t TreeLcaIndex::getNumberOfBranchesBetween(int nodeId1, int nodeId2) const
+{
+  size_t index1 = topology_.getIndex(nodeId1);
+  size_t index2 = topology_.getIndex(nodeId2);
+  size_t lca = getLastCommonAncestorIndex_(index1, index2);
+  return depths_[index1] + depths_[index2] - 2 * depths_[lca];
+}
+
+/******************************************************************************/
+
+double TreeLcaIndex::getDistanceBetweenAnyTwoNodes(int nodeId1, int nodeId2) const
+{
+  size_t index1 = topology_.getIndex(nodeId1);
+  size_t index2 = topology_.getIndex(nodeId2);
+  if (!hasAllBranchLengths_)
+    throw Exception("TreeLcaIndex::getDistanceBetweenAnyTwoNodes(). Some branches of the tree have no length.");
+  size_t lca = getLastCommonAncestorIndex_(index1, index2);
+  return distancesToRoot_[index1] + distancesToRoot_[index2] - 2. * distancesToRoot_[lca];
+}
+
+/******************************************************************************/
+
+vector<int> TreeLcaIndex::getPathBetweenAnyTwoNodes(int nodeId1, int nodeId2, bool includeAncestor) const
+{
+  size_t index1 = topology_.getIndex(nodeId1);
+  size_t index2 = topology_.getIndex(nodeId2);
+  size_t lca = getLastCommonAncestorIndex_(index1, index2);
+  vector<int> path;
+  path.reserve(depths_[index1] + depths_[index2] - 2 * depths_[lca] + 1);
+  for (size_t i = index1; i != lca; i = topology_.getFather(i))
+  {
+    path.push_back(topology_.getNodeId(i));
+  }
+  if (includeAncestor)
+    path.push_back(topology_.getNodeId(lca));
+  size_t middle = path.size();
+  for (size_t i = index2; i != lca; i = topology_.getFather(i))
+  {
+    path.push_back(topology_.getNodeId(i));
+  }
+  reverse(path.begin() + static_cast<ptrdiff_t>(middle), path.end());
+  return path;
+}
+
+/******************************************************************************/
+
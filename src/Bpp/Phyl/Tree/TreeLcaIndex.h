@@ -0,0 +1,139 @@
+//
+// File: TreeLcaIndex.h
+// Created by: Julien Dutheil
+// Created on: October 14, 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _TREELCAINDEX_H_
+#define _TREELCAINDEX_H_
+
+#include "FlatTopology.h"
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief An index answering last common ancestor and distance queries in constant time.
+ *
+ * The index is built once from a FlatTopology snapshot of a tree: it stores an Euler tour
+ * of the tree, a sparse table giving the least deep node of any range of the tour, and the
+ * depth and distance to the root of each node. The last common ancestor of two nodes is
+ * the least deep node of the tour between their first occurrences, and the distance between
+ * them follows from their distances to the root.
+ *
+ * Like the snapshot it is built from, the index does not follow the tree: it must be rebuilt
+ * after any change of topology or branch lengths.
+ *
+ * Nodes are designated by their id in the original tree (the node index for a PhyloTree).
+ *
+ * @see TreeTools::getLastCommonAncestor, TreeTools::getDistanceBetweenAnyTwoNodes
+ */
+class TreeLcaIndex
+{
+  private:
+    FlatTopology topology_;
+    std::vector<size_t> depths_;            // Number of branches to the root.
+    std::vector<double> distancesToRoot_;
+    bool hasAllBranchLengths_;
+    std::vector<size_t> firstOccurrences_;  // Position of the first occurrence of each node in the tour.
+    std::vector< std::vector<size_t> > sparseTable_; // Level k gives the least deep node of tour ranges of size 2^k.
+    std::vector<size_t> logs_;              // Floor of log2, for range sizes.
+
+  public:
+    TreeLcaIndex(const Tree& tree);
+
+    TreeLcaIndex(const PhyloTree& tree);
+
+    TreeLcaIndex(const FlatTopology& topology);
+
+  public:
+    const FlatTopology& getTopology() const { return topology_; }
+
+    /**
+     * @return The id of the last common ancestor of two nodes.
+     * @throw NodeNotFoundException If a node is not found.
+     */
+    int getLastCommonAncestor(int nodeId1, int nodeId2) const
+    {
+      return topology_.getNodeId(getLastCommonAncestorIndex_(topology_.getIndex(nodeId1), topology_.getIndex(nodeId2)));
+    }
+
+    /**
+     * @return The id of the last common ancestor of all specified nodes.
+     * @throw NodeNotFoundException If a node is not found.
+     * @throw Exception If no node is given.
+     */
+    int getLastCommonAncestor(const std::vector<int>& nodeIds) const;
+
+    /**
+     * @return The number of branches between two nodes.
+     * @throw NodeNotFoundException If a node is not found.
+     */
+    size_t getNumberOfBranchesBetween(int nodeId1, int nodeId2) const;
+
+    /**
+     * @return The sum of all branch lengths between two nodes.
+     * @throw NodeNotFoundException If a node is not found.
+     * @throw Exception If some branches of the tree have no length.
+     */
+    double getDistanceBetweenAnyTwoNodes(int nodeId1, int nodeId2) const;
+
+    /**
+     * @brief Get the path between two nodes, in the same order as TreeTools::getPathBetweenAnyTwoNodes.
+     *
+     * Only the nodes of the path are visited.
+     *
+     * @param nodeId1 Id of first node.
+     * @param nodeId2 Id of second node.
+     * @param includeAncestor Tell if the common ancestor must be included in the vector.
+     * @return A vector of node ids.
+     * @throw NodeNotFoundException If a node is not found.
+     */
+    std::vector<int> getPathBetweenAnyTwoNodes(int nodeId1, int nodeId2, bool includeAncestor = true) const;
+
+  private:
+    void build_();
+
+    size_t getLastCommonAncestorIndex_(size_t index1, size_t index2) const;
+};
+
+} //end of namespace bpp.
+
+#endif //_TREELCAINDEX_H_
+
@@ -41,6 +41,7 @@
 
 #include "TreeTemplateTools.h"
 #include "TreeTemplate.h"
+#include "../SiteLoopExecutor.h"
 
 #include <Bpp/Numeric/Number.h>
 #include <Bpp/BppString.h>
@@ -55,6 +56,8 @@ using namespace bpp;
 #include <iostream>
 #include <sstream>
 #include <limits>
+#include <cctype>
+#include <functional>
 
 using namespace std;
 
@@ -239,83 +242,211 @@ TreeTemplateTools::Element TreeTemplateTools::getElement(const string& elt)
 /******************************************************************************/
 
 
-Node* TreeTemplateTools::parenthesisToNode(const string& description, unsigned int& nodeCounter, bool bootstrap, const string& propertyName, bool withId, bool verbose)
+namespace
 {
-  // cout << "NODE: " << description << endl;
-  Element elt = getElement(description);
-
-  // New node:
-  Node* node = new Node();
-  if (!TextTools::isEmpty(elt.length))
-  {
-    node->setDistanceToFather(TextTools::toDouble(elt.length));
-    // cout << "NODE: LENGTH: " << * elt.length << endl;
+  /**
+   * @brief Find the next parenthesis or comma from position first, ignoring those within single quotes.
+   *
+   * @return The position found, or the size of the description if there is none.
+   */
+  size_t findDelimiter(const string& description, size_t first)
+  {
+    size_t n = description.size();
+    bool quoted = false;
+    for (size_t k = first; k < n; k++)
+    {
+      char c = description[k];
+      if (c == '\'')
+        quoted = !quoted;
+      else if (!quoted && (c == ',' || c == '(' || c == ')'))
+        return k;
+    }
+    if (quoted)
+      throw IOException("TreeTemplateTools::parseParenthesis(). Invalid format: unterminated quoted label in " + description.substr(first));
+    return n;
   }
-  if (!TextTools::isEmpty(elt.bootstrap))
+
+  /**
+   * @brief Read the optional label and length of an element, in description[first, last).
+   *
+   * Quoted labels are kept with their quotes.
+   */
+  void readLabelAndLength(const string& description, size_t first, size_t last, TreeTemplateTools::Element& element, bool isLeaf)
   {
-    if (withId)
+    size_t colon = last;
+    bool quoted = false;
+    for (size_t k = first; k < last; k++)
     {
-      node->setId(TextTools::toInt(elt.bootstrap));
+      if (description[k] == '\'')
+        quoted = !quoted;
+      else if (!quoted && description[k] == ':')
+        colon = k;
     }
-    else
+    if (colon < last)
+      element.length = TextTools::removeSurroundingWhiteSpaces(description.substr(colon + 1, last - colon - 1));
+    string label = TextTools::removeSurroundingWhiteSpaces(description.substr(first, colon - first));
+    element.isLeaf = isLeaf;
+    if (isLeaf)
+      element.content = label;
+    else if (!TextTools::isEmpty(label))
+      element.bootstrap = label;
+  }
+}
+
+void TreeTemplateTools::parseParenthesis(const string& description, vector<Element>& elements, vector<size_t>& fathers, vector<size_t>& postorder)
+{
+  const size_t noFather = numeric_limits<size_t>::max();
+  elements.clear();
+  fathers.clear();
+  postorder.clear();
+
+  vector<size_t> open; // Internal nodes whose closing parenthesis was not read yet.
+  size_t n = description.size();
+  size_t i = 0;
+  bool expectElement = true;
+  while (expectElement || i < n)
+  {
+    if (expectElement)
     {
-      if (bootstrap)
-      {
-        node->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(TextTools::toDouble(elt.bootstrap)));
-        // cout << "NODE: BOOTSTRAP: " << * elt.bootstrap << endl;
-      }
-      else
+      while (i < n && isspace(static_cast<unsigned char>(description[i])))
+        i++;
+      size_t father = open.empty() ? noFather : open.back();
+      elements.push_back(Element());
+      fathers.push_back(father);
+      if (i < n && description[i] == '(')
       {
-        node->setBranchProperty(propertyName, BppString(elt.bootstrap));
+        // Internal node, its sons come next:
+        open.push_back(elements.size() - 1);
+        i++;
+        continue;
       }
+      // Leaf:
+      size_t j = findDelimiter(description, i);
+      if (j < n && description[j] == '(')
+        throw IOException("TreeTemplateTools::parseParenthesis(). Invalid format: unexpected opening parenthesis in " + description.substr(i, j - i + 1));
+      readLabelAndLength(description, i, j, elements.back(), true);
+      postorder.push_back(elements.size() - 1);
+      i = j;
+      expectElement = false;
+    }
+    else if (description[i] == ',')
+    {
+      if (open.empty())
+        throw IOException("TreeTemplateTools::parseParenthesis(). Invalid format: several elements at the root level.");
+      i++;
+      expectElement = true;
+    }
+    else
+    {
+      // Closing parenthesis, the label and length of the node follow:
+      if (open.empty())
+        throw IOException("TreeTemplateTools::parseParenthesis(). Invalid format: bad closing parenthesis.");
+      size_t node = open.back();
+      open.pop_back();
+      i++;
+      size_t j = findDelimiter(description, i);
+      if (j < n && description[j] == '(')
+        throw IOException("TreeTemplateTools::parseParenthesis(). Invalid format: unexpected opening parenthesis in " + description.substr(i, j - i + 1));
+      readLabelAndLength(description, i, j, elements[node], false);
+      postorder.push_back(node);
+      i = j;
     }
   }
+  if (!open.empty())
+    throw IOException("TreeTemplateTools::parseParenthesis(). Invalid format: missing closing parenthesis.");
+}
 
-  NestedStringTokenizer nt(elt.content, "(", ")", ",");
-  vector<string> elements;
-  while (nt.hasMoreToken())
-  {
-    elements.push_back(nt.nextToken());
-  }
+/******************************************************************************/
+
+Node* TreeTemplateTools::parenthesisToNode(const string& description, unsigned int& nodeCounter, bool bootstrap, const string& propertyName, bool withId, bool verbose, vector<Node*>* pool)
+{
+  vector<Element> elements;
+  vector<size_t> fathers, postorder;
+  parseParenthesis(description, elements, fathers, postorder);
 
-  if (elt.isLeaf)
+  vector<Node*> nodes(elements.size());
+  try
   {
-    // This is a leaf:
-    string name = TextTools::removeSurroundingWhiteSpaces(elements[0]);
-    if (withId)
+    for (size_t k = 0; k < elements.size(); k++)
     {
-      StringTokenizer st(name, "_", true, true);
-      ostringstream realName;
-      for (size_t i = 0; i < st.numberOfRemainingTokens() - 1; ++i)
+      const Element& elt = elements[k];
+      // New node, recycled if possible:
+      Node* node;
+      if (pool && !pool->empty())
+      {
+        node = pool->back();
+        pool->pop_back();
+      }
+      else
+        node = new Node();
+      nodes[k] = node;
+      if (fathers[k] != numeric_limits<size_t>::max())
+        nodes[fathers[k]]->addSon(node);
+      if (!TextTools::isEmpty(elt.length))
+      {
+        node->setDistanceToFather(TextTools::toDouble(elt.length));
+      }
+      if (!TextTools::isEmpty(elt.bootstrap))
       {
-        if (i != 0)
+        if (withId)
         {
-          realName << "_";
+          node->setId(TextTools::toInt(elt.bootstrap));
+        }
+        else
+        {
+          if (bootstrap)
+          {
+            node->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(TextTools::toDouble(elt.bootstrap)));
+          }
+          else
+          {
+            node->setBranchProperty(propertyName, BppString(elt.bootstrap));
+          }
+        }
+      }
+
+      if (elt.isLeaf)
+      {
+        // This is a leaf:
+        if (withId)
+        {
+          StringTokenizer st(elt.content, "_", true, true);
+          ostringstream realName;
+          for (size_t i = 0; i < st.numberOfRemainingTokens() - 1; ++i)
+          {
+            if (i != 0)
+            {
+              realName << "_";
+            }
+            realName << st.getToken(i);
+          }
+          node->setName(realName.str());
+          node->setId(TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1)));
+        }
+        else
+        {
+          node->setName(elt.content);
         }
-        realName << st.getToken(i);
       }
-      node->setName(realName.str());
-      node->setId(TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1)));
-    }
-    else
-    {
-      node->setName(name);
     }
   }
-  else
+  catch (...)
   {
-    // This is a node:
-    for (size_t i = 0; i < elements.size(); i++)
+    // Nodes are created in preorder, each one attached to its father:
+    if (!nodes.empty() && nodes[0])
     {
-      // cout << "NODE: SUBNODE: " << i << ", " << elements[i] << endl;
-      Node* son = parenthesisToNode(elements[i], nodeCounter, bootstrap, propertyName, withId, verbose);
-      node->addSon(son);
+      deleteSubtree(nodes[0]);
+      delete nodes[0];
     }
+    throw;
   }
-  nodeCounter++;
-  if (verbose)
-    ApplicationTools::displayUnlimitedGauge(nodeCounter);
-  return node;
+  for (size_t k = 0; k < postorder.size(); k++)
+  {
+    nodeCounter++;
+    if (verbose)
+      ApplicationTools::displayUnlimitedGauge(nodeCounter);
+  }
+  return nodes[0];
 }
 
 /******************************************************************************/
@@ -343,9 +474,9 @@ TreeTemplate<Node>* TreeTemplateTools::parenthesisToTree(const string& descripti
 
 /******************************************************************************/
 
-string TreeTemplateTools::nodeToParenthesis(const Node& node, bool writeId)
+void TreeTemplateTools::nodeToParenthesis(const Node& node, ostream& s, bool writeId)
 {
-  ostringstream s;
+  TreeTools::DefaultNumberFormat format(s);
   if (node.hasNoSon())
   {
     s << node.getName();
@@ -353,10 +484,11 @@ string TreeTemplateTools::nodeToParenthesis(const Node& node, bool writeId)
   else
   {
     s << "(";
-    s << nodeToParenthesis(*node[0], writeId);
+    nodeToParenthesis(*node[0], s, writeId);
     for (int i = 1; i < static_cast<int>(node.getNumberOfSons()); i++)
     {
-      s << "," << nodeToParenthesis(*node[i], writeId);
+      s << ",";
+      nodeToParenthesis(*node[i], s, writeId);
     }
     s << ")";
   }
@@ -373,14 +505,22 @@ string TreeTemplateTools::nodeToParenthesis(const Node& node, bool writeId)
   }
   if (node.hasDistanceToFather())
     s << ":" << node.getDistanceToFather();
-  return s.str();
 }
 
 /******************************************************************************/
 
-string TreeTemplateTools::nodeToParenthesis(const Node& node, bool bootstrap, const string& propertyName)
+string TreeTemplateTools::nodeToParenthesis(const Node& node, bool writeId)
 {
   ostringstream s;
+  nodeToParenthesis(node, s, writeId);
+  return s.str();
+}
+
+/******************************************************************************/
+
+void TreeTemplateTools::nodeToParenthesis(const Node& node, ostream& s, bool bootstrap, const string& propertyName)
+{
+  TreeTools::DefaultNumberFormat format(s);
   if (node.hasNoSon())
   {
     s << node.getName();
@@ -388,10 +528,11 @@ string TreeTemplateTools::nodeToParenthesis(const Node& node, bool bootstrap, co
   else
   {
     s << "(";
-    s << nodeToParenthesis(*node[0], bootstrap, propertyName);
+    nodeToParenthesis(*node[0], s, bootstrap, propertyName);
     for (int i = 1; i < static_cast<int>(node.getNumberOfSons()); i++)
     {
-      s << "," << nodeToParenthesis(*node[i], bootstrap, propertyName);
+      s << ",";
+      nodeToParenthesis(*node[i], s, bootstrap, propertyName);
     }
     s << ")";
 
@@ -414,14 +555,22 @@ string TreeTemplateTools::nodeToParenthesis(const Node& node, bool bootstrap, co
   }
   if (node.hasDistanceToFather())
     s << ":" << node.getDistanceToFather();
-  return s.str();
 }
 
 /******************************************************************************/
 
-string TreeTemplateTools::treeToParenthesis(const TreeTemplate<Node>& tree, bool writeId)
+string TreeTemplateTools::nodeToParenthesis(const Node& node, bool bootstrap, const string& propertyName)
 {
   ostringstream s;
+  nodeToParenthesis(node, s, bootstrap, propertyName);
+  return s.str();
+}
+
+/******************************************************************************/
+
+void TreeTemplateTools::treeToParenthesis(const TreeTemplate<Node>& tree, ostream& s, bool writeId)
+{
+  TreeTools::DefaultNumberFormat format(s);
   s << "(";
   const Node* node = tree.getRootNode();
   if (node->hasNoSon())
@@ -429,29 +578,39 @@ string TreeTemplateTools::treeToParenthesis(const TreeTemplate<Node>& tree, bool
     s << node->getName();
     for (size_t i = 0; i < node->getNumberOfSons(); ++i)
     {
-      s << "," << nodeToParenthesis(*node->getSon(i), writeId);
+      s << ",";
+      nodeToParenthesis(*node->getSon(i), s, writeId);
     }
   }
   else
   {
-    s << nodeToParenthesis(*node->getSon(0), writeId);
+    nodeToParenthesis(*node->getSon(0), s, writeId);
     for (size_t i = 1; i < node->getNumberOfSons(); ++i)
     {
-      s << "," << nodeToParenthesis(*node->getSon(i), writeId);
+      s << ",";
+      nodeToParenthesis(*node->getSon(i), s, writeId);
     }
   }
   s << ")";
   if (node->hasDistanceToFather())
     s << ":" << node->getDistanceToFather();
-  s << ";" << endl;
-  return s.str();
+  s << ";\n";
 }
 
 /******************************************************************************/
 
-string TreeTemplateTools::treeToParenthesis(const TreeTemplate<Node>& tree, bool bootstrap, const string& propertyName)
+string TreeTemplateTools::treeToParenthesis(const TreeTemplate<Node>& tree, bool writeId)
 {
   ostringstream s;
+  treeToParenthesis(tree, s, writeId);
+  return s.str();
+}
+
+/******************************************************************************/
+
+void TreeTemplateTools::treeToParenthesis(const TreeTemplate<Node>& tree, ostream& s, bool bootstrap, const string& propertyName)
+{
+  TreeTools::DefaultNumberFormat format(s);
   s << "(";
   const Node* node = tree.getRootNode();
   if (node->hasNoSon())
@@ -459,15 +618,17 @@ string TreeTemplateTools::treeToParenthesis(const TreeTemplate<Node>& tree, bool
     s << node->getName();
     for (size_t i = 0; i < node->getNumberOfSons(); i++)
     {
-      s << "," << nodeToParenthesis(*node->getSon(i), bootstrap, propertyName);
+      s << ",";
+      nodeToParenthesis(*node->getSon(i), s, bootstrap, propertyName);
     }
   }
   else
   {
-    s << nodeToParenthesis(*node->getSon(0), bootstrap, propertyName);
+    nodeToParenthesis(*node->getSon(0), s, bootstrap, propertyName);
     for (size_t i = 1; i < node->getNumberOfSons(); i++)
     {
-      s << "," << nodeToParenthesis(*node->getSon(i), bootstrap, propertyName);
+      s << ",";
+      nodeToParenthesis(*node->getSon(i), s, bootstrap, propertyName);
     }
   }
   s << ")";
@@ -487,7 +648,15 @@ string TreeTemplateTools::treeToParenthesis(const TreeTemplate<Node>& tree, bool
         throw Exception("TreeTemplateTools::nodeToParenthesis. Property should be a BppString.");
     }
   }
-  s << ";" << endl;
+  s << ";\n";
+}
+
+/******************************************************************************/
+
+string TreeTemplateTools::treeToParenthesis(const TreeTemplate<Node>& tree, bool bootstrap, const string& propertyName)
+{
+  ostringstream s;
+  treeToParenthesis(tree, s, bootstrap, propertyName);
   return s.str();
 }
 
@@ -750,86 +919,84 @@ double TreeTemplateTools::getDistanceBetweenAnyTwoNodes(const Node& node1, const
 
 /******************************************************************************/
 
-void TreeTemplateTools::processDistsInSubtree_(const Node* node, DistanceMatrix& matrix, vector< std::pair<string, double> >& distsToNodeFather)
+DistanceMatrix* TreeTemplateTools::getDistanceMatrix(const TreeTemplate<Node>& tree, size_t nbThreads)
 {
-  distsToNodeFather.clear();
-
-  // node-is-leaf case
-  if (node->getNumberOfSons() == 0)
-  {
-    distsToNodeFather.push_back(make_pair(node->getName(), node->getDistanceToFather()));
-    return;
+  //Nodes are numbered in preorder, so that the leaves of any subtree are a contiguous range.
+  //Leaves are found in the same order as by getLeavesNames.
+  const size_t NONE = static_cast<size_t>(-1);
+  vector<const Node*> nodes;
+  vector<size_t> fathers;
+  vector<double> depths;            //Distances to the root.
+  vector<size_t> leavesBegin;
+  vector<size_t> leaves;            //Node index of each leaf.
+  vector<string> names;
+  vector<pair<const Node*, size_t> > stack(1, make_pair(tree.getRootNode(), NONE));
+  while (!stack.empty())
+  {
+    const Node* node = stack.back().first;
+    size_t father = stack.back().second;
+    stack.pop_back();
+    size_t index = nodes.size();
+    nodes.push_back(node);
+    fathers.push_back(father);
+    depths.push_back(father == NONE ? 0. : depths[father] + node->getDistanceToFather());
+    leavesBegin.push_back(leaves.size());
+    if (node->isLeaf())
+    {
+      leaves.push_back(index);
+      names.push_back(node->getName());
+    }
+    for (size_t k = node->getNumberOfSons(); k > 0; k--)
+    {
+      stack.push_back(make_pair(node->getSon(k - 1), index));
+    }
   }
-
-  // For all leaves in node's subtree, get leaf-to-node distances.
-  // Leaves are classified upon node's sons.
-  map<const Node*, vector< pair<string, double> > > leavesDists;
-  for (size_t i = 0; i < node->getNumberOfSons(); ++i)
+  //Count leaves in subtrees, sons coming after their father:
+  vector<size_t> nbLeaves(nodes.size(), 0);
+  for (size_t i = nodes.size(); i > 0; i--)
   {
-    const Node* son = node->getSon(i);
-    processDistsInSubtree_(son, matrix, leavesDists[son]); // recursivity
+    size_t v = i - 1;
+    if (nodes[v]->isLeaf())
+      nbLeaves[v]++;
+    if (fathers[v] != NONE)
+      nbLeaves[fathers[v]] += nbLeaves[v];
   }
-  // Write leaf-leaf distances to the distance matrix.
-  // Only pairs in which the two leaves belong to different
-  // sons are considered.
-  for (size_t son1_loc = 0; son1_loc < node->getNumberOfSons(); ++son1_loc)
+  vector<size_t> leavesEnd(nodes.size());
+  for (size_t v = 0; v < nodes.size(); v++)
   {
-    for (size_t son2_loc = 0; son2_loc < son1_loc; ++son2_loc)
-    {
-      const Node* son1 = node->getSon(son1_loc);
-      const Node* son2 = node->getSon(son2_loc);
-
-      for (vector< pair<string, double> >::iterator son1_leaf = leavesDists[son1].begin();
-           son1_leaf != leavesDists[son1].end();
-           ++son1_leaf)
-      {
-        for (vector< pair<string, double> >::iterator son2_leaf = leavesDists[son2].begin();
-             son2_leaf != leavesDists[son2].end();
-             ++son2_leaf)
-        {
-          matrix(son1_leaf->first, son2_leaf->first) =
-            matrix(son2_leaf->first, son1_leaf->first) =
-              ( son1_leaf->second + son2_leaf->second );
-        }
-      }
-    }
+    leavesEnd[v] = leavesBegin[v] + nbLeaves[v];
   }
 
-  // node-is-root case
-  if (!node->hasFather())
+  DistanceMatrix* matrix = new DistanceMatrix(names);
+  //Each row is filled independently, by going up from its leaf to the root:
+  //at each ancestor, the leaves of its subtree which were not seen yet have it
+  //as last common ancestor with the leaf of the row.
+  function<void(size_t, size_t)> loop = [&](size_t first, size_t last)
   {
-    // node-is-root-and-leaf case
-    if (node->hasNoSon() )
+    for (size_t a = first; a < last; a++)
     {
-      string root_name = node->getName();
-      for (vector< pair<string, double> >::iterator other_leaf = leavesDists[node->getSon(0)].begin();
-           other_leaf != leavesDists[node->getSon(0)].end();
-           ++other_leaf)
+      size_t u = leaves[a];
+      (*matrix)(a, a) = 0;
+      size_t seenBegin = a, seenEnd = a + 1;
+      for (size_t v = u; v != NONE; v = fathers[v])
       {
-        matrix(root_name, other_leaf->first) = matrix( other_leaf->first, root_name) = other_leaf->second;
+        double d = depths[u] - 2. * depths[v];
+        for (size_t b = leavesBegin[v]; b < seenBegin; b++)
+          (*matrix)(a, b) = d + depths[leaves[b]];
+        for (size_t b = seenEnd; b < leavesEnd[v]; b++)
+          (*matrix)(a, b) = d + depths[leaves[b]];
+        seenBegin = leavesBegin[v];
+        seenEnd = leavesEnd[v];
       }
     }
-
-    return;
-  }
-
-  // Get distances from node's father to considered leaves
-  distsToNodeFather.clear();
-  double nodeToFather = node->getDistanceToFather();
-  for (map<const Node*, vector<pair<string, double> > >::iterator son = leavesDists.begin(); son != leavesDists.end(); ++son)
+  };
+  if (nbThreads > 1 && leaves.size() > 1)
   {
-    for (vector< pair<string, double> >::iterator leaf = (son->second).begin(); leaf != (son->second).end(); ++leaf)
-    {
-      distsToNodeFather.push_back(make_pair(leaf->first, (leaf->second + nodeToFather)));
-    }
+    SiteLoopExecutor executor(min(nbThreads, leaves.size()));
+    executor.run(leaves.size(), loop);
   }
-}
-
-DistanceMatrix* TreeTemplateTools::getDistanceMatrix(const TreeTemplate<Node>& tree)
-{
-  DistanceMatrix* matrix = new DistanceMatrix(tree.getLeavesNames());
-  vector< pair<string, double> > distsToRoot;
-  processDistsInSubtree_(tree.getRootNode(), *matrix, distsToRoot);
+  else
+    loop(0, leaves.size());
   return matrix;
 }
 
@@ -850,6 +1017,128 @@ std::vector<const Node*> TreeTemplateTools::getRemainingNeighbors(const Node* no
 
 /******************************************************************************/
 
+bool TreeTemplateTools::isValidSPR(const Node* node, const Node* target)
+{
+  if (!node->hasFather() || !target->hasFather())
+    return false;
+  const Node* parent = node->getFather();
+  if (!parent->hasFather() || parent->getNumberOfSons() != 2)
+    return false;
+  if (target == parent || target->getFather() == parent)
+    return false;
+  // The target must not be in the pruned subtree:
+  for (const Node* n = target; n->hasFather(); n = n->getFather())
+  {
+    if (n == node)
+      return false;
+  }
+  return true;
+}
+
+/******************************************************************************/
+
+vector<const Node*> TreeTemplateTools::getRegraftingPath(const Node* node, const Node* target)
+{
+  if (!isValidSPR(node, target))
+    throw NodePException("TreeTemplateTools::getRegraftingPath(). Invalid SPR move.", node);
+  const Node* parent = node->getFather();
+
+  // Ancestors of the pruning point, and of the target:
+  vector<const Node*> up1, up2;
+  for (const Node* n = parent; n; n = n->hasFather() ? n->getFather() : 0)
+    up1.push_back(n);
+  for (const Node* n = target; n; n = n->hasFather() ? n->getFather() : 0)
+    up2.push_back(n);
+  size_t i1 = up1.size(), i2 = up2.size();
+  while (i1 > 0 && i2 > 0 && up1[i1 - 1] == up2[i2 - 1])
+  {
+    i1--; i2--;
+  }
+  // up1[i1] == up2[i2] is the last common ancestor.
+  vector<const Node*> path(up1.begin(), up1.begin() + static_cast<ptrdiff_t>(i1 + 1));
+  for (size_t i = i2; i > 0; i--)
+  {
+    path.push_back(up2[i - 1]);
+  }
+  // The path ends by the target. If it does not contain its father, the
+  // target is an ancestor of the pruning point, and its father is the far end:
+  if (path.size() < 2 || path[path.size() - 2] != target->getFather())
+    path.push_back(target->getFather());
+  return path;
+}
+
+/******************************************************************************/
+
+vector<int> TreeTemplateTools::getRegraftingNodes(const Node* node, unsigned int radius)
+{
+  vector<int> targets;
+  if (!node->hasFather())
+    return targets;
+  const Node* parent = node->getFather();
+  if (!parent->hasFather() || parent->getNumberOfSons() != 2)
+    return targets;
+
+  // Breadth-first walk from the pruning point, with the node we come from:
+  vector< pair<const Node*, const Node*> > front;
+  vector<const Node*> neighbors = getRemainingNeighbors(parent, node, node);
+  for (size_t k = 0; k < neighbors.size(); k++)
+  {
+    front.push_back(make_pair(neighbors[k], parent));
+  }
+  for (unsigned int d = 1; d <= radius && front.size() > 0; d++)
+  {
+    vector< pair<const Node*, const Node*> > next;
+    for (size_t i = 0; i < front.size(); i++)
+    {
+      const Node* n = front[i].first;
+      vector<const Node*> outer = getRemainingNeighbors(n, front[i].second, front[i].second);
+      for (size_t k = 0; k < outer.size(); k++)
+      {
+        const Node* m = outer[k];
+        targets.push_back(m->hasFather() && m->getFather() == n ? m->getId() : n->getId());
+        next.push_back(make_pair(m, n));
+      }
+    }
+    front.swap(next);
+  }
+  return targets;
+}
+
+/******************************************************************************/
+
+void TreeTemplateTools::pruneAndRegraft(Node* node, Node* target)
+{
+  if (!isValidSPR(node, target))
+    throw NodePException("TreeTemplateTools::pruneAndRegraft(). Invalid SPR move.", node);
+  Node* parent = node->getFather();
+  Node* grandFather = parent->getFather();
+  Node* brother = parent->getSon(parent->getSon(0) == node ? 1 : 0);
+
+  // Prune:
+  if (brother->hasDistanceToFather() && parent->hasDistanceToFather())
+    brother->setDistanceToFather(brother->getDistanceToFather() + parent->getDistanceToFather());
+  size_t parentPosition = grandFather->getSonPosition(parent);
+  parent->removeSon(brother);
+  grandFather->setSon(parentPosition, brother);
+  parent->removeFather();
+
+  // Regraft:
+  Node* targetFather = target->getFather();
+  size_t targetPosition = targetFather->getSonPosition(target);
+  targetFather->setSon(targetPosition, parent);
+  parent->addSon(target);
+  if (target->hasDistanceToFather())
+  {
+    double d = target->getDistanceToFather() / 2.;
+    target->setDistanceToFather(d);
+    parent->setDistanceToFather(d);
+  }
+  else
+    parent->deleteDistanceToFather();
+}
+
+/******************************************************************************/
+
 void TreeTemplateTools::incrementAllIds(Node* node, int increment)
 {
   node->setId(node->getId() + increment);
@@ -1055,8 +1344,7 @@ void TreeTemplateTools::midRoot(TreeTemplate<Node>& tree, short criterion, bool
   best_root_branch.second ["score"] = numeric_limits<double>::max();
 
   // find the best root
-  getBestRootInSubtree_(tree, criterion, ref_root, best_root_branch);
-  tree.rootAt(ref_root); // back to the original root
+  getBestRoot_(ref_root, criterion, best_root_branch);
 
   // reroot
   const double pos = best_root_branch.second["position"];
@@ -1163,86 +1451,134 @@ void TreeTemplateTools::unresolveUncertainNodes(Node& subtree, double threshold,
   }
 }
 
-void TreeTemplateTools::getBestRootInSubtree_(TreeTemplate<Node>& tree, short criterion, Node* node, pair<Node*, map<string, double> >& bestRoot)
+void TreeTemplateTools::getBestRoot_(Node* root, short criterion, pair<Node*, map<string, double> >& bestRoot)
 {
-  const vector<Node*> sons = node->getSons(); // copy
-  tree.rootAt(node);
-
-  // Try to place the root on each branch downward node
-  for (vector<Node*>::const_iterator son = sons.begin(); son != sons.end(); ++son)
-  {
-    // Compute the moment of the subtree on son's side
-    Moments_ son_moment = getSubtreeMoments_(*son);
-
-    // Compute the moment of the subtree on node's side
-    tree.rootAt(*son);
-    Moments_ node_moment = getSubtreeMoments_(node);
-    tree.rootAt(node);
-
-    /*
-     * Get the position of the root on this branch that
-     * minimizes the root-to-leaves distances variance.
-     *
-     * This variance can be written in the form A x^2 + B x + C
-     */
-    double min_criterion_value;
-    double best_position; // 0 is toward the root, 1 is away from it
-
-    const TreeTemplateTools::Moments_& m1 = node_moment;
-    const TreeTemplateTools::Moments_& m2 = son_moment;
-    const double d = (**son).getDistanceToFather();
-    const double n1 = m1.numberOfLeaves;
-    const double n2 = m2.numberOfLeaves;
-
-    double A = 0, B = 0, C = 0;
-    if (criterion == MIDROOT_SUM_OF_SQUARES)
-    {
-      A = (n1 + n2) * d * d;
-      B = 2 * d * (m1.sum - m2.sum) - 2 * n2 * d * d;
-      C = m1.squaresSum + m2.squaresSum
-          + 2 * m2.sum * d
-          + n2 * d * d;
-    }
-    else if (criterion == MIDROOT_VARIANCE)
+  //Nodes in preorder:
+  const size_t NONE = static_cast<size_t>(-1);
+  vector<Node*> nodes;
+  vector<size_t> fathers;
+  vector<pair<Node*, size_t> > stack(1, make_pair(root, NONE));
+  while (!stack.empty())
+  {
+    Node* node = stack.back().first;
+    fathers.push_back(stack.back().second);
+    stack.pop_back();
+    size_t index = nodes.size();
+    nodes.push_back(node);
+    for (size_t k = node->getNumberOfSons(); k > 0; k--)
     {
-      A = 4 * n1 * n2 * d * d;
-      B = 4 * d * ( n2 * m1.sum - n1 * m2.sum - d * n1 * n2);
-      C = (n1 + n2) * (m1.squaresSum + m2.squaresSum) + n1 * d * n2 * d
-          + 2 * n1 * d * m2.sum - 2 * n2 * d * m1.sum
-          - (m1.sum + m2.sum) * (m1.sum + m2.sum);
+      stack.push_back(make_pair(node->getSon(k - 1), index));
     }
+  }
+  size_t n = nodes.size();
+  vector<double> lengths(n, 0.);
+  for (size_t v = 1; v < n; v++)
+  {
+    lengths[v] = nodes[v]->getDistanceToFather();
+  }
+
+  //First pass, from the leaves: moments of the subtree of each node.
+  vector<Moments_> down(n);
+  for (size_t i = n; i > 0; i--)
+  {
+    size_t v = i - 1;
+    down[v].sum = 0;
+    down[v].squaresSum = 0;
+    down[v].numberOfLeaves = nodes[v]->isLeaf() ? 1 : 0;
+  }
+  //Sons come after their father, in preorder:
+  for (size_t i = n; i > 1; i--)
+  {
+    size_t v = i - 1;
+    addMoments_(down[fathers[v]], down[v], lengths[v]);
+  }
 
-    if (A < 1e-20)
+  //Second pass, from the root: moments of the rest of the tree, seen from the father of each node.
+  vector<Moments_> up(n);
+  vector<Moments_> all(n); //Moments of the whole tree seen from each node.
+  all[0] = down[0];
+  for (size_t v = 1; v < n; v++)
+  {
+    size_t f = fathers[v];
+    Moments_ sonSide = { 0, 0, 0 };
+    addMoments_(sonSide, down[v], lengths[v]);
+    up[v].numberOfLeaves = all[f].numberOfLeaves - sonSide.numberOfLeaves;
+    up[v].sum = all[f].sum - sonSide.sum;
+    up[v].squaresSum = all[f].squaresSum - sonSide.squaresSum;
+    all[v] = down[v];
+    addMoments_(all[v], up[v], lengths[v]);
+
+    //Score the branch leading to this node, in preorder as the former recursion did:
+    double score, position;
+    getBestRootPosition_(criterion, up[v], down[v], lengths[v], score, position);
+    if (score < bestRoot.second["score"])
     {
-      min_criterion_value = numeric_limits<double>::max();
-      best_position = 0.5;
+      bestRoot.first = nodes[v];
+      bestRoot.second["position"] = position;
+      bestRoot.second["score"] = score;
     }
-    else
+  }
+}
+
+/******************************************************************************/
+
+void TreeTemplateTools::addMoments_(Moments_& moments, const Moments_& subtree, double length)
+{
+  moments.numberOfLeaves += subtree.numberOfLeaves;
+  moments.sum += subtree.sum + length * subtree.numberOfLeaves;
+  moments.squaresSum += subtree.squaresSum + 2 * length * subtree.sum + subtree.numberOfLeaves * length * length;
+}
+
+/******************************************************************************/
+
+void TreeTemplateTools::getBestRootPosition_(short criterion, const Moments_& m1, const Moments_& m2, double d, double& score, double& position)
+{
+  /*
+   * Get the position of the root on this branch that
+   * minimizes the root-to-leaves distances variance.
+   *
+   * This variance can be written in the form A x^2 + B x + C
+   */
+  const double n1 = m1.numberOfLeaves;
+  const double n2 = m2.numberOfLeaves;
+
+  double A = 0, B = 0, C = 0;
+  if (criterion == MIDROOT_SUM_OF_SQUARES)
+  {
+    A = (n1 + n2) * d * d;
+    B = 2 * d * (m1.sum - m2.sum) - 2 * n2 * d * d;
+    C = m1.squaresSum + m2.squaresSum
+        + 2 * m2.sum * d
+        + n2 * d * d;
+  }
+  else if (criterion == MIDROOT_VARIANCE)
+  {
+    A = 4 * n1 * n2 * d * d;
+    B = 4 * d * ( n2 * m1.sum - n1 * m2.sum - d * n1 * n2);
+    C = (n1 + n2) * (m1.squaresSum + m2.squaresSum) + n1 * d * n2 * d
+        + 2 * n1 * d * m2.sum - 2 * n2 * d * m1.sum
+        - (m1.sum + m2.sum) * (m1.sum + m2.sum);
+  }
+
+  if (A < 1e-20)
+  {
+    score = numeric_limits<double>::max();
+    position = 0.5;
+  }
+  else
+  {
+    score = C - B * B / (4 * A);
+    position = -B / (2 * A);
+    if (position < 0)
     {
-      min_criterion_value = C - B * B / (4 * A);
-      best_position = -B / (2 * A);
-      if (best_position < 0)
-      {
-        best_position = 0;
-        min_criterion_value = C;
-      }
-      else if (best_position > 1)
-      {
-        best_position = 1;
-        min_criterion_value = A + B + C;
-      }
+      position = 0;
+      score = C;
     }
-
-    // Is this branch is the best seen, update 'bestRoot'
-    if (min_criterion_value < bestRoot.second["score"])
+    else if (position > 1)
     {
-      bestRoot.first = *son;
-      bestRoot.second["position"] = best_position;
-      bestRoot.second["score"] = min_criterion_value;
+      position = 1;
+      score = A + B + C;
     }
-
-    // Recurse
-    TreeTemplateTools::getBestRootInSubtree_(tree, criterion, *son, bestRoot);
   }
 }
 
@@ -901,28 +901,18 @@ public:
    *
    * @see getDistanceBetweenAnyTwoNodes
    *
+   * Leaves are numbered in preorder, so that the leaves of each subtree form a range of
+   * indexes, and the matrix is filled row by row from these ranges and the distances of
+   * nodes to the root. Rows are independent, and can be filled by several threads.
+   *
    * @author Nicolas Rochette
    *
    * @param tree The tree to use.
+   * @param nbThreads The number of threads filling the matrix.
    * @return The distance matrix computed from tree.
    */
-  static DistanceMatrix* getDistanceMatrix(const TreeTemplate<Node>& tree);
-
-private:
-  /**
-   * @brief Inner function used by getDistanceMatrix.
-   *
-   * (1) Retrieves leaf-leaf distances in node's subtree and
-   *  writes them in the distance matrix.
-   * (2) Returns distances from node's father to those leaves.
-   *
-   * @param node The current node in the recursion.
-   * @param matrix The output matrix which will be filled.
-   * @param distsToNodeFather Intermediate computations contianing the distances of the node to the leaves.
-   */
-  static void processDistsInSubtree_(const Node* node, DistanceMatrix& matrix, std::vector< std::pair<std::string, double> >& distsToNodeFather);
+  static DistanceMatrix* getDistanceMatrix(const TreeTemplate<Node>& tree, size_t nbThreads = 1);
 
-public:
   /** @} */
 
   /**
@@ -952,6 +942,24 @@ public:
 
   static Element getElement(const std::string& elt);
 
+  /**
+   * @brief Parse a string in the parenthesis format in a single pass.
+   *
+   * The description is read once from left to right, without recursion nor copies of
+   * sub-descriptions, so that parsing is linear in the size of the description whatever
+   * the shape of the tree. Labels may be enclosed in single quotes, in which case they can
+   * contain parentheses, commas and colons. Quotes are kept in the labels.
+   *
+   * @param description The string to parse, without the final semi-colon.
+   * @param elements [Output] One element per node, in preorder. The content of a leaf is
+   * its name, the content of an internal node is empty.
+   * @param fathers  [Output] The position of the father of each element, std::numeric_limits<size_t>::max() for the root.
+   * Sons come in their order of appearance in the description.
+   * @param postorder [Output] The positions of elements, in the order in which their description ends.
+   * @throw IOException in case of bad format.
+   */
+  static void parseParenthesis(const std::string& description, std::vector<Element>& elements, std::vector<size_t>& fathers, std::vector<size_t>& postorder);
+
   /**
    * @brief Parse a string in the parenthesis format and convert it to
    * a subtree.
@@ -963,9 +971,11 @@ public:
    * @param propertyName The name of the property to store. Only used if bootstrap = false.
    * @param withId Tells if node ids have been stored in the tree. If set at "true", no bootstrap or property values can be read. Node ids are positioned as bootstrap values for internal nodes, and are concatenated to leaf names after a "_" sign.
    * @param verbose Tell if some information should be displayed, like progress bars for large trees.
+   * @param pool Nodes in their default state, used before creating new ones (optional).
+   * Nodes taken from the pool are removed from it.
    * @return A pointer toward a dynamically created subtree.
    */
-  static Node* parenthesisToNode(const std::string& description, unsigned int& nodeCounter, bool bootstrap = true, const std::string& propertyName = TreeTools::BOOTSTRAP, bool withId = false, bool verbose = true);
+  static Node* parenthesisToNode(const std::string& description, unsigned int& nodeCounter, bool bootstrap = true, const std::string& propertyName = TreeTools::BOOTSTRAP, bool withId = false, bool verbose = true, std::vector<Node*>* pool = 0);
 
   /**
    * @brief Parse a string in the parenthesis format and convert it to
@@ -993,6 +1003,13 @@ public:
    */
   static std::string nodeToParenthesis(const Node& node, bool writeId = false);
 
+  /**
+   * @brief Same as above, but writes the description to a stream.
+   *
+   * Numbers are written as in the string version, whatever the settings of the stream.
+   */
+  static void nodeToParenthesis(const Node& node, std::ostream& out, bool writeId = false);
+
   /**
    * @brief Get the parenthesis description of a subtree.
    *
@@ -1007,6 +1024,13 @@ public:
    */
   static std::string nodeToParenthesis(const Node& node, bool bootstrap, const std::string& propertyName);
 
+  /**
+   * @brief Same as above, but writes the description to a stream.
+   *
+   * Numbers are written as in the string version, whatever the settings of the stream.
+   */
+  static void nodeToParenthesis(const Node& node, std::ostream& out, bool bootstrap, const std::string& propertyName);
+
   /**
    * @brief Get the parenthesis description of a tree.
    *
@@ -1018,6 +1042,13 @@ public:
    */
   static std::string treeToParenthesis(const TreeTemplate<Node>& tree, bool writeId = false);
 
+  /**
+   * @brief Same as above, but writes the description to a stream.
+   *
+   * Numbers are written as in the string version, whatever the settings of the stream.
+   */
+  static void treeToParenthesis(const TreeTemplate<Node>& tree, std::ostream& out, bool writeId = false);
+
   /**
    * @brief Get the parenthesis description of a tree.
    *
@@ -1032,6 +1063,13 @@ public:
    */
   static std::string treeToParenthesis(const TreeTemplate<Node>& tree, bool bootstrap, const std::string& propertyName);
 
+  /**
+   * @brief Same as above, but writes the description to a stream.
+   *
+   * Numbers are written as in the string version, whatever the settings of the stream.
+   */
+  static void treeToParenthesis(const TreeTemplate<Node>& tree, std::ostream& out, bool bootstrap, const std::string& propertyName);
+
   /** @} */
 
   /**
@@ -1064,6 +1102,66 @@ public:
    */
   static std::vector<const Node*> getRemainingNeighbors(const Node* node1, const Node* node2, const Node* node3);
 
+  /**
+   * @name Subtree pruning and regrafting (SPR).
+   *
+   * A SPR move is defined by a node, whose subtree is pruned together with
+   * its father node, and by a target node, the subtree being regrafted on the
+   * branch between the target node and its father.
+   * The father of the pruned node must be a bifurcation, and not the root node.
+   *
+   * @{
+   */
+
+  /**
+   * @brief Tell if a SPR move is valid.
+   *
+   * The move is valid if the father of the node is a bifurcation which is not the root,
+   * and if the target branch is neither in the pruned subtree nor adjacent to the pruning point.
+   *
+   * @param node   The pruned node.
+   * @param target The target node.
+   * @return True if the move can be performed.
+   */
+  static bool isValidSPR(const Node* node, const Node* target);
+
+  /**
+   * @brief Get the path from the pruning point to the regrafting branch.
+   *
+   * @param node   The pruned node.
+   * @param target The target node.
+   * @return The nodes met from the father of the pruned node to the end of the
+   * target branch which is the closest to it, followed by the other end of the target branch.
+   */
+  static std::vector<const Node*> getRegraftingPath(const Node* node, const Node* target);
+
+  /**
+   * @brief Get all target nodes of SPR moves within a given radius.
+   *
+   * The distance of a move is the number of nodes separating the pruning point
+   * from the the regrafting branch, once the subtree is pruned.
+   * Moves at distance 1 are hence NNIs.
+   *
+   * @param node   The pruned node.
+   * @param radius The maximum distance of the moves.
+   * @return The ids of the target nodes.
+   */
+  static std::vector<int> getRegraftingNodes(const Node* node, unsigned int radius);
+
+  /**
+   * @brief Perform a SPR move.
+   *
+   * The two branches around the pruning point are merged, and the target branch
+   * is split in two halves. The branch length of the pruned node is not changed.
+   *
+   * @param node   The pruned node.
+   * @param target The target node.
+   * @throw NodePException If the move is not valid.
+   */
+  static void pruneAndRegraft(Node* node, Node* target);
+
+  /** @} */
+
   /**
    * @brief This method will add a given value (possibly negative) to all identifiers in a (sub)tree.
    *
@@ -1260,20 +1358,41 @@ private:
   static Moments_ getSubtreeMoments_(const Node* node);
 
   /**
-   * @brief Find, in the branches of a subtree, the root that minimizes a criterion over the tree.
+   * @brief Add the moments of a subtree, seen from the node above its base branch.
+   *
+   * @param moments The moments to update.
+   * @param subtree The moments of the subtree.
+   * @param length The length of the base branch of the subtree.
+   */
+  static void addMoments_(Moments_& moments, const Moments_& subtree, double length);
+
+  /**
+   * @brief Find the branch of the tree where placing the root minimizes a criterion.
    *
    * @details
-   * The branches are explored recursively. For each branch leaving the input node, the method
-   * computes the best root position, possibly updates the bestRoot parameter, then recurses.
+   * All branches are scored in two passes over the tree, without moving the root: moments of
+   * subtrees are computed from the leaves, then moments of the rest of the tree are computed
+   * from the root.
    *
-   * @param tree The tree to which the subtree belongs. (The root is moved.)
+   * @param root The root of the tree.
    * @param criterion The criterion to minimize. Legal values are TreeTemplateTools::MIDROOT_VARIANCE and TreeTemplateTools::MIDROOT_SUM_OF_SQUARES.
-   * @param node The root of the subtree.
    * @param bestRoot The object storing the best root found, if it is better than the initial one, or otherwise left unchanged.
    *
    * @author Nicolas Rochette, Manolo Gouy
    */
-  static void getBestRootInSubtree_(bpp::TreeTemplate<bpp::Node>& tree, short criterion,  bpp::Node* node, std::pair<bpp::Node*, std::map<std::string, double> >& bestRoot);
+  static void getBestRoot_(bpp::Node* root, short criterion, std::pair<bpp::Node*, std::map<std::string, double> >& bestRoot);
+
+  /**
+   * @brief Get the position of the root on a branch minimizing a criterion, and the value of the criterion.
+   *
+   * @param criterion The criterion to minimize.
+   * @param m1 The moments of the leaves on the side of the father node, seen from it.
+   * @param m2 The moments of the leaves on the side of the son node, seen from it.
+   * @param d The length of the branch.
+   * @param score The minimum value of the criterion.
+   * @param position The best position, 0 is toward the father node, 1 is away from it.
+   */
+  static void getBestRootPosition_(short criterion, const Moments_& m1, const Moments_& m2, double d, double& score, double& position);
 
 public:
   static const short MIDROOT_VARIANCE;
@@ -40,11 +40,13 @@
 #include "TreeTools.h"
 #include "Tree.h"
 #include "BipartitionTools.h"
+#include "BipartitionCounter.h"
 #include "../Model/Nucleotide/JCnuc.h"
 #include "../Distance/DistanceEstimation.h"
 #include "../Distance/BioNJ.h"
 #include "../Parsimony/DRTreeParsimonyScore.h"
 #include "../OptimizationTools.h"
+#include "../SiteLoopExecutor.h"
 
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/Text/StringTokenizer.h>
@@ -64,6 +66,9 @@ using namespace bpp;
 // From the STL:
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
+#include <functional>
+#include <cmath>
 
 using namespace std;
 
@@ -249,11 +254,11 @@ double TreeTools::getHeights(const Tree& tree, int nodeId, map<int, double>& hei
 
 /******************************************************************************/
 
-string TreeTools::nodeToParenthesis(const Tree& tree, int nodeId, bool writeId)
+void TreeTools::nodeToParenthesis(const Tree& tree, int nodeId, ostream& s, bool writeId)
 {
+  DefaultNumberFormat format(s);
   if (!tree.hasNode(nodeId))
     throw NodeNotFoundException("TreeTools::nodeToParenthesis", nodeId);
-  ostringstream s;
   if (tree.hasNoSon(nodeId))
   {
     s << tree.getNodeName(nodeId);
@@ -262,10 +267,11 @@ string TreeTools::nodeToParenthesis(const Tree& tree, int nodeId, bool writeId)
   {
     s << "(";
     vector<int> sonsId = tree.getSonsId(nodeId);
-    s << nodeToParenthesis(tree, sonsId[0], writeId);
+    nodeToParenthesis(tree, sonsId[0], s, writeId);
     for (size_t i = 1; i < sonsId.size(); i++)
     {
-      s << "," << nodeToParenthesis(tree, sonsId[i], writeId);
+      s << ",";
+      nodeToParenthesis(tree, sonsId[i], s, writeId);
     }
     s << ")";
   }
@@ -282,16 +288,24 @@ string TreeTools::nodeToParenthesis(const Tree& tree, int nodeId, bool writeId)
   }
   if (tree.hasDistanceToFather(nodeId))
     s << ":" << tree.getDistanceToFather(nodeId);
+}
+
+/******************************************************************************/
+
+string TreeTools::nodeToParenthesis(const Tree& tree, int nodeId, bool writeId)
+{
+  ostringstream s;
+  nodeToParenthesis(tree, nodeId, s, writeId);
   return s.str();
 }
 
 /******************************************************************************/
 
-string TreeTools::nodeToParenthesis(const Tree& tree, int nodeId, bool bootstrap, const string& propertyName)
+void TreeTools::nodeToParenthesis(const Tree& tree, int nodeId, ostream& s, bool bootstrap, const string& propertyName)
 {
+  DefaultNumberFormat format(s);
   if (!tree.hasNode(nodeId))
     throw NodeNotFoundException("TreeTools::nodeToParenthesis", nodeId);
-  ostringstream s;
 
   if (tree.hasNoSon(nodeId))
   {
@@ -301,10 +315,11 @@ string TreeTools::nodeToParenthesis(const Tree& tree, int nodeId, bool bootstrap
   {
     s << "(";
     vector<int> sonsId = tree.getSonsId(nodeId);
-    s << nodeToParenthesis(tree, sonsId[0], bootstrap, propertyName);
+    nodeToParenthesis(tree, sonsId[0], s, bootstrap, propertyName);
     for (size_t i = 1; i < sonsId.size(); i++)
     {
-      s << "," << nodeToParenthesis(tree, sonsId[i], bootstrap, propertyName);
+      s << ",";
+      nodeToParenthesis(tree, sonsId[i], s, bootstrap, propertyName);
     }
     s << ")";
 
@@ -321,15 +336,22 @@ string TreeTools::nodeToParenthesis(const Tree& tree, int nodeId, bool bootstrap
   }
   if (tree.hasDistanceToFather(nodeId))
     s << ":" << tree.getDistanceToFather(nodeId);
-  
-  return s.str();
 }
 
 /******************************************************************************/
 
-string TreeTools::treeToParenthesis(const Tree& tree, bool writeId)
+string TreeTools::nodeToParenthesis(const Tree& tree, int nodeId, bool bootstrap, const string& propertyName)
 {
   ostringstream s;
+  nodeToParenthesis(tree, nodeId, s, bootstrap, propertyName);
+  return s.str();
+}
+
+/******************************************************************************/
+
+void TreeTools::treeToParenthesis(const Tree& tree, ostream& s, bool writeId)
+{
+  DefaultNumberFormat format(s);
   s << "(";
   int rootId = tree.getRootId();
   vector<int> sonsId = tree.getSonsId(rootId);
@@ -338,30 +360,40 @@ string TreeTools::treeToParenthesis(const Tree& tree, bool writeId)
     s << tree.getNodeName(rootId);
     for (size_t i = 0; i < sonsId.size(); i++)
     {
-      s << "," << nodeToParenthesis(tree, sonsId[i], writeId);
+      s << ",";
+      nodeToParenthesis(tree, sonsId[i], s, writeId);
     }
   }
   else
   {
     if (sonsId.size() > 0)
     {
-      s << nodeToParenthesis(tree, sonsId[0], writeId);
+      nodeToParenthesis(tree, sonsId[0], s, writeId);
       for (size_t i = 1; i < sonsId.size(); i++)
       {
-        s << "," << nodeToParenthesis(tree, sonsId[i], writeId);
+        s << ",";
+        nodeToParenthesis(tree, sonsId[i], s, writeId);
       }
     }
     // Otherwise, this is an empty tree!
   }
-  s << ");" << endl;
-  return s.str();
+  s << ");\n";
 }
 
 /******************************************************************************/
 
-string TreeTools::treeToParenthesis(const Tree& tree, bool bootstrap, const string& propertyName)
+string TreeTools::treeToParenthesis(const Tree& tree, bool writeId)
 {
   ostringstream s;
+  treeToParenthesis(tree, s, writeId);
+  return s.str();
+}
+
+/******************************************************************************/
+
+void TreeTools::treeToParenthesis(const Tree& tree, ostream& s, bool bootstrap, const string& propertyName)
+{
+  DefaultNumberFormat format(s);
   s << "(";
   int rootId = tree.getRootId();
   vector<int> sonsId = tree.getSonsId(rootId);
@@ -371,15 +403,17 @@ string TreeTools::treeToParenthesis(const Tree& tree, bool bootstrap, const stri
     s << tree.getNodeName(rootId);
     for (size_t i = 0; i < sonsId.size(); i++)
     {
-      s << "," << nodeToParenthesis(tree, sonsId[i], bootstrap, propertyName);
+      s << ",";
+      nodeToParenthesis(tree, sonsId[i], s, bootstrap, propertyName);
     }
   }
   else
   {
-    s << nodeToParenthesis(tree, sonsId[0], bootstrap, propertyName);
+    nodeToParenthesis(tree, sonsId[0], s, bootstrap, propertyName);
     for (size_t i = 1; i < sonsId.size(); i++)
     {
-      s << "," << nodeToParenthesis(tree, sonsId[i], bootstrap, propertyName);
+      s << ",";
+      nodeToParenthesis(tree, sonsId[i], s, bootstrap, propertyName);
     }
   }
   s << ")";
@@ -393,8 +427,15 @@ string TreeTools::treeToParenthesis(const Tree& tree, bool bootstrap, const stri
     if (tree.hasBranchProperty(rootId, propertyName))
       s << dynamic_cast<const BppString*>(tree.getBranchProperty(rootId, propertyName))->toSTL();
   }
-  s << ";" << endl;
-  
+  s << ";\n";
+}
+
+/******************************************************************************/
+
+string TreeTools::treeToParenthesis(const Tree& tree, bool bootstrap, const string& propertyName)
+{
+  ostringstream s;
+  treeToParenthesis(tree, s, bootstrap, propertyName);
   return s.str();
 }
 
@@ -954,76 +995,131 @@ int TreeTools::robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool che
 
 /******************************************************************************/
 
-BipartitionList* TreeTools::bipartitionOccurrences(const vector<Tree*>& vecTr, vector<size_t>& bipScore)
+RowMatrix<double> TreeTools::robinsonFouldsDistanceMatrix(const vector<Tree*>& vecTr, bool weighted, size_t nbThreads, bool checkNames)
 {
-  vector<BipartitionList*> vecBipL;
-  BipartitionList* mergedBipL;
-  vector<size_t> bipSize;
-  size_t nbBip;
+  size_t nbTrees = vecTr.size();
+  RowMatrix<double> rf(nbTrees, nbTrees);
+  if (nbTrees == 0)
+    return rf;
 
-  /*  build and merge bipartitions */
-  for (size_t i = 0; i < vecTr.size(); i++)
-  {
-    vecBipL.push_back(new BipartitionList(*vecTr[i]));
-  }
-  mergedBipL = BipartitionTools::mergeBipartitionLists(vecBipL);
-  for (size_t i = 0; i < vecTr.size(); i++)
-  {
-    delete vecBipL[i];
-  }
-
-  mergedBipL->removeTrivialBipartitions();
-  nbBip = mergedBipL->getNumberOfBipartitions();
-  bipScore.clear();
-  for (size_t i = 0; i < nbBip; i++)
+  if (checkNames)
   {
-    bipSize.push_back(mergedBipL->getPartitionSize(i));
-    bipScore.push_back(1);
+    vector<string> tr0leaves = vecTr[0]->getLeavesNames();
+    for (size_t i = 1; i < nbTrees; i++)
+    {
+      if (!VectorTools::haveSameElements(vecTr[i]->getLeavesNames(), tr0leaves))
+        throw Exception("TreeTools::robinsonFouldsDistanceMatrix. Distinct leaf sets between trees");
+    }
   }
 
-  /* compare bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
+  /* hash all splits once, and describe each tree as a sorted list of (split id, weight) */
+  unordered_map<vector<uint64_t>, size_t, BipartitionTools::CanonicalWordsHash> splitIds;
+  vector< vector< pair<size_t, double> > > treeSplits(nbTrees);
+  for (size_t t = 0; t < nbTrees; t++)
   {
-    if (bipScore[i - 1] == 0)
-      continue;
-    for (size_t j = i - 1; j > 0; j--)
+    const Tree& tree = *vecTr[t];
+    vector<int> index;
+    BipartitionList bipL(tree, true, &index);
+    size_t nbElements = bipL.getNumberOfElements();
+    size_t rootId = static_cast<size_t>(tree.getRootId());
+    vector<int> rootSons = tree.getSonsId(tree.getRootId());
+    map<size_t, double> splits;
+    for (size_t i = 0; i < bipL.getNumberOfBipartitions(); i++)
     {
-      if (bipScore[j - 1] && bipSize[i - 1] == bipSize[j - 1] && mergedBipL->areIdentical(i - 1, j - 1))
+      if (!weighted && bipL.getPartitionSize(i) <= 1)
+        continue;
+      auto ins = splitIds.insert(make_pair(BipartitionTools::getCanonicalWords(bipL.getBitBipartitionList()[i], nbElements), splitIds.size()));
+      double w = 0.;
+      if (weighted)
       {
-        bipScore[i - 1]++;
-        bipScore[j - 1] = 0;
+        int id = index[i];
+        if (tree.hasDistanceToFather(id))
+          w = tree.getDistanceToFather(id);
+        if (rootSons.size() == 2 && static_cast<size_t>(tree.getFatherId(id)) == rootId)
+        {
+          int brother = (rootSons[0] == id ? rootSons[1] : rootSons[0]);
+          if (tree.hasDistanceToFather(brother))
+            w += tree.getDistanceToFather(brother);
+        }
       }
+      splits[ins.first->second] += w;
     }
+    treeSplits[t].assign(splits.begin(), splits.end());
   }
 
-  /* keep only distinct bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
+  /* fill the upper triangle, pairs being numbered row by row */
+  size_t nbPairs = nbTrees * (nbTrees - 1) / 2;
+  function<void(size_t, size_t)> loop = [&](size_t first, size_t last)
   {
-    if (bipScore[i - 1] == 0)
+    size_t i = 0;
+    size_t rowEnd = nbTrees - 1;
+    while (rowEnd <= first)
     {
-      bipScore.erase(bipScore.begin() + static_cast<ptrdiff_t>(i - 1));
-      mergedBipL->deleteBipartition(i - 1);
+      i++;
+      rowEnd += nbTrees - 1 - i;
     }
+    size_t j = nbTrees - (rowEnd - first);
+    for (size_t p = first; p < last; p++)
+    {
+      const vector< pair<size_t, double> >& s1 = treeSplits[i];
+      const vector< pair<size_t, double> >& s2 = treeSplits[j];
+      double d = 0.;
+      size_t k1 = 0, k2 = 0;
+      while (k1 < s1.size() || k2 < s2.size())
+      {
+        if (k2 == s2.size() || (k1 < s1.size() && s1[k1].first < s2[k2].first))
+        {
+          d += weighted ? std::abs(s1[k1].second) : 1.;
+          k1++;
+        }
+        else if (k1 == s1.size() || s2[k2].first < s1[k1].first)
+        {
+          d += weighted ? std::abs(s2[k2].second) : 1.;
+          k2++;
+        }
+        else
+        {
+          if (weighted)
+            d += std::abs(s1[k1].second - s2[k2].second);
+          k1++;
+          k2++;
+        }
+      }
+      rf(i, j) = d;
+      rf(j, i) = d;
+      if (++j == nbTrees)
+      {
+        i++;
+        j = i + 1;
+      }
+    }
+  };
+  SiteLoopExecutor executor(max<size_t>(nbThreads, 1));
+  executor.run(nbPairs, loop);
+  for (size_t i = 0; i < nbTrees; i++)
+  {
+    rf(i, i) = 0.;
   }
+  return rf;
+}
 
-  /* add terminal branches */
-  mergedBipL->addTrivialBipartitions(false);
-  for (size_t i = 0; i < mergedBipL->getNumberOfElements(); i++)
+/******************************************************************************/
+
+BipartitionList* TreeTools::bipartitionOccurrences(const vector<Tree*>& vecTr, vector<size_t>& bipScore)
+{
+  BipartitionCounter counter;
+  for (size_t i = 0; i < vecTr.size(); i++)
   {
-    bipScore.push_back(vecTr.size());
+    counter.addTree(*vecTr[i]);
   }
-
-  return mergedBipL;
+  return counter.getBipartitionOccurrences(bipScore);
 }
 
 /******************************************************************************/
 
 TreeTemplate<Node>* TreeTools::thresholdConsensus(const vector<Tree*>& vecTr, double threshold, bool checkNames)
 {
-  vector<size_t> bipScore;
   vector<string> tr0leaves;
-  BipartitionList* bipL;
-  double score;
 
   if (vecTr.size() == 0)
     throw Exception("TreeTools::thresholdConsensus. Empty vector passed");
@@ -1039,33 +1135,12 @@ TreeTemplate<Node>* TreeTools::thresholdConsensus(const vector<Tree*>& vecTr, do
     }
   }
 
-  bipL = bipartitionOccurrences(vecTr, bipScore);
-
-  for (size_t i = bipL->getNumberOfBipartitions(); i > 0; i--)
+  BipartitionCounter counter;
+  for (size_t i = 0; i < vecTr.size(); i++)
   {
-    if (bipL->getPartitionSize(i - 1) == 1)
-      continue;
-    score = static_cast<int>(bipScore[i - 1]) / static_cast<double>(vecTr.size());
-    if (score <= threshold && score != 1.)
-    {
-      bipL->deleteBipartition(i - 1);
-      continue;
-    }
-    if (score > 0.5)
-      continue;
-    for (size_t j = bipL->getNumberOfBipartitions(); j > i; j--)
-    {
-      if (!bipL->areCompatible(i - 1, j - 1))
-      {
-        bipL->deleteBipartition(i - 1);
-        break;
-      }
-    }
+    counter.addTree(*vecTr[i]);
   }
-
-  TreeTemplate<Node>* tr = bipL->toTree();
-  delete bipL;
-  return tr;
+  return counter.thresholdConsensus(threshold);
 }
 
 /******************************************************************************/
@@ -1122,34 +1197,12 @@ Tree* TreeTools::MRP(const vector<Tree*>& vecTr)
 
 void TreeTools::computeBootstrapValues(Tree& tree, const vector<Tree*>& vecTr, bool verbose, int format)
 {
-  vector<int> index;
-  BipartitionList bpTree(tree, true, &index);
-  vector<size_t> occurences;
-  BipartitionList* bpList = bipartitionOccurrences(vecTr, occurences);
-
-  vector< Number<double> > bootstrapValues(bpTree.getNumberOfBipartitions());
-
-  for (size_t i = 0; i < bpTree.getNumberOfBipartitions(); i++)
-  {
-    if (verbose)
-      ApplicationTools::displayGauge(i, bpTree.getNumberOfBipartitions() - 1, '=');
-    for (size_t j = 0; j < bpList->getNumberOfBipartitions(); j++)
-    {
-      if (BipartitionTools::areIdentical(bpTree, i, *bpList, j))
-      {
-        bootstrapValues[i] = format >= 0 ? round(static_cast<double>(occurences[j]) * pow(10., 2 + format) / static_cast<double>(vecTr.size())) / pow(10., format) : static_cast<double>(occurences[j]);
-        break;
-      }
-    }
-  }
-
-  for (size_t i = 0; i < index.size(); i++)
+  BipartitionCounter counter;
+  for (size_t i = 0; i < vecTr.size(); i++)
   {
-    if (!tree.isLeaf(index[i]))
-      tree.setBranchProperty(index[i], BOOTSTRAP, bootstrapValues[i]);
+    counter.addTree(*vecTr[i]);
   }
-
-  delete bpList;
+  counter.computeBootstrapValues(tree, verbose, format);
 }
 
 /******************************************************************************/
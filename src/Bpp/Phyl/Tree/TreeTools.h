@@ -52,6 +52,9 @@
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 #include <Bpp/Seq/DistanceMatrix.h>
 
+// From the STL:
+#include <ostream>
+
 namespace bpp
 {
 /**
@@ -153,6 +156,8 @@ public:
    *
    * Nodes id need not correspond to leaves.
    *
+   * For many queries on the same tree, see TreeLcaIndex.
+   *
    * @author Simon Carrignon
    * @param tree The tree to use.
    * @param nodeIds The ids of the input nodes.
@@ -426,6 +431,39 @@ public:
    * @{
    */
 
+  /**
+   * @brief Set the number format of a new stream (6 significant digits) on a stream,
+   * and restore the previous format when destroyed.
+   *
+   * The stream versions of the conversion tools use it, so that they write exactly
+   * what the string versions return, whatever the settings of the caller's stream.
+   */
+  class DefaultNumberFormat
+  {
+  private:
+    std::ostream& out_;
+    std::ios_base::fmtflags flags_;
+    std::streamsize precision_;
+
+  public:
+    DefaultNumberFormat(std::ostream& out) :
+      out_(out), flags_(out.flags()), precision_(out.precision())
+    {
+      out_.flags(std::ios_base::skipws | std::ios_base::dec);
+      out_.precision(6);
+    }
+
+    ~DefaultNumberFormat()
+    {
+      out_.flags(flags_);
+      out_.precision(precision_);
+    }
+
+  private:
+    DefaultNumberFormat(const DefaultNumberFormat&);
+    DefaultNumberFormat& operator=(const DefaultNumberFormat&);
+  };
+
   /**
    * @brief Get the parenthesis description of a subtree.
    *
@@ -439,6 +477,13 @@ public:
    */
   static std::string nodeToParenthesis(const Tree& tree, int nodeId, bool writeId = false);
 
+  /**
+   * @brief Same as above, but writes the description to a stream.
+   *
+   * Numbers are written as in the string version, whatever the settings of the stream.
+   */
+  static void nodeToParenthesis(const Tree& tree, int nodeId, std::ostream& out, bool writeId = false);
+
   /**
    * @brief Get the parenthesis description of a subtree.
    *
@@ -455,6 +500,13 @@ public:
    */
   static std::string nodeToParenthesis(const Tree& tree, int nodeId, bool bootstrap, const std::string& propertyName);
 
+  /**
+   * @brief Same as above, but writes the description to a stream.
+   *
+   * Numbers are written as in the string version, whatever the settings of the stream.
+   */
+  static void nodeToParenthesis(const Tree& tree, int nodeId, std::ostream& out, bool bootstrap, const std::string& propertyName);
+
   /**
    * @brief Get the parenthesis description of a tree.
    *
@@ -466,6 +518,13 @@ public:
    */
   static std::string treeToParenthesis(const Tree& tree, bool writeId = false);
 
+  /**
+   * @brief Same as above, but writes the description to a stream.
+   *
+   * Numbers are written as in the string version, whatever the settings of the stream.
+   */
+  static void treeToParenthesis(const Tree& tree, std::ostream& out, bool writeId = false);
+
   /**
    * @brief Get the parenthesis description of a tree.
    *
@@ -480,6 +539,13 @@ public:
    */
   static std::string treeToParenthesis(const Tree& tree, bool bootstrap, const std::string& propertyName);
 
+  /**
+   * @brief Same as above, but writes the description to a stream.
+   *
+   * Numbers are written as in the string version, whatever the settings of the stream.
+   */
+  static void treeToParenthesis(const Tree& tree, std::ostream& out, bool bootstrap, const std::string& propertyName);
+
   /** @} */
 
   /**
@@ -595,6 +661,28 @@ public:
    */
   static int robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool checkNames = true, int* missing_in_tr2 = NULL, int* missing_in_tr1 = NULL);
 
+  /**
+   * @brief Calculates the Robinson-Foulds distances between all pairs of trees in a set.
+   *
+   * The splits of every tree are hashed once into a dictionary shared by all trees
+   * (see BipartitionTools::getCanonicalWords), so that each tree is reduced to a sorted list
+   * of split identifiers. Each pairwise distance is then obtained by merging two such lists,
+   * in time linear in the number of leaves. Pairs are distributed over nbThreads threads.
+   *
+   * In the weighted case, each split is weighted by the length of its branch, and the
+   * distance is the sum over all splits (terminal ones included) of the absolute difference
+   * of weights, a missing split having weight 0. Branches without length count as 0.
+   * For a bifurcating root, the two root branches are merged into one split.
+   *
+   * @param vecTr Input trees (must share a common set of leaves - checked if checkNames is true).
+   * @param weighted Tell if splits should be weighted by branch lengths.
+   * @param nbThreads The number of threads used to fill the matrix (1 = no additional thread).
+   * @param checkNames Tell whether we should check the trees first.
+   * @return A symmetric matrix with the distance between trees i and j at position (i, j).
+   * @throw Exception If checkNames is set to true and trees do not share the same leaves names.
+   */
+  static RowMatrix<double> robinsonFouldsDistanceMatrix(const std::vector<Tree*>& vecTr, bool weighted = false, size_t nbThreads = 1, bool checkNames = true);
+
   /**
    * @brief Counts the total number of occurrences of every bipartition from the input trees
    *
@@ -675,10 +763,14 @@ public:
   /**
    * @brief Compute bootstrap values.
    *
+   * The bipartitions of all trees are counted with a BipartitionCounter, and each
+   * bipartition of the input tree is looked up in its table.
+   *
    * @param tree Input tree. the BOOTSTRAP banch property of the tree will be modified if it already exists.
    * @param vecTr A list of trees to compare to 'tree'.
    * @param verbose Tell if a progress bar should be displayed.
-   * @param format The output format of the tree.
+   * @param format The number of decimals of the percentages, or a negative value to get the numbers of occurrences.
+   * @throw Exception If the trees do not share the same leaves.
    */
   
   static void computeBootstrapValues(Tree& tree, const std::vector<Tree*>& vecTr, bool verbose = true, int format = 0);
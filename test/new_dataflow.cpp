@@ -43,9 +43,16 @@
 #include "doctest.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <thread>
 
 #include <Bpp/Exceptions.h>
+#include <Bpp/NewPhyl/DataFlowExtendedFloat.h>
 #include <Bpp/NewPhyl/DataFlowNumeric.h>
+#include <Bpp/NewPhyl/DataFlowParallel.h>
+#include <Bpp/NewPhyl/DataFlowProfiler.h>
 
 static bool enableDotOutput = false;
 
@@ -163,6 +170,281 @@ TEST_CASE("dataflow_invariants")
   dotOutput("dataflow_invariants", {n1.get()});
 }
 
+TEST_CASE("dataflow_concurrent_invalidation")
+{
+  // Threads modify their own leaf and evaluate the shared root concurrently
+  Context c;
+  const std::size_t nbThreads = 4;
+  const int nbIterations = 1000;
+  std::vector<std::shared_ptr<NumericMutable<double>>> leaves;
+  NodeRefVec level;
+  for (std::size_t i = 0; i < 2 * nbThreads; ++i)
+  {
+    leaves.push_back(NumericMutable<double>::create(c, 0.));
+    level.push_back(leaves.back());
+  }
+  while (level.size() > 1)
+  {
+    NodeRefVec nextLevel;
+    for (std::size_t i = 0; i < level.size(); i += 2)
+    {
+      nextLevel.push_back(
+        CWiseAdd<double, std::tuple<double, double>>::create(c, {level[i], level[i + 1]}, Dimension<double>()));
+    }
+    level = std::move(nextLevel);
+  }
+  auto root = convertRef<Value<double>>(level[0]);
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < nbThreads; ++t)
+  {
+    threads.emplace_back([&, t] {
+      for (int k = 1; k <= nbIterations; ++k)
+      {
+        leaves[2 * t]->setValue(double(k));
+        root->computeRecursively();
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  CHECK(root->getValue() == double(nbThreads * nbIterations));
+
+  // Same with a ParallelExecutor per thread
+  ParallelExecutor executor(2);
+  threads.clear();
+  for (std::size_t t = 0; t < nbThreads; ++t)
+  {
+    threads.emplace_back([&, t] {
+      ParallelExecutor ownExecutor(2);
+      for (int k = 1; k <= nbIterations; ++k)
+      {
+        leaves[2 * t + 1]->setValue(double(k));
+        ownExecutor.computeRecursively(*root);
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  CHECK(executor.getValue(*root) == double(2 * nbThreads * nbIterations));
+}
+
+TEST_CASE("dataflow_node_arena")
+{
+  auto arena = std::make_shared<NodeArena>(4096);
+  ValueRef<double> survivor;
+  {
+    Context c(arena);
+    CHECK(c.nodeArena() == arena);
+    auto x = NumericMutable<double>::create(c, 2.);
+    auto y = NumericConstant<double>::create(c, 3.);
+    NodeRefVec terms;
+    for (int i = 0; i < 1000; ++i)
+    {
+      // Merged by the context: duplicates are rolled back in the arena
+      terms.push_back(CWiseMul<double, std::tuple<double, double>>::create(c, {x, y}, Dimension<double>()));
+    }
+    CHECK(terms.front() == terms.back());
+    auto sum = CWiseAdd<double, ReductionOf<double>>::create(c, std::move(terms), Dimension<double>());
+    CHECK(sum->getValue() == 6000.);
+    CHECK(arena->nbChunks() == 1);
+    x->setValue(1.);
+    CHECK(sum->getValue() == 3000.);
+    survivor = sum;
+  }
+  // Nodes keep the arena alive after the context is destroyed
+  arena.reset();
+  CHECK(survivor->getValue() == 3000.);
+}
+
+TEST_CASE("dataflow_value_recycling")
+{
+  // Chain of matrix products: ((m * m) * m) * m ...
+  Context c;
+  const MatrixDimension dim(3, 3);
+  auto m = NumericMutable<Eigen::MatrixXd>::create(c, Eigen::MatrixXd::Constant(3, 3, 0.5));
+  std::vector<ValueRef<Eigen::MatrixXd>> chain{m};
+  for (int i = 0; i < 6; ++i)
+  {
+    chain.push_back(CWiseMul<Eigen::MatrixXd, std::tuple<Eigen::MatrixXd, Eigen::MatrixXd>>::create(
+      c, {chain.back(), m}, dim));
+  }
+  auto root = chain.back();
+
+  ValueBufferPool pool;
+  computeWithValueRecycling({root.get()}, pool);
+  CHECK(root->isValid());
+  CHECK(root->accessValueConst()(0, 0) == doctest::Approx(std::pow(0.5, 7)));
+  // Intermediate values have been released, and their buffers reused along the chain
+  for (std::size_t i = 1; i + 1 < chain.size(); ++i)
+  {
+    CHECK_FALSE(chain[i]->isValid());
+    CHECK(chain[i]->accessValueConst().size() == 0);
+  }
+  CHECK(pool.nbBuffers() == 1);
+
+  // Invalidations propagate through released nodes
+  m->setValue(Eigen::MatrixXd::Constant(3, 3, 2.));
+  CHECK_FALSE(root->isValid());
+  computeWithValueRecycling({root.get()}, pool);
+  CHECK(root->accessValueConst()(0, 0) == doctest::Approx(std::pow(2., 7)));
+  CHECK(pool.nbBuffers() == 1);
+
+  // Released nodes are recomputed by a normal evaluation
+  CHECK(chain[3]->getValue()(0, 0) == doctest::Approx(std::pow(2., 4)));
+}
+
+TEST_CASE("dataflow_profiler")
+{
+  Context c;
+  const MatrixDimension dim(2, 2);
+  auto x = NumericMutable<double>::create(c, 1.);
+  auto m = NumericMutable<Eigen::MatrixXd>::create(c, Eigen::MatrixXd::Ones(2, 2));
+  auto scaled = CWiseMul<Eigen::MatrixXd, std::tuple<double, Eigen::MatrixXd>>::create(c, {x, m}, dim);
+  auto sum = CWiseAdd<Eigen::MatrixXd, std::tuple<Eigen::MatrixXd, Eigen::MatrixXd>>::create(c, {scaled, m}, dim);
+
+  bpp::dataflow::NodeProfiler profiler;
+  profiler.start();
+  sum->getValue();
+  x->setValue(2.);
+  sum->getValue();
+  m->setValue(Eigen::MatrixXd::Ones(2, 2)); // Only dependents of m are recomputed
+  sum->getValue();
+  profiler.stop();
+  x->setValue(3.);
+  sum->getValue(); // Not recorded
+
+  const auto sumStats = profiler.nodeStatistics(*sum);
+  CHECK(sumStats.nbComputations == 3);
+  CHECK(sumStats.valueBytes == 4 * sizeof(double));
+  CHECK(profiler.nodeStatistics(*scaled).nbComputations == 3);
+  CHECK(profiler.nodeStatistics(*x).nbComputations == 0); // Mutable values are not computed
+
+  const auto byClass = profiler.classStatistics();
+  const auto it = byClass.find(bpp::prettyTypeName(typeid(*sum)));
+  REQUIRE(it != byClass.end());
+  CHECK(it->second.nbNodes == 1);
+  CHECK(it->second.nbComputations == 3);
+
+  std::ostringstream report;
+  profiler.writeReport(report);
+  CHECK(report.str().find(sum->description()) != std::string::npos);
+  std::ostringstream dot;
+  profiler.writeGraphToDot(dot, {sum.get()});
+  CHECK(dot.str().find("fillcolor") != std::string::npos);
+
+  profiler.reset();
+  CHECK(profiler.nodeStatistics(*sum).nbComputations == 0);
+}
+
+TEST_CASE("dataflow_compute_multiple_nodes")
+{
+  // Two results sharing a sub-expression
+  Context c;
+  auto x = NumericMutable<double>::create(c, 2.);
+  auto y = NumericMutable<double>::create(c, 3.);
+  auto shared = CWiseMul<double, std::tuple<double, double>>::create(c, {x, y}, Dimension<double>());
+  auto a = CWiseAdd<double, std::tuple<double, double>>::create(c, {shared, x}, Dimension<double>());
+  auto b = CWiseAdd<double, std::tuple<double, double>>::create(c, {shared, y}, Dimension<double>());
+
+  bpp::dataflow::NodeProfiler profiler;
+  profiler.start();
+  bpp::dataflow::computeRecursively({a.get(), b.get()});
+  CHECK(a->accessValueConst() == 8.);
+  CHECK(b->accessValueConst() == 9.);
+  x->setValue(1.);
+  bpp::dataflow::computeRecursively({a.get(), b.get()});
+  CHECK(a->accessValueConst() == 4.);
+  CHECK(b->accessValueConst() == 6.);
+  profiler.stop();
+  CHECK(profiler.nodeStatistics(*shared).nbComputations == 2);
+}
+
+TEST_CASE("dataflow_execution_plan")
+{
+  Context c;
+  auto x = NumericMutable<double>::create(c, 2.);
+  auto y = NumericMutable<double>::create(c, 3.);
+  auto shared = CWiseMul<double, std::tuple<double, double>>::create(c, {x, y}, Dimension<double>());
+  auto a = CWiseAdd<double, std::tuple<double, double>>::create(c, {shared, x}, Dimension<double>());
+  auto b = CWiseAdd<double, std::tuple<double, double>>::create(c, {shared, y}, Dimension<double>());
+
+  bpp::dataflow::ExecutionPlan plan({a, b});
+  REQUIRE(plan.nbSteps() == 5);
+  for (std::size_t i = 0; i < plan.nbSteps(); ++i)
+  {
+    // Dependencies come first
+    for (auto it = plan.dependencyStepsBegin(i); it != plan.dependencyStepsEnd(i); ++it)
+      CHECK(*it < i);
+  }
+  CHECK(plan.updateDirtyFlags() == 3);
+  plan.compute();
+  CHECK(a->accessValueConst() == 8.);
+  CHECK(b->accessValueConst() == 9.);
+  CHECK(plan.updateDirtyFlags() == 0);
+
+  // Only steps depending on y are dirty
+  y->setValue(1.);
+  CHECK(plan.updateDirtyFlags() == 3);
+  for (std::size_t i = 0; i < plan.nbSteps(); ++i)
+    CHECK(bool(plan.dirtyFlags()[i]) == (plan.step(i) != y && isTransitivelyDependentOn(*y, *plan.step(i))));
+  plan.compute();
+  CHECK(a->accessValueConst() == 4.);
+  CHECK(b->accessValueConst() == 3.);
+
+  CHECK(plan.matchesGraph());
+  DependencyRewrite rewrite(c);
+  rewrite.replaceDependency(a, 1, y);
+  CHECK(!plan.matchesGraph());
+  rewrite.revert();
+  CHECK(plan.matchesGraph());
+}
+
+TEST_CASE("dataflow_dependency_rewrite")
+{
+  // Rooted tree ((a,b),c), with x*y for an inner node and x+y for the root: NNI swapping b and c.
+  using Mul = CWiseMul<double, std::tuple<double, double>>;
+  Context c;
+  auto a = NumericMutable<double>::create(c, 2.);
+  auto b = NumericMutable<double>::create(c, 3.);
+  auto leafC = NumericMutable<double>::create(c, 5.);
+  auto inner = Mul::create(c, {a, b}, Dimension<double>());
+  auto root = CWiseAdd<double, std::tuple<double, double>>::create(c, {inner, leafC}, Dimension<double>());
+  CHECK(root->getValue() == 11.);
+
+  bpp::dataflow::NodeProfiler profiler;
+  profiler.start();
+  DependencyRewrite rewrite(c);
+  rewrite.swapDependencies(inner, 1, root, 1);
+  CHECK(rewrite.nbReplacements() == 2);
+  CHECK(!root->isValid());
+  CHECK(root->getValue() == 13.);
+  // The rewritten nodes are merged with the new configuration
+  CHECK(Mul::create(c, {a, leafC}, Dimension<double>()) == inner);
+
+  // Rejected move: the previous values are restored without computation
+  rewrite.revert();
+  CHECK(rewrite.nbReplacements() == 0);
+  CHECK(root->isValid());
+  CHECK(root->getValue() == 11.);
+  CHECK(profiler.nodeStatistics(*root).nbComputations == 1);
+  CHECK(Mul::create(c, {a, b}, Dimension<double>()) == inner);
+
+  // Leaf modification after the move: values depending on it are recomputed
+  rewrite.swapDependencies(inner, 1, root, 1);
+  a->setValue(1.);
+  rewrite.revert();
+  CHECK(!inner->isValid());
+  CHECK(root->getValue() == 8.);
+  profiler.stop();
+
+  // Cycles and value type changes are refused
+  CHECK_THROWS_AS(rewrite.replaceDependency(inner, 0, root), bpp::Exception);
+  auto vector = NumericMutable<Eigen::VectorXd>::create(c, Eigen::VectorXd::Zero(2));
+  CHECK_THROWS_AS(rewrite.replaceDependency(inner, 0, vector), bpp::Exception);
+  CHECK(rewrite.nbReplacements() == 0);
+}
+
 TEST_CASE("dataflow_node_basic_errors")
 {
   auto doNothing = std::make_shared<DoNothingNode>();
@@ -242,6 +524,15 @@ TEST_CASE("NumericConstant")
   CHECK(d->deriveAsValue(c, *dummy)->getValue() == 0);
   CHECK(d->deriveAsValue(c, *d)->getValue() == 1);
 
+  // Merging: equal values, and equal given fingerprints with equal values
+  const Eigen::MatrixXd mCopy = mValue;
+  CHECK(NumericConstant<Eigen::MatrixXd>::create(c, mCopy) == m);
+  auto f = NumericConstant<Eigen::MatrixXd>::createWithFingerprint(c, 7, mCopy);
+  CHECK(f != m);
+  CHECK(f->getFingerprint() == 7);
+  CHECK(NumericConstant<Eigen::MatrixXd>::createWithFingerprint(c, 7, mCopy) == f);
+  CHECK(NumericConstant<Eigen::MatrixXd>::createWithFingerprint(c, 7, Eigen::MatrixXd(mCopy * 2)) != f);
+
   dotOutput("NumericConstant", {d.get(), m.get()});
 }
 
@@ -461,6 +752,57 @@ TEST_CASE("CWiseMul")
   // Not tested: Constant simplifications
 }
 
+TEST_CASE("CWiseMulOfMatrixProducts")
+{
+  using Fused = CWiseMulOfMatrixProducts<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>;
+  using Product = MatrixProduct<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>;
+  Context c;
+  // More columns than a block, and a partial last block
+  const MatrixDimension dim(3, 2 * Fused::columnBlockSize + 5);
+  NodeRefVec fusedDeps, products;
+  std::vector<std::shared_ptr<NumericMutable<Eigen::MatrixXd>>> transitions;
+  for (int i = 0; i < 3; ++i)
+  {
+    transitions.emplace_back(NumericMutable<Eigen::MatrixXd>::create(c, Eigen::MatrixXd::Random(3, 3)));
+    auto conditional = NumericConstant<Eigen::MatrixXd>::create(c, Eigen::MatrixXd::Random(3, dim.cols));
+    fusedDeps.insert(fusedDeps.end(), {transitions.back(), conditional});
+    products.emplace_back(Product::create(c, {transitions.back(), conditional}, dim));
+  }
+  CHECK_THROWS_AS(Fused::create(c, {transitions[0]}, dim), bpp::Exception);
+  CHECK_THROWS_AS(Fused::create(c, {transitions[0], nullptr}, dim), bpp::Exception);
+  CHECK(dynamic_cast<const Product*>(Fused::create(c, {fusedDeps[0], fusedDeps[1]}, dim).get()) != nullptr);
+
+  auto fused = Fused::create(c, NodeRefVec(fusedDeps), dim);
+  auto unfused = CWiseMul<Eigen::MatrixXd, ReductionOf<Eigen::MatrixXd>>::create(c, NodeRefVec(products), dim);
+  CHECK(fused->getValue().isApprox(unfused->getValue()));
+  transitions[1]->setValue(Eigen::MatrixXd::Random(3, 3));
+  CHECK(fused->getValue().isApprox(unfused->getValue()));
+
+  // Derivatives are those of the unfused expression
+  auto dfused = fused->deriveAsValue(c, *transitions[2]);
+  auto dunfused = unfused->deriveAsValue(c, *transitions[2]);
+  CHECK(dfused->getValue().isApprox(dunfused->getValue()));
+
+  // ExtendedFloatMatrix values are rescaled, and do not underflow on long products
+  using bpp::ExtendedFloatMatrix;
+  using FusedEF = CWiseMulOfMatrixProducts<ExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, ExtendedFloatMatrix>;
+  const Eigen::MatrixXd tiny = Eigen::MatrixXd::Constant(3, dim.cols, 1e-100);
+  auto tinyEF = NumericConstant<ExtendedFloatMatrix>::create(c, tiny);
+  NodeRefVec efDeps;
+  const std::size_t nbFactors = 20;
+  for (std::size_t i = 0; i < nbFactors; ++i)
+    efDeps.insert(efDeps.end(), {transitions[0], tinyEF});
+  auto fusedEF = FusedEF::create(c, std::move(efDeps), dim);
+  const Eigen::MatrixXd forward = transitions[0]->getValue().transpose() * tiny / 1e-100;
+  for (Eigen::Index j : {Eigen::Index(0), dim.cols - 1})
+  {
+    CHECK(log(fusedEF->getValue()(1, j)) ==
+          doctest::Approx(double(nbFactors) * (std::log(1e-100) + std::log(std::abs(forward(1, j))))));
+  }
+
+  dotOutput("CWiseMulOfMatrixProducts", {fused.get(), dfused.get(), fusedEF.get()});
+}
+
 // Test dataflow node for numerical derivation. Can serve as an example of a simple case.
 struct OpaqueTestFunction : public Value<double>
 {
@@ -524,6 +866,32 @@ struct OpaqueTestFunction : public Value<double>
   }
 };
 
+TEST_CASE("WeightedSumOfLogarithms")
+{
+  Context c;
+  const auto dim = bpp::rowVectorDimension(3);
+  auto x = NumericMutable<double>::create(c, 2.);
+  auto values =
+    NumericMutable<Eigen::RowVectorXd>::create(c, (Eigen::RowVectorXd(3) << 0.5, 0.25, 0.125).finished());
+  auto weights = NumericConstant<Eigen::RowVectorXd>::create(c, (Eigen::RowVectorXd(3) << 3., 1., 2.).finished());
+  auto scaled = CWiseMul<Eigen::RowVectorXd, std::tuple<double, Eigen::RowVectorXd>>::create(c, {x, values}, dim);
+
+  // Same as summing logarithms of repeated values
+  auto weighted = WeightedSumOfLogarithms<Eigen::RowVectorXd>::create(c, {scaled, weights}, dim);
+  const double expected = 3. * std::log(1.) + std::log(0.5) + 2. * std::log(0.25);
+  CHECK(weighted->getValue() == doctest::Approx(expected));
+
+  // d/dx sum_i w_i log(x v_i) = sum_i w_i / x
+  CHECK(weighted->deriveAsValue(c, *x)->getValue() == doctest::Approx(6. / 2.));
+  auto variableWeights = WeightedSumOfLogarithms<Eigen::RowVectorXd>::create(c, {values, scaled}, dim);
+  CHECK_THROWS_AS(variableWeights->derive(c, *x), bpp::Exception);
+
+  // ExtendedFloatMatrix version: one weight per column
+  auto valuesEF = NumericConstant<bpp::ExtendedFloatMatrix>::create(c, values->getValue());
+  CHECK(WeightedSumOfLogarithms<bpp::ExtendedFloatMatrix>::create(c, {valuesEF, weights}, dim)->getValue() ==
+        doctest::Approx(3. * std::log(0.5) + std::log(0.25) + 2. * std::log(0.125)));
+}
+
 TEST_CASE("numerical_derivation")
 {
   Context c;
@@ -562,6 +930,280 @@ TEST_CASE("numerical_derivation")
   dotOutput("numerical_derivation", {f.get(), df_ddummy.get(), df_dx.get(), df_dy.get(), d2f_dx2.get()});
 }
 
+/******************************************************************************
+ * Test parallel evaluation.
+ */
+struct ThrowingNode : public Value<double>
+{
+  ThrowingNode(NodeRefVec&& deps)
+    : Value<double>(std::move(deps))
+  {
+  }
+  void compute() final { throw bpp::Exception("ThrowingNode::compute"); }
+};
+
+TEST_CASE("ParallelExecutor")
+{
+  Context c;
+  const auto dim = MatrixDimension(3, 5);
+  // Balanced binary tree of products over mutable leaves, similar to conditional likelihoods.
+  std::vector<std::shared_ptr<NumericMutable<Eigen::MatrixXd>>> leaves;
+  NodeRefVec level;
+  for (int i = 0; i < 16; ++i)
+  {
+    auto leaf = NumericMutable<Eigen::MatrixXd>::create(c, Eigen::MatrixXd::Constant(3, 5, 1. + 0.1 * i));
+    leaves.push_back(leaf);
+    level.push_back(leaf);
+  }
+  while (level.size() > 1)
+  {
+    NodeRefVec nextLevel;
+    for (std::size_t i = 0; i < level.size(); i += 2)
+    {
+      nextLevel.push_back(CWiseMul<Eigen::MatrixXd, std::tuple<Eigen::MatrixXd, Eigen::MatrixXd>>::create(
+        c, {level[i], level[i + 1]}, dim));
+    }
+    level = std::move(nextLevel);
+  }
+  auto root = convertRef<Value<Eigen::MatrixXd>>(level[0]);
+
+  double expected = 1.;
+  for (int i = 0; i < 16; ++i)
+    expected *= 1. + 0.1 * i;
+
+  ParallelExecutor executor(4);
+  CHECK(executor.nbThreads() == 4);
+  const auto& value = executor.getValue(*root);
+  CHECK(root->isValid());
+  CHECK(value(0, 0) == doctest::Approx(expected));
+  CHECK(value(2, 4) == doctest::Approx(expected));
+
+  // Only the path to the modified leaf is invalidated, and recomputed.
+  leaves[3]->setValue(Eigen::MatrixXd::Constant(3, 5, 2. * (1. + 0.3)));
+  CHECK_FALSE(root->isValid());
+  CHECK(leaves[0]->dependentNodes()[0]->isValid());
+  CHECK(executor.getValue(*root)(1, 1) == doctest::Approx(2. * expected));
+
+  // Same result as sequential evaluation
+  leaves[5]->setValue(Eigen::MatrixXd::Constant(3, 5, 0.5 * (1. + 0.5)));
+  auto parallelValue = executor.getValue(*root);
+  leaves[5]->setValue(Eigen::MatrixXd::Constant(3, 5, 0.5 * (1. + 0.5)));
+  CHECK(root->getValue() == parallelValue);
+
+  // Single thread executor does all the work itself (leaves 3 and 5 changes compensate)
+  ParallelExecutor singleThread(1);
+  leaves[0]->setValue(Eigen::MatrixXd::Constant(3, 5, 1.));
+  CHECK(singleThread.getValue(*root)(0, 0) == doctest::Approx(expected));
+
+  // Exceptions from compute() are forwarded, independent nodes stay consistent
+  auto failing = std::make_shared<ThrowingNode>(NodeRefVec{leaves[0]});
+  auto l0 = NumericMutable<double>::create(c, 1.);
+  auto l1 = NumericMutable<double>::create(c, 2.);
+  auto sum = CWiseAdd<double, std::tuple<double, double>>::create(c, {l0, l1}, Dimension<double>());
+  auto failingSum = std::make_shared<DoNothingNode>(NodeRefVec{failing, sum});
+  CHECK_THROWS_AS(executor.computeRecursively(*failingSum), bpp::Exception);
+  CHECK_FALSE(failing->isValid());
+  CHECK_FALSE(failingSum->isValid());
+  CHECK(executor.getValue(*sum) == 3.);
+
+  dotOutput("ParallelExecutor", {root.get()});
+}
+
+TEST_CASE("ExtendedFloat")
+{
+  using bpp::ExtendedFloat;
+  ExtendedFloat small(1e-200);
+  small.normalize();
+  const ExtendedFloat tiny = small * small;
+  const ExtendedFloat zero;
+
+  // Sums align exponents
+  CHECK(log(tiny + tiny) == doctest::Approx(std::log(2.) + 2. * std::log(1e-200)));
+  CHECK(log(tiny + tiny * ExtendedFloat(0.01)) == doctest::Approx(std::log(1.01) + 2. * std::log(1e-200)));
+  CHECK(tiny + zero == tiny);
+  CHECK(zero + tiny == tiny);
+  CHECK(ExtendedFloat(1.) + tiny == ExtendedFloat(1.));
+  ExtendedFloat sum;
+  for (int i = 0; i < 10; ++i)
+    sum += tiny;
+  CHECK(log(sum) == doctest::Approx(std::log(10.) + 2. * std::log(1e-200)));
+
+  // Comparisons and conversion
+  CHECK(tiny < tiny + tiny);
+  CHECK(tiny + tiny > tiny);
+  CHECK(tiny <= tiny);
+  CHECK(tiny >= tiny);
+  CHECK(zero < tiny);
+  CHECK(tiny != zero);
+  CHECK(tiny < ExtendedFloat(1e-300));
+  CHECK(ExtendedFloat(0.5, 1) == ExtendedFloat(1.));
+  CHECK(static_cast<double>(ExtendedFloat(0.5) * ExtendedFloat(0.25)) == 0.125);
+  CHECK(static_cast<double>(tiny) == 0.);
+  CHECK(std::hash<ExtendedFloat>{}(ExtendedFloat(0.5, 1)) == std::hash<ExtendedFloat>{}(ExtendedFloat(1.)));
+
+  // Eigen matrices of ExtendedFloat in dataflow nodes, compared to doubles scaled by 1e-300
+  using MatrixEF = Eigen::Matrix<ExtendedFloat, Eigen::Dynamic, Eigen::Dynamic>;
+  Context c;
+  const MatrixDimension dim(2, 2);
+  const Eigen::MatrixXd values = (Eigen::MatrixXd(2, 2) << 0.1, 0.2, 0.3, 0.4).finished();
+  const MatrixEF valuesEF = values.unaryExpr([](double d) { return ExtendedFloat(d) * ExtendedFloat(1e-300); });
+  auto xD = NumericConstant<Eigen::MatrixXd>::create(c, values);
+  auto xEF = NumericConstant<MatrixEF>::create(c, valuesEF);
+  auto addD = CWiseAdd<Eigen::MatrixXd, std::tuple<Eigen::MatrixXd, Eigen::MatrixXd>>::create(c, {xD, xD}, dim);
+  auto addEF = CWiseAdd<MatrixEF, std::tuple<MatrixEF, MatrixEF>>::create(c, {xEF, xEF}, dim);
+  auto mulD = CWiseMul<Eigen::MatrixXd, std::tuple<Eigen::MatrixXd, Eigen::MatrixXd>>::create(c, {addD, xD}, dim);
+  auto mulEF = CWiseMul<MatrixEF, std::tuple<MatrixEF, MatrixEF>>::create(c, {addEF, xEF}, dim);
+  auto prodD = MatrixProduct<Eigen::MatrixXd, Eigen::MatrixXd, Eigen::MatrixXd>::create(c, {mulD, xD}, dim);
+  auto prodEF = MatrixProduct<MatrixEF, MatrixEF, MatrixEF>::create(c, {mulEF, xEF}, dim);
+  for (Eigen::Index i = 0; i < 2; ++i)
+  {
+    for (Eigen::Index j = 0; j < 2; ++j)
+    {
+      CHECK(log(addEF->getValue()(i, j)) == doctest::Approx(std::log(addD->getValue()(i, j)) + std::log(1e-300)));
+      CHECK(log(mulEF->getValue()(i, j)) ==
+            doctest::Approx(std::log(mulD->getValue()(i, j)) + 2. * std::log(1e-300)));
+      CHECK(log(prodEF->getValue()(i, j)) ==
+            doctest::Approx(std::log(prodD->getValue()(i, j)) + 3. * std::log(1e-300)));
+    }
+  }
+  auto identityEF = NumericConstant<MatrixEF>::create(c, MatrixEF::Identity(2, 2));
+  auto prodIdentityEF = MatrixProduct<MatrixEF, MatrixEF, MatrixEF>::create(c, {xEF, identityEF}, dim);
+  CHECK(prodIdentityEF == xEF);
+
+  dotOutput("ExtendedFloat", {prodEF.get()});
+}
+
+TEST_CASE("ExtendedFloatMatrix")
+{
+  using bpp::ExtendedFloatMatrix;
+  Context c;
+  const MatrixDimension dim(2, 3);
+
+  // Construction normalizes columns
+  const Eigen::MatrixXd tiny = Eigen::MatrixXd::Constant(2, 3, 1e-100);
+  const ExtendedFloatMatrix tinyEF(tiny);
+  CHECK(tinyEF.exponent_part()(0) < 0);
+  CHECK(tinyEF.float_part()(0, 0) >= double(bpp::ExtendedFloat::smallest_normalized_value));
+  CHECK(log(tinyEF(1, 2)) == doctest::Approx(std::log(1e-100)));
+
+  // Long product chain: underflows with doubles, not with ExtendedFloatMatrix
+  const std::size_t nbFactors = 100;
+  auto leafD = NumericConstant<Eigen::MatrixXd>::create(c, tiny);
+  auto leafEF = NumericConstant<ExtendedFloatMatrix>::create(c, tiny);
+  auto prodD = CWiseMul<Eigen::MatrixXd, ReductionOf<Eigen::MatrixXd>>::create(
+    c, NodeRefVec(nbFactors, leafD), dim);
+  auto prodEF = CWiseMul<ExtendedFloatMatrix, ReductionOf<ExtendedFloatMatrix>>::create(
+    c, NodeRefVec(nbFactors, leafEF), dim);
+  CHECK(prodD->getValue()(0, 0) == 0.);
+  const double expectedLog = 6. * double(nbFactors) * std::log(1e-100);
+  CHECK(SumOfLogarithms<ExtendedFloatMatrix>::create(c, {prodEF}, dim)->getValue() ==
+        doctest::Approx(expectedLog));
+
+  // Simplifications
+  using MulEF = CWiseMul<ExtendedFloatMatrix, ReductionOf<ExtendedFloatMatrix>>;
+  auto zeroEF = ConstantZero<ExtendedFloatMatrix>::create(c, dim);
+  CHECK(MulEF::create(c, {leafEF, zeroEF}, dim)->hasNumericalProperty(NumericalProperty::ConstantZero));
+  CHECK(MulEF::create(c, {leafEF}, dim) == leafEF);
+
+  // Products with double matrices, compared to the double version on representable values
+  const Eigen::MatrixXd values = (Eigen::MatrixXd(2, 3) << 0.1, 0.2, 1e-3, 0.9, 0.8, 1e-4).finished();
+  const Eigen::MatrixXd transition = (Eigen::MatrixXd(2, 2) << 0.7, 0.3, 0.4, 0.6).finished();
+  const Eigen::RowVectorXd freqs = (Eigen::RowVectorXd(2) << 0.25, 0.75).finished();
+  auto valuesD = NumericConstant<Eigen::MatrixXd>::create(c, values);
+  auto valuesEF = NumericConstant<ExtendedFloatMatrix>::create(c, values);
+  auto transitionNode = NumericConstant<Eigen::MatrixXd>::create(c, transition);
+  auto freqsNode = NumericConstant<Eigen::RowVectorXd>::create(c, freqs);
+  auto forwardD = MatrixProduct<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>::create(
+    c, {transitionNode, valuesD}, dim);
+  auto forwardEF = MatrixProduct<ExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, ExtendedFloatMatrix>::create(
+    c, {transitionNode, valuesEF}, dim);
+  auto likD = MatrixProduct<Eigen::RowVectorXd, Eigen::RowVectorXd, Eigen::MatrixXd>::create(
+    c, {freqsNode, forwardD}, bpp::rowVectorDimension(3));
+  auto likEF = MatrixProduct<ExtendedFloatMatrix, Eigen::RowVectorXd, ExtendedFloatMatrix>::create(
+    c, {freqsNode, forwardEF}, bpp::rowVectorDimension(3));
+  for (Eigen::Index j = 0; j < 3; ++j)
+  {
+    CHECK(log(forwardEF->getValue()(1, j)) == doctest::Approx(std::log(forwardD->getValue()(1, j))));
+  }
+  CHECK(SumOfLogarithms<ExtendedFloatMatrix>::create(c, {likEF}, bpp::rowVectorDimension(3))->getValue() ==
+        doctest::Approx(SumOfLogarithms<Eigen::RowVectorXd>::create(c, {likD}, bpp::rowVectorDimension(3))
+                          ->getValue()));
+
+  dotOutput("ExtendedFloatMatrix", {likEF.get()});
+}
+
+TEST_CASE("SingleExtendedFloatMatrix")
+{
+  using bpp::SingleExtendedFloatMatrix;
+  Context c;
+  const MatrixDimension dim(2, 3);
+
+  // Normalization bounds fit in float products
+  CHECK(SingleExtendedFloatMatrix::smallest_normalized_value > 0.f);
+  const Eigen::MatrixXd tiny = Eigen::MatrixXd::Constant(2, 3, 1e-100);
+  const SingleExtendedFloatMatrix tinySEF(tiny);
+  CHECK(log(tinySEF(1, 2)) == doctest::Approx(std::log(1e-100)));
+
+  // Long product chain does not underflow
+  const std::size_t nbFactors = 100;
+  auto leafSEF = NumericConstant<SingleExtendedFloatMatrix>::create(c, tiny);
+  auto prodSEF = CWiseMul<SingleExtendedFloatMatrix, ReductionOf<SingleExtendedFloatMatrix>>::create(
+    c, NodeRefVec(nbFactors, leafSEF), dim);
+  CHECK(SumOfLogarithms<SingleExtendedFloatMatrix>::create(c, {prodSEF}, dim)->getValue() ==
+        doctest::Approx(6. * double(nbFactors) * std::log(1e-100)));
+
+  // Same results as the double version, up to float precision
+  const Eigen::MatrixXd values = (Eigen::MatrixXd(2, 3) << 0.1, 0.2, 1e-3, 0.9, 0.8, 1e-4).finished();
+  const Eigen::MatrixXd transition = (Eigen::MatrixXd(2, 2) << 0.7, 0.3, 0.4, 0.6).finished();
+  const Eigen::RowVectorXd freqs = (Eigen::RowVectorXd(2) << 0.25, 0.75).finished();
+  auto valuesD = NumericConstant<Eigen::MatrixXd>::create(c, values);
+  auto valuesSEF = NumericConstant<SingleExtendedFloatMatrix>::create(c, values);
+  auto transitionNode = NumericConstant<Eigen::MatrixXd>::create(c, transition);
+  auto freqsNode = NumericConstant<Eigen::RowVectorXd>::create(c, freqs);
+  auto forwardD = MatrixProduct<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>::create(
+    c, {transitionNode, valuesD}, dim);
+  auto forwardSEF =
+    MatrixProduct<SingleExtendedFloatMatrix, Transposed<Eigen::MatrixXd>, SingleExtendedFloatMatrix>::create(
+      c, {transitionNode, valuesSEF}, dim);
+  auto likD = MatrixProduct<Eigen::RowVectorXd, Eigen::RowVectorXd, Eigen::MatrixXd>::create(
+    c, {freqsNode, forwardD}, bpp::rowVectorDimension(3));
+  auto likSEF = MatrixProduct<SingleExtendedFloatMatrix, Eigen::RowVectorXd, SingleExtendedFloatMatrix>::create(
+    c, {freqsNode, forwardSEF}, bpp::rowVectorDimension(3));
+  auto weights = NumericConstant<Eigen::RowVectorXd>::create(c, (Eigen::RowVectorXd(3) << 3., 1., 2.).finished());
+  CHECK(WeightedSumOfLogarithms<SingleExtendedFloatMatrix>::create(c, {likSEF, weights}, bpp::rowVectorDimension(3))
+          ->getValue() ==
+        doctest::Approx(WeightedSumOfLogarithms<Eigen::RowVectorXd>::create(c, {likD, weights},
+                                                                           bpp::rowVectorDimension(3))
+                          ->getValue())
+          .epsilon(1e-6));
+}
+
+TEST_CASE("fixed_state_matrices")
+{
+  using Transition4 = Eigen::Matrix<double, 4, 4>;
+  using CondLik4 = Eigen::Matrix<double, 4, Eigen::Dynamic>;
+  Context c;
+  const MatrixDimension dim(4, 5);
+  const Eigen::MatrixXd values = Eigen::MatrixXd::Random(4, 5).cwiseAbs();
+  const Eigen::MatrixXd transition = Eigen::MatrixXd::Random(4, 4).cwiseAbs();
+
+  // Nodes storing fixed size matrices must be correctly aligned for vectorization
+  auto transitionFixed = NumericConstant<Transition4>::create(c, transition);
+  CHECK(reinterpret_cast<std::uintptr_t>(&transitionFixed->getValue()) % alignof(Transition4) == 0);
+
+  // Same results as dynamic matrices
+  auto valuesD = NumericConstant<Eigen::MatrixXd>::create(c, values);
+  auto transitionD = NumericConstant<Eigen::MatrixXd>::create(c, transition);
+  auto valuesFixed = NumericConstant<CondLik4>::create(c, values);
+  auto forwardD = MatrixProduct<Eigen::MatrixXd, Transposed<Eigen::MatrixXd>, Eigen::MatrixXd>::create(
+    c, {transitionD, valuesD}, dim);
+  auto forwardFixed = MatrixProduct<CondLik4, Transposed<Transition4>, CondLik4>::create(
+    c, {transitionFixed, valuesFixed}, dim);
+  auto condD = CWiseMul<Eigen::MatrixXd, ReductionOf<Eigen::MatrixXd>>::create(c, {forwardD, valuesD}, dim);
+  auto condFixed = CWiseMul<CondLik4, ReductionOf<CondLik4>>::create(c, {forwardFixed, valuesFixed}, dim);
+  CHECK(condFixed->getValue().isApprox(condD->getValue()));
+}
+
 int main(int argc, char** argv)
 {
   const std::string keyword = "dot_output";
@@ -52,15 +52,19 @@
 #include <Bpp/Numeric/Function/SimpleNewtonMultiDimensions.h>
 #include <Bpp/Numeric/Parameter.h>
 #include <Bpp/Numeric/ParameterList.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
 #include <Bpp/Phyl/Model/Nucleotide/T92.h>
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 #include <chrono>
+#include <sstream>
+#include <numeric>
 
 // Old likelihood
 #ifdef ENABLE_OLD
 #include <Bpp/Numeric/Prob/ConstantDistribution.h>
 #include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
 #include <Bpp/Phyl/Tree/TreeTemplate.h>
 #endif
 // Newlik
@@ -71,6 +75,7 @@
 #endif
 // DF
 #include <Bpp/NewPhyl/LikelihoodExample.h>
+#include <Bpp/NewPhyl/LikelihoodService.h>
 #include <Bpp/Phyl/Io/Newick.h>
 #include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
 
@@ -289,6 +294,377 @@ TEST_CASE("df")
   // TODO test optimization with model params
 }
 
+TEST_CASE("df_site_blocks")
+{
+  const CommonStuff c;
+  bpp::Newick reader;
+  auto phyloTree = std::unique_ptr<bpp::PhyloTree>(reader.parenthesisToPhyloTree(c.treeStr, false, "", false, false));
+
+  bpp::dataflow::Context context;
+  auto model = std::unique_ptr<bpp::T92>(new bpp::T92(&c.alphabet, 3.));
+  auto modelParameters = bpp::dataflow::createParameterMapForModel(context, *model);
+  auto modelNode = bpp::dataflow::ConfiguredModel::create(
+    context,
+    bpp::dataflow::createDependencyVector(
+      *model, [&modelParameters](const std::string& paramName) { return modelParameters[paramName]; }),
+    std::move(model));
+
+  // Identical columns are merged in weighted patterns
+  const auto patterns = bpp::computeSitePatterns(c.sites);
+  CHECK(patterns.sites.size() < c.sites.getNumberOfSites());
+  CHECK(std::accumulate(patterns.weights.begin(), patterns.weights.end(), std::size_t(0)) ==
+        c.sites.getNumberOfSites());
+
+  // Same likelihood with and without splitting patterns in blocks (last block is partial)
+  auto whole = makeSimpleLikelihoodNodes(context, *phyloTree, c.sites, modelNode);
+  auto blocked = makeSimpleLikelihoodNodes(context, *phyloTree, c.sites, modelNode, 16);
+  CHECK(blocked.totalLogLikelihood->getValue() == doctest::Approx(whole.totalLogLikelihood->getValue()));
+
+  // Branch lengths are shared between blocks
+  CHECK(blocked.branchLengthValues.size() == whole.branchLengthValues.size());
+  blocked.branchLengthValues[1]->setValue(0.2);
+  whole.branchLengthValues[1]->setValue(0.2);
+  CHECK(blocked.totalLogLikelihood->getValue() == doctest::Approx(whole.totalLogLikelihood->getValue()));
+  dotOutput("likelihood_example_site_blocks", {blocked.totalLogLikelihood.get()});
+}
+
+TEST_CASE("df_analytical_brlen_derivatives")
+{
+  const CommonStuff c;
+  bpp::Newick reader;
+  auto phyloTree = std::unique_ptr<bpp::PhyloTree>(reader.parenthesisToPhyloTree(c.treeStr, false, "", false, false));
+
+  // Numerical derivation is not configured for the model: it would throw if used for branch lengths.
+  bpp::dataflow::Context context;
+  auto model = std::unique_ptr<bpp::T92>(new bpp::T92(&c.alphabet, 3.));
+  auto modelParameters = bpp::dataflow::createParameterMapForModel(context, *model);
+  auto modelNode = bpp::dataflow::ConfiguredModel::create(
+    context,
+    bpp::dataflow::createDependencyVector(
+      *model, [&modelParameters](const std::string& paramName) { return modelParameters[paramName]; }),
+    std::move(model));
+  auto l = makeSimpleLikelihoodNodes(context, *phyloTree, c.sites, modelNode);
+
+  // Compare analytical first and second derivatives to finite differences of the value
+  const double delta = 1e-5;
+  for (const auto& p : l.branchLengthValues)
+  {
+    auto& brlen = *p.second;
+    auto d1 = l.totalLogLikelihood->deriveAsValue(context, brlen);
+    auto d2 = d1->deriveAsValue(context, brlen);
+    const double x = brlen.getValue();
+    const double f = l.totalLogLikelihood->getValue();
+    const double d1Value = d1->getValue();
+    const double d2Value = d2->getValue();
+    brlen.setValue(x + delta);
+    const double fPlus = l.totalLogLikelihood->getValue();
+    brlen.setValue(x - delta);
+    const double fMinus = l.totalLogLikelihood->getValue();
+    brlen.setValue(x);
+    CHECK(d1Value == doctest::Approx((fPlus - fMinus) / (2. * delta)).epsilon(1e-4));
+    CHECK(d2Value == doctest::Approx((fPlus - 2. * f + fMinus) / (delta * delta)).epsilon(1e-2));
+  }
+
+  // Batched evaluation gives the same values as individual calls
+  bpp::ParameterList brlenParameters;
+  std::vector<std::string> brlenNames;
+  for (const auto& p : l.branchLengthValues)
+  {
+    brlenNames.push_back("BrLen" + std::to_string(p.first));
+    brlenParameters.addParameter(bpp::DataFlowParameter(brlenNames.back(), p.second));
+  }
+  bpp::DataFlowFunction llh(context, l.totalLogLikelihood, brlenParameters);
+  l.branchLengthValues.begin()->second->setValue(0.05);
+  const auto batch = llh.computeValueGradientAndHessianDiagonal(brlenNames);
+  CHECK(batch.value == doctest::Approx(llh.getValue()));
+  REQUIRE(batch.gradient.size() == brlenNames.size());
+  for (std::size_t i = 0; i < brlenNames.size(); ++i)
+  {
+    CHECK(batch.gradient[i] == doctest::Approx(llh.getFirstOrderDerivative(brlenNames[i])));
+    CHECK(batch.hessianDiagonal[i] == doctest::Approx(llh.getSecondOrderDerivative(brlenNames[i])));
+  }
+}
+
+TEST_CASE("df_model_parameter_derivatives")
+{
+  const CommonStuff c;
+  bpp::Newick reader;
+  auto phyloTree = std::unique_ptr<bpp::PhyloTree>(reader.parenthesisToPhyloTree(c.treeStr, false, "", false, false));
+
+  // GTR uses the eigen system, T92 does not declare one: both ways of deriving transition matrices.
+  std::vector<std::unique_ptr<bpp::SubstitutionModel>> models;
+  models.emplace_back(new bpp::GTR(&c.alphabet, 1.5, 0.5, 2., 0.8, 1.2, 0.3, 0.2, 0.2, 0.3));
+  models.emplace_back(new bpp::T92(&c.alphabet, 3.));
+  for (auto& model : models)
+  {
+    bpp::dataflow::Context context;
+    auto modelParameters = bpp::dataflow::createParameterMapForModel(context, *model);
+    auto modelNode = bpp::dataflow::ConfiguredModel::create(
+      context,
+      bpp::dataflow::createDependencyVector(
+        *model, [&modelParameters](const std::string& paramName) { return modelParameters[paramName]; }),
+      std::move(model));
+    modelNode->config.delta = bpp::dataflow::NumericConstant<double>::create(context, 1e-6);
+    modelNode->config.type = bpp::dataflow::NumericalDerivativeType::ThreePoints;
+    auto l = makeSimpleLikelihoodNodes(context, *phyloTree, c.sites, modelNode);
+
+    // Compare to finite differences of the value
+    const double delta = 1e-5;
+    for (const auto& p : modelParameters)
+    {
+      auto& x = *p.second;
+      auto d1 = l.totalLogLikelihood->deriveAsValue(context, x);
+      const double d1Value = d1->getValue();
+      const double xValue = x.getValue();
+      x.setValue(xValue + delta);
+      const double fPlus = l.totalLogLikelihood->getValue();
+      x.setValue(xValue - delta);
+      const double fMinus = l.totalLogLikelihood->getValue();
+      x.setValue(xValue);
+      CHECK(d1Value == doctest::Approx((fPlus - fMinus) / (2. * delta)).epsilon(1e-4));
+    }
+  }
+}
+
+TEST_CASE("df_rate_classes")
+{
+  const CommonStuff c;
+  bpp::Newick reader;
+  auto phyloTree = std::unique_ptr<bpp::PhyloTree>(reader.parenthesisToPhyloTree(c.treeStr, false, "", false, false));
+
+  bpp::dataflow::Context context;
+  auto model = std::unique_ptr<bpp::T92>(new bpp::T92(&c.alphabet, 3.));
+  auto modelParameters = bpp::dataflow::createParameterMapForModel(context, *model);
+  auto modelNode = bpp::dataflow::ConfiguredModel::create(
+    context,
+    bpp::dataflow::createDependencyVector(
+      *model, [&modelParameters](const std::string& paramName) { return modelParameters[paramName]; }),
+    std::move(model));
+
+  // Classes with equal rates give the likelihood without classes
+  auto simple = bpp::makeSimpleLikelihoodNodes(context, *phyloTree, c.sites, modelNode);
+  auto equalRates = bpp::makeClassLikelihoodNodes(context, *phyloTree, c.sites, modelNode, {1., 1.}, {0.25, 0.75});
+  CHECK(equalRates.totalLogLikelihood->getValue() == doctest::Approx(simple.totalLogLikelihood->getValue()));
+
+  // Discrete gamma rates, in site blocks
+  bpp::GammaDiscreteRateDistribution gamma(4, 0.5);
+  auto l = bpp::makeClassLikelihoodNodes(context, *phyloTree, c.sites, modelNode, gamma.getCategories(),
+                                         gamma.getProbabilities(), 16);
+#ifdef ENABLE_OLD
+  auto tree = std::unique_ptr<bpp::TreeTemplate<bpp::Node>>(bpp::TreeTemplateTools::parenthesisToTree(c.treeStr));
+  bpp::RHomogeneousTreeLikelihood oldLlh(*tree, c.sites, new bpp::T92(&c.alphabet, 3.), gamma.clone(), false, false);
+  oldLlh.initialize();
+  CHECK(l.totalLogLikelihood->getValue() == doctest::Approx(oldLlh.getValue()));
+#endif
+
+  // Analytical branch length derivatives of all classes
+  const double delta = 1e-5;
+  auto& brlen = *l.branchLengthValues.begin()->second;
+  auto d1 = l.totalLogLikelihood->deriveAsValue(context, brlen);
+  auto d2 = d1->deriveAsValue(context, brlen);
+  const double x = brlen.getValue();
+  const double f = l.totalLogLikelihood->getValue();
+  const double d1Value = d1->getValue();
+  const double d2Value = d2->getValue();
+  brlen.setValue(x + delta);
+  const double fPlus = l.totalLogLikelihood->getValue();
+  brlen.setValue(x - delta);
+  const double fMinus = l.totalLogLikelihood->getValue();
+  brlen.setValue(x);
+  CHECK(d1Value == doctest::Approx((fPlus - fMinus) / (2. * delta)).epsilon(1e-4));
+  CHECK(d2Value == doctest::Approx((fPlus - 2. * f + fMinus) / (delta * delta)).epsilon(1e-2));
+  dotOutput("likelihood_example_rate_classes", {l.totalLogLikelihood.get()});
+}
+
+#ifdef BPP_WITH_BEAGLE
+TEST_CASE("df_beagle")
+{
+  const CommonStuff c;
+  bpp::Newick reader;
+  auto phyloTree = std::unique_ptr<bpp::PhyloTree>(reader.parenthesisToPhyloTree(c.treeStr, false, "", false, false));
+
+  bpp::dataflow::Context context;
+  auto model = std::unique_ptr<bpp::T92>(new bpp::T92(&c.alphabet, 3.));
+  auto modelParameters = bpp::dataflow::createParameterMapForModel(context, *model);
+  auto modelNode = bpp::dataflow::ConfiguredModel::create(
+    context,
+    bpp::dataflow::createDependencyVector(
+      *model, [&modelParameters](const std::string& paramName) { return modelParameters[paramName]; }),
+    std::move(model));
+  auto reference = makeSimpleLikelihoodNodes(context, *phyloTree, c.sites, modelNode);
+  auto l = makeBeagleLikelihoodNodes(context, *phyloTree, c.sites, modelNode);
+  CHECK(l.totalLogLikelihood->getValue() == doctest::Approx(reference.totalLogLikelihood->getValue()));
+
+  // Parameter changes are sent to the instance
+  modelParameters["kappa"]->setValue(0.5);
+  for (const auto& p : l.branchLengthValues)
+  {
+    p.second->setValue(0.2);
+    reference.branchLengthValues[p.first]->setValue(0.2);
+  }
+  CHECK(l.totalLogLikelihood->getValue() == doctest::Approx(reference.totalLogLikelihood->getValue()));
+}
+#endif
+
+TEST_CASE("df_extended_float")
+{
+  const CommonStuff c;
+  bpp::Newick reader;
+  auto phyloTree = std::unique_ptr<bpp::PhyloTree>(reader.parenthesisToPhyloTree(c.treeStr, false, "", false, false));
+
+  bpp::dataflow::Context context;
+  auto model = std::unique_ptr<bpp::T92>(new bpp::T92(&c.alphabet, 3.));
+  auto modelParameters = bpp::dataflow::createParameterMapForModel(context, *model);
+  auto modelNode = bpp::dataflow::ConfiguredModel::create(
+    context,
+    bpp::dataflow::createDependencyVector(
+      *model, [&modelParameters](const std::string& paramName) { return modelParameters[paramName]; }),
+    std::move(model));
+
+  // Same likelihood with double and ExtendedFloat conditional likelihoods
+  auto doubleLik = bpp::makeSimpleLikelihoodNodes(context, *phyloTree, c.sites, modelNode);
+  auto extendedLik = bpp::makeSimpleLikelihoodNodesWithTypes<bpp::ExtendedFloatLikelihoodNodeTypes>(
+    context, *phyloTree, c.sites, modelNode);
+  CHECK(extendedLik.totalLogLikelihood->getValue() == doctest::Approx(doubleLik.totalLogLikelihood->getValue()));
+  dotOutput("likelihood_example_extended_float", {extendedLik.totalLogLikelihood.get()});
+}
+
+TEST_CASE("df_likelihood_service")
+{
+  const CommonStuff c;
+  bpp::Newick reader;
+  const char* treeStrs[] = {c.treeStr, "((A:0.05, B:0.02):0.01,C:0.2,D:0.1);", "((A:0.01, C:0.02):0.03,B:0.01,D:0.1);"};
+  std::vector<std::shared_ptr<const bpp::PhyloTree>> trees;
+  for (const char* treeStr : treeStrs)
+  {
+    trees.emplace_back(reader.parenthesisToPhyloTree(treeStr, false, "", false, false));
+  }
+
+  // Reference values from one graph per (tree, kappa)
+  const bpp::T92 model(&c.alphabet, 3.);
+  auto reference = [&c, &model](const bpp::PhyloTree& tree, double kappa) {
+    bpp::dataflow::Context context;
+    auto modelParameters = bpp::dataflow::createParameterMapForModel(context, model);
+    modelParameters["kappa"]->setValue(kappa);
+    auto modelNode = bpp::dataflow::ConfiguredModel::create(
+      context,
+      bpp::dataflow::createDependencyVector(
+        model, [&modelParameters](const std::string& paramName) { return modelParameters[paramName]; }),
+      std::unique_ptr<bpp::TransitionModel>(model.clone()));
+    return bpp::makeSimpleLikelihoodNodes(context, tree, c.sites, modelNode).totalLogLikelihood->getValue();
+  };
+
+  bpp::LikelihoodService service(c.sites, model, 2);
+  std::vector<std::future<double>> results;
+  std::vector<double> expected;
+  for (int round = 0; round < 4; ++round)
+  {
+    for (const auto& tree : trees)
+    {
+      const double kappa = 1. + round;
+      results.emplace_back(service.submit(bpp::LikelihoodRequest{tree, {{"kappa", kappa}}}));
+      expected.push_back(reference(*tree, kappa));
+    }
+  }
+  for (std::size_t i = 0; i < results.size(); ++i)
+  {
+    CHECK(results[i].get() == doctest::Approx(expected[i]));
+  }
+  // Graphs are reused: the first two trees share a topology
+  CHECK(service.nbEnginesBuilt() < results.size());
+
+  auto unknown = service.submit(bpp::LikelihoodRequest{trees[0], {{"alpha", 1.}}});
+  CHECK_THROWS_AS(unknown.get(), bpp::Exception);
+}
+
+TEST_CASE("df_streamed_likelihood")
+{
+  const CommonStuff c;
+  bpp::Newick reader;
+  auto phyloTree = std::unique_ptr<bpp::PhyloTree>(reader.parenthesisToPhyloTree(c.treeStr, false, "", false, false));
+  const bpp::T92 model(&c.alphabet, 3.);
+
+  // Reference: one graph for the whole alignment
+  bpp::dataflow::Context context;
+  auto modelParameters = bpp::dataflow::createParameterMapForModel(context, model);
+  auto modelNode = bpp::dataflow::ConfiguredModel::create(
+    context,
+    bpp::dataflow::createDependencyVector(
+      model, [&modelParameters](const std::string& paramName) { return modelParameters[paramName]; }),
+    std::unique_ptr<bpp::TransitionModel>(model.clone()));
+  auto l = makeSimpleLikelihoodNodes(context, *phyloTree, c.sites, modelNode);
+
+  // Write the alignment in blocks of 16 sites (last block is partial)
+  std::stringstream stream;
+  bpp::BinarySiteBlockWriter writer(stream, c.sites.getSequencesNames());
+  for (std::size_t first = 0; first < c.sites.getNumberOfSites(); first += 16)
+  {
+    writer.writeBlock(c.sites, first, std::min(std::size_t(16), c.sites.getNumberOfSites() - first));
+  }
+
+  bpp::BinarySiteBlockReader blocks(stream, &c.alphabet);
+  const auto streamed = bpp::computeStreamedLikelihood(blocks, *phyloTree, model);
+  CHECK(streamed.nbSites == c.sites.getNumberOfSites());
+  CHECK(streamed.totalLogLikelihood == doctest::Approx(l.totalLogLikelihood->getValue()));
+  REQUIRE(streamed.branchLengthDerivatives.size() == l.branchLengthValues.size());
+  for (const auto& p : l.branchLengthValues)
+  {
+    CHECK(streamed.branchLengthDerivatives.at(p.first) ==
+          doctest::Approx(l.totalLogLikelihood->deriveAsValue(context, *p.second)->getValue()));
+  }
+}
+
+TEST_CASE("df_graph_template")
+{
+  const CommonStuff c;
+  bpp::Newick reader;
+  auto phyloTree = std::unique_ptr<bpp::PhyloTree>(reader.parenthesisToPhyloTree(c.treeStr, false, "", false, false));
+
+  bpp::dataflow::Context context;
+  auto model = std::unique_ptr<bpp::T92>(new bpp::T92(&c.alphabet, 3.));
+  auto modelParameters = bpp::dataflow::createParameterMapForModel(context, *model);
+  auto modelNode = bpp::dataflow::ConfiguredModel::create(
+    context,
+    bpp::dataflow::createDependencyVector(
+      *model, [&modelParameters](const std::string& paramName) { return modelParameters[paramName]; }),
+    std::move(model));
+
+  for (bool fuse : {false, true})
+  {
+    // Same graph from the tree and from its template
+    auto direct = bpp::makeSimpleLikelihoodNodes(context, *phyloTree, c.sites, modelNode, 16, fuse);
+    const auto graph = bpp::LikelihoodGraphTemplate::create(*phyloTree, fuse);
+    auto templated = bpp::makeSimpleLikelihoodNodesFromTemplate(context, graph, c.sites, modelNode, 16);
+    CHECK(templated.totalLogLikelihood->getValue() == doctest::Approx(direct.totalLogLikelihood->getValue()));
+    REQUIRE(templated.branchLengthValues.size() == direct.branchLengthValues.size());
+
+    // Templates survive a round trip in a stream
+    std::stringstream stream;
+    graph.write(stream);
+    const auto loaded = bpp::LikelihoodGraphTemplate::read(stream);
+    CHECK(loaded.structureHash == graph.structureHash);
+    auto reloaded = bpp::makeSimpleLikelihoodNodesFromTemplate(context, loaded, c.sites, modelNode, 16);
+    for (const auto& p : direct.branchLengthValues)
+    {
+      p.second->setValue(0.2);
+      reloaded.branchLengthValues.at(p.first)->setValue(0.2);
+    }
+    CHECK(reloaded.totalLogLikelihood->getValue() == doctest::Approx(direct.totalLogLikelihood->getValue()));
+  }
+
+  // Branch lengths are not part of the structure, leaf names are
+  auto otherLengths =
+    std::unique_ptr<bpp::PhyloTree>(reader.parenthesisToPhyloTree("((A:0.05, B:0.02):0.01,C:0.2,D:0.1);", false, "", false, false));
+  auto otherTopology =
+    std::unique_ptr<bpp::PhyloTree>(reader.parenthesisToPhyloTree("((A:0.01, C:0.02):0.03,B:0.01,D:0.1);", false, "", false, false));
+  const auto graph = bpp::LikelihoodGraphTemplate::create(*phyloTree);
+  CHECK(bpp::LikelihoodGraphTemplate::create(*otherLengths).structureHash == graph.structureHash);
+  CHECK(bpp::LikelihoodGraphTemplate::create(*otherTopology).structureHash != graph.structureHash);
+
+  std::stringstream truncated(std::string(8, 'x'));
+  CHECK_THROWS_AS(bpp::LikelihoodGraphTemplate::read(truncated), bpp::IOException);
+}
+
 int main(int argc, char** argv)
 {
   const std::string keyword = "dot_output";
@@ -0,0 +1,163 @@
+//
+// File: test_agglomerative_threads.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Seq/DistanceMatrix.h>
+#include <Bpp/Phyl/Distance/BioNJ.h>
+#include <Bpp/Phyl/Distance/HierarchicalClustering.h>
+#include <Bpp/Phyl/Distance/NeighborJoining.h>
+#include <Bpp/Phyl/Distance/PGMA.h>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+// Trees built with distinct numbers of threads must be identical, node ids and branch lengths included.
+bool areIdentical(const TreeTemplate<Node>& tree1, const TreeTemplate<Node>& tree2)
+{
+  vector<const Node*> nodes1 = tree1.getNodes();
+  vector<const Node*> nodes2 = tree2.getNodes();
+  if (nodes1.size() != nodes2.size())
+    return false;
+  for (size_t i = 0; i < nodes1.size(); ++i)
+  {
+    const Node* n1 = nodes1[i];
+    const Node* n2 = nodes2[i];
+    if (n1->getId() != n2->getId()
+        || n1->getNumberOfSons() != n2->getNumberOfSons()
+        || n1->hasName() != n2->hasName()
+        || (n1->hasName() && n1->getName() != n2->getName())
+        || n1->hasDistanceToFather() != n2->hasDistanceToFather()
+        || (n1->hasDistanceToFather() && n1->getDistanceToFather() != n2->getDistanceToFather()))
+      return false;
+  }
+  return true;
+}
+
+int main() {
+  try {
+    vector<AbstractAgglomerativeDistanceMethod*> methods;
+    vector<string> names;
+    methods.push_back(new NeighborJoining(false, false, false));
+    names.push_back("NJ");
+    methods.push_back(new BioNJ(false, false, false));
+    names.push_back("BioNJ");
+    methods.push_back(new PGMA(false));
+    names.push_back("UPGMA");
+    methods.push_back(new PGMA(true));
+    names.push_back("WPGMA");
+    string linkages[] = {
+      HierarchicalClustering::COMPLETE, HierarchicalClustering::SINGLE,
+      HierarchicalClustering::AVERAGE, HierarchicalClustering::MEDIAN,
+      HierarchicalClustering::WARD, HierarchicalClustering::CENTROID };
+    //The constructor with a matrix builds rooted trees, as used in practice:
+    DistanceMatrix start(3);
+    start(0, 1) = start(1, 0) = 1.;
+    start(0, 2) = start(2, 0) = 2.;
+    start(1, 2) = start(2, 1) = 3.;
+    for (const string& linkage : linkages)
+    {
+      methods.push_back(new HierarchicalClustering(linkage, start));
+      names.push_back(linkage);
+    }
+    for (AbstractAgglomerativeDistanceMethod* method : methods)
+      method->setVerbose(false);
+
+    size_t sizes[] = {3, 4, 15, 40};
+    size_t threads[] = {2, 3, 50};
+    for (size_t r = 0; r < 40; ++r)
+    {
+      size_t n = sizes[r % 4];
+      //Small integer distances every other replicate, so that there are ties:
+      DistanceMatrix matrix(n);
+      for (size_t i = 0; i < n; ++i)
+        for (size_t j = i + 1; j < n; ++j)
+          matrix(i, j) = matrix(j, i) = (r % 2 == 0) ?
+            static_cast<double>(1 + RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(5)) :
+            RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+
+      for (size_t k = 0; k < methods.size(); ++k)
+      {
+        AbstractAgglomerativeDistanceMethod* method = methods[k];
+        method->setNumberOfThreads(1);
+        method->setDistanceMatrix(matrix);
+        method->computeTree();
+        unique_ptr< TreeTemplate<Node> > serialTree(method->getTree());
+        for (size_t t : threads)
+        {
+          method->setNumberOfThreads(t);
+          method->setDistanceMatrix(matrix);
+          method->computeTree();
+          unique_ptr< TreeTemplate<Node> > tree(method->getTree());
+          if (!areIdentical(*serialTree, *tree))
+          {
+            cerr << names[k] << ", replicate " << r << ", " << t << " threads: trees differ." << endl;
+            return 1;
+          }
+        }
+
+        //A copy keeps the number of threads:
+        unique_ptr<AbstractAgglomerativeDistanceMethod> copy(dynamic_cast<AbstractAgglomerativeDistanceMethod*>(method->clone()));
+        if (copy->getNumberOfThreads() != threads[2])
+        {
+          cerr << names[k] << ": number of threads not copied." << endl;
+          return 1;
+        }
+        copy->setDistanceMatrix(matrix);
+        copy->computeTree();
+        unique_ptr< TreeTemplate<Node> > copyTree(copy->getTree());
+        if (!areIdentical(*serialTree, *copyTree))
+        {
+          cerr << names[k] << ", replicate " << r << ": tree of the copy differs." << endl;
+          return 1;
+        }
+      }
+    }
+    cout << "Trees ok." << endl;
+
+    for (AbstractAgglomerativeDistanceMethod* method : methods)
+      delete method;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
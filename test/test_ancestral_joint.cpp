@@ -0,0 +1,231 @@
+//
+// File: test_ancestral_joint.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/PhyloTree.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/JointAncestralStateReconstruction.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/JointAncestralReconstruction.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <map>
+
+using namespace bpp;
+using namespace std;
+
+// A tree as a list of nodes, independent of the likelihood engine.
+struct BruteNode
+{
+  int id;
+  int father; // Position in the list, -1 for the root.
+  double length;
+  string name;
+  bool leaf;
+};
+
+// Log probability of the states of all nodes at a site, for one rate class.
+double logJoint(const vector<BruteNode>& nodes, const vector<int>& states, const TransitionModel& model, double rate)
+{
+  double lp = 0;
+  for (size_t k = 0; k < nodes.size(); ++k)
+  {
+    if (nodes[k].father < 0)
+      lp += log(model.freq(static_cast<size_t>(states[k])));
+    else
+    {
+      const Matrix<double>& pxy = model.getPij_t(nodes[k].length * rate);
+      lp += log(pxy(static_cast<size_t>(states[static_cast<size_t>(nodes[k].father)]), static_cast<size_t>(states[k])));
+    }
+  }
+  return lp;
+}
+
+// Best joint log probability of a site, over all classes and all states of the inner nodes.
+double bestLogJoint(const vector<BruteNode>& nodes, const vector<int>& leafStates, const TransitionModel& model, const DiscreteDistribution& rdist)
+{
+  size_t nbStates = model.getNumberOfStates();
+  vector<size_t> inner;
+  for (size_t k = 0; k < nodes.size(); ++k)
+    if (!nodes[k].leaf) inner.push_back(k);
+  size_t nbAssignments = 1;
+  for (size_t j = 0; j < inner.size(); ++j)
+    nbAssignments *= nbStates;
+
+  double best = -numeric_limits<double>::infinity();
+  vector<int> states = leafStates;
+  for (size_t a = 0; a < nbAssignments; ++a)
+  {
+    size_t code = a;
+    for (size_t j = 0; j < inner.size(); ++j)
+    {
+      states[inner[j]] = static_cast<int>(code % nbStates);
+      code /= nbStates;
+    }
+    for (size_t c = 0; c < rdist.getNumberOfCategories(); ++c)
+      best = max(best, log(rdist.getProbability(c)) + logJoint(nodes, states, model, rdist.getCategory(c)));
+  }
+  return best;
+}
+
+// Check the reconstructed states of each site against the brute-force optimum.
+bool check(const AbstractJointAncestralStateReconstruction& asr, const vector<BruteNode>& nodes,
+           const SiteContainer& sites, const TransitionModel& model, const DiscreteDistribution& rdist)
+{
+  map<int, shared_ptr<Sequence> > ancestors;
+  for (size_t k = 0; k < nodes.size(); ++k)
+    if (!nodes[k].leaf)
+      ancestors[nodes[k].id] = shared_ptr<Sequence>(asr.getAncestralSequenceForNode(nodes[k].id));
+
+  for (size_t i = 0; i < sites.getNumberOfSites(); ++i)
+  {
+    vector<int> states(nodes.size());
+    for (size_t k = 0; k < nodes.size(); ++k)
+      states[k] = nodes[k].leaf ? sites.getSequence(nodes[k].name).getValue(i) : ancestors[nodes[k].id]->getValue(i);
+    double value = -numeric_limits<double>::infinity();
+    for (size_t c = 0; c < rdist.getNumberOfCategories(); ++c)
+      value = max(value, log(rdist.getProbability(c)) + logJoint(nodes, states, model, rdist.getCategory(c)));
+    double best = bestLogJoint(nodes, states, model, rdist);
+    if (abs(value - best) > 1e-9 * abs(best))
+    {
+      cerr << "Site " << i << ": joint log likelihood of the reconstruction " << value << ", best " << best << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  string newick = "((A:0.1,B:0.25):0.15,(C:0.3,D:0.05):0.2,E:0.12);";
+
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAA", alphabet));
+  sites.addSequence(BasicSequence("B", "GATCACGATAGCATGTATGTTCAGAGAGTAAATCTA", alphabet));
+  sites.addSequence(BasicSequence("C", "GTAATACTTTATAAATACTGATCAATTCAGATAATT", alphabet));
+  sites.addSequence(BasicSequence("D", "TCAATCGAAAGCCAGGATCAACAATCTTTAACTTAT", alphabet));
+  sites.addSequence(BasicSequence("E", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAA", alphabet));
+
+  T92 model(alphabet, 3., 0.6);
+  GammaDiscreteDistribution rdist(3, 0.5);
+
+  try {
+    // Double-recursive likelihood:
+    {
+      Newick reader;
+      unique_ptr<TreeTemplate<Node> > tree(reader.parenthesisToTree(newick));
+      DRHomogeneousTreeLikelihood drl(*tree, sites, model.clone(), rdist.clone(), true, false);
+      drl.initialize();
+      drl.getValue();
+
+      const TreeTemplate<Node> drTree(drl.getTree());
+      vector<const Node*> treeNodes = drTree.getNodes();
+      map<int, int> positions;
+      for (size_t k = 0; k < treeNodes.size(); ++k)
+        positions[treeNodes[k]->getId()] = static_cast<int>(k);
+      vector<BruteNode> nodes(treeNodes.size());
+      for (size_t k = 0; k < treeNodes.size(); ++k)
+      {
+        const Node* node = treeNodes[k];
+        nodes[k].id     = node->getId();
+        nodes[k].father = node->hasFather() ? positions[node->getFather()->getId()] : -1;
+        nodes[k].length = node->hasFather() ? node->getDistanceToFather() : 0.;
+        nodes[k].leaf   = node->isLeaf();
+        nodes[k].name   = node->hasName() ? node->getName() : "";
+      }
+
+      for (size_t nbThreads = 1; nbThreads <= 2; ++nbThreads)
+      {
+        JointAncestralStateReconstruction asr(&drl, nbThreads);
+        if (!check(asr, nodes, sites, model, rdist))
+          return 1;
+      }
+      cout << "Joint reconstruction for DRHomogeneousTreeLikelihood ok." << endl;
+    }
+
+    // Recursive likelihood calculation:
+    {
+      Newick reader;
+      unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree(newick, false, "", false, false));
+      ParametrizablePhyloTree pTree(*tree);
+      unique_ptr<RateAcrossSitesSubstitutionProcess> process(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist.clone(), pTree.clone()));
+      // Arrays indexed by distinct sites, as required by the reconstruction:
+      RecursiveLikelihoodTreeCalculation* rltc = new RecursiveLikelihoodTreeCalculation(sites, process.get(), true, false);
+      SingleProcessPhyloLikelihood lik(process.get(), rltc);
+      lik.getValue();
+
+      vector<shared_ptr<PhyloNode> > treeNodes = tree->getAllNodes();
+      map<PhyloTree::NodeIndex, int> positions;
+      for (size_t k = 0; k < treeNodes.size(); ++k)
+        positions[tree->getNodeIndex(treeNodes[k])] = static_cast<int>(k);
+      vector<BruteNode> nodes(treeNodes.size());
+      for (size_t k = 0; k < treeNodes.size(); ++k)
+      {
+        shared_ptr<PhyloNode> node = treeNodes[k];
+        bool hasFather = tree->hasFather(node);
+        nodes[k].id     = static_cast<int>(tree->getNodeIndex(node));
+        nodes[k].father = hasFather ? positions[tree->getNodeIndex(tree->getFather(node))] : -1;
+        nodes[k].length = hasFather ? tree->getEdgeToFather(node)->getLength() : 0.;
+        nodes[k].leaf   = tree->isLeaf(node);
+        nodes[k].name   = node->hasName() ? node->getName() : "";
+      }
+
+      for (size_t nbThreads = 1; nbThreads <= 2; ++nbThreads)
+      {
+        JointAncestralReconstruction asr(*rltc, nbThreads);
+        if (!check(asr, nodes, sites, model, rdist))
+          return 1;
+      }
+      cout << "Joint reconstruction for RecursiveLikelihoodTreeCalculation ok." << endl;
+    }
+  } catch (Exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
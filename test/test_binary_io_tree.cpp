@@ -0,0 +1,256 @@
+//
+// File: test_binary_io_tree.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/BppString.h>
+#include <Bpp/BppBoolean.h>
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Tree/TreeTools.h>
+#include <Bpp/Phyl/Tree/PhyloTree.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Io/BinaryIoTree.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool sameProperty(const Clonable* p1, const Clonable* p2)
+{
+  if (!p1 || !p2) return false;
+  if (const BppString* s1 = dynamic_cast<const BppString*>(p1)) {
+    const BppString* s2 = dynamic_cast<const BppString*>(p2);
+    return s2 && s1->toSTL() == s2->toSTL();
+  }
+  if (const Number<int>* i1 = dynamic_cast<const Number<int>*>(p1)) {
+    const Number<int>* i2 = dynamic_cast<const Number<int>*>(p2);
+    return i2 && i1->getValue() == i2->getValue();
+  }
+  if (const Number<double>* d1 = dynamic_cast<const Number<double>*>(p1)) {
+    const Number<double>* d2 = dynamic_cast<const Number<double>*>(p2);
+    return d2 && d1->getValue() == d2->getValue();
+  }
+  if (const BppBoolean* b1 = dynamic_cast<const BppBoolean*>(p1)) {
+    const BppBoolean* b2 = dynamic_cast<const BppBoolean*>(p2);
+    return b2 && b1->getValue() == b2->getValue();
+  }
+  return false;
+}
+
+bool sameTree(const Tree& t1, const Tree& t2)
+{
+  vector<int> ids = t1.getNodesId();
+  if (ids.size() != t2.getNumberOfNodes() || t1.getRootId() != t2.getRootId())
+    return false;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    int id = ids[i];
+    if (!t2.hasNode(id)) return false;
+    if (t1.hasNodeName(id) != t2.hasNodeName(id)) return false;
+    if (t1.hasNodeName(id) && t1.getNodeName(id) != t2.getNodeName(id)) return false;
+    if (t1.hasFather(id) != t2.hasFather(id)) return false;
+    if (t1.hasFather(id)) {
+      if (t1.getFatherId(id) != t2.getFatherId(id)) return false;
+      // Lengths are stored raw: they must be restored exactly.
+      if (t1.getDistanceToFather(id) != t2.getDistanceToFather(id)) return false;
+    }
+    vector<string> names = t1.getNodePropertyNames(id);
+    if (names.size() != t2.getNodePropertyNames(id).size()) return false;
+    for (size_t j = 0; j < names.size(); ++j)
+      if (!t2.hasNodeProperty(id, names[j]) || !sameProperty(t1.getNodeProperty(id, names[j]), t2.getNodeProperty(id, names[j])))
+        return false;
+    names = t1.getBranchPropertyNames(id);
+    if (names.size() != t2.getBranchPropertyNames(id).size()) return false;
+    for (size_t j = 0; j < names.size(); ++j)
+      if (!t2.hasBranchProperty(id, names[j]) || !sameProperty(t1.getBranchProperty(id, names[j]), t2.getBranchProperty(id, names[j])))
+        return false;
+  }
+  return true;
+}
+
+bool samePhyloTree(const PhyloTree& t1, const PhyloTree& t2)
+{
+  vector<shared_ptr<PhyloNode> > nodes = t1.getAllNodes();
+  if (nodes.size() != t2.getAllNodes().size())
+    return false;
+  if (t1.getNodeIndex(t1.getRoot()) != t2.getNodeIndex(t2.getRoot()))
+    return false;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    PhyloTree::NodeIndex index = t1.getNodeIndex(nodes[i]);
+    shared_ptr<PhyloNode> node2 = t2.getNode(index);
+    if (nodes[i]->hasName() != node2->hasName()) return false;
+    if (nodes[i]->hasName() && nodes[i]->getName() != node2->getName()) return false;
+    vector<string> names = nodes[i]->getPropertyNames();
+    if (names.size() != node2->getPropertyNames().size()) return false;
+    for (size_t j = 0; j < names.size(); ++j)
+      if (!node2->hasProperty(names[j]) || !sameProperty(nodes[i]->getProperty(names[j]), node2->getProperty(names[j])))
+        return false;
+    if (t1.hasFather(nodes[i]) != t2.hasFather(node2)) return false;
+    if (t1.hasFather(nodes[i])) {
+      if (t1.getNodeIndex(t1.getFather(nodes[i])) != t2.getNodeIndex(t2.getFather(node2))) return false;
+      shared_ptr<PhyloBranch> b1 = t1.getEdgeToFather(nodes[i]);
+      shared_ptr<PhyloBranch> b2 = t2.getEdgeToFather(node2);
+      if (b1->hasLength() != b2->hasLength()) return false;
+      if (b1->hasLength() && b1->getLength() != b2->getLength()) return false;
+      names = b1->getPropertyNames();
+      if (names.size() != b2->getPropertyNames().size()) return false;
+      for (size_t j = 0; j < names.size(); ++j)
+        if (!b2->hasProperty(names[j]) || !sameProperty(b1->getProperty(names[j]), b2->getProperty(names[j])))
+          return false;
+    }
+  }
+  return true;
+}
+
+TreeTemplate<Node>* getTreeWithProperties(size_t nbLeaves)
+{
+  vector<string> leaves(nbLeaves);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    leaves[i] = "leaf " + TextTools::toString(i);
+  TreeTemplate<Node>* tree = TreeTemplateTools::getRandomTree(leaves, true);
+  vector<Node*> nodes = tree->getNodes();
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (nodes[i]->hasFather())
+      nodes[i]->setDistanceToFather(RandomTools::giveRandomNumberBetweenZeroAndEntry(1.0));
+    // Values containing newline and carriage return bytes, altered by text mode on some platforms:
+    nodes[i]->setNodeProperty("GN", BppString("Gene\r\n" + TextTools::toString(i)));
+    nodes[i]->setNodeProperty("W", Number<int>(static_cast<int>(i) - 3));
+    nodes[i]->setNodeProperty("D", BppBoolean(i % 2 == 0));
+    nodes[i]->setBranchProperty("rate", Number<double>(10. / 13. + static_cast<double>(i)));
+    if (nodes[i]->hasFather() && !nodes[i]->isLeaf())
+      nodes[i]->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(floor(RandomTools::giveRandomNumberBetweenZeroAndEntry(100.) + 0.5)));
+  }
+  return tree;
+}
+
+int main() {
+  BinaryIOTree io;
+  string path = "test_binary_io_tree.bin";
+
+  // Tree objects, written and read through a path, one by one and appended:
+  vector<TreeTemplate<Node>*> trees;
+  for (size_t i = 0; i < 3; ++i)
+    trees.push_back(getTreeWithProperties(5 + 10 * i));
+
+  io.write(*trees[0], path, true);
+  TreeTemplate<Node>* tree = io.read(path);
+  if (!sameTree(*trees[0], *tree)) {
+    cerr << "Tree read back from file differs from the original one." << endl;
+    return 1;
+  }
+  delete tree;
+
+  io.write(*trees[1], path, false);
+  io.write(vector<const Tree*>(1, trees[2]), path, false);
+  vector<Tree*> trees2;
+  io.read(path, trees2);
+  if (trees2.size() != trees.size()) {
+    cerr << "Expected " << trees.size() << " trees, read " << trees2.size() << "." << endl;
+    return 1;
+  }
+  for (size_t i = 0; i < trees.size(); ++i) {
+    if (!sameTree(*trees[i], *trees2[i])) {
+      cerr << "Tree " << i << " read back from file differs from the original one." << endl;
+      return 1;
+    }
+    delete trees2[i];
+  }
+
+  size_t count = 0;
+  io.readTrees(path, [&](Tree* t) { bool ok = sameTree(*trees[count], *t); delete t; count++; return ok; });
+  if (count != trees.size()) {
+    cerr << "readTrees stopped after " << count << " trees." << endl;
+    return 1;
+  }
+
+  // PhyloTree objects:
+  Newick newick;
+  istringstream newickStream("((A:0.1,B:0.2)90:0.05,(C:0.3,D:0.1)75:0.2,E:0.15);");
+  PhyloTree* phyloTree = newick.readP(newickStream);
+  vector<shared_ptr<PhyloNode> > nodes = phyloTree->getAllNodes();
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    nodes[i]->setProperty("GN", BppString("Gene\r\n" + TextTools::toString(i)));
+    nodes[i]->setProperty("W", Number<int>(static_cast<int>(i)));
+    if (phyloTree->hasFather(nodes[i])) {
+      phyloTree->getEdgeToFather(nodes[i])->setProperty("rate", Number<double>(1. / 3. + static_cast<double>(i)));
+      phyloTree->getEdgeToFather(nodes[i])->setProperty("D", BppBoolean(i % 2 == 1));
+    }
+  }
+  io.write(*phyloTree, path, true);
+  io.write(vector<const PhyloTree*>(1, phyloTree), path, false);
+  PhyloTree* phyloTree2 = io.readP(path);
+  if (!samePhyloTree(*phyloTree, *phyloTree2)) {
+    cerr << "PhyloTree read back from file differs from the original one." << endl;
+    return 1;
+  }
+  delete phyloTree2;
+  vector<PhyloTree*> phyloTrees;
+  io.read(path, phyloTrees);
+  if (phyloTrees.size() != 2) {
+    cerr << "Expected 2 phylogenetic trees, read " << phyloTrees.size() << "." << endl;
+    return 1;
+  }
+  for (size_t i = 0; i < phyloTrees.size(); ++i) {
+    if (!samePhyloTree(*phyloTree, *phyloTrees[i])) {
+      cerr << "PhyloTree " << i << " read back from file differs from the original one." << endl;
+      return 1;
+    }
+    delete phyloTrees[i];
+  }
+
+  // Unsupported property classes are refused:
+  trees[0]->getRootNode()->setNodeProperty("bad", *trees[1]);
+  try {
+    io.write(*trees[0], path, true);
+    cerr << "Writing an unsupported property should throw." << endl;
+    return 1;
+  } catch (IOException& e) {}
+
+  delete phyloTree;
+  for (size_t i = 0; i < trees.size(); ++i)
+    delete trees[i];
+  remove(path.c_str());
+  cout << "Binary tree round trips OK." << endl;
+  return 0;
+}
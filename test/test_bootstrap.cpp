@@ -0,0 +1,161 @@
+//
+// File: test_bootstrap.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Tree/TreeTools.h>
+#include <Bpp/Phyl/Tree/BipartitionCounter.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <memory>
+#include <sstream>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+double getSupport(const Node& node)
+{
+  return dynamic_cast<const Number<double>*>(node.getBranchProperty(TreeTools::BOOTSTRAP))->getValue();
+}
+
+// Check the supports of the sons of the root.
+bool checkSupports(const TreeTemplate<Node>& tree, const vector<double>& expected)
+{
+  const Node* root = tree.getRootNode();
+  for (size_t i = 0; i < expected.size(); ++i)
+  {
+    const Node* son = root->getSon(i);
+    if (son->isLeaf())
+    {
+      if (son->hasBranchProperty(TreeTools::BOOTSTRAP))
+        return false;
+    }
+    else if (!son->hasBranchProperty(TreeTools::BOOTSTRAP) || getSupport(*son) != expected[i])
+    {
+      cerr << "Support of son " << i << " is " << (son->hasBranchProperty(TreeTools::BOOTSTRAP) ? getSupport(*son) : -1.) << ", expected " << expected[i] << "." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  //AB occurs in 3 trees out of 4, DE in 2, AC, CE and CD in 1:
+  string replicates =
+    "((A,B),C,(D,E));\n"
+    "((A,B),D,(C,E));\n"
+    "((A,C),B,(D,E));\n"
+    "((A,B),E,(C,D));\n";
+  vector<Tree*> trees;
+  istringstream iss(replicates);
+  Newick reader;
+  reader.read(iss, trees);
+  if (trees.size() != 4)
+    return 1;
+
+  unique_ptr< TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("((A,B),C,(D,E));", true, TreeTools::BOOTSTRAP, false, false));
+  TreeTools::computeBootstrapValues(*tree, trees, false);
+  if (!checkSupports(*tree, { 75., 0., 50. }))
+    return 1;
+  TreeTools::computeBootstrapValues(*tree, trees, false, -1);
+  if (!checkSupports(*tree, { 3., 0., 2. }))
+    return 1;
+  //Unseen bipartitions get a null support:
+  tree.reset(TreeTemplateTools::parenthesisToTree("((A,E),B,(C,D));", true, TreeTools::BOOTSTRAP, false, false));
+  TreeTools::computeBootstrapValues(*tree, trees, false);
+  if (!checkSupports(*tree, { 0., 0., 25. }))
+    return 1;
+  //Rooted tree, both sons of the root define the same bipartition:
+  tree.reset(TreeTemplateTools::parenthesisToTree("(((A,B),C),(D,E));", true, TreeTools::BOOTSTRAP, false, false));
+  TreeTools::computeBootstrapValues(*tree, trees, false);
+  if (!checkSupports(*tree, { 50., 50. }) || getSupport(*tree->getRootNode()->getSon(0)->getSon(0)) != 75.)
+    return 1;
+  //Support with one decimal, out of 3 trees:
+  vector<Tree*> threeTrees(trees.begin(), trees.begin() + 3);
+  tree.reset(TreeTemplateTools::parenthesisToTree("((A,B),C,(D,E));", true, TreeTools::BOOTSTRAP, false, false));
+  TreeTools::computeBootstrapValues(*tree, threeTrees, false, 1);
+  if (!checkSupports(*tree, { 66.7, 0., 66.7 }))
+    return 1;
+  cout << "Bootstrap values ok." << endl;
+
+  //Streaming from a multi-tree stream gives the same result:
+  BipartitionCounter counter;
+  istringstream iss2(replicates);
+  TreeTemplate<Node>* replicate;
+  while ((replicate = reader.readNextTree(iss2)))
+  {
+    counter.addTree(*replicate);
+    delete replicate;
+  }
+  if (counter.getNumberOfTrees() != 4 || counter.getNumberOfDistinctBipartitions() != 5)
+    return 1;
+  tree.reset(TreeTemplateTools::parenthesisToTree("((A,B),C,(D,E));", true, TreeTools::BOOTSTRAP, false, false));
+  counter.computeBootstrapValues(*tree, false);
+  if (!checkSupports(*tree, { 75., 0., 50. }))
+    return 1;
+  cout << "Streamed bootstrap values ok." << endl;
+
+  //Occurrences and consensus:
+  vector<size_t> scores;
+  unique_ptr<BipartitionList> bipL(TreeTools::bipartitionOccurrences(trees, scores));
+  if (bipL->getNumberOfBipartitions() != 10 || scores.size() != 10)
+    return 1;
+  size_t total = 0;
+  for (size_t i = 0; i < scores.size(); ++i)
+    total += scores[i];
+  if (total != 5 * 4 + 8)
+    return 1;
+  unique_ptr< TreeTemplate<Node> > consensus(TreeTools::majorityConsensus(trees));
+  unique_ptr< TreeTemplate<Node> > expected(TreeTemplateTools::parenthesisToTree("((A,B),C,D,E);", true, TreeTools::BOOTSTRAP, false, false));
+  if (TreeTools::robinsonFouldsDistance(*consensus, *expected) != 0)
+    return 1;
+  //Trees with other leaves are rejected:
+  trees.push_back(TreeTemplateTools::parenthesisToTree("((A,B),C,(D,F));", true, TreeTools::BOOTSTRAP, false, false));
+  try {
+    TreeTools::computeBootstrapValues(*tree, trees, false);
+    cerr << "Trees with other leaves were accepted." << endl;
+    return 1;
+  } catch (Exception& ex) {}
+  cout << "Consensus ok." << endl;
+
+  for (size_t i = 0; i < trees.size(); ++i)
+    delete trees[i];
+  return 0;
+}
@@ -0,0 +1,167 @@
+//
+// File: test_branch_mapping.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Mapping/PhyloBranchMapping.h>
+#include <Bpp/Phyl/Mapping/ProbabilisticSubstitutionMapping.h>
+#include <Bpp/Phyl/Mapping/SubstitutionMappingTools.h>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  try {
+    //Storage of a single branch:
+    PhyloBranchMapping branch(0.5);
+    branch.setNumberOfSitesAndTypes(3, 2);
+    for (size_t i = 0; i < 3; ++i)
+      for (size_t t = 0; t < 2; ++t)
+        branch(i, t) = static_cast<double>(10 * i + t);
+    if (branch.getCounts().size() != 6 || branch.getCounts()[2 * 2 + 1] != 21.) {
+      cerr << "Counts are not stored by site / type." << endl;
+      return 1;
+    }
+    SiteCounts view = branch.getSiteCount(1);
+    Vdouble copy = view;
+    if (view.size() != 2 || view[0] != 10. || view[1] != 11. || view.sum() != 21. || copy != Vdouble({10., 11.})) {
+      cerr << "Bad view on the counts of a site." << endl;
+      return 1;
+    }
+    cout << "Branch storage ok." << endl;
+
+    //Resizing keeps the existing values:
+    branch.setNumberOfSites(5);
+    branch.setNumberOfTypes(3);
+    for (size_t i = 0; i < 5; ++i) {
+      for (size_t t = 0; t < 3; ++t) {
+        double expected = (i < 3 && t < 2) ? static_cast<double>(10 * i + t) : 0.;
+        if (branch.getSiteTypeCount(i, t) != expected) {
+          cerr << "Resizing changed the count at site " << i << " and type " << t << "." << endl;
+          return 1;
+        }
+      }
+    }
+    branch.setNumberOfSitesAndTypes(2, 1);
+    if (branch.getCounts() != Vdouble({0., 10.})) {
+      cerr << "Shrinking did not keep the first counts." << endl;
+      return 1;
+    }
+    try {
+      branch.getSiteTypeCount(0, 1);
+      cerr << "Reading an unknown type should fail!" << endl;
+      return 1;
+    } catch (BadSizeException& ex) {}
+    try {
+      branch.setSiteTypeCount(2, 0, 1.);
+      cerr << "Writing at an unknown site should fail!" << endl;
+      return 1;
+    } catch (BadSizeException& ex) {}
+    PhyloBranchMapping branch2(branch);
+    branch2(1, 0) = 3.;
+    if (branch(1, 0) != 10.) {
+      cerr << "Copies share their counts." << endl;
+      return 1;
+    }
+    cout << "Branch resizing ok." << endl;
+
+    //Mapping with site patterns:
+    Newick reader;
+    unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("((A:0.1,B:0.2):0.3,C:0.4,D:0.5);", false, "", false, false));
+    vector<size_t> patterns = {0, 1, 0, 2};
+    ProbabilisticSubstitutionMapping counts(*tree, 2, patterns, 3);
+    ProbabilisticSubstitutionMapping factors(*tree, 2, patterns, 3);
+    vector<uint> ids = counts.getAllEdgesIndexes();
+    for (auto id : ids) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t t = 0; t < 2; ++t) {
+          counts(id, i, t) = static_cast<double>(100 * id + 10 * i + t);
+          factors(id, i, t) = static_cast<double>(t + 1);
+        }
+      }
+    }
+    for (auto id : ids) {
+      for (size_t k = 0; k < patterns.size(); ++k) {
+        SiteCounts c = counts.getSiteCounts(id, k);
+        if (c.size() != 2 || c[1] != counts.getCount(id, k, 1) || c[1] != static_cast<double>(100 * id + 10 * patterns[k] + 1)
+            || counts.getCounts(id, k) != Vdouble(c)) {
+          cerr << "Bad counts for branch " << id << " at site " << k << "." << endl;
+          return 1;
+        }
+      }
+    }
+
+    VVdouble perSite = SubstitutionMappingTools::getCountsPerSitePerBranch(counts, ids);
+    VVdouble perSiteFactors = SubstitutionMappingTools::getCountsPerSitePerBranch(counts, factors, ids);
+    if (perSite.size() != patterns.size())
+      return 1;
+    for (size_t k = 0; k < patterns.size(); ++k) {
+      for (size_t b = 0; b < ids.size(); ++b) {
+        double sum = static_cast<double>(2 * (100 * ids[b] + 10 * patterns[k]) + 1);
+        if (perSite[k][b] != sum || perSiteFactors[k][b] != sum / 3.) {
+          cerr << "Bad sum of counts for branch " << ids[b] << " at site " << k << "." << endl;
+          return 1;
+        }
+      }
+    }
+    cout << "Counts per site and branch ok." << endl;
+
+    //Normalization, on all branches but the first one:
+    vector<uint> normIds(ids.begin() + 1, ids.end());
+    unique_ptr<ProbabilisticSubstitutionMapping> normCounts(SubstitutionMappingTools::computeNormalizedCounts(&counts, &factors, normIds, false, 2));
+    for (auto id : ids) {
+      double length = counts.getEdge(id)->getLength();
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t t = 0; t < 2; ++t) {
+          double expected = (id == ids[0]) ? 0. : counts(id, i, t) / static_cast<double>(t + 1) * (length / 2.);
+          if ((*normCounts)(id, i, t) != expected) {
+            cerr << "Bad normalized count for branch " << id << ", site " << i << " and type " << t << "." << endl;
+            return 1;
+          }
+        }
+      }
+    }
+    cout << "Normalized counts ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
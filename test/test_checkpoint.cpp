@@ -0,0 +1,148 @@
+//
+// File: test_checkpoint.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <iostream>
+#include <sstream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+// Tells if the likelihood is computed, without computing it.
+class CheckedLikelihood :
+  public SingleProcessPhyloLikelihood
+{
+public:
+  CheckedLikelihood(SubstitutionProcess* process, LikelihoodTreeCalculation* tlComp) :
+    SingleProcessPhyloLikelihood(process, tlComp) {}
+
+  bool isComputed() const { return !computeLikelihoods_; }
+};
+
+VectorSiteContainer* getSites(const NucleicAlphabet* alphabet, size_t length)
+{
+  VectorSiteContainer* sites = new VectorSiteContainer(alphabet);
+  sites->addSequence(BasicSequence("A", string("ATCCAGACATGCCGGGACTTTGCAGAGAAGGAGTTGTTTCCCATTGCAGCCCAGGTGGATAAGGAACAGC").substr(0, length), alphabet));
+  sites->addSequence(BasicSequence("B", string("CGTCAGACATGCCGTGACTTTGCCGAGAAGGAGTTGGTCCCCATTGCGGCCCAGCTGGACAGGGAGCATC").substr(0, length), alphabet));
+  sites->addSequence(BasicSequence("C", string("GGTCAGACATGCCGGGAATTTGCTGAAAAGGAGCTGGTTCCCATTGCAGCCCAGGTAGACAAGGAGCATC").substr(0, length), alphabet));
+  sites->addSequence(BasicSequence("D", string("TTCCAGACATGCCGGGACTTTACCGAGAAGGAGTTGTTTTCCATTGCAGCCCAGGTGGATAAGGAACATC").substr(0, length), alphabet));
+  return sites;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("((A:0.01, B:0.02):0.03,C:0.01,D:0.1);", false, "", false, false));
+  ParametrizablePhyloTree pTree(*tree);
+  unique_ptr<VectorSiteContainer> sites(getSites(alphabet, 70));
+  unique_ptr<VectorSiteContainer> shortSites(getSites(alphabet, 20));
+  T92 model(alphabet, 3.);
+  GammaDiscreteRateDistribution rdist(4, 1.0);
+
+  unique_ptr<RateAcrossSitesSubstitutionProcess> process1(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist.clone(), pTree.clone()));
+  unique_ptr<RateAcrossSitesSubstitutionProcess> process2(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist.clone(), pTree.clone()));
+  unique_ptr<RateAcrossSitesSubstitutionProcess> process3(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist.clone(), pTree.clone()));
+  SingleProcessPhyloLikelihood lik1(process1.get(), new RecursiveLikelihoodTreeCalculation(*sites, process1.get(), false, false));
+  CheckedLikelihood lik2(process2.get(), new RecursiveLikelihoodTreeCalculation(*sites, process2.get(), false, false));
+  SingleProcessPhyloLikelihood lik3(process3.get(), new RecursiveLikelihoodTreeCalculation(*shortSites, process3.get(), false, false));
+
+  ParameterList pl;
+  pl.addParameter(Parameter("T92.kappa", 5.));
+  pl.addParameter(Parameter("BrLen1", 0.2));
+  lik1.matchParametersValues(pl);
+  double value = lik1.getValue();
+
+  //Save and restore, without computing the likelihood again:
+  stringstream checkpoint(ios::in | ios::out | ios::binary);
+  lik1.writeCheckpoint(checkpoint);
+  string saved = checkpoint.str();
+  lik2.readCheckpoint(checkpoint);
+  if (!lik2.isComputed()) {
+    cerr << "Restored likelihood is flagged for recomputation." << endl;
+    return 1;
+  }
+  if (lik2.getParameterValue("T92.kappa") != 5. || lik2.getParameterValue("BrLen1") != 0.2)
+    return 1;
+  if (lik2.getValue() != value) {
+    cerr << "Restored value " << lik2.getValue() << " differs from " << value << "." << endl;
+    return 1;
+  }
+  cout << "Restored value ok." << endl;
+
+  //The restored object keeps working:
+  ParameterList pl2;
+  pl2.addParameter(Parameter("BrLen0", 0.05));
+  lik1.matchParametersValues(pl2);
+  lik2.matchParametersValues(pl2);
+  if (lik2.isComputed())
+    return 1;
+  if (abs(lik2.getValue() - lik1.getValue()) > 1e-10)
+    return 1;
+  if (abs(lik2.getFirstOrderDerivative("BrLen2") - lik1.getFirstOrderDerivative("BrLen2")) > 1e-8)
+    return 1;
+  cout << "Update after restore ok." << endl;
+
+  //Checkpoints of other data are rejected:
+  try {
+    istringstream in(saved, ios::in | ios::binary);
+    lik3.readCheckpoint(in);
+    cerr << "Checkpoint of other data was accepted." << endl;
+    return 1;
+  } catch (IOException& ex) {}
+
+  //Truncated checkpoints are rejected:
+  try {
+    istringstream in(saved.substr(0, saved.size() / 2), ios::in | ios::binary);
+    lik2.readCheckpoint(in);
+    cerr << "Truncated checkpoint was accepted." << endl;
+    return 1;
+  } catch (IOException& ex) {}
+  cout << "Bad checkpoints ok." << endl;
+
+  return 0;
+}
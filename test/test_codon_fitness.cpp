@@ -0,0 +1,170 @@
+//
+// File: test_codon_fitness.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/CodonFrequenciesSet.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/ProteinFrequenciesSet.h>
+#include <Bpp/Phyl/Model/Codon/AbstractCodonFitnessSubstitutionModel.h>
+#include <Bpp/Phyl/Model/Codon/AbstractCodonAAFitnessSubstitutionModel.h>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+// The factor of a substitution from fitness phiI to fitness phiJ, as
+// computed for each pair before the factors were tabulated. Close
+// fitnesses are compared with the first order expansion 1 + S / 2.
+bool checkFactor(double mu, double phiI, double phiJ, double ns)
+{
+  double expected;
+  if (phiI == phiJ || ns == 0)
+    expected = 1;
+  else if (phiI == 0)
+    expected = 100;
+  else if (phiJ == 0)
+    expected = 0;
+  else
+  {
+    double x = pow(phiI / phiJ, ns);
+    if (abs(x - 1) < 1e-6)
+      expected = 1 - log(x) / 2;
+    else
+      expected = -log(x) / (1 - x);
+  }
+  if (abs(mu - expected) > 1e-9 * max(1., expected))
+  {
+    cerr << "Factor " << mu << " instead of " << expected << " for fitnesses " << phiI << " and " << phiJ << ", Ns = " << ns << endl;
+    return false;
+  }
+  return true;
+}
+
+bool checkCodonModel(const AbstractCodonFitnessSubstitutionModel& model)
+{
+  const Vdouble& phi = model.getFitness()->getFrequencies();
+  for (size_t i = 0; i < phi.size(); ++i)
+    for (size_t j = 0; j < phi.size(); ++j)
+      if (!checkFactor(model.getCodonsMulRate(i, j), phi[i], phi[j], 1))
+        return false;
+  return true;
+}
+
+bool checkAAModel(const AbstractCodonAAFitnessSubstitutionModel& model, const GeneticCode& gc, double ns)
+{
+  const Vdouble& phi = model.getAAFitness().getFrequencies();
+  size_t nbCodons = gc.getSourceAlphabet()->getSize();
+  for (size_t i = 0; i < nbCodons; ++i)
+    for (size_t j = 0; j < nbCodons; ++j)
+    {
+      int ci = static_cast<int>(i);
+      int cj = static_cast<int>(j);
+      if (gc.isStop(ci) || gc.isStop(cj))
+      {
+        try {
+          model.getCodonsMulRate(i, j);
+          cerr << "No error for a stop codon." << endl;
+          return false;
+        } catch (Exception& ex) {}
+        continue;
+      }
+      if (!checkFactor(model.getCodonsMulRate(i, j), phi[static_cast<size_t>(gc.translate(ci))], phi[static_cast<size_t>(gc.translate(cj))], ns))
+        return false;
+    }
+  return true;
+}
+
+int main() {
+  try {
+    StandardGeneticCode gc(&AlphabetTools::DNA_ALPHABET);
+    const Alphabet* codonAlphabet = gc.getSourceAlphabet();
+
+    //Codon fitnesses, two of them being very close:
+    AbstractCodonFitnessSubstitutionModel codonModel(new FullCodonFrequenciesSet(&gc), &gc, "");
+    if (!checkCodonModel(codonModel))
+      return 1;
+    map<int, double> codonFitnesses;
+    for (int c = 0; c < static_cast<int>(codonAlphabet->getSize()); ++c)
+      if (!gc.isStop(c))
+        codonFitnesses[c] = 0.1 + RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+    codonFitnesses[1] = codonFitnesses[0] * (1. + 1e-9);
+    codonModel.setFreq(codonFitnesses);
+    if (!checkCodonModel(codonModel))
+      return 1;
+
+    //Parameter changes, and copies:
+    ParameterList parameters = codonModel.getParameters();
+    parameters[0].setValue(0.4);
+    codonModel.matchParametersValues(parameters);
+    unique_ptr<AbstractCodonFitnessSubstitutionModel> codonCopy(codonModel.clone());
+    if (!checkCodonModel(codonModel) || !checkCodonModel(*codonCopy))
+      return 1;
+    cout << "Codon fitnesses ok." << endl;
+
+    //Amino acid fitnesses, with Ns:
+    AbstractCodonAAFitnessSubstitutionModel aaModel(new FullProteinFrequenciesSet(&AlphabetTools::PROTEIN_ALPHABET), &gc, "");
+    if (!checkAAModel(aaModel, gc, 1))
+      return 1;
+    map<int, double> aaFitnesses;
+    for (int a = 0; a < 20; ++a)
+      aaFitnesses[a] = 0.1 + RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+    aaModel.setFreq(aaFitnesses);
+    if (!checkAAModel(aaModel, gc, 1))
+      return 1;
+    aaModel.addNsParameter();
+    aaModel.setParameterValue("Ns", 2.5);
+    if (!checkAAModel(aaModel, gc, 2.5))
+      return 1;
+    unique_ptr<AbstractCodonAAFitnessSubstitutionModel> aaCopy(aaModel.clone());
+    AbstractCodonAAFitnessSubstitutionModel aaAssigned(new FullProteinFrequenciesSet(&AlphabetTools::PROTEIN_ALPHABET), &gc, "");
+    aaAssigned = aaModel;
+    if (!checkAAModel(*aaCopy, gc, 2.5) || !checkAAModel(aaAssigned, gc, 2.5))
+      return 1;
+    cout << "Amino acid fitnesses ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
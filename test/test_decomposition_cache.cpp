@@ -0,0 +1,159 @@
+//
+// File: test_decomposition_cache.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/DNA.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Mapping/SubstitutionRegister.h>
+#include <Bpp/Phyl/Mapping/DecompositionSubstitutionCount.h>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+//Gives access to the expectations:
+class TestedCount :
+  public DecompositionSubstitutionCount
+{
+  public:
+    TestedCount(const SubstitutionModel* model) :
+      DecompositionSubstitutionCount(model, new ComprehensiveSubstitutionRegister(model->getStateMap())) {}
+
+    using DecompositionMethods::computeExpectations;
+};
+
+bool sameExpectations(const vector< RowMatrix<double> >& m1, const vector< RowMatrix<double> >& m2) {
+  if (m1.size() != m2.size())
+    return false;
+  for (size_t t = 0; t < m1.size(); ++t)
+    for (size_t i = 0; i < m1[t].getNumberOfRows(); ++i)
+      for (size_t j = 0; j < m1[t].getNumberOfColumns(); ++j)
+        if (m1[t](i, j) != m2[t](i, j))
+          return false;
+  return true;
+}
+
+//Compare with the expectations computed by a count with an empty cache:
+bool checkExpectations(const TestedCount& count, const SubstitutionModel& model, double length) {
+  vector< RowMatrix<double> > cached, fresh;
+  count.computeExpectations(cached, length);
+  TestedCount(&model).computeExpectations(fresh, length);
+  if (!sameExpectations(cached, fresh)) {
+    cerr << "Cached expectations differ from fresh ones for length " << length << "." << endl;
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  try {
+    DNA alphabet;
+    GTR model(&alphabet, 1, 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2);
+    TestedCount count(&model);
+
+    //More lengths than the cache holds, queried in several orders, so
+    //that entries are both reused and discarded:
+    vector<double> lengths;
+    for (size_t k = 0; k < 40; ++k)
+      lengths.push_back(0.013 * static_cast<double>(k + 1));
+    for (size_t r = 0; r < 3; ++r)
+      for (size_t k = 0; k < lengths.size(); ++k)
+        if (!checkExpectations(count, model, lengths[(k * 7 + r * 13) % lengths.size()]))
+          return 1;
+    cout << "Cached expectations ok." << endl;
+
+    //Batched computation, with repeated lengths:
+    vector<double> batch = {0.1, 0.2, 0.1, 0.013, 0.5, 0.2, 0.1};
+    vector< vector< RowMatrix<double> > > batchExpectations;
+    count.computeExpectations(batch, batchExpectations);
+    if (batchExpectations.size() != batch.size())
+      return 1;
+    for (size_t l = 0; l < batch.size(); ++l) {
+      vector< RowMatrix<double> > fresh;
+      TestedCount(&model).computeExpectations(fresh, batch[l]);
+      if (!sameExpectations(batchExpectations[l], fresh)) {
+        cerr << "Batched expectations differ for length " << batch[l] << "." << endl;
+        return 1;
+      }
+    }
+    cout << "Batched expectations ok." << endl;
+
+    //The cache must not survive a change of the model, with the same
+    //or another object:
+    vector< RowMatrix<double> > before;
+    count.computeExpectations(before, 0.1);
+    model.setParameterValue("GTR.a", 2.);
+    count.setSubstitutionModel(&model);
+    vector< RowMatrix<double> > after;
+    count.computeExpectations(after, 0.1);
+    if (sameExpectations(before, after)) {
+      cerr << "Expectations did not change with the model." << endl;
+      return 1;
+    }
+    for (size_t l = 0; l < batch.size(); ++l)
+      if (!checkExpectations(count, model, batch[l]))
+        return 1;
+
+    GTR model2(&alphabet, 3, 0.5, 0.3, 0.4, 0.4, 0.4, 0.1, 0.1, 0.4);
+    count.setSubstitutionModel(&model2);
+    for (size_t l = 0; l < batch.size(); ++l)
+      if (!checkExpectations(count, model2, batch[l]))
+        return 1;
+
+    //The counts themselves:
+    for (size_t l = 0; l < batch.size(); ++l) {
+      TestedCount fresh(&model2);
+      for (size_t t = 1; t <= count.getNumberOfSubstitutionTypes(); ++t) {
+        unique_ptr< Matrix<double> > m1(count.getAllNumbersOfSubstitutions(batch[l], t));
+        unique_ptr< Matrix<double> > m2(fresh.getAllNumbersOfSubstitutions(batch[l], t));
+        for (size_t i = 0; i < m1->getNumberOfRows(); ++i)
+          for (size_t j = 0; j < m1->getNumberOfColumns(); ++j)
+            if ((*m1)(i, j) != (*m2)(i, j)) {
+              cerr << "Counts differ for length " << batch[l] << " and type " << t << "." << endl;
+              return 1;
+            }
+      }
+    }
+    cout << "Cache reset on model change ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,218 @@
+//
+// File: test_distance_closed_form.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Model/Nucleotide/JCnuc.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Model/Nucleotide/TN93.h>
+#include <Bpp/Phyl/Model/RateDistribution/ConstantRateDistribution.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Distance/DistanceEstimation.h>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+// Proportions of purine transitions, pyrimidine transitions and transversions,
+// counted site by site on the sites where both sequences are resolved.
+void countDifferences(const string& s1, const string& s2, double& p1, double& p2, double& q)
+{
+  const string states = "ACGT";
+  double nbSites = 0, nbP1 = 0, nbP2 = 0, nbQ = 0;
+  for (size_t i = 0; i < s1.size(); ++i)
+  {
+    size_t x = states.find(s1[i]);
+    size_t y = states.find(s2[i]);
+    if (x == string::npos || y == string::npos)
+      continue;
+    nbSites++;
+    bool purineX = (x == 0 || x == 2);
+    bool purineY = (y == 0 || y == 2);
+    if (x == y)
+      continue;
+    if (purineX != purineY)
+      nbQ++;
+    else if (purineX)
+      nbP1++;
+    else
+      nbP2++;
+  }
+  p1 = nbP1 / nbSites;
+  p2 = nbP2 / nbSites;
+  q = nbQ / nbSites;
+}
+
+// -log(x), or alpha (x^{-1/alpha} - 1) with gamma rates.
+double f(double x, double alpha)
+{
+  return alpha > 0 ? alpha * (pow(x, -1. / alpha) - 1.) : -log(x);
+}
+
+double tamuraNei(const string& s1, const string& s2, double piA, double piC, double piG, double piT, double alpha)
+{
+  double p1, p2, q;
+  countDifferences(s1, s2, p1, p2, q);
+  double piR = piA + piG, piY = piC + piT;
+  return 2. * piA * piG / piR * f(1. - piR * p1 / (2. * piA * piG) - q / (2. * piR), alpha)
+       + 2. * piC * piT / piY * f(1. - piY * p2 / (2. * piC * piT) - q / (2. * piY), alpha)
+       + 2. * (piR * piY - piA * piG * piY / piR - piC * piT * piR / piY) * f(1. - q / (2. * piR * piY), alpha);
+}
+
+double kimura(const string& s1, const string& s2)
+{
+  double p1, p2, q;
+  countDifferences(s1, s2, p1, p2, q);
+  return 0.5 * f(1. - 2. * (p1 + p2) - q, 0) + 0.25 * f(1. - 2. * q, 0);
+}
+
+unique_ptr<DistanceMatrix> computeMatrix(const TransitionModel& model, const DiscreteDistribution& rateDist, const SiteContainer& sites, bool closedForm, size_t nbThreads)
+{
+  DistanceEstimation estimation(model.clone(), rateDist.clone(), &sites, 0, false);
+  estimation.setClosedFormDistances(closedForm);
+  estimation.setNumberOfThreads(nbThreads);
+  estimation.computeMatrix();
+  return unique_ptr<DistanceMatrix>(estimation.getMatrix());
+}
+
+int main() {
+  try {
+    const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+    const string states = "ACGT";
+
+    //Sequences derived from a random one, with increasing divergence, gaps and unknown
+    //characters, over more than two words of 64 sites. The last one is random (too divergent
+    //for the formulas) and the one before has a partially ambiguous character.
+    size_t nbSites = 150;
+    string ref(nbSites, 'A');
+    for (size_t i = 0; i < nbSites; ++i)
+      ref[i] = states[RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(4)];
+    vector<string> seqs;
+    double divergences[] = {0., 0.05, 0.1, 0.2, 0.3};
+    for (double p : divergences)
+    {
+      string s = ref;
+      for (size_t i = 0; i < nbSites; ++i)
+        if (RandomTools::giveRandomNumberBetweenZeroAndEntry(1.) < p)
+          s[i] = states[RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(4)];
+      s[seqs.size() * 7] = '-';
+      s[seqs.size() * 13 + 70] = 'N';
+      seqs.push_back(s);
+    }
+    seqs.push_back(seqs[1]);
+    seqs.back()[100] = 'R';
+    string random(nbSites, 'A');
+    for (size_t i = 0; i < nbSites; ++i)
+    {
+      // A state different from the one of all other sequences, when there is one:
+      random[i] = states[(states.find(ref[i]) + 1) % 4];
+      for (size_t x = 0; x < 4; ++x)
+      {
+        bool found = false;
+        for (size_t k = 0; k < seqs.size(); ++k)
+          found = found || (seqs[k][i] == states[x]);
+        if (!found)
+          random[i] = states[x];
+      }
+    }
+    seqs.push_back(random);
+    size_t n = seqs.size();
+    size_t nbClosedForm = n - 2;
+
+    VectorSiteContainer sites(alphabet);
+    for (size_t i = 0; i < n; ++i)
+      sites.addSequence(BasicSequence("seq" + TextTools::toString(i), seqs[i], alphabet));
+
+    ConstantRateDistribution constant;
+    GammaDiscreteRateDistribution gamma(4, 0.7);
+    K80 k80(alphabet, 2.);
+    TN93 tn93(alphabet, 2., 3., 0.3, 0.2, 0.15, 0.35);
+    JCnuc jc(alphabet);
+
+    //The formulas, with counts computed site by site:
+    unique_ptr<DistanceMatrix> dK80 = computeMatrix(k80, constant, sites, true, 1);
+    unique_ptr<DistanceMatrix> dTN93 = computeMatrix(tn93, gamma, sites, true, 1);
+    for (size_t i = 0; i < nbClosedForm; ++i)
+      for (size_t j = i + 1; j < nbClosedForm; ++j)
+      {
+        double eK80 = max(kimura(seqs[i], seqs[j]), 0.000001);
+        double eTN93 = max(tamuraNei(seqs[i], seqs[j], 0.3, 0.2, 0.15, 0.35, 0.7), 0.000001);
+        if (abs((*dK80)(i, j) - eK80) > 1e-12 || abs((*dTN93)(i, j) - eTN93) > 1e-12)
+        {
+          cerr << "Pair " << i << ", " << j << ": " << (*dK80)(i, j) << " and " << (*dTN93)(i, j)
+               << " instead of " << eK80 << " and " << eTN93 << endl;
+          return 1;
+        }
+      }
+    cout << "Closed forms ok." << endl;
+
+    //For JC with constant rates, the closed form is the maximum likelihood estimate. Pairs with
+    //an ambiguous character or too divergent ones are estimated by maximum likelihood:
+    unique_ptr<DistanceMatrix> dJC = computeMatrix(jc, constant, sites, true, 1);
+    unique_ptr<DistanceMatrix> dJCML = computeMatrix(jc, constant, sites, false, 1);
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = i + 1; j < n; ++j)
+        if (abs((*dJC)(i, j) - (*dJCML)(i, j)) > 1e-3 * max(1., (*dJCML)(i, j)))
+        {
+          cerr << "JC, pair " << i << ", " << j << ": " << (*dJC)(i, j) << " instead of " << (*dJCML)(i, j) << endl;
+          return 1;
+        }
+    cout << "Maximum likelihood ok." << endl;
+
+    //Threads:
+    unique_ptr<DistanceMatrix> dTN93Threads = computeMatrix(tn93, gamma, sites, true, 4);
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = i + 1; j < n; ++j)
+        if ((*dTN93Threads)(i, j) != (*dTN93)(i, j) && (i < nbClosedForm && j < nbClosedForm))
+        {
+          cerr << "Pair " << i << ", " << j << " depends on the number of threads." << endl;
+          return 1;
+        }
+    cout << "Threads ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,178 @@
+//
+// File: test_distance_matrix_io.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Io/IoDistanceMatrixFactory.h>
+#include <Bpp/Phyl/Io/PhylipDistanceMatrixFormat.h>
+#include <Bpp/Phyl/Io/BinaryDistanceMatrixFormat.h>
+#include <Bpp/Seq/DistanceMatrix.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool sameMatrices(const DistanceMatrix& m1, const DistanceMatrix& m2, double tolerance) {
+  if (m1.size() != m2.size()) {
+    cerr << "Matrices have different sizes: " << m1.size() << " vs " << m2.size() << "." << endl;
+    return false;
+  }
+  for (size_t i = 0; i < m1.size(); ++i) {
+    //Phylip pads names to 10 characters:
+    if (TextTools::removeSurroundingWhiteSpaces(m1.getName(i)) != TextTools::removeSurroundingWhiteSpaces(m2.getName(i))) {
+      cerr << "Name " << i << " differs: '" << m1.getName(i) << "' vs '" << m2.getName(i) << "'." << endl;
+      return false;
+    }
+    for (size_t j = 0; j < m1.size(); ++j) {
+      if (abs(m1(i, j) - m2(i, j)) > tolerance * max(1., abs(m1(i, j)))) {
+        cerr << "Value (" << i << ", " << j << ") differs: " << m1(i, j) << " vs " << m2(i, j) << "." << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+  try {
+    size_t n = 12;
+    DistanceMatrix dist(n);
+    for (size_t i = 0; i < n; ++i) {
+      dist.setName(i, "seq" + TextTools::toString(i));
+      for (size_t j = 0; j < i; ++j) {
+        double d = RandomTools::giveRandomNumberBetweenZeroAndEntry(2.);
+        dist(i, j) = dist(j, i) = d;
+      }
+    }
+    dist(1, 2) = dist(2, 1) = 1.e-12;
+    dist(3, 4) = dist(4, 3) = 12345.678;
+
+    //Phylip, with names of at most 10 characters:
+    PhylipDistanceMatrixFormat phylip(false);
+    stringstream ss1;
+    phylip.write(dist, ss1);
+    unique_ptr<DistanceMatrix> dist1(phylip.read(ss1));
+    if (!sameMatrices(dist, *dist1, 1.e-7)) {
+      cerr << "Phylip round trip failed:" << endl << ss1.str() << endl;
+      return 1;
+    }
+    cout << "Phylip round trip ok." << endl;
+
+    //Extended Phylip, with long names:
+    DistanceMatrix distExt(dist);
+    for (size_t i = 0; i < n; ++i)
+      distExt.setName(i, "a_long_sequence_name_" + TextTools::toString(i));
+    PhylipDistanceMatrixFormat phylipExt(true);
+    stringstream ss2;
+    phylipExt.write(distExt, ss2);
+    unique_ptr<DistanceMatrix> dist2(phylipExt.read(ss2));
+    if (!sameMatrices(distExt, *dist2, 1.e-7)) {
+      cerr << "Extended Phylip round trip failed:" << endl << ss2.str() << endl;
+      return 1;
+    }
+    cout << "Extended Phylip round trip ok." << endl;
+
+    //Rows split over several lines, with Windows line breaks:
+    istringstream ss3("   3\r\nA          0 1.5\r\n 2\r\nB          1.5 0 3\r\nC          2 3\r\n0\r\n");
+    unique_ptr<DistanceMatrix> dist3(phylip.read(ss3));
+    if (dist3->size() != 3 || TextTools::removeSurroundingWhiteSpaces(dist3->getName(2)) != "C" || (*dist3)(0, 2) != 2. || (*dist3)(1, 2) != 3. || (*dist3)(2, 2) != 0.) {
+      cerr << "Phylip reading of rows split over several lines failed." << endl;
+      return 1;
+    }
+    cout << "Phylip split rows ok." << endl;
+
+    //Malformed value:
+    istringstream ss4("   2\nA          0 x\nB          1 0\n");
+    try {
+      unique_ptr<DistanceMatrix> dist4(phylip.read(ss4));
+      cerr << "Reading a malformed value should fail!" << endl;
+      return 1;
+    } catch (IOException& ex) {
+      cout << "Ok, reading a malformed value throws an exception: " << ex.what() << endl;
+    }
+
+    //Binary, which is exact:
+    BinaryDistanceMatrixFormat binary;
+    stringstream ss5(ios::in | ios::out | ios::binary);
+    binary.write(distExt, ss5);
+    binary.write(dist, ss5);
+    unique_ptr<DistanceMatrix> dist5(binary.read(ss5));
+    unique_ptr<DistanceMatrix> dist6(binary.read(ss5));
+    if (!sameMatrices(distExt, *dist5, 0.) || !sameMatrices(dist, *dist6, 0.)) {
+      cerr << "Binary round trip failed." << endl;
+      return 1;
+    }
+    cout << "Binary round trip ok." << endl;
+
+    //Not a binary matrix:
+    stringstream ss7(ios::in | ios::out | ios::binary);
+    phylip.write(dist, ss7);
+    try {
+      unique_ptr<DistanceMatrix> dist7(binary.read(ss7));
+      cerr << "Reading a Phylip matrix as binary should fail!" << endl;
+      return 1;
+    } catch (IOException& ex) {
+      cout << "Ok, reading a Phylip matrix as binary throws an exception." << endl;
+    }
+
+    //Factory:
+    IODistanceMatrixFactory factory;
+    unique_ptr<IDistanceMatrix> reader(factory.createReader(IODistanceMatrixFactory::BINARY_FORMAT));
+    unique_ptr<ODistanceMatrix> writer(factory.createWriter(IODistanceMatrixFactory::BINARY_FORMAT));
+    if (reader->getFormatName() != "Binary" || writer->getFormatName() != "Binary") {
+      cerr << "Factory did not create binary reader and writer." << endl;
+      return 1;
+    }
+    stringstream ss8(ios::in | ios::out | ios::binary);
+    writer->write(dist, ss8);
+    unique_ptr<DistanceMatrix> dist8(reader->read(ss8));
+    if (!sameMatrices(dist, *dist8, 0.)) {
+      cerr << "Binary round trip through the factory failed." << endl;
+      return 1;
+    }
+    cout << "Factory ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,136 @@
+//
+// File: test_distance_threads.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/RateDistribution/ConstantRateDistribution.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Distance/DistanceEstimation.h>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+// Distances estimated by maximum likelihood, possibly with an additional
+// parameter, on a given number of threads. The parameters of the model of
+// the estimation must not change when pairs are computed concurrently.
+unique_ptr<DistanceMatrix> computeMatrix(const TransitionModel& model, const DiscreteDistribution& rateDist, const SiteContainer& sites, const string& parameter, size_t nbThreads)
+{
+  DistanceEstimation estimation(model.clone(), rateDist.clone(), &sites, 0, false);
+  if (!parameter.empty())
+  {
+    ParameterList pl;
+    pl.addParameter(estimation.getModel().getParameter(parameter));
+    estimation.setAdditionalParameters(pl);
+  }
+  estimation.setNumberOfThreads(nbThreads);
+  estimation.computeMatrix();
+  if (parameter.empty())
+  {
+    ParameterList pl = model.getParameters();
+    for (size_t k = 0; k < pl.size(); ++k)
+      if (estimation.getModel().getParameterValue(pl[k].getName()) != pl[k].getValue())
+        throw Exception("Parameter " + pl[k].getName() + " changed by the estimation of distances.");
+  }
+  return unique_ptr<DistanceMatrix>(estimation.getMatrix());
+}
+
+int main() {
+  try {
+    const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+    const string states = "ACGT";
+
+    //Sequences derived from a random one, with increasing divergence and a few gaps:
+    size_t nbSites = 120;
+    string ref(nbSites, 'A');
+    for (size_t i = 0; i < nbSites; ++i)
+      ref[i] = states[RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(4)];
+    VectorSiteContainer sites(alphabet);
+    for (size_t k = 0; k < 8; ++k)
+    {
+      string s = ref;
+      for (size_t i = 0; i < nbSites; ++i)
+        if (RandomTools::giveRandomNumberBetweenZeroAndEntry(1.) < 0.05 * static_cast<double>(k))
+          s[i] = states[RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(4)];
+      s[k * 11] = '-';
+      sites.addSequence(BasicSequence("seq" + TextTools::toString(k), s, alphabet));
+    }
+    size_t n = sites.getNumberOfSequences();
+
+    ConstantRateDistribution constant;
+    GammaDiscreteRateDistribution gamma(4, 0.7);
+    T92 t92(alphabet, 3., 0.6);
+    GTR gtr(alphabet, 1., 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2);
+
+    // Each pair starts from the same point whatever the number of threads,
+    // with fewer threads than pairs, and more:
+    vector<string> names = { "T92 with gamma rates", "GTR", "T92 with its kappa estimated" };
+    for (size_t m = 0; m < names.size(); ++m)
+    {
+      const TransitionModel& model = (m == 1 ? static_cast<const TransitionModel&>(gtr) : t92);
+      const DiscreteDistribution& rateDist = (m == 0 ? static_cast<const DiscreteDistribution&>(gamma) : constant);
+      string parameter = (m == 2 ? "T92.kappa" : "");
+      unique_ptr<DistanceMatrix> serial = computeMatrix(model, rateDist, sites, parameter, 1);
+      for (size_t nbThreads : { 2, 3, 40 })
+      {
+        unique_ptr<DistanceMatrix> threaded = computeMatrix(model, rateDist, sites, parameter, nbThreads);
+        for (size_t i = 0; i < n; ++i)
+          for (size_t j = 0; j < n; ++j)
+            if ((*threaded)(i, j) != (*serial)(i, j))
+            {
+              cerr << names[m] << ", pair " << i << ", " << j << " with " << nbThreads << " threads: "
+                   << (*threaded)(i, j) << " instead of " << (*serial)(i, j) << endl;
+              return 1;
+            }
+      }
+      cout << names[m] << " ok." << endl;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
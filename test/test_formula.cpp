@@ -0,0 +1,168 @@
+//
+// File: test_formula.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/SimpleSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/FormulaOfPhyloLikelihood.h>
+#include <functional>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+// A value with its first and second order derivatives, to compute the expected results.
+struct Dual
+{
+  double v, d, d2;
+  Dual(double value = 0, double d1 = 0, double d2nd = 0) : v(value), d(d1), d2(d2nd) {}
+};
+
+Dual operator+(const Dual& a, const Dual& b) { return Dual(a.v + b.v, a.d + b.d, a.d2 + b.d2); }
+Dual operator-(const Dual& a, const Dual& b) { return Dual(a.v - b.v, a.d - b.d, a.d2 - b.d2); }
+Dual operator-(const Dual& a) { return Dual(-a.v, -a.d, -a.d2); }
+Dual operator*(const Dual& a, const Dual& b) { return Dual(a.v * b.v, a.d * b.v + a.v * b.d, a.d2 * b.v + 2 * a.d * b.d + a.v * b.d2); }
+Dual exp(const Dual& a) { double e = exp(a.v); return Dual(e, e * a.d, e * (a.d2 + a.d * a.d)); }
+Dual log(const Dual& a) { return Dual(log(a.v), a.d / a.v, a.d2 / a.v - a.d * a.d / (a.v * a.v)); }
+Dual inverse(const Dual& a) { return Dual(1. / a.v, -a.d / (a.v * a.v), -a.d2 / (a.v * a.v) + 2 * a.d * a.d / (a.v * a.v * a.v)); }
+Dual operator/(const Dual& a, const Dual& b) { return a * inverse(b); }
+// For positive bases:
+Dual pow(const Dual& a, const Dual& b) { return exp(b * log(a)); }
+
+// Two genes, sharing the parameters of their tree and model.
+void fillContainer(PhyloLikelihoodContainer& pc)
+{
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("((A:0.1,B:0.2):0.05,C:0.3,D:0.1);"));
+  vector< vector<string> > genes = {
+    {"GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATG", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAAC",
+     "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAG", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGA"},
+    {"ATGTCATTTCTGAATTATTATA", "CAAGTAATATGTTTTAAGAATT", "AACTAACATATATATTATGAAT", "AAATCATTTATGTGAAGGCAAT"}
+  };
+  vector<string> names = {"A", "B", "C", "D"};
+  for (size_t g = 0; g < genes.size(); g++)
+  {
+    VectorSiteContainer sites(alphabet);
+    for (size_t i = 0; i < names.size(); i++)
+      sites.addSequence(BasicSequence(names[i], genes[g][i], alphabet));
+    SubstitutionProcess* process = new SimpleSubstitutionProcess(new T92(alphabet, 3., 0.5), new ParametrizablePhyloTree(*tree));
+    RecursiveLikelihoodTreeCalculation* calc = new RecursiveLikelihoodTreeCalculation(sites, process, true, true);
+    pc.addPhyloLikelihood(g + 1, new SingleProcessPhyloLikelihood(process, calc));
+  }
+}
+
+bool isClose(double a, double b)
+{
+  return abs(a - b) <= 1e-9 * max(1., abs(b));
+}
+
+int main() {
+  PhyloLikelihoodContainer pc;
+  fillContainer(pc);
+  const AbstractPhyloLikelihood* m1 = dynamic_cast<const AbstractPhyloLikelihood*>(pc[1]);
+  const AbstractPhyloLikelihood* m2 = dynamic_cast<const AbstractPhyloLikelihood*>(pc[2]);
+  const string variable = "BrLen0";
+
+  //Formulas and the functions they should compute, checking precedence and associativity:
+  vector< pair<string, function<Dual(const Dual&, const Dual&)> > > formulas = {
+    { "phylo1 + 2 * phylo2", [](const Dual& x, const Dual& y) { return x + Dual(2) * y; } },
+    { "phylo1 - phylo2 - 3", [](const Dual& x, const Dual& y) { return (x - y) - Dual(3); } },
+    { "phylo1 / phylo2 * 4", [](const Dual& x, const Dual& y) { return (x / y) * Dual(4); } },
+    { "-phylo1^2 / 100", [](const Dual& x, const Dual& y) { return -pow(x, Dual(2)) / Dual(100); } },
+    { "2^3^2 + phylo1", [](const Dual& x, const Dual& y) { return Dual(512) + x; } },
+    { "2^-1 * phylo2", [](const Dual& x, const Dual& y) { return Dual(0.5) * y; } },
+    { "exp(phylo1 / 100) * log(phylo2)", [](const Dual& x, const Dual& y) { return exp(x / Dual(100)) * log(y); } },
+    { "phylo1 ^ (phylo2 / 100)", [](const Dual& x, const Dual& y) { return pow(x, y / Dual(100)); } },
+    { " ( phylo1 + phylo2 ) * .5 ", [](const Dual& x, const Dual& y) { return (x + y) * Dual(0.5); } }
+  };
+  for (size_t i = 0; i < formulas.size(); ++i)
+  {
+    FormulaOfPhyloLikelihood formula(&pc, formulas[i].first);
+    double value = formula.getValue();
+    double d1 = formula.getFirstOrderDerivative(variable);
+    double d2 = formula.getSecondOrderDerivative(variable);
+    Dual v1(m1->getValue(), m1->getFirstOrderDerivative(variable), m1->getSecondOrderDerivative(variable));
+    Dual v2(m2->getValue(), m2->getFirstOrderDerivative(variable), m2->getSecondOrderDerivative(variable));
+    Dual expected = formulas[i].second(v1, v2);
+    if (!isClose(value, expected.v) || !isClose(d1, expected.d) || !isClose(d2, expected.d2))
+    {
+      cerr << formulas[i].first << ": " << value << ", " << d1 << ", " << d2 << " instead of "
+           << expected.v << ", " << expected.d << ", " << expected.d2 << endl;
+      return 1;
+    }
+  }
+  cout << "Values and derivatives ok." << endl;
+
+  //Syntax errors:
+  vector<string> bad = { "phylo1 +", "(phylo1 + phylo2", "phylo1 phylo2", "foo(phylo1)", "phylo1 + )" };
+  for (size_t i = 0; i < bad.size(); ++i)
+  {
+    try {
+      FormulaOfPhyloLikelihood formula(&pc, bad[i]);
+      cerr << "No error for " << bad[i] << endl;
+      return 1;
+    } catch (Exception& ex) {}
+  }
+  cout << "Syntax errors ok." << endl;
+
+  //Copies and assignment take the formula of their source:
+  FormulaOfPhyloLikelihood f1(&pc, "phylo1 + 2 * phylo2");
+  FormulaOfPhyloLikelihood f2(&pc, "phylo1");
+  f2 = f1;
+  if (f2.output() != f1.output() || !isClose(f2.getValue(), f1.getValue()))
+    return 1;
+  FormulaOfPhyloLikelihood f3(f1);
+  if (f3.output() != f1.output() || !isClose(f3.getValue(), f1.getValue()))
+    return 1;
+  FormulaOfPhyloLikelihood empty(&pc);
+  FormulaOfPhyloLikelihood emptyCopy(empty);
+  f3 = empty;
+  if (f3.output() != "")
+    return 1;
+  cout << "Copies ok." << endl;
+
+  return 0;
+}
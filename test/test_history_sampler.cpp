@@ -0,0 +1,118 @@
+//
+// File: test_history_sampler.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Mapping/UniformizationHistorySampler.h>
+#include <Bpp/Phyl/Simulation/CounterBasedRandomStream.h>
+#include <cmath>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+// Expected number of substitutions on a branch of length t, given its end states a and b:
+// sum over i != j of Q(i, j) int_0^t P(a, i; s) P(j, b; t - s) ds / P(a, b; t),
+// the integral being computed with Simpson's rule.
+double getExpectedCount(const SubstitutionModel& model, size_t a, size_t b, double t)
+{
+  const Matrix<double>& q = model.getGenerator();
+  size_t n = model.getNumberOfStates();
+  size_t nbSteps = 400;
+  double h = t / static_cast<double>(nbSteps);
+  double integral = 0;
+  for (size_t k = 0; k <= nbSteps; ++k)
+  {
+    double s = h * static_cast<double>(k);
+    RowMatrix<double> p1 = model.getPij_t(s);
+    RowMatrix<double> p2 = model.getPij_t(t - s);
+    double f = 0;
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < n; ++j)
+        if (i != j)
+          f += p1(a, i) * q(i, j) * p2(j, b);
+    integral += f * ((k == 0 || k == nbSteps) ? 1. : (k % 2 == 1 ? 4. : 2.));
+  }
+  integral *= h / 3.;
+  return integral / model.getPij_t(t)(a, b);
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  T92 model(alphabet, 3., 0.65);
+  UniformizationHistorySampler sampler(&model);
+
+  double lengths[] = { 0.1, 0.5, 2. };
+  size_t ends[][2] = { { 0, 0 }, { 0, 2 }, { 1, 3 }, { 3, 3 } };
+  size_t nbReplicates = 20000;
+  uint64_t stream = 0;
+  for (size_t l = 0; l < 3; ++l)
+  {
+    for (size_t e = 0; e < 4; ++e)
+    {
+      size_t a = ends[e][0], b = ends[e][1];
+      double t = lengths[l];
+      CounterBasedRandomStream random(12345, stream++);
+      double sum = 0, sum2 = 0;
+      for (size_t r = 0; r < nbReplicates; ++r)
+      {
+        MutationPath path = sampler.sample(a, b, t, random);
+        if (path.getInitialState() != a || path.getFinalState() != b || path.getTotalTime() != t)
+          return 1;
+        //Virtual jumps are dropped:
+        RowMatrix<double> counts(4, 4);
+        path.getEventCounts(counts);
+        for (size_t k = 0; k < 4; ++k)
+          if (counts(k, k) != 0)
+            return 1;
+        double x = static_cast<double>(path.getNumberOfEvents());
+        sum += x;
+        sum2 += x * x;
+      }
+      double n = static_cast<double>(nbReplicates);
+      double mean = sum / n;
+      double se = sqrt((sum2 / n - mean * mean) / n);
+      double expected = getExpectedCount(model, a, b, t);
+      cout << "t=" << t << ", " << a << "->" << b << ": mean " << mean << " (" << se << "), expected " << expected << endl;
+      if (abs(mean - expected) > 5. * se + 1e-3)
+        return 1;
+    }
+  }
+  return 0;
+}
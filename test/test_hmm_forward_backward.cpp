@@ -0,0 +1,224 @@
+//
+// File: test_hmm_forward_backward.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Matrix/Matrix.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/ScaledHmmForwardBackward.h>
+#include <cmath>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+// Random transitions, leaving each state towards all the others with the same probability if banded.
+RowMatrix<double> getTransitions(size_t n, bool banded)
+{
+  RowMatrix<double> t(n, n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    double s = 0;
+    double off = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+    for (size_t j = 0; j < n; ++j)
+    {
+      t(k, j) = banded ? (j == k ? 1. : off) : 0.1 + RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+      s += t(k, j);
+    }
+    for (size_t j = 0; j < n; ++j)
+      t(k, j) /= s;
+  }
+  return t;
+}
+
+vector<double> getFrequencies(size_t n)
+{
+  vector<double> freqs(n);
+  double s = 0;
+  for (size_t k = 0; k < n; ++k)
+    s += freqs[k] = 0.1 + RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+  for (size_t k = 0; k < n; ++k)
+    freqs[k] /= s;
+  return freqs;
+}
+
+void setEmissions(ScaledHmmForwardBackward& fb)
+{
+  double* em = fb.getEmissions();
+  for (size_t i = 0; i < fb.getNumberOfSites() * fb.getNumberOfStates(); ++i)
+    em[i] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1e-3);
+}
+
+// Likelihood and posterior probabilities, summed over all hidden paths.
+double enumerate(const ScaledHmmForwardBackward& fb, const Matrix<double>& t, const vector<double>& freqs, VVdouble& posteriors)
+{
+  size_t nbSites = fb.getNumberOfSites();
+  size_t n = fb.getNumberOfStates();
+  const double* em = const_cast<ScaledHmmForwardBackward&>(fb).getEmissions();
+  size_t nbPaths = 1;
+  for (size_t i = 0; i < nbSites; ++i)
+    nbPaths *= n;
+  posteriors.assign(nbSites, Vdouble(n, 0.));
+  vector<size_t> path(nbSites);
+  double l = 0;
+  for (size_t p = 0; p < nbPaths; ++p)
+  {
+    size_t code = p;
+    for (size_t i = 0; i < nbSites; ++i)
+    {
+      path[i] = code % n;
+      code /= n;
+    }
+    // The first state is drawn from the frequencies, followed by one transition:
+    double x = 0;
+    for (size_t k = 0; k < n; ++k)
+      x += freqs[k] * t(k, path[0]);
+    x *= em[path[0]];
+    for (size_t i = 1; i < nbSites; ++i)
+      x *= t(path[i - 1], path[i]) * em[i * n + path[i]];
+    l += x;
+    for (size_t i = 0; i < nbSites; ++i)
+      posteriors[i][path[i]] += x;
+  }
+  for (size_t i = 0; i < nbSites; ++i)
+    for (size_t k = 0; k < n; ++k)
+      posteriors[i][k] /= l;
+  return l;
+}
+
+bool checkEnumeration(size_t n, bool banded)
+{
+  ScaledHmmForwardBackward fb;
+  fb.resize(6, n);
+  setEmissions(fb);
+  RowMatrix<double> t = getTransitions(n, banded);
+  vector<double> freqs = getFrequencies(n);
+  fb.computeForward(t, freqs);
+  //With 2 states, all matrices are banded:
+  if (fb.hasBandedTransitions() != (banded || n == 2))
+    return false;
+
+  VVdouble expected, posteriors;
+  double l = enumerate(fb, t, freqs, expected);
+  double sumLogScales = 0;
+  for (size_t i = 0; i < fb.getNumberOfSites(); ++i)
+    sumLogScales += log(fb.getLikelihoodForASite(i));
+  if (abs(fb.getLogLikelihood() - log(l)) > 1e-12 * abs(log(l)) || abs(sumLogScales - fb.getLogLikelihood()) > 1e-10)
+  {
+    cerr << n << " states: log-likelihood " << fb.getLogLikelihood() << " instead of " << log(l) << "." << endl;
+    return false;
+  }
+  fb.getPosteriorProbabilities(posteriors);
+  for (size_t i = 0; i < posteriors.size(); ++i)
+  {
+    Vdouble site = fb.getPosteriorProbabilitiesForASite(i);
+    for (size_t k = 0; k < n; ++k)
+      if (abs(posteriors[i][k] - expected[i][k]) > 1e-10 || site[k] != posteriors[i][k])
+      {
+        cerr << n << " states: posterior " << posteriors[i][k] << " instead of " << expected[i][k] << " at site " << i << "." << endl;
+        return false;
+      }
+  }
+  return true;
+}
+
+bool checkThreads(size_t n, bool banded)
+{
+  ScaledHmmForwardBackward seq;
+  seq.resize(2000, n);
+  setEmissions(seq);
+  ScaledHmmForwardBackward par(seq);
+  par.setNumberOfThreads(4);
+  RowMatrix<double> t = getTransitions(n, banded);
+  vector<double> freqs = getFrequencies(n);
+  seq.computeForward(t, freqs);
+  par.computeForward(t, freqs);
+  if (abs(par.getLogLikelihood() - seq.getLogLikelihood()) > 1e-12 * abs(seq.getLogLikelihood()))
+  {
+    cerr << n << " states: threaded log-likelihood " << par.getLogLikelihood() << " instead of " << seq.getLogLikelihood() << "." << endl;
+    return false;
+  }
+  VVdouble p1, p2;
+  seq.getPosteriorProbabilities(p1);
+  par.getPosteriorProbabilities(p2);
+  for (size_t i = 0; i < p1.size(); ++i)
+    for (size_t k = 0; k < n; ++k)
+      if (abs(p1[i][k] - p2[i][k]) > 1e-9)
+      {
+        cerr << n << " states: threaded posterior " << p2[i][k] << " instead of " << p1[i][k] << " at site " << i << "." << endl;
+        return false;
+      }
+  return true;
+}
+
+// A site with null emissions gives a null likelihood, without NaN.
+bool checkNullSite(size_t nbThreads)
+{
+  ScaledHmmForwardBackward fb;
+  fb.resize(1000, 3);
+  fb.setNumberOfThreads(nbThreads);
+  setEmissions(fb);
+  for (size_t k = 0; k < 3; ++k)
+    fb.getEmissions()[700 * 3 + k] = 0;
+  fb.computeForward(getTransitions(3, false), getFrequencies(3));
+  if (!std::isinf(fb.getLogLikelihood()) || fb.getLogLikelihood() > 0)
+    return false;
+  for (size_t i = 0; i < fb.getNumberOfSites(); ++i)
+    if (std::isnan(fb.getLikelihoodForASite(i)))
+      return false;
+  try {
+    VVdouble posteriors;
+    fb.getPosteriorProbabilities(posteriors);
+    return false;
+  } catch (Exception& ex) {}
+  return true;
+}
+
+int main() {
+  for (size_t n = 2; n <= 5; ++n)
+  {
+    if (!checkEnumeration(n, false) || !checkEnumeration(n, true))
+      return 1;
+    if (!checkThreads(n, false) || !checkThreads(n, true))
+      return 1;
+  }
+  cout << "Forward-backward ok." << endl;
+  if (!checkNullSite(1) || !checkNullSite(4))
+    return 1;
+  cout << "Null likelihood ok." << endl;
+  return 0;
+}
@@ -0,0 +1,150 @@
+//
+// File: test_likelihood_above.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+// Posterior probabilities at a node must match those of a fresh
+// computation.
+bool compare(const RecursiveLikelihoodTreeCalculation& calc, const RecursiveLikelihoodTreeCalculation& fresh, int id)
+{
+  VVVdouble pp = calc.getLikelihoodData().getPosteriorProbabilitiesPerStatePerClass(id);
+  VVVdouble ppRef = fresh.getLikelihoodData().getPosteriorProbabilitiesPerStatePerClass(id);
+  for (size_t c = 0; c < ppRef.size(); c++)
+    for (size_t i = 0; i < ppRef[c].size(); i++)
+      for (size_t s = 0; s < ppRef[c][i].size(); s++)
+        if (abs(pp[c][i][s] - ppRef[c][i][s]) > 1e-12)
+        {
+          cerr << "Node " << id << ", class " << c << ", site " << i << ", state " << s << ": "
+               << pp[c][i][s] << " instead of " << ppRef[c][i][s] << endl;
+          return false;
+        }
+  return true;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("((A:0.1,B:0.2):0.05,(C:0.3,((D:0.1,E:0.2):0.1,F:0.15):0.12):0.2);"));
+  ParametrizablePhyloTree pTree(*tree);
+  vector<unsigned int> ids = tree->getNodeIndexes(tree->getAllNodes());
+
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAAT", alphabet));
+  sites.addSequence(BasicSequence("B", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTAT", alphabet));
+  sites.addSequence(BasicSequence("C", "GTAATACTTTATAAATACTGATCAATTCAGATAATTTT", alphabet));
+  sites.addSequence(BasicSequence("D", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATAT", alphabet));
+  sites.addSequence(BasicSequence("E", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAATT", alphabet));
+  sites.addSequence(BasicSequence("F", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTAT", alphabet));
+
+  T92 model(alphabet, 3., 0.6);
+  GammaDiscreteRateDistribution rdist(4, 0.5);
+
+  try {
+    unique_ptr<RateAcrossSitesSubstitutionProcess> process(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist.clone(), pTree.clone()));
+    RecursiveLikelihoodTreeCalculation* calc = new RecursiveLikelihoodTreeCalculation(sites, process.get(), false, false);
+    SingleProcessPhyloLikelihood lik(process.get(), calc);
+    lik.getValue();
+
+    ParameterList pl = lik.getBranchLengthParameters();
+    for (size_t k = 0; k < pl.size(); k++)
+    {
+      calc->computeLikelihoodsAtAllNodes();
+
+      // Only the path from the changed branch to the root is
+      // invalidated, the deeper above likelihoods are checked lazily:
+      string name = pl[k].getName();
+      double length = lik.getParameterValue(name);
+      lik.setParameterValue(name, length * 1.7);
+      lik.getValue();
+
+      unique_ptr<RateAcrossSitesSubstitutionProcess> freshProcess(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist.clone(), pTree.clone()));
+      RecursiveLikelihoodTreeCalculation* freshCalc = new RecursiveLikelihoodTreeCalculation(sites, freshProcess.get(), false, false);
+      SingleProcessPhyloLikelihood fresh(freshProcess.get(), freshCalc);
+      fresh.matchParametersValues(lik.getParameters());
+      fresh.getValue();
+      freshCalc->computeLikelihoodsAtAllNodes();
+
+      // Stale nodes have to be reported as such, not read:
+      for (size_t i = 0; i < ids.size(); i++)
+      {
+        int id = static_cast<int>(ids[i]);
+        try {
+          if (!compare(*calc, *freshCalc, id))
+          {
+            cerr << "Stale likelihoods read after changing " << name << "." << endl;
+            return 1;
+          }
+        } catch (Exception& ex) {}
+      }
+
+      // And are computed again at request:
+      for (size_t i = 0; i < ids.size(); i++)
+      {
+        int id = static_cast<int>(ids[i]);
+        calc->computeLikelihoodsAtNode(id);
+        if (!compare(*calc, *freshCalc, id))
+        {
+          cerr << "Wrong likelihoods computed after changing " << name << "." << endl;
+          return 1;
+        }
+      }
+
+      lik.setParameterValue(name, length);
+    }
+    cout << "Lazy above likelihoods ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,182 @@
+//
+// File: test_likelihood_lazy_arrays.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/NucleotideFrequenciesSet.h>
+#include <Bpp/Phyl/Model/SubstitutionModelSetTools.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRNonHomogeneousTreeLikelihood.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool isClose(double a, double b)
+{
+  return abs(a - b) <= 1e-9 * max(1., abs(b));
+}
+
+// Compare the site likelihoods and the branch length derivatives of a
+// likelihood read right after its initialization, with one whose arrays
+// were all allocated beforehand.
+template<class Likelihood>
+bool compare(const Likelihood& lazy, const Likelihood& eager, const string& name)
+{
+  if (!isClose(lazy.getValue(), eager.getValue()))
+  {
+    cerr << name << " likelihood: " << lazy.getValue() << " instead of " << eager.getValue() << endl;
+    return false;
+  }
+  for (size_t i = 0; i < eager.getNumberOfSites(); i++)
+  {
+    if (!isClose(lazy.getLikelihoodForASite(i), eager.getLikelihoodForASite(i)))
+    {
+      cerr << name << " likelihood of site " << i << ": " << lazy.getLikelihoodForASite(i) << " instead of " << eager.getLikelihoodForASite(i) << endl;
+      return false;
+    }
+  }
+  ParameterList brLens = eager.getBranchLengthsParameters();
+  for (size_t k = 0; k < brLens.size(); k++)
+  {
+    string brLen = brLens[k].getName();
+    double d1 = lazy.getFirstOrderDerivative(brLen), d2 = lazy.getSecondOrderDerivative(brLen);
+    double d1Ref = eager.getFirstOrderDerivative(brLen), d2Ref = eager.getSecondOrderDerivative(brLen);
+    if (!isClose(d1, d1Ref) || !isClose(d2, d2Ref))
+    {
+      cerr << name << " derivatives for " << brLen << ": " << d1 << ", " << d2 << " instead of " << d1Ref << ", " << d2Ref << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  unique_ptr<TreeTemplate<Node> > tree(reader.parenthesisToTree("((A:0.1,B:0.2):0.05,((C:0.3,D:0.1):0.2,G:0.12):0.07,(E:0.15,F:0.25):0.1);"));
+  unique_ptr<TreeTemplate<Node> > rootedTree(reader.parenthesisToTree("(((A:0.1,B:0.2):0.3,C:0.15):0.25,((D:0.35,G:0.12):0.1,(E:0.26,F:0.05):0.12):0.16);"));
+
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATGTCATTTCTGAATTATTATA", alphabet));
+  sites.addSequence(BasicSequence("B", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("C", "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAGAACTAACATATATATTATG", alphabet));
+  sites.addSequence(BasicSequence("D", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGAAAATCATTTATGTGAAGGC", alphabet));
+  sites.addSequence(BasicSequence("E", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAATTCAGATAATTTTCAGAACTAACA", alphabet));
+  sites.addSequence(BasicSequence("F", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("G", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCAAGCATGAATGTTCAGTGAGT", alphabet));
+
+  T92 model(alphabet, 3., 0.6);
+  GammaDiscreteDistribution rdist(4, 0.5);
+
+  try {
+    // Homogeneous, with all upper arrays or under a memory budget set
+    // before the first computation, where they are computed on demand:
+    NNIHomogeneousTreeLikelihood eager(*tree, sites, model.clone(), rdist.clone(), true, false);
+    eager.getLikelihoodData()->allocateArrays();
+    eager.initialize();
+    for (size_t budget = 0; budget < 2; budget++)
+    {
+      NNIHomogeneousTreeLikelihood lazy(*tree, sites, model.clone(), rdist.clone(), true, false);
+      if (lazy.getLikelihoodData()->hasAllocatedArrays())
+      {
+        cerr << "Arrays allocated before the first computation." << endl;
+        return 1;
+      }
+      unique_ptr<NNIHomogeneousTreeLikelihood> copy(lazy.clone());
+      if (copy->getLikelihoodData()->hasAllocatedArrays())
+      {
+        cerr << "Arrays allocated by a copy before the first computation." << endl;
+        return 1;
+      }
+      if (budget > 0)
+        lazy.setMemoryBudget(1);
+      lazy.initialize();
+
+      string name = budget > 0 ? "Homogeneous with a memory budget" : "Homogeneous";
+      vector<int> ids = lazy.getTree().getNodesId();
+      for (size_t k = 0; k < ids.size(); k++)
+      {
+        const Node* node = lazy.getTree().getNode(ids[k]);
+        if (!node->hasFather() || !node->getFather()->hasFather())
+          continue;
+        double diff = lazy.testNNI(ids[k]);
+        double diffRef = eager.testNNI(ids[k]);
+        if (!isClose(diff, diffRef))
+        {
+          cerr << name << " NNI on node " << ids[k] << ": " << diff << " instead of " << diffRef << endl;
+          return 1;
+        }
+      }
+      if (!compare(lazy, eager, name))
+        return 1;
+      cout << name << " ok." << endl;
+    }
+
+    // Non-homogeneous:
+    vector<string> globalParameterNames;
+    globalParameterNames.push_back("T92.kappa");
+    map<string, string> alias;
+    SubstitutionModelSet* modelSet = SubstitutionModelSetTools::createNonHomogeneousModelSet(model.clone(), new GCFrequenciesSet(alphabet), rootedTree.get(), alias, globalParameterNames);
+
+    DRNonHomogeneousTreeLikelihood nhEager(*rootedTree, sites, modelSet->clone(), rdist.clone(), false);
+    nhEager.getLikelihoodData()->allocateArrays();
+    nhEager.initialize();
+    DRNonHomogeneousTreeLikelihood nhLazy(*rootedTree, sites, modelSet, rdist.clone(), false);
+    if (nhLazy.getLikelihoodData()->hasAllocatedArrays())
+    {
+      cerr << "Non-homogeneous arrays allocated before the first computation." << endl;
+      return 1;
+    }
+    nhLazy.initialize();
+    if (!compare(nhLazy, nhEager, "Non-homogeneous"))
+      return 1;
+    cout << "Non-homogeneous ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,300 @@
+//
+// File: test_likelihood_mixture.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/PhyloTree.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/SimpleSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/SubstitutionProcessCollection.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/MixtureSequenceEvolution.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/MixtureOfAlignedPhyloLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/MixtureProcessPhyloLikelihood.h>
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+const vector<string> names = {"A", "B", "C", "D"};
+const vector<string> gene = {
+  "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATGTCATTTCTGAATTATTATA",
+  "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA",
+  "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAGAACTAACATATATATTATG",
+  "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGAAAATCATTTATGTGAAGGC"};
+
+VectorSiteContainer* getSites()
+{
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  VectorSiteContainer* sites = new VectorSiteContainer(alphabet);
+  for (size_t i = 0; i < names.size(); i++)
+    sites->addSequence(BasicSequence(names[i], gene[i], alphabet));
+  return sites;
+}
+
+// Member g of the mixture of aligned likelihoods, with a T92 model
+// with its own parameter names. The branch lengths are shared by all
+// members.
+class Member
+{
+  public:
+    unique_ptr<SubstitutionProcess> process;
+    unique_ptr<SingleProcessPhyloLikelihood> lik;
+
+    Member(size_t g) :
+      process(), lik()
+    {
+      const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+      Newick reader;
+      unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("((A:0.1,B:0.2):0.05,C:0.3,D:0.1);"));
+      unique_ptr<VectorSiteContainer> sites(getSites());
+      T92* model = new T92(alphabet, 1. + 2. * double(g), 0.3 + 0.2 * double(g));
+      model->setNamespace("T92_" + TextTools::toString(g + 1) + ".");
+      process.reset(new SimpleSubstitutionProcess(model, new ParametrizablePhyloTree(*tree)));
+      lik.reset(new SingleProcessPhyloLikelihood(process.get(), new RecursiveLikelihoodTreeCalculation(*sites, process.get(), false, true)));
+    }
+};
+
+bool isClose(double a, double b, double tol)
+{
+  return abs(a - b) <= tol * max(1., abs(b));
+}
+
+// Compare the first and second order derivatives of the value with
+// central differences:
+bool checkDerivatives(PhyloLikelihood& lik, const string& name, const string& step)
+{
+  const double h = 0.0001;
+  double x = lik.getParameterValue(name);
+  double f0 = lik.getValue();
+  lik.setParameterValue(name, x + h);
+  double fPlus = lik.getValue();
+  lik.setParameterValue(name, x - h);
+  double fMinus = lik.getValue();
+  lik.setParameterValue(name, x);
+
+  double d1 = (fPlus - fMinus) / (2 * h);
+  double d2 = (fPlus - 2 * f0 + fMinus) / (h * h);
+  if (!isClose(lik.getFirstOrderDerivative(name), d1, 1e-4)) {
+    cerr << step << ": first order derivative wrt " << name << " is " << lik.getFirstOrderDerivative(name) << " instead of " << d1 << "." << endl;
+    return false;
+  }
+  if (!isClose(lik.getSecondOrderDerivative(name), d2, 1e-3)) {
+    cerr << step << ": second order derivative wrt " << name << " is " << lik.getSecondOrderDerivative(name) << " instead of " << d2 << "." << endl;
+    return false;
+  }
+  return true;
+}
+
+// Compare the mixture with members computed from scratch on its
+// parameters, and check its derivatives:
+bool checkMixture(MixtureOfAlignedPhyloLikelihood& mixture, const vector<string>& variables, const string& step)
+{
+  ParameterList parameters = mixture.getParameters();
+  vector< unique_ptr<Member> > members;
+  for (size_t g = 0; g < 3; g++)
+  {
+    members.emplace_back(new Member(g));
+    members[g]->lik->matchParametersValues(parameters);
+  }
+
+  double logLik = 0;
+  for (size_t i = 0; i < gene[0].size(); i++)
+  {
+    double l = 0;
+    for (size_t g = 0; g < 3; g++)
+      l += mixture.getPhyloProb(g) * members[g]->lik->getLikelihoodForASite(i);
+    if (!isClose(mixture.getLikelihoodForASite(i), l, 1e-9) || !isClose(mixture.getLogLikelihoodForASite(i), log(l), 1e-9)) {
+      cerr << step << ": likelihood of site " << i << " is " << mixture.getLikelihoodForASite(i) << " instead of " << l << "." << endl;
+      return false;
+    }
+    logLik += log(l);
+  }
+  if (!isClose(mixture.getLogLikelihood(), logLik, 1e-9)) {
+    cerr << step << ": log-likelihood is " << mixture.getLogLikelihood() << " instead of " << logLik << "." << endl;
+    return false;
+  }
+
+  for (size_t i = 0; i < variables.size(); i++)
+    if (!checkDerivatives(mixture, variables[i], step))
+      return false;
+  return true;
+}
+
+int main() {
+  try {
+    // Mixture of aligned likelihoods:
+    {
+      vector< unique_ptr<SubstitutionProcess> > processes;
+      PhyloLikelihoodContainer pc;
+      for (size_t g = 0; g < 3; g++)
+      {
+        Member member(g);
+        pc.addPhyloLikelihood(g + 1, member.lik.release());
+        processes.push_back(move(member.process));
+      }
+      MixtureOfAlignedPhyloLikelihood mixture(&pc, {1, 2, 3});
+
+      vector<string> variables = {"Mixture.theta1", "Mixture.theta2"};
+      const ParameterList& pl = mixture.getParameters();
+      for (size_t i = 0; i < pl.size() && variables.size() == 2; i++)
+        if (pl[i].getName().compare(0, 5, "BrLen") == 0)
+          variables.push_back(pl[i].getName());
+
+      if (!checkMixture(mixture, variables, "Initial values"))
+        return 1;
+
+      mixture.setParameterValue("Mixture.theta1", 0.6);
+      if (!checkMixture(mixture, variables, "After changing Mixture.theta1"))
+        return 1;
+
+      mixture.setParameterValue("T92_2.kappa", 6.);
+      if (!checkMixture(mixture, variables, "After changing T92_2.kappa"))
+        return 1;
+
+      mixture.setParameterValue(variables[2], 0.4);
+      if (!checkMixture(mixture, variables, "After changing " + variables[2]))
+        return 1;
+
+      Simplex simplex(vector<double>({0.2, 0.1, 0.7}), 1, false, "Mixture.");
+      mixture.setPhyloProb(simplex);
+      if (!isClose(mixture.getPhyloProb(2), 0.7, 1e-9) || !checkMixture(mixture, variables, "After setting the probabilities"))
+        return 1;
+      cout << "Mixture of aligned likelihoods ok." << endl;
+    }
+
+    // Mixture of processes:
+    {
+      const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+      Newick reader;
+      unique_ptr<PhyloTree> tree1(reader.parenthesisToPhyloTree("(((A:0.1, B:0.2):0.3,C:0.1):0.2,D:0.3);"));
+      unique_ptr<PhyloTree> tree2(reader.parenthesisToPhyloTree("((A:0.05, C:0.02):0.1,(D:0.01,B:0.03):0.05);"));
+      unique_ptr<ParametrizablePhyloTree> parTree1(new ParametrizablePhyloTree(*tree1));
+      unique_ptr<ParametrizablePhyloTree> parTree2(new ParametrizablePhyloTree(*tree2));
+
+      T92 model1(alphabet, 3., 0.9);
+      T92 model2(alphabet, 2., 0.1);
+      GammaDiscreteRateDistribution rdist1(4, 2.0);
+      GammaDiscreteRateDistribution rdist2(3, 1.0);
+      unique_ptr<VectorSiteContainer> sites(getSites());
+
+      // The processes of the mixture, out of any collection:
+      unique_ptr<SubstitutionProcess> subPro1(new RateAcrossSitesSubstitutionProcess(model1.clone(), rdist1.clone(), parTree1->clone()));
+      unique_ptr<SubstitutionProcess> subPro2(new RateAcrossSitesSubstitutionProcess(model2.clone(), rdist2.clone(), parTree2->clone()));
+      SingleProcessPhyloLikelihood lik1(subPro1.get(), new RecursiveLikelihoodTreeCalculation(*sites, subPro1.get(), true, true));
+      SingleProcessPhyloLikelihood lik2(subPro2.get(), new RecursiveLikelihoodTreeCalculation(*sites, subPro2.get(), true, true));
+
+      unique_ptr<SubstitutionProcessCollection> modelColl(new SubstitutionProcessCollection());
+      modelColl->addModel(model1.clone(), 1);
+      modelColl->addModel(model2.clone(), 2);
+      modelColl->addDistribution(rdist1.clone(), 1);
+      modelColl->addDistribution(rdist2.clone(), 2);
+      modelColl->addTree(parTree1->clone(), 1);
+      modelColl->addTree(parTree2->clone(), 2);
+      Vuint branches = {0, 1, 2, 3, 4, 5};
+      map<size_t, Vuint> mModBr1, mModBr2;
+      mModBr1[1] = branches;
+      mModBr2[2] = branches;
+      modelColl->addSubstitutionProcess(1, mModBr1, 1, 1);
+      modelColl->addSubstitutionProcess(2, mModBr2, 2, 2);
+
+      vector<size_t> vp = {1, 2};
+      MixtureSequenceEvolution mse(modelColl.get(), vp);
+      MixtureProcessPhyloLikelihood mixture(*sites, mse);
+
+      double logLik = 0;
+      for (size_t i = 0; i < sites->getNumberOfSites(); i++)
+      {
+        double l = mixture.getSubProcessProb(0) * lik1.getLikelihoodForASite(i) + mixture.getSubProcessProb(1) * lik2.getLikelihoodForASite(i);
+        if (!isClose(mixture.getLikelihoodForASite(i), l, 1e-9)) {
+          cerr << "Likelihood of site " << i << " is " << mixture.getLikelihoodForASite(i) << " instead of " << l << "." << endl;
+          return 1;
+        }
+        logLik += log(l);
+      }
+      if (!isClose(mixture.getLogLikelihood(), logLik, 1e-9)) {
+        cerr << "Log-likelihood is " << mixture.getLogLikelihood() << " instead of " << logLik << "." << endl;
+        return 1;
+      }
+
+      // A branch of each tree:
+      vector<string> variables;
+      const ParameterList& pl = mixture.getParameters();
+      for (size_t i = 0; i < pl.size(); i++)
+        if (pl[i].getName().compare(0, 5, "BrLen") == 0)
+          variables.push_back(pl[i].getName());
+      variables.erase(variables.begin() + 1, variables.end() - 1);
+
+      for (size_t i = 0; i < variables.size(); i++)
+        if (!checkDerivatives(mixture, variables[i], "Initial values"))
+          return 1;
+
+      mixture.setParameterValue(variables[0], 0.4);
+      for (size_t i = 0; i < variables.size(); i++)
+        if (!checkDerivatives(mixture, variables[i], "After changing " + variables[0]))
+          return 1;
+
+      // The weights of the processes:
+      string theta;
+      for (size_t i = 0; i < pl.size() && theta.empty(); i++)
+        if (pl[i].getName().find("theta1") != string::npos)
+          theta = pl[i].getName();
+      mixture.setParameterValue(theta, 0.8);
+      if (!isClose(mixture.getSubProcessProb(0), 0.8, 1e-9)) {
+        cerr << "Probability of the first process is " << mixture.getSubProcessProb(0) << " instead of 0.8." << endl;
+        return 1;
+      }
+      for (size_t i = 0; i < variables.size(); i++)
+        if (!checkDerivatives(mixture, variables[i], "After changing " + theta))
+          return 1;
+      cout << "Mixture of processes ok." << endl;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,157 @@
+//
+// File: test_likelihood_mpi.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+// MPIProductOfPhyloLikelihood is only built with the WITH_MPI CMake option.
+// Run with mpirun to distribute the members, for instance:
+//   mpirun -n 3 test_likelihood_mpi
+// ctest runs it as a single process.
+
+#include <iostream>
+
+#ifdef BPP_WITH_MPI
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/PhyloTree.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/SimpleSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/FormulaOfPhyloLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/MPIProductOfPhyloLikelihood.h>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+// Three independent genes of different lengths, numbered 1 to 3.
+void fillContainer(PhyloLikelihoodContainer& pc)
+{
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("((A:0.1,B:0.2):0.05,C:0.3,D:0.1);"));
+
+  vector< vector<string> > genes = {
+    {"GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATG", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAAC",
+     "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAG", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGA"},
+    {"ATGTCATTTCTGAATTATTATA", "CAAGTAATATGTTTTAAGAATT", "AACTAACATATATATTATGAAT", "AAATCATTTATGTGAAGGCAAT"},
+    {"GATCAAATATGTCATTTCTGAATTATTATAGAACACGAAAGCATGAATGTT", "ATAAGAAAGTTAAATATCTTATAACCAAGTTTTGAACTGTTTGAATATAAG",
+     "AAATACTGATCAATTCAGATAATTTTCAGAAGTAATACTTTATAAATACTG", "CAGGATCAACAATCTTTAACTTATATCGAAATCGATCGAAAGCCAGGATCA"}
+  };
+  vector<string> names = {"A", "B", "C", "D"};
+  for (size_t g = 0; g < genes.size(); g++)
+  {
+    VectorSiteContainer sites(alphabet);
+    for (size_t i = 0; i < names.size(); i++)
+      sites.addSequence(BasicSequence(names[i], genes[g][i], alphabet));
+    SubstitutionProcess* process = new SimpleSubstitutionProcess(new T92(alphabet, 3. + double(g), 0.5), new ParametrizablePhyloTree(*tree));
+    RecursiveLikelihoodTreeCalculation* calc = new RecursiveLikelihoodTreeCalculation(sites, process, true, true);
+    pc.addPhyloLikelihood(g + 1, new SingleProcessPhyloLikelihood(process, calc));
+  }
+}
+
+bool isClose(double a, double b)
+{
+  return abs(a - b) <= 1e-9 * max(1., abs(b));
+}
+
+int main(int argc, char** argv) {
+  MPI_Init(&argc, &argv);
+  int status = 0;
+  try {
+    PhyloLikelihoodContainer pc, pcRef;
+    fillContainer(pc);
+    fillContainer(pcRef);
+
+    MPIProductOfPhyloLikelihood mpl(&pc);
+    for (size_t g = 1; g <= 3; g++)
+      mpl.addPhyloLikelihood(g);
+    mpl.initialize();
+    FormulaOfPhyloLikelihood ref(&pcRef, "phylo1 + phylo2 + phylo3");
+
+    // Members go largest first to the least loaded rank:
+    const vector<int>& ranks = mpl.getMemberRanks();
+    if (mpl.getNumberOfRanks() >= 3 && (ranks[2] != 0 || ranks[0] != 1 || ranks[1] != 2))
+    {
+      cerr << "Unexpected distribution of the members" << endl;
+      status = 1;
+    }
+
+    if (!isClose(mpl.getValue(), ref.getValue()))
+    {
+      cerr << "Rank " << mpl.getRank() << ": " << mpl.getValue() << " instead of " << ref.getValue() << endl;
+      status = 1;
+    }
+
+    // Parameter changes are broadcast, and derivatives summed over the ranks:
+    ParameterList parameters = mpl.getParameters();
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+      if (parameters[i].getName().compare(0, 5, "BrLen") == 0)
+      {
+        parameters[i].setValue(parameters[i].getValue() * 1.5);
+        const string name = parameters[i].getName();
+        mpl.matchParametersValues(parameters);
+        ref.matchParametersValues(parameters);
+        if (!isClose(mpl.getValue(), ref.getValue()) || !isClose(mpl.getFirstOrderDerivative(name), ref.getFirstOrderDerivative(name)))
+        {
+          cerr << "Rank " << mpl.getRank() << ", after changing " << name << ": " << mpl.getValue() << " instead of " << ref.getValue() << endl;
+          status = 1;
+        }
+        break;
+      }
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    status = 1;
+  }
+  MPI_Finalize();
+  return status;
+}
+
+#else
+
+int main() {
+  std::cout << "bpp-phyl is built without MPI: nothing to test." << std::endl;
+  return 0;
+}
+
+#endif
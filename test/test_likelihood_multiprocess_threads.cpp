@@ -0,0 +1,202 @@
+//
+// File: test_likelihood_multiprocess_threads.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/PhyloTree.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/SubstitutionProcessCollection.h>
+#include <Bpp/Phyl/NewLikelihood/MixtureSequenceEvolution.h>
+#include <Bpp/Phyl/NewLikelihood/HmmSequenceEvolution.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/MixtureProcessPhyloLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/HmmProcessPhyloLikelihood.h>
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+// A likelihood on three processes, the first two sharing a model and a
+// rate distribution on different trees, with its own collection.
+class MultiProcess
+{
+  public:
+    unique_ptr<SubstitutionProcessCollection> collection;
+    unique_ptr<MultiProcessSequenceEvolution> evolution;
+    unique_ptr<MultiProcessSequencePhyloLikelihood> lik;
+
+    MultiProcess(const VectorSiteContainer& sites, bool hmm) :
+      collection(new SubstitutionProcessCollection()), evolution(), lik()
+    {
+      const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+      Newick reader;
+      vector<string> trees = {
+        "(((A:0.1, B:0.2):0.3,C:0.1):0.2,D:0.3);",
+        "((A:0.05, C:0.02):0.1,(D:0.01,B:0.03):0.05);",
+        "((A:0.2, D:0.1):0.05,(C:0.15,B:0.3):0.1);"};
+      for (size_t t = 0; t < trees.size(); t++)
+      {
+        unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree(trees[t]));
+        collection->addTree(new ParametrizablePhyloTree(*tree), t + 1);
+      }
+      collection->addModel(new T92(alphabet, 3., 0.7), 1);
+      collection->addModel(new T92(alphabet, 2., 0.3), 2);
+      collection->addDistribution(new GammaDiscreteRateDistribution(4, 0.8), 1);
+      collection->addDistribution(new GammaDiscreteRateDistribution(3, 1.5), 2);
+
+      Vuint branches = {0, 1, 2, 3, 4, 5};
+      map<size_t, Vuint> mModBr1, mModBr2;
+      mModBr1[1] = branches;
+      mModBr2[2] = branches;
+      collection->addSubstitutionProcess(1, mModBr1, 1, 1);
+      collection->addSubstitutionProcess(2, mModBr1, 2, 1);
+      collection->addSubstitutionProcess(3, mModBr2, 3, 2);
+
+      vector<size_t> vp = {1, 2, 3};
+      if (hmm)
+      {
+        HmmSequenceEvolution* hse = new HmmSequenceEvolution(collection.get(), vp);
+        evolution.reset(hse);
+        lik.reset(new HmmProcessPhyloLikelihood(sites, *hse, 0, 0, false));
+      }
+      else
+      {
+        MixtureSequenceEvolution* mse = new MixtureSequenceEvolution(collection.get(), vp);
+        evolution.reset(mse);
+        lik.reset(new MixtureProcessPhyloLikelihood(sites, *mse, 0, 0, false));
+      }
+    }
+};
+
+// Concurrent computations must give exactly the serial values, site
+// likelihoods and branch length derivatives:
+bool compare(MultiProcessSequencePhyloLikelihood& threaded, MultiProcessSequencePhyloLikelihood& serial, const string& step)
+{
+  if (threaded.getValue() != serial.getValue())
+  {
+    cerr << step << ": likelihood " << threaded.getValue() << " instead of " << serial.getValue() << endl;
+    return false;
+  }
+  for (size_t i = 0; i < serial.getNumberOfSites(); i++)
+  {
+    if (threaded.getLikelihoodForASite(i) != serial.getLikelihoodForASite(i))
+    {
+      cerr << step << ": likelihood of site " << i << " " << threaded.getLikelihoodForASite(i) << " instead of " << serial.getLikelihoodForASite(i) << endl;
+      return false;
+    }
+  }
+  const ParameterList& pl = serial.getParameters();
+  for (size_t k = 0; k < pl.size(); k++)
+  {
+    const string& name = pl[k].getName();
+    if (name.compare(0, 5, "BrLen") != 0)
+      continue;
+    if (threaded.getFirstOrderDerivative(name) != serial.getFirstOrderDerivative(name)
+        || threaded.getSecondOrderDerivative(name) != serial.getSecondOrderDerivative(name))
+    {
+      cerr << step << ": derivatives for " << name << ": " << threaded.getFirstOrderDerivative(name) << ", " << threaded.getSecondOrderDerivative(name)
+           << " instead of " << serial.getFirstOrderDerivative(name) << ", " << serial.getSecondOrderDerivative(name) << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATGTCATTTCTGAATTATTATA", alphabet));
+  sites.addSequence(BasicSequence("B", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("C", "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAGAACTAACATATATATTATG", alphabet));
+  sites.addSequence(BasicSequence("D", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGAAAATCATTTATGTGAAGGC", alphabet));
+
+  try {
+    for (size_t hmm = 0; hmm < 2; hmm++)
+    {
+      string name = hmm ? "Hmm of processes" : "Mixture of processes";
+      MultiProcess serial(sites, hmm > 0);
+      MultiProcess threaded(sites, hmm > 0);
+      threaded.lik->setNumberOfThreads(3);
+      if (!compare(*threaded.lik, *serial.lik, name + " at start"))
+        return 1;
+
+      // Changes of the shared model and of branch lengths, many times so
+      // that a model read while being updated would show:
+      const ParameterList& pl = serial.lik->getParameters();
+      string kappa, brLen;
+      for (size_t k = 0; k < pl.size(); k++)
+      {
+        if (kappa.empty() && pl[k].getName().find("kappa") != string::npos)
+          kappa = pl[k].getName();
+        if (brLen.empty() && pl[k].getName().compare(0, 5, "BrLen") == 0)
+          brLen = pl[k].getName();
+      }
+      for (size_t n = 0; n < 20; n++)
+      {
+        double value = 1. + 0.3 * static_cast<double>(n);
+        serial.lik->setParameterValue(kappa, value);
+        threaded.lik->setParameterValue(kappa, value);
+        if (!compare(*threaded.lik, *serial.lik, name + " with " + kappa + "=" + TextTools::toString(value)))
+          return 1;
+        value = 0.01 + 0.02 * static_cast<double>(n);
+        serial.lik->setParameterValue(brLen, value);
+        threaded.lik->setParameterValue(brLen, value);
+        if (!compare(*threaded.lik, *serial.lik, name + " with " + brLen + "=" + TextTools::toString(value)))
+          return 1;
+      }
+
+      // Back to one thread:
+      threaded.lik->setNumberOfThreads(1);
+      serial.lik->setParameterValue(kappa, 2.5);
+      threaded.lik->setParameterValue(kappa, 2.5);
+      if (!compare(*threaded.lik, *serial.lik, name + " back to one thread"))
+        return 1;
+      cout << name << " ok." << endl;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
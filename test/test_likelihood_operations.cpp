@@ -0,0 +1,167 @@
+//
+// File: test_likelihood_operations.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+#include <iostream>
+#include <map>
+
+using namespace bpp;
+using namespace std;
+
+// Also runs the recursions replaced by the list of operations.
+class TestedLikelihood :
+  public NNIHomogeneousTreeLikelihood
+{
+public:
+  TestedLikelihood(const Tree& tree, const AlignedValuesContainer& data, TransitionModel* model, DiscreteDistribution* rDist) :
+    NNIHomogeneousTreeLikelihood(tree, data, model, rDist, true, false) {}
+
+  void computeRecursively()
+  {
+    computeSubtreeLikelihoodPostfix(tree_->getRootNode());
+    computeSubtreeLikelihoodPrefix(tree_->getRootNode());
+    computeRootLikelihood();
+  }
+};
+
+map<int, map<int, VVVdouble> > getArrays(const TestedLikelihood& tl)
+{
+  map<int, map<int, VVVdouble> > arrays;
+  vector<int> ids = tl.getTree().getInnerNodesId();
+  for (size_t k = 0; k < ids.size(); k++)
+    arrays[ids[k]] = tl.getLikelihoodData()->getLikelihoodArrays(ids[k]);
+  return arrays;
+}
+
+// The list of operations computes the same arrays as the recursions,
+// in the same order, so that results are identical.
+bool compare(TestedLikelihood& tl, const string& step)
+{
+  tl.computeTreeLikelihood();
+  map<int, map<int, VVVdouble> > arrays = getArrays(tl);
+  VVVdouble root = tl.getLikelihoodData()->getRootLikelihoodArray();
+  double logLik = tl.getLogLikelihood();
+
+  tl.computeRecursively();
+  if (getArrays(tl) != arrays || tl.getLikelihoodData()->getRootLikelihoodArray() != root)
+  {
+    cerr << step << ": likelihood arrays differ from the recursive ones." << endl;
+    return false;
+  }
+  if (tl.getLogLikelihood() != logLik)
+  {
+    cerr << step << ": log likelihood " << logLik << " instead of " << tl.getLogLikelihood() << endl;
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  unique_ptr<TreeTemplate<Node> > tree(reader.parenthesisToTree("((A:0.1,B:0.2):0.05,((C:0.3,D:0.1):0.2,G:0.12):0.07,(E:0.15,F:0.25):0.1);"));
+
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATGTCATTTCTGAATTATTATA", alphabet));
+  sites.addSequence(BasicSequence("B", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("C", "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAGAACTAACATATATATTATG", alphabet));
+  sites.addSequence(BasicSequence("D", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGAAAATCATTTATGTGAAGGC", alphabet));
+  sites.addSequence(BasicSequence("E", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAATTCAGATAATTTTCAGAACTAACA", alphabet));
+  sites.addSequence(BasicSequence("F", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("G", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCAAGCATGAATGTTCAGTGAGT", alphabet));
+
+  T92 model(alphabet, 3., 0.6);
+  GammaDiscreteDistribution rdist(4, 0.5);
+
+  try {
+    TestedLikelihood tl(*tree, sites, model.clone(), rdist.clone());
+    tl.initialize();
+    if (!compare(tl, "Initial tree"))
+      return 1;
+
+    ParameterList pl;
+    pl.addParameter(Parameter("T92.kappa", 4.));
+    pl.addParameter(Parameter("BrLen2", 0.3));
+    tl.matchParametersValues(pl);
+    if (!compare(tl, "New parameters"))
+      return 1;
+
+    //The list is rebuilt after each topology change:
+    vector<int> ids = tl.getTree().getNodesId();
+    size_t nbNNIs = 0;
+    for (size_t k = 0; k < ids.size(); k++)
+    {
+      const Node* node = tl.getTree().getNode(ids[k]);
+      if (!node->hasFather() || !node->getFather()->hasFather())
+        continue;
+      tl.doNNI(ids[k]);
+      if (!compare(tl, "NNI on node " + TextTools::toString(ids[k])))
+        return 1;
+      nbNNIs++;
+    }
+    if (nbNNIs == 0)
+      return 1;
+
+    //Copies build their own list, on their own arrays:
+    pl.setParameterValue("T92.kappa", 2.5);
+    TestedLikelihood copy(tl);
+    copy.matchParametersValues(pl);
+    if (!compare(copy, "Copy"))
+      return 1;
+    TestedLikelihood assigned(*tree, sites, model.clone(), rdist.clone());
+    assigned.initialize();
+    assigned = tl;
+    pl.setParameterValue("T92.kappa", 5.);
+    assigned.matchParametersValues(pl);
+    if (!compare(assigned, "Assignment"))
+      return 1;
+    cout << "Likelihood operations ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
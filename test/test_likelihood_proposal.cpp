@@ -0,0 +1,175 @@
+//
+// File: test_likelihood_proposal.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool isClose(double a, double b)
+{
+  return abs(a - b) <= 1e-9 * max(1., abs(b));
+}
+
+// Compare a likelihood with one computed from scratch with the same
+// parameter values, for the value and the derivatives along a branch.
+bool compare(const DRHomogeneousTreeLikelihood& tl, const DRHomogeneousTreeLikelihood& fresh, const string& brLen, const string& step)
+{
+  if (!isClose(tl.getValue(), fresh.getValue())
+      || !isClose(tl.getFirstOrderDerivative(brLen), fresh.getFirstOrderDerivative(brLen))
+      || !isClose(tl.getSecondOrderDerivative(brLen), fresh.getSecondOrderDerivative(brLen)))
+  {
+    cerr << "Likelihood " << step << ": " << tl.getValue() << " instead of " << fresh.getValue() << endl;
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  unique_ptr<TreeTemplate<Node> > tree(reader.parenthesisToTree("((A:0.1,B:0.2):0.05,((C:0.3,D:0.1):0.2,G:0.12):0.07,(E:0.15,F:0.25):0.1);"));
+
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATGTCATTTCTGAATTATTATA", alphabet));
+  sites.addSequence(BasicSequence("B", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("C", "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAGAACTAACATATATATTATG", alphabet));
+  sites.addSequence(BasicSequence("D", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGAAAATCATTTATGTGAAGGC", alphabet));
+  sites.addSequence(BasicSequence("E", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAATTCAGATAATTTTCAGAACTAACA", alphabet));
+  sites.addSequence(BasicSequence("F", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("G", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCAAGCATGAATGTTCAGTGAGT", alphabet));
+
+  T92 model(alphabet, 3., 0.6);
+  GammaDiscreteDistribution rdist(4, 0.5);
+
+  try {
+    DRHomogeneousTreeLikelihood tl(*tree, sites, model.clone(), rdist.clone(), true, false);
+    tl.initialize();
+    DRHomogeneousTreeLikelihood fresh(*tree, sites, model.clone(), rdist.clone(), true, false);
+    fresh.initialize();
+
+    string brLen = tl.getBranchLengthsParameters()[0].getName();
+    ParameterList initial = tl.getParameters();
+    ParameterList proposal = initial;
+    proposal.setParameterValue(brLen, 0.4);
+    proposal.setParameterValue("T92.kappa", 5.);
+
+    double value = tl.getValue();
+    Vdouble siteLikelihoods(tl.getNumberOfSites());
+    for (size_t i = 0; i < siteLikelihoods.size(); i++)
+      siteLikelihoods[i] = tl.getLikelihoodForASite(i);
+    const double* rootArray = &tl.getLikelihoodData()->getRootSiteLikelihoodArray()[0][0];
+
+    // A proposal computes the likelihood of the new values:
+    tl.proposeParameters(proposal);
+    fresh.matchParametersValues(proposal);
+    if (!tl.hasProposal() || !compare(tl, fresh, brLen, "of the first proposal"))
+      return 1;
+
+    // Rejecting it brings back the former arrays, not recomputed ones:
+    tl.rejectProposal();
+    if (tl.hasProposal() || tl.getValue() != value
+        || &tl.getLikelihoodData()->getRootSiteLikelihoodArray()[0][0] != rootArray)
+    {
+      cerr << "Likelihood after rejection: " << tl.getValue() << " instead of " << value << endl;
+      return 1;
+    }
+    for (size_t i = 0; i < siteLikelihoods.size(); i++)
+      if (tl.getLikelihoodForASite(i) != siteLikelihoods[i])
+      {
+        cerr << "Likelihood of site " << i << " after rejection: " << tl.getLikelihoodForASite(i) << " instead of " << siteLikelihoods[i] << endl;
+        return 1;
+      }
+    for (size_t k = 0; k < initial.size(); k++)
+      if (tl.getParameterValue(initial[k].getName()) != initial[k].getValue())
+      {
+        cerr << "Parameter " << initial[k].getName() << " not restored." << endl;
+        return 1;
+      }
+    fresh.matchParametersValues(initial);
+    if (!compare(tl, fresh, brLen, "after rejection"))
+      return 1;
+    cout << "Rejected proposal ok." << endl;
+
+    // Accepted proposals are kept, and later changes start from them:
+    tl.proposeParameters(proposal);
+    tl.acceptProposal();
+    fresh.matchParametersValues(proposal);
+    if (tl.hasProposal() || !compare(tl, fresh, brLen, "after acceptance"))
+      return 1;
+
+    proposal.setParameterValue("T92.theta", 0.4);
+    tl.matchParametersValues(proposal);
+    fresh.matchParametersValues(proposal);
+    if (!compare(tl, fresh, brLen, "after a change following acceptance"))
+      return 1;
+
+    // The arrays swapped back and forth stay consistent over several proposals:
+    for (size_t n = 0; n < 4; n++)
+    {
+      ParameterList next = proposal;
+      next.setParameterValue(brLen, 0.1 + 0.1 * static_cast<double>(n));
+      tl.proposeParameters(next);
+      if (n % 2 == 0)
+        tl.rejectProposal();
+      else
+      {
+        tl.acceptProposal();
+        proposal = next;
+      }
+      fresh.matchParametersValues(proposal);
+      if (!compare(tl, fresh, brLen, "after proposal " + TextTools::toString(n)))
+        return 1;
+    }
+    cout << "Accepted proposals ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,140 @@
+//
+// File: test_likelihood_rootat.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool isClose(double a, double b)
+{
+  return abs(a - b) <= 1e-9 * max(1., abs(b));
+}
+
+// Compare a likelihood rerooted in place with one built on the rerooted tree,
+// for the value and the site derivatives of each branch.
+bool compare(const DRHomogeneousTreeLikelihood& rerooted, const DRHomogeneousTreeLikelihood& fresh)
+{
+  if (!isClose(rerooted.getValue(), fresh.getValue()))
+  {
+    cerr << "Likelihood: " << rerooted.getValue() << " instead of " << fresh.getValue() << endl;
+    return false;
+  }
+  if (rerooted.getTree().getRootId() != fresh.getTree().getRootId())
+    return false;
+  vector<int> ids = fresh.getTree().getNodesId();
+  for (size_t k = 0; k < ids.size(); k++)
+  {
+    if (ids[k] == fresh.getTree().getRootId())
+      continue;
+    const Vdouble& d1 = rerooted.getLikelihoodData()->getDLikelihoodArray(ids[k]);
+    const Vdouble& d1Ref = fresh.getLikelihoodData()->getDLikelihoodArray(ids[k]);
+    const Vdouble& d2 = rerooted.getLikelihoodData()->getD2LikelihoodArray(ids[k]);
+    const Vdouble& d2Ref = fresh.getLikelihoodData()->getD2LikelihoodArray(ids[k]);
+    for (size_t i = 0; i < d1Ref.size(); i++)
+    {
+      if (!isClose(d1[i], d1Ref[i]) || !isClose(d2[i], d2Ref[i]))
+      {
+        cerr << "Derivatives of branch " << ids[k] << ", site " << i << ": " << d1[i] << ", " << d2[i]
+             << " instead of " << d1Ref[i] << ", " << d2Ref[i] << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  unique_ptr<TreeTemplate<Node> > tree(reader.parenthesisToTree("((A:0.1,B:0.2):0.05,((C:0.3,D:0.1):0.2,G:0.12):0.07,(E:0.15,F:0.25):0.1);"));
+
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATGTCATTTCTGAATTATTATA", alphabet));
+  sites.addSequence(BasicSequence("B", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("C", "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAGAACTAACATATATATTATG", alphabet));
+  sites.addSequence(BasicSequence("D", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGAAAATCATTTATGTGAAGGC", alphabet));
+  sites.addSequence(BasicSequence("E", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAATTCAGATAATTTTCAGAACTAACA", alphabet));
+  sites.addSequence(BasicSequence("F", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("G", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCAAGCATGAATGTTCAGTGAGT", alphabet));
+
+  T92 model(alphabet, 3., 0.6);
+  GammaDiscreteDistribution rdist(4, 0.5);
+
+  try {
+    for (size_t budget = 0; budget < 2; budget++)
+    {
+      DRHomogeneousTreeLikelihood tl(*tree, sites, model.clone(), rdist.clone(), true, false);
+      tl.initialize();
+      // The smallest budget: only a few upper arrays are kept.
+      if (budget > 0)
+        tl.setMemoryBudget(1);
+
+      // Each inner node in turn, so that the root also moves back toward previous roots:
+      vector<int> ids = tl.getTree().getInnerNodesId();
+      for (size_t k = 0; k < ids.size(); k++)
+      {
+        if (tree->getNode(ids[k])->degree() < 3)
+          continue;
+        tl.rootAt(ids[k]);
+
+        TreeTemplate<Node> rerootedTree(tl.getTree());
+        DRHomogeneousTreeLikelihood fresh(rerootedTree, sites, model.clone(), rdist.clone(), false, false);
+        fresh.initialize();
+
+        cout << "Root " << ids[k] << ": " << tl.getValue() << " vs " << fresh.getValue() << endl;
+        if (!compare(tl, fresh))
+          return 1;
+      }
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
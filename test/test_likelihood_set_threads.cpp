@@ -0,0 +1,212 @@
+//
+// File: test_likelihood_set_threads.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/PhyloTree.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/SimpleSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/FormulaOfPhyloLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/ProductOfAlignedPhyloLikelihood.h>
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+const vector< vector<string> > genes = {
+  {"GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATG", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAAC",
+   "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAG", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGA"},
+  {"ATGTCATTTCTGAATTATTATA", "CAAGTAATATGTTTTAAGAATT", "AACTAACATATATATTATGAAT", "AAATCATTTATGTGAAGGCAAT"},
+  {"GATCAAATATGTCATTTCTGAATTATTATAGAACACGAAAGCATGAATGTT", "ATAAGAAAGTTAAATATCTTATAACCAAGTTTTGAACTGTTTGAATATAAG",
+   "AAATACTGATCAATTCAGATAATTTTCAGAAGTAATACTTTATAAATACTG", "CAGGATCAACAATCTTTAACTTATATCGAAATCGATCGAAAGCCAGGATCA"}
+};
+
+// Member g uses gene g (or the first gene if aligned), and a T92
+// model with its own parameter names. The branch lengths are shared
+// by all members.
+class Member
+{
+  public:
+    unique_ptr<SubstitutionProcess> process;
+    unique_ptr<SingleProcessPhyloLikelihood> lik;
+
+    Member(size_t g, bool aligned) :
+      process(), lik()
+    {
+      const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+      Newick reader;
+      unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("((A:0.1,B:0.2):0.05,C:0.3,D:0.1);"));
+      VectorSiteContainer sites(alphabet);
+      vector<string> names = {"A", "B", "C", "D"};
+      for (size_t i = 0; i < names.size(); i++)
+        sites.addSequence(BasicSequence(names[i], genes[aligned ? 0 : g][i], alphabet));
+      T92* model = new T92(alphabet, 3. + double(g), 0.5);
+      model->setNamespace("T92_" + TextTools::toString(g + 1) + ".");
+      process.reset(new SimpleSubstitutionProcess(model, new ParametrizablePhyloTree(*tree)));
+      lik.reset(new SingleProcessPhyloLikelihood(process.get(), new RecursiveLikelihoodTreeCalculation(sites, process.get(), false, true)));
+    }
+};
+
+void fillContainer(PhyloLikelihoodContainer& pc, vector< unique_ptr<SubstitutionProcess> >& processes, bool aligned)
+{
+  for (size_t g = 0; g < genes.size(); g++)
+  {
+    Member member(g, aligned);
+    pc.addPhyloLikelihood(g + 1, member.lik.release());
+    processes.push_back(move(member.process));
+  }
+}
+
+// Members computed concurrently must give exactly the serial values
+// and branch length derivatives:
+bool compare(PhyloLikelihood& threaded, PhyloLikelihood& serial, const string& step)
+{
+  if (threaded.getValue() != serial.getValue())
+  {
+    cerr << step << ": likelihood " << threaded.getValue() << " instead of " << serial.getValue() << endl;
+    return false;
+  }
+  const ParameterList& pl = serial.getParameters();
+  for (size_t k = 0; k < pl.size(); k++)
+  {
+    const string& name = pl[k].getName();
+    if (name.compare(0, 5, "BrLen") != 0)
+      continue;
+    if (threaded.getFirstOrderDerivative(name) != serial.getFirstOrderDerivative(name)
+        || threaded.getSecondOrderDerivative(name) != serial.getSecondOrderDerivative(name))
+    {
+      cerr << step << ": derivatives for " << name << ": " << threaded.getFirstOrderDerivative(name) << ", " << threaded.getSecondOrderDerivative(name)
+           << " instead of " << serial.getFirstOrderDerivative(name) << ", " << serial.getSecondOrderDerivative(name) << endl;
+      return false;
+    }
+  }
+  AlignedPhyloLikelihood* alignedThreaded = dynamic_cast<AlignedPhyloLikelihood*>(&threaded);
+  AlignedPhyloLikelihood* alignedSerial = dynamic_cast<AlignedPhyloLikelihood*>(&serial);
+  if (alignedSerial)
+  {
+    for (size_t i = 0; i < alignedSerial->getNumberOfSites(); i++)
+      if (alignedThreaded->getLikelihoodForASite(i) != alignedSerial->getLikelihoodForASite(i))
+      {
+        cerr << step << ": likelihood of site " << i << " " << alignedThreaded->getLikelihoodForASite(i) << " instead of " << alignedSerial->getLikelihoodForASite(i) << endl;
+        return false;
+      }
+  }
+  return true;
+}
+
+// Changes of single members, of all members and of shared branch
+// lengths, many times so that members read while being updated would
+// show:
+bool runChanges(PhyloLikelihood& threaded, PhyloLikelihood& serial, const string& name)
+{
+  if (!compare(threaded, serial, name + " at start"))
+    return false;
+
+  string brLen;
+  const ParameterList& pl = serial.getParameters();
+  for (size_t i = 0; i < pl.size() && brLen.empty(); i++)
+    if (pl[i].getName().compare(0, 5, "BrLen") == 0)
+      brLen = pl[i].getName();
+
+  for (size_t n = 0; n < 20; n++)
+  {
+    string kappa = "T92_" + TextTools::toString(n % genes.size() + 1) + ".kappa";
+    double value = 1. + 0.3 * static_cast<double>(n);
+    serial.setParameterValue(kappa, value);
+    threaded.setParameterValue(kappa, value);
+    if (!compare(threaded, serial, name + " with " + kappa + "=" + TextTools::toString(value)))
+      return false;
+
+    value = 0.01 + 0.02 * static_cast<double>(n);
+    serial.setParameterValue(brLen, value);
+    threaded.setParameterValue(brLen, value);
+    if (!compare(threaded, serial, name + " with " + brLen + "=" + TextTools::toString(value)))
+      return false;
+  }
+  return true;
+}
+
+int main() {
+  try {
+    // Fewer threads than members, and one per member:
+    for (size_t nbThreads = 2; nbThreads <= 3; nbThreads++)
+    {
+      {
+        vector< unique_ptr<SubstitutionProcess> > processes, threadedProcesses;
+        PhyloLikelihoodContainer pc, threadedPc;
+        fillContainer(pc, processes, false);
+        fillContainer(threadedPc, threadedProcesses, false);
+        FormulaOfPhyloLikelihood formula(&pc, "phylo1 + phylo2 + phylo3");
+        FormulaOfPhyloLikelihood threadedFormula(&threadedPc, "phylo1 + phylo2 + phylo3");
+        threadedFormula.setNumberOfThreads(nbThreads);
+        if (!runChanges(threadedFormula, formula, "Formula with " + TextTools::toString(nbThreads) + " threads"))
+          return 1;
+      }
+      {
+        vector< unique_ptr<SubstitutionProcess> > processes, threadedProcesses;
+        PhyloLikelihoodContainer pc, threadedPc;
+        fillContainer(pc, processes, true);
+        fillContainer(threadedPc, threadedProcesses, true);
+        ProductOfAlignedPhyloLikelihood product(&pc, {1, 2, 3});
+        ProductOfAlignedPhyloLikelihood threadedProduct(&threadedPc, {1, 2, 3});
+        threadedProduct.setNumberOfThreads(nbThreads);
+        if (!runChanges(threadedProduct, product, "Product with " + TextTools::toString(nbThreads) + " threads"))
+          return 1;
+
+        // Back to one thread:
+        threadedProduct.setNumberOfThreads(1);
+        product.setParameterValue("T92_1.theta", 0.3);
+        threadedProduct.setParameterValue("T92_1.theta", 0.3);
+        if (!compare(threadedProduct, product, "Product back to one thread"))
+          return 1;
+      }
+      cout << "Sets of likelihoods with " << nbThreads << " threads ok." << endl;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
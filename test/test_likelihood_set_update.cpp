@@ -0,0 +1,192 @@
+//
+// File: test_likelihood_set_update.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/PhyloTree.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/SimpleSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/FormulaOfPhyloLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/ProductOfAlignedPhyloLikelihood.h>
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+const vector< vector<string> > genes = {
+  {"GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATG", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAAC",
+   "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAG", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGA"},
+  {"ATGTCATTTCTGAATTATTATA", "CAAGTAATATGTTTTAAGAATT", "AACTAACATATATATTATGAAT", "AAATCATTTATGTGAAGGCAAT"},
+  {"GATCAAATATGTCATTTCTGAATTATTATAGAACACGAAAGCATGAATGTT", "ATAAGAAAGTTAAATATCTTATAACCAAGTTTTGAACTGTTTGAATATAAG",
+   "AAATACTGATCAATTCAGATAATTTTCAGAAGTAATACTTTATAAATACTG", "CAGGATCAACAATCTTTAACTTATATCGAAATCGATCGAAAGCCAGGATCA"}
+};
+
+// Member g uses gene g (or the first gene if aligned), and a T92
+// model with its own parameter names. The branch lengths are shared
+// by all members.
+class Member
+{
+  public:
+    unique_ptr<SubstitutionProcess> process;
+    unique_ptr<SingleProcessPhyloLikelihood> lik;
+
+    Member(size_t g, bool aligned) :
+      process(), lik()
+    {
+      const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+      Newick reader;
+      unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("((A:0.1,B:0.2):0.05,C:0.3,D:0.1);"));
+      VectorSiteContainer sites(alphabet);
+      vector<string> names = {"A", "B", "C", "D"};
+      for (size_t i = 0; i < names.size(); i++)
+        sites.addSequence(BasicSequence(names[i], genes[aligned ? 0 : g][i], alphabet));
+      T92* model = new T92(alphabet, 3. + double(g), 0.5);
+      model->setNamespace("T92_" + TextTools::toString(g + 1) + ".");
+      process.reset(new SimpleSubstitutionProcess(model, new ParametrizablePhyloTree(*tree)));
+      lik.reset(new SingleProcessPhyloLikelihood(process.get(), new RecursiveLikelihoodTreeCalculation(sites, process.get(), false, true)));
+    }
+};
+
+void fillContainer(PhyloLikelihoodContainer& pc, vector< unique_ptr<SubstitutionProcess> >& processes, bool aligned)
+{
+  for (size_t g = 0; g < genes.size(); g++)
+  {
+    Member member(g, aligned);
+    pc.addPhyloLikelihood(g + 1, member.lik.release());
+    processes.push_back(move(member.process));
+  }
+}
+
+// The first branch length, shared by all members:
+string brLen;
+
+bool isClose(double a, double b)
+{
+  return abs(a - b) <= 1e-9 * max(1., abs(b));
+}
+
+// Compare the set with members computed from scratch on its parameters:
+bool checkSet(PhyloLikelihood& set, bool aligned, const string& step)
+{
+  ParameterList parameters = set.getParameters();
+  double logLik = 0, dValue = 0;
+  for (size_t g = 0; g < genes.size(); g++)
+  {
+    Member member(g, aligned);
+    member.lik->matchParametersValues(parameters);
+    logLik += member.lik->getLogLikelihood();
+    dValue += member.lik->getFirstOrderDerivative(brLen);
+  }
+  if (!isClose(set.getLogLikelihood(), logLik) || !isClose(set.getFirstOrderDerivative(brLen), dValue)) {
+    cerr << step << ": " << set.getLogLikelihood() << " instead of " << logLik << ", derivative "
+         << set.getFirstOrderDerivative(brLen) << " instead of " << dValue << "." << endl;
+    return false;
+  }
+  return true;
+}
+
+bool runChanges(PhyloLikelihood& set, bool aligned)
+{
+  const ParameterList& pl = set.getParameters();
+  for (size_t i = 0; i < pl.size() && brLen.empty(); i++)
+    if (pl[i].getName().compare(0, 5, "BrLen") == 0)
+      brLen = pl[i].getName();
+
+  if (!checkSet(set, aligned, "Initial values"))
+    return false;
+
+  // A parameter of a single member:
+  set.setParameterValue("T92_2.kappa", 6.);
+  if (!checkSet(set, aligned, "After changing T92_2.kappa"))
+    return false;
+
+  // Parameters of two members at once:
+  ParameterList parameters = set.getParameters();
+  parameters.setParameterValue("T92_1.theta", 0.3);
+  parameters.setParameterValue("T92_3.kappa", 1.5);
+  set.matchParametersValues(parameters);
+  if (!checkSet(set, aligned, "After changing T92_1.theta and T92_3.kappa"))
+    return false;
+
+  // A parameter shared by all members:
+  set.setParameterValue(brLen, 0.4);
+  if (!checkSet(set, aligned, "After changing " + brLen))
+    return false;
+
+  // Back to a previous value, then no change at all:
+  set.setParameterValue("T92_2.kappa", 4.);
+  set.matchParametersValues(set.getParameters());
+  if (!checkSet(set, aligned, "After changing T92_2.kappa back"))
+    return false;
+
+  return true;
+}
+
+int main() {
+  try {
+    {
+      vector< unique_ptr<SubstitutionProcess> > processes;
+      PhyloLikelihoodContainer pc;
+      fillContainer(pc, processes, false);
+      FormulaOfPhyloLikelihood formula(&pc, "phylo1 + phylo2 + phylo3");
+      if (!runChanges(formula, false))
+        return 1;
+      cout << "Formula of likelihoods ok." << endl;
+    }
+    {
+      vector< unique_ptr<SubstitutionProcess> > processes;
+      PhyloLikelihoodContainer pc;
+      fillContainer(pc, processes, true);
+      ProductOfAlignedPhyloLikelihood product(&pc, {1, 2, 3});
+      if (!runChanges(product, true))
+        return 1;
+      cout << "Product of aligned likelihoods ok." << endl;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,266 @@
+//
+// File: test_likelihood_threads.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/NucleotideFrequenciesSet.h>
+#include <Bpp/Phyl/Model/SubstitutionModelSetTools.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/RNonHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <iostream>
+#include <functional>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+// Threads only split the sites (or the classes), so that the results
+// have to be exactly the same as the serial ones.
+template<class Likelihood>
+bool compare(const Likelihood& threaded, const Likelihood& serial, const ParameterList& brLens, size_t nbThreads)
+{
+  if (threaded.getValue() != serial.getValue())
+  {
+    cerr << nbThreads << " threads: likelihood " << threaded.getValue() << " instead of " << serial.getValue() << endl;
+    return false;
+  }
+  for (size_t k = 0; k < brLens.size(); k++)
+  {
+    string name = brLens[k].getName();
+    if (threaded.getFirstOrderDerivative(name) != serial.getFirstOrderDerivative(name)
+        || threaded.getSecondOrderDerivative(name) != serial.getSecondOrderDerivative(name))
+    {
+      cerr << nbThreads << " threads: derivatives for " << name << " differ." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Likelihoods created by create() with several threads, and their
+// clones, have to match the serial one, also after changes of
+// parameters and back to one thread:
+template<class Likelihood>
+bool checkThreads(Likelihood& serial, const function<Likelihood*()>& create, size_t nbSites)
+{
+  ParameterList brLens = serial.getBranchLengthsParameters();
+  for (size_t nbThreads = 2; nbThreads <= 7; nbThreads += 5)
+  {
+    unique_ptr<Likelihood> threaded(create());
+    threaded->initialize();
+    threaded->setNumberOfThreads(nbThreads);
+    threaded->matchParametersValues(serial.getParameters());
+    if (threaded->getNumberOfThreads() != nbThreads)
+      return false;
+    if (!compare(*threaded, serial, brLens, nbThreads))
+      return false;
+
+    //After an update of the arrays:
+    ParameterList pl;
+    pl.addParameter(Parameter("T92.kappa", 4.));
+    pl.addParameter(Parameter(brLens[2].getName(), 0.3));
+    serial.matchParametersValues(pl);
+    threaded->matchParametersValues(pl);
+    if (!compare(*threaded, serial, brLens, nbThreads))
+      return false;
+    for (size_t i = 0; i < nbSites; i++)
+      if (threaded->getLogLikelihoodForASite(i) != serial.getLogLikelihoodForASite(i))
+      {
+        cerr << nbThreads << " threads: site " << i << " differs." << endl;
+        return false;
+      }
+
+    //Clones keep the number of threads:
+    unique_ptr<Likelihood> copy(threaded->clone());
+    if (copy->getNumberOfThreads() != nbThreads)
+    {
+      cerr << "Clone has " << copy->getNumberOfThreads() << " threads instead of " << nbThreads << "." << endl;
+      return false;
+    }
+    pl.setParameterValue(brLens[0].getName(), 0.2);
+    serial.matchParametersValues(pl);
+    copy->matchParametersValues(pl);
+    if (!compare(*copy, serial, brLens, nbThreads))
+      return false;
+
+    //Back to one thread:
+    copy->setNumberOfThreads(1);
+    pl.setParameterValue("T92.kappa", 3.5);
+    serial.matchParametersValues(pl);
+    copy->matchParametersValues(pl);
+    if (copy->getNumberOfThreads() != 1 || !compare(*copy, serial, brLens, 1))
+      return false;
+  }
+  return true;
+}
+
+SubstitutionModelSet* createModelSet(const NucleicAlphabet* alphabet, const Tree& tree)
+{
+  vector<string> globalParameterNames;
+  globalParameterNames.push_back("T92.kappa");
+  map<string, string> alias;
+  SubstitutionModelSet* modelSet = SubstitutionModelSetTools::createNonHomogeneousModelSet(
+      new T92(alphabet, 3., 0.6), new GCFrequenciesSet(alphabet, 0.4), &tree, alias, globalParameterNames);
+  modelSet->setParameterValue("T92.theta_1", 0.3);
+  modelSet->setParameterValue("T92.theta_2", 0.8);
+  return modelSet;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  string newick = "((A:0.1,B:0.2):0.05,((C:0.3,D:0.1):0.2,G:0.12):0.07,(E:0.15,F:0.25):0.1);";
+
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATGTCATTTCTGAATTATTATA", alphabet));
+  sites.addSequence(BasicSequence("B", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("C", "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAGAACTAACATATATATTATG", alphabet));
+  sites.addSequence(BasicSequence("D", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGAAAATCATTTATGTGAAGGC", alphabet));
+  sites.addSequence(BasicSequence("E", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAATTCAGATAATTTTCAGAACTAACA", alphabet));
+  sites.addSequence(BasicSequence("F", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("G", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCAAGCATGAATGTTCAGTGAGT", alphabet));
+
+  T92 model(alphabet, 3., 0.6);
+
+  try {
+    //Sites split between threads, with block sizes not all equal:
+    unique_ptr<TreeTemplate<Node> > tree(reader.parenthesisToTree(newick));
+    GammaDiscreteDistribution rdist(4, 0.5);
+    DRHomogeneousTreeLikelihood serial(*tree, sites, model.clone(), rdist.clone(), true, false);
+    serial.initialize();
+    ParameterList brLens = serial.getBranchLengthsParameters();
+    for (size_t nbThreads = 2; nbThreads <= 7; nbThreads += 5)
+    {
+      DRHomogeneousTreeLikelihood threaded(*tree, sites, model.clone(), rdist.clone(), true, false);
+      threaded.initialize();
+      threaded.setNumberOfThreads(nbThreads);
+      threaded.matchParametersValues(serial.getParameters());
+      if (threaded.getNumberOfThreads() != nbThreads)
+        return 1;
+      if (!compare(threaded, serial, brLens, nbThreads))
+        return 1;
+
+      //After an update of the arrays:
+      ParameterList pl;
+      pl.addParameter(Parameter("T92.kappa", 4.));
+      pl.addParameter(Parameter(brLens[2].getName(), 0.3));
+      serial.matchParametersValues(pl);
+      threaded.matchParametersValues(pl);
+      if (!compare(threaded, serial, brLens, nbThreads))
+        return 1;
+      for (size_t i = 0; i < sites.getNumberOfSites(); i++)
+        if (threaded.getLogLikelihoodForASite(i) != serial.getLogLikelihoodForASite(i))
+        {
+          cerr << nbThreads << " threads: site " << i << " differs." << endl;
+          return 1;
+        }
+
+      //Back to one thread:
+      threaded.setNumberOfThreads(1);
+      pl.setParameterValue("T92.kappa", 3.5);
+      serial.matchParametersValues(pl);
+      threaded.matchParametersValues(pl);
+      if (!compare(threaded, serial, brLens, 1))
+        return 1;
+    }
+    cout << "Threaded sites ok." << endl;
+
+    //Recursive likelihoods, homogeneous and non-homogeneous:
+    RHomogeneousTreeLikelihood serialR(*tree, sites, model.clone(), rdist.clone(), true, false);
+    serialR.initialize();
+    function<RHomogeneousTreeLikelihood*()> createR = [&]() {
+      return new RHomogeneousTreeLikelihood(*tree, sites, model.clone(), rdist.clone(), true, false);
+    };
+    if (!checkThreads(serialR, createR, sites.getNumberOfSites()))
+      return 1;
+    cout << "Threaded recursive likelihood ok." << endl;
+
+    unique_ptr<TreeTemplate<Node> > rootedTree(reader.parenthesisToTree("(((A:0.1,B:0.2):0.05,((C:0.3,D:0.1):0.2,G:0.12):0.07):0.04,(E:0.15,F:0.25):0.1);"));
+    RNonHomogeneousTreeLikelihood serialNH(*rootedTree, sites, createModelSet(alphabet, *rootedTree), rdist.clone(), false);
+    serialNH.initialize();
+    function<RNonHomogeneousTreeLikelihood*()> createNH = [&]() {
+      return new RNonHomogeneousTreeLikelihood(*rootedTree, sites, createModelSet(alphabet, *rootedTree), rdist.clone(), false);
+    };
+    if (!checkThreads(serialNH, createNH, sites.getNumberOfSites()))
+      return 1;
+    cout << "Threaded non-homogeneous recursive likelihood ok." << endl;
+
+    //Rate classes split between threads:
+    unique_ptr<PhyloTree> phyloTree(reader.parenthesisToPhyloTree(newick, false, "", false, false));
+    ParametrizablePhyloTree pTree(*phyloTree);
+    GammaDiscreteRateDistribution rdist2(5, 0.5);
+    unique_ptr<RateAcrossSitesSubstitutionProcess> process1(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist2.clone(), pTree.clone()));
+    SingleProcessPhyloLikelihood serial2(process1.get(), new RecursiveLikelihoodTreeCalculation(sites, process1.get(), false, false));
+    ParameterList brLens2 = serial2.getBranchLengthParameters();
+    for (size_t nbThreads = 2; nbThreads <= 5; nbThreads += 3)
+    {
+      unique_ptr<RateAcrossSitesSubstitutionProcess> process2(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist2.clone(), pTree.clone()));
+      RecursiveLikelihoodTreeCalculation* calc = new RecursiveLikelihoodTreeCalculation(sites, process2.get(), false, false);
+      calc->setNumberOfThreads(nbThreads);
+      SingleProcessPhyloLikelihood threaded2(process2.get(), calc);
+      threaded2.matchParametersValues(serial2.getParameters());
+      if (!compare(threaded2, serial2, brLens2, nbThreads))
+        return 1;
+
+      ParameterList pl;
+      pl.addParameter(Parameter("T92.theta", 0.4));
+      pl.addParameter(Parameter(brLens2[1].getName(), 0.3));
+      serial2.matchParametersValues(pl);
+      threaded2.matchParametersValues(pl);
+      if (!compare(threaded2, serial2, brLens2, nbThreads))
+        return 1;
+    }
+    cout << "Threaded classes ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
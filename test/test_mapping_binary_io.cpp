@@ -0,0 +1,179 @@
+//
+// File: test_mapping_binary_io.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/DNA.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Mapping/SubstitutionRegister.h>
+#include <Bpp/Phyl/Mapping/BinaryMappingStream.h>
+#include <Bpp/Phyl/Mapping/SubstitutionMappingTools.h>
+#include <iostream>
+#include <sstream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  try {
+    //Blocks of counts:
+    vector<uint> ids = {3, 1, 4};
+    vector<string> typeNames = {"a", "b"};
+    vector<VVVdouble> blocks(2);
+    VectorTools::resize3(blocks[0], 5, ids.size(), typeNames.size());
+    VectorTools::resize3(blocks[1], 2, ids.size(), typeNames.size());
+    for (size_t b = 0; b < blocks.size(); ++b)
+      for (size_t i = 0; i < blocks[b].size(); ++i)
+        for (size_t k = 0; k < ids.size(); ++k)
+          for (size_t t = 0; t < typeNames.size(); ++t)
+            blocks[b][i][k][t] = static_cast<double>(1000 * b + 100 * i + 10 * k + t) / 3.;
+
+    stringstream ss1(ios::in | ios::out | ios::binary);
+    BinaryMappingWriter writer(ss1, ids, typeNames);
+    for (auto& block : blocks)
+      writer.writeBlock(block);
+    if (writer.getNumberOfSitesWritten() != 7) {
+      cerr << "Bad number of sites written: " << writer.getNumberOfSitesWritten() << "." << endl;
+      return 1;
+    }
+    VVVdouble badBlock;
+    VectorTools::resize3(badBlock, 1, ids.size(), 1);
+    try {
+      writer.writeBlock(badBlock);
+      cerr << "Writing a block with a bad number of types should fail!" << endl;
+      return 1;
+    } catch (BadSizeException& ex) {}
+
+    BinaryMappingReader reader(ss1);
+    if (reader.getBranchIds() != ids || reader.getTypeNames() != typeNames) {
+      cerr << "Bad header read." << endl;
+      return 1;
+    }
+    VVVdouble block;
+    for (auto& expected : blocks) {
+      if (!reader.readBlock(block) || block != expected) {
+        cerr << "Bad block read." << endl;
+        return 1;
+      }
+    }
+    if (reader.readBlock(block)) {
+      cerr << "Read a block after the end of the stream." << endl;
+      return 1;
+    }
+    cout << "Blocks of counts ok." << endl;
+
+    //Truncated and foreign streams:
+    string truncated = ss1.str().substr(0, ss1.str().size() - 4);
+    stringstream ss2(truncated, ios::in | ios::binary);
+    BinaryMappingReader reader2(ss2);
+    try {
+      while (reader2.readBlock(block)) {}
+      cerr << "Reading a truncated stream should fail!" << endl;
+      return 1;
+    } catch (IOException& ex) {}
+    stringstream ss3("((A,B),C);", ios::in | ios::binary);
+    try {
+      BinaryMappingReader reader3(ss3);
+      cerr << "Reading a foreign stream should fail!" << endl;
+      return 1;
+    } catch (IOException& ex) {}
+    cout << "Bad streams ok." << endl;
+
+    //Whole mapping, with site patterns, by blocks of sites:
+    Newick newick;
+    unique_ptr<PhyloTree> tree(newick.parenthesisToPhyloTree("((A:0.1,B:0.2):0.3,C:0.4,D:0.5);", false, "", false, false));
+    DNA alphabet;
+    GTR model(&alphabet);
+    ComprehensiveSubstitutionRegister reg(model.getStateMap());
+    size_t nbTypes = reg.getNumberOfSubstitutionTypes();
+    vector<size_t> patterns = {0, 1, 0, 2, 3, 3, 1};
+    ProbabilisticSubstitutionMapping counts(*tree, nbTypes, patterns, 4);
+    vector<uint> edges = counts.getAllEdgesIndexes();
+    for (auto id : edges)
+      for (size_t i = 0; i < 4; ++i)
+        for (size_t t = 0; t < nbTypes; ++t)
+          counts(id, i, t) = static_cast<double>(100 * id + 10 * i + t) / 7.;
+
+    stringstream ss4(ios::in | ios::out | ios::binary);
+    SubstitutionMappingTools::writeToBinaryStream(counts, reg, ss4, 3);
+    ProbabilisticSubstitutionMapping counts2(*tree);
+    SubstitutionMappingTools::readFromBinaryStream(ss4, counts2);
+    if (counts2.getNumberOfSites() != patterns.size() || counts2.getNumberOfSubstitutionTypes() != nbTypes) {
+      cerr << "Bad size of the mapping read: " << counts2.getNumberOfSites() << " sites and " << counts2.getNumberOfSubstitutionTypes() << " types." << endl;
+      return 1;
+    }
+    for (auto id : edges) {
+      for (size_t i = 0; i < patterns.size(); ++i) {
+        for (size_t t = 0; t < nbTypes; ++t) {
+          if (counts2.getCount(id, i, t) != counts.getCount(id, i, t)) {
+            cerr << "Count differs for branch " << id << ", site " << i << " and type " << t << "." << endl;
+            return 1;
+          }
+        }
+      }
+    }
+    ss4.clear();
+    ss4.seekg(0);
+    BinaryMappingReader reader4(ss4);
+    for (size_t t = 0; t < nbTypes; ++t) {
+      if (reader4.getTypeNames()[t] != reg.getTypeName(t + 1)) {
+        cerr << "Bad name for type " << t + 1 << "." << endl;
+        return 1;
+      }
+    }
+    cout << "Mapping round trip ok." << endl;
+
+    //Branches unknown to the mapping read:
+    unique_ptr<PhyloTree> smallTree(newick.parenthesisToPhyloTree("(A:0.1,B:0.2);", false, "", false, false));
+    ProbabilisticSubstitutionMapping counts3(*smallTree);
+    ss4.clear();
+    ss4.seekg(0);
+    try {
+      SubstitutionMappingTools::readFromBinaryStream(ss4, counts3);
+      cerr << "Reading counts of unknown branches should fail!" << endl;
+      return 1;
+    } catch (IOException& ex) {
+      cout << "Ok, reading counts of unknown branches throws an exception." << endl;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
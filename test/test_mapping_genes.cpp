@@ -0,0 +1,150 @@
+//
+// File: test_mapping_genes.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/DNA.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Simulation/SubstitutionProcessSequenceSimulator.h>
+#include <Bpp/Phyl/Mapping/SubstitutionRegister.h>
+#include <Bpp/Phyl/Mapping/DecompositionSubstitutionCount.h>
+#include <Bpp/Phyl/Mapping/SubstitutionMappingTools.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <iostream>
+#include <sstream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  try {
+    Newick reader;
+    unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("(((A:0.01, B:0.02):0.03,C:0.1):0.02,(D:0.05,(E:0.2,F:0.07):0.04):0.01);", false, "", false, false));
+    DNA alphabet;
+    GTR model1(&alphabet, 1, 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2);
+    GTR model2(&alphabet, 2, 0.1, 0.5, 0.2, 0.3, 0.3, 0.2, 0.3, 0.2);
+    GammaDiscreteDistribution rdist(4, 0.4, 0.4);
+    ParametrizablePhyloTree pTree(*tree);
+
+    //Genes 0, 2 and 4 share a process, hence its models, genes 1 and 3
+    //have processes of their own:
+    vector< unique_ptr<RateAcrossSitesSubstitutionProcess> > processes;
+    processes.emplace_back(new RateAcrossSitesSubstitutionProcess(model1.clone(), rdist.clone(), pTree.clone()));
+    processes.emplace_back(new RateAcrossSitesSubstitutionProcess(model2.clone(), rdist.clone(), pTree.clone()));
+    processes.emplace_back(new RateAcrossSitesSubstitutionProcess(model1.clone(), rdist.clone(), pTree.clone()));
+    vector<size_t> geneProcesses = {0, 1, 0, 2, 0};
+
+    vector< unique_ptr<SingleProcessPhyloLikelihood> > liks;
+    vector<RecursiveLikelihoodTreeCalculation*> genes;
+    vector<string> geneNames;
+    for (size_t g = 0; g < geneProcesses.size(); ++g) {
+      SubstitutionProcess* process = processes[geneProcesses[g]].get();
+      SimpleSubstitutionProcessSequenceSimulator simulator(*process);
+      unique_ptr<SiteContainer> sites(simulator.simulate(100 + 50 * g, static_cast<unsigned int>(g + 1)));
+      liks.emplace_back(new SingleProcessPhyloLikelihood(process, new RecursiveLikelihoodTreeCalculation(*sites, process, false, true)));
+      liks[g]->getValue();
+      genes.push_back(dynamic_cast<RecursiveLikelihoodTreeCalculation*>(liks[g]->getLikelihoodCalculation()));
+      geneNames.push_back("gene" + TextTools::toString(g));
+    }
+
+    ComprehensiveSubstitutionRegister reg(model1.getStateMap());
+    vector<uint> ids = pTree.getAllEdgesIndexes();
+
+    //Expected output, gene per gene:
+    ostringstream expected;
+    expected << "Gene\tBranch";
+    for (size_t t = 0; t < reg.getNumberOfSubstitutionTypes(); ++t)
+      expected << "\t" << reg.getTypeName(t + 1);
+    expected << endl;
+    for (size_t g = 0; g < genes.size(); ++g) {
+      const SubstitutionModel* sm = dynamic_cast<const SubstitutionModel*>(genes[g]->getSubstitutionProcess()->getModel(ids[0], 0));
+      DecompositionSubstitutionCount count(sm, reg.clone());
+      unique_ptr<ProbabilisticSubstitutionMapping> mapping(SubstitutionMappingTools::computeCounts(*genes[g], ids, count, -1, false, 1));
+      for (auto id : ids) {
+        Vdouble cou = SubstitutionMappingTools::getCountsForBranchPerType(*mapping, id);
+        expected << geneNames[g] << "\t" << id;
+        for (size_t t = 0; t < cou.size(); ++t)
+          expected << "\t" << cou[t];
+        expected << endl;
+      }
+    }
+
+    for (size_t nbThreads = 1; nbThreads <= 8; nbThreads *= 2) {
+      for (size_t run = 0; run < 5; ++run) {
+        ostringstream out;
+        SubstitutionMappingTools::outputPerGenePerBranchPerType(genes, geneNames, ids, reg, out, 0, 0, -1, false, nbThreads);
+        if (out.str() != expected.str()) {
+          cerr << "Output with " << nbThreads << " threads differs from the gene per gene one:" << endl << out.str() << endl;
+          return 1;
+        }
+      }
+    }
+    cout << "Mapping per gene ok." << endl;
+
+    //Counts already set on the model of the process give the same
+    //counts, with or without threads:
+    const SubstitutionModel* sm = dynamic_cast<const SubstitutionModel*>(genes[1]->getSubstitutionProcess()->getModel(ids[0], 0));
+    DecompositionSubstitutionCount setCount(sm, reg.clone());
+    DecompositionSubstitutionCount freshCount(&model1, reg.clone());
+    vector<SubstitutionCount*> setCounts = {&setCount};
+    vector<SubstitutionCount*> freshCounts = {&freshCount};
+    unique_ptr<ProbabilisticSubstitutionMapping> fresh(SubstitutionMappingTools::computeCounts(*genes[1], ids, freshCounts, -1, false, 1, false)[0]);
+    for (size_t nbThreads = 1; nbThreads <= 4; nbThreads += 3) {
+      unique_ptr<ProbabilisticSubstitutionMapping> setMapping(SubstitutionMappingTools::computeCounts(*genes[1], ids, setCounts, -1, false, nbThreads, true)[0]);
+      for (auto id : ids) {
+        if (setMapping->getEdge(id)->getCounts() != fresh->getEdge(id)->getCounts()) {
+          cerr << "Counts already set differ on branch " << id << " with " << nbThreads << " threads." << endl;
+          return 1;
+        }
+      }
+    }
+    if (setCount.getSubstitutionModel() != sm) {
+      cerr << "Counts already set were set on another model." << endl;
+      return 1;
+    }
+    cout << "Counts already set ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
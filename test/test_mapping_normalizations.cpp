@@ -0,0 +1,155 @@
+//
+// File: test_mapping_normalizations.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/DNA.h>
+#include <Bpp/Seq/AlphabetIndex/UserAlphabetIndex1.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/BranchedModelSet.h>
+#include <Bpp/Phyl/Simulation/SubstitutionProcessSequenceSimulator.h>
+#include <Bpp/Phyl/Mapping/SubstitutionRegister.h>
+#include <Bpp/Phyl/Mapping/DecompositionReward.h>
+#include <Bpp/Phyl/Mapping/RewardMappingTools.h>
+#include <Bpp/Phyl/Mapping/SubstitutionMappingTools.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+//Two null models, each on half of the branches:
+class TwoModelSet :
+  public BranchedModelSet
+{
+  private:
+    GTR* model1_;
+    GTR* model2_;
+    vector<uint> branches1_, branches2_;
+
+  public:
+    TwoModelSet(GTR* model1, GTR* model2, const vector<uint>& branches1, const vector<uint>& branches2) :
+      model1_(model1), model2_(model2), branches1_(branches1), branches2_(branches2) {}
+
+    TwoModelSet(const TwoModelSet& set) :
+      model1_(set.model1_), model2_(set.model2_), branches1_(set.branches1_), branches2_(set.branches2_) {}
+
+    TwoModelSet& operator=(const TwoModelSet& set) {
+      model1_ = set.model1_;
+      model2_ = set.model2_;
+      branches1_ = set.branches1_;
+      branches2_ = set.branches2_;
+      return *this;
+    }
+
+    size_t getNumberOfModels() const { return 2; }
+    vector<size_t> getModelNumbers() const { return {1, 2}; }
+    const TransitionModel* getModel(size_t index) const { return index == 1 ? model1_ : model2_; }
+    const TransitionModel* getModelForBranch(uint branchId) const { return VectorTools::contains(branches1_, branchId) ? model1_ : model2_; }
+    TransitionModel* getModelForBranch(uint branchId) { return VectorTools::contains(branches1_, branchId) ? model1_ : model2_; }
+    vector<uint> getBranchesWithModel(size_t index) const { return index == 1 ? branches1_ : branches2_; }
+};
+
+int main() {
+  try {
+    Newick reader;
+    unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("(((A:0.01, B:0.02):0.03,C:0.1):0.02,(D:0.05,(E:0.2,F:0.07):0.04):0.01);", false, "", false, false));
+    DNA alphabet;
+    GTR model(&alphabet, 1, 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2);
+    GammaDiscreteDistribution rdist(4, 0.4, 0.4);
+    ParametrizablePhyloTree pTree(*tree);
+    unique_ptr<RateAcrossSitesSubstitutionProcess> process(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist.clone(), pTree.clone()));
+
+    SimpleSubstitutionProcessSequenceSimulator simulator(*process);
+    unique_ptr<SiteContainer> sites(simulator.simulate(300, 7));
+
+    SingleProcessPhyloLikelihood lik(process.get(), new RecursiveLikelihoodTreeCalculation(*sites, process.get(), false, true));
+    cout << "LogLik: " << lik.getValue() << endl;
+    RecursiveLikelihoodTreeCalculation& rltc = *dynamic_cast<RecursiveLikelihoodTreeCalculation*>(lik.getLikelihoodCalculation());
+
+    vector<uint> nodeIds = pTree.getAllEdgesIndexes();
+    vector<uint> branches1(nodeIds.begin(), nodeIds.begin() + nodeIds.size() / 2);
+    vector<uint> branches2(nodeIds.begin() + nodeIds.size() / 2, nodeIds.end());
+    GTR null1(&alphabet);
+    GTR null2(&alphabet, 2, 0.5, 0.3, 0.4, 0.4, 0.4, 0.1, 0.1, 0.4);
+    TwoModelSet nullModels(&null1, &null2, branches1, branches2);
+
+    ComprehensiveSubstitutionRegister reg(model.getStateMap());
+    size_t nbTypes = reg.getNumberOfSubstitutionTypes();
+    unique_ptr<ProbabilisticSubstitutionMapping> normalizations(SubstitutionMappingTools::computeNormalizations(rltc, nodeIds, &nullModels, reg, 0, false));
+
+    //The same, one type and one traversal at a time:
+    vector<int> states = model.getAlphabetStates();
+    size_t nbStates = states.size();
+    const vector<size_t>& types = reg.getTypeMatrix();
+    size_t nbTypeStates = reg.getStateMap().getNumberOfModelStates();
+    for (size_t m = 1; m <= 2; ++m) {
+      const GTR& nullModel = (m == 1 ? null1 : null2);
+      vector<uint> mids = nullModels.getBranchesWithModel(m);
+      for (size_t t = 0; t < nbTypes; ++t) {
+        UserAlphabetIndex1 index(&alphabet);
+        for (size_t i = 0; i < nbStates; ++i)
+          index.setIndex(states[i], 0);
+        for (size_t i = 0; i < nbStates; ++i)
+          for (size_t j = 0; j < nbStates; ++j)
+            if (i != j && types[i * nbTypeStates + j] == t + 1)
+              index.setIndex(states[i], index.getIndex(states[i]) + nullModel.Qij(i, j));
+        DecompositionReward reward(&nullModel, &index);
+        unique_ptr<ProbabilisticRewardMapping> mapping(RewardMappingTools::computeRewardVectors(rltc, mids, reward, false));
+        for (auto id : mids) {
+          for (size_t i = 0; i < normalizations->getNumberOfDistinctSites(); ++i) {
+            if ((*normalizations)(id, i, t) != mapping->getEdge(id)->getSiteReward(i)) {
+              cerr << "Normalization of type " << t + 1 << " differs on branch " << id << " at site index " << i << ": "
+                   << (*normalizations)(id, i, t) << " vs " << mapping->getEdge(id)->getSiteReward(i) << "." << endl;
+              return 1;
+            }
+          }
+        }
+      }
+    }
+    cout << "Normalizations ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
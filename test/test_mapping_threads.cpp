@@ -0,0 +1,147 @@
+//
+// File: test_mapping_threads.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/DNA.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Simulation/SubstitutionProcessSequenceSimulator.h>
+#include <Bpp/Phyl/Mapping/SubstitutionRegister.h>
+#include <Bpp/Phyl/Mapping/DecompositionSubstitutionCount.h>
+#include <Bpp/Phyl/Mapping/UniformizationSubstitutionCount.h>
+#include <Bpp/Phyl/Mapping/SubstitutionMappingTools.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+bool sameMappings(const ProbabilisticSubstitutionMapping& m1, const ProbabilisticSubstitutionMapping& m2) {
+  vector<uint> ids = m1.getAllEdgesIndexes();
+  if (ids.empty())
+    return false;
+  for (auto id : ids) {
+    if (m1.getEdge(id)->getCounts() != m2.getEdge(id)->getCounts()) {
+      cerr << "Counts differ on branch " << id << "." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  try {
+    Newick reader;
+    unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("(((A:0.01, B:0.02):0.03,C:0.1):0.02,(D:0.05,(E:0.2,F:0.07):0.04):0.01);", false, "", false, false));
+    DNA alphabet;
+    GTR model(&alphabet, 1, 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2);
+    GammaDiscreteDistribution rdist(4, 0.4, 0.4);
+    ParametrizablePhyloTree pTree(*tree);
+    unique_ptr<RateAcrossSitesSubstitutionProcess> process(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist.clone(), pTree.clone()));
+
+    SimpleSubstitutionProcessSequenceSimulator simulator(*process);
+    unique_ptr<SiteContainer> sites(simulator.simulate(500, 42));
+
+    SingleProcessPhyloLikelihood lik(process.get(), new RecursiveLikelihoodTreeCalculation(*sites, process.get(), false, true));
+    cout << "LogLik: " << lik.getValue() << endl;
+    RecursiveLikelihoodTreeCalculation& rltc = *dynamic_cast<RecursiveLikelihoodTreeCalculation*>(lik.getLikelihoodCalculation());
+
+    DecompositionSubstitutionCount decCount(&model, new ComprehensiveSubstitutionRegister(model.getStateMap()));
+    UniformizationSubstitutionCount uniCount(&model, new TotalSubstitutionRegister(model.getStateMap()));
+    vector<SubstitutionCount*> counts = {&decCount, &uniCount};
+
+    //One count at a time:
+    for (auto count : counts) {
+      unique_ptr<ProbabilisticSubstitutionMapping> serial(SubstitutionMappingTools::computeCounts(rltc, *count, -1, false, 1));
+      for (size_t nbThreads = 2; nbThreads <= 16; nbThreads *= 2) {
+        unique_ptr<ProbabilisticSubstitutionMapping> threaded(SubstitutionMappingTools::computeCounts(rltc, *count, -1, false, nbThreads));
+        if (!sameMappings(*serial, *threaded)) {
+          cerr << "Mapping with " << nbThreads << " threads differs from the serial one." << endl;
+          return 1;
+        }
+      }
+    }
+    cout << "Threaded counts ok." << endl;
+
+    //Several counts at once, on some of the branches:
+    vector<uint> nodeIds = pTree.getAllEdgesIndexes();
+    nodeIds.resize(nodeIds.size() - 2);
+    vector<ProbabilisticSubstitutionMapping*> serials = SubstitutionMappingTools::computeCounts(rltc, nodeIds, counts, -1, false, 1);
+    vector<ProbabilisticSubstitutionMapping*> threadeds = SubstitutionMappingTools::computeCounts(rltc, nodeIds, counts, -1, false, 3);
+    bool ok = true;
+    for (size_t k = 0; k < counts.size(); ++k) {
+      unique_ptr<ProbabilisticSubstitutionMapping> single(SubstitutionMappingTools::computeCounts(rltc, nodeIds, *counts[k], -1, false, 1));
+      for (auto id : nodeIds) {
+        if (serials[k]->getEdge(id)->getCounts() != threadeds[k]->getEdge(id)->getCounts()
+            || serials[k]->getEdge(id)->getCounts() != single->getEdge(id)->getCounts()) {
+          cerr << "Count " << k << " differs on branch " << id << "." << endl;
+          ok = false;
+        }
+      }
+      delete serials[k];
+      delete threadeds[k];
+    }
+    if (!ok)
+      return 1;
+    cout << "Threaded multiple counts ok." << endl;
+
+    //Stress: many runs, on new parameter values each time, so that the
+    //transition probabilities of the models are computed again while
+    //threads share them:
+    for (size_t run = 0; run < 20; ++run) {
+      lik.setParameterValue("GTR.a", 1. + 0.05 * static_cast<double>(run));
+      for (auto count : counts) {
+        unique_ptr<ProbabilisticSubstitutionMapping> serial(SubstitutionMappingTools::computeCounts(rltc, *count, -1, false, 1));
+        unique_ptr<ProbabilisticSubstitutionMapping> threaded(SubstitutionMappingTools::computeCounts(rltc, *count, -1, false, 8));
+        if (!sameMappings(*serial, *threaded)) {
+          cerr << "Mapping with 8 threads differs from the serial one at run " << run << "." << endl;
+          return 1;
+        }
+      }
+    }
+    cout << "Threaded counts stress ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
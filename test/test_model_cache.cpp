@@ -0,0 +1,88 @@
+//
+// File: test_model_cache.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/BppOSubstitutionModelFormat.h>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+double getTheta(BppOSubstitutionModelFormat& bIO, const VectorSiteContainer& sites)
+{
+  unique_ptr<SubstitutionModel> model(bIO.read(&AlphabetTools::DNA_ALPHABET, "HKY85(initFreqs=observed)", &sites, true));
+  return model->getParameterValue("theta");
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "GGCCGGCCATGCGGCC", alphabet));
+  sites.addSequence(BasicSequence("B", "GGCCGACCATGCGGCA", alphabet));
+
+  BppOSubstitutionModelFormat bIO(BppOSubstitutionModelFormat::ALL, true, true, true, false, 0);
+  double theta1 = getTheta(bIO, sites);
+  double theta1Again = getTheta(bIO, sites);
+  cout << "theta: " << theta1 << " then " << theta1Again << endl;
+  if (theta1 != theta1Again)
+    return 1;
+
+  // Same container, new content: the prototype must not be used.
+  sites.deleteSequence("A");
+  sites.addSequence(BasicSequence("A", "AATTAATTATGCAATT", alphabet));
+  double theta2 = getTheta(bIO, sites);
+  BppOSubstitutionModelFormat freshIO(BppOSubstitutionModelFormat::ALL, true, true, true, false, 0);
+  double theta2Fresh = getTheta(freshIO, sites);
+  cout << "theta after modification: " << theta2 << " (fresh reader: " << theta2Fresh << ")" << endl;
+  if (theta2 == theta1 || theta2 != theta2Fresh)
+    return 1;
+
+  // A copy with the same content gives the same model:
+  VectorSiteContainer copy(sites);
+  if (getTheta(bIO, copy) != theta2)
+    return 1;
+
+  bIO.clearModelCache();
+  if (getTheta(bIO, sites) != theta2)
+    return 1;
+  return 0;
+}
@@ -0,0 +1,142 @@
+//
+// File: test_neighbor_joining.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Seq/DistanceMatrix.h>
+#include <Bpp/Phyl/Distance/NeighborJoining.h>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+// Gives access to the pair selection, on a chosen set of current nodes.
+class TestedNeighborJoining :
+  public NeighborJoining
+{
+public:
+  TestedNeighborJoining() : NeighborJoining(false, false, false) {}
+
+  void setCurrentNodes(const vector<size_t>& ids)
+  {
+    currentNodes_.clear();
+    for (size_t id : ids)
+      currentNodes_[id] = 0;
+  }
+
+  vector<size_t> getBestPair() { return NeighborJoining::getBestPair(); }
+};
+
+// The pair with the largest criterion, and the smallest indices in case of ties.
+vector<size_t> getBestPairByFullScan(const DistanceMatrix& matrix, const vector<size_t>& ids)
+{
+  size_t n = ids.size();
+  vector<double> sums(n, 0);
+  for (size_t i = 0; i < n; ++i)
+    for (size_t j = 0; j < n; ++j)
+      sums[i] += matrix(ids[i], ids[j]);
+  double factor = static_cast<double>(n - 2);
+  vector<size_t> best;
+  double critMax = 0;
+  for (size_t i = 0; i < n; ++i)
+    for (size_t j = i + 1; j < n; ++j)
+    {
+      double crit = sums[i] + sums[j] - factor * matrix(ids[i], ids[j]);
+      if (best.empty() || crit > critMax)
+      {
+        critMax = crit;
+        best = {ids[i], ids[j]};
+      }
+    }
+  return best;
+}
+
+int main() {
+  try {
+    size_t n = 12;
+    TestedNeighborJoining nj;
+    for (size_t r = 0; r < 200; ++r)
+    {
+      //Small integer distances, so that there are ties:
+      DistanceMatrix matrix(n);
+      for (size_t i = 0; i < n; ++i)
+        for (size_t j = i + 1; j < n; ++j)
+          matrix(i, j) = matrix(j, i) = static_cast<double>(1 + RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(5));
+      nj.setDistanceMatrix(matrix);
+
+      //All nodes, and a subset as after some agglomerations, down to the last pair:
+      vector<size_t> ids;
+      for (size_t i = 0; i < n; ++i)
+        if (r % 2 == 0 || i % 3 != 1)
+          ids.push_back(i);
+      if (r % 10 == 9)
+        ids.resize(2);
+      nj.setCurrentNodes(ids);
+      vector<size_t> expected = getBestPairByFullScan(matrix, ids);
+      size_t threads[] = {1, 4};
+      for (size_t t : threads)
+      {
+        nj.setNumberOfThreads(t);
+        if (nj.getBestPair() != expected)
+        {
+          cerr << "Replicate " << r << ", " << t << " thread(s): wrong pair." << endl;
+          return 1;
+        }
+      }
+    }
+    cout << "Best pairs ok." << endl;
+
+    //Less than two nodes:
+    for (size_t k = 0; k < 2; ++k)
+    {
+      nj.setCurrentNodes(vector<size_t>(k, 0));
+      try {
+        nj.getBestPair();
+        cerr << "No error with " << k << " node(s)." << endl;
+        return 1;
+      } catch (Exception& ex) {}
+    }
+    cout << "Boundaries ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,160 @@
+//
+// File: test_newick_parallel.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Io/BppOMultiTreeReaderFormat.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace bpp;
+using namespace std;
+
+bool hasCarriageReturn(const Tree& tree)
+{
+  vector<string> names = tree.getLeavesNames();
+  for (size_t i = 0; i < names.size(); i++)
+    if (names[i].find('\r') != string::npos)
+      return true;
+  return false;
+}
+
+// Reads with the given number of threads, and compares with the expected trees.
+bool check(const string& content, const vector<string>& expected, size_t nbThreads)
+{
+  Newick newick;
+  newick.setNumberOfThreads(nbThreads);
+  istringstream in(content);
+  vector<Tree*> trees;
+  newick.read(in, trees);
+  bool ok = (trees.size() == expected.size());
+  if (!ok)
+    cerr << nbThreads << " threads: " << trees.size() << " trees instead of " << expected.size() << "." << endl;
+  for (size_t i = 0; ok && i < trees.size(); i++)
+  {
+    if (hasCarriageReturn(*trees[i]) || TreeTools::treeToParenthesis(*trees[i]) != expected[i])
+    {
+      cerr << nbThreads << " threads: tree " << i << " read as " << TreeTools::treeToParenthesis(*trees[i]) << endl;
+      ok = false;
+    }
+  }
+  for (size_t i = 0; i < trees.size(); i++)
+    delete trees[i];
+  return ok;
+}
+
+int main() {
+  vector<string> leaves(20);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    leaves[i] = "leaf" + TextTools::toString(i);
+
+  //Random trees, one per line with Windows line breaks, some lines with two trees
+  //and some trees over two lines:
+  string content;
+  vector<string> expected;
+  for (size_t i = 0; i < 200; i++)
+  {
+    unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(leaves, true));
+    vector<Node*> nodes = tree->getNodes();
+    for (size_t j = 0; j < nodes.size(); j++)
+      if (nodes[j]->hasFather())
+        nodes[j]->setDistanceToFather(0.01 * static_cast<double>((i + j) % 17 + 1));
+    string description = TreeTools::treeToParenthesis(*tree);
+    expected.push_back(description);
+    if (i % 7 == 3)
+      description.insert(description.size() / 2, "\r\n");
+    content += description + (i % 5 == 0 ? " " : "\r\n");
+  }
+
+  try {
+    for (size_t nbThreads = 1; nbThreads <= 4; nbThreads++)
+      if (!check(content, expected, nbThreads))
+        return 1;
+
+    //Streaming gives the same trees:
+    Newick newick;
+    istringstream in(content);
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+      unique_ptr<TreeTemplate<Node> > tree(newick.readNextTree(in));
+      if (!tree || hasCarriageReturn(*tree) || TreeTools::treeToParenthesis(*tree) != expected[i])
+      {
+        cerr << "Streamed tree " << i << " differs." << endl;
+        return 1;
+      }
+    }
+    cout << "Parallel reading ok." << endl;
+
+    //A parsing error is reported, whatever the thread it occurs in:
+    for (size_t nbThreads = 1; nbThreads <= 4; nbThreads += 3)
+    {
+      Newick parallel;
+      parallel.setNumberOfThreads(nbThreads);
+      istringstream bad(content + "((leaf0,leaf1),leaf2;\r\n" + content);
+      vector<Tree*> trees;
+      try {
+        parallel.read(bad, trees);
+        cerr << "Bad tree was accepted with " << nbThreads << " threads." << endl;
+        return 1;
+      } catch (Exception& ex) {}
+      //The sequential reader keeps the trees read before the error:
+      if (nbThreads > 1 && !trees.empty())
+        return 1;
+      for (size_t i = 0; i < trees.size(); i++)
+        delete trees[i];
+    }
+
+    //The option of the reader format:
+    BppOMultiTreeReaderFormat format(0);
+    unique_ptr<IMultiTree> reader(format.read("Newick(threads=3)"));
+    Newick* threaded = dynamic_cast<Newick*>(reader.get());
+    if (!threaded || threaded->getNumberOfThreads() != 3)
+      return 1;
+    cout << "Parallel errors and options ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,159 @@
+//
+// File: test_newick_parser.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/BppString.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+/**
+ * @brief Parse a description and write it again, the result must be identical.
+ */
+bool roundTrip(const string& description, bool bootstrap = true, const string& propertyName = TreeTools::BOOTSTRAP)
+{
+  unique_ptr< TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree(description, bootstrap, propertyName, false, false));
+  string written = TreeTemplateTools::treeToParenthesis(*tree, bootstrap, propertyName);
+  if (written != description + "\n") {
+    cerr << "Round trip failed:" << endl << description << endl << written;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief A caterpillar tree: ((((l0,l1),l2),l3)...), with branch length i for leaf li.
+ */
+string caterpillar(size_t nbLeaves)
+{
+  string description(nbLeaves - 1, '(');
+  description += "l0:0,l1:1)";
+  for (size_t i = 2; i < nbLeaves; ++i)
+    description += ":0.5,l" + TextTools::toString(i) + ":" + TextTools::toString(i) + ")";
+  return description + ";";
+}
+
+int main() {
+  //Labels, lengths and bootstrap values:
+  if (!roundTrip("((A:0.1,B:0.2)80:0.3,(C:0.4,D:0.5)95:0.6,E:0.7);"))
+    return 1;
+  if (!roundTrip("((A,B)aa:1,(C,D)bb,E)root;", false, "ESS"))
+    return 1;
+  //Quoted labels, which may contain delimiters:
+  if (!roundTrip("(('Homo sapiens':0.1,'x,y (z):w':0.2)80:0.3,'C:D');"))
+    return 1;
+  cout << "Round trips ok." << endl;
+
+  unique_ptr< TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("(('A, b':1,B:2)80:3,C:4);", true, TreeTools::BOOTSTRAP, false, false));
+  if (tree->getNumberOfLeaves() != 3 || tree->getNumberOfNodes() != 5)
+    return 1;
+  const Node* a = tree->getRootNode()->getSon(0)->getSon(0);
+  if (a->getName() != "'A, b'" || a->getDistanceToFather() != 1.)
+    return 1;
+  const Node* ab = tree->getRootNode()->getSon(0);
+  if (!ab->hasBranchProperty(TreeTools::BOOTSTRAP)
+      || dynamic_cast<const Number<double>*>(ab->getBranchProperty(TreeTools::BOOTSTRAP))->getValue() != 80.
+      || ab->getDistanceToFather() != 3.)
+    return 1;
+  tree.reset(TreeTemplateTools::parenthesisToTree("((A,B)aa,C)2;", false, "ESS", false, false));
+  ab = tree->getRootNode()->getSon(0);
+  if (!ab->hasBranchProperty("ESS") || dynamic_cast<const BppString*>(ab->getBranchProperty("ESS"))->toSTL() != "aa")
+    return 1;
+  if (ab->hasBranchProperty(TreeTools::BOOTSTRAP))
+    return 1;
+  cout << "Properties ok." << endl;
+
+  //Malformed descriptions:
+  vector<string> bad = { "((A,B),C;", "(A,B)),C);", "(A,B)(C);", "(A,'B,C);", "(A,B),C;" };
+  for (size_t i = 0; i < bad.size(); ++i) {
+    try {
+      tree.reset(TreeTemplateTools::parenthesisToTree(bad[i], true, TreeTools::BOOTSTRAP, false, false));
+      cerr << "No exception for " << bad[i] << endl;
+      return 1;
+    } catch (Exception& ex) {}
+  }
+  cout << "Malformed descriptions ok." << endl;
+
+  //Deep caterpillar trees:
+  size_t nbLeaves = 5000;
+  string description = caterpillar(nbLeaves);
+  tree.reset(TreeTemplateTools::parenthesisToTree(description, true, TreeTools::BOOTSTRAP, false, false));
+  if (tree->getNumberOfLeaves() != nbLeaves || tree->getNumberOfNodes() != 2 * nbLeaves - 1)
+    return 1;
+  //Walk down the spine, checking each level:
+  const Node* node = tree->getRootNode();
+  for (size_t i = nbLeaves - 1; i > 0; --i) {
+    if (node->getNumberOfSons() != 2)
+      return 1;
+    const Node* leaf = node->getSon(1);
+    if (leaf->getName() != "l" + TextTools::toString(i) || leaf->getDistanceToFather() != static_cast<double>(i))
+      return 1;
+    node = node->getSon(0);
+    if (i > 1 && node->getDistanceToFather() != 0.5)
+      return 1;
+  }
+  if (node->getName() != "l0")
+    return 1;
+  if (TreeTemplateTools::treeToParenthesis(*tree, true, TreeTools::BOOTSTRAP) != description + "\n")
+    return 1;
+
+  Newick reader;
+  unique_ptr<PhyloTree> phyloTree(reader.parenthesisToPhyloTree(description));
+  if (phyloTree->getAllNodes().size() != 2 * nbLeaves - 1 || phyloTree->getAllLeavesNames().size() != nbLeaves)
+    return 1;
+  //Nodes are numbered in the order in which their description ends:
+  shared_ptr<PhyloNode> leaf = phyloTree->getNode(0);
+  if (leaf->getName() != "l0" || phyloTree->getEdgeToFather(leaf)->getLength() != 0.)
+    return 1;
+  leaf = phyloTree->getNode(static_cast<PhyloTree::NodeIndex>(2 * nbLeaves - 3));
+  if (leaf->getName() != "l" + TextTools::toString(nbLeaves - 1))
+    return 1;
+  if (phyloTree->getNodeIndex(phyloTree->getRoot()) != 2 * nbLeaves - 2)
+    return 1;
+  cout << "Deep trees ok." << endl;
+
+  return 0;
+}
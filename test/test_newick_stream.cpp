@@ -0,0 +1,173 @@
+//
+// File: test_newick_stream.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace bpp;
+using namespace std;
+
+// A reader only implementing read(), which gets readTrees() from IMultiTree.
+class VectorReader :
+  public AbstractIMultiTree
+{
+public:
+  const string getFormatName() const { return "Test"; }
+  const string getFormatDescription() const { return "Newick read all at once."; }
+
+  void read(istream& in, vector<Tree*>& trees) const { Newick().read(in, trees); }
+  void read(istream& in, vector<PhyloTree*>& trees) const { Newick().read(in, trees); }
+};
+
+const string input = "((A:1,B:2)90:3,C:4);\n(A,(B,C)); ((A,B),(C,D));\n(\n(A:0.5,\nB:0.5):1,(C:1,\nD:1)75:2,E:3);\n";
+const char* descriptions[] = { "((A:1,B:2)90:3,C:4);", "(A,(B,C));", "((A,B),(C,D));", "((A:0.5,B:0.5):1,(C:1,D:1)75:2,E:3);" };
+
+string getExpected(size_t i)
+{
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree(descriptions[i]));
+  return TreeTools::treeToParenthesis(*tree);
+}
+
+bool checkHandler(const IMultiTree& reader, const string& name)
+{
+  vector<string> read;
+  istringstream in(input);
+  reader.readTrees(in, [&read](Tree* tree) {
+      read.push_back(TreeTools::treeToParenthesis(*tree));
+      delete tree;
+      return true;
+    });
+  if (read.size() != 4)
+  {
+    cerr << name << ": " << read.size() << " trees instead of 4." << endl;
+    return false;
+  }
+  for (size_t i = 0; i < read.size(); i++)
+    if (read[i] != getExpected(i))
+    {
+      cerr << name << ": tree " << i << " is " << read[i] << " instead of " << getExpected(i) << endl;
+      return false;
+    }
+
+  //The handler stops the reading:
+  size_t nbCalls = 0;
+  istringstream in2(input);
+  reader.readTrees(in2, [&nbCalls](Tree* tree) {
+      delete tree;
+      return ++nbCalls < 2;
+    });
+  if (nbCalls != 2)
+  {
+    cerr << name << ": the handler was called " << nbCalls << " times instead of 2." << endl;
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  try {
+    Newick newick;
+    if (!checkHandler(newick, "Newick") || !checkHandler(VectorReader(), "Default"))
+      return 1;
+    cout << "Tree handlers ok." << endl;
+
+    //Trees read into the same object recycle its nodes:
+    istringstream in(input);
+    TreeTemplate<Node> tree;
+    set<const Node*> previous;
+    for (size_t i = 0; i < 4; i++)
+    {
+      if (!newick.readNextTree(in, tree))
+        return 1;
+      if (TreeTools::treeToParenthesis(tree) != getExpected(i))
+      {
+        cerr << "Tree " << i << " read as " << TreeTools::treeToParenthesis(tree) << endl;
+        return 1;
+      }
+      vector<const Node*> nodes = const_cast<const TreeTemplate<Node>&>(tree).getNodes();
+      for (size_t j = 0; j < nodes.size(); j++)
+      {
+        //Nothing is left from the previous tree:
+        if (i == 1 && (nodes[j]->hasDistanceToFather() || nodes[j]->hasBranchProperty(TreeTools::BOOTSTRAP)))
+        {
+          cerr << "Node properties of the previous tree were kept." << endl;
+          return 1;
+        }
+        //A tree not larger than the previous one allocates no node:
+        if (nodes.size() <= previous.size() && previous.find(nodes[j]) == previous.end())
+        {
+          cerr << "A node was allocated for tree " << i << "." << endl;
+          return 1;
+        }
+      }
+      previous = set<const Node*>(nodes.begin(), nodes.end());
+    }
+    if (newick.readNextTree(in, tree) || TreeTools::treeToParenthesis(tree) != getExpected(3))
+    {
+      cerr << "The end of the stream modified the tree." << endl;
+      return 1;
+    }
+
+    //A parsing error leaves a single node:
+    istringstream bad("((A,B),C;");
+    try {
+      newick.readNextTree(bad, tree);
+      cerr << "Bad tree was accepted." << endl;
+      return 1;
+    } catch (Exception& ex) {}
+    if (tree.getNumberOfNodes() != 1)
+      return 1;
+    istringstream good(descriptions[1]);
+    if (!newick.readNextTree(good, tree) || TreeTools::treeToParenthesis(tree) != getExpected(1))
+      return 1;
+    cout << "Recycled nodes ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,159 @@
+//
+// File: test_nni_threads.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTools.h>
+#include <Bpp/Phyl/Tree/NNITopologySearch.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/OptimizationTools.h>
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool isClose(double a, double b)
+{
+  return abs(a - b) <= 1e-9 * max(1., abs(b));
+}
+
+// The nodes whose NNIs can be tested:
+vector<int> getCandidates(const NNIHomogeneousTreeLikelihood& tl)
+{
+  vector<int> candidates;
+  vector<int> ids = tl.getTree().getNodesId();
+  for (size_t k = 0; k < ids.size(); k++)
+  {
+    const Node* node = tl.getTree().getNode(ids[k]);
+    if (node->hasFather() && node->getFather()->hasFather())
+      candidates.push_back(ids[k]);
+  }
+  return candidates;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  // A topology far from the one of the sequences, so that searches move:
+  unique_ptr<TreeTemplate<Node> > tree(reader.parenthesisToTree("((A:0.1,C:0.2):0.05,((B:0.3,E:0.1):0.2,G:0.12):0.07,(D:0.15,F:0.25):0.1);"));
+
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAAATATGTCATTTCTGAATTATTATA", alphabet));
+  sites.addSequence(BasicSequence("B", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("C", "GTAATACTTTATAAATACTGATCAATTCAGATAATTTTCAGAACTAACATATATATTATG", alphabet));
+  sites.addSequence(BasicSequence("D", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCGAAAATCATTTATGTGAAGGC", alphabet));
+  sites.addSequence(BasicSequence("E", "GAACACGAAAGCATGAATGTTCAGTGAGTAGATCAATTCAGATAATTTTCAGAACTAACA", alphabet));
+  sites.addSequence(BasicSequence("F", "TTTGAACTGTTTGAATATAAGAAAGTTAAATATCTTATAACCAAGTAATATGTTTTAAGA", alphabet));
+  sites.addSequence(BasicSequence("G", "TCGATCGAAAGCCAGGATCAACAATCTTTAACTTATATCAAGCATGAATGTTCAGTGAGT", alphabet));
+
+  T92 model(alphabet, 3., 0.6);
+  GammaDiscreteDistribution rdist(4, 0.5);
+
+  try {
+    // Candidates tested together on several threads score as when
+    // tested one at a time:
+    NNIHomogeneousTreeLikelihood serial(*tree, sites, model.clone(), rdist.clone(), true, false);
+    serial.initialize();
+    vector<int> candidates = getCandidates(serial);
+    vector<double> serialDiffs;
+    for (size_t k = 0; k < candidates.size(); k++)
+      serialDiffs.push_back(serial.testNNI(candidates[k]));
+
+    for (size_t nbThreads = 2; nbThreads <= 4; nbThreads += 2)
+    {
+      for (size_t budget = 0; budget < 2; budget++)
+      {
+        unique_ptr<NNIHomogeneousTreeLikelihood> threaded(serial.clone());
+        threaded->setNumberOfThreads(nbThreads);
+        if (budget > 0)
+          threaded->setMemoryBudget(1);
+        vector<double> diffs;
+        threaded->testNNIs(candidates, diffs);
+        if (diffs.size() != candidates.size())
+        {
+          cerr << "Wrong number of tested NNIs." << endl;
+          return 1;
+        }
+        for (size_t k = 0; k < candidates.size(); k++)
+        {
+          if (!isClose(diffs[k], serialDiffs[k]))
+          {
+            cerr << "NNI on node " << candidates[k] << " with " << nbThreads << " threads: " << diffs[k] << " instead of " << serialDiffs[k] << endl;
+            return 1;
+          }
+        }
+      }
+    }
+    cout << "NNIs tested on several threads ok." << endl;
+
+    // Whole searches reach the same tree and likelihood whatever the
+    // number of threads:
+    vector<string> algorithms = { NNITopologySearch::PHYML, NNITopologySearch::BETTER };
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+      NNIHomogeneousTreeLikelihood* serialSearch = new NNIHomogeneousTreeLikelihood(*tree, sites, model.clone(), rdist.clone(), true, false);
+      serialSearch->initialize();
+      NNIHomogeneousTreeLikelihood* threadedSearch = serialSearch->clone();
+      threadedSearch->setNumberOfThreads(3);
+
+      serialSearch = OptimizationTools::optimizeTreeNNI(serialSearch, serialSearch->getBranchLengthsParameters(), false, 100, 100, 1000000, 1, 0, 0, false, 0, OptimizationTools::OPTIMIZATION_NEWTON, 1, algorithms[a]);
+      threadedSearch = OptimizationTools::optimizeTreeNNI(threadedSearch, threadedSearch->getBranchLengthsParameters(), false, 100, 100, 1000000, 1, 0, 0, false, 0, OptimizationTools::OPTIMIZATION_NEWTON, 1, algorithms[a]);
+      unique_ptr<NNIHomogeneousTreeLikelihood> serialResult(serialSearch), threadedResult(threadedSearch);
+
+      if (!TreeTools::haveSameTopology(threadedResult->getTree(), serialResult->getTree())
+          || !isClose(threadedResult->getValue(), serialResult->getValue()))
+      {
+        cerr << algorithms[a] << " search on 3 threads: " << threadedResult->getValue() << " instead of " << serialResult->getValue() << endl;
+        return 1;
+      }
+      cout << algorithms[a] << " search on several threads ok." << endl;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
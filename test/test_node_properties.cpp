@@ -0,0 +1,136 @@
+//
+// File: test_node_properties.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/BppString.h>
+#include <Bpp/Phyl/Tree/Node.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <memory>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+double getBootstrap(const Node& node)
+{
+  return dynamic_cast<const Number<double>*>(node.getBranchProperty(TreeTools::BOOTSTRAP))->getValue();
+}
+
+string getLabel(const Node& node)
+{
+  return dynamic_cast<const BppString*>(node.getNodeProperty("label"))->toSTL();
+}
+
+int main() {
+  Node a(0, "A");
+  a.setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(90.));
+  a.setNodeProperty("label", BppString("x"));
+
+  //Copies share their properties until they modify them:
+  Node b(a);
+  const Node& ca = a;
+  const Node& cb = b;
+  if (cb.getBranchProperty(TreeTools::BOOTSTRAP) != ca.getBranchProperty(TreeTools::BOOTSTRAP))
+    return 1;
+  *dynamic_cast<Number<double>*>(b.getBranchProperty(TreeTools::BOOTSTRAP)) = Number<double>(50.);
+  if (getBootstrap(a) != 90. || getBootstrap(b) != 50.)
+    return 1;
+  b.setNodeProperty("label", BppString("y"));
+  if (getLabel(a) != "x" || getLabel(b) != "y")
+    return 1;
+  Node c(a);
+  a.deleteBranchProperty(TreeTools::BOOTSTRAP);
+  if (a.hasBranchProperty(TreeTools::BOOTSTRAP) || getBootstrap(c) != 90.)
+    return 1;
+  cout << "Copies ok." << endl;
+
+  //Assignment keeps the properties of the target which are not in the source:
+  Node d;
+  d.setNodeProperty("other", BppString("z"));
+  d.setNodeProperty("label", BppString("w"));
+  d = c;
+  if (getLabel(d) != "x" || !d.hasNodeProperty("other") || getBootstrap(d) != 90.)
+    return 1;
+  d.setNodeProperty("label", BppString("v"));
+  if (getLabel(c) != "x")
+    return 1;
+  cout << "Assignment ok." << endl;
+
+  //Removing properties does not delete them:
+  Node e;
+  e.setNodeProperty("label", BppString("u"));
+  e.setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(10.));
+  unique_ptr<Clonable> label(e.getNodeProperty("label"));
+  unique_ptr<Clonable> bootstrap(e.getBranchProperty(TreeTools::BOOTSTRAP));
+  e.removeNodeProperties();
+  e.removeBranchProperties();
+  if (e.hasNodeProperty("label") || !e.getNodePropertyNames().empty() || !e.getBranchPropertyNames().empty())
+    return 1;
+  if (dynamic_cast<BppString*>(label.get())->toSTL() != "u" || dynamic_cast<Number<double>*>(bootstrap.get())->getValue() != 10.)
+    return 1;
+  //Shared properties stay with the other copies:
+  Node f(c);
+  f.removeNodeProperties();
+  f.removeBranchProperties();
+  if (f.hasNodeProperty("label") || f.hasBranchProperty(TreeTools::BOOTSTRAP))
+    return 1;
+  if (getLabel(c) != "x" || getBootstrap(c) != 90.)
+    return 1;
+  f.setNodeProperty("label", BppString("t"));
+  if (getLabel(c) != "x")
+    return 1;
+  cout << "Removal ok." << endl;
+
+  //Tree copies are independent:
+  unique_ptr< TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("((A:1,B:2)80:3,(C:4,D:5)70:6);", true, TreeTools::BOOTSTRAP, false, false));
+  unique_ptr< TreeTemplate<Node> > copy(tree->clone());
+  copy->getRootNode()->getSon(0)->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(20.));
+  copy->getRootNode()->getSon(1)->deleteBranchProperty(TreeTools::BOOTSTRAP);
+  if (getBootstrap(*tree->getRootNode()->getSon(0)) != 80. || getBootstrap(*tree->getRootNode()->getSon(1)) != 70.)
+    return 1;
+  if (getBootstrap(*copy->getRootNode()->getSon(0)) != 20. || copy->getRootNode()->getSon(1)->hasBranchProperty(TreeTools::BOOTSTRAP))
+    return 1;
+  copy.reset();
+  if (getBootstrap(*tree->getRootNode()->getSon(0)) != 80.)
+    return 1;
+  cout << "Tree copies ok." << endl;
+
+  return 0;
+}
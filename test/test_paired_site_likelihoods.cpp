@@ -0,0 +1,169 @@
+//
+// File: test_paired_site_likelihoods.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Phyl/Likelihood/PairedSiteLikelihoods.h>
+#include <Bpp/Phyl/Io/IoPairedSiteLikelihoods.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+using namespace bpp;
+using namespace std;
+
+bool isClose(double a, double b)
+{
+  return abs(a - b) <= 1e-12 * max(1., abs(b));
+}
+
+int main() {
+  try {
+    //Large log-likelihoods, so that their exponentials underflow:
+    size_t nbModels = 5;
+    size_t nbSites = 130;
+    vector< vector<double> > nested(nbModels, vector<double>(nbSites));
+    vector<string> names(nbModels);
+    for (size_t m = 0; m < nbModels; ++m)
+    {
+      names[m] = "tree" + TextTools::toString(m);
+      for (size_t s = 0; s < nbSites; ++s)
+        nested[m][s] = -10. * static_cast<double>(s % 7 + 1) - RandomTools::giveRandomNumberBetweenZeroAndEntry(0.5);
+    }
+
+    //The matrix and nested constructors give the same column-major matrix:
+    vector<double> matrix;
+    for (size_t m = 0; m < nbModels; ++m)
+      matrix.insert(matrix.end(), nested[m].begin(), nested[m].end());
+    PairedSiteLikelihoods psl(nested, names);
+    PairedSiteLikelihoods pslMatrix(nbSites, matrix, names);
+    if (psl.getLogLikelihoodMatrix() != matrix || pslMatrix.getLogLikelihoodMatrix() != matrix ||
+        psl.getLikelihoods() != nested || psl.getNumberOfSites() != nbSites || psl.getNumberOfModels() != nbModels)
+      return 1;
+    for (size_t m = 0; m < nbModels; ++m)
+      if (psl.getSiteLogLikelihoods(m)[nbSites - 1] != nested[m][nbSites - 1])
+        return 1;
+    try {
+      PairedSiteLikelihoods bad(nbSites, vector<double>(nbSites * 2 + 1, 0.));
+      cerr << "No error for a matrix of wrong size." << endl;
+      return 1;
+    } catch (Exception& ex) {}
+    try {
+      PairedSiteLikelihoods bad(nbSites, matrix, vector<string>(2));
+      cerr << "No error for a wrong number of names." << endl;
+      return 1;
+    } catch (Exception& ex) {}
+    cout << "Storage ok." << endl;
+
+    //Model weights, computed with the log-likelihoods shifted by their maximum:
+    vector<double> logliks(nbModels, 0);
+    for (size_t m = 0; m < nbModels; ++m)
+      for (size_t s = 0; s < nbSites; ++s)
+        logliks[m] += nested[m][s];
+    vector<double> penalties = {1., 2., 0., 5., 3.};
+    for (size_t k = 0; k < 2; ++k)
+    {
+      vector<double> Y = logliks;
+      if (k == 1)
+        for (size_t m = 0; m < nbModels; ++m)
+          Y[m] -= penalties[m];
+      double Ymax = *max_element(Y.begin(), Y.end());
+      double sum = 0;
+      for (size_t m = 0; m < nbModels; ++m)
+        sum += exp(Y[m] - Ymax);
+      vector<double> weights = (k == 0 ? psl.computeModelWeights() : psl.computeModelWeights(penalties));
+      for (size_t m = 0; m < nbModels; ++m)
+        if (!isClose(weights[m], exp(Y[m] - Ymax) / sum))
+        {
+          cerr << "Weight of model " << m << ": " << weights[m] << " instead of " << exp(Y[m] - Ymax) / sum << endl;
+          return 1;
+        }
+    }
+    cout << "Model weights ok." << endl;
+
+    //Expected likelihood weights: replicates are drawn in blocks, in the same order as
+    //successive calls to bootstrap(), and a number of replicates not multiple of the
+    //block size.
+    int nbReplicates = 150;
+    RandomTools::setSeed(42);
+    vector<double> expected(nbModels, 0);
+    for (int b = 0; b < nbReplicates; ++b)
+    {
+      vector<int> counts = PairedSiteLikelihoods::bootstrap(nbSites);
+      vector<double> Y(nbModels, 0);
+      for (size_t m = 0; m < nbModels; ++m)
+        for (size_t s = 0; s < nbSites; ++s)
+          Y[m] += counts[s] * nested[m][s];
+      double Ymax = *max_element(Y.begin(), Y.end());
+      double sum = 0;
+      for (size_t m = 0; m < nbModels; ++m)
+        sum += exp(Y[m] - Ymax);
+      for (size_t m = 0; m < nbModels; ++m)
+        expected[m] += exp(Y[m] - Ymax) / sum / nbReplicates;
+    }
+    RandomTools::setSeed(42);
+    pair< vector<string>, vector<double> > elw = psl.computeExpectedLikelihoodWeights(nbReplicates);
+    if (elw.first != names)
+      return 1;
+    for (size_t m = 0; m < nbModels; ++m)
+      if (abs(elw.second[m] - expected[m]) > 1e-10)
+      {
+        cerr << "ELW of model " << m << ": " << elw.second[m] << " instead of " << expected[m] << endl;
+        return 1;
+      }
+    cout << "Expected likelihood weights ok." << endl;
+
+    //Binary format:
+    stringstream ss;
+    IOBinaryPairedSiteLikelihoods::write(psl, ss);
+    PairedSiteLikelihoods read = IOBinaryPairedSiteLikelihoods::read(ss);
+    if (read.getLogLikelihoodMatrix() != matrix || read.getModelNames() != names)
+    {
+      cerr << "Binary round trip failed." << endl;
+      return 1;
+    }
+    cout << "Binary format ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,198 @@
+//
+// File: test_parallel_derivative.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Numeric/AbstractParametrizable.h>
+#include <Bpp/Numeric/Function/Functions.h>
+#include <Bpp/Numeric/Function/ThreePointsNumericalDerivative.h>
+#include <Bpp/Phyl/ParallelThreePointsNumericalDerivative.h>
+#include <iostream>
+#include <cmath>
+#include <map>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+// f(x, y, z) = exp(x).y^2 + x.y.z + z^3 + x.z^2, with x close to its
+// lower bound and z close to its upper bound.
+class TestFunction:
+  public virtual Function,
+  public AbstractParametrizable
+{
+  public:
+    TestFunction():
+      AbstractParametrizable("")
+    {
+      addParameter_(new Parameter("x", 1e-5, &Parameter::R_PLUS));
+      addParameter_(new Parameter("y", 0.7));
+      addParameter_(new Parameter("z", 1. - 1e-5, new IntervalConstraint(-10., 1., true, true), true));
+    }
+
+    TestFunction* clone() const { return new TestFunction(*this); }
+
+    void setParameters(const ParameterList& pl) {
+      matchParametersValues(pl);
+    }
+
+    double getValue() const {
+      double x = getParameterValue("x"), y = getParameterValue("y"), z = getParameterValue("z");
+      return exp(x) * y * y + x * y * z + z * z * z + x * z * z;
+    }
+
+    void fireParameterChanged(const bpp::ParameterList&) {}
+};
+
+bool isClose(double a, double b, double tolerance)
+{
+  return abs(a - b) <= tolerance * max(1., abs(b));
+}
+
+// Derivatives of the two methods, compared with each other and with
+// the analytical ones.
+bool compare(const AbstractNumericalDerivative& parallel, const AbstractNumericalDerivative& serial, const TestFunction& f, const string& name)
+{
+  double x = f.getParameterValue("x"), y = f.getParameterValue("y"), z = f.getParameterValue("z");
+  map<string, double> d1, d2;
+  d1["x"] = exp(x) * y * y + y * z + z * z;
+  d1["y"] = 2. * exp(x) * y + x * z;
+  d1["z"] = x * y + 3. * z * z + 2. * x * z;
+  d2["x"] = exp(x) * y * y;
+  d2["y"] = 2. * exp(x);
+  d2["z"] = 6. * z + 2. * x;
+  map<string, double> cross;
+  cross["xy"] = 2. * exp(x) * y + z;
+  cross["xz"] = y + 2. * z;
+  cross["yz"] = x;
+
+  if (parallel.getValue() != f.getValue())
+  {
+    cerr << name << ": value " << parallel.getValue() << " instead of " << f.getValue() << endl;
+    return false;
+  }
+  vector<string> vars = { "x", "y", "z" };
+  for (size_t i = 0; i < vars.size(); i++)
+  {
+    const string& v = vars[i];
+    double pd1 = parallel.getFirstOrderDerivative(v), pd2 = parallel.getSecondOrderDerivative(v);
+    double sd1 = serial.getFirstOrderDerivative(v), sd2 = serial.getSecondOrderDerivative(v);
+    if (!isClose(pd1, d1[v], 1e-6) || !isClose(pd1, sd1, 1e-6)
+        || !isClose(pd2, d2[v], 1e-3) || !isClose(pd2, sd2, 1e-3))
+    {
+      cerr << name << ": derivatives for " << v << ": " << pd1 << ", " << pd2
+           << " instead of " << d1[v] << ", " << d2[v]
+           << " (three points: " << sd1 << ", " << sd2 << ")" << endl;
+      return false;
+    }
+    for (size_t j = i + 1; j < vars.size(); j++)
+    {
+      const string& w = vars[j];
+      double pc = parallel.getSecondOrderDerivative(v, w), sc = serial.getSecondOrderDerivative(v, w);
+      if (pc != parallel.getSecondOrderDerivative(w, v)
+          || !isClose(pc, cross[v + w], 1e-3) || !isClose(pc, sc, 1e-3))
+      {
+        cerr << name << ": cross derivative for " << v << ", " << w << ": " << pc
+             << " instead of " << cross[v + w] << " (three points: " << sc << ")" << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+  try {
+    TestFunction f;
+    vector<string> vars = { "x", "y", "z" };
+
+    TestFunction serialFunction(f);
+    ThreePointsNumericalDerivative serial(&serialFunction);
+    serial.setParametersToDerivate(vars);
+    serial.enableFirstOrderDerivatives(true);
+    serial.enableSecondOrderDerivatives(true);
+    serial.enableSecondOrderCrossDerivatives(true);
+    serial.setParameters(f.getParameters());
+
+    vector<double> firstDerivatives;
+    for (size_t nbThreads = 1; nbThreads <= 4; nbThreads += 3)
+    {
+      vector<unique_ptr<TestFunction> > ownedCopies;
+      vector<Function*> copies;
+      for (size_t t = 0; t < nbThreads; t++)
+      {
+        ownedCopies.push_back(unique_ptr<TestFunction>(f.clone()));
+        copies.push_back(ownedCopies.back().get());
+      }
+      TestFunction function(f);
+      ParallelThreePointsNumericalDerivative parallel(&function, copies);
+      parallel.setParametersToDerivate(vars);
+      parallel.enableFirstOrderDerivatives(true);
+      parallel.enableSecondOrderDerivatives(true);
+      parallel.enableSecondOrderCrossDerivatives(true);
+      parallel.setParameters(f.getParameters());
+
+      string name = TextTools::toString(nbThreads) + " thread(s)";
+      if (parallel.getNumberOfThreads() != nbThreads || !compare(parallel, serial, function, name))
+        return 1;
+
+      // The points are the same whatever the number of threads:
+      vector<double> derivatives;
+      for (size_t i = 0; i < vars.size(); i++)
+      {
+        derivatives.push_back(parallel.getFirstOrderDerivative(vars[i]));
+        derivatives.push_back(parallel.getSecondOrderDerivative(vars[i]));
+        for (size_t j = i + 1; j < vars.size(); j++)
+          derivatives.push_back(parallel.getSecondOrderDerivative(vars[i], vars[j]));
+      }
+      if (firstDerivatives.size() == 0)
+        firstDerivatives = derivatives;
+      else if (derivatives != firstDerivatives)
+      {
+        cerr << name << ": derivatives differ from the ones with one thread." << endl;
+        return 1;
+      }
+      cout << "Derivatives with " << name << " ok." << endl;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
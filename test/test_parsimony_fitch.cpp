@@ -0,0 +1,143 @@
+//
+// File: test_parsimony_fitch.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
+#include <iostream>
+#include <map>
+
+using namespace bpp;
+using namespace std;
+
+// Per-site Fitch algorithm on a rooted binary tree, with one state per leaf.
+// Returns the number of changes below node, and sets the state set of node.
+unsigned int fitch(const Node* node, const map<string, int>& leafStates, size_t nbStates, vector<bool>& set)
+{
+  set.assign(nbStates, false);
+  if (node->isLeaf())
+  {
+    set[static_cast<size_t>(leafStates.at(node->getName()))] = true;
+    return 0;
+  }
+  unsigned int score = fitch(node->getSon(0), leafStates, nbStates, set);
+  for (size_t k = 1; k < node->getNumberOfSons(); ++k)
+  {
+    vector<bool> sonSet;
+    score += fitch(node->getSon(k), leafStates, nbStates, sonSet);
+    vector<bool> inter(nbStates, false);
+    bool empty = true;
+    for (size_t s = 0; s < nbStates; ++s)
+    {
+      inter[s] = set[s] && sonSet[s];
+      if (inter[s]) empty = false;
+    }
+    if (empty)
+    {
+      for (size_t s = 0; s < nbStates; ++s)
+        set[s] = set[s] || sonSet[s];
+      score++;
+    }
+    else
+      set = inter;
+  }
+  return score;
+}
+
+// Compare DRTreeParsimonyScore with the reference on random data.
+// The number of sites is not a multiple of 64, so that the last words have padding bits.
+bool testAlphabet(const Alphabet* alphabet, size_t nbLeaves, size_t nbSites)
+{
+  size_t nbStates = alphabet->getSize();
+  vector<string> names(nbLeaves);
+  for (size_t i = 0; i < nbLeaves; ++i)
+    names[i] = "leaf" + TextTools::toString(i);
+  unique_ptr< TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(names, true));
+
+  vector< vector<int> > contents(nbLeaves, vector<int>(nbSites));
+  VectorSiteContainer sites(alphabet);
+  for (size_t i = 0; i < nbLeaves; ++i)
+  {
+    for (size_t j = 0; j < nbSites; ++j)
+      contents[i][j] = RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(static_cast<int>(nbStates));
+    sites.addSequence(BasicSequence(names[i], contents[i], alphabet));
+  }
+
+  DRTreeParsimonyScore pars(*tree, sites, false);
+
+  unsigned int total = 0;
+  for (size_t j = 0; j < nbSites; ++j)
+  {
+    map<string, int> leafStates;
+    for (size_t i = 0; i < nbLeaves; ++i)
+      leafStates[names[i]] = contents[i][j];
+    vector<bool> set;
+    unsigned int expected = fitch(tree->getRootNode(), leafStates, nbStates, set);
+    total += expected;
+    if (pars.getScoreForSite(j) != expected)
+    {
+      cerr << alphabet->getAlphabetType() << ", site " << j << ": " << pars.getScoreForSite(j) << " instead of " << expected << endl;
+      return false;
+    }
+  }
+  cout << alphabet->getAlphabetType() << ": " << pars.getScore() << " (expected " << total << ")" << endl;
+  return pars.getScore() == total;
+}
+
+int main() {
+  try {
+    CodonAlphabet codonAlphabet(&AlphabetTools::DNA_ALPHABET);
+    for (unsigned int i = 0; i < 5; ++i)
+    {
+      if (!testAlphabet(&AlphabetTools::DNA_ALPHABET, 12, 150)) return 1;
+      if (!testAlphabet(&AlphabetTools::PROTEIN_ALPHABET, 12, 70)) return 1;
+      if (!testAlphabet(&codonAlphabet, 12, 130)) return 1;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
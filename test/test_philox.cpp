@@ -0,0 +1,96 @@
+//
+// File: test_philox.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Simulation/CounterBasedRandomStream.h>
+#include <iostream>
+#include <iomanip>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  //Known-answer vectors of Philox4x32-10, from the Random123 distribution (kat_vectors):
+  const uint32_t kat[3][10] = {
+    { 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+      0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+    { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+      0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+    { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822, 0x299f31d0,
+      0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }
+  };
+  for (size_t i = 0; i < 3; ++i) {
+    uint32_t result[4];
+    CounterBasedRandomStream::philox4x32(kat[i], kat[i] + 4, result);
+    for (size_t j = 0; j < 4; ++j) {
+      if (result[j] != kat[i][6 + j]) {
+        cerr << "Known-answer vector " << i << ", word " << j << ": " << hex << result[j] << " instead of " << kat[i][6 + j] << "." << endl;
+        return 1;
+      }
+    }
+  }
+  cout << "Known-answer vectors ok." << endl;
+
+  //Draws are a function of the seed, the stream and their position only:
+  CounterBasedRandomStream s1(42, 7), s2(42, 7), s3(42, 8), s4(43, 7);
+  bool differ3 = false, differ4 = false;
+  for (size_t i = 0; i < 1000; ++i) {
+    double x = s1.giveRandomNumberBetweenZeroAndEntry(1.);
+    if (x < 0 || x >= 1. || x != s2.giveRandomNumberBetweenZeroAndEntry(1.))
+      return 1;
+    differ3 = differ3 || x != s3.giveRandomNumberBetweenZeroAndEntry(1.);
+    differ4 = differ4 || x != s4.giveRandomNumberBetweenZeroAndEntry(1.);
+  }
+  if (!differ3 || !differ4)
+    return 1;
+  //The first draw is made of the first two words of the block of counter 0:
+  uint32_t counter[4] = { 0, 0, 5, 0 };
+  uint32_t key[2] = { 9, 0 };
+  uint32_t block[4];
+  CounterBasedRandomStream::philox4x32(counter, key, block);
+  uint64_t bits = ((static_cast<uint64_t>(block[0]) << 32) | block[1]) >> 11;
+  CounterBasedRandomStream s5(9, 5);
+  if (s5.giveRandomNumberBetweenZeroAndEntry(1.) != static_cast<double>(bits) / 9007199254740992.)
+    return 1;
+  //Integers stay in range:
+  for (size_t i = 0; i < 1000; ++i)
+    if (s5.giveIntRandomNumberBetweenZeroAndEntry(3) >= 3)
+      return 1;
+  cout << "Streams ok." << endl;
+  return 0;
+}
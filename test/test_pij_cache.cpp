@@ -0,0 +1,177 @@
+//
+// File: test_pij_cache.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/MixtureOfSubstitutionModels.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool sameMatrix(const Matrix<double>& m1, const Matrix<double>& m2, double tolerance = 0) {
+  for (size_t i = 0; i < m1.getNumberOfRows(); ++i)
+    for (size_t j = 0; j < m1.getNumberOfColumns(); ++j)
+      if (abs(m1(i, j) - m2(i, j)) > tolerance)
+        return false;
+  return true;
+}
+
+// A model reading its transition matrices from the cache gives exactly
+// the ones computed without cache, for more branch lengths than cached
+// matrices, in varying orders:
+bool compareModels(const SubstitutionModel& cached, const SubstitutionModel& uncached, const string& step) {
+  vector<double> lengths;
+  for (size_t i = 0; i < 24; ++i)
+    lengths.push_back(0.01 + 0.13 * static_cast<double>(i));
+
+  for (size_t pass = 0; pass < 3; ++pass) {
+    for (size_t k = 0; k < lengths.size(); ++k) {
+      // Forward, backward, then only a few lengths:
+      double t = (pass == 1 ? lengths[lengths.size() - 1 - k] : lengths[pass == 2 ? k % 5 : k]);
+      if (!sameMatrix(cached.getPij_t(t), uncached.getPij_t(t))
+          || !sameMatrix(cached.getdPij_dt(t), uncached.getdPij_dt(t))
+          || !sameMatrix(cached.getd2Pij_dt2(t), uncached.getd2Pij_dt2(t))) {
+        cerr << "Cached transition matrices differ at t=" << t << " " << step << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+  try {
+    // Single model:
+    GTR model(&AlphabetTools::DNA_ALPHABET, 1, 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2);
+    GTR uncached(model);
+    uncached.setTransitionMatrixCacheSize(0);
+    if (model.getTransitionMatrixCacheSize() != 16 || uncached.getTransitionMatrixCacheSize() != 0) {
+      cerr << "Wrong cache sizes." << endl;
+      return 1;
+    }
+    if (!compareModels(model, uncached, "at start"))
+      return 1;
+
+    // The cache is invalidated when the generator changes:
+    RowMatrix<double> before = model.getPij_t(0.5);
+    ParameterList pl = model.getParameters();
+    pl.setParameterValue("GTR.a", 2.5);
+    model.matchParametersValues(pl);
+    uncached.matchParametersValues(pl);
+    if (sameMatrix(model.getPij_t(0.5), before) || !compareModels(model, uncached, "after a parameter change"))
+      return 1;
+
+    before = model.getPij_t(0.5);
+    model.setScale(0.5);
+    uncached.setScale(0.5);
+    if (sameMatrix(model.getPij_t(0.5), before) || !compareModels(model, uncached, "after setScale"))
+      return 1;
+
+    before = model.getPij_t(0.5);
+    map<int, double> freqs;
+    freqs[0] = 0.1;
+    freqs[1] = 0.2;
+    freqs[2] = 0.3;
+    freqs[3] = 0.4;
+    model.setFreq(freqs);
+    uncached.setFreq(freqs);
+    if (sameMatrix(model.getPij_t(0.5), before) || !compareModels(model, uncached, "after setFreq"))
+      return 1;
+
+    // Matrices are cached per rate, which changes without changing the generator:
+    model.setRate(2.);
+    uncached.setRate(2.);
+    if (!compareModels(model, uncached, "at rate 2"))
+      return 1;
+    model.setRate(1.);
+    uncached.setRate(1.);
+    if (!compareModels(model, uncached, "back at rate 1"))
+      return 1;
+
+    // Matrices computed together are cached for single ones, up to rounding:
+    vector<double> vt = { 0.05, 0.5, 0.7, 5. };
+    vector<RowMatrix<double> > vPij(vt.size());
+    vector<RowMatrix<double>*> pvPij;
+    for (auto& pij : vPij)
+      pvPij.push_back(&pij);
+    model.getPij_t(0.5);
+    model.computePij_t(vt, pvPij);
+    for (size_t k = 0; k < vt.size(); ++k)
+      if (!sameMatrix(vPij[k], uncached.getPij_t(vt[k]), 1e-12) || !sameMatrix(model.getPij_t(vt[k]), vPij[k])) {
+        cerr << "Wrong transition matrices computed together at t=" << vt[k] << endl;
+        return 1;
+      }
+    cout << "Transition matrix cache of a model ok." << endl;
+
+    // Mixture whose submodel rates change with the relative rates:
+    vector<SubstitutionModel*> vModels;
+    vModels.push_back(new GTR(&AlphabetTools::DNA_ALPHABET, 1, 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2));
+    vModels.push_back(new GTR(&AlphabetTools::DNA_ALPHABET, 0.5, 1.2, 0.8, 0.4, 1.5, 0.3, 0.2, 0.2, 0.3));
+    MixtureOfSubstitutionModels mixture(&AlphabetTools::DNA_ALPHABET, vModels);
+    MixtureOfSubstitutionModels uncachedMixture(mixture);
+    for (size_t i = 0; i < mixture.getNumberOfModels(); ++i)
+      dynamic_cast<AbstractSubstitutionModel*>(uncachedMixture.getNModel(i))->setTransitionMatrixCacheSize(0);
+
+    vector<double> relrates = { 0.5, 0.3, 0.8, 0.3, 0.5 };
+    for (double relrate : relrates) {
+      pl = mixture.getParameters();
+      pl.setParameterValue("Mixture.relrate1", relrate);
+      mixture.matchParametersValues(pl);
+      uncachedMixture.matchParametersValues(pl);
+      string step = "with relrate1=" + TextTools::toString(relrate);
+      for (size_t i = 0; i < mixture.getNumberOfModels(); ++i) {
+        if (mixture.getNModel(i)->getRate() != uncachedMixture.getNModel(i)->getRate()) {
+          cerr << "Submodel rates differ " << step << endl;
+          return 1;
+        }
+        if (!compareModels(*mixture.getNModel(i), *uncachedMixture.getNModel(i), "in submodel " + TextTools::toString(i) + " " + step))
+          return 1;
+      }
+      if (!compareModels(mixture, uncachedMixture, step))
+        return 1;
+    }
+    cout << "Transition matrix cache of a mixture ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,182 @@
+//
+// File: test_reward_mapping_threads.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Numeric/Prob/ConstantDistribution.h>
+#include <Bpp/Seq/Alphabet/DNA.h>
+#include <Bpp/Seq/AlphabetIndex/UserAlphabetIndex1.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Simulation/SubstitutionProcessSequenceSimulator.h>
+#include <Bpp/Phyl/Mapping/DecompositionReward.h>
+#include <Bpp/Phyl/Mapping/RewardMappingTools.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool sameRewards(const ProbabilisticRewardMapping& m1, const ProbabilisticRewardMapping& m2, const vector<uint>& ids) {
+  for (auto id : ids) {
+    if (m1.getEdge(id)->getRewards() != m2.getEdge(id)->getRewards()) {
+      cerr << "Rewards differ on branch " << id << "." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  try {
+    Newick reader;
+    unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("(((A:0.01, B:0.02):0.03,C:0.1):0.02,(D:0.05,(E:0.2,F:0.07):0.04):0.01);", false, "", false, false));
+    DNA alphabet;
+    GTR model(&alphabet, 1, 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2);
+    GammaDiscreteDistribution rdist(4, 0.4, 0.4);
+    ParametrizablePhyloTree pTree(*tree);
+    unique_ptr<RateAcrossSitesSubstitutionProcess> process(new RateAcrossSitesSubstitutionProcess(model.clone(), rdist.clone(), pTree.clone()));
+
+    SimpleSubstitutionProcessSequenceSimulator simulator(*process);
+    unique_ptr<SiteContainer> sites(simulator.simulate(500, 11));
+
+    SingleProcessPhyloLikelihood lik(process.get(), new RecursiveLikelihoodTreeCalculation(*sites, process.get(), false, true));
+    cout << "LogLik: " << lik.getValue() << endl;
+    RecursiveLikelihoodTreeCalculation& rltc = *dynamic_cast<RecursiveLikelihoodTreeCalculation*>(lik.getLikelihoodCalculation());
+
+    //Time spent in A or T, with a null reward for C and G, and time
+    //spent in G:
+    UserAlphabetIndex1 indexAT(&alphabet);
+    indexAT.setIndex(alphabet.charToInt("A"), 1.);
+    indexAT.setIndex(alphabet.charToInt("C"), 0.);
+    indexAT.setIndex(alphabet.charToInt("G"), 0.);
+    indexAT.setIndex(alphabet.charToInt("T"), 1.);
+    UserAlphabetIndex1 indexG(&alphabet);
+    indexG.setIndex(alphabet.charToInt("A"), 0.);
+    indexG.setIndex(alphabet.charToInt("C"), 0.);
+    indexG.setIndex(alphabet.charToInt("G"), 1.);
+    indexG.setIndex(alphabet.charToInt("T"), 0.);
+    DecompositionReward rewardAT(&model, &indexAT);
+    DecompositionReward rewardG(&model, &indexG);
+    vector<Reward*> rewards = {&rewardAT, &rewardG};
+
+    vector<uint> nodeIds = pTree.getAllEdgesIndexes();
+    for (auto reward : rewards) {
+      unique_ptr<ProbabilisticRewardMapping> serial(RewardMappingTools::computeRewardVectors(rltc, nodeIds, *reward, false, 1));
+      for (size_t nbThreads = 2; nbThreads <= 16; nbThreads *= 2) {
+        unique_ptr<ProbabilisticRewardMapping> threaded(RewardMappingTools::computeRewardVectors(rltc, nodeIds, *reward, false, nbThreads));
+        if (!sameRewards(*serial, *threaded, nodeIds)) {
+          cerr << "Rewards with " << nbThreads << " threads differ from the serial ones." << endl;
+          return 1;
+        }
+      }
+    }
+    cout << "Threaded rewards ok." << endl;
+
+    //Several rewards at once, on some of the branches:
+    vector<uint> someIds(nodeIds.begin() + 1, nodeIds.end());
+    vector<ProbabilisticRewardMapping*> threadeds = RewardMappingTools::computeRewardVectors(rltc, someIds, rewards, false, 3);
+    bool ok = true;
+    for (size_t k = 0; k < rewards.size(); ++k) {
+      unique_ptr<ProbabilisticRewardMapping> single(RewardMappingTools::computeRewardVectors(rltc, someIds, *rewards[k], false, 1));
+      if (!sameRewards(*single, *threadeds[k], someIds))
+        ok = false;
+      delete threadeds[k];
+    }
+    if (!ok)
+      return 1;
+    cout << "Threaded multiple rewards ok." << endl;
+
+    //With a constant rate, the times spent in all states sum to the
+    //length of the branch:
+    ConstantDistribution constant(1.);
+    unique_ptr<RateAcrossSitesSubstitutionProcess> process1(new RateAcrossSitesSubstitutionProcess(model.clone(), constant.clone(), pTree.clone()));
+    SingleProcessPhyloLikelihood lik1(process1.get(), new RecursiveLikelihoodTreeCalculation(*sites, process1.get(), false, true));
+    lik1.getValue();
+    RecursiveLikelihoodTreeCalculation& rltc1 = *dynamic_cast<RecursiveLikelihoodTreeCalculation*>(lik1.getLikelihoodCalculation());
+    UserAlphabetIndex1 indexC(&alphabet);
+    indexC.setIndex(alphabet.charToInt("A"), 0.);
+    indexC.setIndex(alphabet.charToInt("C"), 1.);
+    indexC.setIndex(alphabet.charToInt("G"), 0.);
+    indexC.setIndex(alphabet.charToInt("T"), 0.);
+    DecompositionReward rewardC(&model, &indexC);
+    vector<Reward*> allRewards = {&rewardAT, &rewardC, &rewardG};
+    vector<ProbabilisticRewardMapping*> parts = RewardMappingTools::computeRewardVectors(rltc1, nodeIds, allRewards, false, 4);
+    for (auto id : nodeIds) {
+      double length = parts[0]->getEdge(id)->getLength();
+      for (size_t i = 0; i < parts[0]->getNumberOfDistinctSites(); ++i) {
+        double total = 0;
+        for (auto part : parts)
+          total += part->getEdge(id)->getSiteReward(i);
+        if (abs(total - length) > 1e-6 * length) {
+          cerr << "Times spent in all states on branch " << id << " at site index " << i << " sum to " << total << " instead of " << length << "." << endl;
+          ok = false;
+        }
+      }
+    }
+    for (auto part : parts)
+      delete part;
+    if (!ok)
+      return 1;
+    cout << "Sum of rewards ok." << endl;
+
+    //Stress: many runs, on new parameter values each time, so that the
+    //transition probabilities of the models are computed again while
+    //threads share them:
+    for (size_t run = 0; run < 20; ++run) {
+      lik.setParameterValue("GTR.a", 1. + 0.05 * static_cast<double>(run));
+      for (auto reward : rewards) {
+        unique_ptr<ProbabilisticRewardMapping> serial(RewardMappingTools::computeRewardVectors(rltc, nodeIds, *reward, false, 1));
+        unique_ptr<ProbabilisticRewardMapping> threaded(RewardMappingTools::computeRewardVectors(rltc, nodeIds, *reward, false, 8));
+        if (!sameRewards(*serial, *threaded, nodeIds)) {
+          cerr << "Rewards with 8 threads differ from the serial ones at run " << run << "." << endl;
+          return 1;
+        }
+      }
+    }
+    cout << "Threaded rewards stress ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
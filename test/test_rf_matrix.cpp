@@ -0,0 +1,148 @@
+//
+// File: test_rf_matrix.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Tree/TreeTools.h>
+#include <algorithm>
+#include <map>
+#include <cmath>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+// Weights of the splits of a tree, each split being identified by the sorted
+// names on the side which does not contain the first leaf.
+map<vector<string>, double> getSplits(const TreeTemplate<Node>& tree, const string& firstLeaf)
+{
+  vector<string> allNames = tree.getLeavesNames();
+  map<vector<string>, double> splits;
+  vector<const Node*> nodes = tree.getNodes();
+  for (size_t i = 0; i < nodes.size(); ++i)
+  {
+    if (!nodes[i]->hasFather())
+      continue;
+    vector<string> names = TreeTemplateTools::getLeavesNames(*nodes[i]);
+    if (find(names.begin(), names.end(), firstLeaf) != names.end())
+    {
+      vector<string> complement;
+      for (size_t j = 0; j < allNames.size(); ++j)
+        if (find(names.begin(), names.end(), allNames[j]) == names.end())
+          complement.push_back(allNames[j]);
+      names = complement;
+    }
+    sort(names.begin(), names.end());
+    splits[names] += nodes[i]->hasDistanceToFather() ? nodes[i]->getDistanceToFather() : 0;
+  }
+  return splits;
+}
+
+double weightedDistance(const map<vector<string>, double>& s1, const map<vector<string>, double>& s2)
+{
+  double d = 0;
+  for (map<vector<string>, double>::const_iterator it = s1.begin(); it != s1.end(); ++it)
+  {
+    map<vector<string>, double>::const_iterator it2 = s2.find(it->first);
+    d += abs(it->second - (it2 == s2.end() ? 0 : it2->second));
+  }
+  for (map<vector<string>, double>::const_iterator it = s2.begin(); it != s2.end(); ++it)
+    if (s1.find(it->first) == s1.end())
+      d += it->second;
+  return d;
+}
+
+int main() {
+  vector<string> leaves(20);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    leaves[i] = "leaf" + TextTools::toString(i);
+
+  //Rooted and unrooted random trees, some of them identical, with random branch lengths:
+  vector<Tree*> trees;
+  for (size_t i = 0; i < 30; ++i)
+  {
+    TreeTemplate<Node>* tree = TreeTemplateTools::getRandomTree(leaves, i % 2 == 0);
+    vector<Node*> nodes = tree->getNodes();
+    for (size_t j = 0; j < nodes.size(); ++j)
+      if (nodes[j]->hasFather())
+        nodes[j]->setDistanceToFather(RandomTools::giveRandomNumberBetweenZeroAndEntry(1.));
+    trees.push_back(tree);
+    if (i % 10 == 0)
+      trees.push_back(tree->clone());
+  }
+  //A multifurcating tree:
+  trees.push_back(TreeTemplateTools::parenthesisToTree("((leaf0,leaf1,leaf2,leaf3,leaf4),(leaf5,leaf6,leaf7,leaf8,leaf9),leaf10,leaf11,leaf12,leaf13,leaf14,leaf15,leaf16,leaf17,leaf18,leaf19);", true, TreeTools::BOOTSTRAP, false, false));
+
+  vector< map<vector<string>, double> > splits;
+  for (size_t i = 0; i < trees.size(); ++i)
+    splits.push_back(getSplits(dynamic_cast<const TreeTemplate<Node>&>(*trees[i]), leaves[0]));
+
+  size_t threads[] = { 1, 4 };
+  for (size_t t = 0; t < 2; ++t)
+  {
+    RowMatrix<double> rf = TreeTools::robinsonFouldsDistanceMatrix(trees, false, threads[t]);
+    RowMatrix<double> wrf = TreeTools::robinsonFouldsDistanceMatrix(trees, true, threads[t]);
+    if (rf.getNumberOfRows() != trees.size() || rf.getNumberOfColumns() != trees.size())
+      return 1;
+    for (size_t i = 0; i < trees.size(); ++i)
+    {
+      for (size_t j = 0; j < trees.size(); ++j)
+      {
+        double expected = static_cast<double>(TreeTools::robinsonFouldsDistance(*trees[i], *trees[j]));
+        if (rf(i, j) != expected)
+        {
+          cerr << "RF(" << i << ", " << j << ") = " << rf(i, j) << ", expected " << expected << " with " << threads[t] << " thread(s)." << endl;
+          return 1;
+        }
+        double expectedW = weightedDistance(splits[i], splits[j]);
+        if (abs(wrf(i, j) - expectedW) > 1e-10)
+        {
+          cerr << "Weighted RF(" << i << ", " << j << ") = " << wrf(i, j) << ", expected " << expectedW << " with " << threads[t] << " thread(s)." << endl;
+          return 1;
+        }
+      }
+    }
+  }
+  cout << "Robinson-Foulds matrix ok." << endl;
+
+  for (size_t i = 0; i < trees.size(); ++i)
+    delete trees[i];
+  return 0;
+}
@@ -0,0 +1,124 @@
+//
+// File: test_sparse_generator.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/KroneckerWordSubstitutionModel.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/CodonFrequenciesSet.h>
+#include <Bpp/Phyl/Model/SparseGenerator.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+// The sparse copy of the generator has the non-zero terms of the dense
+// one, and gives the same products with vectors:
+bool testModel(const SubstitutionModel& model, size_t maxPerRow) {
+  const Matrix<double>& generator = model.getGenerator();
+  size_t n = generator.getNumberOfRows();
+  SparseGenerator sparse;
+  sparse.build(generator);
+
+  size_t nonZeros = 0;
+  double maxRate = 0;
+  for (size_t i = 0; i < n; ++i) {
+    size_t rowNonZeros = 0;
+    for (size_t j = 0; j < n; ++j)
+      if (generator(i, j) != 0)
+        rowNonZeros++;
+    if (rowNonZeros > maxPerRow) {
+      cerr << model.getName() << ": " << rowNonZeros << " non-zero rates on row " << i << "." << endl;
+      return false;
+    }
+    nonZeros += rowNonZeros;
+    maxRate = max(maxRate, -generator(i, i));
+  }
+  if (sparse.getSize() != n || sparse.getNumberOfNonZeros() != nonZeros || sparse.getMaxRate() != maxRate) {
+    cerr << model.getName() << ": sparse generator of size " << sparse.getSize() << " with " << sparse.getNumberOfNonZeros()
+         << " non-zeros, instead of " << n << " and " << nonZeros << "." << endl;
+    return false;
+  }
+
+  vector< vector<double> > vectors(3, vector<double>(n));
+  vectors[0][n / 2] = 1.;
+  for (size_t i = 0; i < n; ++i) {
+    vectors[1][i] = 1. / static_cast<double>(i + 1);
+    vectors[2][i] = (i % 3 == 0) ? 0. : sin(static_cast<double>(i));
+  }
+
+  for (auto& v : vectors) {
+    vector<double> res;
+    sparse.multiply(v, res);
+    for (size_t i = 0; i < n; ++i) {
+      double dense = 0;
+      for (size_t j = 0; j < n; ++j)
+        dense += generator(i, j) * v[j];
+      if (abs(res[i] - dense) > 1e-13 * max(1., abs(dense))) {
+        cerr << model.getName() << ": sparse product " << res[i] << " instead of " << dense << " on row " << i << "." << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+  try {
+    //Words of three nucleotides: a single position changes at a time.
+    KroneckerWordSubstitutionModel word(new GTR(&AlphabetTools::DNA_ALPHABET, 1, 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2), 3);
+    if (!testModel(word, 1 + 3 * 3))
+      return 1;
+    cout << "Sparse generator of word model ok." << endl;
+
+    StandardGeneticCode gc(AlphabetTools::DNA_ALPHABET.clone());
+    YN98 yn98(&gc, CodonFrequenciesSet::getFrequenciesSetForCodons(CodonFrequenciesSet::F3X4, &gc));
+    yn98.setParameterValue("YN98.kappa", 2.5);
+    yn98.setParameterValue("YN98.omega", 0.3);
+    if (!testModel(yn98, 1 + 3 * 3))
+      return 1;
+    cout << "Sparse generator of codon model ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,192 @@
+//
+// File: test_spr.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/ConstantDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Tree/SPRTopologySearch.h>
+#include <Bpp/Phyl/Model/Nucleotide/JCnuc.h>
+#include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/OptimizationTools.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+// Records the score after each move performed by a search.
+class ScoreRecorder :
+  public virtual TopologyListener
+{
+private:
+  const SPRSearchable* searchable_;
+  vector<double>* scores_;
+
+public:
+  ScoreRecorder(const SPRSearchable* searchable, vector<double>* scores) :
+    searchable_(searchable), scores_(scores) {}
+
+  ScoreRecorder* clone() const { return new ScoreRecorder(*this); }
+
+  void topologyChangeTested(const TopologyChangeEvent& event) {}
+  void topologyChangeSuccessful(const TopologyChangeEvent& event)
+  {
+    scores_->push_back(searchable_->getTopologyValue());
+  }
+};
+
+// Run a search and check that the score never gets worse.
+bool searchDoesNotWorsen(SPRSearchable& searchable, const string& algorithm, unsigned int radius, double tolerance)
+{
+  vector<double> scores(1, searchable.getTopologyValue());
+  SPRTopologySearch search(searchable, algorithm, radius, 0);
+  search.addTopologyListener(new ScoreRecorder(&searchable, &scores));
+  search.search();
+  for (size_t i = 1; i < scores.size(); i++)
+  {
+    if (scores[i] > scores[i - 1] + tolerance)
+    {
+      cerr << algorithm << " search, move " << i << ": score " << scores[i] << " after " << scores[i - 1] << endl;
+      return false;
+    }
+  }
+  cout << algorithm << " search, radius " << radius << ": " << scores.front() << " -> " << scores.back()
+       << " in " << scores.size() - 1 << " moves." << endl;
+  return true;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  Newick reader;
+  unique_ptr<TreeTemplate<Node> > reference(reader.parenthesisToTree(
+    "((A:0.1,B:0.1):0.1,(C:0.1,D:0.1):0.1,((E:0.1,F:0.1):0.1,(G:0.1,H:0.1):0.1):0.1);"));
+  // The same tree with A moved next to H:
+  unique_ptr<TreeTemplate<Node> > moved(reader.parenthesisToTree(
+    "(B:0.1,(C:0.1,D:0.1):0.1,((E:0.1,F:0.1):0.1,(G:0.1,(H:0.1,A:0.1):0.1):0.1):0.1);"));
+
+  // Each split of the reference tree is supported by three sites, so that
+  // it is the only most parsimonious tree, with a score of one per site.
+  const char* splits[] = { "11000000", "00110000", "11110000", "00001100", "00000011" };
+  const char* inStates  = "ACG";
+  const char* outStates = "TGT";
+  vector<string> seqs(8);
+  for (size_t s = 0; s < 5; s++)
+    for (size_t r = 0; r < 3; r++)
+      for (size_t t = 0; t < 8; t++)
+        seqs[t] += (splits[s][t] == '1' ? inStates[r] : outStates[r]);
+  VectorSiteContainer sites(alphabet);
+  vector<string> names = { "A", "B", "C", "D", "E", "F", "G", "H" };
+  for (size_t t = 0; t < 8; t++)
+    sites.addSequence(BasicSequence(names[t], seqs[t] + "AACC", alphabet));
+
+  try {
+    // Parsimony, back to the reference tree:
+    {
+      DRTreeParsimonyScore referenceScore(*reference, sites, false, false);
+      DRTreeParsimonyScore* tp = new DRTreeParsimonyScore(*moved, sites, false, false);
+      if (!searchDoesNotWorsen(*tp, SPRTopologySearch::BETTER, 5, 0.))
+        return 1;
+      if (tp->getScore() != referenceScore.getScore() || tp->getScore() != 15)
+      {
+        cerr << "Parsimony score " << tp->getScore() << " instead of " << referenceScore.getScore() << endl;
+        return 1;
+      }
+      if (TreeTools::robinsonFouldsDistance(tp->getTree(), *reference) != 0)
+      {
+        cerr << "SPR search did not find the reference tree: " << TreeTools::treeToParenthesis(tp->getTree()) << endl;
+        return 1;
+      }
+      delete tp;
+    }
+
+    // Parsimony, from random trees, with both algorithms and through OptimizationTools:
+    for (size_t rep = 0; rep < 5; rep++)
+    {
+      unique_ptr<TreeTemplate<Node> > randomTree(TreeTemplateTools::getRandomTree(names, false));
+      DRTreeParsimonyScore tp(*randomTree, sites, false, false);
+      if (!searchDoesNotWorsen(tp, rep % 2 == 0 ? SPRTopologySearch::FAST : SPRTopologySearch::BETTER, 2 + static_cast<unsigned int>(rep), 0.))
+        return 1;
+      DRTreeParsimonyScore* tp2 = new DRTreeParsimonyScore(*randomTree, sites, false, false);
+      unsigned int initialScore = tp2->getScore();
+      tp2 = OptimizationTools::optimizeTreeSPR(tp2, 3, 0);
+      if (tp2->getScore() > initialScore)
+        return 1;
+      delete tp2;
+    }
+
+    // Likelihood, back to the reference tree:
+    {
+      NNIHomogeneousTreeLikelihood tl(*moved, sites, new JCnuc(alphabet), new ConstantDistribution(1.), true, false);
+      tl.initialize();
+      double initialValue = tl.getValue();
+      if (!searchDoesNotWorsen(tl, SPRTopologySearch::BETTER, 5, 1e-6))
+        return 1;
+      if (tl.getValue() >= initialValue)
+      {
+        cerr << "No likelihood improvement: " << tl.getValue() << " from " << initialValue << endl;
+        return 1;
+      }
+      if (TreeTools::robinsonFouldsDistance(tl.getTree(), *reference) != 0)
+      {
+        cerr << "SPR search did not find the reference tree: " << TreeTools::treeToParenthesis(tl.getTree()) << endl;
+        return 1;
+      }
+    }
+
+    // Likelihood, from a random tree with the fast algorithm:
+    {
+      unique_ptr<TreeTemplate<Node> > randomTree(TreeTemplateTools::getRandomTree(names, false));
+      randomTree->setBranchLengths(0.1);
+      NNIHomogeneousTreeLikelihood* tl = new NNIHomogeneousTreeLikelihood(*randomTree, sites, new JCnuc(alphabet), new ConstantDistribution(1.), true, false);
+      tl->initialize();
+      if (!searchDoesNotWorsen(*tl, SPRTopologySearch::FAST, 3, 1e-6))
+        return 1;
+      tl = OptimizationTools::optimizeTreeSPR(tl, 3, 0);
+      delete tl;
+    }
+  } catch (Exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,168 @@
+//
+// File: test_stepwise_addition.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Tree/TreeTools.h>
+#include <Bpp/Phyl/Model/StateMap.h>
+#include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
+#include <Bpp/Phyl/Parsimony/StepwiseAdditionTreeBuilder.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+// The results are sorted, distinct, and their scores are those of DRTreeParsimonyScore.
+bool checkResults(const vector<StepwiseAdditionTreeBuilder::Result>& results, const SiteContainer& sites, size_t nbBest)
+{
+  if (results.empty() || results.size() > nbBest)
+    return false;
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const TreeTemplate<Node>& tree = *results[i].tree;
+    if (tree.getNumberOfLeaves() != sites.getNumberOfSequences() || tree.getRootNode()->getNumberOfSons() != 3)
+    {
+      cerr << "Tree " << i << " is not a complete unrooted tree." << endl;
+      return false;
+    }
+    DRTreeParsimonyScore pars(tree, sites, false);
+    if (pars.getScore() != results[i].score)
+    {
+      cerr << "Tree " << i << ": score " << results[i].score << " instead of " << pars.getScore() << endl;
+      return false;
+    }
+    if (i > 0 && results[i].score < results[i - 1].score)
+    {
+      cerr << "Trees are not sorted by score." << endl;
+      return false;
+    }
+    for (size_t j = 0; j < i; ++j)
+      if (TreeTools::robinsonFouldsDistance(tree, *results[j].tree) == 0)
+      {
+        cerr << "Trees " << j << " and " << i << " have the same topology." << endl;
+        return false;
+      }
+  }
+  return true;
+}
+
+int main() {
+  try {
+    const Alphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+    CanonicalStateMap stateMap(alphabet, false);
+    vector<string> names(12);
+    for (size_t i = 0; i < names.size(); ++i)
+      names[i] = "leaf" + TextTools::toString(i);
+
+    //Perfect data: one site per branch of a random tree, so that the tree is the only
+    //one without homoplasy, and any stepwise addition finds it.
+    unique_ptr< TreeTemplate<Node> > trueTree(TreeTemplateTools::getRandomTree(names, false));
+    vector<string> perfect(names.size());
+    unsigned int nbBranches = 0;
+    vector<Node*> nodes = trueTree->getNodes();
+    for (size_t k = 0; k < nodes.size(); ++k)
+    {
+      if (nodes[k]->isLeaf() || !nodes[k]->hasFather())
+        continue;
+      vector<string> below = TreeTemplateTools::getLeavesNames(*nodes[k]);
+      for (size_t i = 0; i < names.size(); ++i)
+        perfect[i] += (find(below.begin(), below.end(), names[i]) != below.end() ? "A" : "C");
+      nbBranches++;
+    }
+    VectorSiteContainer perfectSites(alphabet);
+    for (size_t i = 0; i < names.size(); ++i)
+      perfectSites.addSequence(BasicSequence(names[i], perfect[i] + "GT", alphabet));
+    StepwiseAdditionTreeBuilder perfectBuilder(perfectSites, stateMap);
+    vector<StepwiseAdditionTreeBuilder::Result> perfectResults = perfectBuilder.build(5, 3, 7);
+    if (!checkResults(perfectResults, perfectSites, 3))
+      return 1;
+    if (perfectResults.size() != 1 || perfectResults[0].score != nbBranches ||
+        TreeTools::robinsonFouldsDistance(*perfectResults[0].tree, *trueTree) != 0)
+    {
+      cerr << "The tree of the perfect data was not found." << endl;
+      return 1;
+    }
+    cout << "Perfect data ok." << endl;
+
+    //Random data, with 1 and 4 threads, concurrent replicates or concurrent branches:
+    VectorSiteContainer sites(alphabet);
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+      vector<int> content(150);
+      for (size_t j = 0; j < content.size(); ++j)
+        content[j] = RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(4);
+      sites.addSequence(BasicSequence(names[i], content, alphabet));
+    }
+    StepwiseAdditionTreeBuilder builder(sites, stateMap);
+    size_t nbReplicates[] = {10, 2};
+    for (size_t n : nbReplicates)
+    {
+      vector<StepwiseAdditionTreeBuilder::Result> serial = builder.build(n, 4, 3, 1);
+      vector<StepwiseAdditionTreeBuilder::Result> threaded = builder.build(n, 4, 3, 4);
+      if (!checkResults(serial, sites, 4) || serial.size() != threaded.size())
+        return 1;
+      for (size_t i = 0; i < serial.size(); ++i)
+        if (serial[i].score != threaded[i].score ||
+            TreeTemplateTools::treeToParenthesis(*serial[i].tree) != TreeTemplateTools::treeToParenthesis(*threaded[i].tree))
+        {
+          cerr << n << " replicates: tree " << i << " depends on the number of threads." << endl;
+          return 1;
+        }
+    }
+    cout << "Threads ok." << endl;
+
+    //Explicit orders must be permutations:
+    try {
+      builder.build(vector<size_t>(names.size(), 0), 1);
+      cerr << "No error for an invalid order." << endl;
+      return 1;
+    } catch (Exception& ex) {}
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -43,6 +43,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <string>
 #include <vector>
 #include <iostream>
+#include <iomanip>
 
 using namespace bpp;
 using namespace std;
@@ -137,6 +138,23 @@ int main() {
     return 1;
   cout << "Newick I/O ok." << endl;
 
+  //Stream output does not depend on the settings of the stream:
+  for (size_t i = 0; i < tree10->getNumberOfNodes(); ++i)
+    if (tree10->getNodes()[i]->hasFather())
+      tree10->getNodes()[i]->setDistanceToFather(1. / 3. + static_cast<double>(i));
+  ostringstream oss;
+  oss << fixed << setprecision(12);
+  tWriter.write(*tree10, oss);
+  if (oss.str() != TreeTools::treeToParenthesis(*tree10)) {
+    cerr << "Newick output depends on the stream precision:" << endl << oss.str() << endl;
+    return 1;
+  }
+  if (oss.precision() != 12 || !(oss.flags() & ios::fixed)) {
+    cerr << "Newick output did not restore the stream format." << endl;
+    return 1;
+  }
+  cout << "Newick stream format ok." << endl;
+
   //Multiple trees:
   vector<const Tree *> trees;
   for (unsigned int i = 0; i < 100; ++i) {
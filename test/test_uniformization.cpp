@@ -0,0 +1,172 @@
+//
+// File: test_uniformization.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/KroneckerWordSubstitutionModel.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/FrequenciesSet/CodonFrequenciesSet.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Simulation/SubstitutionProcessSequenceSimulator.h>
+#include <Bpp/Phyl/NewLikelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/NewLikelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/NewLikelihood/RecursiveLikelihoodTreeCalculation.h>
+#include <Bpp/Phyl/NewLikelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+// P(t).v computed by uniformization agrees with the product by the
+// transition matrix of the eigen decomposition, on short and long
+// branches (the last one being split in several parts):
+bool testModel(const SubstitutionModel& model) {
+  size_t n = model.getNumberOfStates();
+  vector< vector<double> > vectors(3, vector<double>(n));
+  vectors[0][n / 3] = 1.;
+  for (size_t i = 0; i < n; ++i) {
+    vectors[1][i] = 1. / static_cast<double>(i + 1);
+    vectors[2][i] = (i % 3 == 0) ? 0. : abs(sin(static_cast<double>(i)));
+  }
+
+  vector<double> lengths = {0.001, 0.05, 0.3, 1., 3., 40.};
+  for (auto t : lengths) {
+    for (auto& v : vectors) {
+      vector<double> res;
+      model.applyPij_t(t, v, res);
+      const Matrix<double>& pij = model.getPij_t(t);
+      for (size_t i = 0; i < n; ++i) {
+        double dense = 0;
+        for (size_t j = 0; j < n; ++j)
+          dense += pij(i, j) * v[j];
+        if (abs(res[i] - dense) > 1e-11) {
+          cerr << model.getName() << ": P(" << t << ").v is " << res[i] << " instead of " << dense << " on row " << i << "." << endl;
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool isClose(double a, double b) {
+  return abs(a - b) <= 1e-9 * max(1., abs(b));
+}
+
+bool sameLikelihoods(const SingleProcessPhyloLikelihood& uniformized, const SingleProcessPhyloLikelihood& dense, size_t nbSites, const string& step) {
+  if (!isClose(uniformized.getValue(), dense.getValue())) {
+    cerr << step << ": likelihood " << uniformized.getValue() << " with uniformization instead of " << dense.getValue() << "." << endl;
+    return false;
+  }
+  for (size_t i = 0; i < nbSites; ++i)
+    if (!isClose(uniformized.getLogLikelihoodForASite(i), dense.getLogLikelihoodForASite(i))) {
+      cerr << step << ": site " << i << " differs with uniformization." << endl;
+      return false;
+    }
+  return true;
+}
+
+int main() {
+  try {
+    KroneckerWordSubstitutionModel word(new GTR(&AlphabetTools::DNA_ALPHABET, 1, 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2), 3);
+    if (!testModel(word))
+      return 1;
+    cout << "Uniformization on word model ok." << endl;
+
+    StandardGeneticCode gc(AlphabetTools::DNA_ALPHABET.clone());
+    YN98 yn98(&gc, CodonFrequenciesSet::getFrequenciesSetForCodons(CodonFrequenciesSet::F3X4, &gc));
+    yn98.setParameterValue("YN98.kappa", 2.5);
+    yn98.setParameterValue("YN98.omega", 0.3);
+    if (!testModel(yn98))
+      return 1;
+    cout << "Uniformization on codon model ok." << endl;
+
+    //Likelihoods propagated through applyPij_t:
+    Newick reader;
+    unique_ptr<PhyloTree> tree(reader.parenthesisToPhyloTree("((A:0.1,B:0.2):0.05,C:0.3,(D:0.1,E:0.4):0.2);"));
+    ParametrizablePhyloTree pTree(*tree);
+    GammaDiscreteRateDistribution rdist(3, 0.5);
+    KroneckerWordSubstitutionModel uniformizedWord(word);
+    uniformizedWord.enableUniformization(true);
+    if (!uniformizedWord.usesUniformization() || word.usesUniformization())
+      return 1;
+
+    unique_ptr<SubstitutionProcess> denseProcess(new RateAcrossSitesSubstitutionProcess(word.clone(), rdist.clone(), pTree.clone()));
+    unique_ptr<SubstitutionProcess> uniformizedProcess(new RateAcrossSitesSubstitutionProcess(uniformizedWord.clone(), rdist.clone(), pTree.clone()));
+
+    SimpleSubstitutionProcessSequenceSimulator simulator(*denseProcess);
+    unique_ptr<SiteContainer> sites(simulator.simulate(200, 5));
+
+    SingleProcessPhyloLikelihood dense(denseProcess.get(), new RecursiveLikelihoodTreeCalculation(*sites, denseProcess.get(), false, true));
+    SingleProcessPhyloLikelihood uniformized(uniformizedProcess.get(), new RecursiveLikelihoodTreeCalculation(*sites, uniformizedProcess.get(), false, true));
+    size_t nbSites = sites->getNumberOfSites();
+    if (!sameLikelihoods(uniformized, dense, nbSites, "Initial values"))
+      return 1;
+
+    string brLen, gtrA;
+    const ParameterList& pl = dense.getParameters();
+    for (size_t i = 0; i < pl.size(); ++i) {
+      if (brLen.empty() && pl[i].getName().compare(0, 5, "BrLen") == 0)
+        brLen = pl[i].getName();
+      if (gtrA.empty() && pl[i].getName().find("GTR.a") != string::npos)
+        gtrA = pl[i].getName();
+    }
+    if (brLen.empty() || gtrA.empty())
+      return 1;
+
+    dense.setParameterValue(brLen, 0.7);
+    uniformized.setParameterValue(brLen, 0.7);
+    if (!sameLikelihoods(uniformized, dense, nbSites, "After changing " + brLen))
+      return 1;
+
+    dense.setParameterValue(gtrA, 2.);
+    uniformized.setParameterValue(gtrA, 2.);
+    if (!sameLikelihoods(uniformized, dense, nbSites, "After changing " + gtrA))
+      return 1;
+    cout << "Uniformized likelihood ok." << endl;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,147 @@
+//
+// File: test_uniformization_count.cpp
+// Created by: Julien Dutheil
+// Created on: October 15, 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Mapping/SubstitutionRegister.h>
+#include <Bpp/Phyl/Mapping/UniformizationSubstitutionCount.h>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+typedef vector< vector<double> > Square;
+
+Square mult(const Square& a, const Square& b)
+{
+  size_t n = a.size();
+  Square c(n, vector<double>(n, 0));
+  for (size_t i = 0; i < n; ++i)
+    for (size_t k = 0; k < n; ++k)
+      for (size_t j = 0; j < n; ++j)
+        c[i][j] += a[i][k] * b[k][j];
+  return c;
+}
+
+// Exponential of a matrix, by scaling and squaring of its Taylor series.
+Square expm(Square a)
+{
+  size_t n = a.size();
+  double norm = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    double s = 0;
+    for (size_t j = 0; j < n; ++j)
+      s += abs(a[i][j]);
+    norm = max(norm, s);
+  }
+  int nbSquarings = 0;
+  while (norm > 0.1)
+  {
+    norm /= 2;
+    nbSquarings++;
+  }
+  for (size_t i = 0; i < n; ++i)
+    for (size_t j = 0; j < n; ++j)
+      a[i][j] = ldexp(a[i][j], -nbSquarings);
+  Square e(n, vector<double>(n, 0)), term(n, vector<double>(n, 0));
+  for (size_t i = 0; i < n; ++i)
+    e[i][i] = term[i][i] = 1;
+  for (int k = 1; k <= 20; ++k)
+  {
+    term = mult(term, a);
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < n; ++j)
+      {
+        term[i][j] /= k;
+        e[i][j] += term[i][j];
+      }
+  }
+  for (int k = 0; k < nbSquarings; ++k)
+    e = mult(e, e);
+  return e;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  T92 model(alphabet, 3., 0.65);
+  size_t n = model.getNumberOfStates();
+  const Matrix<double>& q = model.getGenerator();
+
+  // All substitutions are counted: b is the largest exit rate.
+  double b = 0;
+  for (size_t i = 0; i < n; ++i)
+    b = max(b, -q(i, i));
+
+  unique_ptr<UniformizationSubstitutionCount> count(new UniformizationSubstitutionCount(&model, new TotalSubstitutionRegister(model.getStateMap())));
+
+  // The joint expectation int_0^t P(s) B P(t - s) ds is the upper right
+  // block of the exponential of t [[Q, B], [0, Q]] (Van Loan).
+  double lengths[] = {1e-6, 0.001, 0.1, 0.5, 2., 10., 50., 0.01};
+  for (double t : lengths)
+  {
+    Square block(2 * n, vector<double>(2 * n, 0));
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < n; ++j)
+      {
+        block[i][j] = block[n + i][n + j] = q(i, j) * t;
+        block[i][n + j] = (i != j ? q(i, j) * t : 0);
+      }
+    Square e = expm(block);
+
+    unique_ptr< Matrix<double> > counts(count->getAllNumbersOfSubstitutions(t, 1));
+    RowMatrix<double> p = model.getPij_t(t);
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < n; ++j)
+      {
+        // The truncation bound, plus some room for round-off errors:
+        double joint = (*counts)(i, j) * p(i, j);
+        if (abs(joint - e[i][n + j]) > 1e-12 * b * t + 1e-13 * e[i][n + j])
+        {
+          cerr << "Length " << t << ", states " << i << ", " << j << ": " << joint << " instead of " << e[i][n + j] << endl;
+          return 1;
+        }
+      }
+  }
+  cout << "Joint expectations ok." << endl;
+
+  return 0;
+}